@@ -85,10 +85,14 @@ private:
 	void applyQualitySettings() override;
 	void run() override;
 
-	int setHWParams( const ch_cnt_t _channels, snd_pcm_access_t _access );
+	int setHWParams( const ch_cnt_t _channels );
 	int setSWParams();
 	int handleError( int _err );
 
+	// converts _frames frames to the format of the device at _dst
+	void convert( const surroundSampleFrame * _src, const fpp_t _frames,
+								char * _dst );
+
 
 	snd_pcm_t * m_handle;
 
@@ -98,7 +102,10 @@ private:
 	snd_pcm_hw_params_t * m_hwParams;
 	snd_pcm_sw_params_t * m_swParams;
 
+	snd_pcm_format_t m_format;
 	bool m_convertEndian;
+	// whether the periods get written straight into the ring of the device
+	bool m_mmap;
 
 } ;
 
@@ -26,9 +26,15 @@
 #define AUDIO_DEVICE_H
 
 #include <QtCore/QMutex>
+#include <QtCore/QString>
 #include <samplerate.h>
 
+#include <atomic>
+
 #include "lmms_basics.h"
+#include "CpuUsage.h"
+#include "Decimator.h"
+#include "MicroTimer.h"
 
 
 class AudioPort;
@@ -79,6 +85,11 @@ public:
 
 	void processNextBuffer();
 
+	//! Writes a period the mixer rendered besides its output, e.g. a
+	//! stem of an export, after converting it to the rate of the device
+	void processBuffer( const surroundSampleFrame * _buf,
+						const float _gain );
+
 	virtual void startProcessing()
 	{
 		m_inProcess = true;
@@ -88,6 +99,40 @@ public:
 
 	virtual void applyQualitySettings();
 
+	//! Whether the device renders each period from its own callback
+	//! through getNextBuffer(), in which case the mixer leaves out the
+	//! fifo and its writer thread
+	virtual bool rendersInCallback() const
+	{
+		return false;
+	}
+
+	//! How playback went so far, for telling a slow machine from a
+	//! misconfigured backend. Updated by the audio thread.
+	struct Statistics
+	{
+		//! Underruns reported by the backend, -1 if it can't detect them
+		int xruns;
+		//! Periods the device had to wait for longer than a period lasts
+		int latePeriods;
+		//! Deviation of the time between two periods being taken from
+		//! the length of a period, in microseconds
+		float jitterAverage;
+		float jitterMaximum;
+		//! Time getNextBuffer() took, i.e. waiting for or rendering the
+		//! period, in microseconds
+		float waitAverage;
+		float waitMaximum;
+		//! Periods rendered ahead when the device took one, 0 without fifo
+		float fifoDepth;
+		int fifoSize;
+	} ;
+
+	Statistics statistics() const;
+
+	//! One line summary of statistics() for the GUI and console
+	QString statisticsText() const;
+
 
 
 protected:
@@ -110,6 +155,17 @@ protected:
 						int_sample_t * _output_buffer,
 						const bool _convert_endian = false );
 
+	// same for devices taking signed 32-bit or float samples in the byte
+	// order of the machine
+	int convertToS32( const surroundSampleFrame * _ab,
+						const fpp_t _frames,
+						const float _master_gain,
+						int32_t * _output_buffer );
+	int convertToFloat( const surroundSampleFrame * _ab,
+						const fpp_t _frames,
+						const float _master_gain,
+						float * _output_buffer );
+
 	// clear given signed-int-16-buffer
 	void clearS16Buffer( int_sample_t * _outbuf,
 							const fpp_t _frames );
@@ -135,12 +191,25 @@ protected:
 
 	static void stopProcessingThread( QThread * thread );
 
+	//! To be called by backends which get notified about underruns
+	void reportXrun()
+	{
+		m_xruns.fetch_add( 1, std::memory_order_relaxed );
+	}
+
 
 protected:
 	bool m_supportsCapture;
+	//! Set by backends which call reportXrun()
+	bool m_detectsXruns;
 
 
 private:
+	// converts a period from the processing rate of the mixer, returns
+	// the number of frames written to _dst
+	fpp_t toDeviceRate( const surroundSampleFrame * _src, fpp_t _frames,
+						surroundSampleFrame * _dst );
+
 	sample_rate_t m_sampleRate;
 	ch_cnt_t m_channels;
 	Mixer* m_mixer;
@@ -150,9 +219,20 @@ private:
 
 	SRC_DATA m_srcData;
 	SRC_STATE * m_srcState;
+	// takes oversampled periods down to the rate of the device, cheaper
+	// than libsamplerate for whole factors
+	Decimator m_decimator;
 
 	surroundSampleFrame * m_buffer;
 
+	std::atomic_int m_xruns;
+	std::atomic_int m_latePeriods;
+	// time since the last period was taken
+	MicroTimer m_periodTimer;
+	CpuUsage m_jitter;
+	CpuUsage m_wait;
+	std::atomic<float> m_fifoDepth;
+
 } ;
 
 
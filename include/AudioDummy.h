@@ -99,10 +99,7 @@ private:
 			{
 				break;
 			}
-			if( mixer()->hasFifoWriter() )
-			{
-				delete[] b;
-			}
+			mixer()->releaseNextBuffer();
 
 			const int microseconds = static_cast<int>( mixer()->framesPerPeriod() * 1000000.0f / mixer()->processingSampleRate() - timer.elapsed() );
 			if( microseconds > 0 )
@@ -28,6 +28,8 @@
 
 #include <QtCore/QFile>
 
+#include <memory>
+
 #include "AudioDevice.h"
 #include "OutputSettings.h"
 
@@ -35,6 +37,8 @@
 class AudioFileDevice : public AudioDevice
 {
 public:
+	//! No file is opened if _file is empty, for devices which don't write
+	//! one
 	AudioFileDevice(OutputSettings const & outputSettings,
 			const ch_cnt_t _channels, const QString & _file,
 			Mixer* mixer );
@@ -47,8 +51,45 @@ public:
 
 	OutputSettings const & getOutputSettings() const { return m_outputSettings; }
 
+	// exporting in blocks saves the encoder the overhead of a call per
+	// period, see ProjectRenderer::run()
+
+	//! Frames collected before they're passed to the encoder, 0 passes
+	//! each period on its own like processNextBuffer()
+	void setBlockSize( f_cnt_t _frames );
+	//! Renders the next period into the current block, which is passed to
+	//! the encoder once it's full. Returns false if there was no period.
+	bool processNextPeriod();
+	//! Drops the frames of the period processNextPeriod() just rendered
+	//! except for the ones from _first up to _last, which are counted at
+	//! the processing rate of the mixer
+	void keepOfLastPeriod( f_cnt_t _first, f_cnt_t _last );
+	//! Frames at the rate of the device which processNextPeriod() just
+	//! rendered and keepOfLastPeriod() left of them
+	f_cnt_t lastPeriodFrames() const
+	{
+		return m_lastPeriodFrames;
+	}
+	//! Passes _frames frames which are at the rate of the device already
+	//! to the encoder, e.g. when joining files, see SegmentStitcher
+	void writeFrames( const surroundSampleFrame * _ab, fpp_t _frames )
+	{
+		writeBuffer( _ab, _frames, 1.0f );
+	}
+	//! Passes the frames collected so far to the encoder and waits for it
+	//! to finish them, has to be done after the last period
+	void flushBlock();
+
 
 protected:
+	//! Whether encoding takes long enough to be worth a thread of its own
+	//! when exporting in blocks, which then calls writeBuffer() while the
+	//! song goes on rendering
+	virtual bool encodesInBackground() const
+	{
+		return false;
+	}
+
 	int writeData( const void* data, int len );
 
 	inline bool outputFileOpened() const
@@ -62,8 +103,20 @@ protected:
 	}
 
 private:
+	class EncoderThread;
+
+	// passes the current block to the encoder or its thread
+	void passBlock();
+
 	QFile m_outputFile;
 	OutputSettings m_outputSettings;
+
+	surroundSampleFrame * m_block;
+	f_cnt_t m_blockSize;
+	f_cnt_t m_blockFrames;
+	f_cnt_t m_lastPeriodFrames;
+
+	std::unique_ptr<EncoderThread> m_encoder;
 } ;
 
 
@@ -65,6 +65,10 @@ private:
 	virtual void writeBuffer(surroundSampleFrame const* _ab,
 						fpp_t const frames,
 						float master_gain) override;
+	bool encodesInBackground() const override
+	{
+		return true;
+	}
 
 	bool startEncoding();
 	void finishEncoding();
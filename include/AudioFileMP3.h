@@ -59,6 +59,10 @@ protected:
 	virtual void writeBuffer( const surroundSampleFrame * /* _buf*/,
 				  const fpp_t /*_frames*/,
 				  const float /*_master_gain*/ ) override;
+	bool encodesInBackground() const override
+	{
+		return true;
+	}
 
 private:
 	void flushRemainingBuffers();
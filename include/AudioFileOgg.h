@@ -60,6 +60,10 @@ private:
 	virtual void writeBuffer( const surroundSampleFrame * _ab,
 						const fpp_t _frames,
 						const float _master_gain ) override;
+	bool encodesInBackground() const override
+	{
+		return true;
+	}
 
 	bool startEncoding();
 	void finishEncoding();
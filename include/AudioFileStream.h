@@ -0,0 +1,112 @@
+/*
+ * AudioFileStream.h - AudioFileDevice which streams WAV or raw PCM to
+ *                     standard output, a pipe or a socket while rendering
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef AUDIO_FILE_STREAM_H
+#define AUDIO_FILE_STREAM_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+
+#include "AudioFileDevice.h"
+
+
+//! Writes the export as it's rendered without ever seeking back, so it can
+//! go to a reader which consumes it meanwhile, e.g. an encoder reading
+//! standard output. The samples are either preceded by a WAV header whose
+//! sizes are left unknown or written as raw interleaved little endian PCM.
+//! Writes block while the reader falls behind, encodesInBackground() keeps
+//! that from stalling the render until the encoder thread's ring is full.
+class AudioFileStream : public AudioFileDevice
+{
+public:
+	//! _target is "-" for standard output, "tcp://<host>:<port>" to
+	//! connect to, a pipe or a file
+	AudioFileStream( OutputSettings const & outputSettings,
+			const ch_cnt_t channels,
+			bool & successful,
+			const QString & target,
+			bool raw,
+			Mixer* mixer );
+	virtual ~AudioFileStream();
+
+	static AudioFileDevice * getInst( const QString & outputFilename,
+					  OutputSettings const & outputSettings,
+					  const ch_cnt_t channels,
+					  Mixer* mixer,
+					  bool & successful )
+	{
+		return new AudioFileStream( outputSettings, channels, successful,
+					  outputFilename, false, mixer );
+	}
+
+	static AudioFileDevice * getRawInst( const QString & outputFilename,
+					  OutputSettings const & outputSettings,
+					  const ch_cnt_t channels,
+					  Mixer* mixer,
+					  bool & successful )
+	{
+		return new AudioFileStream( outputSettings, channels, successful,
+					  outputFilename, true, mixer );
+	}
+
+	//! Whether _target can only be written front to back and mustn't be
+	//! removed if the export is aborted: standard output, a socket or a
+	//! pipe
+	static bool isStream( const QString & _target );
+
+	//! Keeps standard output for the stream and sends what's printed to it
+	//! to standard error instead, has to be called before anything else
+	//! gets printed if the export goes to "-"
+	static void reserveStandardOutput();
+
+
+protected:
+	bool encodesInBackground() const override
+	{
+		return true;
+	}
+
+
+private:
+	virtual void writeBuffer( const surroundSampleFrame * _ab,
+						const fpp_t _frames,
+						float _master_gain ) override;
+
+	bool openStream( const QString & _target );
+	bool writeHeader();
+	// writes all of _data in chunks, returns false once the reader is gone
+	bool writeChunked( const char * _data, qint64 _size );
+
+	// larger writes are split, so a pipe's reader gets going early
+	static const qint64 ChunkBytes = 64 * 1024;
+
+	const bool m_raw;
+	const int m_sampleBytes;
+	QFile m_stream;
+	QByteArray m_buffer;
+	bool m_failed;
+
+} ;
+
+
+#endif
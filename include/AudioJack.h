@@ -43,6 +43,7 @@
 
 class QLineEdit;
 class LcdSpinBox;
+class LedCheckBox;
 class MidiJack;
 
 
@@ -59,6 +60,11 @@ public:
 	AudioJack * addMidiClient(MidiJack *midiClient);
 	jack_client_t * jackClient() {return m_client;};
 
+	bool rendersInCallback() const override
+	{
+		return m_renderInCallback;
+	}
+
 	inline static QString name()
 	{
 		return QT_TRANSLATE_NOOP( "setupWidget",
@@ -77,6 +83,7 @@ public:
 	private:
 		QLineEdit * m_clientName;
 		LcdSpinBox * m_channels;
+		LedCheckBox * m_renderInCallback;
 
 	} ;
 
@@ -101,12 +108,15 @@ private:
 	static int staticProcessCallback( jack_nframes_t _nframes,
 							void * _udata );
 	static void shutdownCallback( void * _udata );
+	static int xrunCallback( void * _udata );
 
 
 	jack_client_t * m_client;
 
 	bool m_active;
 	bool m_stopped;
+	// render the periods in processCallback() instead of a fifo thread
+	const bool m_renderInCallback;
 
 	MidiJack *m_midiClient;
 	QVector<jack_port_t *> m_outputPorts;
@@ -25,17 +25,22 @@
 #ifndef AUDIO_PORT_H
 #define AUDIO_PORT_H
 
+#include <atomic>
 #include <memory>
 #include <QtCore/QString>
 #include <QtCore/QMutex>
 #include <QtCore/QMutexLocker>
 
+#include "AudioTap.h"
+#include "LatencyCompensator.h"
 #include "MemoryManager.h"
 #include "PlayHandle.h"
 
+class BBLoopCache;
 class EffectChain;
 class FloatModel;
 class BoolModel;
+class StemTap;
 
 class AudioPort : public ThreadableJob
 {
@@ -99,6 +104,23 @@ public:
 
 	bool processEffects();
 
+	// latency compensation, see FxMixer::prepareMasterMix()
+
+	//! Frames the input of the port lags behind, i.e. the latency of the
+	//! instrument playing into it
+	void setSourceLatency( f_cnt_t _frames )
+	{
+		m_sourceLatency = _frames;
+	}
+	//! Latency of the output including the effects of the port
+	f_cnt_t latency() const;
+	//! Delay the output by _frames, to line it up with slower ports
+	//! and channels feeding the same FX channel
+	void setCompensation( f_cnt_t _frames )
+	{
+		m_compensator.setDelay( _frames );
+	}
+
 	// ThreadableJob stuff
 	void doProcessing() override;
 	bool requiresProcessing() const override
@@ -109,6 +131,99 @@ public:
 	void addPlayHandle( PlayHandle * handle );
 	void removePlayHandle( PlayHandle * handle );
 
+	// render graph stuff, see Mixer::runRenderGraph()
+
+	//! Reset graph state and link port to its FX channel. Until
+	//! finishRenderGraphSetup() is called, the port isn't queued.
+	void prepareRenderGraph();
+	//! Make the port wait for one more play handle
+	void addPendingPlayHandle()
+	{
+		++m_pendingPlayHandles;
+	}
+	//! Undo addPendingPlayHandle() for a play handle which wasn't queued
+	void removePendingPlayHandle()
+	{
+		--m_pendingPlayHandles;
+	}
+	void finishRenderGraphSetup()
+	{
+		predecessorDone();
+	}
+
+	// anticipative rendering, see Mixer::startAnticipativeJobs()
+
+	//! Render the port one period ahead on otherwise idle worker threads,
+	//! only for ports of tracks which don't depend on live input
+	void setAnticipative( bool _anticipative )
+	{
+		m_anticipative = _anticipative;
+	}
+	bool isAnticipative() const
+	{
+		return m_anticipative;
+	}
+	//! Whether the output of the current period has been rendered during
+	//! the previous period already
+	bool renderedAhead() const
+	{
+		return m_renderedAhead;
+	}
+	//! Send output rendered ahead to the FX mixer
+	void mixAheadOutput();
+
+	//! Time the play handles of the port took, i.e. the instrument, while
+	//! cpuUsage() is the time of the effects and mixing
+	const CpuUsage & playHandleCpuUsage() const
+	{
+		return m_playHandleCpuUsage;
+	}
+
+	//! Copy the output of each period to _tap while exporting stems,
+	//! before or after the effects of the port, see StemExporter
+	void setStemTap( StemTap * _tap, bool _preEffects )
+	{
+		m_stemTap = _tap;
+		m_stemTapPreEffects = _preEffects;
+	}
+
+	//! Copy what the play handles of the port rendered in each period to
+	//! _tap while freezing a track, before the volume, panning and effects
+	//! of the port or after them, see TrackFreeze
+	void setFreezeTap( StemTap * _tap, bool _afterEffects )
+	{
+		m_freezeTap = _tap;
+		m_freezeTapAfterEffects = _afterEffects;
+	}
+
+	//! Pass what the play handles of the port rendered in each period to
+	//! _cache, before the volume, panning and effects of the port
+	void setLoopCache( BBLoopCache * _cache )
+	{
+		m_loopCache = _cache;
+	}
+
+	//! The output of the port after its effects, i.e. the audio of the
+	//! track, for scopes and meters
+	AudioTapPoint & tap()
+	{
+		return m_tap;
+	}
+
+	//! Pass on what the play handles render as it is, for the audio of a
+	//! track frozen with its volume, panning and effects applied already
+	void setFrozenAfterEffects( bool _frozen )
+	{
+		m_frozenAfterEffects = _frozen;
+	}
+
+protected:
+	void predecessorDone() override;
+	const char * traceName() const override
+	{
+		return "AudioPort";
+	}
+
 private:
 	volatile bool m_bufferUsage;
 
@@ -129,8 +244,31 @@ private:
 	FloatModel * m_panningModel;
 	BoolModel * m_mutedModel;
 
+	AudioTapPoint m_tap;
+
+	// number of play handles which have to be processed before the port
+	// can be queued
+	std::atomic_int m_pendingPlayHandles;
+
+	bool m_anticipative;
+	bool m_renderedAhead;
+	bool m_hasAheadOutput;
+
+	CpuUsage m_playHandleCpuUsage;
+
+	f_cnt_t m_sourceLatency;
+	LatencyCompensator m_compensator;
+
+	StemTap * m_stemTap;
+	bool m_stemTapPreEffects;
+	StemTap * m_freezeTap;
+	bool m_freezeTapAfterEffects;
+	bool m_frozenAfterEffects;
+	BBLoopCache * m_loopCache;
+
 	friend class Mixer;
 	friend class MixerWorkerThread;
+	friend class PlayHandle;
 
 } ;
 
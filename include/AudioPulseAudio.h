@@ -73,6 +73,11 @@ public:
 
 	void streamWriteCallback( pa_stream * s, size_t length );
 
+	void streamUnderflowCallback()
+	{
+		reportXrun();
+	}
+
 	void signalConnected( bool connected );
 
 	pa_stream * m_s;
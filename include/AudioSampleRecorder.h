@@ -26,11 +26,9 @@
 #ifndef AUDIO_SAMPLE_RECORDER_H
 #define AUDIO_SAMPLE_RECORDER_H
 
-#include <QtCore/QList>
-#include <QtCore/QPair>
-
 #include "AudioDevice.h"
 
+class RecordingWriter;
 class SampleBuffer;
 
 
@@ -50,8 +48,8 @@ private:
 						const fpp_t _frames,
 						const float _master_gain ) override;
 
-	typedef QList<QPair<sampleFrame *, fpp_t> > BufferList;
-	BufferList m_buffers;
+	// streams the frames to a file in the samples directory
+	RecordingWriter * m_writer;
 
 } ;
 
@@ -0,0 +1,126 @@
+/*
+ * AudioTap.h - lets the GUI look at the audio of the master output, an FX
+ *              channel or a track without getting in the way of the mixer
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef AUDIO_TAP_H
+#define AUDIO_TAP_H
+
+#include <atomic>
+
+#include "lmms_basics.h"
+#include "lmms_export.h"
+#include "LocklessRingBuffer.h"
+
+
+//! The audio of one point of the mixer, e.g. for scopes and meters. The
+//! mixer thread writes each period into a lock-free ring buffer as long as
+//! there are readers, the GUI thread takes what arrived whenever it redraws
+//! and keeps the latest frames, so any number of views can look at them at
+//! their own pace. Frames which don't fit because the GUI stalled are lost.
+class LMMS_EXPORT AudioTap
+{
+public:
+	//! Frames the ring buffer and the history hold
+	static const f_cnt_t Capacity = 8192;
+
+	AudioTap();
+	~AudioTap();
+
+	// mixer thread
+
+	//! Whether anyone reads the tap, nothing needs to be written otherwise
+	bool isActive() const
+	{
+		return m_readers.load( std::memory_order_relaxed ) > 0;
+	}
+
+	//! Appends _frames frames, silence if _buffer is NULL
+	void write( const sampleFrame * _buffer, fpp_t _frames );
+
+	// GUI thread
+
+	//! Called by each view when it starts and stops looking at the tap
+	void addReader();
+	void removeReader();
+
+	//! Copies the latest _frames frames into _dest, at most Capacity
+	void latest( sampleFrame * _dest, f_cnt_t _frames );
+
+	//! Frames arrived since the first reader was added, after latest(),
+	//! to tell how many of them are new to a view
+	f_cnt_t framesReceived() const
+	{
+		return m_received;
+	}
+
+
+private:
+	//! Moves what the mixer wrote into the history
+	void fetch();
+
+	LocklessRingBuffer<sampleFrame> m_ring;
+	LocklessRingBufferReader<sampleFrame> m_reader;
+	std::atomic_int m_readers;
+
+	// the latest frames, only touched by the GUI thread
+	sampleFrame * m_history;
+	f_cnt_t m_historyPos;
+	f_cnt_t m_received;
+
+} ;
+
+
+
+
+//! Where a tap can be attached, the tap is created when the GUI asks for it
+//! first and lives as long as the point
+class LMMS_EXPORT AudioTapPoint
+{
+public:
+	AudioTapPoint() :
+		m_tap( nullptr )
+	{
+	}
+
+	~AudioTapPoint();
+
+	//! The tap, created on demand, GUI thread only
+	AudioTap * tap();
+
+	//! Passes the audio of a period on if anyone reads it, mixer thread
+	void write( const sampleFrame * _buffer, fpp_t _frames )
+	{
+		AudioTap * tap = m_tap.load( std::memory_order_acquire );
+		if( tap && tap->isActive() )
+		{
+			tap->write( _buffer, _frames );
+		}
+	}
+
+
+private:
+	std::atomic<AudioTap *> m_tap;
+
+} ;
+
+
+#endif
@@ -25,6 +25,8 @@
 #ifndef AUTOMATABLE_MODEL_H
 #define AUTOMATABLE_MODEL_H
 
+#include <atomic>
+
 #include <QtCore/QMap>
 #include <QtCore/QMutex>
 
@@ -199,6 +201,10 @@ public:
 	void setInitValue( const float value );
 
 	void setAutomatedValue( const float value );
+	//! Make valueBuffer() return the automation from frame offset to the
+	//! end of the current period, given as values of automation patterns.
+	//! Frames before offset are kept if set this period already.
+	void setAutomatedValues( const float * values, f_cnt_t offset );
 	void setValue( const float value );
 
 	void incValue( int steps )
@@ -298,6 +304,14 @@ public:
 		s_periodCounter = 0;
 	}
 
+	//! Number of the period being rendered - it's incremented before
+	//! anticipative rendering starts, so ports rendering one period ahead
+	//! get the number of the period they render too
+	static long periodCounter()
+	{
+		return s_periodCounter;
+	}
+
 public slots:
 	virtual void reset();
 	void unlinkControllerConnection();
@@ -386,14 +400,41 @@ private:
 	ControllerConnection* m_controllerConnection;
 
 
-	ValueBuffer m_valueBuffer;
-	long m_lastUpdatedPeriod;
+	//! From ValueBuffer::acquire() while there is sample-exact data, NULL
+	//! otherwise
+	ValueBuffer * m_valueBuffer;
+	std::atomic<long> m_lastUpdatedPeriod;
+	//! The period m_valueBuffer holds the automation of
+	long m_automatedPeriod;
+	//! The buffer of a linked model with the same range returned instead
+	//! of m_valueBuffer, NULL if there's none
+	ValueBuffer * m_sharedValueBuffer;
 	static long s_periodCounter;
 
 	bool m_hasSampleExactData;
 
-	// prevent several threads from attempting to write the same vb at the same time
-	QMutex m_valueBufferMutex;
+	// prevent several threads from attempting to write the same vb at the
+	// same time, only held while it is being calculated
+	std::atomic_bool m_updatingValueBuffer;
+
+	void updateValueBuffer();
+
+	bool hasSameRangeAs( const AutomatableModel * other ) const
+	{
+		return m_scaleType == other->m_scaleType &&
+			m_minValue == other->m_minValue &&
+			m_maxValue == other->m_maxValue &&
+			m_step == other->m_step;
+	}
+
+	ValueBuffer * ownValueBuffer()
+	{
+		if( m_valueBuffer == NULL )
+		{
+			m_valueBuffer = ValueBuffer::acquire();
+		}
+		return m_valueBuffer;
+	}
 
 signals:
 	void initValueChanged( float val );
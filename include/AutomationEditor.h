@@ -37,6 +37,7 @@
 #include "MidiTime.h"
 #include "AutomationPattern.h"
 #include "ComboBoxModel.h"
+#include "embed.h"
 #include "Knob.h"
 
 class QPainter;
@@ -185,12 +186,12 @@ private:
 	AutomationEditor( const AutomationEditor & );
 	virtual ~AutomationEditor();
 
-	static QPixmap * s_toolDraw;
-	static QPixmap * s_toolErase;
-	static QPixmap * s_toolSelect;
-	static QPixmap * s_toolMove;
-	static QPixmap * s_toolYFlip;
-	static QPixmap * s_toolXFlip;
+	static LazyPixmap s_toolDraw;
+	static LazyPixmap s_toolErase;
+	static LazyPixmap s_toolSelect;
+	static LazyPixmap s_toolMove;
+	static LazyPixmap s_toolYFlip;
+	static LazyPixmap s_toolXFlip;
 
 	ComboBoxModel m_zoomingXModel;
 	ComboBoxModel m_zoomingYModel;
@@ -0,0 +1,115 @@
+/*
+ * AutomationIndex.h - automation patterns and BB TCOs of a track container
+ *                     sorted by position for looking up automated values
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef AUTOMATION_INDEX_H
+#define AUTOMATION_INDEX_H
+
+#include <atomic>
+#include <vector>
+
+#include "AutomatableModel.h"
+#include "lmms_export.h"
+#include "MidiTime.h"
+
+
+class AutomationPattern;
+class TrackContainer;
+class TrackContentObject;
+
+
+//! What TrackContainer::automatedValuesAt() returns for all TCOs, without
+//! collecting them every time: the automation patterns and BB TCOs are
+//! kept sorted by position together with the models each of them
+//! automates last. A cursor into them advances with the time asked for,
+//! so during playback every call only visits the TCOs which started since
+//! the last one and evaluates the patterns currently in effect.
+//!
+//! All indices are rebuilt on their next use after invalidate(), which is
+//! called whenever tracks, TCOs or the objects of automation patterns
+//! change. Only to be used by the thread processing the song.
+class LMMS_EXPORT AutomationIndex
+{
+public:
+	struct Value
+	{
+		AutomatableModel * model;
+		float value;
+		//! what the value comes from, NULL for BB TCOs
+		const AutomationPattern * pattern;
+	} ;
+	typedef std::vector<Value> Values;
+
+	AutomationIndex( const TrackContainer * container );
+
+	static void invalidate()
+	{
+		++s_generation;
+	}
+
+	//! Values of all models automated at _time
+	const Values & valuesAt( MidiTime time );
+
+	//! Patterns of automation tracks which are recording
+	const std::vector<AutomationPattern *> & recordingPatterns();
+
+
+private:
+	struct Entry
+	{
+		TrackContentObject * tco;
+		// into m_models
+		std::vector<int> models;
+	} ;
+
+	void update();
+	void rebuild();
+	void seek( MidiTime time );
+
+	static std::atomic_int s_generation;
+
+	const TrackContainer * m_container;
+	int m_generation;
+
+	std::vector<Entry> m_entries;
+	std::vector<AutomatableModel *> m_models;
+	std::vector<AutomationPattern *> m_recording;
+
+	// number of entries starting at or before m_time
+	int m_cursor;
+	MidiTime m_time;
+	// per model, the entry automating it last, -1 for none yet
+	std::vector<int> m_winners;
+
+	// per entry, what valuesAt() evaluated if m_evaluated matches
+	// m_evaluation
+	std::vector<unsigned int> m_evaluated;
+	std::vector<float> m_patternValues;
+	std::vector<AutomatedValueMap> m_bbValues;
+	unsigned int m_evaluation;
+
+	Values m_values;
+
+} ;
+
+
+#endif
@@ -28,8 +28,10 @@
 #define AUTOMATION_PATTERN_H
 
 #include <QtCore/QMap>
+#include <QtCore/QMutex>
 #include <QtCore/QPointer>
 
+#include "AutomationIndex.h"
 #include "Track.h"
 
 
@@ -136,6 +138,16 @@ public:
 
 	float valueAt( const MidiTime & _time ) const;
 	float *valuesAfter( const MidiTime & _time ) const;
+	//! Write the values at _frames times from _time on, _ticksPerFrame
+	//! apart, limited to the pattern unless it resizes automatically.
+	//! Returns whether they differ.
+	bool renderValues( float * _values, float _time, float _ticksPerFrame,
+							int _frames ) const;
+	//! The values of the segment from _segment to the next point every
+	//! _step ticks, for drawing the curve. Kept until the segment is
+	//! edited or drawn with another step, e.g. after zooming.
+	QVector<float> segmentValues( timeMap::const_iterator _segment,
+							int _step ) const;
 
 	const QString name() const;
 
@@ -155,7 +167,11 @@ public:
 	static void resolveAllIDs();
 
 	bool isRecording() const { return m_isRecording; }
-	void setRecording( const bool b ) { m_isRecording = b; }
+	void setRecording( const bool b )
+	{
+		m_isRecording = b;
+		AutomationIndex::invalidate();
+	}
 
 	static int quantization() { return s_quantization; }
 	static void setQuantization(int q) { s_quantization = q; }
@@ -167,11 +183,17 @@ public slots:
 	void flipY();
 	void flipX( int length = -1 );
 
+private slots:
+	void updateAutomationIndex();
+
 private:
 	void cleanObjects();
 	void generateTangents();
 	void generateTangents( timeMap::const_iterator it, int numToGenerate );
 	float valueAt( timeMap::const_iterator v, int offset ) const;
+	//! Forgets the values of the segments starting from _from to _to
+	void invalidateSegments( int _from, int _to );
+	void invalidateSegments();
 
 	AutomationTrack * m_autoTrack;
 	QVector<jo_id_t> m_idsToResolve;
@@ -188,6 +210,21 @@ private:
 	bool m_isRecording;
 	float m_lastRecordedValue;
 
+	// what the automation index was last told about
+	bool m_indexedAutomation;
+	int m_indexedObjects;
+
+	struct Segment
+	{
+		int end;
+		int step;
+		QVector<float> values;
+	} ;
+	// by the key of their first point, drawn from the GUI while points
+	// may be recorded from the mixer
+	mutable QMutex m_segmentsMutex;
+	mutable QMap<int, Segment> m_segments;
+
 	static int s_quantization;
 
 	static const float DEFAULT_MIN_VALUE;
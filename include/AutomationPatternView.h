@@ -65,7 +65,6 @@ protected:
 
 private:
 	AutomationPattern * m_pat;
-	QPixmap m_paintPixmap;
 	
 	QStaticText m_staticTextName;
 	
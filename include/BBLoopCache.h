@@ -0,0 +1,190 @@
+/*
+ * BBLoopCache.h - replays the audio of an instrument track of a beat/bassline
+ *                 which repeats unchanged
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef BB_LOOP_CACHE_H
+#define BB_LOOP_CACHE_H
+
+#include <vector>
+
+#include <QtCore/QList>
+
+#include "lmms_basics.h"
+#include "MemoryManager.h"
+#include "PlayHandle.h"
+
+class AutomatableModel;
+class BBLoopPlayHandle;
+class InstrumentTrack;
+class Pattern;
+class Track;
+
+
+//! The audio of an instrument track of the beat/bassline editor for one
+//! repetition of a beat/bassline, recorded while it's played and replayed
+//! for as long as it repeats the same way, instead of playing the notes
+//! again. Only tracks with an instrument which renders notes the same way
+//! each time are cached, see Instrument::isDeterministic(), and only while
+//! none of the models the sound depends on is automated or controlled.
+//! The audio is taken before the volume, panning and effects of the track,
+//! which still apply to the replayed audio, so its FX channel and route
+//! don't matter. Everything but setModels() is called by the mixer thread.
+//!
+//! A repetition is recorded once a whole one has been played, so the tails
+//! of the notes of the repetition before it are part of it as well. The
+//! notes still playing are dropped at the start of the period after the
+//! recording ended, the cached audio continues from where they were.
+class LMMS_EXPORT BBLoopCache
+{
+	MM_OPERATORS
+public:
+	BBLoopCache( InstrumentTrack * _track );
+	~BBLoopCache();
+
+	//! Whether beat/bassline tracks are cached, see the setup dialog
+	static bool isEnabled();
+
+	//! Sets the models the audio depends on, called by the GUI thread
+	//! with the track locked whenever they change
+	void setModels( const QList<AutomatableModel *> & _models );
+	//! Forgets the models before the ones of the instrument are deleted,
+	//! nothing is cached until they are set again
+	void clearModels();
+
+	//! Called before the song plays a period
+	void startPeriod();
+	//! Called by the track for each tick of beat/bassline _bb played
+	//! _offset frames into the period with the track locked, returns
+	//! whether the cached audio plays it so no notes are to be started
+	bool playTick( Pattern * _pattern, Track * _bbTrack, int _bb,
+					tick_t _tick, f_cnt_t _offset );
+	//! Called by the port of the track with the audio of its play handles
+	//! once per period rendered
+	void capture( const sampleFrame * const * _sources, int _count,
+							fpp_t _frames );
+
+
+private:
+	enum States
+	{
+		Live,
+		Recording,
+		//! The loop is complete, the notes are replaced by it at
+		//! the start of the next period
+		Switching,
+		Replaying
+	} ;
+
+	//! Hashes what the audio of _pattern depends on into _fingerprint,
+	//! returns false if it's not the same for each repetition
+	bool fingerprint( Pattern * _pattern, Track * _bbTrack,
+					quint64 & _fingerprint ) const;
+	//! Go back to playing the notes _offset frames into the period
+	void stop( f_cnt_t _offset );
+
+	//! At most this many seconds of audio per track
+	static const int MaxSeconds = 30;
+
+	InstrumentTrack * m_track;
+	BBLoopPlayHandle * m_handle;
+
+	QList<AutomatableModel *> m_models;
+	bool m_modelsValid;
+
+	States m_state;
+
+	// the beat/bassline and the next tick expected, to find out whether
+	// the repetitions are played one after the other
+	int m_bb;
+	tick_t m_nextTick;
+	tick_t m_loopTicks;
+	//! Whether a repetition has been played from its start on
+	bool m_playedLoopStart;
+	f_cnt_t m_framesSinceTick;
+
+	// the loop, interleaved stereo
+	std::vector<sample_t> m_loop;
+	int m_loopBB;
+	quint64 m_fingerprint;
+
+	// frames of the period being rendered to be recorded, m_captureBegin
+	// is -1 if there are none
+	f_cnt_t m_captureBegin;
+	f_cnt_t m_captureEnd;
+	bool m_captured;
+	//! Where the loop started or ended in the period it was recorded in
+	f_cnt_t m_switchOffset;
+
+
+	friend class BBLoopPlayHandle;
+
+} ;
+
+
+
+
+//! Plays the cached loop of a track into its port, see BBLoopCache. Lives
+//! as long as the cache, like a FreezePlayHandle.
+class BBLoopPlayHandle : public PlayHandle
+{
+public:
+	BBLoopPlayHandle( BBLoopCache * _cache, InstrumentTrack * _track );
+
+	//! It's removed by the thread it was created by, right away
+	bool affinityMatters() const override
+	{
+		return true;
+	}
+
+	void play( sampleFrame * _buffer ) override;
+
+	bool isFinished() const override
+	{
+		return false;
+	}
+
+	bool isFromTrack( const Track * _track ) const override;
+
+	//! Plays the loop from _frame on, from the next period on
+	void start( f_cnt_t _frame );
+	//! Plays the loop from its start on from _offset frames into the
+	//! current period on
+	void restart( f_cnt_t _offset );
+	//! Stops playing _offset frames into the current period
+	void stop( f_cnt_t _offset );
+
+
+private:
+	BBLoopCache * m_cache;
+	InstrumentTrack * m_track;
+
+	// next frame of the loop to be played, -1 while it's not played
+	f_cnt_t m_frame;
+	// where in the current period the loop starts over or stops, -1 if
+	// it doesn't
+	f_cnt_t m_restartOffset;
+	f_cnt_t m_stopOffset;
+
+} ;
+
+
+#endif
@@ -117,7 +117,6 @@ protected:
 
 private:
 	BBTCO * m_bbTCO;
-	QPixmap m_paintPixmap;
 	
 	QStaticText m_staticTextName;
 } ;
@@ -64,6 +64,12 @@ public:
 
 	AutomatedValueMap automatedValuesAt(MidiTime time, int tcoNum) const override;
 
+	//! Lets the instrument tracks replay beat/basslines repeated unchanged
+	//! from a cache, see BBLoopCache
+	void setLoopCaching( bool _enabled );
+	//! Called by the song before it plays a period
+	void startPeriod();
+
 public slots:
 	void play();
 	void stop();
@@ -54,7 +54,7 @@ const int TLENS[MAXTBL+1] = { 2 << 0, 3 << 0, 2 << 1, 3 << 1,
 typedef struct
 {
 public:
-	inline sample_t sampleAt( int table, int ph )
+	inline sample_t sampleAt( int table, int ph ) const
 	{
 		if( table % 2 == 0 )
 		{	return m_data[ TLENS[ table ] + ph ]; }
@@ -124,11 +124,24 @@ public:
 	 *  \param _wave The wanted waveform. Options currently are saw, triangle, square and moog saw.
 	 */
 	static inline sample_t oscillate( float _ph, float _wavelen, Waveforms _wave )
+	{
+		return oscillateTable( _ph, tableIndex( _wavelen ), _wave );
+	}
+
+	/*! \brief The mipmap level oscillateTable() needs for a wavelength. Oscillators with a fixed
+	 *  frequency for a period can look it up once instead of with every sample.
+	 */
+	static inline int tableIndex( float _wavelen )
 	{
 		// get the next higher tlen
 		int t = 0;
 		while( t < MAXTBL && _wavelen >= TLENS[t+1] ) { t++; }
+		return t;
+	}
 
+	/*! \brief Same as oscillate(), with the mipmap level from tableIndex() */
+	static inline sample_t oscillateTable( float _ph, int t, Waveforms _wave )
+	{
 		int tlen = TLENS[t];
 		const float ph = fraction( _ph );
 		const float lookupf = ph * static_cast<float>( tlen );
@@ -159,11 +172,16 @@ public:
 	};
 
 
+	/*! \brief Maps the mipmaps from the wavetable cache. If there is no cache for this version
+	 *  yet, they're loaded from the wavetable files or generated and the cache is written, so the
+	 *  next processes can share its pages read-only instead of building their own copy.
+	 */
 	static void generateWaves();
 
 	static bool s_wavesGenerated;
 
-	static WaveMipMap s_waveforms [NumBLWaveforms];
+	//! NumBLWaveforms mipmaps, either in the mapped cache or allocated by generateWaves()
+	static const WaveMipMap * s_waveforms;
 
 	static QString s_wavetableDir;
 };
@@ -128,6 +128,65 @@ public:
 		return y;
 	}
 
+	//! update() of _low and _high for all frames and channels of _in, e.g.
+	//! the low and high pass of a crossover. Both filters and all channels
+	//! are lanes of one loop, so they're processed side by side. The outputs
+	//! may be _in.
+	static inline void processPair( LinkwitzRiley & _low, LinkwitzRiley & _high,
+				const sample_t ( * _in )[CHANNELS],
+				sample_t ( * _lowOut )[CHANNELS],
+				sample_t ( * _highOut )[CHANNELS], const fpp_t _frames )
+	{
+		const int Lanes = 2 * CHANNELS;
+		LinkwitzRiley * filters[2] = { &_low, &_high };
+		double a0[Lanes], a1[Lanes], a2[Lanes];
+		double b1[Lanes], b2[Lanes], b3[Lanes], b4[Lanes];
+		double z1[Lanes], z2[Lanes], z3[Lanes], z4[Lanes];
+		for( int l = 0; l < Lanes; ++l )
+		{
+			const LinkwitzRiley & lr = *filters[l / CHANNELS];
+			const int ch = l % CHANNELS;
+			a0[l] = lr.m_a0; a1[l] = lr.m_a1; a2[l] = lr.m_a2;
+			b1[l] = lr.m_b1; b2[l] = lr.m_b2; b3[l] = lr.m_b3; b4[l] = lr.m_b4;
+			z1[l] = lr.m_z1[ch]; z2[l] = lr.m_z2[ch];
+			z3[l] = lr.m_z3[ch]; z4[l] = lr.m_z4[ch];
+		}
+
+		for( fpp_t f = 0; f < _frames; ++f )
+		{
+			double in[Lanes];
+			double out[Lanes];
+			for( int l = 0; l < Lanes; ++l )
+			{
+				in[l] = _in[f][l % CHANNELS];
+			}
+			for( int l = 0; l < Lanes; ++l )
+			{
+				const double x = in[l] - z1[l] * b1[l] - z2[l] * b2[l] -
+						z3[l] * b3[l] - z4[l] * b4[l];
+				out[l] = a0[l] * x + z1[l] * a1[l] + z2[l] * a2[l] +
+						z3[l] * a1[l] + z4[l] * a0[l];
+				z4[l] = z3[l];
+				z3[l] = z2[l];
+				z2[l] = z1[l];
+				z1[l] = x;
+			}
+			for( int ch = 0; ch < CHANNELS; ++ch )
+			{
+				_lowOut[f][ch] = out[ch];
+				_highOut[f][ch] = out[CHANNELS + ch];
+			}
+		}
+
+		for( int l = 0; l < Lanes; ++l )
+		{
+			LinkwitzRiley & lr = *filters[l / CHANNELS];
+			const int ch = l % CHANNELS;
+			lr.m_z1[ch] = z1[l]; lr.m_z2[ch] = z2[l];
+			lr.m_z3[ch] = z3[l]; lr.m_z4[ch] = z4[l];
+		}
+	}
+
 private:
 	float m_sampleRate;
 	double m_wc4;
@@ -175,6 +234,36 @@ public:
 		m_z2[ch] = m_b2 * in - m_a2 * out;
 		return out;
 	}
+	//! update() for all frames and channels of _buf
+	inline void processBlock( sample_t ( * _buf )[CHANNELS], const fpp_t _frames )
+	{
+		// in locals for the compiler, which would otherwise have to
+		// assume that writing to _buf changes them - it can keep them in
+		// registers then and process the channels side by side
+		const float a1 = m_a1, a2 = m_a2, b0 = m_b0, b1 = m_b1, b2 = m_b2;
+		float z1[CHANNELS], z2[CHANNELS];
+		for( int ch = 0; ch < CHANNELS; ++ch )
+		{
+			z1[ch] = m_z1[ch];
+			z2[ch] = m_z2[ch];
+		}
+		for( fpp_t f = 0; f < _frames; ++f )
+		{
+			for( int ch = 0; ch < CHANNELS; ++ch )
+			{
+				const float in = _buf[f][ch];
+				const float out = z1[ch] + b0 * in;
+				z1[ch] = b1 * in + z2[ch] - a1 * out;
+				z2[ch] = b2 * in - a2 * out;
+				_buf[f][ch] = out;
+			}
+		}
+		for( int ch = 0; ch < CHANNELS; ++ch )
+		{
+			m_z1[ch] = z1[ch];
+			m_z2[ch] = z2[ch];
+		}
+	}
 private:
 	float m_a1, m_a2, m_b0, m_b1, m_b2;
 	float m_z1 [CHANNELS], m_z2 [CHANNELS];
@@ -222,6 +311,8 @@ class BasicFilters
 {
 	MM_OPERATORS
 public:
+	typedef sample_t frame[CHANNELS];
+
 	enum FilterTypes
 	{
 		LowPass,
@@ -331,6 +422,236 @@ public:
 	{
 		sample_t out;
 		switch( m_type )
+		{
+			case Moog: out = updateAs<Moog>( _in0, _chnl ); break;
+			case Tripole: out = updateAs<Tripole>( _in0, _chnl ); break;
+			case Lowpass_SV:
+			case Bandpass_SV: out = updateAs<Lowpass_SV>( _in0, _chnl ); break;
+			case Highpass_SV: out = updateAs<Highpass_SV>( _in0, _chnl ); break;
+			case Notch_SV: out = updateAs<Notch_SV>( _in0, _chnl ); break;
+			case Lowpass_RC12: out = updateAs<Lowpass_RC12>( _in0, _chnl ); break;
+			case Highpass_RC12:
+			case Bandpass_RC12: out = updateAs<Highpass_RC12>( _in0, _chnl ); break;
+			case Lowpass_RC24: out = updateAs<Lowpass_RC24>( _in0, _chnl ); break;
+			case Highpass_RC24:
+			case Bandpass_RC24: out = updateAs<Highpass_RC24>( _in0, _chnl ); break;
+			case Formantfilter:
+			case FastFormant: out = updateAs<Formantfilter>( _in0, _chnl ); break;
+			default: out = m_biQuad.update( _in0, _chnl ); break;
+		}
+
+		if( m_doubleFilter )
+		{
+			return m_subFilter->update( out, _chnl );
+		}
+
+		return out;
+	}
+
+	//! Same as update() for all frames and channels of _buf, with the
+	//! filter type looked up once and the channels processed side by side.
+	//! Coefficients stay the same for the block, so callers with changing
+	//! cutoff or resonance call it for each run of equal coefficients.
+	inline void processBlock( frame * _buf, const fpp_t _frames )
+	{
+		switch( m_type )
+		{
+			case Moog: processBlockAs<Moog>( _buf, _frames ); break;
+			case Tripole: processBlockAs<Tripole>( _buf, _frames ); break;
+			case Lowpass_SV:
+			case Bandpass_SV: processBlockAs<Lowpass_SV>( _buf, _frames ); break;
+			case Highpass_SV: processBlockAs<Highpass_SV>( _buf, _frames ); break;
+			case Notch_SV: processBlockAs<Notch_SV>( _buf, _frames ); break;
+			case Lowpass_RC12: processBlockAs<Lowpass_RC12>( _buf, _frames ); break;
+			case Highpass_RC12:
+			case Bandpass_RC12: processBlockAs<Highpass_RC12>( _buf, _frames ); break;
+			case Lowpass_RC24: processBlockAs<Lowpass_RC24>( _buf, _frames ); break;
+			case Highpass_RC24:
+			case Bandpass_RC24: processBlockAs<Highpass_RC24>( _buf, _frames ); break;
+			case Formantfilter:
+			case FastFormant: processBlockAs<Formantfilter>( _buf, _frames ); break;
+			default: m_biQuad.processBlock( _buf, _frames ); break;
+		}
+
+		if( m_doubleFilter )
+		{
+			m_subFilter->processBlock( _buf, _frames );
+		}
+	}
+
+	inline void calcFilterCoeffs( float _freq, float _q )
+	{
+		// temp coef vars
+		_q = qMax( _q, minQ() );
+
+		if( m_type == Lowpass_RC12  ||
+			m_type == Bandpass_RC12 ||
+			m_type == Highpass_RC12 ||
+			m_type == Lowpass_RC24 ||
+			m_type == Bandpass_RC24 ||
+			m_type == Highpass_RC24 )
+		{
+			_freq = qBound( 50.0f, _freq, 20000.0f );
+			const float sr = m_sampleRatio * 0.25f;
+			const float f = 1.0f / ( _freq * F_2PI );
+			
+			m_rca = 1.0f - sr / ( f + sr );
+			m_rcb = 1.0f - m_rca;
+			m_rcc = f / ( f + sr );
+
+			// Stretch Q/resonance, as self-oscillation reliably starts at a q of ~2.5 - ~2.6
+			m_rcq = _q * 0.25f;
+			return;
+		}
+
+		if( m_type == Formantfilter ||
+			m_type == FastFormant )
+		{
+			_freq = qBound( minFreq(), _freq, 20000.0f ); // limit freq and q for not getting bad noise out of the filter...
+
+			// formats for a, e, i, o, u, a
+			static const float _f[6][2] = { { 1000, 1400 }, { 500, 2300 },
+							{ 320, 3200 },
+							{ 500, 1000 },
+							{ 320, 800 },
+							{ 1000, 1400 } };
+			static const float freqRatio = 4.0f / 14000.0f;
+
+			// Stretch Q/resonance
+			m_vfq = _q * 0.25f;
+
+			// frequency in lmms ranges from 1Hz to 14000Hz
+			const float vowelf = _freq * freqRatio;
+			const int vowel = static_cast<int>( vowelf );
+			const float fract = vowelf - vowel;
+
+			// interpolate between formant frequencies
+			const float f0 = 1.0f / ( linearInterpolate( _f[vowel+0][0], _f[vowel+1][0], fract ) * F_2PI );
+			const float f1 = 1.0f / ( linearInterpolate( _f[vowel+0][1], _f[vowel+1][1], fract ) * F_2PI );
+
+			// samplerate coeff: depends on oversampling
+			const float sr = m_type == FastFormant ? m_sampleRatio : m_sampleRatio * 0.25f;
+
+			m_vfa[0] = 1.0f - sr / ( f0 + sr );
+			m_vfb[0] = 1.0f - m_vfa[0];
+			m_vfc[0] = f0 /	( f0 + sr );
+			m_vfa[1] = 1.0f - sr / ( f1 + sr );
+			m_vfb[1] = 1.0f - m_vfa[1];
+			m_vfc[1] = f1 /	( f1 + sr );
+			return;
+		}
+
+		if( m_type == Moog ||
+			m_type == DoubleMoog )
+		{
+			// [ 0 - 0.5 ]
+			const float f = qBound( minFreq(), _freq, 20000.0f ) * m_sampleRatio;
+			// (Empirical tunning)
+			m_p = ( 3.6f - 3.2f * f ) * f;
+			m_k = 2.0f * m_p - 1;
+			m_r = _q * powf( F_E, ( 1 - m_p ) * 1.386249f );
+
+			if( m_doubleFilter )
+			{
+				m_subFilter->m_r = m_r;
+				m_subFilter->m_p = m_p;
+				m_subFilter->m_k = m_k;
+			}
+			return;
+		}
+		
+		if( m_type == Tripole )
+		{
+			const float f = qBound( 20.0f, _freq, 20000.0f ) * m_sampleRatio * 0.25f;
+			
+			m_p = ( 3.6f - 3.2f * f ) * f;
+			m_k = 2.0f * m_p - 1.0f;
+			m_r = _q * 0.1f * powf( F_E, ( 1 - m_p ) * 1.386249f );
+			
+			return;
+		}
+
+		if( m_type == Lowpass_SV || 
+			m_type == Bandpass_SV ||
+			m_type == Highpass_SV ||
+			m_type == Notch_SV )
+		{
+			const float f = sinf( qMax( minFreq(), _freq ) * m_sampleRatio * F_PI );
+			m_svf1 = qMin( f, 0.825f );
+			m_svf2 = qMin( f * 2.0f, 0.825f );
+			m_svq = qMax( 0.0001f, 2.0f - ( _q * 0.1995f ) );
+			return;
+		}
+
+		// other filters
+		_freq = qBound( minFreq(), _freq, 20000.0f );
+		const float omega = F_2PI * _freq * m_sampleRatio;
+		const float tsin = sinf( omega ) * 0.5f;
+		const float tcos = cosf( omega );
+
+		const float alpha = tsin / _q;
+
+		const float a0 = 1.0f / ( 1.0f + alpha );
+
+		const float a1 = -2.0f * tcos * a0;
+		const float a2 = ( 1.0f - alpha ) * a0;
+
+		switch( m_type )
+		{
+			case LowPass:
+			{
+				const float b1 = ( 1.0f - tcos ) * a0;
+				const float b0 = b1 * 0.5f;
+				m_biQuad.setCoeffs( a1, a2, b0, b1, b0 );
+				break;
+			}
+			case HiPass:
+			{
+				const float b1 = ( -1.0f - tcos ) * a0;
+				const float b0 = b1 * -0.5f;
+				m_biQuad.setCoeffs( a1, a2, b0, b1, b0 );
+				break;
+			}
+			case BandPass_CSG:
+			{
+				const float b0 = tsin * a0;
+				m_biQuad.setCoeffs( a1, a2, b0, 0.0f, -b0 );
+				break;
+			}
+			case BandPass_CZPG:
+			{
+				const float b0 = alpha * a0;
+				m_biQuad.setCoeffs( a1, a2, b0, 0.0f, -b0 );
+				break;
+			}
+			case Notch:
+			{
+				m_biQuad.setCoeffs( a1, a2, a0, a1, a0 );
+				break;
+			}
+			case AllPass:
+			{
+				m_biQuad.setCoeffs( a1, a2, a2, a1, 1.0f );
+				break;
+			}
+			default:
+				break;
+		}
+
+		if( m_doubleFilter )
+		{
+			m_subFilter->m_biQuad.setCoeffs( m_biQuad.m_a1, m_biQuad.m_a2, m_biQuad.m_b0, m_biQuad.m_b1, m_biQuad.m_b2 );
+		}
+	}
+
+
+private:
+	// the filter of the type group TYPE, without the sub filter
+	template<int TYPE>
+	inline sample_t updateAs( sample_t _in0, ch_cnt_t _chnl )
+	{
+		sample_t out;
+		switch( TYPE )
 		{
 			case Moog:
 			{
@@ -694,183 +1015,25 @@ public:
 				break;
 		}
 
-		if( m_doubleFilter )
-		{
-			return m_subFilter->update( out, _chnl );
-		}
-
-		// Clipper band limited sigmoid
 		return out;
 	}
 
 
-	inline void calcFilterCoeffs( float _freq, float _q )
-	{
-		// temp coef vars
-		_q = qMax( _q, minQ() );
 
-		if( m_type == Lowpass_RC12  ||
-			m_type == Bandpass_RC12 ||
-			m_type == Highpass_RC12 ||
-			m_type == Lowpass_RC24 ||
-			m_type == Bandpass_RC24 ||
-			m_type == Highpass_RC24 )
-		{
-			_freq = qBound( 50.0f, _freq, 20000.0f );
-			const float sr = m_sampleRatio * 0.25f;
-			const float f = 1.0f / ( _freq * F_2PI );
-			
-			m_rca = 1.0f - sr / ( f + sr );
-			m_rcb = 1.0f - m_rca;
-			m_rcc = f / ( f + sr );
-
-			// Stretch Q/resonance, as self-oscillation reliably starts at a q of ~2.5 - ~2.6
-			m_rcq = _q * 0.25f;
-			return;
-		}
-
-		if( m_type == Formantfilter ||
-			m_type == FastFormant )
-		{
-			_freq = qBound( minFreq(), _freq, 20000.0f ); // limit freq and q for not getting bad noise out of the filter...
-
-			// formats for a, e, i, o, u, a
-			static const float _f[6][2] = { { 1000, 1400 }, { 500, 2300 },
-							{ 320, 3200 },
-							{ 500, 1000 },
-							{ 320, 800 },
-							{ 1000, 1400 } };
-			static const float freqRatio = 4.0f / 14000.0f;
-
-			// Stretch Q/resonance
-			m_vfq = _q * 0.25f;
-
-			// frequency in lmms ranges from 1Hz to 14000Hz
-			const float vowelf = _freq * freqRatio;
-			const int vowel = static_cast<int>( vowelf );
-			const float fract = vowelf - vowel;
-
-			// interpolate between formant frequencies
-			const float f0 = 1.0f / ( linearInterpolate( _f[vowel+0][0], _f[vowel+1][0], fract ) * F_2PI );
-			const float f1 = 1.0f / ( linearInterpolate( _f[vowel+0][1], _f[vowel+1][1], fract ) * F_2PI );
-
-			// samplerate coeff: depends on oversampling
-			const float sr = m_type == FastFormant ? m_sampleRatio : m_sampleRatio * 0.25f;
-
-			m_vfa[0] = 1.0f - sr / ( f0 + sr );
-			m_vfb[0] = 1.0f - m_vfa[0];
-			m_vfc[0] = f0 /	( f0 + sr );
-			m_vfa[1] = 1.0f - sr / ( f1 + sr );
-			m_vfb[1] = 1.0f - m_vfa[1];
-			m_vfc[1] = f1 /	( f1 + sr );
-			return;
-		}
-
-		if( m_type == Moog ||
-			m_type == DoubleMoog )
-		{
-			// [ 0 - 0.5 ]
-			const float f = qBound( minFreq(), _freq, 20000.0f ) * m_sampleRatio;
-			// (Empirical tunning)
-			m_p = ( 3.6f - 3.2f * f ) * f;
-			m_k = 2.0f * m_p - 1;
-			m_r = _q * powf( F_E, ( 1 - m_p ) * 1.386249f );
-
-			if( m_doubleFilter )
-			{
-				m_subFilter->m_r = m_r;
-				m_subFilter->m_p = m_p;
-				m_subFilter->m_k = m_k;
-			}
-			return;
-		}
-		
-		if( m_type == Tripole )
-		{
-			const float f = qBound( 20.0f, _freq, 20000.0f ) * m_sampleRatio * 0.25f;
-			
-			m_p = ( 3.6f - 3.2f * f ) * f;
-			m_k = 2.0f * m_p - 1.0f;
-			m_r = _q * 0.1f * powf( F_E, ( 1 - m_p ) * 1.386249f );
-			
-			return;
-		}
-
-		if( m_type == Lowpass_SV || 
-			m_type == Bandpass_SV ||
-			m_type == Highpass_SV ||
-			m_type == Notch_SV )
-		{
-			const float f = sinf( qMax( minFreq(), _freq ) * m_sampleRatio * F_PI );
-			m_svf1 = qMin( f, 0.825f );
-			m_svf2 = qMin( f * 2.0f, 0.825f );
-			m_svq = qMax( 0.0001f, 2.0f - ( _q * 0.1995f ) );
-			return;
-		}
-
-		// other filters
-		_freq = qBound( minFreq(), _freq, 20000.0f );
-		const float omega = F_2PI * _freq * m_sampleRatio;
-		const float tsin = sinf( omega ) * 0.5f;
-		const float tcos = cosf( omega );
-
-		const float alpha = tsin / _q;
-
-		const float a0 = 1.0f / ( 1.0f + alpha );
-
-		const float a1 = -2.0f * tcos * a0;
-		const float a2 = ( 1.0f - alpha ) * a0;
-
-		switch( m_type )
+	template<int TYPE>
+	inline void processBlockAs( frame * _buf, const fpp_t _frames )
+	{
+		for( fpp_t f = 0; f < _frames; ++f )
 		{
-			case LowPass:
+			for( ch_cnt_t ch = 0; ch < CHANNELS; ++ch )
 			{
-				const float b1 = ( 1.0f - tcos ) * a0;
-				const float b0 = b1 * 0.5f;
-				m_biQuad.setCoeffs( a1, a2, b0, b1, b0 );
-				break;
+				_buf[f][ch] = updateAs<TYPE>( _buf[f][ch], ch );
 			}
-			case HiPass:
-			{
-				const float b1 = ( -1.0f - tcos ) * a0;
-				const float b0 = b1 * -0.5f;
-				m_biQuad.setCoeffs( a1, a2, b0, b1, b0 );
-				break;
-			}
-			case BandPass_CSG:
-			{
-				const float b0 = tsin * a0;
-				m_biQuad.setCoeffs( a1, a2, b0, 0.0f, -b0 );
-				break;
-			}
-			case BandPass_CZPG:
-			{
-				const float b0 = alpha * a0;
-				m_biQuad.setCoeffs( a1, a2, b0, 0.0f, -b0 );
-				break;
-			}
-			case Notch:
-			{
-				m_biQuad.setCoeffs( a1, a2, a0, a1, a0 );
-				break;
-			}
-			case AllPass:
-			{
-				m_biQuad.setCoeffs( a1, a2, a2, a1, 1.0f );
-				break;
-			}
-			default:
-				break;
-		}
-
-		if( m_doubleFilter )
-		{
-			m_subFilter->m_biQuad.setCoeffs( m_biQuad.m_a1, m_biQuad.m_a2, m_biQuad.m_b0, m_biQuad.m_b1, m_biQuad.m_b2 );
 		}
 	}
 
 
-private:
+
 	// biquad filter
 	BiQuad<CHANNELS> m_biQuad;
 
@@ -886,8 +1049,6 @@ private:
 	// coeffs for Lowpass_SV (state-variant lowpass)
 	float m_svf1, m_svf2, m_svq;
 
-	typedef sample_t frame[CHANNELS];
-
 	// in/out history for moog-filter
 	frame m_y1, m_y2, m_y3, m_y4, m_oldx, m_oldy1, m_oldy2, m_oldy3;
 	// additional one for Tripole filter
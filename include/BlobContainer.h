@@ -0,0 +1,115 @@
+/*
+ * BlobContainer.h - binary projects keeping samples and plugin states as raw
+ *                   blobs next to their XML
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef BLOB_CONTAINER_H
+#define BLOB_CONTAINER_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QList>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+#include <QtXml/QDomElement>
+
+#include "lmms_export.h"
+
+
+//! A binary project (.mmpb) is its XML followed by the data of the large
+//! base64 attributes, e.g. embedded samples and plugin chunks, as raw
+//! blobs. The attributes hold references to the blobs instead, which
+//! base64::decode() resolves while the container is open. The file is
+//! memory-mapped, so only the blobs which get decoded are read.
+//!
+//! Layout, little endian: the magic "LMMSMMPB", the version and the number
+//! of blobs as 32 bit values, the offset and size of the XML and then of
+//! each blob as 64 bit values, followed by the XML and the blobs, each
+//! starting at a multiple of 16 bytes.
+class LMMS_EXPORT BlobContainer
+{
+public:
+	//! What replaceAttributes() changed
+	struct Replacement
+	{
+		QDomElement element;
+		QString name;
+		QString value;
+	} ;
+
+	//! Maps _file, see isValid()
+	BlobContainer( const QString & _file );
+	~BlobContainer();
+
+	BlobContainer( const BlobContainer & ) = delete;
+	BlobContainer & operator=( const BlobContainer & ) = delete;
+
+	bool isValid() const
+	{
+		return m_map != NULL;
+	}
+
+	//! The XML of the container, which refers to the mapping
+	const QByteArray & xml() const
+	{
+		return m_xml;
+	}
+
+	//! Makes the references to blobs below _element resolvable, has to be
+	//! done once after _element has been parsed from xml()
+	void adoptReferences( QDomElement _element ) const;
+
+	static bool isContainer( const QByteArray & _head );
+
+	//! Whether _value refers to a blob of a container which has been
+	//! opened, see adoptReferences()
+	static bool isReference( const QString & _value );
+
+	//! The data _reference refers to, which points into the mapping and
+	//! has to be copied before the container is closed. Empty if the
+	//! container isn't open anymore.
+	static QByteArray data( const QString & _reference );
+
+	//! Replaces the large base64 attributes below _element and the
+	//! references to blobs by references to the blobs appended to
+	//! _blobs, in order to write them to a container. If _blobs is NULL,
+	//! only the references are replaced, by the base64 of what they refer
+	//! to. restore() has to be called with what's returned once written.
+	static QList<Replacement> replaceAttributes( QDomElement _element,
+						QList<QByteArray> * _blobs );
+	static void restore( const QList<Replacement> & _replacements );
+
+	//! Writes a container with _xml and _blobs to _out
+	static bool write( QIODevice & _out, const QByteArray & _xml,
+					const QList<QByteArray> & _blobs );
+
+
+private:
+	QFile m_file;
+	uchar * m_map;
+	QByteArray m_xml;
+	QVector<QByteArray> m_blobs;
+	quint64 m_id;
+
+} ;
+
+
+#endif
@@ -29,10 +29,28 @@
 #include "lmms_export.h"
 #include "lmms_basics.h"
 
+//! Period buffers are taken from preallocated, cache line aligned pools
+//! with lock-free free lists, so play handles and audio ports can be
+//! created while rendering without going to the allocator. Once the pools
+//! are used up, buffers are allocated from the MemoryManager until reserve()
+//! adds another pool.
 class LMMS_EXPORT BufferManager
 {
 public:
-	static void init( fpp_t framesPerPeriod );
+	struct Statistics
+	{
+		int inUse;
+		int highWater;
+		int capacity;
+		// buffers which didn't fit into the pools
+		int overflows;
+	} ;
+
+	//! _hugePages backs the pools and slabs by huge pages where the
+	//! system supports it, only the first call sets it up
+	static void init( fpp_t framesPerPeriod, bool _hugePages = false );
+	//! The period size of init(), the same for all mixers
+	static fpp_t framesPerPeriod();
 	static sampleFrame * acquire();
 	// audio-buffer-mgm
 	static void clear( sampleFrame * ab, const f_cnt_t frames,
@@ -42,6 +60,24 @@ public:
 						const f_cnt_t offset = 0 );
 #endif
 	static void release( sampleFrame * buf );
+
+	//! Adds a pool if more than three quarters of the buffers have been in
+	//! use, must not be called while rendering
+	static void reserve();
+
+	//! Give the memory of the pool buffers not in use back to the system,
+	//! they're mapped in again when they're taken the next time. Buffers
+	//! taken meanwhile come from the MemoryManager.
+	static void trim();
+
+	static Statistics statistics();
+
+	//! Cache line aligned memory for buffers which are best kept next to
+	//! each other in the order they're processed, like the ones of the FX
+	//! channels. The slab is zeroed and may be allocated from huge pages,
+	//! so walking through it takes fewer TLB misses.
+	static void * allocSlab( size_t _bytes );
+	static void freeSlab( void * _slab );
 };
 
 #endif
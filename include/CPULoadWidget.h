@@ -44,6 +44,8 @@ public:
 
 protected:
 	void paintEvent( QPaintEvent * _ev ) override;
+	bool event( QEvent * _ev ) override;
+	void contextMenuEvent( QContextMenuEvent * _ev ) override;
 
 
 protected slots:
@@ -66,6 +66,11 @@ public:
 	}
 
 
+	const QString & configFile() const
+	{
+		return m_lmmsRcFile;
+	}
+
 	const QString & workingDir() const
 	{
 		return m_workingDir;
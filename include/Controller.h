@@ -27,6 +27,8 @@
 #ifndef CONTROLLER_H
 #define CONTROLLER_H
 
+#include <atomic>
+
 #include "lmms_export.h"
 #include "Engine.h"
 #include "Model.h"
@@ -114,9 +116,10 @@ public:
 		return qBound<float>( 0.0f, _val, 1.0f );
 	}
 
+	//! Periods rendered by the mixer of the calling thread
 	static long runningPeriods()
 	{
-		return s_periods;
+		return Engine::context()->controllerPeriods;
 	}
 	static unsigned int runningFrames();
 	static float runningTime();
@@ -146,23 +149,33 @@ protected:
 
 	virtual void updateValueBuffer();
 
+	//! Call updateValueBuffer() once per period, however many models are
+	//! connected, possibly from several threads. Controllers controlling
+	//! this one are updated first, as it pulls their buffers.
+	void publishValueBuffer();
+
 	// buffer for storing sample-exact values in case there
 	// are more than one model wanting it, so we don't have to create it
 	// again every time
 	ValueBuffer m_valueBuffer;
 	// when we last updated the valuebuffer - so we know if we have to update it
 	long m_bufferLastUpdated;
+	// the period m_valueBuffer may be read for, -1 to have it checked again
+	std::atomic<long> m_bufferPublished;
 
 	float m_currentValue;
 	bool  m_sampleExact;
 	int m_connectionCount;
+	// the engine objects the controller belongs to
+	EngineContext * m_context;
 
 	QString m_name;
 	ControllerTypes m_type;
 
 	static ControllerVector s_controllers;
 
-	static long s_periods;
+	// taken while updating the value buffer
+	std::atomic_bool m_updatingBuffer;
 
 
 signals:
@@ -0,0 +1,179 @@
+/*
+ * CostEstimator.h - estimates whether a project plays in real time and
+ *                   what to change if it doesn't
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef COST_ESTIMATOR_H
+#define COST_ESTIMATOR_H
+
+#include <memory>
+
+#include <QtCore/QObject>
+#include <QtCore/QStringList>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QTimer>
+#include <QtCore/QVector>
+
+#include "lmms_export.h"
+#include "Mixer.h"
+#include "OutputSettings.h"
+
+class CpuUsage;
+class Effect;
+class EffectChain;
+class InstrumentTrack;
+class RenderManager;
+class ThreadableJob;
+
+
+//! Renders the loaded project into a temporary file and estimates from the
+//! time the instrument and the effects of each track and FX channel took
+//! whether it plays in real time with another period size on another
+//! number of cores, for checking a project before playing it live. The
+//! CpuUsage of every part is taken every SampleInterval milliseconds while
+//! rendering, along with the load of each period from Mixer::renderStats().
+//!
+//! The jobs are assumed to spread over the cores, except for the longest
+//! one, and to take as long per frame with other periods. What the mixer
+//! thread does on its own besides waiting for the jobs is left as it was
+//! per period, so it weighs more with shorter periods.
+class LMMS_EXPORT CostEstimator : public QObject
+{
+	Q_OBJECT
+public:
+	static const int SampleInterval = 20;
+	//! Load above which spikes would overload, suggestions are made until
+	//! it's below
+	static constexpr float Headroom = 0.75f;
+	//! Voices above which limiting the polyphony of costly tracks is
+	//! suggested
+	static const int ManyVoices = 16;
+
+	//! Load of jobs of _total microseconds per period of _frames frames,
+	//! of which the longest takes _longest, plus _overhead microseconds of
+	//! the mixer thread per period, with periods of _targetFrames frames
+	//! at _sampleRate on _cores cores
+	static float load( float _total, float _longest, float _overhead,
+				fpp_t _frames, fpp_t _targetFrames, int _cores,
+						sample_rate_t _sampleRate );
+
+	//! _targetFrames and _cores are what the project is estimated for
+	CostEstimator( const Mixer::qualitySettings & _qualitySettings,
+			const OutputSettings & _outputSettings,
+			fpp_t _targetFrames, int _cores );
+	virtual ~CostEstimator();
+
+	//! Rendering the project failed or it is empty
+	bool failed() const
+	{
+		return m_failed;
+	}
+
+	//! What should be done so the project fits, empty if nothing
+	const QStringList & suggestions() const
+	{
+		return m_suggestions;
+	}
+
+
+public slots:
+	void start();
+	void updateConsoleProgress();
+
+
+signals:
+	void finished();
+
+
+private slots:
+	void sample();
+	void renderFinished();
+
+
+private:
+	struct EffectCost
+	{
+		Effect * effect;
+		QString name;
+		double time;
+		float peak;
+		int silentSamples;
+	} ;
+
+	//! The instrument and the effects of a track or an FX channel
+	struct PartCost
+	{
+		QString name;
+		InstrumentTrack * track;
+		// play handles, NULL for FX channels
+		const CpuUsage * instrument;
+		// effects and mixing
+		const ThreadableJob * job;
+		QVector<EffectCost> effects;
+		double instrumentTime;
+		double effectTime;
+		float peak;
+		int peakVoices;
+	} ;
+
+	void addPart( const QString & _name, InstrumentTrack * _track,
+			const CpuUsage * _instrument, const ThreadableJob * _job,
+						const EffectChain * _effects );
+	void collectParts();
+
+	//! Average and peak load of the parts except for those _without with
+	//! periods of _targetFrames frames
+	void estimate( const QVector<bool> & _without, fpp_t _targetFrames,
+				float & _average, float & _peak ) const;
+	void suggest();
+	void report() const;
+
+	//! Share of a core _microseconds per measured period is
+	float share( double _microseconds ) const;
+
+	const Mixer::qualitySettings m_qualitySettings;
+	const OutputSettings m_outputSettings;
+	const fpp_t m_targetFrames;
+	const int m_cores;
+
+	std::unique_ptr<RenderManager> m_manager;
+	QTemporaryDir m_dir;
+	QTimer m_sampleTimer;
+	LocklessRingBufferReader<Mixer::RenderStats> m_reader;
+
+	QVector<PartCost> m_parts;
+	int m_samples;
+	double m_loadSum;
+	int m_periods;
+	float m_peakLoad;
+	int m_threads;
+	fpp_t m_frames;
+	sample_rate_t m_sampleRate;
+
+	bool m_failed;
+	float m_averageEstimate;
+	float m_peakEstimate;
+	QStringList m_suggestions;
+
+} ;
+
+
+#endif
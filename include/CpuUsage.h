@@ -0,0 +1,88 @@
+/*
+ * CpuUsage.h - rolling statistics of processing time per period
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef CPU_USAGE_H
+#define CPU_USAGE_H
+
+#include <atomic>
+
+
+//! How long something took to process per period, in microseconds. Updated
+//! by the audio threads, read by the GUI - see
+//! MixerProfiler::percentOfPeriod() for turning it into a load.
+class CpuUsage
+{
+public:
+	CpuUsage() :
+		m_average( 0.0f ),
+		m_maximum( 0.0f ),
+		m_pending( 0 )
+	{
+	}
+
+	//! Account for one period that took _microseconds
+	void add( int _microseconds )
+	{
+		const float time = _microseconds;
+		m_average.store( m_average.load( std::memory_order_relaxed ) *
+				0.95f + time * 0.05f, std::memory_order_relaxed );
+		// let the maximum decay within a few seconds so it shows recent
+		// spikes rather than the one from loading the project
+		const float maximum =
+			m_maximum.load( std::memory_order_relaxed ) * 0.999f;
+		m_maximum.store( time > maximum ? time : maximum,
+						std::memory_order_relaxed );
+	}
+
+	//! Collect time of several jobs, e.g. all notes of a track, which
+	//! may run in parallel
+	void accumulate( int _microseconds )
+	{
+		m_pending.fetch_add( _microseconds, std::memory_order_relaxed );
+	}
+
+	//! add() what has been accumulated since the last call
+	void finishPeriod()
+	{
+		add( m_pending.exchange( 0, std::memory_order_relaxed ) );
+	}
+
+	float average() const
+	{
+		return m_average.load( std::memory_order_relaxed );
+	}
+
+	float maximum() const
+	{
+		return m_maximum.load( std::memory_order_relaxed );
+	}
+
+
+private:
+	std::atomic<float> m_average;
+	std::atomic<float> m_maximum;
+	std::atomic_int m_pending;
+
+} ;
+
+
+#endif
@@ -27,11 +27,14 @@
 #ifndef DATA_FILE_H
 #define DATA_FILE_H
 
+#include <memory>
+
 #include <QDomDocument>
 
 #include "lmms_export.h"
 #include "MemoryManager.h"
 
+class BlobContainer;
 class QTextStream;
 
 class LMMS_EXPORT DataFile : public QDomDocument
@@ -112,7 +115,9 @@ private:
 
 	void upgrade();
 
-	void loadData( const QByteArray & _data, const QString & _sourceFile );
+	//! Takes _data by value, so the compressed data of a file can be let go
+	//! of once it's uncompressed
+	void loadData( QByteArray _data, const QString & _sourceFile );
 
 
 	struct LMMS_EXPORT typeDescStruct
@@ -125,6 +130,9 @@ private:
 	QDomElement m_content;
 	QDomElement m_head;
 	Type m_type;
+	//! The binary project this was loaded from, which has to stay open
+	//! until the blobs its references refer to have been decoded
+	std::shared_ptr<BlobContainer> m_blobs;
 
 } ;
 
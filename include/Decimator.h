@@ -0,0 +1,111 @@
+/*
+ * Decimator.h - half-band filter cascade for taking oversampled audio
+ *               down to the rate of the device
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef DECIMATOR_H
+#define DECIMATOR_H
+
+#include <vector>
+
+#include "lmms_basics.h"
+#include "lmms_export.h"
+#include "MemoryManager.h"
+
+
+//! Divides the sample rate of surround frames by 2, 4 or 8 through a
+//! cascade of half-band FIR filters. Each stage splits its input into the
+//! even and odd frames, so only their own half of the taps is applied to
+//! contiguous samples of one channel, in loops the compiler vectorises.
+//! The stages before the last one only have to keep the final band free
+//! of aliases and get by with a few taps, the quality sets the length of
+//! the last one and with it the latency.
+class LMMS_EXPORT Decimator
+{
+	MM_OPERATORS
+public:
+	enum Qualities
+	{
+		LowLatency,
+		Balanced,
+		HighQuality
+	} ;
+
+	Decimator( int factor = 2, Qualities quality = Balanced );
+
+	//! Sets a factor of 2, 4 or 8 and clears the filters
+	void setup( int factor, Qualities quality );
+
+	int factor() const
+	{
+		return m_factor;
+	}
+
+	//! Delay the filters add, in output frames
+	float latency() const;
+
+	void reset();
+
+	//! Writes _frames / factor() frames to _out, _frames has to be a
+	//! multiple of factor()
+	fpp_t process( const surroundSampleFrame * _in, f_cnt_t _frames,
+						surroundSampleFrame * _out );
+
+	//! Taps of a half-band filter with _pairs taps on each side at the
+	//! odd offsets from its centre, Kaiser windowed. They add up to 0.5,
+	//! the centre tap of 0.5 makes up the other half of the gain.
+	static std::vector<float> halfBandTaps( int _pairs, double _beta );
+
+	//! Pairs of taps and Kaiser beta of a stage for _quality, the one at
+	//! the lowest rate needing the most, see Oversampler as well
+	static void stageDesign( Qualities _quality, bool _lowestRate,
+						int & _pairs, double & _beta );
+
+
+private:
+	// input frames handled at once, DEFAULT_BUFFER_SIZE without
+	// depending on Mixer.h
+	static const int BlockSize = 256;
+
+	struct Stage
+	{
+		// taps applied to the even frames, the odd ones only get the
+		// centre tap of 0.5
+		std::vector<float> taps;
+		// the last taps - 1 even and taps / 2 odd frames before the
+		// ones of the block, followed by the block
+		std::vector<float> even[SURROUND_CHANNELS];
+		std::vector<float> odd[SURROUND_CHANNELS];
+
+		void design( int pairs, double beta );
+		void clear();
+		// decimates _frames samples of one channel from _in to _out
+		void process( int _channel, const float * _in, int _frames,
+								float * _out );
+	} ;
+
+	int m_factor;
+	std::vector<Stage> m_stages;
+
+} ;
+
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ * DelayLine.h - block processing fractional delay line for effects
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef DELAY_LINE_H
+#define DELAY_LINE_H
+
+#include <vector>
+
+#include "lmms_basics.h"
+#include "lmms_export.h"
+#include "MemoryManager.h"
+
+
+//! One channel of delayed samples in a circular buffer with a power of two
+//! size, so positions wrap with a mask. Whole blocks are written and read
+//! at once, taps read at fractional and per-frame modulated delays. The
+//! loops of linear and cubic taps are free of branches and get vectorised
+//! by the compiler; allpass taps are recursive and run frame by frame.
+//! Delays are in frames and get clamped to what the line can deliver.
+class LMMS_EXPORT DelayLine
+{
+	MM_OPERATORS
+public:
+	enum Interpolations
+	{
+		Linear,
+		Cubic,
+		Allpass
+	} ;
+
+	DelayLine( f_cnt_t maxDelay = 0 );
+
+	//! Resizes the line to hold at least maxDelay frames and clears it,
+	//! e.g. after a sample rate change
+	void setMaxDelay( f_cnt_t maxDelay );
+
+	f_cnt_t maxDelay() const
+	{
+		return m_maxDelay;
+	}
+
+	void clear();
+
+	//! Appends frames samples
+	void write( const sample_t * src, fpp_t frames );
+
+	//! Reads the last frames written samples, each delayed by delays[f]
+	void read( sample_t * dst, const float * delays, fpp_t frames,
+					Interpolations interpolation = Linear );
+
+	//! Same as read() with one delay for all frames
+	void read( sample_t * dst, float delay, fpp_t frames,
+					Interpolations interpolation = Linear );
+
+	//! Same as read() with a whole number of frames as delay, which passes
+	//! the samples on unchanged
+	void read( sample_t * dst, f_cnt_t delay, fpp_t frames );
+
+	//! Feedback delay in place: each frame of buf is replaced by what the
+	//! line delivers at delays[f], while the input plus feedback times that
+	//! output is written. Delays shorter than the block are processed in
+	//! as small parts as needed.
+	void process( sample_t * buf, const float * delays, float feedback,
+					fpp_t frames,
+					Interpolations interpolation = Linear );
+
+
+private:
+	// reads frames taps for the frames starting at position start, dst
+	// must not be the buffer of the line
+	void tap( sample_t * __restrict dst, f_cnt_t start,
+				const float * delays, fpp_t frames,
+				Interpolations interpolation );
+
+	float minDelay( Interpolations interpolation ) const;
+
+	std::vector<sample_t> m_buffer;
+	f_cnt_t m_mask;
+	f_cnt_t m_maxDelay;
+	// position the next frame is written to, wraps with m_mask
+	f_cnt_t m_writePos;
+
+	// state of the allpass taps
+	float m_allpassState;
+
+} ;
+
+
+#endif
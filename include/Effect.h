@@ -27,6 +27,7 @@
 #define EFFECT_H
 
 #include "Plugin.h"
+#include "CpuUsage.h"
 #include "Engine.h"
 #include "Mixer.h"
 #include "AutomatableModel.h"
@@ -35,11 +36,12 @@
 
 class EffectChain;
 class EffectControls;
+class FxChannel;
 
 
 class LMMS_EXPORT Effect : public Plugin
 {
-	MM_OPERATORS
+	MM_OPERATORS_TAGGED( Plugins )
 	Q_OBJECT
 public:
 	Effect( const Plugin::Descriptor * _desc,
@@ -55,10 +57,79 @@ public:
 		return "effect";
 	}
 
+	//! tailFrames() of effects which don't know how long they keep
+	//! sounding
+	static const f_cnt_t UnknownTail = -1;
+
 	
 	virtual bool processAudioBuffer( sampleFrame * _buf,
 						const fpp_t _frames ) = 0;
 
+	//! Whether the effect chain should call processPlanar() instead of
+	//! processAudioBuffer(), e.g. as the effect hosts plugins working on
+	//! one buffer per channel. The chain only converts the buffer where
+	//! the layout wanted by its effects changes.
+	virtual bool wantsPlanar() const
+	{
+		return false;
+	}
+
+	//! Same as processAudioBuffer() with one buffer per channel
+	virtual bool processPlanar( float * * _channels, const fpp_t _frames )
+	{
+		return false;
+	}
+
+	//! Whether processAudioBuffer() and processPlanar() write the wet
+	//! signal only. The effect chain then mixes in the dry input by
+	//! wetLevel() and checks the gate in one pass over the buffer, so the
+	//! effect must neither call checkGate() nor mix itself.
+	virtual bool writesWetOnly() const
+	{
+		return false;
+	}
+
+	//! Frames the output keeps sounding once the input went silent, e.g. 0
+	//! for effects without any state. Once they passed, the effect chain
+	//! stops the effect without waiting for the gate. Effects returning
+	//! UnknownTail are stopped by the gate only.
+	virtual f_cnt_t tailFrames() const
+	{
+		return UnknownTail;
+	}
+
+	//! Frames the output lags behind the input, e.g. for a lookahead or
+	//! linear phase filters. The FX mixer delays parallel paths by as
+	//! much, see LatencyCompensator.
+	virtual f_cnt_t latencyFrames() const
+	{
+		return 0;
+	}
+
+	//! FX channel whose output the effect takes as sidechain input, e.g.
+	//! for the detector of a compressor, -1 for none
+	int sidechainChannel() const
+	{
+		return m_sidechainChannel;
+	}
+
+	void setSidechainChannel( int _channel );
+
+	//! Whether the effect gets a sidechain input, which only effects of FX
+	//! channels do as the source has to be processed before them
+	bool hasSidechain() const
+	{
+		return m_sidechainSource != NULL;
+	}
+
+	//! The buffer of the sidechain source after its effects and before
+	//! its fader, see sidechainGain(), NULL while it's silent. It's the
+	//! one the source sends on, so it must not be written to.
+	const sampleFrame * sidechainBuffer() const;
+
+	//! Fader of the sidechain source
+	float sidechainGain() const;
+
 	inline ch_cnt_t processorCount() const
 	{
 		return m_processors;
@@ -88,6 +159,7 @@ public:
 	inline void startRunning() 
 	{ 
 		m_bufferCount = 0;
+		m_silentFrames = 0;
 		m_running = true; 
 	}
 
@@ -148,6 +220,19 @@ public:
 		m_noRun = _state;
 	}
 
+	//! Time processAudioBuffer() took during the last periods
+	inline const CpuUsage & cpuUsage() const
+	{
+		return m_cpuUsage;
+	}
+
+	//! Share of a period processing takes on average
+	inline float cost() const
+	{
+		return Engine::mixer()->profiler().percentOfPeriod(
+					m_cpuUsage.average() ) / 100.0f;
+	}
+
 	EffectChain * effectChain() const
 	{
 		return m_parent;
@@ -209,6 +294,9 @@ private:
 	bool m_noRun;
 	bool m_running;
 	f_cnt_t m_bufferCount;
+	// silent input processed since the last input, see tailFrames()
+	f_cnt_t m_silentFrames;
+	CpuUsage m_cpuUsage;
 
 	BoolModel m_enabledModel;
 	FloatModel m_wetDryModel;
@@ -217,12 +305,18 @@ private:
 	
 	bool m_autoQuitDisabled;
 
+	int m_sidechainChannel;
+	// the channel of m_sidechainChannel if the effect belongs to another
+	// channel processed after it, see FxMixer::updateSidechains()
+	FxChannel * m_sidechainSource;
+
 	SRC_DATA m_srcData[2];
 	SRC_STATE * m_srcState[2];
 
 
 	friend class EffectView;
 	friend class EffectChain;
+	friend class FxMixer;
 
 } ;
 
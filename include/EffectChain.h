@@ -52,8 +52,32 @@ public:
 	void removeEffect( Effect * _effect );
 	void moveDown( Effect * _effect );
 	void moveUp( Effect * _effect );
-	bool processAudioBuffer( sampleFrame * _buf, const fpp_t _frames, bool hasInputNoise );
-	void startRunning();
+	//! Processes the effects from _first up to but not including _end, all
+	//! up to the last one for an _end of -1. Doesn't sanitize the output
+	//! of the last effect, see MixHelpers::sanitize()
+	bool processAudioBuffer( sampleFrame * _buf, const fpp_t _frames, bool hasInputNoise,
+						int _first = 0, int _end = -1 );
+	void startRunning( int _first = 0, int _end = -1 );
+
+	//! Splits the effects into up to _stages runs taking about as long as
+	//! each other, for processing them one after the other on different
+	//! threads. The first run goes at least up to the last effect with a
+	//! sidechain, which has to be processed after its source. Writes where
+	//! each run ends to _ends and returns the number of runs, which is
+	//! fewer if there aren't enough effects. _byCost is set when the time
+	//! the effects took was known, otherwise each one counts the same.
+	int splitIntoStages( int _stages, int * _ends, bool & _byCost ) const;
+
+	int size() const
+	{
+		return m_effects.size();
+	}
+
+	//! Effects which are enabled and processing, for monitoring
+	int runningEffects() const;
+
+	//! Sum of the latencies of all enabled effects
+	f_cnt_t latencyFrames() const;
 
 	void clear();
 
@@ -62,10 +86,14 @@ private:
 	typedef QVector<Effect *> EffectList;
 	EffectList m_effects;
 
+	void swapEffects( EffectList & _effects );
+
 	BoolModel m_enabledModel;
 
 
+	friend class CostEstimator;
 	friend class EffectRackView;
+	friend class FxMixer;
 
 
 signals:
@@ -75,6 +75,7 @@ signals:
 protected:
 	void contextMenuEvent( QContextMenuEvent * _me ) override;
 	void paintEvent( QPaintEvent * _pe ) override;
+	bool event( QEvent * _e ) override;
 	void modelChanged() override;
 
 
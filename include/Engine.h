@@ -29,6 +29,8 @@
 #include <QtCore/QString>
 #include <QtCore/QObject>
 
+#include <atomic>
+
 
 #include "lmms_export.h"
 #include "lmms_basics.h"
@@ -40,6 +42,29 @@ class ProjectJournal;
 class Mixer;
 class Song;
 class Ladspa2LMMS;
+class PerfLogTimer;
+
+
+//! The engine objects of one project. Engine::init() creates the one the
+//! GUI works with, Engine::createContext() further ones for rendering
+//! other projects in the same process at the same time, which share the
+//! plugin libraries, the sample cache and the worker threads. Engine's
+//! accessors return the objects of the context of the calling thread, see
+//! Engine::ContextScope.
+struct EngineContext
+{
+	Mixer * mixer;
+	FxMixer * fxMixer;
+	Song * song;
+	BBTrackContainer * bbTrackContainer;
+	ProjectJournal * projectJournal;
+	DummyTrackContainer * dummyTC;
+
+	float framesPerTick;
+	float periodFramesPerTick;
+	//! Periods rendered, for the controllers, see Controller
+	long controllerPeriods;
+} ;
 
 
 // Note: This class is called 'LmmsCore' instead of 'Engine' because of naming
@@ -58,33 +83,62 @@ class LMMS_EXPORT LmmsCore : public QObject
 {
 	Q_OBJECT
 public:
+	//! Makes _context the one of the calling thread while it exists,
+	//! scopes nest
+	class LMMS_EXPORT ContextScope
+	{
+	public:
+		ContextScope( EngineContext * _context );
+		~ContextScope();
+
+	private:
+		EngineContext * m_previous;
+	} ;
+
 	static void init( bool renderOnly );
 	static void destroy();
 
+	//! Creates the engine objects for one more project, with a mixer
+	//! with dummy devices which doesn't process until a ProjectRenderer
+	//! renders the project. They're set up and used within a ContextScope
+	//! of the context, e.g. for loading the project.
+	static EngineContext * createContext();
+	//! Deletes a context of createContext()
+	static void destroyContext( EngineContext * _context );
+
+	//! The context of the calling thread, the one of init() unless it's
+	//! in a ContextScope or renders for another context
+	static EngineContext * context()
+	{
+		// only looked up per thread when there's more than one
+		return s_extraContexts.load( std::memory_order_relaxed ) > 0 ?
+						threadContext() : &s_main;
+	}
+
 	// core
 	static Mixer *mixer()
 	{
-		return s_mixer;
+		return context()->mixer;
 	}
 
 	static FxMixer * fxMixer()
 	{
-		return s_fxMixer;
+		return context()->fxMixer;
 	}
 
 	static Song * getSong()
 	{
-		return s_song;
+		return context()->song;
 	}
 
 	static BBTrackContainer * getBBTrackContainer()
 	{
-		return s_bbTrackContainer;
+		return context()->bbTrackContainer;
 	}
 
 	static ProjectJournal * projectJournal()
 	{
-		return s_projectJournal;
+		return context()->projectJournal;
 	}
 
 	static Ladspa2LMMS * getLADSPAManager()
@@ -94,18 +148,32 @@ public:
 
 	static DummyTrackContainer * dummyTrackContainer()
 	{
-		return s_dummyTC;
+		return context()->dummyTC;
 	}
 
 	static float framesPerTick()
 	{
-		return s_framesPerTick;
+		return context()->framesPerTick;
 	}
 
 	static float framesPerTick(sample_rate_t sample_rate);
 
 	static void updateFramesPerTick();
 
+	//! framesPerTick() as of the start of the period being rendered, so
+	//! all of the period sees the same tempo
+	static float periodFramesPerTick()
+	{
+		return context()->periodFramesPerTick;
+	}
+
+	//! Called by the mixer at the start of every period
+	static void updatePeriodFramesPerTick()
+	{
+		EngineContext * c = context();
+		c->periodFramesPerTick = c->framesPerTick;
+	}
+
 	static inline LmmsCore * inst()
 	{
 		if( s_instanceOfMe == NULL )
@@ -118,6 +186,22 @@ public:
 	static void setDndPluginKey(void* newKey);
 	static void* pickDndPluginKey();
 
+	//! Whether the phases of the startup get logged, see --profile-startup
+	static bool profileStartup()
+	{
+		return s_profileStartup;
+	}
+
+	static void setProfileStartup( bool _profile )
+	{
+		s_profileStartup = _profile;
+	}
+
+	//! Shows _name as progress of the startup and with profileStartup()
+	//! logs how long the phase before took, an empty _name ends the last
+	//! phase and logs the time of all of them
+	static void startupPhase( const QString & _name );
+
 signals:
 	void initProgress(const QString &msg);
 
@@ -133,19 +217,20 @@ private:
 		delete tmp;
 	}
 
-	static float s_framesPerTick;
+	static EngineContext * threadContext();
 
-	// core
-	static Mixer *s_mixer;
-	static FxMixer * s_fxMixer;
-	static Song * s_song;
-	static BBTrackContainer * s_bbTrackContainer;
-	static ProjectJournal * s_projectJournal;
-	static DummyTrackContainer * s_dummyTC;
+	// core, of init()
+	static EngineContext s_main;
+	// contexts of createContext()
+	static std::atomic_int s_extraContexts;
 
 	static Ladspa2LMMS * s_ladspaManager;
 	static void* s_dndPluginKey;
 
+	static bool s_profileStartup;
+	static PerfLogTimer * s_startupPhase;
+	static PerfLogTimer * s_startupTotal;
+
 	// even though most methods are static, an instance is needed for Qt slots/signals
 	static LmmsCore * s_instanceOfMe;
 
@@ -33,6 +33,8 @@
 #include "TempoSyncKnobModel.h"
 #include "lmms_basics.h"
 
+struct EngineContext;
+
 
 class LMMS_EXPORT EnvelopeAndLfoParameters : public Model, public JournallingObject
 {
@@ -90,6 +92,13 @@ public:
 		return m_used;
 	}
 
+	//! Whether the LFO modulates - it runs along with the song, not with
+	//! the notes
+	inline bool usesLfo() const
+	{
+		return !m_lfoAmountIsZero;
+	}
+
 
 	void saveSettings( QDomDocument & _doc, QDomElement & _parent ) override;
 	void loadSettings( const QDomElement & _this ) override;
@@ -163,6 +172,8 @@ private:
 	sample_t m_random;
 	bool m_bad_lfoShapeData;
 	SampleBuffer m_userWave;
+	// the engine objects whose mixer advances the LFO
+	EngineContext * m_context;
 
 	enum LfoShapes
 	{
@@ -116,6 +116,8 @@ private:
 	void mouseReleaseEvent( QMouseEvent * _me ) override;
 	void wheelEvent( QWheelEvent *ev ) override;
 	void paintEvent( QPaintEvent *ev ) override;
+	//! Repaints only where the knob was and is
+	void modelDataChanged() override;
 
 	inline bool clips(float const & value) const { return value >= 1.0f; }
 
@@ -132,6 +134,8 @@ private:
 
 	void setPeak( float fPeak, float &targetPeak, float &persistentPeak, QTime &lastPeakTime );
 	int calculateDisplayPeak( float fPeak );
+	//! The height of the level in pixels as it's drawn
+	int levelHeight( float fPeak );
 
 	void updateTextFloat();
 
@@ -160,6 +164,8 @@ private:
 
 	int m_moveStartPoint;
 	float m_startValue;
+	//! Where the knob was painted last
+	int m_knobY;
 
 	static TextFloat * s_textFloat;
 
@@ -26,11 +26,16 @@
 #ifndef FILE_BROWSER_H
 #define FILE_BROWSER_H
 
+#include <atomic>
+
 #include <QtCore/QDir>
 #include <QtCore/QMutex>
+#include <QtCore/QPersistentModelIndex>
+#include <QtCore/QThreadPool>
 #include <QTreeWidget>
 
 
+#include "FileIndex.h"
 #include "SideBarWidget.h"
 
 
@@ -59,21 +64,33 @@ public:
 	FileBrowser( const QString & directories, const QString & filter,
 			const QString & title, const QPixmap & pm,
 			QWidget * parent, bool dirs_as_items = false, bool recurse = false );
-	virtual ~FileBrowser() = default;
+	virtual ~FileBrowser();
 
 private slots:
 	void reloadTree( void );
 	void expandItems( QTreeWidgetItem * item=NULL, QList<QString> expandedDirs = QList<QString>() );
+	void applyFilter( const QString & filter );
 	// call with item=NULL to filter the entire tree
 	bool filterItems( const QString & filter, QTreeWidgetItem * item=NULL );
 	void giveFocusToFilter();
+	//! Adds files found by the scan of the given generation to m_index
+	void addToIndex( int generation, const QStringList & paths );
 
 private:
+	//! Search results shown at most, the tree widget wouldn't cope well
+	//! with all of a large library
+	static const int MaxSearchResults = 1000;
+
 	void keyPressEvent( QKeyEvent * ke ) override;
 
 	void addItems( const QString & path );
+	//! Lists the files below m_directories into m_index in the background
+	void scanFiles();
+	void showSearchResults( const QString & filter );
 
 	FileBrowserTreeWidget * m_fileBrowserTreeWidget;
+	//! The matches of the filter in m_index, shown instead of the tree
+	FileBrowserTreeWidget * m_searchTreeWidget;
 
 	QLineEdit * m_filterEdit;
 
@@ -83,6 +100,15 @@ private:
 	bool m_dirsAsItems;
 	bool m_recurse;
 
+	//! The files of browsers which recurse, searched instead of filtering
+	//! the tree, which would have to load every directory for that
+	FileIndex m_index;
+	//! Changed for every scan, so the ones running before stop
+	std::atomic_int m_scanGeneration;
+	QThreadPool m_scanPool;
+
+	friend class FileScanner;
+
 } ;
 
 
@@ -120,8 +146,14 @@ private:
 
 	FileItem * m_contextMenuItem;
 
+	//! The preset after the one previewed last, loaded once the user
+	//! paused for PreloadDelay milliseconds
+	static const int PreloadDelay = 300;
+	QPersistentModelIndex m_preloadItem;
+
 
 private slots:
+	void preloadPreset();
 	void activateListItem( QTreeWidgetItem * item, int column );
 	void openInNewInstrumentTrackBBE( void );
 	void openInNewInstrumentTrackSE( void );
@@ -0,0 +1,70 @@
+/*
+ * FileIndex.h - finds the files whose names contain a text, for searching the
+ *               file browser
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef FILE_INDEX_H
+#define FILE_INDEX_H
+
+#include <QtCore/QHash>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+#include "lmms_export.h"
+
+
+//! The paths of files with the entries of each trigram (three consecutive
+//! characters) of their lower case names, so a search intersects the few
+//! entries of the rarest trigram of its text instead of matching every name.
+class LMMS_EXPORT FileIndex
+{
+public:
+	void add( const QString & _path );
+	void clear();
+
+	int size() const
+	{
+		return m_paths.size();
+	}
+
+	const QString & path( int _entry ) const
+	{
+		return m_paths[_entry];
+	}
+
+	//! The entries whose file names contain _text regardless of case, in
+	//! the order they were added
+	QVector<int> find( const QString & _text ) const;
+
+
+private:
+	static quint64 trigram( const QChar * _chars );
+
+	QStringList m_paths;
+	//! Lower case file names, for checking the entries of a trigram
+	QStringList m_names;
+	QHash<quint64, QVector<int> > m_trigrams;
+
+} ;
+
+
+#endif
@@ -30,6 +30,7 @@
 #include <QLineEdit>
 #include <QWidget>
 
+#include "embed.h"
 #include "Knob.h"
 #include "LcdWidget.h"
 #include "SendButtonIndicator.h"
@@ -55,6 +56,7 @@ public:
 	void mousePressEvent( QMouseEvent * ) override;
 	void mouseDoubleClickEvent( QMouseEvent * ) override;
 	void contextMenuEvent( QContextMenuEvent * ) override;
+	bool event( QEvent * ) override;
 
 	inline int channelIndex() { return m_channelIndex; }
 	void setChannelIndex(int index);
@@ -93,8 +95,8 @@ private:
 	QColor m_strokeOuterInactive;
 	QColor m_strokeInnerActive;
 	QColor m_strokeInnerInactive;
-	static QPixmap * s_sendBgArrow;
-	static QPixmap * s_receiveBgArrow;
+	static LazyPixmap s_sendBgArrow;
+	static LazyPixmap s_receiveBgArrow;
 	bool m_inRename;
 	QLineEdit * m_renameLineEdit;
 	QGraphicsView * m_view;
@@ -27,17 +27,26 @@
 
 #include "Model.h"
 #include "EffectChain.h"
+#include "AudioTap.h"
 #include "JournallingObject.h"
+#include "LatencyCompensator.h"
+#include "LoudnessMeter.h"
 #include "ThreadableJob.h"
 
 #include <atomic>
 
+class AudioPort;
 class FxRoute;
+class FxChannel;
+class StemTap;
 typedef QVector<FxRoute *> FxRouteVector;
+typedef QVector<FxChannel *> FxChannelVector;
 
 class FxChannel : public ThreadableJob
 {
 	public:
+		static const int MaxPipelineStages = 4;
+
 		FxChannel( int idx, Model * _parent );
 		virtual ~FxChannel();
 
@@ -47,14 +56,30 @@ class FxChannel : public ThreadableJob
 		bool m_hasInput;
 		// set to true if any effect in the channel is enabled and running
 		bool m_stillRunning;
+		// set to true when the buffer has been written to in this period
+		// and has to be cleared afterwards
+		bool m_bufferDirty;
 
 		float m_peakLeft;
 		float m_peakRight;
+		// points into the slab of the mixer like m_inputs, see
+		// FxMixer::layoutChannelBuffers()
 		sampleFrame * m_buffer;
+		// what the audio ports sent, summed up by every thread processing
+		// jobs in a buffer of its own so ports feeding the same channel
+		// don't wait for each other, see FxMixer::mixToChannel()
+		int m_inputSlots;
+		sampleFrame * m_inputs;
+		bool * m_inputUsed;
 		bool m_muteBeforeSolo;
 		BoolModel m_muteModel;
 		BoolModel m_soloModel;
 		FloatModel m_volumeModel;
+		// stages the effects are split into for running on different
+		// threads at the same time, each one taking what the one before
+		// put out during the last period - a period of latency for every
+		// stage after the first one, 1 for processing them in one go
+		IntModel m_pipelineStagesModel;
 		QString m_name;
 		QMutex m_lock;
 		int m_channelIndex; // what channel index are we
@@ -67,16 +92,82 @@ class FxChannel : public ThreadableJob
 		// pointers to other channels that send to this one
 		FxRouteVector m_receives;
 
+		// channels whose output effects of this one take as sidechain
+		// input and channels with effects taking the output of this one,
+		// see FxMixer::updateSidechains()
+		FxChannelVector m_sidechainSources;
+		FxChannelVector m_sidechainListeners;
+
+		// takes the output after the fader while exporting stems, see
+		// StemExporter
+		StemTap * m_stemTap;
+		// the output before the fader, for scopes and meters
+		AudioTapPoint m_tap;
+		// RMS, true peak and loudness after the fader, measured while
+		// anyone reads them
+		LoudnessMeter m_meter;
+
 		bool requiresProcessing() const override { return true; }
 		void unmuteForSolo();
 
 	
 		std::atomic_int m_dependenciesMet;
+		// number of audio ports feeding this channel when processed as
+		// part of the render graph, 0 otherwise
+		int m_portInputs;
+
+		// latency of the slowest input and of the output including the
+		// effects, see FxMixer::updateLatencies()
+		f_cnt_t m_inputLatency;
+		f_cnt_t m_latency;
+
 		void incrementDeps();
 		void processed();
-		
+
+		//! Splits the effects anew if the number of stages or effects
+		//! changed or they weren't split by their cost yet, see
+		//! EffectChain::splitIntoStages(). Clears what's left in the stages
+		//! if the split changes.
+		void updatePipeline();
+		//! Stages the effects are split into right now
+		int pipelineStages() const
+		{
+			return m_pipelineStages;
+		}
+		//! Queues the stages after the first one, which the channel
+		//! processes itself
+		void queuePipeline();
+		void resetPipeline();
+
+	protected:
+		void predecessorDone() override;
+		const char * traceName() const override
+		{
+			return "FxChannel";
+		}
+
 	private:
+		class PipelineStage;
+
 		void doProcessing() override;
+		//! Add the inputs of all threads to m_buffer
+		void combineInputs( fpp_t _frames );
+		//! Waits for the stages after the first one, helping with them,
+		//! puts the output of the last one into m_buffer and hands the
+		//! output of each stage on to the next one. Returns whether the
+		//! output is active.
+		bool finishPipeline( bool _firstActive, fpp_t _frames );
+
+		PipelineStage * m_stages[MaxPipelineStages - 1];
+		int m_pipelineStages;
+		// where each stage ends in the chain
+		int m_stageEnds[MaxPipelineStages];
+		// whether effects of the first stage are still running
+		bool m_firstStageRunning;
+		// the number of stages and effects the chain was split for
+		int m_pipelineWanted;
+		int m_pipelineEffects;
+		bool m_pipelineByCost;
 };
 
 
@@ -113,11 +204,18 @@ class FxRoute : public QObject
 	}
 	
 	void updateName();
+
+	//! Lines the send up with slower inputs of the receiver
+	LatencyCompensator * compensator()
+	{
+		return &m_compensator;
+	}
 		
 	private:
 		FxChannel * m_from;
 		FxChannel * m_to;
 		FloatModel m_amount;
+		LatencyCompensator m_compensator;
 };
 
 
@@ -130,9 +228,24 @@ public:
 
 	void mixToChannel( const sampleFrame * _buf, fx_ch_t _ch );
 
-	void prepareMasterMix();
+	//! Also delays the faster of the paths meeting in a channel, so all
+	//! inputs of a channel are lined up with its slowest one
+	void prepareMasterMix( const QVector<AudioPort *> & ports );
 	void masterMix( sampleFrame * _buf );
 
+	// render graph mode: instead of processing all channels in a separate
+	// stage, channels are queued by the audio ports feeding them (see
+	// Mixer::runRenderGraph()) - must be called after resetting the job queue
+	void prepareRenderGraph( const QVector<AudioPort *> & ports );
+	//! Queues the later stages of channels whose effects are split into
+	//! several, see FxChannel::m_pipelineStagesModel, so they run along with
+	//! the first jobs of the period - must be called after resetting the
+	//! job queue
+	void queuePipelineStages();
+	// mix master channel into _buf once all jobs are done and reset state
+	// of all channels
+	void finishMasterMix( sampleFrame * _buf );
+
 	void saveSettings( QDomDocument & _doc, QDomElement & _parent ) override;
 	void loadSettings( const QDomElement & _this ) override;
 
@@ -161,6 +274,15 @@ public:
 	bool isInfiniteLoop(fx_ch_t fromChannel, fx_ch_t toChannel);
 	bool checkInfiniteLoop( FxChannel * from, FxChannel * to );
 
+	//! Rebuilds the sidechain edges between the channels from their
+	//! effects, a channel with an effect taking the output of another one
+	//! as sidechain input is processed after it. The master channel can't
+	//! be a source and edges which would close a loop are left out.
+	void updateSidechains();
+
+	//! Index of the channel _chain belongs to, -1 for chains of tracks
+	int channelIndexOf( const EffectChain * _chain ) const;
+
 	// return the FloatModel of fromChannel sending its output to the input of
 	// toChannel. NULL if there is no send.
 	FloatModel * channelSendModel(fx_ch_t fromChannel, fx_ch_t toChannel);
@@ -197,12 +319,50 @@ public:
 	FxRouteVector m_fxRoutes;
 
 private:
+	typedef QVector<FxChannel *> FxChannelList;
+
 	// the fx channels in the mixer. index 0 is always master.
-	QVector<FxChannel *> m_fxChannels;
+	FxChannelList m_fxChannels;
+
+	// processing order of all unmuted channels. channels of one level
+	// only receive from channels of previous levels so each level can be
+	// processed in parallel
+	QVector<FxChannelList> m_schedule;
+	// set when routing changed - mute changes are detected in masterMix()
+	std::atomic_bool m_scheduleOutdated;
+
+	void invalidateSchedule()
+	{
+		m_scheduleOutdated = true;
+	}
+	void updateSchedule();
+
+	// the buffers and inputs of all channels, one slot after the other
+	sampleFrame * m_channelBuffers;
+	int m_channelBufferSlots;
+	// set by updateSchedule(), the slots get handed out again after the
+	// period when all buffers are clear
+	bool m_bufferLayoutOutdated;
+
+	//! Frames of a channel's slot in m_channelBuffers
+	static f_cnt_t channelSlotFrames();
+	//! Makes room in m_channelBuffers for _channels channels
+	void reserveChannelBuffers( int _channels );
+	//! Gives the channels cleared slots in the order they're scheduled and
+	//! the remaining ones after them, so processing a period walks through
+	//! the slab instead of jumping around the heap
+	void layoutChannelBuffers();
+
+	void updateLatencies( const QVector<AudioPort *> & ports );
+	f_cnt_t outputLatency( FxChannel * ch );
 
 	// make sure we have at least num channels
 	void allocateChannelsTo(int num);
 
+	//! Gives the effects of all channels taking channel i as sidechain
+	//! input channel _newIndex[i] as source instead, -1 for none
+	void remapSidechains( const QVector<int> & _newIndex );
+
 	int m_lastSoloed;
 
 } ;
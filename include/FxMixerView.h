@@ -39,6 +39,7 @@
 #include "EffectRackView.h"
 
 class QButtonGroup;
+class QLabel;
 class FxLine;
 
 class LMMS_EXPORT FxMixerView : public QWidget, public ModelView,
@@ -114,6 +115,8 @@ protected:
 	
 private slots:
 	void updateFaders();
+	//! Shows the levels of the selected channel, see LoudnessMeter
+	void updateLoudness();
 	void toggledSolo();
 
 private:
@@ -127,6 +130,9 @@ private:
 	QWidget * m_channelAreaWidget;
 	QStackedLayout * m_racksLayout;
 	QWidget * m_racksWidget;
+	// of the snapshot whose peaks the faders show
+	quint64 m_lastPeriod;
+	QLabel * m_loudnessLabel;
 
 	void updateMaxChannelSelector();
 	
@@ -43,7 +43,7 @@ class Track;
 
 class LMMS_EXPORT Instrument : public Plugin
 {
-	MM_OPERATORS
+	MM_OPERATORS_TAGGED( Plugins )
 public:
 	enum Flag
 	{
@@ -51,6 +51,8 @@ public:
 		IsSingleStreamed = 0x01,	/*! Instrument provides a single audio stream for all notes */
 		IsMidiBased = 0x02,			/*! Instrument is controlled by MIDI events rather than NotePlayHandles */
 		IsNotBendable = 0x04,		/*! Instrument can't react to pitch bend changes */
+		RendersVoicesBatched = 0x08,	/*! Instrument renders all notes of a period at once in renderVoices(),
+										driven by an InstrumentPlayHandle it creates */
 	};
 
 	Q_DECLARE_FLAGS(Flags, Flag);
@@ -77,6 +79,14 @@ public:
 	{
 	}
 
+	// instruments with the RendersVoicesBatched flag get all notes of a
+	// period at once instead of single playNote() calls, so they can share
+	// work between notes or process several of them in SIMD lanes - each
+	// note has to be rendered into its buffer and passed through
+	// InstrumentTrack::processAudioBuffer() just like in playNote()
+	virtual void renderVoices( NotePlayHandle * const * _notes,
+					sampleFrame * const * _working_bufs, int _count );
+
 	// needed for deleting plugin-specific-data of a note - plugin has to
 	// cast void-ptr so that the plugin-data is deleted properly
 	// (call of dtor if it's a class etc.)
@@ -98,11 +108,46 @@ public:
 		return 0;
 	}
 
+	// notes in their release phase are ended early once their output
+	// (including envelopes and note volume) stays below this level for
+	// silentVoicePeriods() periods - instruments with long or sparse
+	// tails (delays, reverbs, sparse grains) can re-implement this method
+	// and return 0 for opting out
+	virtual float silentVoiceThreshold() const
+	{
+		return 1e-6f;	// -120 dBFS
+	}
+
+	virtual int silentVoicePeriods() const
+	{
+		return 8;
+	}
+
 	virtual Flags flags() const
 	{
 		return NoFlags;
 	}
 
+	// instruments which render a note the same way whenever it's played
+	// with the same settings, i.e. which depend on nothing but their
+	// models, the note and the time since it started, can re-implement
+	// this method so the beat/bassline tracks they play get cached (see
+	// BBLoopCache) - no noise, free running oscillators or samples which
+	// aren't models
+	virtual bool isDeterministic() const
+	{
+		return false;
+	}
+
+	// frames the output lags behind the notes and MIDI events, e.g. for
+	// instruments hosted in another process - the FX mixer delays parallel
+	// paths by as much (see LatencyCompensator), it's asked from the audio
+	// thread while playing
+	virtual f_cnt_t latencyFrames() const
+	{
+		return 0;
+	}
+
 	// sub-classes can re-implement this for receiving all incoming
 	// MIDI-events
 	inline virtual bool handleMidiEvent( const MidiEvent&, const MidiTime& = MidiTime(), f_cnt_t offset = 0 )
@@ -25,6 +25,9 @@
 #ifndef INSTRUMENT_FUNCTIONS_H
 #define INSTRUMENT_FUNCTIONS_H
 
+#include <memory>
+#include <vector>
+
 #include "JournallingObject.h"
 #include "lmms_basics.h"
 #include "AutomatableModel.h"
@@ -175,6 +178,16 @@ public:
 
 	void processNote( NotePlayHandle* n );
 
+	//! Whether the arpeggio plays a note the same way each time, i.e.
+	//! it's off or neither random nor skips or misses notes
+	bool isDeterministic() const
+	{
+		return !m_arpEnabledModel.value() ||
+			( m_arpDirectionModel.value() != ArpDirRandom &&
+				m_arpSkipModel.value() == 0 &&
+				m_arpMissModel.value() == 0 );
+	}
+
 
 	void saveSettings( QDomDocument & _doc, QDomElement & _parent ) override;
 	void loadSettings( const QDomElement & _this ) override;
@@ -185,6 +198,10 @@ public:
 	}
 
 
+private slots:
+	void updateSchedule();
+
+
 private:
 	enum ArpModes
 	{
@@ -193,6 +210,15 @@ private:
 		SyncMode
 	} ;
 
+	//! Keys of the steps of one cycle of the arpeggio relative to the
+	//! played note, so steps don't have to work out the direction, the
+	//! cycling and the chord each. Empty for random directions.
+	typedef std::vector<int> Schedule;
+
+	//! Key of note _index of _chord extended over the octaves above it,
+	//! relative to the played note
+	static int chordKey( int _chord, int _index );
+
 	BoolModel m_arpEnabledModel;
 	ComboBoxModel m_arpModel;
 	FloatModel m_arpRangeModel;
@@ -204,6 +230,9 @@ private:
 	ComboBoxModel m_arpDirectionModel;
 	ComboBoxModel m_arpModeModel;
 
+	// replaced when the settings change while notes read it
+	std::shared_ptr<const Schedule> m_schedule;
+
 
 	friend class InstrumentTrack;
 	friend class InstrumentFunctionArpeggioView;
@@ -31,8 +31,10 @@
 #include "ModelView.h"
 
 
+class ComboBox;
 class GroupBox;
 class LcdSpinBox;
+class QLabel;
 class QToolButton;
 class LedCheckBox;
 class InstrumentTrack;
@@ -77,9 +79,18 @@ public:
 		return m_pitchGroupBox;
 	}
 
+	void setTrack( InstrumentTrack * it );
+
+private slots:
+	void updateVoiceCount();
+
 private:
 
+	InstrumentTrack * m_track;
 	GroupBox * m_pitchGroupBox;
+	LcdSpinBox * m_polyphonySpinBox;
+	ComboBox * m_voiceStealComboBox;
+	QLabel * m_voiceCountLabel;
 
 };
 
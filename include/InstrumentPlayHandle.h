@@ -42,6 +42,12 @@ public:
 
 	void play( sampleFrame * _working_buffer ) override
 	{
+		// the audio of a frozen track is played instead
+		if( isBypassed() )
+		{
+			return;
+		}
+
 		// ensure that all our nph's have been processed first
 		ConstNotePlayHandleList nphv = NotePlayHandle::nphsOfInstrumentTrack( m_instrument->instrumentTrack(), true );
 		
@@ -61,7 +67,13 @@ public:
 			}
 		}
 		while( nphsLeft );
-		
+
+		if( m_instrument->flags().testFlag( Instrument::RendersVoicesBatched ) )
+		{
+			renderVoices( nphv );
+			return;
+		}
+
 		m_instrument->play( _working_buffer );
 	}
 
@@ -77,6 +89,9 @@ public:
 
 
 private:
+	bool isBypassed() const;
+	void renderVoices( const ConstNotePlayHandleList& nphv );
+
 	Instrument* m_instrument;
 
 } ;
@@ -56,6 +56,9 @@ public:
 
 	float volumeLevel( NotePlayHandle * _n, const f_cnt_t _frame );
 
+	//! Whether any of the LFOs modulates the notes
+	bool usesLfo() const;
+
 
 	void saveSettings( QDomDocument & _doc, QDomElement & _parent ) override;
 	void loadSettings( const QDomElement & _this ) override;
@@ -73,6 +76,8 @@ private:
 	ComboBoxModel m_filterModel;
 	FloatModel m_filterCutModel;
 	FloatModel m_filterResModel;
+	//! Lower quality for cheaper envelope- or LFO-modulated filters
+	BoolModel m_fastFilterModulationModel;
 
 	static const QString targetNames[InstrumentSoundShaping::NumTargets][3];
 
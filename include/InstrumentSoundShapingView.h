@@ -36,6 +36,7 @@ class EnvelopeAndLfoView;
 class ComboBox;
 class GroupBox;
 class Knob;
+class LedCheckBox;
 class TabWidget;
 
 
@@ -62,6 +63,7 @@ private:
 	ComboBox * m_filterComboBox;
 	Knob * m_filterCutKnob;
 	Knob * m_filterResKnob;
+	LedCheckBox * m_fastFilterModulationCheckBox;
 
 	QLabel* m_singleStreamInfoLabel;
 
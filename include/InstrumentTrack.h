@@ -26,7 +26,12 @@
 #ifndef INSTRUMENT_TRACK_H
 #define INSTRUMENT_TRACK_H
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include "AudioPort.h"
+#include "ComboBoxModel.h"
 #include "GroupBox.h"
 #include "InstrumentFunctions.h"
 #include "InstrumentSoundShaping.h"
@@ -43,11 +48,13 @@
 
 class QLineEdit;
 template<class T> class QQueue;
+class BBLoopCache;
 class InstrumentFunctionArpeggioView;
 class InstrumentFunctionNoteStackingView;
 class EffectRackView;
 class InstrumentSoundShapingView;
 class FadeButton;
+class FreezePlayHandle;
 class Instrument;
 class InstrumentTrackWindow;
 class InstrumentMidiIOView;
@@ -60,6 +67,7 @@ class midiPortMenu;
 class DataFile;
 class PluginView;
 class TabWidget;
+class TrackFreeze;
 class TrackLabelButton;
 class LedCheckBox;
 class QLabel;
@@ -71,6 +79,15 @@ class LMMS_EXPORT InstrumentTrack : public Track, public MidiEventProcessor
 	MM_OPERATORS
 	mapPropertyFromModel(int,getVolume,setVolume,m_volumeModel);
 public:
+	//! Which note to end if a new one would exceed the maximum polyphony
+	enum VoiceStealModes
+	{
+		StealOldest,
+		StealQuietest,
+		StealSameKey,	// the same key if it's playing, the oldest otherwise
+		NumVoiceStealModes
+	} ;
+
 	InstrumentTrack( TrackContainer* tc );
 	virtual ~InstrumentTrack();
 
@@ -90,6 +107,12 @@ public:
 		return m_sustainPedalPressed;
 	}
 
+	//! Notes being played, including the ones in their release
+	int voiceCount() const
+	{
+		return m_voiceCount;
+	}
+
 	f_cnt_t beatLen( NotePlayHandle * _n ) const;
 
 
@@ -162,6 +185,12 @@ public:
 		return &m_midiPort;
 	}
 
+	//! Whether notes may come in live (e.g. from a MIDI keyboard)
+	bool hasLiveInput() const
+	{
+		return m_midiPort.isInputEnabled();
+	}
+
 	const IntModel *baseNoteModel() const
 	{
 		return &m_baseNoteModel;
@@ -212,6 +241,16 @@ public:
 		return &m_effectChannelModel;
 	}
 
+	IntModel * polyphonyModel()
+	{
+		return &m_polyphonyModel;
+	}
+
+	ComboBoxModel * voiceStealModel()
+	{
+		return &m_voiceStealModel;
+	}
+
 	void setPreviewMode( const bool );
 
 	bool isPreviewMode() const
@@ -219,6 +258,46 @@ public:
 		return m_previewMode;
 	}
 
+	//! Marks the note starts of all instrument tracks outdated, called
+	//! whenever notes or patterns change
+	static void invalidateNoteStarts()
+	{
+		++s_noteStartsGeneration;
+	}
+
+	//! Whether the audio of the track comes from a freeze instead of its
+	//! notes when the song is played, see TrackFreeze
+	bool isFrozen() const
+	{
+		return m_freeze != nullptr;
+	}
+
+	//! Whether the song is being played from the freeze right now, the
+	//! instrument is bypassed then. Patterns played on their own and
+	//! notes played live still use it.
+	bool isPlayingFrozen() const;
+
+	//! Plays _freeze from now on until the notes or the sound of the track
+	//! change. Returns false if it couldn't be played.
+	bool setFreeze( std::unique_ptr<TrackFreeze> _freeze );
+
+	//! Lets play() mark the ticks of the song for _freeze while it's
+	//! being recorded, see TrackFreezer
+	void setFreezeRecording( TrackFreeze * _freeze );
+
+	//! Replays beat/basslines repeated unchanged from a cache while
+	//! _enabled, see BBLoopCache - only for tracks of the beat/bassline
+	//! editor
+	void setLoopCaching( bool _enabled );
+	BBLoopCache * loopCache() const
+	{
+		return m_loopCache.get();
+	}
+
+public slots:
+	//! Goes back to playing the notes with the instrument
+	void unfreeze();
+
 signals:
 	void instrumentChanged();
 	void midiNoteOn( const Note& );
@@ -245,7 +324,29 @@ protected slots:
 	void updateEffectChannel();
 
 
+private slots:
+	void freezeModelChanged();
+	void invalidateFreeze();
+	void updateFreezeSampleRate();
+	void updateLoopCacheModels();
+
+
 private:
+	//! Hands _instrument to the audio threads between two periods and
+	//! returns the one it replaced
+	Instrument * swapInstrument( Instrument * _instrument );
+	//! Steal notes until _newNote fits into the maximum polyphony
+	void limitPolyphony( NotePlayHandle * _newNote );
+	NotePlayHandle * voiceToSteal( const NotePlayHandle * _newNote );
+	//! Whether a note of a pattern of the track may start at the
+	//! song-global _time, rebuilds m_noteStarts if it's outdated
+	bool mayStartNote( const MidiTime & _time );
+	//! Everything the audio of the notes depends on, apart from what's
+	//! applied to it while it's played
+	QList<AutomatableModel *> soundModels();
+	//! Unfreeze as soon as anything the frozen audio depends on changes
+	void watchFreeze( bool _watch );
+
 	MidiPort m_midiPort;
 
 	NotePlayHandle* m_notes[NumKeys];
@@ -263,6 +364,14 @@ private:
 	IntModel m_baseNoteModel;
 
 	NotePlayHandleList m_processHandles;
+	std::atomic_int m_voiceCount;
+
+	// song-global positions of the notes of all patterns, sorted - a
+	// superset of what play() starts, which lets it skip ticks without
+	// looking at any pattern
+	std::vector<tick_t> m_noteStarts;
+	int m_noteStartsGeneration;
+	static std::atomic_int s_noteStartsGeneration;
 
 	FloatModel m_volumeModel;
 	FloatModel m_panningModel;
@@ -273,6 +382,9 @@ private:
 	IntModel m_pitchRangeModel;
 	IntModel m_effectChannelModel;
 	BoolModel m_useMasterPitchModel;
+	//! 0 for no limit
+	IntModel m_polyphonyModel;
+	ComboBoxModel m_voiceStealModel;
 
 
 	Instrument * m_instrument;
@@ -282,7 +394,14 @@ private:
 
 	Piano m_piano;
 
+	std::unique_ptr<TrackFreeze> m_freeze;
+	FreezePlayHandle * m_freezeHandle;
+	TrackFreeze * m_freezeRecording;
+
+	std::unique_ptr<BBLoopCache> m_loopCache;
 
+
+	friend class BBLoopCache;
 	friend class InstrumentTrackView;
 	friend class InstrumentTrackWindow;
 	friend class NotePlayHandle;
@@ -326,6 +445,9 @@ public:
 	// Create a menu for assigning/creating channels for this track
 	QMenu * createFxMenu( QString title, QString newFxLabel ) override;
 
+	//! Adds the actions for freezing the track or unfreezing it
+	void addFreezeActions( QMenu * _menu );
+
 
 protected:
 	void dragEnterEvent( QDragEnterEvent * _dee ) override;
@@ -344,6 +466,9 @@ private slots:
 	void assignFxLine( int channelIndex );
 	void createFxLine();
 
+	void freezeTrack();
+	void freezeTrackWithEffects();
+
 
 private:
 	InstrumentTrackWindow * m_window;
@@ -363,6 +488,8 @@ private:
 
 	QPoint m_lastPos;
 
+	void freeze( bool _afterEffects );
+
 	FadeButton * getActivityIndicator()
 	{
 		return m_activityIndicator;
@@ -0,0 +1,72 @@
+/*
+ * JobBatcher.h - queues cheap jobs of the mixer together
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef JOB_BATCHER_H
+#define JOB_BATCHER_H
+
+#include <vector>
+
+#include "lmms_export.h"
+
+class ThreadableJob;
+
+
+//! Queues jobs which took less than a budget per period lately (see
+//! ThreadableJob::cpuUsage()) together, in batches about worth the budget
+//! which the worker threads process like one job. Hundreds of voices of a
+//! light instrument then don't spend more time in the job queue than in
+//! rendering. Jobs taking longer are queued on their own. Only to be used
+//! by the mixer thread while it fills the job queue.
+class LMMS_EXPORT JobBatcher
+{
+public:
+	JobBatcher();
+	~JobBatcher();
+
+	//! Start over for a new job queue, with batches worth _budget
+	//! microseconds - 0 queues every job on its own
+	void reset( float _budget );
+
+	//! Queue _job on its own or batched, returns false if it doesn't
+	//! require processing like MixerWorkerThread::addJob()
+	bool addJob( ThreadableJob * _job );
+
+	//! Queue the batch being filled, has to be done before the jobs are
+	//! started
+	void flush();
+
+
+private:
+	class Batch;
+
+	// enough for a few thousand voices, jobs beyond are queued on their
+	// own
+	static const int MaxBatches = 256;
+
+	std::vector<Batch *> m_batches;
+	int m_usedBatches;
+	float m_budget;
+
+} ;
+
+
+#endif
@@ -27,12 +27,13 @@
 #define KNOB_H
 
 #include <QWidget>
+#include <QtCore/QHash>
 #include <QtCore/QPoint>
+#include <QPixmap>
 
 #include "AutomatableModelView.h"
 
 
-class QPixmap;
 class TextFloat;
 
 enum knobTypes
@@ -137,20 +138,23 @@ protected:
 
 	virtual float getValue( const QPoint & _p );
 
+	//! Repaints only once the knob turns to another frame
+	void modelDataChanged() override;
+
 private slots:
 	virtual void enterValue();
-	void friendlyUpdate();
 	void toggleScale();
 
 private:
 	QString displayValue() const;
 
-	void doConnections() override;
-
 	QLineF calculateLine( const QPointF & _mid, float _radius,
 						float _innerRadius = 1) const;
 
 	void drawKnob( QPainter * _p );
+	QPixmap renderKnob( int _centerAngle, const QColor & _penColor ) const;
+	//! What the frames of the knob depend on besides its angle
+	QString spriteKey( int _centerAngle, const QColor & _penColor ) const;
 	void setPosition( const QPoint & _p );
 	bool updateAngle();
 
@@ -167,6 +171,12 @@ private:
 
 	static TextFloat * s_textFloat;
 
+	//! The knob is drawn at angles this many degrees apart
+	static const int AngleStep = 3;
+	//! The frames drawn so far by the angle, of each kind of knob, which
+	//! are shared by all knobs looking alike
+	static QHash<QString, QHash<int, QPixmap> > s_sprites;
+
 	QString m_label;
 
 	QPixmap * m_knobPixmap;
@@ -180,7 +190,6 @@ private:
 
 	float m_totalAngle;
 	int m_angle;
-	QImage m_cache;
 
 	// Styled knob stuff, could break out
 	QPointF m_centerPoint;
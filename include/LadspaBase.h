@@ -71,6 +71,9 @@ typedef struct PortDescription
 	//! Note however that the model can still decide to use a linear scale
 	bool suggests_logscale;
 	LADSPA_Data * buffer;
+	//! whether all of buffer holds value, so audio rate inputs without
+	//! sample-exact data are only refilled once their value changes
+	bool holdsValue;
 	LadspaControl * control;
 } port_desc_t;
 
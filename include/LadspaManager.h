@@ -30,6 +30,7 @@
 
 #include <ladspa.h>
 
+#include <QtCore/QHash>
 #include <QtCore/QMap>
 #include <QtCore/QPair>
 #include <QtCore/QString>
@@ -72,11 +73,17 @@ enum ladspaPluginType
 
 typedef struct ladspaManagerStorage
 {
+	/* NULL until the library is loaded, which happens once one of its
+	plug-ins is used if it was found in the scan cache */
 	LADSPA_Descriptor_Function descriptorFunction;
 	uint32_t index;
 	ladspaPluginType type;
 	uint16_t inputChannels;
 	uint16_t outputChannels;
+	/* What's needed to list the plug-in without loading the library */
+	QString library;
+	QString name;
+	LADSPA_Properties properties;
 } ladspaManagerDescription;
 
 
@@ -329,8 +336,28 @@ public:
 						LADSPA_Handle _instance );
 
 private:
+	/* What the scan cache keeps of a library */
+	struct CachedLibrary
+	{
+		qint64 size;
+		qint64 modified;
+		QList<QPair<QString, ladspaManagerDescription> > plugins;
+	} ;
+
+	static QString scanCacheFile();
+	QHash<QString, CachedLibrary> readScanCache() const;
+	void writeScanCache( const QHash<QString, CachedLibrary> & _cache ) const;
+
 	void  addPlugins( LADSPA_Descriptor_Function _descriptor_func,
+						const QString & _file,
+						const QString & _library );
+	/* Adds the plug-ins of a library in the scan cache without loading
+	it */
+	void  addCachedPlugins( const CachedLibrary & _library,
 						const QString & _file );
+	/* Loads the library of the plug-in if that wasn't done yet */
+	bool  resolve( ladspaManagerDescription * _description,
+						const QString & _label );
 	uint16_t  getPluginInputs( const LADSPA_Descriptor * _descriptor );
 	uint16_t  getPluginOutputs( const LADSPA_Descriptor * _descriptor );
 
@@ -0,0 +1,72 @@
+/*
+ * LatencyCompensator.h - delays a path to line it up with slower ones
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef LATENCY_COMPENSATOR_H
+#define LATENCY_COMPENSATOR_H
+
+#include "DelayLine.h"
+#include "lmms_basics.h"
+#include "lmms_export.h"
+#include "MemoryManager.h"
+
+
+//! Delays a stereo signal by a whole number of frames, so it meets signals
+//! of parallel paths with a higher latency at the same time. The FX mixer
+//! sets the delay of each audio port and send, see FxMixer::prepareMasterMix().
+//! Once the input went silent, what's still in the delay has to be passed on
+//! for as long as the delay, see hasTail().
+class LMMS_EXPORT LatencyCompensator
+{
+	MM_OPERATORS
+public:
+	LatencyCompensator();
+
+	//! Changes the delay and drops what's on its way. Only allocates when
+	//! the delay grows beyond all delays before.
+	void setDelay( f_cnt_t frames );
+
+	f_cnt_t delay() const
+	{
+		return m_delay;
+	}
+
+	//! Whether input passed earlier has yet to come out
+	bool hasTail() const
+	{
+		return m_tail > 0;
+	}
+
+	//! Delays _buf in place, _silent tells it's all zeros so the tail ends
+	//! once the delay passed
+	void process( sampleFrame * _buf, fpp_t _frames, bool _silent );
+
+
+private:
+	DelayLine m_lines[DEFAULT_CHANNELS];
+	f_cnt_t m_delay;
+	// frames of the last input which didn't come out yet
+	f_cnt_t m_tail;
+
+} ;
+
+
+#endif
@@ -27,10 +27,14 @@
 #define LCD_WIDGET_H
 
 #include <QtCore/QMap>
+#include <QPixmap>
 #include <QWidget>
 
 #include "lmms_export.h"
 
+class QPainter;
+
+
 class LMMS_EXPORT LcdWidget : public QWidget
 {
 	Q_OBJECT
@@ -52,7 +56,7 @@ public:
 	void addTextForValue( int value, const QString& text )
 	{
 		m_textForValue[value] = text;
-		update();
+		invalidateCache();
 	}
 
 	Q_PROPERTY( int numDigits READ numDigits WRITE setNumDigits )
@@ -71,6 +75,7 @@ public slots:
 
 
 protected:
+	void changeEvent( QEvent * ce ) override;
 	void paintEvent( QPaintEvent * pe ) override;
 
 	virtual void updateSize();
@@ -85,12 +90,18 @@ private:
 
 	static const int charsPerPixmap = 12;
 
+	void drawLcd( QPainter & p );
+	//! Has the widget drawn again on the next paint
+	void invalidateCache();
+
 	QMap<int, QString> m_textForValue;
 
 	QString m_display;
 
 	QString m_label;
 	QPixmap* m_lcdPixmap;
+	//! The widget as painted last, for repaints without changes
+	QPixmap m_cache;
 
 	QColor m_textColor;
 	QColor m_textShadowColor;
@@ -0,0 +1,113 @@
+/*
+ * LevelDetector.h - block based level detection for dynamics effects
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef LEVEL_DETECTOR_H
+#define LEVEL_DETECTOR_H
+
+#include <vector>
+
+#include "lmms_basics.h"
+#include "lmms_export.h"
+#include "MemoryManager.h"
+
+
+//! Follows the level of one channel for compressors, gates and the like.
+//! A block is squared, averaged over the RMS window and given attack and
+//! release, each step as a loop over the whole block. The envelope moves
+//! by a constant factor per frame, i.e. linearly in dB, and stays between
+//! a floor and a ceiling. With a lookahead the levels are taken that many
+//! frames ahead of the audio, which the detector delays by as much.
+class LMMS_EXPORT LevelDetector
+{
+	MM_OPERATORS
+public:
+	LevelDetector( float floor, float ceiling );
+
+	//! Frames the RMS is taken over, one follows the peaks
+	void setRmsSize( int frames );
+
+	//! Frames the levels are ahead of the audio, also its latency
+	void setLookahead( int frames );
+
+	int lookahead() const
+	{
+		return static_cast<int>( m_delay.size() );
+	}
+
+	//! Factors the envelope is multiplied with per frame while rising and
+	//! falling, above and below one
+	void setAttack( float factor )
+	{
+		m_attack = factor;
+	}
+
+	void setRelease( float factor )
+	{
+		m_release = factor;
+	}
+
+	//! Forgets the input so far and drops the envelope to the floor
+	void reset();
+
+	float level() const
+	{
+		return m_envelope;
+	}
+
+	//! Writes the level of each of the _frames samples of _buf to _levels
+	//! and delays _buf by the lookahead
+	void process( sample_t * _buf, float * _levels, fpp_t _frames );
+
+	//! Maps each level through _curve, whose _points values are spaced
+	//! 1 / _scale apart with the one for 0 left out, and writes the gain
+	//! which takes the level there. Levels at the floor get a gain of one.
+	static void curveGains( const float * _curve, int _points, float _scale,
+				float _floor, const float * _levels,
+				float * _gains, fpp_t _frames );
+
+	//! Sum of the squares of _samples samples, negative ones count
+	//! negative with _keepSign, e.g. for a signed RMS of a block
+	static double sumOfSquares( const sample_t * _src, int _samples,
+							bool _keepSign );
+
+
+private:
+	const float m_floor;
+	const float m_ceiling;
+
+	float m_envelope;
+	float m_attack;
+	float m_release;
+
+	// squares within the RMS window
+	std::vector<float> m_window;
+	int m_windowPos;
+	double m_windowSum;
+
+	// audio waiting for the lookahead
+	std::vector<sample_t> m_delay;
+	int m_delayPos;
+
+} ;
+
+
+#endif
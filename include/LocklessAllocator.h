@@ -31,13 +31,40 @@
 class LocklessAllocator
 {
 public:
-	LocklessAllocator( size_t nmemb, size_t size );
+	//! Elements are aligned to _alignment, which must be a power of two
+	LocklessAllocator( size_t nmemb, size_t size,
+					size_t alignment = sizeof( void * ) );
 	virtual ~LocklessAllocator();
 	void * alloc();
+	//! Like alloc() but doesn't complain if there's no free space left
+	void * tryAlloc();
 	void free( void * ptr );
 
+	//! Whether ptr points into the pool of this allocator
+	bool contains( const void * ptr ) const
+	{
+		return ptr >= m_pool && ptr < m_pool + m_capacity * m_elementSize;
+	}
+
+	size_t capacity() const
+	{
+		return m_capacity;
+	}
+
+	//! The memory all elements are taken from
+	void * pool() const
+	{
+		return m_pool;
+	}
+
+	size_t poolSize() const
+	{
+		return m_capacity * m_elementSize;
+	}
+
 
 private:
+	char * m_storage;
 	char * m_pool;
 	size_t m_capacity;
 	size_t m_elementSize;
@@ -71,11 +98,18 @@ public:
 		return (T *)LocklessAllocator::alloc();
 	}
 
+	T * tryAlloc()
+	{
+		return (T *)LocklessAllocator::tryAlloc();
+	}
+
 	void free( T * ptr )
 	{
 		LocklessAllocator::free( ptr );
 	}
 
+	using LocklessAllocator::contains;
+
 } ;
 
 
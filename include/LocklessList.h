@@ -25,7 +25,7 @@
 #ifndef LOCKLESS_LIST_H
 #define LOCKLESS_LIST_H
 
-#include "LocklessAllocator.h"
+#include "LocklessPool.h"
 
 #include <atomic>
 
@@ -39,9 +39,10 @@ public:
 		Element * next;
 	} ;
 
+	//! size is the initial capacity, the list grows beyond it if needed
 	LocklessList( size_t size ) :
 		m_first(nullptr),
-		m_allocator(new LocklessAllocatorT<Element>(size))
+		m_allocator(new LocklessPool<Element>(size))
 	{
 	}
 
@@ -87,7 +88,7 @@ public:
 
 private:
 	std::atomic<Element*> m_first;
-	LocklessAllocatorT<Element> * m_allocator;
+	LocklessPool<Element> * m_allocator;
 
 } ;
 
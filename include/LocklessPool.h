@@ -0,0 +1,118 @@
+/*
+ * LocklessPool.h - typed allocator with lockless alloc and free which grows
+ *                  instead of running out of space
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef LOCKLESS_POOL_H
+#define LOCKLESS_POOL_H
+
+#include "LocklessAllocator.h"
+#include "MemoryManager.h"
+
+#include <atomic>
+
+
+//! A LocklessAllocatorT<T> which doesn't fail when it's full: it adds
+//! another allocator with as many elements as all previous ones, so only
+//! every doubling allocates. Allocators are never removed before the pool
+//! is destroyed. Once MaxAllocators exist, elements come from the
+//! MemoryManager.
+template<typename T>
+class LocklessPool
+{
+public:
+	static const int MaxAllocators = 16;
+
+	LocklessPool( size_t initialSize ) :
+		m_initialSize( initialSize )
+	{
+		m_allocators[0].store( new LocklessAllocatorT<T>( initialSize ) );
+		for( int i = 1; i < MaxAllocators; ++i )
+		{
+			m_allocators[i].store( nullptr );
+		}
+	}
+
+	~LocklessPool()
+	{
+		for( int i = 0; i < MaxAllocators; ++i )
+		{
+			delete m_allocators[i].load();
+		}
+	}
+
+	T * alloc()
+	{
+		for( int i = 0; i < MaxAllocators; ++i )
+		{
+			LocklessAllocatorT<T> * allocator =
+				m_allocators[i].load( std::memory_order_acquire );
+			if( allocator == nullptr )
+			{
+				LocklessAllocatorT<T> * grown = new LocklessAllocatorT<T>(
+						m_initialSize << ( i > 0 ? i - 1 : 0 ) );
+				// another thread may have grown the pool meanwhile
+				if( m_allocators[i].compare_exchange_strong( allocator,
+									grown ) )
+				{
+					allocator = grown;
+				}
+				else
+				{
+					delete grown;
+				}
+			}
+			if( T * ptr = allocator->tryAlloc() )
+			{
+				return ptr;
+			}
+		}
+		return reinterpret_cast<T *>( MemoryManager::alloc( sizeof( T ) ) );
+	}
+
+	void free( T * ptr )
+	{
+		for( int i = 0; i < MaxAllocators; ++i )
+		{
+			LocklessAllocatorT<T> * allocator =
+				m_allocators[i].load( std::memory_order_acquire );
+			if( allocator == nullptr )
+			{
+				break;
+			}
+			if( allocator->contains( ptr ) )
+			{
+				allocator->free( ptr );
+				return;
+			}
+		}
+		MemoryManager::free( ptr );
+	}
+
+
+private:
+	const size_t m_initialSize;
+	std::atomic<LocklessAllocatorT<T> *> m_allocators[MaxAllocators];
+
+} ;
+
+
+#endif
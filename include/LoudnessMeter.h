@@ -0,0 +1,140 @@
+/*
+ * LoudnessMeter.h - peak, RMS, true peak and loudness of an FX channel
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef LOUDNESS_METER_H
+#define LOUDNESS_METER_H
+
+#include <atomic>
+
+#include "lmms_basics.h"
+#include "lmms_export.h"
+#include "TripleBuffer.h"
+
+
+//! Measures what an FX channel puts out, on the worker thread processing
+//! it, in one pass over the sanitized buffer: RMS, true peak from four
+//! times oversampling and the momentary (400 ms) and short-term (3 s)
+//! loudness of ITU-R BS.1770 / EBU R 128, without the gating of integrated
+//! loudness. The sample peaks come from sanitizing. Nothing is measured
+//! unless someone read the levels in the last second or so, so only the
+//! channels with a visible meter or another consumer cost anything.
+class LMMS_EXPORT LoudnessMeter
+{
+public:
+	//! Reported while there's nothing to measure, the absolute gate of
+	//! R 128
+	static constexpr float Silence = -70.0f;
+
+	struct Levels
+	{
+		// linear, the highest since the levels read before
+		float peak[DEFAULT_CHANNELS];
+		float truePeak[DEFAULT_CHANNELS];
+		// linear, over the periods since the levels read before
+		float rms[DEFAULT_CHANNELS];
+		// in LUFS
+		float momentary;
+		float shortTerm;
+	} ;
+
+	LoudnessMeter();
+
+	// worker thread
+
+	//! Whether anyone reads the levels, process() needn't be called if not
+	bool isWanted() const
+	{
+		return m_lease.load( std::memory_order_relaxed ) > 0;
+	}
+
+	//! Measures _frames frames of _buf with _gain applied, silence if _buf
+	//! is NULL. _peakLeft and _peakRight are the sample peaks, with the
+	//! gain applied as well.
+	void process( const sampleFrame * _buf, fpp_t _frames, float _gain,
+				float _peakLeft, float _peakRight,
+				sample_rate_t _sampleRate );
+
+	// reader thread, only one
+
+	//! The latest levels, and keeps the meter measuring for a while
+	const Levels & levels();
+
+	static float toDbfs( float _level );
+
+
+private:
+	struct Biquad
+	{
+		double b0, b1, b2, a1, a2;
+	} ;
+
+	//! Sets up the filters for _sampleRate and forgets the input so far
+	void reset( sample_rate_t _sampleRate );
+
+	//! Loudness of the mean square of the last _blocks blocks
+	float loudness( int _blocks ) const;
+
+	// blocks of 100 ms, of which the last 4 make up the momentary and the
+	// last 30 the short-term loudness
+	static const int MomentaryBlocks = 4;
+	static const int ShortTermBlocks = 30;
+	// taps per phase of the oversampling filter
+	static const int TruePeakTaps = 12;
+	static const int TruePeakPhases = 4;
+	// frames a read keeps the meter measuring, a second and a half at
+	// 44.1 kHz
+	static const int LeaseFrames = 65536;
+
+	std::atomic_int m_lease;
+	bool m_measuring;
+
+	sample_rate_t m_sampleRate;
+	Biquad m_shelf;
+	Biquad m_highPass;
+	// direct form II state of both filters of each channel
+	double m_shelfState[DEFAULT_CHANNELS][2];
+	double m_highPassState[DEFAULT_CHANNELS][2];
+
+	// the interpolation filters of the phases between the samples
+	float m_phases[TruePeakPhases - 1][TruePeakTaps];
+	float m_history[DEFAULT_CHANNELS][TruePeakTaps];
+
+	f_cnt_t m_blockFrames;
+	f_cnt_t m_blockPos;
+	double m_blockSum;
+	// sums of the squares of the K-weighted samples of both channels
+	double m_blocks[ShortTermBlocks];
+	int m_nextBlock;
+	int m_blocksDone;
+
+	// since the reader took the levels published last
+	float m_heldPeak[DEFAULT_CHANNELS];
+	float m_heldTruePeak[DEFAULT_CHANNELS];
+	double m_heldSquares[DEFAULT_CHANNELS];
+	f_cnt_t m_heldFrames;
+
+	TripleBuffer<Levels> m_levels;
+
+} ;
+
+
+#endif
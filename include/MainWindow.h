@@ -28,10 +28,13 @@
 #include <QtCore/QBasicTimer>
 #include <QtCore/QTimer>
 #include <QtCore/QList>
+#include <QtCore/QThreadPool>
 #include <QMainWindow>
 
 #include "ConfigManager.h"
+#include "RefreshScheduler.h"
 #include "SubWindow.h"
+#include "TrackSnapshots.h"
 
 class QAction;
 class QDomElement;
@@ -39,6 +42,7 @@ class QGridLayout;
 class QMdiArea;
 
 class ConfigManager;
+class PerformanceMonitor;
 class PluginView;
 class ToolButton;
 
@@ -57,6 +61,12 @@ public:
 		return m_toolBar;
 	}
 
+	//! Refreshes meters, scopes and the like at display rate
+	RefreshScheduler * refreshScheduler()
+	{
+		return &m_refreshScheduler;
+	}
+
 	int addWidgetToToolBar( QWidget * _w, int _row = -1, int _col = -1 );
 	void addSpacingToToolBar( int _size );
 
@@ -155,6 +165,7 @@ public slots:
 	void toggleFxMixerWin();
 	void togglePianoRollWin();
 	void toggleControllerRack();
+	void togglePerformanceMonitor();
 
 	void updatePlayPauseIcons();
 
@@ -214,13 +225,21 @@ private:
 	QList<PluginView *> m_tools;
 
 	QBasicTimer m_updateTimer;
+	RefreshScheduler m_refreshScheduler;
 	QTimer m_autoSaveTimer;
 	int m_autoSaveInterval;
+	// the tracks unchanged since the last autosave aren't saved again
+	TrackSnapshots m_autoSaveSnapshots;
+	// writes the autosaves, one at a time
+	QThreadPool m_autoSavePool;
 
 	friend class GuiApplication;
 
 	QMenu * m_viewMenu;
 
+	// created when shown first
+	PerformanceMonitor * m_performanceMonitor;
+
 	ToolButton * m_metronomeToggle;
 
 	SessionState m_session;
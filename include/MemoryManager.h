@@ -28,6 +28,7 @@
 #define MEMORY_MANAGER_H
 
 #include <cstddef>
+#include <string>
 #include <vector>
 
 #include "lmms_export.h"
@@ -41,19 +42,58 @@ public:
 		~ThreadGuard();
 	};
 
-	static void * alloc( size_t size );
+	//! What an allocation is used for. Bytes and allocations are counted
+	//! per tag, so it's possible to see what uses up the memory of a
+	//! project.
+	enum Tag
+	{
+		Untagged,
+		SampleBuffers,
+		ValueBuffers,
+		NotePlayHandles,
+		PeriodBuffers,
+		Plugins,
+		NumTags
+	} ;
+
+	struct Usage
+	{
+		size_t bytes;
+		size_t allocations;
+	} ;
+
+	static void * alloc( size_t size, Tag tag = Untagged );
 	static void free( void * ptr );
+
+	//! Give the memory the calling thread keeps cached for its next
+	//! allocations back, e.g. once rendering is idle
+	static void collectThreadCache();
+
+	static const char * tagName( Tag tag );
+	static Usage usage( Tag tag );
+	static size_t totalBytes();
+	//! One line per tag, e.g. for printing it on the command line
+	static std::string report();
 };
 
-template<typename T>
+template<typename T, MemoryManager::Tag TAG = MemoryManager::Untagged>
 struct MmAllocator
 {
 	typedef T value_type;
-	template<class U>  struct rebind { typedef MmAllocator<U> other; };
+	template<class U>  struct rebind { typedef MmAllocator<U, TAG> other; };
+
+	MmAllocator()
+	{
+	}
+
+	template<class U>
+	MmAllocator( const MmAllocator<U, TAG> & )
+	{
+	}
 
 	T* allocate( std::size_t n )
 	{
-		return reinterpret_cast<T*>( MemoryManager::alloc( sizeof(T) * n ) );
+		return reinterpret_cast<T*>( MemoryManager::alloc( sizeof(T) * n, TAG ) );
 	}
 
 	void deallocate( T* p, std::size_t )
@@ -61,19 +101,31 @@ struct MmAllocator
 		MemoryManager::free( p );
 	}
 
-	typedef std::vector<T, MmAllocator<T> > vector;
+	bool operator==( const MmAllocator & ) const
+	{
+		return true;
+	}
+
+	bool operator!=( const MmAllocator & ) const
+	{
+		return false;
+	}
+
+	typedef std::vector<T, MmAllocator<T, TAG> > vector;
 };
 
 
-#define MM_OPERATORS								\
+#define MM_OPERATORS MM_OPERATORS_TAGGED( Untagged )
+
+#define MM_OPERATORS_TAGGED( tag )					\
 public: 											\
 static void * operator new ( size_t size )		\
 {													\
-	return MemoryManager::alloc( size );			\
+	return MemoryManager::alloc( size, MemoryManager::tag );	\
 }													\
 static void * operator new[] ( size_t size )		\
 {													\
-	return MemoryManager::alloc( size );			\
+	return MemoryManager::alloc( size, MemoryManager::tag );	\
 }													\
 static void operator delete ( void * ptr )		\
 {													\
@@ -86,6 +138,7 @@ static void operator delete[] ( void * ptr )	\
 
 // for use in cases where overriding new/delete isn't a possibility
 #define MM_ALLOC( type, count ) reinterpret_cast<type*>( MemoryManager::alloc( sizeof( type ) * count ) )
+#define MM_ALLOC_TAGGED( type, count, tag ) reinterpret_cast<type*>( MemoryManager::alloc( sizeof( type ) * count, MemoryManager::tag ) )
 // and just for symmetry...
 #define MM_FREE( ptr ) MemoryManager::free( ptr )
 
@@ -0,0 +1,80 @@
+/*
+ * Metronome.h - clicks of the metronome
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef METRONOME_H
+#define METRONOME_H
+
+#include <memory>
+#include <vector>
+
+#include <QtCore/QObject>
+
+#include "lmms_basics.h"
+
+class AudioPort;
+
+
+//! Plays the clicks of the metronome. Both clicks are decoded and
+//! resampled to the processing rate up front, outside the audio thread, and
+//! every click is a small play handle streaming one of them on a shared
+//! audio port, starting at the frame its beat falls on.
+class Metronome : public QObject
+{
+	Q_OBJECT
+public:
+	//! interleaved frames
+	typedef std::vector<sample_t> Sound;
+	typedef std::shared_ptr<const Sound> SoundPtr;
+
+	Metronome();
+	virtual ~Metronome();
+
+	//! Starts the click of a beat falling into the period which starts at
+	//! _ticks and _frame frames into that tick, called by the mixer
+	void processPeriod( tick_t _ticks, float _frame, tick_t _ticksPerBar,
+						int _beatsPerBar, float _framesPerTick );
+
+
+private slots:
+	void updateSounds();
+
+
+private:
+	enum Clicks
+	{
+		BarClick,
+		BeatClick,
+		NumClicks
+	} ;
+
+	AudioPort * m_audioPort;
+	SoundPtr m_sounds[NumClicks];
+
+	// beat whose click was started last and the period start it was
+	// started in, so jumping back starts the clicks again
+	qint64 m_lastBeat;
+	double m_lastStart;
+
+} ;
+
+
+#endif
@@ -25,9 +25,18 @@
 #ifndef MIDI_CLIENT_H
 #define MIDI_CLIENT_H
 
+#include <QtCore/QMutex>
 #include <QtCore/QStringList>
 #include <QtCore/QVector>
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "LocklessList.h"
+#include "LocklessRingBuffer.h"
 
 #include "MidiEvent.h"
 #include "MidiEventProcessor.h"
@@ -106,9 +115,94 @@ public:
 	// any other working
 	static MidiClient * openMidiClient();
 
+	//! Queues a note event the input thread received for _port, stamped
+	//! with the time it came in. Returns false if the queue is full and
+	//! the event has to be delivered right away.
+	bool queueInEvent( MidiPort * _port, const MidiEvent & _me,
+						const MidiTime & _time );
+
+	//! Called by the mixer at the start of each period for delivering the
+	//! queued events, each at the frame of the period matching its time
+	void processQueuedInEvents( fpp_t _frames, sample_rate_t _sampleRate );
+
+	//! Queues an event of _port for the output thread, which passes it to
+	//! processOutEvent() when the frame _offset frames into the period
+	//! being rendered gets played. Doesn't block, so worker threads can
+	//! call it. Without the output thread the event is sent right away.
+	void queueOutEvent( const MidiPort * _port, const MidiEvent & _me,
+					const MidiTime & _time, f_cnt_t _offset );
+
+	//! Starts the thread sending the queued output events, called by the
+	//! mixer once the client is set up
+	void startOutputThread();
+	//! Stops it, dropping the events it didn't send yet. Has to be called
+	//! before a derived client gets destroyed.
+	void stopOutputThread();
+
 protected:
+	//! Gives the calling input thread real-time priority if the system
+	//! allows it, for receiving events independently of the CPU load
+	static void applyInputThreadPriority( const char * _threadName );
+
 	QVector<MidiPort *> m_midiPorts;
 
+
+private:
+	struct QueuedInEvent
+	{
+		MidiPort * port;
+		MidiEvent event;
+		MidiTime time;
+		// microseconds of a steady clock
+		qint64 received;
+	} ;
+
+	struct QueuedOutEvent
+	{
+		const MidiPort * port;
+		MidiEvent event;
+		MidiTime time;
+		// microseconds of a steady clock
+		qint64 due;
+	} ;
+
+	static const int InEventQueueSize = 1024;
+	static const int OutEventQueueSize = 1024;
+
+	//! Moves the queued events to m_pendingInEvents, only called from the
+	//! rendering thread or while it waits for a change in the model
+	void takeQueuedInEvents();
+
+	LocklessRingBuffer<QueuedInEvent> m_inEvents;
+	LocklessRingBufferReader<QueuedInEvent> m_inEventReader;
+	// only one thread may write to the queue, backends might receive
+	// from several
+	QMutex m_inEventWriteMutex;
+	std::vector<QueuedInEvent> m_pendingInEvents;
+	qint64 m_lastPeriodStart;
+
+	//! Body of the output thread
+	void sendOutEvents();
+	//! Moves the queued output events to m_pendingOutEvents in the order
+	//! they're due, with m_outEventMutex held
+	void takeQueuedOutEvents();
+
+	LocklessList<QueuedOutEvent> m_outEvents;
+	// when the period being rendered starts being played, in microseconds
+	// of a steady clock, and how long it is
+	std::atomic<qint64> m_outPeriodStart;
+	std::atomic<qint64> m_outPeriodLength;
+	std::atomic<sample_rate_t> m_outSampleRate;
+	std::thread m_outThread;
+	// held by the output thread while it sorts or sends events
+	std::mutex m_outEventMutex;
+	std::vector<QueuedOutEvent> m_pendingOutEvents;
+	// the mixer only holds this one briefly for waking the thread up
+	std::mutex m_outWakeMutex;
+	std::condition_variable m_outWake;
+	bool m_outEventsQueued;
+	bool m_outQuit;
+
 } ;
 
 
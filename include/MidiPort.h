@@ -100,7 +100,12 @@ public:
 	}
 
 	void processInEvent( const MidiEvent& event, const MidiTime& time = MidiTime() );
-	void processOutEvent( const MidiEvent& event, const MidiTime& time = MidiTime() );
+	//! Hands an event that passed processInEvent() to the processor, called
+	//! by the client for the events it queued
+	void deliverInEvent( const MidiEvent& event, const MidiTime& time, f_cnt_t offset );
+	//! Queues the event for being sent once the frame offset frames into
+	//! the period being rendered gets played
+	void processOutEvent( const MidiEvent& event, const MidiTime& time = MidiTime(), f_cnt_t offset = 0 );
 
 
 	void saveSettings( QDomDocument& doc, QDomElement& thisElement ) override;
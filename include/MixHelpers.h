@@ -31,6 +31,34 @@ class ValueBuffer;
 namespace MixHelpers
 {
 
+/*! \brief Vectorized versions of the hottest helpers for one instruction set,
+ * working on interleaved samples (twice the number of frames) */
+struct SimdKernels
+{
+	const char * name;
+	void (*add)( float * dst, const float * src, int samples );
+	void (*addMultiplied)( float * dst, const float * src, float coeffSrc, int samples );
+	void (*addSanitizedMultiplied)( float * dst, const float * src, float coeffSrc, int samples );
+	double (*mixDryWet)( float * wet, const float * dry, float coeffDry, float coeffWet, int samples );
+	bool (*isSilent)( const float * src, int samples );
+	bool (*hasNonFinite)( const float * src, int samples );
+	void (*clamp)( float * buf, int samples );
+	void (*peak)( const float * src, int samples, float * peaks );
+	bool (*sanitizeAndPeak)( float * buf, int samples, float * peaks );
+	void (*sumMultipliedByGains)( float * dst, const sampleFrame * const * srcs, int count, const float * gains, int samples );
+	void (*stereoGains)( float * gains, const float * volume, float volumeValue, const float * panning, float panningValue, int frames );
+	void (*polyphase)( float * dst, const float * src, const float * bank, int taps, int phases, double position, double step, int frames );
+} ;
+
+/*! \brief The kernels for the best instruction set the CPU supports (SSE2,
+ * AVX2 or AVX-512 on x86, NEON on ARM64), NULL if there are none */
+const SimdKernels * detectedSimdKernels();
+
+bool useSimd();
+
+/*! \brief Use the scalar reference code if disabled, e.g. for comparing */
+void setSimdEnabled( bool use );
+
 bool isSilent( const sampleFrame* src, int frames );
 
 bool useNaNHandler();
@@ -39,6 +67,39 @@ void setNaNHandler( bool use );
 
 bool sanitize( sampleFrame * src, int frames );
 
+/*! \brief Peak absolute values of both channels, ignoring nans */
+void peak( const sampleFrame* src, int frames, float & left, float & right );
+
+/*! \brief sanitize() and peak() in one pass over the buffer - the peaks are
+ * zero if the buffer has been cleared */
+bool sanitizeAndPeak( sampleFrame* src, int frames, float & left, float & right );
+
+/*! \brief Overwrite dst with the sum of count buffers, multiplied by the
+ * interleaved per-frame gains unless those are NULL */
+void sumMultipliedByGains( sampleFrame* dst, const sampleFrame* const* srcs, int count, const sampleFrame* gains, int frames );
+
+/*! \brief Left and right gains of volume and panning in percent, each given
+ * as value or, unless NULL, per frame */
+void stereoGains( sampleFrame* gains, const float* volume, float volumeValue, const float* panning, float panningValue, int frames );
+
+/*! \brief Interpolate frames from src with a polyphase filter bank of
+ * phases + 1 rows of taps coefficients, each stored twice for interleaved
+ * samples. Frame f of dst is centered at position + f * step, counted in
+ * frames from the first tap. taps has to be a multiple of 4. */
+void polyphase( sampleFrame* dst, const sampleFrame* src, const float* bank, int taps, int phases, double position, double step, int frames );
+
+/*! \brief Overwrite wet with coeffDry * dry + coeffWet * wet and return the
+ * sum of the squares of the result, which may be summed in a different
+ * order depending on the CPU. Works on both layouts as long as wet and dry
+ * have the same. */
+double mixDryWet( sampleFrame* wet, const sampleFrame* dry, float coeffDry, float coeffWet, int frames );
+
+/*! \brief Split interleaved src into one buffer per channel */
+void deinterleave( float* const* dst, const sampleFrame* src, int frames );
+
+/*! \brief Join one buffer per channel into interleaved dst */
+void interleave( sampleFrame* dst, const float* const* src, int frames );
+
 /*! \brief Add samples from src to dst */
 void add( sampleFrame* dst, const sampleFrame* src, int frames );
 
@@ -27,21 +27,33 @@
 
 #include <QtCore/QMutex>
 #include <QtCore/QThread>
+#include <QtCore/QTimer>
 #include <QtCore/QVector>
 #include <QtCore/QWaitCondition>
 #include <samplerate.h>
 
+#include <atomic>
+#include <functional>
+#include <utility>
+#include <vector>
+
 
 #include "lmms_basics.h"
+#include "AudioTap.h"
+#include "JobBatcher.h"
 #include "LocklessList.h"
+#include "LocklessRingBuffer.h"
 #include "Note.h"
-#include "fifo_buffer.h"
 #include "MixerProfiler.h"
+#include "PeriodBufferRing.h"
+#include "TripleBuffer.h"
 
 
 class AudioDevice;
+struct EngineContext;
 class MidiClient;
 class AudioPort;
+class Metronome;
 
 
 const fpp_t MINIMUM_BUFFER_SIZE = 32;
@@ -235,6 +247,66 @@ public:
 		return m_profiler;
 	}
 
+	//! Published after every period for monitoring
+	struct RenderStats
+	{
+		quint64 period;
+		//! Time rendering took relative to the period length
+		float load;
+		int voices;
+		int effects;
+		//! Jobs processed by the worker threads
+		int jobs;
+		//! Bytes allocated through MemoryManager and their maximum so far
+		size_t memory;
+		size_t memoryHighWater;
+	} ;
+
+	//! Consumers read the stats with a LocklessRingBufferReader of their
+	//! own, the mixer never waits for them - once a reader falls behind
+	//! by RenderStatsBufferSize periods, new stats are dropped until it
+	//! catches up.
+	LocklessRingBuffer<RenderStats> & renderStats()
+	{
+		return m_renderStats;
+	}
+
+	//! What the GUI shows of the engine, as of the end of the last period
+	struct Snapshot
+	{
+		struct Peak
+		{
+			float left;
+			float right;
+		} ;
+
+		quint64 period;
+		int playMode;
+		bool playing;
+		tick_t ticks;
+		int milliseconds;
+		//! Of every FX channel since the snapshot read before, the
+		//! master's with the master gain applied
+		std::vector<Peak> fxPeaks;
+	} ;
+
+	//! The latest snapshot, without synchronizing with rendering - only
+	//! to be called from the GUI thread
+	const Snapshot & snapshot()
+	{
+		return m_snapshot.read();
+	}
+
+	//! The audio sent to the output device, for scopes
+	AudioTapPoint & masterTap()
+	{
+		return m_masterTap;
+	}
+
+	//! Make room for the peaks of _channels FX channels in the snapshots,
+	//! so publishing them never allocates
+	void reserveSnapshotChannels( int _channels );
+
 	int cpuLoad() const
 	{
 		return m_profiler.cpuLoad();
@@ -293,44 +365,133 @@ public:
 		return m_fifoWriter != NULL;
 	}
 
+	//! Periods rendered ahead which the audio device didn't take yet
+	int fifoDepth() const
+	{
+		return hasFifoWriter() ? m_fifo->queued() : 0;
+	}
+
+	int fifoSize() const
+	{
+		return hasFifoWriter() ? m_fifo->size() : 0;
+	}
+
+	//! Called by the capturing device thread, frames that don't fit into
+	//! the ring any more get dropped
 	void pushInputFrames( sampleFrame * _ab, const f_cnt_t _frames );
 
+	//! Frames captured during the last period, for the rendering threads
 	inline const sampleFrame * inputBuffer()
 	{
-		return m_inputBuffer[ m_inputBufferRead ];
+		return m_inputBuffer;
 	}
 
 	inline f_cnt_t inputBufferFrames() const
 	{
-		return m_inputBufferFrames[ m_inputBufferRead ];
+		return m_inputBufferFrames;
 	}
 
+	//! The buffer stays valid until releaseNextBuffer() is called
 	inline const surroundSampleFrame * nextBuffer()
 	{
-		return hasFifoWriter() ? m_fifo->read() : renderNextBuffer();
+		if( !hasFifoWriter() )
+		{
+			return renderNextBuffer();
+		}
+		m_fifo->waitForData();
+		const surroundSampleFrame * b = m_fifo->readBuffer();
+		if( b == NULL )
+		{
+			// end of stream, there's nothing to release
+			m_fifo->commitRead();
+		}
+		return b;
+	}
+
+	inline void releaseNextBuffer()
+	{
+		if( hasFifoWriter() )
+		{
+			m_fifo->commitRead();
+		}
 	}
 
 	void changeQuality( const struct qualitySettings & _qs );
 
+	//! Switch to a buffer of _frames frames, as configured in the setup
+	//! dialog, without setting up anything else anew. Buffers larger than
+	//! DEFAULT_BUFFER_SIZE are periods of that size queued in the fifo,
+	//! so only their number changes. Returns false if the period size
+	//! would change, which takes a restart.
+	bool setBufferSize( fpp_t _frames );
+
 	inline bool isMetronomeActive() const { return m_metronomeActive; }
-	inline void setMetronomeActive(bool value = true) { m_metronomeActive = value; }
+	void setMetronomeActive(bool value = true);
+
+	//! Let the song render tracks without live input one period ahead on
+	//! otherwise idle worker threads, see startAnticipativeJobs()
+	inline bool anticipativeRendering() const { return m_anticipativeRendering; }
+	inline void setAnticipativeRendering( bool _enabled ) { m_anticipativeRendering = _enabled; }
+
+	//! Play handles added by the audio thread while set are meant for the
+	//! next period, i.e. they come from tracks played ahead
+	inline void setAddingAheadPlayHandles( bool _ahead ) { m_addingAheadPlayHandles = _ahead; }
+
+	//! What the mixer may do instead of xrunning when rendering a period
+	//! takes too long - measures are taken in this order one after another
+	//! and undone once there's enough headroom again
+	enum OverloadMeasures
+	{
+		CheapInterpolation = 0x01,	// resample linearly instead of sinc
+		BypassEffects = 0x02,	// skip effects which take long
+		StealNotes = 0x04	// end the oldest notes early
+	} ;
+
+	//! Bitwise-or of the measures that may be taken, measures which aren't
+	//! allowed anymore get undone with the next period
+	inline int overloadPolicy() const { return m_overloadPolicy; }
+	inline void setOverloadPolicy( int _policy ) { m_overloadPolicy = _policy; }
+	//! Bitwise-or of the measures taken at the moment
+	inline int overloadMeasures() const
+	{
+		return m_overloadMeasures.load( std::memory_order_relaxed );
+	}
 
 	//! Block until a change in model can be done (i.e. wait for audio thread)
 	void requestChangeInModel();
 	void doneChangeInModel();
 
+	//! Let the audio thread run _change at the start of the next period and
+	//! wait until it's done. In contrast to requestChangeInModel() the audio
+	//! thread never waits for the calling thread, so prepare everything
+	//! beforehand and keep _change short (e.g. swapping a pointer).
+	void runInAudioThread( const std::function<void()> & _change );
+
+	//! Like runInAudioThread() but without waiting. _reclaim runs in a
+	//! non-realtime thread some time after _change, e.g. to free what
+	//! _change replaced.
+	void postChangeInModel( std::function<void()> _change,
+				std::function<void()> _reclaim = nullptr );
+
 	static bool isAudioDevNameValid(QString name);
 	static bool isMidiDevNameValid(QString name);
 
 
+public slots:
+	//! Give memory which is only needed while playing back to the system:
+	//! the unused period buffers and what the audio threads keep cached.
+	//! Done automatically once the song has been stopped for a while, see
+	//! mixer/idletrim (in seconds, 0 disables it).
+	void trimMemory();
+
+
 signals:
 	void qualitySettingsChanged();
 	void sampleRateChanged();
-	void nextAudioBuffer( const surroundSampleFrame * buffer );
 
 
 private:
-	typedef fifoBuffer<surroundSampleFrame *> fifo;
+	typedef PeriodBufferRing fifo;
 
 	class fifoWriter : public QThread
 	{
@@ -347,7 +508,7 @@ private:
 
 		void run() override;
 
-		void write( surroundSampleFrame * buffer );
+		void write( const surroundSampleFrame * buffer );
 
 	} ;
 
@@ -358,6 +519,10 @@ private:
 	void startProcessing( bool _needs_fifo = true );
 	void stopProcessing();
 
+	//! Set up priority and CPU affinity of the worker threads for live
+	//! playback or for offline rendering
+	void setupRenderThreads( bool _offline );
+
 
 	AudioDevice * tryAudioDevices();
 	MidiClient * tryMidiClients();
@@ -365,8 +530,72 @@ private:
 
 	const surroundSampleFrame * renderNextBuffer();
 
+	//! Process play handles, audio ports and FX channels as one dependency
+	//! graph instead of three separate stages
+	void runRenderGraph();
+	void removeFinishedPlayHandles();
+
+	//! Whether a play handle has been or will be rendered in a period ahead
+	static bool renderedAhead( PlayHandle * _handle );
+	//! Calls _queue with each of _jobs, the ones processing took longest
+	//! for lately where the job scheduler starts first, so a hosted rack
+	//! of plugins or the like doesn't end up running on its own at the end
+	//! of the period
+	template<class T, class F>
+	void forEachJobHeaviestFirst( const T & _jobs, F _queue );
+	//! What processing _job and what waits for nothing but it took lately
+	float criticalPath( ThreadableJob * _job ) const;
+	float criticalPath( PlayHandle * _handle ) const;
+	//! Microseconds per period jobs taking less are batched for, see
+	//! JobBatcher
+	float jobBatchBudget() const;
+	//! Start rendering anticipative audio ports for the next period
+	//! without waiting for them
+	void startAnticipativeJobs();
+	//! Wait for what startAnticipativeJobs() started - has to be done
+	//! before anything can touch the play handles or audio ports again
+	void finishAnticipativeJobs();
+
+	//! Take or undo overload measures depending on how long the last
+	//! periods took to render
+	void updateOverloadMeasures();
+	//! Push the stats of the period just rendered to m_renderStats
+	void publishRenderStats();
+	//! Hand the state of the period just rendered over to the GUI
+	void publishSnapshot();
+	//! End the oldest notes so no more than m_noteLimit are playing
+	void stealNotes();
+
+	// play handle registry - all of these have to be called from the mixer
+	// thread or between requestChangeInModel() and doneChangeInModel()
+	void registerPlayHandle( PlayHandle * handle );
+	//! Free the slot of the handle and delete it, the caller has to take
+	//! care of removing it from m_playHandles
+	void releasePlayHandle( PlayHandle * handle );
+	//! Release all handles _remove returns true for and close the gaps
+	//! in m_playHandles, keeping the order of the remaining ones
+	template<typename F>
+	void removePlayHandlesIf( F _remove );
+
 	void clearInternal();
 
+	// lock-free queue of changes the audio thread applies at the start of
+	// every period, see runInAudioThread() and postChangeInModel()
+	struct ChangeCommand
+	{
+		std::function<void()> change;
+		std::function<void()> reclaim;
+		// set by the audio thread if somebody waits for the command
+		std::atomic_bool applied;
+		bool waiting;
+		ChangeCommand * next;
+	} ;
+	void queueChange( ChangeCommand * _cmd );
+	//! Called by the audio thread
+	void applyQueuedChanges();
+	//! Called by non-realtime threads
+	void reclaimAppliedChanges();
+
 	//! Called by the audio thread to give control to other threads,
 	//! such that they can do changes in the model (like e.g. removing effects)
 	void runChangesInModel();
@@ -377,11 +606,13 @@ private:
 
 	fpp_t m_framesPerPeriod;
 
-	sampleFrame * m_inputBuffer[2];
-	f_cnt_t m_inputBufferFrames[2];
-	f_cnt_t m_inputBufferSize[2];
-	int m_inputBufferRead;
-	int m_inputBufferWrite;
+	// captured frames, written by the device without locking and taken
+	// out once per period into m_inputBuffer
+	static const f_cnt_t InputBufferSize = DEFAULT_BUFFER_SIZE * 100;
+	LocklessRingBuffer<sampleFrame> m_inputRing;
+	LocklessRingBufferReader<sampleFrame> m_inputReader;
+	sampleFrame * m_inputBuffer;
+	f_cnt_t m_inputBufferFrames;
 
 	surroundSampleFrame * m_readBuf;
 	surroundSampleFrame * m_writeBuf;
@@ -394,12 +625,48 @@ private:
 	// worker thread stuff
 	QVector<MixerWorkerThread *> m_workers;
 	int m_numWorkers;
+	// the engine objects of this mixer, made current while rendering
+	EngineContext * m_context;
+	// whether this mixer renders with the worker threads, see
+	// MixerWorkerThread::acquireWorkers()
+	bool m_holdsWorkers;
+	bool m_renderGraph;
+	bool m_anticipativeRendering;
+	bool m_anticipativeJobsRunning;
+	bool m_addingAheadPlayHandles;
+	int m_overloadPolicy;
+	std::atomic_int m_overloadMeasures;
+	// periods the load has been above (> 0) or below (< 0) the thresholds
+	int m_overloadPeriods;
+	int m_noteLimit;
+	bool m_realtimeThreads;
+	bool m_pinThreads;
 
 	// playhandle stuff
 	PlayHandleList m_playHandles;
+	// jobs of a stage by criticalPath(), see forEachJobHeaviestFirst()
+	std::vector<std::pair<float, ThreadableJob *> > m_jobOrder;
+	JobBatcher m_jobBatcher;
 	// place where new playhandles are added temporarily
 	LocklessList<PlayHandle *> m_newPlayHandles;
-	ConstPlayHandleList m_playHandlesToRemove;
+
+	// Every handle in m_playHandles owns a slot which stores its position
+	// there so it can be found in O(1). Removal requests refer to handles
+	// by slot and generation rather than by pointer - the handle may have
+	// been deleted or (as NotePlayHandles are pooled) reused in between.
+	struct PlayHandleSlot
+	{
+		int index;	// position in m_playHandles or next free slot
+		unsigned int generation;	// incremented whenever freed
+	} ;
+	struct PlayHandleKey
+	{
+		int slot;
+		unsigned int generation;
+	} ;
+	QVector<PlayHandleSlot> m_playHandleSlots;
+	int m_freePlayHandleSlot;
+	QVector<PlayHandleKey> m_playHandlesToRemove;
 
 
 	struct qualitySettings m_qualitySettings;
@@ -409,6 +676,10 @@ private:
 
 	// audio device stuff
 	void doSetAudioDevice( AudioDevice *_dev );
+	//! Emit sampleRateChanged() if the processing rate isn't the one
+	//! emitted last, everything rate dependent is set up anew on it
+	void announceSampleRate();
+	sample_rate_t m_announcedSampleRate;
 	AudioDevice * m_audioDev;
 	AudioDevice * m_oldAudioDev;
 	QString m_audioDevName;
@@ -424,7 +695,22 @@ private:
 
 	MixerProfiler m_profiler;
 
+	static const int RenderStatsBufferSize = 1024;
+	LocklessRingBuffer<RenderStats> m_renderStats;
+	quint64 m_periodsRendered;
+	size_t m_memoryHighWater;
+
+	static const int SnapshotChannels = 64;
+	TripleBuffer<Snapshot> m_snapshot;
+	// the peaks since the GUI read the last snapshot
+	std::vector<Snapshot::Peak> m_heldPeaks;
+	AudioTapPoint m_masterTap;
+	// started whenever the song stops
+	QTimer m_idleTrimTimer;
+
 	bool m_metronomeActive;
+	// created once the metronome is turned on first
+	Metronome * m_metronome;
 
 	bool m_clearSignal;
 
@@ -438,6 +724,12 @@ private:
 
 	bool m_waitingForWrite;
 
+	std::atomic<ChangeCommand *> m_queuedChanges;
+	std::atomic<ChangeCommand *> m_appliedChanges;
+	// set while no audio thread applies queued changes
+	std::atomic_bool m_audioThreadStopped;
+	QMutex m_changeQueueMutex;
+
 	friend class LmmsCore;
 	friend class MixerWorkerThread;
 	friend class ProjectRenderer;
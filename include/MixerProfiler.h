@@ -27,35 +27,137 @@
 
 #include <QFile>
 
+#include <atomic>
+
 #include "lmms_basics.h"
+#include "CpuUsage.h"
 #include "MicroTimer.h"
+#include "lmms_export.h"
 
-class MixerProfiler
+class LMMS_EXPORT MixerProfiler
 {
 public:
+	//! Parts of Mixer::renderNextBuffer() timed separately
+	enum Stage
+	{
+		//! metronome, input buffers, removing play handles etc.
+		Cleanup,
+		SongProcessing,
+		//! with the render graph this covers stages 2 and 3 as well
+		PlayHandles,
+		AudioPorts,
+		MasterMix,
+		//! runChangesInModel(), LFOs and starting anticipative jobs
+		ModelChanges,
+		NumStages
+	} ;
+
 	MixerProfiler();
 	~MixerProfiler();
 
 	void startPeriod()
 	{
 		m_periodTimer.reset();
+		m_stageBegin = 0;
+		for( int & time : m_stageTimes )
+		{
+			time = 0;
+		}
 	}
 
-	void finishPeriod( sample_rate_t sampleRate, fpp_t framesPerPeriod );
+	//! Add the time since the previous stage finished to _stage
+	void finishStage( Stage _stage )
+	{
+		const int now = m_periodTimer.elapsed();
+		m_stageTimes[_stage] += now - m_stageBegin;
+		m_stageBegin = now;
+	}
+
+	//! _threads is the number of threads processing jobs, including the
+	//! mixer thread itself
+	void finishPeriod( sample_rate_t sampleRate, fpp_t framesPerPeriod,
+								int _threads );
+
+	//! Called by every job with the time it took, for computing the
+	//! time the threads spent waiting for jobs
+	static void addJobTime( int _microseconds )
+	{
+		s_jobTime.fetch_add( _microseconds, std::memory_order_relaxed );
+		s_jobCount.fetch_add( 1, std::memory_order_relaxed );
+	}
 
 	int cpuLoad() const
 	{
 		return m_cpuLoad;
 	}
 
+	//! Estimate of the share of a period rendering the next one takes,
+	//! follows spikes immediately and falls slowly
+	float deadlineLoad() const
+	{
+		return m_deadlineLoad;
+	}
+
+	//! Share of a period rendering the last one took, without smoothing
+	float lastLoad() const
+	{
+		return m_lastLoad;
+	}
+
+	//! Jobs processed while rendering the last period
+	int lastJobCount() const
+	{
+		return m_lastJobCount;
+	}
+
+	//! Share of a period in percent that processing for _microseconds takes,
+	//! e.g. for the entries of a CpuUsage
+	float percentOfPeriod( float _microseconds ) const
+	{
+		return m_periodLength > 0 ?
+				_microseconds * 100.0f / m_periodLength : 0.0f;
+	}
+
+	//! Average and maximum load of _usage for showing it to the user
+	QString describe( const CpuUsage & _usage ) const;
+
+	//! Write a line of comma separated timings per period to outputFile
+	//! and start collecting the summary
 	void setOutputFile( const QString& outputFile );
 
+	//! Average and maximum time of each stage and a histogram of period
+	//! times relative to the period length since setOutputFile()
+	QString summary() const;
+
 
 private:
+	// of period time relative to the period length, in steps of 10%, the
+	// last one for everything beyond 100%
+	static const int HistogramSize = 11;
+
 	MicroTimer m_periodTimer;
 	int m_cpuLoad;
+	float m_deadlineLoad;
+	float m_lastLoad;
+	int m_lastJobCount;
+	// in microseconds
+	float m_periodLength;
 	QFile m_outputFile;
 
+	int m_stageBegin;
+	int m_stageTimes[NumStages];
+
+	// for the summary, only while writing to m_outputFile
+	int m_periods;
+	qint64 m_stageTotals[NumStages];
+	int m_stageMaxima[NumStages];
+	qint64 m_idleTotal;
+	int m_idleMaximum;
+	int m_histogram[HistogramSize];
+
+	static std::atomic_int s_jobTime;
+	static std::atomic_int s_jobCount;
+
 };
 
 #endif
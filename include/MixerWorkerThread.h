@@ -25,11 +25,15 @@
 #ifndef MIXER_WORKER_THREAD_H
 #define MIXER_WORKER_THREAD_H
 
+#include <QtCore/QMutex>
 #include <QtCore/QThread>
+#include <QtCore/QVector>
 
 #include <atomic>
+#include <vector>
+
+#include "ThreadPriority.h"
 
-class QWaitCondition;
 class Mixer;
 class ThreadableJob;
 
@@ -37,6 +41,12 @@ class MixerWorkerThread : public QThread
 {
 	Q_OBJECT
 public:
+	enum class Scheduler
+	{
+		GlobalQueue,	// one job array shared and scanned by all threads
+		WorkStealing	// per-thread deques, idle threads steal from others
+	} ;
+
 	// internal representation of the job queue - all functions are thread-safe
 	class JobQueue
 	{
@@ -59,7 +69,7 @@ public:
 
 		void reset( OperationMode _opMode );
 
-		void addJob( ThreadableJob * _job );
+		bool addJob( ThreadableJob * _job );
 
 		void run();
 		void wait();
@@ -73,20 +83,105 @@ public:
 	} ;
 
 
+	// job queue with one deque per thread - jobs are pushed to and popped
+	// from the back of the own deque while idle threads steal from the front
+	// of the other threads' deques - all functions except addThread() are
+	// thread-safe
+	class WorkStealingQueue
+	{
+	public:
+		WorkStealingQueue();
+		~WorkStealingQueue();
+
+		//! Allocate a deque for a new thread and return its index
+		int addThread();
+
+		void reset( JobQueue::OperationMode _opMode );
+
+		bool addJob( ThreadableJob * _job );
+
+		void run( int _threadIndex );
+		void wait();
+
+	private:
+		class Deque;
+
+		ThreadableJob * steal( int _threadIndex );
+		bool hasJobs() const;
+
+		std::vector<Deque *> m_deques;
+		// keep the counters on separate cache lines as they're modified
+		// by every thread for every job
+		alignas( 64 ) std::atomic_int m_jobsQueued;
+		alignas( 64 ) std::atomic_int m_jobsDone;
+		alignas( 64 ) std::atomic_int m_nextDeque;
+		std::atomic_bool m_running;
+		JobQueue::OperationMode m_opMode;
+
+	} ;
+
+
 	MixerWorkerThread( Mixer* mixer );
 	virtual ~MixerWorkerThread();
 
 	virtual void quit();
 
+	//! Select the job scheduler - must not be called while jobs are processed
+	static void setScheduler( Scheduler _scheduler )
+	{
+		scheduler = _scheduler;
+	}
+
+	static Scheduler currentScheduler()
+	{
+		return scheduler;
+	}
+
+	// threads waiting for jobs (or for jobs to be done) spin for the given
+	// time before going to sleep - spinning reduces wake-up latency while
+	// sleeping saves power
+	static const int DefaultSpinTime = 100; // in microseconds
+
+	static void setSpinTime( int _microseconds )
+	{
+		s_spinTime = _microseconds;
+	}
+
+	static int spinTime()
+	{
+		return s_spinTime;
+	}
+
+	struct WaitStatistics
+	{
+		int workerSleeps;	// worker thread went to sleep waiting for jobs
+		int mixerSleeps;	// mixer thread went to sleep waiting for workers
+	} ;
+
+	//! Return number of times threads went to sleep since last call
+	static WaitStatistics takeWaitStatistics();
+
 	static void resetJobQueue( JobQueue::OperationMode _opMode =
 													JobQueue::Static )
 	{
-		globalJobQueue.reset( _opMode );
+		if( scheduler == Scheduler::WorkStealing )
+		{
+			workStealingQueue.reset( _opMode );
+		}
+		else
+		{
+			globalJobQueue.reset( _opMode );
+		}
 	}
 
-	static void addJob( ThreadableJob * _job )
+	//! Queue a job, returns false if it doesn't require processing
+	static bool addJob( ThreadableJob * _job )
 	{
-		globalJobQueue.addJob( _job );
+		if( scheduler == Scheduler::WorkStealing )
+		{
+			return workStealingQueue.addJob( _job );
+		}
+		return globalJobQueue.addJob( _job );
 	}
 
 	// a convenient helper function allowing to pass a container with pointers
@@ -104,15 +199,80 @@ public:
 
 	static void startAndWaitForJobs();
 
+	//! Mixers of further engine contexts share the worker threads of the
+	//! first one, see Engine::createContext(), one period at a time: each
+	//! holds them from before it queues the first jobs of a period until
+	//! it has waited for the last ones
+	static void acquireWorkers();
+	static void releaseWorkers();
+	//! Whether a mixer is waiting for the workers
+	static bool workersWanted()
+	{
+		return s_workersWanted.load( std::memory_order_relaxed ) > 0;
+	}
+
+	//! Let the worker threads process the queued jobs without waiting for
+	//! them, waitForJobs() has to be called before touching the queue again
+	static void startJobs();
+	//! Help processing the jobs started by startJobs() and wait for them
+	static void waitForJobs();
+
+	//! Number of threads processing jobs, the mixer thread included
+	static int threadCount()
+	{
+		return workerThreads.size();
+	}
+
+	//! Index of the calling thread among threadCount(), -1 for threads
+	//! which didn't process any jobs yet
+	static int threadIndex();
+
+	//! Change priority and CPU affinity of all worker threads. Workers pick
+	//! up the change the next time they're woken up. With a non-empty list
+	//! of cores the mixer thread gets the first core and each worker one of
+	//! the others (cores are shared if there aren't enough).
+	static void setThreadPolicy( ThreadPriority::Policy _policy,
+						const QVector<int> & _cores );
+
+	//! Apply the current thread policy to the calling thread, meant to be
+	//! called from the thread calling Mixer::renderNextBuffer()
+	static void applyMixerThreadPolicy();
+
+	//! Let all worker threads give back their cached memory, see
+	//! MemoryManager::collectThreadCache(). Like policy changes, workers
+	//! do so the next time they're woken up.
+	static void collectThreadCaches()
+	{
+		++s_collectGeneration;
+	}
+
 
 private:
 	void run() override;
 
+	// apply current thread policy, _coreSlot is 0 for the mixer thread
+	static void applyThreadPolicy( int _coreSlot, const char * _threadName );
+
+	static Scheduler scheduler;
 	static JobQueue globalJobQueue;
-	static QWaitCondition * queueReadyWaitCond;
+	static WorkStealingQueue workStealingQueue;
 	static QList<MixerWorkerThread *> workerThreads;
+	static std::atomic_int s_spinTime;
+	static std::atomic_int s_workersWanted;
+
+	static QMutex s_policyMutex;
+	static ThreadPriority::Policy s_policy;
+	static QVector<int> s_policyCores;
+	static std::atomic_int s_policyGeneration;
+	static std::atomic_int s_collectGeneration;
 
 	volatile bool m_quit;
+	// index of this thread's deque in workStealingQueue
+	int m_index;
+	// s_policyGeneration when the thread policy was last applied
+	int m_policyGeneration;
+	// s_collectGeneration when the thread cache was last collected
+	int m_collectGeneration;
 
 } ;
 
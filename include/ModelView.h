@@ -25,7 +25,10 @@
 #ifndef MODEL_VIEW_H
 #define MODEL_VIEW_H
 
+#include <atomic>
+
 #include <QtCore/QPointer>
+#include <QtCore/QVector>
 #include "Model.h"
 
 
@@ -59,6 +62,10 @@ public:
 		return dynamic_cast<const T*>( model() );
 	}
 
+	//! Update the views whose models changed from other threads since the
+	//! last call, done by MainWindow at display rate
+	static void updateChangedViews();
+
 
 protected:
 	// sub-classes can re-implement this to track model-changes
@@ -73,10 +80,20 @@ protected:
 
 	virtual void doConnections();
 
+	//! What a change of the model's data does to the view. Changes from
+	//! other threads than the GUI thread, e.g. automation, only set a flag
+	//! and are applied by updateChangedViews().
+	virtual void modelDataChanged();
+
 
 private:
+	void markDataChanged();
+
 	QWidget* m_widget;
 	QPointer<Model> m_model;
+	std::atomic_bool m_dataChanged;
+
+	static QVector<ModelView *> s_views;
 
 } ;
 
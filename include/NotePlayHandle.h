@@ -26,7 +26,9 @@
 #ifndef NOTE_PLAY_HANDLE_H
 #define NOTE_PLAY_HANDLE_H
 
+#include <atomic>
 #include <memory>
+#include <vector>
 
 #include "BasicFilters.h"
 #include "Note.h"
@@ -34,7 +36,6 @@
 #include "Track.h"
 #include "MemoryManager.h"
 
-class QReadWriteLock;
 class InstrumentTrack;
 class NotePlayHandle;
 
@@ -104,6 +105,14 @@ public:
 		return m_unpitchedFrequency;
 	}
 
+	/*! Frequency at the end of the period while the note detuning moves,
+		frequency() otherwise - instruments gliding from frequency() to it
+		over the period follow the detuning curve sample accurately */
+	float endFrequency() const
+	{
+		return m_endFrequency;
+	}
+
 	/*! Renders one chunk using the attached instrument into the buffer */
 	void play( sampleFrame* buffer ) override;
 
@@ -116,6 +125,23 @@ public:
 	/*! Returns number of frames left for playback */
 	f_cnt_t framesLeft() const;
 
+	/*! Returns whether play() left rendering this period's audio to the
+	    instrument's Instrument::renderVoices() */
+	bool isRenderPending() const
+	{
+		return m_renderPending;
+	}
+
+	/*! Returns the buffer the pending period has to be rendered into */
+	sampleFrame* pendingBuffer() const
+	{
+		return m_pendingBuffer;
+	}
+
+	/*! Completes a period left pending by play() once the instrument has
+	    rendered it */
+	void finishPendingRender();
+
 	/*! Returns how many frames have to be rendered in current period */
 	fpp_t framesLeftForCurrentPeriod() const;
 
@@ -125,6 +151,26 @@ public:
 	/*! Releases the note (and plays release frames */
 	void noteOff( const f_cnt_t offset = 0 );
 
+	/*! Releases the note and fades it out within the next period regardless
+	    of its release time, used by the mixer when overloaded */
+	void steal();
+
+	/*! Have the note released offset frames into the period of its next
+	    play(), for threads other than the one playing it, e.g. MIDI input
+	    or the parent of a chord note, which don't have to lock it then */
+	void requestNoteOff( const f_cnt_t offset = 0 );
+
+	/*! Have the note stolen with its next play(), see requestNoteOff() */
+	void requestSteal();
+
+	/*! Returns whether the note is going to be released or stolen with its
+	    next play() */
+	bool isReleaseRequested() const
+	{
+		return m_releaseRequest.load( std::memory_order_relaxed ) >= 0 ||
+			m_stealRequest.load( std::memory_order_relaxed );
+	}
+
 	/*! Returns number of frames to be played until the note is going to be released */
 	f_cnt_t framesBeforeRelease() const
 	{
@@ -212,7 +258,7 @@ public:
 		return m_muted;
 	}
 
-	/*! Mutes playback of note */
+	/*! Mutes playback of note from its next play() on */
 	void mute();
 
 	/*! Returns index of NotePlayHandle in vector of note-play-handles
@@ -234,17 +280,21 @@ public:
 		return m_bbTrack && m_bbTrack->isMuted();
 	}
 
+	/*! Returns attached BB track, NULL for notes played live */
+	Track * bbTrack() const
+	{
+		return m_bbTrack;
+	}
+
 	/*! Sets attached BB track */
 	void setBBTrack( Track* t )
 	{
 		m_bbTrack = t;
 	}
 
-	/*! Process note detuning automation */
-	void processMidiTime( const MidiTime& time );
-
-	/*! Updates total length (m_frames) depending on a new tempo */
-	void resize( const bpm_t newTempo );
+	/*! Called for each tick of the song while the note is played, _offset
+		frames into the period, to follow the detuning automation from */
+	void processMidiTime( const MidiTime& time, f_cnt_t _offset );
 
 	/*! Set song-global offset (relative to containing pattern) in order to properly perform the note detuning */
 	void setSongGlobalParentOffset( const MidiTime& offset )
@@ -263,33 +313,80 @@ public:
 		m_frequencyNeedsUpdate = true;
 	}
 
+	friend class InstrumentTrack;
+
 private:
+	//! The detuning of a note and its sub-notes. An automated one is
+	//! rendered once when the note starts, one value per tick, so following
+	//! it costs the handles an interpolation per period. The time in the
+	//! note is set by the song thread only, the handles rendered in
+	//! parallel just read it.
 	class BaseDetuning
 	{
 		MM_OPERATORS
 	public:
-		BaseDetuning( DetuningHelper* detuning );
+		BaseDetuning( DetuningHelper* detuning, tick_t length );
 
-		void setValue( float val )
+		float value() const
 		{
-			m_value = val;
+			return m_value;
 		}
 
-		float value() const
+		bool isAutomated() const
 		{
-			return m_value;
+			return !m_curve.empty();
+		}
+
+		//! Called by the song thread, the period being rendered starts
+		//! _ticks ticks into the note
+		void sync( float _ticks, long _period )
+		{
+			m_syncTicks = _ticks;
+			m_syncPeriod = _period;
 		}
 
+		bool isSynced( long _period ) const
+		{
+			return m_syncPeriod == _period;
+		}
+
+		//! Sets _ticks to the ticks into the note at the start of
+		//! _period, a period having _ticksPerPeriod ticks, returns false
+		//! if the song didn't get to the note
+		bool ticksAt( long _period, float _ticksPerPeriod,
+							float & _ticks ) const
+		{
+			_ticks = m_syncTicks + ( _period - m_syncPeriod ) *
+							_ticksPerPeriod;
+			return m_syncPeriod >= 0;
+		}
+
+		//! The detuning _ticks into the note
+		float valueAt( float _ticks ) const;
+
 
 	private:
 		float m_value;
+		std::vector<float> m_curve;
+		float m_syncTicks;
+		long m_syncPeriod;
 
 	} ;
 
 	void updateFrequency();
-
-	InstrumentTrack* m_instrumentTrack;		// needed for calling
-											// InstrumentTrack::playNote
+	//! updateFrequency() without the sub-notes
+	void updateOwnFrequency();
+	//! Follows the detuning curve to the current period
+	void updateDetuning();
+	//! Converts the length in ticks to m_frames at the tempo of the period
+	void updateFrames();
+	void checkSilence( const sampleFrame* buffer, fpp_t frames );
+	void finishPeriod( sampleFrame* buffer, f_cnt_t framesThisPeriod, bool rendered );
+
+	// The state below up to m_frequencyNeedsUpdate is read and written for
+	// every note in every period, e.g. by isFinished(), and therefore kept
+	// together so it shares a cache line. Anything only needed when
+	// starting, stopping or retuning a note follows it.
 	f_cnt_t m_frames;						// total frames to play
 	f_cnt_t m_totalFramesPlayed;			// total frame-counter - used for
 											// figuring out whether a whole note
@@ -300,38 +397,61 @@ private:
 											// played after release
 	f_cnt_t m_releaseFramesDone;			// number of frames done after
 											// release of note
-	NotePlayHandleList m_subNotes;			// used for chords and arpeggios
-	volatile bool m_released;				// indicates whether note is released
+	float m_frequency;
+	float m_unpitchedFrequency;
+	std::atomic_bool m_released;			// indicates whether note is released
 	bool m_releaseStarted;
-	bool m_hasMidiNote;
 	bool m_hasParent;						// indicates whether note has parent
+	std::atomic_bool m_muted;				// indicates whether note is muted
+	bool m_stolen;							// indicates whether note is faded out
+	// offset of a release requested by another thread, -1 for none, and
+	// whether it wants the note stolen, taken by the next play()
+	std::atomic<f_cnt_t> m_releaseRequest;
+	std::atomic_bool m_stealRequest;
+	bool m_frequencyNeedsUpdate;				// used to update pitch
+	int m_silentPeriods;					// number of periods rendered
+											// below the silence threshold
+	bool m_renderPending;					// rendered by Instrument::renderVoices()
+	sampleFrame* m_pendingBuffer;
+	f_cnt_t m_pendingFrames;
+
+	InstrumentTrack* m_instrumentTrack;		// needed for calling
+											// InstrumentTrack::playNote
+	NotePlayHandleList m_subNotes;			// used for chords and arpeggios
+	bool m_hasMidiNote;
 	NotePlayHandle * m_parent;			// parent note
 	bool m_hadChildren;
-	bool m_muted;							// indicates whether note is muted
 	Track* m_bbTrack;						// related BB track
 
-	// tempo reaction
-	bpm_t m_origTempo;						// original tempo
-	f_cnt_t m_origFrames;					// original m_frames
+	// tempo reaction, the length is kept in ticks and only converted to
+	// m_frames again once the note plays at another tempo
+	double m_ticks;							// length in ticks
+	float m_framesPerTick;					// tempo m_frames is valid for
 
 	int m_origBaseNote;
 
-	float m_frequency;
-	float m_unpitchedFrequency;
-
 	BaseDetuning* m_baseDetuning;
 	MidiTime m_songGlobalParentOffset;
+	// where this handle is on the curve of m_baseDetuning, sub-notes follow
+	// it on their own
+	float m_detuning;
+	float m_endDetuning;
+	float m_endFrequency;
 
 	int m_midiChannel;
 	Origin m_origin;
-
-	bool m_frequencyNeedsUpdate;				// used to update pitch
 } ;
 
 
 const int INITIAL_NPH_CACHE = 256;
-const int NPH_CACHE_INCREMENT = 16;
+const int NPH_CACHE_INCREMENT = 64;
 
+
+//! Pool of note play handles in chunks of NPH_CACHE_INCREMENT handles which
+//! are never freed. Free handles are kept on a lock-free stack, and each
+//! thread keeps a few handles it released for acquiring them again. When
+//! the pool runs dry it grows by another chunk, without blocking other
+//! threads taking handles meanwhile.
 class NotePlayHandleManager
 {
 	MM_OPERATORS
@@ -345,13 +465,12 @@ public:
 					int midiEventChannel = -1,
 					NotePlayHandle::Origin origin = NotePlayHandle::OriginPattern );
 	static void release( NotePlayHandle * nph );
-	static void extend( int i );
 
-private:
-	static NotePlayHandle ** s_available;
-	static QReadWriteLock s_mutex;
-	static std::atomic_int s_availableIndex;
-	static int s_size;
+	//! Grows the pool to at least count handles, e.g. before playing a
+	//! project, so it doesn't have to grow while rendering
+	static void reserve( int count );
+	static int capacity();
+
 };
 
 
@@ -0,0 +1,159 @@
+/*
+ * OneShotCache.h - rendered sounds of deterministic one-shot instruments
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef ONE_SHOT_CACHE_H
+#define ONE_SHOT_CACHE_H
+
+#include <memory>
+#include <vector>
+
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QThreadPool>
+
+#include "lmms_basics.h"
+#include "lmms_export.h"
+#include "MemoryManager.h"
+
+
+//! Instruments whose notes always sound the same for the same parameters
+//! (kicker, sfxr, ...) keep the raw sound of a note in here, so later notes
+//! stream it instead of synthesising it again. Sounds are looked up by a
+//! hash of everything they are rendered from, so edited parameters simply
+//! miss the cache. The sound of a note which ends before its sound does is
+//! completed on a background thread. Per-note processing like release
+//! fades, volume and velocity is done on the streamed sound as before.
+class LMMS_EXPORT OneShotCache
+{
+public:
+	//! default budget of cached frames, about 24 s at 44.1 kHz
+	static const f_cnt_t DefaultMaxFrames = 1 << 20;
+
+	//! Renders the sound of one note on its own, so the cache can complete
+	//! it once the note is gone
+	class Renderer
+	{
+	public:
+		virtual ~Renderer() = default;
+
+		//! Renders the next _frames frames into _buf, returns false once
+		//! the sound is over
+		virtual bool render( sampleFrame * _buf, fpp_t _frames ) = 0;
+	} ;
+
+	//! Hash of the parameters a sound is rendered from
+	class Key
+	{
+	public:
+		Key() :
+			m_hash( 14695981039346656037ULL )
+		{
+		}
+
+		Key & operator<<( float _value );
+		Key & operator<<( int _value );
+
+		quint64 value() const
+		{
+			return m_hash;
+		}
+
+	private:
+		void add( const void * _data, size_t _size );
+
+		quint64 m_hash;
+	} ;
+
+	typedef std::vector<sample_t> Sound;
+	typedef std::shared_ptr<const Sound> SoundPtr;
+
+	//! Plays the sound of one note, either streams it from the cache or
+	//! renders it and adds it to the cache
+	class LMMS_EXPORT Voice
+	{
+		MM_OPERATORS
+	public:
+		//! Takes ownership of _renderer, which is only used if there's
+		//! no sound for _key yet. Without _cache the sound is rendered
+		//! only, e.g. as it's random.
+		Voice( OneShotCache * _cache, const Key & _key,
+						Renderer * _renderer );
+		~Voice();
+
+		//! Next _frames frames of the sound, silence once it's over
+		void render( sampleFrame * _buf, fpp_t _frames );
+
+		bool isPlaying() const;
+
+		bool isCached() const
+		{
+			return m_sound != nullptr;
+		}
+
+	private:
+		OneShotCache * m_cache;
+		quint64 m_key;
+
+		// streaming
+		SoundPtr m_sound;
+		f_cnt_t m_position;
+
+		// rendering, m_recording is dropped if the sound exceeds the
+		// budget of the cache
+		Renderer * m_renderer;
+		std::unique_ptr<Sound> m_recording;
+		bool m_rendering;
+
+	} ;
+
+	OneShotCache( f_cnt_t _maxFrames = DefaultMaxFrames );
+	//! Waits for sounds being completed in the background
+	~OneShotCache();
+
+	void clear();
+
+	//! Number of cached sounds, e.g. for tests
+	int size() const;
+
+
+private:
+	SoundPtr find( quint64 _key ) const;
+	void insert( quint64 _key, Sound * _sound );
+	void complete( quint64 _key, Renderer * _renderer, Sound * _recording );
+
+	const f_cnt_t m_maxFrames;
+
+	mutable QMutex m_mutex;
+	QHash<quint64, SoundPtr> m_sounds;
+	// keys by insertion, the oldest sounds are dropped first
+	QList<quint64> m_order;
+	f_cnt_t m_frames;
+
+	QThreadPool m_completer;
+
+	friend class OneShotCompleter;
+
+} ;
+
+
+#endif
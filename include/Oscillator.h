@@ -85,6 +85,13 @@ public:
 		m_userWave = _wave;
 	}
 
+	//! Render triangle, saw, square and moog saw from the band-limited
+	//! wavetables instead of the naive, aliasing waveforms
+	inline void setUseWaveTable( bool _use )
+	{
+		m_useWaveTable = _use;
+	}
+
 	void update( sampleFrame * _ab, const fpp_t _frames,
 							const ch_cnt_t _chnl );
 
@@ -165,6 +172,9 @@ private:
 	float m_phaseOffset;
 	float m_phase;
 	const SampleBuffer * m_userWave;
+	bool m_useWaveTable;
+	// mipmap level of the band-limited waves for the current period
+	int m_waveTable;
 
 
 	void updateNoSub( sampleFrame * _ab, const fpp_t _frames,
@@ -207,6 +217,7 @@ private:
 	inline sample_t getSample( const float _sample );
 
 	inline void recalcPhase();
+	inline void selectWaveTable( float _osc_coeff );
 
 } ;
 
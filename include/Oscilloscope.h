@@ -31,6 +31,7 @@
 
 #include "lmms_basics.h"
 
+class AudioTap;
 
 class Oscilloscope : public QWidget
 {
@@ -60,16 +61,17 @@ protected:
 	void mousePressEvent( QMouseEvent * _me ) override;
 
 
-protected slots:
-	void updateAudioBuffer( const surroundSampleFrame * buffer );
-
 private:
+	//! Takes the latest audio of the master output from m_tap
+	void updateAudioBuffer();
 	QColor const & determineLineColor(float level) const;
 
 private:
 	QPixmap m_background;
 	QPointF * m_points;
 
+	AudioTap * m_tap;
+
 	sampleFrame * m_buffer;
 	bool m_active;
 
@@ -0,0 +1,128 @@
+/*
+ * Oversampler.h - runs a nonlinear stage of an effect or instrument at a
+ *                 multiple of the processing rate
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef OVERSAMPLER_H
+#define OVERSAMPLER_H
+
+#include <algorithm>
+#include <vector>
+
+#include "Decimator.h"
+#include "lmms_basics.h"
+#include "lmms_export.h"
+#include "MemoryManager.h"
+
+
+//! Oversampling for a single effect or instrument instead of the whole
+//! project, for distortion and the like which would otherwise alias. The
+//! audio is interpolated to 2, 4 or 8 times the rate through a cascade of
+//! half-band FIR filters, handed to the nonlinear stage and brought back to
+//! the processing rate by a Decimator. Like there, each interpolation stage
+//! only computes the new frames between the existing ones, in loops over
+//! contiguous samples the compiler vectorises, and the stage at the lowest
+//! rate gets the most taps.
+class LMMS_EXPORT Oversampler
+{
+	MM_OPERATORS
+public:
+	Oversampler( int factor = 1,
+			Decimator::Qualities quality = Decimator::Balanced );
+	~Oversampler();
+
+	//! Sets a factor of 1, 2, 4 or 8 and clears the filters, 1 passes the
+	//! audio on as it is
+	void setup( int factor, Decimator::Qualities quality );
+
+	int factor() const
+	{
+		return m_factor;
+	}
+
+	//! Delay both directions add, in frames at the processing rate
+	float latency() const;
+
+	void reset();
+
+	//! Calls _stage( buffer, frames ) with _frames frames of _buf at
+	//! factor() times the rate, in pieces, and writes what it made of
+	//! them back to _buf. Per frame values of models have to be taken
+	//! every factor() frames.
+	template<class F>
+	void process( sampleFrame * _buf, fpp_t _frames, F _stage )
+	{
+		if( m_factor == 1 )
+		{
+			_stage( _buf, _frames );
+			return;
+		}
+		while( _frames > 0 )
+		{
+			const fpp_t frames = std::min<fpp_t>( _frames, BlockSize );
+			upsample( _buf, frames );
+			_stage( m_buffer, frames * m_factor );
+			m_decimator.process( m_buffer, frames * m_factor, _buf );
+			_buf += frames;
+			_frames -= frames;
+		}
+	}
+
+
+private:
+	// frames at the processing rate handled at once
+	static const int BlockSize = 256;
+	static const int MaxFactor = 8;
+
+	struct Stage
+	{
+		// taps computing the frames between the input frames, the ones
+		// on the input frames are the input itself
+		std::vector<float> taps;
+		// the last taps - 1 input frames before the ones of the block,
+		// followed by the block
+		std::vector<float> history[DEFAULT_CHANNELS];
+		// what the taps computed for the block
+		std::vector<float> between;
+
+		void design( int pairs, double beta, int blockSize );
+		void clear();
+		// writes 2 * _frames samples of one channel from _in to _out
+		void process( int _channel, const float * _in, int _frames,
+								float * _out );
+	} ;
+
+	//! Interpolates _frames frames of _in into m_buffer
+	void upsample( const sampleFrame * _in, fpp_t _frames );
+
+	int m_factor;
+	std::vector<Stage> m_stages;
+	Decimator m_decimator;
+
+	// one channel of the stages, they go back and forth between them
+	std::vector<float> m_scratch[2];
+	// BlockSize * MaxFactor frames at the high rate
+	sampleFrame * m_buffer;
+
+} ;
+
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ * PartitionedConvolver.h - zero-latency convolution with long impulse
+ *                          responses
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef PARTITIONED_CONVOLVER_H
+#define PARTITIONED_CONVOLVER_H
+
+#include <vector>
+
+#include "lmms_basics.h"
+#include "lmms_export.h"
+#include "MemoryManager.h"
+
+
+//! Convolves one channel with an impulse response of any length without
+//! adding latency. The first HeadSize taps are applied directly, the rest
+//! in stages of FFT partitions growing up to MaxPartition. The first stage
+//! is computed as its blocks complete, the later ones have a block of time
+//! and run as jobs of the mixer worker threads, alongside the rest of the
+//! period.
+class LMMS_EXPORT PartitionedConvolver
+{
+	MM_OPERATORS
+public:
+	//! taps applied in the time domain, also the partition of the first
+	//! FFT stage
+	static const int HeadSize = 64;
+	static const int MaxPartition = 8192;
+
+	//! Transforms the impulse response, so don't call it from the audio
+	//! thread. Without _useWorkers all stages are computed by process().
+	PartitionedConvolver( const float * _ir, f_cnt_t _length,
+						bool _useWorkers = true );
+	~PartitionedConvolver();
+
+	//! Replace _frames samples of _buf by the convolution of the input so
+	//! far with the impulse response
+	void process( float * _buf, fpp_t _frames );
+
+	//! Forget the input so far
+	void reset();
+
+	f_cnt_t length() const
+	{
+		return m_length;
+	}
+
+
+private:
+	class Stage;
+
+	const f_cnt_t m_length;
+	const bool m_useWorkers;
+
+	float m_head[HeadSize];
+	// the last HeadSize - 1 input samples followed by the ones of the
+	// chunk being processed
+	float m_history[2 * HeadSize - 1];
+	std::vector<Stage *> m_stages;
+	// within the largest partition
+	f_cnt_t m_position;
+
+} ;
+
+
+#endif
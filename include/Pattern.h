@@ -32,6 +32,8 @@
 #include <QPixmap>
 #include <QStaticText>
 
+#include <memory>
+#include <vector>
 
 #include "Note.h"
 #include "Track.h"
@@ -56,6 +58,9 @@ public:
 		MelodyPattern
 	} ;
 
+	//! Copies of the notes, which are never changed once published
+	typedef std::vector<Note> NoteSnapshot;
+
 	Pattern( InstrumentTrack* instrumentTrack );
 	Pattern( const Pattern& other );
 	virtual ~Pattern();
@@ -66,6 +71,10 @@ public:
 
 	// note management
 	Note * addNote( const Note & _new_note, const bool _quant_pos = true );
+	//! Like addNote() for all of _new_notes, but sorting them in and
+	//! updating the pattern only once
+	void addNotes( const QVector<Note> & _new_notes,
+						const bool _quant_pos = true );
 
 	void removeNote( Note * _note_to_del );
 
@@ -79,6 +88,15 @@ public:
 		return m_notes;
 	}
 
+	//! The notes as of the last edit for the audio thread, which reads
+	//! them without taking the lock of the track. Edits publish a new
+	//! snapshot at the start of the next period, so it stays valid
+	//! during a period.
+	inline const NoteSnapshot & playedNotes() const
+	{
+		return *m_snapshot->notes;
+	}
+
 	Note * addStepNote( int step );
 	void setStep( int step, bool enabled );
 
@@ -120,6 +138,8 @@ protected:
 
 
 protected slots:
+	//! Let the audio thread play the notes as they are now
+	void publishNotes();
 	void addSteps();
 	void cloneSteps();
 	void removeSteps();
@@ -133,6 +153,8 @@ private:
 	void setType( PatternTypes _new_pattern_type );
 	void checkType();
 
+	std::shared_ptr<const NoteSnapshot> takeSnapshot() const;
+
 	void resizeToFirstTrack();
 
 	InstrumentTrack * m_instrumentTrack;
@@ -143,6 +165,18 @@ private:
 	NoteVector m_notes;
 	int m_steps;
 
+	// what playedNotes() returns, only replaced by the audio thread
+	struct SnapshotSlot
+	{
+		SnapshotSlot() :
+			notes( std::make_shared<const NoteSnapshot>() )
+		{
+		}
+
+		std::shared_ptr<const NoteSnapshot> notes;
+	} ;
+	std::shared_ptr<SnapshotSlot> m_snapshot;
+
 	Pattern * adjacentPatternByOffset(int offset) const;
 
 	friend class PatternView;
@@ -208,7 +242,6 @@ private:
 	static QPixmap * s_stepBtnOffLight;
 
 	Pattern* m_pat;
-	QPixmap m_paintPixmap;
 
 	QColor m_noteFillColor;
 	QColor m_noteBorderColor;
@@ -60,6 +60,8 @@ class PerfLogTimer
 {
  public:
 	PerfLogTimer(const QString& name);
+	/// Only logs if \p active, e.g. with --profile-startup
+	PerfLogTimer(const QString& name, bool active);
 	~PerfLogTimer();
 
 	void begin();
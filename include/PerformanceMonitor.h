@@ -1,7 +1,5 @@
 /*
- * stereodelay.h - declaration of StereoDelay class.
- *
- * Copyright (c) 2014 David French <dave/dot/french3/at/googlemail/dot/com>
+ * PerformanceMonitor.h - window showing the render stats of the mixer live
  *
  * This file is part of LMMS - https://lmms.io
  *
@@ -22,39 +20,42 @@
  *
  */
 
-#ifndef STEREODELAY_H
-#define STEREODELAY_H
+#ifndef PERFORMANCE_MONITOR_H
+#define PERFORMANCE_MONITOR_H
+
+#include <QtCore/QTimer>
+#include <QWidget>
+
+#include "Mixer.h"
 
-#include "lmms_basics.h"
+class QLabel;
 
-class StereoDelay
+
+class PerformanceMonitor : public QWidget
 {
+	Q_OBJECT
 public:
-	StereoDelay( int maxLength, int sampleRate );
-	~StereoDelay();
-	inline void setLength( float length )
-	{
-		if( length <= m_maxLength && length >= 0 )
-		{
-			m_length = length;
-		}
-	}
-
-	inline void setFeedback( float feedback )
-	{
-		m_feedback = feedback;
-	}
-
-	void tick( sampleFrame frame );
-	void setSampleRate( int sampleRate );
+	PerformanceMonitor();
+	virtual ~PerformanceMonitor();
+
+
+private slots:
+	void readStats();
+
 
 private:
-	sampleFrame* m_buffer;
-	int m_maxLength;
-	float m_length;
-	int m_writeIndex;
-	float m_feedback;
-	float m_maxTime;
-};
-
-#endif // STEREODELAY_H
+	QLabel * addRow( const QString & _name );
+
+	LocklessRingBufferReader<Mixer::RenderStats> m_reader;
+	QTimer m_updateTimer;
+
+	QLabel * m_load;
+	QLabel * m_voices;
+	QLabel * m_effects;
+	QLabel * m_jobs;
+	QLabel * m_memory;
+
+} ;
+
+
+#endif
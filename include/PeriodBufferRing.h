@@ -0,0 +1,245 @@
+/*
+ * PeriodBufferRing.h - wait-free ring of preallocated period buffers
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef PERIOD_BUFFER_RING_H
+#define PERIOD_BUFFER_RING_H
+
+#include <atomic>
+#include <cstring>
+
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+
+#include "lmms_basics.h"
+
+
+//! Single-producer/single-consumer ring of period buffers that are allocated
+//! once up front. The producer fills writeBuffer() and publishes it with
+//! commitWrite(), the consumer works on readBuffer() and hands it back with
+//! commitRead(). None of these ever block or allocate; only the wait*()
+//! calls do, and they only touch a mutex if the other side is behind.
+class PeriodBufferRing
+{
+public:
+	//! _size is the number of buffers that can be queued while the consumer
+	//! still works on the one it read before
+	PeriodBufferRing( int _size, fpp_t _frames ) :
+		m_slots( _size + 1 ),
+		m_frames( _frames ),
+		m_buffers( new surroundSampleFrame[( _size + 1 ) * _frames] ),
+		m_end( new bool[_size + 1] ),
+		m_writeIndex( 0 ),
+		m_readerWaiting( false ),
+		m_readIndex( 0 ),
+		m_writerWaiting( false )
+	{
+		memset( m_buffers, 0, m_slots * m_frames *
+						sizeof( surroundSampleFrame ) );
+		memset( m_end, 0, m_slots * sizeof( bool ) );
+	}
+
+	~PeriodBufferRing()
+	{
+		delete[] m_end;
+		delete[] m_buffers;
+	}
+
+	// producer side
+
+	bool full() const
+	{
+		return distance( m_readIndex.load( std::memory_order_acquire ),
+			m_writeIndex.load( std::memory_order_relaxed ) ) >= m_slots;
+	}
+
+	//! Buffer to fill next, NULL if the consumer is behind
+	surroundSampleFrame * writeBuffer()
+	{
+		return full() ? NULL : slot( m_writeIndex.load(
+						std::memory_order_relaxed ) );
+	}
+
+	void commitWrite()
+	{
+		publish( false );
+	}
+
+	//! Make the consumer's readBuffer() return NULL once it got everything
+	//! written before
+	void commitEnd()
+	{
+		publish( true );
+	}
+
+	void waitForSpace()
+	{
+		wait( m_writerWaiting, m_spaceAvailable,
+				[this]() { return !full(); } );
+	}
+
+	void waitUntilRead()
+	{
+		wait( m_writerWaiting, m_spaceAvailable, [this]() {
+			return m_readIndex.load( std::memory_order_acquire ) ==
+				m_writeIndex.load( std::memory_order_relaxed ); } );
+	}
+
+	// consumer side
+
+	bool available() const
+	{
+		return m_writeIndex.load( std::memory_order_acquire ) !=
+				m_readIndex.load( std::memory_order_relaxed );
+	}
+
+	//! Oldest buffer that wasn't read yet, NULL at the end of the stream.
+	//! Must only be called if available().
+	const surroundSampleFrame * readBuffer() const
+	{
+		const unsigned int index =
+				m_readIndex.load( std::memory_order_relaxed );
+		return m_end[index % m_slots] ? NULL : slot( index );
+	}
+
+	//! Give the buffer returned by readBuffer() back to the producer
+	void commitRead()
+	{
+		m_readIndex.store( next( m_readIndex.load(
+			std::memory_order_relaxed ) ), std::memory_order_seq_cst );
+		std::atomic_thread_fence( std::memory_order_seq_cst );
+		if( m_writerWaiting.load( std::memory_order_relaxed ) )
+		{
+			wake( m_spaceAvailable );
+		}
+	}
+
+	void waitForData()
+	{
+		wait( m_readerWaiting, m_dataAvailable,
+				[this]() { return available(); } );
+	}
+
+	//! Buffers written but not read yet, may be outdated already when
+	//! called by neither side
+	int queued() const
+	{
+		return distance( m_readIndex.load( std::memory_order_relaxed ),
+				m_writeIndex.load( std::memory_order_relaxed ) );
+	}
+
+	int size() const
+	{
+		return m_slots;
+	}
+
+
+private:
+	// spin for a few tries before going to sleep, the other side mostly
+	// is just finishing the current period
+	static const int SpinTries = 64;
+
+	// indices run through twice the number of slots so a full ring can be
+	// told apart from an empty one
+	unsigned int next( unsigned int _index ) const
+	{
+		return ( _index + 1 ) % ( 2 * m_slots );
+	}
+
+	unsigned int distance( unsigned int _from, unsigned int _to ) const
+	{
+		return ( _to + 2 * m_slots - _from ) % ( 2 * m_slots );
+	}
+
+	surroundSampleFrame * slot( unsigned int _index ) const
+	{
+		return m_buffers + ( _index % m_slots ) * m_frames;
+	}
+
+	void publish( bool _end )
+	{
+		const unsigned int index =
+				m_writeIndex.load( std::memory_order_relaxed );
+		m_end[index % m_slots] = _end;
+		m_writeIndex.store( next( index ), std::memory_order_seq_cst );
+		std::atomic_thread_fence( std::memory_order_seq_cst );
+		if( m_readerWaiting.load( std::memory_order_relaxed ) )
+		{
+			wake( m_dataAvailable );
+		}
+	}
+
+	void wake( QWaitCondition & _condition )
+	{
+		// taking the mutex makes sure the waiter either sees the new index
+		// or already sleeps
+		m_waitMutex.lock();
+		_condition.wakeAll();
+		m_waitMutex.unlock();
+	}
+
+	template<class Predicate>
+	void wait( std::atomic_bool & _waiting, QWaitCondition & _condition,
+							Predicate _ready )
+	{
+		for( int i = 0; i < SpinTries; ++i )
+		{
+			if( _ready() )
+			{
+				return;
+			}
+			QThread::yieldCurrentThread();
+		}
+
+		m_waitMutex.lock();
+		_waiting.store( true, std::memory_order_seq_cst );
+		std::atomic_thread_fence( std::memory_order_seq_cst );
+		while( !_ready() )
+		{
+			_condition.wait( &m_waitMutex );
+		}
+		_waiting.store( false, std::memory_order_relaxed );
+		m_waitMutex.unlock();
+	}
+
+	const unsigned int m_slots;
+	const fpp_t m_frames;
+	surroundSampleFrame * const m_buffers;
+	bool * const m_end;
+
+	// keep the indices of both sides on separate cache lines
+	char m_pad0[64];
+	std::atomic_uint m_writeIndex;
+	std::atomic_bool m_readerWaiting;
+	char m_pad1[64];
+	std::atomic_uint m_readIndex;
+	std::atomic_bool m_writerWaiting;
+	char m_pad2[64];
+
+	QMutex m_waitMutex;
+	QWaitCondition m_dataAvailable;
+	QWaitCondition m_spaceAvailable;
+
+} ;
+
+
+#endif
@@ -27,12 +27,15 @@
 #ifndef PIANO_ROLL_H
 #define PIANO_ROLL_H
 
+#include <QBitArray>
+#include <QPixmap>
 #include <QVector>
 #include <QWidget>
 #include <QInputDialog>
 
 #include "Editor.h"
 #include "ComboBoxModel.h"
+#include "embed.h"
 #include "SerializingObject.h"
 #include "Note.h"
 #include "lmms_basics.h"
@@ -180,6 +183,7 @@ protected:
 	void focusOutEvent( QFocusEvent * ) override;
 
 	int getKey( int y ) const;
+	void drawBackground( QPainter & p, const QBrush & bgColor );
 	void drawNoteRect( QPainter & p, int x, int y,
 					int  width, const Note * n, const QColor & noteCol, const QColor & noteTextColor,
 					const QColor & selCol, const int noteOpc, const bool borderless, bool drawNoteName );
@@ -235,6 +239,9 @@ protected slots:
 
 	void clearGhostPattern();
 
+	void invalidateNoteIndex();
+	void updateKeyboard();
+
 
 signals:
 	void currentPatternChanged();
@@ -317,17 +324,17 @@ private:
 	static const int cm_scrollAmtHoriz = 10;
 	static const int cm_scrollAmtVert = 1;
 
-	static QPixmap * s_whiteKeyBigPm;
-	static QPixmap * s_whiteKeyBigPressedPm;
-	static QPixmap * s_whiteKeySmallPm;
-	static QPixmap * s_whiteKeySmallPressedPm;
-	static QPixmap * s_blackKeyPm;
-	static QPixmap * s_blackKeyPressedPm;
-	static QPixmap * s_toolDraw;
-	static QPixmap * s_toolErase;
-	static QPixmap * s_toolSelect;
-	static QPixmap * s_toolMove;
-	static QPixmap * s_toolOpen;
+	static LazyPixmap s_whiteKeyBigPm;
+	static LazyPixmap s_whiteKeyBigPressedPm;
+	static LazyPixmap s_whiteKeySmallPm;
+	static LazyPixmap s_whiteKeySmallPressedPm;
+	static LazyPixmap s_blackKeyPm;
+	static LazyPixmap s_blackKeyPressedPm;
+	static LazyPixmap s_toolDraw;
+	static LazyPixmap s_toolErase;
+	static LazyPixmap s_toolSelect;
+	static LazyPixmap s_toolMove;
+	static LazyPixmap s_toolOpen;
 
 	static PianoRollKeyTypes prKeyOrder[];
 
@@ -343,8 +350,61 @@ private:
 	static const QVector<double> m_zoomLevels;
 	static const QVector<double> m_zoomYLevels;
 
+	//! The notes sorted by position, so painting only visits the ones
+	//! within the painted range of ticks. Their keys are checked while
+	//! painting, the note edit area needs the others as well.
+	class NoteIndex
+	{
+	public:
+		NoteIndex();
+
+		void invalidate();
+		//! The notes of _notes which may be visible from tick _start
+		//! to tick _end, in order of their position
+		NoteVector notesInRange( const NoteVector & _notes, int _start,
+								int _end );
+
+	private:
+		bool m_valid;
+		NoteVector m_notes;
+		// of the notes in m_notes, so the ones starting before _start
+		// which are still playing by then are found
+		int m_maxLength;
+	} ;
+
+	//! Everything the grid and keyboard painted into m_background depend
+	//! on, it's painted again once any of it changes
+	struct BackgroundState
+	{
+		QSize size;
+		bool validPattern;
+		int startKey;
+		int currentPosition;
+		int ppb;
+		int keyLineHeight;
+		int notesEditHeight;
+		int quantization;
+		int zoom;
+		int timeSigNumerator;
+		int timeSigDenominator;
+		int noteEditMode;
+		bool noteNames;
+		QList<int> markedSemiTones;
+		QBitArray pressedKeys;
+		QVector<QRgb> colors;
+
+		bool operator==( const BackgroundState & other ) const;
+	} ;
+
+	BackgroundState backgroundState( const QBrush & bgColor ) const;
+
 	Pattern* m_pattern;
 	NoteVector m_ghostNotes;
+	NoteIndex m_noteIndex;
+	NoteIndex m_ghostNoteIndex;
+
+	QPixmap m_background;
+	BackgroundState m_backgroundState;
 
 	inline const NoteVector & ghostNotes() const
 	{
@@ -48,7 +48,9 @@ public:
 		TypeNotePlayHandle = 0x01,
 		TypeInstrumentPlayHandle = 0x02,
 		TypeSamplePlayHandle = 0x04,
-		TypePresetPreviewHandle = 0x08
+		TypePresetPreviewHandle = 0x08,
+		TypeFreezePlayHandle = 0x10,
+		TypeBBLoopPlayHandle = 0x20
 	} ;
 	typedef Types Type;
 
@@ -88,6 +90,9 @@ public:
 
 	// required for ThreadableJob
 	void doProcessing() override;
+	//! Play handles come and go, so their time is collected per audio port
+	void accountProcessingTime( int microseconds ) override;
+	const char * traceName() const override;
 
 	bool requiresProcessing() const override
 	{
@@ -157,6 +162,13 @@ private:
 	bool m_bufferReleased;
 	bool m_usesBuffer;
 	AudioPort * m_audioPort;
+	// slot in the mixer's play handle registry, -1 if not registered
+	int m_mixerSlot;
+	// created for the next period by a track rendered ahead, see
+	// Mixer::startAnticipativeJobs()
+	bool m_aheadOfPeriod;
+
+	friend class Mixer;
 } ;
 
 
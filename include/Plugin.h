@@ -63,7 +63,7 @@ class AutomatableModel;
 */
 class LMMS_EXPORT Plugin : public Model, public JournallingObject
 {
-	MM_OPERATORS
+	MM_OPERATORS_TAGGED( Plugins )
 	Q_OBJECT
 public:
 	enum PluginTypes
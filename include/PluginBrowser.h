@@ -78,8 +78,13 @@ protected:
 private:
 	constexpr static int DEFAULT_HEIGHT{24};
 
+	//! The logo at _size, decoded when it's shown first as most of the
+	//! plugins are out of sight at startup
+	const QPixmap & logo( const QSize & _size );
+
 	PluginKey m_pluginKey;
 	QPixmap m_logo;
+	QPixmap m_scaledLogo;
 
 	bool m_mouseOver;
 };
@@ -27,6 +27,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <QtCore/QFileInfo>
 #include <QtCore/QHash>
@@ -48,6 +49,11 @@ public:
 		QFileInfo file;
 		std::shared_ptr<QLibrary> library = nullptr;
 		Plugin::Descriptor* descriptor = nullptr;
+		/// Whether library is loaded and descriptor is the one it holds.
+		/// Otherwise descriptor was read from the plugin manifest and only
+		/// has the name, type, texts and file types, without logo and sub
+		/// plugin features.
+		bool loaded = true;
 
 		bool isNull() const {return ! library;}
 	};
@@ -63,9 +69,10 @@ public:
 	/// this directly, use pluginFactory instead.
 	static PluginFactory* instance();
 
-	/// Returns a list of all found plugins' descriptors.
-	const Plugin::DescriptorList descriptors() const;
-	const Plugin::DescriptorList descriptors(Plugin::PluginTypes type) const;
+	/// Returns a list of all found plugins' descriptors. Loads the plugins
+	/// which have only been read from the manifest so far.
+	const Plugin::DescriptorList descriptors();
+	const Plugin::DescriptorList descriptors(Plugin::PluginTypes type);
 
 	struct PluginInfoAndKey
 	{
@@ -75,27 +82,77 @@ public:
 	};
 
 	/// Returns a list of all found plugins' PluginFactory::PluginInfo objects.
-	const PluginInfoList& pluginInfos() const;
-	/// Returns a plugin that support the given file extension
+	/// Loads the plugins which have only been read from the manifest so far.
+	const PluginInfoList& pluginInfos();
+	/// Returns a plugin that support the given file extension, loading it
+	/// if needed
 	const PluginInfoAndKey pluginSupportingExtension(const QString& ext);
 
-	/// Returns the PluginInfo object of the plugin with the given name.
+	/// Returns the PluginInfo object of the plugin with the given name,
+	/// loading its library if it hasn't been loaded yet.
 	/// If the plugin is not found, an empty PluginInfo is returned (use
 	/// PluginInfo::isNull() to check this).
-	const PluginInfo pluginInfo(const char* name) const;
+	const PluginInfo pluginInfo(const char* name);
 
 	/// When loading a library fails during discovery, the error string is saved.
 	/// It can be retrieved by calling this function.
 	QString errorString(QString pluginName) const;
 
 public slots:
+	/// Finds the plugins in the search paths. Libraries which didn't change
+	/// since the last time are only looked up in the plugin manifest kept
+	/// next to the configuration file, they are loaded once one of their
+	/// plugins is needed.
 	void discoverPlugins();
 
 private:
+	/// What the plugin manifest keeps of a library
+	struct ManifestEntry
+	{
+		QString path;
+		qint64 size = 0;
+		qint64 modified = 0;
+		/// Libraries which aren't plugins are loaded before retrying one
+		/// which couldn't be loaded, as it may depend on them
+		bool isPlugin = false;
+
+		std::string name;
+		std::string displayName;
+		std::string description;
+		std::string author;
+		std::string supportedFileTypes;
+		bool hasFileTypes = false;
+		int version = 0;
+		int type = Plugin::Undefined;
+		/// Extensions of the sub plugins' keys
+		QStringList subPluginFileTypes;
+
+		/// Made up of the strings above, for plugins not loaded yet
+		Plugin::Descriptor descriptor;
+	};
+
+	static QString manifestFile();
+	QHash<QString, ManifestEntry> readManifest() const;
+	void writeManifest(const QList<const ManifestEntry*>& entries) const;
+
+	bool loadLibrary(QLibrary& library);
+	Plugin::Descriptor* resolveDescriptor(QLibrary& library, const QFileInfo& file);
+	/// Replaces the descriptor of info with the one of its library
+	bool loadPlugin(PluginInfo& info);
+	void loadAll(Plugin::PluginTypes type = Plugin::Undefined);
+	/// Returns the extensions of the sub plugins' keys
+	QStringList addSupportedFileTypes(const PluginInfo& info);
+
 	DescriptorMap m_descriptors;
 	PluginInfoList m_pluginInfos;
 
 	QMap<QString, PluginInfoAndKey> m_pluginByExt;
+	/// Extensions of plugins which haven't been loaded yet
+	QMap<QString, QString> m_lazyPluginByExt;
+	QStringList m_dependencies;
+	/// Entries of the plugins which haven't been loaded yet, which their
+	/// descriptors point into
+	std::vector<std::unique_ptr<ManifestEntry>> m_manifest;
 	QVector<std::string> m_garbage; //!< cleaned up at destruction
 
 	QHash<QString, QString> m_errors;
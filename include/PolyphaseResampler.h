@@ -0,0 +1,74 @@
+/*
+ * PolyphaseResampler.h - windowed-sinc resampler for playing samples at
+ *                        any pitch
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef POLYPHASE_RESAMPLER_H
+#define POLYPHASE_RESAMPLER_H
+
+#include "lmms_basics.h"
+#include "lmms_export.h"
+#include "MemoryManager.h"
+
+
+//! Stereo resampler with a lighter footprint than a libsamplerate
+//! converter: the filter banks are shared by all instances, which only
+//! keep the last input frames and the position between them. The ratio
+//! may change with every call. Playing faster than twice the original
+//! speed uses filters with a lower cutoff, up to MaxScale times.
+class LMMS_EXPORT PolyphaseResampler
+{
+	MM_OPERATORS
+public:
+	//! taps of the filter for ratios >= 1, the others have up to
+	//! MaxScale times as many
+	static const int Taps = 16;
+	static const int Phases = 128;
+	static const int MaxScale = 4;
+	//! input frames needed after the ones the output covers
+	static const int Margin = MaxScale * Taps / 2 + 2;
+
+	PolyphaseResampler();
+
+	void reset();
+
+	//! Write _outFrames frames to _out, resampled from _in by _ratio
+	//! (output over input rate, like src_ratio of libsamplerate). Returns
+	//! the number of input frames used up, the next call continues after
+	//! them.
+	f_cnt_t process( const sampleFrame * _in, f_cnt_t _inFrames,
+				sampleFrame * _out, fpp_t _outFrames,
+				double _ratio );
+
+
+private:
+	static const int HistoryFrames = MaxScale * Taps;
+
+	// the input frames before the next one of process()
+	sampleFrame m_history[HistoryFrames];
+	// of the next output frame, between the first input frame and the
+	// one after it
+	double m_position;
+
+} ;
+
+
+#endif
@@ -48,6 +48,10 @@ public:
 
 	bool isFromTrack( const Track * _track ) const override;
 
+	//! Loads a preset to be previewed next, e.g. the one after the last
+	//! previewed in the file browser, unless a preview is being loaded
+	static void preload( const QString& presetFile, bool loadByPlugin = false, DataFile *dataFile = 0 );
+
 	static void init();
 	static void cleanup();
 	static ConstNotePlayHandleList nphsOfInstrumentTrack( const InstrumentTrack* instrumentTrack );
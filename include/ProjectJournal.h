@@ -25,8 +25,11 @@
 #ifndef PROJECT_JOURNAL_H
 #define PROJECT_JOURNAL_H
 
+#include <deque>
+
+#include <QtCore/QByteArray>
 #include <QtCore/QHash>
-#include <QtCore/QStack>
+#include <QtCore/QSet>
 
 #include "lmms_basics.h"
 #include "DataFile.h"
@@ -38,7 +41,9 @@ class JournallingObject;
 class ProjectJournal
 {
 public:
-	static const int MAX_UNDO_STATES;
+	//! Default of the memory budget for the undo and redo checkpoints, in
+	//! MB, see the "undomemory" setting
+	static const int DEFAULT_UNDO_MEMORY;
 
 	ProjectJournal();
 	virtual ~ProjectJournal();
@@ -51,6 +56,21 @@ public:
 
 	void addJournalCheckPoint( JournallingObject *jo );
 
+	//! Notes that the object with _id changed, whether journalling or not,
+	//! see TrackSnapshots
+	void objectChanged( const jo_id_t _id )
+	{
+		m_changedObjects.insert( _id );
+	}
+
+	//! The objects changed since the last call
+	QSet<jo_id_t> takeChangedObjects()
+	{
+		QSet<jo_id_t> changed;
+		changed.swap( m_changedObjects );
+		return changed;
+	}
+
 	bool isJournalling() const
 	{
 		return m_journalling;
@@ -97,22 +117,35 @@ public:
 private:
 	typedef QHash<jo_id_t, JournallingObject *> JoIdMap;
 
+	//! The state of an object, kept compressed since it's usually the
+	//! whole object for a tiny change
 	struct CheckPoint
 	{
-		CheckPoint( jo_id_t initID = 0, const DataFile& initData = DataFile( DataFile::JournalData ) ) :
+		CheckPoint( jo_id_t initID, const DataFile& initData ) :
 			joID( initID ),
-			data( initData )
+			data( qCompress( initData.toByteArray( -1 ) ) )
 		{
 		}
 		jo_id_t joID;
-		DataFile data;
+		QByteArray data;
 	} ;
-	typedef QStack<CheckPoint> CheckPointStack;
+	//! Trimmed at the front once the checkpoints exceed the budget
+	typedef std::deque<CheckPoint> CheckPointStack;
+
+	//! Saves the state of _jo to push onto _stack
+	static CheckPoint checkPoint( JournallingObject * _jo );
+	void push( CheckPointStack & _stack, const CheckPoint & _checkPoint );
+	CheckPoint pop( CheckPointStack & _stack );
+	//! Drops the oldest undo checkpoints beyond the budget
+	void trim();
 
 	JoIdMap m_joIDs;
 
 	CheckPointStack m_undoCheckPoints;
 	CheckPointStack m_redoCheckPoints;
+	// of the data of both
+	size_t m_checkPointBytes;
+	QSet<jo_id_t> m_changedObjects;
 
 	bool m_journalling;
 
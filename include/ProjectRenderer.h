@@ -25,6 +25,8 @@
 #ifndef PROJECT_RENDERER_H
 #define PROJECT_RENDERER_H
 
+#include <QtCore/QVector>
+
 #include "AudioFileDevice.h"
 #include "lmmsconfig.h"
 #include "Mixer.h"
@@ -32,6 +34,9 @@
 
 #include "lmms_export.h"
 
+class StemExporter;
+class TrackFreeze;
+
 class LMMS_EXPORT ProjectRenderer : public QThread
 {
 	Q_OBJECT
@@ -42,6 +47,7 @@ public:
 		FlacFile,
 		OggFile,
 		MP3File,
+		RawFile,
 		NumFileFormats
 	} ;
 
@@ -60,6 +66,10 @@ public:
 				const OutputSettings & _os,
 				ExportFileFormats _file_format,
 				const QString & _out_file );
+	//! Render into a device set up by the caller, e.g. one which doesn't
+	//! write anything for benchmarking
+	ProjectRenderer( const Mixer::qualitySettings & _qs,
+				AudioFileDevice * _file_dev );
 	virtual ~ProjectRenderer();
 
 	bool isReady() const
@@ -74,6 +84,27 @@ public:
 
 	static const FileEncodeDevice fileEncodeDevices[];
 
+	//! Also write the stems of _stems during the render, which has to stay
+	//! around until the renderer is done
+	void setStemExporter( StemExporter * _stems )
+	{
+		m_stems = _stems;
+	}
+
+	//! Record the frozen audio of a track during the render, see
+	//! TrackFreezer
+	void setTrackFreeze( TrackFreeze * _freeze )
+	{
+		m_freeze = _freeze;
+	}
+
+	//! Frames of the file at which the bars of the export range start, and
+	//! the one at which the range ends, see Song::setExportRange()
+	const QVector<f_cnt_t> & barFrames() const
+	{
+		return m_barFrames;
+	}
+
 public slots:
 	void startProcessing();
 	void abortProcessing();
@@ -88,8 +119,17 @@ signals:
 private:
 	void run() override;
 
+	// frames passed to the encoder at once, the mixer still renders
+	// periods of the configured size so events stay where they were
+	static const f_cnt_t ExportBlockSize = 16384;
+
 	AudioFileDevice * m_fileDev;
+	StemExporter * m_stems;
+	TrackFreeze * m_freeze;
+	QVector<f_cnt_t> m_barFrames;
 	Mixer::qualitySettings m_qualitySettings;
+	// the engine objects of the project rendered, see Engine::createContext()
+	EngineContext * m_context;
 
 	volatile int m_progress;
 	volatile bool m_abort;
@@ -0,0 +1,95 @@
+/*
+ * RealtimeChecker.h - reports operations which may block while rendering
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef REALTIME_CHECKER_H
+#define REALTIME_CHECKER_H
+
+#include "lmmsconfig.h"
+#include "lmms_export.h"
+
+
+//! With WANT_DEBUG_REALTIME, allocations, waiting for mutexes and opening
+//! files are reported with a stack trace while a thread renders, i.e.
+//! inside a RenderScope. Each distinct stack trace is reported once. Set
+//! LMMS_REALTIME_ABORT=1 to abort on the first one, e.g. in CI.
+//! Without WANT_DEBUG_REALTIME everything in here compiles to nothing.
+namespace RealtimeChecker
+{
+
+#ifdef LMMS_DEBUG_REALTIME
+
+//! Marks the calling thread as rendering, nests
+class LMMS_EXPORT RenderScope
+{
+public:
+	RenderScope();
+	~RenderScope();
+
+private:
+	int m_allowed;
+
+} ;
+
+
+//! Allows everything within a RenderScope, for waits that are part of
+//! the design like the mixer waiting for its worker threads. A
+//! RenderScope inside of it, e.g. for a job, is checked again.
+class LMMS_EXPORT Allowed
+{
+public:
+	Allowed();
+	~Allowed();
+
+} ;
+
+
+//! Report _what if the calling thread is rendering
+LMMS_EXPORT void check( const char * _what );
+
+#else
+
+class RenderScope
+{
+public:
+	RenderScope()
+	{
+	}
+} ;
+
+class Allowed
+{
+public:
+	Allowed()
+	{
+	}
+} ;
+
+inline void check( const char * )
+{
+}
+
+#endif
+
+}
+
+
+#endif
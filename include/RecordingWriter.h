@@ -0,0 +1,89 @@
+/*
+ * RecordingWriter.h - streams recorded audio to a file on disk
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef RECORDING_WRITER_H
+#define RECORDING_WRITER_H
+
+#include <QtCore/QString>
+#include <QtCore/QThread>
+
+#include <atomic>
+
+#include "lmms_basics.h"
+#include "lmms_export.h"
+#include "LocklessRingBuffer.h"
+
+
+//! Writes recorded stereo frames to a 32-bit float WAV file from a thread
+//! of its own, so takes are only limited by the disk. The recording
+//! thread hands the frames over through a lockless ring and never waits
+//! for the disk. Files growing beyond 4 GB are written as RF64.
+class LMMS_EXPORT RecordingWriter : public QThread
+{
+public:
+	RecordingWriter( const QString & fileName, sample_rate_t sampleRate );
+	virtual ~RecordingWriter();
+
+	//! A name for a new recording in the samples directory of the user
+	//! not taken yet, starting with _prefix
+	static QString newFileName( const QString & _prefix );
+
+	const QString & fileName() const
+	{
+		return m_fileName;
+	}
+
+	//! Hands _frames frames over to the writing thread, ones that don't
+	//! fit into the ring any more get dropped
+	void write( const sampleFrame * _ab, f_cnt_t _frames );
+
+	//! Frames handed over by write() so far, dropped ones included
+	f_cnt_t framesRecorded() const
+	{
+		return m_framesRecorded;
+	}
+
+	//! Waits for all frames to be written and closes the file, returns
+	//! false if it couldn't be written
+	bool finish();
+
+
+private:
+	void run() override;
+
+	const QString m_fileName;
+	const sample_rate_t m_sampleRate;
+
+	// a few seconds even at high sample rates
+	static const int RingSize = 1 << 18;
+	LocklessRingBuffer<sampleFrame> m_ring;
+	LocklessRingBufferReader<sampleFrame> m_reader;
+
+	f_cnt_t m_framesRecorded;
+	std::atomic_int m_framesDropped;
+	std::atomic<bool> m_finishing;
+	std::atomic<bool> m_failed;
+
+} ;
+
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ * RefreshScheduler.h - refreshes meters, scopes and displays at display rate
+ *                      while they can be seen
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef REFRESH_SCHEDULER_H
+#define REFRESH_SCHEDULER_H
+
+#include <functional>
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QObject>
+#include <QtCore/QVector>
+
+#include "lmms_export.h"
+
+class QWidget;
+
+
+//! Refreshes the registered widgets from the display timer of the main
+//! window, each kind at no more than its own rate and only while the widget
+//! can be seen. The refreshes of a frame are done together, so Qt paints
+//! their widgets in a single pass per window.
+class LMMS_EXPORT RefreshScheduler : public QObject
+{
+	Q_OBJECT
+public:
+	//! Refreshes per second of each kind of widget
+	enum Rates
+	{
+		MeterRate = 30,
+		ScopeRate = 60,
+		DisplayRate = 30
+	} ;
+
+	typedef std::function<void()> Refresh;
+
+	RefreshScheduler( QObject * _parent = NULL );
+
+	//! Calls _refresh up to _rate times a second while _widget is visible,
+	//! until it's removed or destroyed
+	void add( QWidget * _widget, int _rate, const Refresh & _refresh );
+	void remove( const QObject * _widget );
+
+	//! Does the refreshes due, called by MainWindow every frame
+	void tick();
+
+
+private:
+	static bool isShown( const QWidget * _widget );
+
+	struct Entry
+	{
+		QWidget * widget;
+		int interval;
+		qint64 due;
+		Refresh refresh;
+	} ;
+
+	QVector<Entry> m_entries;
+	QElapsedTimer m_clock;
+	bool m_removed;
+
+} ;
+
+
+#endif
@@ -46,6 +46,7 @@
 #endif
 
 #include <QtCore/QtGlobal>
+#include <QtCore/QMutex>
 #include <QtCore/QSystemSemaphore>
 #endif
 
@@ -89,9 +90,14 @@ typedef int32_t key_t;
 
 #else
 #include "lmms_export.h"
+#include "LocklessList.h"
 #include <QtCore/QMutex>
+#include <QtCore/QPointer>
 #include <QtCore/QProcess>
 #include <QtCore/QThread>
+#include <QtCore/QVector>
+
+#include <functional>
 
 #ifndef SYNC_WITH_SHM_FIFO
 #include <poll.h>
@@ -102,13 +108,29 @@ typedef int32_t key_t;
 
 #ifdef SYNC_WITH_SHM_FIFO
 // sometimes we need to exchange bigger messages (e.g. for VST parameter dumps)
-// so set a usable value here
+// so set a usable value here, it has to be a power of two
 const int SHM_FIFO_SIZE = 512*1024;
 
+// number of times a reader polls for a message before it sleeps on the
+// message semaphore - replies to the audio thread often arrive within
+// microseconds and spinning for them saves two kernel round-trips
+const int SHM_FIFO_SPIN_COUNT = 2000;
+
 
 // implements a FIFO inside a shared memory segment
+//
+// Each end of the FIFO belongs to one process, so the ring itself is
+// a lock-free single producer, single consumer queue: the writer only
+// moves writePos, the reader only readPos. Threads of the same process
+// take turns through a local lock. The message semaphore is only touched
+// when the reader actually has to sleep.
 class shmFifo
 {
+	static_assert( ( SHM_FIFO_SIZE & ( SHM_FIFO_SIZE - 1 ) ) == 0,
+				"SHM_FIFO_SIZE must be a power of two" );
+	static_assert( ATOMIC_INT_LOCK_FREE == 2,
+			"shared memory FIFO requires lock-free atomic integers" );
+
 	// need this union to handle different sizes of sem_t on 32 bit
 	// and 64 bit platforms
 	union sem32_t
@@ -118,11 +140,13 @@ class shmFifo
 	} ;
 	struct shmData
 	{
-		sem32_t dataSem;	// semaphore for locking this
-					// FIFO management data
-		sem32_t messageSem;	// semaphore for incoming messages
-		volatile int32_t startPtr; // current start of FIFO in memory
-		volatile int32_t endPtr;   // current end of FIFO in memory
+		sem32_t messageSem;	// semaphore the reader sleeps on
+		// messages written but not yet taken, negative while the
+		// reader sleeps on messageSem
+		std::atomic<int32_t> messages;
+		// bytes read and written so far, wrapping around
+		std::atomic<uint32_t> readPos;
+		std::atomic<uint32_t> writePos;
 		char data[SHM_FIFO_SIZE];  // actual data
 	} ;
 
@@ -138,9 +162,8 @@ public:
 		m_shmID( -1 ),
 #endif
 		m_data( NULL ),
-		m_dataSem( QString() ),
 		m_messageSem( QString() ),
-		m_lockDepth( 0 )
+		m_localLock( QMutex::Recursive )
 	{
 #ifdef USE_QT_SHMEM
 		do
@@ -158,12 +181,11 @@ public:
 		m_data = (shmData *) shmat( m_shmID, 0, 0 );
 #endif
 		assert( m_data != NULL );
-		m_data->startPtr = m_data->endPtr = 0;
+		m_data->messages.store( 0 );
+		m_data->readPos.store( 0 );
+		m_data->writePos.store( 0 );
 		static int k = 0;
-		m_data->dataSem.semKey = ( getpid()<<10 ) + ++k;
 		m_data->messageSem.semKey = ( getpid()<<10 ) + ++k;
-		m_dataSem.setKey( QString::number( m_data->dataSem.semKey ),
-						1, QSystemSemaphore::Create );
 		m_messageSem.setKey( QString::number(
 						m_data->messageSem.semKey ),
 						0, QSystemSemaphore::Create );
@@ -181,9 +203,8 @@ public:
 		m_shmID( shmget( _shm_key, 0, 0 ) ),
 #endif
 		m_data( NULL ),
-		m_dataSem( QString() ),
 		m_messageSem( QString() ),
-		m_lockDepth( 0 )
+		m_localLock( QMutex::Recursive )
 	{
 #ifdef USE_QT_SHMEM
 		if( m_shmObj.attach() )
@@ -197,7 +218,6 @@ public:
 		}
 #endif
 		assert( m_data != NULL );
-		m_dataSem.setKey( QString::number( m_data->dataSem.semKey ) );
 		m_messageSem.setKey( QString::number(
 						m_data->messageSem.semKey ) );
 	}
@@ -232,37 +252,53 @@ public:
 		return m_master;
 	}
 
-	// recursive lock
+	// recursive lock, keeps threads of this process from interleaving
+	// their messages
 	inline void lock()
 	{
-		if( !isInvalid() && m_lockDepth.fetch_add( 1 ) == 0 )
-		{
-			m_dataSem.acquire();
-		}
+		m_localLock.lock();
 	}
 
-	// recursive unlock
 	inline void unlock()
 	{
-		if( m_lockDepth.fetch_sub( 1 ) <= 1 )
-		{
-			m_dataSem.release();
-		}
+		m_localLock.unlock();
 	}
 
-	// wait until message-semaphore is available
+	// wait until a message is available and take it
 	inline void waitForMessage()
 	{
-		if( !isInvalid() )
+		if( isInvalid() )
+		{
+			return;
+		}
+		for( int i = 0; i < SHM_FIFO_SPIN_COUNT; ++i )
+		{
+			int32_t pending = m_data->messages.load(
+						std::memory_order_relaxed );
+			if( pending > 0 &&
+				m_data->messages.compare_exchange_weak( pending,
+						pending - 1,
+						std::memory_order_acquire ) )
+			{
+				return;
+			}
+		}
+		// nothing yet - going below zero tells the writer to wake us up
+		if( m_data->messages.fetch_sub( 1,
+					std::memory_order_acquire ) <= 0 )
 		{
 			m_messageSem.acquire();
 		}
 	}
 
-	// increase message-semaphore
+	// announce a message, waking up the reader if it sleeps
 	inline void messageSent()
 	{
-		m_messageSem.release();
+		if( m_data->messages.fetch_add( 1,
+					std::memory_order_release ) < 0 )
+		{
+			m_messageSem.release();
+		}
 	}
 
 
@@ -308,10 +344,7 @@ public:
 		{
 			return false;
 		}
-		lock();
-		const bool empty = ( m_data->startPtr == m_data->endPtr );
-		unlock();
-		return !empty;
+		return m_data->messages.load( std::memory_order_acquire ) > 0;
 	}
 
 
@@ -343,25 +376,29 @@ private:
 			memset( _buf, 0, _len );
 			return;
 		}
-		lock();
-		while( isInvalid() == false &&
-				_len > m_data->endPtr - m_data->startPtr )
+		// a message is complete before it gets announced, so this only
+		// waits for the rest of messages bigger than the FIFO
+		const uint32_t readPos =
+			m_data->readPos.load( std::memory_order_relaxed );
+		while( isInvalid() == false && (uint32_t) _len >
+			m_data->writePos.load( std::memory_order_acquire ) -
+								readPos )
 		{
-			unlock();
 #ifndef LMMS_BUILD_WIN32
 			usleep( 5 );
 #endif
-			lock();
 		}
-		fastMemCpy( _buf, m_data->data + m_data->startPtr, _len );
-		m_data->startPtr += _len;
-		// nothing left?
-		if( m_data->startPtr == m_data->endPtr )
+		if( isInvalid() )
 		{
-			// then reset to 0
-			m_data->startPtr = m_data->endPtr = 0;
+			memset( _buf, 0, _len );
+			return;
 		}
-		unlock();
+		const int offset = readPos & ( SHM_FIFO_SIZE - 1 );
+		const int first = qMin( _len, SHM_FIFO_SIZE - offset );
+		fastMemCpy( _buf, m_data->data + offset, first );
+		memcpy( (char *) _buf + first, m_data->data, _len - first );
+		m_data->readPos.store( readPos + _len,
+						std::memory_order_release );
 	}
 
 	void write( const void * _buf, int _len )
@@ -370,28 +407,23 @@ private:
 		{
 			return;
 		}
-		lock();
-		while( _len > SHM_FIFO_SIZE - m_data->endPtr )
+		// wait for the reader to make room
+		const uint32_t writePos =
+			m_data->writePos.load( std::memory_order_relaxed );
+		while( isInvalid() == false && (uint32_t) _len > SHM_FIFO_SIZE -
+			( writePos - m_data->readPos.load(
+						std::memory_order_acquire ) ) )
 		{
-			// if no space is left, try to move data to front
-			if( m_data->startPtr > 0 )
-			{
-				memmove( m_data->data,
-					m_data->data + m_data->startPtr,
-					m_data->endPtr - m_data->startPtr );
-				m_data->endPtr = m_data->endPtr -
-							m_data->startPtr;
-				m_data->startPtr = 0;
-			}
-			unlock();
 #ifndef LMMS_BUILD_WIN32
 			usleep( 5 );
 #endif
-			lock();
 		}
-		fastMemCpy( m_data->data + m_data->endPtr, _buf, _len );
-		m_data->endPtr += _len;
-		unlock();
+		const int offset = writePos & ( SHM_FIFO_SIZE - 1 );
+		const int first = qMin( _len, SHM_FIFO_SIZE - offset );
+		fastMemCpy( m_data->data + offset, _buf, first );
+		memcpy( m_data->data, (const char *) _buf + first, _len - first );
+		m_data->writePos.store( writePos + _len,
+						std::memory_order_release );
 	}
 
 	volatile bool m_invalid;
@@ -403,9 +435,8 @@ private:
 	int m_shmID;
 #endif
 	shmData * m_data;
-	QSystemSemaphore m_dataSem;
 	QSystemSemaphore m_messageSem;
-	std::atomic_int m_lockDepth;
+	QMutex m_localLock;
 
 } ;
 #endif
@@ -439,11 +470,34 @@ enum RemoteMessageIDs
 	IdSavePresetFile,
 	IdLoadPresetFile,
 	IdDebugMessage,
+	IdParameterChange,
 	IdUserBase = 64
 } ;
 
 
 
+// a parameter change handed to the plugin process along with the audio of
+// a period, the layout is the same for 32 and 64 bit processes
+struct RemoteParameterChange
+{
+	int32_t index;
+	float value;
+	// frame of the period the change is due at
+	int32_t offset;
+} ;
+
+// follows the audio in the shared memory, the changes of a period which are
+// applied before processing it
+struct RemoteParameterBlock
+{
+	static const int MaxChanges = 1024;
+
+	int32_t count;
+	RemoteParameterChange changes[MaxChanges];
+} ;
+
+
+
 class LMMS_EXPORT RemotePluginBase
 {
 public:
@@ -747,29 +801,63 @@ private:
 
 class RemotePlugin;
 
+// one thread for all remote plugins, which starts their processes and
+// invalidates a plugin whose process terminates unexpectedly, so LMMS
+// doesn't lock up
 class ProcessWatcher : public QThread
 {
 	Q_OBJECT
 public:
-	ProcessWatcher( RemotePlugin * );
-	virtual ~ProcessWatcher() = default;
+	static ProcessWatcher * instance();
 
-	void stop()
-	{
-		m_quit = true;
-		quit();
-	}
+	virtual ~ProcessWatcher();
 
-	void reset()
-	{
-		m_quit = false;
-	}
+	// starts the process of _p on the watcher thread
+	void launch( RemotePlugin * _p );
+	// gives the process of _p back to the thread of _p if the watcher
+	// still holds it, e.g. before stopping it
+	void release( RemotePlugin * _p );
+
+	// starts a spare process for _exec, which the next plugin started
+	// with the same arguments takes over instead of waiting for a new one
+	void prestart( const QString & _exec, const QStringList & _extraArgs );
+	// has _p take over a spare process, false if there is none
+	bool adopt( RemotePlugin * _p, const QString & _exec,
+					const QStringList & _extraArgs );
 
 private:
-	void run() override;
+	struct Spare
+	{
+		QString exec;
+		QStringList extraArgs;
+		QProcess * process;
+#ifdef SYNC_WITH_SHM_FIFO
+		shmFifo * in;
+		shmFifo * out;
+#else
+		int server;
+		QString socketFile;
+#endif
+	} ;
+
+	ProcessWatcher();
 
-	RemotePlugin * m_plugin;
-	volatile bool m_quit;
+	// runs _f on the watcher thread and waits for it
+	void runOnWatcher( const std::function<void()> & _f );
+
+	// called on the watcher thread once the process of _p finished
+	void processFinished( RemotePlugin * _p );
+	void invalidateWhenDone( QPointer<RemotePlugin> _p );
+
+	void dropSpare( const Spare & _s );
+	void dropSpares();
+
+	// lives on the watcher thread, for running things there
+	QObject m_context;
+
+	QVector<Spare> m_spares;
+
+	friend class RemotePlugin;
 
 } ;
 
@@ -786,7 +874,7 @@ public:
 #ifdef DEBUG_REMOTE_PLUGIN
 		return true;
 #else
-		return m_process.state() != QProcess::NotRunning;
+		return m_process->state() != QProcess::NotRunning;
 #endif
 	}
 
@@ -807,8 +895,33 @@ public:
 
 	bool process( const sampleFrame * _in_buf, sampleFrame * _out_buf );
 
+	// With asynchronous processing, process() starts the plugin on the
+	// current period and returns the result of the previous one, so the
+	// plugin process runs in parallel with the rest of the graph. Output
+	// is one period late then, see latency().
+	void setAsyncProcessing( bool _on );
+
+	inline bool asyncProcessing() const
+	{
+		return m_asyncProcessing;
+	}
+
+	// frames the output of process() lags behind its input
+	f_cnt_t latency() const;
+
 	void processMidiEvent( const MidiEvent&, const f_cnt_t _offset );
 
+	// Has the plugin process set parameter _index to _value _offset frames
+	// into the next period. Changes are collected without locking and go
+	// to the plugin together with the audio of the period instead of one
+	// message each, so any thread can call this.
+	void queueParameterChange( int _index, float _value,
+						f_cnt_t _offset = 0 );
+
+	// sends the changes queued so far as messages for when no periods are
+	// processed, needs lock()
+	void flushParameterChanges();
+
 	void updateSampleRate( sample_rate_t _sr )
 	{
 		lock();
@@ -844,6 +957,12 @@ public:
 		m_commMutex.lock();
 	}
 
+	// for traffic which can wait while a period is processed
+	inline bool tryLock()
+	{
+		return m_commMutex.tryLock();
+	}
+
 	inline void unlock()
 	{
 		m_commMutex.unlock();
@@ -862,11 +981,24 @@ protected:
 
 	bool m_failed;
 private:
+	void connectProcess();
 	void resizeSharedProcessingMemory();
 
+	// process messages until all periods sent off are done
+	void waitForPendingProcessing();
+	void writeInputs( const sampleFrame * _in_buf );
+	void readOutputs( sampleFrame * _out_buf );
+	typedef LocklessList<RemoteParameterChange> ParameterChangeList;
 
-	QProcess m_process;
-	ProcessWatcher m_watcher;
+	void writeParameterChanges();
+	// the changes queued so far, oldest first, for freeing one by one
+	ParameterChangeList::Element * takeParameterChanges( int & _changes );
+	RemoteParameterBlock * parameterBlock();
+
+
+	QProcess * m_process;
+	// set while stopping the process, which then isn't a failure
+	std::atomic<bool> m_quitting;
 
 	QString m_exec;
 	QStringList m_args;
@@ -884,6 +1016,13 @@ private:
 	int m_inputCount;
 	int m_outputCount;
 
+	bool m_asyncProcessing;
+	// IdStartProcessing sent without IdProcessingDone received yet
+	int m_processingPending;
+
+	// the latest change first
+	ParameterChangeList m_parameterChanges;
+
 #ifndef SYNC_WITH_SHM_FIFO
 	int m_server;
 	QString m_socketFile;
@@ -923,6 +1062,12 @@ public:
 	{
 	}
 
+	// called before processing the period the change belongs to
+	virtual void processParameterChange( int /* _index */,
+				float /* _value */, f_cnt_t /* _offset */ )
+	{
+	}
+
 	inline float * sharedMemory()
 	{
 		return m_shm;
@@ -993,6 +1138,7 @@ private:
 #endif
 	VstSyncData * m_vstSyncData;
 	float * m_shm;
+	size_t m_shmSize;
 
 	int m_inputCount;
 	int m_outputCount;
@@ -1196,6 +1342,7 @@ RemotePluginClient::RemotePluginClient( const char * socketPath ) :
 #endif
 	m_vstSyncData( NULL ),
 	m_shm( NULL ),
+	m_shmSize( 0 ),
 	m_inputCount( 0 ),
 	m_outputCount( 0 ),
 	m_sampleRate( 44100 ),
@@ -1353,6 +1500,11 @@ bool RemotePluginClient::processMessage( const message & _m )
 							_m.getInt( 4 ) );
 			break;
 
+		case IdParameterChange:
+			processParameterChange( _m.getInt( 0 ), _m.getFloat( 1 ),
+								_m.getInt( 2 ) );
+			break;
+
 		case IdStartProcessing:
 			doProcessing();
 			reply_message.id = IdProcessingDone;
@@ -1392,6 +1544,7 @@ void RemotePluginClient::setShmKey( key_t _key, int _size )
 	if( m_shmObj.attach() || m_shmObj.error() == QSharedMemory::NoError )
 	{
 		m_shm = (float *) m_shmObj.data();
+		m_shmSize = _size;
 	}
 	else
 	{
@@ -1404,6 +1557,7 @@ void RemotePluginClient::setShmKey( key_t _key, int _size )
 	{
 		shmdt( m_shm );
 		m_shm = NULL;
+		m_shmSize = 0;
 	}
 
 	// only called for detaching SHM?
@@ -1420,6 +1574,7 @@ void RemotePluginClient::setShmKey( key_t _key, int _size )
 	else
 	{
 		m_shm = (float *) shmat( shm_id, 0, 0 );
+		m_shmSize = _size;
 	}
 #endif
 }
@@ -1431,6 +1586,24 @@ void RemotePluginClient::doProcessing()
 {
 	if( m_shm != NULL )
 	{
+		// the parameter changes of the period come after its audio,
+		// unless the channel counts just changed and the memory for
+		// them isn't there yet
+		const size_t audio = ( m_inputCount + m_outputCount ) *
+								m_bufferSize;
+		if( audio * sizeof( float ) + sizeof( RemoteParameterBlock ) <=
+								m_shmSize )
+		{
+			const RemoteParameterBlock * block =
+				(const RemoteParameterBlock *)( m_shm + audio );
+			for( int i = 0; i < block->count &&
+				i < RemoteParameterBlock::MaxChanges; ++i )
+			{
+				const RemoteParameterChange & c = block->changes[i];
+				processParameterChange( c.index, c.value, c.offset );
+			}
+		}
+
 		process( (sampleFrame *)( m_inputCount > 0 ? m_shm : NULL ),
 				(sampleFrame *)( m_shm +
 					( m_inputCount*m_bufferSize ) ) );
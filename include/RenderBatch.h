@@ -0,0 +1,105 @@
+/*
+ * RenderBatch.h - renders several projects one after the other in the same
+ *                 process
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef RENDER_BATCH_H
+#define RENDER_BATCH_H
+
+#include <memory>
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QObject>
+#include <QtCore/QVector>
+
+#include "lmms_export.h"
+#include "Mixer.h"
+#include "OutputSettings.h"
+
+class RenderManager;
+
+
+//! Renders the projects of a manifest one after the other without
+//! starting over, so the engine, the plugins discovered and loaded, the
+//! wavetables and the samples the projects share are only set up once.
+class LMMS_EXPORT RenderBatch : public QObject
+{
+	Q_OBJECT
+public:
+	struct Job
+	{
+		QString project;
+		//! The extension tells the format
+		QString output;
+	} ;
+
+	//! Reads a manifest with a project and the file to render it into per
+	//! line, separated by whitespace, paths with spaces in double quotes.
+	//! Relative paths are relative to the manifest, empty lines and lines
+	//! starting with # are skipped. Returns false and sets _error if it
+	//! couldn't be read.
+	static bool readManifest( const QString & _manifest,
+				QVector<Job> & _jobs, QString & _error );
+	//! Splits a line the way the ones of a manifest are, returns false if
+	//! a quote isn't closed
+	static bool splitFields( const QString & _line, QStringList & _fields );
+
+	RenderBatch( const QVector<Job> & _jobs,
+			const Mixer::qualitySettings & _qualitySettings,
+			const OutputSettings & _outputSettings, bool _loop );
+	virtual ~RenderBatch();
+
+	//! Number of projects which couldn't be rendered
+	int failed() const
+	{
+		return m_failed;
+	}
+
+
+public slots:
+	void start();
+	void updateConsoleProgress();
+
+
+signals:
+	void finished();
+
+
+private slots:
+	void renderNext();
+	void jobFinished();
+
+
+private:
+	const QVector<Job> m_jobs;
+	const Mixer::qualitySettings m_qualitySettings;
+	const OutputSettings m_outputSettings;
+	const bool m_loop;
+
+	std::unique_ptr<RenderManager> m_manager;
+	int m_next;
+	int m_failed;
+	QElapsedTimer m_timer;
+
+} ;
+
+
+#endif
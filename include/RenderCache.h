@@ -0,0 +1,130 @@
+/*
+ * RenderCache.h - bars of a song rendered by earlier exports, so only the
+ *                 ones which changed get rendered again
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef RENDER_CACHE_H
+#define RENDER_CACHE_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QDir>
+#include <QtCore/QVector>
+
+#include "lmms_basics.h"
+#include "lmms_export.h"
+#include "SegmentStitcher.h"
+
+class Song;
+
+
+//! A directory keeping the rendered output of each bar of a song together
+//! with a hash of everything which went into it: the patterns, automation
+//! and settings of the tracks playing in the bar, their instruments and
+//! effects, the FX mixer and the controllers. A bar has to be rendered
+//! again if its hash or one of the hashes of the pre-roll before it
+//! changed, as the tails of those reach into it. The bars which have to be
+//! rendered form runs which are rendered as segments, see
+//! Song::setExportRange(), and spliced with the cached ones by a
+//! SegmentStitcher.
+class LMMS_EXPORT RenderCache
+{
+public:
+	//! Bars from begin up to end
+	struct Run
+	{
+		bar_t begin;
+		bar_t end;
+	} ;
+
+	//! _settings identify how the bars are rendered, e.g. the sample rate
+	//! and quality, all bars are rendered again if they changed. Reads
+	//! what has been cached in _dir before.
+	RenderCache( const QString & _dir, const QByteArray & _settings,
+					bar_t _preRoll, f_cnt_t _crossfade );
+
+	bar_t preRoll() const
+	{
+		return m_preRoll;
+	}
+
+	f_cnt_t crossfade() const
+	{
+		return m_crossfade;
+	}
+
+	//! The hash of each bar of _song which an export plays
+	static QVector<QByteArray> barHashes( Song * _song );
+
+	//! Compares _hashes with the cached ones, dirtyRuns() tell which bars
+	//! have to be rendered afterwards
+	void setBarHashes( const QVector<QByteArray> & _hashes );
+
+	const QVector<Run> & dirtyRuns() const
+	{
+		return m_dirtyRuns;
+	}
+
+	int barCount() const
+	{
+		return m_bars.size();
+	}
+
+	//! A new file in the directory to render a run into
+	QString createFile();
+
+	//! Takes the bars of _run from _file, one of createFile(), at the
+	//! frames given by ProjectRenderer::barFrames() for it
+	bool addRun( const Run & _run, const QString & _file,
+					const QVector<f_cnt_t> & _barFrames );
+
+	//! The bars to be spliced, once all dirty runs are added
+	QVector<SegmentStitcher::Segment> segments() const;
+
+	//! Writes what's cached and removes the files which aren't needed
+	//! anymore, returns false if that didn't work
+	bool save();
+
+
+private:
+	struct Bar
+	{
+		QByteArray hash;
+		// relative to the directory, empty if the bar isn't cached
+		QString file;
+		f_cnt_t begin;
+		f_cnt_t frames;
+	} ;
+
+	void load();
+
+	QDir m_dir;
+	const QByteArray m_settings;
+	const bar_t m_preRoll;
+	const f_cnt_t m_crossfade;
+
+	QVector<Bar> m_cached;
+	QVector<Bar> m_bars;
+	QVector<Run> m_dirtyRuns;
+
+} ;
+
+
+#endif
@@ -0,0 +1,147 @@
+/*
+ * RenderDaemon.h - renders the projects sent to it by other processes
+ *                  without starting over for each of them
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef RENDER_DAEMON_H
+#define RENDER_DAEMON_H
+
+#include <memory>
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QList>
+#include <QtCore/QObject>
+
+#include "lmms_export.h"
+#include "Mixer.h"
+#include "OutputSettings.h"
+
+class QSocketNotifier;
+class RenderManager;
+
+
+//! Keeps the engine running and renders the jobs sent to it, like
+//! RenderBatch does for the projects of a manifest, so plugins, wavetables
+//! and samples stay loaded between them. Jobs are read from standard input
+//! or from the clients connecting to a local socket, one command per line
+//! with the fields separated like in a manifest:
+//!
+//!   render <project> <output> [<priority>]
+//!   preview <project> <output> <first bar>:<last bar> [<priority>]
+//!   cancel <id>
+//!   jobs
+//!   quit
+//!
+//! Jobs with a higher priority are rendered first, the ones with the same
+//! one in the order they were sent. The output can be a tcp:// stream, see
+//! AudioFileStream. The client is told about its jobs with lines like
+//!
+//!   queued <id>, started <id>, progress <id> <percent>,
+//!   done <id> <seconds>, failed <id> <reason>, cancelled <id>,
+//!   job <id> <queued|rendering> <priority> <project>, error <message>
+//!
+//! The jobs of a client which disconnects are cancelled.
+class LMMS_EXPORT RenderDaemon : public QObject
+{
+	Q_OBJECT
+public:
+	//! Listens on the local socket _socket, or reads standard input if
+	//! it's empty
+	RenderDaemon( const QString & _socket,
+			const Mixer::qualitySettings & _qualitySettings,
+			const OutputSettings & _outputSettings );
+	virtual ~RenderDaemon();
+
+	//! Sets up reading the commands, returns false with _error set if
+	//! that's not possible
+	bool start( QString & _error );
+
+
+signals:
+	//! After quit, or once standard input is closed and its jobs are done
+	void finished();
+
+
+private slots:
+	void acceptClient();
+	void readClient( int _fd );
+	void updateProgress( int _progress );
+	void jobFinished();
+
+
+private:
+	struct Client
+	{
+		int inFd;
+		int outFd;
+		QSocketNotifier * notifier;
+		QByteArray pending;
+	} ;
+
+	struct Job
+	{
+		int id;
+		int priority;
+		QString project;
+		QString output;
+		// bars of a preview, 0 for the whole project
+		int firstBar;
+		int lastBar;
+		Client * client;
+	} ;
+
+	void handleCommand( Client * _client, const QString & _line );
+	void queueJob( Client * _client, const QStringList & _fields,
+							bool _preview );
+	void cancelJob( Client * _client, int _id );
+	void send( Client * _client, const QString & _line );
+	void removeClient( Client * _client );
+
+	//! Renders the next job unless one is being rendered
+	void renderNext();
+	void finishJob( const QString & _status );
+	void quit();
+
+	const QString m_socketPath;
+	const Mixer::qualitySettings m_qualitySettings;
+	const OutputSettings m_outputSettings;
+
+	int m_listenFd;
+	QSocketNotifier * m_listenNotifier;
+	QList<Client *> m_clients;
+	// no more commands are expected, finish once the jobs are done
+	bool m_closing;
+	// nothing is rendered anymore
+	bool m_quit;
+
+	// ordered by priority, then by id
+	QList<Job> m_queue;
+	int m_nextId;
+
+	std::unique_ptr<RenderManager> m_manager;
+	Job m_current;
+	int m_progress;
+	QElapsedTimer m_timer;
+
+} ;
+
+
+#endif
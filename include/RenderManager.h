@@ -30,6 +30,8 @@
 
 #include "ProjectRenderer.h"
 #include "OutputSettings.h"
+#include "RenderCache.h"
+#include "StemExporter.h"
 
 
 class RenderManager : public QObject
@@ -47,24 +49,36 @@ public:
 	/// Export all unmuted tracks into a single file
 	void renderProject();
 
-	/// Export all unmuted tracks into individual file
-	void renderTracks();
+	/// Export all unmuted tracks and FX channels into individual files,
+	/// taken during a single render of the whole mix
+	void renderTracks(
+		StemExporter::TapPoints tapPoint = StemExporter::PostEffects );
+
+	/// Export into a single file, rendering only the bars which changed
+	/// since the last export into the cache in cacheDir again
+	void renderIncrementally( const QString & cacheDir, bar_t preRoll,
+							f_cnt_t crossfade );
 
 	void abortProcessing();
 
+public slots:
+	void updateConsoleProgress();
+
 signals:
 	void progressChanged( int );
 	void finished();
 
 private slots:
-	void renderNextTrack();
-	void updateConsoleProgress();
+	void renderFinished();
+	void runFinished();
 
 private:
-	QString pathForTrack( const Track *track, int num );
-	void restoreMutedState();
+	QString pathForStem( const QString & prefix,
+				const QString & stemName ) const;
 
 	void render( QString outputPath );
+	void renderNextRun();
+	void finishIncrementally();
 
 	const Mixer::qualitySettings m_qualitySettings;
 	const Mixer::qualitySettings m_oldQualitySettings;
@@ -73,9 +87,11 @@ private:
 	QString m_outputPath;
 
 	std::unique_ptr<ProjectRenderer> m_activeRenderer;
+	std::unique_ptr<StemExporter> m_stems;
 
-	QVector<Track*> m_tracksToRender;
-	QVector<Track*> m_unmuted;
+	std::unique_ptr<RenderCache> m_cache;
+	int m_nextRun;
+	QString m_runFile;
 } ;
 
 #endif
@@ -0,0 +1,73 @@
+/*
+ * RenderStatsExporter.h - sends the render stats of the mixer as OSC
+ *                         messages over UDP
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef RENDER_STATS_EXPORTER_H
+#define RENDER_STATS_EXPORTER_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QThread>
+
+#include <atomic>
+
+#include "Mixer.h"
+
+
+//! Collects Mixer::renderStats() in a thread of its own and sends a
+//! summary every Interval milliseconds as OSC message
+//!
+//!   /lmms/stats ,sfiiiii <host name> <maximum load> <voices> <effects>
+//!                        <jobs> <memory KiB> <memory high water KiB>
+//!
+//! to a UDP port, so many machines can be watched from one place. The
+//! load is the maximum of the interval, everything else the latest value.
+//! Not available on Windows.
+class LMMS_EXPORT RenderStatsExporter : public QThread
+{
+public:
+	static const int Interval = 250;
+
+	//! _target is "host:port"
+	RenderStatsExporter( const QString & _target );
+	~RenderStatsExporter() override;
+
+	//! Whether _target could be resolved and a socket be opened
+	bool isValid() const
+	{
+		return m_socket >= 0;
+	}
+
+
+private:
+	void run() override;
+	void send( const Mixer::RenderStats & _stats, float _maximumLoad );
+
+	LocklessRingBufferReader<Mixer::RenderStats> m_reader;
+	std::atomic_bool m_quit;
+	QByteArray m_hostName;
+	int m_socket;
+	QByteArray m_address;
+
+} ;
+
+
+#endif
@@ -28,6 +28,9 @@
 
 #include <QtCore/QReadWriteLock>
 #include <QtCore/QObject>
+#include <QtCore/QStringList>
+
+#include <memory>
 
 #include <samplerate.h>
 
@@ -37,16 +40,25 @@
 #include "lmms_math.h"
 #include "shared_object.h"
 #include "MemoryManager.h"
+#include "PolyphaseResampler.h"
+#include "SampleCache.h"
+#include "SamplePeaks.h"
 
 
+class QFileInfo;
 class QPainter;
 class QRect;
+class SampleStream;
+
+// interpolation mode of handleState next to the converter types of libsamplerate,
+// resamples with PolyphaseResampler instead
+const int POLYPHASE_INTERPOLATION = SRC_LINEAR + 1;
 
 // values for buffer margins, used for various libsamplerate interpolation modes
 // the array positions correspond to the converter_type parameter values in libsamplerate
 // if there appears problems with playback on some interpolation mode, then the value for that mode
 // may need to be higher - conversely, to optimize, some may work with lower values
-const f_cnt_t MARGIN[] = { 64, 64, 64, 4, 4 };
+const f_cnt_t MARGIN[] = { 64, 64, 64, 4, 4, PolyphaseResampler::Margin };
 
 class LMMS_EXPORT SampleBuffer : public QObject, public sharedObject
 {
@@ -90,13 +102,23 @@ public:
 			return m_interpolationMode;
 		}
 
+		//! Prepares a state for playing another note from the start,
+		//! so a pooled one can be reused instead of constructing one
+		void reset( bool _varying_pitch );
+
 
 	private:
 		f_cnt_t m_frameIndex;
-		const bool m_varyingPitch;
+		bool m_varyingPitch;
 		bool m_isBackwards;
 		SRC_STATE * m_resamplingData;
 		int m_interpolationMode;
+		// linear resampler used instead of sinc while the mixer is
+		// overloaded, see Mixer::CheapInterpolation
+		SRC_STATE * m_cheapResamplingData;
+		bool m_usingCheapResampling;
+		// used instead of m_resamplingData with POLYPHASE_INTERPOLATION
+		PolyphaseResampler * m_polyphaseResampler;
 
 		friend class SampleBuffer;
 
@@ -220,6 +242,77 @@ public:
 
 	// protect calls from the GUI to this function with dataReadLock() and
 	// dataUnlock()
+	//! Files too long to be kept in memory are played from disk then, see
+	//! SampleStream. Only play() and visualize() support such buffers,
+	//! their data() just holds a single frame.
+	void setStreamingEnabled( bool _enabled )
+	{
+		m_streamingEnabled = _enabled;
+	}
+
+	//! Streams every file longer than the head SampleStream reads up front
+	//! rather than only long ones, for previews which should start right
+	//! away and not keep whole files in memory. Needs streaming enabled.
+	void setEagerStreaming( bool _eager )
+	{
+		m_eagerStreaming = _eager;
+	}
+
+	bool isStreaming() const
+	{
+		return m_stream != NULL;
+	}
+
+	//! Gets streamed frames from _frame on ready ahead of playing them,
+	//! they'd be silent for a moment otherwise. Nothing to do for buffers
+	//! held in memory.
+	void cue( f_cnt_t _frame );
+
+	//! Files with 16 bit resolution or less are kept as 16 bit integers
+	//! then, which halves their memory. Like for streaming, only play()
+	//! and visualize() support such buffers.
+	void setCompactStorage( bool _enabled )
+	{
+		m_compactEnabled = _enabled;
+	}
+
+	bool isCompact() const
+	{
+		return m_compactData != NULL;
+	}
+
+	//! Files set while a project is loaded in the GUI are decoded on a
+	//! thread pool then, the buffer keeps its previous data until it's
+	//! done and emits sampleUpdated() once it's swapped in
+	void setBackgroundDecoding( bool _enabled )
+	{
+		m_backgroundDecoding = _enabled;
+	}
+
+	bool isDecoding() const
+	{
+		return m_decodeJob != nullptr;
+	}
+
+	//! Waits for the background decoding of all buffers and swaps in what
+	//! they decoded, before playing or exporting. GUI thread only.
+	static void waitForDecoding();
+
+	//! Stretches the sample on a thread pool to play _speed times as fast
+	//! at the same pitch and shifted by _semitones, e.g. to fit a loop to
+	//! the song's tempo. The result is kept in the SampleCache, so buffers
+	//! of the same file and settings share it. stretched() is NULL until
+	//! it's done and stretchUpdated() emitted, and it's stretched again
+	//! once the sample changes. A speed of 1 without a shift drops it.
+	//! GUI thread only, streamed buffers aren't stretched.
+	void setStretch( double _speed, int _semitones );
+
+	//! The buffer setStretch() made or NULL, ref() it for keeping it
+	SampleBuffer * stretched() const
+	{
+		return m_stretched;
+	}
+
 	SampleBuffer * resample( const sample_rate_t _src_sr,
 						const sample_rate_t _dst_sr );
 
@@ -254,6 +347,12 @@ public:
 	static QString tryToMakeRelative( const QString & _file );
 	static QString tryToMakeAbsolute(const QString & file);
 
+	//! Decodes _files in parallel into the SampleCache, so the buffers
+	//! loading them afterwards share the data instead of decoding one file
+	//! after the other. Returns the buffers holding the data, which is
+	//! freed once they're unref'ed unless it's used by then.
+	static QList<SampleBuffer *> prefetch( const QStringList & _files );
+
 
 public slots:
 	void setAudioFile( const QString & _audio_file );
@@ -264,10 +363,62 @@ public slots:
 	void setReversed( bool _on );
 	void sampleRateChanged();
 
+private slots:
+	void finishDecoding();
+	void finishStretching();
+
 private:
+	class PrefetchTask;
+	class DecodeTask;
+	struct DecodeJob;
+	class StretchTask;
+	struct StretchJob;
+
 	static sample_rate_t mixerSampleRate();
 
 	void update( bool _keep_settings = false );
+	//! Load m_data from m_audioFile or m_origData, returns false if the
+	//! file exceeds the size limits
+	bool decode( bool _keep_settings );
+	//! With _keep_settings, the result keeps the frames set, converted to
+	//! the new rate, like update( true )
+	void decodeInBackground( bool _keep_settings = false );
+	//! Forgets about the background decoding, e.g. if the file changed
+	void cancelDecoding();
+	void reportLoadError();
+	//! The key of the data decoded from _file in the SampleCache
+	SampleCache::Key cacheKey( const QFileInfo & _file ) const;
+
+	//! Stretches the data for the settings of setStretch() again
+	void updateStretched();
+	void cancelStretching();
+	//! Swaps in _stretched for stretched(), which it owns
+	void setStretched( SampleBuffer * _stretched );
+	//! Makes _data with _frames frames, which is from the SampleCache if
+	//! _shared, the buffer's data, for buffers without any yet
+	void adoptData( sampleFrame * _data, f_cnt_t _frames, bool _shared );
+
+	//! Frees m_data or releases it if it's shared through the SampleCache
+	void freeData();
+	//! Same for m_compactData
+	void freeCompactData();
+	//! Moves m_data into m_compactData
+	void compactData();
+	//! Sets m_peaks, from the SampleCache if the data is shared and
+	//! another buffer built them already
+	void buildPeaks();
+	//! Minimum and maximum of each channel from _begin to _end for
+	//! visualize()
+	void peakRange( f_cnt_t _begin, f_cnt_t _end, float * _min,
+						float * _max ) const;
+	//! m_data + _index if it isn't compact, otherwise the converted frames
+	//! in _tmp
+	sampleFrame * framesAt( f_cnt_t _index, f_cnt_t _frames,
+						sampleFrame * _tmp ) const;
+	void copyFrames( sampleFrame * _dst, f_cnt_t _index,
+						f_cnt_t _frames ) const;
+	void copyFramesBackwards( sampleFrame * _dst, f_cnt_t _index,
+						f_cnt_t _frames ) const;
 
 	void convertIntToFloat ( int_sample_t * & _ibuf, f_cnt_t _frames, int _channels);
 	void directFloatWrite ( sample_t * & _fbuf, f_cnt_t _frames, int _channels);
@@ -288,6 +439,19 @@ private:
 	sampleFrame * m_origData;
 	f_cnt_t m_origFrames;
 	sampleFrame * m_data;
+	// m_data is from the SampleCache and must not be modified
+	bool m_dataShared;
+	bool m_streamingEnabled;
+	bool m_eagerStreaming;
+	SampleStream * m_stream;
+	bool m_compactEnabled;
+	// interleaved stereo frames replacing m_data
+	qint16 * m_compactData;
+	// m_compactData is from the SampleCache
+	bool m_compactShared;
+	// of m_data or m_compactData, built while decoding files and
+	// otherwise when first needed
+	SamplePeaksPtr m_peaks;
 	QReadWriteLock m_varLock;
 	f_cnt_t m_frames;
 	f_cnt_t m_startFrame;
@@ -298,10 +462,17 @@ private:
 	bool m_reversed;
 	float m_frequency;
 	sample_rate_t m_sampleRate;
+	bool m_backgroundDecoding;
+	std::shared_ptr<DecodeJob> m_decodeJob;
+
+	double m_stretchSpeed;
+	int m_stretchSemitones;
+	SampleBuffer * m_stretched;
+	std::shared_ptr<StretchJob> m_stretchJob;
 
 	sampleFrame * getSampleFragment( f_cnt_t _index, f_cnt_t _frames,
 						LoopMode _loopmode,
-						sampleFrame * * _tmp,
+						sampleFrame * _tmp,
 						bool * _backwards, f_cnt_t _loopstart, f_cnt_t _loopend,
 						f_cnt_t _end ) const;
 	f_cnt_t getLoopedIndex( f_cnt_t _index, f_cnt_t _startf, f_cnt_t _endf  ) const;
@@ -310,6 +481,7 @@ private:
 
 signals:
 	void sampleUpdated();
+	void stretchUpdated();
 
 } ;
 
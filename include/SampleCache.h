@@ -0,0 +1,109 @@
+/*
+ * SampleCache.h - decoded samples shared by all sample buffers loading the
+ *                 same file
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef SAMPLE_CACHE_H
+#define SAMPLE_CACHE_H
+
+#include <QtCore/QString>
+
+#include "lmms_basics.h"
+#include "lmms_export.h"
+#include "SamplePeaks.h"
+
+
+//! Decoding a file yields the same data for every SampleBuffer with the
+//! same sample rate and direction, so SampleBuffer keeps decoded files in
+//! here and buffers loading them again share that data instead of decoding
+//! and storing it once more. Shared data is never modified, a buffer which
+//! changes any of the key's properties decodes into its own entry.
+//! Entries are freed once the last buffer using them releases them, unless
+//! a budget for keeping them is set. With a disk cache they're also written
+//! to files holding the data as it is in memory, which later runs map
+//! instead of decoding and resampling the samples again. The pages of the
+//! mapped files are shared by all processes using them.
+class LMMS_EXPORT SampleCache
+{
+public:
+	struct Key
+	{
+		QString file;
+		// modification time in ms since the epoch, so edited files
+		// are decoded again
+		qint64 modified;
+		sample_rate_t sampleRate;
+		bool reversed;
+		// 0 for the data as decoded, otherwise the speed it's been
+		// stretched to play at and the semitones it's been shifted
+		// by, see SampleBuffer::setStretch()
+		double speed;
+		int semitones;
+	} ;
+
+	//! The data decoded for _key or NULL, sets _frames. Release data
+	//! returned by it.
+	static sampleFrame * acquire( const Key & _key, f_cnt_t & _frames );
+
+	//! Takes ownership of _data, allocated by MM_ALLOC_TAGGED(), and
+	//! returns the data to use - another thread may have added the same
+	//! file meanwhile. Release it as well.
+	static sampleFrame * insert( const Key & _key, sampleFrame * _data,
+							f_cnt_t _frames );
+
+	//! Like acquire() and insert() for 16 bit data of buffers with compact
+	//! storage, kept apart from the float data of the same file
+	static qint16 * acquireCompact( const Key & _key, f_cnt_t & _frames );
+	static qint16 * insertCompact( const Key & _key, qint16 * _data,
+							f_cnt_t _frames );
+
+	static void release( const void * _data );
+
+	//! The peaks built for _data, data returned by the functions above,
+	//! or NULL if there are none yet
+	static SamplePeaksPtr peaks( const void * _data );
+	//! Keeps _peaks with the entry of _data, if it's still there
+	static void setPeaks( const void * _data,
+					const SamplePeaksPtr & _peaks );
+
+	//! Keeps up to _bytes of entries which aren't used anymore, e.g. while
+	//! rendering several projects sharing samples one after the other.
+	//! The ones released first are freed first, 0 frees them right away.
+	static void setRetainBudget( size_t _bytes );
+
+	//! Keeps the entries of files in _dir as well, an empty _dir turns the
+	//! disk cache off. The files are named after a hash of the contents of
+	//! the sample and the properties of the key other than its path, the
+	//! ones written first are removed once there are more than
+	//! DiskCacheBytes of them.
+	static void setDiskCacheDir( const QString & _dir );
+	//! Where the disk cache goes if it's enabled in the settings
+	static QString defaultDiskCacheDir();
+
+	static const qint64 DiskCacheBytes = 4LL * 1024 * 1024 * 1024;
+
+	//! Number of distinct entries, e.g. for tests
+	static int size();
+
+} ;
+
+
+#endif
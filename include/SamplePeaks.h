@@ -0,0 +1,74 @@
+/*
+ * SamplePeaks.h - minimum and maximum of a sample at several resolutions,
+ *                 for drawing its waveform
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef SAMPLE_PEAKS_H
+#define SAMPLE_PEAKS_H
+
+#include <memory>
+#include <vector>
+
+#include "lmms_basics.h"
+#include "lmms_export.h"
+
+
+//! The minimum and maximum of both channels of every bucket of
+//! 2^(BaseBucketBits + level) frames, for every level up to a single
+//! bucket. The range of any span of at least BaseBucket frames is looked up
+//! from the few buckets of the level matching its length, so drawing a
+//! waveform costs the same at any zoom. Built once per decoded sample and
+//! shared through the SampleCache like the data.
+class LMMS_EXPORT SamplePeaks
+{
+public:
+	static const int BaseBucketBits = 6;
+	static const f_cnt_t BaseBucket = 1 << BaseBucketBits;
+
+	SamplePeaks( const sampleFrame * _data, f_cnt_t _frames );
+	//! From interleaved stereo 16 bit data, see SampleBuffer
+	SamplePeaks( const qint16 * _data, f_cnt_t _frames );
+
+	//! Minimum and maximum of each channel from _begin to _end, which
+	//! may include up to a bucket around them
+	void range( f_cnt_t _begin, f_cnt_t _end,
+				float _min[DEFAULT_CHANNELS],
+				float _max[DEFAULT_CHANNELS] ) const;
+
+
+private:
+	template<class Sample>
+	void build( const Sample * _data, f_cnt_t _frames, float _scale );
+
+	// every bucket is the minimum and maximum of each channel, as 16 bit
+	// values of the range from -1 to 1
+	static const int ValuesPerBucket = 2 * DEFAULT_CHANNELS;
+
+	f_cnt_t m_frames;
+	std::vector<std::vector<qint16> > m_levels;
+
+} ;
+
+
+typedef std::shared_ptr<const SamplePeaks> SamplePeaksPtr;
+
+
+#endif
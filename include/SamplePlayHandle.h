@@ -40,6 +40,8 @@ class SamplePlayHandle : public PlayHandle
 {
 public:
 	SamplePlayHandle( SampleBuffer* sampleBuffer , bool ownAudioPort = true );
+	//! For previews, plays the file from disk unless it's short, see
+	//! SampleBuffer::setEagerStreaming()
 	SamplePlayHandle( const QString& sampleFile );
 	SamplePlayHandle( SampleTCO* tco );
 	virtual ~SamplePlayHandle();
@@ -82,6 +84,8 @@ private:
 
 	f_cnt_t m_frame;
 	SampleBuffer::handleState m_state;
+	// of the sample's own speed, see SampleTCO::playbackSpeed()
+	double m_speed;
 
 	const bool m_ownAudioPort;
 
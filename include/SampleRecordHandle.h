@@ -26,13 +26,11 @@
 #ifndef SAMPLE_RECORD_HANDLE_H
 #define SAMPLE_RECORD_HANDLE_H
 
-#include <QtCore/QList>
-#include <QtCore/QPair>
-
 #include "MidiTime.h"
 #include "PlayHandle.h"
 
 class BBTrack;
+class RecordingWriter;
 class SampleBuffer;
 class SampleTCO;
 class Track;
@@ -50,15 +48,14 @@ public:
 	bool isFromTrack( const Track * _track ) const override;
 
 	f_cnt_t framesRecorded() const;
+	// finishes the recording and loads it from its file, NULL if it
+	// couldn't be written
 	void createSampleBuffer( SampleBuffer * * _sample_buf );
 
 
 private:
-	virtual void writeBuffer( const sampleFrame * _ab,
-						const f_cnt_t _frames );
-
-	typedef QList<QPair<sampleFrame *, f_cnt_t> > bufferList;
-	bufferList m_buffers;
+	// streams the recording to a file in the samples directory
+	RecordingWriter * m_writer;
 	f_cnt_t m_framesRecorded;
 	MidiTime m_minLength;
 
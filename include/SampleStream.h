@@ -0,0 +1,132 @@
+/*
+ * SampleStream.h - plays long audio files from disk instead of loading them
+ *                  into memory
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef SAMPLE_STREAM_H
+#define SAMPLE_STREAM_H
+
+#include <atomic>
+
+#include <QtCore/QFile>
+#include <QtCore/QString>
+
+#include <samplerate.h>
+#include <sndfile.h>
+
+#include "lmms_basics.h"
+#include "MemoryManager.h"
+
+
+//! Frames of a file, resampled to the given rate, for files too long to be
+//! kept in memory. The first HeadSeconds are read up front so playback
+//! starts instantly. The rest is read ahead by a background thread into a
+//! ring of RingSeconds around the position read last. read() never waits:
+//! frames which haven't arrived yet, e.g. right after jumping elsewhere in
+//! the file, are silent. Memory use doesn't depend on the file's length,
+//! apart from the overview visualize() draws from, one peak per
+//! OverviewBlock frames.
+class SampleStream
+{
+	MM_OPERATORS
+public:
+	static const int HeadSeconds = 4;
+	static const int RingSeconds = 8;
+	static const f_cnt_t OverviewBlock = 1024;
+
+	SampleStream( const QString & _file, sample_rate_t _sampleRate );
+	~SampleStream();
+
+	bool isValid() const
+	{
+		return m_frames > 0;
+	}
+
+	f_cnt_t frames() const
+	{
+		return m_frames;
+	}
+
+	//! Copies _frames frames starting at _index to _dst, lock-free
+	void read( f_cnt_t _index, sampleFrame * _dst, f_cnt_t _frames );
+
+	//! Has the background thread read from _index on if it wouldn't get
+	//! there otherwise, for playback about to start at _index. Lock-free,
+	//! but moves the window away from any playback in progress.
+	void cue( f_cnt_t _index );
+
+	//! Peaks of both channels of the block _frame is in, zero until the
+	//! background thread got there
+	void peak( f_cnt_t _frame, float & _left, float & _right ) const;
+
+	//! For the background thread, returns false if there's nothing to do
+	bool fill();
+
+
+private:
+	//! Whether the background thread gets to _index by reading on from
+	//! _window
+	bool isInReach( quint64 _window, f_cnt_t _index ) const;
+	void seekFile( f_cnt_t _frame );
+	//! Reads and resamples up to _frames frames at the current position
+	f_cnt_t produce( sampleFrame * _dst, f_cnt_t _frames );
+	bool scanOverview();
+
+	QFile m_qfile;
+	SNDFILE * m_file;
+	SF_INFO m_info;
+	double m_ratio;
+	f_cnt_t m_frames;
+	// frames behind the read position kept in the ring, e.g. for loops
+	f_cnt_t m_keepFrames;
+
+	sampleFrame * m_head;
+	f_cnt_t m_headFrames;
+
+	// the frames of the window are in the ring at their index modulo
+	// m_ringFrames. Its start is in the upper 32 bits of m_window and
+	// its end in the lower ones, so readers get both at once.
+	sampleFrame * m_ring;
+	f_cnt_t m_ringFrames;
+	std::atomic<quint64> m_window;
+	std::atomic<f_cnt_t> m_readPosition;
+	std::atomic<f_cnt_t> m_seekRequest;
+
+	// used by the background thread only
+	SRC_STATE * m_resampler;
+	float * m_fileBuffer;
+	sampleFrame * m_pending;
+	f_cnt_t m_pendingOffset;
+	f_cnt_t m_pendingFrames;
+	bool m_endOfFile;
+	sampleFrame * m_chunk;
+	f_cnt_t m_chunkFrames;
+
+	QFile m_scanQFile;
+	SNDFILE * m_scanFile;
+	sampleFrame * m_overview;
+	f_cnt_t m_overviewBlocks;
+	std::atomic<f_cnt_t> m_overviewScanned;
+
+} ;
+
+
+#endif
@@ -65,6 +65,26 @@ public:
 		return m_sampleBuffer;
 	}
 
+	//! What's played, the sample fitted to the song's tempo and shifted
+	//! by the semitones set, or the sample itself until that's done
+	SampleBuffer* playbackBuffer();
+	//! How much faster than at its own rate playbackBuffer() is played,
+	//! which keeps a sample synced to the tempo in time until it's
+	//! stretched
+	double playbackSpeed() const;
+
+	//! The tempo the sample has been recorded at, 0 to play it at its own
+	//! speed instead of stretching it to the song's tempo
+	float sampleTempo() const
+	{
+		return m_sampleTempo;
+	}
+
+	int semitones() const
+	{
+		return m_semitones;
+	}
+
 	MidiTime sampleLength() const;
 	void setSampleStartFrame( f_cnt_t startFrame );
 	void setSamplePlayLength( f_cnt_t length );
@@ -81,12 +101,21 @@ public slots:
 	void toggleRecord();
 	void playbackPositionChanged();
 	void updateTrackTcos();
+	void setSampleTempo( float _tempo );
+	void setSemitones( int _semitones );
+	//! Has the sample stretched for the song's tempo and the semitones
+	void updateStretch();
 
 
 private:
+	//! How much faster than its own tempo the song plays the sample
+	double tempoRatio() const;
+
 	SampleBuffer* m_sampleBuffer;
 	BoolModel m_recordModel;
 	bool m_isPlaying;
+	float m_sampleTempo;
+	int m_semitones;
 
 
 	friend class SampleTCOView;
@@ -109,6 +138,8 @@ public:
 
 public slots:
 	void updateSample();
+	void setSampleTempo();
+	void setSemitones();
 
 
 
@@ -124,7 +155,6 @@ protected:
 
 private:
 	SampleTCO * m_tco;
-	QPixmap m_paintPixmap;
 } ;
 
 
@@ -182,6 +212,17 @@ public slots:
 	void updateEffectChannel();
 
 private:
+	//! Clip starts within this time are prepared ahead, streamed samples
+	//! need a while to be read from disk
+	static const int CueMilliseconds = 300;
+
+	//! Lets the clips which start playing within CueMilliseconds of
+	//! _start, or where the song loops back to then, get their samples
+	//! ready
+	void cueUpcomingTcos( const MidiTime & _start );
+	//! The frame of the sample of _tco playing at _time
+	static f_cnt_t sampleFrameAt( SampleTCO * _tco, const MidiTime & _time );
+
 	FloatModel m_volumeModel;
 	FloatModel m_panningModel;
 	IntModel m_effectChannelModel;
@@ -0,0 +1,103 @@
+/*
+ * ScratchArena.h - temporary buffers for rendering which don't go through
+ *                  the allocator
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef SCRATCH_ARENA_H
+#define SCRATCH_ARENA_H
+
+#include <cstddef>
+
+#include "lmms_export.h"
+#include "MemoryManager.h"
+
+
+//! A block per thread which scratch buffers are taken from like from a
+//! stack, so they cost a pointer increment and are mostly in cache
+//! already. Use ScratchBuffer instead of calling this directly.
+class LMMS_EXPORT ScratchArena
+{
+public:
+	static const size_t Capacity = 256 * 1024;
+
+	//! NULL if the arena of the calling thread is full
+	static void * push( size_t _bytes );
+	//! Release _ptr and everything pushed after it
+	static void pop( void * _ptr );
+
+	//! Allocate the arena of the calling thread, otherwise that happens
+	//! on first use
+	static void prepareThread();
+
+} ;
+
+
+//! Uninitialized buffer of _count T for the current scope. Falls back to
+//! MemoryManager if the arena is full.
+template<typename T>
+class ScratchBuffer
+{
+public:
+	ScratchBuffer( size_t _count ) :
+		m_data( static_cast<T *>( ScratchArena::push( sizeof( T ) * _count ) ) ),
+		m_fromArena( m_data != NULL )
+	{
+		if( !m_fromArena )
+		{
+			m_data = static_cast<T *>( MemoryManager::alloc(
+				sizeof( T ) * _count, MemoryManager::PeriodBuffers ) );
+		}
+	}
+
+	~ScratchBuffer()
+	{
+		if( m_fromArena )
+		{
+			ScratchArena::pop( m_data );
+		}
+		else
+		{
+			MemoryManager::free( m_data );
+		}
+	}
+
+	ScratchBuffer( const ScratchBuffer & ) = delete;
+	ScratchBuffer & operator=( const ScratchBuffer & ) = delete;
+
+	T * data()
+	{
+		return m_data;
+	}
+
+	T & operator[]( size_t _index )
+	{
+		return m_data[_index];
+	}
+
+
+private:
+	T * m_data;
+	const bool m_fromArena;
+
+} ;
+
+
+#endif
@@ -0,0 +1,96 @@
+/*
+ * SegmentStitcher.h - joins segments of a song rendered separately
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef SEGMENT_STITCHER_H
+#define SEGMENT_STITCHER_H
+
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+#include "lmms_basics.h"
+#include "lmms_export.h"
+
+class AudioFileDevice;
+
+
+//! Joins the files of the segments of a song which have been rendered by
+//! several processes, see Song::setExportRange(). Each segment but the
+//! last ends with the tail of frames which the next one begins with, the
+//! two get crossfaded. As the pre-roll of the next segment should have
+//! brought it to the same state, the difference of the overlapping frames
+//! tells whether the pre-roll was long enough.
+class LMMS_EXPORT SegmentStitcher
+{
+public:
+	//! Part of a file taken as segment, including the tail
+	struct Segment
+	{
+		QString file;
+		f_cnt_t begin;
+		//! -1 up to the end of the file
+		f_cnt_t frames;
+	} ;
+
+	//! Takes each file as a whole
+	SegmentStitcher( const QStringList & _segments, f_cnt_t _crossfade );
+	//! Takes parts of files, e.g. the cached bars of a song, see
+	//! RenderCache. Files can be used for several segments.
+	SegmentStitcher( const QVector<Segment> & _segments, f_cnt_t _crossfade );
+
+	//! Checks that all segments can be read and share the sample rate,
+	//! returns false and sets errorString() otherwise
+	bool open();
+
+	sample_rate_t sampleRate() const
+	{
+		return m_sampleRate;
+	}
+
+	//! Writes the segments as one to _device, whose sample rate has to be
+	//! sampleRate(). Returns false if a segment couldn't be read.
+	bool stitch( AudioFileDevice * _device );
+
+	//! Largest difference of two overlapping frames at each joint, as
+	//! amplitude, available after stitch()
+	const QVector<float> & differences() const
+	{
+		return m_differences;
+	}
+
+	const QString & errorString() const
+	{
+		return m_error;
+	}
+
+
+private:
+	QVector<Segment> m_segments;
+	const f_cnt_t m_crossfade;
+	sample_rate_t m_sampleRate;
+
+	QVector<float> m_differences;
+	QString m_error;
+
+} ;
+
+
+#endif
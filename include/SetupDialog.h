@@ -97,6 +97,21 @@ private slots:
 	void toggleHQAudioDev(bool enabled);
 	void setBufferSize(int value);
 	void resetBufferSize();
+	void toggleWorkStealing(bool enabled);
+	void toggleRenderGraph(bool enabled);
+	void toggleRealtimeThreads(bool enabled);
+	void togglePinThreads(bool enabled);
+	void toggleHugePages(bool enabled);
+	void toggleAnticipative(bool enabled);
+	void toggleBBLoopCache(bool enabled);
+	void toggleAsyncRemotePlugins(bool enabled);
+	void togglePrestartRemotePlugins(bool enabled);
+	void toggleReserveNotes(bool enabled);
+	void toggleSampleDiskCache(bool enabled);
+	void toggleOverloadInterpolation(bool enabled);
+	void toggleOverloadEffects(bool enabled);
+	void toggleOverloadNotes(bool enabled);
+	void setSpinTime(int value);
 
 	// MIDI settings widget.
 	void midiInterfaceChanged(const QString & driver);
@@ -122,6 +137,8 @@ private slots:
 	void showRestartWarning();
 
 private:
+	void setOverloadMeasure(int measure, bool enabled);
+
 	TabBar * m_tabBar;
 
 	// General settings widgets.
@@ -170,6 +187,21 @@ private:
 	int m_bufferSize;
 	QSlider * m_bufferSizeSlider;
 	QLabel * m_bufferSizeLbl;
+	bool m_workStealing;
+	bool m_renderGraph;
+	bool m_realtimeThreads;
+	bool m_pinThreads;
+	bool m_hugePages;
+	bool m_anticipative;
+	bool m_bbLoopCache;
+	bool m_asyncRemotePlugins;
+	bool m_prestartRemotePlugins;
+	bool m_reserveNotes;
+	bool m_sampleDiskCache;
+	int m_overloadPolicy;
+	int m_spinTime;
+	QSlider * m_spinTimeSlider;
+	QLabel * m_spinTimeLbl;
 
 	// MIDI settings widgets.
 	QComboBox * m_midiInterfaces;
@@ -26,6 +26,7 @@
 #define SONG_H
 
 #include <utility>
+#include <vector>
 
 #include <QtCore/QSharedMemory>
 #include <QtCore/QVector>
@@ -40,6 +41,7 @@
 class AutomationTrack;
 class Pattern;
 class TimeLineWidget;
+class TrackSnapshots;
 
 
 const bpm_t MinTempo = 10;
@@ -235,6 +237,39 @@ public:
 		m_renderBetweenMarkers = renderBetweenMarkers;
 	}
 
+	//! Export only from _begin to _end, e.g. one segment of a song rendered
+	//! by several processes. Playing starts _preRoll earlier, so effect
+	//! tails and note releases from before _begin are there. _tailFrames
+	//! frames of the output beyond _end are kept for crossfading with the
+	//! next segment, see SegmentStitcher.
+	void setExportRange( const MidiTime & _begin, const MidiTime & _end,
+				const MidiTime & _preRoll, f_cnt_t _tailFrames );
+	void clearExportRange()
+	{
+		m_hasExportRange = false;
+	}
+	bool hasExportRange() const
+	{
+		return m_hasExportRange;
+	}
+	f_cnt_t exportRangeTail() const
+	{
+		return m_exportRangeTail;
+	}
+	//! Frames of the period just played from _first up to _last which lie
+	//! within the export range, with _first == _last if there are none
+	void exportRangeFrames( f_cnt_t & _first, f_cnt_t & _last ) const
+	{
+		_first = m_exportRangeFirst;
+		_last = m_exportRangeLast;
+	}
+	//! Frames of the period just played at which bars of the export range
+	//! start, including the bar the range ends with
+	const QVector<f_cnt_t> & exportRangeBars() const
+	{
+		return m_exportRangeBars;
+	}
+
 	inline PlayModes playMode() const
 	{
 		return m_playMode;
@@ -269,7 +304,10 @@ public:
 	}
 
 	//TODO: Add Q_DECL_OVERRIDE when Qt4 is dropped
-	AutomatedValueMap automatedValuesAt(MidiTime time, int tcoNum = -1) const override;
+	TrackList automationTracks() const override
+	{
+		return TrackList{m_globalAutomationTrack} << tracks();
+	}
 
 	// file management
 	void createNewProject();
@@ -278,6 +316,16 @@ public:
 	bool guiSaveProject();
 	bool guiSaveProjectAs( const QString & filename );
 	bool saveProjectFile( const QString & filename );
+	//! Saves the song into _dataFile, taking the tracks which haven't
+	//! changed from _snapshots if given
+	void saveProject( DataFile & _dataFile,
+					TrackSnapshots * _snapshots = NULL );
+
+	//! The snapshots the tracks are saved from, while saving
+	TrackSnapshots * trackSnapshots() const
+	{
+		return m_trackSnapshots;
+	}
 
 	const QString & projectFileName() const
 	{
@@ -330,6 +378,11 @@ public:
 		return m_timeSigModel;
 	}
 
+	IntModel & getTempoModel()
+	{
+		return m_tempoModel;
+	}
+
 	void exportProjectMidi(QString const & exportFileName) const;
 
 	inline void setLoadOnLauch(bool value) { m_loadOnLaunch = value; }
@@ -405,7 +458,34 @@ private:
 
 	void removeAllControllers();
 
-	void processAutomations(const TrackList& tracks, MidiTime timeStart, fpp_t frames);
+	// the pieces a period is played in, one per tick
+	struct PlaybackChunk
+	{
+		MidiTime start;
+		f_cnt_t frames;
+		f_cnt_t offset;
+	} ;
+	typedef std::vector<PlaybackChunk> PlaybackSchedule;
+
+	//! Apply the automation of a chunk, sample-exact from its offset on,
+	//! or from the start of the period for the first chunk
+	void processAutomations(const TrackList& tracks, const PlaybackChunk& chunk, bool firstChunk);
+
+	//! Move the play position forward by one period
+	void advancePlayPos( PlaybackSchedule & _schedule );
+	//! Find the frames of the period played from _periodStart on which lie
+	//! within the export range
+	void updateExportRangeFrames( const MidiTime & _periodStart,
+					const PlaybackSchedule & _schedule );
+	//! Play the live tracks (and automation) and/or the tracks played ahead
+	void playSchedule( const PlaybackSchedule & _schedule,
+				const TrackList & _tracks, int _tcoNum,
+				bool _live, bool _anticipated );
+	//! Whether a track is played one period ahead of the others
+	static bool isAnticipated( Track * _track );
+	//! Let all instrument tracks without live input be played ahead or
+	//! stop doing so, see Mixer::startAnticipativeJobs()
+	void setAnticipated( bool _anticipated );
 
 	void setModified(bool value);
 
@@ -436,6 +516,7 @@ private:
 	volatile bool m_paused;
 
 	bool m_savingProject;
+	TrackSnapshots * m_trackSnapshots;
 	bool m_loadingProject;
 	bool m_isCancelled;
 
@@ -464,6 +545,23 @@ private:
 	MidiTime m_exportSongEnd;
 	MidiTime m_exportEffectiveLength;
 
+	bool m_hasExportRange;
+	MidiTime m_exportRangeBegin;
+	MidiTime m_exportRangeEnd;
+	MidiTime m_exportPreRoll;
+	f_cnt_t m_exportRangeTail;
+	f_cnt_t m_exportRangeFirst;
+	f_cnt_t m_exportRangeLast;
+	QVector<f_cnt_t> m_exportRangeBars;
+
+	// While anticipating, the play position runs one period ahead of what
+	// the live tracks play. Tracks without live input are played with
+	// m_aheadSchedule, the others with m_schedule which the former has
+	// been the period before.
+	PlaybackSchedule m_schedule;
+	PlaybackSchedule m_aheadSchedule;
+	bool m_anticipating;
+
 	friend class LmmsCore;
 	friend class SongEditor;
 	friend class mainWindow;
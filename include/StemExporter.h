@@ -0,0 +1,143 @@
+/*
+ * StemExporter.h - writes tracks and FX channels to files of their own
+ *                  while the song is rendered once
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef STEM_EXPORTER_H
+#define STEM_EXPORTER_H
+
+#include <memory>
+#include <vector>
+
+#include <QtCore/QStringList>
+
+#include "AudioFileDevice.h"
+#include "lmms_export.h"
+#include "MemoryManager.h"
+
+class AudioPort;
+class FxChannel;
+
+
+//! Copy of the output of a track or FX channel during one period, taken
+//! by the port or channel it's attached to. Each tap is only written by
+//! the job of its port or channel, so no locking is needed.
+class LMMS_EXPORT StemTap
+{
+	MM_OPERATORS
+public:
+	StemTap();
+	~StemTap();
+
+	//! Takes _frames frames of _buf multiplied by _gain
+	void capture( const sampleFrame * _buf, fpp_t _frames,
+						float _gain = 1.0f );
+
+	//! Takes the sum of _count buffers of _frames frames each
+	void captureSum( const sampleFrame * const * _buffers, int _count,
+							fpp_t _frames );
+
+	//! What has been captured during the period, silence if nothing
+	const sampleFrame * buffer() const
+	{
+		return m_buffer;
+	}
+
+	//! Clears what has been captured for the next period
+	void clear();
+
+
+private:
+	sampleFrame * m_buffer;
+	bool m_captured;
+
+} ;
+
+
+
+
+//! Attaches taps to the ports of tracks and to FX channels and writes what
+//! they captured to a file device per stem after each period, so all stems
+//! of a song take a single render instead of one render per track. Stems
+//! leave out the master channel and the master gain.
+class LMMS_EXPORT StemExporter
+{
+public:
+	enum TapPoints
+	{
+		//! The notes and samples played by the track with its volume
+		//! and panning, before its effects
+		PreEffects,
+		//! The output of the track as sent to its FX channel
+		PostEffects
+	} ;
+
+	StemExporter( AudioFileDeviceInstantiaton _factory,
+				const OutputSettings & _outputSettings );
+	//! Detaches the taps and closes the files
+	~StemExporter();
+
+	//! Returns false if the file couldn't be created
+	bool addPort( AudioPort * _port, TapPoints _tapPoint,
+						const QString & _file );
+	//! Taps the channel after its effects and fader
+	bool addFxChannel( FxChannel * _channel, const QString & _file );
+
+	int count() const
+	{
+		return static_cast<int>( m_stems.size() );
+	}
+
+	QStringList files() const;
+
+	//! To be called once the mixer switched to the quality settings of
+	//! the export, as the devices are created before
+	void applyQualitySettings();
+
+	//! Writes the period the mixer just rendered to all files, to be
+	//! called by the rendering thread after each period
+	void writePeriod();
+
+	//! Drops what has been captured during a period which isn't exported
+	void skipPeriod();
+
+
+private:
+	struct Stem
+	{
+		StemTap tap;
+		std::unique_ptr<AudioFileDevice> device;
+		AudioPort * port;
+		FxChannel * channel;
+	} ;
+
+	bool addStem( AudioPort * _port, FxChannel * _channel,
+						const QString & _file );
+
+	AudioFileDeviceInstantiaton m_factory;
+	OutputSettings m_outputSettings;
+
+	std::vector<std::unique_ptr<Stem> > m_stems;
+
+} ;
+
+
+#endif
@@ -32,21 +32,74 @@
 #include <QMimeData>
 
 #include "lmms_export.h"
+#include "DataFile.h"
 
 class QPixmap;
 
 
+//! Mime data holding a DataFile, which is only turned into text once it's
+//! asked for as such, e.g. by another application. Within LMMS, dataFile()
+//! hands the document over as it is, so large selections don't have to
+//! be written out and parsed again.
+class LMMS_EXPORT DataFileMimeData : public QMimeData
+{
+public:
+	//! The data of _format is _prefix followed by the XML of _dataFile
+	DataFileMimeData( const QString & _format, const QString & _prefix,
+						const DataFile & _dataFile );
+
+	const QString & prefix() const
+	{
+		return m_prefix;
+	}
+
+	const DataFile & dataFile() const
+	{
+		return m_dataFile;
+	}
+
+	bool hasFormat( const QString & _mimeType ) const override;
+	QStringList formats() const override;
+
+	//! The DataFile _mimeData holds in _format, parsed if it doesn't come
+	//! from a DataFileMimeData, after _prefix
+	static DataFile decode( const QMimeData * _mimeData,
+				const QString & _format, int _prefixSize = 0 );
+
+
+protected:
+	QVariant retrieveData( const QString & _mimeType,
+					QVariant::Type _type ) const override;
+
+
+private:
+	const QString m_format;
+	const QString m_prefix;
+	const DataFile m_dataFile;
+	mutable QByteArray m_text;
+
+} ;
+
+
+
+
 class LMMS_EXPORT StringPairDrag : public QDrag
 {
 public:
 	StringPairDrag( const QString & _key, const QString & _value,
 					const QPixmap & _icon, QWidget * _w );
+	//! Drags _dataFile as the value, see DataFileMimeData
+	StringPairDrag( const QString & _key, const DataFile & _dataFile,
+					const QPixmap & _icon, QWidget * _w );
 	~StringPairDrag();
 
 	static bool processDragEnterEvent( QDragEnterEvent * _dee,
 						const QString & _allowed_keys );
 	static QString decodeMimeKey( const QMimeData * mimeData );
 	static QString decodeMimeValue( const QMimeData * mimeData );
+	//! The value as a DataFile, without parsing it if it's dragged
+	//! within LMMS
+	static DataFile decodeMimeDataFile( const QMimeData * mimeData );
 	static QString decodeKey( QDropEvent * _de );
 	static QString decodeValue( QDropEvent * _de );
 
@@ -55,6 +108,10 @@ public:
 		return( "application/x-lmms-stringpair" );
 	}
 
+
+private:
+	void start( QMimeData * _mimeData, const QPixmap & _icon, QWidget * _w );
+
 } ;
 
 
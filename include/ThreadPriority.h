@@ -0,0 +1,59 @@
+/*
+ * ThreadPriority.h - helpers for scheduling priority and CPU affinity of
+ *                    audio threads
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef THREAD_PRIORITY_H
+#define THREAD_PRIORITY_H
+
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+#include "lmms_export.h"
+
+//! All functions act on the calling thread. They never fail hard: if a
+//! setting can't be applied, the closest one available is used and the
+//! returned description says what was actually applied.
+namespace ThreadPriority
+{
+
+enum class Policy
+{
+	Normal,		// default time-sharing priority, used for offline rendering
+	High,		// highest priority the OS grants without special rights
+	RealTime	// SCHED_FIFO/SCHED_RR, MMCSS "Pro Audio" or QoS user-interactive
+} ;
+
+LMMS_EXPORT QString apply( Policy policy );
+
+//! Pin the calling thread to the given core, a negative core allows all cores
+LMMS_EXPORT QString pinToCore( int core );
+
+//! Cores reserved by the isolcpus kernel parameter, empty if there are none
+//! or the platform doesn't support isolating cores
+LMMS_EXPORT QVector<int> isolatedCores();
+
+//! All cores available, 0 .. QThread::idealThreadCount() - 1
+LMMS_EXPORT QVector<int> allCores();
+
+}
+
+#endif
@@ -26,6 +26,11 @@
 #define THREADABLE_JOB_H
 
 #include "lmms_basics.h"
+#include "CpuUsage.h"
+#include "MicroTimer.h"
+#include "MixerProfiler.h"
+#include "RealtimeChecker.h"
+#include "TraceRecorder.h"
 
 #include <atomic>
 
@@ -42,7 +47,8 @@ public:
 	};
 
 	ThreadableJob() :
-		m_state(ProcessingState::Unstarted)
+		m_state(ProcessingState::Unstarted),
+		m_successor(nullptr)
 	{
 	}
 
@@ -66,23 +72,75 @@ public:
 		m_state = ProcessingState::Done;
 	}
 
-	void process()
+	//! Set a job to be notified via predecessorDone() after this job has
+	//! been processed. The successor is only notified once, i.e. it has to
+	//! be set again for every period.
+	inline void setSuccessor(ThreadableJob * successor)
+	{
+		m_successor = successor;
+	}
+
+	//! Process the job if it's queued. Jobs processed as part of a batch
+	//! (see JobBatcher) count as one job for the profiler.
+	void process(bool batched = false)
 	{
 		auto expected = ProcessingState::Queued;
 		if (m_state.compare_exchange_strong(expected, ProcessingState::InProgress))
 		{
+			TraceRecorder::Zone zone(traceName());
+			RealtimeChecker::RenderScope realtimeScope;
+			MicroTimer timer;
 			doProcessing();
+			const int elapsed = timer.elapsed();
+			accountProcessingTime(elapsed);
+			if (!batched)
+			{
+				MixerProfiler::addJobTime(elapsed);
+			}
 			m_state = ProcessingState::Done;
+
+			ThreadableJob * successor = m_successor.exchange(nullptr);
+			if (successor)
+			{
+				successor->predecessorDone();
+			}
 		}
 	}
 
 	virtual bool requiresProcessing() const = 0;
 
+	//! Time processing took during the last periods
+	const CpuUsage & cpuUsage() const
+	{
+		return m_cpuUsage;
+	}
+
 
 protected:
 	virtual void doProcessing() = 0;
 
+	//! Called after a job having this job as successor has been processed
+	virtual void predecessorDone()
+	{
+	}
+
+	//! Called with the time doProcessing() took, for jobs which are
+	//! processed once per period
+	virtual void accountProcessingTime(int microseconds)
+	{
+		m_cpuUsage.add(microseconds);
+	}
+
+	//! Name of the zone process() records, see TraceRecorder
+	virtual const char * traceName() const
+	{
+		return "ThreadableJob";
+	}
+
+	CpuUsage m_cpuUsage;
+
 	std::atomic<ProcessingState> m_state;
+	std::atomic<ThreadableJob *> m_successor;
 } ;
 
 #endif
@@ -0,0 +1,56 @@
+/*
+ * TimeStretch.h - changes the tempo and pitch of a sample independently
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TIME_STRETCH_H
+#define TIME_STRETCH_H
+
+#include "lmms_basics.h"
+#include "lmms_export.h"
+
+
+//! Offline WSOLA (waveform similarity overlap-add) for whole samples, too
+//! slow to run per voice but good enough for loops and vocals. The input
+//! is cut into overlapping windows of WindowMilliseconds which are laid out
+//! at the new tempo, each one shifted by up to SearchMilliseconds to where
+//! it continues the one before best, so the waveform doesn't jump. Pitch
+//! shifting stretches by the pitch ratio on top and resamples the result
+//! back to the length wanted.
+class LMMS_EXPORT TimeStretch
+{
+public:
+	static const int WindowMilliseconds = 40;
+	static const int SearchMilliseconds = 10;
+
+	//! Length of _frames frames played _speed times as fast
+	static f_cnt_t stretchedFrames( f_cnt_t _frames, double _speed );
+
+	//! _frames frames of _in at _sampleRate played _speed times as fast
+	//! without changing their pitch, shifted by _semitones. Returns
+	//! stretchedFrames() frames allocated by MM_ALLOC_TAGGED().
+	static sampleFrame * process( const sampleFrame * _in, f_cnt_t _frames,
+					double _speed, int _semitones,
+					sample_rate_t _sampleRate );
+
+} ;
+
+
+#endif
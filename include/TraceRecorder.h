@@ -0,0 +1,93 @@
+/*
+ * TraceRecorder.h - records timed zones of the audio threads for viewing
+ *                   them as timeline in chrome://tracing or Perfetto
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <atomic>
+
+#include <QtCore/QString>
+
+#include "lmms_export.h"
+
+
+//! Zones are recorded into a ring per thread which only the thread itself
+//! writes to, so recording never locks - only the first zone of a thread
+//! registers its ring. Each ring keeps the last EventsPerThread zones,
+//! which covers several seconds of rendering.
+class LMMS_EXPORT TraceRecorder
+{
+public:
+	static const unsigned int EventsPerThread = 1 << 16;
+
+	//! Records the time from construction to destruction as a zone of the
+	//! calling thread, if recording is enabled. _name must be a string
+	//! literal, only the pointer is stored.
+	class Zone
+	{
+	public:
+		Zone( const char * _name ) :
+			m_name( isRecording() ? _name : NULL ),
+			m_begin( m_name ? now() : 0 )
+		{
+		}
+
+		~Zone()
+		{
+			if( m_name )
+			{
+				addZone( m_name, m_begin, now() );
+			}
+		}
+
+	private:
+		const char * m_name;
+		qint64 m_begin;
+
+	} ;
+
+	static bool isRecording()
+	{
+		return s_recording.load( std::memory_order_relaxed );
+	}
+
+	//! Starting drops everything recorded before
+	static void setRecording( bool _recording );
+
+	//! Write what has been recorded as Chrome trace event JSON. Can be
+	//! called while recording, the oldest zones may be missing then.
+	static bool writeChromeTrace( const QString & _file );
+
+	//! Nanoseconds on a monotonic clock
+	static qint64 now();
+
+	static void addZone( const char * _name, qint64 _begin, qint64 _end );
+
+
+private:
+	static std::atomic_bool s_recording;
+
+} ;
+
+
+#endif
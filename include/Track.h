@@ -31,6 +31,7 @@
 #include <QWidget>
 #include <QColor>
 #include <QMimeData>
+#include <QPixmap>
 
 #include "lmms_basics.h"
 #include "MidiTime.h"
@@ -268,6 +269,8 @@ protected:
 		m_needsUpdate = true;
 		selectableObject::resizeEvent( re );
 	}
+	void hideEvent( QHideEvent * he ) override;
+	void showEvent( QShowEvent * se ) override;
 
 	float pixelsPerBar();
 
@@ -276,6 +279,9 @@ protected:
 
 	virtual void paintTextLabel(QString const & text, QPainter & painter);
 
+	// what paintEvent() painted last, only kept while the view is shown
+	QPixmap m_paintPixmap;
+
 
 protected slots:
 	void updateLength();
@@ -389,6 +395,7 @@ protected:
 	void mousePressEvent( QMouseEvent * me ) override;
 	void paintEvent( QPaintEvent * pe ) override;
 	void resizeEvent( QResizeEvent * re ) override;
+	void showEvent( QShowEvent * se ) override;
 
 	QString nodeName() const override
 	{
@@ -532,6 +539,8 @@ public:
 	// -- for usage by TrackContentObject only ---------------
 	TrackContentObject * addTCO( TrackContentObject * tco );
 	void removeTCO( TrackContentObject * tco );
+	void updateTCOPosition( TrackContentObject * tco );
+	void updateTCOLength();
 	// -------------------------------------------------------
 	void deleteTCOs();
 
@@ -625,6 +634,9 @@ private:
 	bool m_simpleSerializingMode;
 
 	tcoVector m_trackContentObjects;
+	// the same TCOs sorted by start position for getTCOsInRange()
+	tcoVector m_sortedTCOs;
+	tick_t m_longestTCO;
 
 	QMutex m_processingLock;
 
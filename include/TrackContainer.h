@@ -28,6 +28,7 @@
 
 #include <QtCore/QReadWriteLock>
 
+#include "AutomationIndex.h"
 #include "Track.h"
 #include "JournallingObject.h"
 
@@ -95,6 +96,17 @@ public:
 
 	virtual AutomatedValueMap automatedValuesAt(MidiTime time, int tcoNum = -1) const;
 
+	//! The tracks whose automation applies to the models of this container
+	virtual TrackList automationTracks() const
+	{
+		return tracks();
+	}
+
+	AutomationIndex & automationIndex() const
+	{
+		return m_automationIndex;
+	}
+
 signals:
 	void trackAdded( Track * _track );
 
@@ -108,6 +120,8 @@ private:
 
 	TrackContainerTypes m_TrackContainerType;
 
+	mutable AutomationIndex m_automationIndex;
+
 
 	friend class TrackContainerView;
 	friend class Track;
@@ -138,6 +138,12 @@ public slots:
 	void stopRubberBand();
 
 
+private slots:
+	//! Shows the track views around the visible part of the scroll area
+	//! and hides the others, which keep their place in the layout
+	void showVisibleTracks();
+
+
 protected:
 	static const int DEFAULT_PIXELS_PER_BAR = 16;
 
@@ -0,0 +1,213 @@
+/*
+ * TrackFreeze.h - audio of an instrument track rendered once and played
+ *                 back instead of its instrument
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TRACK_FREEZE_H
+#define TRACK_FREEZE_H
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <QtCore/QObject>
+#include <QtCore/QString>
+
+#include "lmms_export.h"
+#include "Mixer.h"
+#include "MemoryManager.h"
+#include "PlayHandle.h"
+#include "StemExporter.h"
+
+class AudioFileDevice;
+class InstrumentTrack;
+class ProjectRenderer;
+class SampleStream;
+class Track;
+
+
+//! The audio of an instrument track, rendered with the whole song once so
+//! playing the song doesn't need its instrument anymore. It's taken before
+//! the volume, panning and effects of the track, which then still apply,
+//! or after them. The frames where each tick of the song starts are kept,
+//! so the audio follows the song wherever it's played from. The file is
+//! streamed from disk, see SampleStream, and removed with the freeze.
+class LMMS_EXPORT TrackFreeze
+{
+	MM_OPERATORS
+public:
+	//! Creates the file and taps the port of _track for recording
+	TrackFreeze( InstrumentTrack * _track, bool _afterEffects );
+	~TrackFreeze();
+
+	//! Whether the file could be created
+	bool isValid() const;
+
+	bool afterEffects() const
+	{
+		return m_afterEffects;
+	}
+
+	// recording, see TrackFreezer
+
+	//! Called by the track for each tick starting in the period being
+	//! rendered, _offset frames into it
+	void markTick( tick_t _tick, f_cnt_t _offset );
+	//! Writes what the tap captured once a period has been rendered
+	void writePeriod();
+	//! Drops a period which isn't exported
+	void skipPeriod();
+	//! Detaches the tap and opens the file for playing, returns false if
+	//! that didn't work
+	bool finishRecording();
+
+	// playing, see FreezePlayHandle
+
+	//! Frame of the audio at the processing rate at which _tick starts,
+	//! -1 if it hasn't been rendered
+	f_cnt_t tickFrame( tick_t _tick ) const;
+	//! Copies _frames frames from _frame on to _dst, silence where
+	//! there's no audio
+	void read( f_cnt_t _frame, sampleFrame * _dst, f_cnt_t _frames );
+	//! Streams the file at the current processing rate, to be called by
+	//! the GUI thread whenever it changed
+	void updateSampleRate();
+
+
+private:
+	InstrumentTrack * m_track;
+	const bool m_afterEffects;
+	QString m_file;
+
+	StemTap m_tap;
+	std::unique_ptr<AudioFileDevice> m_device;
+	// ticks of the period being rendered and their offsets
+	std::vector<std::pair<tick_t, f_cnt_t> > m_pendingTicks;
+	f_cnt_t m_framesWritten;
+
+	// frame of each tick at the rate of recording, -1 for ticks which
+	// haven't been played
+	std::vector<f_cnt_t> m_tickFrames;
+	sample_rate_t m_sampleRate;
+
+	std::unique_ptr<SampleStream> m_stream;
+	// stream frames per recorded frame
+	double m_ratio;
+
+} ;
+
+
+
+
+//! Plays the frozen audio of a track into its port while the song is
+//! played. Lives as long as the freeze, like an InstrumentPlayHandle.
+class FreezePlayHandle : public PlayHandle
+{
+public:
+	FreezePlayHandle( TrackFreeze * _freeze, InstrumentTrack * _track );
+
+	//! It's removed by the thread it was created by when unfreezing,
+	//! right away
+	bool affinityMatters() const override
+	{
+		return true;
+	}
+
+	void play( sampleFrame * _buffer ) override;
+
+	bool isFinished() const override
+	{
+		return false;
+	}
+
+	bool isFromTrack( const Track * _track ) const override;
+
+	//! Continues with the frame of the audio at which _tick starts from
+	//! _offset frames into the current period on, called while the song
+	//! is played before the period gets rendered
+	void jumpTo( tick_t _tick, f_cnt_t _offset );
+
+
+private:
+	struct Jump
+	{
+		f_cnt_t offset;
+		f_cnt_t frame;
+	} ;
+
+	TrackFreeze * m_freeze;
+	InstrumentTrack * m_track;
+
+	// jumps of the current period, there can't be more than a tick per
+	// frame
+	Jump m_jumps[DEFAULT_BUFFER_SIZE];
+	int m_jumpCount;
+	// next frame to be played, -1 while the song isn't played
+	f_cnt_t m_frame;
+
+} ;
+
+
+
+
+//! Freezes an instrument track, see TrackFreeze, by rendering the song the
+//! way it's exported with the other tracks muted. Runs in the background
+//! like RenderManager.
+class LMMS_EXPORT TrackFreezer : public QObject
+{
+	Q_OBJECT
+public:
+	TrackFreezer( InstrumentTrack * _track, bool _afterEffects );
+	virtual ~TrackFreezer();
+
+	//! Returns false if the file couldn't be created
+	bool start();
+
+public slots:
+	void abortProcessing();
+
+signals:
+	void progressChanged( int );
+	//! The track is frozen now if _successful
+	void finished( bool _successful );
+
+
+private slots:
+	void renderFinished();
+
+
+private:
+	void muteOtherTracks( bool _mute );
+
+	InstrumentTrack * m_track;
+	const bool m_afterEffects;
+	const Mixer::qualitySettings m_qualitySettings;
+
+	std::unique_ptr<TrackFreeze> m_freeze;
+	std::unique_ptr<ProjectRenderer> m_renderer;
+
+	std::vector<Track *> m_mutedTracks;
+	bool m_aborted;
+
+} ;
+
+
+#endif
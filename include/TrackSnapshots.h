@@ -0,0 +1,77 @@
+/*
+ * TrackSnapshots.h - the saved state of the tracks unchanged since the last
+ *                    save, so saving again doesn't serialize them again
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TRACK_SNAPSHOTS_H
+#define TRACK_SNAPSHOTS_H
+
+#include <QtCore/QHash>
+#include <QtCore/QPointer>
+#include <QtXml/QDomDocument>
+
+#include "lmms_export.h"
+
+class Track;
+
+
+//! Keeps what each track saved, e.g. for autosaving, until an object
+//! belonging to the track reports a change through
+//! JournallingObject::addJournalCheckPoint(). What isn't reported, e.g.
+//! the state edited in a plugin's own window, is still saved every
+//! FullSaveInterval'th time, when all tracks are serialized again.
+class LMMS_EXPORT TrackSnapshots
+{
+public:
+	static const int FullSaveInterval = 10;
+
+	TrackSnapshots();
+
+	//! Forgets the snapshots of the tracks changed since the last call,
+	//! all of them every FullSaveInterval'th call or if an object which
+	//! changed is gone. Call before saving.
+	void update();
+
+	//! Appends the state of _track to _parent, the snapshot if there's
+	//! one and otherwise what the track saves, which is kept then
+	void save( Track * _track, QDomDocument & _doc, QDomElement & _parent );
+
+
+private:
+	struct Snapshot
+	{
+		// null once the track is deleted, so a new track at the same
+		// address doesn't get the snapshot
+		QPointer<Track> track;
+		QDomElement element;
+	} ;
+
+	void clear();
+
+	// holds the snapshots, apart from the documents they're copied into
+	QDomDocument m_doc;
+	QHash<const Track *, Snapshot> m_snapshots;
+	int m_updates;
+
+} ;
+
+
+#endif
@@ -0,0 +1,112 @@
+/*
+ * TripleBuffer.h - wait-free handover of the latest state from one thread
+ *                  to another
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+
+//! Double buffering where neither side ever waits for the other: the writer
+//! fills back() and publish()es it, the reader gets the latest published
+//! state from read(). A third buffer sits between them, so the writer always
+//! has one to fill while the reader still looks at another, and intermediate
+//! states the reader didn't pick up are simply replaced.
+//! There must only be one writer and one reader thread.
+template<class T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() :
+		m_back( 0 ),
+		m_front( 1 ),
+		m_middle( 2 )
+	{
+	}
+
+	// writer side
+
+	//! The buffer to fill next - it holds an older state, so all of it
+	//! has to be written
+	T & back()
+	{
+		return m_buffers[m_back];
+	}
+
+	//! Hand back() over to the reader
+	void publish()
+	{
+		m_back = m_middle.exchange( m_back | Fresh,
+					std::memory_order_acq_rel ) & IndexMask;
+	}
+
+	//! Whether the reader got the state published last, so it won't see
+	//! anything published before the next one
+	bool taken() const
+	{
+		return !( m_middle.load( std::memory_order_relaxed ) & Fresh );
+	}
+
+	// reader side
+
+	//! The latest state published, stays valid until the next call
+	const T & read()
+	{
+		if( m_middle.load( std::memory_order_relaxed ) & Fresh )
+		{
+			m_front = m_middle.exchange( m_front,
+					std::memory_order_acq_rel ) & IndexMask;
+		}
+		return m_buffers[m_front];
+	}
+
+	//! Call _f for every buffer, e.g. for reserving memory up front. Only
+	//! allowed while neither side accesses them.
+	template<class F>
+	void forEach( F _f )
+	{
+		for( T & buffer : m_buffers )
+		{
+			_f( buffer );
+		}
+	}
+
+
+private:
+	static const int IndexMask = 3;
+	static const int Fresh = 4;
+
+	T m_buffers[3];
+
+	// only touched by the writer
+	int m_back;
+	// only touched by the reader
+	int m_front;
+	// the index of the buffer in between, with Fresh set if published
+	// after the reader got the one before
+	std::atomic_int m_middle;
+
+} ;
+
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * UserWaveMipMap.h - band-limited versions of a drawn waveform
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef USER_WAVE_MIP_MAP_H
+#define USER_WAVE_MIP_MAP_H
+
+#include <memory>
+#include <vector>
+
+#include "interpolation.h"
+#include "lmms_basics.h"
+#include "lmms_export.h"
+#include "lmms_math.h"
+
+
+//! Like the WaveMipMap of BandLimitedWave, for one cycle drawn by the user
+//! (bitInvader, Watsyn, ...). Every level holds half the partials of the
+//! one before it, so an oscillator picks the level without partials above
+//! the Nyquist frequency and doesn't alias. The levels are built once when
+//! the drawing changes and shared by all notes through a UserWaveMipMapPtr.
+class LMMS_EXPORT UserWaveMipMap
+{
+public:
+	//! samples of every level, a power of two
+	static const int TableLength = 2048;
+
+	//! Levels for the _length samples of one cycle in _cycle
+	UserWaveMipMap( const float * _cycle, int _length );
+
+	int levels() const
+	{
+		return m_levels;
+	}
+
+	//! The first level without partials above half the sample rate at a
+	//! phase increment of _cyclesPerFrame, the last one if there's none
+	int level( float _cyclesPerFrame ) const
+	{
+		int l = 0;
+		while( l < m_levels - 1 &&
+			( m_partials >> l ) * _cyclesPerFrame > 0.5f )
+		{
+			++l;
+		}
+		return l;
+	}
+
+	//! Sample of _level at _phase, in cycles
+	sample_t sample( int _level, float _phase ) const
+	{
+		const float pos = fraction( _phase ) * TableLength;
+		const int i = static_cast<int>( pos );
+		const float * table = m_tables.data() + _level * ( TableLength + 1 );
+		return linearInterpolate( table[i], table[i + 1], pos - i );
+	}
+
+
+private:
+	//! partials of the first level
+	int m_partials;
+	int m_levels;
+	// the levels one after the other, every one with its first sample
+	// repeated at the end for interpolating
+	std::vector<float> m_tables;
+
+} ;
+
+
+typedef std::shared_ptr<const UserWaveMipMap> UserWaveMipMapPtr;
+
+
+#endif
@@ -31,9 +31,10 @@
 #include "MemoryManager.h"
 #include "lmms_export.h"
 
-class LMMS_EXPORT ValueBuffer : public std::vector<float>
+class LMMS_EXPORT ValueBuffer :
+	public std::vector<float, MmAllocator<float, MemoryManager::ValueBuffers> >
 {
-	MM_OPERATORS
+	MM_OPERATORS_TAGGED( ValueBuffers )
 public:
 	ValueBuffer();
 	ValueBuffer(int length);
@@ -48,6 +49,13 @@ public:
 	int length() const;
 
 	void interpolate(float start, float end);
+
+	//! Buffers of the given length are taken from a preallocated pool by
+	//! acquire() from then on. Must not be called while rendering.
+	static void initPool(int length);
+	//! Lock-free unless the pool is used up
+	static ValueBuffer * acquire();
+	static void release(ValueBuffer * buffer);
 };
 
 #endif
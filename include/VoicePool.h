@@ -0,0 +1,146 @@
+/*
+ * VoicePool.h - constructed per-note engines of an instrument kept for reuse
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef VOICE_POOL_H
+#define VOICE_POOL_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+//! Keeps the per-note engines of an instrument (emulated chips, STK
+//! instruments, ...) once a note is done with them, so starting a note
+//! only resets an engine instead of constructing one on the audio thread.
+//! The pool is filled through reserve() outside the audio thread. take()
+//! and give() hold a spinlock for a few instructions only and never
+//! allocate.
+template<typename T>
+class VoicePool
+{
+public:
+	//! pool size for tracks without a polyphony limit
+	static const int DefaultSize = 16;
+
+	VoicePool()
+	{
+		m_lock.clear();
+	}
+
+	~VoicePool()
+	{
+		clear();
+	}
+
+	//! Returns a pooled engine or nullptr if there's none left
+	T * take()
+	{
+		T * voice = nullptr;
+		lock();
+		if( !m_voices.empty() )
+		{
+			voice = m_voices.back();
+			m_voices.pop_back();
+		}
+		unlock();
+		return voice;
+	}
+
+	//! Hands an engine back - it's deleted if the pool is full already
+	void give( T * voice )
+	{
+		if( voice == nullptr )
+		{
+			return;
+		}
+		lock();
+		if( m_voices.size() < m_voices.capacity() )
+		{
+			m_voices.push_back( voice );
+			voice = nullptr;
+		}
+		unlock();
+		delete voice;
+	}
+
+	//! Constructs engines through create() until count of them are
+	//! pooled, e.g. count is the polyphony of the track
+	template<typename Create>
+	void reserve( int count, Create create )
+	{
+		if( count <= 0 )
+		{
+			count = DefaultSize;
+		}
+
+		lock();
+		if( m_voices.capacity() < static_cast<size_t>( count ) )
+		{
+			m_voices.reserve( count );
+		}
+		int missing = count - static_cast<int>( m_voices.size() );
+		unlock();
+
+		for( ; missing > 0; --missing )
+		{
+			give( create() );
+		}
+	}
+
+	//! Deletes all pooled engines, e.g. after they got outdated by a
+	//! sample rate change
+	void clear()
+	{
+		std::vector<T *> voices;
+		lock();
+		voices.reserve( m_voices.capacity() );
+		voices.swap( m_voices );
+		unlock();
+
+		for( T * voice : voices )
+		{
+			delete voice;
+		}
+	}
+
+
+private:
+	void lock()
+	{
+		while( m_lock.test_and_set( std::memory_order_acquire ) )
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	void unlock()
+	{
+		m_lock.clear( std::memory_order_release );
+	}
+
+	std::atomic_flag m_lock;
+	std::vector<T *> m_voices;
+
+} ;
+
+
+#endif
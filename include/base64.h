@@ -30,6 +30,8 @@
 #include <QtCore/QString>
 #include <QtCore/QVariant>
 
+#include "BlobContainer.h"
+
 
 namespace base64
 {
@@ -42,7 +44,10 @@ namespace base64
 	template<class T>
 	inline void decode( const QString & _b64, T * * _data, int * _size )
 	{
-		QByteArray data = QByteArray::fromBase64( _b64.toUtf8() );
+		// a blob of a binary project is used as it is
+		QByteArray data = BlobContainer::isReference( _b64 ) ?
+					BlobContainer::data( _b64 ) :
+					QByteArray::fromBase64( _b64.toUtf8() );
 		*_size = data.size();
 		*_data = new T[*_size / sizeof(T)];
 		memcpy( *_data, data.constData(), *_size );
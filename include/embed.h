@@ -108,6 +108,52 @@ protected:
 } ;
 
 
+//! A pixmap of the icon pixmap cache which is decoded when it's used first
+//! instead of when the widgets using it are created, as many of them aren't
+//! shown in a session or only later on
+class LazyPixmap
+{
+public:
+	LazyPixmap( const char * _name, int _w = -1, int _h = -1 ) :
+		m_name( _name ),
+		m_width( _w ),
+		m_height( _h ),
+		m_pixmap( NULL )
+	{
+	}
+
+	const QPixmap * get() const
+	{
+		if( m_pixmap == NULL )
+		{
+			// never freed, just like the static pixmaps of widgets,
+			// as there's no application to free it with at exit
+			m_pixmap = new QPixmap( embed::getIconPixmap( m_name,
+							m_width, m_height ) );
+		}
+		return m_pixmap;
+	}
+
+	const QPixmap & operator*() const
+	{
+		return *get();
+	}
+
+	const QPixmap * operator->() const
+	{
+		return get();
+	}
+
+private:
+	const char * m_name;
+	const int m_width;
+	const int m_height;
+	mutable QPixmap * m_pixmap;
+
+} ;
+
+
+
 #ifdef PLUGIN_NAME
 class PluginPixmapLoader : public PixmapLoader
 {
@@ -103,4 +103,33 @@ int LMMS_EXPORT absspec(const fftwf_complex *complex_buffer, float *absspec_buff
 int LMMS_EXPORT compressbands(const float * _absspec_buffer, float * _compressedband,
 			int _num_old, int _num_new, int _bottom, int _top);
 
+
+/**	Get a plan for count real to complex FFTs of size values each, from a
+ *	cache shared by all users. The input arrays follow each other size
+ *	values apart, their outputs size / 2 + 1 bins apart.
+ *	Only the first request for a size measures the plan (or reads it from
+ *	the wisdom kept in the config directory), after that they are cheap.
+ *	Thread-safe, but should be called ahead of real-time processing.
+ *
+ *	Run the plan with fftwf_execute_dft_r2c() on any input and output of
+ *	the same alignment as the ones given here; input and output must not
+ *	overlap. The input is left unchanged. The plan is owned by the cache,
+ *	don't destroy it.
+ *
+ *	@return NULL on error
+ */
+fftwf_plan LMMS_EXPORT realFFTPlan(unsigned int size, const float *input,
+			const fftwf_complex *output, unsigned int count = 1);
+
+
+/**	Like realFFTPlan(), but for the inverse complex to real FFTs from
+ *	size / 2 + 1 bins to size values, run with fftwf_execute_dft_c2r().
+ *	Unlike the forward FFT, the inverse one destroys its input. The output
+ *	is not normalized, i.e. it is size times the original values.
+ *
+ *	@return NULL on error
+ */
+fftwf_plan LMMS_EXPORT realIFFTPlan(unsigned int size, const fftwf_complex *input,
+			const float *output, unsigned int count = 1);
+
 #endif
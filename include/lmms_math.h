@@ -268,6 +268,120 @@ static inline float dbfsToAmp( float dbfs )
 
 
 
+//! @brief 2^x with a relative error below 2.5e-7 for x in [-126, 126], clamped to that
+//! range outside it (nan included). Doesn't branch, so loops over it are vectorized by the
+//! compiler.
+static inline float fastExp2f( float x )
+{
+	// clamped on the bits, GCC doesn't vectorize selects of floats which
+	// feed into arithmetic unless traps are disabled, 126.0f is 0x42fc0000
+	union
+	{
+		float f;
+		int32_t i;
+	} c;
+	c.f = x;
+	c.i = ( c.i & 0x7fffffff ) > 0x42fc0000 ?
+		( c.i & static_cast<int32_t>( 0x80000000 ) ) | 0x42fc0000 : c.i;
+	x = c.f;
+	// nearest integer, the offset keeps the truncated value positive
+	const int i = static_cast<int>( x + 126.5f ) - 126;
+	const float f = x - i;
+	// minimax polynomial of 2^f for f in [-0.5, 0.5], exact for f = 0
+	const float p = 1.0f + f * ( 0.693146978f + f * ( 0.240222421f +
+			f * ( 0.0555073375f + f * ( 0.00967151287f + f * 0.00132647239f ) ) ) );
+	union
+	{
+		int32_t i;
+		float f;
+	} u;
+	u.i = ( i + 127 ) << 23;
+	return u.f * p;
+}
+
+
+//! @brief e^x for x in [-87, 87]. The relative error is below 2.5e-7 for |x| < 1 and
+//! grows with |x| from rounding x * log2(e), to about 1e-6 at 20 and 4e-6 at 87.
+static inline float fastExpf( float x )
+{
+	return fastExp2f( x * 1.44269504f );
+}
+
+
+//! @brief sin(x) with an absolute error below 2.5e-7 for |x| < pi. The range reduction
+//! adds about |x| * 7e-8, e.g. 7e-6 at |x| = 100. Doesn't branch either.
+static inline float fastSinf( float x )
+{
+	// in turns, folded into [-0.5, 0.5]
+	float t = x * ( 1.0f / F_2PI );
+	t -= static_cast<int>( t + ( t >= 0.0f ? 0.5f : -0.5f ) );
+	// sin is symmetric around a quarter turn, so [0, 0.25] is enough
+	const float q = ( 0.25f - fabsf( 0.25f - fabsf( t ) ) ) * F_2PI;
+	const float q2 = q * q;
+	const float s = q * ( 0.999999977f + q2 * ( -0.166666476f + q2 * ( 0.00833289985f +
+			q2 * ( -0.000198008993f + q2 * 0.00000259049115f ) ) ) );
+	return t < 0.0f ? -s : s;
+}
+
+
+//! @brief tanh(x) with an absolute error below 1.5e-7, exactly +-1 for |x| > 44
+static inline float fastTanhf( float x )
+{
+	const float e = fastExp2f( x * 2.88539008f );
+	return ( e - 1.0f ) / ( e + 1.0f );
+}
+
+
+//! @brief dbfsToAmp() through fastExp2f() with a relative error below 1e-6 for dbfs in
+//! [-120, 20], valid in [-758, 758]. -inf gives 2^-126 instead of 0, which is below
+//! anything audible.
+static inline float fastDbfsToAmp( float dbfs )
+{
+	return fastExp2f( dbfs * 0.166096405f );
+}
+
+
+//! @brief fastExpf() of _n values, _dst may be _src
+static inline void fastExpBlock( float * _dst, const float * _src, int _n )
+{
+	for( int i = 0; i < _n; ++i )
+	{
+		_dst[i] = fastExpf( _src[i] );
+	}
+}
+
+
+//! @brief fastSinf() of _n values, _dst may be _src
+static inline void fastSinBlock( float * _dst, const float * _src, int _n )
+{
+	for( int i = 0; i < _n; ++i )
+	{
+		_dst[i] = fastSinf( _src[i] );
+	}
+}
+
+
+//! @brief fastTanhf() of _n values, _dst may be _src
+static inline void fastTanhBlock( float * _dst, const float * _src, int _n )
+{
+	for( int i = 0; i < _n; ++i )
+	{
+		_dst[i] = fastTanhf( _src[i] );
+	}
+}
+
+
+//! @brief fastDbfsToAmp() of _n values, _dst may be _src
+static inline void dbToAmpBlock( float * _dst, const float * _src, int _n )
+{
+	for( int i = 0; i < _n; ++i )
+	{
+		_dst[i] = fastDbfsToAmp( _src[i] );
+	}
+}
+
+
+
 //! returns 1.0f if val >= 0.0f, -1.0 else
 static inline float sign( float val ) 
 { 
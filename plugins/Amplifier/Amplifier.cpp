@@ -71,10 +71,6 @@ bool AmplifierEffect::processAudioBuffer( sampleFrame* buf, const fpp_t frames )
 		return( false );
 	}
 
-	double outSum = 0.0;
-	const float d = dryLevel();
-	const float w = wetLevel();
-	
 	const ValueBuffer * volBuf = m_ampControls.m_volumeModel.valueBuffer();
 	const ValueBuffer * panBuf = m_ampControls.m_panModel.valueBuffer();
 	const ValueBuffer * leftBuf = m_ampControls.m_leftModel.valueBuffer();
@@ -120,13 +116,10 @@ bool AmplifierEffect::processAudioBuffer( sampleFrame* buf, const fpp_t frames )
 		s[0] *= left1 * left2 * 0.01;
 		s[1] *= right1 * right2 * 0.01;
 
-		buf[f][0] = d * buf[f][0] + w * s[0];
-		buf[f][1] = d * buf[f][1] + w * s[1];
-		outSum += buf[f][0] * buf[f][0] + buf[f][1] * buf[f][1];
+		buf[f][0] = s[0];
+		buf[f][1] = s[1];
 	}
 
-	checkGate( outSum / frames );
-
 	return isRunning();
 }
 
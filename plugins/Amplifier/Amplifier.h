@@ -38,6 +38,17 @@ public:
 	virtual ~AmplifierEffect();
 	virtual bool processAudioBuffer( sampleFrame* buf, const fpp_t frames );
 
+	virtual bool writesWetOnly() const
+	{
+		return true;
+	}
+
+	// silence in, silence out
+	virtual f_cnt_t tailFrames() const
+	{
+		return 0;
+	}
+
 	virtual EffectControls* controls()
 	{
 		return &m_ampControls;
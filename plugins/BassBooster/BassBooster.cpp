@@ -86,10 +86,6 @@ bool BassBoosterEffect::processAudioBuffer( sampleFrame* buf, const fpp_t frames
 	const float const_gain = m_bbControls.m_gainModel.value();
 	const ValueBuffer *gainBuffer = m_bbControls.m_gainModel.valueBuffer();
 
-	double outSum = 0.0;
-	const float d = dryLevel();
-	const float w = wetLevel();
-
 	for( fpp_t f = 0; f < frames; ++f )
 	{
 		float gain = const_gain;
@@ -101,16 +97,9 @@ bool BassBoosterEffect::processAudioBuffer( sampleFrame* buf, const fpp_t frames
 		m_bbFX.leftFX().setGain( gain );
 		m_bbFX.rightFX().setGain( gain);
 
-		sample_t s[2] = { buf[f][0], buf[f][1] };
-		m_bbFX.nextSample( s[0], s[1] );
-
-		buf[f][0] = d * buf[f][0] + w * s[0];
-		buf[f][1] = d * buf[f][1] + w * s[1];
-		outSum += buf[f][0] * buf[f][0] + buf[f][1] * buf[f][1];
+		m_bbFX.nextSample( buf[f][0], buf[f][1] );
 	}
 
-	checkGate( outSum / frames );
-
 	return isRunning();
 }
 
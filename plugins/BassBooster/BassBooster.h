@@ -38,6 +38,11 @@ public:
 	virtual ~BassBoosterEffect();
 	virtual bool processAudioBuffer( sampleFrame* buf, const fpp_t frames );
 
+	virtual bool writesWetOnly() const
+	{
+		return true;
+	}
+
 	virtual EffectControls* controls()
 	{
 		return &m_bbControls;
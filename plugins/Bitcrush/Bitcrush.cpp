@@ -58,7 +58,7 @@ BitcrushEffect::BitcrushEffect( Model * parent, const Descriptor::SubPluginFeatu
 	m_sampleRate( Engine::mixer()->processingSampleRate() ),
 	m_filter( m_sampleRate )
 {
-	m_buffer = MM_ALLOC( sampleFrame, Engine::mixer()->framesPerPeriod() * OS_RATE );
+	m_buffer = MM_ALLOC_TAGGED( sampleFrame, Engine::mixer()->framesPerPeriod() * OS_RATE, Plugins );
 	m_filter.setLowpass( m_sampleRate * ( CUTOFF_RATIO * OS_RATIO ) );
 	m_needsUpdate = true;
 	
@@ -218,9 +218,6 @@ bool BitcrushEffect::processAudioBuffer( sampleFrame* buf, const fpp_t frames )
 	
 	// now downsample and write it back to main buffer
 	
-	double outSum = 0.0;
-	const float d = dryLevel();
-	const float w = wetLevel();
 	for( int f = 0; f < frames; ++f )
 	{
 		float lsum = 0.0f;
@@ -230,12 +227,9 @@ bool BitcrushEffect::processAudioBuffer( sampleFrame* buf, const fpp_t frames )
 			lsum += m_buffer[f * OS_RATE + o][0] * OS_RESAMPLE[o];
 			rsum += m_buffer[f * OS_RATE + o][1] * OS_RESAMPLE[o];
 		}
-		buf[f][0] = d * buf[f][0] + w * qBound( -m_outClip, lsum, m_outClip ) * m_outGain;
-		buf[f][1] = d * buf[f][1] + w * qBound( -m_outClip, rsum, m_outClip ) * m_outGain;
-		outSum += buf[f][0]*buf[f][0] + buf[f][1]*buf[f][1];
+		buf[f][0] = qBound( -m_outClip, lsum, m_outClip ) * m_outGain;
+		buf[f][1] = qBound( -m_outClip, rsum, m_outClip ) * m_outGain;
 	}
-	
-	checkGate( outSum / frames );
 
 	return isRunning();
 }
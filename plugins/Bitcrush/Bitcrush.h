@@ -40,6 +40,11 @@ public:
 	virtual ~BitcrushEffect();
 	virtual bool processAudioBuffer( sampleFrame* buf, const fpp_t frames );
 
+	virtual bool writesWetOnly() const
+	{
+		return true;
+	}
+
 	virtual EffectControls* controls()
 	{
 		return &m_controls;
@@ -0,0 +1,169 @@
+/*
+ * Convolver.cpp - convolution with impulse responses from audio files
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "Convolver.h"
+
+#include "embed.h"
+#include "Engine.h"
+#include "lmms_math.h"
+#include "Mixer.h"
+#include "PartitionedConvolver.h"
+#include "plugin_export.h"
+#include "SampleBuffer.h"
+#include "ScratchArena.h"
+
+extern "C"
+{
+
+Plugin::Descriptor PLUGIN_EXPORT convolver_plugin_descriptor =
+{
+	STRINGIFY( PLUGIN_NAME ),
+	"Convolver",
+	QT_TRANSLATE_NOOP( "pluginBrowser", "Convolution with impulse responses, e.g. of rooms or cabinets" ),
+	"",
+	0x0100,
+	Plugin::Effect,
+	new PluginPixmapLoader( "logo" ),
+	NULL,
+	NULL
+} ;
+
+}
+
+
+
+ConvolverEffect::ConvolverEffect( Model* parent, const Descriptor::SubPluginFeatures::Key* key ) :
+	Effect( &convolver_plugin_descriptor, parent, key ),
+	m_convolverControls( this )
+{
+	m_convolvers[0] = m_convolvers[1] = NULL;
+}
+
+
+
+
+ConvolverEffect::~ConvolverEffect()
+{
+	delete m_convolvers[0];
+	delete m_convolvers[1];
+}
+
+
+
+
+void ConvolverEffect::loadImpulseResponse( const QString & file )
+{
+	PartitionedConvolver * convolvers[2] = { NULL, NULL };
+	if( !file.isEmpty() )
+	{
+		SampleBuffer ir( file );
+		const sample_rate_t sampleRate = Engine::mixer()->processingSampleRate();
+		SampleBuffer * resampled = ir.sampleRate() != sampleRate ?
+					ir.resample( ir.sampleRate(), sampleRate ) : NULL;
+		const SampleBuffer * source = resampled ? resampled : &ir;
+
+		const f_cnt_t frames = source->frames();
+		std::vector<float> channel( frames );
+		for( int ch = 0; ch < 2; ++ch )
+		{
+			for( f_cnt_t f = 0; f < frames; ++f )
+			{
+				channel[f] = source->data()[f][ch];
+			}
+			convolvers[ch] = new PartitionedConvolver( channel.data(), frames );
+		}
+		delete resampled;
+	}
+
+	// transforming the impulse response is done, only swap it in
+	Engine::mixer()->runInAudioThread( [this, &convolvers]()
+	{
+		std::swap( m_convolvers[0], convolvers[0] );
+		std::swap( m_convolvers[1], convolvers[1] );
+	} );
+	delete convolvers[0];
+	delete convolvers[1];
+}
+
+
+
+
+bool ConvolverEffect::processAudioBuffer( sampleFrame* buf, const fpp_t frames )
+{
+	if( !isEnabled() || !isRunning () )
+	{
+		return( false );
+	}
+
+	double outSum = 0.0;
+	const float d = dryLevel();
+	const float w = wetLevel() * dbfsToAmp( m_convolverControls.m_gainModel.value() );
+
+	if( m_convolvers[0] == NULL )
+	{
+		for( fpp_t f = 0; f < frames; ++f )
+		{
+			buf[f][0] *= d;
+			buf[f][1] *= d;
+			outSum += buf[f][0] * buf[f][0] + buf[f][1] * buf[f][1];
+		}
+		checkGate( outSum / frames );
+		return isRunning();
+	}
+
+	ScratchBuffer<float> left( frames );
+	ScratchBuffer<float> right( frames );
+	for( fpp_t f = 0; f < frames; ++f )
+	{
+		left[f] = buf[f][0];
+		right[f] = buf[f][1];
+	}
+
+	m_convolvers[0]->process( left.data(), frames );
+	m_convolvers[1]->process( right.data(), frames );
+
+	for( fpp_t f = 0; f < frames; ++f )
+	{
+		buf[f][0] = d * buf[f][0] + w * left[f];
+		buf[f][1] = d * buf[f][1] + w * right[f];
+		outSum += buf[f][0] * buf[f][0] + buf[f][1] * buf[f][1];
+	}
+
+	checkGate( outSum / frames );
+
+	return isRunning();
+}
+
+
+
+
+
+extern "C"
+{
+
+// necessary for getting instance out of shared lib
+PLUGIN_EXPORT Plugin * lmms_plugin_main( Model* parent, void* data )
+{
+	return new ConvolverEffect( parent, static_cast<const Plugin::Descriptor::SubPluginFeatures::Key *>( data ) );
+}
+
+}
@@ -0,0 +1,58 @@
+/*
+ * Convolver.h - convolution with impulse responses from audio files
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+#ifndef CONVOLVER_H
+#define CONVOLVER_H
+
+#include "Effect.h"
+#include "ConvolverControls.h"
+
+class PartitionedConvolver;
+
+class ConvolverEffect : public Effect
+{
+public:
+	ConvolverEffect( Model* parent, const Descriptor::SubPluginFeatures::Key* key );
+	virtual ~ConvolverEffect();
+	virtual bool processAudioBuffer( sampleFrame* buf, const fpp_t frames );
+
+	virtual EffectControls* controls()
+	{
+		return &m_convolverControls;
+	}
+
+	//! Load the impulse response and swap it in, without an empty file
+	//! the effect only passes the dry signal
+	void loadImpulseResponse( const QString & file );
+
+
+private:
+	ConvolverControls m_convolverControls;
+	// per channel, NULL without impulse response
+	PartitionedConvolver * m_convolvers[2];
+
+	friend class ConvolverControls;
+
+} ;
+
+#endif
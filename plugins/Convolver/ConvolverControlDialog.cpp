@@ -0,0 +1,87 @@
+/*
+ * ConvolverControlDialog.cpp - control dialog for the convolver effect
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <QFileInfo>
+#include <QLabel>
+
+#include "ConvolverControlDialog.h"
+#include "ConvolverControls.h"
+#include "embed.h"
+#include "PixmapButton.h"
+#include "SampleBuffer.h"
+#include "ToolTip.h"
+
+
+
+ConvolverControlDialog::ConvolverControlDialog( ConvolverControls* controls ) :
+	EffectControlDialog( controls ),
+	m_controls( controls )
+{
+	setAutoFillBackground( true );
+	QPalette pal;
+	pal.setBrush( backgroundRole(), PLUGIN_NAME::getIconPixmap( "artwork" ) );
+	setPalette( pal );
+	setFixedSize( 185, 55 );
+
+	PixmapButton * openButton = new PixmapButton( this );
+	openButton->setCursor( QCursor( Qt::PointingHandCursor ) );
+	openButton->move( 16, 14 );
+	openButton->setActiveGraphic( embed::getIconPixmap( "project_open" ) );
+	openButton->setInactiveGraphic( embed::getIconPixmap( "project_open" ) );
+	connect( openButton, SIGNAL( clicked() ), this, SLOT( openImpulseResponse() ) );
+	ToolTip::add( openButton, tr( "Open impulse response" ) );
+
+	m_fileLabel = new QLabel( this );
+	m_fileLabel->setGeometry( 44, 14, 90, 26 );
+	m_fileLabel->setWordWrap( true );
+	connect( controls, SIGNAL( impulseResponseChanged() ), this, SLOT( updateFileName() ) );
+	updateFileName();
+
+	Knob * gainKnob = new Knob( knobBright_26, this);
+	gainKnob -> move( 139, 10 );
+	gainKnob->setModel( &controls->m_gainModel );
+	gainKnob->setLabel( tr( "Gain" ) );
+	gainKnob->setHintText( tr( "Gain:" ) , "dB" );
+}
+
+
+
+
+void ConvolverControlDialog::openImpulseResponse()
+{
+	const QString file = SampleBuffer().openAudioFile();
+	if( !file.isEmpty() )
+	{
+		m_controls->setImpulseResponseFile( file );
+	}
+}
+
+
+
+
+void ConvolverControlDialog::updateFileName()
+{
+	const QString & file = m_controls->impulseResponseFile();
+	m_fileLabel->setText( file.isEmpty() ? tr( "No impulse response" ) :
+						QFileInfo( file ).fileName() );
+	m_fileLabel->setToolTip( file );
+}
@@ -1,7 +1,5 @@
 /*
- * monodelay.h - defination of MonoDelay class.
- *
- * Copyright (c) 2014 David French <dave/dot/french3/at/googlemail/dot/com>
+ * ConvolverControlDialog.h - control dialog for the convolver effect
  *
  * This file is part of LMMS - https://lmms.io
  *
@@ -22,39 +20,34 @@
  *
  */
 
-#ifndef MONODELAY_H
-#define MONODELAY_H
+#ifndef CONVOLVER_CONTROL_DIALOG_H
+#define CONVOLVER_CONTROL_DIALOG_H
+
+#include "EffectControlDialog.h"
+
+
+class QLabel;
+class ConvolverControls;
 
-#include "lmms_basics.h"
 
-class MonoDelay
+class ConvolverControlDialog : public EffectControlDialog
 {
+	Q_OBJECT
 public:
-	MonoDelay( int maxTime , int sampleRate );
-	~MonoDelay();
-	inline void setLength( float length )
+	ConvolverControlDialog( ConvolverControls* controls );
+	virtual ~ConvolverControlDialog()
 	{
-		if( length <= m_maxLength && length >= 0 )
-		{
-			m_length = length;
-		}
 	}
 
-	inline void setFeedback( float feedback )
-	{
-		m_feedback = feedback;
-	}
 
-	void tick( sample_t* sample );
-	void setSampleRate( int sampleRate );
+private slots:
+	void openImpulseResponse();
+	void updateFileName();
 
 private:
-	sample_t* m_buffer;
-	int m_maxLength;
-	float m_length;
-	int m_writeIndex;
-	float m_feedback;
-	float m_maxTime;
-};
-
-#endif // MONODELAY_H
+	ConvolverControls* m_controls;
+	QLabel* m_fileLabel;
+
+} ;
+
+#endif
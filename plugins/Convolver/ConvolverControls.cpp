@@ -0,0 +1,75 @@
+/*
+ * ConvolverControls.cpp - controls for the convolver effect
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+#include <QDomElement>
+
+#include "ConvolverControls.h"
+#include "Convolver.h"
+#include "Engine.h"
+#include "Mixer.h"
+#include "SampleBuffer.h"
+
+
+ConvolverControls::ConvolverControls( ConvolverEffect* effect ) :
+	EffectControls( effect ),
+	m_effect( effect ),
+	m_gainModel( 0.0f, -60.0f, 15.0f, 0.1f, this, tr( "Gain" ) )
+{
+	connect( Engine::mixer(), SIGNAL( sampleRateChanged() ), this, SLOT( changeSampleRate() ) );
+}
+
+
+
+
+void ConvolverControls::setImpulseResponseFile( const QString & file )
+{
+	m_irFile = SampleBuffer::tryToMakeRelative( file );
+	m_effect->loadImpulseResponse( SampleBuffer::tryToMakeAbsolute( m_irFile ) );
+	emit impulseResponseChanged();
+}
+
+
+
+
+void ConvolverControls::changeSampleRate()
+{
+	m_effect->loadImpulseResponse( SampleBuffer::tryToMakeAbsolute( m_irFile ) );
+}
+
+
+
+
+void ConvolverControls::loadSettings( const QDomElement& _this )
+{
+	m_gainModel.loadSettings( _this, "gain" );
+	setImpulseResponseFile( _this.attribute( "irfile" ) );
+}
+
+
+
+
+void ConvolverControls::saveSettings( QDomDocument& doc, QDomElement& _this )
+{
+	m_gainModel.saveSettings( doc, _this, "gain" );
+	_this.setAttribute( "irfile", m_irFile );
+}
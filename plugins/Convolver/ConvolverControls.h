@@ -0,0 +1,85 @@
+/*
+ * ConvolverControls.h - controls for the convolver effect
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef CONVOLVER_CONTROLS_H
+#define CONVOLVER_CONTROLS_H
+
+#include "EffectControls.h"
+#include "ConvolverControlDialog.h"
+#include "Knob.h"
+
+
+class ConvolverEffect;
+
+
+class ConvolverControls : public EffectControls
+{
+	Q_OBJECT
+public:
+	ConvolverControls( ConvolverEffect* effect );
+	virtual ~ConvolverControls()
+	{
+	}
+
+	virtual void saveSettings( QDomDocument & _doc, QDomElement & _parent );
+	virtual void loadSettings( const QDomElement & _this );
+	inline virtual QString nodeName() const
+	{
+		return "ConvolverControls";
+	}
+
+	virtual int controlCount()
+	{
+		return 2;
+	}
+
+	virtual EffectControlDialog* createView()
+	{
+		return new ConvolverControlDialog( this );
+	}
+
+	const QString & impulseResponseFile() const
+	{
+		return m_irFile;
+	}
+
+	void setImpulseResponseFile( const QString & file );
+
+
+signals:
+	void impulseResponseChanged();
+
+
+private slots:
+	void changeSampleRate();
+
+private:
+	ConvolverEffect* m_effect;
+	FloatModel m_gainModel;
+	QString m_irFile;
+
+	friend class ConvolverControlDialog;
+	friend class ConvolverEffect;
+
+} ;
+
+#endif
@@ -27,7 +27,10 @@
 #include "CrossoverEQ.h"
 #include "lmms_math.h"
 #include "embed.h"
+#include "fft_helpers.h"
+#include "PartitionedConvolver.h"
 #include "plugin_export.h"
+#include "ScratchArena.h"
 
 extern "C"
 {
@@ -60,9 +63,11 @@ CrossoverEQEffect::CrossoverEQEffect( Model* parent, const Descriptor::SubPlugin
 	m_hp4( m_sampleRate ),
 	m_needsUpdate( true )
 {
-	m_tmp1 = MM_ALLOC( sampleFrame, Engine::mixer()->framesPerPeriod() );
-	m_tmp2 = MM_ALLOC( sampleFrame, Engine::mixer()->framesPerPeriod() );
-	m_work = MM_ALLOC( sampleFrame, Engine::mixer()->framesPerPeriod() );
+	m_tmp1 = MM_ALLOC_TAGGED( sampleFrame, Engine::mixer()->framesPerPeriod(), Plugins );
+	m_tmp2 = MM_ALLOC_TAGGED( sampleFrame, Engine::mixer()->framesPerPeriod(), Plugins );
+	m_work = MM_ALLOC_TAGGED( sampleFrame, Engine::mixer()->framesPerPeriod(), Plugins );
+	m_band = MM_ALLOC_TAGGED( sampleFrame, Engine::mixer()->framesPerPeriod(), Plugins );
+	m_linearPhase[0] = m_linearPhase[1] = NULL;
 }
 
 CrossoverEQEffect::~CrossoverEQEffect()
@@ -70,6 +75,9 @@ CrossoverEQEffect::~CrossoverEQEffect()
 	MM_FREE( m_tmp1 );
 	MM_FREE( m_tmp2 );
 	MM_FREE( m_work );
+	MM_FREE( m_band );
+	delete m_linearPhase[0];
+	delete m_linearPhase[1];
 }
 
 void CrossoverEQEffect::sampleRateChanged()
@@ -134,61 +142,59 @@ bool CrossoverEQEffect::processAudioBuffer( sampleFrame* buf, const fpp_t frames
 	const bool mute4 = m_controls.m_mute4.value();
 	
 	m_needsUpdate = false;
-	
-	memset( m_work, 0, sizeof( sampleFrame ) * frames );
-	
-	// run temp bands
-	for( int f = 0; f < frames; ++f )
-	{
-		m_tmp1[f][0] = m_lp2.update( buf[f][0], 0 );
-		m_tmp1[f][1] = m_lp2.update( buf[f][1], 1 );
-		m_tmp2[f][0] = m_hp3.update( buf[f][0], 0 );
-		m_tmp2[f][1] = m_hp3.update( buf[f][1], 1 );
-	}
 
-	// run band 1
-	if( mute1 )
+	const float d = dryLevel();
+	const float w = wetLevel();
+	double outSum = 0.0;
+
+	if( m_linearPhase[0] )
 	{
+		ScratchBuffer<float> left( frames );
+		ScratchBuffer<float> right( frames );
 		for( int f = 0; f < frames; ++f )
 		{
-			m_work[f][0] += m_lp1.update( m_tmp1[f][0], 0 ) * m_gain1;
-			m_work[f][1] += m_lp1.update( m_tmp1[f][1], 1 ) * m_gain1;
+			left[f] = buf[f][0];
+			right[f] = buf[f][1];
 		}
-	}
-	
-	// run band 2
-	if( mute2 )
-	{
+
+		m_linearPhase[0]->process( left.data(), frames );
+		m_linearPhase[1]->process( right.data(), frames );
+
 		for( int f = 0; f < frames; ++f )
 		{
-			m_work[f][0] += m_hp2.update( m_tmp1[f][0], 0 ) * m_gain2;
-			m_work[f][1] += m_hp2.update( m_tmp1[f][1], 1 ) * m_gain2;
+			buf[f][0] = d * buf[f][0] + w * left[f];
+			buf[f][1] = d * buf[f][1] + w * right[f];
+			outSum += buf[f][0] * buf[f][0] + buf[f][1] * buf[f][1];
 		}
+
+		checkGate( outSum / frames );
+
+		return isRunning();
 	}
-	
-	// run band 3
-	if( mute3 )
+
+	memset( m_work, 0, sizeof( sampleFrame ) * frames );
+
+	// the low and high pass of each split run side by side, splits whose
+	// bands are all muted are skipped
+	const bool lowBands = mute1 || mute2;
+	const bool highBands = mute3 || mute4;
+	if( lowBands || highBands )
 	{
-		for( int f = 0; f < frames; ++f )
-		{
-			m_work[f][0] += m_lp3.update( m_tmp2[f][0], 0 ) * m_gain3;
-			m_work[f][1] += m_lp3.update( m_tmp2[f][1], 1 ) * m_gain3;
-		}
+		StereoLinkwitzRiley::processPair( m_lp2, m_hp3, buf, m_tmp1, m_tmp2, frames );
 	}
-	
-	// run band 4
-	if( mute4 )
+	if( lowBands )
 	{
-		for( int f = 0; f < frames; ++f )
-		{
-			m_work[f][0] += m_hp4.update( m_tmp2[f][0], 0 ) * m_gain4;
-			m_work[f][1] += m_hp4.update( m_tmp2[f][1], 1 ) * m_gain4;
-		}
+		StereoLinkwitzRiley::processPair( m_lp1, m_hp2, m_tmp1, m_tmp1, m_band, frames );
+		addBand( m_tmp1, mute1, m_gain1, frames );
+		addBand( m_band, mute2, m_gain2, frames );
 	}
-	
-	const float d = dryLevel();
-	const float w = wetLevel();
-	double outSum = 0.0;
+	if( highBands )
+	{
+		StereoLinkwitzRiley::processPair( m_lp3, m_hp4, m_tmp2, m_tmp2, m_band, frames );
+		addBand( m_tmp2, mute3, m_gain3, frames );
+		addBand( m_band, mute4, m_gain4, frames );
+	}
+
 	for( int f = 0; f < frames; ++f )
 	{
 		buf[f][0] = d * buf[f][0] + w * m_work[f][0];
@@ -201,6 +207,108 @@ bool CrossoverEQEffect::processAudioBuffer( sampleFrame* buf, const fpp_t frames
 	return isRunning();
 }
 
+void CrossoverEQEffect::addBand( const sampleFrame * band, bool active, float gain, const fpp_t frames )
+{
+	if( !active )
+	{
+		return;
+	}
+	if( gain == 1.0f )
+	{
+		for( int f = 0; f < frames; ++f )
+		{
+			m_work[f][0] += band[f][0];
+			m_work[f][1] += band[f][1];
+		}
+		return;
+	}
+	for( int f = 0; f < frames; ++f )
+	{
+		m_work[f][0] += band[f][0] * gain;
+		m_work[f][1] += band[f][1] * gain;
+	}
+}
+
+
+std::vector<float> CrossoverEQEffect::linearPhaseResponse() const
+{
+	// the magnitudes of the Linkwitz-Riley filters the bands are split
+	// with, at the frequencies they were warped to by the bilinear
+	// transform, delayed by half of the response
+	const int size = LinearPhaseSize;
+	const int bins = size / 2 + 1;
+	fftwf_complex * spectrum = (fftwf_complex *) fftwf_malloc( bins * sizeof( fftwf_complex ) );
+	float * response = (float *) fftwf_malloc( size * sizeof( float ) );
+	float * window = (float *) fftwf_malloc( size * sizeof( float ) );
+	fftwf_plan plan = realIFFTPlan( size, spectrum, response );
+
+	const double warp12 = tan( D_PI * m_controls.m_xover12.value() / m_sampleRate );
+	const double warp23 = tan( D_PI * m_controls.m_xover23.value() / m_sampleRate );
+	const double warp34 = tan( D_PI * m_controls.m_xover34.value() / m_sampleRate );
+	const double gains[4] = {
+		m_controls.m_mute1.value() ? dbfsToAmp( m_controls.m_gain1.value() ) : 0.0,
+		m_controls.m_mute2.value() ? dbfsToAmp( m_controls.m_gain2.value() ) : 0.0,
+		m_controls.m_mute3.value() ? dbfsToAmp( m_controls.m_gain3.value() ) : 0.0,
+		m_controls.m_mute4.value() ? dbfsToAmp( m_controls.m_gain4.value() ) : 0.0 };
+
+	for( int k = 0; k < bins; ++k )
+	{
+		const double warped = tan( D_PI * k / size );
+		const double r12 = pow( warped / warp12, 4.0 );
+		const double r23 = pow( warped / warp23, 4.0 );
+		const double r34 = pow( warped / warp34, 4.0 );
+		const double lp12 = 1.0 / ( 1.0 + r12 );
+		const double lp23 = 1.0 / ( 1.0 + r23 );
+		const double lp34 = 1.0 / ( 1.0 + r34 );
+		const double magnitude =
+			gains[0] * lp12 * lp23 +
+			gains[1] * ( 1.0 - lp12 ) * lp23 +
+			gains[2] * ( 1.0 - lp23 ) * lp34 +
+			gains[3] * ( 1.0 - lp23 ) * ( 1.0 - lp34 );
+		spectrum[k][0] = ( k & 1 ? -magnitude : magnitude ) / size;
+		spectrum[k][1] = 0.0f;
+	}
+
+	fftwf_execute_dft_c2r( plan, spectrum, response );
+	precomputeWindow( window, size, HANNING, false );
+
+	std::vector<float> result( size );
+	for( int i = 0; i < size; ++i )
+	{
+		result[i] = response[i] * window[i];
+	}
+
+	fftwf_free( spectrum );
+	fftwf_free( response );
+	fftwf_free( window );
+	return result;
+}
+
+
+void CrossoverEQEffect::updateLinearPhase()
+{
+	PartitionedConvolver * convolvers[2] = { NULL, NULL };
+	if( m_controls.m_linearPhase.value() )
+	{
+		const std::vector<float> response = linearPhaseResponse();
+		for( int ch = 0; ch < 2; ++ch )
+		{
+			convolvers[ch] = new PartitionedConvolver( response.data(), response.size() );
+		}
+	}
+
+	// designing and transforming is done, only swap it in
+	Engine::mixer()->runInAudioThread( [this, &convolvers]()
+	{
+		std::swap( m_linearPhase[0], convolvers[0] );
+		std::swap( m_linearPhase[1], convolvers[1] );
+		clearFilterHistories();
+	} );
+	delete convolvers[0];
+	delete convolvers[1];
+}
+
+
 void CrossoverEQEffect::clearFilterHistories()
 {
 	m_lp1.clearHistory();
@@ -33,6 +33,10 @@
 #include "lmms_math.h"
 #include "BasicFilters.h"
 
+#include <vector>
+
+class PartitionedConvolver;
+
 class CrossoverEQEffect : public Effect
 {
 public:
@@ -45,12 +49,27 @@ public:
 		return &m_controls;
 	}
 
+	virtual f_cnt_t latencyFrames() const
+	{
+		return m_linearPhase[0] ? LinearPhaseSize / 2 : 0;
+	}
+
 	void clearFilterHistories();
+
+	//! Designs the linear phase response of the current settings and swaps
+	//! it in, or drops it if linear phase is off. Don't call it from the
+	//! audio thread.
+	void updateLinearPhase();
 	
 private:
 	CrossoverEQControls m_controls;
 
+	// taps of the linear phase response, half of them is its latency
+	static const int LinearPhaseSize = 4096;
+
 	void sampleRateChanged();
+	void addBand( const sampleFrame * band, bool active, float gain, const fpp_t frames );
+	std::vector<float> linearPhaseResponse() const;
 
 	float m_sampleRate;
 	
@@ -70,6 +89,10 @@ private:
 	sampleFrame * m_tmp1;
 	sampleFrame * m_tmp2;
 	sampleFrame * m_work;
+	sampleFrame * m_band;
+
+	// per channel, NULL unless linear phase is on
+	PartitionedConvolver * m_linearPhase[2];
 	
 	bool m_needsUpdate;
 	
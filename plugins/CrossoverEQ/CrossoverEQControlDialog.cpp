@@ -112,4 +112,9 @@ CrossoverEQControlDialog::CrossoverEQControlDialog( CrossoverEQControls * contro
 	mute4->move( 135, 154 );
 	mute4->setModel( & controls->m_mute4 );
 	ToolTip::add( mute4, tr( "Mute band 4" ) );
+
+	LedCheckBox * linearPhase = new LedCheckBox( "", this, tr( "Linear phase" ), LedCheckBox::Green );
+	linearPhase->move( 150, 4 );
+	linearPhase->setModel( & controls->m_linearPhase );
+	ToolTip::add( linearPhase, tr( "Split the bands with linear phase filters, which adds latency" ) );
 }
@@ -40,12 +40,23 @@ CrossoverEQControls::CrossoverEQControls( CrossoverEQEffect * eff ) :
 	m_mute1( true, this, "Mute Band 1" ),
 	m_mute2( true, this, "Mute Band 2" ),
 	m_mute3( true, this, "Mute Band 3" ),
-	m_mute4( true, this, "Mute Band 4" )
+	m_mute4( true, this, "Mute Band 4" ),
+	m_linearPhase( false, this, "Linear Phase" )
 {
 	connect( Engine::mixer(), SIGNAL( sampleRateChanged() ), this, SLOT( sampleRateChanged() ) );
 	connect( &m_xover12, SIGNAL( dataChanged() ), this, SLOT( xover12Changed() ) );
 	connect( &m_xover23, SIGNAL( dataChanged() ), this, SLOT( xover23Changed() ) );
 	connect( &m_xover34, SIGNAL( dataChanged() ), this, SLOT( xover34Changed() ) );
+
+	// the linear phase response covers all settings, changes made by
+	// automation are queued to this thread
+	Model * models[] = { &m_xover12, &m_xover23, &m_xover34,
+		&m_gain1, &m_gain2, &m_gain3, &m_gain4,
+		&m_mute1, &m_mute2, &m_mute3, &m_mute4, &m_linearPhase };
+	for( Model * model : models )
+	{
+		connect( model, SIGNAL( dataChanged() ), this, SLOT( updateLinearPhase() ) );
+	}
 	
 	m_xover12.setScaleLogarithmic( true );
 	m_xover23.setScaleLogarithmic( true );
@@ -67,6 +78,8 @@ void CrossoverEQControls::saveSettings( QDomDocument & doc, QDomElement & elem )
 	m_mute2.saveSettings( doc, elem, "mute2" );
 	m_mute3.saveSettings( doc, elem, "mute3" );
 	m_mute4.saveSettings( doc, elem, "mute4" );
+
+	m_linearPhase.saveSettings( doc, elem, "linearphase" );
 }
 
 void CrossoverEQControls::loadSettings( const QDomElement & elem )
@@ -84,6 +97,8 @@ void CrossoverEQControls::loadSettings( const QDomElement & elem )
 	m_mute2.loadSettings( elem, "mute2" );
 	m_mute3.loadSettings( elem, "mute3" );
 	m_mute4.loadSettings( elem, "mute4" );
+
+	m_linearPhase.loadSettings( elem, "linearphase" );
 	
 	m_effect->m_needsUpdate = true;
 	m_effect->clearFilterHistories();
@@ -114,4 +129,15 @@ void CrossoverEQControls::xover34Changed()
 void CrossoverEQControls::sampleRateChanged()
 {
 	m_effect->sampleRateChanged();
+	updateLinearPhase();
+}
+
+
+void CrossoverEQControls::updateLinearPhase()
+{
+	// nothing to drop or design while it's off
+	if( m_linearPhase.value() || m_effect->m_linearPhase[0] )
+	{
+		m_effect->updateLinearPhase();
+	}
 }
@@ -48,7 +48,7 @@ public:
 
 	virtual int controlCount()
 	{
-		return( 11 );
+		return( 12 );
 	}
 
 	virtual EffectControlDialog * createView()
@@ -61,6 +61,7 @@ private slots:
 	void xover23Changed();
 	void xover34Changed();
 	void sampleRateChanged();
+	void updateLinearPhase();
 
 private:
 	CrossoverEQEffect * m_effect;
@@ -78,6 +79,8 @@ private:
 	BoolModel m_mute2;
 	BoolModel m_mute3;
 	BoolModel m_mute4;
+
+	BoolModel m_linearPhase;
 	
 	friend class CrossoverEQControlDialog;
 	friend class CrossoverEQEffect;
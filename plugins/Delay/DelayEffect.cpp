@@ -27,6 +27,7 @@
 #include "embed.h"
 #include "interpolation.h"
 #include "plugin_export.h"
+#include "ScratchArena.h"
 
 extern "C"
 {
@@ -51,10 +52,9 @@ DelayEffect::DelayEffect( Model* parent, const Plugin::Descriptor::SubPluginFeat
 	Effect( &delay_plugin_descriptor, parent, key ),
 	m_delayControls( this )
 {
-	m_delay = 0;
-	m_delay = new StereoDelay( 20, Engine::mixer()->processingSampleRate() );
 	m_lfo = new Lfo( Engine::mixer()->processingSampleRate() );
 	m_outGain = 1.0;
+	changeSampleRate();
 }
 
 
@@ -62,10 +62,6 @@ DelayEffect::DelayEffect( Model* parent, const Plugin::Descriptor::SubPluginFeat
 
 DelayEffect::~DelayEffect()
 {
-	if( m_delay )
-	{
-		delete m_delay;
-	}
 	if( m_lfo )
 	{
 		delete m_lfo;
@@ -81,11 +77,7 @@ bool DelayEffect::processAudioBuffer( sampleFrame* buf, const fpp_t frames )
 	{
 		return( false );
 	}
-	double outSum = 0.0;
 	const float sr = Engine::mixer()->processingSampleRate();
-	const float d = dryLevel();
-	const float w = wetLevel();
-	sample_t dryS[2];
 	float lPeak = 0.0;
 	float rPeak = 0.0;
 	float length = m_delayControls.m_delayTimeModel.value();
@@ -99,45 +91,51 @@ bool DelayEffect::processAudioBuffer( sampleFrame* buf, const fpp_t frames )
 	int lengthInc = lengthBuffer ? 1 : 0;
 	int amplitudeInc = lfoAmountBuffer ? 1 : 0;
 	int lfoTimeInc = lfoTimeBuffer ? 1 : 0;
-	int feedbackInc = feedbackBuffer ? 1 : 0;
 	float *lengthPtr = lengthBuffer ? &( lengthBuffer->values()[ 0 ] ) : &length;
 	float *amplitudePtr = lfoAmountBuffer ? &( lfoAmountBuffer->values()[ 0 ] ) : &amplitude;
 	float *lfoTimePtr = lfoTimeBuffer ? &( lfoTimeBuffer->values()[ 0 ] ) : &lfoTime;
-	float *feedbackPtr = feedbackBuffer ? &( feedbackBuffer->values()[ 0 ] ) : &feedback;
+	// the delay lines take one feedback per period
+	const float periodFeedback = feedbackBuffer ? feedbackBuffer->values()[ 0 ] : feedback;
 
 	if( m_delayControls.m_outGainModel.isValueChanged() )
 	{
 		m_outGain = dbfsToAmp( m_delayControls.m_outGainModel.value() );
 	}
+
+	// delay lengths of all frames and the channels on their own
+	ScratchBuffer<float> work( frames * 3 );
+	float * lengths = work.data();
+	sample_t * wet[2] = { lengths + frames, lengths + frames * 2 };
 	int sampleLength;
 	for( fpp_t f = 0; f < frames; ++f )
 	{
-		dryS[0] = buf[f][0];
-		dryS[1] = buf[f][1];
-
-		m_delay->setFeedback( *feedbackPtr );
 		m_lfo->setFrequency( *lfoTimePtr );
-		sampleLength = *lengthPtr * Engine::mixer()->processingSampleRate();
-		m_currentLength = sampleLength;
-		m_delay->setLength( m_currentLength + ( *amplitudePtr * ( float )m_lfo->tick() ) );
-		m_delay->tick( buf[f] );
-
-		buf[f][0] *= m_outGain;
-		buf[f][1] *= m_outGain;
-
-		lPeak = buf[f][0] > lPeak ? buf[f][0] : lPeak;
-		rPeak = buf[f][1] > rPeak ? buf[f][1] : rPeak;
-
-		buf[f][0] = ( d * dryS[0] ) + ( w * buf[f][0] );
-		buf[f][1] = ( d * dryS[1] ) + ( w * buf[f][1] );
-		outSum += buf[f][0]*buf[f][0] + buf[f][1]*buf[f][1];
+		sampleLength = *lengthPtr * sr;
+		lengths[f] = sampleLength + ( *amplitudePtr * ( float )m_lfo->tick() );
+		wet[0][f] = buf[f][0];
+		wet[1][f] = buf[f][1];
 
 		lengthPtr += lengthInc;
 		amplitudePtr += amplitudeInc;
 		lfoTimePtr += lfoTimeInc;
-		feedbackPtr += feedbackInc;
 	}
-	checkGate( outSum / frames );
+
+	for( int ch = 0; ch < 2; ++ch )
+	{
+		m_delay[ch].process( wet[ch], lengths, periodFeedback, frames );
+	}
+
+	for( fpp_t f = 0; f < frames; ++f )
+	{
+		const sample_t l = wet[0][f] * m_outGain;
+		const sample_t r = wet[1][f] * m_outGain;
+
+		lPeak = l > lPeak ? l : lPeak;
+		rPeak = r > rPeak ? r : rPeak;
+
+		buf[f][0] = l;
+		buf[f][1] = r;
+	}
 	m_delayControls.m_outPeakL = lPeak;
 	m_delayControls.m_outPeakR = rPeak;
 
@@ -147,7 +145,11 @@ bool DelayEffect::processAudioBuffer( sampleFrame* buf, const fpp_t frames )
 void DelayEffect::changeSampleRate()
 {
 	m_lfo->setSampleRate( Engine::mixer()->processingSampleRate() );
-	m_delay->setSampleRate( Engine::mixer()->processingSampleRate() );
+	for( int ch = 0; ch < 2; ++ch )
+	{
+		// up to 20 seconds
+		m_delay[ch].setMaxDelay( 20 * Engine::mixer()->processingSampleRate() );
+	}
 }
 
 
@@ -25,10 +25,10 @@
 #ifndef DELAYEFFECT_H
 #define DELAYEFFECT_H
 
+#include "DelayLine.h"
 #include "Effect.h"
 #include "DelayControls.h"
 #include "Lfo.h"
-#include "StereoDelay.h"
 #include "ValueBuffer.h"
 
 class DelayEffect : public Effect
@@ -37,6 +37,11 @@ public:
 	DelayEffect(Model* parent , const Descriptor::SubPluginFeatures::Key* key );
 	virtual ~DelayEffect();
 	virtual bool processAudioBuffer( sampleFrame* buf, const fpp_t frames );
+
+	virtual bool writesWetOnly() const
+	{
+		return true;
+	}
 	virtual EffectControls* controls()
 	{
 		return &m_delayControls;
@@ -45,10 +50,9 @@ public:
 
 private:
 	DelayControls m_delayControls;
-	StereoDelay* m_delay;
+	DelayLine m_delay[2];
 	Lfo* m_lfo;
 	float m_outGain;
-	float m_currentLength;
 };
 
 #endif // DELAYEFFECT_H
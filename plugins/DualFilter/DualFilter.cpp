@@ -25,8 +25,11 @@
 
 #include "DualFilter.h"
 
+#include <cstring>
+
 #include "embed.h"
 #include "BasicFilters.h"
+#include "ScratchArena.h"
 #include "plugin_export.h"
 
 extern "C"
@@ -73,6 +76,36 @@ DualFilterEffect::~DualFilterEffect()
 
 
 
+// filters _buf in blocks of frames with the same cutoff and resonance
+static void filterBlocks( BasicFilters<2> * _filter, sampleFrame * _buf,
+				const float * _cut, int _cutInc,
+				const float * _res, int _resInc,
+				float & _currentCut, float & _currentRes,
+				bool & _changed, const fpp_t _frames )
+{
+	fpp_t blockStart = 0;
+	for( fpp_t f = 0; f < _frames; ++f )
+	{
+		// recalculate only when necessary: either cut/res is changed, or the changed-flag is set (filter type or samplerate changed)
+		if( *_cut != _currentCut || *_res != _currentRes || _changed )
+		{
+			_filter->processBlock( _buf + blockStart, f - blockStart );
+			blockStart = f;
+
+			_filter->calcFilterCoeffs( *_cut, *_res );
+			_changed = false;
+			_currentCut = *_cut;
+			_currentRes = *_res;
+		}
+		_cut += _cutInc;
+		_res += _resInc;
+	}
+	_filter->processBlock( _buf + blockStart, _frames - blockStart );
+}
+
+
+
+
 bool DualFilterEffect::processAudioBuffer( sampleFrame* buf, const fpp_t frames )
 {
 	if( !isEnabled() || !isRunning () )
@@ -80,10 +113,6 @@ bool DualFilterEffect::processAudioBuffer( sampleFrame* buf, const fpp_t frames
 		return( false );
 	}
 
-	double outSum = 0.0;
-	const float d = dryLevel();
-	const float w = wetLevel();
-
     if( m_dfControls.m_filter1Model.isValueChanged() || m_filter1changed )
 	{
 		m_filter1->setFilterType( m_dfControls.m_filter1Model.value() );
@@ -133,6 +162,24 @@ bool DualFilterEffect::processAudioBuffer( sampleFrame* buf, const fpp_t frames
 	
 	
 
+	// both filters run over the whole buffer first
+	ScratchBuffer<sampleFrame> filtered1( enabled1 ? frames : 0 );
+	ScratchBuffer<sampleFrame> filtered2( enabled2 ? frames : 0 );
+	if( enabled1 )
+	{
+		memcpy( filtered1.data(), buf, frames * sizeof( sampleFrame ) );
+		filterBlocks( m_filter1, filtered1.data(), cut1Ptr, cut1Inc,
+				res1Ptr, res1Inc, m_currentCut1, m_currentRes1,
+				m_filter1changed, frames );
+	}
+	if( enabled2 )
+	{
+		memcpy( filtered2.data(), buf, frames * sizeof( sampleFrame ) );
+		filterBlocks( m_filter2, filtered2.data(), cut2Ptr, cut2Inc,
+				res2Ptr, res2Inc, m_currentCut2, m_currentRes2,
+				m_filter2changed, frames );
+	}
+
 	// buffer processing loop
 	for( fpp_t f = 0; f < frames; ++f )
 	{
@@ -142,75 +189,32 @@ bool DualFilterEffect::processAudioBuffer( sampleFrame* buf, const fpp_t frames
 		const float gain1 = *gain1Ptr * 0.01f;
 		const float gain2 = *gain2Ptr * 0.01f;
 		sample_t s[2] = { 0.0f, 0.0f };	// mix
-		sample_t s1[2] = { buf[f][0], buf[f][1] };	// filter 1
-		sample_t s2[2] = { buf[f][0], buf[f][1] };	// filter 2
 
-		// update filter 1
+		// filter 1
 		if( enabled1 )
 		{
-			//update filter 1 params here
-			// recalculate only when necessary: either cut/res is changed, or the changed-flag is set (filter type or samplerate changed)
-			if( ( ( *cut1Ptr != m_currentCut1 ||
-				*res1Ptr != m_currentRes1 ) ) || m_filter1changed )
-			{
-				m_filter1->calcFilterCoeffs( *cut1Ptr, *res1Ptr );
-				m_filter1changed = false;
-				m_currentCut1 = *cut1Ptr;
-				m_currentRes1 = *res1Ptr;
-			}
-			s1[0] = m_filter1->update( s1[0], 0 );
-			s1[1] = m_filter1->update( s1[1], 1 );
-
-			// apply gain
-			s1[0] *= gain1;
-			s1[1] *= gain1;
-
-			// apply mix
-			s[0] += ( s1[0] * mix1 );
-			s[1] += ( s1[1] * mix1 );
+			// apply gain and mix
+			s[0] += ( filtered1[f][0] * gain1 * mix1 );
+			s[1] += ( filtered1[f][1] * gain1 * mix1 );
 		}
 
-		// update filter 2
+		// filter 2
 		if( enabled2 )
 		{
-			//update filter 2 params here
-			if( ( ( *cut2Ptr != m_currentCut2 ||
-								*res2Ptr != m_currentRes2 ) ) || m_filter2changed )
-			{
-				m_filter2->calcFilterCoeffs( *cut2Ptr, *res2Ptr );
-				m_filter2changed = false;
-				m_currentCut2 = *cut2Ptr;
-				m_currentRes2 = *res2Ptr;
-			}
-			s2[0] = m_filter2->update( s2[0], 0 );
-			s2[1] = m_filter2->update( s2[1], 1 );
-
-			//apply gain
-			s2[0] *= gain2;
-			s2[1] *= gain2;
-
-			// apply mix
-			s[0] += ( s2[0] * mix2 );
-			s[1] += ( s2[1] * mix2 );
+			// apply gain and mix
+			s[0] += ( filtered2[f][0] * gain2 * mix2 );
+			s[1] += ( filtered2[f][1] * gain2 * mix2 );
 		}
 
-		// do another mix with dry signal
-		buf[f][0] = d * buf[f][0] + w * s[0];
-		buf[f][1] = d * buf[f][1] + w * s[1];
-		outSum += buf[f][0] * buf[f][0] + buf[f][1] * buf[f][1];
+		buf[f][0] = s[0];
+		buf[f][1] = s[1];
 
 		//increment pointers
-		cut1Ptr += cut1Inc;
-		res1Ptr += res1Inc;
 		gain1Ptr += gain1Inc;
-		cut2Ptr += cut2Inc;
-		res2Ptr += res2Inc;
 		gain2Ptr += gain2Inc;
 		mixPtr += mixInc;
 	}
 
-	checkGate( outSum / frames );
-
 	return isRunning();
 }
 
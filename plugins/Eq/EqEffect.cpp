@@ -24,10 +24,13 @@
 
 #include "EqEffect.h"
 
+#include <cstring>
+
 #include "Engine.h"
 #include "EqFader.h"
 #include "interpolation.h"
 #include "lmms_math.h"
+#include "ScratchArena.h"
 
 #include "embed.h"
 #include "plugin_export.h"
@@ -76,7 +79,6 @@ bool EqEffect::processAudioBuffer( sampleFrame *buf, const fpp_t frames )
 	//wet/dry controls
 	const float dry = dryLevel();
 	const float wet = wetLevel();
-	sample_t dryS[2];
 	// setup sample exact controls
 	float hpRes = m_eqControls.m_hpResModel.value();
 	float lowShelfRes = m_eqControls.m_lowShelfResModel.value();
@@ -177,95 +179,93 @@ bool EqEffect::processAudioBuffer( sampleFrame *buf, const fpp_t frames )
 	m_eqControls.m_inPeakL = m_eqControls.m_inPeakL < m_inPeak[0] ? m_inPeak[0] : m_eqControls.m_inPeakL;
 	m_eqControls.m_inPeakR = m_eqControls.m_inPeakR < m_inPeak[1] ? m_inPeak[1] : m_eqControls.m_inPeakR;
 
-	float periodProgress = 0.0f; // percentage of period processed
-	for( fpp_t f = 0; f < frames; ++f)
+	// the bands run one after the other on the whole period, for both
+	// channels side by side - the input is kept for the dry level only
+	// if there is one
+	ScratchBuffer<sampleFrame> dryBuf( dry != 0.0f ? frames : 0 );
+	if( dry != 0.0f )
 	{
-		periodProgress = (float)f / (float)(frames-1);
-		//wet dry buffer
-		dryS[0] = buf[f][0];
-		dryS[1] = buf[f][1];
-		if( hpActive )
-		{
-			buf[f][0] = m_hp12.update( buf[f][0], 0, periodProgress );
-			buf[f][1] = m_hp12.update( buf[f][1], 1, periodProgress );
-
-			if( hp24Active || hp48Active )
-			{
-				buf[f][0] = m_hp24.update( buf[f][0], 0, periodProgress );
-				buf[f][1] = m_hp24.update( buf[f][1], 1, periodProgress );
-			}
-
-			if( hp48Active )
-			{
-				buf[f][0] = m_hp480.update( buf[f][0], 0, periodProgress );
-				buf[f][1] = m_hp480.update( buf[f][1], 1, periodProgress );
-
-				buf[f][0] = m_hp481.update( buf[f][0], 0, periodProgress );
-				buf[f][1] = m_hp481.update( buf[f][1], 1, periodProgress );
-			}
-		}
+		memcpy( dryBuf.data(), buf, sizeof( sampleFrame ) * frames );
+	}
 
-		if( lowShelfActive )
-		{
-			buf[f][0] = m_lowShelf.update( buf[f][0], 0, periodProgress );
-			buf[f][1] = m_lowShelf.update( buf[f][1], 1, periodProgress );
-		}
+	if( hpActive )
+	{
+		m_hp12.processBlock( buf, frames );
 
-		if( para1Active )
+		if( hp24Active || hp48Active )
 		{
-			buf[f][0] = m_para1.update( buf[f][0], 0, periodProgress );
-			buf[f][1] = m_para1.update( buf[f][1], 1, periodProgress );
+			m_hp24.processBlock( buf, frames );
 		}
 
-		if( para2Active )
+		if( hp48Active )
 		{
-			buf[f][0] = m_para2.update( buf[f][0], 0, periodProgress );
-			buf[f][1] = m_para2.update( buf[f][1], 1, periodProgress );
+			m_hp480.processBlock( buf, frames );
+			m_hp481.processBlock( buf, frames );
 		}
+	}
 
-		if( para3Active )
-		{
-			buf[f][0] = m_para3.update( buf[f][0], 0, periodProgress );
-			buf[f][1] = m_para3.update( buf[f][1], 1, periodProgress );
-		}
+	if( lowShelfActive )
+	{
+		m_lowShelf.processBlock( buf, frames );
+	}
 
-		if( para4Active )
-		{
-			buf[f][0] = m_para4.update( buf[f][0], 0, periodProgress );
-			buf[f][1] = m_para4.update( buf[f][1], 1, periodProgress );
-		}
+	if( para1Active )
+	{
+		m_para1.processBlock( buf, frames );
+	}
 
-		if( highShelfActive )
-		{
-			buf[f][0] = m_highShelf.update( buf[f][0], 0, periodProgress );
-			buf[f][1] = m_highShelf.update( buf[f][1], 1, periodProgress );
-		}
+	if( para2Active )
+	{
+		m_para2.processBlock( buf, frames );
+	}
 
-		if( lpActive ){
-			buf[f][0] = m_lp12.update( buf[f][0], 0, periodProgress );
-			buf[f][1] = m_lp12.update( buf[f][1], 1, periodProgress );
+	if( para3Active )
+	{
+		m_para3.processBlock( buf, frames );
+	}
+
+	if( para4Active )
+	{
+		m_para4.processBlock( buf, frames );
+	}
 
-			if( lp24Active || lp48Active )
-			{
-				buf[f][0] = m_lp24.update( buf[f][0], 0, periodProgress );
-				buf[f][1] = m_lp24.update( buf[f][1], 1, periodProgress );
-			}
+	if( highShelfActive )
+	{
+		m_highShelf.processBlock( buf, frames );
+	}
 
-			if( lp48Active )
-			{
-				buf[f][0] = m_lp480.update( buf[f][0], 0, periodProgress );
-				buf[f][1] = m_lp480.update( buf[f][1], 1, periodProgress );
+	if( lpActive )
+	{
+		m_lp12.processBlock( buf, frames );
 
-				buf[f][0] = m_lp481.update( buf[f][0], 0, periodProgress );
-				buf[f][1] = m_lp481.update( buf[f][1], 1, periodProgress );
-			}
+		if( lp24Active || lp48Active )
+		{
+			m_lp24.processBlock( buf, frames );
 		}
 
-		//apply wet / dry levels
-		buf[f][1] = ( dry * dryS[1] ) + ( wet * buf[f][1] );
-		buf[f][0] = ( dry * dryS[0] ) + ( wet * buf[f][0] );
-
+		if( lp48Active )
+		{
+			m_lp480.processBlock( buf, frames );
+			m_lp481.processBlock( buf, frames );
+		}
+	}
 
+	//apply wet / dry levels
+	if( dry != 0.0f )
+	{
+		for( fpp_t f = 0; f < frames; ++f )
+		{
+			buf[f][0] = ( dry * dryBuf[f][0] ) + ( wet * buf[f][0] );
+			buf[f][1] = ( dry * dryBuf[f][1] ) + ( wet * buf[f][1] );
+		}
+	}
+	else if( wet != 1.0f )
+	{
+		for( fpp_t f = 0; f < frames; ++f )
+		{
+			buf[f][0] *= wet;
+			buf[f][1] *= wet;
+		}
 	}
 
 	sampleFrame outPeak = { 0, 0 };
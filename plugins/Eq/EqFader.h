@@ -47,7 +47,7 @@ public:
 		resize( 23, 80 );
 		m_lPeak = lPeak;
 		m_rPeak = rPeak;
-		connect( gui->mainWindow(), SIGNAL( periodicUpdate() ), this, SLOT( updateVuMeters() ) );
+		gui->mainWindow()->refreshScheduler()->add( this, RefreshScheduler::MeterRate, [this]() { updateVuMeters(); } );
 		m_model = model;
 		setPeak_L( 0 );
 		setPeak_R( 0 );
@@ -61,7 +61,7 @@ public:
 		resize( 23, 116 );
 		m_lPeak = lPeak;
 		m_rPeak = rPeak;
-		connect( gui->mainWindow(), SIGNAL( periodicUpdate() ), this, SLOT( updateVuMeters() ) );
+		gui->mainWindow()->refreshScheduler()->add( this, RefreshScheduler::MeterRate, [this]() { updateVuMeters(); } );
 		m_model = model;
 		setPeak_L( 0 );
 		setPeak_R( 0 );
@@ -80,7 +80,8 @@ private slots:
 	{
 		const float opl = getPeak_L();
 		const float opr = getPeak_R();
-		const float fallOff = 1.07;
+		// per refresh at the meter rate of 30 a second
+		const float fallOff = 1.07 * 1.07;
 		if( *m_lPeak > opl )
 		{
 			setPeak_L( *m_lPeak );
@@ -100,7 +101,6 @@ private slots:
 		{
 			setPeak_R( opr/fallOff );
 		}
-		update();
 	}
 
 
@@ -43,7 +43,8 @@ public:
 		m_freq(0),
 		m_res(0),
 		m_gain(0),
-		m_bw(0)
+		m_bw(0),
+		m_crossfading(false)
 	{
 
 	}
@@ -56,7 +57,7 @@ public:
 		if( sampleRate != m_sampleRate )
 		{
 			m_sampleRate = sampleRate;
-			calcCoefficents();
+			changeCoefficents();
 		}
 	}
 
@@ -67,7 +68,7 @@ public:
 		if ( freq != m_freq )
 		{
 			m_freq = freq;
-			calcCoefficents();
+			changeCoefficents();
 		}
 	}
 
@@ -79,7 +80,7 @@ public:
 		if ( res != m_res )
 		{
 			m_res = res;
-			calcCoefficents();
+			changeCoefficents();
 		}
 	}
 
@@ -91,7 +92,7 @@ public:
 		if ( gain != m_gain )
 		{
 			m_gain = gain;
-			calcCoefficents();
+			changeCoefficents();
 		}
 	}
 
@@ -109,7 +110,7 @@ public:
 			m_freq = freq;
 			m_res = res;
 			m_gain = gain;
-			calcCoefficents();
+			changeCoefficents();
 		}
 	}
 
@@ -131,6 +132,7 @@ public:
 		if(frameProgress > 0.99999 )
 		{
 			m_biQuadFrameInitial= m_biQuadFrameTarget;
+			m_crossfading = false;
 		}
 
 		return (1.0f-frameProgress) * initailF + frameProgress * targetF;
@@ -138,6 +140,28 @@ public:
 	}
 
 
+	///
+	/// \brief processBlock
+	/// update() for both channels of a whole period. Unless the parameters
+	/// changed, there's nothing to crossfade and only one BiQuad is run.
+	///
+	inline void processBlock( sampleFrame * buf, const fpp_t frames )
+	{
+		if( !m_crossfading )
+		{
+			m_biQuadFrameTarget.processBlock( buf, frames );
+			return;
+		}
+
+		for( fpp_t f = 0; f < frames; ++f )
+		{
+			const float periodProgress = (float)f / (float)(frames-1);
+			buf[f][0] = update( buf[f][0], 0, periodProgress );
+			buf[f][1] = update( buf[f][1], 1, periodProgress );
+		}
+	}
+
+
 protected:
 	///
 	/// \brief calcCoefficents
@@ -153,6 +177,18 @@ protected:
 		m_biQuadFrameTarget.setCoeffs( a1, a2, b0, b1, b2 );
 	}
 
+	///
+	/// \brief changeCoefficents
+	///  Lets the next period crossfade from the current coefficents to the
+	///  ones of the new parameters
+	inline void changeCoefficents()
+	{
+		// only the target BiQuad runs while not crossfading
+		m_biQuadFrameInitial = m_biQuadFrameTarget;
+		m_crossfading = true;
+		calcCoefficents();
+	}
+
 
 
 
@@ -165,6 +201,7 @@ protected:
 	float m_bw;
 	StereoBiQuad m_biQuadFrameInitial;
 	StereoBiQuad m_biQuadFrameTarget;
+	bool m_crossfading;
 };
 
 
@@ -320,7 +357,7 @@ public:
 			hasChanged = true;
 		}
 
-		if ( hasChanged ) { calcCoefficents(); }
+		if ( hasChanged ) { changeCoefficents(); }
 	}
 };
 
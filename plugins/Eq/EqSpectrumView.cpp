@@ -31,12 +31,13 @@
 EqAnalyser::EqAnalyser() :
 	m_framesFilledUp ( 0 ),
 	m_energy ( 0 ),
+	m_cleared ( false ),
 	m_sampleRate ( 1 ),
 	m_active ( true )
 {
 	m_inProgress=false;
 	m_specBuf = ( fftwf_complex * ) fftwf_malloc( ( FFT_BUFFER_SIZE + 1 ) * sizeof( fftwf_complex ) );
-	m_fftPlan = fftwf_plan_dft_r2c_1d( FFT_BUFFER_SIZE*2, m_buffer, m_specBuf, FFTW_MEASURE );
+	m_fftPlan = realFFTPlan( FFT_BUFFER_SIZE*2, m_buffer, m_specBuf );
 
 	//initialize Blackman-Harris window, constants taken from
 	//https://en.wikipedia.org/wiki/Window_function#A_list_of_window_functions
@@ -59,7 +60,6 @@ EqAnalyser::EqAnalyser() :
 
 EqAnalyser::~EqAnalyser()
 {
-	fftwf_destroy_plan( m_fftPlan );
 	fftwf_free( m_specBuf );
 }
 
@@ -72,6 +72,7 @@ void EqAnalyser::analyze( sampleFrame *buf, const fpp_t frames )
 	if ( m_active )
 	{
 		m_inProgress=true;
+		m_cleared = false;
 		const int FFT_BUFFER_SIZE = 2048;
 		fpp_t f = 0;
 		if( frames > FFT_BUFFER_SIZE )
@@ -103,7 +104,7 @@ void EqAnalyser::analyze( sampleFrame *buf, const fpp_t frames )
 			m_buffer[i] = m_buffer[i] * m_fftWindow[i];
 		}
 
-		fftwf_execute( m_fftPlan );
+		fftwf_execute_dft_r2c( m_fftPlan, m_buffer, m_specBuf );
 		absspec( m_specBuf, m_absSpecBuf, FFT_BUFFER_SIZE+1 );
 
 		compressbands( m_absSpecBuf, m_bands, FFT_BUFFER_SIZE+1,
@@ -163,10 +164,16 @@ bool EqAnalyser::getInProgress()
 
 void EqAnalyser::clear()
 {
+	// called every period while the view is closed
+	if( m_cleared )
+	{
+		return;
+	}
 	m_framesFilledUp = 0;
 	m_energy = 0;
 	memset( m_buffer, 0, sizeof( m_buffer ) );
 	memset( m_bands, 0, sizeof( m_bands ) );
+	m_cleared = true;
 }
 
 
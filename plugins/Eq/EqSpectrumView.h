@@ -57,6 +57,8 @@ private:
 	float m_buffer[FFT_BUFFER_SIZE*2];
 	int m_framesFilledUp;
 	float m_energy;
+	// nothing to clear since the last clear()
+	bool m_cleared;
 	int m_sampleRate;
 	bool m_active;
 	bool m_inProgress;
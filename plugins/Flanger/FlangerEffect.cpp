@@ -27,6 +27,7 @@
 
 #include "embed.h"
 #include "plugin_export.h"
+#include "ScratchArena.h"
 
 extern "C"
 {
@@ -52,8 +53,9 @@ FlangerEffect::FlangerEffect( Model *parent, const Plugin::Descriptor::SubPlugin
 	m_flangerControls( this )
 {
 	m_lfo = new QuadratureLfo( Engine::mixer()->processingSampleRate() );
-	m_lDelay = new MonoDelay( 1, Engine::mixer()->processingSampleRate() );
-	m_rDelay = new MonoDelay( 1, Engine::mixer()->processingSampleRate() );
+	// up to one second
+	m_lDelay.setMaxDelay( Engine::mixer()->processingSampleRate() );
+	m_rDelay.setMaxDelay( Engine::mixer()->processingSampleRate() );
 	m_noise = new Noise;
 }
 
@@ -62,14 +64,6 @@ FlangerEffect::FlangerEffect( Model *parent, const Plugin::Descriptor::SubPlugin
 
 FlangerEffect::~FlangerEffect()
 {
-	if(m_lDelay )
-	{
-		delete m_lDelay;
-	}
-	if( m_rDelay )
-	{
-		delete m_rDelay;
-	}
 	if( m_lfo )
 	{
 		delete m_lfo;
@@ -89,43 +83,39 @@ bool FlangerEffect::processAudioBuffer( sampleFrame *buf, const fpp_t frames )
 	{
 		return( false );
 	}
-	double outSum = 0.0;
-	const float d = dryLevel();
-	const float w = wetLevel();
 	const float length = m_flangerControls.m_delayTimeModel.value() * Engine::mixer()->processingSampleRate();
 	const float noise = m_flangerControls.m_whiteNoiseAmountModel.value();
 	float amplitude = m_flangerControls.m_lfoAmountModel.value() * Engine::mixer()->processingSampleRate();
 	bool invertFeedback = m_flangerControls.m_invertFeedbackModel.value();
 	m_lfo->setFrequency(  1.0/m_flangerControls.m_lfoFrequencyModel.value() );
-	m_lDelay->setFeedback( m_flangerControls.m_feedbackModel.value() );
-	m_rDelay->setFeedback( m_flangerControls.m_feedbackModel.value() );
-	sample_t dryS[2];
+	const float feedback = m_flangerControls.m_feedbackModel.value();
 	float leftLfo;
 	float rightLfo;
+
+	// delay lengths of all frames and the channels on their own
+	ScratchBuffer<float> work( frames * 4 );
+	float * lengths[2] = { work.data(), work.data() + frames };
+	sample_t * wet[2] = { work.data() + frames * 2, work.data() + frames * 3 };
 	for( fpp_t f = 0; f < frames; ++f )
 	{
 		buf[f][0] += m_noise->tick() * noise;
 		buf[f][1] += m_noise->tick() * noise;
-		dryS[0] = buf[f][0];
-		dryS[1] = buf[f][1];
 		m_lfo->tick(&leftLfo, &rightLfo);
-		m_lDelay->setLength( ( float )length + amplitude * (leftLfo+1.0)  );
-		m_rDelay->setLength( ( float )length + amplitude * (rightLfo+1.0)  );
-		if(invertFeedback)
-		{
-			m_lDelay->tick( &buf[f][1] );
-			m_rDelay->tick(&buf[f][0] );
-		} else
-		{
-			m_lDelay->tick( &buf[f][0] );
-			m_rDelay->tick( &buf[f][1] );
-		}
-
-		buf[f][0] = ( d * dryS[0] ) + ( w * buf[f][0] );
-		buf[f][1] = ( d * dryS[1] ) + ( w * buf[f][1] );
-		outSum += buf[f][0]*buf[f][0] + buf[f][1]*buf[f][1];
+		lengths[0][f] = ( float )length + amplitude * (leftLfo+1.0);
+		lengths[1][f] = ( float )length + amplitude * (rightLfo+1.0);
+		wet[0][f] = buf[f][0];
+		wet[1][f] = buf[f][1];
+	}
+
+	// with inverted feedback the left delay runs on the right channel
+	m_lDelay.process( wet[invertFeedback ? 1 : 0], lengths[0], feedback, frames );
+	m_rDelay.process( wet[invertFeedback ? 0 : 1], lengths[1], feedback, frames );
+
+	for( fpp_t f = 0; f < frames; ++f )
+	{
+		buf[f][0] = wet[0][f];
+		buf[f][1] = wet[1][f];
 	}
-	checkGate( outSum / frames );
 	return isRunning();
 }
 
@@ -135,8 +125,8 @@ bool FlangerEffect::processAudioBuffer( sampleFrame *buf, const fpp_t frames )
 void FlangerEffect::changeSampleRate()
 {
 	m_lfo->setSampleRate( Engine::mixer()->processingSampleRate() );
-	m_lDelay->setSampleRate( Engine::mixer()->processingSampleRate() );
-	m_rDelay->setSampleRate( Engine::mixer()->processingSampleRate() );
+	m_lDelay.setMaxDelay( Engine::mixer()->processingSampleRate() );
+	m_rDelay.setMaxDelay( Engine::mixer()->processingSampleRate() );
 }
 
 
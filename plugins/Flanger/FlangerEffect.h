@@ -26,10 +26,10 @@
 #ifndef FLANGEREFFECT_H
 #define FLANGEREFFECT_H
 
+#include "DelayLine.h"
 #include "Effect.h"
 #include "FlangerControls.h"
 #include "QuadratureLfo.h"
-#include "MonoDelay.h"
 #include "Noise.h"
 
 
@@ -39,6 +39,11 @@ public:
 	FlangerEffect( Model* parent , const Descriptor::SubPluginFeatures::Key* key );
 	virtual ~FlangerEffect();
 	virtual bool processAudioBuffer( sampleFrame *buf, const fpp_t frames );
+
+	virtual bool writesWetOnly() const
+	{
+		return true;
+	}
 	virtual EffectControls* controls()
 	{
 		return &m_flangerControls;
@@ -48,8 +53,8 @@ public:
 
 private:
 	FlangerControls m_flangerControls;
-	MonoDelay* m_lDelay;
-	MonoDelay* m_rDelay;
+	DelayLine m_lDelay;
+	DelayLine m_rDelay;
 	QuadratureLfo* m_lfo;
 	Noise* m_noise;
 
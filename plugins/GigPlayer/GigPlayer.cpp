@@ -29,6 +29,7 @@
  */
 
 
+#include <algorithm>
 #include <cstring>
 #include <QDebug>
 #include <QLayout>
@@ -38,6 +39,7 @@
 #include "FileDialog.h"
 #include "GigPlayer.h"
 #include "Engine.h"
+#include "GuiApplication.h"
 #include "InstrumentTrack.h"
 #include "InstrumentPlayHandle.h"
 #include "Mixer.h"
@@ -51,6 +53,7 @@
 #include "PatchesDialog.h"
 #include "ToolTip.h"
 #include "LcdSpinBox.h"
+#include "MainWindow.h"
 
 #include "embed.h"
 #include "plugin_export.h"
@@ -84,6 +87,8 @@ GigInstrument::GigInstrument( InstrumentTrack * _instrument_track ) :
 	m_bankNum( 0, 0, 999, this, tr( "Bank" ) ),
 	m_patchNum( 0, 0, 127, this, tr( "Patch" ) ),
 	m_gain( 1.0f, 0.0f, 5.0f, 0.01f, this, tr( "Gain" ) ),
+	m_preloadSize( 64, 4, 9999, this, tr( "Preload size" ) ),
+	m_underruns( 0 ),
 	m_interpolation( SRC_LINEAR ),
 	m_RandomSeed( 0 ),
 	m_currentKeyDimension( 0 )
@@ -95,6 +100,7 @@ GigInstrument::GigInstrument( InstrumentTrack * _instrument_track ) :
 
 	connect( &m_bankNum, SIGNAL( dataChanged() ), this, SLOT( updatePatch() ) );
 	connect( &m_patchNum, SIGNAL( dataChanged() ), this, SLOT( updatePatch() ) );
+	connect( &m_preloadSize, SIGNAL( dataChanged() ), this, SLOT( updatePreload() ) );
 	connect( Engine::mixer(), SIGNAL( sampleRateChanged() ), this, SLOT( updateSampleRate() ) );
 }
 
@@ -119,6 +125,7 @@ void GigInstrument::saveSettings( QDomDocument & _doc, QDomElement & _this )
 	m_bankNum.saveSettings( _doc, _this, "bank" );
 
 	m_gain.saveSettings( _doc, _this, "gain" );
+	m_preloadSize.saveSettings( _doc, _this, "preload" );
 }
 
 
@@ -126,6 +133,9 @@ void GigInstrument::saveSettings( QDomDocument & _doc, QDomElement & _this )
 
 void GigInstrument::loadSettings( const QDomElement & _this )
 {
+	// before opening the file, so the heads get loaded only once
+	m_preloadSize.loadSettings( _this, "preload" );
+
 	openFile( _this.attribute( "src" ), false );
 	m_patchNum.loadSettings( _this, "patch" );
 	m_bankNum.loadSettings( _this, "bank" );
@@ -185,14 +195,16 @@ void GigInstrument::freeInstance()
 
 	if( m_instance != NULL )
 	{
-		delete m_instance;
-		m_instance = NULL;
-
 		// If we're changing instruments, we got to make sure that we
 		// remove all pointers to the old samples and don't try accessing
-		// that instrument again
+		// that instrument again - the notes hand back their streams
+		// before the streamer goes away
 		m_instrument = NULL;
 		m_notes.clear();
+		m_preloaded.clear();
+
+		delete m_instance;
+		m_instance = NULL;
 	}
 }
 
@@ -211,7 +223,10 @@ void GigInstrument::openFile( const QString & _gigFile, bool updateTrackName )
 
 		try
 		{
-			m_instance = new GigInstance( SampleBuffer::tryToMakeAbsolute( _gigFile ) );
+			// every note plays a few samples, e.g. release samples
+			const int polyphony = instrumentTrack()->polyphonyModel()->value();
+			m_instance = new GigInstance( SampleBuffer::tryToMakeAbsolute( _gigFile ),
+				polyphony > 0 ? 2 * polyphony : GigStreamer::DefaultVoices );
 			m_filename = SampleBuffer::tryToMakeRelative( _gigFile );
 		}
 		catch( ... )
@@ -380,7 +395,7 @@ void GigInstrument::play( sampleFrame * _working_buffer )
 			// the end of the sample
 			if( sample->sample == NULL || sample->adsr.done() ||
 				( it->isRelease == true &&
-				  sample->pos >= sample->sample->SamplesTotal - 1 ) )
+				  sample->loop.index( sample->pos ) >= sample->sample->SamplesTotal - 1 ) )
 			{
 				sample = it->samples.erase( sample );
 
@@ -490,6 +505,11 @@ void GigInstrument::play( sampleFrame * _working_buffer )
 			// Update note position with how many samples we actually used
 			sample->pos += used;
 			sample->adsr.inc( used );
+
+			if( sample->stream != NULL )
+			{
+				sample->stream->advance( sample->pos );
+			}
 		}
 	}
 
@@ -511,79 +531,61 @@ void GigInstrument::play( sampleFrame * _working_buffer )
 
 void GigInstrument::loadSample( GigSample& sample, sampleFrame* sampleData, f_cnt_t samples )
 {
-	if( sampleData == NULL || samples < 1 )
+	if( sampleData == NULL || samples < 1 || sample.sample->FrameSize == 0 )
 	{
 		return;
 	}
 
-	// Determine if we need to loop part of this sample
-	bool loop = false;
-	gig::loop_type_t loopType = gig::loop_type_normal;
-	f_cnt_t loopStart = 0;
-	f_cnt_t loopLength = 0;
+	const int frameSize = sample.sample->FrameSize;
+	const f_cnt_t total = sample.sample->SamplesTotal;
 
-	if( sample.region->pSampleLoops != NULL )
-	{
-		for( uint32_t i = 0; i < sample.region->SampleLoops; ++i )
-		{
-			loop = true;
-			loopType = static_cast<gig::loop_type_t>( sample.region->pSampleLoops[i].LoopType );
-			loopStart = sample.region->pSampleLoops[i].LoopStart;
-			loopLength = sample.region->pSampleLoops[i].LoopLength;
+	// The head of the sample preloaded by preloadSamples()
+	const gig::buffer_t cache = sample.sample->GetCache();
+	const f_cnt_t cached = cache.Size / frameSize;
+	const int8_t * head = static_cast<const int8_t *>( cache.pStart );
 
-			// Currently only support at max one loop
-			break;
-		}
+	// Stream the rest unless the sample never leaves its head, try again
+	// next period if all streams are in use
+	if( sample.stream == NULL && !sample.resident( cached ) && m_instance != NULL )
+	{
+		sample.stream = m_instance->streamer.stream( sample.sample,
+					sample.loop, qMax( sample.pos, cached ) );
 	}
 
-	unsigned long allocationsize = samples * sample.sample->FrameSize;
+	unsigned long allocationsize = samples * frameSize;
 	int8_t buffer[allocationsize];
 
-	// Load the sample in different ways depending on if we're looping or not
-	if( loop == true && ( sample.pos >= loopStart || sample.pos + samples > loopStart ) )
+	// Gather the raw frames, looping the sample where needed
+	bool underrun = false;
+	for( f_cnt_t i = 0; i < samples; ++i )
 	{
-		// Calculate the new position based on the type of loop
-		if( loopType == gig::loop_type_bidirectional )
+		const f_cnt_t pos = sample.pos + i;
+		const f_cnt_t index = sample.loop.index( pos );
+		const int8_t * frame = NULL;
+
+		if( index < cached )
 		{
-			sample.pos = getPingPongIndex( sample.pos, loopStart, loopStart + loopLength );
+			frame = head + index * frameSize;
 		}
-		else
+		else if( index < total )
 		{
-			sample.pos = getLoopedIndex( sample.pos, loopStart, loopStart + loopLength );
-			// TODO: also implement loop_type_backward support
+			frame = sample.stream != NULL ? sample.stream->frame( pos ) : NULL;
+			underrun |= frame == NULL;
 		}
 
-		sample.sample->SetPos( sample.pos );
-
-		// Load the samples (based on gig::Sample::ReadAndLoop) even around the end
-		// of a loop boundary wrapping to the beginning of the loop region
-		long samplestoread = samples;
-		long samplestoloopend = 0;
-		long readsamples = 0;
-		long totalreadsamples = 0;
-		long loopEnd = loopStart + loopLength;
-
-		do
+		if( frame != NULL )
 		{
-			samplestoloopend = loopEnd - sample.sample->GetPos();
-			readsamples = sample.sample->Read( &buffer[totalreadsamples * sample.sample->FrameSize],
-					min( samplestoread, samplestoloopend ) );
-			samplestoread -= readsamples;
-			totalreadsamples += readsamples;
-
-			if( readsamples >= samplestoloopend )
-			{
-				sample.sample->SetPos( loopStart );
-			}
+			std::memcpy( &buffer[i * frameSize], frame, frameSize );
+		}
+		else
+		{
+			std::memset( &buffer[i * frameSize], 0, frameSize );
 		}
-		while( samplestoread > 0 && readsamples > 0 );
 	}
-	else
-	{
-		sample.sample->SetPos( sample.pos );
 
-		unsigned long size = sample.sample->Read( &buffer, samples ) * sample.sample->FrameSize;
-		std::memset( (int8_t*) &buffer + size, 0, allocationsize - size );
+	if( underrun )
+	{
+		m_underruns.ref();
 	}
 
 	// Convert from 16 or 24 bit into 32-bit float
@@ -644,39 +646,6 @@ void GigInstrument::loadSample( GigSample& sample, sampleFrame* sampleData, f_cn
 
 
 
-// These two loop index functions taken from SampleBuffer.cpp
-f_cnt_t GigInstrument::getLoopedIndex( f_cnt_t index, f_cnt_t startf, f_cnt_t endf ) const
-{
-	if( index < endf )
-	{
-		return index;
-	}
-
-	return startf + ( index - startf )
-				% ( endf - startf );
-}
-
-
-
-
-f_cnt_t GigInstrument::getPingPongIndex( f_cnt_t index, f_cnt_t startf, f_cnt_t endf ) const
-{
-	if( index < endf )
-	{
-		return index;
-	}
-
-	const f_cnt_t looplen = endf - startf;
-	const f_cnt_t looppos = ( index - endf ) % ( looplen * 2 );
-
-	return ( looppos < looplen )
-		? endf - looppos
-		: startf + ( looppos - looplen );
-}
-
-
-
-
 // A key has been released
 void GigInstrument::deleteNotePluginData( NotePlayHandle * _n )
 {
@@ -874,6 +843,8 @@ void GigInstrument::getInstrument()
 
 	if( m_instance != NULL )
 	{
+		// instruments are loaded from the file on first access
+		m_instance->streamer.fileMutex()->lock();
 		gig::Instrument * pInstrument = m_instance->gig.GetFirstInstrument();
 
 		while( pInstrument != NULL )
@@ -888,8 +859,71 @@ void GigInstrument::getInstrument()
 
 			pInstrument = m_instance->gig.GetNextInstrument();
 		}
+		m_instance->streamer.fileMutex()->unlock();
+
+		if( pInstrument != m_instrument )
+		{
+			m_instrument = pInstrument;
+			preloadSamples();
+		}
+	}
+}
+
+
+
+
+// Keep the first KB of every sample of the instrument in RAM, so notes
+// start right away while the rest of their samples gets streamed
+void GigInstrument::preloadSamples()
+{
+	QMutexLocker fileLock( m_instance->streamer.fileMutex() );
+
+	// Heads of the samples of the previous instrument - its notes still
+	// playing go silent where the heads were, see loadSample()
+	for( QSet<gig::Sample *>::iterator it = m_preloaded.begin();
+					it != m_preloaded.end(); ++it )
+	{
+		( *it )->ReleaseSampleData();
+	}
+	m_preloaded.clear();
+
+	if( m_instrument == NULL )
+	{
+		return;
+	}
+
+	const unsigned long bytes = m_preloadSize.value() * 1024;
+
+	gig::Region * pRegion = m_instrument->GetFirstRegion();
+
+	while( pRegion != NULL )
+	{
+		for( uint32_t i = 0; i < pRegion->DimensionRegions; ++i )
+		{
+			gig::Sample * pSample = pRegion->pDimensionRegions[i]->pSample;
+
+			if( pSample != NULL && pSample->FrameSize != 0 &&
+					!m_preloaded.contains( pSample ) )
+			{
+				pSample->LoadSampleData( bytes / pSample->FrameSize );
+				m_preloaded.insert( pSample );
+			}
+		}
+
+		pRegion = m_instrument->GetNextRegion();
+	}
+}
+
+
 
-		m_instrument = pInstrument;
+
+void GigInstrument::updatePreload()
+{
+	QMutexLocker locker( &m_synthMutex );
+
+	if( m_instance != NULL )
+	{
+		preloadSamples();
 	}
 }
 
@@ -970,6 +1004,19 @@ GigInstrumentView::GigInstrumentView( Instrument * _instrument, QWidget * _paren
 	m_gainKnob->setHintText( tr( "Gain:" ) + " ", "" );
 	m_gainKnob->move( 32, 140 );
 
+	// Preload size
+	m_preloadLcd = new LcdSpinBox( 4, "21pink", this );
+	m_preloadLcd->setLabel( tr( "PRELOAD KB" ) );
+	m_preloadLcd->move( 111, 196 );
+	ToolTip::add( m_preloadLcd, tr( "KB of every sample kept in memory, "
+				"the rest is streamed from disk while playing" ) );
+
+	m_underrunLabel = new QLabel( this );
+	m_underrunLabel->setGeometry( 61, 118, 156, 14 );
+
+	connect( gui->mainWindow(), SIGNAL( periodicUpdate() ),
+					this, SLOT( updateUnderruns() ) );
+
 	setAutoFillBackground( true );
 	QPalette pal;
 	pal.setBrush( backgroundRole(), PLUGIN_NAME::getIconPixmap( "artwork" ) );
@@ -995,6 +1042,7 @@ void GigInstrumentView::modelChanged()
 	m_patchNumLcd->setModel( &k->m_patchNum );
 
 	m_gainKnob->setModel( &k->m_gain );
+	m_preloadLcd->setModel( &k->m_preloadSize );
 
 	connect( k, SIGNAL( fileChanged() ), this, SLOT( updateFilename() ) );
 	connect( k, SIGNAL( fileLoading() ), this, SLOT( invalidateFile() ) );
@@ -1036,6 +1084,19 @@ void GigInstrumentView::updatePatchName()
 
 
 
+// Streams falling behind the disk show up here, e.g. to raise the preload size
+void GigInstrumentView::updateUnderruns()
+{
+	GigInstrument * i = castModel<GigInstrument>();
+	const int underruns = i->underruns();
+
+	m_underrunLabel->setText( underruns > 0 ?
+			tr( "Underruns: %1" ).arg( underruns ) : QString() );
+}
+
+
+
+
 void GigInstrumentView::invalidateFile()
 {
 	m_patchDialogButton->setEnabled( false );
@@ -1100,11 +1161,13 @@ void GigInstrumentView::showPatchDialog()
 GigSample::GigSample( gig::Sample * pSample, gig::DimensionRegion * pDimRegion,
 		float attenuation, int interpolation, float desiredFreq )
 	: sample( pSample ), region( pDimRegion ), attenuation( attenuation ),
-	  pos( 0 ), interpolation( interpolation ), srcState( NULL ),
+	  pos( 0 ), stream( NULL ), interpolation( interpolation ), srcState( NULL ),
 	  sampleFreq( 0 ), freqFactor( 1 )
 {
 	if( sample != NULL && region != NULL )
 	{
+		loop = GigLoop( sample, region );
+
 		// Note: we don't create the libsamplerate object here since we always
 		// also call the copy constructor when appending to the end of the
 		// QList. We'll create it only in the copy constructor so we only have
@@ -1137,6 +1200,11 @@ GigSample::~GigSample()
 	{
 		src_delete( srcState );
 	}
+
+	if( stream != NULL )
+	{
+		stream->release();
+	}
 }
 
 
@@ -1144,8 +1212,9 @@ GigSample::~GigSample()
 
 GigSample::GigSample( const GigSample& g )
 	: sample( g.sample ), region( g.region ), attenuation( g.attenuation ),
-	  adsr( g.adsr ), pos( g.pos ), interpolation( g.interpolation ),
-	  srcState( NULL ), sampleFreq( g.sampleFreq ), freqFactor( g.freqFactor )
+	  adsr( g.adsr ), pos( g.pos ), loop( g.loop ), stream( NULL ),
+	  interpolation( g.interpolation ), srcState( NULL ),
+	  sampleFreq( g.sampleFreq ), freqFactor( g.freqFactor )
 {
 	// On the copy, we want to create the object
 	updateSampleRate();
@@ -1161,6 +1230,7 @@ GigSample& GigSample::operator=( const GigSample& g )
 	attenuation = g.attenuation;
 	adsr = g.adsr;
 	pos = g.pos;
+	loop = g.loop;
 	interpolation = g.interpolation;
 	srcState = NULL;
 	sampleFreq = g.sampleFreq;
@@ -1171,12 +1241,28 @@ GigSample& GigSample::operator=( const GigSample& g )
 		updateSampleRate();
 	}
 
+	// the stream keeps streaming for the original
+	if( stream != NULL )
+	{
+		stream->release();
+		stream = NULL;
+	}
+
 	return *this;
 }
 
 
 
 
+bool GigSample::resident( f_cnt_t cached ) const
+{
+	return cached >= static_cast<f_cnt_t>( sample->SamplesTotal ) ||
+		( loop.type != GigLoop::None && loop.end <= cached );
+}
+
+
+
+
 void GigSample::updateSampleRate()
 {
 	if( srcState != NULL )
@@ -1243,6 +1329,269 @@ bool GigSample::convertSampleRate( sampleFrame & oldBuf, sampleFrame & newBuf,
 
 
 
+GigLoop::GigLoop()
+	: type( None ), start( 0 ), end( 0 )
+{
+}
+
+
+
+
+GigLoop::GigLoop( gig::Sample * pSample, gig::DimensionRegion * pDimRegion )
+	: type( None ), start( 0 ), end( 0 )
+{
+	// Currently only support at max one loop
+	if( pDimRegion->pSampleLoops != NULL && pDimRegion->SampleLoops > 0 )
+	{
+		const gig::loop_type_t loopType = static_cast<gig::loop_type_t>(
+					pDimRegion->pSampleLoops[0].LoopType );
+		start = pDimRegion->pSampleLoops[0].LoopStart;
+		end = qMin<f_cnt_t>( start + pDimRegion->pSampleLoops[0].LoopLength,
+							pSample->SamplesTotal );
+
+		if( end > start )
+		{
+			// TODO: also implement loop_type_backward support
+			type = loopType == gig::loop_type_bidirectional ?
+							PingPong : Forward;
+		}
+	}
+}
+
+
+
+
+// Based on the loop index functions of SampleBuffer.cpp, the ping pong loop
+// plays the loop backwards from its last frame on
+f_cnt_t GigLoop::index( f_cnt_t pos ) const
+{
+	if( type == None || pos < end )
+	{
+		return pos;
+	}
+
+	const f_cnt_t length = end - start;
+
+	if( type == Forward )
+	{
+		return start + ( pos - start ) % length;
+	}
+
+	const f_cnt_t looppos = ( pos - end ) % ( length * 2 );
+
+	return ( looppos < length )
+		? end - 1 - looppos
+		: start + ( looppos - length );
+}
+
+
+
+
+GigStream::GigStream()
+	: sample( NULL ), first( 0 ), ring( Frames * MaxFrameSize ),
+	  state( Free ), written( 0 ), read( 0 )
+{
+}
+
+
+
+
+const int8_t * GigStream::frame( f_cnt_t pos ) const
+{
+	const f_cnt_t offset = pos - first;
+
+	if( offset < 0 || offset >= written.loadAcquire() )
+	{
+		return NULL;
+	}
+
+	return &ring[( offset % Frames ) * sample->FrameSize];
+}
+
+
+
+
+void GigStream::advance( f_cnt_t pos )
+{
+	read.storeRelease( qMax<f_cnt_t>( 0, pos - first ) );
+}
+
+
+
+
+void GigStream::release()
+{
+	state.storeRelease( Released );
+}
+
+
+
+
+GigStreamer::GigStreamer( int voices )
+	: m_quit( 0 )
+{
+	for( int i = 0; i < voices; ++i )
+	{
+		m_streams.push_back( new GigStream );
+	}
+
+	m_decompressionBuffer = gig::Sample::CreateDecompressionBuffer( ChunkFrames );
+}
+
+
+
+
+GigStreamer::~GigStreamer()
+{
+	m_quit.storeRelease( 1 );
+	m_wake.wakeOne();
+	wait();
+
+	for( size_t i = 0; i < m_streams.size(); ++i )
+	{
+		delete m_streams[i];
+	}
+
+	gig::Sample::DestroyDecompressionBuffer( m_decompressionBuffer );
+}
+
+
+
+
+GigStream * GigStreamer::stream( gig::Sample * pSample, const GigLoop & loop,
+								f_cnt_t first )
+{
+	if( pSample->FrameSize > GigStream::MaxFrameSize )
+	{
+		return NULL;
+	}
+
+	for( size_t i = 0; i < m_streams.size(); ++i )
+	{
+		GigStream * s = m_streams[i];
+
+		if( s->state.testAndSetAcquire( GigStream::Free, GigStream::Starting ) )
+		{
+			s->sample = pSample;
+			s->loop = loop;
+			s->first = first;
+			s->written.store( 0 );
+			s->read.store( 0 );
+			s->state.storeRelease( GigStream::Streaming );
+
+			m_wake.wakeOne();
+
+			return s;
+		}
+	}
+
+	return NULL;
+}
+
+
+
+
+void GigStreamer::run()
+{
+	while( m_quit.loadAcquire() == 0 )
+	{
+		bool busy = false;
+
+		m_fileMutex.lock();
+		for( size_t i = 0; i < m_streams.size(); ++i )
+		{
+			GigStream * s = m_streams[i];
+			const int state = s->state.loadAcquire();
+
+			if( state == GigStream::Released )
+			{
+				s->state.storeRelease( GigStream::Free );
+			}
+			else if( state == GigStream::Streaming && fill( s ) )
+			{
+				busy = true;
+			}
+		}
+		m_fileMutex.unlock();
+
+		// Wait for new streams or for space in the rings, wakeOne()
+		// being missed only delays streaming a bit
+		if( busy == false )
+		{
+			m_wakeMutex.lock();
+			m_wake.wait( &m_wakeMutex, 5 );
+			m_wakeMutex.unlock();
+		}
+	}
+}
+
+
+
+
+bool GigStreamer::fill( GigStream * s )
+{
+	gig::Sample * pSample = s->sample;
+	const int frameSize = pSample->FrameSize;
+	const f_cnt_t total = pSample->SamplesTotal;
+	f_cnt_t written = s->written.load();
+
+	if( GigStream::Frames - ( written - s->read.loadAcquire() ) < ChunkFrames )
+	{
+		return false;
+	}
+
+	f_cnt_t todo = ChunkFrames;
+
+	while( todo > 0 )
+	{
+		const f_cnt_t pos = s->first + written;
+		const f_cnt_t index = s->loop.index( pos );
+
+		// Nothing left to stream once the sample is over
+		if( index >= total )
+		{
+			return false;
+		}
+
+		// Read runs of frames which are consecutive in the sample, going
+		// backwards in ping pong loops and not wrapping around the ring
+		const int step = s->loop.index( pos + 1 ) == index - 1 ? -1 : 1;
+		const f_cnt_t ringPos = written % GigStream::Frames;
+		const f_cnt_t maxRun = qMin<f_cnt_t>( todo, GigStream::Frames - ringPos );
+
+		f_cnt_t run = 1;
+		while( run < maxRun && index + step * run < total &&
+				s->loop.index( pos + run ) == index + step * run )
+		{
+			++run;
+		}
+
+		int8_t * buffer = &s->ring[ringPos * frameSize];
+		pSample->SetPos( step > 0 ? index : index - run + 1 );
+		const f_cnt_t got = pSample->Read( buffer, run, &m_decompressionBuffer );
+		std::memset( buffer + got * frameSize, 0, ( run - got ) * frameSize );
+
+		if( step < 0 )
+		{
+			for( f_cnt_t i = 0; i < run / 2; ++i )
+			{
+				std::swap_ranges( buffer + i * frameSize,
+						buffer + ( i + 1 ) * frameSize,
+						buffer + ( run - 1 - i ) * frameSize );
+			}
+		}
+
+		written += run;
+		todo -= run;
+		s->written.storeRelease( written );
+	}
+
+	return true;
+}
+
+
+
+
 ADSR::ADSR()
 	: preattack( 0 ), attack( 0 ), decay1( 0 ), decay2( 0 ), infiniteSustain( false ),
 	  sustain( 0 ), release( 0 ),
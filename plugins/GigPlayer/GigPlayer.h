@@ -27,10 +27,15 @@
 #ifndef GIG_PLAYER_H
 #define GIG_PLAYER_H
 
+#include <QAtomicInt>
 #include <QList>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QSet>
+#include <QThread>
+#include <QWaitCondition>
 #include <samplerate.h>
+#include <vector>
 
 #include "Instrument.h"
 #include "PixmapButton.h"
@@ -58,20 +63,133 @@ struct GIGPluginData
 
 
 
+// The loop of a sample, maps positions in the played sample, i.e. with the
+// loop unrolled, to positions in the sample
+struct GigLoop
+{
+	enum Types
+	{
+		None,
+		Forward,
+		PingPong
+	} ;
+
+	GigLoop();
+	GigLoop( gig::Sample * pSample, gig::DimensionRegion * pDimRegion );
+
+	f_cnt_t index( f_cnt_t pos ) const;
+
+	Types type;
+	f_cnt_t start;
+	f_cnt_t end;
+} ;
+
+
+
+
+// Ring buffer the part of a sample which isn't preloaded gets streamed into,
+// holding the raw frames of the played positions first + [read, written)
+class GigStream
+{
+public:
+	// played frames the ring holds, about 0.7 s at 44.1 kHz
+	static const int Frames = 32768;
+	// stereo 24 bit
+	static const int MaxFrameSize = 6;
+
+	enum States
+	{
+		Free,
+		Starting,
+		Streaming,
+		Released
+	} ;
+
+	GigStream();
+
+	// Raw frame of played position pos, NULL if it wasn't streamed yet
+	const int8_t * frame( f_cnt_t pos ) const;
+	// The positions before pos aren't needed anymore
+	void advance( f_cnt_t pos );
+	void release();
+
+	gig::Sample * sample;
+	GigLoop loop;
+	f_cnt_t first;
+
+	std::vector<int8_t> ring;
+	QAtomicInt state;
+	QAtomicInt written;
+	QAtomicInt read;
+} ;
+
+
+
+
+// Background thread streaming the samples of the playing notes from the
+// file, so the audio thread never waits for the disk. The streams are
+// allocated up front, starting one on the audio thread only takes a free one.
+class GigStreamer : public QThread
+{
+public:
+	// streams of tracks without a polyphony limit
+	static const int DefaultVoices = 64;
+	// frames streamed at once
+	static const int ChunkFrames = 4096;
+
+	GigStreamer( int voices );
+	virtual ~GigStreamer();
+
+	// Starts streaming pSample from played position first on, NULL if
+	// all streams are in use
+	GigStream * stream( gig::Sample * pSample, const GigLoop & loop,
+							f_cnt_t first );
+
+	// Libgig has to read the file in one thread at a time
+	QMutex * fileMutex()
+	{
+		return &m_fileMutex;
+	}
+
+protected:
+	virtual void run();
+
+private:
+	// Streams the next chunk if there's space for it in the ring
+	bool fill( GigStream * s );
+
+	std::vector<GigStream *> m_streams;
+	gig::buffer_t m_decompressionBuffer;
+
+	QMutex m_fileMutex;
+	QMutex m_wakeMutex;
+	QWaitCondition m_wake;
+	QAtomicInt m_quit;
+} ;
+
+
+
+
 // Load a GIG file using libgig
 class GigInstance
 {
 public:
-	GigInstance( QString filename ) :
+	GigInstance( QString filename, int voices ) :
 		riff( filename.toUtf8().constData() ),
-		gig( &riff )
-	{}
+		gig( &riff ),
+		streamer( voices )
+	{
+		streamer.start();
+	}
 
 private:
 	RIFF::File riff;
 
 public:
 	gig::File gig;
+
+	// Declared last so it stops before the file gets closed
+	GigStreamer streamer;
 } ;
 
 
@@ -151,13 +269,22 @@ public:
 	bool convertSampleRate( sampleFrame & oldBuf, sampleFrame & newBuf,
 		f_cnt_t oldSize, f_cnt_t newSize, float freq_factor, f_cnt_t& used );
 
+	// Whether the loop of the sample stays within the first cached frames,
+	// i.e. it never needs to be streamed
+	bool resident( f_cnt_t cached ) const;
+
 	gig::Sample * sample;
 	gig::DimensionRegion * region;
 	float attenuation;
 	ADSR adsr;
 
-	// The position in sample
+	// The position in the played sample, see GigLoop
 	f_cnt_t pos;
+	GigLoop loop;
+
+	// The rest of the sample after the preloaded head, taken when the
+	// sample starts playing - copies don't take it along
+	GigStream * stream;
 
 	// Whether to change the pitch of the samples, e.g. if there's only one
 	// sample per octave and you want that sample pitch shifted for the rest of
@@ -273,6 +400,13 @@ public slots:
 	void openFile( const QString & _gigFile, bool updateTrackName = true );
 	void updatePatch();
 	void updateSampleRate();
+	void updatePreload();
+
+	// Periods a note had to play silence as its stream fell behind
+	int underruns() const
+	{
+		return m_underruns.load();
+	}
 
 
 private:
@@ -288,6 +422,12 @@ private:
 
 	FloatModel m_gain;
 
+	// KB of each sample of the instrument kept in RAM, the rest of it is
+	// streamed once a note plays it
+	LcdSpinBoxModel m_preloadSize;
+	QSet<gig::Sample *> m_preloaded;
+	QAtomicInt m_underruns;
+
 	// Locking for the data
 	QMutex m_synthMutex;
 	QMutex m_notesMutex;
@@ -313,10 +453,13 @@ private:
 	// parameters such as velocity
 	Dimension getDimensions( gig::Region * pRegion, int velocity, bool release );
 
-	// Load sample data from the Gig file, looping the sample where needed
+	// Load sample data from its preloaded head and its stream, looping the
+	// sample where needed
 	void loadSample( GigSample& sample, sampleFrame* sampleData, f_cnt_t samples );
-	f_cnt_t getLoopedIndex( f_cnt_t index, f_cnt_t startf, f_cnt_t endf ) const;
-	f_cnt_t getPingPongIndex( f_cnt_t index, f_cnt_t startf, f_cnt_t endf ) const;
+
+	// Load the heads of the samples of the instrument, m_synthMutex has to
+	// be locked
+	void preloadSamples();
 
 	// Add the desired samples to the note, either normal samples or release
 	// samples
@@ -356,6 +499,9 @@ private:
 
 	Knob * m_gainKnob;
 
+	LcdSpinBox * m_preloadLcd;
+	QLabel * m_underrunLabel;
+
 	static PatchesDialog * s_patchDialog;
 
 protected slots:
@@ -364,6 +510,7 @@ protected slots:
 	void showPatchDialog();
 	void updateFilename();
 	void updatePatchName();
+	void updateUnderruns();
 } ;
 
 
@@ -1,5 +1,6 @@
 #include <QDomDocument>
 #include <QDir>
+#include <QHash>
 #include <QApplication>
 #include <QMessageBox>
 #include <QProgressDialog>
@@ -267,6 +268,8 @@ bool HydrogenImport::readSong()
 		QDomNode pNoteListNode = patternNode.firstChildElement( "noteList" );
 		if ( ! pNoteListNode.isNull() ) {
 			QDomNode noteNode = pNoteListNode.firstChildElement( "note" );
+			// added to each pattern at once after reading all notes
+			QHash<Pattern *, QVector<Note> > patternNotes;
 			while ( ! noteNode.isNull()  ) {
 				int nPosition = LocalFileMng::readXmlInt( noteNode, "position", 0 );
 				float fVelocity = LocalFileMng::readXmlFloat( noteNode, "velocity", 0.8f );	
@@ -292,10 +295,14 @@ bool HydrogenImport::readSong()
 				n.setVolume( fVelocity * 100 );
 				n.setPanning( ( fPan_R - fPan_L ) * 100 );
 				n.setKey( NoteKey::stringToNoteKey( sKey ) );
-				p->addNote( n,false );
+				patternNotes[p].push_back( n );
 				pn = pn + 1;
 				noteNode = ( QDomNode ) noteNode.nextSiblingElement( "note" );
 			}        
+			for ( auto it = patternNotes.begin(); it != patternNotes.end(); ++it )
+			{
+				it.key()->addNotes( it.value(), false );
+			}
 		}
 		patternNode = ( QDomNode ) patternNode.nextSiblingElement( "pattern" );
 	}
@@ -24,9 +24,10 @@
  */
 
 
-#include <QtCore/QVarLengthArray>
 #include <QMessageBox>
 
+#include <algorithm>
+
 #include "LadspaEffect.h"
 #include "DataFile.h"
 #include "AudioDevice.h"
@@ -39,6 +40,7 @@
 #include "AutomationPattern.h"
 #include "ControllerConnection.h"
 #include "MemoryManager.h"
+#include "ScratchArena.h"
 #include "ValueBuffer.h"
 #include "Song.h"
 
@@ -131,29 +133,75 @@ void LadspaEffect::changeSampleRate()
 bool LadspaEffect::processAudioBuffer( sampleFrame * _buf, 
 							const fpp_t _frames )
 {
-	m_pluginMutex.lock();
 	if( !isOkay() || dontRun() || !isRunning() || !isEnabled() )
 	{
-		m_pluginMutex.unlock();
 		return( false );
 	}
 
+	// the plugin is only locked while it's being re-instantiated for a new
+	// sample rate - the period passes through dry then instead of waiting
+	if( !m_pluginMutex.tryLock() )
+	{
+		return isRunning();
+	}
+
 	int frames = _frames;
 	sampleFrame * o_buf = NULL;
-	QVarLengthArray<sample_t> sBuf(_frames * DEFAULT_CHANNELS);
+	ScratchBuffer<sampleFrame> sBuf(_frames);
 
 	if( m_maxSampleRate < Engine::mixer()->processingSampleRate() )
 	{
 		o_buf = _buf;
-		_buf = reinterpret_cast<sampleFrame*>(sBuf.data());
+		_buf = sBuf.data();
 		sampleDown( o_buf, _buf, m_maxSampleRate );
 		frames = _frames * m_maxSampleRate /
 				Engine::mixer()->processingSampleRate();
 	}
 
+	float * channels[DEFAULT_CHANNELS] = { &_buf[0][0], &_buf[0][1] };
+	processChannels<DEFAULT_CHANNELS>( channels, frames );
+
+	if( o_buf != NULL )
+	{
+		sampleBack( _buf, o_buf, m_maxSampleRate );
+	}
+
+	m_pluginMutex.unlock();
+	return( isRunning() );
+}
+
+
+
+
+bool LadspaEffect::processPlanar( float * * _channels, const fpp_t _frames )
+{
+	if( !isOkay() || dontRun() || !isRunning() || !isEnabled() )
+	{
+		return( false );
+	}
+
+	if( !m_pluginMutex.tryLock() )
+	{
+		return isRunning();
+	}
+
+	processChannels<1>( _channels, _frames );
+
+	m_pluginMutex.unlock();
+	return( isRunning() );
+}
+
+
+
+
+template<int Stride>
+void LadspaEffect::processChannels( float * const * _channels, int frames )
+{
 	// Copy the LMMS audio buffer to the LADSPA input buffer and initialize
 	// the control ports.  
 	ch_cnt_t channel = 0;
+	// whether a control rate input changes within the period
+	bool automated = false;
 	for( ch_cnt_t proc = 0; proc < processorCount(); ++proc )
 	{
 		for( int port = 0; port < m_portCount; ++port )
@@ -162,38 +210,43 @@ bool LadspaEffect::processAudioBuffer( sampleFrame * _buf,
 			switch( pp->rate )
 			{
 				case CHANNEL_IN:
+				{
+					const float * in = _channels[channel];
 					for( fpp_t frame = 0; 
 						frame < frames; ++frame )
 					{
-						pp->buffer[frame] = 
-							_buf[frame][channel];
+						pp->buffer[frame] = in[frame * Stride];
 					}
 					++channel;
 					break;
+				}
 				case AUDIO_RATE_INPUT:
 				{
 					ValueBuffer * vb = pp->control->valueBuffer();
 					if( vb )
 					{
 						memcpy( pp->buffer, vb->values(), frames * sizeof(float) );
+						pp->holdsValue = false;
 					}
 					else
 					{
-						pp->value = static_cast<LADSPA_Data>( 
+						const LADSPA_Data value = static_cast<LADSPA_Data>(
 											pp->control->value() / pp->scale );
 						// This only supports control rate ports, so the audio rates are
 						// treated as though they were control rate by setting the
 						// port buffer to all the same value.
-						for( fpp_t frame = 0; 
-							frame < frames; ++frame )
+						if( !pp->holdsValue || value != pp->value )
 						{
-							pp->buffer[frame] = 
-								pp->value;
+							pp->value = value;
+							std::fill( pp->buffer, pp->buffer +
+								Engine::mixer()->framesPerPeriod(), value );
+							pp->holdsValue = true;
 						}
 					}
 					break;
 				}
 				case CONTROL_RATE_INPUT:
+				{
 					if( pp->control == NULL )
 					{
 						break;
@@ -202,7 +255,16 @@ bool LadspaEffect::processAudioBuffer( sampleFrame * _buf,
 										pp->control->value() / pp->scale );
 					pp->buffer[0] = 
 						pp->value;
+					const ValueBuffer * vb = pp->control->valueBuffer();
+					if( vb && !automated )
+					{
+						const float * v = vb->values();
+						automated = std::find_if( v, v + vb->length(),
+							[v]( float _x ) { return _x != v[0]; } ) !=
+								v + vb->length();
+					}
 					break;
+				}
 				case CHANNEL_OUT:
 				case AUDIO_RATE_OUTPUT:
 				case CONTROL_RATE_OUTPUT:
@@ -215,9 +277,16 @@ bool LadspaEffect::processAudioBuffer( sampleFrame * _buf,
 
 
 	// Process the buffers.
-	for( ch_cnt_t proc = 0; proc < processorCount(); ++proc )
+	if( automated && frames >= 2 * SubBlockFrames )
+	{
+		runSubBlocks( frames );
+	}
+	else
 	{
-		(m_descriptor->run)( m_handles[proc], frames );
+		for( ch_cnt_t proc = 0; proc < processorCount(); ++proc )
+		{
+			(m_descriptor->run)( m_handles[proc], frames );
+		}
 	}
 
 	// Copy the LADSPA output buffers to the LMMS buffer.
@@ -237,14 +306,18 @@ bool LadspaEffect::processAudioBuffer( sampleFrame * _buf,
 				case CONTROL_RATE_INPUT:
 					break;
 				case CHANNEL_OUT:
+				{
+					float * out = _channels[channel];
 					for( fpp_t frame = 0; 
 						frame < frames; ++frame )
 					{
-						_buf[frame][channel] = d * _buf[frame][channel] + w * pp->buffer[frame];
-						out_sum += _buf[frame][channel] * _buf[frame][channel];
+						float & sample = out[frame * Stride];
+						sample = d * sample + w * pp->buffer[frame];
+						out_sum += sample * sample;
 					}
 					++channel;
 					break;
+				}
 				case AUDIO_RATE_OUTPUT:
 				case CONTROL_RATE_OUTPUT:
 					break;
@@ -254,17 +327,62 @@ bool LadspaEffect::processAudioBuffer( sampleFrame * _buf,
 		}
 	}
 
-	if( o_buf != NULL )
-	{
-		sampleBack( _buf, o_buf, m_maxSampleRate );
-	}
-
 	checkGate( out_sum / frames );
+}
 
 
-	bool is_running = isRunning();
-	m_pluginMutex.unlock();
-	return( is_running );
+
+
+void LadspaEffect::runSubBlocks( int _frames )
+{
+	const int blocks = _frames / SubBlockFrames;
+	for( int b = 0; b < blocks; ++b )
+	{
+		const int start = b * _frames / blocks;
+		const int end = ( b + 1 ) * _frames / blocks;
+		for( ch_cnt_t proc = 0; proc < processorCount(); ++proc )
+		{
+			for( int port = 0; port < m_portCount; ++port )
+			{
+				port_desc_t * pp = m_ports.at( proc ).at( port );
+				if( pp->rate == CONTROL_RATE_INPUT )
+				{
+					const ValueBuffer * vb = pp->control ?
+						pp->control->valueBuffer() : NULL;
+					if( vb )
+					{
+						// the automation is at the processing
+						// rate, the plugin may run at a lower one
+						pp->buffer[0] = static_cast<LADSPA_Data>(
+							vb->value( start * vb->length() /
+							_frames ) / pp->scale );
+					}
+				}
+				else if( pp->rate != CONTROL_RATE_OUTPUT )
+				{
+					// LADSPA allows connecting ports between
+					// calls of run()
+					m_descriptor->connect_port( m_handles[proc],
+							port, pp->buffer + start );
+				}
+			}
+			(m_descriptor->run)( m_handles[proc], end - start );
+		}
+	}
+
+	for( ch_cnt_t proc = 0; proc < processorCount(); ++proc )
+	{
+		for( int port = 0; port < m_portCount; ++port )
+		{
+			port_desc_t * pp = m_ports.at( proc ).at( port );
+			if( pp->rate != CONTROL_RATE_INPUT &&
+					pp->rate != CONTROL_RATE_OUTPUT )
+			{
+				m_descriptor->connect_port( m_handles[proc], port,
+								pp->buffer );
+			}
+		}
+	}
 }
 
 
@@ -316,6 +434,7 @@ void LadspaEffect::pluginInstantiation()
 			p->port_id = port;
 			p->control = NULL;
 			p->buffer = NULL;
+			p->holdsValue = false;
 
 			// Determine the port's category.
 			if( manager->isPortAudio( m_key, port ) )
@@ -324,7 +443,7 @@ void LadspaEffect::pluginInstantiation()
 					manager->isPortInput( m_key, port ) )
 				{
 					p->rate = CHANNEL_IN;
-					p->buffer = MM_ALLOC( LADSPA_Data, Engine::mixer()->framesPerPeriod() );
+					p->buffer = MM_ALLOC_TAGGED( LADSPA_Data, Engine::mixer()->framesPerPeriod(), Plugins );
 					inbuf[ inputch ] = p->buffer;
 					inputch++;
 				}
@@ -339,24 +458,24 @@ void LadspaEffect::pluginInstantiation()
 					}
 					else
 					{
-						p->buffer = MM_ALLOC( LADSPA_Data, Engine::mixer()->framesPerPeriod() );
+						p->buffer = MM_ALLOC_TAGGED( LADSPA_Data, Engine::mixer()->framesPerPeriod(), Plugins );
 						m_inPlaceBroken = true;
 					}
 				}
 				else if( manager->isPortInput( m_key, port ) )
 				{
 					p->rate = AUDIO_RATE_INPUT;
-					p->buffer = MM_ALLOC( LADSPA_Data, Engine::mixer()->framesPerPeriod() );
+					p->buffer = MM_ALLOC_TAGGED( LADSPA_Data, Engine::mixer()->framesPerPeriod(), Plugins );
 				}
 				else
 				{
 					p->rate = AUDIO_RATE_OUTPUT;
-					p->buffer = MM_ALLOC( LADSPA_Data, Engine::mixer()->framesPerPeriod() );
+					p->buffer = MM_ALLOC_TAGGED( LADSPA_Data, Engine::mixer()->framesPerPeriod(), Plugins );
 				}
 			}
 			else
 			{
-				p->buffer = MM_ALLOC( LADSPA_Data, 1 );
+				p->buffer = MM_ALLOC_TAGGED( LADSPA_Data, 1, Plugins );
 
 				if( manager->isPortInput( m_key, port ) )
 				{
@@ -45,6 +45,15 @@ public:
 
 	virtual bool processAudioBuffer( sampleFrame * _buf,
 							const fpp_t _frames );
+
+	// the ports are planar, unless the plugin has to be run at a lower
+	// sample rate
+	virtual bool wantsPlanar() const
+	{
+		return m_maxSampleRate >= Engine::mixer()->processingSampleRate();
+	}
+
+	virtual bool processPlanar( float * * _channels, const fpp_t _frames );
 	
 	void setControl( int _control, LADSPA_Data _data );
 
@@ -67,6 +76,17 @@ private:
 	void pluginInstantiation();
 	void pluginDestruction();
 
+	//! Runs the plugin on the channels, whose samples are Stride apart,
+	//! with the plugin locked
+	template<int Stride>
+	void processChannels( float * const * _channels, int _frames );
+	//! Splits run() into sub-blocks of at least SubBlockFrames frames,
+	//! each one with the values the automated control rate inputs have
+	//! at its start
+	void runSubBlocks( int _frames );
+
+	static const int SubBlockFrames = 32;
+
 	static sample_rate_t maxSamplerate( const QString & _name );
 
 
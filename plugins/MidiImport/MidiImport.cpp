@@ -30,6 +30,7 @@
 #include <QMessageBox>
 #include <QProgressDialog>
 
+#include <algorithm>
 #include <sstream>
 
 #include "MidiImport.h"
@@ -225,6 +226,7 @@ public:
 	Instrument * it_inst;
 	bool isSF2; 
 	bool hasNotes;
+	QVector<Note> notes;
 	QString trackName;
 	
 	smfMidiChannel * create( TrackContainer* tc, QString tn )
@@ -267,34 +269,43 @@ public:
 
 	void addNote( Note & n )
 	{
-		if (!p)
-		{
-			p = dynamic_cast<Pattern*>(it->createTCO(0));
-		}
-		p->addNote(n, false);
+		// added to the patterns all at once by splitPatterns()
+		notes.push_back(n);
 		hasNotes = true;
 	}
 
 	void splitPatterns()
 	{
 		Pattern * newPattern = nullptr;
+		QVector<Note> patternNotes;
 		MidiTime lastEnd(0);
 
-		p->rearrangeAllNotes();
-		for (auto n : p->notes())
+		std::stable_sort(notes.begin(), notes.end(),
+			[](const Note & a, const Note & b) { return Note::lessThan(&a, &b); });
+		for (const Note & n : notes)
 		{
-			if (!newPattern || n->pos() > lastEnd + DefaultTicksPerBar)
+			if (!newPattern || n.pos() > lastEnd + DefaultTicksPerBar)
 			{
-				MidiTime pPos = MidiTime(n->pos().getBar(), 0);
+				if (newPattern)
+				{
+					newPattern->addNotes(patternNotes, false);
+					patternNotes.clear();
+				}
+				MidiTime pPos = MidiTime(n.pos().getBar(), 0);
 				newPattern = dynamic_cast<Pattern*>(it->createTCO(0));
 				newPattern->movePosition(pPos);
 			}
-			lastEnd = n->pos() + n->length();
+			lastEnd = n.pos() + n.length();
 
-			Note newNote(*n);
-			newNote.setPos(n->pos(newPattern->startPosition()));
-			newPattern->addNote(newNote, false);
+			Note newNote(n);
+			newNote.setPos(n.pos(newPattern->startPosition()));
+			patternNotes.push_back(newNote);
+		}
+		if (newPattern)
+		{
+			newPattern->addNotes(patternNotes, false);
 		}
+		notes.clear();
 
 		delete p;
 		p = nullptr;
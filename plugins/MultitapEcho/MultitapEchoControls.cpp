@@ -130,10 +130,7 @@ void MultitapEchoControls::setDefaultLpShape()
 void MultitapEchoControls::ampSamplesChanged( int begin, int end )
 {
 	const float * samples = m_ampGraph.samples();
-	for( int i = begin; i <= end; ++i )
-	{
-		m_effect->m_amp[i] = dbfsToAmp( samples[i] );
-	}
+	dbToAmpBlock( m_effect->m_amp + begin, samples + begin, end - begin + 1 );
 }
 
 
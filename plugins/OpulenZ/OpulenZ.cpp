@@ -24,7 +24,8 @@
 
 // TODO:
 // - Better voice allocation: long releases get cut short :(
-// - RT safety = get rid of mutex = make emulator code thread-safe
+// - RT safety = get rid of mutex (the Nuked OPL3 emulator only needs it for
+//   MIDI handling and patch changes of its own instance)
 
 // - Extras:
 //   - double release: first release is in effect until noteoff (heard if percussive sound),
@@ -48,7 +49,11 @@
 #include <math.h>
 
 #include "opl.h"
+#ifdef OPULENZ_NUKED_OPL
+#include "nemuopl.h"
+#else
 #include "temuopl.h"
+#endif
 #include "mididata.h"
 
 #include "embed.h"
@@ -86,9 +91,18 @@ PLUGIN_EXPORT Plugin * lmms_plugin_main( Model *m, void * )
 
 }
 
+#ifndef OPULENZ_NUKED_OPL
 // I'd much rather do without a mutex, but it looks like
 // the emulator code isn't really ready for threads
 QMutex OpulenzInstrument::emulatorMutex;
+#endif
+
+// Nuked OPL3 renders stereo, the older emulator mono
+#ifdef OPULENZ_NUKED_OPL
+const int OPL_OUTPUT_CHANNELS = 2;
+#else
+const int OPL_OUTPUT_CHANNELS = 1;
+#endif
 
 // Weird ordering of voice parameters
 const unsigned int adlib_opadd[OPL2_VOICES] = {0x00, 0x01, 0x02, 0x08, 0x09, 0x0A, 0x10, 0x11, 0x12};
@@ -137,12 +151,8 @@ OpulenzInstrument::OpulenzInstrument( InstrumentTrack * _instrument_track ) :
 	trem_depth_mdl(false, this, tr( "Tremolo depth" )   )
 {
 
-	// Create an emulator - samplerate, 16 bit, mono
 	emulatorMutex.lock();
-	theEmulator = new CTemuopl(Engine::mixer()->processingSampleRate(), true, false);
-	theEmulator->init();
-	// Enable waveform selection
-	theEmulator->write(0x01,0x20);
+	theEmulator = createEmulator();
 	emulatorMutex.unlock();
 
 	//Initialize voice values
@@ -159,7 +169,7 @@ OpulenzInstrument::OpulenzInstrument( InstrumentTrack * _instrument_track ) :
 
 	// Can the buffer size change suddenly? I bet that would break lots of stuff
 	frameCount = Engine::mixer()->framesPerPeriod();
-	renderbuffer = new short[frameCount];
+	renderbuffer = new short[frameCount * OPL_OUTPUT_CHANNELS];
 
 	// Some kind of sane defaults
 	pitchbend = 0;
@@ -219,20 +229,33 @@ OpulenzInstrument::OpulenzInstrument( InstrumentTrack * _instrument_track ) :
 }
 
 OpulenzInstrument::~OpulenzInstrument() {
-	delete theEmulator;
 	Engine::mixer()->removePlayHandlesOfTypes( instrumentTrack(),
 				PlayHandle::TypeNotePlayHandle
 				| PlayHandle::TypeInstrumentPlayHandle );
+	delete theEmulator;
 	delete [] renderbuffer;
 }
 
+// Create an emulator - samplerate, 16 bit, mono (the Nuked one renders
+// stereo and keeps all of its state per instance)
+// This shall only be called from code protected by the holy Mutex!
+Copl * OpulenzInstrument::createEmulator() {
+#ifdef OPULENZ_NUKED_OPL
+	Copl * emulator = new CNemuopl(Engine::mixer()->processingSampleRate());
+#else
+	Copl * emulator = new CTemuopl(Engine::mixer()->processingSampleRate(), true, false);
+#endif
+	emulator->init();
+	// Enable waveform selection
+	emulator->write(0x01,0x20);
+	return emulator;
+}
+
 // Samplerate changes when choosing oversampling, so this is more or less mandatory
 void OpulenzInstrument::reloadEmulator() {
-	delete theEmulator;
 	emulatorMutex.lock();
-	theEmulator = new CTemuopl(Engine::mixer()->processingSampleRate(), true, false);
-	theEmulator->init();
-	theEmulator->write(0x01,0x20);
+	delete theEmulator;
+	theEmulator = createEmulator();
 	emulatorMutex.unlock();
 	for(int i=0; i<OPL2_VOICES; ++i) {
 		voiceNote[i] = OPL2_VOICE_FREE;
@@ -402,16 +425,16 @@ void OpulenzInstrument::play( sampleFrame * _working_buffer )
 {
 	emulatorMutex.lock();
 	theEmulator->update(renderbuffer, frameCount);
+	emulatorMutex.unlock();
 
 	for( fpp_t frame = 0; frame < frameCount; ++frame )
         {
-                sample_t s = float(renderbuffer[frame]) / 8192.0;
                 for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
                 {
-                        _working_buffer[frame][ch] = s;
+                        _working_buffer[frame][ch] = float(renderbuffer[frame * OPL_OUTPUT_CHANNELS
+                                        + ch % OPL_OUTPUT_CHANNELS]) / 8192.0;
                 }
 	}
-	emulatorMutex.unlock();
 
 	// Throw the data to the track...
 	instrumentTrack()->processAudioBuffer( _working_buffer, frameCount, NULL );
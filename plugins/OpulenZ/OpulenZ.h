@@ -29,6 +29,8 @@
 #include "InstrumentView.h"
 #include "opl.h"
 
+#include <QMutex>
+
 #include "LcdSpinBox.h"
 #include "Knob.h"
 #include "PixmapButton.h"
@@ -133,7 +135,16 @@ private:
 	int pushVoice(int v);
 
 	int Hz2fnum(float Hz);
+#ifdef OPULENZ_NUKED_OPL
+	// guards the emulator of this instance against concurrent MIDI
+	// handling and patch changes
+	QMutex emulatorMutex;
+#else
+	// the emulator keeps its render state in globals shared by all
+	// instances
 	static QMutex emulatorMutex;
+#endif
+	static Copl * createEmulator();
 	void setVoiceVelocity(int voice, int vel);
 
 	// Pitch bend range comes through RPNs.
@@ -24,6 +24,7 @@
 #include "ReverbSC.h"
 
 #include "embed.h"
+#include "ScratchArena.h"
 #include "plugin_export.h"
 
 #define DB2LIN(X) pow(10, X / 20.0f);
@@ -82,41 +83,46 @@ bool ReverbSCEffect::processAudioBuffer( sampleFrame* buf, const fpp_t frames )
 	const float d = dryLevel();
 	const float w = wetLevel();
 
-	SPFLOAT tmpL, tmpR;
-	SPFLOAT dcblkL, dcblkR;
-	
 	ValueBuffer * inGainBuf = m_reverbSCControls.m_inputGainModel.valueBuffer();
 	ValueBuffer * sizeBuf = m_reverbSCControls.m_sizeModel.valueBuffer();
 	ValueBuffer * colorBuf = m_reverbSCControls.m_colorModel.valueBuffer();
 	ValueBuffer * outGainBuf = m_reverbSCControls.m_outputGainModel.valueBuffer();
 
+	// size and color are applied once per period, the reverb runs on
+	// separate left and right blocks
+	revsc->feedback = (SPFLOAT)(sizeBuf ?
+		sizeBuf->values()[0]
+		: m_reverbSCControls.m_sizeModel.value());
+	revsc->lpfreq = (SPFLOAT)(colorBuf ?
+		colorBuf->values()[0]
+		: m_reverbSCControls.m_colorModel.value());
+
+	ScratchBuffer<SPFLOAT> planar( frames * 4 );
+	SPFLOAT * inL = planar.data();
+	SPFLOAT * inR = inL + frames;
+	SPFLOAT * outL = inR + frames;
+	SPFLOAT * outR = outL + frames;
+
 	for( fpp_t f = 0; f < frames; ++f )
 	{
-		sample_t s[2] = { buf[f][0], buf[f][1] };
-
-		const SPFLOAT inGain = (SPFLOAT)DB2LIN((inGainBuf ? 
-			inGainBuf->values()[f] 
+		const SPFLOAT inGain = (SPFLOAT)DB2LIN((inGainBuf ?
+			inGainBuf->values()[f]
 			: m_reverbSCControls.m_inputGainModel.value()));
-		const SPFLOAT outGain = (SPFLOAT)DB2LIN((outGainBuf ? 
-			outGainBuf->values()[f] 
-			: m_reverbSCControls.m_outputGainModel.value()));
-
-		s[0] *= inGain;
-		s[1] *= inGain;
-		revsc->feedback = (SPFLOAT)(sizeBuf ? 
-			sizeBuf->values()[f] 
-			: m_reverbSCControls.m_sizeModel.value());
-
-		revsc->lpfreq = (SPFLOAT)(colorBuf ? 
-			colorBuf->values()[f] 
-			: m_reverbSCControls.m_colorModel.value());
+		inL[f] = buf[f][0] * inGain;
+		inR[f] = buf[f][1] * inGain;
+	}
 
+	sp_revsc_compute_block(sp, revsc, inL, inR, outL, outR, frames);
+	sp_dcblock_compute_block(sp, dcblk[0], outL, outL, frames);
+	sp_dcblock_compute_block(sp, dcblk[1], outR, outR, frames);
 
-		sp_revsc_compute(sp, revsc, &s[0], &s[1], &tmpL, &tmpR);
-		sp_dcblock_compute(sp, dcblk[0], &tmpL, &dcblkL);
-		sp_dcblock_compute(sp, dcblk[1], &tmpR, &dcblkR);
-		buf[f][0] = d * buf[f][0] + w * dcblkL * outGain;
-		buf[f][1] = d * buf[f][1] + w * dcblkR * outGain;
+	for( fpp_t f = 0; f < frames; ++f )
+	{
+		const SPFLOAT outGain = (SPFLOAT)DB2LIN((outGainBuf ?
+			outGainBuf->values()[f]
+			: m_reverbSCControls.m_outputGainModel.value()));
+		buf[f][0] = d * buf[f][0] + w * outL[f] * outGain;
+		buf[f][1] = d * buf[f][1] + w * outR[f] * outGain;
 
 		outSum += buf[f][0]*buf[f][0] + buf[f][1]*buf[f][1];
 	}
@@ -51,3 +51,21 @@ int sp_dcblock_compute(sp_data *sp, sp_dcblock *p, SPFLOAT *in, SPFLOAT *out)
     p->inputs = inputs;
     return SP_OK;
 }
+
+int sp_dcblock_compute_block(sp_data *sp, sp_dcblock *p, const SPFLOAT *in,
+        SPFLOAT *out, int nFrames)
+{
+    SPFLOAT gain = p->gain;
+    SPFLOAT outputs = p->outputs;
+    SPFLOAT inputs = p->inputs;
+    int i;
+
+    for (i = 0; i < nFrames; i++) {
+        outputs = in[i] - inputs + (gain * outputs);
+        inputs = in[i];
+        out[i] = outputs;
+    }
+    p->outputs = outputs;
+    p->inputs = inputs;
+    return SP_OK;
+}
@@ -274,3 +274,128 @@ int sp_revsc_compute(sp_data *sp, sp_revsc *p, SPFLOAT *in1, SPFLOAT *in2, SPFLO
     *out2 = aoutR * outputGain;
     return SP_OK;
 }
+
+/* Same as sp_revsc_compute() for n frames of separate left and right        */
+/* buffers. feedback and lpfreq are read once per block, like k-rate         */
+/* parameters in Csound, and new random line segments are only started at   */
+/* block boundaries, which is far below the segment lengths. The state of    */
+/* the eight delay lines is kept in arrays of eight during the block, so the */
+/* interpolation and filter math of one frame runs through SIMD lanes.       */
+
+int sp_revsc_compute_block(sp_data *sp, sp_revsc *p, const SPFLOAT *in1,
+        const SPFLOAT *in2, SPFLOAT *out1, SPFLOAT *out2, int nFrames)
+{
+    SPFLOAT filterState[8], frac[8], vm1[8], v0[8], v1[8], v2[8];
+    int writePos[8], readPos[8], readPosFrac[8], readPosFrac_inc[8];
+    int bufferSize[8];
+    SPFLOAT *buf[8];
+    SPFLOAT dampFact = p->dampFact;
+    SPFLOAT feedback = p->feedback;
+    SPFLOAT ainL, ainR, aoutL, aoutR, jp;
+    sp_revsc_dl *lp;
+    int i, n, pos;
+
+    if (p->initDone <= 0) return SP_NOT_OK;
+
+    if (p->lpfreq != p->prv_LPFreq) {
+        p->prv_LPFreq = p->lpfreq;
+        dampFact = 2.0 - cos(p->prv_LPFreq * (2 * M_PI) / p->sampleRate);
+        dampFact = p->dampFact = dampFact - sqrt(dampFact * dampFact - 1.0);
+    }
+
+    /* update modulation and load the delay lines */
+
+    for (n = 0; n < 8; n++) {
+        lp = &p->delayLines[n];
+        if (lp->randLine_cnt <= 0) {
+            next_random_lineseg(p, lp, n);
+        }
+        filterState[n] = lp->filterState;
+        writePos[n] = lp->writePos;
+        readPos[n] = lp->readPos;
+        readPosFrac[n] = lp->readPosFrac;
+        readPosFrac_inc[n] = lp->readPosFrac_inc;
+        bufferSize[n] = lp->bufferSize;
+        buf[n] = lp->buf;
+    }
+
+    for (i = 0; i < nFrames; i++) {
+        jp = 0.0;
+        for (n = 0; n < 8; n++) {
+            jp += filterState[n];
+        }
+        jp *= jpScale;
+        ainL = jp + in1[i];
+        ainR = jp + in2[i];
+
+        /* write to and read from the delay lines, these are gathers */
+
+        for (n = 0; n < 8; n++) {
+            buf[n][writePos[n]] = (n & 1 ? ainR : ainL) - filterState[n];
+            if (++writePos[n] >= bufferSize[n]) {
+                writePos[n] -= bufferSize[n];
+            }
+
+            if (readPosFrac[n] >= DELAYPOS_SCALE) {
+                readPos[n] += (readPosFrac[n] >> DELAYPOS_SHIFT);
+                readPosFrac[n] &= DELAYPOS_MASK;
+            }
+            if (readPos[n] >= bufferSize[n])
+                readPos[n] -= bufferSize[n];
+            pos = readPos[n];
+            frac[n] = (SPFLOAT) readPosFrac[n] * (1.0 / (SPFLOAT) DELAYPOS_SCALE);
+
+            if (pos > 0 && pos < (bufferSize[n] - 2)) {
+                vm1[n] = buf[n][pos - 1];
+                v0[n] = buf[n][pos];
+                v1[n] = buf[n][pos + 1];
+                v2[n] = buf[n][pos + 2];
+            }
+            else {
+                if (--pos < 0) pos += bufferSize[n];
+                vm1[n] = buf[n][pos];
+                if (++pos >= bufferSize[n]) pos -= bufferSize[n];
+                v0[n] = buf[n][pos];
+                if (++pos >= bufferSize[n]) pos -= bufferSize[n];
+                v1[n] = buf[n][pos];
+                if (++pos >= bufferSize[n]) pos -= bufferSize[n];
+                v2[n] = buf[n][pos];
+            }
+
+            readPosFrac[n] += readPosFrac_inc[n];
+        }
+
+        /* cubic interpolation, feedback gain and lowpass filter of all */
+        /* lines at once */
+
+        for (n = 0; n < 8; n++) {
+            SPFLOAT f = frac[n];
+            SPFLOAT a2 = (f * f - 1.0f) * (1.0f / 6.0f);
+            SPFLOAT a1 = (f + 1.0f) * 0.5f;
+            SPFLOAT am1 = a1 - 1.0f;
+            SPFLOAT a0 = 3.0f * a2;
+            SPFLOAT v;
+            a1 -= a0; am1 -= a2; a0 -= f;
+            v = (am1 * vm1[n] + a0 * v0[n] + a1 * v1[n] + a2 * v2[n]) * f
+                + v0[n];
+            v *= feedback;
+            filterState[n] = (filterState[n] - v) * dampFact + v;
+        }
+
+        aoutL = filterState[0] + filterState[2] + filterState[4] + filterState[6];
+        aoutR = filterState[1] + filterState[3] + filterState[5] + filterState[7];
+        out1[i] = aoutL * outputGain;
+        out2[i] = aoutR * outputGain;
+    }
+
+    for (n = 0; n < 8; n++) {
+        lp = &p->delayLines[n];
+        lp->filterState = filterState[n];
+        lp->writePos = writePos[n];
+        lp->readPos = readPos[n];
+        lp->readPosFrac = readPosFrac[n];
+        lp->randLine_cnt -= nFrames;
+    }
+
+    return SP_OK;
+}
@@ -44,7 +44,7 @@ extern "C" {
 		"Spectrum Analyzer",
 		QT_TRANSLATE_NOOP("pluginBrowser", "A graphical spectrum analyzer."),
 		"Martin Pavelek <he29/dot/HS/at/gmail/dot/com>",
-		0x0112,
+		0x0113,
 		Plugin::Effect,
 		new PluginPixmapLoader("logo"),
 		NULL,
@@ -90,8 +90,9 @@ bool Analyzer::processAudioBuffer(sampleFrame *buffer, const fpp_t frame_count)
 
 	if (!isEnabled() || !isRunning ()) {return false;}
 
-	// Skip processing if the controls dialog isn't visible, it would only waste CPU cycles.
-	if (m_controls.isViewVisible())
+	// Skip processing if the controls dialog or both its displays aren't
+	// visible, it would only waste CPU cycles.
+	if (m_controls.isViewVisible() && m_processor.isActive())
 	{
 		// To avoid processing spikes on audio thread, data are stored in
 		// a lockless ringbuffer and processed in a separate thread.
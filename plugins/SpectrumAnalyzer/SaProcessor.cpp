@@ -47,6 +47,8 @@ SaProcessor::SaProcessor(const SaControls *controls) :
 	m_fftBlockSize(FFT_BLOCK_SIZES[0]),
 	m_sampleRate(Engine::mixer()->processingSampleRate()),
 	m_framesFilledUp(0),
+	m_historyPos(0),
+	m_waterfallWidth(0),
 	m_spectrumActive(false),
 	m_waterfallActive(false),
 	m_waterfallNotEmpty(0),
@@ -57,12 +59,10 @@ SaProcessor::SaProcessor(const SaControls *controls) :
 
 	m_bufferL.resize(m_inBlockSize, 0);
 	m_bufferR.resize(m_inBlockSize, 0);
-	m_filteredBufferL.resize(m_fftBlockSize, 0);
-	m_filteredBufferR.resize(m_fftBlockSize, 0);
-	m_spectrumL = (fftwf_complex *) fftwf_malloc(binCount() * sizeof (fftwf_complex));
-	m_spectrumR = (fftwf_complex *) fftwf_malloc(binCount() * sizeof (fftwf_complex));
-	m_fftPlanL = fftwf_plan_dft_r2c_1d(m_fftBlockSize, m_filteredBufferL.data(), m_spectrumL, FFTW_MEASURE);
-	m_fftPlanR = fftwf_plan_dft_r2c_1d(m_fftBlockSize, m_filteredBufferR.data(), m_spectrumR, FFTW_MEASURE);
+	m_filteredBuffer.resize(2 * m_fftBlockSize, 0);
+	m_spectrum = (fftwf_complex *) fftwf_malloc(2 * binCount() * sizeof (fftwf_complex));
+	m_fftPlanMono = realFFTPlan(m_fftBlockSize, m_filteredBuffer.data(), m_spectrum);
+	m_fftPlanStereo = realFFTPlan(m_fftBlockSize, m_filteredBuffer.data(), m_spectrum, 2);
 
 	m_absSpectrumL.resize(binCount(), 0);
 	m_absSpectrumR.resize(binCount(), 0);
@@ -70,22 +70,18 @@ SaProcessor::SaProcessor(const SaControls *controls) :
 	m_normSpectrumR.resize(binCount(), 0);
 
 	m_waterfallHeight = 100;	// a small safe value
-	m_history_work.resize(waterfallWidth() * m_waterfallHeight * sizeof qRgb(0,0,0), 0);
-	m_history.resize(waterfallWidth() * m_waterfallHeight * sizeof qRgb(0,0,0), 0);
+	resizeHistory();
 }
 
 
 SaProcessor::~SaProcessor()
 {
-	if (m_fftPlanL != NULL) {fftwf_destroy_plan(m_fftPlanL);}
-	if (m_fftPlanR != NULL) {fftwf_destroy_plan(m_fftPlanR);}
-	if (m_spectrumL != NULL) {fftwf_free(m_spectrumL);}
-	if (m_spectrumR != NULL) {fftwf_free(m_spectrumR);}
-
-	m_fftPlanL = NULL;
-	m_fftPlanR = NULL;
-	m_spectrumL = NULL;
-	m_spectrumR = NULL;
+	// the plans belong to the shared cache
+	if (m_spectrum != NULL) {fftwf_free(m_spectrum);}
+
+	m_fftPlanMono = NULL;
+	m_fftPlanStereo = NULL;
+	m_spectrum = NULL;
 }
 
 
@@ -163,21 +159,21 @@ void SaProcessor::analyze(LocklessRingBuffer<sampleFrame> &ring_buffer)
 				// apply FFT window
 				for (unsigned int i = 0; i < m_inBlockSize; i++)
 				{
-					m_filteredBufferL[i] = m_bufferL[i] * m_fftWindow[i];
-					m_filteredBufferR[i] = m_bufferR[i] * m_fftWindow[i];
+					m_filteredBuffer[i] = m_bufferL[i] * m_fftWindow[i];
+					m_filteredBuffer[m_fftBlockSize + i] = m_bufferR[i] * m_fftWindow[i];
 				}
 
-				// Run FFT on left channel, convert the result to absolute magnitude
-				// spectrum and normalize it.
-				fftwf_execute(m_fftPlanL);
-				absspec(m_spectrumL, m_absSpectrumL.data(), binCount());
+				// Run FFT on left channel, or on both at once if stereo processing
+				// is enabled. Convert the result to absolute magnitude spectrum
+				// and normalize it.
+				fftwf_execute_dft_r2c(stereo ? m_fftPlanStereo : m_fftPlanMono,
+					m_filteredBuffer.data(), m_spectrum);
+				absspec(m_spectrum, m_absSpectrumL.data(), binCount());
 				normalize(m_absSpectrumL, m_normSpectrumL, m_inBlockSize);
 
-				// repeat analysis for right channel if stereo processing is enabled
 				if (stereo)
 				{
-					fftwf_execute(m_fftPlanR);
-					absspec(m_spectrumR, m_absSpectrumR.data(), binCount());
+					absspec(m_spectrum + binCount(), m_absSpectrumR.data(), binCount());
 					normalize(m_absSpectrumR, m_normSpectrumR, m_inBlockSize);
 				}
 
@@ -193,96 +189,95 @@ void SaProcessor::analyze(LocklessRingBuffer<sampleFrame> &ring_buffer)
 
 				if (m_waterfallActive && m_waterfallNotEmpty)
 				{
-					// move waterfall history one line down and clear the top line
-					QRgb *pixel = (QRgb *)m_history_work.data();
-					std::copy(pixel,
-							  pixel + waterfallWidth() * m_waterfallHeight - waterfallWidth(),
-							  pixel + waterfallWidth());
-					memset(pixel, 0, waterfallWidth() * sizeof (QRgb));
-
-					// add newest result on top
-					int target;		// pixel being constructed
-					float accL = 0;	// accumulators for merging multiple bins
-					float accR = 0;
-					for (unsigned int i = 0; i < binCount(); i++)
+					// Replace the oldest history line by the newest result. The
+					// line above it becomes the oldest one, so nothing has to move.
+					const unsigned int width = waterfallWidth();
+					m_historyPos = (m_historyPos + m_waterfallHeight - 1) % m_waterfallHeight;
+					QRgb *pixel = (QRgb *)m_history.data() + m_historyPos * width;
+
+					if (overload)
 					{
 						// fill line with red color to indicate lost data if CPU cannot keep up
-						if (overload && i < waterfallWidth())
-						{
-							pixel[i] = qRgb(42, 0, 0);
-							continue;
-						}
+						std::fill(pixel, pixel + width, qRgb(42, 0, 0));
+					}
+					else
+					{
+						memset(pixel, 0, width * sizeof (QRgb));
 
-						// Every frequency bin spans a frequency range that must be
-						// partially or fully mapped to a pixel. Any inconsistency
-						// may be seen in the spectrogram as dark or white lines --
-						// play white noise to confirm your change did not break it.
-						float band_start = freqToXPixel(binToFreq(i) - binBandwidth() / 2.0, waterfallWidth());
-						float band_end = freqToXPixel(binToFreq(i + 1) - binBandwidth() / 2.0, waterfallWidth());
-						if (m_controls->m_logXModel.value())
+						// Only bins within the displayed frequency range are drawn,
+						// starting just below it so that partial pixels add up.
+						unsigned int first = getFreqRangeMin() / getNyquistFreq() * binCount();
+						if (first > 0) {first--;}
+
+						int target;		// pixel being constructed
+						float accL = 0;	// accumulators for merging multiple bins
+						float accR = 0;
+						for (unsigned int i = first; i < binCount(); i++)
 						{
-							// Logarithmic scale
-							if (band_end - band_start > 1.0)
+							// Every frequency bin spans a frequency range that must be
+							// partially or fully mapped to a pixel. Any inconsistency
+							// may be seen in the spectrogram as dark or white lines --
+							// play white noise to confirm your change did not break it.
+							float band_start = freqToXPixel(binToFreq(i) - binBandwidth() / 2.0, width);
+							float band_end = freqToXPixel(binToFreq(i + 1) - binBandwidth() / 2.0, width);
+							// the remaining bins are all right of the display
+							if (band_start >= width) {break;}
+							if (m_controls->m_logXModel.value())
 							{
-								// band spans multiple pixels: draw all pixels it covers
-								for (target = (int)band_start; target < (int)band_end; target++)
+								// Logarithmic scale
+								if (band_end - band_start > 1.0)
 								{
-									if (target >= 0 && target < waterfallWidth())
+									// band spans multiple pixels: draw all pixels it covers
+									for (target = (int)band_start; target < (int)band_end; target++)
 									{
-										pixel[target] = makePixel(m_normSpectrumL[i], m_normSpectrumR[i]);
+										if (target >= 0 && target < (int)width)
+										{
+											pixel[target] = makePixel(m_normSpectrumL[i], m_normSpectrumR[i]);
+										}
 									}
-								}
-								// save remaining portion of the band for the following band / pixel
-								// (in case the next band uses sub-pixel drawing)
-								accL = (band_end - (int)band_end) * m_normSpectrumL[i];
-								accR = (band_end - (int)band_end) * m_normSpectrumR[i];
-							}
-							else
-							{
-								// sub-pixel drawing; add contribution of current band
-								target = (int)band_start;
-								if ((int)band_start == (int)band_end)
-								{
-									// band ends within current target pixel, accumulate
-									accL += (band_end - band_start) * m_normSpectrumL[i];
-									accR += (band_end - band_start) * m_normSpectrumR[i];
+									// save remaining portion of the band for the following band / pixel
+									// (in case the next band uses sub-pixel drawing)
+									accL = (band_end - (int)band_end) * m_normSpectrumL[i];
+									accR = (band_end - (int)band_end) * m_normSpectrumR[i];
 								}
 								else
 								{
-									// Band ends in the next pixel -- finalize the current pixel.
-									// Make sure contribution is split correctly on pixel boundary.
-									accL += ((int)band_end - band_start) * m_normSpectrumL[i];
-									accR += ((int)band_end - band_start) * m_normSpectrumR[i];
+									// sub-pixel drawing; add contribution of current band
+									target = (int)band_start;
+									if ((int)band_start == (int)band_end)
+									{
+										// band ends within current target pixel, accumulate
+										accL += (band_end - band_start) * m_normSpectrumL[i];
+										accR += (band_end - band_start) * m_normSpectrumR[i];
+									}
+									else
+									{
+										// Band ends in the next pixel -- finalize the current pixel.
+										// Make sure contribution is split correctly on pixel boundary.
+										accL += ((int)band_end - band_start) * m_normSpectrumL[i];
+										accR += ((int)band_end - band_start) * m_normSpectrumR[i];
 
-									if (target >= 0 && target < waterfallWidth()) {pixel[target] = makePixel(accL, accR);}
+										if (target >= 0 && target < (int)width) {pixel[target] = makePixel(accL, accR);}
 
-									// save remaining portion of the band for the following band / pixel
-									accL = (band_end - (int)band_end) * m_normSpectrumL[i];
-									accR = (band_end - (int)band_end) * m_normSpectrumR[i];
+										// save remaining portion of the band for the following band / pixel
+										accL = (band_end - (int)band_end) * m_normSpectrumL[i];
+										accR = (band_end - (int)band_end) * m_normSpectrumR[i];
+									}
 								}
 							}
-						}
-						else
-						{
-							// Linear: always draws one or more pixels per band
-							for (target = (int)band_start; target < band_end; target++)
+							else
 							{
-								if (target >= 0 && target < waterfallWidth())
+								// Linear: always draws one or more pixels per band
+								for (target = (int)band_start; target < band_end; target++)
 								{
-									pixel[target] = makePixel(m_normSpectrumL[i], m_normSpectrumR[i]);
+									if (target >= 0 && target < (int)width)
+									{
+										pixel[target] = makePixel(m_normSpectrumL[i], m_normSpectrumR[i]);
+									}
 								}
 							}
 						}
 					}
-
-					// Copy work buffer to result buffer. Done only if requested, so
-					// that time isn't wasted on updating faster than display FPS.
-					// (The copy is about as expensive as the movement.)
-					if (m_flipRequest)
-					{
-						m_history = m_history_work;
-						m_flipRequest = false;
-					}
 				}
 				// clean up before checking for more data from input buffer
 				const unsigned int overlaps = m_controls->m_windowOverlapModel.value();
@@ -395,25 +390,20 @@ void SaProcessor::reallocateBuffers()
 	QMutexLocker reloc_lock(&m_reallocationAccess);
 	QMutexLocker data_lock(&m_dataAccess);
 
-	// destroy old FFT plan and free the result buffer
-	if (m_fftPlanL != NULL) {fftwf_destroy_plan(m_fftPlanL);}
-	if (m_fftPlanR != NULL) {fftwf_destroy_plan(m_fftPlanR);}
-	if (m_spectrumL != NULL) {fftwf_free(m_spectrumL);}
-	if (m_spectrumR != NULL) {fftwf_free(m_spectrumR);}
+	// free the result buffer, the old FFT plans stay in the shared cache
+	if (m_spectrum != NULL) {fftwf_free(m_spectrum);}
 
 	// allocate new space, create new plan and resize containers
 	m_fftWindow.resize(new_in_size, 1.0);
 	precomputeWindow(m_fftWindow.data(), new_in_size, (FFT_WINDOWS) m_controls->m_windowModel.value());
 	m_bufferL.resize(new_in_size, 0);
 	m_bufferR.resize(new_in_size, 0);
-	m_filteredBufferL.resize(new_fft_size, 0);
-	m_filteredBufferR.resize(new_fft_size, 0);
-	m_spectrumL = (fftwf_complex *) fftwf_malloc(new_bins * sizeof (fftwf_complex));
-	m_spectrumR = (fftwf_complex *) fftwf_malloc(new_bins * sizeof (fftwf_complex));
-	m_fftPlanL = fftwf_plan_dft_r2c_1d(new_fft_size, m_filteredBufferL.data(), m_spectrumL, FFTW_MEASURE);
-	m_fftPlanR = fftwf_plan_dft_r2c_1d(new_fft_size, m_filteredBufferR.data(), m_spectrumR, FFTW_MEASURE);
-
-	if (m_fftPlanL == NULL || m_fftPlanR == NULL)
+	m_filteredBuffer.resize(2 * new_fft_size, 0);
+	m_spectrum = (fftwf_complex *) fftwf_malloc(2 * new_bins * sizeof (fftwf_complex));
+	m_fftPlanMono = realFFTPlan(new_fft_size, m_filteredBuffer.data(), m_spectrum);
+	m_fftPlanStereo = realFFTPlan(new_fft_size, m_filteredBuffer.data(), m_spectrum, 2);
+
+	if (m_fftPlanMono == NULL || m_fftPlanStereo == NULL)
 	{
 		#ifdef SA_DEBUG
 			std::cerr << "Analyzer: failed to create new FFT plan!" << std::endl;
@@ -424,18 +414,14 @@ void SaProcessor::reallocateBuffers()
 	m_normSpectrumL.resize(new_bins, 0);
 	m_normSpectrumR.resize(new_bins, 0);
 
-	m_waterfallHeight = m_controls->m_waterfallHeightModel.value();
-	m_history_work.resize((new_bins < m_waterfallMaxWidth ? new_bins : m_waterfallMaxWidth)
-							* m_waterfallHeight
-							* sizeof qRgb(0,0,0), 0);
-	m_history.resize((new_bins < m_waterfallMaxWidth ? new_bins : m_waterfallMaxWidth)
-						* m_waterfallHeight
-						* sizeof qRgb(0,0,0), 0);
-
 	// done; publish new sizes and clean up
 	m_inBlockSize = new_in_size;
 	m_fftBlockSize = new_fft_size;
 
+	// history width depends on the new bin count
+	m_waterfallHeight = m_controls->m_waterfallHeightModel.value();
+	resizeHistory();
+
 	data_lock.unlock();
 	reloc_lock.unlock();
 	m_reallocating = false;
@@ -465,22 +451,48 @@ void SaProcessor::clear()
 	m_framesFilledUp = m_inBlockSize - m_inBlockSize / overlaps;
 	std::fill(m_bufferL.begin(), m_bufferL.end(), 0);
 	std::fill(m_bufferR.begin(), m_bufferR.end(), 0);
-	std::fill(m_filteredBufferL.begin(), m_filteredBufferL.end(), 0);
-	std::fill(m_filteredBufferR.begin(), m_filteredBufferR.end(), 0);
+	std::fill(m_filteredBuffer.begin(), m_filteredBuffer.end(), 0);
 	std::fill(m_absSpectrumL.begin(), m_absSpectrumL.end(), 0);
 	std::fill(m_absSpectrumR.begin(), m_absSpectrumR.end(), 0);
 	std::fill(m_normSpectrumL.begin(), m_normSpectrumL.end(), 0);
 	std::fill(m_normSpectrumR.begin(), m_normSpectrumR.end(), 0);
-	std::fill(m_history_work.begin(), m_history_work.end(), 0);
 	std::fill(m_history.begin(), m_history.end(), 0);
 }
 
-// Clear only history work buffer. Used to flush old data when waterfall
+// Clear only history buffer. Used to flush old data when waterfall
 // is shown after a period of inactivity.
 void SaProcessor::clearHistory()
 {
 	QMutexLocker lock(&m_dataAccess);
-	std::fill(m_history_work.begin(), m_history_work.end(), 0);
+	std::fill(m_history.begin(), m_history.end(), 0);
+}
+
+
+// Set width of the history to the width of the waterfall display, so that
+// lines are rendered only for pixels actually shown and need no horizontal
+// scaling. Existing history is dropped when the width changes.
+void SaProcessor::setWaterfallWidth(unsigned int width)
+{
+	if (width == m_waterfallWidth) {return;}
+
+	// same locking as in reallocateBuffers()
+	m_reallocating = true;
+	QMutexLocker reloc_lock(&m_reallocationAccess);
+	QMutexLocker data_lock(&m_dataAccess);
+	m_waterfallWidth = width;
+	resizeHistory();
+	data_lock.unlock();
+	reloc_lock.unlock();
+	m_reallocating = false;
+}
+
+
+// Allocate an empty history for the current width and height.
+// The calling function is responsible for acquiring both locks!
+void SaProcessor::resizeHistory()
+{
+	m_history.assign(waterfallWidth() * m_waterfallHeight * sizeof qRgb(0,0,0), 0);
+	m_historyPos = 0;
 }
 
 // Check if result buffers contain any non-zero values
@@ -518,13 +530,14 @@ unsigned int SaProcessor::binCount() const
 
 
 // Return the final width of waterfall display buffer.
-// Normally the waterfall width equals the number of frequency bins, but the
-// FFT transform can easily produce more bins than can be reasonably useful for
-// currently used display resolutions. This function limits width of the final
-// image to a given size, which is then used during waterfall render and display.
+// Normally the waterfall width equals the width of the display in device
+// pixels, as reported by SaWaterfallView. Until then, the number of frequency
+// bins is used. Either way the width of the final image is limited to a given
+// size, which is then used during waterfall render and display.
 unsigned int SaProcessor::waterfallWidth() const
 {
-	return binCount() < m_waterfallMaxWidth ? binCount() : m_waterfallMaxWidth;
+	const unsigned int width = m_waterfallWidth ? m_waterfallWidth.load() : binCount();
+	return width < m_waterfallMaxWidth ? width : m_waterfallMaxWidth;
 }
 
 
@@ -52,7 +52,8 @@ public:
 	// inform processor if any processing is actually required
 	void setSpectrumActive(bool active);
 	void setWaterfallActive(bool active);
-	void flipRequest() {m_flipRequest = true;}	// request refresh of history buffer
+	bool isActive() const {return m_spectrumActive || m_waterfallActive;}
+	void setWaterfallWidth(unsigned int width);	//!< match history width to display (device pixels)
 
 	// configuration is taken from models in SaControls; some changes require
 	// an exlicit update request (reallocation and window rebuild)
@@ -64,13 +65,14 @@ public:
 	const float *getSpectrumL() const {return m_normSpectrumL.data();}
 	const float *getSpectrumR() const {return m_normSpectrumR.data();}
 	const uchar *getHistory() const {return m_history.data();}
+	unsigned int historyPos() const {return m_historyPos;}	//!< history line with the newest result
 
 	// information about results and unit conversion helpers
 	unsigned int inBlockSize() const {return m_inBlockSize;}
 	unsigned int binCount() const;			//!< size of output (frequency domain) data block
 	bool spectrumNotEmpty();				//!< check if result buffers contain any non-zero values
 
-	unsigned int waterfallWidth() const;	//!< binCount value capped at 3840 (for display)
+	unsigned int waterfallWidth() const;	//!< display width (or binCount) capped at 3840
 	unsigned int waterfallHeight() const {return m_waterfallHeight;}
 	bool waterfallNotEmpty() const {return m_waterfallNotEmpty;}
 
@@ -121,31 +123,33 @@ private:
 	std::vector<float> m_bufferL;			//!< time domain samples (left)
 	std::vector<float> m_bufferR;			//!< time domain samples (right)
 	std::vector<float> m_fftWindow;			//!< precomputed window function coefficients
-	std::vector<float> m_filteredBufferL;	//!< time domain samples with window function applied (left)
-	std::vector<float> m_filteredBufferR;	//!< time domain samples with window function applied (right)
-	fftwf_plan m_fftPlanL;
-	fftwf_plan m_fftPlanR;
-	fftwf_complex *m_spectrumL;				//!< frequency domain samples (complex) (left)
-	fftwf_complex *m_spectrumR;				//!< frequency domain samples (complex) (right)
+	std::vector<float> m_filteredBuffer;	//!< time domain samples with window function applied (left, then right)
+	fftwf_plan m_fftPlanMono;				//!< shared plan for the left channel only
+	fftwf_plan m_fftPlanStereo;				//!< shared plan for both channels at once
+	fftwf_complex *m_spectrum;				//!< frequency domain samples (complex) (left, then right)
 	std::vector<float> m_absSpectrumL;		//!< frequency domain samples (absolute) (left)
 	std::vector<float> m_absSpectrumR;		//!< frequency domain samples (absolute) (right)
 	std::vector<float> m_normSpectrumL;		//!< frequency domain samples (normalized) (left)
 	std::vector<float> m_normSpectrumR;     //!< frequency domain samples (normalized) (right)
 
-	// spectrum history for waterfall: new normSpectrum lines are added on top
-	std::vector<uchar> m_history_work;		//!< local history buffer for render
-	std::vector<uchar> m_history;			//!< public buffer for reading
-	bool m_flipRequest;						//!< update public buffer only when requested
+	// spectrum history for waterfall: a ring of lines, each new normSpectrum
+	// line replaces the oldest one and older lines follow below the newest
+	std::vector<uchar> m_history;			//!< ring buffer of history lines
+	std::atomic<unsigned int> m_historyPos;	//!< line holding the newest result
 	std::atomic<unsigned int> m_waterfallHeight;	//!< number of stored lines in history buffer
 											// Note: high values may make it harder to see transients.
+	std::atomic<unsigned int> m_waterfallWidth;	//!< requested display width, 0 if unknown
 	const unsigned int m_waterfallMaxWidth = 3840;
 
 	// book keeping
-	bool m_spectrumActive;
-	bool m_waterfallActive;
+	std::atomic<bool> m_spectrumActive;
+	std::atomic<bool> m_waterfallActive;
 	std::atomic<unsigned int> m_waterfallNotEmpty;	//!< number of lines remaining visible on display
 	bool m_reallocating;
 
+	// reallocate and clear the history for the current width and height
+	void resizeHistory();
+
 	// merge L and R channels and apply gamma correction to make a spectrogram pixel
 	QRgb makePixel(float left, float right) const;
 
@@ -348,7 +348,10 @@ QPainterPath SaSpectrumView::makePath(std::vector<float> &displayBuffer, float r
 	// Bins falling to interval [x_start, x_next) contribute to a single point.
 	float max = m_displayBottom;
 	float x_start = -1;		// lower bound of currently constructed point
-	for (unsigned int n = 0; n < m_processor->binCount(); n++)
+	// skip bins below the displayed range, starting just below it
+	unsigned int first = m_processor->getFreqRangeMin() / m_processor->getNyquistFreq() * m_processor->binCount();
+	if (first > 0) {first--;}
+	for (unsigned int n = first; n < m_processor->binCount(); n++)
 	{
 		float x = freqToXPixel(binToFreq(n), m_displayWidth);
 		float x_next = freqToXPixel(binToFreq(n + 1), m_displayWidth);
@@ -782,7 +785,7 @@ void SaSpectrumView::periodicUpdate()
 	// check if the widget is visible; if it is not, processing can be paused
 	m_processor->setSpectrumActive(isVisible());
 	// tell Qt it is time for repaint
-	update();
+	if (isVisible()) {update();}
 }
 
 
@@ -135,22 +135,36 @@ void SaWaterfallView::paintEvent(QPaintEvent *event)
 		}
 	}
 
+	// keep history resolution in sync with the display
+	m_processor->setWaterfallWidth(m_displayWidth * devicePixelRatio());
+
 	// draw the spectrogram precomputed in SaProcessor
 	if (m_processor->waterfallNotEmpty())
 	{
+		// The history is a ring of lines that is drawn in two parts: from the
+		// newest line to the end of the buffer, then the rest from its start.
+		// Its width already matches the display, only lines are scaled.
+		// A line written meanwhile may be drawn part old, part new; at display
+		// frame rate the difference is invisible.
 		QMutexLocker lock(&m_processor->m_reallocationAccess);
-		QImage temp = QImage(m_processor->getHistory(),			// raw pixel data to display
-							 m_processor->waterfallWidth(),		// width = number of frequency bins
-							 m_processor->waterfallHeight(),	// height = number of history lines
-							 QImage::Format_RGB32);
-		lock.unlock();
-		temp.setDevicePixelRatio(devicePixelRatio());			// display at native resolution
-		painter.drawImage(m_displayLeft, m_displayTop,
-						  temp.scaled(m_displayWidth * devicePixelRatio(),
-									  m_displayHeight * devicePixelRatio(),
-									  Qt::IgnoreAspectRatio,
-									  Qt::SmoothTransformation));
-		m_processor->flipRequest();
+		const unsigned int lines = m_processor->waterfallHeight();
+		const unsigned int newest = m_processor->historyPos();
+		QImage history = QImage(m_processor->getHistory(),			// raw pixel data to display
+								m_processor->waterfallWidth(),		// width = display width
+								lines,								// height = number of history lines
+								QImage::Format_RGB32);
+		const float pixels_per_line = (float)m_displayHeight / lines;
+		const float split = m_displayTop + (lines - newest) * pixels_per_line;
+		painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+		painter.drawImage(QRectF(m_displayLeft, m_displayTop, m_displayWidth, split - m_displayTop),
+						  history,
+						  QRectF(0, newest, history.width(), lines - newest));
+		if (newest > 0)
+		{
+			painter.drawImage(QRectF(m_displayLeft, split, m_displayWidth, m_displayBottom - split),
+							  history,
+							  QRectF(0, 0, history.width(), newest));
+		}
 	}
 	else
 	{
@@ -37,7 +37,8 @@ VecControls::VecControls(Vectorscope *effect) :
 	// initialize models and set default values
 	m_persistenceModel(0.5f, 0.0f, 1.0f, 0.05f, this, tr("Display persistence amount")),
 	m_logarithmicModel(false, this, tr("Logarithmic scale")),
-	m_highQualityModel(false, this, tr("High quality"))
+	m_highQualityModel(false, this, tr("High quality")),
+	m_pointBudgetModel(20000.0f, 1000.0f, 100000.0f, 1000.0f, this, tr("Points per frame"))
 {
 	// Colors (percentages include sRGB gamma correction)
 	m_colorFG = QColor(60, 255, 130, 255);		// ~LMMS green
@@ -59,6 +60,7 @@ void VecControls::loadSettings(const QDomElement &element)
 	m_persistenceModel.loadSettings(element, "Persistence");
 	m_logarithmicModel.loadSettings(element, "Logarithmic");
 	m_highQualityModel.loadSettings(element, "HighQuality");
+	m_pointBudgetModel.loadSettings(element, "PointBudget");
 }
 
 
@@ -67,4 +69,5 @@ void VecControls::saveSettings(QDomDocument &document, QDomElement &element)
 	m_persistenceModel.saveSettings(document, element, "Persistence");
 	m_logarithmicModel.saveSettings(document, element, "Logarithmic");
 	m_highQualityModel.saveSettings(document, element, "HighQuality");
+	m_pointBudgetModel.saveSettings(document, element, "PointBudget");
 }
@@ -46,7 +46,7 @@ public:
 	void loadSettings (const QDomElement &element) override;
 
 	QString nodeName() const override {return "Vectorscope";}
-	int controlCount() override {return 3;}
+	int controlCount() override {return 4;}
 
 private:
 	Vectorscope *m_effect;
@@ -54,6 +54,7 @@ private:
 	FloatModel m_persistenceModel;
 	BoolModel m_logarithmicModel;
 	BoolModel m_highQualityModel;
+	FloatModel m_pointBudgetModel;
 
 	QColor m_colorFG;
 	QColor m_colorGrid;
@@ -84,6 +84,14 @@ VecControlsDialog::VecControlsDialog(VecControls *controls) :
 	persistenceKnob->setToolTip(tr("Trace persistence: higher amount means the trace will stay bright for longer time."));
 	persistenceKnob->setHintText(tr("Trace persistence"), "");
 	config_layout->addWidget(persistenceKnob);
+
+	// Point budget knob
+	Knob *pointBudgetKnob = new Knob(knobSmall_17, this);
+	pointBudgetKnob->setModel(&controls->m_pointBudgetModel);
+	pointBudgetKnob->setLabel(tr("Points"));
+	pointBudgetKnob->setToolTip(tr("Maximum number of samples drawn per display refresh. Lower values save CPU at high sample rates."));
+	pointBudgetKnob->setHintText(tr("Draw at most"), tr(" points"));
+	config_layout->addWidget(pointBudgetKnob);
 }
 
 
@@ -51,6 +51,7 @@ VectorView::VectorView(VecControls *controls, LocklessRingBuffer<sampleFrame> *i
 
 	connect(gui->mainWindow(), SIGNAL(periodicUpdate()), this, SLOT(periodicUpdate()));
 
+	m_accumulator.resize(m_displaySize * m_displaySize, 0.f);
 	m_displayBuffer.resize(sizeof qRgb(0,0,0) * m_displaySize * m_displaySize, 0);
 
 #ifdef VEC_DEBUG
@@ -91,15 +92,15 @@ void VectorView::paintEvent(QPaintEvent *event)
 	const int labelHeight = 26;
 
 	bool hq = m_controls->m_highQualityModel.value();
+	const unsigned short activeSize = hq ? m_displaySize : m_displaySize / 2;
+	// Non-HQ mode uses half the resolution → use limited buffer space.
+	const std::size_t useableBuffer = activeSize * activeSize;
 
-	// Clear display buffer if quality setting was changed
+	// Clear accumulation buffer if quality setting was changed
 	if (hq != m_oldHQ)
 	{
 		m_oldHQ = hq;
-		for (std::size_t i = 0; i < m_displayBuffer.size(); i++)
-		{
-			m_displayBuffer.data()[i] = 0;
-		}
+		std::fill(m_accumulator.begin(), m_accumulator.end(), 0.f);
 	}
 
 	// Dim stored image based on persistence setting and elapsed time.
@@ -113,8 +114,6 @@ void VectorView::paintEvent(QPaintEvent *event)
 	if (elapsed > threshold)
 	{
 		m_persistTimestamp = currentTimestamp;
-		// Non-HQ mode uses half the resolution → use limited buffer space.
-		const std::size_t useableBuffer = hq ? m_displayBuffer.size() : m_displayBuffer.size() / 4;
 		// The knob value is interpreted on log. scale, otherwise the effect would ramp up too slowly.
 		// Persistence value specifies fraction of light intensity that remains after 10 ms.
 		// → Compensate it based on elapsed time (exponential decay).
@@ -125,7 +124,7 @@ void VectorView::paintEvent(QPaintEvent *event)
 		// occurs in high-intensity traces in HQ mode.
 		for (std::size_t i = 0; i < useableBuffer; i++)
 		{
-			m_displayBuffer.data()[i] *= persistPerFrame;
+			m_accumulator[i] *= persistPerFrame;
 		}
 	}
 
@@ -133,80 +132,80 @@ void VectorView::paintEvent(QPaintEvent *event)
 	auto inBuffer = m_bufferReader.read_max(m_inputBuffer->capacity());
 	std::size_t frameCount = inBuffer.size();
 
+	// Keep the cost of drawing independent of sample rate: if there are more new samples
+	// than the point budget allows, draw only every n-th one and make it n times brighter,
+	// so that the trace keeps its overall brightness.
+	const std::size_t budget = std::max((int)m_controls->m_pointBudgetModel.value(), 1);
+	const std::size_t stride = std::max<std::size_t>((frameCount + budget - 1) / budget, 1);
+	const float strideWeight = stride;
+
 	// Draw new points on top
-	float left, right;
 	int x, y;
 
 	const bool logScale = m_controls->m_logarithmicModel.value();
-	const unsigned short activeSize = hq ? m_displaySize : m_displaySize / 2;
 
 	// Helper lambda functions for better readability
 	// Make sure pixel stays within display bounds:
 	auto saturate = [=](short pixelPos) {return qBound((short)0, pixelPos, (short)(activeSize - 1));};
-	// Take existing pixel and brigthen it. Very bright light should reduce saturation and become
-	// white. This effect is easily approximated by capping elementary colors to 255 individually.
-	auto updatePixel = [&](unsigned short x, unsigned short y, QColor addedColor)
+	// Scale left and right channel from (-1.0, 1.0) to display range, then rotate display
+	// coordinates 45 degrees and flip Y axis (bounds are checked by the caller)
+	auto toDisplay = [&](const sampleFrame &frame, float &outX, float &outY)
 	{
-		QColor currentColor = ((QRgb*)m_displayBuffer.data())[x + y * activeSize];
-		currentColor.setRed(std::min(currentColor.red() + addedColor.red(), 255));
-		currentColor.setGreen(std::min(currentColor.green() + addedColor.green(), 255));
-		currentColor.setBlue(std::min(currentColor.blue() + addedColor.blue(), 255));
-		((QRgb*)m_displayBuffer.data())[x + y * activeSize] = currentColor.rgb();
+		const float inLeft = frame[0] * m_zoom;
+		const float inRight = frame[1] * m_zoom;
+		float left, right;
+		if (logScale)
+		{
+			// To better preserve shapes, the log scale is applied to the distance from origin,
+			// not the individual channels.
+			const float distance = sqrt(inLeft * inLeft + inRight * inRight);
+			const float distanceLog = log10(1 + 9 * abs(distance));
+			const float angleCos = inLeft / distance;
+			const float angleSin = inRight / distance;
+			left  = distanceLog * angleCos * (activeSize - 1) / 4;
+			right = distanceLog * angleSin * (activeSize - 1) / 4;
+		}
+		else
+		{
+			left  = inLeft * (activeSize - 1) / 4;
+			right = inRight * (activeSize - 1) / 4;
+		}
+		outX = right - left + activeSize / 2.f;
+		outY = activeSize - (right + left + activeSize / 2.f);
 	};
 
+	float newX, newY;
 	if (hq)
 	{
 		// High quality mode: check distance between points and draw a line.
 		// The longer the line is, the dimmer, simulating real electron trace on luminescent screen.
-		for (std::size_t frame = 0; frame < frameCount; frame++)
+		for (std::size_t frame = 0; frame < frameCount; frame += stride)
 		{
-			float inLeft = inBuffer[frame][0] * m_zoom;
-			float inRight = inBuffer[frame][1] * m_zoom;
-			// Scale left and right channel from (-1.0, 1.0) to display range
-			if (logScale)
-			{
-				// To better preserve shapes, the log scale is applied to the distance from origin,
-				// not the individual channels.
-				const float distance = sqrt(inLeft * inLeft + inRight * inRight);
-				const float distanceLog = log10(1 + 9 * abs(distance));
-				const float angleCos = inLeft / distance;
-				const float angleSin = inRight / distance;
-				left  = distanceLog * angleCos * (activeSize - 1) / 4;
-				right = distanceLog * angleSin * (activeSize - 1) / 4;
-			}
-			else
-			{
-				left  = inLeft * (activeSize - 1) / 4;
-				right = inRight * (activeSize - 1) / 4;
-			}
-
-			// Rotate display coordinates 45 degrees, flip Y axis and make sure the result stays within bounds
-			x = saturate(right - left + activeSize / 2.f);
-			y = saturate(activeSize - (right + left + activeSize / 2.f));
+			toDisplay(inBuffer[frame], newX, newY);
+			x = saturate(newX);
+			y = saturate(newY);
 
 			// Estimate number of points needed to fill space between the old and new pixel. Cap at 100.
 			unsigned char points = std::min((int)sqrt((m_oldX - x) * (m_oldX - x) + (m_oldY - y) * (m_oldY - y)), 100);
 
-			// Large distance = dim trace. The curve for darker() is choosen so that:
+			// Large distance = dim trace. The curve is choosen so that:
 			// - no movement (0 points) actually _increases_ brightness slightly,
-			// - one point between samples = returns exactly the specified color,
+			// - one point between samples = adds exactly the specified color,
 			// - one to 99 points between samples = follows a sharp "1/x" decaying curve,
-			// - 100 points between samples = returns approximately 5 % brightness.
+			// - 100 points between samples = adds approximately 5 % brightness.
 			// Everything else is discarded (by the 100 point cap) because there is not much to see anyway.
-			QColor addedColor = m_controls->m_colorFG.darker(75 + 20 * points).rgb();
+			const float added = strideWeight * 100.f / (75 + 20 * points);
 
 			// Draw the new pixel: the beam sweeps across area that may have been excited before
 			// → add new value to existing pixel state.
-			updatePixel(x, y, addedColor);
+			m_accumulator[x + y * activeSize] += added;
 
 			// Draw interpolated points between the old pixel and the new one
-			int newX = right - left + activeSize / 2.f;
-			int newY = activeSize - (right + left + activeSize / 2.f);
 			for (unsigned char i = 1; i < points; i++)
 			{
-				x = saturate(((points - i) * m_oldX + i * newX) / points);
-				y = saturate(((points - i) * m_oldY + i * newY) / points);
-				updatePixel(x, y, addedColor);
+				x = saturate(((points - i) * m_oldX + i * (int)newX) / points);
+				y = saturate(((points - i) * m_oldY + i * (int)newY) / points);
+				m_accumulator[x + y * activeSize] += added;
 			}
 			m_oldX = newX;
 			m_oldY = newY;
@@ -216,39 +215,37 @@ void VectorView::paintEvent(QPaintEvent *event)
 	{
 		// To improve performance, non-HQ mode uses smaller display size and only
 		// one full-color pixel per sample.
-		for (std::size_t frame = 0; frame < frameCount; frame++)
+		for (std::size_t frame = 0; frame < frameCount; frame += stride)
 		{
-			float inLeft = inBuffer[frame][0] * m_zoom;
-			float inRight = inBuffer[frame][1] * m_zoom;
-			if (logScale) {
-				const float distance = sqrt(inLeft * inLeft + inRight * inRight);
-				const float distanceLog = log10(1 + 9 * abs(distance));
-				const float angleCos = inLeft / distance;
-				const float angleSin = inRight / distance;
-				left  = distanceLog * angleCos * (activeSize - 1) / 4;
-				right = distanceLog * angleSin * (activeSize - 1) / 4;
-			} else {
-				left  = inLeft * (activeSize - 1) / 4;
-				right = inRight * (activeSize - 1) / 4;
-			}
-			x = saturate(right - left + activeSize / 2.f);
-			y = saturate(activeSize - (right + left + activeSize / 2.f));
-			((QRgb*)m_displayBuffer.data())[x + y * activeSize] = m_controls->m_colorFG.rgb();
+			toDisplay(inBuffer[frame], newX, newY);
+			m_accumulator[saturate(newX) + saturate(newY) * activeSize] = 1.f;
 		}
 	}
 
+	// Map intensity to color. Very bright light should reduce saturation and become white.
+	// This effect is easily approximated by capping elementary colors to 255 individually.
+	const float red = m_controls->m_colorFG.red();
+	const float green = m_controls->m_colorFG.green();
+	const float blue = m_controls->m_colorFG.blue();
+	QRgb *pixels = (QRgb*)m_displayBuffer.data();
+	for (std::size_t i = 0; i < useableBuffer; i++)
+	{
+		const float intensity = m_accumulator[i];
+		pixels[i] = qRgb(std::min(red * intensity, 255.f),
+						 std::min(green * intensity, 255.f),
+						 std::min(blue * intensity, 255.f));
+	}
+
 	// Draw background
 	painter.fillRect(displayLeft, displayTop, displayWidth, displayHeight, QColor(0,0,0));
 
-	// Draw the final image
+	// Draw the final image, scaled by the painter
 	QImage temp = QImage(m_displayBuffer.data(),
 						 activeSize,
 						 activeSize,
 						 QImage::Format_RGB32);
-	temp.setDevicePixelRatio(devicePixelRatio());
-	painter.drawImage(displayLeft, displayTop,
-					  temp.scaledToWidth(displayWidth * devicePixelRatio(),
-					  Qt::SmoothTransformation));
+	painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+	painter.drawImage(QRectF(displayLeft, displayTop, displayWidth, displayWidth), temp);
 
 	// Draw the grid and labels
 	painter.setPen(QPen(m_controls->m_colorGrid, 1.5, Qt::SolidLine, Qt::RoundCap, Qt::BevelJoin));
@@ -59,7 +59,8 @@ private:
 	LocklessRingBuffer<sampleFrame> *m_inputBuffer;
 	LocklessRingBufferReader<sampleFrame> m_bufferReader;
 
-	std::vector<uchar> m_displayBuffer;
+	std::vector<float> m_accumulator;	// beam intensity per pixel, 1.0 = foreground color
+	std::vector<uchar> m_displayBuffer;	// accumulator mapped to pixels
 	const unsigned short m_displaySize;
 
 	bool m_visible;
@@ -49,6 +49,11 @@ public:
 		return &m_vstControls;
 	}
 
+	virtual f_cnt_t latencyFrames() const
+	{
+		return m_latency;
+	}
+
 	virtual inline QString publicName() const
 	{
 		return m_plugin->name();
@@ -61,6 +66,8 @@ private:
 
 	QSharedPointer<VstPlugin> m_plugin;
 	QMutex m_pluginMutex;
+	// of the plugin, taken while processing as it's guarded by the mutex
+	f_cnt_t m_latency;
 	EffectKey m_key;
 
 	VstEffectControls m_vstControls;
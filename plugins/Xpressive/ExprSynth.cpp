@@ -33,9 +33,12 @@
 
 #include "Xpressive.h"
 
+#include "Engine.h"
+#include "InstrumentTrack.h"
 #include "interpolation.h"
 #include "lmms_math.h"
 #include "NotePlayHandle.h"
+#include "Song.h"
 
 
 #include "exprtk.hpp"
@@ -689,29 +692,42 @@ void ExprFront::setIntegrate(const unsigned int* const frameCounter, const unsig
 }
 
 ExprSynth::ExprSynth(const WaveSample *gW1, const WaveSample *gW2, const WaveSample *gW3,
-	ExprFront *exprO1, ExprFront *exprO2,
-	NotePlayHandle *nph, const sample_rate_t sample_rate,
-	const FloatModel* pan1, const FloatModel* pan2, float rel_trans):
-	m_exprO1(exprO1),
-	m_exprO2(exprO2),
+	const char* exprO1, const char* exprO2, float* A1, float* A2, float* A3,
+	const sample_rate_t sample_rate, const FloatModel* pan1, const FloatModel* pan2):
+	m_exprO1(new ExprFront(exprO1, sample_rate)),//give the "last" function a whole second
+	m_exprO2(new ExprFront(exprO2, sample_rate)),
 	m_W1(gW1),
 	m_W2(gW2),
 	m_W3(gW3),
-	m_nph(nph),
+	m_nph(NULL),
 	m_sample_rate(sample_rate),
 	m_pan1(pan1),
 	m_pan2(pan2),
-	m_rel_transition(rel_trans)
+	m_rel_transition(0)
 {
 	m_note_sample = 0;
 	m_note_rel_sample = 0;
 	m_note_rel_sec = 0;
 	m_note_sample_sec = 0;
 	m_released = 0;
-	m_frequency = m_nph->frequency();
-	m_rel_inc = 1000.0 / (m_sample_rate * m_rel_transition);//rel_transition in ms. compute how much increment in each frame
-
-	auto init_expression_step2 = [this](ExprFront * e) {
+	m_frequency = 0;
+	m_key = 0;
+	m_bnote = 0;
+	m_volume = 0;
+	m_tempo = 0;
+	m_rel_inc = 0;
+
+	auto init_expression = [this, A1, A2, A3](ExprFront * e) {
+		//add the constants and the variables to the expression.
+		//note dependent values are variables, so the expression can be compiled before the note starts.
+		e->add_variable("key", m_key);//the key that was pressed.
+		e->add_variable("bnote", m_bnote); // the base note
+		e->add_constant("srate", m_sample_rate);// sample rate of the mixer
+		e->add_variable("v", m_volume); //volume of the note.
+		e->add_variable("tempo", m_tempo);//tempo of the song.
+		e->add_variable("A1", *A1);//A1,A2,A3: general purpose input controls.
+		e->add_variable("A2", *A2);
+		e->add_variable("A3", *A3);
 		e->add_cyclic_vector("W1", m_W1->m_samples,m_W1->m_length, m_W1->m_interpolate);
 		e->add_cyclic_vector("W2", m_W2->m_samples,m_W2->m_length, m_W2->m_interpolate);
 		e->add_cyclic_vector("W3", m_W3->m_samples,m_W3->m_length, m_W3->m_interpolate);
@@ -722,9 +738,21 @@ ExprSynth::ExprSynth(const WaveSample *gW1, const WaveSample *gW2, const WaveSam
 		e->setIntegrate(&m_note_sample,m_sample_rate);
 		e->compile();
 	};
-	init_expression_step2(m_exprO1);
-	init_expression_step2(m_exprO2);
+	init_expression(m_exprO1);
+	init_expression(m_exprO2);
+
+}
 
+void ExprSynth::startNote(NotePlayHandle* nph, float rel_trans)
+{
+	m_nph = nph;
+	m_key = nph->key();
+	m_bnote = nph->instrumentTrack()->baseNote();
+	m_volume = nph->getVolume() / 255.0;
+	m_tempo = Engine::getSong()->getTempo();
+	m_frequency = nph->frequency();
+	m_rel_transition = rel_trans;
+	m_rel_inc = 1000.0 / (m_sample_rate * m_rel_transition);//rel_transition in ms. compute how much increment in each frame
 }
 
 ExprSynth::~ExprSynth()
@@ -92,12 +92,17 @@ class ExprSynth
 {
 	MM_OPERATORS
 public:
-	ExprSynth(const WaveSample* gW1, const WaveSample* gW2, const WaveSample* gW3, ExprFront* exprO1, ExprFront* exprO2, NotePlayHandle* nph,
-			const sample_rate_t sample_rate, const FloatModel* pan1, const FloatModel* pan2, float rel_trans);
+	// compiles both expressions - this is slow, so voices are usually prepared
+	// ahead of time and only bound to their note by startNote()
+	ExprSynth(const WaveSample* gW1, const WaveSample* gW2, const WaveSample* gW3, const char* exprO1, const char* exprO2,
+			float* A1, float* A2, float* A3, const sample_rate_t sample_rate, const FloatModel* pan1, const FloatModel* pan2);
 	virtual ~ExprSynth();
 
+	void startNote(NotePlayHandle* nph, float rel_trans);
 	void renderOutput(fpp_t frames, sampleFrame* buf );
 
+	inline sample_rate_t sampleRate() const { return m_sample_rate; }
+
 
 private:
 	ExprFront *m_exprO1, *m_exprO2;
@@ -108,6 +113,10 @@ private:
 	float m_note_rel_sec;
 	float m_frequency;
 	float m_released;
+	float m_key;
+	float m_bnote;
+	float m_volume;
+	float m_tempo;
 	NotePlayHandle* m_nph;
 	const sample_rate_t m_sample_rate;
 	const FloatModel *m_pan1,*m_pan2;
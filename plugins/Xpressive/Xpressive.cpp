@@ -103,13 +103,32 @@ Xpressive::Xpressive(InstrumentTrack* instrument_track) :
 	m_W1(GRAPH_LENGTH),
 	m_W2(GRAPH_LENGTH),
 	m_W3(GRAPH_LENGTH),
-	m_exprValid(false, this)
+	m_exprValid(false, this),
+	m_voiceGeneration(0),
+	m_stopCompiler(false),
+	m_voiceCompiler(this)
 {
 	m_outputExpression[0]="sinew(integrate(f*(1+0.05sinew(12t))))*(2^(-(1.1+A2)*t)*(0.4+0.1(1+A3)+0.4sinew((2.5+2A1)t))^2)";
 	m_outputExpression[1]="expw(integrate(f*atan(500t)*2/pi))*0.5+0.12";
+
+	connect(&m_interpolateW1, SIGNAL(dataChanged()), this, SLOT(expressionsChanged()));
+	connect(&m_interpolateW2, SIGNAL(dataChanged()), this, SLOT(expressionsChanged()));
+	connect(&m_interpolateW3, SIGNAL(dataChanged()), this, SLOT(expressionsChanged()));
+
+	m_W1.setInterpolate(false);
+	m_W2.setInterpolate(false);
+	m_W3.setInterpolate(false);
+	m_voiceCompiler.start(QThread::LowPriority);
 }
 
 Xpressive::~Xpressive() {
+	m_voicePoolMutex.lock();
+	m_stopCompiler = true;
+	m_voicePoolCondition.wakeOne();
+	m_voicePoolMutex.unlock();
+	m_voiceCompiler.wait();
+
+	qDeleteAll(m_voicePool);
 }
 
 void Xpressive::saveSettings(QDomDocument & _doc, QDomElement & _this) {
@@ -150,8 +169,10 @@ void Xpressive::saveSettings(QDomDocument & _doc, QDomElement & _this) {
 
 void Xpressive::loadSettings(const QDomElement & _this) {
 
+	m_voicePoolMutex.lock();
 	m_outputExpression[0]=_this.attribute( "O1").toLatin1();
 	m_outputExpression[1]=_this.attribute( "O2").toLatin1();
+	m_voicePoolMutex.unlock();
 	m_wavesExpression[0]=_this.attribute( "W1").toLatin1();
 	m_wavesExpression[1]=_this.attribute( "W2").toLatin1();
 	m_wavesExpression[2]=_this.attribute( "W3").toLatin1();
@@ -190,6 +211,8 @@ void Xpressive::loadSettings(const QDomElement & _this) {
 	m_W1.copyFrom(&m_graphW1);
 	m_W2.copyFrom(&m_graphW2);
 	m_W3.copyFrom(&m_graphW3);
+
+	expressionsChanged();
 }
 
 
@@ -203,29 +226,14 @@ void Xpressive::playNote(NotePlayHandle* nph, sampleFrame* working_buffer) {
 	m_A3=m_parameterA3.value();
 
 	if (nph->totalFramesPlayed() == 0 || nph->m_pluginData == NULL) {
-
-		ExprFront *exprO1 = new ExprFront(m_outputExpression[0].constData(),Engine::mixer()->processingSampleRate());//give the "last" function a whole second
-		ExprFront *exprO2 = new ExprFront(m_outputExpression[1].constData(),Engine::mixer()->processingSampleRate());
-
-		auto init_expression_step1 = [this, nph](ExprFront* e) { //lambda function to init exprO1 and exprO2
-			//add the constants and the variables to the expression.
-			e->add_constant("key", nph->key());//the key that was pressed.
-			e->add_constant("bnote", nph->instrumentTrack()->baseNote()); // the base note
-			e->add_constant("srate", Engine::mixer()->processingSampleRate());// sample rate of the mixer
-			e->add_constant("v", nph->getVolume() / 255.0); //volume of the note.
-			e->add_constant("tempo", Engine::getSong()->getTempo());//tempo of the song.
-			e->add_variable("A1", m_A1);//A1,A2,A3: general purpose input controls.
-			e->add_variable("A2", m_A2);
-			e->add_variable("A3", m_A3);
-		};
-		init_expression_step1(exprO1);
-		init_expression_step1(exprO2);
-
-		m_W1.setInterpolate(m_interpolateW1.value());//set interpolation according to the user selection.
-		m_W2.setInterpolate(m_interpolateW2.value());
-		m_W3.setInterpolate(m_interpolateW3.value());
-		nph->m_pluginData = new ExprSynth(&m_W1, &m_W2, &m_W3, exprO1, exprO2, nph,
-				Engine::mixer()->processingSampleRate(), &m_panning1, &m_panning2, m_relTransition.value());
+		ExprSynth *voice = takeVoice();
+		if (voice == NULL)
+		{
+			// the background compiler didn't keep up - compile right here
+			voice = createVoice();
+		}
+		voice->startNote(nph, m_relTransition.value());
+		nph->m_pluginData = voice;
 	}
 
 
@@ -244,6 +252,94 @@ void Xpressive::deleteNotePluginData(NotePlayHandle* nph) {
 	delete static_cast<ExprSynth *>(nph->m_pluginData);
 }
 
+void Xpressive::setOutputExpression(int i, const QByteArray& text) {
+	m_voicePoolMutex.lock();
+	m_outputExpression[i] = text;
+	m_voicePoolMutex.unlock();
+	expressionsChanged();
+}
+
+void Xpressive::expressionsChanged() {
+	QList<ExprSynth*> outdated;
+	m_voicePoolMutex.lock();
+	m_W1.setInterpolate(m_interpolateW1.value());//set interpolation according to the user selection.
+	m_W2.setInterpolate(m_interpolateW2.value());
+	m_W3.setInterpolate(m_interpolateW3.value());
+	++m_voiceGeneration;
+	outdated.swap(m_voicePool);
+	m_voicePoolCondition.wakeOne();
+	m_voicePoolMutex.unlock();
+
+	qDeleteAll(outdated);
+}
+
+ExprSynth* Xpressive::createVoice() {
+	m_voicePoolMutex.lock();
+	const QByteArray exprO1 = m_outputExpression[0];
+	const QByteArray exprO2 = m_outputExpression[1];
+	m_voicePoolMutex.unlock();
+
+	return new ExprSynth(&m_W1, &m_W2, &m_W3, exprO1.constData(), exprO2.constData(),
+			&m_A1, &m_A2, &m_A3, Engine::mixer()->processingSampleRate(), &m_panning1, &m_panning2);
+}
+
+ExprSynth* Xpressive::takeVoice() {
+	const sample_rate_t sample_rate = Engine::mixer()->processingSampleRate();
+	ExprSynth *voice = NULL;
+	QList<ExprSynth*> outdated;
+
+	m_voicePoolMutex.lock();
+	if (!m_voicePool.isEmpty() && m_voicePool.first()->sampleRate() != sample_rate)
+	{
+		// compiled for another sample rate - start all over
+		++m_voiceGeneration;
+		outdated.swap(m_voicePool);
+	}
+	if (!m_voicePool.isEmpty())
+	{
+		voice = m_voicePool.takeFirst();
+	}
+	m_voicePoolCondition.wakeOne();
+	m_voicePoolMutex.unlock();
+
+	qDeleteAll(outdated);
+	return voice;
+}
+
+void Xpressive::compileVoices() {
+	m_voicePoolMutex.lock();
+	while (!m_stopCompiler)
+	{
+		if (m_voicePool.size() >= VOICE_POOL_SIZE)
+		{
+			m_voicePoolCondition.wait(&m_voicePoolMutex);
+			continue;
+		}
+		const int generation = m_voiceGeneration;
+		m_voicePoolMutex.unlock();
+
+		ExprSynth *voice = createVoice();
+
+		m_voicePoolMutex.lock();
+		if (generation == m_voiceGeneration)
+		{
+			m_voicePool.append(voice);
+			voice = NULL;
+		}
+		m_voicePoolMutex.unlock();
+
+		// the expressions changed while compiling
+		delete voice;
+
+		m_voicePoolMutex.lock();
+	}
+	m_voicePoolMutex.unlock();
+}
+
+void ExprVoiceCompiler::run() {
+	m_xpressive->compileVoices();
+}
+
 PluginView * Xpressive::instantiateView(QWidget* parent) {
 	return (new XpressiveView(this, parent));
 }
@@ -522,10 +618,10 @@ void XpressiveView::expressionChanged() {
 		e->wavesExpression(2) = text;
 		break;
 	case O1_EXPR:
-		e->outputExpression(0) = text;
+		e->setOutputExpression(0, text);
 		break;
 	case O2_EXPR:
-		e->outputExpression(1) = text;
+		e->setOutputExpression(1, text);
 		break;
 	}
 	if (m_wave_expr)
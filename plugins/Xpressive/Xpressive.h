@@ -26,7 +26,10 @@
 #ifndef XPRESSIVE_H
 #define XPRESSIVE_H
 
+#include <QMutex>
 #include <QPlainTextEdit>
+#include <QThread>
+#include <QWaitCondition>
 
 #include "Graph.h"
 #include "Instrument.h"
@@ -47,9 +50,31 @@ const int	O1_EXPR = 3;
 const int	O2_EXPR = 4;
 const int	NUM_EXPRS = 5;
 
+// number of voices compiled ahead of time
+const int	VOICE_POOL_SIZE = 16;
+
 
 class ExprFront;
 class SubWindow;
+class Xpressive;
+
+
+// compiles the voices of Xpressive in the background, since compiling the
+// expressions takes much longer than a period
+class ExprVoiceCompiler : public QThread
+{
+public:
+	ExprVoiceCompiler(Xpressive* xpressive) :
+		m_xpressive(xpressive)
+	{
+	}
+
+protected:
+	void run() override;
+
+private:
+	Xpressive* m_xpressive;
+} ;
 
 
 
@@ -83,7 +108,8 @@ public:
 	graphModel& rawgraphW3() { return m_rawgraphW3; }
 	IntModel& selectedGraph() { return m_selectedGraph; }
 	QByteArray& wavesExpression(int i) { return m_wavesExpression[i]; }
-	QByteArray& outputExpression(int i) { return m_outputExpression[i]; }
+	const QByteArray& outputExpression(int i) const { return m_outputExpression[i]; }
+	void setOutputExpression(int i, const QByteArray& text);
 
 	FloatModel& parameterA1() { return m_parameterA1; }
 	FloatModel& parameterA2() { return m_parameterA2; }
@@ -105,6 +131,9 @@ public:
 protected:
 	
 protected slots:
+	// drops the precompiled voices after the expressions or wave
+	// interpolation changed
+	void expressionsChanged();
 
 
 private:
@@ -135,6 +164,19 @@ private:
 	WaveSample m_W1, m_W2, m_W3;
 
 	BoolModel m_exprValid;
+
+	ExprSynth* createVoice();
+	ExprSynth* takeVoice();
+	void compileVoices();
+
+	QMutex m_voicePoolMutex;
+	QWaitCondition m_voicePoolCondition;
+	QList<ExprSynth*> m_voicePool;
+	int m_voiceGeneration;
+	bool m_stopCompiler;
+	ExprVoiceCompiler m_voiceCompiler;
+
+	friend class ExprVoiceCompiler;
 	
 } ;
 
@@ -71,6 +71,25 @@ Plugin::Descriptor PLUGIN_EXPORT audiofileprocessor_plugin_descriptor =
 
 
 
+// interpolation mode of libsamplerate for an item of the interpolation model
+static int srcMode( int _interpolation )
+{
+	switch( _interpolation )
+	{
+		case 0:
+			return SRC_ZERO_ORDER_HOLD;
+		case 2:
+			return SRC_SINC_MEDIUM_QUALITY;
+		case 3:
+			return POLYPHASE_INTERPOLATION;
+		default:
+			return SRC_LINEAR;
+	}
+}
+
+
+
+
 audioFileProcessor::audioFileProcessor( InstrumentTrack * _instrument_track ) :
 	Instrument( _instrument_track, &audiofileprocessor_plugin_descriptor ),
 	m_sampleBuffer(),
@@ -85,6 +104,9 @@ audioFileProcessor::audioFileProcessor( InstrumentTrack * _instrument_track ) :
 	m_nextPlayStartPoint( 0 ),
 	m_nextPlayBackwards( false )
 {
+	// only played and drawn, so 16 bit files can be kept as such
+	m_sampleBuffer.setCompactStorage( true );
+
 	connect( &m_reverseModel, SIGNAL( dataChanged() ),
 				this, SLOT( reverseModelChanged() ) );
 	connect( &m_ampModel, SIGNAL( dataChanged() ),
@@ -102,9 +124,16 @@ audioFileProcessor::audioFileProcessor( InstrumentTrack * _instrument_track ) :
 	m_interpolationModel.addItem( tr( "None" ) );
 	m_interpolationModel.addItem( tr( "Linear" ) );
 	m_interpolationModel.addItem( tr( "Sinc" ) );
+	m_interpolationModel.addItem( tr( "Polyphase" ) );
 	m_interpolationModel.setValue( 1 );
 	
 	pointChanged();
+
+	reserveStates();
+	connect( &m_interpolationModel, SIGNAL( dataChanged() ),
+			this, SLOT( reserveStates() ) );
+	connect( instrumentTrack()->polyphonyModel(), SIGNAL( dataChanged() ),
+			this, SLOT( reserveStates() ) );
 }
 
 
@@ -142,21 +171,19 @@ void audioFileProcessor::playNote( NotePlayHandle * _n,
 			m_nextPlayStartPoint = m_sampleBuffer.startFrame();
 			m_nextPlayBackwards = false;
 		}
-		// set interpolation mode for libsamplerate
-		int srcmode = SRC_LINEAR;
-		switch( m_interpolationModel.value() )
+		// retriggered notes reuse the state of a finished one
+		const int mode = m_interpolationModel.value();
+		handleState * state = m_statePools[mode].take();
+		if( state != NULL )
+		{
+			state->reset( _n->hasDetuningInfo() );
+		}
+		else
 		{
-			case 0:
-				srcmode = SRC_ZERO_ORDER_HOLD;
-				break;
-			case 1:
-				srcmode = SRC_LINEAR;
-				break;
-			case 2:
-				srcmode = SRC_SINC_MEDIUM_QUALITY;
-				break;
+			state = new handleState( _n->hasDetuningInfo(),
+							srcMode( mode ) );
 		}
-		_n->m_pluginData = new handleState( _n->hasDetuningInfo(), srcmode );
+		_n->m_pluginData = state;
 		((handleState *)_n->m_pluginData)->setFrameIndex( m_nextPlayStartPoint );
 		((handleState *)_n->m_pluginData)->setBackwards( m_nextPlayBackwards );
 
@@ -201,7 +228,21 @@ void audioFileProcessor::playNote( NotePlayHandle * _n,
 
 void audioFileProcessor::deleteNotePluginData( NotePlayHandle * _n )
 {
-	delete (handleState *)_n->m_pluginData;
+	handleState * state = static_cast<handleState *>( _n->m_pluginData );
+	if( state == NULL )
+	{
+		return;
+	}
+	// the mode may have changed while the note played
+	for( int i = 0; i < 4; ++i )
+	{
+		if( state->interpolationMode() == srcMode( i ) )
+		{
+			m_statePools[i].give( state );
+			return;
+		}
+	}
+	delete state;
 }
 
 
@@ -340,6 +381,19 @@ void audioFileProcessor::setAudioFile( const QString & _audio_file,
 
 
 
+void audioFileProcessor::reserveStates()
+{
+	const int mode = m_interpolationModel.value();
+	m_statePools[mode].reserve( instrumentTrack()->polyphonyModel()->value(),
+		[mode]()
+		{
+			return new handleState( false, srcMode( mode ) );
+		} );
+}
+
+
+
+
 void audioFileProcessor::reverseModelChanged( void )
 {
 	m_sampleBuffer.setReversed( m_reverseModel.value() );
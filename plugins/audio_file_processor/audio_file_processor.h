@@ -36,6 +36,7 @@
 #include "PixmapButton.h"
 #include "AutomatableButton.h"
 #include "ComboBox.h"
+#include "VoicePool.h"
 
 
 class audioFileProcessor : public Instrument
@@ -79,6 +80,7 @@ private slots:
 	void endPointChanged();
 	void pointChanged();
 	void stutterModelChanged();
+	void reserveStates();
 
 
 signals:
@@ -102,6 +104,10 @@ private:
 	f_cnt_t m_nextPlayStartPoint;
 	bool m_nextPlayBackwards;
 
+	// states of finished notes with their resamplers, per interpolation
+	// mode
+	VoicePool<handleState> m_statePools[4];
+
 	friend class AudioFileProcessorView;
 
 } ;
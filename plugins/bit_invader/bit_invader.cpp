@@ -64,14 +64,24 @@ Plugin::Descriptor PLUGIN_EXPORT bitinvader_plugin_descriptor =
 }
 
 
-bSynth::bSynth( float * _shape, NotePlayHandle * _nph, bool _interpolation,
+bSynth::bSynth( float * _shape, const UserWaveMipMapPtr & _mipMap,
+				NotePlayHandle * _nph, bool _interpolation,
 				float _factor, const sample_rate_t _sample_rate ) :
 	sample_index( 0 ),
 	sample_realindex( 0 ),
+	sample_shape( NULL ),
 	nph( _nph ),
 	sample_rate( _sample_rate ),
-	interpolation( _interpolation)
+	interpolation( _interpolation),
+	mipMap( _mipMap ),
+	factor( _factor ),
+	mipMapFrequency( -1.0f ),
+	mipMapLevel( 0 )
 {
+	if( interpolation )
+	{
+		return;
+	}
 	sample_shape = new float[200];
 	for (int i=0; i < 200; ++i)
 	{
@@ -101,19 +111,14 @@ sample_t bSynth::nextStringSample( float sample_length )
 
 	if (interpolation) {
 
-		// find position in shape 
-		int a = static_cast<int>(sample_realindex);	
-		int b;
-		if (a < (sample_length-1)) {
-			b = static_cast<int>(sample_realindex+1);
-		} else {
-			b = 0;
+		// band-limited, so high notes don't alias
+		if( nph->frequency() != mipMapFrequency )
+		{
+			mipMapFrequency = nph->frequency();
+			mipMapLevel = mipMap->level( mipMapFrequency / sample_rate );
 		}
-		
-		// Nachkommaanteil
-		const float frac = fraction( sample_realindex );
-		
-		sample = linearInterpolate( sample_shape[a], sample_shape[b], frac );
+		sample = mipMap->sample( mipMapLevel,
+				sample_realindex / sample_length ) * factor;
 
 	} else {
 		// No interpolation
@@ -154,6 +159,7 @@ bitInvader::bitInvader( InstrumentTrack * _instrument_track ) :
 	connect( &m_graph, SIGNAL( samplesChanged( int, int ) ),
 			this, SLOT( samplesChanged( int, int ) ) );
 
+	updateMipMap();
 }
 
 
@@ -223,6 +229,7 @@ void bitInvader::lengthChanged()
 	m_graph.setLength( (int) m_sampleLength.value() );
 
 	normalize();
+	updateMipMap();
 }
 
 
@@ -231,6 +238,7 @@ void bitInvader::lengthChanged()
 void bitInvader::samplesChanged( int _begin, int _end )
 {
 	normalize();
+	updateMipMap();
 	//engine::getSongEditor()->setModified();
 }
 
@@ -253,6 +261,15 @@ void bitInvader::normalize()
 
 
 
+void bitInvader::updateMipMap()
+{
+	std::atomic_store( &m_mipMap, UserWaveMipMapPtr(
+		new UserWaveMipMap( m_graph.samples(), m_graph.length() ) ) );
+}
+
+
+
+
 QString bitInvader::nodeName() const
 {
 	return( bitinvader_plugin_descriptor.name );
@@ -279,6 +296,7 @@ void bitInvader::playNote( NotePlayHandle * _n,
 
 		_n->m_pluginData = new bSynth(
 					const_cast<float*>( m_graph.samples() ),
+					std::atomic_load( &m_mipMap ),
 					_n,
 					m_interpolation.value(), factor,
 				Engine::mixer()->processingSampleRate() );
@@ -34,6 +34,7 @@
 #include "PixmapButton.h"
 #include "LedCheckbox.h"
 #include "MemoryManager.h"
+#include "UserWaveMipMap.h"
 
 class oscillator;
 class bitInvaderView;
@@ -42,7 +43,8 @@ class bSynth
 {
 	MM_OPERATORS
 public:
-	bSynth( float * sample, NotePlayHandle * _nph,
+	bSynth( float * sample, const UserWaveMipMapPtr & _mipMap,
+			NotePlayHandle * _nph,
 			bool _interpolation, float factor, 
 			const sample_rate_t _sample_rate );
 	virtual ~bSynth();
@@ -58,6 +60,13 @@ private:
 	const sample_rate_t sample_rate;
 
 	bool interpolation;
+
+	// band-limited shape played with interpolation, the level of which is
+	// picked again once the frequency changes
+	UserWaveMipMapPtr mipMap;
+	float factor;
+	float mipMapFrequency;
+	int mipMapLevel;
 	
 } ;
 
@@ -91,6 +100,7 @@ protected slots:
 	void samplesChanged( int, int );
 
 	void normalize();
+	void updateMipMap();
 
 
 private:
@@ -101,6 +111,9 @@ private:
 	BoolModel m_normalize;
 	
 	float m_normalizeFactor;
+
+	// shared by all notes, replaced when the shape changes
+	UserWaveMipMapPtr m_mipMap;
 	
 	friend class bitInvaderView;
 } ;
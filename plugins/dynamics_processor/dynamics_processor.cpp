@@ -30,6 +30,7 @@
 
 #include "embed.h"
 #include "plugin_export.h"
+#include "ScratchArena.h"
 
 extern "C"
 {
@@ -58,9 +59,11 @@ dynProcEffect::dynProcEffect( Model * _parent,
 	Effect( &dynamicsprocessor_plugin_descriptor, _parent, _key ),
 	m_dpControls( this )
 {
-	m_currentPeak[0] = m_currentPeak[1] = DYN_NOISE_FLOOR;
-	m_rms[0] = new RmsHelper( 64 * Engine::mixer()->processingSampleRate() / 44100 );
-	m_rms[1] = new RmsHelper( 64 * Engine::mixer()->processingSampleRate() / 44100 );
+	for( int i = 0; i <= 1; i++ )
+	{
+		m_level[i] = new LevelDetector( DYN_NOISE_FLOOR, 10.0f );
+		m_level[i]->setRmsSize( 64 * Engine::mixer()->processingSampleRate() / 44100 );
+	}
 	calcAttack();
 	calcRelease();
 }
@@ -70,19 +73,23 @@ dynProcEffect::dynProcEffect( Model * _parent,
 
 dynProcEffect::~dynProcEffect()
 {
-	delete m_rms[0];
-	delete m_rms[1];
+	delete m_level[0];
+	delete m_level[1];
 }
 
 
 inline void dynProcEffect::calcAttack()
 {
 	m_attCoeff = exp10( ( DNF_LOG / ( m_dpControls.m_attackModel.value() * 0.001 ) ) / Engine::mixer()->processingSampleRate() );
+	m_level[0]->setAttack( m_attCoeff );
+	m_level[1]->setAttack( m_attCoeff );
 }
 
 inline void dynProcEffect::calcRelease()
 {
 	m_relCoeff = exp10( ( -DNF_LOG / ( m_dpControls.m_releaseModel.value() * 0.001 ) ) / Engine::mixer()->processingSampleRate() );
+	m_level[0]->setRelease( m_relCoeff );
+	m_level[1]->setRelease( m_relCoeff );
 }
 
 
@@ -92,16 +99,10 @@ bool dynProcEffect::processAudioBuffer( sampleFrame * _buf,
 	if( !isEnabled() || !isRunning () )
 	{
 //apparently we can't keep running after the decay value runs out so we'll just set the peaks to zero
-		m_currentPeak[0] = m_currentPeak[1] = DYN_NOISE_FLOOR;
+		m_level[0]->reset();
+		m_level[1]->reset();
 		return( false );
 	}
-	//qDebug( "%f %f", m_currentPeak[0], m_currentPeak[1] );
-
-// variables for effect
-	int i = 0;
-
-	float sm_peak[2] = { 0.0f, 0.0f };
-	float gain;
 
 	double out_sum = 0.0;
 	const float d = dryLevel();
@@ -113,13 +114,10 @@ bool dynProcEffect::processAudioBuffer( sampleFrame * _buf,
 	
 	const float * samples = m_dpControls.m_wavegraphModel.samples();
 
-// debug code
-//	qDebug( "peaks %f %f", m_currentPeak[0], m_currentPeak[1] );
-
 	if( m_needsUpdate )
 	{
-		m_rms[0]->setSize( 64 * Engine::mixer()->processingSampleRate() / 44100 );
-		m_rms[1]->setSize( 64 * Engine::mixer()->processingSampleRate() / 44100 );
+		m_level[0]->setRmsSize( 64 * Engine::mixer()->processingSampleRate() / 44100 );
+		m_level[1]->setRmsSize( 64 * Engine::mixer()->processingSampleRate() / 44100 );
 		calcAttack();
 		calcRelease();
 		m_needsUpdate = false;
@@ -136,88 +134,71 @@ bool dynProcEffect::processAudioBuffer( sampleFrame * _buf,
 		}
 	}
 
+// apply input gain
+	ScratchBuffer<float> work( _frames * 6 );
+	float * s[2] = { work.data(), work.data() + _frames };
+	float * gains[2] = { work.data() + _frames * 2, work.data() + _frames * 3 };
+	float * keys[2] = { work.data() + _frames * 4, work.data() + _frames * 5 };
 	for( fpp_t f = 0; f < _frames; ++f )
 	{
-		double s[2] = { _buf[f][0], _buf[f][1] };
+		s[0][f] = _buf[f][0] * inputGain;
+		s[1][f] = _buf[f][1] * inputGain;
+	}
 
-// apply input gain
-		s[0] *= inputGain;
-		s[1] *= inputGain;
+// the levels come from the sidechain input if there is one, a silent one
+// leaves the input as it is
+	const sampleFrame * key = hasSidechain() ? sidechainBuffer() : _buf;
+	const float keyGain = hasSidechain() ? sidechainGain() * inputGain :
+								inputGain;
+	for( fpp_t f = 0; f < _frames; ++f )
+	{
+		keys[0][f] = key ? key[f][0] * keyGain : 0.0f;
+		keys[1][f] = key ? key[f][1] * keyGain : 0.0f;
+	}
 
 // update peak values
-		for ( i=0; i <= 1; i++ )
-		{
-			const double t = m_rms[i]->update( s[i] );
-			if( t > m_currentPeak[i] )
-			{
-				m_currentPeak[i] = qMin( m_currentPeak[i] * m_attCoeff, t );
-			}
-			else
-			if( t < m_currentPeak[i] )
-			{
-				m_currentPeak[i] = qMax( m_currentPeak[i] * m_relCoeff, t );
-			}
-
-			m_currentPeak[i] = qBound( DYN_NOISE_FLOOR, m_currentPeak[i], 10.0f );
-		}
+	for( int i = 0; i <= 1; i++ )
+	{
+		m_level[i]->process( keys[i], gains[i], _frames );
+	}
 
 // account for stereo mode
-		switch( stereoMode )
+	switch( stereoMode )
+	{
+		case dynProcControls::SM_Maximum:
 		{
-			case dynProcControls::SM_Maximum:
+			for( fpp_t f = 0; f < _frames; ++f )
 			{
-				sm_peak[0] = sm_peak[1] = qMax( m_currentPeak[0], m_currentPeak[1] );
-				break;
-			}
-			case dynProcControls::SM_Average:
-			{
-				sm_peak[0] = sm_peak[1] = ( m_currentPeak[0] + m_currentPeak[1] ) * 0.5;
-				break;
-			}
-			case dynProcControls::SM_Unlinked:
-			{
-				sm_peak[0] = m_currentPeak[0];
-				sm_peak[1] = m_currentPeak[1];
-				break;
+				gains[0][f] = gains[1][f] = qMax( gains[0][f], gains[1][f] );
 			}
+			break;
 		}
-
-// start effect
-
-		for ( i=0; i <= 1; i++ )
+		case dynProcControls::SM_Average:
 		{
-			const int lookup = static_cast<int>( sm_peak[i] * 200.0f );
-			const float frac = fraction( sm_peak[i] * 200.0f );
-
-			if( sm_peak[i] > DYN_NOISE_FLOOR )
+			for( fpp_t f = 0; f < _frames; ++f )
 			{
-				if ( lookup < 1 )
-				{
-					gain = frac * samples[0];
-				}
-				else
-				if ( lookup < 200 )
-				{
-					gain = linearInterpolate( samples[ lookup - 1 ],
-							samples[ lookup ], frac );
-				}
-				else
-				{
-					gain = samples[199];
-				};
-
-				s[i] *= gain; 
-				s[i] /= sm_peak[i];
+				gains[0][f] = gains[1][f] = ( gains[0][f] + gains[1][f] ) * 0.5f;
 			}
+			break;
+		}
+		case dynProcControls::SM_Unlinked:
+		{
+			break;
 		}
+	}
 
-// apply output gain
-		s[0] *= outputGain;
-		s[1] *= outputGain;
+// start effect
+	for( int i = 0; i <= 1; i++ )
+	{
+		LevelDetector::curveGains( samples, 200, 200.0f, DYN_NOISE_FLOOR,
+						gains[i], gains[i], _frames );
+	}
 
-// mix wet/dry signals
-		_buf[f][0] = d * _buf[f][0] + w * s[0];
-		_buf[f][1] = d * _buf[f][1] + w * s[1];
+	for( fpp_t f = 0; f < _frames; ++f )
+	{
+// apply gain and output gain, mix wet/dry signals
+		_buf[f][0] = d * _buf[f][0] + w * s[0][f] * gains[0][f] * outputGain;
+		_buf[f][1] = d * _buf[f][1] + w * s[1][f] * gains[1][f] * outputGain;
 		out_sum += _buf[f][0] * _buf[f][0] + _buf[f][1] * _buf[f][1];
 	}
 
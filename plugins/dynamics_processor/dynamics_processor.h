@@ -29,7 +29,7 @@
 
 #include "Effect.h"
 #include "dynamics_processor_controls.h"
-#include "RmsHelper.h"
+#include "LevelDetector.h"
 
 
 class dynProcEffect : public Effect
@@ -53,14 +53,12 @@ private:
 
 	dynProcControls m_dpControls;
 
-// this member array is needed for peak detection 
-	float m_currentPeak[2];
 	double m_attCoeff;
 	double m_relCoeff;
 	
 	bool m_needsUpdate;
 	
-	RmsHelper * m_rms [2];
+	LevelDetector * m_level [2];
 
 	friend class dynProcControls;
 
@@ -161,37 +161,84 @@ typedef DspEffectLibrary::Distortion DistFX;
 typedef KickerOsc<DspEffectLibrary::MonoToStereoAdaptor<DistFX> > SweepOsc;
 
 
+// renders a kick for the longest a note can play it
+class KickRenderer : public OneShotCache::Renderer
+{
+public:
+	KickRenderer( SweepOsc * _osc, f_cnt_t _frames, sample_rate_t _sampleRate ) :
+		m_osc( _osc ),
+		m_framesLeft( _frames ),
+		m_sampleRate( _sampleRate )
+	{
+	}
+
+	virtual ~KickRenderer()
+	{
+		delete m_osc;
+	}
+
+	virtual bool render( sampleFrame * _buf, fpp_t _frames )
+	{
+		m_osc->update( _buf, _frames, m_sampleRate );
+		m_framesLeft -= _frames;
+		return m_framesLeft > 0;
+	}
+
+private:
+	SweepOsc * m_osc;
+	f_cnt_t m_framesLeft;
+	const sample_rate_t m_sampleRate;
+
+} ;
+
+
 void kickerInstrument::playNote( NotePlayHandle * _n,
 						sampleFrame * _working_buffer )
 {
 	const fpp_t frames = _n->framesLeftForCurrentPeriod();
 	const f_cnt_t offset = _n->noteOffset();
-	const float decfr = m_decayModel.value() *
-		Engine::mixer()->processingSampleRate() / 1000.0f;
+	const sample_rate_t sampleRate = Engine::mixer()->processingSampleRate();
+	const float decfr = m_decayModel.value() * sampleRate / 1000.0f;
 	const f_cnt_t tfp = _n->totalFramesPlayed();
 
 	if ( tfp == 0 )
 	{
-		_n->m_pluginData = new SweepOsc(
+		const float startFreq = m_startNoteModel.value() ? _n->frequency() : m_startFreqModel.value();
+		const float endFreq = m_endNoteModel.value() ? _n->frequency() : m_endFreqModel.value();
+		const float noise = m_noiseModel.value() * m_noiseModel.value();
+		const float click = m_clickModel.value() * 0.25f;
+
+		OneShotCache::Key key;
+		key << static_cast<int>( sampleRate ) << startFreq << endFreq << noise << click
+			<< m_slopeModel.value() << m_envModel.value() << m_distModel.value()
+			<< m_distEndModel.value() << m_gainModel.value() << decfr;
+
+		// the note is released after decfr at most
+		const f_cnt_t length = static_cast<f_cnt_t>( decfr ) + desiredReleaseFrames() +
+					2 * Engine::mixer()->framesPerPeriod();
+
+		// noisy kicks are random, so they're rendered every time
+		_n->m_pluginData = new OneShotCache::Voice( noise > 0.0f ? NULL : &m_cache, key,
+			new KickRenderer( new SweepOsc(
 					DistFX( m_distModel.value(),
 							m_gainModel.value() ),
-					m_startNoteModel.value() ? _n->frequency() : m_startFreqModel.value(),
-					m_endNoteModel.value() ? _n->frequency() : m_endFreqModel.value(),
-					m_noiseModel.value() * m_noiseModel.value(),
-					m_clickModel.value() * 0.25f,
+					startFreq,
+					endFreq,
+					noise,
+					click,
 					m_slopeModel.value(),
 					m_envModel.value(),
 					m_distModel.value(),
 					m_distEndModel.value(),
-					decfr );
+					decfr ), length, sampleRate ) );
 	}
 	else if( tfp > decfr && !_n->isReleased() )
 	{
 		_n->noteOff();
 	}
 
-	SweepOsc * so = static_cast<SweepOsc *>( _n->m_pluginData );
-	so->update( _working_buffer + offset, frames, Engine::mixer()->processingSampleRate() );
+	OneShotCache::Voice * voice = static_cast<OneShotCache::Voice *>( _n->m_pluginData );
+	voice->render( _working_buffer + offset, frames );
 
 	if( _n->isReleased() )
 	{
@@ -213,7 +260,7 @@ void kickerInstrument::playNote( NotePlayHandle * _n,
 
 void kickerInstrument::deleteNotePluginData( NotePlayHandle * _n )
 {
-	delete static_cast<SweepOsc *>( _n->m_pluginData );
+	delete static_cast<OneShotCache::Voice *>( _n->m_pluginData );
 }
 
 
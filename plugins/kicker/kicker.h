@@ -32,6 +32,7 @@
 #include "InstrumentView.h"
 #include "Knob.h"
 #include "LedCheckbox.h"
+#include "OneShotCache.h"
 #include "TempoSyncKnob.h"
 
 
@@ -68,6 +69,11 @@ public:
 		return( 512 );
 	}
 
+	virtual bool isDeterministic() const
+	{
+		return m_noiseModel.value() == 0;
+	}
+
 	virtual PluginView * instantiateView( QWidget * _parent );
 
 
@@ -88,6 +94,10 @@ private:
 
 	IntModel m_versionModel;
 
+	// kicks rendered before, declared last so background renders are
+	// done before the models go away
+	OneShotCache m_cache;
+
 	friend class kickerInstrumentView;
 
 } ;
@@ -38,6 +38,7 @@
 #include "InstrumentPlayHandle.h"
 #include "InstrumentTrack.h"
 #include "Knob.h"
+#include "lmms_math.h"
 #include "NotePlayHandle.h"
 #include "Oscillator.h"
 #include "PixmapButton.h"
@@ -258,12 +259,12 @@ float lb302Filter3Pole::process(const float& samp)
 	float ax1  = lastin;
 	float ay11 = ay1;
 	float ay31 = ay2;
-	lastin  = (samp) - tanh(kres*aout);
+	lastin  = (samp) - fastTanhf(kres*aout);
 	ay1     = kp1h * (lastin+ax1) - kp*ay1;
 	ay2     = kp1h * (ay1 + ay11) - kp*ay2;
 	aout    = kp1h * (ay2 + ay31) - kp*aout;
 
-	return tanh(aout*value)*LB_24_VOL_ADJUST/(1.0+fs->dist);
+	return fastTanhf(aout*value)*LB_24_VOL_ADJUST/(1.0+fs->dist);
 }
 
 
@@ -25,6 +25,8 @@
 
 #include <QDomElement>
 
+#include <algorithm>
+
 #include "Monstro.h"
 #include "Engine.h"
 #include "InstrumentTrack.h"
@@ -33,6 +35,7 @@
 #include "Song.h"
 #include "lmms_math.h"
 #include "interpolation.h"
+#include "ScratchArena.h"
 
 #include "embed.h"
 
@@ -114,39 +117,29 @@ MonstroSynth::~MonstroSynth()
 
 void MonstroSynth::renderOutput( fpp_t _frames, sampleFrame * _buf  )
 {
-	float modtmp; // temp variable for freq modulation
-// macros for modulating with env/lfos
-#define modulatefreq( car, mod ) \
-		modtmp = 0.0f; \
-		if( mod##_e1 != 0.0f ) modtmp += m_env[0][f] * mod##_e1; \
-		if( mod##_e2 != 0.0f ) modtmp += m_env[1][f] * mod##_e2; \
-		if( mod##_l1 != 0.0f ) modtmp += m_lfo[0][f] * mod##_l1; \
-		if( mod##_l2 != 0.0f ) modtmp += m_lfo[1][f] * mod##_l2; \
-		car = qBound( MIN_FREQ, car * powf( 2.0f, modtmp ), MAX_FREQ );
-
-#define modulateabs( car, mod ) \
-		if( mod##_e1 != 0.0f ) car += m_env[0][f] * mod##_e1; \
-		if( mod##_e2 != 0.0f ) car += m_env[1][f] * mod##_e2; \
-		if( mod##_l1 != 0.0f ) car += m_lfo[0][f] * mod##_l1; \
-		if( mod##_l2 != 0.0f ) car += m_lfo[1][f] * mod##_l2;
-
-#define modulatephs( car, mod ) \
-		if( mod##_e1 != 0.0f ) car += m_env[0][f] * mod##_e1; \
-		if( mod##_e2 != 0.0f ) car += m_env[1][f] * mod##_e2; \
-		if( mod##_l1 != 0.0f ) car += m_lfo[0][f] * mod##_l1; \
-		if( mod##_l2 != 0.0f ) car += m_lfo[1][f] * mod##_l2;
-
-#define modulatevol( car, mod ) \
-		if( mod##_e1 > 0.0f ) car *= ( 1.0f - mod##_e1 + mod##_e1 * m_env[0][f] ); \
-		if( mod##_e1 < 0.0f ) car *= ( 1.0f + mod##_e1 * m_env[0][f] );	\
-		if( mod##_e2 > 0.0f ) car *= ( 1.0f - mod##_e2 + mod##_e2 * m_env[1][f] );	\
-		if( mod##_e2 < 0.0f ) car *= ( 1.0f + mod##_e2 * m_env[1][f] );	\
-		if( mod##_l1 != 0.0f ) car *= ( 1.0f + mod##_l1 * m_lfo[0][f] ); \
-		if( mod##_l2 != 0.0f ) car *= ( 1.0f + mod##_l2 * m_lfo[1][f] ); \
-		car = qBound( -MODCLIP, car, MODCLIP );
-
+	// specialise the render loop for the o2-o3 modulation, so the
+	// unused modulation paths are compiled out
+	switch( m_parent->m_o23Mod.value() )
+	{
+		case MOD_AM:
+			render<MOD_AM>( _frames, _buf );
+			break;
+		case MOD_FM:
+			render<MOD_FM>( _frames, _buf );
+			break;
+		case MOD_PM:
+			render<MOD_PM>( _frames, _buf );
+			break;
+		default:
+			render<MOD_MIX>( _frames, _buf );
+			break;
+	}
+}
 
 
+template<int MOD>
+void MonstroSynth::render( fpp_t _frames, sampleFrame * _buf )
+{
 	////////////////////
 	//                //
 	//   MODULATORS   //
@@ -294,11 +287,6 @@ void MonstroSynth::renderOutput( fpp_t _frames, sampleFrame * _buf  )
 	const float o3s_l2 = ( m_parent->m_sub3lfo2.value() * 0.5f );
 	const bool o3s_mod = o3s_e1 != 0.0f || o3s_e2 != 0.0f || o3s_l1 != 0.0f || o3s_l2 != 0.0f;
 
-
-	//o2-o3 modulation
-
-	const int omod = m_parent->m_o23Mod.value();
-
 	// sync information
 
 	const bool o1ssr = m_parent->m_osc1SSR.value();
@@ -308,13 +296,71 @@ void MonstroSynth::renderOutput( fpp_t _frames, sampleFrame * _buf  )
 	const bool o2syncr = m_parent->m_osc2SyncR.value();
 	const bool o3syncr = m_parent->m_osc3SyncR.value();
 
-	///////////////////////////
-	//                       //
-	// 	 start buffer loop   //
-	//                       //
-	///////////////////////////
+	// render modulators: envelopes, lfos
+	updateModulators( m_env[0].data(), m_env[1].data(), m_lfo[0].data(), m_lfo[1].data(), _frames );
+
+	////////////////////
+	//                //
+	//   MODULATION   //
+	//                //
+	////////////////////
 
-	// declare working variables for for loop
+	// apply the modulation matrix in block loops, so the oscillator loops
+	// below only read the modulated pitch, phase, pulse width and sub
+	ScratchBuffer<float> pitch( _frames );
+
+	ScratchBuffer<float> o1l_inc( _frames );
+	ScratchBuffer<float> o1r_inc( _frames );
+	ScratchBuffer<float> o1_ph( _frames );
+	ScratchBuffer<float> o1_pw( _frames );
+	if( o1f_mod )
+	{
+		pitchModulation( pitch.data(), o1f_e1, o1f_e2, o1f_l1, o1f_l2, _frames );
+	}
+	phaseIncrements( o1l_inc.data(), o1lfb, o1f_mod ? pitch.data() : NULL, _frames );
+	phaseIncrements( o1r_inc.data(), o1rfb, o1f_mod ? pitch.data() : NULL, _frames );
+	modulation( o1_ph.data(), o1p_mod, 0.0f, o1p_e1, o1p_e2, o1p_l1, o1p_l2, _frames );
+	modulation( o1_pw.data(), o1pw_mod, pw, o1pw_e1, o1pw_e2, o1pw_l1, o1pw_l2, _frames );
+	if( o1pw_mod )
+	{
+		bound( o1_pw.data(), PW_MIN, PW_MAX, _frames );
+	}
+
+	ScratchBuffer<float> o2l_inc( _frames );
+	ScratchBuffer<float> o2r_inc( _frames );
+	ScratchBuffer<float> o2_ph( _frames );
+	if( o2f_mod )
+	{
+		pitchModulation( pitch.data(), o2f_e1, o2f_e2, o2f_l1, o2f_l2, _frames );
+	}
+	phaseIncrements( o2l_inc.data(), o2lfb, o2f_mod ? pitch.data() : NULL, _frames );
+	phaseIncrements( o2r_inc.data(), o2rfb, o2f_mod ? pitch.data() : NULL, _frames );
+	modulation( o2_ph.data(), o2p_mod, 0.0f, o2p_e1, o2p_e2, o2p_l1, o2p_l2, _frames );
+
+	// left and right of osc3 share their base frequency
+	ScratchBuffer<float> o3_inc( _frames );
+	ScratchBuffer<float> o3_ph( _frames );
+	ScratchBuffer<float> o3_sub( _frames );
+	if( o3f_mod )
+	{
+		pitchModulation( pitch.data(), o3f_e1, o3f_e2, o3f_l1, o3f_l2, _frames );
+	}
+	phaseIncrements( o3_inc.data(), o3fb, o3f_mod ? pitch.data() : NULL, _frames );
+	modulation( o3_ph.data(), o3p_mod, 0.0f, o3p_e1, o3p_e2, o3p_l1, o3p_l2, _frames );
+	modulation( o3_sub.data(), o3s_mod, o3sub, o3s_e1, o3s_e2, o3s_l1, o3s_l2, _frames );
+	if( o3s_mod )
+	{
+		bound( o3_sub.data(), 0.0f, 1.0f, _frames );
+	}
+
+	ScratchBuffer<sample_t> O1L( _frames );
+	ScratchBuffer<sample_t> O1R( _frames );
+	ScratchBuffer<sample_t> O2L( _frames );
+	ScratchBuffer<sample_t> O2R( _frames );
+	ScratchBuffer<sample_t> O3L( _frames );
+	ScratchBuffer<sample_t> O3R( _frames );
+	// bit 0/1: osc1 triggers a sync of the left/right channel
+	ScratchBuffer<unsigned char> syncs( _frames );
 
 	// phase manipulation vars - these can be reused by all oscs
 	float leftph;
@@ -324,178 +370,66 @@ void MonstroSynth::renderOutput( fpp_t _frames, sampleFrame * _buf  )
 	float len_l;
 	float len_r;
 
-	// osc1 vars
-	float o1l_f;
-	float o1r_f;
+	/////////////////////////////
+	//				           //
+	//          OSC 1          //
+	//				           //
+	/////////////////////////////
+
 	float o1l_p = m_osc1l_phase + o1lpo; // we add phase offset here so we don't have to do it every frame
 	float o1r_p = m_osc1r_phase + o1rpo; // then subtract it again after loop...
-	float o1_pw;
-
-	// osc2 vars
-	float o2l_f;
-	float o2r_f;
-	float o2l_p = m_osc2l_phase + o2lpo;
-	float o2r_p = m_osc2r_phase + o2rpo;
 
-	// osc3 vars
-	float o3l_f;
-	float o3r_f;
-	float o3l_p = m_osc3l_phase + o3lpo;
-	float o3r_p = m_osc3r_phase + o3rpo;
-	float sub;
-
-	// render modulators: envelopes, lfos
-	updateModulators( m_env[0].data(), m_env[1].data(), m_lfo[0].data(), m_lfo[1].data(), _frames );
-
-	// begin for loop
 	for( f_cnt_t f = 0; f < _frames; ++f )
 	{
-/*	// debug code
-		if( f % 10 == 0 ) {
-			qDebug( "env1 %f -- env1 phase %f", m_env1_buf[f], m_env1_phase );
-			qDebug( "env1 pre %f att %f dec %f rel %f ", m_parent->m_env1_pre, m_parent->m_env1_att,
-				m_parent->m_env1_dec, m_parent->m_env1_rel );
-		}*/
-
-
-		/////////////////////////////
-		//				           //
-		//          OSC 1          //
-		//				           //
-		/////////////////////////////
-
-		// calc and mod frequencies
-		o1l_f = o1lfb;
-		o1r_f = o1rfb;
-		if( o1f_mod )
-		{
-			modulatefreq( o1l_f, o1f )
-			modulatefreq( o1r_f, o1f )
-		}
-		// calc and modulate pulse
-		o1_pw = pw;
-		if( o1pw_mod )
-		{
-			modulateabs( o1_pw, o1pw )
-			o1_pw = qBound( PW_MIN, o1_pw, PW_MAX );
-		}
-
-		// calc and modulate phase
-		leftph = o1l_p;
-		rightph = o1r_p;
-		if( o1p_mod )
-		{
-			modulatephs( leftph, o1p )
-			modulatephs( rightph, o1p )
-		}
-
 		// pulse wave osc
-		sample_t O1L = ( absFraction( leftph ) < o1_pw ) ? 1.0f : -1.0f;
-		sample_t O1R = ( absFraction( rightph ) < o1_pw ) ? 1.0f : -1.0f;
-
-		// check for rise/fall, and sync if appropriate
-		// sync on rise
-		if( o1ssr )
-		{
-			// hard sync
-			if( o2sync )
-			{
-				if( O1L > m_osc1l_last ) { o2l_p = o2lpo; m_counter2l = m_parent->m_counterMax; }
-				if( O1R > m_osc1r_last ) { o2r_p = o2rpo; m_counter2r = m_parent->m_counterMax; }
-			}
-			if( o3sync )
-			{
-				if( O1L > m_osc1l_last ) { o3l_p = o3lpo; m_counter3l = m_parent->m_counterMax; }
-				if( O1R > m_osc1r_last ) { o3r_p = o3rpo; m_counter3r = m_parent->m_counterMax; }
-			}
-			// reverse sync
-			if( o2syncr )
-			{
-				if( O1L > m_osc1l_last ) { m_invert2l = !m_invert2l; m_counter2l = m_parent->m_counterMax; }
-				if( O1R > m_osc1r_last ) { m_invert2r = !m_invert2r; m_counter2r = m_parent->m_counterMax; }
-			}
-			if( o3syncr )
-			{
-				if( O1L > m_osc1l_last ) { m_invert3l = !m_invert3l; m_counter3l = m_parent->m_counterMax; }
-				if( O1R > m_osc1r_last ) { m_invert3r = !m_invert3r; m_counter3r = m_parent->m_counterMax; }
-			}
-		}
-		// sync on fall
-		if( o1ssf )
-		{
-			// hard sync
-			if( o2sync )
-			{
-				if( O1L < m_osc1l_last ) { o2l_p = o2lpo; m_counter2l = m_parent->m_counterMax; }
-				if( O1R < m_osc1r_last ) { o2r_p = o2rpo; m_counter2r = m_parent->m_counterMax; }
-			}
-			if( o3sync )
-			{
-				if( O1L < m_osc1l_last ) { o3l_p = o3lpo; m_counter3l = m_parent->m_counterMax; }
-				if( O1R < m_osc1r_last ) { o3r_p = o3rpo; m_counter3r = m_parent->m_counterMax; }
-			}
-			// reverse sync
-			if( o2syncr )
-			{
-				if( O1L < m_osc1l_last ) { m_invert2l = !m_invert2l; m_counter2l = m_parent->m_counterMax; }
-				if( O1R < m_osc1r_last ) { m_invert2r = !m_invert2r; m_counter2r = m_parent->m_counterMax; }
-			}
-			if( o3syncr )
-			{
-				if( O1L < m_osc1l_last ) { m_invert3l = !m_invert3l; m_counter3l = m_parent->m_counterMax; }
-				if( O1R < m_osc1r_last ) { m_invert3r = !m_invert3r; m_counter3r = m_parent->m_counterMax; }
-			}
-		}
+		const sample_t l = ( absFraction( o1l_p + o1_ph[f] ) < o1_pw[f] ) ? 1.0f : -1.0f;
+		const sample_t r = ( absFraction( o1r_p + o1_ph[f] ) < o1_pw[f] ) ? 1.0f : -1.0f;
 
-		// update last before signal is touched
-		// also do a very simple amp delta cap
-		const sample_t tmpl = m_osc1l_last;
-		const sample_t tmpr = m_osc1r_last;
+		// check for rise/fall, syncing is done by osc2/osc3
+		const bool syncl = ( o1ssr && l > m_osc1l_last ) || ( o1ssf && l < m_osc1l_last );
+		const bool syncr = ( o1ssr && r > m_osc1r_last ) || ( o1ssf && r < m_osc1r_last );
+		syncs[f] = ( syncl ? 1 : 0 ) | ( syncr ? 2 : 0 );
 
-		m_osc1l_last = O1L;
-		m_osc1r_last = O1R;
+		// very simple amp delta cap
+		O1L[f] = l != m_osc1l_last ? 0.0f : l * o1lv;
+		O1R[f] = r != m_osc1r_last ? 0.0f : r * o1rv;
 
-		if( tmpl != O1L ) O1L = 0.0f;
-		if( tmpr != O1R ) O1R = 0.0f;
+		m_osc1l_last = l;
+		m_osc1r_last = r;
 
-		// modulate volume
-		O1L *= o1lv;
-		O1R *= o1rv;
-		if( o1v_mod )
-		{
-			modulatevol( O1L, o1v )
-			modulatevol( O1R, o1v )
-		}
+		o1l_p += o1l_inc[f];
+		o1r_p += o1r_inc[f];
+	}
+	if( o1v_mod )
+	{
+		modulateVolume( O1L.data(), O1R.data(), o1v_e1, o1v_e2, o1v_l1, o1v_l2, _frames );
+	}
 
-		// update osc1 phase working variable
-		o1l_p += 1.0f / ( static_cast<float>( m_parent->m_samplerate ) / o1l_f );
-		o1r_p += 1.0f / ( static_cast<float>( m_parent->m_samplerate ) / o1r_f );
+	/////////////////////////////
+	//				           //
+	//          OSC 2          //
+	//				           //
+	/////////////////////////////
 
-		/////////////////////////////
-		//				           //
-		//          OSC 2          //
-		//				           //
-		/////////////////////////////
+	float o2l_p = m_osc2l_phase + o2lpo;
+	float o2r_p = m_osc2r_phase + o2rpo;
 
-		// calc and mod frequencies
-		o2l_f = o2lfb;
-		o2r_f = o2rfb;
-		if( o2f_mod )
+	for( f_cnt_t f = 0; f < _frames; ++f )
+	{
+		if( syncs[f] & 1 )
 		{
-			modulatefreq( o2l_f, o2f )
-			modulatefreq( o2r_f, o2f )
+			// hard sync / reverse sync
+			if( o2sync ) { o2l_p = o2lpo; m_counter2l = m_parent->m_counterMax; }
+			if( o2syncr ) { m_invert2l = !m_invert2l; m_counter2l = m_parent->m_counterMax; }
 		}
-
-		// calc and modulate phase
-		leftph = o2l_p;
-		rightph = o2r_p;
-		if( o2p_mod )
+		if( syncs[f] & 2 )
 		{
-			modulatephs( leftph, o2p )
-			modulatephs( rightph, o2p )
+			if( o2sync ) { o2r_p = o2rpo; m_counter2r = m_parent->m_counterMax; }
+			if( o2syncr ) { m_invert2r = !m_invert2r; m_counter2r = m_parent->m_counterMax; }
 		}
-		leftph = absFraction( leftph );
-		rightph = absFraction( rightph );
+
+		leftph = absFraction( o2l_p + o2_ph[f] );
+		rightph = absFraction( o2r_p + o2_ph[f] );
 
 		// phase delta
 		pd_l = qAbs( leftph - m_ph2l_last );
@@ -508,56 +442,53 @@ void MonstroSynth::renderOutput( fpp_t _frames, sampleFrame * _buf  )
 		len_r = BandLimitedWave::pdToLen( pd_r );
 		if( m_counter2l > 0 ) { len_l /= m_counter2l; m_counter2l--; }
 		if( m_counter2r > 0 ) { len_r /= m_counter2r; m_counter2r--; }
-		sample_t O2L = oscillate( o2w, leftph, len_l );
-		sample_t O2R = oscillate( o2w, rightph, len_r );
 
-		// modulate volume
-		O2L *= o2lv;
-		O2R *= o2rv;
-		if( o2v_mod )
-		{
-			modulatevol( O2L, o2v )
-			modulatevol( O2R, o2v )
-		}
-
-		// reverse sync - invert waveforms when needed
-		if( m_invert2l ) O2L *= -1.0;
-		if( m_invert2r ) O2R *= -1.0;
+		// reverse sync - invert waveforms when needed, the volume
+		// modulation below is symmetric so it may come after this
+		O2L[f] = oscillate( o2w, leftph, len_l ) * ( m_invert2l ? -o2lv : o2lv );
+		O2R[f] = oscillate( o2w, rightph, len_r ) * ( m_invert2r ? -o2rv : o2rv );
 
 		// update osc2 phases
 		m_ph2l_last = leftph;
 		m_ph2r_last = rightph;
-		o2l_p += 1.0f / ( static_cast<float>( m_parent->m_samplerate ) / o2l_f );
-		o2r_p += 1.0f / ( static_cast<float>( m_parent->m_samplerate ) / o2r_f );
-
-		/////////////////////////////
-		//				           //
-		//          OSC 3          //
-		//				           //
-		/////////////////////////////
-
-		// calc and mod frequencies
-		o3l_f = o3fb;
-		o3r_f = o3fb;
-		if( o3f_mod )
+		o2l_p += o2l_inc[f];
+		o2r_p += o2r_inc[f];
+	}
+	if( o2v_mod )
+	{
+		modulateVolume( O2L.data(), O2R.data(), o2v_e1, o2v_e2, o2v_l1, o2v_l2, _frames );
+	}
+
+	/////////////////////////////
+	//				           //
+	//          OSC 3          //
+	//				           //
+	/////////////////////////////
+
+	float o3l_p = m_osc3l_phase + o3lpo;
+	float o3r_p = m_osc3r_phase + o3rpo;
+
+	for( f_cnt_t f = 0; f < _frames; ++f )
+	{
+		if( syncs[f] & 1 )
 		{
-			modulatefreq( o3l_f, o3f )
-			modulatefreq( o3r_f, o3f )
+			if( o3sync ) { o3l_p = o3lpo; m_counter3l = m_parent->m_counterMax; }
+			if( o3syncr ) { m_invert3l = !m_invert3l; m_counter3l = m_parent->m_counterMax; }
 		}
-		// calc and modulate phase
-		leftph = o3l_p;
-		rightph = o3r_p;
-		if( o3p_mod )
+		if( syncs[f] & 2 )
 		{
-			modulatephs( leftph, o3p )
-			modulatephs( rightph, o3p )
+			if( o3sync ) { o3r_p = o3rpo; m_counter3r = m_parent->m_counterMax; }
+			if( o3syncr ) { m_invert3r = !m_invert3r; m_counter3r = m_parent->m_counterMax; }
 		}
 
+		leftph = o3l_p + o3_ph[f];
+		rightph = o3r_p + o3_ph[f];
+
 		// o2 modulation?
-		if( omod == MOD_PM )
+		if( MOD == MOD_PM )
 		{
-			leftph += O2L * 0.5f;
-			rightph += O2R * 0.5f;
+			leftph += O2L[f] * 0.5f;
+			rightph += O2R[f] * 0.5f;
 		}
 		leftph = absFraction( leftph );
 		rightph = absFraction( rightph );
@@ -574,60 +505,58 @@ void MonstroSynth::renderOutput( fpp_t _frames, sampleFrame * _buf  )
 		if( m_counter3l > 0 ) { len_l /= m_counter3l; m_counter3l--; }
 		if( m_counter3r > 0 ) { len_r /= m_counter3r; m_counter3r--; }
 		//  sub-osc 1
-		sample_t O3AL = oscillate( o3w1, leftph, len_l );
-		sample_t O3AR = oscillate( o3w1, rightph, len_r );
+		const sample_t O3AL = oscillate( o3w1, leftph, len_l );
+		const sample_t O3AR = oscillate( o3w1, rightph, len_r );
 
 		// multi-wave DC Oscillator, sub-osc 2
-		sample_t O3BL = oscillate( o3w2, leftph, len_l );
-		sample_t O3BR = oscillate( o3w2, rightph, len_r );
-
-		// calc and modulate sub
-		sub = o3sub;
-		if( o3s_mod )
-		{
-			modulateabs( sub, o3s )
-			sub = qBound( 0.0f, sub, 1.0f );
-		}
+		const sample_t O3BL = oscillate( o3w2, leftph, len_l );
+		const sample_t O3BR = oscillate( o3w2, rightph, len_r );
 
-		sample_t O3L = linearInterpolate( O3AL, O3BL, sub );
-		sample_t O3R = linearInterpolate( O3AR, O3BR, sub );
-
-		// modulate volume
-		O3L *= o3lv;
-		O3R *= o3rv;
-		if( o3v_mod )
-		{
-			modulatevol( O3L, o3v )
-			modulatevol( O3R, o3v )
-		}
-		// o2 modulation?
-		if( omod == MOD_AM )
-		{
-			O3L = qBound( -MODCLIP, O3L * qMax( 0.0f, 1.0f + O2L ), MODCLIP );
-			O3R = qBound( -MODCLIP, O3R * qMax( 0.0f, 1.0f + O2R ), MODCLIP );
-		}
-
-		// reverse sync - invert waveforms when needed
-		if( m_invert3l ) O3L *= -1.0;
-		if( m_invert3r ) O3R *= -1.0;
+		// reverse sync - invert waveforms when needed, volume and
+		// amplitude modulation below are symmetric
+		O3L[f] = linearInterpolate( O3AL, O3BL, o3_sub[f] ) * ( m_invert3l ? -o3lv : o3lv );
+		O3R[f] = linearInterpolate( O3AR, O3BR, o3_sub[f] ) * ( m_invert3r ? -o3rv : o3rv );
 
 		// update osc3 phases
 		m_ph3l_last = leftph;
 		m_ph3r_last = rightph;
-		len_l = 1.0f / ( static_cast<float>( m_parent->m_samplerate ) / o3l_f );
-		len_r = 1.0f / ( static_cast<float>( m_parent->m_samplerate ) / o3r_f );
 		// handle FM as PM
-		if( omod == MOD_FM )
+		if( MOD == MOD_FM )
+		{
+			o3l_p += o3_inc[f] + O2L[f] * m_parent->m_fmCorrection;
+			o3r_p += o3_inc[f] + O2R[f] * m_parent->m_fmCorrection;
+		}
+		else
+		{
+			o3l_p += o3_inc[f];
+			o3r_p += o3_inc[f];
+		}
+	}
+	if( o3v_mod )
+	{
+		modulateVolume( O3L.data(), O3R.data(), o3v_e1, o3v_e2, o3v_l1, o3v_l2, _frames );
+	}
+	// o2 modulation?
+	if( MOD == MOD_AM )
+	{
+		for( f_cnt_t f = 0; f < _frames; ++f )
 		{
-			len_l += O2L * m_parent->m_fmCorrection;
-			len_r += O2R * m_parent->m_fmCorrection;
+			O3L[f] = qBound( -MODCLIP, O3L[f] * qMax( 0.0f, 1.0f + O2L[f] ), MODCLIP );
+			O3R[f] = qBound( -MODCLIP, O3R[f] * qMax( 0.0f, 1.0f + O2R[f] ), MODCLIP );
 		}
-		o3l_p += len_l;
-		o3r_p += len_r;
+	}
+
+	/////////////////////////////
+	//				           //
+	//           MIX           //
+	//				           //
+	/////////////////////////////
 
+	for( f_cnt_t f = 0; f < _frames; ++f )
+	{
 		// integrator - very simple filter
-		sample_t L = O1L + O3L + ( omod == MOD_MIX ? O2L : 0.0f );
-		sample_t R = O1R + O3R + ( omod == MOD_MIX ? O2R : 0.0f );
+		const sample_t L = O1L[f] + O3L[f] + ( MOD == MOD_MIX ? O2L[f] : 0.0f );
+		const sample_t R = O1R[f] + O3R[f] + ( MOD == MOD_MIX ? O2R[f] : 0.0f );
 
 		_buf[f][0] = linearInterpolate( L, m_l_last, m_parent->m_integrator );
 		_buf[f][1] = linearInterpolate( R, m_r_last, m_parent->m_integrator );
@@ -649,6 +578,85 @@ void MonstroSynth::renderOutput( fpp_t _frames, sampleFrame * _buf  )
 }
 
 
+void MonstroSynth::modulation( float * _out, bool _mod, float _base,
+		float _e1, float _e2, float _l1, float _l2, fpp_t _frames ) const
+{
+	if( !_mod )
+	{
+		std::fill( _out, _out + _frames, _base );
+		return;
+	}
+
+	const float * env1 = m_env[0].data();
+	const float * env2 = m_env[1].data();
+	const float * lfo1 = m_lfo[0].data();
+	const float * lfo2 = m_lfo[1].data();
+	for( f_cnt_t f = 0; f < _frames; ++f )
+	{
+		_out[f] = _base + env1[f] * _e1 + env2[f] * _e2 + lfo1[f] * _l1 + lfo2[f] * _l2;
+	}
+}
+
+
+void MonstroSynth::pitchModulation( float * _out,
+		float _e1, float _e2, float _l1, float _l2, fpp_t _frames ) const
+{
+	modulation( _out, true, 0.0f, _e1, _e2, _l1, _l2, _frames );
+	for( f_cnt_t f = 0; f < _frames; ++f )
+	{
+		_out[f] = fastExp2f( _out[f] );
+	}
+}
+
+
+void MonstroSynth::phaseIncrements( float * _inc, float _freq,
+				const float * _pitch, fpp_t _frames ) const
+{
+	const float samplerate = static_cast<float>( m_parent->m_samplerate );
+	if( _pitch == NULL )
+	{
+		std::fill( _inc, _inc + _frames, _freq / samplerate );
+		return;
+	}
+
+	for( f_cnt_t f = 0; f < _frames; ++f )
+	{
+		_inc[f] = qBound( MIN_FREQ, _freq * _pitch[f], MAX_FREQ ) / samplerate;
+	}
+}
+
+
+void MonstroSynth::modulateVolume( sample_t * _l, sample_t * _r,
+		float _e1, float _e2, float _l1, float _l2, fpp_t _frames ) const
+{
+	// positive envelope amounts scale down from full volume, negative ones
+	// scale up from silence
+	const float e1base = _e1 > 0.0f ? 1.0f - _e1 : 1.0f;
+	const float e2base = _e2 > 0.0f ? 1.0f - _e2 : 1.0f;
+
+	const float * env1 = m_env[0].data();
+	const float * env2 = m_env[1].data();
+	const float * lfo1 = m_lfo[0].data();
+	const float * lfo2 = m_lfo[1].data();
+	for( f_cnt_t f = 0; f < _frames; ++f )
+	{
+		const float gain = ( e1base + _e1 * env1[f] ) * ( e2base + _e2 * env2[f] ) *
+					( 1.0f + _l1 * lfo1[f] ) * ( 1.0f + _l2 * lfo2[f] );
+		_l[f] = qBound( -MODCLIP, _l[f] * gain, MODCLIP );
+		_r[f] = qBound( -MODCLIP, _r[f] * gain, MODCLIP );
+	}
+}
+
+
+void MonstroSynth::bound( float * _buf, float _min, float _max, fpp_t _frames )
+{
+	for( f_cnt_t f = 0; f < _frames; ++f )
+	{
+		_buf[f] = qBound( _min, _buf[f], _max );
+	}
+}
+
+
 inline void MonstroSynth::updateModulators( float * env1, float * env2, float * lfo1, float * lfo2, int frames )
 {
 	// frames played before
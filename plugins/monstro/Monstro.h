@@ -174,6 +174,22 @@ private:
 
 	inline void updateModulators( float * env1, float * env2, float * lfo1, float * lfo2, int frames );
 
+	// renderOutput() for one o2-o3 modulation mode, MOD is one of MOD_*
+	template<int MOD>
+	void render( fpp_t _frames, sampleFrame * _buf );
+
+	// block stages of render() applying the modulation matrix: out = base + env/lfo modulation,
+	// or base if _mod is false
+	void modulation( float * _out, bool _mod, float _base,
+			float _e1, float _e2, float _l1, float _l2, fpp_t _frames ) const;
+	// pitch multipliers from modulation in octaves
+	void pitchModulation( float * _out, float _e1, float _e2, float _l1, float _l2, fpp_t _frames ) const;
+	// phase increments for pitch multipliers, _pitch is NULL if the pitch isn't modulated
+	void phaseIncrements( float * _inc, float _freq, const float * _pitch, fpp_t _frames ) const;
+	void modulateVolume( sample_t * _l, sample_t * _r,
+			float _e1, float _e2, float _l1, float _l2, fpp_t _frames ) const;
+	static void bound( float * _buf, float _min, float _max, fpp_t _frames );
+
 	// linear interpolation
 /*	inline sample_t interpolate( sample_t s1, sample_t s2, float x )
 	{
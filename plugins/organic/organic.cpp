@@ -30,6 +30,7 @@
 #include <QPainter>
 
 
+#include "BufferManager.h"
 #include "Engine.h"
 #include "InstrumentTrack.h"
 #include "Knob.h"
@@ -37,6 +38,7 @@
 #include "NotePlayHandle.h"
 #include "Oscillator.h"
 #include "PixmapButton.h"
+#include "ScratchArena.h"
 #include "ToolTip.h"
 
 #include "embed.h"
@@ -232,73 +234,35 @@ void organicInstrument::playNote( NotePlayHandle * _n,
 	
 	if( _n->totalFramesPlayed() == 0 || _n->m_pluginData == NULL )
 	{
-		Oscillator * oscs_l[NUM_OSCILLATORS];
-		Oscillator * oscs_r[NUM_OSCILLATORS];
-
-		_n->m_pluginData = new oscPtr;
-
-		for( int i = m_numOscillators - 1; i >= 0; --i )
+		oscPtr * osc = new oscPtr;
+		for( int i = 0; i < m_numOscillators; ++i )
 		{
-			static_cast<oscPtr *>( _n->m_pluginData )->phaseOffsetLeft[i] 
-				= rand() / ( RAND_MAX + 1.0f );
-			static_cast<oscPtr *>( _n->m_pluginData )->phaseOffsetRight[i] 
-				= rand() / ( RAND_MAX + 1.0f );
-			
-			// initialise ocillators
-			
-			if( i == m_numOscillators - 1 )
-			{
-				// create left oscillator
-				oscs_l[i] = new Oscillator(
-						&m_osc[i]->m_waveShape,
-						&m_modulationAlgo,
-						_n->frequency(),
-						m_osc[i]->m_detuningLeft,
-						static_cast<oscPtr *>( _n->m_pluginData )->phaseOffsetLeft[i],
-						m_osc[i]->m_volumeLeft );
-				// create right oscillator
-				oscs_r[i] = new Oscillator(
-						&m_osc[i]->m_waveShape,
-						&m_modulationAlgo,
-						_n->frequency(),
-						m_osc[i]->m_detuningRight,
-						static_cast<oscPtr *>( _n->m_pluginData )->phaseOffsetRight[i],
-						m_osc[i]->m_volumeRight );
-			}
-			else
-			{
-				// create left oscillator
-				oscs_l[i] = new Oscillator(
-						&m_osc[i]->m_waveShape,
-						&m_modulationAlgo,
-						_n->frequency(),
-						m_osc[i]->m_detuningLeft,
-						static_cast<oscPtr *>( _n->m_pluginData )->phaseOffsetLeft[i],
-						m_osc[i]->m_volumeLeft,
-						oscs_l[i + 1] );
-				// create right oscillator
-				oscs_r[i] = new Oscillator(
-						&m_osc[i]->m_waveShape,
-						&m_modulationAlgo,
-						_n->frequency(),
-						m_osc[i]->m_detuningRight,
-						static_cast<oscPtr *>( _n->m_pluginData )->phaseOffsetRight[i],
-						m_osc[i]->m_volumeRight,
-						oscs_r[i + 1] );
-			}
-			
-				
+			osc->phaseOffsetLeft[i] = rand() / ( RAND_MAX + 1.0f );
+			osc->phaseOffsetRight[i] = rand() / ( RAND_MAX + 1.0f );
+			osc->sineRe[i] = cosf( osc->phaseOffsetLeft[i] * F_2PI );
+			osc->sineIm[i] = sinf( osc->phaseOffsetLeft[i] * F_2PI );
+			osc->sineRe[NUM_OSCILLATORS + i] =
+				cosf( osc->phaseOffsetRight[i] * F_2PI );
+			osc->sineIm[NUM_OSCILLATORS + i] =
+				sinf( osc->phaseOffsetRight[i] * F_2PI );
+			osc->oscLeft[i] = NULL;
+			osc->oscRight[i] = NULL;
 		}
-
-		static_cast<oscPtr *>( _n->m_pluginData )->oscLeft = oscs_l[0];
-		static_cast<oscPtr *>( _n->m_pluginData )->oscRight = oscs_r[0];
+		_n->m_pluginData = osc;
 	}
 
-	Oscillator * osc_l = static_cast<oscPtr *>( _n->m_pluginData )->oscLeft;
-	Oscillator * osc_r = static_cast<oscPtr *>( _n->m_pluginData)->oscRight;
+	oscPtr * osc = static_cast<oscPtr *>( _n->m_pluginData );
 
-	osc_l->update( _working_buffer + offset, frames, 0 );
-	osc_r->update( _working_buffer + offset, frames, 1 );
+	if( _n->frequency() >= Engine::mixer()->processingSampleRate() / 2 )
+	{
+		BufferManager::clear( _working_buffer + offset, frames );
+	}
+	else
+	{
+		renderSines( osc, _working_buffer + offset, frames,
+							_n->frequency() );
+		renderOthers( _n, osc, _working_buffer + offset, frames );
+	}
 
 
 	// -- fx section --
@@ -324,12 +288,114 @@ void organicInstrument::playNote( NotePlayHandle * _n,
 
 void organicInstrument::deleteNotePluginData( NotePlayHandle * _n )
 {
-	delete static_cast<Oscillator *>( static_cast<oscPtr *>(
-						_n->m_pluginData )->oscLeft );
-	delete static_cast<Oscillator *>( static_cast<oscPtr *>(
-						_n->m_pluginData )->oscRight );
-	
-	delete static_cast<oscPtr *>( _n->m_pluginData );
+	oscPtr * osc = static_cast<oscPtr *>( _n->m_pluginData );
+	for( int i = 0; i < NUM_OSCILLATORS; ++i )
+	{
+		delete osc->oscLeft[i];
+		delete osc->oscRight[i];
+	}
+	delete osc;
+}
+
+
+
+
+void organicInstrument::renderSines( oscPtr * _osc, sampleFrame * _buf,
+						fpp_t _frames, float _freq )
+{
+	// every sine is a phasor rotated by its phase increment per frame, so
+	// all of them take a few multiplications per frame instead of a sinf()
+	// each, in a loop the compiler can vectorise
+	float re[NUM_SINES];
+	float im[NUM_SINES];
+	float rotRe[NUM_SINES];
+	float rotIm[NUM_SINES];
+	float vol[NUM_SINES];
+	for( int i = 0; i < NUM_SINES; ++i )
+	{
+		const int o = i % NUM_OSCILLATORS;
+		const bool left = i < NUM_OSCILLATORS;
+		const float angle = F_2PI * _freq * ( left ?
+			m_osc[o]->m_detuningLeft : m_osc[o]->m_detuningRight );
+		rotRe[i] = cosf( angle );
+		rotIm[i] = sinf( angle );
+		vol[i] = m_osc[o]->m_waveShape.value() != Oscillator::SineWave ?
+			0.0f : left ? m_osc[o]->m_volumeLeft :
+							m_osc[o]->m_volumeRight;
+
+		// undo the rounding errors of the last period
+		const float norm = 1.0f / sqrtf( _osc->sineRe[i] * _osc->sineRe[i] +
+					_osc->sineIm[i] * _osc->sineIm[i] );
+		re[i] = _osc->sineRe[i] * norm;
+		im[i] = _osc->sineIm[i] * norm;
+	}
+
+	for( fpp_t f = 0; f < _frames; ++f )
+	{
+		float out[NUM_SINES];
+		for( int i = 0; i < NUM_SINES; ++i )
+		{
+			out[i] = im[i] * vol[i];
+			const float r = re[i] * rotRe[i] - im[i] * rotIm[i];
+			im[i] = re[i] * rotIm[i] + im[i] * rotRe[i];
+			re[i] = r;
+		}
+		float l = 0.0f;
+		float r = 0.0f;
+		for( int i = 0; i < NUM_OSCILLATORS; ++i )
+		{
+			l += out[i];
+			r += out[NUM_OSCILLATORS + i];
+		}
+		_buf[f][0] = l;
+		_buf[f][1] = r;
+	}
+
+	for( int i = 0; i < NUM_SINES; ++i )
+	{
+		_osc->sineRe[i] = re[i];
+		_osc->sineIm[i] = im[i];
+	}
+}
+
+
+
+
+void organicInstrument::renderOthers( NotePlayHandle * _n, oscPtr * _osc,
+					sampleFrame * _buf, fpp_t _frames )
+{
+	ScratchBuffer<sampleFrame> tmp( _frames );
+	for( int i = 0; i < m_numOscillators; ++i )
+	{
+		if( m_osc[i]->m_waveShape.value() == Oscillator::SineWave )
+		{
+			continue;
+		}
+		if( _osc->oscLeft[i] == NULL )
+		{
+			_osc->oscLeft[i] = new Oscillator(
+					&m_osc[i]->m_waveShape,
+					&m_modulationAlgo,
+					_n->frequency(),
+					m_osc[i]->m_detuningLeft,
+					_osc->phaseOffsetLeft[i],
+					m_osc[i]->m_volumeLeft );
+			_osc->oscRight[i] = new Oscillator(
+					&m_osc[i]->m_waveShape,
+					&m_modulationAlgo,
+					_n->frequency(),
+					m_osc[i]->m_detuningRight,
+					_osc->phaseOffsetRight[i],
+					m_osc[i]->m_volumeRight );
+		}
+		_osc->oscLeft[i]->update( tmp.data(), _frames, 0 );
+		_osc->oscRight[i]->update( tmp.data(), _frames, 1 );
+		for( fpp_t f = 0; f < _frames; ++f )
+		{
+			_buf[f][0] += tmp[f][0];
+			_buf[f][1] += tmp[f][1];
+		}
+	}
 }
 
 /*float inline organicInstrument::foldback(float in, float threshold)
@@ -149,15 +149,30 @@ private:
 
 	OscillatorObject ** m_osc;
 
+	// sine oscillators of the left channel followed by those of the right
+	// one, rendered together by renderSines()
+	static const int NUM_SINES = NUM_OSCILLATORS * 2;
+
 	struct oscPtr
 	{
 		MM_OPERATORS
-		Oscillator * oscLeft;
-		Oscillator * oscRight;
+		// phasors of the sine oscillators, advanced by rotating them
+		float sineRe[NUM_SINES];
+		float sineIm[NUM_SINES];
+		// oscillators with other waveshapes, created once they're needed
+		Oscillator * oscLeft[NUM_OSCILLATORS];
+		Oscillator * oscRight[NUM_OSCILLATORS];
 		float phaseOffsetLeft[NUM_OSCILLATORS];
 		float phaseOffsetRight[NUM_OSCILLATORS];		
 	} ;
 
+	//! Renders all oscillators with a sine waveshape into _buf in one pass
+	void renderSines( oscPtr * _osc, sampleFrame * _buf, fpp_t _frames,
+							float _freq );
+	//! Adds the oscillators with other waveshapes to _buf
+	void renderOthers( NotePlayHandle * _n, oscPtr * _osc,
+					sampleFrame * _buf, fpp_t _frames );
+
 	const IntModel m_modulationAlgo;
 
 	FloatModel  m_fx1Model;
@@ -29,6 +29,7 @@
 #include "PresetPreviewPlayHandle.h"
 #include "PeakController.h"
 #include "peak_controller_effect.h"
+#include "LevelDetector.h"
 #include "lmms_math.h"
 
 #include "embed.h"
@@ -103,26 +104,10 @@ bool PeakControllerEffect::processAudioBuffer( sampleFrame * _buf,
 	}
 
 	// RMS:
-	double sum = 0;
-
-	if( c.m_absModel.value() )
-	{
-		for( int i = 0; i < _frames; ++i )
-		{
-			// absolute value is achieved because the squares are > 0
-			sum += _buf[i][0]*_buf[i][0] + _buf[i][1]*_buf[i][1];
-		}
-	}
-	else
-	{
-		for( int i = 0; i < _frames; ++i )
-		{
-			// the value is absolute because of squaring,
-			// so we need to correct it
-			sum += _buf[i][0] * _buf[i][0] * sign( _buf[i][0] )
-				+ _buf[i][1] * _buf[i][1] * sign( _buf[i][1] );
-		}
-	}
+	// without abs the squares keep the sign of the samples, so it
+	// needs to be corrected
+	const double sum = LevelDetector::sumOfSquares( _buf[0], _frames * DEFAULT_CHANNELS,
+							!c.m_absModel.value() );
 
 	// TODO: flipping this might cause clipping
 	// this will mute the output after the values were measured
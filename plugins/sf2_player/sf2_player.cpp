@@ -31,6 +31,7 @@
 #include "ConfigManager.h"
 #include "FileDialog.h"
 #include "sf2_player.h"
+#include "AutomatableModel.h"
 #include "ConfigManager.h"
 #include "Engine.h"
 #include "InstrumentTrack.h"
@@ -79,6 +80,12 @@ struct SF2PluginData
 } ;
 
 
+static inline SF2PluginData * noteData( NotePlayHandle * _n )
+{
+	return static_cast<SF2PluginData *>( _n->m_pluginData );
+}
+
+
 
 // Static map of current sfonts
 QMap<QString, sf2Font*> sf2Instrument::s_fonts;
@@ -107,7 +114,10 @@ sf2Instrument::sf2Instrument( InstrumentTrack * _instrument_track ) :
 	m_chorusNum( FLUID_CHORUS_DEFAULT_N, 0, 10.0, 1.0, this, tr( "Chorus voices" ) ),
 	m_chorusLevel( FLUID_CHORUS_DEFAULT_LEVEL, 0, 10.0, 0.01, this, tr( "Chorus level" ) ),
 	m_chorusSpeed( FLUID_CHORUS_DEFAULT_SPEED, 0.29, 5.0, 0.01, this, tr( "Chorus speed" ) ),
-	m_chorusDepth( FLUID_CHORUS_DEFAULT_DEPTH, 0, 46.0, 0.05, this, tr( "Chorus depth" ) )
+	m_chorusDepth( FLUID_CHORUS_DEFAULT_DEPTH, 0, 46.0, 0.05, this, tr( "Chorus depth" ) ),
+	m_sharedModel( false, this, tr( "Share engine" ) ),
+	m_shared( NULL ),
+	m_sharedChannel( 0 )
 {
 	for( int i = 0; i < 128; ++i )
 	{
@@ -182,6 +192,8 @@ sf2Instrument::sf2Instrument( InstrumentTrack * _instrument_track ) :
 	connect( &m_chorusSpeed, SIGNAL( dataChanged() ), this, SLOT( updateChorus() ) );
 	connect( &m_chorusDepth, SIGNAL( dataChanged() ), this, SLOT( updateChorus() ) );
 
+	connect( &m_sharedModel, SIGNAL( dataChanged() ), this, SLOT( updateSharing() ) );
+
 	InstrumentPlayHandle * iph = new InstrumentPlayHandle( this, _instrument_track );
 	Engine::mixer()->addPlayHandle( iph );
 }
@@ -224,6 +236,8 @@ void sf2Instrument::saveSettings( QDomDocument & _doc, QDomElement & _this )
 	m_chorusLevel.saveSettings( _doc, _this, "chorusLevel" );
 	m_chorusSpeed.saveSettings( _doc, _this, "chorusSpeed" );
 	m_chorusDepth.saveSettings( _doc, _this, "chorusDepth" );
+
+	m_sharedModel.saveSettings( _doc, _this, "shared" );
 }
 
 
@@ -231,6 +245,9 @@ void sf2Instrument::saveSettings( QDomDocument & _doc, QDomElement & _this )
 
 void sf2Instrument::loadSettings( const QDomElement & _this )
 {
+	// before opening the file, which joins the shared engine
+	m_sharedModel.loadSettings( _this, "shared" );
+
 	openFile( _this.attribute( "src" ), false );
 	m_patchNum.loadSettings( _this, "patch" );
 	m_bankNum.loadSettings( _this, "bank" );
@@ -335,6 +352,8 @@ QString sf2Instrument::nodeName() const
 
 void sf2Instrument::freeFont()
 {
+	leaveShared();
+
 	m_synthMutex.lock();
 
 	if ( m_font != NULL )
@@ -422,6 +441,11 @@ void sf2Instrument::openFile( const QString & _sf2File, bool updateTrackName )
 		//m_bankNum.setValue( 0 );
 		m_filename = relativePath;
 
+		if( m_sharedModel.value() )
+		{
+			joinShared();
+		}
+
 		emit fileChanged();
 	}
 
@@ -442,7 +466,115 @@ void sf2Instrument::updatePatch()
 	{
 		fluid_synth_program_select( m_synth, m_channel, m_fontId,
 				m_bankNum.value(), m_patchNum.value() );
+
+		// the own synth keeps the patch too, e.g. for the patch dialog
+		if( m_shared != NULL )
+		{
+			fluid_synth_program_select( m_shared->synth(),
+					m_sharedChannel, m_shared->fontId(),
+					m_bankNum.value(), m_patchNum.value() );
+		}
+	}
+}
+
+
+
+
+void sf2Instrument::updateSharing()
+{
+	leaveShared();
+	if( m_sharedModel.value() )
+	{
+		joinShared();
+	}
+}
+
+
+
+
+void sf2Instrument::joinShared()
+{
+	m_synthMutex.lock();
+	s_fontsMutex.lock();
+
+	if( m_font != NULL && m_shared == NULL )
+	{
+		if( m_font->shared == NULL )
+		{
+			m_font->shared = new sf2SharedSynth( m_font->fluidFont );
+		}
+
+		// without a free channel we keep using our own synth
+		const int channel = m_font->shared->join( this );
+		if( channel >= 0 )
+		{
+			m_shared = m_font->shared;
+			m_sharedChannel = channel;
+		}
+		else if( m_font->shared->isEmpty() )
+		{
+			delete m_font->shared;
+			m_font->shared = NULL;
+		}
+	}
+
+	s_fontsMutex.unlock();
+	m_synthMutex.unlock();
+
+	// pitch and patch are per channel
+	m_lastMidiPitch = -1;
+	m_lastMidiPitchRange = -1;
+	updatePatch();
+}
+
+
+
+
+void sf2Instrument::leaveShared()
+{
+	m_synthMutex.lock();
+	s_fontsMutex.lock();
+
+	if( m_shared != NULL )
+	{
+		m_shared->leave( m_sharedChannel );
+		if( m_shared->isEmpty() )
+		{
+			m_font->shared = NULL;
+			delete m_shared;
+		}
+		m_shared = NULL;
 	}
+
+	s_fontsMutex.unlock();
+	m_synthMutex.unlock();
+
+	m_lastMidiPitch = -1;
+	m_lastMidiPitchRange = -1;
+}
+
+
+
+
+fluid_synth_t * sf2Instrument::synth()
+{
+	return m_shared != NULL ? m_shared->synth() : m_synth;
+}
+
+
+
+
+QMutex * sf2Instrument::synthMutex()
+{
+	return m_shared != NULL ? m_shared->mutex() : &m_synthMutex;
+}
+
+
+
+
+int sf2Instrument::channel() const
+{
+	return m_shared != NULL ? m_sharedChannel : m_channel;
 }
 
 
@@ -538,6 +670,9 @@ void  sf2Instrument::updateChorus()
 
 void sf2Instrument::updateSampleRate()
 {
+	// the shared engine gets recreated by the first player rejoining it
+	leaveShared();
+
 	double tempRate;
 
 	// Set & get, returns the true sample rate
@@ -605,6 +740,11 @@ void sf2Instrument::updateSampleRate()
 	// upon playing the next note
 	m_lastMidiPitch = -1;
 	m_lastMidiPitchRange = -1;
+
+	if( m_sharedModel.value() )
+	{
+		joinShared();
+	}
 }
 
 
@@ -663,14 +803,16 @@ void sf2Instrument::playNote( NotePlayHandle * _n, sampleFrame * )
 
 void sf2Instrument::noteOn( SF2PluginData * n )
 {
-	m_synthMutex.lock();
+	QMutex * mutex = synthMutex();
+	fluid_synth_t * fluidSynth = synth();
+	mutex->lock();
 
 	// get list of current voice IDs so we can easily spot the new
 	// voice after the fluid_synth_noteon() call
-	const int poly = fluid_synth_get_polyphony( m_synth );
+	const int poly = fluid_synth_get_polyphony( fluidSynth );
 	fluid_voice_t * voices[poly];
 	unsigned int id[poly];
-	fluid_synth_get_voicelist( m_synth, voices, poly, -1 );
+	fluid_synth_get_voicelist( fluidSynth, voices, poly, -1 );
 	for( int i = 0; i < poly; ++i )
 	{
 		id[i] = 0;
@@ -680,10 +822,10 @@ void sf2Instrument::noteOn( SF2PluginData * n )
 		id[i] = fluid_voice_get_id( voices[i] );
 	}
 
-	fluid_synth_noteon( m_synth, m_channel, n->midiNote, n->lastVelocity );
+	fluid_synth_noteon( fluidSynth, channel(), n->midiNote, n->lastVelocity );
 
 	// get new voice and save it
-	fluid_synth_get_voicelist( m_synth, voices, poly, -1 );
+	fluid_synth_get_voicelist( fluidSynth, voices, poly, -1 );
 	for( int i = 0; i < poly && voices[i]; ++i )
 	{
 		const unsigned int newID = fluid_voice_get_id( voices[i] );
@@ -694,7 +836,7 @@ void sf2Instrument::noteOn( SF2PluginData * n )
 		}
 	}
 
-	m_synthMutex.unlock();
+	mutex->unlock();
 
 	m_notesRunningMutex.lock();
 	++m_notesRunning[ n->midiNote ];
@@ -711,35 +853,108 @@ void sf2Instrument::noteOff( SF2PluginData * n )
 
 	if( notes <= 0 )
 	{
-		m_synthMutex.lock();
-		fluid_synth_noteoff( m_synth, m_channel, n->midiNote );
-		m_synthMutex.unlock();
+		QMutex * mutex = synthMutex();
+		mutex->lock();
+		fluid_synth_noteoff( synth(), channel(), n->midiNote );
+		mutex->unlock();
 	}
 }
 
 
-void sf2Instrument::play( sampleFrame * _working_buffer )
+void sf2Instrument::updatePitch()
 {
-	const fpp_t frames = Engine::mixer()->framesPerPeriod();
-
 	// set midi pitch for this period
 	const int currentMidiPitch = instrumentTrack()->midiPitch();
 	if( m_lastMidiPitch != currentMidiPitch )
 	{
 		m_lastMidiPitch = currentMidiPitch;
-		m_synthMutex.lock();
-		fluid_synth_pitch_bend( m_synth, m_channel, m_lastMidiPitch );
-		m_synthMutex.unlock();
+		synthMutex()->lock();
+		fluid_synth_pitch_bend( synth(), channel(), m_lastMidiPitch );
+		synthMutex()->unlock();
 	}
 
 	const int currentMidiPitchRange = instrumentTrack()->midiPitchRange();
 	if( m_lastMidiPitchRange != currentMidiPitchRange )
 	{
 		m_lastMidiPitchRange = currentMidiPitchRange;
-		m_synthMutex.lock();
-		fluid_synth_pitch_wheel_sens( m_synth, m_channel, m_lastMidiPitchRange );
-		m_synthMutex.unlock();
+		synthMutex()->lock();
+		fluid_synth_pitch_wheel_sens( synth(), channel(), m_lastMidiPitchRange );
+		synthMutex()->unlock();
 	}
+}
+
+
+NotePlayHandle * sf2Instrument::firstNote()
+{
+	QMutexLocker lock( &m_playingNotesMutex );
+
+	NotePlayHandle * first = NULL;
+	for( NotePlayHandle * note : m_playingNotes )
+	{
+		if( first == NULL || noteData( first )->offset >
+						noteData( note )->offset )
+		{
+			first = note;
+		}
+	}
+	return first;
+}
+
+
+void sf2Instrument::processNote( NotePlayHandle * n )
+{
+	SF2PluginData * data = noteData( n );
+	if( data->isNew )
+	{
+		noteOn( data );
+		if( n->isReleased() ) // if the note is released during the same period, we have to process it again for noteoff
+		{
+			data->isNew = false;
+			data->offset = n->framesBeforeRelease();
+			return;
+		}
+	}
+	else
+	{
+		noteOff( data );
+	}
+
+	// otherwise remove the handle
+	m_playingNotesMutex.lock();
+	m_playingNotes.remove( m_playingNotes.indexOf( n ) );
+	m_playingNotesMutex.unlock();
+}
+
+
+void sf2Instrument::play( sampleFrame * _working_buffer )
+{
+	const fpp_t frames = Engine::mixer()->framesPerPeriod();
+
+	m_synthMutex.lock();
+	sf2SharedSynth * shared = m_shared;
+	if( shared != NULL )
+	{
+		// our notes and pitch are processed by whichever player of the
+		// engine renders the period first
+		shared->render( m_sharedChannel, _working_buffer );
+	}
+	m_synthMutex.unlock();
+
+	if( shared != NULL )
+	{
+		// the shared engine runs at unity gain
+		const float gain = m_gain.value();
+		for( fpp_t f = 0; f < frames; ++f )
+		{
+			_working_buffer[f][0] *= gain;
+			_working_buffer[f][1] *= gain;
+		}
+		instrumentTrack()->processAudioBuffer( _working_buffer, frames, NULL );
+		return;
+	}
+
+	updatePitch();
+
 	// if we have no new noteons/noteoffs, just render a period and call it a day
 	if( m_playingNotes.isEmpty() )
 	{
@@ -752,50 +967,18 @@ void sf2Instrument::play( sampleFrame * _working_buffer )
 	// go through noteplayhandles in processing order
 	f_cnt_t currentFrame = 0;
 
-	while( ! m_playingNotes.isEmpty() )
+	for( NotePlayHandle * currentNote = firstNote(); currentNote != NULL;
+						currentNote = firstNote() )
 	{
-		// find the note with lowest offset
-		NotePlayHandle * currentNote = m_playingNotes[0];
-		for( int i = 1; i < m_playingNotes.size(); ++i )
-		{
-			SF2PluginData * currentData = static_cast<SF2PluginData *>( currentNote->m_pluginData );
-			SF2PluginData * iData = static_cast<SF2PluginData *>( m_playingNotes[i]->m_pluginData );
-			if( currentData->offset > iData->offset )
-			{
-				currentNote = m_playingNotes[i];
-			}
-		}
-
 		// process the current note:
 		// first see if we're synced in frame count
-		SF2PluginData * currentData = static_cast<SF2PluginData *>( currentNote->m_pluginData );
+		SF2PluginData * currentData = noteData( currentNote );
 		if( currentData->offset > currentFrame )
 		{
 			renderFrames( currentData->offset - currentFrame, _working_buffer + currentFrame );
 			currentFrame = currentData->offset;
 		}
-		if( currentData->isNew )
-		{
-			noteOn( currentData );
-			if( currentNote->isReleased() ) // if the note is released during the same period, we have to process it again for noteoff
-			{
-				currentData->isNew = false;
-				currentData->offset = currentNote->framesBeforeRelease();
-			}
-			else // otherwise remove the handle
-			{
-				m_playingNotesMutex.lock();
-				m_playingNotes.remove( m_playingNotes.indexOf( currentNote ) );
-				m_playingNotesMutex.unlock();
-			}
-		}
-		else
-		{
-			noteOff( currentData );
-			m_playingNotesMutex.lock();
-			m_playingNotes.remove( m_playingNotes.indexOf( currentNote ) );
-			m_playingNotesMutex.unlock();
-		}
+		processNote( currentNote );
 	}
 
 	if( currentFrame < frames )
@@ -870,6 +1053,276 @@ void sf2Instrument::deleteNotePluginData( NotePlayHandle * _n )
 
 
 
+//! Processes the notes of _track queued for the current stage, like
+//! InstrumentPlayHandle::play() does for its own track. Notes of tracks
+//! rendered in another stage, i.e. ahead or not, are done already or not
+//! queued yet.
+static void processQueuedNotes( InstrumentTrack * _track )
+{
+	ConstNotePlayHandleList nphv = NotePlayHandle::nphsOfInstrumentTrack( _track, true );
+
+	bool nphsLeft;
+	do
+	{
+		nphsLeft = false;
+		for( const NotePlayHandle * constNotePlayHandle : nphv )
+		{
+			NotePlayHandle * notePlayHandle = const_cast<NotePlayHandle *>( constNotePlayHandle );
+			const ThreadableJob::ProcessingState state = notePlayHandle->state();
+			if( ( state == ThreadableJob::ProcessingState::Queued ||
+				state == ThreadableJob::ProcessingState::InProgress ) &&
+					!notePlayHandle->isFinished() )
+			{
+				nphsLeft = true;
+				notePlayHandle->process();
+			}
+		}
+	}
+	while( nphsLeft );
+}
+
+
+
+
+sf2SharedSynth::sf2SharedSynth( fluid_sfont_t * _font ) :
+	m_font( _font ),
+	m_settings( new_fluid_settings() ),
+	m_synth( NULL ),
+	m_fontId( -1 ),
+	m_sampleRate( 0 ),
+	m_usable( false ),
+	m_frames( 0 ),
+	m_period( -1 ),
+	m_mutex( QMutex::Recursive )
+{
+	for( int i = 0; i < Channels; ++i )
+	{
+		m_players[i] = NULL;
+	}
+
+	// a stereo output of its own for every MIDI channel
+	fluid_settings_setint( m_settings, (char *) "synth.midi-channels", Channels );
+	fluid_settings_setint( m_settings, (char *) "synth.audio-channels", Channels );
+	fluid_settings_setint( m_settings, (char *) "synth.audio-groups", Channels );
+
+	createSynth();
+}
+
+
+
+
+sf2SharedSynth::~sf2SharedSynth()
+{
+	// the font belongs to the synths of the players
+	fluid_synth_remove_sfont( m_synth, m_font );
+	delete_fluid_synth( m_synth );
+	delete_fluid_settings( m_settings );
+}
+
+
+
+
+int sf2SharedSynth::join( sf2Instrument * _player )
+{
+	QMutexLocker lock( &m_mutex );
+
+	if( m_sampleRate != Engine::mixer()->processingSampleRate() )
+	{
+		// the other players rejoin on the sample rate change as well
+		createSynth();
+	}
+
+	if( !m_usable )
+	{
+		return -1;
+	}
+
+	for( int i = 0; i < Channels; ++i )
+	{
+		if( m_players[i] == NULL )
+		{
+			m_players[i] = _player;
+			return i;
+		}
+	}
+	return -1;
+}
+
+
+
+
+void sf2SharedSynth::leave( int _channel )
+{
+	QMutexLocker lock( &m_mutex );
+
+	fluid_synth_all_sounds_off( m_synth, _channel );
+	m_players[_channel] = NULL;
+}
+
+
+
+
+bool sf2SharedSynth::isEmpty()
+{
+	QMutexLocker lock( &m_mutex );
+
+	for( sf2Instrument * player : m_players )
+	{
+		if( player != NULL )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+
+void sf2SharedSynth::render( int _channel, sampleFrame * _buf )
+{
+	const long period = AutomatableModel::periodCounter();
+
+	QMutexLocker lock( &m_mutex );
+
+	if( m_period != period )
+	{
+		renderPeriod();
+		m_period = period;
+	}
+
+	const fpp_t frames = qMin( m_frames, Engine::mixer()->framesPerPeriod() );
+	const float * left = m_left.data() + _channel * m_frames;
+	const float * right = m_right.data() + _channel * m_frames;
+	for( fpp_t f = 0; f < frames; ++f )
+	{
+		_buf[f][0] = left[f];
+		_buf[f][1] = right[f];
+	}
+}
+
+
+
+
+void sf2SharedSynth::createSynth()
+{
+	if( m_synth != NULL )
+	{
+		fluid_synth_remove_sfont( m_synth, m_font );
+		delete_fluid_synth( m_synth );
+	}
+
+	double tempRate;
+	m_sampleRate = Engine::mixer()->processingSampleRate();
+	fluid_settings_setnum( m_settings, (char *) "synth.sample-rate", m_sampleRate );
+	fluid_settings_getnum( m_settings, (char *) "synth.sample-rate", &tempRate );
+
+	// players don't share an engine they'd have to resample, they keep
+	// their own synth instead
+	m_usable = static_cast<sample_rate_t>( tempRate ) == m_sampleRate;
+#if FLUIDSYNTH_VERSION_MAJOR < 2
+	// older versions drop the rest of a block which is rendered partly,
+	// as it happens between the notes of a period
+	m_usable = false;
+#endif
+
+	m_synth = new_fluid_synth( m_settings );
+	m_fontId = fluid_synth_add_sfont( m_synth, m_font );
+
+	if( Engine::mixer()->currentQualitySettings().interpolation >=
+			Mixer::qualitySettings::Interpolation_SincFastest )
+	{
+		fluid_synth_set_interp_method( m_synth, -1, FLUID_INTERP_7THORDER );
+	}
+	else
+	{
+		fluid_synth_set_interp_method( m_synth, -1, FLUID_INTERP_DEFAULT );
+	}
+
+	// the effects would be shared by all channels, the gain is applied by
+	// every player to its channel
+	fluid_synth_set_reverb_on( m_synth, 0 );
+	fluid_synth_set_chorus_on( m_synth, 0 );
+	fluid_synth_set_gain( m_synth, 1.0f );
+
+	m_frames = Engine::mixer()->framesPerPeriod();
+	m_left.assign( Channels * m_frames, 0.0f );
+	m_right.assign( Channels * m_frames, 0.0f );
+	m_period = -1;
+}
+
+
+
+
+void sf2SharedSynth::renderPeriod()
+{
+	// the notes of all players have to be queued and their pitch has to
+	// be set before rendering
+	for( sf2Instrument * player : m_players )
+	{
+		if( player != NULL )
+		{
+			processQueuedNotes( player->instrumentTrack() );
+			player->updatePitch();
+		}
+	}
+
+	// go through the notes of all players in processing order
+	f_cnt_t currentFrame = 0;
+	while( true )
+	{
+		sf2Instrument * player = NULL;
+		NotePlayHandle * note = NULL;
+		for( sf2Instrument * p : m_players )
+		{
+			NotePlayHandle * n = p != NULL ? p->firstNote() : NULL;
+			if( n != NULL && ( note == NULL ||
+				noteData( n )->offset < noteData( note )->offset ) )
+			{
+				player = p;
+				note = n;
+			}
+		}
+
+		if( note == NULL )
+		{
+			break;
+		}
+
+		const f_cnt_t offset = qMin<f_cnt_t>( noteData( note )->offset, m_frames );
+		if( offset > currentFrame )
+		{
+			renderFrames( currentFrame, offset - currentFrame );
+			currentFrame = offset;
+		}
+		player->processNote( note );
+	}
+
+	if( currentFrame < m_frames )
+	{
+		renderFrames( currentFrame, m_frames - currentFrame );
+	}
+}
+
+
+
+
+void sf2SharedSynth::renderFrames( f_cnt_t _start, f_cnt_t _frames )
+{
+	float * left[Channels];
+	float * right[Channels];
+	for( int i = 0; i < Channels; ++i )
+	{
+		left[i] = m_left.data() + i * m_frames + _start;
+		right[i] = m_right.data() + i * m_frames + _start;
+	}
+
+	fluid_synth_nwrite_float( m_synth, _frames, left, right, NULL, NULL );
+}
+
+
+
+
 PluginView * sf2Instrument::instantiateView( QWidget * _parent )
 {
 	return new sf2InstrumentView( this, _parent );
@@ -1026,6 +1479,13 @@ sf2InstrumentView::sf2InstrumentView( Instrument * _instrument, QWidget * _paren
 	m_chorusDepthKnob = new sf2Knob( this );
 	m_chorusDepthKnob->setHintText( tr("Depth:"), "" );
 	m_chorusDepthKnob->move( 204 , 206 );
+
+	m_sharedLed = new LedCheckBox( tr( "SHARE" ), this,
+					tr( "Share engine" ), LedCheckBox::Green );
+	m_sharedLed->move( 14, 142 );
+	ToolTip::add( m_sharedLed, tr( "Play through one engine together with "
+				"the other players of this SoundFont which share "
+				"theirs (no reverb and chorus)" ) );
 /*
 	hl->addWidget( m_chorusOnLed );
 	hl->addWidget( m_chorusNumKnob);
@@ -1073,6 +1533,8 @@ void sf2InstrumentView::modelChanged()
 	m_chorusSpeedKnob->setModel( &k->m_chorusSpeed );
 	m_chorusDepthKnob->setModel( &k->m_chorusDepth );
 
+	m_sharedLed->setModel( &k->m_sharedModel );
+
 
 	connect( k, SIGNAL( fileChanged() ), this, SLOT( updateFilename() ) );
 
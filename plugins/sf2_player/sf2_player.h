@@ -30,6 +30,8 @@
 #include <QMutex>
 #include <samplerate.h>
 
+#include <vector>
+
 #include "Instrument.h"
 #include "PixmapButton.h"
 #include "InstrumentView.h"
@@ -41,6 +43,7 @@
 
 class sf2InstrumentView;
 class sf2Font;
+class sf2SharedSynth;
 class NotePlayHandle;
 
 class patchesDialog;
@@ -96,6 +99,7 @@ public slots:
 	void openFile( const QString & _sf2File, bool updateTrackName = true );
 	void updatePatch();
 	void updateSampleRate();
+	void updateSharing();
 	
 	// We can't really support sample-exact with the way IPH and FS work.
 	// So, sig/slots work just fine for the synth settings right now.
@@ -154,13 +158,33 @@ private:
 	QVector<NotePlayHandle *> m_playingNotes;
 	QMutex m_playingNotesMutex;
 
+	// play through the shared engine of the font if possible
+	BoolModel m_sharedModel;
+	// engine and its channel the notes go to while sharing one
+	sf2SharedSynth * m_shared;
+	int m_sharedChannel;
+
 private:
 	void freeFont();
+	void joinShared();
+	void leaveShared();
+
+	//! Synth, its mutex and the channel notes are played on
+	fluid_synth_t * synth();
+	QMutex * synthMutex();
+	int channel() const;
+
 	void noteOn( SF2PluginData * n );
 	void noteOff( SF2PluginData * n );
+	void updatePitch();
+	//! Queued note with the lowest offset, NULL if there's none
+	NotePlayHandle * firstNote();
+	//! Sends note on or off of a queued note
+	void processNote( NotePlayHandle * n );
 	void renderFrames( f_cnt_t frames, sampleFrame * buf );
 
 	friend class sf2InstrumentView;
+	friend class sf2SharedSynth;
 
 signals:
 	void fileLoading();
@@ -178,15 +202,86 @@ class sf2Font
 public:
 	sf2Font( fluid_sfont_t * f ) :
 		fluidFont( f ),
-		refCount( 1 )
+		refCount( 1 ),
+		shared( NULL )
 	{};
 
 	fluid_sfont_t * fluidFont;
 	int refCount;
+	// engine of the players sharing one, NULL if there's none
+	sf2SharedSynth * shared;
 };
 
 
 
+//! One fluid_synth for all players of a font which share their engine,
+//! every player gets a MIDI channel and an audio channel of its own. The
+//! first player playing in a period renders the notes of all of them and
+//! the others only pick up their channel. Reverb and chorus can't be split
+//! per channel and are turned off.
+class sf2SharedSynth
+{
+	MM_OPERATORS
+public:
+	static const int Channels = 16;
+
+	sf2SharedSynth( fluid_sfont_t * _font );
+	~sf2SharedSynth();
+
+	//! Channel of the new player, -1 if all channels are taken or the
+	//! engine can't run at the rate of the mixer
+	int join( sf2Instrument * _player );
+	void leave( int _channel );
+	bool isEmpty();
+
+	fluid_synth_t * synth()
+	{
+		return m_synth;
+	}
+
+	QMutex * mutex()
+	{
+		return &m_mutex;
+	}
+
+	int fontId() const
+	{
+		return m_fontId;
+	}
+
+	//! The current period of _channel, renders the period of all
+	//! channels first if no player did so yet
+	void render( int _channel, sampleFrame * _buf );
+
+
+private:
+	void createSynth();
+	void renderPeriod();
+	void renderFrames( f_cnt_t _start, f_cnt_t _frames );
+
+	fluid_sfont_t * m_font;
+	fluid_settings_t * m_settings;
+	fluid_synth_t * m_synth;
+	int m_fontId;
+	sample_rate_t m_sampleRate;
+	// false if fluidsynth doesn't render at the rate of the mixer
+	bool m_usable;
+
+	sf2Instrument * m_players[Channels];
+
+	// output of the current period, one channel after the other
+	fpp_t m_frames;
+	std::vector<float> m_left;
+	std::vector<float> m_right;
+	long m_period;
+
+	// recursive, notes are played by the player rendering the period
+	QMutex m_mutex;
+
+} ;
+
+
+
 class sf2InstrumentView : public InstrumentViewFixedSize
 {
 	Q_OBJECT
@@ -221,6 +316,8 @@ private:
 	Knob * m_chorusSpeedKnob;
 	Knob * m_chorusDepthKnob;
 
+	LedCheckBox * m_sharedLed;
+
 	static patchesDialog * s_patchDialog;
 
 protected slots:
@@ -324,6 +324,15 @@ bool SfxrSynth::isPlaying() const
 
 
 
+bool SfxrSynth::render( sampleFrame * _buf, fpp_t _frames )
+{
+	update( _buf, _frames );
+	return isPlaying();
+}
+
+
+
+
 sfxrInstrument::sfxrInstrument( InstrumentTrack * _instrument_track ) :
 	Instrument( _instrument_track, &sfxr_plugin_descriptor ),
 	m_attModel(0.0f, this, "Attack Time"),
@@ -461,9 +470,24 @@ void sfxrInstrument::playNote( NotePlayHandle * _n, sampleFrame * _working_buffe
     const f_cnt_t offset = _n->noteOffset();
 	if ( _n->totalFramesPlayed() == 0 || _n->m_pluginData == NULL )
 	{
-		_n->m_pluginData = new SfxrSynth( this );
+		// the synth's output doesn't depend on the note, which only
+		// changes the rate it's played back at below
+		OneShotCache::Key key;
+		key << m_attModel.value() << m_holdModel.value() << m_susModel.value()
+			<< m_decModel.value() << m_startFreqModel.value() << m_minFreqModel.value()
+			<< m_slideModel.value() << m_dSlideModel.value() << m_vibDepthModel.value()
+			<< m_vibSpeedModel.value() << m_changeAmtModel.value() << m_changeSpeedModel.value()
+			<< m_sqrDutyModel.value() << m_sqrSweepModel.value() << m_repeatSpeedModel.value()
+			<< m_phaserOffsetModel.value() << m_phaserSweepModel.value() << m_lpFilCutModel.value()
+			<< m_lpFilCutSweepModel.value() << m_lpFilResoModel.value() << m_hpFilCutModel.value()
+			<< m_hpFilCutSweepModel.value() << m_waveFormModel.value();
+
+		// noise is random, so it's rendered every time
+		_n->m_pluginData = new OneShotCache::Voice(
+				m_waveFormModel.value() == 3 ? NULL : &m_cache, key,
+							new SfxrSynth( this ) );
 	}
-	else if( static_cast<SfxrSynth*>(_n->m_pluginData)->isPlaying() == false )
+	else if( static_cast<OneShotCache::Voice*>(_n->m_pluginData)->isPlaying() == false )
 	{
 		memset(_working_buffer + offset, 0, sizeof(sampleFrame) * frameNum);
 		_n->noteOff();
@@ -478,7 +502,7 @@ void sfxrInstrument::playNote( NotePlayHandle * _n, sampleFrame * _working_buffe
 //	qDebug( "pFN %d", pitchedFrameNum );
 
 	sampleFrame * pitchedBuffer = new sampleFrame[pitchedFrameNum];
-	static_cast<SfxrSynth*>(_n->m_pluginData)->update( pitchedBuffer, pitchedFrameNum );
+	static_cast<OneShotCache::Voice*>(_n->m_pluginData)->render( pitchedBuffer, pitchedFrameNum );
 	for( fpp_t i=0; i<frameNum; i++ )
 	{
 		for( ch_cnt_t j=0; j<DEFAULT_CHANNELS; j++ )
@@ -500,7 +524,7 @@ void sfxrInstrument::playNote( NotePlayHandle * _n, sampleFrame * _working_buffe
 
 void sfxrInstrument::deleteNotePluginData( NotePlayHandle * _n )
 {
-	delete static_cast<SfxrSynth *>( _n->m_pluginData );
+	delete static_cast<OneShotCache::Voice *>( _n->m_pluginData );
 }
 
 
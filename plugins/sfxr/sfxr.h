@@ -35,6 +35,7 @@
 #include "PixmapButton.h"
 #include "LedCheckbox.h"
 #include "MemoryManager.h"
+#include "OneShotCache.h"
 
 
 enum SfxrWaves
@@ -68,7 +69,7 @@ class sfxrInstrument;
 
 
 
-class SfxrSynth
+class SfxrSynth : public OneShotCache::Renderer
 {
 	MM_OPERATORS
 public:
@@ -80,6 +81,8 @@ public:
 
 	bool isPlaying() const;
 
+	virtual bool render( sampleFrame * _buf, fpp_t _frames );
+
 private:
 	const sfxrInstrument * s;
 	bool playing_sample;
@@ -217,6 +220,10 @@ private:
 
 	IntModel m_waveFormModel;
 
+	// sounds rendered before at the synth's own rate, declared last so
+	// background renders are done before the models go away
+	OneShotCache m_cache;
+
 	friend class sfxrInstrumentView;
 	friend class SfxrSynth;
 };
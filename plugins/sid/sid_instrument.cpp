@@ -33,9 +33,12 @@
 #include "sid.h"
 
 #include "sid_instrument.h"
+#include "ComboBox.h"
 #include "Engine.h"
+#include "InstrumentPlayHandle.h"
 #include "InstrumentTrack.h"
 #include "Knob.h"
+#include "LedCheckbox.h"
 #include "Mixer.h"
 #include "NotePlayHandle.h"
 #include "PixmapButton.h"
@@ -68,6 +71,27 @@ static const char *decRelTime[16] = { "6 ms", "24 ms", "48 ms", "72 ms",
 static const int relTime[16] = { 6, 24, 48, 72, 114, 168, 204, 240, 300, 750,
 								1500, 2400, 3000, 9000, 15000, 24000 };
 
+// reSID's sampling methods by sidInstrument::SamplingMethods
+static const sampling_method samplingMethods[sidInstrument::NumSamplingMethods] =
+	{ SAMPLE_FAST, SAMPLE_INTERPOLATE,
+	  SAMPLE_RESAMPLE_FAST, SAMPLE_RESAMPLE_INTERPOLATE };
+
+
+// a chip along with the sampling parameters it was set up for, as setting
+// them up is expensive for the resampling methods
+struct sidChip
+{
+	sidChip() :
+		sampling( -1 ),
+		sampleRate( 0 )
+	{
+	}
+
+	cSID sid;
+	int sampling;
+	int sampleRate;
+} ;
+
 
 extern "C"
 {
@@ -140,6 +164,10 @@ sidInstrument::sidInstrument( InstrumentTrack * _instrument_track ) :
 
 sidInstrument::~sidInstrument()
 {
+	Engine::mixer()->removePlayHandlesOfTypes( instrumentTrack(),
+				PlayHandle::TypeNotePlayHandle
+				| PlayHandle::TypeInstrumentPlayHandle );
+	delete m_sharedChip;
 }
 
 
@@ -184,6 +212,8 @@ void sidInstrument::saveSettings( QDomDocument & _doc,
 	m_voice3OffModel.saveSettings( _doc, _this, "voice3Off" );
 	m_volumeModel.saveSettings( _doc, _this, "volume" );
 	m_chipModel.saveSettings( _doc, _this, "chipModel" );
+	m_samplingModel.saveSettings( _doc, _this, "sampling" );
+	m_sharedChipModel.saveSettings( _doc, _this, "sharedChip" );
 }
 
 
@@ -218,6 +248,8 @@ void sidInstrument::loadSettings( const QDomElement & _this )
 	m_voice3OffModel.loadSettings( _this, "voice3Off" );
 	m_volumeModel.loadSettings( _this, "volume" );
 	m_chipModel.loadSettings( _this, "chipModel" );
+	m_samplingModel.loadSettings( _this, "sampling" );
+	m_sharedChipModel.loadSettings( _this, "sharedChip" );
 }
 
 
@@ -302,106 +334,70 @@ static int sid_fillbuffer(unsigned char* sidreg, cSID *sid, int tdelta, short *p
 
 
 
-void sidInstrument::playNote( NotePlayHandle * _n,
-						sampleFrame * _working_buffer )
+void sidInstrument::writeVoiceRegisters( unsigned char * _sidreg, int _voice,
+						float _freq, bool _gate ) const
 {
-	const f_cnt_t tfp = _n->totalFramesPlayed();
+	const reg8 base = _voice*7;
+	reg8 data8 = 0;
+	reg8 data16 = 0;
 
-	const int clockrate = C64_PAL_CYCLES_PER_SEC;
-	const int samplerate = Engine::mixer()->processingSampleRate();
+	// freq ( Fn = Fout / Fclk * 16777216 ) + coarse detuning
+	float note = 69.0 + 12.0 * log( _freq / 440.0 ) / log( 2 );
+	note += m_voice[_voice]->m_coarseModel.value();
+	const float freq = 440.0 * pow( 2.0, (note-69.0)/12.0 );
+	data16 = int( freq / float(C64_PAL_CYCLES_PER_SEC) * 16777216.0 );
 
-	if ( tfp == 0 )
-	{
-		cSID *sid = new cSID();
-		sid->set_sampling_parameters( clockrate, SAMPLE_FAST, samplerate );
-		sid->set_chip_model( MOS8580 );
-		sid->enable_filter( true );
-		sid->reset();
-		_n->m_pluginData = sid;
+	_sidreg[base+0] = data16&0x00FF;
+	_sidreg[base+1] = (data16>>8)&0x00FF;
+	// pw
+	data16 = (int)m_voice[_voice]->m_pulseWidthModel.value();
+	
+	_sidreg[base+2] = data16&0x00FF;
+	_sidreg[base+3] = (data16>>8)&0x000F;
+	// control: wave form, (test), ringmod, sync, gate
+	data8 = _gate?1:0;
+	data8 += m_voice[_voice]->m_syncModel.value()?2:0;
+	data8 += m_voice[_voice]->m_ringModModel.value()?4:0;
+	data8 += m_voice[_voice]->m_testModel.value()?8:0;
+	switch( m_voice[_voice]->m_waveFormModel.value() )
+	{	
+		default: break;
+		case voiceObject::NoiseWave:	data8 += 128; break;
+		case voiceObject::SquareWave:	data8 += 64; break;
+		case voiceObject::SawWave:		data8 += 32; break;
+		case voiceObject::TriangleWave:	data8 += 16; break;
 	}
-	const fpp_t frames = _n->framesLeftForCurrentPeriod();
-	const f_cnt_t offset = _n->noteOffset();
+	_sidreg[base+4] = data8&0x00FF;
+	// ad
+	data16 = (int)m_voice[_voice]->m_attackModel.value();
 
-	cSID *sid = static_cast<cSID *>( _n->m_pluginData );
-	int delta_t = clockrate * frames / samplerate + 4;
-	// avoid variable length array for msvc compat
-	short* buf = reinterpret_cast<short*>(_working_buffer + offset);
-	unsigned char sidreg[NUMSIDREGS];
+	data8 = (data16&0x0F)<<4;
+	data16 = (int)m_voice[_voice]->m_decayModel.value();
 
-	for (int c = 0; c < NUMSIDREGS; c++)
-	{
-		sidreg[c] = 0x00;
-	}
+	data8 += (data16&0x0F);
+	_sidreg[base+5] = data8&0x00FF;
+	// sr
+	data16 = (int)m_voice[_voice]->m_sustainModel.value();
 
-	if( (ChipModel)m_chipModel.value() == sidMOS6581 )
-	{
-		sid->set_chip_model( MOS6581 );
-	}
-	else
-	{
-		sid->set_chip_model( MOS8580 );
-	}
+	data8 = (data16&0x0F)<<4;
+	data16 = (int)m_voice[_voice]->m_releaseModel.value();
 
-	// voices
-	reg8 data8 = 0;
-	reg8 data16 = 0;
-	reg8 base = 0;
-	float freq = 0.0;
-	float note = 0.0;
-	for( reg8 i = 0 ; i < 3 ; ++i )
-	{
-		base = i*7;
-		// freq ( Fn = Fout / Fclk * 16777216 ) + coarse detuning
-		freq = _n->frequency();
-		note = 69.0 + 12.0 * log( freq / 440.0 ) / log( 2 );
-		note += m_voice[i]->m_coarseModel.value();
-		freq = 440.0 * pow( 2.0, (note-69.0)/12.0 );
-		data16 = int( freq / float(clockrate) * 16777216.0 );
-
-		sidreg[base+0] = data16&0x00FF;
-		sidreg[base+1] = (data16>>8)&0x00FF;
-		// pw
-		data16 = (int)m_voice[i]->m_pulseWidthModel.value();
-		
-		sidreg[base+2] = data16&0x00FF;
-		sidreg[base+3] = (data16>>8)&0x000F;
-		// control: wave form, (test), ringmod, sync, gate
-		data8 = _n->isReleased()?0:1;
-		data8 += m_voice[i]->m_syncModel.value()?2:0;
-		data8 += m_voice[i]->m_ringModModel.value()?4:0;
-		data8 += m_voice[i]->m_testModel.value()?8:0;
-		switch( m_voice[i]->m_waveFormModel.value() )
-		{	
-			default: break;
-			case voiceObject::NoiseWave:	data8 += 128; break;
-			case voiceObject::SquareWave:	data8 += 64; break;
-			case voiceObject::SawWave:		data8 += 32; break;
-			case voiceObject::TriangleWave:	data8 += 16; break;
-		}
-		sidreg[base+4] = data8&0x00FF;
-		// ad
-		data16 = (int)m_voice[i]->m_attackModel.value();
+	data8 += (data16&0x0F);
+	_sidreg[base+6] = data8&0x00FF;
+}
 
-		data8 = (data16&0x0F)<<4;
-		data16 = (int)m_voice[i]->m_decayModel.value();
 
-		data8 += (data16&0x0F);
-		sidreg[base+5] = data8&0x00FF;
-		// sr
-		data16 = (int)m_voice[i]->m_sustainModel.value();
 
-		data8 = (data16&0x0F)<<4;
-		data16 = (int)m_voice[i]->m_releaseModel.value();
 
-		data8 += (data16&0x0F);
-		sidreg[base+6] = data8&0x00FF;
-	}
-	// filtered
+void sidInstrument::writeFilterRegisters( unsigned char * _sidreg ) const
+{
+	reg8 data8 = 0;
+	reg8 data16 = 0;
 
 	// FC (FilterCutoff)
 	data16 = (int)m_filterFCModel.value();
-	sidreg[21] = data16&0x0007;
-	sidreg[22] = (data16>>3)&0x00FF;
+	_sidreg[21] = data16&0x0007;
+	_sidreg[22] = (data16>>3)&0x00FF;
 	
 	// res, filt ex,3,2,1
 	data16 = (int)m_filterResonanceModel.value();
@@ -409,7 +405,7 @@ void sidInstrument::playNote( NotePlayHandle * _n,
 	data8 += m_voice[2]->m_filteredModel.value()?4:0;
 	data8 += m_voice[1]->m_filteredModel.value()?2:0;
 	data8 += m_voice[0]->m_filteredModel.value()?1:0;
-	sidreg[23] = data8&0x00FF;
+	_sidreg[23] = data8&0x00FF;
 
 	// mode vol
 	data16 = (int)m_volumeModel.value();
@@ -424,31 +420,252 @@ void sidInstrument::playNote( NotePlayHandle * _n,
 		case HighPass:	data8 += 64; break;
 	}
 
-	sidreg[24] = data8&0x00FF;
-		
-	int num = sid_fillbuffer(sidreg, sid,delta_t,buf, frames);
-	if(num!=frames)
+	_sidreg[24] = data8&0x00FF;
+}
+
+
+
+
+void sidInstrument::setupChip( sidChip * _chip ) const
+{
+	const int samplerate = Engine::mixer()->processingSampleRate();
+	const int sampling = m_samplingModel.value();
+	if( _chip->sampling == sampling && _chip->sampleRate == samplerate )
+	{
+		return;
+	}
+
+	// the resampling methods don't support all clock to sample rate
+	// ratios - fall back to the fast method for these
+	if( !_chip->sid.set_sampling_parameters( C64_PAL_CYCLES_PER_SEC,
+					samplingMethods[sampling], samplerate ) )
+	{
+		_chip->sid.set_sampling_parameters( C64_PAL_CYCLES_PER_SEC,
+						SAMPLE_FAST, samplerate );
+	}
+	_chip->sampling = sampling;
+	_chip->sampleRate = samplerate;
+}
+
+
+
+
+void sidInstrument::renderChip( sidChip * _chip, unsigned char * _sidreg,
+				sampleFrame * _buf, fpp_t _frames )
+{
+	const int samplerate = Engine::mixer()->processingSampleRate();
+
+	setupChip( _chip );
+	if( (ChipModel)m_chipModel.value() == sidMOS6581 )
+	{
+		_chip->sid.set_chip_model( MOS6581 );
+	}
+	else
+	{
+		_chip->sid.set_chip_model( MOS8580 );
+	}
+
+	int delta_t = C64_PAL_CYCLES_PER_SEC * _frames / samplerate + 4;
+	// avoid variable length array for msvc compat
+	short* buf = reinterpret_cast<short*>( _buf );
+	int num = sid_fillbuffer(_sidreg, &_chip->sid, delta_t, buf, _frames);
+	if(num!=_frames)
 		printf("!!!Not enough samples\n");
 
 	// loop backwards to avoid overwriting data in the short-to-float conversion
-	for( fpp_t frame = frames - 1; frame >= 0; frame-- )
+	for( fpp_t frame = _frames - 1; frame >= 0; frame-- )
 	{
 		sample_t s = float(buf[frame])/32768.0;
 		for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
 		{
-			_working_buffer[frame+offset][ch] = s;
+			_buf[frame][ch] = s;
+		}
+	}
+}
+
+
+
+
+void sidInstrument::playNote( NotePlayHandle * _n,
+						sampleFrame * _working_buffer )
+{
+	const f_cnt_t tfp = _n->totalFramesPlayed();
+
+	if ( tfp == 0 )
+	{
+		if( m_sharedChipModel.value() )
+		{
+			// the shared chip is rendered by play(), the note only
+			// occupies one of its voices
+			startSharedVoice( _n );
+			_n->m_pluginData = m_sharedChip;
+			return;
+		}
+
+		sidChip *chip = m_sidPool.take();
+		if( chip == NULL )
+		{
+			chip = new sidChip;
 		}
+		chip->sid.enable_filter( true );
+		chip->sid.reset();
+		_n->m_pluginData = chip;
+	}
+
+	sidChip *chip = static_cast<sidChip *>( _n->m_pluginData );
+	if( chip == m_sharedChip )
+	{
+		return;
+	}
+
+	const fpp_t frames = _n->framesLeftForCurrentPeriod();
+	const f_cnt_t offset = _n->noteOffset();
+
+	unsigned char sidreg[NUMSIDREGS];
+
+	for (int c = 0; c < NUMSIDREGS; c++)
+	{
+		sidreg[c] = 0x00;
 	}
 
+	// voices
+	for( int i = 0 ; i < 3 ; ++i )
+	{
+		writeVoiceRegisters( sidreg, i, _n->frequency(), !_n->isReleased() );
+	}
+	writeFilterRegisters( sidreg );
+
+	renderChip( chip, sidreg, _working_buffer + offset, frames );
+
 	instrumentTrack()->processAudioBuffer( _working_buffer, frames + offset, _n );
 }
 
 
 
 
+void sidInstrument::play( sampleFrame * _working_buffer )
+{
+	const fpp_t frames = Engine::mixer()->framesPerPeriod();
+	unsigned char sidreg[NUMSIDREGS];
+
+	for (int c = 0; c < NUMSIDREGS; c++)
+	{
+		sidreg[c] = 0x00;
+	}
+
+	// each note plays one voice of the chip with that voice's settings,
+	// released voices keep their frequency for the release phase
+	m_sharedVoicesMutex.lock();
+	for( int i = 0; i < 3; ++i )
+	{
+		const NotePlayHandle * n = m_sharedVoices[i];
+		if( n != NULL )
+		{
+			m_sharedFrequency[i] = n->frequency();
+		}
+		writeVoiceRegisters( sidreg, i, m_sharedFrequency[i],
+					n != NULL && !n->isReleased() );
+	}
+	m_sharedVoicesMutex.unlock();
+	writeFilterRegisters( sidreg );
+
+	m_sharedChip->sid.enable_filter( true );
+	renderChip( m_sharedChip, sidreg, _working_buffer, frames );
+
+	instrumentTrack()->processAudioBuffer( _working_buffer, frames, NULL );
+}
+
+
+
+
+void sidInstrument::startSharedVoice( NotePlayHandle * _n )
+{
+	m_sharedVoicesMutex.lock();
+	// take a free voice, or the one playing the oldest note like a
+	// tracker would
+	int voice = 0;
+	for( int i = 0; i < 3; ++i )
+	{
+		if( m_sharedVoices[i] == NULL )
+		{
+			voice = i;
+			break;
+		}
+		if( m_sharedVoiceStart[i] < m_sharedVoiceStart[voice] )
+		{
+			voice = i;
+		}
+	}
+	m_sharedVoices[voice] = _n;
+	m_sharedVoiceStart[voice] = ++m_sharedVoicesStarted;
+	m_sharedVoicesMutex.unlock();
+}
+
+
+
+
 void sidInstrument::deleteNotePluginData( NotePlayHandle * _n )
 {
-	delete static_cast<cSID *>( _n->m_pluginData );
+	m_sharedVoicesMutex.lock();
+	for( int i = 0; i < 3; ++i )
+	{
+		if( m_sharedVoices[i] == _n )
+		{
+			m_sharedVoices[i] = NULL;
+		}
+	}
+	m_sharedVoicesMutex.unlock();
+
+	if( _n->m_pluginData != m_sharedChip )
+	{
+		m_sidPool.give( static_cast<sidChip *>( _n->m_pluginData ) );
+	}
+}
+
+
+
+
+float sidInstrument::silentVoiceThreshold() const
+{
+	// notes on the shared chip don't render anything themselves, but
+	// have to last until the chip's envelope released their voice
+	return m_sharedChipModel.value() ? 0 :
+				Instrument::silentVoiceThreshold();
+}
+
+
+
+
+void sidInstrument::reserveVoices()
+{
+	// chips are set up for the selected sampling method here, as this is
+	// expensive for the resampling methods
+	m_sidPool.clear();
+	m_sidPool.reserve( instrumentTrack()->polyphonyModel()->value(),
+		[this]()
+		{
+			sidChip * chip = new sidChip;
+			setupChip( chip );
+			return chip;
+		} );
+}
+
+
+
+
+void sidInstrument::updateSharedChip()
+{
+	if( m_sharedChipModel.value() && m_sharedChipHandle == NULL )
+	{
+		m_sharedChipHandle = new InstrumentPlayHandle( this, instrumentTrack() );
+		Engine::mixer()->addPlayHandle( m_sharedChipHandle );
+	}
+	else if( !m_sharedChipModel.value() && m_sharedChipHandle != NULL )
+	{
+		Engine::mixer()->removePlayHandlesOfTypes( instrumentTrack(),
+					PlayHandle::TypeInstrumentPlayHandle );
+		m_sharedChipHandle = NULL;
+	}
 }
 
 
@@ -549,6 +766,16 @@ sidInstrumentView::sidInstrumentView( Instrument * _instrument,
 	m_sidTypeBtnGrp->addButton( mos6581_btn );
 	m_sidTypeBtnGrp->addButton( mos8580_btn );
 
+	m_samplingComboBox = new ComboBox( this );
+	m_samplingComboBox->setGeometry( 140, 8, 104, 22 );
+	ToolTip::add( m_samplingComboBox, tr( "Emulation quality" ) );
+
+	m_sharedChipLed = new LedCheckBox( tr( "SHARED" ), this,
+					tr( "Shared chip" ), LedCheckBox::Green );
+	m_sharedChipLed->move( 140, 36 );
+	ToolTip::add( m_sharedChipLed,
+			tr( "Play up to three notes on the voices of one chip" ) );
+
 	for( int i = 0; i < 3; i++ ) 
 	{
 		Knob *ak = new sidKnob( this );
@@ -732,6 +959,8 @@ void sidInstrumentView::modelChanged()
 	m_passBtnGrp->setModel( &k->m_filterModeModel );
 	m_offButton->setModel(  &k->m_voice3OffModel );
 	m_sidTypeBtnGrp->setModel(  &k->m_chipModel );
+	m_samplingComboBox->setModel( &k->m_samplingModel );
+	m_sharedChipLed->setModel( &k->m_sharedChipModel );
 
 	for( int i = 0; i < 3; ++i )
 	{
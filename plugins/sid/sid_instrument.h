@@ -27,14 +27,22 @@
 #ifndef _SID_H
 #define _SID_H
 
+#include <QMutex>
 #include <QObject>
+#include "ComboBoxModel.h"
 #include "Instrument.h"
 #include "InstrumentView.h"
 #include "Knob.h"
+#include "VoicePool.h"
 
 
 class sidInstrumentView;
 class NotePlayHandle;
+class cSID;
+class ComboBox;
+class InstrumentPlayHandle;
+class LedCheckBox;
+struct sidChip;
 class automatableButtonGroup;
 class PixmapButton;
 
@@ -88,6 +96,14 @@ public:
 		NumChipModels
 	};
 
+	enum SamplingMethods {
+		SamplingFast = 0,
+		SamplingInterpolate,
+		SamplingResampleFast,
+		SamplingResampleInterpolate,
+		NumSamplingMethods
+	};
+
 
 	sidInstrument( InstrumentTrack * _instrument_track );
 	virtual ~sidInstrument();
@@ -96,6 +112,10 @@ public:
 						sampleFrame * _working_buffer );
 	virtual void deleteNotePluginData( NotePlayHandle * _n );
 
+	// renders the shared chip
+	virtual void play( sampleFrame * _working_buffer );
+
+	virtual float silentVoiceThreshold() const;
 
 	virtual void saveSettings( QDomDocument & _doc, QDomElement & _parent );
 	virtual void loadSettings( const QDomElement & _this );
@@ -107,11 +127,24 @@ public:
 	virtual PluginView * instantiateView( QWidget * _parent );
 
 
+private slots:
+	void reserveVoices();
+	void updateSharedChip();
+
+
 /*public slots:
 	void updateKnobHint();
 	void updateKnobToolTip();*/
 
 private:
+	void writeVoiceRegisters( unsigned char * _sidreg, int _voice,
+						float _freq, bool _gate ) const;
+	void writeFilterRegisters( unsigned char * _sidreg ) const;
+	void setupChip( sidChip * _chip ) const;
+	void renderChip( sidChip * _chip, unsigned char * _sidreg,
+					sampleFrame * _buf, fpp_t _frames );
+	void startSharedVoice( NotePlayHandle * _n );
+
 	// voices
 	voiceObject * m_voice[3];
 
@@ -125,6 +158,21 @@ private:
 	FloatModel m_volumeModel;
 
 	IntModel m_chipModel;
+	ComboBoxModel m_samplingModel;
+
+	// play up to three notes on the voices of one chip like a tracker
+	BoolModel m_sharedChipModel;
+
+	// emulated chips of finished notes, so new notes don't allocate
+	VoicePool<sidChip> m_sidPool;
+
+	sidChip * m_sharedChip;
+	InstrumentPlayHandle * m_sharedChipHandle;
+	NotePlayHandle * m_sharedVoices[3];
+	int m_sharedVoiceStart[3];
+	int m_sharedVoicesStarted;
+	float m_sharedFrequency[3];
+	QMutex m_sharedVoicesMutex;
 
 	friend class sidInstrumentView;
 
@@ -144,6 +192,8 @@ private:
 	
 	automatableButtonGroup * m_passBtnGrp;
 	automatableButtonGroup * m_sidTypeBtnGrp;
+	ComboBox * m_samplingComboBox;
+	LedCheckBox * m_sharedChipLed;
 
 	struct voiceKnobs
 	{
@@ -38,6 +38,17 @@ public:
 	virtual bool processAudioBuffer( sampleFrame * _buf,
 		                                          const fpp_t _frames );
 
+	virtual bool writesWetOnly() const
+	{
+		return true;
+	}
+
+	// silence in, silence out
+	virtual f_cnt_t tailFrames() const
+	{
+		return 0;
+	}
+
 	virtual EffectControls * controls()
 	{
 		return( &m_smControls );
@@ -28,6 +28,7 @@
 
 #include <QDir>
 #include <QMessageBox>
+#include <QMutex>
 
 #include "BandedWG.h"
 #include "ModalBar.h"
@@ -43,6 +44,11 @@
 #include "embed.h"
 #include "plugin_export.h"
 
+
+// STK instruments are constructed in a critical section as STK is not
+// thread-safe
+static QMutex s_stkMutex;
+
 extern "C"
 {
 
@@ -120,6 +126,12 @@ malletsInstrument::malletsInstrument( InstrumentTrack * _instrument_track ):
 	m_scalers.append( 16.0 );
 	m_presetsModel.addItem( tr( "Tibetan bowl" ) );
 	m_scalers.append( 7.0 );
+
+	reserveVoices();
+	connect( &m_presetsModel, SIGNAL( dataChanged() ),
+			this, SLOT( reserveVoices() ) );
+	connect( instrumentTrack()->polyphonyModel(), SIGNAL( dataChanged() ),
+			this, SLOT( reserveVoices() ) );
 }
 
 
@@ -295,12 +307,26 @@ void malletsInstrument::playNote( NotePlayHandle * _n,
 			m_isOldVersionModel.value() ? 100.0 : 200.0;
 		const float vel = _n->getVolume() / velocityAdjust;
 
-		// critical section as STK is not thread-safe
-		static QMutex m;
-		m.lock();
+		const int type = synthType( p );
+		const sample_rate_t sampleRate = Engine::mixer()->processingSampleRate();
+		malletsSynth * ps = m_voicePools[type].take();
+		if( ps != NULL && ps->sampleRate() != sampleRate )
+		{
+			// pooled before the sample rate changed
+			delete ps;
+			ps = NULL;
+		}
+		if( ps == NULL )
+		{
+			// critical section as STK is not thread-safe
+			s_stkMutex.lock();
+			ps = new malletsSynth( type, sampleRate );
+			s_stkMutex.unlock();
+		}
+
 		if( p < 9 )
 		{
-			_n->m_pluginData = new malletsSynth( freq,
+			ps->startModalBar( freq,
 						vel,
 						m_stickModel.value(),
 						m_hardnessModel.value(),
@@ -308,25 +334,22 @@ void malletsInstrument::playNote( NotePlayHandle * _n,
 						m_vibratoGainModel.value(),
 						m_vibratoFreqModel.value(),
 						p,
-						(uint8_t) m_spreadModel.value(),
-				Engine::mixer()->processingSampleRate() );
+						(uint8_t) m_spreadModel.value() );
 		}
 		else if( p == 9 )
 		{
-			_n->m_pluginData = new malletsSynth( freq,
+			ps->startTubeBell( freq,
 						vel,
-						p,
 						m_lfoDepthModel.value(),
 						m_modulatorModel.value(),
 						m_crossfadeModel.value(),
 						m_lfoSpeedModel.value(),
 						m_adsrModel.value(),
-						(uint8_t) m_spreadModel.value(),
-				Engine::mixer()->processingSampleRate() );
+						(uint8_t) m_spreadModel.value() );
 		}
 		else
 		{
-			_n->m_pluginData = new malletsSynth( freq,
+			ps->startBandedWG( freq,
 						vel,
 						m_pressureModel.value(),
 						m_motionModel.value(),
@@ -334,11 +357,10 @@ void malletsInstrument::playNote( NotePlayHandle * _n,
 						p - 10,
 						m_strikeModel.value() * 128.0,
 						m_velocityModel.value(),
-						(uint8_t) m_spreadModel.value(),
-				Engine::mixer()->processingSampleRate() );
+						(uint8_t) m_spreadModel.value() );
 		}
-		m.unlock();
-		static_cast<malletsSynth *>(_n->m_pluginData)->setPresetIndex(p);
+		ps->setPresetIndex(p);
+		_n->m_pluginData = ps;
 	}
 
 	const fpp_t frames = _n->framesLeftForCurrentPeriod();
@@ -370,7 +392,44 @@ void malletsInstrument::playNote( NotePlayHandle * _n,
 
 void malletsInstrument::deleteNotePluginData( NotePlayHandle * _n )
 {
-	delete static_cast<malletsSynth *>( _n->m_pluginData );
+	malletsSynth * ps = static_cast<malletsSynth *>( _n->m_pluginData );
+	if( ps != NULL )
+	{
+		m_voicePools[ps->type()].give( ps );
+	}
+}
+
+
+
+
+void malletsInstrument::reserveVoices()
+{
+	if( m_filesMissing )
+	{
+		return;
+	}
+
+	const int type = synthType( m_presetsModel.value() );
+	const sample_rate_t sampleRate = Engine::mixer()->processingSampleRate();
+	m_voicePools[type].reserve( instrumentTrack()->polyphonyModel()->value(),
+		[type, sampleRate]()
+		{
+			QMutexLocker lock( &s_stkMutex );
+			return new malletsSynth( type, sampleRate );
+		} );
+}
+
+
+
+
+int malletsInstrument::synthType( int _preset )
+{
+	if( _preset < 9 )
+	{
+		return malletsSynth::ModalBarType;
+	}
+	return _preset == 9 ? malletsSynth::TubeBellType :
+					malletsSynth::BandedWGType;
 }
 
 
@@ -605,17 +664,9 @@ void malletsInstrumentView::changePreset()
 
 
 
-// ModalBar
-malletsSynth::malletsSynth( const StkFloat _pitch,
-				const StkFloat _velocity,
-				const StkFloat _control1,
-				const StkFloat _control2,
-				const StkFloat _control4,
-				const StkFloat _control8,
-				const StkFloat _control11,
-				const int _control16,
-				const uint8_t _delay,
-				const sample_rate_t _sample_rate ) :
+malletsSynth::malletsSynth( const int _type, const sample_rate_t _sample_rate ) :
+	m_type( _type ),
+	m_sampleRate( _sample_rate ),
 	m_presetIndex(0)
 {
 	try
@@ -627,17 +678,18 @@ malletsSynth::malletsSynth( const StkFloat _pitch,
 		Stk::showWarnings( false );
 #endif
 
-		m_voice = new ModalBar();
-	
-		m_voice->controlChange( 16, _control16 );
-		m_voice->controlChange( 1, _control1 );
-		m_voice->controlChange( 2, _control2 );
-		m_voice->controlChange( 4, _control4 );
-		m_voice->controlChange( 8, _control8 );
-		m_voice->controlChange( 11, _control11 );
-		m_voice->controlChange( 128, 128.0f );
-		
-		m_voice->noteOn( _pitch, _velocity );
+		switch( _type )
+		{
+			case ModalBarType:
+				m_voice = new ModalBar();
+				break;
+			case TubeBellType:
+				m_voice = new TubeBell();
+				break;
+			default:
+				m_voice = new BandedWG();
+				break;
+		}
 	}
 	catch( ... )
 	{
@@ -645,6 +697,14 @@ malletsSynth::malletsSynth( const StkFloat _pitch,
 	}
 	
 	m_delay = new StkFloat[256];
+	clearDelay( 0 );
+}
+
+
+
+
+void malletsSynth::clearDelay( const uint8_t _delay )
+{
 	m_delayRead = 0;
 	m_delayWrite = _delay;
 	for( int i = 0; i < 256; i++ )
@@ -656,57 +716,78 @@ malletsSynth::malletsSynth( const StkFloat _pitch,
 
 
 
-// TubeBell
-malletsSynth::malletsSynth( const StkFloat _pitch,
+void malletsSynth::startModalBar( const StkFloat _pitch,
 				const StkFloat _velocity,
-				const int _preset,
 				const StkFloat _control1,
 				const StkFloat _control2,
 				const StkFloat _control4,
+				const StkFloat _control8,
 				const StkFloat _control11,
-				const StkFloat _control128,
-				const uint8_t _delay,
-				const sample_rate_t _sample_rate ) :
-	m_presetIndex(0)
+				const int _control16,
+				const uint8_t _delay )
 {
+	clearDelay( _delay );
+	if( m_voice == NULL )
+	{
+		return;
+	}
+
 	try
 	{
-		Stk::setSampleRate( _sample_rate );
-		Stk::setRawwavePath( QDir( ConfigManager::inst()->stkDir() ).absolutePath()
-						.toLocal8Bit().constData() );
-#ifndef LMMS_DEBUG
-		Stk::showWarnings( false );
-#endif
+		static_cast<ModalBar *>( m_voice )->clear();
 
-		m_voice = new TubeBell();
-	
+		m_voice->controlChange( 16, _control16 );
 		m_voice->controlChange( 1, _control1 );
 		m_voice->controlChange( 2, _control2 );
 		m_voice->controlChange( 4, _control4 );
+		m_voice->controlChange( 8, _control8 );
 		m_voice->controlChange( 11, _control11 );
-		m_voice->controlChange( 128, _control128 );
-	
+		m_voice->controlChange( 128, 128.0f );
+		
 		m_voice->noteOn( _pitch, _velocity );
 	}
 	catch( ... )
 	{
-		m_voice = NULL;
 	}
+}
+
+
+
+
+void malletsSynth::startTubeBell( const StkFloat _pitch,
+				const StkFloat _velocity,
+				const StkFloat _control1,
+				const StkFloat _control2,
+				const StkFloat _control4,
+				const StkFloat _control11,
+				const StkFloat _control128,
+				const uint8_t _delay )
+{
+	clearDelay( _delay );
+	if( m_voice == NULL )
+	{
+		return;
+	}
+
+	try
+	{
+		m_voice->controlChange( 1, _control1 );
+		m_voice->controlChange( 2, _control2 );
+		m_voice->controlChange( 4, _control4 );
+		m_voice->controlChange( 11, _control11 );
+		m_voice->controlChange( 128, _control128 );
 	
-	m_delay = new StkFloat[256];
-	m_delayRead = 0;
-	m_delayWrite = _delay;
-	for( int i = 0; i < 256; i++ )
+		m_voice->noteOn( _pitch, _velocity );
+	}
+	catch( ... )
 	{
-		m_delay[i] = 0.0;
 	}
 }
 
 
 
 
-// BandedWG
-malletsSynth::malletsSynth( const StkFloat _pitch,
+void malletsSynth::startBandedWG( const StkFloat _pitch,
 				const StkFloat _velocity,
 				const StkFloat _control2,
 				const StkFloat _control4,
@@ -714,21 +795,18 @@ malletsSynth::malletsSynth( const StkFloat _pitch,
 				const int _control16,
 				const StkFloat _control64,
 				const StkFloat _control128,
-				const uint8_t _delay,
-				const sample_rate_t _sample_rate ) :
-	m_presetIndex(0)
+				const uint8_t _delay )
 {
+	clearDelay( _delay );
+	if( m_voice == NULL )
+	{
+		return;
+	}
+
 	try
 	{
-		Stk::setSampleRate( _sample_rate );
-		Stk::setRawwavePath( QDir( ConfigManager::inst()->stkDir() ).absolutePath()
-						.toLocal8Bit().constData() );
-#ifndef LMMS_DEBUG
-		Stk::showWarnings( false );
-#endif
+		static_cast<BandedWG *>( m_voice )->clear();
 
-		m_voice = new BandedWG();
-	
 		m_voice->controlChange( 1, 128.0 );
 		m_voice->controlChange( 2, _control2 );
 		m_voice->controlChange( 4, _control4 );
@@ -741,15 +819,6 @@ malletsSynth::malletsSynth( const StkFloat _pitch,
 	}
 	catch( ... )
 	{
-		m_voice = NULL;
-	}
-	
-	m_delay = new StkFloat[256];
-	m_delayRead = 0;
-	m_delayWrite = _delay;
-	for( int i = 0; i < 256; i++ )
-	{
-		m_delay[i] = 0.0;
 	}
 }
 
@@ -35,6 +35,7 @@
 #include "Knob.h"
 #include "NotePlayHandle.h"
 #include "LedCheckbox.h"
+#include "VoicePool.h"
 
 // As of Stk 4.4 all classes and types have been moved to the namespace "stk".
 // However in older versions this namespace does not exist, therefore declare it
@@ -47,8 +48,20 @@ static const int MALLETS_PRESET_VERSION = 1;
 class malletsSynth
 {
 public:
+	enum Types
+	{
+		ModalBarType,
+		TubeBellType,
+		BandedWGType,
+		NumTypes
+	} ;
+
+	// constructs the STK instrument - this loads raw waves from disk,
+	// so instances are pooled and only restarted by the start methods
+	malletsSynth( const int _type, const sample_rate_t _sample_rate );
+
 	// ModalBar
-	malletsSynth( const StkFloat _pitch,
+	void startModalBar( const StkFloat _pitch,
 			const StkFloat _velocity,
 			const StkFloat _control1,
 			const StkFloat _control2,
@@ -56,23 +69,20 @@ public:
 			const StkFloat _control8,
 			const StkFloat _control11,
 			const int _control16,
-			const uint8_t _delay,
-			const sample_rate_t _sample_rate );
+			const uint8_t _delay );
 
 	// TubeBell
-	malletsSynth( const StkFloat _pitch,
+	void startTubeBell( const StkFloat _pitch,
 			const StkFloat _velocity,
-			const int _preset,
 			const StkFloat _control1,
 			const StkFloat _control2,
 			const StkFloat _control4,
 			const StkFloat _control11,
 			const StkFloat _control128,
-			const uint8_t _delay,
-			const sample_rate_t _sample_rate );
+			const uint8_t _delay );
 
 	// BandedWG
-	malletsSynth( const StkFloat _pitch,
+	void startBandedWG( const StkFloat _pitch,
 			const StkFloat _velocity,
 			const StkFloat _control2,
 			const StkFloat _control4,
@@ -80,8 +90,7 @@ public:
 			const int _control16,
 			const StkFloat _control64,
 			const StkFloat _control128,
-			const uint8_t _delay,
-			const sample_rate_t _sample_rate );
+			const uint8_t _delay );
 
 	inline ~malletsSynth()
 	{
@@ -130,8 +139,22 @@ public:
 		m_presetIndex = presetIndex;
 	}
 
+	inline int type() const
+	{
+		return m_type;
+	}
+
+	inline sample_rate_t sampleRate() const
+	{
+		return m_sampleRate;
+	}
+
 
 protected:
+	void clearDelay( const uint8_t _delay );
+
+	const int m_type;
+	const sample_rate_t m_sampleRate;
 	int m_presetIndex;
 	Instrmnt * m_voice;
 
@@ -163,7 +186,13 @@ public:
 	virtual PluginView * instantiateView( QWidget * _parent );
 
 
+private slots:
+	void reserveVoices();
+
+
 private:
+	static int synthType( int _preset );
+
 	FloatModel m_hardnessModel;
 	FloatModel m_positionModel;
 	FloatModel m_vibratoGainModel;
@@ -192,6 +221,8 @@ private:
 
 	bool m_filesMissing;
 
+	// STK instruments of finished notes by malletsSynth::Types
+	VoicePool<malletsSynth> m_voicePools[malletsSynth::NumTypes];
 
 	friend class malletsInstrumentView;
 
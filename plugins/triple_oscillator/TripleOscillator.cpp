@@ -33,6 +33,7 @@
 #include "Engine.h"
 #include "InstrumentTrack.h"
 #include "Knob.h"
+#include "LedCheckbox.h"
 #include "Mixer.h"
 #include "NotePlayHandle.h"
 #include "PixmapButton.h"
@@ -87,6 +88,8 @@ OscillatorObject::OscillatorObject( Model * _parent, int _idx ) :
 	m_modulationAlgoModel( Oscillator::SignalMix, 0,
 				Oscillator::NumModulationAlgos-1, this,
 				tr( "Modulation type %1" ).arg( _idx+1 ) ),
+	m_useWaveTableModel( false, this,
+				tr( "Osc %1 wavetable" ).arg( _idx+1 ) ),
 
 	m_sampleBuffer( new SampleBuffer ),
 	m_volumeLeft( 0.0f ),
@@ -253,6 +256,8 @@ void TripleOscillator::saveSettings( QDomDocument & _doc, QDomElement & _this )
 							"wavetype" + is );
 		m_osc[i]->m_modulationAlgoModel.saveSettings( _doc, _this,
 					"modalgo" + QString::number( i+1 ) );
+		m_osc[i]->m_useWaveTableModel.saveSettings( _doc, _this,
+							"usewavetable" + is );
 		_this.setAttribute( "userwavefile" + is,
 					m_osc[i]->m_sampleBuffer->audioFile() );
 	}
@@ -279,6 +284,8 @@ void TripleOscillator::loadSettings( const QDomElement & _this )
 									is );
 		m_osc[i]->m_modulationAlgoModel.loadSettings( _this,
 					"modalgo" + QString::number( i+1 ) );
+		m_osc[i]->m_useWaveTableModel.loadSettings( _this,
+							"usewavetable" + is );
 		m_osc[i]->m_sampleBuffer->setAudioFile( _this.attribute(
 							"userwavefile" + is ) );
 	}
@@ -295,6 +302,24 @@ QString TripleOscillator::nodeName() const
 
 
 
+bool TripleOscillator::isDeterministic() const
+{
+	// noise is random, user defined waves are samples
+	for( int i = 0; i < NUM_OF_OSCILLATORS; ++i )
+	{
+		const int shape = m_osc[i]->m_waveShapeModel.value();
+		if( shape == Oscillator::WhiteNoise ||
+				shape == Oscillator::UserDefinedWave )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+
 void TripleOscillator::playNote( NotePlayHandle * _n,
 						sampleFrame * _working_buffer )
 {
@@ -346,6 +371,10 @@ void TripleOscillator::playNote( NotePlayHandle * _n,
 
 			oscs_l[i]->setUserWave( m_osc[i]->m_sampleBuffer );
 			oscs_r[i]->setUserWave( m_osc[i]->m_sampleBuffer );
+			oscs_l[i]->setUseWaveTable(
+					m_osc[i]->m_useWaveTableModel.value() );
+			oscs_r[i]->setUseWaveTable(
+					m_osc[i]->m_useWaveTableModel.value() );
 
 		}
 
@@ -659,6 +688,12 @@ TripleOscillatorView::TripleOscillatorView( Instrument * _instrument,
 							"usr_shape_inactive" ) );
 		ToolTip::add( uwb, tr( "User-defined wave" ) );
 
+		LedCheckBox * wtcb = new LedCheckBox( "", this, tr( "Wavetable" ),
+							LedCheckBox::Green );
+		wtcb->move( 113, btn_y + 1 );
+		ToolTip::add( wtcb, tr( "Use alias-free wavetables for "
+					"triangle, saw, square and moog-saw" ) );
+
 		automatableButtonGroup * wsbg =
 			new automatableButtonGroup( this );
 
@@ -672,7 +707,7 @@ TripleOscillatorView::TripleOscillatorView( Instrument * _instrument,
 		wsbg->addButton( uwb );
 
 		m_oscKnobs[i] = OscillatorKnobs( vk, pk, ck, flk, frk, pok,
-							spdk, uwb, wsbg );
+						spdk, uwb, wsbg, wtcb );
 	}
 }
 
@@ -710,6 +745,8 @@ void TripleOscillatorView::modelChanged()
 				&t->m_osc[i]->m_stereoPhaseDetuningModel );
 		m_oscKnobs[i].m_waveShapeBtnGrp->setModel(
 					&t->m_osc[i]->m_waveShapeModel );
+		m_oscKnobs[i].m_useWaveTableCheckBox->setModel(
+					&t->m_osc[i]->m_useWaveTableModel );
 		connect( m_oscKnobs[i].m_userWaveButton,
 						SIGNAL( doubleClicked() ),
 				t->m_osc[i], SLOT( oscUserDefWaveDblClick() ) );
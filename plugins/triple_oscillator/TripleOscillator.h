@@ -34,6 +34,7 @@
 
 class automatableButtonGroup;
 class Knob;
+class LedCheckBox;
 class NotePlayHandle;
 class PixmapButton;
 class SampleBuffer;
@@ -60,6 +61,7 @@ private:
 	FloatModel m_stereoPhaseDetuningModel;
 	IntModel m_waveShapeModel;
 	IntModel m_modulationAlgoModel;
+	BoolModel m_useWaveTableModel;
 	SampleBuffer* m_sampleBuffer;
 
 	float m_volumeLeft;
@@ -112,6 +114,8 @@ public:
 		return( 128 );
 	}
 
+	virtual bool isDeterministic() const;
+
 	virtual PluginView * instantiateView( QWidget * _parent );
 
 
@@ -161,7 +165,8 @@ private:
 					Knob * po,
 					Knob * spd,
 					PixmapButton * uwb,
-					automatableButtonGroup * wsbg ) :
+					automatableButtonGroup * wsbg,
+					LedCheckBox * wtcb ) :
 			m_volKnob( v ),
 			m_panKnob( p ),
 			m_coarseKnob( c ),
@@ -170,7 +175,8 @@ private:
 			m_phaseOffsetKnob( po ),
 			m_stereoPhaseDetuningKnob( spd ),
 			m_userWaveButton( uwb ),
-			m_waveShapeBtnGrp( wsbg )
+			m_waveShapeBtnGrp( wsbg ),
+			m_useWaveTableCheckBox( wtcb )
 		{
 		}
 		OscillatorKnobs()
@@ -185,6 +191,7 @@ private:
 		Knob * m_stereoPhaseDetuningKnob;
 		PixmapButton * m_userWaveButton;
 		automatableButtonGroup * m_waveShapeBtnGrp;
+		LedCheckBox * m_useWaveTableCheckBox;
 
 	} ;
 
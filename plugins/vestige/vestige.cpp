@@ -146,6 +146,7 @@ vestigeInstrument::vestigeInstrument( InstrumentTrack * _instrument_track ) :
 	Instrument( _instrument_track, &vestige_plugin_descriptor ),
 	m_plugin( NULL ),
 	m_pluginMutex(),
+	m_latency( 0 ),
 	m_subWindow( NULL ),
 	m_scrollArea( NULL ),
 	knobFModel( NULL ),
@@ -399,6 +400,7 @@ void vestigeInstrument::play( sampleFrame * _buf )
 	}
 
 	m_plugin->process( NULL, _buf );
+	m_latency = m_plugin->latency();
 
 	instrumentTrack()->processAudioBuffer( _buf, frames, NULL );
 
@@ -67,6 +67,11 @@ public:
 		return IsSingleStreamed | IsMidiBased;
 	}
 
+	virtual f_cnt_t latencyFrames() const
+	{
+		return m_latency;
+	}
+
 	virtual bool handleMidiEvent( const MidiEvent& event, const MidiTime& time, f_cnt_t offset = 0 );
 
 	virtual PluginView * instantiateView( QWidget * _parent );
@@ -82,6 +87,8 @@ private:
 
 	VstPlugin * m_plugin;
 	QMutex m_pluginMutex;
+	// of the plugin, taken while playing as it's guarded by the mutex
+	f_cnt_t m_latency;
 
 	QString m_pluginDLL;
 	QMdiSubWindow * m_subWindow;
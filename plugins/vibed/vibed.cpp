@@ -30,6 +30,7 @@
 #include "InstrumentTrack.h"
 #include "Mixer.h"
 #include "NotePlayHandle.h"
+#include "ScratchArena.h"
 #include "ToolTip.h"
 #include "base64.h"
 #include "CaptionMenu.h"
@@ -309,19 +310,33 @@ void vibed::playNote( NotePlayHandle * _n, sampleFrame * _working_buffer )
 	{
 		_working_buffer[i][0] = 0.0f;
 		_working_buffer[i][1] = 0.0f;
-		int s = 0;
-		for( int string = 0; string < 9; ++string )
+	}
+
+	// render the strings one after another, so each one stays in the
+	// cache for the whole period
+	ScratchBuffer<sample_t> stringBuffer( frames );
+	int s = 0;
+	for( int string = 0; string < 9; ++string )
+	{
+		if( !ps->exists( string ) )
 		{
-			if( ps->exists( string ) )
-			{
-				// pan: 0 -> left, 1 -> right
-				const float pan = ( m_panKnobs[string]->value() + 1 ) / 2.0f;
-				const sample_t sample = ps->getStringSample( s ) * m_volumeKnobs[string]->value() / 100.0f;
-				_working_buffer[i][0] += ( 1.0f - pan ) * sample;
-				_working_buffer[i][1] += pan * sample;
-				s++;
-			}
+			continue;
+		}
+
+		// pan: 0 -> left, 1 -> right
+		const float pan = ( m_panKnobs[string]->value() + 1 ) / 2.0f;
+		const float volume = m_volumeKnobs[string]->value() / 100.0f;
+		const float left = ( 1.0f - pan ) * volume;
+		const float right = pan * volume;
+
+		ps->renderString( s, stringBuffer.data(), frames );
+		sampleFrame * buf = _working_buffer + offset;
+		for( fpp_t i = 0; i < frames; ++i )
+		{
+			buf[i][0] += left * stringBuffer[i];
+			buf[i][1] += right * stringBuffer[i];
 		}
+		s++;
 	}
 
 	instrumentTrack()->processAudioBuffer( _working_buffer, frames + offset, _n );
@@ -46,12 +46,14 @@ vibratingString::vibratingString(	float _pitch,
 	m_stringLoss( 1.0f - _string_loss ),
 	m_state( 0.1f )
 {
-	m_outsamp = new sample_t[m_oversample];
 	int string_length;
 	
 	string_length = static_cast<int>( m_oversample * _sample_rate /
 								_pitch ) + 1;
 	string_length += static_cast<int>( string_length * -_detune );
+	// the nut is read two samples before the end of the delay lines
+	string_length = qMax( string_length, 2 );
+	m_length = string_length;
 
 	int pick = static_cast<int>( ceil( string_length * _pick ) );
 	
@@ -69,8 +71,10 @@ vibratingString::vibratingString(	float _pitch,
 		}
 	}
 	
-	m_toBridge = vibratingString::initDelayLine( string_length, pick );
-	m_fromBridge = vibratingString::initDelayLine( string_length, pick );
+	m_toBridge = vibratingString::initDelayLine( string_length );
+	m_fromBridge = vibratingString::initDelayLine( string_length );
+	m_toBridgePos = 0;
+	m_fromBridgePos = 0;
 
 	
 	vibratingString::setDelayLine( m_toBridge, pick, 
@@ -80,8 +84,9 @@ vibratingString::vibratingString(	float _pitch,
 						m_impulse, _len, 0.5f,
 						_state);
 	
-	m_choice = static_cast<int>( m_oversample * 
-				static_cast<float>( rand() ) / RAND_MAX ); 
+	m_choice = qMin( static_cast<int>( m_oversample * 
+				static_cast<float>( rand() ) / RAND_MAX ),
+							m_oversample - 1 );
 	
 	m_pickupLoc = static_cast<int>( _pickup * string_length );
 }
@@ -89,46 +94,77 @@ vibratingString::vibratingString(	float _pitch,
 
 
 
-vibratingString::delayLine * vibratingString::initDelayLine( int _len,
-								int _pick )
+sample_t * vibratingString::initDelayLine( int _len )
 {
-	delayLine * dl = new vibratingString::delayLine[_len];
-	dl->length = _len;
-	if( _len > 0 )
+	sample_t * dl = new sample_t[_len];
+	float r;
+	float offset = 0.0f;
+	for( int i = 0; i < _len; i++ )
 	{
-		dl->data = new sample_t[_len];
-		float r;
-		float offset = 0.0f;
-		for( int i = 0; i < dl->length; i++ )
-		{
-			r = static_cast<float>( rand() ) /
-					RAND_MAX;
-			offset =  ( m_randomize / 2.0f -
-					m_randomize ) * r;
-			dl->data[i] = offset;
-		}
-	}
-	else
-	{
-		dl->data = NULL;
+		r = static_cast<float>( rand() ) /
+				RAND_MAX;
+		offset =  ( m_randomize / 2.0f -
+				m_randomize ) * r;
+		dl[i] = offset;
 	}
 
-	dl->pointer = dl->data;
-	dl->end = dl->data + _len - 1;
-
 	return( dl );
 }
 
 
 
 
-void vibratingString::freeDelayLine( delayLine * _dl )
+void vibratingString::render( sample_t * _out, fpp_t _frames )
 {
-	if( _dl )
+	// keep the string state local, so the loop runs in registers
+	sample_t * const fromBridge = m_fromBridge;
+	sample_t * const toBridge = m_toBridge;
+	const int len = m_length;
+	const int pickup = m_pickupLoc;
+	const float loss = m_stringLoss;
+	int from = m_fromBridgePos;
+	int to = m_toBridgePos;
+	float state = m_state;
+
+	// all positions read are less than len past x = 0
+	auto wrap = [len]( int _pos ) { return _pos < len ? _pos : _pos - len; };
+
+	for( fpp_t frame = 0; frame < _frames; ++frame )
 	{
-		delete[] _dl->data;
-		delete[] _dl;
+		sample_t out = 0.0f;
+		for( int i = 0; i < m_oversample; i++ )
+		{
+			// Output at pickup position, only the chosen one of
+			// the oversampled ones is used
+			if( i == m_choice )
+			{
+				out = fromBridge[wrap( from + pickup )] +
+						toBridge[wrap( to + pickup )];
+			}
+
+			// Sample traveling into "bridge"
+			const sample_t ym0 = toBridge[wrap( to + 1 )];
+			// Sample to "nut"
+			const sample_t ypM = fromBridge[wrap( from + len - 2 )];
+
+			// String state update
+
+			// Decrement pointer and then update with the
+			// "bridge-reflected" sample
+			from = from > 0 ? from - 1 : len - 1;
+			state = ( state + ym0 ) * 0.5f;
+			fromBridge[from] = -state * loss;
+			// Update with the "nut-reflected" sample and then
+			// increment pointer
+			toBridge[to] = -ypM * loss;
+			to = to < len - 1 ? to + 1 : 0;
+		}
+		_out[frame] = out;
 	}
+
+	m_fromBridgePos = from;
+	m_toBridgePos = to;
+	m_state = state;
 }
 
 
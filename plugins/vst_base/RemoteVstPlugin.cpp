@@ -167,6 +167,11 @@ public:
 
 	virtual void processMidiEvent( const MidiEvent& event, const f_cnt_t offset );
 
+	// VST 2 parameters aren't sample accurate, all changes of a period
+	// are applied at its start
+	virtual void processParameterChange( int _index, float _value,
+							f_cnt_t _offset );
+
 	// set given sample-rate for plugin
 	virtual void updateSampleRate()
 	{
@@ -981,6 +986,18 @@ void RemoteVstPlugin::process( const sampleFrame * _in, sampleFrame * _out )
 
 
 
+void RemoteVstPlugin::processParameterChange( int _index, float _value,
+							f_cnt_t )
+{
+	if( m_plugin )
+	{
+		m_plugin->setParameter( m_plugin, _index, _value );
+	}
+}
+
+
+
+
 void RemoteVstPlugin::processMidiEvent( const MidiEvent& event, const f_cnt_t offset )
 {
 	VstMidiEvent vme;
@@ -1988,6 +2005,7 @@ DWORD WINAPI RemoteVstPlugin::processingThread( LPVOID _param )
 		if( m.id == IdStartProcessing
 			|| m.id == IdMidiEvent
 			|| m.id == IdVstSetParameter
+			|| m.id == IdParameterChange
 			|| m.id == IdVstSetTempo )
 		{
 			_this->processMessage( m );
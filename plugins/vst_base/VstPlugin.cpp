@@ -54,6 +54,7 @@
 #	include <QLayout>
 #endif
 
+#include "BlobContainer.h"
 #include "ConfigManager.h"
 #include "GuiApplication.h"
 #include "LocaleHelper.h"
@@ -227,8 +228,10 @@ void VstPlugin::loadSettings( const QDomElement & _this )
 	// if it exists try to load settings chunk
 	if( _this.hasAttribute( "chunk" ) )
 	{
-		loadChunk( QByteArray::fromBase64(
-				_this.attribute( "chunk" ).toUtf8() ) );
+		const QString chunk = _this.attribute( "chunk" );
+		loadChunk( BlobContainer::isReference( chunk ) ?
+				BlobContainer::data( chunk ) :
+				QByteArray::fromBase64( chunk.toUtf8() ) );
 	}
 	else if( num_params > 0 )
 	{
@@ -367,6 +370,8 @@ void VstPlugin::setParameterDump( const QMap<QString, QString> & _pdump )
 		m.addFloat( item.value );
 	}
 	lock();
+	// the dump is newer than the changes still queued
+	flushParameterChanges();
 	sendMessage( m );
 	unlock();
 }
@@ -571,17 +576,24 @@ void VstPlugin::savePreset( )
 
 void VstPlugin::setParam( int i, float f )
 {
-	lock();
-	sendMessage( message( IdVstSetParameter ).addInt( i ).addFloat( f ) );
-	//waitForMessage( IdVstSetParameter, true );
-	unlock();
+	// automation changes many parameters each period, they go to the
+	// plugin with the audio instead of a message each
+	queueParameterChange( i, f );
 }
 
 
 
 void VstPlugin::idleUpdate()
 {
-	lock();
+	// nothing here is urgent, leave the plugin to the audio thread if it
+	// is using it and try again next time
+	if( !tryLock() )
+	{
+		return;
+	}
+	// hands over the changes of parameters made while no periods are
+	// processed, e.g. when the effect sleeps
+	flushParameterChanges();
 	sendMessage( message( IdVstIdleUpdate ) );
 	unlock();
 }
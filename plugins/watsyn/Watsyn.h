@@ -34,8 +34,8 @@
 #include "TempoSyncKnob.h"
 #include "NotePlayHandle.h"
 #include "PixmapButton.h"
-#include <samplerate.h>
 #include "MemoryManager.h"
+#include "UserWaveMipMap.h"
 
 
 #define makeknob( name, x, y, hint, unit, oname ) 		\
@@ -83,8 +83,7 @@ class WatsynObject
 {
 	MM_OPERATORS
 public:
-	WatsynObject( 	float * _A1wave, float * _A2wave,
-					float * _B1wave, float * _B2wave,
+	WatsynObject( 	const UserWaveMipMapPtr * _waves,
 					int _amod, int _bmod, const sample_rate_t _samplerate, NotePlayHandle * _nph, fpp_t _frames,
 					WatsynInstrument * _w );
 	virtual ~WatsynObject();
@@ -121,10 +120,14 @@ private:
 	float m_lphase [NUM_OSCS];
 	float m_rphase [NUM_OSCS];
 
-	float m_A1wave [WAVELEN];
-	float m_A2wave [WAVELEN];
-	float m_B1wave [WAVELEN];
-	float m_B2wave [WAVELEN];
+	// kept for the whole note, so edits of the graphs don't race with it
+	UserWaveMipMapPtr m_waves [NUM_OSCS];
+
+	// sample of _osc at _phase, which is in samples of WAVELEN
+	inline sample_t wave( int _osc, int _level, float _phase ) const
+	{
+		return m_waves[_osc]->sample( _level, _phase * ( 1.0f / WAVELEN ) );
+	}
 };
 
 class WatsynInstrument : public Instrument
@@ -181,30 +184,8 @@ private:
 		return ( _pan >= 0 ? 1.0 : 1.0 + ( _pan / 100.0 ) ) * _vol / 100.0;
 	}
 
-	// memcpy utilizing libsamplerate (src) for sinc interpolation
-	inline void srccpy( float * _dst, float * _src )
-	{
-		int err;
-		const int margin = 64;
-		
-		// copy to temp array
-		float tmps [ GRAPHLEN + margin ]; // temp array in stack
-		float * tmp = &tmps[0];
-
-		memcpy( tmp, _src, sizeof( float ) * GRAPHLEN );
-		memcpy( tmp + GRAPHLEN, _src, sizeof( float ) * margin );
-		SRC_STATE * src_state = src_new( SRC_SINC_FASTEST, 1, &err );
-		SRC_DATA src_data;
-		src_data.data_in = tmp;
-		src_data.input_frames = GRAPHLEN + margin;
-		src_data.data_out = _dst;
-		src_data.output_frames = WAVELEN;
-		src_data.src_ratio = static_cast<double>( WAVERATIO );
-		src_data.end_of_input = 0;
-		err = src_process( src_state, &src_data ); 
-		if( err ) { qDebug( "Watsyn SRC error: %s", src_strerror( err ) ); }
-		src_delete( src_state );
-	}
+	// band-limited versions of the graph, so high notes don't alias
+	void updateWave( int _osc, const graphModel & _graph );
 
 	// memcpy utilizing cubic interpolation
 /*	inline void cipcpy( float * _dst, float * _src )
@@ -283,10 +264,8 @@ private:
 
 	IntModel m_selectedGraph;
 	
-	float A1_wave [WAVELEN];
-	float A2_wave [WAVELEN];
-	float B1_wave [WAVELEN];
-	float B2_wave [WAVELEN];
+	// shared by all notes, replaced when a graph changes
+	UserWaveMipMapPtr m_waves [NUM_OSCS];
 
 	friend class WatsynObject;
 	friend class WatsynView;
@@ -77,10 +77,41 @@ bool waveShaperEffect::processAudioBuffer( sampleFrame * _buf,
 		return( false );
 	}
 
+	const int factor = 1 << m_wsControls.m_oversamplingModel.value();
+	if( factor != m_oversampler.factor() )
+	{
+		m_oversampler.setup( factor, Decimator::Balanced );
+	}
+
+	// the dry signal goes through the oversampling as well, so it's as
+	// late as the wet one
+	fpp_t offset = 0;
+	m_oversampler.process( _buf, _frames,
+		[this, factor, &offset]( sampleFrame * _upBuf, fpp_t _upFrames )
+		{
+			shape( _upBuf, _upFrames, factor, offset );
+			offset += _upFrames / factor;
+		} );
+
+	double out_sum = 0.0;
+	for( fpp_t f = 0; f < _frames; ++f )
+	{
+		out_sum += _buf[f][0] * _buf[f][0] + _buf[f][1] * _buf[f][1];
+	}
+	checkGate( out_sum / _frames );
+
+	return( isRunning() );
+}
+
+
+
+
+void waveShaperEffect::shape( sampleFrame * _buf, f_cnt_t _frames,
+						int _factor, fpp_t _offset )
+{
 // variables for effect
 	int i = 0;
 
-	double out_sum = 0.0;
 	const float d = dryLevel();
 	const float w = wetLevel();
 	float input = m_wsControls.m_inputModel.value();
@@ -91,13 +122,14 @@ bool waveShaperEffect::processAudioBuffer( sampleFrame * _buf,
 	ValueBuffer *inputBuffer = m_wsControls.m_inputModel.valueBuffer();
 	ValueBuffer *outputBufer = m_wsControls.m_outputModel.valueBuffer();
 
-	int inputInc = inputBuffer ? 1 : 0;
-	int outputInc = outputBufer ? 1 : 0;
+	// the value buffers hold one value per frame at the processing rate
+	const int inputInc = inputBuffer ? 1 : 0;
+	const int outputInc = outputBufer ? 1 : 0;
 
-	const float *inputPtr = inputBuffer ? &( inputBuffer->values()[ 0 ] ) : &input;
-	const float *outputPtr = outputBufer ? &( outputBufer->values()[ 0 ] ) : &output;
+	const float *inputPtr = inputBuffer ? &( inputBuffer->values()[ _offset ] ) : &input;
+	const float *outputPtr = outputBufer ? &( outputBufer->values()[ _offset ] ) : &output;
 
-	for( fpp_t f = 0; f < _frames; ++f )
+	for( f_cnt_t f = 0; f < _frames; ++f )
 	{
 		float s[2] = { _buf[f][0], _buf[f][1] };
 
@@ -143,15 +175,13 @@ bool waveShaperEffect::processAudioBuffer( sampleFrame * _buf,
 // mix wet/dry signals
 		_buf[f][0] = d * _buf[f][0] + w * s[0];
 		_buf[f][1] = d * _buf[f][1] + w * s[1];
-		out_sum += _buf[f][0] * _buf[f][0] + _buf[f][1] * _buf[f][1];
 
-		outputPtr += outputInc;
-		inputPtr += inputInc;
+		if( ( f + 1 ) % _factor == 0 )
+		{
+			outputPtr += outputInc;
+			inputPtr += inputInc;
+		}
 	}
-
-	checkGate( out_sum / _frames );
-
-	return( isRunning() );
 }
 
 
@@ -28,6 +28,7 @@
 #define _WAVESHAPER_H
 
 #include "Effect.h"
+#include "Oversampler.h"
 #include "waveshaper_controls.h"
 
 
@@ -46,10 +47,20 @@ public:
 		return( &m_wsControls );
 	}
 
+	f_cnt_t latencyFrames() const override
+	{
+		return static_cast<f_cnt_t>( m_oversampler.latency() + 0.5f );
+	}
+
 
 private:
+	//! Shapes _frames frames at _factor times the rate, starting _offset
+	//! frames into the period
+	void shape( sampleFrame * _buf, f_cnt_t _frames, int _factor,
+							fpp_t _offset );
 
 	waveShaperControls m_wsControls;
+	Oversampler m_oversampler;
 
 	friend class waveShaperControls;
 
@@ -25,10 +25,14 @@
 
 
 #include <QLayout>
+#include <QImage>
+#include <QPainter>
 
 #include "waveshaper_control_dialog.h"
 #include "waveshaper_controls.h"
+#include "ComboBox.h"
 #include "embed.h"
+#include "gui_templates.h"
 #include "Graph.h"
 #include "PixmapButton.h"
 #include "ToolTip.h"
@@ -39,12 +43,20 @@ waveShaperControlDialog::waveShaperControlDialog(
 					waveShaperControls * _controls ) :
 	EffectControlDialog( _controls )
 {
+	// with room for the oversampling below the artwork
+	const QPixmap artwork = PLUGIN_NAME::getIconPixmap( "artwork" );
+	QPixmap background( artwork.width(), artwork.height() + 30 );
+	background.fill( QColor( artwork.toImage().pixel( 0,
+						artwork.height() - 1 ) ) );
+	QPainter painter( &background );
+	painter.drawPixmap( 0, 0, artwork );
+	painter.end();
+
 	setAutoFillBackground( true );
 	QPalette pal;
-	pal.setBrush( backgroundRole(),
-				PLUGIN_NAME::getIconPixmap( "artwork" ) );
+	pal.setBrush( backgroundRole(), background );
 	setPalette( pal );
-	setFixedSize( 224, 274 );
+	setFixedSize( background.size() );
 
 	Graph * waveGraph = new Graph( this, Graph::LinearNonCyclicStyle, 204, 205 );
 	waveGraph -> move( 10, 6 );
@@ -107,6 +119,13 @@ waveShaperControlDialog::waveShaperControlDialog(
 	clipInputToggle -> setModel( &_controls -> m_clipModel );
 	ToolTip::add( clipInputToggle, tr( "Clip input signal to 0 dB" ) );
 
+	ComboBox * oversamplingBox = new ComboBox( this );
+	oversamplingBox->setGeometry( 10, 276, 204, 22 );
+	oversamplingBox->setFont( pointSize<8>( oversamplingBox->font() ) );
+	oversamplingBox->setModel( &_controls->m_oversamplingModel );
+	ToolTip::add( oversamplingBox, tr( "Shape at a higher rate so "
+				"the distortion doesn't alias, at more CPU" ) );
+
 	connect( resetButton, SIGNAL (clicked () ),
 			_controls, SLOT ( resetClicked() ) );
 	connect( smoothButton, SIGNAL (clicked () ),
@@ -42,8 +42,14 @@ waveShaperControls::waveShaperControls( waveShaperEffect * _eff ) :
 	m_inputModel( 1.0f, 0.0f, 5.0f, 0.01f, this, tr( "Input gain" ) ),
 	m_outputModel( 1.0f, 0.0f, 5.0f, 0.01f, this, tr( "Output gain" ) ),
 	m_wavegraphModel( 0.0f, 1.0f, 200, this ),
-	m_clipModel( false, this )
+	m_clipModel( false, this ),
+	m_oversamplingModel( this, tr( "Oversampling" ) )
 {
+	m_oversamplingModel.addItem( tr( "No oversampling" ) );
+	m_oversamplingModel.addItem( tr( "2x oversampling" ) );
+	m_oversamplingModel.addItem( tr( "4x oversampling" ) );
+	m_oversamplingModel.addItem( tr( "8x oversampling" ) );
+
 	connect( &m_wavegraphModel, SIGNAL( samplesChanged( int, int ) ),
 			this, SLOT( samplesChanged( int, int ) ) );
 
@@ -68,6 +74,7 @@ void waveShaperControls::loadSettings( const QDomElement & _this )
 	m_outputModel.loadSettings( _this, "outputGain" );
 	
 	m_clipModel.loadSettings( _this, "clipInput" );
+	m_oversamplingModel.loadSettings( _this, "oversampling" );
 
 //load waveshape
 	int size = 0;
@@ -90,6 +97,7 @@ void waveShaperControls::saveSettings( QDomDocument & _doc,
 	m_outputModel.saveSettings( _doc, _this, "outputGain" );
 
 	m_clipModel.saveSettings( _doc, _this, "clipInput" );
+	m_oversamplingModel.saveSettings( _doc, _this, "oversampling" );
 
 //save waveshape
 	QString sampleString;
@@ -26,6 +26,7 @@
 #ifndef WAVESHAPER_CONTROLS_H
 #define WAVESHAPER_CONTROLS_H
 
+#include "ComboBoxModel.h"
 #include "EffectControls.h"
 #include "waveshaper_control_dialog.h"
 #include "Knob.h"
@@ -54,7 +55,7 @@ public:
 
 	virtual int controlCount()
 	{
-		return( 4 );
+		return( 5 );
 	}
 
 	virtual EffectControlDialog * createView()
@@ -78,6 +79,8 @@ private:
 	FloatModel m_outputModel;
 	graphModel m_wavegraphModel;
 	BoolModel  m_clipModel;
+	//! Runs the shaping at 2, 4 or 8 times the rate, see Oversampler
+	ComboBoxModel m_oversamplingModel;
 
 	friend class waveShaperControlDialog;
 	friend class waveShaperEffect;
@@ -111,6 +111,7 @@ ZynAddSubFxInstrument::ZynAddSubFxInstrument(
 	m_hasGUI( false ),
 	m_plugin( NULL ),
 	m_remotePlugin( NULL ),
+	m_latency( 0 ),
 	m_portamentoModel( 0, 0, 127, 1, this, tr( "Portamento" ) ),
 	m_filterFreqModel( 64, 0, 127, 1, this, tr( "Filter frequency" ) ),
 	m_filterQModel( 64, 0, 127, 1, this, tr( "Filter resonance" ) ),
@@ -338,10 +339,12 @@ void ZynAddSubFxInstrument::play( sampleFrame * _buf )
 	if( m_remotePlugin )
 	{
 		m_remotePlugin->process( NULL, _buf );
+		m_latency = m_remotePlugin->latency();
 	}
 	else
 	{
 		m_plugin->processAudio( _buf );
+		m_latency = 0;
 	}
 	m_pluginMutex.unlock();
 	instrumentTrack()->processAudioBuffer( _buf, Engine::mixer()->framesPerPeriod(), NULL );
@@ -85,6 +85,11 @@ public:
 		return IsSingleStreamed | IsMidiBased;
 	}
 
+	virtual f_cnt_t latencyFrames() const
+	{
+		return m_latency;
+	}
+
 	virtual PluginView * instantiateView( QWidget * _parent );
 
 
@@ -110,6 +115,8 @@ private:
 	QMutex m_pluginMutex;
 	LocalZynAddSubFx * m_plugin;
 	ZynAddSubFxRemotePlugin * m_remotePlugin;
+	// of the remote plugin, taken while playing as it's guarded by the mutex
+	f_cnt_t m_latency;
 
 	FloatModel m_portamentoModel;
 	FloatModel m_filterFreqModel;
@@ -0,0 +1,149 @@
+/*
+ * AudioTap.cpp - lets the GUI look at the audio of the master output, an FX
+ *                channel or a track without getting in the way of the mixer
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "AudioTap.h"
+
+#include <algorithm>
+
+#include "BufferManager.h"
+
+
+// written in pieces of this size when there's no buffer
+static const fpp_t SilenceFrames = 256;
+static const sampleFrame s_silence[SilenceFrames] = {};
+
+
+AudioTap::AudioTap() :
+	m_ring( Capacity ),
+	m_reader( m_ring ),
+	m_readers( 0 ),
+	m_history( new sampleFrame[Capacity] ),
+	m_historyPos( 0 ),
+	m_received( 0 )
+{
+	BufferManager::clear( m_history, Capacity );
+}
+
+
+
+
+AudioTap::~AudioTap()
+{
+	delete[] m_history;
+}
+
+
+
+
+void AudioTap::write( const sampleFrame * _buffer, fpp_t _frames )
+{
+	if( _buffer )
+	{
+		m_ring.write( _buffer, _frames );
+		return;
+	}
+	while( _frames > 0 )
+	{
+		const fpp_t frames = std::min( _frames, SilenceFrames );
+		m_ring.write( s_silence, frames );
+		_frames -= frames;
+	}
+}
+
+
+
+
+void AudioTap::addReader()
+{
+	if( m_readers.fetch_add( 1 ) == 0 )
+	{
+		// drop what's left from the last time anyone looked
+		fetch();
+		BufferManager::clear( m_history, Capacity );
+		m_historyPos = 0;
+		m_received = 0;
+	}
+}
+
+
+
+
+void AudioTap::removeReader()
+{
+	--m_readers;
+}
+
+
+
+
+void AudioTap::latest( sampleFrame * _dest, f_cnt_t _frames )
+{
+	fetch();
+
+	_frames = std::min( _frames, Capacity );
+	f_cnt_t pos = ( m_historyPos + Capacity - _frames ) % Capacity;
+	for( f_cnt_t f = 0; f < _frames; ++f )
+	{
+		_dest[f][0] = m_history[pos][0];
+		_dest[f][1] = m_history[pos][1];
+		pos = ( pos + 1 ) % Capacity;
+	}
+}
+
+
+
+
+void AudioTap::fetch()
+{
+	auto frames = m_reader.read_max( Capacity );
+	const f_cnt_t count = frames.size();
+	for( f_cnt_t f = 0; f < count; ++f )
+	{
+		m_history[m_historyPos][0] = frames[f][0];
+		m_history[m_historyPos][1] = frames[f][1];
+		m_historyPos = ( m_historyPos + 1 ) % Capacity;
+	}
+	m_received += count;
+}
+
+
+
+
+AudioTapPoint::~AudioTapPoint()
+{
+	delete m_tap.load();
+}
+
+
+
+
+AudioTap * AudioTapPoint::tap()
+{
+	AudioTap * tap = m_tap.load( std::memory_order_relaxed );
+	if( tap == nullptr )
+	{
+		tap = new AudioTap;
+		m_tap.store( tap, std::memory_order_release );
+	}
+	return tap;
+}
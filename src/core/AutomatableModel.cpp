@@ -24,6 +24,9 @@
 
 #include "AutomatableModel.h"
 
+#include <algorithm>
+#include <thread>
+
 #include "lmms_math.h"
 
 #include "AutomationPattern.h"
@@ -51,9 +54,12 @@ AutomatableModel::AutomatableModel(
 	m_setValueDepth( 0 ),
 	m_hasStrictStepSize( false ),
 	m_controllerConnection( NULL ),
-	m_valueBuffer( static_cast<int>( Engine::mixer()->framesPerPeriod() ) ),
+	m_valueBuffer( NULL ),
 	m_lastUpdatedPeriod( -1 ),
-	m_hasSampleExactData( false )
+	m_automatedPeriod( -1 ),
+	m_sharedValueBuffer( NULL ),
+	m_hasSampleExactData( false ),
+	m_updatingValueBuffer( false )
 
 {
 	m_value = fittedValue( val );
@@ -76,7 +82,10 @@ AutomatableModel::~AutomatableModel()
 		delete m_controllerConnection;
 	}
 
-	m_valueBuffer.clear();
+	if( m_valueBuffer )
+	{
+		ValueBuffer::release( m_valueBuffer );
+	}
 
 	emit destroyed( id() );
 }
@@ -400,6 +409,34 @@ void AutomatableModel::setAutomatedValue( const float value )
 
 
 
+void AutomatableModel::setAutomatedValues( const float * values, f_cnt_t offset )
+{
+	// the buffer replaces the ramp valueBuffer() would make to m_value
+	m_oldValue = m_value;
+
+	while( m_updatingValueBuffer.exchange( true, std::memory_order_acquire ) )
+	{
+		std::this_thread::yield();
+	}
+	const fpp_t frames = Engine::mixer()->framesPerPeriod();
+	float * buffer = ownValueBuffer()->values();
+	if( m_automatedPeriod != s_periodCounter )
+	{
+		std::fill( buffer, buffer + offset, fittedValue( scaledValue( values[0] ) ) );
+	}
+	for( fpp_t i = offset; i < frames; ++i )
+	{
+		buffer[i] = fittedValue( scaledValue( values[i - offset] ) );
+	}
+	m_automatedPeriod = s_periodCounter;
+	// in case it has been calculated already
+	m_lastUpdatedPeriod.store( -1, std::memory_order_release );
+	m_updatingValueBuffer.store( false, std::memory_order_release );
+}
+
+
+
+
 void AutomatableModel::setRange( const float min, const float max,
 							const float step )
 {
@@ -595,15 +632,37 @@ float AutomatableModel::controllerValue( int frameOffset ) const
 
 ValueBuffer * AutomatableModel::valueBuffer()
 {
-	QMutexLocker m( &m_valueBufferMutex );
-	// if we've already calculated the valuebuffer this period, return the cached buffer
-	if( m_lastUpdatedPeriod == s_periodCounter )
+	// if we've already calculated the valuebuffer this period, return the
+	// cached buffer, otherwise one thread calculates it and any others wait
+	// for it to be published
+	while( m_lastUpdatedPeriod.load( std::memory_order_acquire ) != s_periodCounter )
 	{
-		return m_hasSampleExactData
-			? &m_valueBuffer
-			: NULL;
+		if( !m_updatingValueBuffer.exchange( true, std::memory_order_acquire ) )
+		{
+			if( m_lastUpdatedPeriod.load( std::memory_order_relaxed ) != s_periodCounter )
+			{
+				updateValueBuffer();
+				m_lastUpdatedPeriod.store( s_periodCounter, std::memory_order_release );
+			}
+			m_updatingValueBuffer.store( false, std::memory_order_release );
+			break;
+		}
+		std::this_thread::yield();
 	}
 
+	if( !m_hasSampleExactData )
+	{
+		return NULL;
+	}
+	return m_sharedValueBuffer ? m_sharedValueBuffer : m_valueBuffer;
+}
+
+
+
+
+void AutomatableModel::updateValueBuffer()
+{
+	m_sharedValueBuffer = NULL;
 	float val = m_value; // make sure our m_value doesn't change midway
 
 	ValueBuffer * vb;
@@ -613,17 +672,17 @@ ValueBuffer * AutomatableModel::valueBuffer()
 		if( vb )
 		{
 			float * values = vb->values();
-			float * nvalues = m_valueBuffer.values();
+			float * nvalues = ownValueBuffer()->values();
 			switch( m_scaleType )
 			{
 			case Linear:
-				for( int i = 0; i < m_valueBuffer.length(); i++ )
+				for( int i = 0; i < m_valueBuffer->length(); i++ )
 				{
 					nvalues[i] = minValue<float>() + ( range() * values[i] );
 				}
 				break;
 			case Logarithmic:
-				for( int i = 0; i < m_valueBuffer.length(); i++ )
+				for( int i = 0; i < m_valueBuffer->length(); i++ )
 				{
 					nvalues[i] = logToLinearScale( values[i] );
 				}
@@ -633,9 +692,8 @@ ValueBuffer * AutomatableModel::valueBuffer()
 					"lacks implementation for a scale type");
 				break;
 			}
-			m_lastUpdatedPeriod = s_periodCounter;
 			m_hasSampleExactData = true;
-			return &m_valueBuffer;
+			return;
 		}
 	}
 	AutomatableModel* lm = NULL;
@@ -646,31 +704,52 @@ ValueBuffer * AutomatableModel::valueBuffer()
 	if( lm && lm->controllerConnection() && lm->controllerConnection()->getController()->isSampleExact() )
 	{
 		vb = lm->valueBuffer();
+		if( hasSameRangeAs( lm ) )
+		{
+			// nothing to fit, so read the linked model's buffer itself
+			// instead of copying it
+			if( m_valueBuffer )
+			{
+				ValueBuffer::release( m_valueBuffer );
+				m_valueBuffer = NULL;
+			}
+			m_sharedValueBuffer = vb;
+			m_hasSampleExactData = true;
+			return;
+		}
 		float * values = vb->values();
-		float * nvalues = m_valueBuffer.values();
+		float * nvalues = ownValueBuffer()->values();
 		for( int i = 0; i < vb->length(); i++ )
 		{
 			nvalues[i] = fittedValue( values[i] );
 		}
-		m_lastUpdatedPeriod = s_periodCounter;
 		m_hasSampleExactData = true;
-		return &m_valueBuffer;
+		return;
+	}
+
+	if( m_automatedPeriod == s_periodCounter )
+	{
+		m_hasSampleExactData = true;
+		return;
 	}
 
 	if( m_oldValue != val )
 	{
-		m_valueBuffer.interpolate( m_oldValue, val );
+		ownValueBuffer()->interpolate( m_oldValue, val );
 		m_oldValue = val;
-		m_lastUpdatedPeriod = s_periodCounter;
 		m_hasSampleExactData = true;
-		return &m_valueBuffer;
+		return;
 	}
 
 	// if we have no sample-exact source for a ValueBuffer, return NULL to signify that no data is available at the moment
 	// in which case the recipient knows to use the static value() instead
-	m_lastUpdatedPeriod = s_periodCounter;
+	// - and the buffer can go back to the pool until there's data again
+	if( m_valueBuffer )
+	{
+		ValueBuffer::release( m_valueBuffer );
+		m_valueBuffer = NULL;
+	}
 	m_hasSampleExactData = false;
-	return NULL;
 }
 
 
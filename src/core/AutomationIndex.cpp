@@ -0,0 +1,278 @@
+/*
+ * AutomationIndex.cpp - automation patterns and BB TCOs of a track
+ *                       container sorted by position for looking up
+ *                       automated values
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "AutomationIndex.h"
+
+#include <algorithm>
+
+#include <QtCore/QHash>
+
+#include "AutomationPattern.h"
+#include "BBTrack.h"
+#include "BBTrackContainer.h"
+#include "Engine.h"
+#include "TrackContainer.h"
+
+
+std::atomic_int AutomationIndex::s_generation( 0 );
+
+
+
+
+AutomationIndex::AutomationIndex( const TrackContainer * container ) :
+	m_container( container ),
+	m_generation( s_generation - 1 ),
+	m_cursor( 0 ),
+	m_time( 0 ),
+	m_evaluation( 0 )
+{
+}
+
+
+
+
+const AutomationIndex::Values & AutomationIndex::valuesAt( MidiTime time )
+{
+	update();
+	seek( time );
+
+	// every entry still in effect is evaluated once, BB TCOs through the
+	// BB track container
+	++m_evaluation;
+	m_values.clear();
+	for( size_t model = 0; model < m_models.size(); ++model )
+	{
+		const int winner = m_winners[model];
+		if( winner < 0 )
+		{
+			continue;
+		}
+		TrackContentObject * tco = m_entries[winner].tco;
+		if( auto * p = dynamic_cast<AutomationPattern *>( tco ) )
+		{
+			if( m_evaluated[winner] != m_evaluation )
+			{
+				MidiTime relTime = time - p->startPosition();
+				if( !p->getAutoResize() )
+				{
+					relTime = qMin( relTime, p->length() );
+				}
+				m_patternValues[winner] = p->valueAt( relTime );
+				m_evaluated[winner] = m_evaluation;
+			}
+			m_values.push_back( Value{ m_models[model],
+						m_patternValues[winner], p } );
+		}
+		else
+		{
+			if( m_evaluated[winner] != m_evaluation )
+			{
+				auto bbIndex = dynamic_cast<BBTrack *>( tco->getTrack() )->index();
+				auto bbContainer = Engine::getBBTrackContainer();
+
+				MidiTime bbTime = time - tco->startPosition();
+				bbTime = std::min( bbTime, tco->length() );
+				bbTime = bbTime % ( bbContainer->lengthOfBB( bbIndex ) *
+							MidiTime::ticksPerBar() );
+
+				m_bbValues[winner] = bbContainer->automatedValuesAt(
+								bbTime, bbIndex );
+				m_evaluated[winner] = m_evaluation;
+			}
+			auto it = m_bbValues[winner].find( m_models[model] );
+			if( it != m_bbValues[winner].end() )
+			{
+				m_values.push_back( Value{ m_models[model],
+							it.value(), NULL } );
+			}
+		}
+	}
+
+	return m_values;
+}
+
+
+
+
+const std::vector<AutomationPattern *> & AutomationIndex::recordingPatterns()
+{
+	update();
+	return m_recording;
+}
+
+
+
+
+void AutomationIndex::update()
+{
+	const int generation = s_generation;
+	if( generation != m_generation )
+	{
+		m_generation = generation;
+		rebuild();
+	}
+}
+
+
+
+
+void AutomationIndex::rebuild()
+{
+	m_entries.clear();
+	m_models.clear();
+	m_recording.clear();
+
+	QHash<AutomatableModel *, int> modelIndices;
+	auto addModels = [&]( Entry & entry, const AutomationPattern * p )
+	{
+		for( AutomatableModel * model : p->objects() )
+		{
+			if( !model )
+			{
+				continue;
+			}
+			auto it = modelIndices.find( model );
+			if( it == modelIndices.end() )
+			{
+				it = modelIndices.insert( model, m_models.size() );
+				m_models.push_back( model );
+			}
+			entry.models.push_back( it.value() );
+		}
+	};
+
+	for( Track * track : m_container->automationTracks() )
+	{
+		if( track->type() == Track::AutomationTrack )
+		{
+			for( TrackContentObject * tco : track->getTCOs() )
+			{
+				auto * p = dynamic_cast<AutomationPattern *>( tco );
+				if( p && p->isRecording() )
+				{
+					m_recording.push_back( p );
+				}
+			}
+		}
+
+		if( track->isMuted() )
+		{
+			continue;
+		}
+
+		switch( track->type() )
+		{
+		case Track::AutomationTrack:
+		case Track::HiddenAutomationTrack:
+		case Track::BBTrack:
+			break;
+		default:
+			continue;
+		}
+
+		for( TrackContentObject * tco : track->getTCOs() )
+		{
+			if( tco->isMuted() )
+			{
+				continue;
+			}
+			Entry entry;
+			entry.tco = tco;
+			if( auto * p = dynamic_cast<AutomationPattern *>( tco ) )
+			{
+				if( !p->hasAutomation() )
+				{
+					continue;
+				}
+				addModels( entry, p );
+			}
+			else if( auto * bb = dynamic_cast<BBTCO *>( tco ) )
+			{
+				// the models automated by the patterns of this BB
+				const int bbIndex = dynamic_cast<BBTrack *>( bb->getTrack() )->index();
+				for( Track * bbTrack : Engine::getBBTrackContainer()->tracks() )
+				{
+					if( bbTrack->isMuted() ||
+						( bbTrack->type() != Track::AutomationTrack &&
+						bbTrack->type() != Track::HiddenAutomationTrack ) ||
+						bbTrack->numOfTCOs() <= bbIndex )
+					{
+						continue;
+					}
+					auto * p = dynamic_cast<AutomationPattern *>(
+							bbTrack->getTCO( bbIndex ) );
+					if( p && !p->isMuted() && p->hasAutomation() )
+					{
+						addModels( entry, p );
+					}
+				}
+			}
+			else
+			{
+				continue;
+			}
+			m_entries.push_back( entry );
+		}
+	}
+
+	// later tracks take precedence over earlier ones at the same position
+	std::stable_sort( m_entries.begin(), m_entries.end(),
+		[]( const Entry & a, const Entry & b )
+		{
+			return a.tco->startPosition() < b.tco->startPosition();
+		} );
+
+	m_winners.assign( m_models.size(), -1 );
+	m_evaluated.assign( m_entries.size(), m_evaluation );
+	m_patternValues.assign( m_entries.size(), 0.0f );
+	m_bbValues.assign( m_entries.size(), AutomatedValueMap() );
+	m_values.reserve( m_models.size() );
+	m_cursor = 0;
+	m_time = 0;
+}
+
+
+
+
+void AutomationIndex::seek( MidiTime time )
+{
+	if( time < m_time )
+	{
+		// jumped back, e.g. looping
+		std::fill( m_winners.begin(), m_winners.end(), -1 );
+		m_cursor = 0;
+	}
+	m_time = time;
+
+	const int entries = m_entries.size();
+	while( m_cursor < entries &&
+		m_entries[m_cursor].tco->startPosition() <= time )
+	{
+		for( int model : m_entries[m_cursor].models )
+		{
+			m_winners[model] = m_cursor;
+		}
+		++m_cursor;
+	}
+}
@@ -34,7 +34,9 @@
 #include "BBTrackContainer.h"
 #include "Song.h"
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
 
 int AutomationPattern::s_quantization = 1;
 const float AutomationPattern::DEFAULT_MIN_VALUE = 0;
@@ -49,8 +51,13 @@ AutomationPattern::AutomationPattern( AutomationTrack * _auto_track ) :
 	m_progressionType( DiscreteProgression ),
 	m_dragging( false ),
 	m_isRecording( false ),
-	m_lastRecordedValue( 0 )
+	m_lastRecordedValue( 0 ),
+	m_indexedAutomation( false ),
+	m_indexedObjects( 0 )
 {
+	connect( this, SIGNAL( dataChanged() ),
+			this, SLOT( updateAutomationIndex() ),
+						Qt::DirectConnection );
 	changeLength( MidiTime( 1, 0 ) );
 	if( getTrack() )
 	{
@@ -77,8 +84,13 @@ AutomationPattern::AutomationPattern( const AutomationPattern & _pat_to_copy ) :
 	m_autoTrack( _pat_to_copy.m_autoTrack ),
 	m_objects( _pat_to_copy.m_objects ),
 	m_tension( _pat_to_copy.m_tension ),
-	m_progressionType( _pat_to_copy.m_progressionType )
+	m_progressionType( _pat_to_copy.m_progressionType ),
+	m_indexedAutomation( false ),
+	m_indexedObjects( 0 )
 {
+	connect( this, SIGNAL( dataChanged() ),
+			this, SLOT( updateAutomationIndex() ),
+						Qt::DirectConnection );
 	for( timeMap::const_iterator it = _pat_to_copy.m_timeMap.begin();
 				it != _pat_to_copy.m_timeMap.end(); ++it )
 	{
@@ -97,6 +109,7 @@ AutomationPattern::AutomationPattern( const AutomationPattern & _pat_to_copy ) :
 			setAutoResize( false );
 			break;
 	}
+	updateAutomationIndex();
 }
 
 bool AutomationPattern::addObject( AutomatableModel * _obj, bool _search_dup )
@@ -135,6 +148,7 @@ void AutomationPattern::setProgressionType(
 		_new_progression_type == CubicHermiteProgression )
 	{
 		m_progressionType = _new_progression_type;
+		invalidateSegments();
 		emit dataChanged();
 	}
 }
@@ -150,6 +164,7 @@ void AutomationPattern::setTension( QString _new_tension )
 	if( ok && nt > -0.01 && nt < 1.01 )
 	{
 		m_tension = nt;
+		invalidateSegments();
 	}
 }
 
@@ -395,6 +410,112 @@ float AutomationPattern::valueAt( timeMap::const_iterator v, int offset ) const
 
 
 
+bool AutomationPattern::renderValues( float * _values, float _time,
+					float _ticksPerFrame, int _frames ) const
+{
+	if( m_timeMap.isEmpty() )
+	{
+		std::fill( _values, _values + _frames, 0.0f );
+		return false;
+	}
+
+	const float last = getAutoResize() ?
+			std::numeric_limits<float>::max() :
+					static_cast<float>( length() );
+
+	// the first key after the current segment, the coefficients of the
+	// segment are only looked up when passing it
+	timeMap::const_iterator next = m_timeMap.upperBound(
+				static_cast<int>( qBound( 0.0f, _time, last ) ) );
+	bool changedSegment = true;
+	ProgressionTypes progression = DiscreteProgression;
+	float begin = 0, span = 1, v0 = 0, v1 = 0, m1 = 0, m2 = 0;
+
+	bool varies = false;
+	for( int i = 0; i < _frames; ++i )
+	{
+		const float time = qBound( 0.0f, _time + i * _ticksPerFrame, last );
+		while( next != m_timeMap.end() && next.key() <= time )
+		{
+			++next;
+			changedSegment = true;
+		}
+
+		if( changedSegment )
+		{
+			changedSegment = false;
+			progression = DiscreteProgression;
+			if( next == m_timeMap.begin() )
+			{
+				// like valueAt() before the first key
+				v0 = 0;
+			}
+			else if( next == m_timeMap.end() )
+			{
+				v0 = ( next - 1 ).value();
+			}
+			else
+			{
+				timeMap::const_iterator v = next - 1;
+				progression = m_progressionType;
+				begin = v.key();
+				span = next.key() - v.key();
+				v0 = v.value();
+				v1 = next.value();
+				m1 = m_tangents[v.key()] * span * m_tension;
+				m2 = m_tangents[next.key()] * span * m_tension;
+			}
+		}
+
+		// see valueAt( timeMap::const_iterator, int )
+		const float t = ( time - begin ) / span;
+		switch( progression )
+		{
+		case LinearProgression:
+			_values[i] = v0 + t * ( v1 - v0 );
+			break;
+		case CubicHermiteProgression:
+			_values[i] = ( 2*t*t*t - 3*t*t + 1 ) * v0
+					+ ( t*t*t - 2*t*t + t ) * m1
+					+ ( -2*t*t*t + 3*t*t ) * v1
+					+ ( t*t*t - t*t ) * m2;
+			break;
+		default:
+			_values[i] = v0;
+			break;
+		}
+		varies |= _values[i] != _values[0];
+	}
+
+	return varies;
+}
+
+
+
+
+QVector<float> AutomationPattern::segmentValues(
+		timeMap::const_iterator _segment, int _step ) const
+{
+	QMutexLocker lock( &m_segmentsMutex );
+	Segment & segment = m_segments[_segment.key()];
+	const int end = ( _segment + 1 ).key();
+	if( segment.end != end || segment.step != _step )
+	{
+		segment.end = end;
+		segment.step = _step;
+		segment.values.resize( ( end - _segment.key() + _step - 1 ) /
+								_step );
+		for( int i = 0; i < segment.values.size(); ++i )
+		{
+			segment.values[i] = valueAt( _segment, i * _step );
+		}
+	}
+	return segment.values;
+}
+
+
+
+
 float *AutomationPattern::valuesAfter( const MidiTime & _time ) const
 {
 	timeMap::ConstIterator v = m_timeMap.lowerBound( _time );
@@ -605,6 +726,7 @@ void AutomationPattern::loadSettings( const QDomElement & _this )
 		changeLength( len );
 	}
 	generateTangents();
+	updateAutomationIndex();
 }
 
 
@@ -808,6 +930,7 @@ void AutomationPattern::clear()
 {
 	m_timeMap.clear();
 	m_tangents.clear();
+	invalidateSegments();
 
 	emit dataChanged();
 }
@@ -859,6 +982,21 @@ void AutomationPattern::cleanObjects()
 
 
 
+void AutomationPattern::updateAutomationIndex()
+{
+	// the index only cares about whether and which models are automated
+	if( hasAutomation() != m_indexedAutomation ||
+				m_objects.size() != m_indexedObjects )
+	{
+		m_indexedAutomation = hasAutomation();
+		m_indexedObjects = m_objects.size();
+		AutomationIndex::invalidate();
+	}
+}
+
+
+
+
 void AutomationPattern::generateTangents()
 {
 	generateTangents(m_timeMap.begin(), m_timeMap.size());
@@ -867,9 +1005,44 @@ void AutomationPattern::generateTangents()
 
 
 
+void AutomationPattern::invalidateSegments( int _from, int _to )
+{
+	QMutexLocker lock( &m_segmentsMutex );
+	QMap<int, Segment>::iterator it = m_segments.lowerBound( _from );
+	while( it != m_segments.end() && it.key() <= _to )
+	{
+		it = m_segments.erase( it );
+	}
+}
+
+
+
+
+void AutomationPattern::invalidateSegments()
+{
+	QMutexLocker lock( &m_segmentsMutex );
+	m_segments.clear();
+}
+
+
+
+
 void AutomationPattern::generateTangents( timeMap::const_iterator it,
 							int numToGenerate )
 {
+	// the segments ending at the first point and starting at the ones
+	// whose tangents change, and the ones points were removed from
+	if( it != m_timeMap.end() )
+	{
+		timeMap::const_iterator last = it;
+		for( int i = 0; i < numToGenerate && last + 1 != m_timeMap.end(); ++i )
+		{
+			++last;
+		}
+		invalidateSegments( it == m_timeMap.begin() ? 0 :
+					( it - 1 ).key(), last.key() );
+	}
+
 	if( m_timeMap.size() < 2 && numToGenerate > 0 )
 	{
 		m_tangents[it.key()] = 0;
@@ -0,0 +1,495 @@
+/*
+ * BBLoopCache.cpp - replays the audio of an instrument track of a
+ *                   beat/bassline which repeats unchanged
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "BBLoopCache.h"
+
+#include "AutomatableModel.h"
+#include "BBTrackContainer.h"
+#include "ConfigManager.h"
+#include "Engine.h"
+#include "Instrument.h"
+#include "InstrumentTrack.h"
+#include "Mixer.h"
+#include "NotePlayHandle.h"
+#include "OneShotCache.h"
+#include "Pattern.h"
+#include "Song.h"
+
+
+BBLoopCache::BBLoopCache( InstrumentTrack * _track ) :
+	m_track( _track ),
+	m_handle( new BBLoopPlayHandle( this, _track ) ),
+	m_modelsValid( false ),
+	m_state( Live ),
+	m_bb( -1 ),
+	m_nextTick( 0 ),
+	m_loopTicks( 0 ),
+	m_playedLoopStart( false ),
+	m_framesSinceTick( 0 ),
+	m_loopBB( -1 ),
+	m_fingerprint( 0 ),
+	m_captureBegin( -1 ),
+	m_captureEnd( 0 ),
+	m_captured( false ),
+	m_switchOffset( 0 )
+{
+	Engine::mixer()->requestChangeInModel();
+	m_track->audioPort()->setLoopCache( this );
+	if( !Engine::mixer()->addPlayHandle( m_handle ) )
+	{
+		// the mixer deleted it already, the track is just never cached
+		m_handle = NULL;
+	}
+	Engine::mixer()->doneChangeInModel();
+}
+
+
+
+
+BBLoopCache::~BBLoopCache()
+{
+	Engine::mixer()->requestChangeInModel();
+	m_track->audioPort()->setLoopCache( NULL );
+	if( m_handle )
+	{
+		Engine::mixer()->removePlayHandle( m_handle );
+	}
+	Engine::mixer()->doneChangeInModel();
+}
+
+
+
+
+bool BBLoopCache::isEnabled()
+{
+	return ConfigManager::inst()->value( "mixer", "bbcache" ).toInt();
+}
+
+
+
+
+void BBLoopCache::setModels( const QList<AutomatableModel *> & _models )
+{
+	m_models = _models;
+	m_modelsValid = true;
+}
+
+
+
+
+void BBLoopCache::clearModels()
+{
+	m_models.clear();
+	m_modelsValid = false;
+}
+
+
+
+
+void BBLoopCache::startPeriod()
+{
+	const fpp_t fpp = Engine::mixer()->framesPerPeriod();
+
+	// a loop is only complete if every period of it has been recorded,
+	// the port doesn't process anything while the track is muted
+	if( m_captureBegin >= 0 && !m_captured )
+	{
+		stop( 0 );
+	}
+	m_captureBegin = -1;
+	m_captured = false;
+
+	const Song * song = Engine::getSong();
+	m_framesSinceTick += fpp;
+	if( !( song->isPlaying() || song->isExporting() ) ||
+		m_framesSinceTick > Engine::periodFramesPerTick() + fpp )
+	{
+		// neither the song nor the beat/bassline is played anymore
+		stop( 0 );
+		m_bb = -1;
+		m_playedLoopStart = false;
+		return;
+	}
+
+	switch( m_state )
+	{
+		case Recording:
+			m_captureBegin = 0;
+			m_captureEnd = fpp;
+			break;
+
+		case Switching:
+		{
+			// notes played live would be removed along with the ones
+			// of the beat/bassline
+			for( const NotePlayHandle * note : m_track->m_processHandles )
+			{
+				if( note->bbTrack() == NULL )
+				{
+					stop( 0 );
+					return;
+				}
+			}
+			Engine::mixer()->removePlayHandlesOfTypes( m_track,
+						PlayHandle::TypeNotePlayHandle );
+			// the notes played the first frames of the loop in the
+			// rest of the last period
+			const f_cnt_t frames = m_loop.size() / DEFAULT_CHANNELS;
+			m_handle->start( ( fpp - m_switchOffset ) % frames );
+			m_state = Replaying;
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
+
+
+
+bool BBLoopCache::playTick( Pattern * _pattern, Track * _bbTrack, int _bb,
+						tick_t _tick, f_cnt_t _offset )
+{
+	m_framesSinceTick = 0;
+
+	// patterns played on their own repeat with a length of their own
+	if( Engine::getSong()->playMode() == Song::Mode_PlayPattern )
+	{
+		stop( _offset );
+		m_bb = -1;
+		m_playedLoopStart = false;
+		return false;
+	}
+
+	// whether this tick follows the last one of the same beat/bassline,
+	// which tells apart e.g. several beat/basslines played at once
+	bool contiguous = _bb == m_bb && _tick == m_nextTick;
+	if( _tick == 0 )
+	{
+		contiguous = _bb == m_bb && m_loopTicks > 0 &&
+						m_nextTick == m_loopTicks;
+		m_loopTicks = Engine::getBBTrackContainer()->lengthOfBB( _bb ) *
+							MidiTime::ticksPerBar();
+	}
+	m_nextTick = _tick + 1;
+
+	if( !contiguous )
+	{
+		stop( _offset );
+		m_bb = _bb;
+		m_playedLoopStart = _tick == 0;
+		return false;
+	}
+	if( _tick > 0 )
+	{
+		return m_state == Replaying;
+	}
+
+	// a repetition starts - it sounds the same as the one before if that
+	// one was played from its start, with the tails of the notes of the
+	// one before that, and nothing changed
+	const bool followsLoop = m_playedLoopStart;
+	m_playedLoopStart = true;
+	quint64 fingerprint = 0;
+	const bool eligible = followsLoop &&
+			this->fingerprint( _pattern, _bbTrack, fingerprint );
+	const bool same = eligible && _bb == m_loopBB &&
+					fingerprint == m_fingerprint;
+
+	switch( m_state )
+	{
+		case Replaying:
+			if( same )
+			{
+				m_handle->restart( _offset );
+				return true;
+			}
+			stop( _offset );
+			break;
+
+		case Recording:
+			if( same )
+			{
+				m_captureEnd = _offset;
+				m_switchOffset = _offset;
+				m_state = Switching;
+			}
+			else
+			{
+				stop( _offset );
+			}
+			break;
+
+		case Live:
+			if( same && !m_loop.empty() )
+			{
+				// e.g. when the beat/bassline is played again
+				m_switchOffset = _offset;
+				m_state = Switching;
+			}
+			else if( eligible )
+			{
+				const fpp_t fpp = Engine::mixer()->framesPerPeriod();
+				m_state = Recording;
+				m_loopBB = _bb;
+				m_fingerprint = fingerprint;
+				m_loop.clear();
+				m_loop.reserve( ( f_cnt_t( m_loopTicks *
+					Engine::periodFramesPerTick() ) + fpp ) *
+							DEFAULT_CHANNELS );
+				m_captureBegin = _offset;
+				m_captureEnd = fpp;
+			}
+			break;
+
+		case Switching:
+			break;
+	}
+	return false;
+}
+
+
+
+
+void BBLoopCache::capture( const sampleFrame * const * _sources, int _count,
+								fpp_t _frames )
+{
+	if( m_captureBegin < 0 )
+	{
+		return;
+	}
+
+	const f_cnt_t end = qMin<f_cnt_t>( m_captureEnd, _frames );
+	const size_t at = m_loop.size();
+	m_loop.resize( at + ( end - m_captureBegin ) * DEFAULT_CHANNELS, 0 );
+	sample_t * dst = m_loop.data() + at;
+	for( int i = 0; i < _count; ++i )
+	{
+		const sampleFrame * src = _sources[i];
+		for( f_cnt_t f = m_captureBegin; f < end; ++f )
+		{
+			for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+			{
+				dst[( f - m_captureBegin ) * DEFAULT_CHANNELS + ch] +=
+								src[f][ch];
+			}
+		}
+	}
+	m_captured = true;
+}
+
+
+
+
+bool BBLoopCache::fingerprint( Pattern * _pattern, Track * _bbTrack,
+						quint64 & _fingerprint ) const
+{
+	const Instrument * instrument = m_track->instrument();
+	if( m_handle == NULL || !m_modelsValid || _pattern == NULL ||
+		instrument == NULL || !instrument->isDeterministic() ||
+		instrument->flags().testFlag( Instrument::IsSingleStreamed ) ||
+		!m_track->m_arpeggio.isDeterministic() ||
+		m_track->m_soundShaping.usesLfo() ||
+		// played a period ahead of the ticks
+		m_track->audioPort()->renderedAhead() )
+	{
+		return false;
+	}
+
+	const sample_rate_t sampleRate =
+				Engine::mixer()->processingSampleRate();
+	if( m_loopTicks * Engine::periodFramesPerTick() >
+						MaxSeconds * sampleRate )
+	{
+		return false;
+	}
+
+	// notes played live would be recorded
+	for( const NotePlayHandle * note : m_track->m_processHandles )
+	{
+		if( note->bbTrack() == NULL )
+		{
+			return false;
+		}
+	}
+
+	OneShotCache::Key key;
+	key << static_cast<int>( sampleRate ) << m_loopTicks
+		<< Engine::periodFramesPerTick()
+		<< Engine::getSong()->masterPitch()
+		<< static_cast<int>( _pattern->isMuted() )
+		<< static_cast<int>( _bbTrack && _bbTrack->isMuted() );
+	for( const AutomatableModel * model : m_models )
+	{
+		// automation may change the sound from one repetition to the
+		// next
+		if( model->isAutomatedOrControlled() )
+		{
+			return false;
+		}
+		key << model->value<float>();
+	}
+	for( const Note & note : _pattern->playedNotes() )
+	{
+		key << static_cast<int>( note.pos() )
+			<< static_cast<int>( note.length() )
+			<< note.key()
+			<< static_cast<int>( note.getVolume() )
+			<< static_cast<int>( note.getPanning() );
+	}
+	_fingerprint = key.value();
+	return true;
+}
+
+
+
+
+void BBLoopCache::stop( f_cnt_t _offset )
+{
+	switch( m_state )
+	{
+		case Replaying:
+			m_handle->stop( _offset );
+			break;
+
+		case Recording:
+		case Switching:
+			// a loop is incomplete until its last period has been
+			// recorded
+			if( m_state == Recording || m_captureBegin >= 0 )
+			{
+				m_loop.clear();
+				m_loopBB = -1;
+				m_captureBegin = -1;
+			}
+			break;
+
+		case Live:
+			break;
+	}
+	m_state = Live;
+}
+
+
+
+
+BBLoopPlayHandle::BBLoopPlayHandle( BBLoopCache * _cache,
+						InstrumentTrack * _track ) :
+	PlayHandle( TypeBBLoopPlayHandle ),
+	m_cache( _cache ),
+	m_track( _track ),
+	m_frame( -1 ),
+	m_restartOffset( -1 ),
+	m_stopOffset( -1 )
+{
+	setAudioPort( _track->audioPort() );
+}
+
+
+
+
+void BBLoopPlayHandle::play( sampleFrame * _buffer )
+{
+	const std::vector<sample_t> & loop = m_cache->m_loop;
+	const f_cnt_t frames = loop.size() / DEFAULT_CHANNELS;
+	const fpp_t fpp = Engine::mixer()->framesPerPeriod();
+	const f_cnt_t end = m_stopOffset >= 0 ? m_stopOffset : fpp;
+
+	auto copy = [&]( f_cnt_t _from, f_cnt_t _to )
+	{
+		if( m_frame < 0 || frames == 0 )
+		{
+			return;
+		}
+		for( f_cnt_t f = _from; f < _to; ++f )
+		{
+			if( m_frame >= frames )
+			{
+				m_frame = 0;
+			}
+			_buffer[f][0] = loop[m_frame * DEFAULT_CHANNELS];
+			_buffer[f][1] = loop[m_frame * DEFAULT_CHANNELS + 1];
+			++m_frame;
+		}
+	};
+
+	f_cnt_t offset = 0;
+	if( m_restartOffset >= 0 )
+	{
+		copy( 0, qMin( m_restartOffset, end ) );
+		offset = m_restartOffset;
+		m_frame = 0;
+		m_restartOffset = -1;
+	}
+	copy( offset, end );
+
+	if( m_stopOffset >= 0 )
+	{
+		m_frame = -1;
+		m_stopOffset = -1;
+	}
+}
+
+
+
+
+bool BBLoopPlayHandle::isFromTrack( const Track * _track ) const
+{
+	return m_track == _track;
+}
+
+
+
+
+void BBLoopPlayHandle::start( f_cnt_t _frame )
+{
+	m_frame = _frame;
+	m_restartOffset = -1;
+	m_stopOffset = -1;
+}
+
+
+
+
+void BBLoopPlayHandle::restart( f_cnt_t _offset )
+{
+	m_restartOffset = _offset;
+}
+
+
+
+
+void BBLoopPlayHandle::stop( f_cnt_t _offset )
+{
+	m_restartOffset = -1;
+	if( _offset <= 0 )
+	{
+		m_frame = -1;
+		m_stopOffset = -1;
+	}
+	else
+	{
+		m_stopOffset = _offset;
+	}
+}
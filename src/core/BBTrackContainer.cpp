@@ -24,8 +24,10 @@
 
 
 #include "BBTrackContainer.h"
+#include "BBLoopCache.h"
 #include "BBTrack.h"
 #include "Engine.h"
+#include "InstrumentTrack.h"
 #include "Song.h"
 
 
@@ -79,6 +81,40 @@ bool BBTrackContainer::play( MidiTime _start, fpp_t _frames,
 
 
 
+void BBTrackContainer::setLoopCaching( bool _enabled )
+{
+	for( Track * track : tracks() )
+	{
+		if( track->type() == Track::InstrumentTrack )
+		{
+			static_cast<InstrumentTrack *>( track )->
+						setLoopCaching( _enabled );
+		}
+	}
+}
+
+
+
+
+void BBTrackContainer::startPeriod()
+{
+	for( Track * track : tracks() )
+	{
+		if( track->type() == Track::InstrumentTrack )
+		{
+			BBLoopCache * cache = static_cast<InstrumentTrack *>(
+							track )->loopCache();
+			if( cache )
+			{
+				cache->startPeriod();
+			}
+		}
+	}
+}
+
+
+
+
 void BBTrackContainer::updateAfterTrackAdd()
 {
 	if( numOfBBs() == 0 && !Engine::getSong()->isLoadingProject() )
@@ -25,9 +25,18 @@
 
 #include "BandLimitedWave.h"
 
+#include <cstring>
+
 #include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "lmmsversion.h"
 
-WaveMipMap BandLimitedWave::s_waveforms[4] = {  };
+const WaveMipMap * BandLimitedWave::s_waveforms = NULL;
 bool BandLimitedWave::s_wavesGenerated = false;
 QString BandLimitedWave::s_wavetableDir = "";
 
@@ -59,11 +68,119 @@ QDataStream& operator>> ( QDataStream &in, WaveMipMap &waveMipMap )
 }
 
 
+namespace
+{
+
+// The cache holds the mipmaps in the memory layout of this build, the
+// header makes sure it has been written by a compatible one.
+struct CacheHeader
+{
+	char magic[8];
+	quint32 byteOrder;
+	quint32 mipMapSize;
+	quint32 waveforms;
+	quint32 reserved;
+} ;
+
+const char CacheMagic[8] = { 'L', 'M', 'M', 'S', 'W', 'T', 'B', 'L' };
+const quint32 CacheByteOrder = 0x01020304;
+
+// mappings are removed when the file is closed, so it stays open
+QFile * s_cacheFile = NULL;
+
+}
+
+
+
+
+static QString cacheFileName()
+{
+	return QStandardPaths::writableLocation(
+				QStandardPaths::GenericCacheLocation ) +
+			"/lmms/wavetables-" LMMS_VERSION ".cache";
+}
+
+
+
+
+static CacheHeader cacheHeader()
+{
+	CacheHeader header;
+	memcpy( header.magic, CacheMagic, sizeof( CacheMagic ) );
+	header.byteOrder = CacheByteOrder;
+	header.mipMapSize = sizeof( WaveMipMap );
+	header.waveforms = BandLimitedWave::NumBLWaveforms;
+	header.reserved = 0;
+	return header;
+}
+
+
+
+
+static bool mapCache()
+{
+	QFile * file = new QFile( cacheFileName() );
+	const CacheHeader expected = cacheHeader();
+	const qint64 size = sizeof( CacheHeader ) +
+			sizeof( WaveMipMap ) * BandLimitedWave::NumBLWaveforms;
+
+	if( file->open( QIODevice::ReadOnly ) && file->size() == size )
+	{
+		// pages are only read in once a waveform is played
+		const uchar * data = file->map( 0, size );
+		if( data != NULL &&
+			memcmp( data, &expected, sizeof( CacheHeader ) ) == 0 )
+		{
+			s_cacheFile = file;
+			BandLimitedWave::s_waveforms =
+				reinterpret_cast<const WaveMipMap *>(
+						data + sizeof( CacheHeader ) );
+			return true;
+		}
+	}
+
+	delete file;
+	return false;
+}
+
+
+
+
+// written to a temporary file and renamed, so processes starting meanwhile
+// never map a partial cache
+static void writeCache( const WaveMipMap * _waves )
+{
+	const QString fileName = cacheFileName();
+	if( !QDir().mkpath( QFileInfo( fileName ).absolutePath() ) )
+	{
+		return;
+	}
+
+	QSaveFile file( fileName );
+	if( file.open( QIODevice::WriteOnly ) )
+	{
+		const CacheHeader header = cacheHeader();
+		file.write( reinterpret_cast<const char *>( &header ),
+							sizeof( header ) );
+		file.write( reinterpret_cast<const char *>( _waves ),
+			sizeof( WaveMipMap ) * BandLimitedWave::NumBLWaveforms );
+		file.commit();
+	}
+}
+
+
 void BandLimitedWave::generateWaves()
 {
 // don't generate if they already exist
 	if( s_wavesGenerated ) return;
 
+	if( mapCache() )
+	{
+		s_wavesGenerated = true;
+		return;
+	}
+
+	WaveMipMap * waves = new WaveMipMap[NumBLWaveforms];
 	int i;
 
 // set wavetable directory
@@ -81,7 +198,7 @@ void BandLimitedWave::generateWaves()
 	{
 		saw_file.open( QIODevice::ReadOnly );
 		QDataStream in( &saw_file );
-		in >> s_waveforms[ BandLimitedWave::BLSaw ];
+		in >> waves[ BandLimitedWave::BLSaw ];
 		saw_file.close();
 	}
 	else
@@ -105,14 +222,14 @@ void BandLimitedWave::generateWaves()
 					s += amp * /*a2 **/sin( static_cast<double>( ph * harm ) / static_cast<double>( len ) * F_2PI );
 					harm++;
 				} while( hlen > 2.0 );
-				s_waveforms[ BandLimitedWave::BLSaw ].setSampleAt( i, ph, s );
+				waves[ BandLimitedWave::BLSaw ].setSampleAt( i, ph, s );
 				max = qMax( max, qAbs( s ) );
 			}
 			// normalize
 			for( int ph = 0; ph < len; ph++ )
 			{
-				sample_t s = s_waveforms[ BandLimitedWave::BLSaw ].sampleAt( i, ph ) / max;
-				s_waveforms[ BandLimitedWave::BLSaw ].setSampleAt( i, ph, s );
+				sample_t s = waves[ BandLimitedWave::BLSaw ].sampleAt( i, ph ) / max;
+				waves[ BandLimitedWave::BLSaw ].setSampleAt( i, ph, s );
 			}
 		}
 	}
@@ -123,7 +240,7 @@ void BandLimitedWave::generateWaves()
 	{
 		sqr_file.open( QIODevice::ReadOnly );
 		QDataStream in( &sqr_file );
-		in >> s_waveforms[ BandLimitedWave::BLSquare ];
+		in >> waves[ BandLimitedWave::BLSquare ];
 		sqr_file.close();
 	}
 	else
@@ -147,14 +264,14 @@ void BandLimitedWave::generateWaves()
 					s += amp * /*a2 **/ sin( static_cast<double>( ph * harm ) / static_cast<double>( len ) * F_2PI );
 					harm += 2;
 				} while( hlen > 2.0 );
-				s_waveforms[ BandLimitedWave::BLSquare ].setSampleAt( i, ph, s );
+				waves[ BandLimitedWave::BLSquare ].setSampleAt( i, ph, s );
 				max = qMax( max, qAbs( s ) );
 			}
 			// normalize
 			for( int ph = 0; ph < len; ph++ )
 			{
-				sample_t s = s_waveforms[ BandLimitedWave::BLSquare ].sampleAt( i, ph ) / max;
-				s_waveforms[ BandLimitedWave::BLSquare ].setSampleAt( i, ph, s );
+				sample_t s = waves[ BandLimitedWave::BLSquare ].sampleAt( i, ph ) / max;
+				waves[ BandLimitedWave::BLSquare ].setSampleAt( i, ph, s );
 			}
 		}
 	}
@@ -164,7 +281,7 @@ void BandLimitedWave::generateWaves()
 	{
 		tri_file.open( QIODevice::ReadOnly );
 		QDataStream in( &tri_file );
-		in >> s_waveforms[ BandLimitedWave::BLTriangle ];
+		in >> waves[ BandLimitedWave::BLTriangle ];
 		tri_file.close();
 	}
 	else
@@ -189,14 +306,14 @@ void BandLimitedWave::generateWaves()
 							( ( harm + 1 ) % 4 == 0 ? 0.5 : 0.0 ) ) * F_2PI );
 					harm += 2;
 				} while( hlen > 2.0 );
-				s_waveforms[ BandLimitedWave::BLTriangle ].setSampleAt( i, ph, s );
+				waves[ BandLimitedWave::BLTriangle ].setSampleAt( i, ph, s );
 				max = qMax( max, qAbs( s ) );
 			}
 			// normalize
 			for( int ph = 0; ph < len; ph++ )
 			{
-				sample_t s = s_waveforms[ BandLimitedWave::BLTriangle ].sampleAt( i, ph ) / max;
-				s_waveforms[ BandLimitedWave::BLTriangle ].setSampleAt( i, ph, s );
+				sample_t s = waves[ BandLimitedWave::BLTriangle ].sampleAt( i, ph ) / max;
+				waves[ BandLimitedWave::BLTriangle ].setSampleAt( i, ph, s );
 			}
 		}
 	}
@@ -207,7 +324,7 @@ void BandLimitedWave::generateWaves()
 	{
 		moog_file.open( QIODevice::ReadOnly );
 		QDataStream in( &moog_file );
-		in >> s_waveforms[ BandLimitedWave::BLMoog ];
+		in >> waves[ BandLimitedWave::BLMoog ];
 		moog_file.close();
 	}
 	else
@@ -219,13 +336,16 @@ void BandLimitedWave::generateWaves()
 			for( int ph = 0; ph < len; ph++ )
 			{
 				const int sawph = ( ph + static_cast<int>( len * 0.75 ) ) % len;
-				const sample_t saw = s_waveforms[ BandLimitedWave::BLSaw ].sampleAt( i, sawph );
-				const sample_t tri = s_waveforms[ BandLimitedWave::BLTriangle ].sampleAt( i, ph );
-				s_waveforms[ BandLimitedWave::BLMoog ].setSampleAt( i, ph, ( saw + tri ) * 0.5f );
+				const sample_t saw = waves[ BandLimitedWave::BLSaw ].sampleAt( i, sawph );
+				const sample_t tri = waves[ BandLimitedWave::BLTriangle ].sampleAt( i, ph );
+				waves[ BandLimitedWave::BLMoog ].setSampleAt( i, ph, ( saw + tri ) * 0.5f );
 			}
 		}
 	}
 
+	s_waveforms = waves;
+	writeCache( waves );
+
 // set the generated flag so we don't load/generate them again needlessly
 	s_wavesGenerated = true;
 
@@ -249,22 +369,22 @@ QFile moogfile( "path-to-wavetables/moog.bin" );
 
 sawfile.open( QIODevice::WriteOnly );
 QDataStream sawout( &sawfile );
-sawout << s_waveforms[ BandLimitedWave::BLSaw ];
+sawout << waves[ BandLimitedWave::BLSaw ];
 sawfile.close();
 
 sqrfile.open( QIODevice::WriteOnly );
 QDataStream sqrout( &sqrfile );
-sqrout << s_waveforms[ BandLimitedWave::BLSquare ];
+sqrout << waves[ BandLimitedWave::BLSquare ];
 sqrfile.close();
 
 trifile.open( QIODevice::WriteOnly );
 QDataStream triout( &trifile );
-triout << s_waveforms[ BandLimitedWave::BLTriangle ];
+triout << waves[ BandLimitedWave::BLTriangle ];
 trifile.close();
 
 moogfile.open( QIODevice::WriteOnly );
 QDataStream moogout( &moogfile );
-moogout << s_waveforms[ BandLimitedWave::BLMoog ];
+moogout << waves[ BandLimitedWave::BLMoog ];
 moogfile.close();
 
 */
@@ -0,0 +1,333 @@
+/*
+ * BlobContainer.cpp - binary projects keeping samples and plugin states as
+ *                     raw blobs next to their XML
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "BlobContainer.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QStringList>
+#include <QtCore/QtEndian>
+#include <QtXml/QDomNamedNodeMap>
+
+#include <climits>
+#include <cstring>
+
+
+namespace
+{
+
+const char Magic[] = "LMMSMMPB";
+const int MagicSize = 8;
+const quint32 Version = 1;
+const int HeaderSize = MagicSize + 4 + 4 + 8 + 8;
+const int Alignment = 16;
+
+// written into the file, adoptReferences() adds the container's id
+const char * const ReferencePrefix = "lmms-blob:";
+
+// attributes whose loaders decode them with base64::decode() or check for
+// references themselves, which are worth a blob of their own above the size
+const char * const BlobAttributes[] = { "data", "srcdata", "chunk" };
+const int MinimumBlobSize = 4096;
+
+QMutex s_mutex;
+QHash<quint64, BlobContainer *> s_containers;
+quint64 s_nextId = 1;
+
+
+qint64 aligned( qint64 _offset )
+{
+	return ( _offset + Alignment - 1 ) / Alignment * Alignment;
+}
+
+
+
+
+bool isBlobAttribute( const QString & _name )
+{
+	for( const char * name : BlobAttributes )
+	{
+		if( _name == name )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+
+
+// the index of a reference as written into the file, -1 if it isn't one
+int fileReferenceIndex( const QString & _value )
+{
+	if( !_value.startsWith( ReferencePrefix ) )
+	{
+		return -1;
+	}
+	bool ok = false;
+	const int index = _value.mid( strlen( ReferencePrefix ) ).toInt( &ok );
+	return ok ? index : -1;
+}
+
+
+
+
+// calls _visit with each element below and including _element
+template<class Visitor>
+void visitElements( QDomElement _element, Visitor _visit )
+{
+	_visit( _element );
+	for( QDomElement child = _element.firstChildElement(); !child.isNull();
+					child = child.nextSiblingElement() )
+	{
+		visitElements( child, _visit );
+	}
+}
+
+}
+
+
+
+
+BlobContainer::BlobContainer( const QString & _file ) :
+	m_file( _file ),
+	m_map( NULL ),
+	m_id( 0 )
+{
+	if( !m_file.open( QIODevice::ReadOnly ) ||
+					m_file.size() < HeaderSize )
+	{
+		return;
+	}
+	const qint64 size = m_file.size();
+	uchar * map = m_file.map( 0, size );
+	if( map == NULL ||
+		!isContainer( QByteArray::fromRawData(
+				reinterpret_cast<const char *>( map ), MagicSize ) ) ||
+		qFromLittleEndian<quint32>( map + MagicSize ) != Version )
+	{
+		return;
+	}
+
+	// the XML and the blobs, which all have to be within the file
+	const quint32 count = qFromLittleEndian<quint32>( map + MagicSize + 4 );
+	if( HeaderSize + 16 * qint64( count ) > size )
+	{
+		return;
+	}
+	QVector<QByteArray> parts;
+	for( quint32 i = 0; i <= count; ++i )
+	{
+		const uchar * entry = map + MagicSize + 8 + 16 * i;
+		const quint64 offset = qFromLittleEndian<quint64>( entry );
+		const quint64 length = qFromLittleEndian<quint64>( entry + 8 );
+		if( offset > quint64( size ) || length > quint64( size ) - offset ||
+							length > INT_MAX )
+		{
+			return;
+		}
+		parts.push_back( QByteArray::fromRawData(
+				reinterpret_cast<const char *>( map + offset ),
+								int( length ) ) );
+	}
+
+	m_map = map;
+	m_xml = parts.takeFirst();
+	m_blobs = parts;
+
+	QMutexLocker lock( &s_mutex );
+	m_id = s_nextId++;
+	s_containers.insert( m_id, this );
+}
+
+
+
+
+BlobContainer::~BlobContainer()
+{
+	if( m_map )
+	{
+		QMutexLocker lock( &s_mutex );
+		s_containers.remove( m_id );
+	}
+}
+
+
+
+
+void BlobContainer::adoptReferences( QDomElement _element ) const
+{
+	const QString prefix = ReferencePrefix + QString::number( m_id ) + ':';
+	visitElements( _element, [&]( QDomElement & _el )
+	{
+		const QDomNamedNodeMap attributes = _el.attributes();
+		for( int i = 0; i < attributes.count(); ++i )
+		{
+			QDomAttr attribute = attributes.item( i ).toAttr();
+			const int index = fileReferenceIndex( attribute.value() );
+			if( index >= 0 )
+			{
+				attribute.setValue( prefix + QString::number( index ) );
+			}
+		}
+	} );
+}
+
+
+
+
+bool BlobContainer::isContainer( const QByteArray & _head )
+{
+	return _head.startsWith( QByteArray( Magic, MagicSize ) );
+}
+
+
+
+
+bool BlobContainer::isReference( const QString & _value )
+{
+	// a reference of a file has the index only
+	return _value.startsWith( ReferencePrefix ) &&
+			_value.indexOf( ':', strlen( ReferencePrefix ) ) > 0;
+}
+
+
+
+
+QByteArray BlobContainer::data( const QString & _reference )
+{
+	const QStringList parts = _reference.mid( strlen( ReferencePrefix ) ).
+								split( ':' );
+	if( !_reference.startsWith( ReferencePrefix ) || parts.size() != 2 )
+	{
+		return QByteArray();
+	}
+
+	QMutexLocker lock( &s_mutex );
+	const BlobContainer * container =
+			s_containers.value( parts[0].toULongLong(), NULL );
+	const int index = parts[1].toInt();
+	if( container == NULL || index < 0 ||
+					index >= container->m_blobs.size() )
+	{
+		return QByteArray();
+	}
+	return container->m_blobs[index];
+}
+
+
+
+
+QList<BlobContainer::Replacement> BlobContainer::replaceAttributes(
+			QDomElement _element, QList<QByteArray> * _blobs )
+{
+	QList<Replacement> replacements;
+	visitElements( _element, [&]( QDomElement & _el )
+	{
+		const QDomNamedNodeMap attributes = _el.attributes();
+		for( int i = 0; i < attributes.count(); ++i )
+		{
+			QDomAttr attribute = attributes.item( i ).toAttr();
+			const QString value = attribute.value();
+			const bool reference = isReference( value );
+			if( !reference && ( _blobs == NULL ||
+				!isBlobAttribute( attribute.name() ) ||
+					value.size() < MinimumBlobSize ) )
+			{
+				continue;
+			}
+
+			replacements.push_back( Replacement{ _el, attribute.name(),
+								value } );
+			if( _blobs == NULL )
+			{
+				attribute.setValue( QString::fromLatin1(
+						data( value ).toBase64() ) );
+				continue;
+			}
+			// copied, the container may be overwritten by the write
+			_blobs->push_back( reference ?
+				QByteArray( data( value ).constData(),
+						data( value ).size() ) :
+				QByteArray::fromBase64( value.toLatin1() ) );
+			attribute.setValue( ReferencePrefix +
+					QString::number( _blobs->size() - 1 ) );
+		}
+	} );
+	return replacements;
+}
+
+
+
+
+void BlobContainer::restore( const QList<Replacement> & _replacements )
+{
+	for( Replacement replacement : _replacements )
+	{
+		replacement.element.setAttribute( replacement.name,
+							replacement.value );
+	}
+}
+
+
+
+
+bool BlobContainer::write( QIODevice & _out, const QByteArray & _xml,
+					const QList<QByteArray> & _blobs )
+{
+	QByteArray header( HeaderSize + 16 * _blobs.size(), '\0' );
+	uchar * h = reinterpret_cast<uchar *>( header.data() );
+	memcpy( h, Magic, MagicSize );
+	qToLittleEndian<quint32>( Version, h + MagicSize );
+	qToLittleEndian<quint32>( _blobs.size(), h + MagicSize + 4 );
+
+	QList<QByteArray> parts = _blobs;
+	parts.prepend( _xml );
+	qint64 offset = aligned( header.size() );
+	for( int i = 0; i < parts.size(); ++i )
+	{
+		qToLittleEndian<quint64>( offset, h + MagicSize + 8 + 16 * i );
+		qToLittleEndian<quint64>( parts[i].size(),
+						h + MagicSize + 16 + 16 * i );
+		offset = aligned( offset + parts[i].size() );
+	}
+
+	if( _out.write( header ) != header.size() )
+	{
+		return false;
+	}
+	qint64 written = header.size();
+	for( const QByteArray & part : parts )
+	{
+		const QByteArray padding( aligned( written ) - written, '\0' );
+		if( _out.write( padding ) != padding.size() ||
+				_out.write( part ) != part.size() )
+		{
+			return false;
+		}
+		written += padding.size() + part.size();
+	}
+	return true;
+}
@@ -26,21 +26,142 @@
 
 #include "BufferManager.h"
 
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <QtCore/QMutex>
+
+#include "lmmsconfig.h"
+
+#ifdef LMMS_BUILD_LINUX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #include "Engine.h"
+#include "LocklessAllocator.h"
 #include "Mixer.h"
 #include "MemoryManager.h"
 
 static fpp_t framesPerPeriod;
 
-void BufferManager::init( fpp_t framesPerPeriod )
+// The mixer never uses periods longer than DEFAULT_BUFFER_SIZE (it
+// renders several of them instead), so buffers of that size fit whatever
+// period size the mixer has been initialized with and the pools can be
+// kept across mixers. They are never freed, buffers may still be released
+// while the application exits.
+static const int MaxPools = 8;
+static const int InitialPoolSize = 512;
+static const size_t CacheLineSize = 64;
+static const size_t HugePageSize = 2 * 1024 * 1024;
+
+static bool s_hugePages = false;
+
+static std::atomic<LocklessAllocator *> s_pools[MaxPools];
+static QMutex s_poolsMutex;
+
+static std::atomic_int s_capacity( 0 );
+static std::atomic_int s_inUse( 0 );
+static std::atomic_int s_highWater( 0 );
+static std::atomic_int s_overflows( 0 );
+
+
+
+
+// asks for transparent huge pages behind the whole pages of the memory
+static void adviseHugePages( void * _mem, size_t _bytes )
+{
+#if defined( LMMS_BUILD_LINUX ) && defined( MADV_HUGEPAGE )
+	const uintptr_t pageSize = sysconf( _SC_PAGESIZE );
+	const uintptr_t begin = ( (uintptr_t) _mem + pageSize - 1 ) &
+							~( pageSize - 1 );
+	const uintptr_t end = ( (uintptr_t) _mem + _bytes ) & ~( pageSize - 1 );
+	if( end > begin )
+	{
+		madvise( (void *) begin, end - begin, MADV_HUGEPAGE );
+	}
+#else
+	Q_UNUSED( _mem );
+	Q_UNUSED( _bytes );
+#endif
+}
+
+
+
+
+// callers hold s_poolsMutex
+static void addPool( int _size )
+{
+	for( int i = 0; i < MaxPools; ++i )
+	{
+		if( s_pools[i].load( std::memory_order_relaxed ) == NULL )
+		{
+			LocklessAllocator * pool = new LocklessAllocator( _size,
+					sizeof( sampleFrame ) * DEFAULT_BUFFER_SIZE,
+					CacheLineSize );
+			if( s_hugePages )
+			{
+				// only the huge page sized parts of the pool
+				// get them, which takes pools of a few MB
+				adviseHugePages( pool->pool(), pool->poolSize() );
+			}
+			s_pools[i].store( pool, std::memory_order_release );
+			s_capacity += _size;
+			return;
+		}
+	}
+}
+
+
+
+
+void BufferManager::init( fpp_t framesPerPeriod, bool _hugePages )
 {
 	::framesPerPeriod = framesPerPeriod;
+
+	s_poolsMutex.lock();
+	if( s_capacity == 0 )
+	{
+		s_hugePages = _hugePages;
+		addPool( InitialPoolSize );
+	}
+	s_poolsMutex.unlock();
+}
+
+
+fpp_t BufferManager::framesPerPeriod()
+{
+	return ::framesPerPeriod;
 }
 
 
 sampleFrame * BufferManager::acquire()
 {
-	return MM_ALLOC( sampleFrame, ::framesPerPeriod );
+	const int inUse = ++s_inUse;
+	int highWater = s_highWater.load( std::memory_order_relaxed );
+	while( inUse > highWater &&
+		!s_highWater.compare_exchange_weak( highWater, inUse ) )
+	{
+	}
+
+	for( int i = 0; i < MaxPools; ++i )
+	{
+		LocklessAllocator * pool = s_pools[i].load( std::memory_order_acquire );
+		if( pool == NULL )
+		{
+			break;
+		}
+		if( void * buf = pool->tryAlloc() )
+		{
+			return static_cast<sampleFrame *>( buf );
+		}
+	}
+
+	++s_overflows;
+	return MM_ALLOC_TAGGED( sampleFrame, ::framesPerPeriod, PeriodBuffers );
 }
 
 void BufferManager::clear( sampleFrame *ab, const f_cnt_t frames, const f_cnt_t offset )
@@ -59,6 +180,135 @@ void BufferManager::clear( surroundSampleFrame * ab, const f_cnt_t frames,
 
 void BufferManager::release( sampleFrame * buf )
 {
+	if( buf == NULL )
+	{
+		return;
+	}
+	--s_inUse;
+
+	for( int i = 0; i < MaxPools; ++i )
+	{
+		LocklessAllocator * pool = s_pools[i].load( std::memory_order_acquire );
+		if( pool == NULL )
+		{
+			break;
+		}
+		if( pool->contains( buf ) )
+		{
+			pool->free( buf );
+			return;
+		}
+	}
+
 	MM_FREE( buf );
 }
 
+
+
+
+void BufferManager::reserve()
+{
+	s_poolsMutex.lock();
+	const int capacity = s_capacity;
+	if( s_highWater > capacity * 3 / 4 )
+	{
+		// doubles the capacity
+		addPool( qMax( capacity, InitialPoolSize ) );
+	}
+	s_poolsMutex.unlock();
+}
+
+
+
+
+void BufferManager::trim()
+{
+#ifdef LMMS_BUILD_LINUX
+	const uintptr_t pageSize = sysconf( _SC_PAGESIZE );
+	const size_t bufferSize = sizeof( sampleFrame ) * DEFAULT_BUFFER_SIZE;
+
+	s_poolsMutex.lock();
+	for( int i = 0; i < MaxPools; ++i )
+	{
+		LocklessAllocator * pool = s_pools[i].load( std::memory_order_acquire );
+		if( pool == NULL )
+		{
+			break;
+		}
+
+		// take the free buffers so nobody writes to them while their
+		// pages are dropped
+		std::vector<void *> buffers;
+		while( void * buf = pool->tryAlloc() )
+		{
+			buffers.push_back( buf );
+		}
+		for( void * buf : buffers )
+		{
+			const uintptr_t begin = ( (uintptr_t) buf + pageSize - 1 ) &
+								~( pageSize - 1 );
+			const uintptr_t end = ( (uintptr_t) buf + bufferSize ) &
+								~( pageSize - 1 );
+			if( end > begin )
+			{
+				madvise( (void *) begin, end - begin, MADV_DONTNEED );
+			}
+			pool->free( buf );
+		}
+	}
+	s_poolsMutex.unlock();
+#endif
+}
+
+
+
+
+BufferManager::Statistics BufferManager::statistics()
+{
+	Statistics stats;
+	stats.inUse = s_inUse;
+	stats.highWater = s_highWater;
+	stats.capacity = s_capacity;
+	stats.overflows = s_overflows;
+	return stats;
+}
+
+
+
+
+
+void * BufferManager::allocSlab( size_t _bytes )
+{
+	// whole huge pages, so no other allocation shares them
+	const size_t alignment = s_hugePages ? HugePageSize : CacheLineSize;
+	_bytes = ( _bytes + alignment - 1 ) & ~( alignment - 1 );
+
+	// the start of the allocation is kept right before the slab
+	char * mem = static_cast<char *>( malloc( _bytes + alignment +
+							sizeof( void * ) ) );
+	if( mem == NULL )
+	{
+		return NULL;
+	}
+	char * slab = reinterpret_cast<char *>( ( (uintptr_t) mem +
+			sizeof( void * ) + alignment - 1 ) & ~( alignment - 1 ) );
+	reinterpret_cast<void **>( slab )[-1] = mem;
+
+	if( s_hugePages )
+	{
+		adviseHugePages( slab, _bytes );
+	}
+	memset( slab, 0, _bytes );
+	return slab;
+}
+
+
+
+
+void BufferManager::freeSlab( void * _slab )
+{
+	if( _slab )
+	{
+		free( reinterpret_cast<void **>( _slab )[-1] );
+	}
+}
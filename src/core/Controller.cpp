@@ -29,6 +29,8 @@
 #include <QVector>
 
 
+#include <thread>
+
 #include "Song.h"
 #include "Mixer.h"
 #include "ControllerConnection.h"
@@ -38,7 +40,6 @@
 #include "PeakController.h"
 
 
-long Controller::s_periods = 0;
 QVector<Controller *> Controller::s_controllers;
 
 
@@ -49,8 +50,11 @@ Controller::Controller( ControllerTypes _type, Model * _parent,
 	JournallingObject(),
 	m_valueBuffer( Engine::mixer()->framesPerPeriod() ),
 	m_bufferLastUpdated( -1 ),
+	m_bufferPublished( -1 ),
 	m_connectionCount( 0 ),
-	m_type( _type )
+	m_context( Engine::context() ),
+	m_type( _type ),
+	m_updatingBuffer( false )
 {
 	if( _type != DummyController && _type != MidiController )
 	{
@@ -112,35 +116,50 @@ float Controller::currentValue( int _offset )
 
 float Controller::value( int offset )
 {
-	if( m_bufferLastUpdated != s_periods )
-	{
-		updateValueBuffer();
-	}
+	publishValueBuffer();
 	return m_valueBuffer.values()[ offset ];
 }
 	
 
 ValueBuffer * Controller::valueBuffer()
 {
-	if( m_bufferLastUpdated != s_periods )
+	publishValueBuffer();
+	return &m_valueBuffer;
+}
+
+
+void Controller::publishValueBuffer()
+{
+	const long periods = runningPeriods();
+	while( m_bufferPublished.load( std::memory_order_acquire ) != periods )
 	{
-		updateValueBuffer();
+		// one consumer updates, the others wait for it
+		if( !m_updatingBuffer.exchange( true, std::memory_order_acquire ) )
+		{
+			if( m_bufferLastUpdated != periods )
+			{
+				updateValueBuffer();
+			}
+			m_bufferPublished.store( periods, std::memory_order_release );
+			m_updatingBuffer.store( false, std::memory_order_release );
+			break;
+		}
+		std::this_thread::yield();
 	}
-	return &m_valueBuffer;
 }
 
 
 void Controller::updateValueBuffer()
 {
 	m_valueBuffer.fill(0.5f);
-	m_bufferLastUpdated = s_periods;
+	m_bufferLastUpdated = runningPeriods();
 }
 
 
 // Get position in frames
 unsigned int Controller::runningFrames()
 {
-	return s_periods * Engine::mixer()->framesPerPeriod();
+	return runningPeriods() * Engine::mixer()->framesPerPeriod();
 }
 
 
@@ -155,16 +174,25 @@ float Controller::runningTime()
 
 void Controller::triggerFrameCounter()
 {
+	EngineContext * context = Engine::context();
 	for (Controller * controller : s_controllers)
 	{
+		if( controller->m_context != context )
+		{
+			continue;
+		}
 		// This signal is for updating values for both stubborn knobs and for
 		// painting.  If we ever get all the widgets to use or at least check
 		// currentValue() then we can throttle the signal and only use it for
-		// GUI.
-		emit controller->valueChanged();
+		// GUI. Nothing listens to controllers without connections, and
+		// they aren't updated until something reads them.
+		if( controller->m_connectionCount > 0 )
+		{
+			emit controller->valueChanged();
+		}
 	}
 
-	s_periods ++;
+	context->controllerPeriods ++;
 	//emit s_signaler.triggerValueChanged();
 }
 
@@ -172,11 +200,16 @@ void Controller::triggerFrameCounter()
 
 void Controller::resetFrameCounter()
 {
+	EngineContext * context = Engine::context();
 	for (Controller * controller : s_controllers)
 	{
-		controller->m_bufferLastUpdated = 0;
+		if( controller->m_context == context )
+		{
+			controller->m_bufferLastUpdated = 0;
+			controller->m_bufferPublished = -1;
+		}
 	}
-	s_periods = 0;
+	context->controllerPeriods = 0;
 }
 
 
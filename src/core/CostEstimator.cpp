@@ -0,0 +1,495 @@
+/*
+ * CostEstimator.cpp - estimates whether a project plays in real time and
+ *                     what to change if it doesn't
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "CostEstimator.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "AudioPort.h"
+#include "BBTrackContainer.h"
+#include "ConfigManager.h"
+#include "Effect.h"
+#include "EffectChain.h"
+#include "Engine.h"
+#include "FxMixer.h"
+#include "InstrumentTrack.h"
+#include "MixerWorkerThread.h"
+#include "ProjectRenderer.h"
+#include "RenderManager.h"
+#include "SampleTrack.h"
+#include "Song.h"
+#include "stdshims.h"
+
+
+constexpr float CostEstimator::Headroom;
+
+// the longest period suggested
+static const fpp_t MaximumFrames = 4096;
+// shares of a core below which parts aren't worth a suggestion
+static const float CostlyInstrument = 0.05f;
+static const float CostlyEffect = 0.01f;
+
+
+float CostEstimator::load( float _total, float _longest, float _overhead,
+				fpp_t _frames, fpp_t _targetFrames, int _cores,
+						sample_rate_t _sampleRate )
+{
+	const float jobs = std::max( _total / std::max( _cores, 1 ), _longest );
+	const float period = _targetFrames * 1000000.0f / _sampleRate;
+	return ( jobs * _targetFrames / _frames + _overhead ) / period;
+}
+
+
+
+
+CostEstimator::CostEstimator( const Mixer::qualitySettings & _qualitySettings,
+				const OutputSettings & _outputSettings,
+				fpp_t _targetFrames, int _cores ) :
+	m_qualitySettings( _qualitySettings ),
+	m_outputSettings( _outputSettings ),
+	m_targetFrames( _targetFrames ),
+	m_cores( _cores ),
+	m_reader( Engine::mixer()->renderStats() ),
+	m_samples( 0 ),
+	m_loadSum( 0.0 ),
+	m_periods( 0 ),
+	m_peakLoad( 0.0f ),
+	m_threads( 1 ),
+	m_frames( DEFAULT_BUFFER_SIZE ),
+	m_sampleRate( 44100 ),
+	m_failed( false ),
+	m_averageEstimate( 0.0f ),
+	m_peakEstimate( 0.0f )
+{
+	connect( &m_sampleTimer, SIGNAL( timeout() ), this, SLOT( sample() ) );
+}
+
+
+
+
+CostEstimator::~CostEstimator()
+{
+	m_manager.reset();
+}
+
+
+
+
+void CostEstimator::start()
+{
+	collectParts();
+	if( m_parts.isEmpty() || !m_dir.isValid() )
+	{
+		m_failed = true;
+		emit finished();
+		return;
+	}
+
+	// the periods before the render don't count
+	m_reader.read_max( m_reader.read_space() );
+
+	m_manager = make_unique<RenderManager>( m_qualitySettings,
+			m_outputSettings, ProjectRenderer::WaveFile,
+			m_dir.filePath( "estimate.wav" ) );
+	// the manager is deleted once it returned from its signal
+	connect( m_manager.get(), SIGNAL( finished() ),
+			this, SLOT( renderFinished() ), Qt::QueuedConnection );
+
+	m_sampleTimer.start( SampleInterval );
+	m_manager->renderProject();
+}
+
+
+
+
+void CostEstimator::updateConsoleProgress()
+{
+	if( m_manager )
+	{
+		m_manager->updateConsoleProgress();
+	}
+}
+
+
+
+
+void CostEstimator::sample()
+{
+	// the quality of the render applies once it started
+	m_frames = Engine::mixer()->framesPerPeriod();
+	m_sampleRate = Engine::mixer()->processingSampleRate();
+	m_threads = std::max( MixerWorkerThread::threadCount(), 1 );
+
+	auto stats = m_reader.read_max( m_reader.read_space() );
+	if( stats.size() == 0 )
+	{
+		// not rendering yet
+		return;
+	}
+	for( std::size_t i = 0; i < stats.size(); ++i )
+	{
+		m_loadSum += stats[i].load;
+		m_peakLoad = std::max( m_peakLoad, stats[i].load );
+	}
+	m_periods += stats.size();
+
+	// parts which weren't processed for a while keep their last time, so
+	// the estimate errs on the safe side
+	for( PartCost & part : m_parts )
+	{
+		const float instrument = part.instrument ?
+					part.instrument->average() : 0.0f;
+		part.instrumentTime += instrument;
+		part.effectTime += part.job->cpuUsage().average();
+		part.peak = std::max( part.peak, ( part.instrument ?
+				part.instrument->maximum() : 0.0f ) +
+					part.job->cpuUsage().maximum() );
+		if( part.track )
+		{
+			part.peakVoices = std::max( part.peakVoices,
+						part.track->voiceCount() );
+		}
+
+		for( EffectCost & effect : part.effects )
+		{
+			// effects which sleep don't take any time
+			if( !effect.effect->isEnabled() ||
+						!effect.effect->isRunning() )
+			{
+				continue;
+			}
+			effect.time += effect.effect->cpuUsage().average();
+			effect.peak = std::max( effect.peak,
+					effect.effect->cpuUsage().maximum() );
+			// counting down to sleeping since the output is silent
+			if( effect.effect->bufferCount() > 0 )
+			{
+				++effect.silentSamples;
+			}
+		}
+	}
+	++m_samples;
+}
+
+
+
+
+void CostEstimator::renderFinished()
+{
+	m_sampleTimer.stop();
+	sample();
+	m_manager.reset();
+
+	if( m_samples == 0 || m_periods == 0 )
+	{
+		m_failed = true;
+		emit finished();
+		return;
+	}
+
+	suggest();
+	report();
+	emit finished();
+}
+
+
+
+
+void CostEstimator::addPart( const QString & _name, InstrumentTrack * _track,
+			const CpuUsage * _instrument, const ThreadableJob * _job,
+						const EffectChain * _effects )
+{
+	PartCost part = { _name, _track, _instrument, _job,
+				QVector<EffectCost>(), 0.0, 0.0, 0.0f, 0 };
+	if( _effects )
+	{
+		for( Effect * effect : _effects->m_effects )
+		{
+			part.effects.push_back( EffectCost{ effect,
+					effect->displayName(), 0.0, 0.0f, 0 } );
+		}
+	}
+	m_parts.push_back( part );
+}
+
+
+
+
+void CostEstimator::collectParts()
+{
+	m_parts.clear();
+
+	TrackContainer::TrackList tracks = Engine::getSong()->tracks();
+	tracks += Engine::getBBTrackContainer()->tracks();
+	for( Track * track : tracks )
+	{
+		if( track->type() == Track::InstrumentTrack )
+		{
+			InstrumentTrack * it =
+				static_cast<InstrumentTrack *>( track );
+			AudioPort * port = it->audioPort();
+			addPart( it->name(), it, &port->playHandleCpuUsage(),
+						port, port->effects() );
+		}
+		else if( track->type() == Track::SampleTrack )
+		{
+			AudioPort * port =
+				static_cast<SampleTrack *>( track )->audioPort();
+			addPart( track->name(), NULL,
+				&port->playHandleCpuUsage(), port,
+							port->effects() );
+		}
+	}
+
+	FxMixer * fxMixer = Engine::fxMixer();
+	for( fx_ch_t ch = 0; ch < fxMixer->numChannels(); ++ch )
+	{
+		FxChannel * channel = fxMixer->effectChannel( ch );
+		addPart( channel->m_name, NULL, NULL, channel,
+						&channel->m_fxChain );
+	}
+}
+
+
+
+
+void CostEstimator::estimate( const QVector<bool> & _without,
+			fpp_t _targetFrames, float & _average, float & _peak ) const
+{
+	const float period = m_frames * 1000000.0f / m_sampleRate;
+	const float measured = static_cast<float>( m_loadSum / m_periods );
+
+	float total = 0.0f;
+	float longest = 0.0f;
+	float allTotal = 0.0f;
+	float allLongest = 0.0f;
+	for( int p = 0; p < m_parts.size(); ++p )
+	{
+		const PartCost & part = m_parts[p];
+		const float time = static_cast<float>( ( part.instrumentTime +
+					part.effectTime ) / m_samples );
+		allTotal += time;
+		allLongest = std::max( allLongest, time );
+		if( !_without[p] )
+		{
+			total += time;
+			longest = std::max( longest, time );
+		}
+	}
+
+	// whatever the render took beyond the jobs
+	const float overhead = std::max( measured * period -
+			std::max( allTotal / m_threads, allLongest ), 0.0f );
+
+	_average = load( total, longest, overhead, m_frames, _targetFrames,
+						m_cores, m_sampleRate );
+	// the periods take as much longer than the average as they did here
+	_peak = measured > 0.0f ?
+		_average * std::max( m_peakLoad / measured, 1.0f ) : _average;
+}
+
+
+
+
+void CostEstimator::suggest()
+{
+	m_suggestions.clear();
+
+	QVector<bool> without( m_parts.size(), false );
+	estimate( without, m_targetFrames, m_averageEstimate,
+							m_peakEstimate );
+
+	// freezing the most costly tracks, which are then played from audio
+	float average = m_averageEstimate;
+	float peak = m_peakEstimate;
+	if( peak > Headroom )
+	{
+		QVector<int> order;
+		for( int p = 0; p < m_parts.size(); ++p )
+		{
+			if( m_parts[p].track && !m_parts[p].track->isFrozen() )
+			{
+				order.push_back( p );
+			}
+		}
+		std::sort( order.begin(), order.end(), [this]( int a, int b )
+		{
+			return m_parts[a].instrumentTime + m_parts[a].effectTime >
+				m_parts[b].instrumentTime + m_parts[b].effectTime;
+		} );
+
+		for( int p : order )
+		{
+			if( peak <= Headroom )
+			{
+				break;
+			}
+			const PartCost & part = m_parts[p];
+			without[p] = true;
+			estimate( without, m_targetFrames, average, peak );
+			m_suggestions << tr( "Freeze \"%1\", it takes %2% of a core" ).
+				arg( part.name ).arg( 100.0f * share(
+					( part.instrumentTime + part.effectTime ) /
+							m_samples ), 0, 'f', 1 );
+		}
+	}
+
+	if( peak > Headroom )
+	{
+		// the overhead of the mixer thread weighs less with longer
+		// periods
+		fpp_t frames = m_targetFrames * 2;
+		for( ; frames <= MaximumFrames; frames *= 2 )
+		{
+			estimate( without, frames, average, peak );
+			if( peak <= Headroom )
+			{
+				break;
+			}
+		}
+		if( frames <= MaximumFrames )
+		{
+			m_suggestions << tr( "Use periods of %1 frames" ).
+								arg( frames );
+		}
+		else
+		{
+			m_suggestions << tr( "Even then it won't play in real "
+					"time on %1 cores" ).arg( m_cores );
+		}
+	}
+
+	// limiting the polyphony of costly instruments playing many voices
+	for( const PartCost & part : m_parts )
+	{
+		if( !part.track || part.peakVoices <= ManyVoices ||
+			share( part.instrumentTime / m_samples ) <
+							CostlyInstrument )
+		{
+			continue;
+		}
+		const int voices = std::max( part.peakVoices / 2, ManyVoices / 2 );
+		const int polyphony = part.track->polyphonyModel()->value();
+		if( polyphony == 0 || polyphony > voices )
+		{
+			m_suggestions << tr( "Limit the polyphony of \"%1\" to %2 "
+				"voices, it plays up to %3" ).arg( part.name ).
+					arg( voices ).arg( part.peakVoices );
+		}
+	}
+
+	// effects which keep processing once their input is silent
+	if( ConfigManager::inst()->value( "ui", "disableautoquit" ).toInt() )
+	{
+		m_suggestions << tr( "Enable auto-quit in the settings, effects "
+				"process silence until they are disabled" );
+		return;
+	}
+	for( const PartCost & part : m_parts )
+	{
+		for( const EffectCost & effect : part.effects )
+		{
+			if( share( effect.time / m_samples ) < CostlyEffect ||
+					effect.silentSamples * 2 < m_samples )
+			{
+				continue;
+			}
+			m_suggestions << tr( "\"%1\" on \"%2\" processes silence "
+				"%3% of the time, lower its decay or raise its "
+				"gate" ).arg( effect.name ).arg( part.name ).
+					arg( 100 * effect.silentSamples / m_samples );
+		}
+	}
+}
+
+
+
+
+void CostEstimator::report() const
+{
+	const float measured = static_cast<float>( m_loadSum / m_periods );
+	printf( "\nMeasured with %d frames per period on %d threads: "
+			"average load %.0f%%, peaks %.0f%%\n", m_frames,
+			m_threads, 100.0f * measured, 100.0f * m_peakLoad );
+	printf( "Estimated with %d frames per period on %d cores: "
+			"average load %.0f%%, peaks %.0f%%\n\n", m_targetFrames,
+			m_cores, 100.0f * m_averageEstimate,
+						100.0f * m_peakEstimate );
+
+	printf( "%-32s %10s %10s %10s %7s\n", "Share of a core",
+				"instrument", "effects", "peak", "voices" );
+	for( const PartCost & part : m_parts )
+	{
+		const QByteArray name = part.name.left( 32 ).toUtf8();
+		printf( "%-32s", name.constData() );
+		if( part.instrument )
+		{
+			printf( " %9.1f%%", 100.0f *
+				share( part.instrumentTime / m_samples ) );
+		}
+		else
+		{
+			printf( " %10s", "" );
+		}
+		printf( " %9.1f%% %9.1f%%", 100.0f *
+				share( part.effectTime / m_samples ),
+				100.0f * share( part.peak ) );
+		if( part.track )
+		{
+			printf( " %7d", part.peakVoices );
+		}
+		printf( "\n" );
+
+		for( const EffectCost & effect : part.effects )
+		{
+			const QByteArray effectName =
+					effect.name.left( 30 ).toUtf8();
+			printf( "  %-30s %10s %9.1f%% %9.1f%%  silent %d%%\n",
+				effectName.constData(), "", 100.0f *
+					share( effect.time / m_samples ),
+				100.0f * share( effect.peak ),
+				100 * effect.silentSamples / m_samples );
+		}
+	}
+
+	if( m_suggestions.isEmpty() )
+	{
+		printf( "\nIt leaves enough headroom, nothing to change.\n" );
+		return;
+	}
+	printf( "\nSuggestions:\n" );
+	for( const QString & suggestion : m_suggestions )
+	{
+		printf( "  - %s\n", suggestion.toUtf8().constData() );
+	}
+}
+
+
+
+
+float CostEstimator::share( double _microseconds ) const
+{
+	return static_cast<float>( _microseconds * m_sampleRate /
+						( m_frames * 1000000.0 ) );
+}
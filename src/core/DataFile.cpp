@@ -34,6 +34,7 @@
 #include <QMessageBox>
 
 #include "base64.h"
+#include "BlobContainer.h"
 #include "ConfigManager.h"
 #include "Effect.h"
 #include "embed.h"
@@ -47,6 +48,8 @@
 #include "lmmsversion.h"
 
 static void findIds(const QDomElement& elem, QList<jo_id_t>& idList);
+static QList<QDomElement> findElements(const QDomNode& node, const QString& tagName);
+static void renameElements(const QDomNode& node, const QString& from, const QString& to);
 
 
 
@@ -92,6 +95,54 @@ DataFile::DataFile( Type type ) :
 
 
 
+//! The elements below node named tagName in document order, found in a
+//! single pass. Unlike the live list of elementsByTagName(), which searches
+//! the document again after each child added or removed, it may be
+//! changed while going through it.
+QList<QDomElement> findElements(const QDomNode& node, const QString& tagName)
+{
+	QList<QDomElement> elements;
+	QDomNode n = node.firstChild();
+	while (!n.isNull())
+	{
+		if (n.isElement() && n.toElement().tagName() == tagName)
+		{
+			elements << n.toElement();
+		}
+
+		// depth first without recursing, as deep as the document is
+		if (!n.firstChild().isNull())
+		{
+			n = n.firstChild();
+			continue;
+		}
+		while (!n.isNull() && n != node && n.nextSibling().isNull())
+		{
+			n = n.parentNode();
+		}
+		if (n.isNull() || n == node)
+		{
+			break;
+		}
+		n = n.nextSibling();
+	}
+	return elements;
+}
+
+
+
+
+void renameElements(const QDomNode& node, const QString& from, const QString& to)
+{
+	for (QDomElement el : findElements(node, from))
+	{
+		el.setTagName(to);
+	}
+}
+
+
+
+
 DataFile::DataFile( const QString & _fileName ) :
 	QDomDocument(),
 	m_content(),
@@ -114,6 +165,22 @@ DataFile::DataFile( const QString & _fileName ) :
 		return;
 	}
 
+	// a binary project is mapped instead, its blobs are only read once
+	// they're decoded
+	if( BlobContainer::isContainer( inFile.peek( 8 ) ) )
+	{
+		inFile.close();
+		m_blobs = std::make_shared<BlobContainer>( _fileName );
+		if( m_blobs->isValid() )
+		{
+			loadData( m_blobs->xml(), _fileName );
+			m_blobs->adoptReferences( documentElement() );
+			return;
+		}
+		m_blobs.reset();
+		inFile.open( QIODevice::ReadOnly );
+	}
+
 	loadData( inFile.readAll(), _fileName );
 }
 
@@ -143,7 +210,8 @@ bool DataFile::validate( QString extension )
 	switch( m_type )
 	{
 	case Type::SongProject:
-		if( extension == "mmp" || extension == "mmpz" )
+		if( extension == "mmp" || extension == "mmpz" ||
+						extension == "mmpb" )
 		{
 			return true;
 		}
@@ -162,6 +230,7 @@ bool DataFile::validate( QString extension )
 		break;
 	case Type::UnknownType:
 		if (! ( extension == "mmp" || extension == "mpt" || extension == "mmpz" ||
+				extension == "mmpb" ||
 				extension == "xpf" || extension == "xml" ||
 				( extension == "xiz" && ! pluginFactory->pluginSupportingExtension(extension).isNull()) ||
 				extension == "sf2" || extension == "sf3" || extension == "pat" || extension == "mid" ||
@@ -192,7 +261,8 @@ QString DataFile::nameWithExtension( const QString & _fn ) const
 		case SongProject:
 			if( _fn.section( '.', -1 ) != "mmp" &&
 					_fn.section( '.', -1 ) != "mpt" &&
-					_fn.section( '.', -1 ) != "mmpz" )
+					_fn.section( '.', -1 ) != "mmpz" &&
+					_fn.section( '.', -1 ) != "mmpb" )
 			{
 				if( ConfigManager::inst()->value( "app",
 						"nommpz" ).toInt() == 0 )
@@ -230,7 +300,16 @@ void DataFile::write( QTextStream & _strm )
 		cleanMetaNodes( documentElement() );
 	}
 
+	// references to the blobs of a binary project are only good while
+	// it's open, so they're written out in full
+	const QList<BlobContainer::Replacement> replacements =
+		m_blobs ? BlobContainer::replaceAttributes( documentElement(),
+								NULL ) :
+			QList<BlobContainer::Replacement>();
+
 	save(_strm, 2);
+
+	BlobContainer::restore( replacements );
 }
 
 
@@ -265,6 +344,19 @@ bool DataFile::writeFile( const QString& filename )
 		write( ts );
 		outfile.write( qCompress( xml.toUtf8() ) );
 	}
+	else if( fullName.section( '.', -1 ) == "mmpb" )
+	{
+		// the large base64 attributes go into blobs of their own
+		QList<QByteArray> blobs;
+		const QList<BlobContainer::Replacement> replacements =
+			BlobContainer::replaceAttributes( documentElement(),
+								&blobs );
+		QString xml;
+		QTextStream ts( &xml );
+		write( ts );
+		BlobContainer::restore( replacements );
+		BlobContainer::write( outfile, xml.toUtf8(), blobs );
+	}
 	else
 	{
 		QTextStream ts( &outfile );
@@ -501,11 +593,7 @@ void DataFile::upgrade_0_2_1_20070508()
 		}
 	}
 
-	while( !( list = elementsByTagName( "channeltrack" ) ).isEmpty() )
-	{
-		QDomElement el = list.item( 0 ).toElement();
-		el.setTagName( "instrumenttrack" );
-	}
+	renameElements( *this, "channeltrack", "instrumenttrack" );
 
 	list = elementsByTagName( "instrumenttrack" );
 	for( int i = 0; !list.item( i ).isNull(); ++i )
@@ -558,27 +646,14 @@ void DataFile::upgrade_0_3_0_rc2()
 void DataFile::upgrade_0_3_0()
 {
 	// Upgrade to version 0.3.0 (final) from some version greater than or equal to 0.3.0-rc2
-	QDomNodeList list;
-	while( !( list = elementsByTagName(
-				"pluckedstringsynth" ) ).isEmpty() )
+	for( QDomElement el : findElements( *this, "pluckedstringsynth" ) )
 	{
-		QDomElement el = list.item( 0 ).toElement();
 		el.setTagName( "vibedstrings" );
 		el.setAttribute( "active0", 1 );
 	}
 
-	while( !( list = elementsByTagName( "lb303" ) ).isEmpty() )
-	{
-		QDomElement el = list.item( 0 ).toElement();
-		el.setTagName( "lb302" );
-	}
-
-	while( !( list = elementsByTagName( "channelsettings" ) ).
-							isEmpty() )
-	{
-		QDomElement el = list.item( 0 ).toElement();
-		el.setTagName( "instrumenttracksettings" );
-	}
+	renameElements( *this, "lb303", "lb302" );
+	renameElements( *this, "channelsettings", "instrumenttracksettings" );
 }
 
 
@@ -601,12 +676,10 @@ void DataFile::upgrade_0_4_0_20080104()
 void DataFile::upgrade_0_4_0_20080118()
 {
 	// Upgrade to version 0.4.0-20080118 from some version greater than or equal to 0.4.0-20080104
-	QDomNodeList list;
-	while( !( list = elementsByTagName( "fx" ) ).isEmpty() )
+	for( QDomElement fxchain : findElements( *this, "fx" ) )
 	{
-		QDomElement fxchain = list.item( 0 ).toElement();
 		fxchain.setTagName( "fxchain" );
-		QDomNode rack = list.item( 0 ).firstChild();
+		QDomNode rack = fxchain.firstChild();
 		QDomNodeList effects = rack.childNodes();
 		// move items one level up
 		while( effects.count() )
@@ -623,11 +696,8 @@ void DataFile::upgrade_0_4_0_20080118()
 void DataFile::upgrade_0_4_0_20080129()
 {
 	// Upgrade to version 0.4.0-20080129 from some version greater than or equal to 0.4.0-20080118
-	QDomNodeList list;
-	while( !( list =
-		elementsByTagName( "arpandchords" ) ).isEmpty() )
+	for( QDomElement aac : findElements( *this, "arpandchords" ) )
 	{
-		QDomElement aac = list.item( 0 ).toElement();
 		aac.setTagName( "arpeggiator" );
 		QDomNode cloned = aac.cloneNode();
 		cloned.toElement().setTagName( "chordcreator" );
@@ -668,27 +738,16 @@ void DataFile::upgrade_0_4_0_20080409()
 void DataFile::upgrade_0_4_0_20080607()
 {
 	// Upgrade to version 0.4.0-20080607 from some version greater than or equal to 0.3.0-20080409
-	QDomNodeList list;
-	while( !( list = elementsByTagName( "midi" ) ).isEmpty() )
-	{
-		QDomElement el = list.item( 0 ).toElement();
-		el.setTagName( "midiport" );
-	}
+	renameElements( *this, "midi", "midiport" );
 }
 
 
 void DataFile::upgrade_0_4_0_20080622()
 {
 	// Upgrade to version 0.4.0-20080622 from some version greater than or equal to 0.3.0-20080607
-	QDomNodeList list;
-	while( !( list = elementsByTagName(
-				"automation-pattern" ) ).isEmpty() )
-	{
-		QDomElement el = list.item( 0 ).toElement();
-		el.setTagName( "automationpattern" );
-	}
+	renameElements( *this, "automation-pattern", "automationpattern" );
 
-	list = elementsByTagName( "bbtrack" );
+	QDomNodeList list = elementsByTagName( "bbtrack" );
 	for( int i = 0; !list.item( i ).isNull(); ++i )
 	{
 		QDomElement el = list.item( i ).toElement();
@@ -704,11 +763,8 @@ void DataFile::upgrade_0_4_0_beta1()
 {
 	// Upgrade to version 0.4.0-beta1 from some version greater than or equal to 0.4.0-20080622
 	// convert binary effect-key-blobs to XML
-	QDomNodeList list;
-	list = elementsByTagName( "effect" );
-	for( int i = 0; !list.item( i ).isNull(); ++i )
+	for( QDomElement el : findElements( *this, "effect" ) )
 	{
-		QDomElement el = list.item( i ).toElement();
 		QString k = el.attribute( "key" );
 		if( !k.isEmpty() )
 		{
@@ -773,10 +829,9 @@ void DataFile::upgrade_1_0_99()
 	QList<jo_id_t> idList;
 	findIds(documentElement(), idList);
 	
-	QDomNodeList list = elementsByTagName("ladspacontrols");
-	for(int i = 0; !list.item(i).isNull(); ++i)
+	for(const QDomElement& controls : findElements(*this, "ladspacontrols"))
 	{
-		for(QDomNode node = list.item(i).firstChild(); !node.isNull();
+		for(QDomNode node = controls.firstChild(); !node.isNull();
 			node = node.nextSibling())
 		{
 			QDomElement el = node.toElement();
@@ -809,10 +864,10 @@ void DataFile::upgrade_1_0_99()
 
 void DataFile::upgrade_1_1_0()
 {
-	QDomNodeList list = elementsByTagName("fxchannel");
-	for (int i = 1; !list.item(i).isNull(); ++i)
+	const QList<QDomElement> list = findElements(*this, "fxchannel");
+	for (int i = 1; i < list.size(); ++i)
 	{
-		QDomElement el = list.item(i).toElement();
+		QDomElement el = list[i];
 		QDomElement send = createElement("send");
 		send.setAttribute("channel", "0");
 		send.setAttribute("amount", "1");
@@ -1027,10 +1082,9 @@ void DataFile::upgrade_1_3_0()
 		}
 	}
 
-	list = elementsByTagName( "effect" );
-	for( int i = 0; !list.item( i ).isNull(); ++i )
+	// the ports of the effects are added and removed below
+	for( QDomElement effect : findElements( *this, "effect" ) )
 	{
-		QDomElement effect = list.item( i ).toElement();
 		if( effect.attribute( "name" ) == "ladspaeffect" )
 		{
 			QDomNodeList keys = effect.elementsByTagName( "key" );
@@ -1335,88 +1389,46 @@ void DataFile::upgrade_1_3_0()
 
 void DataFile::upgrade()
 {
+	// the routines which apply to files created before each version, in
+	// the order they have to run in
+	static const struct
+	{
+		const char * version;
+		void ( DataFile::*upgrade )();
+	} upgrades[] =
+	{
+		{ "0.2.1-20070501", &DataFile::upgrade_0_2_1_20070501 },
+		{ "0.2.1-20070508", &DataFile::upgrade_0_2_1_20070508 },
+		{ "0.3.0-rc2", &DataFile::upgrade_0_3_0_rc2 },
+		{ "0.3.0", &DataFile::upgrade_0_3_0 },
+		{ "0.4.0-20080104", &DataFile::upgrade_0_4_0_20080104 },
+		{ "0.4.0-20080118", &DataFile::upgrade_0_4_0_20080118 },
+		{ "0.4.0-20080129", &DataFile::upgrade_0_4_0_20080129 },
+		{ "0.4.0-20080409", &DataFile::upgrade_0_4_0_20080409 },
+		{ "0.4.0-20080607", &DataFile::upgrade_0_4_0_20080607 },
+		{ "0.4.0-20080622", &DataFile::upgrade_0_4_0_20080622 },
+		{ "0.4.0-beta1", &DataFile::upgrade_0_4_0_beta1 },
+		{ "0.4.0-rc2", &DataFile::upgrade_0_4_0_rc2 },
+		{ "1.0.99-0", &DataFile::upgrade_1_0_99 },
+		{ "1.1.0-0", &DataFile::upgrade_1_1_0 },
+		{ "1.1.91-0", &DataFile::upgrade_1_1_91 },
+		{ "1.2.0-rc3", &DataFile::upgrade_1_2_0_rc3 },
+		{ "1.2.0-rc3", &DataFile::upgrade_1_2_0_rc2_42 },
+		{ "1.3.0", &DataFile::upgrade_1_3_0 }
+	} ;
+
 	ProjectVersion version =
 		documentElement().attribute( "creatorversion" ).
 							replace( "svn", "" );
 
-	if( version < "0.2.1-20070501" )
-	{
-		upgrade_0_2_1_20070501();
-	}
-
-	if( version < "0.2.1-20070508" )
-	{
-		upgrade_0_2_1_20070508();
-	}
-
-	if( version < "0.3.0-rc2" )
+	// files of a version which needs none of them, e.g. a build of the
+	// current one, only get their meta data updated
+	for( const auto & upgrade : upgrades )
 	{
-		upgrade_0_3_0_rc2();
-	}
-
-	if( version < "0.3.0" )
-	{
-		upgrade_0_3_0();
-	}
-
-	if( version < "0.4.0-20080104" )
-	{
-		upgrade_0_4_0_20080104();
-	}
-
-	if( version < "0.4.0-20080118" )
-	{
-		upgrade_0_4_0_20080118();
-	}
-
-	if( version < "0.4.0-20080129" )
-	{
-		upgrade_0_4_0_20080129();
-	}
-
-	if( version < "0.4.0-20080409" )
-	{
-		upgrade_0_4_0_20080409();
-	}
-
-	if( version < "0.4.0-20080607" )
-	{
-		upgrade_0_4_0_20080607();
-	}
-
-	if( version < "0.4.0-20080622" )
-	{
-		upgrade_0_4_0_20080622();
-	}
-
-	if( version < "0.4.0-beta1" )
-	{
-		upgrade_0_4_0_beta1();
-	}
-	if( version < "0.4.0-rc2" )
-	{
-		upgrade_0_4_0_rc2();
-	}
-	if( version < "1.0.99-0" )
-	{
-		upgrade_1_0_99();
-	}
-	if( version < "1.1.0-0" )
-	{
-		upgrade_1_1_0();
-	}
-	if( version < "1.1.91-0" )
-	{
-		upgrade_1_1_91();
-	}
-	if( version < "1.2.0-rc3" )
-	{
-		upgrade_1_2_0_rc3();
-		upgrade_1_2_0_rc2_42();
-	}
-	if( version < "1.3.0" )
-	{
-		upgrade_1_3_0();
+		if( version < upgrade.version )
+		{
+			( this->*upgrade.upgrade )();
+		}
 	}
 
 	// update document meta data
@@ -1444,37 +1456,50 @@ void DataFile::upgrade()
 
 
 
-void DataFile::loadData( const QByteArray & _data, const QString & _sourceFile )
+//! Whether _data is what qCompress() made of a file: the size of the
+//! uncompressed data followed by a zlib stream, which XML can't start with
+static bool isCompressed( const QByteArray & _data )
+{
+	if( _data.size() < 6 )
+	{
+		return false;
+	}
+	const uchar cmf = _data[4];
+	const uchar flg = _data[5];
+	return ( cmf & 0x0f ) == 8 && ( cmf * 256 + flg ) % 31 == 0;
+}
+
+
+
+
+void DataFile::loadData( QByteArray _data, const QString & _sourceFile )
 {
+	// uncompressed up front instead of after trying to parse the
+	// compressed data, so the document is only parsed once
+	if( isCompressed( _data ) )
+	{
+		_data = qUncompress( _data );
+	}
+
 	QString errorMsg;
 	int line = -1, col = -1;
 	if( !setContent( _data, &errorMsg, &line, &col ) )
 	{
-		// parsing failed? then try to uncompress data
-		QByteArray uncompressed = qUncompress( _data );
-		if( !uncompressed.isEmpty() )
+		qWarning() << "at line" << line << "column" << errorMsg;
+		if( gui )
 		{
-			if( setContent( uncompressed, &errorMsg, &line, &col ) )
-			{
-				line = col = -1;
-			}
+			QMessageBox::critical( NULL,
+				SongEditor::tr( "Error in file" ),
+				SongEditor::tr( "The file %1 seems to contain "
+						"errors and therefore can't be "
+						"loaded." ).
+							arg( _sourceFile ) );
 		}
-		if( line >= 0 && col >= 0 )
-		{
-			qWarning() << "at line" << line << "column" << errorMsg;
-			if( gui )
-			{
-				QMessageBox::critical( NULL,
-					SongEditor::tr( "Error in file" ),
-					SongEditor::tr( "The file %1 seems to contain "
-							"errors and therefore can't be "
-							"loaded." ).
-								arg( _sourceFile ) );
-			}
 
-			return;
-		}
+		return;
 	}
+	// the document has its own copy, e.g. of the embedded samples
+	_data = QByteArray();
 
 	QDomElement root = documentElement();
 	m_type = type( root.attribute( "type" ) );
@@ -0,0 +1,262 @@
+/*
+ * Decimator.cpp - half-band filter cascade for taking oversampled audio
+ *                 down to the rate of the device
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "Decimator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <QtCore/QtGlobal>
+
+
+// pairs of taps on each side of the centre and Kaiser beta of the last
+// stage and of the ones before, by quality
+static const struct
+{
+	int lastPairs;
+	double lastBeta;
+	int earlyPairs;
+	double earlyBeta;
+} StageDesigns[] =
+{
+	{ 8, 6.8, 4, 5.5 },	// ~70 dB, passband up to 0.36 of the rate
+	{ 16, 7.9, 5, 7.0 },	// ~80 dB, up to 0.42
+	{ 32, 10.1, 6, 9.0 }	// ~100 dB, up to 0.45
+} ;
+
+
+
+
+static double besselI0( double _x )
+{
+	double sum = 1.0;
+	double term = 1.0;
+	for( int k = 1; k < 32; ++k )
+	{
+		term *= ( _x / ( 2.0 * k ) ) * ( _x / ( 2.0 * k ) );
+		sum += term;
+	}
+	return sum;
+}
+
+
+
+
+Decimator::Decimator( int factor, Qualities quality ) :
+	m_factor( 1 )
+{
+	setup( factor, quality );
+}
+
+
+
+
+void Decimator::setup( int factor, Qualities quality )
+{
+	int stages = 1;
+	while( ( 2 << stages ) <= qBound( 2, factor, 8 ) )
+	{
+		++stages;
+	}
+	m_factor = 1 << stages;
+
+	m_stages.resize( stages );
+	for( int s = 0; s < stages; ++s )
+	{
+		int pairs;
+		double beta;
+		stageDesign( quality, s == stages - 1, pairs, beta );
+		m_stages[s].design( pairs, beta );
+	}
+}
+
+
+
+
+float Decimator::latency() const
+{
+	// each stage delays by half its length at its input rate
+	float frames = 0.0f;
+	int rate = m_factor;
+	for( const Stage & stage : m_stages )
+	{
+		frames += static_cast<float>( stage.taps.size() - 1 ) / rate;
+		rate /= 2;
+	}
+	return frames;
+}
+
+
+
+
+void Decimator::reset()
+{
+	for( Stage & stage : m_stages )
+	{
+		stage.clear();
+	}
+}
+
+
+
+
+fpp_t Decimator::process( const surroundSampleFrame * _in, f_cnt_t _frames,
+						surroundSampleFrame * _out )
+{
+	float buf[SURROUND_CHANNELS][BlockSize];
+	fpp_t written = 0;
+	while( _frames > 0 )
+	{
+		const int frames = _frames < BlockSize ? _frames : BlockSize;
+		for( ch_cnt_t ch = 0; ch < SURROUND_CHANNELS; ++ch )
+		{
+			for( int f = 0; f < frames; ++f )
+			{
+				buf[ch][f] = _in[f][ch];
+			}
+
+			// each stage reads all of its input before writing
+			int n = frames;
+			for( Stage & stage : m_stages )
+			{
+				stage.process( ch, buf[ch], n, buf[ch] );
+				n /= 2;
+			}
+
+			for( int f = 0; f < n; ++f )
+			{
+				_out[written + f][ch] = buf[ch][f];
+			}
+		}
+		_in += frames;
+		_frames -= frames;
+		written += frames / m_factor;
+	}
+	return written;
+}
+
+
+
+
+std::vector<float> Decimator::halfBandTaps( int _pairs, double _beta )
+{
+	// the taps at even offsets from the centre are zero except for the
+	// centre itself
+	std::vector<double> taps( 2 * _pairs );
+	double sum = 0.0;
+	for( int m = 0; m < 2 * _pairs; ++m )
+	{
+		const double d = 2 * m - ( 2 * _pairs - 1 );
+		const double u = d / ( 2 * _pairs );
+		const double x = M_PI * d / 2.0;
+		taps[m] = sin( x ) / x *
+			besselI0( _beta * sqrt( 1.0 - u * u ) ) /
+							besselI0( _beta );
+		sum += taps[m];
+	}
+
+	std::vector<float> normalized( taps.size() );
+	for( size_t m = 0; m < taps.size(); ++m )
+	{
+		normalized[m] = static_cast<float>( taps[m] * 0.5 / sum );
+	}
+	return normalized;
+}
+
+
+
+
+void Decimator::stageDesign( Qualities _quality, bool _lowestRate,
+						int & _pairs, double & _beta )
+{
+	_pairs = _lowestRate ? StageDesigns[_quality].lastPairs :
+					StageDesigns[_quality].earlyPairs;
+	_beta = _lowestRate ? StageDesigns[_quality].lastBeta :
+					StageDesigns[_quality].earlyBeta;
+}
+
+
+
+
+void Decimator::Stage::design( int pairs, double beta )
+{
+	// the taps at odd offsets act on the even frames
+	taps = halfBandTaps( pairs, beta );
+
+	for( ch_cnt_t ch = 0; ch < SURROUND_CHANNELS; ++ch )
+	{
+		even[ch].assign( taps.size() - 1 + BlockSize / 2, 0.0f );
+		odd[ch].assign( taps.size() / 2 + BlockSize / 2, 0.0f );
+	}
+}
+
+
+
+
+void Decimator::Stage::clear()
+{
+	for( ch_cnt_t ch = 0; ch < SURROUND_CHANNELS; ++ch )
+	{
+		std::fill( even[ch].begin(), even[ch].end(), 0.0f );
+		std::fill( odd[ch].begin(), odd[ch].end(), 0.0f );
+	}
+}
+
+
+
+
+void Decimator::Stage::process( int _channel, const float * _in,
+						int _frames, float * _out )
+{
+	const int count = static_cast<int>( taps.size() );
+	const int evenHistory = count - 1;
+	const int oddHistory = count / 2;
+	float * __restrict e = even[_channel].data();
+	float * __restrict o = odd[_channel].data();
+	const int n = _frames / 2;
+
+	for( int j = 0; j < n; ++j )
+	{
+		e[evenHistory + j] = _in[2 * j];
+		o[oddHistory + j] = _in[2 * j + 1];
+	}
+
+	// the centre tap is as far behind as half the taps on the odd frames
+	for( int i = 0; i < n; ++i )
+	{
+		_out[i] = 0.5f * o[i];
+	}
+	for( int m = 0; m < count; ++m )
+	{
+		const float tap = taps[m];
+		const float * __restrict src = e + evenHistory - m;
+		for( int i = 0; i < n; ++i )
+		{
+			_out[i] += tap * src[i];
+		}
+	}
+
+	memmove( e, e + n, sizeof( float ) * evenHistory );
+	memmove( o, o + n, sizeof( float ) * oddHistory );
+}
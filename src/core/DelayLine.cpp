@@ -0,0 +1,236 @@
+/*
+ * DelayLine.cpp - block processing fractional delay line for effects
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "DelayLine.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "interpolation.h"
+#include "Mixer.h"
+
+
+DelayLine::DelayLine( f_cnt_t maxDelay ) :
+	m_mask( 0 ),
+	m_maxDelay( 0 ),
+	m_writePos( 0 ),
+	m_allpassState( 0.0f )
+{
+	setMaxDelay( maxDelay );
+}
+
+
+
+
+void DelayLine::setMaxDelay( f_cnt_t maxDelay )
+{
+	// room for the block read after it got written and the points of the
+	// cubic interpolation
+	const f_cnt_t needed = qMax<f_cnt_t>( maxDelay, 0 ) +
+						DEFAULT_BUFFER_SIZE + 4;
+	f_cnt_t size = 1;
+	while( size < needed )
+	{
+		size <<= 1;
+	}
+
+	m_buffer.assign( size, 0.0f );
+	m_mask = size - 1;
+	m_maxDelay = qMax<f_cnt_t>( maxDelay, 2 );
+	m_writePos = 0;
+	m_allpassState = 0.0f;
+}
+
+
+
+
+void DelayLine::clear()
+{
+	std::fill( m_buffer.begin(), m_buffer.end(), 0.0f );
+	m_allpassState = 0.0f;
+}
+
+
+
+
+void DelayLine::write( const sample_t * src, fpp_t frames )
+{
+	const f_cnt_t size = m_mask + 1;
+	const f_cnt_t first = qMin<f_cnt_t>( frames, size - m_writePos );
+	memcpy( m_buffer.data() + m_writePos, src, sizeof( sample_t ) * first );
+	memcpy( m_buffer.data(), src + first,
+				sizeof( sample_t ) * ( frames - first ) );
+	m_writePos = ( m_writePos + frames ) & m_mask;
+}
+
+
+
+
+void DelayLine::read( sample_t * dst, const float * delays, fpp_t frames,
+					Interpolations interpolation )
+{
+	tap( dst, m_writePos - frames, delays, frames, interpolation );
+}
+
+
+
+
+void DelayLine::read( sample_t * dst, float delay, fpp_t frames,
+					Interpolations interpolation )
+{
+	float delays[DEFAULT_BUFFER_SIZE];
+	f_cnt_t start = m_writePos - frames;
+	while( frames > 0 )
+	{
+		const fpp_t part = qMin<fpp_t>( frames, DEFAULT_BUFFER_SIZE );
+		std::fill( delays, delays + part, delay );
+		tap( dst, start, delays, part, interpolation );
+		dst += part;
+		start += part;
+		frames -= part;
+	}
+}
+
+
+
+
+void DelayLine::read( sample_t * dst, f_cnt_t delay, fpp_t frames )
+{
+	delay = qBound<f_cnt_t>( 0, delay, m_maxDelay );
+	const f_cnt_t size = m_mask + 1;
+	const f_cnt_t start = ( m_writePos - frames - delay ) & m_mask;
+	const f_cnt_t first = qMin<f_cnt_t>( frames, size - start );
+	memcpy( dst, m_buffer.data() + start, sizeof( sample_t ) * first );
+	memcpy( dst + first, m_buffer.data(),
+				sizeof( sample_t ) * ( frames - first ) );
+}
+
+
+
+
+void DelayLine::process( sample_t * buf, const float * delays,
+				float feedback, fpp_t frames,
+				Interpolations interpolation )
+{
+	// the taps of a part must only reach frames written before it
+	const float shortest = qBound( minDelay( interpolation ),
+				*std::min_element( delays, delays + frames ),
+				static_cast<float>( m_maxDelay ) );
+	int part = static_cast<int>( shortest );
+	switch( interpolation )
+	{
+		case Cubic: part -= 1; break;
+		case Allpass: part = static_cast<int>( shortest - 0.5f ); break;
+		default: break;
+	}
+	part = qBound<int>( 1, part, DEFAULT_BUFFER_SIZE );
+
+	sample_t out[DEFAULT_BUFFER_SIZE];
+	for( fpp_t f = 0; f < frames; f += part )
+	{
+		const fpp_t n = qMin<fpp_t>( part, frames - f );
+		tap( out, m_writePos, delays + f, n, interpolation );
+		for( fpp_t i = 0; i < n; ++i )
+		{
+			m_buffer[( m_writePos + i ) & m_mask] =
+					buf[f + i] + out[i] * feedback;
+			buf[f + i] = out[i];
+		}
+		m_writePos = ( m_writePos + n ) & m_mask;
+	}
+}
+
+
+
+
+void DelayLine::tap( sample_t * __restrict dst, f_cnt_t start,
+				const float * delays, fpp_t frames,
+				Interpolations interpolation )
+{
+	const sample_t * __restrict buf = m_buffer.data();
+	const f_cnt_t mask = m_mask;
+	const float lowest = minDelay( interpolation );
+	const float highest = static_cast<float>( m_maxDelay );
+
+	switch( interpolation )
+	{
+		case Linear:
+			for( fpp_t f = 0; f < frames; ++f )
+			{
+				// interpolate between the frames before and at the
+				// integer part of the delay
+				const float d = qBound( lowest, delays[f], highest );
+				const f_cnt_t di = static_cast<f_cnt_t>( d );
+				const float frac = 1.0f - ( d - di );
+				const f_cnt_t i = start + f - di - 1;
+				dst[f] = linearInterpolate( buf[i & mask],
+						buf[( i + 1 ) & mask], frac );
+			}
+			break;
+
+		case Cubic:
+			for( fpp_t f = 0; f < frames; ++f )
+			{
+				const float d = qBound( lowest, delays[f], highest );
+				const f_cnt_t di = static_cast<f_cnt_t>( d );
+				const float frac = 1.0f - ( d - di );
+				const f_cnt_t i = start + f - di - 1;
+				dst[f] = hermiteInterpolate( buf[( i - 1 ) & mask],
+						buf[i & mask], buf[( i + 1 ) & mask],
+						buf[( i + 2 ) & mask], frac );
+			}
+			break;
+
+		case Allpass:
+		{
+			// first order allpass with a fractional delay of 0.5 to 1.5
+			// frames, which keeps its pole away from the unit circle
+			float y = m_allpassState;
+			for( fpp_t f = 0; f < frames; ++f )
+			{
+				const float d = qBound( lowest, delays[f], highest );
+				const f_cnt_t di = static_cast<f_cnt_t>( d - 0.5f );
+				const float frac = d - di;
+				const float eta = ( 1.0f - frac ) / ( 1.0f + frac );
+				const f_cnt_t i = start + f - di;
+				y = eta * ( buf[i & mask] - y ) +
+							buf[( i - 1 ) & mask];
+				dst[f] = y;
+			}
+			m_allpassState = y;
+			break;
+		}
+	}
+}
+
+
+
+
+float DelayLine::minDelay( Interpolations interpolation ) const
+{
+	switch( interpolation )
+	{
+		case Cubic: return 2.0f;
+		case Allpass: return 1.5f;
+		default: return 1.0f;
+	}
+}
@@ -29,6 +29,7 @@
 #include "EffectChain.h"
 #include "EffectControls.h"
 #include "EffectView.h"
+#include "FxMixer.h"
 
 #include "ConfigManager.h"
 
@@ -43,11 +44,15 @@ Effect::Effect( const Plugin::Descriptor * _desc,
 	m_noRun( false ),
 	m_running( false ),
 	m_bufferCount( 0 ),
+	m_silentFrames( 0 ),
+	m_cpuUsage(),
 	m_enabledModel( true, this, tr( "Effect enabled" ) ),
 	m_wetDryModel( 1.0f, -1.0f, 1.0f, 0.01f, this, tr( "Wet/Dry mix" ) ),
 	m_gateModel( 0.0f, 0.0f, 1.0f, 0.01f, this, tr( "Gate" ) ),
 	m_autoQuitModel( 1.0f, 1.0f, 8000.0f, 100.0f, 1.0f, this, tr( "Decay" ) ),
-	m_autoQuitDisabled( false )
+	m_autoQuitDisabled( false ),
+	m_sidechainChannel( -1 ),
+	m_sidechainSource( NULL )
 {
 	m_srcState[0] = m_srcState[1] = NULL;
 	reinitSRC();
@@ -81,6 +86,10 @@ void Effect::saveSettings( QDomDocument & _doc, QDomElement & _this )
 	m_wetDryModel.saveSettings( _doc, _this, "wet" );
 	m_autoQuitModel.saveSettings( _doc, _this, "autoquit" );
 	m_gateModel.saveSettings( _doc, _this, "gate" );
+	if( m_sidechainChannel >= 0 )
+	{
+		_this.setAttribute( "sidechain", m_sidechainChannel );
+	}
 	controls()->saveState( _doc, _this );
 }
 
@@ -93,6 +102,8 @@ void Effect::loadSettings( const QDomElement & _this )
 	m_wetDryModel.loadSettings( _this, "wet" );
 	m_autoQuitModel.loadSettings( _this, "autoquit" );
 	m_gateModel.loadSettings( _this, "gate" );
+	// the FX mixer picks it up once the effect is in its chain
+	m_sidechainChannel = _this.attribute( "sidechain", "-1" ).toInt();
 
 	QDomNode node = _this.firstChild();
 	while( !node.isNull() )
@@ -112,6 +123,38 @@ void Effect::loadSettings( const QDomElement & _this )
 
 
 
+void Effect::setSidechainChannel( int _channel )
+{
+	m_sidechainChannel = _channel;
+	Engine::fxMixer()->updateSidechains();
+}
+
+
+
+
+const sampleFrame * Effect::sidechainBuffer() const
+{
+	const FxChannel * source = m_sidechainSource;
+	if( source == NULL || source->m_muted ||
+		!( source->m_hasInput || source->m_stillRunning ) )
+	{
+		return NULL;
+	}
+	return source->m_buffer;
+}
+
+
+
+
+float Effect::sidechainGain() const
+{
+	return m_sidechainSource ? m_sidechainSource->m_volumeModel.value() :
+									0.0f;
+}
+
+
+
+
 Effect * Effect::instantiate( const QString& pluginName,
 				Model * _parent,
 				Descriptor::SubPluginFeatures::Key * _key )
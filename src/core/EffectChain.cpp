@@ -26,13 +26,24 @@
 
 #include <QDomElement>
 
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
 #include "EffectChain.h"
 #include "Effect.h"
 #include "DummyEffect.h"
+#include "MicroTimer.h"
+#include "Mixer.h"
 #include "MixHelpers.h"
+#include "ScratchArena.h"
 #include "Song.h"
 
 
+// effects taking more than this share of a period get bypassed while the
+// mixer is overloaded, see Mixer::BypassEffects
+static const float HighEffectCost = 0.1f;
+
 EffectChain::EffectChain( Model * _parent ) :
 	Model( _parent ),
 	SerializingObject(),
@@ -78,8 +89,8 @@ void EffectChain::loadSettings( const QDomElement & _this )
 {
 	clear();
 
-	// TODO This method should probably also lock the mixer
-
+	// the effects are set up before the audio threads get to see them
+	EffectList effects;
 	m_enabledModel.loadSettings( _this, "enabled" );
 
 	const int plugin_cnt = _this.attribute( "numofeffects" ).toInt();
@@ -107,11 +118,12 @@ void EffectChain::loadSettings( const QDomElement & _this )
 				e = new DummyEffect( parentModel(), effectData );
 			}
 
-			m_effects.push_back( e );
+			effects.push_back( e );
 			++fx_loaded;
 		}
 		node = node.nextSibling();
 	}
+	swapEffects( effects );
 
 	emit dataChanged();
 }
@@ -121,9 +133,12 @@ void EffectChain::loadSettings( const QDomElement & _this )
 
 void EffectChain::appendEffect( Effect * _effect )
 {
-	Engine::mixer()->requestChangeInModel();
-	m_effects.append( _effect );
-	Engine::mixer()->doneChangeInModel();
+	EffectList effects;
+	effects.reserve( m_effects.size() + 1 );
+	std::copy( m_effects.constBegin(), m_effects.constEnd(),
+					std::back_inserter( effects ) );
+	effects.append( _effect );
+	swapEffects( effects );
 
 	m_enabledModel.setValue( true );
 
@@ -135,17 +150,16 @@ void EffectChain::appendEffect( Effect * _effect )
 
 void EffectChain::removeEffect( Effect * _effect )
 {
-	Engine::mixer()->requestChangeInModel();
-
-	Effect ** found = std::find( m_effects.begin(), m_effects.end(), _effect );
-	if( found == m_effects.end() )
+	if( !m_effects.contains( _effect ) )
 	{
-		Engine::mixer()->doneChangeInModel();
 		return;
 	}
-	m_effects.erase( found );
 
-	Engine::mixer()->doneChangeInModel();
+	EffectList effects;
+	effects.reserve( m_effects.size() - 1 );
+	std::remove_copy( m_effects.constBegin(), m_effects.constEnd(),
+					std::back_inserter( effects ), _effect );
+	swapEffects( effects );
 
 	if( m_effects.isEmpty() )
 	{
@@ -182,62 +196,262 @@ void EffectChain::moveUp( Effect * _effect )
 
 
 
-bool EffectChain::processAudioBuffer( sampleFrame * _buf, const fpp_t _frames, bool hasInputNoise )
+void EffectChain::swapEffects( EffectList & _effects )
+{
+	// The new list is built beforehand, the audio thread only swaps the
+	// pointers. Afterwards _effects holds the old list and frees it in
+	// the calling thread.
+	Engine::mixer()->runInAudioThread( [this, &_effects]()
+	{
+		m_effects.swap( _effects );
+	} );
+}
+
+
+
+
+bool EffectChain::processAudioBuffer( sampleFrame * _buf, const fpp_t _frames, bool hasInputNoise,
+							int _first, int _end )
 {
 	if( m_enabledModel.value() == false )
 	{
 		return false;
 	}
 
-	MixHelpers::sanitize( _buf, _frames );
+	const bool bypassExpensive =
+		Engine::mixer()->overloadMeasures() & Mixer::BypassEffects;
+
+	// second layout of the buffer, for effects wanting planar buffers
+	ScratchBuffer<float> planar( _frames * DEFAULT_CHANNELS );
+	float * channels[DEFAULT_CHANNELS] = { planar.data(), planar.data() + _frames };
+	bool isPlanar = false;
 
 	bool moreEffects = false;
-	for( EffectList::Iterator it = m_effects.begin(); it != m_effects.end(); ++it )
+	// whether the input of the current effect is silent, i.e. the one of
+	// the chain is and no effect before it produced anything
+	bool silentInput = !hasInputNoise;
+	const int end = _end < 0 ? m_effects.size() : _end;
+	for( int i = _first; i < end; ++i )
 	{
-		if( hasInputNoise || ( *it )->isRunning() )
+		Effect * effect = m_effects[i];
+		if( !silentInput )
+		{
+			effect->m_silentFrames = 0;
+		}
+		else if( effect->isRunning() && !effect->m_autoQuitDisabled &&
+			effect->tailFrames() != Effect::UnknownTail &&
+			effect->m_silentFrames >= effect->tailFrames() )
+		{
+			// its tail is over, no need to wait for the gate
+			effect->stopRunning();
+			continue;
+		}
+
+		if( hasInputNoise || effect->isRunning() )
 		{
-			moreEffects |= ( *it )->processAudioBuffer( _buf, _frames );
-			MixHelpers::sanitize( _buf, _frames );
+			if( bypassExpensive && effect->cost() > HighEffectCost )
+			{
+				// keep the chain running so the effect gets its input
+				// again once the overload is over
+				moreEffects = true;
+				continue;
+			}
+			if( effect->wantsPlanar() != isPlanar )
+			{
+				if( isPlanar )
+				{
+					MixHelpers::interleave( _buf, channels, _frames );
+				}
+				else
+				{
+					MixHelpers::deinterleave( channels, _buf, _frames );
+				}
+				isPlanar = !isPlanar;
+			}
+
+			// every effect gets sane input, the output of the last one is
+			// left to the caller which usually has a pass over the buffer
+			// anyway (see FxChannel::doProcessing())
+			// - both planar channels are in one block, which can be
+			// sanitized and mixed like frames
+			sampleFrame * buf = isPlanar ?
+				reinterpret_cast<sampleFrame *>( planar.data() ) : _buf;
+			MixHelpers::sanitize( buf, _frames );
+
+			// effects which are stopped or disabled return without
+			// touching the buffer, wet only ones or not
+			const bool mixDry = effect->writesWetOnly() &&
+				effect->isEnabled() && effect->isRunning();
+			const float dryLevel = effect->dryLevel();
+			const bool keepDry = mixDry && dryLevel != 0.0f;
+			ScratchBuffer<sampleFrame> dry( keepDry ? _frames : 0 );
+			if( keepDry )
+			{
+				memcpy( dry.data(), buf, sizeof( sampleFrame ) * _frames );
+			}
+
+			MicroTimer timer;
+			bool running = isPlanar ?
+				effect->processPlanar( channels, _frames ) :
+				effect->processAudioBuffer( buf, _frames );
+			if( mixDry )
+			{
+				// without any dry signal, the buffer is mixed with
+				// itself at no level
+				const double sum = MixHelpers::mixDryWet( buf,
+					keepDry ? dry.data() : buf, dryLevel,
+					effect->wetLevel(), _frames );
+				effect->checkGate( sum / _frames );
+				running = effect->isRunning();
+			}
+			effect->m_cpuUsage.add( timer.elapsed() );
+			moreEffects |= running;
+
+			if( silentInput )
+			{
+				effect->m_silentFrames += _frames;
+				silentInput = !running;
+			}
 		}
 	}
 
+	if( isPlanar )
+	{
+		MixHelpers::interleave( _buf, channels, _frames );
+	}
+
 	return moreEffects;
 }
 
 
 
 
-void EffectChain::startRunning()
+void EffectChain::startRunning( int _first, int _end )
 {
 	if( m_enabledModel.value() == false )
 	{
 		return;
 	}
 
-	for( EffectList::Iterator it = m_effects.begin();
-						it != m_effects.end(); it++ )
+	const int end = _end < 0 ? m_effects.size() : _end;
+	for( int i = _first; i < end; ++i )
 	{
-		( *it )->startRunning();
+		m_effects[i]->startRunning();
 	}
 }
 
 
 
 
+int EffectChain::splitIntoStages( int _stages, int * _ends, bool & _byCost ) const
+{
+	const int effects = m_effects.size();
+	int firstEnd = 1;
+	for( int i = 0; i < effects; ++i )
+	{
+		if( m_effects[i]->hasSidechain() )
+		{
+			firstEnd = i + 1;
+		}
+	}
+	_stages = qBound( 1, qMin( _stages, effects - firstEnd + 1 ), _stages );
+
+	ScratchBuffer<float> costs( effects );
+	float total = 0.0f;
+	for( int i = 0; i < effects; ++i )
+	{
+		costs[i] = m_effects[i]->isEnabled() ?
+				m_effects[i]->cpuUsage().average() : 0.0f;
+		total += costs[i];
+	}
+	_byCost = total > 0.0f;
+	if( !_byCost )
+	{
+		std::fill( costs.data(), costs.data() + effects, 1.0f );
+		total = effects;
+	}
+
+	// each run ends where the effects so far reach its share of the
+	// total, leaving at least one effect for every run after it
+	int stage = 0;
+	float sum = 0.0f;
+	for( int i = 0; i < effects && stage < _stages - 1; ++i )
+	{
+		sum += costs[i];
+		const bool mayEnd = i + 1 >= firstEnd &&
+					effects - ( i + 1 ) >= _stages - 1 - stage;
+		const bool mustEnd = effects - ( i + 1 ) == _stages - 1 - stage;
+		if( mayEnd && ( mustEnd ||
+				sum >= total * ( stage + 1 ) / _stages ) )
+		{
+			_ends[stage++] = i + 1;
+		}
+	}
+	_ends[_stages - 1] = effects;
+
+	return _stages;
+}
+
+
+
+
+int EffectChain::runningEffects() const
+{
+	if( m_enabledModel.value() == false )
+	{
+		return 0;
+	}
+
+	int running = 0;
+	for( const Effect * effect : m_effects )
+	{
+		if( effect->isEnabled() && effect->isRunning() )
+		{
+			++running;
+		}
+	}
+	return running;
+}
+
+
+
+
+f_cnt_t EffectChain::latencyFrames() const
+{
+	if( m_enabledModel.value() == false )
+	{
+		return 0;
+	}
+
+	f_cnt_t latency = 0;
+	for( const Effect * effect : m_effects )
+	{
+		if( effect->isEnabled() )
+		{
+			latency += effect->latencyFrames();
+		}
+	}
+	return latency;
+}
+
+
+
+
 void EffectChain::clear()
 {
 	emit aboutToClear();
 
-	Engine::mixer()->requestChangeInModel();
+	// detach the effects first, so the audio thread doesn't have to wait
+	// for them to be destroyed
+	EffectList effects;
+	swapEffects( effects );
 
-	while( m_effects.count() )
+	while( effects.count() )
 	{
-		Effect * e = m_effects[m_effects.count() - 1];
-		m_effects.pop_back();
+		Effect * e = effects[effects.count() - 1];
+		effects.pop_back();
 		delete e;
 	}
 
-	Engine::mixer()->doneChangeInModel();
-
 	m_enabledModel.setValue( false );
 }
@@ -24,57 +24,149 @@
 
 
 #include "Engine.h"
+
+#include <future>
+
 #include "BBTrackContainer.h"
 #include "ConfigManager.h"
 #include "FxMixer.h"
 #include "Ladspa2LMMS.h"
 #include "Mixer.h"
+#include "PerfLog.h"
 #include "Plugin.h"
+#include "PluginFactory.h"
 #include "PresetPreviewPlayHandle.h"
 #include "ProjectJournal.h"
+#include "SampleCache.h"
 #include "Song.h"
 #include "BandLimitedWave.h"
 
-float LmmsCore::s_framesPerTick;
-Mixer* LmmsCore::s_mixer = NULL;
-FxMixer * LmmsCore::s_fxMixer = NULL;
-BBTrackContainer * LmmsCore::s_bbTrackContainer = NULL;
-Song * LmmsCore::s_song = NULL;
-ProjectJournal * LmmsCore::s_projectJournal = NULL;
+EngineContext LmmsCore::s_main = EngineContext();
+std::atomic_int LmmsCore::s_extraContexts( 0 );
 Ladspa2LMMS * LmmsCore::s_ladspaManager = NULL;
 void* LmmsCore::s_dndPluginKey = nullptr;
-DummyTrackContainer * LmmsCore::s_dummyTC = NULL;
+bool LmmsCore::s_profileStartup = false;
+PerfLogTimer * LmmsCore::s_startupPhase = NULL;
+PerfLogTimer * LmmsCore::s_startupTotal = NULL;
 
+// the context of the thread, NULL for the one of init()
+static thread_local EngineContext * s_threadContext = NULL;
 
 
 
-void LmmsCore::init( bool renderOnly )
+
+LmmsCore::ContextScope::ContextScope( EngineContext * _context ) :
+	m_previous( s_threadContext )
 {
-	LmmsCore *engine = inst();
+	s_threadContext = _context;
+}
+
 
-	emit engine->initProgress(tr("Generating wavetables"));
-	// generate (load from file) bandlimited wavetables
-	BandLimitedWave::generateWaves();
 
-	emit engine->initProgress(tr("Initializing data structures"));
-	s_projectJournal = new ProjectJournal;
-	s_mixer = new Mixer( renderOnly );
-	s_song = new Song;
-	s_fxMixer = new FxMixer;
-	s_bbTrackContainer = new BBTrackContainer;
 
-	s_ladspaManager = new Ladspa2LMMS;
+LmmsCore::ContextScope::~ContextScope()
+{
+	s_threadContext = m_previous;
+}
+
 
-	s_projectJournal->setJournalling( true );
 
-	emit engine->initProgress(tr("Opening audio and midi devices"));
-	s_mixer->initDevices();
+
+EngineContext * LmmsCore::threadContext()
+{
+	return s_threadContext ? s_threadContext : &s_main;
+}
+
+
+
+
+void LmmsCore::init( bool renderOnly )
+{
+	// none of the engine objects needs the wavetables, the LADSPA plugins
+	// or the plugin descriptors until something gets instantiated, so
+	// they're loaded while the engine is set up
+	std::future<void> waves = std::async( std::launch::async, []()
+	{
+		// generate (load from file) bandlimited wavetables
+		PerfLogTimer timer( "Wavetables", s_profileStartup );
+		BandLimitedWave::generateWaves();
+	} );
+	std::future<Ladspa2LMMS *> ladspa = std::async( std::launch::async, []()
+	{
+		PerfLogTimer timer( "LADSPA plugins", s_profileStartup );
+		return new Ladspa2LMMS;
+	} );
+	std::future<void> plugins = std::async( std::launch::async, []()
+	{
+		PerfLogTimer timer( "Plugin manifest", s_profileStartup );
+		PluginFactory::instance();
+	} );
+
+	startupPhase( tr( "Initializing data structures" ) );
+	if( ConfigManager::inst()->value( "mixer", "samplediskcache" ).toInt() )
+	{
+		SampleCache::setDiskCacheDir( SampleCache::defaultDiskCacheDir() );
+	}
+	s_main.projectJournal = new ProjectJournal;
+	s_main.mixer = new Mixer( renderOnly );
+	s_main.song = new Song;
+	s_main.fxMixer = new FxMixer;
+	s_main.bbTrackContainer = new BBTrackContainer;
+
+	s_main.projectJournal->setJournalling( true );
+
+	if( s_main.mixer->m_idleTrimTimer.interval() > 0 )
+	{
+		QObject::connect( s_main.song, SIGNAL( stopped() ),
+				&s_main.mixer->m_idleTrimTimer, SLOT( start() ) );
+	}
+
+	startupPhase( tr( "Opening audio and midi devices" ) );
+	s_main.mixer->initDevices();
+
+	// the preview track is the first to instantiate a plugin
+	startupPhase( tr( "Loading wavetables and plugins" ) );
+	waves.wait();
+	plugins.wait();
+	s_ladspaManager = ladspa.get();
 
 	PresetPreviewPlayHandle::init();
-	s_dummyTC = new DummyTrackContainer;
+	s_main.dummyTC = new DummyTrackContainer;
+
+	startupPhase( tr( "Launching mixer threads" ) );
+	s_main.mixer->startProcessing();
+
+	if( renderOnly )
+	{
+		startupPhase( QString() );
+	}
+}
+
+
 
-	emit engine->initProgress(tr("Launching mixer threads"));
-	s_mixer->startProcessing();
+
+void LmmsCore::startupPhase( const QString & _name )
+{
+	// logs the phase before
+	delete s_startupPhase;
+	s_startupPhase = NULL;
+
+	if( _name.isEmpty() )
+	{
+		delete s_startupTotal;
+		s_startupTotal = NULL;
+		return;
+	}
+
+	if( s_profileStartup )
+	{
+		if( s_startupTotal == NULL )
+		{
+			s_startupTotal = new PerfLogTimer( "Startup" );
+		}
+		s_startupPhase = new PerfLogTimer( _name );
+	}
+	emit inst()->initProgress( _name );
 }
 
 
@@ -82,33 +174,86 @@ void LmmsCore::init( bool renderOnly )
 
 void LmmsCore::destroy()
 {
-	s_projectJournal->stopAllJournalling();
-	s_mixer->stopProcessing();
+	s_main.projectJournal->stopAllJournalling();
+	s_main.mixer->stopProcessing();
 
 	PresetPreviewPlayHandle::cleanup();
 
-	s_song->clearProject();
+	s_main.song->clearProject();
 
-	deleteHelper( &s_bbTrackContainer );
-	deleteHelper( &s_dummyTC );
+	deleteHelper( &s_main.bbTrackContainer );
+	deleteHelper( &s_main.dummyTC );
 
-	deleteHelper( &s_fxMixer );
-	deleteHelper( &s_mixer );
+	deleteHelper( &s_main.fxMixer );
+	deleteHelper( &s_main.mixer );
 
 	deleteHelper( &s_ladspaManager );
 
 	//delete ConfigManager::inst();
-	deleteHelper( &s_projectJournal );
+	deleteHelper( &s_main.projectJournal );
 
-	deleteHelper( &s_song );
+	deleteHelper( &s_main.song );
 
 	delete ConfigManager::inst();
 }
 
+
+
+
+EngineContext * LmmsCore::createContext()
+{
+	EngineContext * context = new EngineContext();
+	// before anything is created which looks its context up
+	++s_extraContexts;
+	ContextScope scope( context );
+
+	context->projectJournal = new ProjectJournal;
+	// the worker threads of the first mixer are shared, see
+	// MixerWorkerThread::acquireWorkers()
+	context->mixer = new Mixer( true );
+	context->song = new Song;
+	context->fxMixer = new FxMixer;
+	context->bbTrackContainer = new BBTrackContainer;
+	context->dummyTC = new DummyTrackContainer;
+
+	context->mixer->initDevices();
+
+	return context;
+}
+
+
+
+
+void LmmsCore::destroyContext( EngineContext * _context )
+{
+	{
+		ContextScope scope( _context );
+
+		_context->projectJournal->stopAllJournalling();
+		_context->song->clearProject();
+
+		deleteHelper( &_context->bbTrackContainer );
+		deleteHelper( &_context->dummyTC );
+
+		deleteHelper( &_context->fxMixer );
+		deleteHelper( &_context->mixer );
+
+		deleteHelper( &_context->projectJournal );
+
+		deleteHelper( &_context->song );
+	}
+
+	delete _context;
+	--s_extraContexts;
+}
+
+
+
+
 float LmmsCore::framesPerTick(sample_rate_t sampleRate)
 {
 	return sampleRate * 60.0f * 4 /
-			DefaultTicksPerBar / s_song->getTempo();
+			DefaultTicksPerBar / getSong()->getTempo();
 }
 
 
@@ -116,8 +261,14 @@ float LmmsCore::framesPerTick(sample_rate_t sampleRate)
 
 void LmmsCore::updateFramesPerTick()
 {
-	s_framesPerTick = s_mixer->processingSampleRate() * 60.0f * 4 /
-				DefaultTicksPerBar / s_song->getTempo();
+	EngineContext * c = context();
+	c->framesPerTick = c->mixer->processingSampleRate() * 60.0f * 4 /
+				DefaultTicksPerBar / c->song->getTempo();
+	if( c->periodFramesPerTick == 0 )
+	{
+		// notes created before the first period
+		c->periodFramesPerTick = c->framesPerTick;
+	}
 }
 
 
@@ -24,10 +24,15 @@
 
 #include <QDomElement>
 
+#include <algorithm>
+#include <cstring>
+
 #include "EnvelopeAndLfoParameters.h"
 #include "Engine.h"
+#include "lmms_math.h"
 #include "Mixer.h"
 #include "Oscillator.h"
+#include "ScratchArena.h"
 
 
 // how long should be each envelope-segment maximal (e.g. attack)?
@@ -43,12 +48,18 @@ EnvelopeAndLfoParameters::LfoInstances * EnvelopeAndLfoParameters::s_lfoInstance
 
 void EnvelopeAndLfoParameters::LfoInstances::trigger()
 {
+	// only the LFOs of the mixer rendering, see Engine::createContext()
+	EngineContext * context = Engine::context();
+	const fpp_t frames = context->mixer->framesPerPeriod();
 	QMutexLocker m( &m_lfoListMutex );
 	for( LfoList::Iterator it = m_lfos.begin();
 							it != m_lfos.end(); ++it )
 	{
-		( *it )->m_lfoFrame +=
-				Engine::mixer()->framesPerPeriod();
+		if( ( *it )->m_context != context )
+		{
+			continue;
+		}
+		( *it )->m_lfoFrame += frames;
 		( *it )->m_bad_lfoShapeData = true;
 	}
 }
@@ -58,10 +69,15 @@ void EnvelopeAndLfoParameters::LfoInstances::trigger()
 
 void EnvelopeAndLfoParameters::LfoInstances::reset()
 {
+	EngineContext * context = Engine::context();
 	QMutexLocker m( &m_lfoListMutex );
 	for( LfoList::Iterator it = m_lfos.begin();
 							it != m_lfos.end(); ++it )
 	{
+		if( ( *it )->m_context != context )
+		{
+			continue;
+		}
 		( *it )->m_lfoFrame = 0;
 		( *it )->m_bad_lfoShapeData = true;
 	}
@@ -118,7 +134,8 @@ EnvelopeAndLfoParameters::EnvelopeAndLfoParameters(
 	m_controlEnvAmountModel( false, this, tr( "Modulate env amount" ) ),
 	m_lfoFrame( 0 ),
 	m_lfoAmountIsZero( false ),
-	m_lfoShapeData( NULL )
+	m_lfoShapeData( NULL ),
+	m_context( Engine::context() )
 {
 	m_amountModel.setCenterValue( 0 );
 	m_lfoAmountModel.setCenterValue( 0 );
@@ -244,9 +261,28 @@ inline sample_t EnvelopeAndLfoParameters::lfoShapeSample( fpp_t _frame_offset )
 void EnvelopeAndLfoParameters::updateLfoShapeData()
 {
 	const fpp_t frames = Engine::mixer()->framesPerPeriod();
-	for( fpp_t offset = 0; offset < frames; ++offset )
+	if( m_lfoWaveModel.value() == SineWave )
 	{
-		m_lfoShapeData[offset] = lfoShapeSample( offset );
+		// the phases first, so the whole period goes through the
+		// vectorized fastSinBlock()
+		const float phaseToRad = F_2PI / m_lfoOscillationFrames;
+		for( fpp_t offset = 0; offset < frames; ++offset )
+		{
+			m_lfoShapeData[offset] = ( ( m_lfoFrame + offset ) %
+				m_lfoOscillationFrames ) * phaseToRad;
+		}
+		fastSinBlock( m_lfoShapeData, m_lfoShapeData, frames );
+		for( fpp_t offset = 0; offset < frames; ++offset )
+		{
+			m_lfoShapeData[offset] *= m_lfoAmount;
+		}
+	}
+	else
+	{
+		for( fpp_t offset = 0; offset < frames; ++offset )
+		{
+			m_lfoShapeData[offset] = lfoShapeSample( offset );
+		}
 	}
 	m_bad_lfoShapeData = false;
 }
@@ -260,10 +296,7 @@ inline void EnvelopeAndLfoParameters::fillLfoLevel( float * _buf,
 {
 	if( m_lfoAmountIsZero || _frame <= m_lfoPredelayFrames )
 	{
-		for( fpp_t offset = 0; offset < _frames; ++offset )
-		{
-			*_buf++ = 0.0f;
-		}
+		memset( _buf, 0, _frames * sizeof( float ) );
 		return;
 	}
 	_frame -= m_lfoPredelayFrames;
@@ -273,17 +306,15 @@ inline void EnvelopeAndLfoParameters::fillLfoLevel( float * _buf,
 		updateLfoShapeData();
 	}
 
-	fpp_t offset = 0;
 	const float lafI = 1.0f / qMax( minimumFrames, m_lfoAttackFrames );
-	for( ; offset < _frames && _frame < m_lfoAttackFrames; ++offset,
-								++_frame )
-	{
-		*_buf++ = m_lfoShapeData[offset] * _frame * lafI;
-	}
-	for( ; offset < _frames; ++offset )
+	const fpp_t attack = static_cast<fpp_t>( qBound<f_cnt_t>( 0,
+				m_lfoAttackFrames - _frame, _frames ) );
+	for( fpp_t offset = 0; offset < attack; ++offset )
 	{
-		*_buf++ = m_lfoShapeData[offset];
+		_buf[offset] = m_lfoShapeData[offset] * ( _frame + offset ) * lafI;
 	}
+	memcpy( _buf + attack, m_lfoShapeData + attack,
+					( _frames - attack ) * sizeof( float ) );
 }
 
 
@@ -302,35 +333,61 @@ void EnvelopeAndLfoParameters::fillLevel( float * _buf, f_cnt_t _frame,
 
 	fillLfoLevel( _buf, _frame, _frames );
 
-	for( fpp_t offset = 0; offset < _frames; ++offset, ++_buf, ++_frame )
+	// the envelope in runs of its segments, found once per period instead
+	// of with every frame
+	ScratchBuffer<float> env( _frames );
+	fpp_t offset = 0;
+	while( offset < _frames )
 	{
-		float env_level;
-		if( _frame < _release_begin )
+		const f_cnt_t frame = _frame + offset;
+		fpp_t run;
+		if( frame < _release_begin && frame < m_pahdFrames )
 		{
-			if( _frame < m_pahdFrames )
-			{
-				env_level = m_pahdEnv[_frame];
-			}
-			else
-			{
-				env_level = m_sustainLevel;
-			}
+			run = qMin<f_cnt_t>( _frames - offset,
+				qMin( _release_begin, m_pahdFrames ) - frame );
+			memcpy( env.data() + offset, m_pahdEnv + frame,
+							run * sizeof( float ) );
 		}
-		else if( ( _frame - _release_begin ) < m_rFrames )
+		else if( frame < _release_begin )
 		{
-			env_level = m_rEnv[_frame - _release_begin] *
-				( ( _release_begin < m_pahdFrames ) ?
-				m_pahdEnv[_release_begin] : m_sustainLevel );
+			run = qMin<f_cnt_t>( _frames - offset,
+						_release_begin - frame );
+			std::fill_n( env.data() + offset, run, m_sustainLevel );
+		}
+		else if( frame - _release_begin < m_rFrames )
+		{
+			run = qMin<f_cnt_t>( _frames - offset,
+					m_rFrames - ( frame - _release_begin ) );
+			const float releaseLevel = _release_begin < m_pahdFrames ?
+				m_pahdEnv[_release_begin] : m_sustainLevel;
+			const sample_t * rEnv = m_rEnv + ( frame - _release_begin );
+			for( fpp_t i = 0; i < run; ++i )
+			{
+				env[offset + i] = rEnv[i] * releaseLevel;
+			}
 		}
 		else
 		{
-			env_level = 0.0f;
+			run = _frames - offset;
+			std::fill_n( env.data() + offset, run, 0.0f );
 		}
+		offset += run;
+	}
 
-		// at this point, *_buf is LFO level
-		*_buf = m_controlEnvAmountModel.value() ?
-			env_level * ( 0.5f + *_buf ) :
-			env_level + *_buf;
+	// at this point, _buf is LFO level
+	if( m_controlEnvAmountModel.value() )
+	{
+		for( fpp_t i = 0; i < _frames; ++i )
+		{
+			_buf[i] = env[i] * ( 0.5f + _buf[i] );
+		}
+	}
+	else
+	{
+		for( fpp_t i = 0; i < _frames; ++i )
+		{
+			_buf[i] = env[i] + _buf[i];
+		}
 	}
 }
 
@@ -0,0 +1,111 @@
+/*
+ * FileIndex.cpp - finds the files whose names contain a text, for searching
+ *                 the file browser
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "FileIndex.h"
+
+
+void FileIndex::add( const QString & _path )
+{
+	const int entry = m_paths.size();
+	const QString name =
+		_path.mid( _path.lastIndexOf( '/' ) + 1 ).toLower();
+	m_paths.push_back( _path );
+	m_names.push_back( name );
+
+	for( int i = 0; i + 3 <= name.size(); ++i )
+	{
+		QVector<int> & entries = m_trigrams[trigram( name.constData() + i )];
+		// once for a trigram repeated in the name
+		if( entries.isEmpty() || entries.last() != entry )
+		{
+			entries.push_back( entry );
+		}
+	}
+}
+
+
+
+
+void FileIndex::clear()
+{
+	m_paths.clear();
+	m_names.clear();
+	m_trigrams.clear();
+}
+
+
+
+
+QVector<int> FileIndex::find( const QString & _text ) const
+{
+	const QString text = _text.toLower();
+	QVector<int> found;
+
+	if( text.size() < 3 )
+	{
+		// too short for a trigram, most names match such anyway
+		for( int entry = 0; entry < m_names.size(); ++entry )
+		{
+			if( m_names[entry].contains( text ) )
+			{
+				found.push_back( entry );
+			}
+		}
+		return found;
+	}
+
+	// only the names with the rarest trigram of the text can contain it
+	const QVector<int> * rarest = NULL;
+	for( int i = 0; i + 3 <= text.size(); ++i )
+	{
+		const QHash<quint64, QVector<int> >::const_iterator it =
+			m_trigrams.constFind( trigram( text.constData() + i ) );
+		if( it == m_trigrams.constEnd() )
+		{
+			return found;
+		}
+		if( rarest == NULL || it->size() < rarest->size() )
+		{
+			rarest = &*it;
+		}
+	}
+
+	for( const int entry : *rarest )
+	{
+		if( m_names[entry].contains( text ) )
+		{
+			found.push_back( entry );
+		}
+	}
+	return found;
+}
+
+
+
+
+quint64 FileIndex::trigram( const QChar * _chars )
+{
+	return ( quint64( _chars[0].unicode() ) << 32 ) |
+			( quint64( _chars[1].unicode() ) << 16 ) |
+					_chars[2].unicode();
+}
@@ -24,12 +24,20 @@
 
 #include <QDomElement>
 
+#include <algorithm>
+#include <cstring>
+
+#include "AudioPort.h"
 #include "BufferManager.h"
+#include "Effect.h"
 #include "FxMixer.h"
 #include "Mixer.h"
 #include "MixerWorkerThread.h"
 #include "MixHelpers.h"
+#include "ScratchArena.h"
 #include "Song.h"
+#include "StemExporter.h"
+#include "TraceRecorder.h"
 
 #include "InstrumentTrack.h"
 #include "SampleTrack.h"
@@ -58,23 +66,115 @@ void FxRoute::updateName()
 }
 
 
+//! The effects of a stage after the first one, processing what the stage
+//! before put out during the last period in a buffer of its own
+class FxChannel::PipelineStage : public ThreadableJob
+{
+public:
+	PipelineStage( FxChannel * _channel ) :
+		m_channel( _channel ),
+		m_first( 0 ),
+		m_end( 0 ),
+		m_buffer( new sampleFrame[Engine::mixer()->framesPerPeriod()] ),
+		m_hasInput( false ),
+		m_running( false )
+	{
+		clear();
+	}
+
+	~PipelineStage()
+	{
+		delete[] m_buffer;
+	}
+
+	bool requiresProcessing() const override
+	{
+		return true;
+	}
+
+	void clear()
+	{
+		BufferManager::clear( m_buffer, Engine::mixer()->framesPerPeriod() );
+		m_hasInput = false;
+		m_running = false;
+	}
+
+	//! Whether the buffer holds anything after processing
+	bool active() const
+	{
+		return m_hasInput || m_running;
+	}
+
+	FxChannel * m_channel;
+	int m_first;
+	int m_end;
+	sampleFrame * m_buffer;
+	bool m_hasInput;
+	bool m_running;
+
+
+protected:
+	void doProcessing() override
+	{
+		if( !active() )
+		{
+			return;
+		}
+		if( m_hasInput )
+		{
+			m_channel->m_fxChain.startRunning( m_first, m_end );
+		}
+		m_running = m_channel->m_fxChain.processAudioBuffer( m_buffer,
+				Engine::mixer()->framesPerPeriod(), m_hasInput,
+							m_first, m_end );
+	}
+
+	const char * traceName() const override
+	{
+		return "FxChannel::PipelineStage";
+	}
+
+} ;
+
+
+
+
 FxChannel::FxChannel( int idx, Model * _parent ) :
 	m_fxChain( NULL ),
 	m_hasInput( false ),
 	m_stillRunning( false ),
+	m_bufferDirty( false ),
 	m_peakLeft( 0.0f ),
 	m_peakRight( 0.0f ),
-	m_buffer( new sampleFrame[Engine::mixer()->framesPerPeriod()] ),
+	m_buffer( NULL ),
+	m_inputSlots( MixerWorkerThread::threadCount() ),
+	m_inputs( NULL ),
+	m_inputUsed( new bool[m_inputSlots] ),
 	m_muteModel( false, _parent ),
 	m_soloModel( false, _parent ),
 	m_volumeModel( 1.0, 0.0, 2.0, 0.001, _parent ),
+	m_pipelineStagesModel( 1, 1, MaxPipelineStages, _parent ),
 	m_name(),
 	m_lock(),
 	m_channelIndex( idx ),
 	m_queued( false ),
-	m_dependenciesMet(0)
+	m_stemTap( NULL ),
+	m_dependenciesMet(0),
+	m_portInputs( 0 ),
+	m_inputLatency( 0 ),
+	m_latency( 0 ),
+	m_pipelineStages( 1 ),
+	m_firstStageRunning( false ),
+	m_pipelineWanted( 1 ),
+	m_pipelineEffects( 0 ),
+	m_pipelineByCost( false )
 {
-	BufferManager::clear( m_buffer, Engine::mixer()->framesPerPeriod() );
+	std::fill( m_inputUsed, m_inputUsed + m_inputSlots, false );
+	for( PipelineStage * & stage : m_stages )
+	{
+		stage = new PipelineStage( this );
+	}
+	m_stageEnds[0] = 0;
 }
 
 
@@ -82,7 +182,11 @@ FxChannel::FxChannel( int idx, Model * _parent ) :
 
 FxChannel::~FxChannel()
 {
-	delete[] m_buffer;
+	for( PipelineStage * stage : m_stages )
+	{
+		delete stage;
+	}
+	delete[] m_inputUsed;
 }
 
 
@@ -95,18 +199,35 @@ inline void FxChannel::processed()
 			receiverRoute->receiver()->incrementDeps();
 		}
 	}
+	for( FxChannel * listener : m_sidechainListeners )
+	{
+		if( listener->m_muted == false )
+		{
+			listener->incrementDeps();
+		}
+	}
 }
 
 void FxChannel::incrementDeps()
 {
 	int i = m_dependenciesMet++ + 1;
-	if( i >= m_receives.size() && ! m_queued )
+	if( i >= m_receives.size() + m_sidechainSources.size() + m_portInputs &&
+								! m_queued )
 	{
 		m_queued = true;
 		MixerWorkerThread::addJob( this );
 	}
 }
 
+void FxChannel::predecessorDone()
+{
+	// muted channels are done before any input gets processed
+	if( m_muted == false )
+	{
+		incrementDeps();
+	}
+}
+
 void FxChannel::unmuteForSolo()
 {
 	//TODO: Recursively activate every channel, this channel sends to
@@ -115,19 +236,164 @@ void FxChannel::unmuteForSolo()
 
 
 
+void FxChannel::combineInputs( fpp_t _frames )
+{
+	for( int slot = 0; slot < m_inputSlots; ++slot )
+	{
+		if( m_inputUsed[slot] )
+		{
+			MixHelpers::add( m_buffer, m_inputs + slot * _frames, _frames );
+			m_inputUsed[slot] = false;
+			m_hasInput = true;
+		}
+	}
+}
+
+
+
+void FxChannel::updatePipeline()
+{
+	const int wanted = m_pipelineStagesModel.value();
+	const int effects = m_fxChain.size();
+	if( wanted == m_pipelineWanted && effects == m_pipelineEffects &&
+					( m_pipelineByCost || wanted == 1 ) )
+	{
+		return;
+	}
+
+	int ends[MaxPipelineStages];
+	bool byCost = false;
+	const int stages = m_fxChain.splitIntoStages( wanted, ends, byCost );
+	m_pipelineWanted = wanted;
+	m_pipelineEffects = effects;
+	m_pipelineByCost = byCost;
+	if( stages == m_pipelineStages &&
+			std::equal( ends, ends + stages, m_stageEnds ) )
+	{
+		return;
+	}
+
+	// what was on its way through the old stages is dropped, effects
+	// which were running get processed until they tell they're done
+	std::copy( ends, ends + stages, m_stageEnds );
+	m_pipelineStages = stages;
+	m_firstStageRunning = true;
+	for( int i = 0; i < MaxPipelineStages - 1; ++i )
+	{
+		m_stages[i]->clear();
+		if( i < stages - 1 )
+		{
+			m_stages[i]->m_first = m_stageEnds[i];
+			m_stages[i]->m_end = m_stageEnds[i + 1];
+			m_stages[i]->m_running = true;
+		}
+	}
+}
+
+
+
+
+void FxChannel::queuePipeline()
+{
+	for( int i = 0; i < m_pipelineStages - 1; ++i )
+	{
+		MixerWorkerThread::addJob( m_stages[i] );
+	}
+}
+
+
+
+
+void FxChannel::resetPipeline()
+{
+	for( int i = 0; i < m_pipelineStages - 1; ++i )
+	{
+		m_stages[i]->reset();
+	}
+}
+
+
+
+
+bool FxChannel::finishPipeline( bool _firstActive, fpp_t _frames )
+{
+	const int later = m_pipelineStages - 1;
+
+	// the stages usually got processed along with the play handles, the
+	// ones which didn't are processed here unless another thread is busy
+	// with them
+	bool stagesLeft;
+	do
+	{
+		stagesLeft = false;
+		for( int i = 0; i < later; ++i )
+		{
+			PipelineStage * stage = m_stages[i];
+			if( stage->state() == ProcessingState::Unstarted )
+			{
+				stage->queue();
+			}
+			if( stage->state() != ProcessingState::Done )
+			{
+				stagesLeft = true;
+				stage->process();
+			}
+		}
+	}
+	while( stagesLeft );
+
+	// the output of the last stage and the one of the first stage swap
+	// places, then every buffer moves on by one stage
+	PipelineStage * last = m_stages[later - 1];
+	const bool active = last->active();
+	sampleFrame * output = last->m_buffer;
+	std::swap_ranges( m_buffer, m_buffer + _frames, output );
+	bool pending = _firstActive;
+	for( int i = later - 1; i > 0; --i )
+	{
+		m_stages[i]->m_buffer = m_stages[i - 1]->m_buffer;
+		m_stages[i]->m_hasInput = m_stages[i - 1]->active();
+		pending |= m_stages[i]->active();
+	}
+	m_stages[0]->m_buffer = output;
+	m_stages[0]->m_hasInput = _firstActive;
+	pending |= m_stages[0]->m_running;
+
+	// stages without input start from silence
+	for( int i = 0; i < later; ++i )
+	{
+		if( !m_stages[i]->m_hasInput )
+		{
+			BufferManager::clear( m_stages[i]->m_buffer, _frames );
+		}
+	}
+
+	// a tail or anything on its way through the stages keeps the channel
+	// running
+	m_stillRunning = active || pending || m_firstStageRunning;
+	return active;
+}
+
+
+
+
 void FxChannel::doProcessing()
 {
 	const fpp_t fpp = Engine::mixer()->framesPerPeriod();
 
 	if( m_muted == false )
 	{
+		combineInputs( fpp );
+
 		for( FxRoute * senderRoute : m_receives )
 		{
 			FxChannel * sender = senderRoute->sender();
 			FloatModel * sendModel = senderRoute->amount();
 			if( ! sendModel ) qFatal( "Error: no send model found from %d to %d", senderRoute->senderIndex(), m_channelIndex );
 
-			if( sender->m_hasInput || sender->m_stillRunning )
+			LatencyCompensator * compensator = senderRoute->compensator();
+			const bool senderActive = sender->m_hasInput || sender->m_stillRunning;
+			if( senderActive || compensator->hasTail() )
 			{
 				// figure out if we're getting sample-exact input
 				ValueBuffer * sendBuf = sendModel->valueBuffer();
@@ -136,6 +402,16 @@ void FxChannel::doProcessing()
 				// mix it's output with this one's output
 				sampleFrame * ch_buf = sender->m_buffer;
 
+				// delayed to meet the slowest input of this channel
+				ScratchBuffer<sampleFrame> delayed(
+						compensator->delay() > 0 ? fpp : 0 );
+				if( compensator->delay() > 0 )
+				{
+					memcpy( delayed.data(), ch_buf, sizeof( sampleFrame ) * fpp );
+					compensator->process( delayed.data(), fpp, !senderActive );
+					ch_buf = delayed.data();
+				}
+
 				// use sample-exact mixing if sample-exact values are available
 				if( ! volBuf && ! sendBuf ) // neither volume nor send has sample-exact data...
 				{
@@ -166,18 +442,65 @@ void FxChannel::doProcessing()
 		if( m_hasInput )
 		{
 			// only start fxchain when we have input...
-			m_fxChain.startRunning();
+			m_fxChain.startRunning( 0, m_pipelineStages > 1 ?
+							m_stageEnds[0] : -1 );
+		}
+
+		bool active = m_hasInput || m_stillRunning;
+		if( m_pipelineStages > 1 )
+		{
+			// the first stage is processed right away, the buffer gets
+			// the output of the last one in exchange
+			const bool firstActive = m_hasInput || m_firstStageRunning;
+			if( firstActive )
+			{
+				m_firstStageRunning = m_fxChain.processAudioBuffer(
+					m_buffer, fpp, m_hasInput, 0, m_stageEnds[0] );
+			}
+			active = finishPipeline( firstActive, fpp );
+			m_bufferDirty = true;
 		}
+		else if( active )
+		{
+			// effects which were still running write to the buffer as well
+			m_bufferDirty = true;
+			m_stillRunning = m_fxChain.processAudioBuffer( m_buffer, fpp, m_hasInput );
+		}
+
+		// a silent channel whose effects are all done keeps its cleared
+		// buffer, so there's nothing to sanitize or meter
+		float peakLeft = 0.0f, peakRight = 0.0f;
+		if( active )
+		{
+			// sanitizes the output of the last effect as well
+			MixHelpers::sanitizeAndPeak( m_buffer, fpp, peakLeft, peakRight );
+			m_peakLeft = qMax( m_peakLeft, peakLeft * v );
+			m_peakRight = qMax( m_peakRight, peakRight * v );
 
-		m_stillRunning = m_fxChain.processAudioBuffer( m_buffer, fpp, m_hasInput );
+			if( m_stemTap )
+			{
+				m_stemTap->capture( m_buffer, fpp, v );
+			}
+		}
+		m_tap.write( m_buffer, fpp );
 
-		Mixer::StereoSample peakSamples = Engine::mixer()->getPeakValues(m_buffer, fpp);
-		m_peakLeft = qMax( m_peakLeft, peakSamples.left * v );
-		m_peakRight = qMax( m_peakRight, peakSamples.right * v );
+		// while the buffer is still in the cache
+		if( m_meter.isWanted() )
+		{
+			m_meter.process( active ? m_buffer : NULL, fpp, v,
+					peakLeft * v, peakRight * v,
+					Engine::mixer()->processingSampleRate() );
+		}
 	}
 	else
 	{
 		m_peakLeft = m_peakRight = 0.0f;
+		m_tap.write( NULL, fpp );
+		if( m_meter.isWanted() )
+		{
+			m_meter.process( NULL, fpp, 0.0f, 0.0f, 0.0f,
+					Engine::mixer()->processingSampleRate() );
+		}
 	}
 
 	// increment dependency counter of all receivers
@@ -189,7 +512,12 @@ void FxChannel::doProcessing()
 FxMixer::FxMixer() :
 	Model( NULL ),
 	JournallingObject(),
-	m_fxChannels()
+	m_fxChannels(),
+	m_schedule(),
+	m_scheduleOutdated( true ),
+	m_channelBuffers( NULL ),
+	m_channelBufferSlots( 0 ),
+	m_bufferLayoutOutdated( false )
 {
 	// create master channel
 	createChannel();
@@ -210,6 +538,7 @@ FxMixer::~FxMixer()
 		m_fxChannels.pop_back();
 		delete f;
 	}
+	BufferManager::freeSlab( m_channelBuffers );
 }
 
 
@@ -218,11 +547,23 @@ int FxMixer::createChannel()
 {
 	const int index = m_fxChannels.size();
 	// create new channel
+	Engine::mixer()->requestChangeInModel();
 	m_fxChannels.push_back( new FxChannel( index, this ) );
+	invalidateSchedule();
+	reserveChannelBuffers( m_fxChannels.size() );
+	layoutChannelBuffers();
+	Engine::mixer()->doneChangeInModel();
+	Engine::mixer()->reserveSnapshotChannels( m_fxChannels.size() );
+
+	// effects taking a sidechain input come and go with the chain
+	connect( &m_fxChannels.last()->m_fxChain, &EffectChain::dataChanged,
+					this, &FxMixer::updateSidechains );
 
 	// reset channel state
 	clearChannel( index );
 
+	invalidateSchedule();
+
 	return index;
 }
 
@@ -324,6 +665,15 @@ void FxMixer::deleteChannel( int index )
 		}
 	}
 
+	// effects taking this channel as sidechain input lose it
+	QVector<int> newIndex( m_fxChannels.size() );
+	for( int i = 0; i < newIndex.size(); ++i )
+	{
+		newIndex[i] = i < index ? i : i - 1;
+	}
+	newIndex[index] = -1;
+	remapSidechains( newIndex );
+
 	FxChannel * ch = m_fxChannels[index];
 
 	// delete all of this channel's sends and receives
@@ -344,6 +694,7 @@ void FxMixer::deleteChannel( int index )
 	// actually delete the channel
 	m_fxChannels.remove(index);
 	delete ch;
+	invalidateSchedule();
 
 	for( int i = index; i < m_fxChannels.size(); ++i )
 	{
@@ -363,6 +714,8 @@ void FxMixer::deleteChannel( int index )
 		}
 	}
 
+	updateSidechains();
+
 	Engine::mixer()->doneChangeInModel();
 }
 
@@ -421,12 +774,22 @@ void FxMixer::moveChannelLeft( int index )
 		}
 	}
 
+	QVector<int> newIndex( m_fxChannels.size() );
+	for( int i = 0; i < newIndex.size(); ++i )
+	{
+		newIndex[i] = i;
+	}
+	qSwap( newIndex[a], newIndex[b] );
+	remapSidechains( newIndex );
+
 	// Swap positions in array
 	qSwap(m_fxChannels[index], m_fxChannels[index - 1]);
 
 	// Update m_channelIndex of both channels
 	m_fxChannels[index]->m_channelIndex = index;
 	m_fxChannels[index - 1]->m_channelIndex = index -1;
+
+	invalidateSchedule();
 }
 
 
@@ -478,6 +841,7 @@ FxRoute * FxMixer::createRoute( FxChannel * from, FxChannel * to, float amount )
 
 	// add us to fxmixer's list
 	Engine::fxMixer()->m_fxRoutes.append( route );
+	invalidateSchedule();
 	Engine::mixer()->doneChangeInModel();
 
 	return route;
@@ -513,6 +877,7 @@ void FxMixer::deleteChannelSend( FxRoute * route )
 	// remove us from fxmixer's list
 	Engine::fxMixer()->m_fxRoutes.remove( Engine::fxMixer()->m_fxRoutes.indexOf( route ) );
 	delete route;
+	invalidateSchedule();
 	Engine::mixer()->doneChangeInModel();
 }
 
@@ -551,10 +916,98 @@ bool FxMixer::checkInfiniteLoop( FxChannel * from, FxChannel * to )
 		}
 	}
 
+	// channels taking the output as sidechain input are processed after
+	// it as well
+	for( FxChannel * listener : to->m_sidechainListeners )
+	{
+		if( checkInfiniteLoop( from, listener ) )
+		{
+			return true;
+		}
+	}
+
 	return false;
 }
 
 
+
+
+void FxMixer::updateSidechains()
+{
+	Engine::mixer()->requestChangeInModel();
+
+	for( FxChannel * ch : m_fxChannels )
+	{
+		ch->m_sidechainSources.clear();
+		ch->m_sidechainListeners.clear();
+	}
+
+	for( FxChannel * ch : m_fxChannels )
+	{
+		for( Effect * effect : ch->m_fxChain.m_effects )
+		{
+			effect->m_sidechainSource = NULL;
+			const int source = effect->m_sidechainChannel;
+			if( source < 0 || source >= m_fxChannels.size() )
+			{
+				continue;
+			}
+
+			// the edges found so far tell whether the source depends
+			// on this channel already
+			FxChannel * from = m_fxChannels[source];
+			if( checkInfiniteLoop( from, ch ) )
+			{
+				continue;
+			}
+
+			effect->m_sidechainSource = from;
+			if( !ch->m_sidechainSources.contains( from ) )
+			{
+				ch->m_sidechainSources.append( from );
+				from->m_sidechainListeners.append( ch );
+			}
+		}
+	}
+
+	invalidateSchedule();
+	Engine::mixer()->doneChangeInModel();
+}
+
+
+
+
+int FxMixer::channelIndexOf( const EffectChain * _chain ) const
+{
+	for( const FxChannel * ch : m_fxChannels )
+	{
+		if( &ch->m_fxChain == _chain )
+		{
+			return ch->m_channelIndex;
+		}
+	}
+	return -1;
+}
+
+
+
+
+void FxMixer::remapSidechains( const QVector<int> & _newIndex )
+{
+	for( FxChannel * ch : m_fxChannels )
+	{
+		for( Effect * effect : ch->m_fxChain.m_effects )
+		{
+			const int source = effect->m_sidechainChannel;
+			if( source >= 0 && source < _newIndex.size() )
+			{
+				effect->m_sidechainChannel = _newIndex[source];
+			}
+		}
+	}
+}
+
+
 // how much does fromChannel send its output to the input of toChannel?
 FloatModel * FxMixer::channelSendModel( fx_ch_t fromChannel, fx_ch_t toChannel )
 {
@@ -580,71 +1033,367 @@ FloatModel * FxMixer::channelSendModel( fx_ch_t fromChannel, fx_ch_t toChannel )
 
 void FxMixer::mixToChannel( const sampleFrame * _buf, fx_ch_t _ch )
 {
-	if( m_fxChannels[_ch]->m_muteModel.value() == false )
+	FxChannel * ch = m_fxChannels[_ch];
+	if( ch->m_muteModel.value() )
+	{
+		return;
+	}
+
+	const fpp_t fpp = Engine::mixer()->framesPerPeriod();
+	const int slot = MixerWorkerThread::threadIndex();
+	if( slot >= 0 && slot < ch->m_inputSlots )
 	{
-		m_fxChannels[_ch]->m_lock.lock();
-		MixHelpers::add( m_fxChannels[_ch]->m_buffer, _buf, Engine::mixer()->framesPerPeriod() );
-		m_fxChannels[_ch]->m_hasInput = true;
-		m_fxChannels[_ch]->m_lock.unlock();
+		// only this thread ever touches its slot, the channel adds up all
+		// slots once its inputs are done
+		sampleFrame * input = ch->m_inputs + slot * fpp;
+		if( ch->m_inputUsed[slot] )
+		{
+			MixHelpers::add( input, _buf, fpp );
+		}
+		else
+		{
+			memcpy( input, _buf, sizeof( sampleFrame ) * fpp );
+			ch->m_inputUsed[slot] = true;
+		}
+		return;
 	}
+
+	ch->m_lock.lock();
+	MixHelpers::add( ch->m_buffer, _buf, fpp );
+	ch->m_hasInput = true;
+	ch->m_lock.unlock();
 }
 
 
 
 
-void FxMixer::prepareMasterMix()
+void FxMixer::prepareMasterMix( const QVector<AudioPort *> & ports )
 {
 	BufferManager::clear( m_fxChannels[0]->m_buffer,
 					Engine::mixer()->framesPerPeriod() );
+
+	// before the latencies, which the stages add to
+	for( FxChannel * ch : m_fxChannels )
+	{
+		ch->updatePipeline();
+	}
+	updateLatencies( ports );
 }
 
 
 
 void FxMixer::masterMix( sampleFrame * _buf )
 {
-	const int fpp = Engine::mixer()->framesPerPeriod();
+	TraceRecorder::Zone zone( "FxMixer::masterMix" );
+
+	// mute and solo states can change at any time (e.g. through automation)
+	// so check whether the schedule still matches them
+	bool muteChanged = false;
+	for( FxChannel * ch : m_fxChannels )
+	{
+		const bool muted = ch->m_muteModel.value();
+		muteChanged |= muted != ch->m_muted;
+		ch->m_muted = muted;
+		if( muted )
+		{
+			ch->m_peakLeft = ch->m_peakRight = 0.0f;
+		}
+		// all channels get queued by the schedule so don't let dependency
+		// counting queue them (see FxChannel::incrementDeps())
+		ch->m_queued = true;
+	}
+
+	if( muteChanged || m_scheduleOutdated )
+	{
+		updateSchedule();
+	}
+
+	for( const FxChannelList & level : m_schedule )
+	{
+		if( level.size() == 1 )
+		{
+			// no need to involve the worker threads (usually the case
+			// for master channel)
+			level.first()->queue();
+			level.first()->process();
+		}
+		else
+		{
+			MixerWorkerThread::fillJobQueue<FxChannelList>( level );
+			MixerWorkerThread::startAndWaitForJobs();
+		}
+	}
+
+	finishMasterMix( _buf );
+}
+
+
+
+
+// m_muted of all channels has to be up to date when calling this
+void FxMixer::updateSchedule()
+{
+	m_scheduleOutdated = false;
+	m_schedule.clear();
+
+	// number of unmuted senders and sidechain sources per channel which
+	// have not been scheduled
+	QVector<int> pendingSenders( m_fxChannels.size(), 0 );
+	FxChannelList level;
+	for( FxChannel * ch : m_fxChannels )
+	{
+		if( ch->m_muted )
+		{
+			continue;
+		}
+		for( const FxRoute * route : ch->m_receives )
+		{
+			if( route->sender()->m_muted == false )
+			{
+				++pendingSenders[ch->m_channelIndex];
+			}
+		}
+		for( const FxChannel * source : ch->m_sidechainSources )
+		{
+			if( source->m_muted == false )
+			{
+				++pendingSenders[ch->m_channelIndex];
+			}
+		}
+		if( pendingSenders[ch->m_channelIndex] == 0 )
+		{
+			level.append( ch );
+		}
+	}
+
+	// a channel is scheduled in the level after its last sender
+	while( !level.isEmpty() )
+	{
+		FxChannelList nextLevel;
+		for( const FxChannel * ch : level )
+		{
+			for( const FxRoute * route : ch->m_sends )
+			{
+				FxChannel * receiver = route->receiver();
+				if( receiver->m_muted == false &&
+					--pendingSenders[receiver->m_channelIndex] == 0 )
+				{
+					nextLevel.append( receiver );
+				}
+			}
+			for( FxChannel * listener : ch->m_sidechainListeners )
+			{
+				if( listener->m_muted == false &&
+					--pendingSenders[listener->m_channelIndex] == 0 )
+				{
+					nextLevel.append( listener );
+				}
+			}
+		}
+		m_schedule.append( level );
+		level = nextLevel;
+	}
+
+	m_bufferLayoutOutdated = true;
+}
+
+
+
+
+f_cnt_t FxMixer::channelSlotFrames()
+{
+	// each buffer starts on a cache line
+	const f_cnt_t frames = ( Engine::mixer()->framesPerPeriod() + 7 ) & ~7;
+	return frames * ( 1 + MixerWorkerThread::threadCount() );
+}
+
+
+
+
+void FxMixer::reserveChannelBuffers( int _channels )
+{
+	if( _channels <= m_channelBufferSlots )
+	{
+		return;
+	}
+
+	// callers wait for the mixer, so the slots can move
+	const int slots = qMax( _channels, 2 * m_channelBufferSlots );
+	BufferManager::freeSlab( m_channelBuffers );
+	m_channelBuffers = static_cast<sampleFrame *>( BufferManager::allocSlab(
+			sizeof( sampleFrame ) * channelSlotFrames() * slots ) );
+	m_channelBufferSlots = slots;
+}
 
-	// add the channels that have no dependencies (no incoming senders, ie.
-	// no receives) to the jobqueue. The channels that have receives get
-	// added when their senders get processed, which is detected by
-	// dependency counting.
-	// also instantly add all muted channels as they don't need to care
-	// about their senders, and can just increment the deps of their
-	// recipients right away.
-	MixerWorkerThread::resetJobQueue( MixerWorkerThread::JobQueue::Dynamic );
+
+
+
+void FxMixer::layoutChannelBuffers()
+{
+	m_bufferLayoutOutdated = false;
+
+	const fpp_t fpp = Engine::mixer()->framesPerPeriod();
+	const f_cnt_t slotFrames = channelSlotFrames();
+	const f_cnt_t inputOffset = ( fpp + 7 ) & ~7;
+	sampleFrame * slot = m_channelBuffers;
+	const auto assign = [&]( FxChannel * ch )
+	{
+		ch->m_buffer = slot;
+		ch->m_inputs = slot + inputOffset;
+		BufferManager::clear( ch->m_buffer, fpp );
+		slot += slotFrames;
+	};
+
+	for( FxChannel * ch : m_fxChannels )
+	{
+		ch->m_buffer = NULL;
+	}
+	// an outdated schedule may still hold deleted channels
+	for( int l = 0; !m_scheduleOutdated && l < m_schedule.size(); ++l )
+	{
+		for( FxChannel * ch : m_schedule[l] )
+		{
+			assign( ch );
+		}
+	}
+	// muted channels and the ones created since
+	for( FxChannel * ch : m_fxChannels )
+	{
+		if( ch->m_buffer == NULL )
+		{
+			assign( ch );
+		}
+	}
+}
+
+
+
+
+void FxMixer::updateLatencies( const QVector<AudioPort *> & ports )
+{
+	// latencies rarely change, but checking them is cheap compared to
+	// what it takes to notice every change
+	for( FxChannel * ch : m_fxChannels )
+	{
+		ch->m_inputLatency = 0;
+		ch->m_latency = -1;
+	}
+	for( const AudioPort * port : ports )
+	{
+		if( port->nextFxChannel() < m_fxChannels.size() )
+		{
+			FxChannel * ch = m_fxChannels[port->nextFxChannel()];
+			ch->m_inputLatency = qMax( ch->m_inputLatency,
+							port->latency() );
+		}
+	}
+	for( FxChannel * ch : m_fxChannels )
+	{
+		outputLatency( ch );
+	}
+
+	// each input gets delayed by what's missing to the slowest one of its
+	// channel
+	for( AudioPort * port : ports )
+	{
+		if( port->nextFxChannel() < m_fxChannels.size() )
+		{
+			port->setCompensation( m_fxChannels[port->nextFxChannel()]->
+					m_inputLatency - port->latency() );
+		}
+	}
+	for( FxRoute * route : m_fxRoutes )
+	{
+		route->compensator()->setDelay( route->receiver()->m_inputLatency -
+						route->sender()->m_latency );
+	}
+}
+
+
+
+
+// m_inputLatency has to hold the latency of the ports of ch when calling this
+f_cnt_t FxMixer::outputLatency( FxChannel * ch )
+{
+	if( ch->m_latency < 0 )
+	{
+		for( const FxRoute * route : ch->m_receives )
+		{
+			ch->m_inputLatency = qMax( ch->m_inputLatency,
+						outputLatency( route->sender() ) );
+		}
+		// every stage after the first one puts out what it got a
+		// period before
+		ch->m_latency = ch->m_inputLatency +
+					ch->m_fxChain.latencyFrames() +
+					( ch->pipelineStages() - 1 ) *
+					Engine::mixer()->framesPerPeriod();
+	}
+	return ch->m_latency;
+}
+
+
+
+
+void FxMixer::prepareRenderGraph( const QVector<AudioPort *> & ports )
+{
 	for( FxChannel * ch : m_fxChannels )
 	{
 		ch->m_muted = ch->m_muteModel.value();
-		if( ch->m_muted ) // instantly "process" muted channels
+	}
+
+	// every audio port becomes an additional dependency of its channel
+	// unless its output has been rendered ahead already
+	for( const AudioPort * port : ports )
+	{
+		if( !port->renderedAhead() &&
+			port->nextFxChannel() < m_fxChannels.size() )
+		{
+			++m_fxChannels[port->nextFxChannel()]->m_portInputs;
+		}
+	}
+
+	// same as in masterMix() - channels without any input and muted
+	// channels can be handled right away
+	for( FxChannel * ch : m_fxChannels )
+	{
+		if( ch->m_muted )
 		{
 			ch->processed();
 			ch->done();
 		}
-		else if( ch->m_receives.size() == 0 )
+		else if( ch->m_receives.size() + ch->m_sidechainSources.size() +
+							ch->m_portInputs == 0 )
 		{
 			ch->m_queued = true;
 			MixerWorkerThread::addJob( ch );
 		}
 	}
-	while (m_fxChannels[0]->state() != ThreadableJob::ProcessingState::Done)
+}
+
+
+
+
+void FxMixer::queuePipelineStages()
+{
+	for( FxChannel * ch : m_fxChannels )
 	{
-		bool found = false;
-		for( FxChannel * ch : m_fxChannels )
-		{
-			const auto s = ch->state();
-			if (s == ThreadableJob::ProcessingState::Queued
-				|| s == ThreadableJob::ProcessingState::InProgress)
-			{
-				found = true;
-				break;
-			}
-		}
-		if( !found )
+		// muted channels don't get processed, neither do their stages
+		if( ch->pipelineStages() > 1 && !ch->m_muteModel.value() )
 		{
-			break;
+			ch->queuePipeline();
 		}
-		MixerWorkerThread::startAndWaitForJobs();
 	}
+}
+
+
+
+
+void FxMixer::finishMasterMix( sampleFrame * _buf )
+{
+	TraceRecorder::Zone zone( "FxMixer::finishMasterMix" );
+
+	const int fpp = Engine::mixer()->framesPerPeriod();
 
 	// handle sample-exact data in master volume fader
 	ValueBuffer * volBuf = m_fxChannels[0]->m_volumeModel.valueBuffer();
@@ -663,17 +1412,33 @@ void FxMixer::masterMix( sampleFrame * _buf )
 		: m_fxChannels[0]->m_volumeModel.value();
 	MixHelpers::addSanitizedMultiplied( _buf, m_fxChannels[0]->m_buffer, v, fpp );
 
-	// clear all channel buffers and
+	// clear all channel buffers which have been written to and
 	// reset channel process state
 	for( int i = 0; i < numChannels(); ++i)
 	{
-		BufferManager::clear( m_fxChannels[i]->m_buffer,
-				Engine::mixer()->framesPerPeriod() );
+		if( m_fxChannels[i]->m_hasInput || m_fxChannels[i]->m_bufferDirty )
+		{
+			BufferManager::clear( m_fxChannels[i]->m_buffer,
+					Engine::mixer()->framesPerPeriod() );
+		}
+		m_fxChannels[i]->m_bufferDirty = false;
+		// muted channels weren't processed, so drop what they were sent
+		std::fill( m_fxChannels[i]->m_inputUsed,
+				m_fxChannels[i]->m_inputUsed +
+					m_fxChannels[i]->m_inputSlots, false );
 		m_fxChannels[i]->reset();
+		m_fxChannels[i]->resetPipeline();
 		m_fxChannels[i]->m_queued = false;
 		// also reset hasInput
 		m_fxChannels[i]->m_hasInput = false;
 		m_fxChannels[i]->m_dependenciesMet = 0;
+		m_fxChannels[i]->m_portInputs = 0;
+	}
+
+	// all buffers are clear now
+	if( m_bufferLayoutOutdated )
+	{
+		layoutChannelBuffers();
 	}
 }
 
@@ -699,10 +1464,13 @@ void FxMixer::clearChannel(fx_ch_t index)
 	ch->m_volumeModel.setValue( 1.0f );
 	ch->m_muteModel.setValue( false );
 	ch->m_soloModel.setValue( false );
+	ch->m_pipelineStagesModel.setValue( 1 );
 	ch->m_name = ( index == 0 ) ? tr( "Master" ) : tr( "FX %1" ).arg( index );
 	ch->m_volumeModel.setDisplayName( ch->m_name + ">" + tr( "Volume" ) );
 	ch->m_muteModel.setDisplayName( ch->m_name + ">" + tr( "Mute" ) );
 	ch->m_soloModel.setDisplayName( ch->m_name + ">" + tr( "Solo" ) );
+	ch->m_pipelineStagesModel.setDisplayName( ch->m_name + ">" +
+						tr( "Pipeline stages" ) );
 
 	// send only to master
 	if( index > 0)
@@ -722,6 +1490,9 @@ void FxMixer::clearChannel(fx_ch_t index)
 	{
 		deleteChannelSend( ch->m_receives.first() );
 	}
+
+	// clearing the chain doesn't tell
+	updateSidechains();
 }
 
 void FxMixer::saveSettings( QDomDocument & _doc, QDomElement & _this )
@@ -738,6 +1509,7 @@ void FxMixer::saveSettings( QDomDocument & _doc, QDomElement & _this )
 		ch->m_volumeModel.saveSettings( _doc, fxch, "volume" );
 		ch->m_muteModel.saveSettings( _doc, fxch, "muted" );
 		ch->m_soloModel.saveSettings( _doc, fxch, "soloed" );
+		ch->m_pipelineStagesModel.saveSettings( _doc, fxch, "pipeline" );
 		fxch.setAttribute( "num", i );
 		fxch.setAttribute( "name", ch->m_name );
 
@@ -784,6 +1556,7 @@ void FxMixer::loadSettings( const QDomElement & _this )
 		m_fxChannels[num]->m_volumeModel.loadSettings( fxch, "volume" );
 		m_fxChannels[num]->m_muteModel.loadSettings( fxch, "muted" );
 		m_fxChannels[num]->m_soloModel.loadSettings( fxch, "soloed" );
+		m_fxChannels[num]->m_pipelineStagesModel.loadSettings( fxch, "pipeline" );
 		m_fxChannels[num]->m_name = fxch.attribute( "name" );
 
 		m_fxChannels[num]->m_fxChain.restoreState( fxch.firstChildElement(
@@ -808,6 +1581,9 @@ void FxMixer::loadSettings( const QDomElement & _this )
 		node = node.nextSibling();
 	}
 
+	// sources of effects loaded before their channel
+	updateSidechains();
+
 	emit dataChanged();
 }
 
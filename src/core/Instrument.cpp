@@ -42,6 +42,18 @@ void Instrument::play( sampleFrame * )
 
 
 
+void Instrument::renderVoices( NotePlayHandle * const * _notes,
+				sampleFrame * const * _working_bufs, int _count )
+{
+	for( int i = 0; i < _count; ++i )
+	{
+		playNote( _notes[i], _working_bufs[i] );
+	}
+}
+
+
+
+
 void Instrument::deleteNotePluginData( NotePlayHandle * )
 {
 }
@@ -326,6 +326,16 @@ InstrumentFunctionArpeggio::InstrumentFunctionArpeggio( Model * _parent ) :
 	m_arpModeModel.addItem( tr( "Free" ), make_unique<PixmapLoader>( "arp_free" ) );
 	m_arpModeModel.addItem( tr( "Sort" ), make_unique<PixmapLoader>( "arp_sort" ) );
 	m_arpModeModel.addItem( tr( "Sync" ), make_unique<PixmapLoader>( "arp_sync" ) );
+
+	updateSchedule();
+	connect( &m_arpModel, SIGNAL( dataChanged() ),
+			this, SLOT( updateSchedule() ) );
+	connect( &m_arpRangeModel, SIGNAL( dataChanged() ),
+			this, SLOT( updateSchedule() ) );
+	connect( &m_arpCycleModel, SIGNAL( dataChanged() ),
+			this, SLOT( updateSchedule() ) );
+	connect( &m_arpDirectionModel, SIGNAL( dataChanged() ),
+			this, SLOT( updateSchedule() ) );
 }
 
 
@@ -354,17 +364,26 @@ void InstrumentFunctionArpeggio::processNote( NotePlayHandle * _n )
 
 	const int selected_arp = m_arpModel.value();
 
-	ConstNotePlayHandleList cnphv = NotePlayHandle::nphsOfInstrumentTrack( _n->instrumentTrack() );
+	// number of frames that every note should be played
+	const f_cnt_t arp_frames = (f_cnt_t)( m_arpTimeModel.value() / 1000.0f * Engine::mixer()->processingSampleRate() );
+	const f_cnt_t gated_frames = (f_cnt_t)( m_arpGateModel.value() * arp_frames / 100.0f );
 
-	if( m_arpModeModel.value() != FreeMode && cnphv.size() == 0 )
+	// the other notes of the track are only needed when the arpeggio is
+	// synced to them
+	ConstNotePlayHandleList cnphv;
+	if( m_arpModeModel.value() != FreeMode )
 	{
-		// maybe we're playing only a preset-preview-note?
-		cnphv = PresetPreviewPlayHandle::nphsOfInstrumentTrack( _n->instrumentTrack() );
+		cnphv = NotePlayHandle::nphsOfInstrumentTrack( _n->instrumentTrack() );
 		if( cnphv.size() == 0 )
 		{
-			// still nothing found here, so lets return
-			//return;
-			cnphv.push_back( _n );
+			// maybe we're playing only a preset-preview-note?
+			cnphv = PresetPreviewPlayHandle::nphsOfInstrumentTrack( _n->instrumentTrack() );
+			if( cnphv.size() == 0 )
+			{
+				// still nothing found here, so lets return
+				//return;
+				cnphv.push_back( _n );
+			}
 		}
 	}
 
@@ -373,10 +392,6 @@ void InstrumentFunctionArpeggio::processNote( NotePlayHandle * _n )
 	const int range = (int)( cur_chord_size * m_arpRangeModel.value() );
 	const int total_range = range * cnphv.size();
 
-	// number of frames that every note should be played
-	const f_cnt_t arp_frames = (f_cnt_t)( m_arpTimeModel.value() / 1000.0f * Engine::mixer()->processingSampleRate() );
-	const f_cnt_t gated_frames = (f_cnt_t)( m_arpGateModel.value() * arp_frames / 100.0f );
-
 	// used for calculating remaining frames for arp-note, we have to add
 	// arp_frames-1, otherwise the first arp-note will not be setup
 	// correctly... -> arp_frames frames silence at the start of every note!
@@ -386,6 +401,9 @@ void InstrumentFunctionArpeggio::processNote( NotePlayHandle * _n )
 	// used for loop
 	f_cnt_t frames_processed = ( m_arpModeModel.value() != FreeMode ) ? cnphv.first()->noteOffset() : _n->noteOffset();
 
+	// keys of the steps, the same for all notes until the settings change
+	const std::shared_ptr<const Schedule> schedule = std::atomic_load( &m_schedule );
+
 	while( frames_processed < Engine::mixer()->framesPerPeriod() )
 	{
 		const f_cnt_t remaining_frames_for_cur_arp = arp_frames - ( cur_frame % arp_frames );
@@ -421,74 +439,22 @@ void InstrumentFunctionArpeggio::processNote( NotePlayHandle * _n )
 			}
 		}
 
-		int dir = m_arpDirectionModel.value();
-
-		// Miss notes randomly. We intercept int dir and abuse it
-		// after need.  :)
-
-		if( m_arpMissModel.value() )
-		{
-			if( 100 * ( (float) rand() / (float)( RAND_MAX + 1.0f ) ) < m_arpMissModel.value() )
-			{
-				dir = ArpDirRandom;
-			}
-		}
+		// Miss notes randomly, by playing a random one instead
+		const bool missed = m_arpMissModel.value() &&
+			100 * ( (float) rand() / (float)( RAND_MAX + 1.0f ) ) < m_arpMissModel.value();
 
-		int cur_arp_idx = 0;
-		// process according to arpeggio-direction...
-		if( dir == ArpDirUp )
-		{
-			cur_arp_idx = ( cur_frame / arp_frames ) % range;
-		}
-		else if( dir == ArpDirDown )
-		{
-			cur_arp_idx = range - ( cur_frame / arp_frames ) %
-								range - 1;
-		}
-		else if( dir == ArpDirUpAndDown && range > 1 )
-		{
-			// imagine, we had to play the arp once up and then
-			// once down -> makes 2 * range possible notes...
-			// because we don't play the lower and upper notes
-			// twice, we have to subtract 2
-			cur_arp_idx = ( cur_frame / arp_frames ) % ( range * 2 - 2 );
-			// if greater than range, we have to play down...
-			// looks like the code for arp_dir==DOWN... :)
-			if( cur_arp_idx >= range )
-			{
-				cur_arp_idx = range - cur_arp_idx % ( range - 1 ) - 1;
-			}
-		}
-		else if( dir == ArpDirDownAndUp && range > 1 )
-		{
-			// copied from ArpDirUpAndDown above
-			cur_arp_idx = ( cur_frame / arp_frames ) % ( range * 2 - 2 );
-			// if greater than range, we have to play down...
-			// looks like the code for arp_dir==DOWN... :)
-			if( cur_arp_idx >= range )
-			{
-				cur_arp_idx = range - cur_arp_idx % ( range - 1 ) - 1;
-			}
-			// inverts direction
-			cur_arp_idx = range - cur_arp_idx - 1;
-		}
-		else if( dir == ArpDirRandom )
+		int sub_note_key = base_note_key;
+		if( missed || schedule->empty() )
 		{
 			// just pick a random chord-index
-			cur_arp_idx = (int)( range * ( (float) rand() / (float) RAND_MAX ) );
+			sub_note_key += chordKey( selected_arp,
+				(int)( range * ( (float) rand() / (float) RAND_MAX ) ) );
 		}
-
-		// Cycle notes
-		if( m_arpCycleModel.value() && dir != ArpDirRandom )
+		else
 		{
-			cur_arp_idx *= m_arpCycleModel.value() + 1;
-			cur_arp_idx %= range;
+			sub_note_key += ( *schedule )[( cur_frame / arp_frames ) % schedule->size()];
 		}
 
-		// now calculate final key for our arp-note
-		const int sub_note_key = base_note_key + (cur_arp_idx / cur_chord_size ) *
-							KeysPerOctave + chord_table[selected_arp][cur_arp_idx % cur_chord_size];
-
 		// range-checking
 		if( sub_note_key >= NumKeys ||
 			sub_note_key < 0 ||
@@ -519,6 +485,77 @@ void InstrumentFunctionArpeggio::processNote( NotePlayHandle * _n )
 
 
 
+void InstrumentFunctionArpeggio::updateSchedule()
+{
+	const int selected_arp = m_arpModel.value();
+	const int dir = m_arpDirectionModel.value();
+	const int cycle = m_arpCycleModel.value();
+	const InstrumentFunctionNoteStacking::ChordTable & chord_table = InstrumentFunctionNoteStacking::ChordTable::getInstance();
+	const int range = (int)( chord_table[selected_arp].size() * m_arpRangeModel.value() );
+
+	Schedule * schedule = new Schedule;
+	if( dir != ArpDirRandom && range > 0 )
+	{
+		// imagine, we had to play the arp once up and then once down
+		// -> makes 2 * range possible notes... because we don't play
+		// the lower and upper notes twice, we have to subtract 2
+		const bool upAndDown = dir == ArpDirUpAndDown || dir == ArpDirDownAndUp;
+		const int steps = upAndDown && range > 1 ? range * 2 - 2 : range;
+		for( int step = 0; step < steps; ++step )
+		{
+			int cur_arp_idx = 0;
+			// process according to arpeggio-direction...
+			if( dir == ArpDirUp )
+			{
+				cur_arp_idx = step;
+			}
+			else if( dir == ArpDirDown )
+			{
+				cur_arp_idx = range - step - 1;
+			}
+			else if( range > 1 )
+			{
+				cur_arp_idx = step;
+				// if greater than range, we have to play down...
+				if( cur_arp_idx >= range )
+				{
+					cur_arp_idx = range - cur_arp_idx % ( range - 1 ) - 1;
+				}
+				if( dir == ArpDirDownAndUp )
+				{
+					// inverts direction
+					cur_arp_idx = range - cur_arp_idx - 1;
+				}
+			}
+
+			// Cycle notes
+			if( cycle )
+			{
+				cur_arp_idx *= cycle + 1;
+				cur_arp_idx %= range;
+			}
+
+			schedule->push_back( chordKey( selected_arp, cur_arp_idx ) );
+		}
+	}
+
+	std::atomic_store( &m_schedule, std::shared_ptr<const Schedule>( schedule ) );
+}
+
+
+
+
+int InstrumentFunctionArpeggio::chordKey( int _chord, int _index )
+{
+	const InstrumentFunctionNoteStacking::Chord & chord =
+		InstrumentFunctionNoteStacking::ChordTable::getInstance()[_chord];
+	return ( _index / chord.size() ) * KeysPerOctave +
+						chord[_index % chord.size()];
+}
+
+
+
+
 void InstrumentFunctionArpeggio::saveSettings( QDomDocument & _doc, QDomElement & _this )
 {
 	m_arpEnabledModel.saveSettings( _doc, _this, "arp-enabled" );
@@ -25,10 +25,57 @@
 
 #include "InstrumentPlayHandle.h"
 #include "InstrumentTrack.h"
+#include "ScratchArena.h"
 
 InstrumentPlayHandle::InstrumentPlayHandle( Instrument * instrument, InstrumentTrack* instrumentTrack ) :
 		PlayHandle( TypeInstrumentPlayHandle ),
 		m_instrument( instrument )
 {
 	setAudioPort( instrumentTrack->audioPort() );
+
+	// batched instruments render into the buffers of their notes
+	if( instrument->flags().testFlag( Instrument::RendersVoicesBatched ) )
+	{
+		setUsesBuffer( false );
+	}
+}
+
+
+
+
+bool InstrumentPlayHandle::isBypassed() const
+{
+	return m_instrument->instrumentTrack()->isPlayingFrozen();
+}
+
+
+
+
+void InstrumentPlayHandle::renderVoices( const ConstNotePlayHandleList& nphv )
+{
+	ScratchBuffer<NotePlayHandle *> notes( nphv.size() );
+	ScratchBuffer<sampleFrame *> buffers( nphv.size() );
+	int count = 0;
+	for( const NotePlayHandle * constNotePlayHandle : nphv )
+	{
+		NotePlayHandle * notePlayHandle = const_cast<NotePlayHandle *>( constNotePlayHandle );
+		if( notePlayHandle->isRenderPending() )
+		{
+			notes[count] = notePlayHandle;
+			buffers[count] = notePlayHandle->pendingBuffer();
+			++count;
+		}
+	}
+
+	if( count == 0 )
+	{
+		return;
+	}
+
+	m_instrument->renderVoices( notes.data(), buffers.data(), count );
+
+	for( int i = 0; i < count; ++i )
+	{
+		notes[i]->finishPendingRender();
+	}
 }
@@ -22,7 +22,6 @@
  *
  */
 
-#include <QtCore/QVarLengthArray>
 #include <QDomElement>
 
 #include "InstrumentSoundShaping.h"
@@ -33,12 +32,15 @@
 #include "Instrument.h"
 #include "InstrumentTrack.h"
 #include "Mixer.h"
+#include "ScratchArena.h"
 #include "stdshims.h"
 
 
 const float CUT_FREQ_MULTIPLIER = 6000.0f;
 const float RES_MULTIPLIER = 2.0f;
 const float RES_PRECISION = 1000.0f;
+// with fast filter modulation, the coefficients are updated this often only
+const fpp_t FAST_MODULATION_FRAMES = 16;
 
 
 // names for env- and lfo-targets - first is name being displayed to user
@@ -64,7 +66,8 @@ InstrumentSoundShaping::InstrumentSoundShaping(
 	m_filterEnabledModel( false, this ),
 	m_filterModel( this, tr( "Filter type" ) ),
 	m_filterCutModel( 14000.0, 1.0, 14000.0, 1.0, this, tr( "Cutoff frequency" ) ),
-	m_filterResModel( 0.5, BasicFilters<>::minQ(), 10.0, 0.01, this, tr( "Q/Resonance" ) )
+	m_filterResModel( 0.5, BasicFilters<>::minQ(), 10.0, 0.01, this, tr( "Q/Resonance" ) ),
+	m_fastFilterModulationModel( false, this, tr( "Fast filter modulation" ) )
 {
 	for( int i = 0; i < NumTargets; ++i )
 	{
@@ -132,6 +135,21 @@ float InstrumentSoundShaping::volumeLevel( NotePlayHandle* n, const f_cnt_t fram
 
 
 
+bool InstrumentSoundShaping::usesLfo() const
+{
+	for( int i = 0; i < NumTargets; ++i )
+	{
+		if( m_envLfoParameters[i]->usesLfo() )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+
+
 void InstrumentSoundShaping::processAudioBuffer( sampleFrame* buffer,
 							const fpp_t frames,
 							NotePlayHandle* n )
@@ -145,18 +163,12 @@ void InstrumentSoundShaping::processAudioBuffer( sampleFrame* buffer,
 		envReleaseBegin += frames;
 	}
 
-	// because of optimizations, there's special code for several cases:
-	// 	- cut- and res-lfo/envelope active
-	// 	- cut-lfo/envelope active
-	// 	- res-lfo/envelope active
-	//	- no lfo/envelope active but filter is used
-
 	// only use filter, if it is really needed
 
 	if( m_filterEnabledModel.value() )
 	{
-		QVarLengthArray<float> cutBuffer(frames);
-		QVarLengthArray<float> resBuffer(frames);
+		ScratchBuffer<float> cutBuffer(frames);
+		ScratchBuffer<float> resBuffer(frames);
 
 		int old_filter_cut = 0;
 		int old_filter_res = 0;
@@ -179,76 +191,52 @@ void InstrumentSoundShaping::processAudioBuffer( sampleFrame* buffer,
 		const float fcv = m_filterCutModel.value();
 		const float frv = m_filterResModel.value();
 
-		if( m_envLfoParameters[Cut]->isUsed() &&
-			m_envLfoParameters[Resonance]->isUsed() )
+		const bool cutUsed = m_envLfoParameters[Cut]->isUsed();
+		const bool resUsed = m_envLfoParameters[Resonance]->isUsed();
+
+		if( cutUsed || resUsed )
 		{
-			for( fpp_t frame = 0; frame < frames; ++frame )
+			// the coefficients only change when the integer part of the
+			// cutoff or the resonance in RES_PRECISION steps does, the frames
+			// in between are filtered as one block - with fast modulation
+			// changes are only looked for at the start of sub-blocks, which
+			// saves most calcFilterCoeffs() calls at the cost of a steppier
+			// modulation
+			const fpp_t step = m_fastFilterModulationModel.value() ?
+						FAST_MODULATION_FRAMES : 1;
+			fpp_t blockStart = 0;
+			for( fpp_t frame = 0; frame < frames; frame += step )
 			{
-				const float new_cut_val = EnvelopeAndLfoParameters::expKnobVal( cutBuffer[frame] ) *
-								CUT_FREQ_MULTIPLIER + fcv;
+				const float new_cut_val = cutUsed ?
+					EnvelopeAndLfoParameters::expKnobVal( cutBuffer[frame] ) *
+								CUT_FREQ_MULTIPLIER + fcv : fcv;
 
-				const float new_res_val = frv + RES_MULTIPLIER * resBuffer[frame];
+				const float new_res_val = resUsed ?
+					frv + RES_MULTIPLIER * resBuffer[frame] : frv;
 
-				if( static_cast<int>( new_cut_val ) != old_filter_cut ||
-					static_cast<int>( new_res_val*RES_PRECISION ) != old_filter_res )
+				if( ( cutUsed && static_cast<int>( new_cut_val ) != old_filter_cut ) ||
+					( resUsed && static_cast<int>( new_res_val*RES_PRECISION ) != old_filter_res ) )
 				{
-					n->m_filter->calcFilterCoeffs( new_cut_val, new_res_val );
-					old_filter_cut = static_cast<int>( new_cut_val );
-					old_filter_res = static_cast<int>( new_res_val*RES_PRECISION );
-				}
-
-				buffer[frame][0] = n->m_filter->update( buffer[frame][0], 0 );
-				buffer[frame][1] = n->m_filter->update( buffer[frame][1], 1 );
-			}
-		}
-		else if( m_envLfoParameters[Cut]->isUsed() )
-		{
-			for( fpp_t frame = 0; frame < frames; ++frame )
-			{
-				float new_cut_val = EnvelopeAndLfoParameters::expKnobVal( cutBuffer[frame] ) *
-								CUT_FREQ_MULTIPLIER + fcv;
+					n->m_filter->processBlock( buffer + blockStart, frame - blockStart );
+					blockStart = frame;
 
-				if( static_cast<int>( new_cut_val ) != old_filter_cut )
-				{
-					n->m_filter->calcFilterCoeffs( new_cut_val, frv );
+					n->m_filter->calcFilterCoeffs( new_cut_val, new_res_val );
 					old_filter_cut = static_cast<int>( new_cut_val );
-				}
-
-				buffer[frame][0] = n->m_filter->update( buffer[frame][0], 0 );
-				buffer[frame][1] = n->m_filter->update( buffer[frame][1], 1 );
-			}
-		}
-		else if( m_envLfoParameters[Resonance]->isUsed() )
-		{
-			for( fpp_t frame = 0; frame < frames; ++frame )
-			{
-				float new_res_val = frv + RES_MULTIPLIER * resBuffer[frame];
-
-				if( static_cast<int>( new_res_val*RES_PRECISION ) != old_filter_res )
-				{
-					n->m_filter->calcFilterCoeffs( fcv, new_res_val );
 					old_filter_res = static_cast<int>( new_res_val*RES_PRECISION );
 				}
-
-				buffer[frame][0] = n->m_filter->update( buffer[frame][0], 0 );
-				buffer[frame][1] = n->m_filter->update( buffer[frame][1], 1 );
 			}
+			n->m_filter->processBlock( buffer + blockStart, frames - blockStart );
 		}
 		else
 		{
 			n->m_filter->calcFilterCoeffs( fcv, frv );
-
-			for( fpp_t frame = 0; frame < frames; ++frame )
-			{
-				buffer[frame][0] = n->m_filter->update( buffer[frame][0], 0 );
-				buffer[frame][1] = n->m_filter->update( buffer[frame][1], 1 );
-			}
+			n->m_filter->processBlock( buffer, frames );
 		}
 	}
 
 	if( m_envLfoParameters[Volume]->isUsed() )
 	{
-		QVarLengthArray<float> volBuffer(frames);
+		ScratchBuffer<float> volBuffer(frames);
 		m_envLfoParameters[Volume]->fillLevel( volBuffer.data(), envTotalFrames, envReleaseBegin, frames );
 
 		for( fpp_t frame = 0; frame < frames; ++frame )
@@ -337,6 +325,7 @@ void InstrumentSoundShaping::saveSettings( QDomDocument & _doc, QDomElement & _t
 	m_filterCutModel.saveSettings( _doc, _this, "fcut" );
 	m_filterResModel.saveSettings( _doc, _this, "fres" );
 	m_filterEnabledModel.saveSettings( _doc, _this, "fwet" );
+	m_fastFilterModulationModel.saveSettings( _doc, _this, "ffastmod" );
 
 	for( int i = 0; i < NumTargets; ++i )
 	{
@@ -355,6 +344,7 @@ void InstrumentSoundShaping::loadSettings( const QDomElement & _this )
 	m_filterCutModel.loadSettings( _this, "fcut" );
 	m_filterResModel.loadSettings( _this, "fres" );
 	m_filterEnabledModel.loadSettings( _this, "fwet" );
+	m_fastFilterModulationModel.loadSettings( _this, "ffastmod" );
 
 	QDomNode node = _this.firstChild();
 	while( !node.isNull() )
@@ -0,0 +1,180 @@
+/*
+ * JobBatcher.cpp - queues cheap jobs of the mixer together
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "JobBatcher.h"
+
+#include "MixerWorkerThread.h"
+#include "ThreadableJob.h"
+
+
+class JobBatcher::Batch : public ThreadableJob
+{
+public:
+	// jobs without any history yet, e.g. new notes, are batched as
+	// well, so don't take too many of them at once
+	static const int MaxJobs = 16;
+
+	Batch() :
+		m_count( 0 ),
+		m_cost( 0.0f )
+	{
+	}
+
+	void clear()
+	{
+		m_count = 0;
+		m_cost = 0.0f;
+	}
+
+	bool isEmpty() const
+	{
+		return m_count == 0;
+	}
+
+	bool isFull( float _budget ) const
+	{
+		return m_count == MaxJobs || m_cost >= _budget;
+	}
+
+	//! Take _job, returns false if it doesn't require processing
+	bool add( ThreadableJob * _job )
+	{
+		if( !_job->requiresProcessing() )
+		{
+			return false;
+		}
+		_job->queue();
+		m_jobs[m_count++] = _job;
+		m_cost += _job->cpuUsage().average();
+		return true;
+	}
+
+	bool requiresProcessing() const override
+	{
+		return m_count > 0;
+	}
+
+
+protected:
+	void doProcessing() override
+	{
+		for( int i = 0; i < m_count; ++i )
+		{
+			m_jobs[i]->process( true );
+		}
+	}
+
+	// the jobs account for the time they took themselves
+	void accountProcessingTime( int ) override
+	{
+	}
+
+	const char * traceName() const override
+	{
+		return "JobBatcher::Batch";
+	}
+
+
+private:
+	ThreadableJob * m_jobs[MaxJobs];
+	int m_count;
+	float m_cost;
+
+} ;
+
+
+
+
+JobBatcher::JobBatcher() :
+	m_usedBatches( 0 ),
+	m_budget( 0.0f )
+{
+	m_batches.reserve( MaxBatches );
+	for( int i = 0; i < MaxBatches; ++i )
+	{
+		m_batches.push_back( new Batch );
+	}
+}
+
+
+
+
+JobBatcher::~JobBatcher()
+{
+	for( Batch * batch : m_batches )
+	{
+		delete batch;
+	}
+}
+
+
+
+
+void JobBatcher::reset( float _budget )
+{
+	m_usedBatches = 0;
+	m_budget = _budget;
+	m_batches.front()->clear();
+}
+
+
+
+
+bool JobBatcher::addJob( ThreadableJob * _job )
+{
+	if( _job->cpuUsage().average() >= m_budget ||
+					m_usedBatches == MaxBatches )
+	{
+		return MixerWorkerThread::addJob( _job );
+	}
+
+	Batch * batch = m_batches[m_usedBatches];
+	if( !batch->add( _job ) )
+	{
+		return false;
+	}
+	if( batch->isFull( m_budget ) )
+	{
+		flush();
+	}
+	return true;
+}
+
+
+
+
+void JobBatcher::flush()
+{
+	if( m_usedBatches == MaxBatches ||
+				m_batches[m_usedBatches]->isEmpty() )
+	{
+		return;
+	}
+
+	// there are worker threads whenever there's a budget, so the queue
+	// takes the batch
+	MixerWorkerThread::addJob( m_batches[m_usedBatches] );
+	if( ++m_usedBatches < MaxBatches )
+	{
+		m_batches[m_usedBatches]->clear();
+	}
+}
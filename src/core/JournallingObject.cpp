@@ -55,6 +55,7 @@ JournallingObject::~JournallingObject()
 
 void JournallingObject::addJournalCheckPoint()
 {
+	Engine::projectJournal()->objectChanged( id() );
 	if( isJournalling() )
 	{
 		Engine::projectJournal()->addJournalCheckPoint( this );
@@ -25,9 +25,12 @@
  */
 
 #include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
 #include <QDebug>
 #include <QDir>
 #include <QLibrary>
+#include <QSaveFile>
 
 #include <math.h>
 
@@ -36,6 +39,10 @@
 #include "PluginFactory.h"
 
 
+// bumped whenever what's kept of a plug-in changes
+static const char * ScanCacheHeader = "lmms-ladspa-cache 1";
+
+
 
 LadspaManager::LadspaManager()
 {
@@ -56,6 +63,12 @@ LadspaManager::LadspaManager()
 	ladspaDirectories.push_back( "/Library/Audio/Plug-Ins/LADSPA" );
 #endif
 
+	// libraries which didn't change since they were scanned last time
+	// aren't loaded before one of their plug-ins is used
+	const QHash<QString, CachedLibrary> cache = readScanCache();
+	QHash<QString, CachedLibrary> scanned;
+	bool cacheChanged = false;
+
 	for( QStringList::iterator it = ladspaDirectories.begin(); 
 			 		   it != ladspaDirectories.end(); ++it )
 	{
@@ -77,7 +90,26 @@ LadspaManager::LadspaManager()
 				continue;
 			}
 
-			QLibrary plugin_lib( f.absoluteFilePath() );
+			const QString path = f.absoluteFilePath();
+			if( scanned.contains( path ) )
+			{
+				continue;
+			}
+
+			const qint64 modified =
+				f.lastModified().toMSecsSinceEpoch();
+			QHash<QString, CachedLibrary>::const_iterator cached =
+							cache.find( path );
+			if( cached != cache.end() && cached->size == f.size() &&
+						cached->modified == modified )
+			{
+				addCachedPlugins( *cached, f.fileName() );
+				scanned.insert( path, *cached );
+				continue;
+			}
+			cacheChanged = true;
+
+			QLibrary plugin_lib( path );
 
 			if( plugin_lib.load() == true )
 			{
@@ -87,8 +119,23 @@ LadspaManager::LadspaManager()
 				if( descriptorFunction != NULL )
 				{
 					addPlugins( descriptorFunction,
-							f.fileName() );
+							f.fileName(), path );
+				}
+
+				CachedLibrary library = { f.size(), modified,
+						QList<QPair<QString,
+						ladspaManagerDescription> >() };
+				for( ladspaManagerMapType::const_iterator p =
+						m_ladspaManagerMap.begin();
+					p != m_ladspaManagerMap.end(); ++p )
+				{
+					if( p.value()->library == path )
+					{
+						library.plugins.push_back( qMakePair(
+							p.key().second, *p.value() ) );
+					}
 				}
+				scanned.insert( path, library );
 			}
 			else
 			{
@@ -96,6 +143,11 @@ LadspaManager::LadspaManager()
 			}
 		}
 	}
+
+	if( cacheChanged || scanned.size() != cache.size() )
+	{
+		writeScanCache( scanned );
+	}
 	
 	l_ladspa_key_t keys = m_ladspaManagerMap.keys();
 	for( l_ladspa_key_t::iterator it = keys.begin();
@@ -137,9 +189,171 @@ ladspaManagerDescription * LadspaManager::getDescription(
 
 
 
+QString LadspaManager::scanCacheFile()
+{
+	return QFileInfo( ConfigManager::inst()->configFile() ).absolutePath() +
+						"/.lmms-ladspa.cache";
+}
+
+
+
+
+QHash<QString, LadspaManager::CachedLibrary> LadspaManager::readScanCache() const
+{
+	QHash<QString, CachedLibrary> cache;
+
+	QFile file( scanCacheFile() );
+	if( !file.open( QIODevice::ReadOnly ) )
+	{
+		return cache;
+	}
+
+	QDataStream in( &file );
+	in.setVersion( QDataStream::Qt_5_0 );
+	QString header;
+	in >> header;
+	if( header != ScanCacheHeader )
+	{
+		return cache;
+	}
+
+	while( !in.atEnd() )
+	{
+		QString path;
+		CachedLibrary library;
+		qint32 count;
+		in >> path >> library.size >> library.modified >> count;
+		for( qint32 i = 0; i < count && in.status() == QDataStream::Ok;
+									++i )
+		{
+			QString label;
+			ladspaManagerDescription plugin;
+			quint32 index;
+			qint32 type, properties;
+			in >> label >> index >> type >> plugin.inputChannels >>
+				plugin.outputChannels >> plugin.name >> properties;
+			plugin.descriptorFunction = NULL;
+			plugin.index = index;
+			plugin.type = static_cast<ladspaPluginType>( type );
+			plugin.library = path;
+			plugin.properties = properties;
+			library.plugins.push_back( qMakePair( label, plugin ) );
+		}
+		if( in.status() != QDataStream::Ok )
+		{
+			// the rest gets scanned again
+			break;
+		}
+		cache.insert( path, library );
+	}
+	return cache;
+}
+
+
+
+
+void LadspaManager::writeScanCache(
+			const QHash<QString, CachedLibrary> & _cache ) const
+{
+	QSaveFile file( scanCacheFile() );
+	if( !file.open( QIODevice::WriteOnly ) )
+	{
+		return;
+	}
+
+	QDataStream out( &file );
+	out.setVersion( QDataStream::Qt_5_0 );
+	out << QString( ScanCacheHeader );
+	for( QHash<QString, CachedLibrary>::const_iterator it = _cache.begin();
+						it != _cache.end(); ++it )
+	{
+		out << it.key() << it->size << it->modified <<
+					qint32( it->plugins.size() );
+		for( const QPair<QString, ladspaManagerDescription> & plugin :
+								it->plugins )
+		{
+			out << plugin.first << quint32( plugin.second.index ) <<
+				qint32( plugin.second.type ) <<
+				plugin.second.inputChannels <<
+				plugin.second.outputChannels <<
+				plugin.second.name <<
+				qint32( plugin.second.properties );
+		}
+	}
+	if( !file.commit() )
+	{
+		qWarning() << "Could not write the LADSPA scan cache" <<
+							file.fileName();
+	}
+}
+
+
+
+
+void LadspaManager::addCachedPlugins( const CachedLibrary & _library,
+						const QString & _file )
+{
+	for( const QPair<QString, ladspaManagerDescription> & plugin :
+							_library.plugins )
+	{
+		ladspa_key_t key( _file, plugin.first );
+		if( !m_ladspaManagerMap.contains( key ) )
+		{
+			m_ladspaManagerMap[key] =
+				new ladspaManagerDescription( plugin.second );
+		}
+	}
+}
+
+
+
+
+bool LadspaManager::resolve( ladspaManagerDescription * _description,
+						const QString & _label )
+{
+	if( _description->descriptorFunction != NULL )
+	{
+		return true;
+	}
+
+	QLibrary plugin_lib( _description->library );
+	LADSPA_Descriptor_Function descriptorFunction = plugin_lib.load() ?
+		( LADSPA_Descriptor_Function ) plugin_lib.resolve(
+						"ladspa_descriptor" ) : NULL;
+	if( descriptorFunction == NULL )
+	{
+		qWarning() << plugin_lib.errorString();
+		return false;
+	}
+
+	// all plug-ins of the library can be used from now on
+	for( ladspaManagerMapType::iterator it = m_ladspaManagerMap.begin();
+					it != m_ladspaManagerMap.end(); ++it )
+	{
+		if( it.value()->library == _description->library )
+		{
+			it.value()->descriptorFunction = descriptorFunction;
+		}
+	}
+
+	// the index is only trusted as long as the label matches
+	const LADSPA_Descriptor * descriptor =
+			descriptorFunction( _description->index );
+	if( descriptor == NULL || _label != descriptor->Label )
+	{
+		_description->descriptorFunction = NULL;
+		return false;
+	}
+	return true;
+}
+
+
+
+
 void LadspaManager::addPlugins(
 		LADSPA_Descriptor_Function _descriptor_func,
-						const QString & _file )
+						const QString & _file,
+						const QString & _library )
 {
 	const LADSPA_Descriptor * descriptor;
 
@@ -159,6 +373,9 @@ void LadspaManager::addPlugins(
 		plugIn->index = pluginIndex;
 		plugIn->inputChannels = getPluginInputs( descriptor );
 		plugIn->outputChannels = getPluginOutputs( descriptor );
+		plugIn->library = _library;
+		plugIn->name = descriptor->Name;
+		plugIn->properties = descriptor->Properties;
 
 		if( plugIn->inputChannels == 0 && plugIn->outputChannels > 0 )
 		{
@@ -278,9 +495,10 @@ QString LadspaManager::getLabel( const ladspa_key_t & _plugin )
 bool LadspaManager::hasRealTimeDependency(
 					const ladspa_key_t &  _plugin )
 {
-	const LADSPA_Descriptor * descriptor = getDescriptor( _plugin );
-	return( descriptor ? LADSPA_IS_REALTIME( descriptor->Properties )
-					   : false );
+	const ladspaManagerDescription * description =
+						getDescription( _plugin );
+	return( description ? LADSPA_IS_REALTIME( description->properties )
+						: false );
 }
 
 
@@ -288,9 +506,10 @@ bool LadspaManager::hasRealTimeDependency(
 
 bool LadspaManager::isInplaceBroken( const ladspa_key_t &  _plugin )
 {
-	const LADSPA_Descriptor * descriptor = getDescriptor( _plugin );
-	return( descriptor ? LADSPA_IS_INPLACE_BROKEN( descriptor->Properties )
-					   : false );
+	const ladspaManagerDescription * description =
+						getDescription( _plugin );
+	return( description ? LADSPA_IS_INPLACE_BROKEN( description->properties )
+						: false );
 }
 
 
@@ -299,9 +518,10 @@ bool LadspaManager::isInplaceBroken( const ladspa_key_t &  _plugin )
 bool LadspaManager::isRealTimeCapable(
 					const ladspa_key_t &  _plugin )
 {
-	const LADSPA_Descriptor * descriptor = getDescriptor( _plugin );
-	return( descriptor ? LADSPA_IS_HARD_RT_CAPABLE( descriptor->Properties )
-					   : false );
+	const ladspaManagerDescription * description =
+						getDescription( _plugin );
+	return( description ? LADSPA_IS_HARD_RT_CAPABLE( description->properties )
+						: false );
 }
 
 
@@ -309,8 +529,10 @@ bool LadspaManager::isRealTimeCapable(
 
 QString LadspaManager::getName( const ladspa_key_t & _plugin )
 {
-	const LADSPA_Descriptor * descriptor = getDescriptor( _plugin );
-	return( descriptor ? descriptor->Name : "" );
+	// known without loading the library
+	const ladspaManagerDescription * description =
+						getDescription( _plugin );
+	return( description ? description->name : "" );
 }
 
 
@@ -526,14 +748,9 @@ bool LadspaManager::isInteger( const ladspa_key_t & _plugin,
 
 bool LadspaManager::isEnum( const ladspa_key_t & _plugin, uint32_t _port )
 {
-	if( m_ladspaManagerMap.contains( _plugin )
-		   && _port < getPortCount( _plugin ) )
+	const LADSPA_Descriptor * descriptor = getDescriptor( _plugin );
+	if( descriptor && _port < getPortCount( _plugin ) )
 	{
-		LADSPA_Descriptor_Function descriptorFunction =
-			m_ladspaManagerMap[_plugin]->descriptorFunction;
-		const LADSPA_Descriptor * descriptor =
-				descriptorFunction(
-					m_ladspaManagerMap[_plugin]->index );
 		LADSPA_PortRangeHintDescriptor hintDescriptor =
 			descriptor->PortRangeHints[_port].HintDescriptor;
 		// This is an LMMS extension to ladspa
@@ -572,7 +789,8 @@ const void * LadspaManager::getImplementationData(
 const LADSPA_Descriptor * LadspaManager::getDescriptor(
 						const ladspa_key_t & _plugin )
 {
-	if( m_ladspaManagerMap.contains( _plugin ) )
+	if( m_ladspaManagerMap.contains( _plugin ) &&
+		resolve( m_ladspaManagerMap[_plugin], _plugin.second ) )
 	{
 		LADSPA_Descriptor_Function descriptorFunction =
 			m_ladspaManagerMap[_plugin]->descriptorFunction;
@@ -0,0 +1,98 @@
+/*
+ * LatencyCompensator.cpp - delays a path to line it up with slower ones
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "LatencyCompensator.h"
+
+#include "ScratchArena.h"
+
+
+LatencyCompensator::LatencyCompensator() :
+	m_delay( 0 ),
+	m_tail( 0 )
+{
+}
+
+
+
+
+void LatencyCompensator::setDelay( f_cnt_t frames )
+{
+	frames = qMax<f_cnt_t>( frames, 0 );
+	if( frames == m_delay )
+	{
+		return;
+	}
+
+	for( DelayLine & line : m_lines )
+	{
+		if( frames > line.maxDelay() )
+		{
+			line.setMaxDelay( frames );
+		}
+		else
+		{
+			line.clear();
+		}
+	}
+	m_delay = frames;
+	m_tail = 0;
+}
+
+
+
+
+void LatencyCompensator::process( sampleFrame * _buf, fpp_t _frames,
+								bool _silent )
+{
+	if( m_delay == 0 )
+	{
+		return;
+	}
+	if( !_silent )
+	{
+		m_tail = m_delay;
+	}
+	else if( m_tail > 0 )
+	{
+		m_tail -= _frames;
+	}
+	else
+	{
+		// the line only holds silence, which doesn't need to be moved
+		return;
+	}
+
+	ScratchBuffer<sample_t> channel( _frames );
+	for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+	{
+		for( fpp_t f = 0; f < _frames; ++f )
+		{
+			channel[f] = _buf[f][ch];
+		}
+		m_lines[ch].write( channel.data(), _frames );
+		m_lines[ch].read( channel.data(), m_delay, _frames );
+		for( fpp_t f = 0; f < _frames; ++f )
+		{
+			_buf[f][ch] = channel[f];
+		}
+	}
+}
@@ -0,0 +1,190 @@
+/*
+ * LevelDetector.cpp - block based level detection for dynamics effects
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "LevelDetector.h"
+
+#include <QtCore/QtGlobal>
+
+#include <algorithm>
+#include <cmath>
+
+
+LevelDetector::LevelDetector( float floor, float ceiling ) :
+	m_floor( floor ),
+	m_ceiling( ceiling ),
+	m_envelope( floor ),
+	m_attack( 1.0f ),
+	m_release( 1.0f ),
+	m_window( 1, 0.0f ),
+	m_windowPos( 0 ),
+	m_windowSum( 0.0 ),
+	m_delayPos( 0 )
+{
+}
+
+
+
+
+void LevelDetector::setRmsSize( int frames )
+{
+	m_window.assign( qMax( frames, 1 ), 0.0f );
+	m_windowPos = 0;
+	m_windowSum = 0.0;
+}
+
+
+
+
+void LevelDetector::setLookahead( int frames )
+{
+	m_delay.assign( qMax( frames, 0 ), 0.0f );
+	m_delayPos = 0;
+}
+
+
+
+
+void LevelDetector::reset()
+{
+	std::fill( m_window.begin(), m_window.end(), 0.0f );
+	std::fill( m_delay.begin(), m_delay.end(), 0.0f );
+	m_windowPos = 0;
+	m_windowSum = 0.0;
+	m_delayPos = 0;
+	m_envelope = m_floor;
+}
+
+
+
+
+void LevelDetector::process( sample_t * _buf, float * _levels, fpp_t _frames )
+{
+	for( fpp_t f = 0; f < _frames; ++f )
+	{
+		_levels[f] = _buf[f] * _buf[f];
+	}
+
+	if( !m_delay.empty() )
+	{
+		const int size = static_cast<int>( m_delay.size() );
+		for( fpp_t f = 0; f < _frames; ++f )
+		{
+			const sample_t in = _buf[f];
+			_buf[f] = m_delay[m_delayPos];
+			m_delay[m_delayPos] = in;
+			if( ++m_delayPos >= size )
+			{
+				m_delayPos = 0;
+			}
+		}
+	}
+
+	// moving average of the squares, a window of one keeps them
+	const int size = static_cast<int>( m_window.size() );
+	if( size > 1 )
+	{
+		const double scale = 1.0 / size;
+		for( fpp_t f = 0; f < _frames; ++f )
+		{
+			m_windowSum += _levels[f] - m_window[m_windowPos];
+			m_window[m_windowPos] = _levels[f];
+			if( ++m_windowPos >= size )
+			{
+				m_windowPos = 0;
+			}
+			_levels[f] = static_cast<float>( m_windowSum * scale );
+		}
+	}
+
+	for( fpp_t f = 0; f < _frames; ++f )
+	{
+		// rounding of the sum may leave it slightly below zero
+		_levels[f] = sqrtf( qMax( _levels[f], 0.0f ) );
+	}
+
+	float envelope = m_envelope;
+	for( fpp_t f = 0; f < _frames; ++f )
+	{
+		const float level = _levels[f];
+		if( level > envelope )
+		{
+			envelope = qMin( envelope * m_attack, level );
+		}
+		else if( level < envelope )
+		{
+			envelope = qMax( envelope * m_release, level );
+		}
+		envelope = qBound( m_floor, envelope, m_ceiling );
+		_levels[f] = envelope;
+	}
+	m_envelope = envelope;
+}
+
+
+
+
+void LevelDetector::curveGains( const float * _curve, int _points, float _scale,
+				float _floor, const float * _levels,
+				float * _gains, fpp_t _frames )
+{
+	const float top = static_cast<float>( _points );
+	for( fpp_t f = 0; f < _frames; ++f )
+	{
+		// the curve starts at 0 for a level of 0, the last value holds
+		// for all levels above it
+		const float level = _levels[f];
+		const float x = qMin( level * _scale, top );
+		const int i = static_cast<int>( x );
+		const float frac = x - i;
+		const float v0 = i < 1 ? 0.0f : _curve[i - 1];
+		const float v1 = _curve[qMin( i, _points - 1 )];
+		const float out = v0 + frac * ( v1 - v0 );
+		_gains[f] = level > _floor ? out / level : 1.0f;
+	}
+}
+
+
+
+
+double LevelDetector::sumOfSquares( const sample_t * _src, int _samples,
+							bool _keepSign )
+{
+	// partial sums the compiler can keep in the lanes of one register
+	const int Lanes = 4;
+	double sums[Lanes] = { 0.0, 0.0, 0.0, 0.0 };
+	int i = 0;
+	for( ; i + Lanes <= _samples; i += Lanes )
+	{
+		for( int l = 0; l < Lanes; ++l )
+		{
+			const double s = _src[i + l];
+			sums[l] += _keepSign ? s * fabs( s ) : s * s;
+		}
+	}
+	double sum = sums[0] + sums[1] + sums[2] + sums[3];
+	for( ; i < _samples; ++i )
+	{
+		const double s = _src[i];
+		sum += _keepSign ? s * fabs( s ) : s * s;
+	}
+	return sum;
+}
@@ -88,9 +88,9 @@ void LfoController::updateValueBuffer()
 
 	// roll phase up until we're in sync with period counter
 	m_bufferLastUpdated++;
-	if( m_bufferLastUpdated < s_periods )
+	if( m_bufferLastUpdated < runningPeriods() )
 	{
-		int diff = s_periods - m_bufferLastUpdated;
+		int diff = runningPeriods() - m_bufferLastUpdated;
 		phase += static_cast<float>( Engine::mixer()->framesPerPeriod() * diff ) / m_duration;
 		m_bufferLastUpdated += diff;
 	}
@@ -113,13 +113,14 @@ void LfoController::updateValueBuffer()
 	}
 
 	m_currentPhase = absFraction( phase - m_phaseOffset );
-	m_bufferLastUpdated = s_periods;
+	m_bufferLastUpdated = runningPeriods();
 }
 
 void LfoController::updatePhase()
 {
 	m_currentPhase = ( Engine::getSong()->getFrames() ) / m_duration;
-	m_bufferLastUpdated = s_periods - 1;
+	m_bufferLastUpdated = runningPeriods() - 1;
+	m_bufferPublished = -1;
 }
 
 
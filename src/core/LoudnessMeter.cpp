@@ -0,0 +1,265 @@
+/*
+ * LoudnessMeter.cpp - peak, RMS, true peak and loudness of an FX channel
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "LoudnessMeter.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "lmms_constants.h"
+
+
+constexpr float LoudnessMeter::Silence;
+
+
+LoudnessMeter::LoudnessMeter() :
+	m_lease( 0 ),
+	m_measuring( false ),
+	m_sampleRate( 0 ),
+	m_heldFrames( 0 )
+{
+	// windowed sinc interpolating at a quarter, a half and three quarters
+	// of the way between the two taps in the middle
+	for( int p = 1; p < TruePeakPhases; ++p )
+	{
+		double sum = 0.0;
+		for( int k = 0; k < TruePeakTaps; ++k )
+		{
+			const double x = TruePeakTaps / 2 - 1 +
+					static_cast<double>( p ) / TruePeakPhases - k;
+			const double sinc = sin( D_PI * x ) / ( D_PI * x );
+			const double window = 0.5 * ( 1.0 +
+					cos( D_PI * x / ( TruePeakTaps / 2 ) ) );
+			m_phases[p - 1][k] = sinc * window;
+			sum += sinc * window;
+		}
+		for( int k = 0; k < TruePeakTaps; ++k )
+		{
+			m_phases[p - 1][k] /= sum;
+		}
+	}
+
+	m_levels.forEach( []( Levels & _levels )
+	{
+		for( int ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+		{
+			_levels.peak[ch] = 0.0f;
+			_levels.truePeak[ch] = 0.0f;
+			_levels.rms[ch] = 0.0f;
+		}
+		_levels.momentary = Silence;
+		_levels.shortTerm = Silence;
+	} );
+
+	reset( 44100 );
+}
+
+
+
+
+void LoudnessMeter::process( const sampleFrame * _buf, fpp_t _frames,
+				float _gain, float _peakLeft, float _peakRight,
+				sample_rate_t _sampleRate )
+{
+	if( !m_measuring || _sampleRate != m_sampleRate )
+	{
+		reset( _sampleRate );
+		m_measuring = true;
+	}
+
+	if( m_levels.taken() )
+	{
+		for( int ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+		{
+			m_heldPeak[ch] = 0.0f;
+			m_heldTruePeak[ch] = 0.0f;
+			m_heldSquares[ch] = 0.0;
+		}
+		m_heldFrames = 0;
+	}
+	m_heldPeak[0] = std::max( m_heldPeak[0], _peakLeft );
+	m_heldPeak[1] = std::max( m_heldPeak[1], _peakRight );
+
+	for( fpp_t f = 0; f < _frames; ++f )
+	{
+		for( int ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+		{
+			const float x = _buf ? _buf[f][ch] * _gain : 0.0f;
+			m_heldSquares[ch] += x * x;
+
+			// the samples between this one and the one before
+			float * history = m_history[ch];
+			std::copy( history + 1, history + TruePeakTaps, history );
+			history[TruePeakTaps - 1] = x;
+			for( int p = 0; p < TruePeakPhases - 1; ++p )
+			{
+				float y = 0.0f;
+				for( int k = 0; k < TruePeakTaps; ++k )
+				{
+					y += m_phases[p][k] * history[k];
+				}
+				m_heldTruePeak[ch] = std::max( m_heldTruePeak[ch],
+								fabsf( y ) );
+			}
+
+			// K-weighting, a high shelf for the head and a high
+			// pass, then the square goes into the block
+			double * s = m_shelfState[ch];
+			const double w1 = x - m_shelf.a1 * s[0] - m_shelf.a2 * s[1];
+			const double y1 = m_shelf.b0 * w1 + m_shelf.b1 * s[0] +
+							m_shelf.b2 * s[1];
+			s[1] = s[0];
+			s[0] = w1;
+
+			double * h = m_highPassState[ch];
+			const double w2 = y1 - m_highPass.a1 * h[0] -
+							m_highPass.a2 * h[1];
+			const double y2 = m_highPass.b0 * w2 +
+					m_highPass.b1 * h[0] + m_highPass.b2 * h[1];
+			h[1] = h[0];
+			h[0] = w2;
+
+			m_blockSum += y2 * y2;
+		}
+
+		if( ++m_blockPos == m_blockFrames )
+		{
+			m_blocks[m_nextBlock] = m_blockSum;
+			m_nextBlock = ( m_nextBlock + 1 ) % ShortTermBlocks;
+			m_blocksDone = std::min( m_blocksDone + 1, ShortTermBlocks );
+			m_blockSum = 0.0;
+			m_blockPos = 0;
+		}
+	}
+	m_heldFrames += _frames;
+
+	Levels & levels = m_levels.back();
+	for( int ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+	{
+		levels.peak[ch] = m_heldPeak[ch];
+		// the samples themselves are peaks of the oversampled signal
+		levels.truePeak[ch] = std::max( m_heldTruePeak[ch],
+							m_heldPeak[ch] );
+		levels.rms[ch] = sqrt( m_heldSquares[ch] / m_heldFrames );
+	}
+	levels.momentary = loudness( MomentaryBlocks );
+	levels.shortTerm = loudness( ShortTermBlocks );
+	m_levels.publish();
+
+	// start over once it's wanted again
+	if( m_lease.fetch_sub( _frames, std::memory_order_relaxed ) <= _frames )
+	{
+		m_measuring = false;
+	}
+}
+
+
+
+
+const LoudnessMeter::Levels & LoudnessMeter::levels()
+{
+	m_lease.store( LeaseFrames, std::memory_order_relaxed );
+	return m_levels.read();
+}
+
+
+
+
+float LoudnessMeter::toDbfs( float _level )
+{
+	return std::max( 20.0f * log10f( _level ), Silence );
+}
+
+
+
+
+void LoudnessMeter::reset( sample_rate_t _sampleRate )
+{
+	m_sampleRate = _sampleRate;
+
+	// the filters of BS.1770, given for 48 kHz there, for any sample rate
+	const double shelfFrequency = 1681.974450955533;
+	const double shelfGain = 3.999843853973347;
+	const double shelfQ = 0.7071752369554196;
+	double k = tan( D_PI * shelfFrequency / _sampleRate );
+	const double vh = pow( 10.0, shelfGain / 20.0 );
+	const double vb = pow( vh, 0.4996667741545416 );
+	double a0 = 1.0 + k / shelfQ + k * k;
+	m_shelf.b0 = ( vh + vb * k / shelfQ + k * k ) / a0;
+	m_shelf.b1 = 2.0 * ( k * k - vh ) / a0;
+	m_shelf.b2 = ( vh - vb * k / shelfQ + k * k ) / a0;
+	m_shelf.a1 = 2.0 * ( k * k - 1.0 ) / a0;
+	m_shelf.a2 = ( 1.0 - k / shelfQ + k * k ) / a0;
+
+	const double highPassFrequency = 38.13547087602444;
+	const double highPassQ = 0.5003270373238773;
+	k = tan( D_PI * highPassFrequency / _sampleRate );
+	a0 = 1.0 + k / highPassQ + k * k;
+	m_highPass.b0 = 1.0;
+	m_highPass.b1 = -2.0;
+	m_highPass.b2 = 1.0;
+	m_highPass.a1 = 2.0 * ( k * k - 1.0 ) / a0;
+	m_highPass.a2 = ( 1.0 - k / highPassQ + k * k ) / a0;
+
+	for( int ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+	{
+		m_shelfState[ch][0] = m_shelfState[ch][1] = 0.0;
+		m_highPassState[ch][0] = m_highPassState[ch][1] = 0.0;
+		std::fill( m_history[ch], m_history[ch] + TruePeakTaps, 0.0f );
+		m_heldPeak[ch] = 0.0f;
+		m_heldTruePeak[ch] = 0.0f;
+		m_heldSquares[ch] = 0.0;
+	}
+	m_heldFrames = 0;
+
+	m_blockFrames = std::max<f_cnt_t>( _sampleRate / 10, 1 );
+	m_blockPos = 0;
+	m_blockSum = 0.0;
+	std::fill( m_blocks, m_blocks + ShortTermBlocks, 0.0 );
+	m_nextBlock = 0;
+	m_blocksDone = 0;
+}
+
+
+
+
+float LoudnessMeter::loudness( int _blocks ) const
+{
+	_blocks = std::min( _blocks, m_blocksDone );
+	if( _blocks == 0 )
+	{
+		return Silence;
+	}
+
+	double sum = 0.0;
+	for( int b = 1; b <= _blocks; ++b )
+	{
+		sum += m_blocks[( m_nextBlock - b + ShortTermBlocks ) %
+							ShortTermBlocks];
+	}
+	const double meanSquare = sum / ( _blocks * m_blockFrames );
+	if( meanSquare <= 0.0 )
+	{
+		return Silence;
+	}
+	return std::max<float>( -0.691 + 10.0 * log10( meanSquare ), Silence );
+}
@@ -25,8 +25,12 @@
 
 #include "MemoryManager.h"
 
+#include <atomic>
+#include <cstdio>
+
 #include <QtCore/QtGlobal>
 #include "rpmalloc.h"
+#include "RealtimeChecker.h"
 
 /// Global static object handling rpmalloc intializing and finalizing
 struct MemoryManagerGlobalGuard {
@@ -41,6 +45,17 @@ struct MemoryManagerGlobalGuard {
 
 namespace {
 static thread_local size_t thread_guard_depth;
+
+//! Precedes every allocation so free() knows what to subtract from which
+//! tag. Its size keeps the 16 byte alignment of rpmalloc.
+struct alignas(16) AllocationHeader
+{
+	size_t size;
+	MemoryManager::Tag tag;
+};
+
+std::atomic<size_t> s_bytes[MemoryManager::NumTags];
+std::atomic<size_t> s_allocations[MemoryManager::NumTags];
 }
 
 MemoryManager::ThreadGuard::ThreadGuard()
@@ -59,13 +74,22 @@ MemoryManager::ThreadGuard::~ThreadGuard()
 
 static thread_local MemoryManager::ThreadGuard local_mm_thread_guard{};
 
-void* MemoryManager::alloc(size_t size)
+void* MemoryManager::alloc(size_t size, Tag tag)
 {
 	// Reference local thread guard to ensure it is initialized.
 	// Compilers may optimize the instance away otherwise.
 	Q_UNUSED(&local_mm_thread_guard);
 	Q_ASSERT_X(rpmalloc_is_thread_initialized(), "MemoryManager::alloc", "Thread not initialized");
-	return rpmalloc(size);
+	RealtimeChecker::check("MemoryManager::alloc()");
+	auto header = static_cast<AllocationHeader*>(rpmalloc(sizeof(AllocationHeader) + size));
+	if (!header) {
+		return nullptr;
+	}
+	header->size = size;
+	header->tag = tag;
+	s_bytes[tag].fetch_add(size, std::memory_order_relaxed);
+	s_allocations[tag].fetch_add(1, std::memory_order_relaxed);
+	return header + 1;
 }
 
 
@@ -73,5 +97,70 @@ void MemoryManager::free(void * ptr)
 {
 	Q_UNUSED(&local_mm_thread_guard);
 	Q_ASSERT_X(rpmalloc_is_thread_initialized(), "MemoryManager::free", "Thread not initialized");
-	return rpfree(ptr);
+	if (!ptr) {
+		return;
+	}
+	auto header = static_cast<AllocationHeader*>(ptr) - 1;
+	s_bytes[header->tag].fetch_sub(header->size, std::memory_order_relaxed);
+	s_allocations[header->tag].fetch_sub(1, std::memory_order_relaxed);
+	rpfree(header);
+}
+
+
+void MemoryManager::collectThreadCache()
+{
+	if (rpmalloc_is_thread_initialized()) {
+		rpmalloc_thread_collect();
+	}
+}
+
+
+const char * MemoryManager::tagName(Tag tag)
+{
+	switch (tag) {
+		case Untagged: return "Other";
+		case SampleBuffers: return "Samples";
+		case ValueBuffers: return "Automation value buffers";
+		case NotePlayHandles: return "Notes";
+		case PeriodBuffers: return "Audio buffers";
+		case Plugins: return "Plugins";
+		case NumTags: break;
+	}
+	return "";
+}
+
+
+MemoryManager::Usage MemoryManager::usage(Tag tag)
+{
+	return Usage{s_bytes[tag].load(std::memory_order_relaxed),
+			s_allocations[tag].load(std::memory_order_relaxed)};
+}
+
+
+size_t MemoryManager::totalBytes()
+{
+	size_t total = 0;
+	for (const std::atomic<size_t> & bytes : s_bytes) {
+		total += bytes.load(std::memory_order_relaxed);
+	}
+	return total;
+}
+
+
+std::string MemoryManager::report()
+{
+	std::string out;
+	size_t total = 0;
+	for (int i = 0; i < NumTags; ++i) {
+		const Usage u = usage(static_cast<Tag>(i));
+		char line[128];
+		snprintf(line, sizeof(line), "%-26s %10.1f KiB in %zu allocations\n",
+				tagName(static_cast<Tag>(i)), u.bytes / 1024.0, u.allocations);
+		out += line;
+		total += u.bytes;
+	}
+	char line[128];
+	snprintf(line, sizeof(line), "%-26s %10.1f KiB\n", "Total", total / 1024.0);
+	out += line;
+	return out;
 }
@@ -0,0 +1,183 @@
+/*
+ * Metronome.cpp - clicks of the metronome
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "Metronome.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "AudioPort.h"
+#include "Engine.h"
+#include "MemoryManager.h"
+#include "Mixer.h"
+#include "PlayHandle.h"
+#include "SampleBuffer.h"
+
+
+static const char * const ClickFiles[] =
+{
+	"misc/metronome02.ogg",
+	"misc/metronome01.ogg"
+} ;
+
+
+//! Streams one click, doesn't allocate anything but itself
+class MetronomeClick : public PlayHandle
+{
+	MM_OPERATORS
+public:
+	MetronomeClick( const Metronome::SoundPtr & _sound, f_cnt_t _offset,
+							AudioPort * _port ) :
+		PlayHandle( TypeSamplePlayHandle, _offset ),
+		m_sound( _sound ),
+		m_frame( 0 )
+	{
+		setAudioPort( _port );
+	}
+
+	void play( sampleFrame * _buf ) override
+	{
+		fpp_t frames = Engine::mixer()->framesPerPeriod();
+
+		// apply offset for the first period
+		if( m_frame == 0 )
+		{
+			memset( _buf, 0, sizeof( sampleFrame ) * offset() );
+			_buf += offset();
+			frames -= offset();
+		}
+
+		const f_cnt_t left = totalFrames() - m_frame;
+		const fpp_t streamed = static_cast<fpp_t>(
+						qBound<f_cnt_t>( 0, left, frames ) );
+		memcpy( _buf, m_sound->data() + m_frame * DEFAULT_CHANNELS,
+					sizeof( sampleFrame ) * streamed );
+		memset( _buf + streamed, 0,
+				sizeof( sampleFrame ) * ( frames - streamed ) );
+		m_frame += streamed;
+	}
+
+	bool isFinished() const override
+	{
+		return m_frame >= totalFrames();
+	}
+
+	bool isFromTrack( const Track * ) const override
+	{
+		return false;
+	}
+
+private:
+	f_cnt_t totalFrames() const
+	{
+		return static_cast<f_cnt_t>( m_sound->size() / DEFAULT_CHANNELS );
+	}
+
+	Metronome::SoundPtr m_sound;
+	f_cnt_t m_frame;
+
+} ;
+
+
+
+
+Metronome::Metronome() :
+	m_audioPort( new AudioPort( "Metronome", false ) ),
+	m_lastBeat( -1 ),
+	m_lastStart( 0 )
+{
+	updateSounds();
+
+	connect( Engine::mixer(), SIGNAL( sampleRateChanged() ),
+						this, SLOT( updateSounds() ) );
+}
+
+
+
+
+Metronome::~Metronome()
+{
+	delete m_audioPort;
+}
+
+
+
+
+void Metronome::processPeriod( tick_t _ticks, float _frame,
+					tick_t _ticksPerBar, int _beatsPerBar,
+					float _framesPerTick )
+{
+	const tick_t beatTicks = qMax<tick_t>( 1, _ticksPerBar /
+						qMax( 1, _beatsPerBar ) );
+	const double beatFrames = beatTicks * (double) _framesPerTick;
+	const double start = _ticks * (double) _framesPerTick + _frame;
+
+	if( start <= m_lastStart )
+	{
+		// jumped back or restarted
+		m_lastBeat = -1;
+	}
+	m_lastStart = start;
+
+	const qint64 beat = static_cast<qint64>( ceil( start / beatFrames ) );
+	const double offset = beat * beatFrames - start;
+	if( beat == m_lastBeat ||
+			offset >= Engine::mixer()->framesPerPeriod() )
+	{
+		return;
+	}
+	m_lastBeat = beat;
+
+	const Clicks click = ( beat * beatTicks ) % _ticksPerBar == 0 ?
+							BarClick : BeatClick;
+	SoundPtr sound = std::atomic_load( &m_sounds[click] );
+	if( sound && !sound->empty() )
+	{
+		Engine::mixer()->addPlayHandle( new MetronomeClick( sound,
+				static_cast<f_cnt_t>( offset ), m_audioPort ) );
+	}
+}
+
+
+
+
+void Metronome::updateSounds()
+{
+	const sample_rate_t sampleRate =
+				Engine::mixer()->processingSampleRate();
+	for( int i = 0; i < NumClicks; ++i )
+	{
+		SampleBuffer * buffer = new SampleBuffer( ClickFiles[i] );
+		if( buffer->sampleRate() != sampleRate )
+		{
+			SampleBuffer * resampled = buffer->resample(
+					buffer->sampleRate(), sampleRate );
+			sharedObject::unref( buffer );
+			buffer = resampled;
+		}
+
+		Sound * sound = new Sound( buffer->data()[0],
+			buffer->data()[0] + buffer->frames() * DEFAULT_CHANNELS );
+		sharedObject::unref( buffer );
+		std::atomic_store( &m_sounds[i], SoundPtr( sound ) );
+	}
+}
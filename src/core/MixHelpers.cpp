@@ -25,14 +25,14 @@
 #include "MixHelpers.h"
 
 #include <cstdio>
+#include <cstring>
 
 #include "lmms_math.h"
 #include "ValueBuffer.h"
 
-#include <cstdio>
-
 
 static bool s_NaNHandler;
+static const MixHelpers::SimdKernels * s_simd = MixHelpers::detectedSimdKernels();
 
 
 namespace MixHelpers
@@ -63,6 +63,11 @@ static inline void run( sampleFrame* dst, const sample_t* srcLeft, const sample_
 
 bool isSilent( const sampleFrame* src, int frames )
 {
+	if( s_simd )
+	{
+		return s_simd->isSilent( src[0], frames * DEFAULT_CHANNELS );
+	}
+
 	const float silenceThreshold = 0.0000001f;
 
 	for( int i = 0; i < frames; ++i )
@@ -86,6 +91,16 @@ void setNaNHandler( bool use )
 	s_NaNHandler = use;
 }
 
+bool useSimd()
+{
+	return s_simd != NULL;
+}
+
+void setSimdEnabled( bool use )
+{
+	s_simd = use ? detectedSimdKernels() : NULL;
+}
+
 /*! \brief Function for sanitizing a buffer of infs/nans - returns true if those are found */
 bool sanitize( sampleFrame * src, int frames )
 {
@@ -94,6 +109,18 @@ bool sanitize( sampleFrame * src, int frames )
 		return false;
 	}
 
+	if( s_simd )
+	{
+		// same result as below: cleared or clamped
+		if( s_simd->hasNonFinite( src[0], frames * DEFAULT_CHANNELS ) )
+		{
+			memset( src, 0, frames * sizeof( sampleFrame ) );
+			return true;
+		}
+		s_simd->clamp( src[0], frames * DEFAULT_CHANNELS );
+		return false;
+	}
+
 	bool found = false;
 	for( int f = 0; f < frames; ++f )
 	{
@@ -125,6 +152,162 @@ bool sanitize( sampleFrame * src, int frames )
 }
 
 
+void peak( const sampleFrame * src, int frames, float & left, float & right )
+{
+	float peaks[2] = { 0.0f, 0.0f };
+	if( s_simd )
+	{
+		s_simd->peak( src[0], frames * DEFAULT_CHANNELS, peaks );
+	}
+	else
+	{
+		for( int f = 0; f < frames; ++f )
+		{
+			for( int c = 0; c < 2; ++c )
+			{
+				if( qAbs( src[f][c] ) > peaks[c] )
+				{
+					peaks[c] = qAbs( src[f][c] );
+				}
+			}
+		}
+	}
+	left = peaks[0];
+	right = peaks[1];
+}
+
+
+bool sanitizeAndPeak( sampleFrame * src, int frames, float & left, float & right )
+{
+	if( !useNaNHandler() )
+	{
+		peak( src, frames, left, right );
+		return false;
+	}
+
+	float peaks[2] = { 0.0f, 0.0f };
+	bool found = false;
+	if( s_simd )
+	{
+		found = s_simd->sanitizeAndPeak( src[0], frames * DEFAULT_CHANNELS, peaks );
+	}
+	else
+	{
+		for( int f = 0; f < frames && !found; ++f )
+		{
+			for( int c = 0; c < 2; ++c )
+			{
+				if( isinf( src[f][c] ) || isnan( src[f][c] ) )
+				{
+					memset( src, 0, frames * sizeof( sampleFrame ) );
+					peaks[0] = peaks[1] = 0.0f;
+					found = true;
+					break;
+				}
+				src[f][c] = qBound( -1000.0f, src[f][c], 1000.0f );
+				peaks[c] = qMax( peaks[c], qAbs( src[f][c] ) );
+			}
+		}
+	}
+	left = peaks[0];
+	right = peaks[1];
+	return found;
+}
+
+
+void sumMultipliedByGains( sampleFrame* dst, const sampleFrame* const* srcs, int count, const sampleFrame* gains, int frames )
+{
+	if( count == 0 )
+	{
+		memset( dst, 0, frames * sizeof( sampleFrame ) );
+		return;
+	}
+
+	if( s_simd )
+	{
+		s_simd->sumMultipliedByGains( dst[0], srcs, count, gains ? gains[0] : NULL, frames * DEFAULT_CHANNELS );
+		return;
+	}
+
+	for( int f = 0; f < frames; ++f )
+	{
+		for( int c = 0; c < 2; ++c )
+		{
+			float sum = srcs[0][f][c];
+			for( int s = 1; s < count; ++s )
+			{
+				sum += srcs[s][f][c];
+			}
+			dst[f][c] = gains ? sum * gains[f][c] : sum;
+		}
+	}
+}
+
+
+void stereoGains( sampleFrame* gains, const float* volume, float volumeValue, const float* panning, float panningValue, int frames )
+{
+	if( s_simd )
+	{
+		s_simd->stereoGains( gains[0], volume, volumeValue, panning, panningValue, frames );
+		return;
+	}
+
+	for( int f = 0; f < frames; ++f )
+	{
+		const float v = ( volume ? volume[f] : volumeValue ) * 0.01f;
+		const float p = ( panning ? panning[f] : panningValue ) * 0.01f;
+		// the pan law attenuates the opposite side only
+		gains[f][0] = qMin( 1.0f, 1.0f - p ) * v;
+		gains[f][1] = qMin( 1.0f, 1.0f + p ) * v;
+	}
+}
+
+
+// like the SIMD kernels, which accumulate 8 samples at once, 4 frames apart
+static inline void polyphaseDot( const float* src, const float* coeffs, int taps, float* out )
+{
+	float acc[8] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	for( int i = 0; i < taps * 2; i += 8 )
+	{
+		for( int l = 0; l < 8; ++l )
+		{
+			acc[l] += src[i + l] * coeffs[i + l];
+		}
+	}
+	out[0] = ( acc[0] + acc[2] ) + ( acc[4] + acc[6] );
+	out[1] = ( acc[1] + acc[3] ) + ( acc[5] + acc[7] );
+}
+
+
+void polyphase( sampleFrame* dst, const sampleFrame* src, const float* bank, int taps, int phases, double position, double step, int frames )
+{
+	if( s_simd )
+	{
+		s_simd->polyphase( dst[0], src[0], bank, taps, phases, position, step, frames );
+		return;
+	}
+
+	for( int f = 0; f < frames; ++f )
+	{
+		const double pos = position + f * step;
+		const int index = static_cast<int>( pos );
+		const double phase = ( pos - index ) * phases;
+		const int row = static_cast<int>( phase );
+		const float weight = static_cast<float>( phase - row );
+
+		polyphaseDot( src[index], bank + row * taps * 2, taps, dst[f] );
+		// positions on a row, e.g. of octaves, don't need the next one
+		if( weight != 0.0f )
+		{
+			float next[2];
+			polyphaseDot( src[index], bank + ( row + 1 ) * taps * 2, taps, next );
+			dst[f][0] += weight * ( next[0] - dst[f][0] );
+			dst[f][1] += weight * ( next[1] - dst[f][1] );
+		}
+	}
+}
+
+
 struct AddOp
 {
 	void operator()( sampleFrame& dst, const sampleFrame& src ) const
@@ -136,6 +319,11 @@ struct AddOp
 
 void add( sampleFrame* dst, const sampleFrame* src, int frames )
 {
+	if( s_simd )
+	{
+		s_simd->add( dst[0], src[0], frames * DEFAULT_CHANNELS );
+		return;
+	}
 	run<>( dst, src, frames, AddOp() );
 }
 
@@ -157,6 +345,11 @@ struct AddMultipliedOp
 
 void addMultiplied( sampleFrame* dst, const sampleFrame* src, float coeffSrc, int frames )
 {
+	if( s_simd )
+	{
+		s_simd->addMultiplied( dst[0], src[0], coeffSrc, frames * DEFAULT_CHANNELS );
+		return;
+	}
 	run<>( dst, src, frames, AddMultipliedOp(coeffSrc) );
 }
 
@@ -258,6 +451,12 @@ void addSanitizedMultiplied( sampleFrame* dst, const sampleFrame* src, float coe
 		return;
 	}
 
+	if( s_simd )
+	{
+		s_simd->addSanitizedMultiplied( dst[0], src[0], coeffSrc, frames * DEFAULT_CHANNELS );
+		return;
+	}
+
 	run<>( dst, src, frames, AddSanitizedMultipliedOp(coeffSrc) );
 }
 
@@ -324,5 +523,50 @@ void multiplyAndAddMultipliedJoined( sampleFrame* dst,
 	run<>( dst, srcLeft, srcRight, frames, MultiplyAndAddMultipliedOp(coeffDst, coeffSrc) );
 }
 
+
+
+double mixDryWet( sampleFrame* wet, const sampleFrame* dry, float coeffDry, float coeffWet, int frames )
+{
+	if( s_simd )
+	{
+		return s_simd->mixDryWet( wet[0], dry[0], coeffDry, coeffWet, frames * DEFAULT_CHANNELS );
+	}
+
+	double sum = 0.0;
+	for( int f = 0; f < frames; ++f )
+	{
+		wet[f][0] = coeffDry * dry[f][0] + coeffWet * wet[f][0];
+		wet[f][1] = coeffDry * dry[f][1] + coeffWet * wet[f][1];
+		sum += wet[f][0] * wet[f][0] + wet[f][1] * wet[f][1];
+	}
+	return sum;
+}
+
+
+
+void deinterleave( float* const* dst, const sampleFrame* src, int frames )
+{
+	float* left = dst[0];
+	float* right = dst[1];
+	for( int f = 0; f < frames; ++f )
+	{
+		left[f] = src[f][0];
+		right[f] = src[f][1];
+	}
+}
+
+
+
+void interleave( sampleFrame* dst, const float* const* src, int frames )
+{
+	const float* left = src[0];
+	const float* right = src[1];
+	for( int f = 0; f < frames; ++f )
+	{
+		dst[f][0] = left[f];
+		dst[f][1] = right[f];
+	}
+}
+
 }
 
@@ -0,0 +1,1291 @@
+/*
+ * MixHelpersSimd.cpp - vectorized versions of the hottest MixHelpers,
+ *                      picked for the CPU at runtime
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "MixHelpers.h"
+
+#include <cmath>
+#include <cstring>
+
+#include <QtCore/QtGlobal>
+
+#include "lmmsconfig.h"
+
+#if defined( __GNUC__ ) && ( defined( LMMS_HOST_X86 ) || defined( LMMS_HOST_X86_64 ) )
+#define LMMS_MIX_X86
+#include <immintrin.h>
+#elif defined( __aarch64__ )
+#define LMMS_MIX_NEON
+#include <arm_neon.h>
+#endif
+
+
+// All kernels work on interleaved samples, _n is twice the number of
+// frames. They use unaligned loads - period buffers from the BufferManager
+// are cache line aligned anyway, but effect and FX channel buffers and
+// the fallback allocations of the BufferManager aren't necessarily. The
+// scalar loops at the end do the remaining samples exactly like the
+// reference code in MixHelpers.cpp, so results don't depend on the CPU.
+
+static const float SilenceThreshold = 0.0000001f;
+static const float SanitizeLimit = 1000.0f;
+
+
+static inline bool isFinite( float _x )
+{
+	return !std::isinf( _x ) && !std::isnan( _x );
+}
+
+
+// the tails of peak() and sanitizeAndPeak(), _from is even so even samples
+// are left ones
+static void peakTail( const float * _src, int _from, int _n, float * _peaks )
+{
+	for( int i = _from; i < _n; ++i )
+	{
+		// ignores nans like Mixer::getPeakValues() did
+		if( fabsf( _src[i] ) > _peaks[i % 2] )
+		{
+			_peaks[i % 2] = fabsf( _src[i] );
+		}
+	}
+}
+
+
+static bool sanitizeAndPeakTail( float * _buf, int _from, int _n,
+						float * _peaks, bool _bad )
+{
+	for( int i = _from; i < _n; ++i )
+	{
+		_bad |= !isFinite( _buf[i] );
+		_buf[i] = qBound( -SanitizeLimit, _buf[i], SanitizeLimit );
+		_peaks[i % 2] = qMax( _peaks[i % 2], fabsf( _buf[i] ) );
+	}
+	if( _bad )
+	{
+		memset( _buf, 0, _n * sizeof( float ) );
+		_peaks[0] = _peaks[1] = 0.0f;
+	}
+	return _bad;
+}
+
+
+// the tail of sumMultipliedByGains()
+static void sumTail( float * _dst, const sampleFrame * const * _srcs,
+			int _count, const float * _gains, int _from, int _n )
+{
+	for( int i = _from; i < _n; ++i )
+	{
+		float sum = _srcs[0][0][i];
+		for( int s = 1; s < _count; ++s )
+		{
+			sum += _srcs[s][0][i];
+		}
+		_dst[i] = _gains ? sum * _gains[i] : sum;
+	}
+}
+
+
+// the tail of stereoGains(), works on frames
+static void stereoGainsTail( float * _gains, const float * _volume,
+				float _volumeValue, const float * _panning,
+				float _panningValue, int _from, int _frames )
+{
+	for( int f = _from; f < _frames; ++f )
+	{
+		const float v = ( _volume ? _volume[f] : _volumeValue ) * 0.01f;
+		const float p = ( _panning ? _panning[f] : _panningValue ) * 0.01f;
+		_gains[f * 2] = qMin( 1.0f, 1.0f - p ) * v;
+		_gains[f * 2 + 1] = qMin( 1.0f, 1.0f + p ) * v;
+	}
+}
+
+
+// the frame of polyphase() which output frame _f starts at, and the row of
+// the filter bank and the weight of the next one
+static inline void polyphasePosition( double _position, double _step, int _f,
+					int _phases, int & _index, int & _row,
+					float & _weight )
+{
+	const double pos = _position + _f * _step;
+	_index = static_cast<int>( pos );
+	const double phase = ( pos - _index ) * _phases;
+	_row = static_cast<int>( phase );
+	_weight = static_cast<float>( phase - _row );
+}
+
+
+// sums up the 8 accumulators of polyphase() like MixHelpers.cpp does
+static inline void reducePolyphase( const float * _lanes, float * _out )
+{
+	_out[0] = ( _lanes[0] + _lanes[2] ) + ( _lanes[4] + _lanes[6] );
+	_out[1] = ( _lanes[1] + _lanes[3] ) + ( _lanes[5] + _lanes[7] );
+}
+
+
+static inline void blendPolyphase( float * _dst, const float * _next,
+							float _weight )
+{
+	_dst[0] += _weight * ( _next[0] - _dst[0] );
+	_dst[1] += _weight * ( _next[1] - _dst[1] );
+}
+
+
+// the tail of mixDryWet(), returns the sum of the squares it wrote
+static double mixDryWetTail( float * _wet, const float * _dry, float _coeffDry,
+				float _coeffWet, int _from, int _n )
+{
+	double sum = 0.0;
+	for( int i = _from; i < _n; ++i )
+	{
+		_wet[i] = _coeffDry * _dry[i] + _coeffWet * _wet[i];
+		sum += _wet[i] * _wet[i];
+	}
+	return sum;
+}
+
+
+// _lanes holds interleaved peaks of _count samples
+static void reducePeaks( const float * _lanes, int _count, float * _peaks )
+{
+	_peaks[0] = _peaks[1] = 0.0f;
+	for( int i = 0; i < _count; ++i )
+	{
+		_peaks[i % 2] = qMax( _peaks[i % 2], _lanes[i] );
+	}
+}
+
+
+
+
+#ifdef LMMS_MIX_X86
+
+#define LMMS_SSE2 __attribute__(( target( "sse2" ) ))
+#define LMMS_AVX2 __attribute__(( target( "avx2" ) ))
+#define LMMS_AVX512 __attribute__(( target( "avx512f" ) ))
+
+
+namespace Sse2
+{
+
+LMMS_SSE2 static inline __m128 absolute( __m128 _x )
+{
+	return _mm_andnot_ps( _mm_set1_ps( -0.0f ), _x );
+}
+
+
+LMMS_SSE2 static void add( float * _dst, const float * _src, int _n )
+{
+	int i = 0;
+	for( ; i + 4 <= _n; i += 4 )
+	{
+		_mm_storeu_ps( _dst + i, _mm_add_ps( _mm_loadu_ps( _dst + i ),
+						_mm_loadu_ps( _src + i ) ) );
+	}
+	for( ; i < _n; ++i )
+	{
+		_dst[i] += _src[i];
+	}
+}
+
+
+LMMS_SSE2 static void addMultiplied( float * _dst, const float * _src,
+							float _coeff, int _n )
+{
+	const __m128 coeff = _mm_set1_ps( _coeff );
+	int i = 0;
+	for( ; i + 4 <= _n; i += 4 )
+	{
+		_mm_storeu_ps( _dst + i, _mm_add_ps( _mm_loadu_ps( _dst + i ),
+				_mm_mul_ps( _mm_loadu_ps( _src + i ), coeff ) ) );
+	}
+	for( ; i < _n; ++i )
+	{
+		_dst[i] += _src[i] * _coeff;
+	}
+}
+
+
+LMMS_SSE2 static void addSanitizedMultiplied( float * _dst, const float * _src,
+							float _coeff, int _n )
+{
+	const __m128 coeff = _mm_set1_ps( _coeff );
+	const __m128 inf = _mm_set1_ps( INFINITY );
+	int i = 0;
+	for( ; i + 4 <= _n; i += 4 )
+	{
+		const __m128 src = _mm_loadu_ps( _src + i );
+		// false for infs and nans
+		const __m128 finite = _mm_cmplt_ps( absolute( src ), inf );
+		_mm_storeu_ps( _dst + i, _mm_add_ps( _mm_loadu_ps( _dst + i ),
+			_mm_and_ps( finite, _mm_mul_ps( src, coeff ) ) ) );
+	}
+	for( ; i < _n; ++i )
+	{
+		_dst[i] += isFinite( _src[i] ) ? _src[i] * _coeff : 0.0f;
+	}
+}
+
+
+LMMS_SSE2 static double mixDryWet( float * _wet, const float * _dry,
+					float _coeffDry, float _coeffWet, int _n )
+{
+	const __m128 coeffDry = _mm_set1_ps( _coeffDry );
+	const __m128 coeffWet = _mm_set1_ps( _coeffWet );
+	__m128 squares = _mm_setzero_ps();
+	int i = 0;
+	for( ; i + 4 <= _n; i += 4 )
+	{
+		const __m128 out = _mm_add_ps(
+			_mm_mul_ps( _mm_loadu_ps( _dry + i ), coeffDry ),
+			_mm_mul_ps( _mm_loadu_ps( _wet + i ), coeffWet ) );
+		_mm_storeu_ps( _wet + i, out );
+		squares = _mm_add_ps( squares, _mm_mul_ps( out, out ) );
+	}
+	float lanes[4];
+	_mm_storeu_ps( lanes, squares );
+	double sum = 0.0;
+	for( int l = 0; l < 4; ++l )
+	{
+		sum += lanes[l];
+	}
+	return sum + mixDryWetTail( _wet, _dry, _coeffDry, _coeffWet, i, _n );
+}
+
+
+LMMS_SSE2 static bool isSilent( const float * _src, int _n )
+{
+	const __m128 threshold = _mm_set1_ps( SilenceThreshold );
+	int i = 0;
+	for( ; i + 4 <= _n; i += 4 )
+	{
+		if( _mm_movemask_ps( _mm_cmpge_ps( absolute( _mm_loadu_ps( _src + i ) ),
+								threshold ) ) )
+		{
+			return false;
+		}
+	}
+	for( ; i < _n; ++i )
+	{
+		if( fabsf( _src[i] ) >= SilenceThreshold )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+LMMS_SSE2 static bool hasNonFinite( const float * _src, int _n )
+{
+	const __m128 inf = _mm_set1_ps( INFINITY );
+	int i = 0;
+	for( ; i + 4 <= _n; i += 4 )
+	{
+		if( _mm_movemask_ps( _mm_cmpnlt_ps( absolute( _mm_loadu_ps( _src + i ) ),
+									inf ) ) )
+		{
+			return true;
+		}
+	}
+	for( ; i < _n; ++i )
+	{
+		if( !isFinite( _src[i] ) )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+LMMS_SSE2 static void clamp( float * _buf, int _n )
+{
+	const __m128 low = _mm_set1_ps( -SanitizeLimit );
+	const __m128 high = _mm_set1_ps( SanitizeLimit );
+	int i = 0;
+	for( ; i + 4 <= _n; i += 4 )
+	{
+		_mm_storeu_ps( _buf + i, _mm_min_ps( _mm_max_ps(
+					_mm_loadu_ps( _buf + i ), low ), high ) );
+	}
+	for( ; i < _n; ++i )
+	{
+		_buf[i] = qBound( -SanitizeLimit, _buf[i], SanitizeLimit );
+	}
+}
+
+LMMS_SSE2 static void peak( const float * _src, int _n, float * _peaks )
+{
+	// absolute values first, the maximum of a nan and x is x then
+	__m128 peaks = _mm_setzero_ps();
+	int i = 0;
+	for( ; i + 4 <= _n; i += 4 )
+	{
+		peaks = _mm_max_ps( absolute( _mm_loadu_ps( _src + i ) ), peaks );
+	}
+	float lanes[4];
+	_mm_storeu_ps( lanes, peaks );
+	reducePeaks( lanes, 4, _peaks );
+	peakTail( _src, i, _n, _peaks );
+}
+
+
+LMMS_SSE2 static bool sanitizeAndPeak( float * _buf, int _n, float * _peaks )
+{
+	const __m128 inf = _mm_set1_ps( INFINITY );
+	const __m128 low = _mm_set1_ps( -SanitizeLimit );
+	const __m128 high = _mm_set1_ps( SanitizeLimit );
+	__m128 bad = _mm_setzero_ps();
+	__m128 peaks = _mm_setzero_ps();
+	int i = 0;
+	for( ; i + 4 <= _n; i += 4 )
+	{
+		const __m128 x = _mm_loadu_ps( _buf + i );
+		bad = _mm_or_ps( bad, _mm_cmpnlt_ps( absolute( x ), inf ) );
+		const __m128 clamped = _mm_min_ps( _mm_max_ps( x, low ), high );
+		_mm_storeu_ps( _buf + i, clamped );
+		peaks = _mm_max_ps( absolute( clamped ), peaks );
+	}
+	float lanes[4];
+	_mm_storeu_ps( lanes, peaks );
+	reducePeaks( lanes, 4, _peaks );
+	return sanitizeAndPeakTail( _buf, i, _n, _peaks,
+					_mm_movemask_ps( bad ) != 0 );
+}
+
+
+LMMS_SSE2 static void sumMultipliedByGains( float * _dst,
+				const sampleFrame * const * _srcs, int _count,
+				const float * _gains, int _n )
+{
+	int i = 0;
+	for( ; i + 4 <= _n; i += 4 )
+	{
+		__m128 sum = _mm_loadu_ps( _srcs[0][0] + i );
+		for( int s = 1; s < _count; ++s )
+		{
+			sum = _mm_add_ps( sum, _mm_loadu_ps( _srcs[s][0] + i ) );
+		}
+		if( _gains )
+		{
+			sum = _mm_mul_ps( sum, _mm_loadu_ps( _gains + i ) );
+		}
+		_mm_storeu_ps( _dst + i, sum );
+	}
+	sumTail( _dst, _srcs, _count, _gains, i, _n );
+}
+
+
+// also used with AVX2 and AVX-512, it's done once per period only
+LMMS_SSE2 static void stereoGains( float * _gains, const float * _volume,
+				float _volumeValue, const float * _panning,
+				float _panningValue, int _frames )
+{
+	const __m128 one = _mm_set1_ps( 1.0f );
+	const __m128 percent = _mm_set1_ps( 0.01f );
+	int f = 0;
+	for( ; f + 4 <= _frames; f += 4 )
+	{
+		const __m128 v = _mm_mul_ps( _volume ? _mm_loadu_ps( _volume + f ) :
+					_mm_set1_ps( _volumeValue ), percent );
+		const __m128 p = _mm_mul_ps( _panning ? _mm_loadu_ps( _panning + f ) :
+					_mm_set1_ps( _panningValue ), percent );
+		const __m128 left = _mm_mul_ps( _mm_min_ps( one, _mm_sub_ps( one, p ) ), v );
+		const __m128 right = _mm_mul_ps( _mm_min_ps( one, _mm_add_ps( one, p ) ), v );
+		_mm_storeu_ps( _gains + f * 2, _mm_unpacklo_ps( left, right ) );
+		_mm_storeu_ps( _gains + f * 2 + 4, _mm_unpackhi_ps( left, right ) );
+	}
+	stereoGainsTail( _gains, _volume, _volumeValue, _panning, _panningValue,
+								f, _frames );
+}
+
+
+// _taps is a multiple of 4, so there are always 8 samples to load
+LMMS_SSE2 static inline void polyphaseDot( const float * _src,
+				const float * _coeffs, int _taps, float * _out )
+{
+	__m128 acc0 = _mm_setzero_ps();
+	__m128 acc1 = _mm_setzero_ps();
+	for( int i = 0; i < _taps * 2; i += 8 )
+	{
+		acc0 = _mm_add_ps( acc0, _mm_mul_ps( _mm_loadu_ps( _src + i ),
+					_mm_loadu_ps( _coeffs + i ) ) );
+		acc1 = _mm_add_ps( acc1, _mm_mul_ps( _mm_loadu_ps( _src + i + 4 ),
+					_mm_loadu_ps( _coeffs + i + 4 ) ) );
+	}
+	float lanes[8];
+	_mm_storeu_ps( lanes, acc0 );
+	_mm_storeu_ps( lanes + 4, acc1 );
+	reducePolyphase( lanes, _out );
+}
+
+
+LMMS_SSE2 static void polyphase( float * _dst, const float * _src,
+				const float * _bank, int _taps, int _phases,
+				double _position, double _step, int _frames )
+{
+	for( int f = 0; f < _frames; ++f )
+	{
+		int index, row;
+		float weight;
+		polyphasePosition( _position, _step, f, _phases, index, row,
+									weight );
+		const float * src = _src + index * 2;
+		float * dst = _dst + f * 2;
+		polyphaseDot( src, _bank + row * _taps * 2, _taps, dst );
+		if( weight != 0.0f )
+		{
+			float next[2];
+			polyphaseDot( src, _bank + ( row + 1 ) * _taps * 2, _taps,
+									next );
+			blendPolyphase( dst, next, weight );
+		}
+	}
+}
+
+
+}
+
+
+
+
+namespace Avx2
+{
+
+LMMS_AVX2 static inline __m256 absolute( __m256 _x )
+{
+	return _mm256_andnot_ps( _mm256_set1_ps( -0.0f ), _x );
+}
+
+
+LMMS_AVX2 static void add( float * _dst, const float * _src, int _n )
+{
+	int i = 0;
+	for( ; i + 8 <= _n; i += 8 )
+	{
+		_mm256_storeu_ps( _dst + i, _mm256_add_ps(
+			_mm256_loadu_ps( _dst + i ), _mm256_loadu_ps( _src + i ) ) );
+	}
+	for( ; i < _n; ++i )
+	{
+		_dst[i] += _src[i];
+	}
+}
+
+
+LMMS_AVX2 static void addMultiplied( float * _dst, const float * _src,
+							float _coeff, int _n )
+{
+	const __m256 coeff = _mm256_set1_ps( _coeff );
+	int i = 0;
+	for( ; i + 8 <= _n; i += 8 )
+	{
+		_mm256_storeu_ps( _dst + i, _mm256_add_ps( _mm256_loadu_ps( _dst + i ),
+			_mm256_mul_ps( _mm256_loadu_ps( _src + i ), coeff ) ) );
+	}
+	for( ; i < _n; ++i )
+	{
+		_dst[i] += _src[i] * _coeff;
+	}
+}
+
+
+LMMS_AVX2 static void addSanitizedMultiplied( float * _dst, const float * _src,
+							float _coeff, int _n )
+{
+	const __m256 coeff = _mm256_set1_ps( _coeff );
+	const __m256 inf = _mm256_set1_ps( INFINITY );
+	int i = 0;
+	for( ; i + 8 <= _n; i += 8 )
+	{
+		const __m256 src = _mm256_loadu_ps( _src + i );
+		const __m256 finite = _mm256_cmp_ps( absolute( src ), inf, _CMP_LT_OQ );
+		_mm256_storeu_ps( _dst + i, _mm256_add_ps( _mm256_loadu_ps( _dst + i ),
+			_mm256_and_ps( finite, _mm256_mul_ps( src, coeff ) ) ) );
+	}
+	for( ; i < _n; ++i )
+	{
+		_dst[i] += isFinite( _src[i] ) ? _src[i] * _coeff : 0.0f;
+	}
+}
+
+
+LMMS_AVX2 static double mixDryWet( float * _wet, const float * _dry,
+					float _coeffDry, float _coeffWet, int _n )
+{
+	const __m256 coeffDry = _mm256_set1_ps( _coeffDry );
+	const __m256 coeffWet = _mm256_set1_ps( _coeffWet );
+	__m256 squares = _mm256_setzero_ps();
+	int i = 0;
+	for( ; i + 8 <= _n; i += 8 )
+	{
+		const __m256 out = _mm256_add_ps(
+			_mm256_mul_ps( _mm256_loadu_ps( _dry + i ), coeffDry ),
+			_mm256_mul_ps( _mm256_loadu_ps( _wet + i ), coeffWet ) );
+		_mm256_storeu_ps( _wet + i, out );
+		squares = _mm256_add_ps( squares, _mm256_mul_ps( out, out ) );
+	}
+	float lanes[8];
+	_mm256_storeu_ps( lanes, squares );
+	double sum = 0.0;
+	for( int l = 0; l < 8; ++l )
+	{
+		sum += lanes[l];
+	}
+	return sum + mixDryWetTail( _wet, _dry, _coeffDry, _coeffWet, i, _n );
+}
+
+
+LMMS_AVX2 static bool isSilent( const float * _src, int _n )
+{
+	const __m256 threshold = _mm256_set1_ps( SilenceThreshold );
+	int i = 0;
+	for( ; i + 8 <= _n; i += 8 )
+	{
+		if( _mm256_movemask_ps( _mm256_cmp_ps( absolute( _mm256_loadu_ps( _src + i ) ),
+							threshold, _CMP_GE_OQ ) ) )
+		{
+			return false;
+		}
+	}
+	for( ; i < _n; ++i )
+	{
+		if( fabsf( _src[i] ) >= SilenceThreshold )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+LMMS_AVX2 static bool hasNonFinite( const float * _src, int _n )
+{
+	const __m256 inf = _mm256_set1_ps( INFINITY );
+	int i = 0;
+	for( ; i + 8 <= _n; i += 8 )
+	{
+		if( _mm256_movemask_ps( _mm256_cmp_ps( absolute( _mm256_loadu_ps( _src + i ) ),
+							inf, _CMP_NLT_UQ ) ) )
+		{
+			return true;
+		}
+	}
+	for( ; i < _n; ++i )
+	{
+		if( !isFinite( _src[i] ) )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+LMMS_AVX2 static void clamp( float * _buf, int _n )
+{
+	const __m256 low = _mm256_set1_ps( -SanitizeLimit );
+	const __m256 high = _mm256_set1_ps( SanitizeLimit );
+	int i = 0;
+	for( ; i + 8 <= _n; i += 8 )
+	{
+		_mm256_storeu_ps( _buf + i, _mm256_min_ps( _mm256_max_ps(
+				_mm256_loadu_ps( _buf + i ), low ), high ) );
+	}
+	for( ; i < _n; ++i )
+	{
+		_buf[i] = qBound( -SanitizeLimit, _buf[i], SanitizeLimit );
+	}
+}
+
+LMMS_AVX2 static void peak( const float * _src, int _n, float * _peaks )
+{
+	__m256 peaks = _mm256_setzero_ps();
+	int i = 0;
+	for( ; i + 8 <= _n; i += 8 )
+	{
+		peaks = _mm256_max_ps( absolute( _mm256_loadu_ps( _src + i ) ), peaks );
+	}
+	float lanes[8];
+	_mm256_storeu_ps( lanes, peaks );
+	reducePeaks( lanes, 8, _peaks );
+	peakTail( _src, i, _n, _peaks );
+}
+
+
+LMMS_AVX2 static bool sanitizeAndPeak( float * _buf, int _n, float * _peaks )
+{
+	const __m256 inf = _mm256_set1_ps( INFINITY );
+	const __m256 low = _mm256_set1_ps( -SanitizeLimit );
+	const __m256 high = _mm256_set1_ps( SanitizeLimit );
+	__m256 bad = _mm256_setzero_ps();
+	__m256 peaks = _mm256_setzero_ps();
+	int i = 0;
+	for( ; i + 8 <= _n; i += 8 )
+	{
+		const __m256 x = _mm256_loadu_ps( _buf + i );
+		bad = _mm256_or_ps( bad, _mm256_cmp_ps( absolute( x ), inf,
+								_CMP_NLT_UQ ) );
+		const __m256 clamped = _mm256_min_ps( _mm256_max_ps( x, low ), high );
+		_mm256_storeu_ps( _buf + i, clamped );
+		peaks = _mm256_max_ps( absolute( clamped ), peaks );
+	}
+	float lanes[8];
+	_mm256_storeu_ps( lanes, peaks );
+	reducePeaks( lanes, 8, _peaks );
+	return sanitizeAndPeakTail( _buf, i, _n, _peaks,
+					_mm256_movemask_ps( bad ) != 0 );
+}
+
+
+LMMS_AVX2 static void sumMultipliedByGains( float * _dst,
+				const sampleFrame * const * _srcs, int _count,
+				const float * _gains, int _n )
+{
+	int i = 0;
+	for( ; i + 8 <= _n; i += 8 )
+	{
+		__m256 sum = _mm256_loadu_ps( _srcs[0][0] + i );
+		for( int s = 1; s < _count; ++s )
+		{
+			sum = _mm256_add_ps( sum, _mm256_loadu_ps( _srcs[s][0] + i ) );
+		}
+		if( _gains )
+		{
+			sum = _mm256_mul_ps( sum, _mm256_loadu_ps( _gains + i ) );
+		}
+		_mm256_storeu_ps( _dst + i, sum );
+	}
+	sumTail( _dst, _srcs, _count, _gains, i, _n );
+}
+
+
+
+// also used with AVX-512, the filters are too short for wider vectors
+LMMS_AVX2 static inline void polyphaseDot( const float * _src,
+				const float * _coeffs, int _taps, float * _out )
+{
+	__m256 acc = _mm256_setzero_ps();
+	for( int i = 0; i < _taps * 2; i += 8 )
+	{
+		acc = _mm256_add_ps( acc, _mm256_mul_ps( _mm256_loadu_ps( _src + i ),
+					_mm256_loadu_ps( _coeffs + i ) ) );
+	}
+	float lanes[8];
+	_mm256_storeu_ps( lanes, acc );
+	reducePolyphase( lanes, _out );
+}
+
+
+LMMS_AVX2 static void polyphase( float * _dst, const float * _src,
+				const float * _bank, int _taps, int _phases,
+				double _position, double _step, int _frames )
+{
+	for( int f = 0; f < _frames; ++f )
+	{
+		int index, row;
+		float weight;
+		polyphasePosition( _position, _step, f, _phases, index, row,
+									weight );
+		const float * src = _src + index * 2;
+		float * dst = _dst + f * 2;
+		polyphaseDot( src, _bank + row * _taps * 2, _taps, dst );
+		if( weight != 0.0f )
+		{
+			float next[2];
+			polyphaseDot( src, _bank + ( row + 1 ) * _taps * 2, _taps,
+									next );
+			blendPolyphase( dst, next, weight );
+		}
+	}
+}
+
+
+}
+
+
+
+
+namespace Avx512
+{
+
+LMMS_AVX512 static inline __m512 absolute( __m512 _x )
+{
+	return _mm512_castsi512_ps( _mm512_and_si512( _mm512_castps_si512( _x ),
+					_mm512_set1_epi32( 0x7fffffff ) ) );
+}
+
+
+LMMS_AVX512 static void add( float * _dst, const float * _src, int _n )
+{
+	int i = 0;
+	for( ; i + 16 <= _n; i += 16 )
+	{
+		_mm512_storeu_ps( _dst + i, _mm512_add_ps(
+			_mm512_loadu_ps( _dst + i ), _mm512_loadu_ps( _src + i ) ) );
+	}
+	for( ; i < _n; ++i )
+	{
+		_dst[i] += _src[i];
+	}
+}
+
+
+LMMS_AVX512 static void addMultiplied( float * _dst, const float * _src,
+							float _coeff, int _n )
+{
+	const __m512 coeff = _mm512_set1_ps( _coeff );
+	int i = 0;
+	for( ; i + 16 <= _n; i += 16 )
+	{
+		_mm512_storeu_ps( _dst + i, _mm512_add_ps( _mm512_loadu_ps( _dst + i ),
+			_mm512_mul_ps( _mm512_loadu_ps( _src + i ), coeff ) ) );
+	}
+	for( ; i < _n; ++i )
+	{
+		_dst[i] += _src[i] * _coeff;
+	}
+}
+
+
+LMMS_AVX512 static void addSanitizedMultiplied( float * _dst, const float * _src,
+							float _coeff, int _n )
+{
+	const __m512 coeff = _mm512_set1_ps( _coeff );
+	const __m512 inf = _mm512_set1_ps( INFINITY );
+	int i = 0;
+	for( ; i + 16 <= _n; i += 16 )
+	{
+		const __m512 src = _mm512_loadu_ps( _src + i );
+		const __mmask16 finite = _mm512_cmp_ps_mask( absolute( src ), inf,
+								_CMP_LT_OQ );
+		_mm512_storeu_ps( _dst + i, _mm512_add_ps( _mm512_loadu_ps( _dst + i ),
+			_mm512_maskz_mov_ps( finite, _mm512_mul_ps( src, coeff ) ) ) );
+	}
+	for( ; i < _n; ++i )
+	{
+		_dst[i] += isFinite( _src[i] ) ? _src[i] * _coeff : 0.0f;
+	}
+}
+
+
+LMMS_AVX512 static double mixDryWet( float * _wet, const float * _dry,
+					float _coeffDry, float _coeffWet, int _n )
+{
+	const __m512 coeffDry = _mm512_set1_ps( _coeffDry );
+	const __m512 coeffWet = _mm512_set1_ps( _coeffWet );
+	__m512 squares = _mm512_setzero_ps();
+	int i = 0;
+	for( ; i + 16 <= _n; i += 16 )
+	{
+		const __m512 out = _mm512_add_ps(
+			_mm512_mul_ps( _mm512_loadu_ps( _dry + i ), coeffDry ),
+			_mm512_mul_ps( _mm512_loadu_ps( _wet + i ), coeffWet ) );
+		_mm512_storeu_ps( _wet + i, out );
+		squares = _mm512_add_ps( squares, _mm512_mul_ps( out, out ) );
+	}
+	float lanes[16];
+	_mm512_storeu_ps( lanes, squares );
+	double sum = 0.0;
+	for( int l = 0; l < 16; ++l )
+	{
+		sum += lanes[l];
+	}
+	return sum + mixDryWetTail( _wet, _dry, _coeffDry, _coeffWet, i, _n );
+}
+
+
+LMMS_AVX512 static bool isSilent( const float * _src, int _n )
+{
+	const __m512 threshold = _mm512_set1_ps( SilenceThreshold );
+	int i = 0;
+	for( ; i + 16 <= _n; i += 16 )
+	{
+		if( _mm512_cmp_ps_mask( absolute( _mm512_loadu_ps( _src + i ) ),
+							threshold, _CMP_GE_OQ ) )
+		{
+			return false;
+		}
+	}
+	for( ; i < _n; ++i )
+	{
+		if( fabsf( _src[i] ) >= SilenceThreshold )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+LMMS_AVX512 static bool hasNonFinite( const float * _src, int _n )
+{
+	const __m512 inf = _mm512_set1_ps( INFINITY );
+	int i = 0;
+	for( ; i + 16 <= _n; i += 16 )
+	{
+		if( _mm512_cmp_ps_mask( absolute( _mm512_loadu_ps( _src + i ) ),
+							inf, _CMP_NLT_UQ ) )
+		{
+			return true;
+		}
+	}
+	for( ; i < _n; ++i )
+	{
+		if( !isFinite( _src[i] ) )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+LMMS_AVX512 static void clamp( float * _buf, int _n )
+{
+	const __m512 low = _mm512_set1_ps( -SanitizeLimit );
+	const __m512 high = _mm512_set1_ps( SanitizeLimit );
+	int i = 0;
+	for( ; i + 16 <= _n; i += 16 )
+	{
+		_mm512_storeu_ps( _buf + i, _mm512_min_ps( _mm512_max_ps(
+				_mm512_loadu_ps( _buf + i ), low ), high ) );
+	}
+	for( ; i < _n; ++i )
+	{
+		_buf[i] = qBound( -SanitizeLimit, _buf[i], SanitizeLimit );
+	}
+}
+
+LMMS_AVX512 static void peak( const float * _src, int _n, float * _peaks )
+{
+	__m512 peaks = _mm512_setzero_ps();
+	int i = 0;
+	for( ; i + 16 <= _n; i += 16 )
+	{
+		peaks = _mm512_max_ps( absolute( _mm512_loadu_ps( _src + i ) ), peaks );
+	}
+	float lanes[16];
+	_mm512_storeu_ps( lanes, peaks );
+	reducePeaks( lanes, 16, _peaks );
+	peakTail( _src, i, _n, _peaks );
+}
+
+
+LMMS_AVX512 static bool sanitizeAndPeak( float * _buf, int _n, float * _peaks )
+{
+	const __m512 inf = _mm512_set1_ps( INFINITY );
+	const __m512 low = _mm512_set1_ps( -SanitizeLimit );
+	const __m512 high = _mm512_set1_ps( SanitizeLimit );
+	__mmask16 bad = 0;
+	__m512 peaks = _mm512_setzero_ps();
+	int i = 0;
+	for( ; i + 16 <= _n; i += 16 )
+	{
+		const __m512 x = _mm512_loadu_ps( _buf + i );
+		bad |= _mm512_cmp_ps_mask( absolute( x ), inf, _CMP_NLT_UQ );
+		const __m512 clamped = _mm512_min_ps( _mm512_max_ps( x, low ), high );
+		_mm512_storeu_ps( _buf + i, clamped );
+		peaks = _mm512_max_ps( absolute( clamped ), peaks );
+	}
+	float lanes[16];
+	_mm512_storeu_ps( lanes, peaks );
+	reducePeaks( lanes, 16, _peaks );
+	return sanitizeAndPeakTail( _buf, i, _n, _peaks, bad != 0 );
+}
+
+
+LMMS_AVX512 static void sumMultipliedByGains( float * _dst,
+				const sampleFrame * const * _srcs, int _count,
+				const float * _gains, int _n )
+{
+	int i = 0;
+	for( ; i + 16 <= _n; i += 16 )
+	{
+		__m512 sum = _mm512_loadu_ps( _srcs[0][0] + i );
+		for( int s = 1; s < _count; ++s )
+		{
+			sum = _mm512_add_ps( sum, _mm512_loadu_ps( _srcs[s][0] + i ) );
+		}
+		if( _gains )
+		{
+			sum = _mm512_mul_ps( sum, _mm512_loadu_ps( _gains + i ) );
+		}
+		_mm512_storeu_ps( _dst + i, sum );
+	}
+	sumTail( _dst, _srcs, _count, _gains, i, _n );
+}
+
+
+}
+
+#endif
+
+
+
+
+#ifdef LMMS_MIX_NEON
+
+namespace Neon
+{
+
+static void add( float * _dst, const float * _src, int _n )
+{
+	int i = 0;
+	for( ; i + 4 <= _n; i += 4 )
+	{
+		vst1q_f32( _dst + i, vaddq_f32( vld1q_f32( _dst + i ),
+						vld1q_f32( _src + i ) ) );
+	}
+	for( ; i < _n; ++i )
+	{
+		_dst[i] += _src[i];
+	}
+}
+
+
+static void addMultiplied( float * _dst, const float * _src,
+							float _coeff, int _n )
+{
+	const float32x4_t coeff = vdupq_n_f32( _coeff );
+	int i = 0;
+	for( ; i + 4 <= _n; i += 4 )
+	{
+		// no vmlaq_f32(), it may fuse the multiply and add
+		vst1q_f32( _dst + i, vaddq_f32( vld1q_f32( _dst + i ),
+				vmulq_f32( vld1q_f32( _src + i ), coeff ) ) );
+	}
+	for( ; i < _n; ++i )
+	{
+		_dst[i] += _src[i] * _coeff;
+	}
+}
+
+
+static void addSanitizedMultiplied( float * _dst, const float * _src,
+							float _coeff, int _n )
+{
+	const float32x4_t coeff = vdupq_n_f32( _coeff );
+	const float32x4_t inf = vdupq_n_f32( INFINITY );
+	int i = 0;
+	for( ; i + 4 <= _n; i += 4 )
+	{
+		const float32x4_t src = vld1q_f32( _src + i );
+		const uint32x4_t finite = vcltq_f32( vabsq_f32( src ), inf );
+		const float32x4_t product = vreinterpretq_f32_u32( vandq_u32(
+			finite, vreinterpretq_u32_f32( vmulq_f32( src, coeff ) ) ) );
+		vst1q_f32( _dst + i, vaddq_f32( vld1q_f32( _dst + i ), product ) );
+	}
+	for( ; i < _n; ++i )
+	{
+		_dst[i] += isFinite( _src[i] ) ? _src[i] * _coeff : 0.0f;
+	}
+}
+
+
+static double mixDryWet( float * _wet, const float * _dry,
+					float _coeffDry, float _coeffWet, int _n )
+{
+	const float32x4_t coeffDry = vdupq_n_f32( _coeffDry );
+	const float32x4_t coeffWet = vdupq_n_f32( _coeffWet );
+	float32x4_t squares = vdupq_n_f32( 0.0f );
+	int i = 0;
+	for( ; i + 4 <= _n; i += 4 )
+	{
+		const float32x4_t out = vaddq_f32(
+			vmulq_f32( vld1q_f32( _dry + i ), coeffDry ),
+			vmulq_f32( vld1q_f32( _wet + i ), coeffWet ) );
+		vst1q_f32( _wet + i, out );
+		squares = vaddq_f32( squares, vmulq_f32( out, out ) );
+	}
+	float lanes[4];
+	vst1q_f32( lanes, squares );
+	double sum = 0.0;
+	for( int l = 0; l < 4; ++l )
+	{
+		sum += lanes[l];
+	}
+	return sum + mixDryWetTail( _wet, _dry, _coeffDry, _coeffWet, i, _n );
+}
+
+
+static bool isSilent( const float * _src, int _n )
+{
+	const float32x4_t threshold = vdupq_n_f32( SilenceThreshold );
+	int i = 0;
+	for( ; i + 4 <= _n; i += 4 )
+	{
+		if( vmaxvq_u32( vcgeq_f32( vabsq_f32( vld1q_f32( _src + i ) ),
+								threshold ) ) )
+		{
+			return false;
+		}
+	}
+	for( ; i < _n; ++i )
+	{
+		if( fabsf( _src[i] ) >= SilenceThreshold )
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+static bool hasNonFinite( const float * _src, int _n )
+{
+	const float32x4_t inf = vdupq_n_f32( INFINITY );
+	int i = 0;
+	for( ; i + 4 <= _n; i += 4 )
+	{
+		// nans fail the comparison as well
+		if( vminvq_u32( vcltq_f32( vabsq_f32( vld1q_f32( _src + i ) ),
+								inf ) ) == 0 )
+		{
+			return true;
+		}
+	}
+	for( ; i < _n; ++i )
+	{
+		if( !isFinite( _src[i] ) )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+static void clamp( float * _buf, int _n )
+{
+	const float32x4_t low = vdupq_n_f32( -SanitizeLimit );
+	const float32x4_t high = vdupq_n_f32( SanitizeLimit );
+	int i = 0;
+	for( ; i + 4 <= _n; i += 4 )
+	{
+		vst1q_f32( _buf + i, vminq_f32( vmaxq_f32(
+					vld1q_f32( _buf + i ), low ), high ) );
+	}
+	for( ; i < _n; ++i )
+	{
+		_buf[i] = qBound( -SanitizeLimit, _buf[i], SanitizeLimit );
+	}
+}
+
+static void peak( const float * _src, int _n, float * _peaks )
+{
+	// vmaxnmq_f32() ignores nans
+	float32x4_t peaks = vdupq_n_f32( 0.0f );
+	int i = 0;
+	for( ; i + 4 <= _n; i += 4 )
+	{
+		peaks = vmaxnmq_f32( peaks, vabsq_f32( vld1q_f32( _src + i ) ) );
+	}
+	float lanes[4];
+	vst1q_f32( lanes, peaks );
+	reducePeaks( lanes, 4, _peaks );
+	peakTail( _src, i, _n, _peaks );
+}
+
+
+static bool sanitizeAndPeak( float * _buf, int _n, float * _peaks )
+{
+	const float32x4_t inf = vdupq_n_f32( INFINITY );
+	const float32x4_t low = vdupq_n_f32( -SanitizeLimit );
+	const float32x4_t high = vdupq_n_f32( SanitizeLimit );
+	uint32x4_t finite = vdupq_n_u32( 0xffffffff );
+	float32x4_t peaks = vdupq_n_f32( 0.0f );
+	int i = 0;
+	for( ; i + 4 <= _n; i += 4 )
+	{
+		const float32x4_t x = vld1q_f32( _buf + i );
+		finite = vandq_u32( finite, vcltq_f32( vabsq_f32( x ), inf ) );
+		const float32x4_t clamped = vminq_f32( vmaxq_f32( x, low ), high );
+		vst1q_f32( _buf + i, clamped );
+		peaks = vmaxnmq_f32( peaks, vabsq_f32( clamped ) );
+	}
+	float lanes[4];
+	vst1q_f32( lanes, peaks );
+	reducePeaks( lanes, 4, _peaks );
+	return sanitizeAndPeakTail( _buf, i, _n, _peaks,
+					vminvq_u32( finite ) == 0 );
+}
+
+
+static void sumMultipliedByGains( float * _dst, const sampleFrame * const * _srcs,
+				int _count, const float * _gains, int _n )
+{
+	int i = 0;
+	for( ; i + 4 <= _n; i += 4 )
+	{
+		float32x4_t sum = vld1q_f32( _srcs[0][0] + i );
+		for( int s = 1; s < _count; ++s )
+		{
+			sum = vaddq_f32( sum, vld1q_f32( _srcs[s][0] + i ) );
+		}
+		if( _gains )
+		{
+			sum = vmulq_f32( sum, vld1q_f32( _gains + i ) );
+		}
+		vst1q_f32( _dst + i, sum );
+	}
+	sumTail( _dst, _srcs, _count, _gains, i, _n );
+}
+
+
+static void stereoGains( float * _gains, const float * _volume,
+				float _volumeValue, const float * _panning,
+				float _panningValue, int _frames )
+{
+	const float32x4_t one = vdupq_n_f32( 1.0f );
+	const float32x4_t percent = vdupq_n_f32( 0.01f );
+	int f = 0;
+	for( ; f + 4 <= _frames; f += 4 )
+	{
+		const float32x4_t v = vmulq_f32( _volume ? vld1q_f32( _volume + f ) :
+					vdupq_n_f32( _volumeValue ), percent );
+		const float32x4_t p = vmulq_f32( _panning ? vld1q_f32( _panning + f ) :
+					vdupq_n_f32( _panningValue ), percent );
+		float32x4x2_t gains;
+		gains.val[0] = vmulq_f32( vminq_f32( one, vsubq_f32( one, p ) ), v );
+		gains.val[1] = vmulq_f32( vminq_f32( one, vaddq_f32( one, p ) ), v );
+		// interleaves left and right
+		vst2q_f32( _gains + f * 2, gains );
+	}
+	stereoGainsTail( _gains, _volume, _volumeValue, _panning, _panningValue,
+								f, _frames );
+}
+
+
+
+static inline void polyphaseDot( const float * _src, const float * _coeffs,
+						int _taps, float * _out )
+{
+	float32x4_t acc0 = vdupq_n_f32( 0.0f );
+	float32x4_t acc1 = vdupq_n_f32( 0.0f );
+	for( int i = 0; i < _taps * 2; i += 8 )
+	{
+		acc0 = vaddq_f32( acc0, vmulq_f32( vld1q_f32( _src + i ),
+					vld1q_f32( _coeffs + i ) ) );
+		acc1 = vaddq_f32( acc1, vmulq_f32( vld1q_f32( _src + i + 4 ),
+					vld1q_f32( _coeffs + i + 4 ) ) );
+	}
+	float lanes[8];
+	vst1q_f32( lanes, acc0 );
+	vst1q_f32( lanes + 4, acc1 );
+	reducePolyphase( lanes, _out );
+}
+
+
+static void polyphase( float * _dst, const float * _src,
+				const float * _bank, int _taps, int _phases,
+				double _position, double _step, int _frames )
+{
+	for( int f = 0; f < _frames; ++f )
+	{
+		int index, row;
+		float weight;
+		polyphasePosition( _position, _step, f, _phases, index, row,
+									weight );
+		const float * src = _src + index * 2;
+		float * dst = _dst + f * 2;
+		polyphaseDot( src, _bank + row * _taps * 2, _taps, dst );
+		if( weight != 0.0f )
+		{
+			float next[2];
+			polyphaseDot( src, _bank + ( row + 1 ) * _taps * 2, _taps,
+									next );
+			blendPolyphase( dst, next, weight );
+		}
+	}
+}
+
+
+}
+
+#endif
+
+
+
+
+namespace MixHelpers
+{
+
+static const SimdKernels * selectSimdKernels()
+{
+#ifdef LMMS_MIX_X86
+	static const SimdKernels sse2 = { "SSE2", Sse2::add, Sse2::addMultiplied,
+		Sse2::addSanitizedMultiplied, Sse2::mixDryWet, Sse2::isSilent,
+		Sse2::hasNonFinite, Sse2::clamp,
+		Sse2::peak, Sse2::sanitizeAndPeak,
+		Sse2::sumMultipliedByGains, Sse2::stereoGains,
+		Sse2::polyphase };
+	static const SimdKernels avx2 = { "AVX2", Avx2::add, Avx2::addMultiplied,
+		Avx2::addSanitizedMultiplied, Avx2::mixDryWet, Avx2::isSilent,
+		Avx2::hasNonFinite, Avx2::clamp,
+		Avx2::peak, Avx2::sanitizeAndPeak,
+		Avx2::sumMultipliedByGains, Sse2::stereoGains,
+		Avx2::polyphase };
+	static const SimdKernels avx512 = { "AVX-512", Avx512::add,
+		Avx512::addMultiplied, Avx512::addSanitizedMultiplied,
+		Avx512::mixDryWet, Avx512::isSilent, Avx512::hasNonFinite, Avx512::clamp,
+		Avx512::peak, Avx512::sanitizeAndPeak,
+		Avx512::sumMultipliedByGains, Sse2::stereoGains,
+		Avx2::polyphase };
+
+	// we may run before the constructor which initializes the CPU model
+	__builtin_cpu_init();
+	if( __builtin_cpu_supports( "avx512f" ) )
+	{
+		return &avx512;
+	}
+	if( __builtin_cpu_supports( "avx2" ) )
+	{
+		return &avx2;
+	}
+	if( __builtin_cpu_supports( "sse2" ) )
+	{
+		return &sse2;
+	}
+#elif defined( LMMS_MIX_NEON )
+	static const SimdKernels neon = { "NEON", Neon::add, Neon::addMultiplied,
+		Neon::addSanitizedMultiplied, Neon::mixDryWet, Neon::isSilent,
+		Neon::hasNonFinite, Neon::clamp,
+		Neon::peak, Neon::sanitizeAndPeak,
+		Neon::sumMultipliedByGains, Neon::stereoGains,
+		Neon::polyphase };
+	return &neon;
+#endif
+	return NULL;
+}
+
+
+
+
+const SimdKernels * detectedSimdKernels()
+{
+	static const SimdKernels * kernels = selectSimdKernels();
+	return kernels;
+}
+
+}
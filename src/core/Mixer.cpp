@@ -24,6 +24,8 @@
 
 #include "Mixer.h"
 
+#include <algorithm>
+
 #include "denormals.h"
 
 #include "lmmsconfig.h"
@@ -35,8 +37,15 @@
 #include "EnvelopeAndLfoParameters.h"
 #include "NotePlayHandle.h"
 #include "ConfigManager.h"
-#include "SamplePlayHandle.h"
+#include "Engine.h"
 #include "MemoryHelper.h"
+#include "MemoryManager.h"
+#include "Metronome.h"
+#include "MixHelpers.h"
+#include "RealtimeChecker.h"
+#include "ScratchArena.h"
+#include "TraceRecorder.h"
+#include "ValueBuffer.h"
 
 // platform-specific audio-interface-classes
 #include "AudioAlsa.h"
@@ -66,40 +75,79 @@ typedef LocklessList<PlayHandle *>::Element LocklessListElement;
 
 static thread_local bool s_renderingThread;
 
+// overload measures get taken one by one while the estimated share of a
+// period rendering takes stays above OverloadHigh, and undone one by one
+// once it stayed below OverloadLow for OverloadRecoverTime milliseconds
+static const float OverloadHigh = 0.9f;
+static const float OverloadLow = 0.6f;
+static const int OverloadEscalatePeriods = 8;
+static const int OverloadRecoverTime = 1000;
+
 
 
 
 Mixer::Mixer( bool renderOnly ) :
 	m_renderOnly( renderOnly ),
 	m_framesPerPeriod( DEFAULT_BUFFER_SIZE ),
-	m_inputBufferRead( 0 ),
-	m_inputBufferWrite( 1 ),
+	m_inputRing( InputBufferSize ),
+	m_inputReader( m_inputRing ),
+	m_inputBuffer( new sampleFrame[InputBufferSize] ),
+	m_inputBufferFrames( 0 ),
 	m_readBuf( NULL ),
 	m_writeBuf( NULL ),
 	m_workers(),
 	m_numWorkers( QThread::idealThreadCount()-1 ),
+	m_context( Engine::context() ),
+	m_holdsWorkers( false ),
+	m_renderGraph( false ),
+	m_anticipativeRendering( false ),
+	m_anticipativeJobsRunning( false ),
+	m_addingAheadPlayHandles( false ),
+	m_overloadPolicy( 0 ),
+	m_overloadMeasures( 0 ),
+	m_overloadPeriods( 0 ),
+	m_noteLimit( 0 ),
 	m_newPlayHandles( PlayHandle::MaxNumber ),
+	m_playHandleSlots(),
+	m_freePlayHandleSlot( -1 ),
+	m_playHandlesToRemove(),
 	m_qualitySettings( qualitySettings::Mode_Draft ),
 	m_masterGain( 1.0f ),
 	m_isProcessing( false ),
 	m_audioDev( NULL ),
 	m_oldAudioDev( NULL ),
 	m_audioDevStartFailed( false ),
+	m_announcedSampleRate( 0 ),
 	m_profiler(),
+	m_renderStats( RenderStatsBufferSize ),
+	m_periodsRendered( 0 ),
+	m_memoryHighWater( 0 ),
 	m_metronomeActive(false),
+	m_metronome( NULL ),
 	m_clearSignal( false ),
 	m_changesSignal( false ),
 	m_changes( 0 ),
 	m_doChangesMutex( QMutex::Recursive ),
-	m_waitingForWrite( false )
+	m_waitingForWrite( false ),
+	m_queuedChanges( nullptr ),
+	m_appliedChanges( nullptr ),
+	m_audioThreadStopped( true )
 {
-	for( int i = 0; i < 2; ++i )
+	// avoid allocations in the audio thread when adding play handles
+	m_playHandles.reserve( PlayHandle::MaxNumber );
+	m_playHandleSlots.reserve( PlayHandle::MaxNumber );
+	m_playHandlesToRemove.reserve( PlayHandle::MaxNumber );
+	m_jobOrder.reserve( PlayHandle::MaxNumber );
+
+	// room for the peaks of the usual number of FX channels up front
+	m_snapshot.forEach( []( Snapshot & _snapshot )
 	{
-		m_inputBufferFrames[i] = 0;
-		m_inputBufferSize[i] = DEFAULT_BUFFER_SIZE * 100;
-		m_inputBuffer[i] = new sampleFrame[ DEFAULT_BUFFER_SIZE * 100 ];
-		BufferManager::clear( m_inputBuffer[i], m_inputBufferSize[i] );
-	}
+		_snapshot = Snapshot();
+		_snapshot.fxPeaks.reserve( SnapshotChannels );
+	} );
+	m_heldPeaks.reserve( SnapshotChannels );
+
+	BufferManager::clear( m_inputBuffer, InputBufferSize );
 
 	// determine FIFO size and number of frames per period
 	int fifoSize = 1;
@@ -130,11 +178,22 @@ Mixer::Mixer( bool renderOnly ) :
 		}
 	}
 
+	// the mixer of a further engine context shares the buffer pools and
+	// the worker threads of the first one, so its period size applies
+	const bool sharesWorkers = MixerWorkerThread::threadCount() > 0;
+	if( sharesWorkers )
+	{
+		m_framesPerPeriod = BufferManager::framesPerPeriod();
+		m_numWorkers = 0;
+	}
+
 	// allocte the FIFO from the determined size
-	m_fifo = new fifo( fifoSize );
+	m_fifo = new fifo( fifoSize, m_framesPerPeriod );
 
 	// now that framesPerPeriod is fixed initialize global BufferManager
-	BufferManager::init( m_framesPerPeriod );
+	BufferManager::init( m_framesPerPeriod,
+		ConfigManager::inst()->value( "mixer", "hugepages" ).toInt() );
+	ValueBuffer::initPool( m_framesPerPeriod );
 
 	for( int i = 0; i < 3; i++ )
 	{
@@ -146,7 +205,30 @@ Mixer::Mixer( bool renderOnly ) :
 		m_bufferPool.push_back( m_readBuf );
 	}
 
-	for( int i = 0; i < m_numWorkers+1; ++i )
+	m_renderGraph = ConfigManager::inst()->value( "mixer", "rendergraph" ).toInt();
+	m_anticipativeRendering = ConfigManager::inst()->value( "mixer", "anticipative" ).toInt();
+	m_overloadPolicy = ConfigManager::inst()->value( "mixer", "overloadpolicy" ).toInt();
+	m_realtimeThreads = ConfigManager::inst()->value( "mixer", "realtimethreads" ).toInt();
+	m_pinThreads = ConfigManager::inst()->value( "mixer", "pinthreads" ).toInt();
+
+	if( !sharesWorkers )
+	{
+		MixerWorkerThread::setScheduler(
+			ConfigManager::inst()->value( "mixer", "workstealing" ).toInt() ?
+				MixerWorkerThread::Scheduler::WorkStealing :
+				MixerWorkerThread::Scheduler::GlobalQueue );
+		MixerWorkerThread::setSpinTime( ConfigManager::inst()->value( "mixer",
+				"spintime", QString::number(
+					MixerWorkerThread::DefaultSpinTime ) ).toInt() );
+	}
+
+	m_idleTrimTimer.setSingleShot( true );
+	m_idleTrimTimer.setInterval( 1000 * ConfigManager::inst()->value(
+					"mixer", "idletrim", "60" ).toInt() );
+	connect( &m_idleTrimTimer, SIGNAL( timeout() ),
+					this, SLOT( trimMemory() ) );
+
+	for( int i = 0; !sharesWorkers && i < m_numWorkers+1; ++i )
 	{
 		MixerWorkerThread * wt = new MixerWorkerThread( this );
 		if( i < m_numWorkers )
@@ -155,6 +237,10 @@ Mixer::Mixer( bool renderOnly ) :
 		}
 		m_workers.push_back( wt );
 	}
+	if( !sharesWorkers && ( m_realtimeThreads || m_pinThreads ) )
+	{
+		setupRenderThreads( false );
+	}
 
 	m_poolDepth = 2;
 	m_readBuffer = 0;
@@ -167,25 +253,30 @@ Mixer::Mixer( bool renderOnly ) :
 Mixer::~Mixer()
 {
 	runChangesInModel();
+	applyQueuedChanges();
+	reclaimAppliedChanges();
 
 	for( int w = 0; w < m_numWorkers; ++w )
 	{
 		m_workers[w]->quit();
 	}
 
-	MixerWorkerThread::startAndWaitForJobs();
+	if( !m_workers.isEmpty() )
+	{
+		MixerWorkerThread::startAndWaitForJobs();
+	}
 
 	for( int w = 0; w < m_numWorkers; ++w )
 	{
 		m_workers[w]->wait( 500 );
 	}
 
-	while( m_fifo->available() )
-	{
-		delete[] m_fifo->read();
-	}
+	delete m_metronome;
+
 	delete m_fifo;
 
+	// it would call into the backend while it's being destroyed
+	m_midiClient->stopOutputThread();
 	delete m_midiClient;
 	delete m_audioDev;
 
@@ -194,10 +285,7 @@ Mixer::~Mixer()
 		MemoryHelper::alignedFree( m_bufferPool[i] );
 	}
 
-	for( int i = 0; i < 2; ++i )
-	{
-		delete[] m_inputBuffer[i];
-	}
+	delete[] m_inputBuffer;
 }
 
 
@@ -214,7 +302,9 @@ void Mixer::initDevices()
 	} else {
 		m_audioDev = tryAudioDevices();
 		m_midiClient = tryMidiClients();
+		m_midiClient->startOutputThread();
 	}
+	m_announcedSampleRate = processingSampleRate();
 }
 
 
@@ -222,7 +312,9 @@ void Mixer::initDevices()
 
 void Mixer::startProcessing( bool _needs_fifo )
 {
-	if( _needs_fifo )
+	m_audioThreadStopped = false;
+
+	if( _needs_fifo && !m_audioDev->rendersInCallback() )
 	{
 		m_fifoWriter = new fifoWriter( this, m_fifo );
 		m_fifoWriter->start( QThread::HighPriority );
@@ -240,6 +332,28 @@ void Mixer::startProcessing( bool _needs_fifo )
 
 
 
+void Mixer::setupRenderThreads( bool _offline )
+{
+	if( _offline )
+	{
+		// don't compete with the rest of the system when exporting but
+		// make use of cores reserved via isolcpus if there are any
+		MixerWorkerThread::setThreadPolicy( ThreadPriority::Policy::Normal,
+					ThreadPriority::isolatedCores() );
+	}
+	else
+	{
+		MixerWorkerThread::setThreadPolicy( m_realtimeThreads ?
+					ThreadPriority::Policy::RealTime :
+					ThreadPriority::Policy::High,
+				m_pinThreads ? ThreadPriority::allCores() :
+							QVector<int>() );
+	}
+}
+
+
+
+
 void Mixer::stopProcessing()
 {
 	m_isProcessing = false;
@@ -256,6 +370,28 @@ void Mixer::stopProcessing()
 	{
 		m_audioDev->stopProcessing();
 	}
+	finishAnticipativeJobs();
+	if( m_holdsWorkers )
+	{
+		MixerWorkerThread::releaseWorkers();
+		m_holdsWorkers = false;
+	}
+
+	// leave a trace of playback problems on the console, e.g. for
+	// headless sessions and bug reports
+	const AudioDevice::Statistics stats = m_audioDev->statistics();
+	if( stats.xruns > 0 || stats.latePeriods > 0 )
+	{
+		printf( "%s: %s\n", m_audioDevName.toUtf8().constData(),
+			m_audioDev->statisticsText().toUtf8().constData() );
+	}
+
+	// nobody renders anymore, so apply what's left in the queue ourselves
+	m_changeQueueMutex.lock();
+	m_audioThreadStopped = true;
+	applyQueuedChanges();
+	m_changeQueueMutex.unlock();
+	reclaimAppliedChanges();
 }
 
 
@@ -311,29 +447,79 @@ bool Mixer::criticalXRuns() const
 
 void Mixer::pushInputFrames( sampleFrame * _ab, const f_cnt_t _frames )
 {
-	requestChangeInModel();
+	m_inputRing.write( _ab, _frames );
+}
 
-	f_cnt_t frames = m_inputBufferFrames[ m_inputBufferWrite ];
-	int size = m_inputBufferSize[ m_inputBufferWrite ];
-	sampleFrame * buf = m_inputBuffer[ m_inputBufferWrite ];
 
-	if( frames + _frames > size )
+
+
+void Mixer::registerPlayHandle( PlayHandle * handle )
+{
+	int slot = m_freePlayHandleSlot;
+	if( slot >= 0 )
 	{
-		size = qMax( size * 2, frames + _frames );
-		sampleFrame * ab = new sampleFrame[ size ];
-		memcpy( ab, buf, frames * sizeof( sampleFrame ) );
-		delete [] buf;
+		m_freePlayHandleSlot = m_playHandleSlots[slot].index;
+	}
+	else
+	{
+		slot = m_playHandleSlots.size();
+		m_playHandleSlots.append( PlayHandleSlot{ 0, 0 } );
+	}
+
+	m_playHandleSlots[slot].index = m_playHandles.size();
+	handle->m_mixerSlot = slot;
+	m_playHandles.append( handle );
+}
+
+
 
-		m_inputBufferSize[ m_inputBufferWrite ] = size;
-		m_inputBuffer[ m_inputBufferWrite ] = ab;
 
-		buf = ab;
+void Mixer::releasePlayHandle( PlayHandle * handle )
+{
+	const int slot = handle->m_mixerSlot;
+	// invalidate pending removal requests and put slot on the free list
+	++m_playHandleSlots[slot].generation;
+	m_playHandleSlots[slot].index = m_freePlayHandleSlot;
+	m_freePlayHandleSlot = slot;
+	handle->m_mixerSlot = -1;
+
+	handle->audioPort()->removePlayHandle( handle );
+	if( handle->type() == PlayHandle::TypeNotePlayHandle )
+	{
+		NotePlayHandleManager::release( (NotePlayHandle*) handle );
 	}
+	else delete handle;
+}
 
-	memcpy( &buf[ frames ], _ab, _frames * sizeof( sampleFrame ) );
-	m_inputBufferFrames[ m_inputBufferWrite ] += _frames;
 
-	doneChangeInModel();
+
+
+template<typename F>
+void Mixer::removePlayHandlesIf( F _remove )
+{
+	// single compaction pass, NULL entries are handles released already
+	int kept = 0;
+	for( int i = 0; i < m_playHandles.size(); ++i )
+	{
+		PlayHandle * handle = m_playHandles[i];
+		if( handle == NULL )
+		{
+			continue;
+		}
+		if( _remove( handle ) )
+		{
+			releasePlayHandle( handle );
+			continue;
+		}
+		if( kept != i )
+		{
+			m_playHandles[kept] = handle;
+			m_playHandleSlots[handle->m_mixerSlot].index = kept;
+		}
+		++kept;
+	}
+	// shrinking a QList never reallocates
+	m_playHandles.erase( m_playHandles.begin() + kept, m_playHandles.end() );
 }
 
 
@@ -341,11 +527,31 @@ void Mixer::pushInputFrames( sampleFrame * _ab, const f_cnt_t _frames )
 
 const surroundSampleFrame * Mixer::renderNextBuffer()
 {
+	TraceRecorder::Zone zone( "Mixer::renderNextBuffer" );
+	// allocates only the first time, which doesn't count as violation here
+	ScratchArena::prepareThread();
+	RealtimeChecker::RenderScope realtimeScope;
+	LmmsCore::ContextScope contextScope( m_context );
+
 	m_profiler.startPeriod();
 
 	s_renderingThread = true;
 
-	static Song::PlayPos last_metro_pos = -1;
+	if( !m_holdsWorkers )
+	{
+		// kept while jobs rendering ahead are running
+		MixerWorkerThread::acquireWorkers();
+		m_holdsWorkers = true;
+	}
+
+	{
+		TraceRecorder::Zone waitZone( "Mixer::finishAnticipativeJobs" );
+		finishAnticipativeJobs();
+	}
+
+	applyQueuedChanges();
+
+	Engine::updatePeriodFramesPerTick();
 
 	Song *song = Engine::getSong();
 
@@ -356,31 +562,29 @@ const surroundSampleFrame * Mixer::renderNextBuffer()
 					 currentPlayMode == Song::Mode_PlaySong ||
 					 currentPlayMode == Song::Mode_PlayBB;
 
-	if( playModeSupportsMetronome && m_metronomeActive && !song->isExporting() &&
-		p != last_metro_pos &&
+	if( playModeSupportsMetronome && m_metronomeActive && m_metronome &&
+		!song->isExporting() &&
 			// Stop crash with metronome if empty project
 				Engine::getSong()->countTracks() )
 	{
-		tick_t ticksPerBar = MidiTime::ticksPerBar();
-		if ( p.getTicks() % ( ticksPerBar / 1 ) == 0 )
-		{
-			addPlayHandle( new SamplePlayHandle( "misc/metronome02.ogg" ) );
-		}
-		else if ( p.getTicks() % ( ticksPerBar /
-			song->getTimeSigModel().getNumerator() ) == 0 )
+		m_metronome->processPeriod( p.getTicks(), p.currentFrame(),
+				MidiTime::ticksPerBar(),
+				song->getTimeSigModel().getNumerator(),
+				Engine::periodFramesPerTick() );
+	}
+
+	// take what has been captured since the last period
+	{
+		auto captured = m_inputReader.read_max( qMin<std::size_t>(
+				m_inputReader.read_space(), InputBufferSize ) );
+		m_inputBufferFrames = captured.size();
+		for( f_cnt_t f = 0; f < m_inputBufferFrames; ++f )
 		{
-			addPlayHandle( new SamplePlayHandle( "misc/metronome01.ogg" ) );
+			m_inputBuffer[f][0] = captured[f][0];
+			m_inputBuffer[f][1] = captured[f][1];
 		}
-		last_metro_pos = p;
 	}
 
-	// swap buffer
-	m_inputBufferWrite = ( m_inputBufferWrite + 1 ) % 2;
-	m_inputBufferRead =  ( m_inputBufferRead + 1 ) % 2;
-
-	// clear new write buffer
-	m_inputBufferFrames[ m_inputBufferWrite ] = 0;
-
 	if( m_clearSignal )
 	{
 		m_clearSignal = false;
@@ -388,25 +592,24 @@ const surroundSampleFrame * Mixer::renderNextBuffer()
 	}
 
 	// remove all play-handles that have to be deleted and delete
-	// them if they still exist...
-	// maybe this algorithm could be optimized...
-	ConstPlayHandleList::Iterator it_rem = m_playHandlesToRemove.begin();
-	while( it_rem != m_playHandlesToRemove.end() )
+	// them if they still exist - requests whose slot has been freed in
+	// the meantime are stale and get ignored
+	if( !m_playHandlesToRemove.isEmpty() )
 	{
-		PlayHandleList::Iterator it = std::find( m_playHandles.begin(), m_playHandles.end(), *it_rem );
-
-		if( it != m_playHandles.end() )
+		for( const PlayHandleKey & key : m_playHandlesToRemove )
 		{
-			( *it )->audioPort()->removePlayHandle( ( *it ) );
-			if( ( *it )->type() == PlayHandle::TypeNotePlayHandle )
+			const PlayHandleSlot & slot = m_playHandleSlots[key.slot];
+			if( slot.generation == key.generation )
 			{
-				NotePlayHandleManager::release( (NotePlayHandle*) *it );
+				PlayHandle * handle = m_playHandles[slot.index];
+				m_playHandles[slot.index] = NULL;
+				releasePlayHandle( handle );
 			}
-			else delete *it;
-			m_playHandles.erase( it );
 		}
+		m_playHandlesToRemove.clear();
 
-		it_rem = m_playHandlesToRemove.erase( it_rem );
+		// close the gaps left behind
+		removePlayHandlesIf( []( PlayHandle * ) { return false; } );
 	}
 
 	// rotate buffers
@@ -419,62 +622,107 @@ const surroundSampleFrame * Mixer::renderNextBuffer()
 	// clear last audio-buffer
 	BufferManager::clear( m_writeBuf, m_framesPerPeriod );
 
+	// the FX mixer renders the master channel into the period buffer and
+	// the devices take it from there, no frames are widened in between
+	static_assert( sizeof( surroundSampleFrame ) == sizeof( sampleFrame ),
+			"the output stage is stereo, see LMMS_DISABLE_SURROUND" );
+
 	// prepare master mix (clear internal buffers etc.)
 	FxMixer * fxMixer = Engine::fxMixer();
-	fxMixer->prepareMasterMix();
+	fxMixer->prepareMasterMix( m_audioPorts );
+
+	// output of ports which have been rendered during the last period
+	for( AudioPort * port : m_audioPorts )
+	{
+		port->mixAheadOutput();
+	}
+
+	m_profiler.finishStage( MixerProfiler::Cleanup );
+
+	// notes played on MIDI devices during the last period
+	m_midiClient->processQueuedInEvents( m_framesPerPeriod,
+						processingSampleRate() );
 
 	// create play-handles for new notes, samples etc.
 	song->processNextBuffer();
 
+	m_profiler.finishStage( MixerProfiler::SongProcessing );
+
 	// add all play-handles that have to be added
 	for( LocklessListElement * e = m_newPlayHandles.popList(); e; )
 	{
-		m_playHandles += e->value;
+		registerPlayHandle( e->value );
 		LocklessListElement * next = e->next;
 		m_newPlayHandles.free( e );
 		e = next;
 	}
 
-	// STAGE 1: run and render all play handles
-	MixerWorkerThread::fillJobQueue<PlayHandleList>( m_playHandles );
-	MixerWorkerThread::startAndWaitForJobs();
+	if( overloadMeasures() & StealNotes )
+	{
+		stealNotes();
+	}
+
+	m_profiler.finishStage( MixerProfiler::Cleanup );
 
-	// removed all play handles which are done
-	for( PlayHandleList::Iterator it = m_playHandles.begin();
-						it != m_playHandles.end(); )
+	if( m_renderGraph )
 	{
-		if( ( *it )->affinityMatters() &&
-			( *it )->affinity() != QThread::currentThread() )
-		{
-			++it;
-			continue;
-		}
-		if( ( *it )->isFinished() )
+		// STAGES 1-3 in one go: play handles, effects of all instrument-
+		// and sampletracks and FX channels are processed as soon as
+		// their inputs are ready
+		TraceRecorder::Zone graphZone( "Mixer::runRenderGraph" );
+		runRenderGraph();
+		removeFinishedPlayHandles();
+		fxMixer->finishMasterMix( m_writeBuf );
+		m_profiler.finishStage( MixerProfiler::PlayHandles );
+	}
+	else
+	{
+		// STAGE 1: run and render all play handles
 		{
-			( *it )->audioPort()->removePlayHandle( ( *it ) );
-			if( ( *it )->type() == PlayHandle::TypeNotePlayHandle )
+			TraceRecorder::Zone stageZone( "Mixer stage 1: play handles" );
+			MixerWorkerThread::resetJobQueue();
+			m_jobBatcher.reset( jobBatchBudget() );
+			forEachJobHeaviestFirst( m_playHandles, [this]( PlayHandle * handle )
 			{
-				NotePlayHandleManager::release( (NotePlayHandle*) *it );
-			}
-			else delete *it;
-			it = m_playHandles.erase( it );
+				if( !renderedAhead( handle ) )
+				{
+					m_jobBatcher.addJob( handle );
+				}
+			} );
+			m_jobBatcher.flush();
+			// the later stages of FX channels only depend on the last
+			// period, so they can run along with the play handles
+			fxMixer->queuePipelineStages();
+			MixerWorkerThread::startAndWaitForJobs();
+
+			removeFinishedPlayHandles();
 		}
-		else
+		m_profiler.finishStage( MixerProfiler::PlayHandles );
+
+		// STAGE 2: process effects of all instrument- and sampletracks
 		{
-			++it;
+			TraceRecorder::Zone stageZone( "Mixer stage 2: audio ports" );
+			MixerWorkerThread::resetJobQueue();
+			m_jobBatcher.reset( jobBatchBudget() );
+			forEachJobHeaviestFirst( m_audioPorts, [this]( AudioPort * port )
+			{
+				if( !port->renderedAhead() )
+				{
+					m_jobBatcher.addJob( port );
+				}
+			} );
+			m_jobBatcher.flush();
+			MixerWorkerThread::startAndWaitForJobs();
 		}
-	}
+		m_profiler.finishStage( MixerProfiler::AudioPorts );
 
-	// STAGE 2: process effects of all instrument- and sampletracks
-	MixerWorkerThread::fillJobQueue<QVector<AudioPort *> >( m_audioPorts );
-	MixerWorkerThread::startAndWaitForJobs();
-
-
-	// STAGE 3: do master mix in FX mixer
-	fxMixer->masterMix( m_writeBuf );
+		// STAGE 3: do master mix in FX mixer
+		fxMixer->masterMix( m_writeBuf );
+		m_profiler.finishStage( MixerProfiler::MasterMix );
+	}
 
 
-	emit nextAudioBuffer( m_readBuf );
+	m_masterTap.write( m_readBuf, m_framesPerPeriod );
 
 	runChangesInModel();
 
@@ -483,9 +731,23 @@ const surroundSampleFrame * Mixer::renderNextBuffer()
 	Controller::triggerFrameCounter();
 	AutomatableModel::incrementPeriodCounter();
 
+	// everything the next period depends on is up to date now
+	startAnticipativeJobs();
+
+	if( !m_anticipativeJobsRunning )
+	{
+		MixerWorkerThread::releaseWorkers();
+		m_holdsWorkers = false;
+	}
+
 	s_renderingThread = false;
 
-	m_profiler.finishPeriod( processingSampleRate(), m_framesPerPeriod );
+	m_profiler.finishStage( MixerProfiler::ModelChanges );
+	m_profiler.finishPeriod( processingSampleRate(), m_framesPerPeriod,
+					MixerWorkerThread::threadCount() );
+	updateOverloadMeasures();
+	publishRenderStats();
+	publishSnapshot();
 
 	return m_readBuf;
 }
@@ -493,6 +755,268 @@ const surroundSampleFrame * Mixer::renderNextBuffer()
 
 
 
+void Mixer::runRenderGraph()
+{
+	// The graph is NotePlayHandle -> AudioPort -> FxChannel -> master.
+	// Each job notifies its successor when done (see ThreadableJob)
+	// and the successor queues itself once all of its inputs are done,
+	// so e.g. a slow play handle on one track doesn't delay the effects
+	// of all other tracks.
+	MixerWorkerThread::resetJobQueue( MixerWorkerThread::JobQueue::Dynamic );
+	m_jobBatcher.reset( jobBatchBudget() );
+
+	// FX channels wait for their senders and the audio ports feeding them
+	Engine::fxMixer()->prepareRenderGraph( m_audioPorts );
+
+	// audio ports wait for their play handles - every port holds back one
+	// pending input so it can't be queued while play handles are still
+	// being added
+	for( AudioPort * port : m_audioPorts )
+	{
+		if( !port->renderedAhead() )
+		{
+			port->prepareRenderGraph();
+		}
+	}
+
+	forEachJobHeaviestFirst( m_playHandles, [this]( PlayHandle * handle )
+	{
+		if( renderedAhead( handle ) )
+		{
+			return;
+		}
+		AudioPort * port = handle->audioPort();
+		port->addPendingPlayHandle();
+		handle->setSuccessor( port );
+		if( !m_jobBatcher.addJob( handle ) )
+		{
+			handle->setSuccessor( nullptr );
+			port->removePendingPlayHandle();
+		}
+	} );
+	m_jobBatcher.flush();
+	// the play handles start the path to the master channel, the later
+	// stages of FX channels only depend on the last period
+	Engine::fxMixer()->queuePipelineStages();
+
+	for( AudioPort * port : m_audioPorts )
+	{
+		if( !port->renderedAhead() )
+		{
+			port->finishRenderGraphSetup();
+		}
+	}
+
+	MixerWorkerThread::startAndWaitForJobs();
+}
+
+
+
+
+bool Mixer::renderedAhead( PlayHandle * _handle )
+{
+	return _handle->m_aheadOfPeriod || _handle->audioPort()->renderedAhead();
+}
+
+
+
+
+template<class T, class F>
+void Mixer::forEachJobHeaviestFirst( const T & _jobs, F _queue )
+{
+	if( MixerWorkerThread::threadCount() <= 1 )
+	{
+		for( auto job : _jobs )
+		{
+			_queue( job );
+		}
+		return;
+	}
+
+	// longest processing time first - the last periods took about as
+	// long as this one will
+	m_jobOrder.clear();
+	for( auto job : _jobs )
+	{
+		m_jobOrder.push_back( std::make_pair( criticalPath( job ), job ) );
+	}
+	std::sort( m_jobOrder.begin(), m_jobOrder.end(),
+		[]( const std::pair<float, ThreadableJob *> & _a,
+			const std::pair<float, ThreadableJob *> & _b )
+		{
+			return _a.first > _b.first;
+		} );
+
+	// the global queue is processed in order, while the work stealing
+	// threads pop the jobs added last to their deques first
+	typedef typename T::value_type Job;
+	if( MixerWorkerThread::currentScheduler() ==
+				MixerWorkerThread::Scheduler::GlobalQueue )
+	{
+		for( auto it = m_jobOrder.begin(); it != m_jobOrder.end(); ++it )
+		{
+			_queue( static_cast<Job>( it->second ) );
+		}
+	}
+	else
+	{
+		for( auto it = m_jobOrder.rbegin(); it != m_jobOrder.rend(); ++it )
+		{
+			_queue( static_cast<Job>( it->second ) );
+		}
+	}
+}
+
+
+
+
+float Mixer::criticalPath( ThreadableJob * _job ) const
+{
+	return _job->cpuUsage().average();
+}
+
+
+
+
+float Mixer::criticalPath( PlayHandle * _handle ) const
+{
+	// the effects of the audio port can only start once the play handle
+	// is done in the render graph
+	float time = _handle->cpuUsage().average();
+	if( m_renderGraph && _handle->audioPort() )
+	{
+		time += _handle->audioPort()->cpuUsage().average();
+	}
+	return time;
+}
+
+
+
+
+float Mixer::jobBatchBudget() const
+{
+	const int threads = MixerWorkerThread::threadCount();
+	if( threads <= 1 )
+	{
+		return 0.0f;
+	}
+
+	// an eighth of what each thread has to do if the period's time is
+	// spread evenly, which leaves enough jobs to balance the threads
+	return m_framesPerPeriod * 1000000.0f / processingSampleRate() /
+								( 8 * threads );
+}
+
+
+
+
+void Mixer::startAnticipativeJobs()
+{
+	// Tracks without live input are played one period ahead by the song
+	// (see Song::processNextBuffer()), so their ports can render the next
+	// period right away on otherwise idle worker threads while the audio
+	// device is busy with this one. Their output gets mixed at the start of
+	// the next period which then only has to wait for the live tracks and
+	// the FX mixer.
+	bool anticipate = false;
+	for( AudioPort * port : m_audioPorts )
+	{
+		port->m_renderedAhead = port->isAnticipative();
+		anticipate |= port->m_renderedAhead;
+	}
+
+	for( PlayHandle * handle : m_playHandles )
+	{
+		handle->m_aheadOfPeriod = false;
+	}
+
+	if( !anticipate )
+	{
+		return;
+	}
+
+	// same graph as in runRenderGraph() but without the FX channels
+	MixerWorkerThread::resetJobQueue( MixerWorkerThread::JobQueue::Dynamic );
+	m_jobBatcher.reset( jobBatchBudget() );
+
+	for( AudioPort * port : m_audioPorts )
+	{
+		if( port->renderedAhead() )
+		{
+			port->prepareRenderGraph();
+			port->setSuccessor( nullptr );
+		}
+	}
+
+	forEachJobHeaviestFirst( m_playHandles, [this]( PlayHandle * handle )
+	{
+		AudioPort * port = handle->audioPort();
+		if( !port->renderedAhead() )
+		{
+			return;
+		}
+		port->addPendingPlayHandle();
+		handle->setSuccessor( port );
+		if( !m_jobBatcher.addJob( handle ) )
+		{
+			handle->setSuccessor( nullptr );
+			port->removePendingPlayHandle();
+		}
+	} );
+	m_jobBatcher.flush();
+
+	for( AudioPort * port : m_audioPorts )
+	{
+		if( port->renderedAhead() )
+		{
+			port->finishRenderGraphSetup();
+		}
+	}
+
+	if( MixerWorkerThread::workersWanted() )
+	{
+		// the mixer of another engine context waits for the workers,
+		// so they're not kept beyond this period
+		MixerWorkerThread::startAndWaitForJobs();
+		return;
+	}
+
+	MixerWorkerThread::startJobs();
+	m_anticipativeJobsRunning = true;
+}
+
+
+
+
+void Mixer::finishAnticipativeJobs()
+{
+	if( m_anticipativeJobsRunning )
+	{
+		MixerWorkerThread::waitForJobs();
+		m_anticipativeJobsRunning = false;
+	}
+}
+
+
+
+
+void Mixer::removeFinishedPlayHandles()
+{
+	removePlayHandlesIf( []( PlayHandle * handle )
+	{
+		if( handle->affinityMatters() &&
+			handle->affinity() != QThread::currentThread() )
+		{
+			return false;
+		}
+		return handle->isFinished();
+	} );
+}
+
+
+
+
+
 void Mixer::clear()
 {
 	m_clearSignal = true;
@@ -515,51 +1039,255 @@ void Mixer::clearNewPlayHandles()
 
 
 
-// removes all play-handles. this is necessary, when the song is stopped ->
-// all remaining notes etc. would be played until their end
-void Mixer::clearInternal()
+void Mixer::updateOverloadMeasures()
 {
-	// TODO: m_midiClient->noteOffAll();
-	for( PlayHandleList::Iterator it = m_playHandles.begin(); it != m_playHandles.end(); ++it )
+	int measures = overloadMeasures() & m_overloadPolicy;
+
+	// there's no deadline when exporting
+	if( Engine::getSong()->isExporting() )
 	{
-		// we must not delete instrument-play-handles as they exist
-		// during the whole lifetime of an instrument
-		if( ( *it )->type() != PlayHandle::TypeInstrumentPlayHandle )
+		measures = 0;
+		m_overloadPeriods = 0;
+	}
+	else if( m_profiler.deadlineLoad() > OverloadHigh )
+	{
+		m_overloadPeriods = qMax( m_overloadPeriods, 0 ) + 1;
+		if( m_overloadPeriods >= OverloadEscalatePeriods )
 		{
-			m_playHandlesToRemove.push_back( *it );
+			m_overloadPeriods = 0;
+			// take the first allowed measure which isn't taken yet
+			const int next = m_overloadPolicy & ~measures;
+			if( next )
+			{
+				measures |= next & -next;
+			}
+			if( measures & StealNotes )
+			{
+				// let stealNotes() play 25% fewer notes than now
+				m_noteLimit = -1;
+			}
 		}
 	}
+	else if( measures && m_profiler.deadlineLoad() < OverloadLow )
+	{
+		m_overloadPeriods = qMin( m_overloadPeriods, 0 ) - 1;
+		if( -m_overloadPeriods * m_framesPerPeriod >= (int)
+			( processingSampleRate() * OverloadRecoverTime / 1000 ) )
+		{
+			m_overloadPeriods = 0;
+			// undo the last measure taken
+			int last = measures;
+			while( last & ( last - 1 ) )
+			{
+				last &= last - 1;
+			}
+			measures &= ~last;
+		}
+	}
+	else
+	{
+		m_overloadPeriods = 0;
+	}
+
+	m_overloadMeasures.store( measures, std::memory_order_relaxed );
 }
 
 
 
 
-Mixer::StereoSample Mixer::getPeakValues(sampleFrame * _ab, const f_cnt_t _frames) const
+void Mixer::publishRenderStats()
+{
+	RenderStats stats;
+	stats.period = ++m_periodsRendered;
+	stats.load = m_profiler.lastLoad();
+	stats.jobs = m_profiler.lastJobCount();
+
+	stats.voices = 0;
+	for( PlayHandle * handle : m_playHandles )
+	{
+		if( handle->type() == PlayHandle::TypeNotePlayHandle )
+		{
+			++stats.voices;
+		}
+	}
+
+	stats.effects = 0;
+	for( AudioPort * port : m_audioPorts )
+	{
+		if( port->effects() )
+		{
+			stats.effects += port->effects()->runningEffects();
+		}
+	}
+	FxMixer * fxMixer = Engine::fxMixer();
+	for( fx_ch_t ch = 0; ch < fxMixer->numChannels(); ++ch )
+	{
+		stats.effects += fxMixer->effectChannel( ch )->m_fxChain.
+							runningEffects();
+	}
+
+	stats.memory = MemoryManager::totalBytes();
+	m_memoryHighWater = qMax( m_memoryHighWater, stats.memory );
+	stats.memoryHighWater = m_memoryHighWater;
+
+	m_renderStats.write( &stats, 1 );
+}
+
+
+
+
+void Mixer::publishSnapshot()
+{
+	Snapshot & snapshot = m_snapshot.back();
+	snapshot.period = m_periodsRendered;
+
+	const Song * song = Engine::getSong();
+	snapshot.playMode = song->playMode();
+	snapshot.playing = song->isPlaying();
+	snapshot.ticks = song->getPlayPos().getTicks();
+	snapshot.milliseconds = song->getMilliseconds();
+
+	// the peaks are held until the GUI got them, so none get lost between
+	// its refreshes
+	const bool taken = m_snapshot.taken();
+	FxMixer * fxMixer = Engine::fxMixer();
+	const size_t channels = qMin<size_t>( fxMixer->numChannels(),
+						m_heldPeaks.capacity() );
+	m_heldPeaks.resize( channels, Snapshot::Peak{ 0.0f, 0.0f } );
+	for( size_t ch = 0; ch < channels; ++ch )
+	{
+		FxChannel * channel = fxMixer->effectChannel( ch );
+		const float gain = ch == 0 ? m_masterGain : 1.0f;
+		const float left = channel->m_peakLeft * gain;
+		const float right = channel->m_peakRight * gain;
+		Snapshot::Peak & held = m_heldPeaks[ch];
+		held.left = taken ? left : qMax( held.left, left );
+		held.right = taken ? right : qMax( held.right, right );
+		channel->m_peakLeft = channel->m_peakRight = 0.0f;
+	}
+	snapshot.fxPeaks.assign( m_heldPeaks.begin(), m_heldPeaks.end() );
+
+	m_snapshot.publish();
+}
+
+
+
+
+void Mixer::reserveSnapshotChannels( int _channels )
 {
-	sample_t peakLeft = 0.0f;
-	sample_t peakRight = 0.0f;
+	if( m_heldPeaks.capacity() >= size_t( _channels ) )
+	{
+		return;
+	}
+
+	// the buffers may only grow while the mixer doesn't publish - the GUI
+	// reading them is the thread calling this
+	requestChangeInModel();
+	m_snapshot.forEach( [_channels]( Snapshot & _snapshot )
+	{
+		_snapshot.fxPeaks.reserve( 2 * _channels );
+	} );
+	m_heldPeaks.reserve( 2 * _channels );
+	doneChangeInModel();
+}
+
+
+
 
-	for( f_cnt_t f = 0; f < _frames; ++f )
+void Mixer::stealNotes()
+{
+	int playing = 0;
+	for( PlayHandle * handle : m_playHandles )
 	{
-		float const absLeft = qAbs( _ab[f][0] );
-		float const absRight = qAbs( _ab[f][1] );
-		if (absLeft > peakLeft)
+		NotePlayHandle * note = dynamic_cast<NotePlayHandle *>( handle );
+		if( note && !note->hasParent() && !note->isReleased() )
 		{
-			peakLeft = absLeft;
+			++playing;
 		}
+	}
 
-		if (absRight > peakRight)
+	// a negative limit asks for lowering it to 75% of what's playing now
+	if( m_noteLimit < 0 )
+	{
+		m_noteLimit = qMax( 1, playing * 3 / 4 );
+	}
+
+	// the oldest notes have been heard for longest so ending them is
+	// noticed least, notes that just started haven't played anything yet
+	for( ; playing > m_noteLimit; --playing )
+	{
+		NotePlayHandle * oldest = NULL;
+		for( PlayHandle * handle : m_playHandles )
+		{
+			NotePlayHandle * note = dynamic_cast<NotePlayHandle *>( handle );
+			if( note && !note->hasParent() && !note->isReleased() &&
+				note->totalFramesPlayed() > 0 &&
+				( oldest == NULL || note->totalFramesPlayed() >
+						oldest->totalFramesPlayed() ) )
+			{
+				oldest = note;
+			}
+		}
+		if( oldest == NULL )
 		{
-			peakRight = absRight;
+			break;
 		}
+		// no jobs are running yet
+		oldest->steal();
 	}
+}
+
 
+
+
+// removes all play-handles. this is necessary, when the song is stopped ->
+// all remaining notes etc. would be played until their end
+void Mixer::clearInternal()
+{
+	// TODO: m_midiClient->noteOffAll();
+	for( PlayHandleList::Iterator it = m_playHandles.begin(); it != m_playHandles.end(); ++it )
+	{
+		// we must not delete instrument-play-handles as they exist
+		// during the whole lifetime of an instrument, the same goes for
+		// the play-handles of frozen and cached tracks
+		if( !( ( *it )->type() & ( PlayHandle::TypeInstrumentPlayHandle |
+					PlayHandle::TypeFreezePlayHandle |
+					PlayHandle::TypeBBLoopPlayHandle ) ) )
+		{
+			const int slot = ( *it )->m_mixerSlot;
+			m_playHandlesToRemove.push_back( PlayHandleKey{ slot,
+					m_playHandleSlots[slot].generation } );
+		}
+	}
+}
+
+
+
+
+Mixer::StereoSample Mixer::getPeakValues(sampleFrame * _ab, const f_cnt_t _frames) const
+{
+	sample_t peakLeft, peakRight;
+	MixHelpers::peak( _ab, _frames, peakLeft, peakRight );
 	return StereoSample(peakLeft, peakRight);
 }
 
 
 
 
+void Mixer::setMetronomeActive( bool value )
+{
+	if( value && m_metronome == NULL )
+	{
+		// decodes the clicks, so it's done here instead of in the
+		// audio thread
+		m_metronome = new Metronome;
+	}
+	m_metronomeActive = value;
+}
+
+
+
+
 void Mixer::changeQuality( const struct qualitySettings & _qs )
 {
 	// don't delete the audio-device
@@ -568,7 +1296,10 @@ void Mixer::changeQuality( const struct qualitySettings & _qs )
 	m_qualitySettings = _qs;
 	m_audioDev->applyQualitySettings();
 
-	emit sampleRateChanged();
+	// a good moment for growing the buffer pools, nothing is rendering
+	BufferManager::reserve();
+
+	announceSampleRate();
 	emit qualitySettingsChanged();
 
 	startProcessing();
@@ -577,6 +1308,42 @@ void Mixer::changeQuality( const struct qualitySettings & _qs )
 
 
 
+bool Mixer::setBufferSize( fpp_t _frames )
+{
+	// the way the constructor splits the configured size
+	const fpp_t period = qMax<fpp_t>( qMin<fpp_t>( _frames,
+				DEFAULT_BUFFER_SIZE ), MINIMUM_BUFFER_SIZE );
+	const int fifoSize = qMax( 1, _frames / DEFAULT_BUFFER_SIZE );
+	if( period != m_framesPerPeriod )
+	{
+		// everything holding a period would have to be reallocated
+		return false;
+	}
+	if( fifoSize == m_fifo->size() )
+	{
+		return true;
+	}
+
+	const bool processing = m_isProcessing;
+	const bool needsFifo = hasFifoWriter();
+	if( processing )
+	{
+		stopProcessing();
+	}
+
+	delete m_fifo;
+	m_fifo = new fifo( fifoSize, m_framesPerPeriod );
+
+	if( processing )
+	{
+		startProcessing( needsFifo );
+	}
+	return true;
+}
+
+
+
+
 void Mixer::doSetAudioDevice( AudioDevice * _dev )
 {
 	// TODO: Use shared_ptr here in the future.
@@ -607,7 +1374,7 @@ void Mixer::setAudioDevice( AudioDevice * _dev,
 
 	doSetAudioDevice( _dev );
 
-	emit sampleRateChanged();
+	announceSampleRate();
 
 	if (startNow) {startProcessing();}
 }
@@ -627,7 +1394,7 @@ void Mixer::setAudioDevice(AudioDevice * _dev,
 	doSetAudioDevice( _dev );
 
 	emit qualitySettingsChanged();
-	emit sampleRateChanged();
+	announceSampleRate();
 
 	if (startNow) {startProcessing( _needs_fifo );}
 }
@@ -635,6 +1402,21 @@ void Mixer::setAudioDevice(AudioDevice * _dev,
 
 
 
+void Mixer::announceSampleRate()
+{
+	// e.g. each sample is resampled, which is wasted if only the device
+	// or the interpolation changed
+	const sample_rate_t rate = processingSampleRate();
+	if( rate != m_announcedSampleRate )
+	{
+		m_announcedSampleRate = rate;
+		emit sampleRateChanged();
+	}
+}
+
+
+
+
 void Mixer::storeAudioDevice()
 {
 	if( !m_oldAudioDev )
@@ -654,7 +1436,7 @@ void Mixer::restoreAudioDevice()
 		delete m_audioDev;
 
 		m_audioDev = m_oldAudioDev;
-		emit sampleRateChanged();
+		announceSampleRate();
 
 		startProcessing();
 	}
@@ -682,6 +1464,7 @@ bool Mixer::addPlayHandle( PlayHandle* handle )
 {
 	if( criticalXRuns() == false )
 	{
+		handle->m_aheadOfPeriod = s_renderingThread && m_addingAheadPlayHandles;
 		m_newPlayHandles.push( handle );
 		handle->audioPort()->addPlayHandle( handle );
 		return true;
@@ -728,17 +1511,17 @@ void Mixer::removePlayHandle( PlayHandle * _ph )
 			}
 		}
 		// Now check m_playHandles
-		PlayHandleList::Iterator it = std::find( m_playHandles.begin(),
-					m_playHandles.end(), _ph );
-		if( it != m_playHandles.end() )
+		if( _ph->m_mixerSlot >= 0 )
 		{
-			m_playHandles.erase( it );
-			removedFromList = true;
+			removePlayHandlesIf( [_ph]( PlayHandle * handle )
+			{
+				return handle == _ph;
+			} );
 		}
 		// Only deleting PlayHandles that were actually found in the list
 		// "fixes crash when previewing a preset under high load"
 		// (See tobydox's 2008 commit 4583e48)
-		if ( removedFromList )
+		else if ( removedFromList )
 		{
 			if( _ph->type() == PlayHandle::TypeNotePlayHandle )
 			{
@@ -747,9 +1530,12 @@ void Mixer::removePlayHandle( PlayHandle * _ph )
 			else delete _ph;
 		}
 	}
-	else
+	else if( _ph->m_mixerSlot >= 0 )
 	{
-		m_playHandlesToRemove.push_back( _ph );
+		// handles still in m_newPlayHandles aren't removed either, see
+		// renderNextBuffer()
+		m_playHandlesToRemove.push_back( PlayHandleKey{ _ph->m_mixerSlot,
+				m_playHandleSlots[_ph->m_mixerSlot].generation } );
 	}
 	doneChangeInModel();
 }
@@ -760,24 +1546,10 @@ void Mixer::removePlayHandle( PlayHandle * _ph )
 void Mixer::removePlayHandlesOfTypes( Track * _track, const quint8 types )
 {
 	requestChangeInModel();
-	PlayHandleList::Iterator it = m_playHandles.begin();
-	while( it != m_playHandles.end() )
+	removePlayHandlesIf( [_track, types]( PlayHandle * handle )
 	{
-		if( ( *it )->isFromTrack( _track ) && ( ( *it )->type() & types ) )
-		{
-			( *it )->audioPort()->removePlayHandle( ( *it ) );
-			if( ( *it )->type() == PlayHandle::TypeNotePlayHandle )
-			{
-				NotePlayHandleManager::release( (NotePlayHandle*) *it );
-			}
-			else delete *it;
-			it = m_playHandles.erase( it );
-		}
-		else
-		{
-			++it;
-		}
-	}
+		return handle->isFromTrack( _track ) && ( handle->type() & types );
+	} );
 	doneChangeInModel();
 }
 
@@ -826,6 +1598,162 @@ void Mixer::doneChangeInModel()
 
 
 
+void Mixer::runInAudioThread( const std::function<void()> & _change )
+{
+	if( s_renderingThread || m_audioThreadStopped )
+	{
+		// nobody to wait for
+		requestChangeInModel();
+		_change();
+		doneChangeInModel();
+		return;
+	}
+
+	ChangeCommand cmd;
+	cmd.change = _change;
+	cmd.applied = false;
+	cmd.waiting = true;
+	queueChange( &cmd );
+
+	reclaimAppliedChanges();
+
+	// usually done within one period
+	while( !cmd.applied.load( std::memory_order_acquire ) )
+	{
+		if( m_audioThreadStopped )
+		{
+			// processing stopped before our change got applied
+			m_changeQueueMutex.lock();
+			applyQueuedChanges();
+			m_changeQueueMutex.unlock();
+			continue;
+		}
+		QThread::usleep( 100 );
+	}
+}
+
+
+
+
+void Mixer::trimMemory()
+{
+	if( Engine::getSong()->isPlaying() )
+	{
+		return;
+	}
+
+	BufferManager::trim();
+	MixerWorkerThread::collectThreadCaches();
+	postChangeInModel( []() { MemoryManager::collectThreadCache(); } );
+	MemoryManager::collectThreadCache();
+}
+
+
+
+
+void Mixer::postChangeInModel( std::function<void()> _change,
+					std::function<void()> _reclaim )
+{
+	if( s_renderingThread || m_audioThreadStopped )
+	{
+		requestChangeInModel();
+		_change();
+		doneChangeInModel();
+		if( _reclaim )
+		{
+			_reclaim();
+		}
+		return;
+	}
+
+	ChangeCommand * cmd = new ChangeCommand;
+	cmd->change = std::move( _change );
+	cmd->reclaim = std::move( _reclaim );
+	cmd->applied = false;
+	cmd->waiting = false;
+	queueChange( cmd );
+
+	reclaimAppliedChanges();
+}
+
+
+
+
+void Mixer::queueChange( ChangeCommand * _cmd )
+{
+	_cmd->next = m_queuedChanges.load( std::memory_order_relaxed );
+	while( !m_queuedChanges.compare_exchange_weak( _cmd->next, _cmd,
+						std::memory_order_release,
+						std::memory_order_relaxed ) )
+	{
+	}
+}
+
+
+
+
+void Mixer::applyQueuedChanges()
+{
+	ChangeCommand * cmd = m_queuedChanges.exchange( nullptr,
+						std::memory_order_acquire );
+	if( cmd == nullptr )
+	{
+		return;
+	}
+
+	// the queue is a stack, so reverse it to apply changes in order
+	ChangeCommand * ordered = nullptr;
+	while( cmd )
+	{
+		ChangeCommand * next = cmd->next;
+		cmd->next = ordered;
+		ordered = cmd;
+		cmd = next;
+	}
+
+	while( ordered )
+	{
+		cmd = ordered;
+		ordered = cmd->next;
+		cmd->change();
+		if( cmd->waiting )
+		{
+			// the waiting thread owns cmd, don't touch it afterwards
+			cmd->applied.store( true, std::memory_order_release );
+			continue;
+		}
+		// hand over to a non-realtime thread for cleaning up
+		cmd->next = m_appliedChanges.load( std::memory_order_relaxed );
+		while( !m_appliedChanges.compare_exchange_weak( cmd->next, cmd,
+						std::memory_order_release,
+						std::memory_order_relaxed ) )
+		{
+		}
+	}
+}
+
+
+
+
+void Mixer::reclaimAppliedChanges()
+{
+	ChangeCommand * cmd = m_appliedChanges.exchange( nullptr,
+						std::memory_order_acquire );
+	while( cmd )
+	{
+		ChangeCommand * next = cmd->next;
+		if( cmd->reclaim )
+		{
+			cmd->reclaim();
+		}
+		delete cmd;
+		cmd = next;
+	}
+}
+
+
+
+
 void Mixer::runChangesInModel()
 {
 	if( m_changesSignal )
@@ -1246,24 +2174,14 @@ void Mixer::fifoWriter::run()
 {
 	disable_denormals();
 
-#if 0
-#if defined(LMMS_BUILD_LINUX) || defined(LMMS_BUILD_FREEBSD)
-#ifdef LMMS_HAVE_SCHED_H
-	cpu_set_t mask;
-	CPU_ZERO( &mask );
-	CPU_SET( 0, &mask );
-	sched_setaffinity( 0, sizeof( mask ), &mask );
-#endif
-#endif
-#endif
+	if( m_mixer->m_realtimeThreads || m_mixer->m_pinThreads )
+	{
+		MixerWorkerThread::applyMixerThreadPolicy();
+	}
 
-	const fpp_t frames = m_mixer->framesPerPeriod();
 	while( m_writing )
 	{
-		surroundSampleFrame * buffer = new surroundSampleFrame[frames];
-		const surroundSampleFrame * b = m_mixer->renderNextBuffer();
-		memcpy( buffer, b, frames * sizeof( surroundSampleFrame ) );
-		write( buffer );
+		write( m_mixer->renderNextBuffer() );
 	}
 
 	// Let audio backend stop processing
@@ -1274,17 +2192,31 @@ void Mixer::fifoWriter::run()
 
 
 
-void Mixer::fifoWriter::write( surroundSampleFrame * buffer )
+void Mixer::fifoWriter::write( const surroundSampleFrame * buffer )
 {
+	// other threads may change the model while we're waiting
+	m_mixer->finishAnticipativeJobs();
+
 	m_mixer->m_waitChangesMutex.lock();
 	m_mixer->m_waitingForWrite = true;
 	m_mixer->m_waitChangesMutex.unlock();
 	m_mixer->runChangesInModel();
 
-	m_fifo->write( buffer );
+	m_fifo->waitForSpace();
 
 	m_mixer->m_doChangesMutex.lock();
 	m_mixer->m_waitingForWrite = false;
 	m_mixer->m_doChangesMutex.unlock();
+
+	if( buffer == NULL )
+	{
+		m_fifo->commitEnd();
+		return;
+	}
+
+	// copy into the ring directly, it was allocated up front
+	memcpy( m_fifo->writeBuffer(), buffer, m_mixer->framesPerPeriod() *
+						sizeof( surroundSampleFrame ) );
+	m_fifo->commitWrite();
 }
 
@@ -24,12 +24,38 @@
 
 #include "MixerProfiler.h"
 
+#include <algorithm>
+
+#include "MixerWorkerThread.h"
+
+
+static const char * const StageNames[MixerProfiler::NumStages] =
+{
+	"cleanup", "song", "stage1", "stage2", "stage3", "model_changes"
+} ;
+
+std::atomic_int MixerProfiler::s_jobTime( 0 );
+std::atomic_int MixerProfiler::s_jobCount( 0 );
+
+
 
 MixerProfiler::MixerProfiler() :
 	m_periodTimer(),
 	m_cpuLoad( 0 ),
-	m_outputFile()
+	m_deadlineLoad( 0.0f ),
+	m_lastLoad( 0.0f ),
+	m_lastJobCount( 0 ),
+	m_periodLength( 0.0f ),
+	m_outputFile(),
+	m_stageBegin( 0 ),
+	m_periods( 0 ),
+	m_idleTotal( 0 ),
+	m_idleMaximum( 0 )
 {
+	std::fill( m_stageTimes, m_stageTimes + NumStages, 0 );
+	std::fill( m_stageTotals, m_stageTotals + NumStages, 0 );
+	std::fill( m_stageMaxima, m_stageMaxima + NumStages, 0 );
+	std::fill( m_histogram, m_histogram + HistogramSize, 0 );
 }
 
 
@@ -39,17 +65,105 @@ MixerProfiler::~MixerProfiler()
 }
 
 
-void MixerProfiler::finishPeriod( sample_rate_t sampleRate, fpp_t framesPerPeriod )
+void MixerProfiler::finishPeriod( sample_rate_t sampleRate, fpp_t framesPerPeriod,
+								int _threads )
 {
 	int periodElapsed = m_periodTimer.elapsed();
 
+	m_periodLength = 1000000.0f * framesPerPeriod / sampleRate;
+
 	const float newCpuLoad = periodElapsed / 10000.0f * sampleRate / framesPerPeriod;
     m_cpuLoad = qBound<int>( 0, ( newCpuLoad * 0.1f + m_cpuLoad * 0.9f ), 100 );
 
-	if( m_outputFile.isOpen() )
+	// a single late period already means an xrun, so react to rising load
+	// fast and only trust falling load after a while
+	const float load = newCpuLoad / 100.0f;
+	m_lastLoad = load;
+	m_deadlineLoad = load > m_deadlineLoad ?
+				load * 0.5f + m_deadlineLoad * 0.5f :
+				load * 0.02f + m_deadlineLoad * 0.98f;
+
+	// always take the statistics so they don't pile up while not profiling
+	const MixerWorkerThread::WaitStatistics waitStats =
+					MixerWorkerThread::takeWaitStatistics();
+	const int jobTime = s_jobTime.exchange( 0, std::memory_order_relaxed );
+	m_lastJobCount = s_jobCount.exchange( 0, std::memory_order_relaxed );
+
+	if( !m_outputFile.isOpen() )
+	{
+		return;
+	}
+
+	// all threads could have been processing jobs during the stages
+	// running them - anticipative jobs finishing late are accounted to the
+	// next period, hence the bound
+	const int jobStages = m_stageTimes[PlayHandles] + m_stageTimes[AudioPorts];
+	const int idle = qMax( 0, jobStages * _threads - jobTime );
+
+	QByteArray line = QByteArray::number( periodElapsed );
+	for( int i = 0; i < NumStages; ++i )
+	{
+		line += ',' + QByteArray::number( m_stageTimes[i] );
+		m_stageTotals[i] += m_stageTimes[i];
+		m_stageMaxima[i] = qMax( m_stageMaxima[i], m_stageTimes[i] );
+	}
+	line += ',' + QByteArray::number( idle ) +
+		',' + QByteArray::number( waitStats.workerSleeps ) +
+		',' + QByteArray::number( waitStats.mixerSleeps ) + '\n';
+	m_outputFile.write( line );
+
+	m_idleTotal += idle;
+	m_idleMaximum = qMax( m_idleMaximum, idle );
+	++m_periods;
+	++m_histogram[qMin<int>( periodElapsed * 10 / m_periodLength,
+							HistogramSize - 1 )];
+}
+
+
+
+QString MixerProfiler::describe( const CpuUsage & _usage ) const
+{
+	return QString( "%1% (max. %2%)" ).
+		arg( percentOfPeriod( _usage.average() ), 0, 'f', 1 ).
+		arg( percentOfPeriod( _usage.maximum() ), 0, 'f', 1 );
+}
+
+
+
+QString MixerProfiler::summary() const
+{
+	if( m_periods == 0 )
+	{
+		return QString();
+	}
+
+	QString out = QString( "%1 periods of %2 us\n\n"
+				"stage             average     maximum\n" ).
+				arg( m_periods ).arg( m_periodLength, 0, 'f', 0 );
+	auto row = [this, &out]( const char * _name, qint64 _total, int _max ) {
+		out += QString( "%1 %2 us  %3 us\n" ).
+			arg( _name, -14 ).
+			arg( (double) _total / m_periods, 8, 'f', 1 ).
+			arg( _max, 8 ); };
+	for( int i = 0; i < NumStages; ++i )
 	{
-		m_outputFile.write( QString( "%1\n" ).arg( periodElapsed ).toLatin1() );
+		row( StageNames[i], m_stageTotals[i], m_stageMaxima[i] );
 	}
+	row( "worker_idle", m_idleTotal, m_idleMaximum );
+
+	out += "\nperiod time    periods\n";
+	const int largest = *std::max_element( m_histogram,
+						m_histogram + HistogramSize );
+	for( int i = 0; i < HistogramSize; ++i )
+	{
+		const QString range = i < HistogramSize - 1 ?
+			QString( "%1-%2%" ).arg( i * 10 ).arg( i * 10 + 10 ) :
+			QString( ">100%" );
+		out += QString( "%1 %2 %3\n" ).arg( range, -9 ).
+			arg( m_histogram[i], 9 ).
+			arg( QString( m_histogram[i] * 40 / qMax( largest, 1 ), '#' ) );
+	}
+	return out;
 }
 
 
@@ -58,6 +172,23 @@ void MixerProfiler::setOutputFile( const QString& outputFile )
 {
 	m_outputFile.close();
 	m_outputFile.setFileName( outputFile );
-	m_outputFile.open( QFile::WriteOnly | QFile::Truncate );
+	if( m_outputFile.open( QFile::WriteOnly | QFile::Truncate ) )
+	{
+		QByteArray header = "period";
+		for( const char * name : StageNames )
+		{
+			header += ',' + QByteArray( name );
+		}
+		m_outputFile.write( QString( "# worker spin time: %1 us, times in us\n" ).
+				arg( MixerWorkerThread::spinTime() ).toLatin1() +
+			header + ",worker_idle,worker_sleeps,mixer_sleeps\n" );
+	}
+
+	m_periods = 0;
+	m_idleTotal = 0;
+	m_idleMaximum = 0;
+	std::fill( m_stageTotals, m_stageTotals + NumStages, 0 );
+	std::fill( m_stageMaxima, m_stageMaxima + NumStages, 0 );
+	std::fill( m_histogram, m_histogram + HistogramSize, 0 );
 }
 
@@ -28,17 +28,204 @@
 #include <QMutex>
 #include <QWaitCondition>
 
+#include <chrono>
+#include <climits>
+
+#include <QtCore/QSemaphore>
+
 #include "denormals.h"
+#include "Engine.h"
 #include "ThreadableJob.h"
 #include "Mixer.h"
+#include "RealtimeChecker.h"
+#include "ScratchArena.h"
 
 #if defined(LMMS_HOST_X86) || defined(LMMS_HOST_X86_64)
 #include <xmmintrin.h>
 #endif
 
+#ifdef LMMS_BUILD_LINUX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+MixerWorkerThread::Scheduler MixerWorkerThread::scheduler =
+					MixerWorkerThread::Scheduler::GlobalQueue;
 MixerWorkerThread::JobQueue MixerWorkerThread::globalJobQueue;
-QWaitCondition * MixerWorkerThread::queueReadyWaitCond = NULL;
+MixerWorkerThread::WorkStealingQueue MixerWorkerThread::workStealingQueue;
 QList<MixerWorkerThread *> MixerWorkerThread::workerThreads;
+std::atomic_int MixerWorkerThread::s_spinTime( MixerWorkerThread::DefaultSpinTime );
+std::atomic_int MixerWorkerThread::s_workersWanted( 0 );
+QMutex MixerWorkerThread::s_policyMutex;
+ThreadPriority::Policy MixerWorkerThread::s_policy = ThreadPriority::Policy::High;
+QVector<int> MixerWorkerThread::s_policyCores;
+std::atomic_int MixerWorkerThread::s_policyGeneration( 0 );
+std::atomic_int MixerWorkerThread::s_collectGeneration( 0 );
+
+
+static inline void cpuRelax()
+{
+#if defined(LMMS_HOST_X86) || defined(LMMS_HOST_X86_64)
+	_mm_pause();
+#endif
+}
+
+
+
+
+// A counter threads can wait on until it changes (an "eventcount"). Waiting
+// threads block in a futex on Linux and in a QWaitCondition elsewhere.
+// Notifying is cheap as long as nobody is waiting.
+class EventCount
+{
+public:
+	EventCount() :
+		m_epoch( 0 ),
+		m_waiters( 0 )
+	{
+	}
+
+	unsigned int epoch() const
+	{
+		return m_epoch.load();
+	}
+
+	// block until epoch() differs from _epoch
+	void wait( unsigned int _epoch )
+	{
+		// m_waiters has to be incremented before checking m_epoch, the
+		// notifying thread does it the other way round
+		++m_waiters;
+#ifdef LMMS_BUILD_LINUX
+		while( m_epoch.load() == _epoch )
+		{
+			syscall( SYS_futex, reinterpret_cast<int *>( &m_epoch ),
+				FUTEX_WAIT_PRIVATE, _epoch, nullptr, nullptr, 0 );
+		}
+#else
+		m_mutex.lock();
+		while( m_epoch.load() == _epoch )
+		{
+			m_cond.wait( &m_mutex );
+		}
+		m_mutex.unlock();
+#endif
+		--m_waiters;
+	}
+
+	void notifyAll()
+	{
+		++m_epoch;
+		if( m_waiters.load() > 0 )
+		{
+#ifdef LMMS_BUILD_LINUX
+			syscall( SYS_futex, reinterpret_cast<int *>( &m_epoch ),
+				FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0 );
+#else
+			m_mutex.lock();
+			m_cond.wakeAll();
+			m_mutex.unlock();
+#endif
+		}
+	}
+
+
+private:
+	static_assert( sizeof( std::atomic<unsigned int> ) == sizeof( int ),
+			"EventCount: futex requires a 32 bit counter" );
+
+	std::atomic<unsigned int> m_epoch;
+	std::atomic_int m_waiters;
+#ifndef LMMS_BUILD_LINUX
+	QMutex m_mutex;
+	QWaitCondition m_cond;
+#endif
+
+} ;
+
+
+// changes whenever a new round of jobs is ready
+static EventCount s_jobsReady;
+// changes whenever all queued jobs have been processed
+static EventCount s_jobsDone;
+
+static std::atomic_int s_workerSleeps( 0 );
+static std::atomic_int s_mixerSleeps( 0 );
+
+
+
+
+// Spin until _done returns true or the configured spin time has elapsed.
+// Returns the last result of _done.
+template<typename F>
+static bool spinWait( F _done, int _spinTime )
+{
+	using namespace std::chrono;
+
+	if( _done() )
+	{
+		return true;
+	}
+	if( _spinTime <= 0 )
+	{
+		return false;
+	}
+
+	const steady_clock::time_point end =
+			steady_clock::now() + microseconds( _spinTime );
+	while( true )
+	{
+		// don't read the clock in every iteration
+		for( int i = 0; i < 64; ++i )
+		{
+			cpuRelax();
+			if( _done() )
+			{
+				return true;
+			}
+		}
+		if( steady_clock::now() >= end )
+		{
+			return false;
+		}
+	}
+}
+
+
+
+
+// wait for _done to become true, spinning first and sleeping afterwards
+template<typename F>
+static void waitForJobsDone( F _done, int _spinTime )
+{
+	if( spinWait( _done, _spinTime ) )
+	{
+		return;
+	}
+	++s_mixerSleeps;
+	while( true )
+	{
+		const unsigned int epoch = s_jobsDone.epoch();
+		if( _done() )
+		{
+			return;
+		}
+		s_jobsDone.wait( epoch );
+	}
+}
+
+// index of the calling thread's deque in workStealingQueue, -1 for threads
+// not taking part in job processing
+static thread_local int s_threadIndex = -1;
+
+// held by the mixer rendering with the workers, see acquireWorkers()
+static QSemaphore s_workersFree( 1 );
+// the engine context of the mixer which started the jobs
+static std::atomic<EngineContext *> s_jobsContext( nullptr );
+
+
+
 
 // implementation of internal JobQueue
 void MixerWorkerThread::JobQueue::reset( OperationMode _opMode )
@@ -51,7 +238,7 @@ void MixerWorkerThread::JobQueue::reset( OperationMode _opMode )
 
 
 
-void MixerWorkerThread::JobQueue::addJob( ThreadableJob * _job )
+bool MixerWorkerThread::JobQueue::addJob( ThreadableJob * _job )
 {
 	if( _job->requiresProcessing() )
 	{
@@ -61,11 +248,13 @@ void MixerWorkerThread::JobQueue::addJob( ThreadableJob * _job )
 		auto index = m_writeIndex++;
 		if (index < JOB_QUEUE_SIZE) {
 			m_items[index] = _job;
+			return true;
 		} else {
 			qWarning() << "Job queue is full!";
 			++m_itemsDone;
 		}
 	}
+	return false;
 }
 
 
@@ -83,7 +272,10 @@ void MixerWorkerThread::JobQueue::run()
 			{
 				job->process();
 				processedJob = true;
-				++m_itemsDone;
+				if( ++m_itemsDone >= m_writeIndex )
+				{
+					s_jobsDone.notifyAll();
+				}
 			}
 		}
 		// always exit loop if we're not in dynamic mode
@@ -96,30 +288,306 @@ void MixerWorkerThread::JobQueue::run()
 
 void MixerWorkerThread::JobQueue::wait()
 {
-	while (m_itemsDone < m_writeIndex)
+	waitForJobsDone( [this]() { return m_itemsDone >= m_writeIndex; },
+								s_spinTime );
+}
+
+
+
+
+// a growable ring of jobs guarded by a spinlock - the lock is only held for
+// a few instructions and every thread mostly works on its own deque so there
+// is hardly any contention on it
+class MixerWorkerThread::WorkStealingQueue::Deque
+{
+public:
+	Deque() :
+		m_ring( 256, nullptr ),
+		m_head( 0 ),
+		m_size( 0 ),
+		m_count( 0 )
 	{
-#if defined(LMMS_HOST_X86) || defined(LMMS_HOST_X86_64)
-		_mm_pause();
-#endif
+		m_lock.clear();
+	}
+
+	// push to the back, the ring grows if required so pushing never fails
+	void push( ThreadableJob * _job )
+	{
+		lock();
+		if( m_size == m_ring.size() )
+		{
+			// unroll the ring into a buffer of twice the size - once
+			// grown the capacity is kept so this only happens when
+			// a project gets bigger than anything played before
+			std::vector<ThreadableJob *> ring( m_ring.size() * 2, nullptr );
+			for( size_t i = 0; i < m_size; ++i )
+			{
+				ring[i] = m_ring[( m_head + i ) & ( m_ring.size() - 1 )];
+			}
+			m_ring.swap( ring );
+			m_head = 0;
+		}
+		m_ring[( m_head + m_size ) & ( m_ring.size() - 1 )] = _job;
+		++m_size;
+		m_count.store( static_cast<int>( m_size ), std::memory_order_relaxed );
+		unlock();
+	}
+
+	// pop from the back - used by the owning thread, so recently added jobs
+	// (e.g. FX channels whose senders were just processed) stay on this core
+	ThreadableJob * pop()
+	{
+		if( m_count.load( std::memory_order_relaxed ) == 0 )
+		{
+			return nullptr;
+		}
+		ThreadableJob * job = nullptr;
+		lock();
+		if( m_size > 0 )
+		{
+			--m_size;
+			job = m_ring[( m_head + m_size ) & ( m_ring.size() - 1 )];
+			m_count.store( static_cast<int>( m_size ), std::memory_order_relaxed );
+		}
+		unlock();
+		return job;
+	}
+
+	// take from the front - used by other threads looking for work
+	ThreadableJob * steal()
+	{
+		if( m_count.load( std::memory_order_relaxed ) == 0 )
+		{
+			return nullptr;
+		}
+		ThreadableJob * job = nullptr;
+		lock();
+		if( m_size > 0 )
+		{
+			job = m_ring[m_head];
+			m_head = ( m_head + 1 ) & ( m_ring.size() - 1 );
+			--m_size;
+			m_count.store( static_cast<int>( m_size ), std::memory_order_relaxed );
+		}
+		unlock();
+		return job;
+	}
+
+	bool isEmpty() const
+	{
+		return m_count.load( std::memory_order_relaxed ) == 0;
 	}
+
+	void clear()
+	{
+		lock();
+		m_head = 0;
+		m_size = 0;
+		m_count.store( 0, std::memory_order_relaxed );
+		unlock();
+	}
+
+
+private:
+	void lock()
+	{
+		while( m_lock.test_and_set( std::memory_order_acquire ) )
+		{
+			cpuRelax();
+		}
+	}
+
+	void unlock()
+	{
+		m_lock.clear( std::memory_order_release );
+	}
+
+	std::atomic_flag m_lock;
+	std::vector<ThreadableJob *> m_ring;	// size is always a power of 2
+	size_t m_head;
+	size_t m_size;
+	// copy of m_size which can be checked without taking the lock
+	std::atomic_int m_count;
+
+	// keep deques of different threads on different cache lines
+	char m_padding[64];
+
+} ;
+
+
+
+
+// implementation of internal WorkStealingQueue
+MixerWorkerThread::WorkStealingQueue::WorkStealingQueue() :
+	m_deques(),
+	m_jobsQueued( 0 ),
+	m_jobsDone( 0 ),
+	m_nextDeque( 0 ),
+	m_running( false ),
+	m_opMode( JobQueue::Static )
+{
 }
 
 
 
 
+MixerWorkerThread::WorkStealingQueue::~WorkStealingQueue()
+{
+	for( Deque * d : m_deques )
+	{
+		delete d;
+	}
+}
 
-// implementation of worker threads
 
-MixerWorkerThread::MixerWorkerThread( Mixer* mixer ) :
-	QThread( mixer ),
-	m_quit( false )
+
+
+int MixerWorkerThread::WorkStealingQueue::addThread()
 {
-	// initialize global static data
-	if( queueReadyWaitCond == NULL )
+	m_deques.push_back( new Deque );
+	return static_cast<int>( m_deques.size() ) - 1;
+}
+
+
+
+
+void MixerWorkerThread::WorkStealingQueue::reset( JobQueue::OperationMode _opMode )
+{
+	m_running = false;
+	for( Deque * d : m_deques )
 	{
-		queueReadyWaitCond = new QWaitCondition;
+		d->clear();
 	}
+	m_jobsQueued = 0;
+	m_jobsDone = 0;
+	m_nextDeque = 0;
+	m_opMode = _opMode;
+}
 
+
+
+
+bool MixerWorkerThread::WorkStealingQueue::addJob( ThreadableJob * _job )
+{
+	if( m_deques.empty() || !_job->requiresProcessing() )
+	{
+		return false;
+	}
+
+	// update job state
+	_job->queue();
+	// count the job before it becomes visible to other threads
+	++m_jobsQueued;
+
+	const int numDeques = static_cast<int>( m_deques.size() );
+	int index = s_threadIndex;
+	if( !m_running || index < 0 || index >= numDeques )
+	{
+		// while the queue is filled before processing, distribute the
+		// jobs evenly so every thread starts with local work
+		index = m_nextDeque++ % numDeques;
+	}
+	m_deques[index]->push( _job );
+	return true;
+}
+
+
+
+
+ThreadableJob * MixerWorkerThread::WorkStealingQueue::steal( int _threadIndex )
+{
+	const int numDeques = static_cast<int>( m_deques.size() );
+	// start with the neighbour so thieves don't all hit the same deque
+	for( int i = 1; i < numDeques; ++i )
+	{
+		ThreadableJob * job = m_deques[( _threadIndex + i ) % numDeques]->steal();
+		if( job )
+		{
+			return job;
+		}
+	}
+	return nullptr;
+}
+
+
+
+
+void MixerWorkerThread::WorkStealingQueue::run( int _threadIndex )
+{
+	if( _threadIndex < 0 || _threadIndex >= static_cast<int>( m_deques.size() ) )
+	{
+		return;
+	}
+	m_running = true;
+
+	Deque * own = m_deques[_threadIndex];
+	while( m_jobsDone < m_jobsQueued )
+	{
+		ThreadableJob * job = own->pop();
+		if( job == nullptr )
+		{
+			job = steal( _threadIndex );
+		}
+		if( job )
+		{
+			job->process();
+			if( ++m_jobsDone >= m_jobsQueued )
+			{
+				s_jobsDone.notifyAll();
+			}
+		}
+		else if( m_opMode == JobQueue::Static )
+		{
+			// all jobs are taken by other threads already
+			break;
+		}
+		else if( !spinWait( [this]() { return hasJobs() ||
+						m_jobsDone >= m_jobsQueued; }, s_spinTime ) )
+		{
+			// jobs still in progress elsewhere may add new ones but
+			// don't keep spinning for too long
+			break;
+		}
+	}
+}
+
+
+
+
+bool MixerWorkerThread::WorkStealingQueue::hasJobs() const
+{
+	for( const Deque * d : m_deques )
+	{
+		if( !d->isEmpty() )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+
+
+void MixerWorkerThread::WorkStealingQueue::wait()
+{
+	waitForJobsDone( [this]() { return m_jobsDone >= m_jobsQueued; },
+								s_spinTime );
+}
+
+
+
+
+
+// implementation of worker threads
+
+MixerWorkerThread::MixerWorkerThread( Mixer* mixer ) :
+	QThread( mixer ),
+	m_quit( false ),
+	m_index( workStealingQueue.addThread() ),
+	m_policyGeneration( s_policyGeneration ),
+	m_collectGeneration( s_collectGeneration )
+{
 	// keep track of all instantiated worker threads - this is used for
 	// processing the last worker thread "inline", see comments in
 	// MixerWorkerThread::startAndWaitForJobs() for details
@@ -148,14 +616,130 @@ void MixerWorkerThread::quit()
 
 
 
+MixerWorkerThread::WaitStatistics MixerWorkerThread::takeWaitStatistics()
+{
+	WaitStatistics stats;
+	stats.workerSleeps = s_workerSleeps.exchange( 0 );
+	stats.mixerSleeps = s_mixerSleeps.exchange( 0 );
+	return stats;
+}
+
+
+
+
+void MixerWorkerThread::setThreadPolicy( ThreadPriority::Policy _policy,
+						const QVector<int> & _cores )
+{
+	s_policyMutex.lock();
+	s_policy = _policy;
+	s_policyCores = _cores;
+	s_policyMutex.unlock();
+	++s_policyGeneration;
+}
+
+
+
+
+void MixerWorkerThread::applyMixerThreadPolicy()
+{
+	applyThreadPolicy( 0, "Mixer thread" );
+}
+
+
+
+
+void MixerWorkerThread::applyThreadPolicy( int _coreSlot,
+						const char * _threadName )
+{
+	s_policyMutex.lock();
+	const ThreadPriority::Policy policy = s_policy;
+	const int core = s_policyCores.isEmpty() ? -1 :
+			s_policyCores[_coreSlot % s_policyCores.size()];
+	s_policyMutex.unlock();
+
+	const QString priority = ThreadPriority::apply( policy );
+	const QString affinity = ThreadPriority::pinToCore( core );
+	qDebug( "%s: %s, %s", _threadName, qPrintable( priority ),
+							qPrintable( affinity ) );
+}
+
+
+
+
 void MixerWorkerThread::startAndWaitForJobs()
 {
-	queueReadyWaitCond->wakeAll();
+	startJobs();
+	waitForJobs();
+}
+
+
+
+
+void MixerWorkerThread::acquireWorkers()
+{
+	// waiting for the period of another context is by design, without
+	// further contexts nobody else holds the workers
+	RealtimeChecker::Allowed waitingForMixer;
+	++s_workersWanted;
+	s_workersFree.acquire();
+	--s_workersWanted;
+}
+
+
+
+
+void MixerWorkerThread::releaseWorkers()
+{
+	RealtimeChecker::Allowed wakingMixer;
+	s_workersFree.release();
+}
+
+
+
+
+void MixerWorkerThread::startJobs()
+{
+	// released to the workers by the notification
+	s_jobsContext.store( Engine::context(), std::memory_order_relaxed );
+
+	RealtimeChecker::Allowed wakingWorkers;
+	s_jobsReady.notifyAll();
+}
+
+
+
+
+void MixerWorkerThread::waitForJobs()
+{
+	// waiting for the workers is by design, the jobs processed in here
+	// are checked again by ThreadableJob::process()
+	RealtimeChecker::Allowed waitingForWorkers;
+
 	// The last worker-thread is never started. Instead it's processed "inline"
 	// i.e. within the global Mixer thread. This way we can reduce latencies
 	// that otherwise would be caused by synchronizing with another thread.
-	globalJobQueue.run();
-	globalJobQueue.wait();
+	if( !workerThreads.isEmpty() )
+	{
+		s_threadIndex = workerThreads.last()->m_index;
+	}
+	if( scheduler == Scheduler::WorkStealing )
+	{
+		workStealingQueue.run( s_threadIndex );
+		workStealingQueue.wait();
+	}
+	else
+	{
+		globalJobQueue.run();
+		globalJobQueue.wait();
+	}
+}
+
+
+
+
+int MixerWorkerThread::threadIndex()
+{
+	return s_threadIndex;
 }
 
 
@@ -165,14 +749,51 @@ void MixerWorkerThread::run()
 {
 	MemoryManager::ThreadGuard mmThreadGuard; Q_UNUSED(mmThreadGuard);
 	disable_denormals();
+	ScratchArena::prepareThread();
+
+	s_threadIndex = m_index;
 
-	QMutex m;
+	unsigned int epoch = s_jobsReady.epoch();
 	while( m_quit == false )
 	{
-		m.lock();
-		queueReadyWaitCond->wait( &m );
-		globalJobQueue.run();
-		m.unlock();
+		// wait for the next round of jobs - spinning for a while keeps
+		// wake-up latency low at small buffer sizes, sleeping afterwards
+		// saves power when the mixer is idle or the period is long
+		const unsigned int lastEpoch = epoch;
+		if( !spinWait( [lastEpoch]() { return s_jobsReady.epoch() != lastEpoch; },
+								s_spinTime ) )
+		{
+			++s_workerSleeps;
+			s_jobsReady.wait( lastEpoch );
+		}
+		epoch = s_jobsReady.epoch();
+
+		{
+			// the jobs look the engine objects of their mixer up
+			LmmsCore::ContextScope contextScope(
+				s_jobsContext.load( std::memory_order_relaxed ) );
+			if( scheduler == Scheduler::WorkStealing )
+			{
+				workStealingQueue.run( m_index );
+			}
+			else
+			{
+				globalJobQueue.run();
+			}
+		}
+
+		// only after the jobs are done so the current period isn't delayed
+		if( m_policyGeneration != s_policyGeneration )
+		{
+			m_policyGeneration = s_policyGeneration;
+			applyThreadPolicy( m_index + 1, qPrintable(
+				QString( "Mixer worker %1" ).arg( m_index ) ) );
+		}
+		if( m_collectGeneration != s_collectGeneration )
+		{
+			m_collectGeneration = s_collectGeneration;
+			MemoryManager::collectThreadCache();
+		}
 	}
 }
 
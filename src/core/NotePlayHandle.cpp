@@ -30,12 +30,49 @@
 #include "InstrumentTrack.h"
 #include "Instrument.h"
 #include "Mixer.h"
+#include "MixHelpers.h"
 #include "Song.h"
 
 
-NotePlayHandle::BaseDetuning::BaseDetuning( DetuningHelper *detuning ) :
-	m_value( detuning ? detuning->automationPattern()->valueAt( 0 ) : 0 )
+// longer notes stay at the detuning they reached by then
+static const int MaxDetuningTicks = 65536;
+
+
+NotePlayHandle::BaseDetuning::BaseDetuning( DetuningHelper *detuning,
+							tick_t length ) :
+	m_value( detuning ? detuning->automationPattern()->valueAt( 0 ) : 0 ),
+	m_syncTicks( 0 ),
+	m_syncPeriod( -1 )
+{
+	// notes without a length are played live
+	if( detuning && length > 0 &&
+			detuning->automationPattern()->hasAutomation() )
+	{
+		const int ticks = qMin<int>( length, MaxDetuningTicks ) + 1;
+		m_curve.resize( ticks );
+		if( !detuning->automationPattern()->renderValues(
+					m_curve.data(), 0.0f, 1.0f, ticks ) )
+		{
+			// constant, m_value is all there is to it
+			std::vector<float>().swap( m_curve );
+		}
+	}
+}
+
+
+
+
+float NotePlayHandle::BaseDetuning::valueAt( float _ticks ) const
 {
+	const int last = static_cast<int>( m_curve.size() ) - 1;
+	const float t = qBound( 0.0f, _ticks, static_cast<float>( last ) );
+	const int tick = static_cast<int>( t );
+	if( tick >= last )
+	{
+		return m_curve[last];
+	}
+	return m_curve[tick] + ( t - tick ) *
+				( m_curve[tick + 1] - m_curve[tick] );
 }
 
 
@@ -53,40 +90,55 @@ NotePlayHandle::NotePlayHandle( InstrumentTrack* instrumentTrack,
 	PlayHandle( TypeNotePlayHandle, _offset ),
 	Note( n.length(), n.pos(), n.key(), n.getVolume(), n.getPanning(), n.detuning() ),
 	m_pluginData( NULL ),
-	m_instrumentTrack( instrumentTrack ),
 	m_frames( 0 ),
 	m_totalFramesPlayed( 0 ),
 	m_framesBeforeRelease( 0 ),
 	m_releaseFramesToDo( 0 ),
 	m_releaseFramesDone( 0 ),
-	m_subNotes(),
+	m_frequency( 0 ),
+	m_unpitchedFrequency( 0 ),
 	m_released( false ),
 	m_releaseStarted( false ),
-	m_hasMidiNote( false ),
 	m_hasParent( parent != NULL  ),
+	m_muted( false ),
+	m_stolen( false ),
+	m_releaseRequest( -1 ),
+	m_stealRequest( false ),
+	m_frequencyNeedsUpdate( false ),
+	m_silentPeriods( 0 ),
+	m_renderPending( false ),
+	m_pendingBuffer( NULL ),
+	m_pendingFrames( 0 ),
+	m_instrumentTrack( instrumentTrack ),
+	m_subNotes(),
+	m_hasMidiNote( false ),
 	m_parent( parent ),
 	m_hadChildren( false ),
-	m_muted( false ),
 	m_bbTrack( NULL ),
-	m_origTempo( Engine::getSong()->getTempo() ),
+	m_ticks( 0 ),
+	m_framesPerTick( Engine::periodFramesPerTick() ),
 	m_origBaseNote( instrumentTrack->baseNote() ),
-	m_frequency( 0 ),
-	m_unpitchedFrequency( 0 ),
 	m_baseDetuning( NULL ),
 	m_songGlobalParentOffset( 0 ),
+	m_detuning( 0 ),
+	m_endDetuning( 0 ),
+	m_endFrequency( 0 ),
 	m_midiChannel( midiEventChannel >= 0 ? midiEventChannel : instrumentTrack->midiPort()->realOutputChannel() ),
-	m_origin( origin ),
-	m_frequencyNeedsUpdate( false )
+	m_origin( origin )
 {
-	lock();
 	if( hasParent() == false )
 	{
-		m_baseDetuning = new BaseDetuning( detuning() );
+		m_baseDetuning = new BaseDetuning( detuning(), length() );
+		m_detuning = m_endDetuning = m_baseDetuning->value();
 		m_instrumentTrack->m_processHandles.push_back( this );
+		++m_instrumentTrack->m_voiceCount;
+		m_instrumentTrack->limitPolyphony( this );
 	}
 	else
 	{
 		m_baseDetuning = parent->m_baseDetuning;
+		m_detuning = parent->m_detuning;
+		m_endDetuning = parent->m_endDetuning;
 
 		parent->m_subNotes.push_back( this );
 		parent->m_hadChildren = true;
@@ -112,20 +164,18 @@ NotePlayHandle::NotePlayHandle( InstrumentTrack* instrumentTrack,
 	}
 
 	setAudioPort( instrumentTrack->audioPort() );
-
-	unlock();
 }
 
 
 NotePlayHandle::~NotePlayHandle()
 {
-	lock();
 	noteOff( 0 );
 
 	if( hasParent() == false )
 	{
 		delete m_baseDetuning;
 		m_instrumentTrack->m_processHandles.removeAll( this );
+		--m_instrumentTrack->m_voiceCount;
 	}
 	else
 	{
@@ -145,8 +195,6 @@ NotePlayHandle::~NotePlayHandle()
 	m_subNotes.clear();
 
 	if( buffer() ) releaseBuffer();
-
-	unlock();
 }
 
 
@@ -182,6 +230,22 @@ int NotePlayHandle::midiKey() const
 
 void NotePlayHandle::play( sampleFrame * _working_buffer )
 {
+	// what other threads asked for meanwhile, the common case of nothing
+	// costs a plain load each
+	if( m_releaseRequest.load( std::memory_order_relaxed ) >= 0 )
+	{
+		const f_cnt_t offset = m_releaseRequest.exchange( -1 );
+		if( offset >= 0 )
+		{
+			noteOff( offset );
+		}
+	}
+	if( m_stealRequest.load( std::memory_order_relaxed ) &&
+						m_stealRequest.exchange( false ) )
+	{
+		steal();
+	}
+
 	if( m_muted )
 	{
 		return;
@@ -194,8 +258,6 @@ void NotePlayHandle::play( sampleFrame * _working_buffer )
 		return;
 	}
 
-	lock();
-
 	/* It is possible for NotePlayHandle::noteOff to be called before NotePlayHandle::play,
 	 * which results in a note-on message being sent without a subsequent note-off message.
 	 * Therefore, we check here whether the note has already been released before sending
@@ -215,11 +277,21 @@ void NotePlayHandle::play( sampleFrame * _working_buffer )
 			offset() );
 	}
 
+	if( m_baseDetuning->isAutomated() )
+	{
+		updateDetuning();
+	}
+
 	if( m_frequencyNeedsUpdate )
 	{
 		updateFrequency();
 	}
 
+	if( m_framesPerTick != Engine::periodFramesPerTick() )
+	{
+		updateFrames();
+	}
+
 	// number of frames that can be played this period
 	f_cnt_t framesThisPeriod = m_totalFramesPlayed == 0
 		? Engine::mixer()->framesPerPeriod() - offset()
@@ -238,14 +310,55 @@ void NotePlayHandle::play( sampleFrame * _working_buffer )
 	// under some circumstances we're called even if there's nothing to play
 	// therefore do an additional check which fixes crash e.g. when
 	// decreasing release of an instrument-track while the note is active
-	if( framesLeft() > 0 )
+	const bool rendered = framesLeft() > 0;
+	if( rendered )
 	{
 		// play note!
 		m_instrumentTrack->playNote( this, _working_buffer );
+
+		if( m_renderPending )
+		{
+			// the instrument renders this note together with all others
+			// of its track and completes the period afterwards
+			m_pendingBuffer = _working_buffer;
+			m_pendingFrames = framesThisPeriod;
+			return;
+		}
+	}
+
+	finishPeriod( _working_buffer, framesThisPeriod, rendered );
+}
+
+
+
+
+void NotePlayHandle::finishPendingRender()
+{
+	m_renderPending = false;
+	finishPeriod( m_pendingBuffer, m_pendingFrames, true );
+	m_pendingBuffer = NULL;
+}
+
+
+
+
+void NotePlayHandle::finishPeriod( sampleFrame* _working_buffer,
+					f_cnt_t framesThisPeriod, bool rendered )
+{
+	if( rendered && m_stolen && _working_buffer )
+	{
+		// fade out instead of cutting the note off
+		const fpp_t fpp = Engine::mixer()->framesPerPeriod();
+		for( fpp_t f = 0; f < fpp; ++f )
+		{
+			const float gain = 1.0f - (float) f / fpp;
+			_working_buffer[f][0] *= gain;
+			_working_buffer[f][1] *= gain;
+		}
 	}
 
 	if( m_released && (!instrumentTrack()->isSustainPedalPressed() ||
-		m_releaseStarted) )
+		m_releaseStarted || m_stolen) )
 	{
 		m_releaseStarted = true;
 
@@ -297,11 +410,45 @@ void NotePlayHandle::play( sampleFrame * _working_buffer )
 				m_releaseFramesDone = m_releaseFramesToDo;
 			}
 		}
+
+		if( m_framesBeforeRelease == 0 && _working_buffer && usesBuffer() )
+		{
+			checkSilence( _working_buffer, Engine::mixer()->framesPerPeriod() );
+		}
 	}
 
 	// update internal data
 	m_totalFramesPlayed += framesThisPeriod;
-	unlock();
+}
+
+
+
+
+void NotePlayHandle::checkSilence( const sampleFrame* buffer, fpp_t frames )
+{
+	const Instrument* instrument = m_instrumentTrack->instrument();
+	const float threshold = instrument->silentVoiceThreshold();
+	if( threshold <= 0 || m_stolen || !m_subNotes.isEmpty() ||
+		m_releaseFramesDone >= m_releaseFramesToDo )
+	{
+		return;
+	}
+
+	float left = 0.0f;
+	float right = 0.0f;
+	MixHelpers::peak( buffer, frames, left, right );
+	if( qMax( left, right ) >= threshold )
+	{
+		m_silentPeriods = 0;
+		return;
+	}
+
+	// the voice is inaudible - skip the rest of its release instead of
+	// rendering it for nothing
+	if( ++m_silentPeriods >= instrument->silentVoicePeriods() )
+	{
+		m_releaseFramesDone = m_releaseFramesToDo;
+	}
 }
 
 
@@ -309,7 +456,7 @@ void NotePlayHandle::play( sampleFrame * _working_buffer )
 
 f_cnt_t NotePlayHandle::framesLeft() const
 {
-	if( instrumentTrack()->isSustainPedalPressed() )
+	if( instrumentTrack()->isSustainPedalPressed() && !m_stolen )
 	{
 		return 4*Engine::mixer()->framesPerPeriod();
 	}
@@ -355,12 +502,10 @@ void NotePlayHandle::noteOff( const f_cnt_t _s )
 	}
 	m_released = true;
 
-	// first note-off all sub-notes
+	// first note-off all sub-notes, which may be playing right now
 	for( NotePlayHandle * n : m_subNotes )
 	{
-		n->lock();
-		n->noteOff( _s );
-		n->unlock();
+		n->requestNoteOff( _s );
 	}
 
 	// then set some variables indicating release-state
@@ -392,6 +537,51 @@ void NotePlayHandle::noteOff( const f_cnt_t _s )
 
 
 
+void NotePlayHandle::steal()
+{
+	for( NotePlayHandle * n : m_subNotes )
+	{
+		n->requestSteal();
+	}
+
+	noteOff( 0 );
+	m_stolen = true;
+
+	// leave one more period which play() fades out
+	const f_cnt_t fpp = Engine::mixer()->framesPerPeriod();
+	if( actualReleaseFramesToDo() == 0 )
+	{
+		m_framesBeforeRelease = fpp;
+	}
+	else
+	{
+		m_framesBeforeRelease = 0;
+		m_releaseFramesToDo = qMin( m_releaseFramesToDo,
+						m_releaseFramesDone + fpp );
+	}
+}
+
+
+
+
+void NotePlayHandle::requestNoteOff( const f_cnt_t _s )
+{
+	// the first request wins like the first noteOff() would
+	f_cnt_t none = -1;
+	m_releaseRequest.compare_exchange_strong( none, qMax<f_cnt_t>( _s, 0 ) );
+}
+
+
+
+
+void NotePlayHandle::requestSteal()
+{
+	m_stealRequest.store( true );
+}
+
+
+
+
 f_cnt_t NotePlayHandle::actualReleaseFramesToDo() const
 {
 	return m_instrumentTrack->m_soundShaping.releaseFrames();
@@ -407,7 +597,7 @@ void NotePlayHandle::setFrames( const f_cnt_t _frames )
 	{
 		m_frames = m_instrumentTrack->beatLen( this );
 	}
-	m_origFrames = m_frames;
+	m_ticks = m_frames / (double) m_framesPerTick;
 }
 
 
@@ -499,45 +689,83 @@ bool NotePlayHandle::operator==( const NotePlayHandle & _nph ) const
 
 
 void NotePlayHandle::updateFrequency()
+{
+	updateOwnFrequency();
+
+	for( NotePlayHandleList::Iterator it = m_subNotes.begin(); it != m_subNotes.end(); ++it )
+	{
+		( *it )->updateFrequency();
+	}
+}
+
+
+
+
+void NotePlayHandle::updateOwnFrequency()
 {
 	int mp = m_instrumentTrack->m_useMasterPitchModel.value() ? Engine::getSong()->masterPitch() : 0;
 	const float pitch =
 		( key() -
 				m_instrumentTrack->baseNoteModel()->value() +
 				mp +
-				m_baseDetuning->value() )
+				m_detuning )
 												 / 12.0f;
 	m_frequency = BaseFreq * powf( 2.0f, pitch + m_instrumentTrack->pitchModel()->value() / ( 100 * 12.0f ) );
 	m_unpitchedFrequency = BaseFreq * powf( 2.0f, pitch );
+	m_endFrequency = m_endDetuning == m_detuning ? m_frequency :
+		m_frequency * powf( 2.0f, ( m_endDetuning - m_detuning ) / 12.0f );
+}
 
-	for( NotePlayHandleList::Iterator it = m_subNotes.begin(); it != m_subNotes.end(); ++it )
+
+
+
+void NotePlayHandle::processMidiTime( const MidiTime& time, f_cnt_t _offset )
+{
+	// only where the song is, the values have been rendered already
+	const long period = AutomatableModel::periodCounter();
+	if( m_baseDetuning->isAutomated() && !m_baseDetuning->isSynced( period ) &&
+				time >= songGlobalParentOffset() + pos() )
 	{
-		( *it )->updateFrequency();
+		const tick_t ticks = time - songGlobalParentOffset() - pos();
+		m_baseDetuning->sync( ticks - _offset / Engine::periodFramesPerTick(),
+									period );
 	}
 }
 
 
 
 
-void NotePlayHandle::processMidiTime( const MidiTime& time )
+void NotePlayHandle::updateDetuning()
 {
-	if( detuning() && time >= songGlobalParentOffset()+pos() )
+	const float ticksPerPeriod = Engine::mixer()->framesPerPeriod() /
+						Engine::periodFramesPerTick();
+	float ticks;
+	if( !m_baseDetuning->ticksAt( AutomatableModel::periodCounter(),
+						ticksPerPeriod, ticks ) )
 	{
-		const float v = detuning()->automationPattern()->valueAt( time - songGlobalParentOffset() - pos() );
-		if( !typeInfo<float>::isEqual( v, m_baseDetuning->value() ) )
-		{
-			m_baseDetuning->setValue( v );
-			updateFrequency();
-		}
+		return;
+	}
+
+	const float detuning = m_baseDetuning->valueAt( ticks );
+	const float endDetuning = m_baseDetuning->valueAt( ticks + ticksPerPeriod );
+	if( !typeInfo<float>::isEqual( detuning, m_detuning ) ||
+			!typeInfo<float>::isEqual( endDetuning, m_endDetuning ) )
+	{
+		m_detuning = detuning;
+		m_endDetuning = endDetuning;
+		// the sub-notes are rendered on their own and follow by themselves
+		updateOwnFrequency();
 	}
 }
 
 
 
 
-void NotePlayHandle::resize( const bpm_t _new_tempo )
+void NotePlayHandle::updateFrames()
 {
-	if (origin() == OriginMidiInput ||
+	m_framesPerTick = Engine::periodFramesPerTick();
+
+	if( m_released || origin() == OriginMidiInput ||
 		(origin() == OriginNoteStacking && m_parent->origin() == OriginMidiInput))
 	{
 		// Don't resize notes from MIDI input - they should continue to play
@@ -546,37 +774,157 @@ void NotePlayHandle::resize( const bpm_t _new_tempo )
 		return;
 	}
 
+	// sub-notes are play handles of their own and update themselves
 	double completed = m_totalFramesPlayed / (double) m_frames;
-	double new_frames = m_origFrames * m_origTempo / (double) _new_tempo;
+	double new_frames = m_ticks * m_framesPerTick;
 	m_frames = (f_cnt_t)new_frames;
 	m_totalFramesPlayed = (f_cnt_t)( completed * new_frames );
+}
 
-	for( NotePlayHandleList::Iterator it = m_subNotes.begin(); it != m_subNotes.end(); ++it )
+
+namespace
+{
+
+// the storage of a handle, followed by what the pool needs while it's free
+struct Slot
+{
+	alignas( NotePlayHandle ) char handle[sizeof( NotePlayHandle )];
+	std::atomic<quint32> next;
+	quint32 index;
+} ;
+
+
+// 262144 handles at most
+const int MaxChunks = 4096;
+
+// how many released handles a thread keeps for itself
+const int ThreadCacheSize = 16;
+
+}
+
+
+static std::atomic<Slot *> s_chunks[MaxChunks];
+static std::atomic_int s_chunkCount( 0 );
+
+// top of the stack of free slots, index + 1 in the lower 32 bits (0 if the
+// stack is empty) and a counter against ABA in the upper ones
+static std::atomic<quint64> s_freeSlots( 0 );
+
+
+
+
+static Slot * slot( quint32 _index )
+{
+	return s_chunks[_index / NPH_CACHE_INCREMENT].load(
+			std::memory_order_acquire ) + _index % NPH_CACHE_INCREMENT;
+}
+
+
+
+
+static void pushSlot( Slot * _slot )
+{
+	quint64 top = s_freeSlots.load( std::memory_order_relaxed );
+	quint64 newTop;
+	do
 	{
-		( *it )->resize( _new_tempo );
+		_slot->next.store( (quint32) top, std::memory_order_relaxed );
+		newTop = ( ( top >> 32 ) + 1 ) << 32 | ( _slot->index + 1 );
 	}
+	while( !s_freeSlots.compare_exchange_weak( top, newTop,
+			std::memory_order_release, std::memory_order_relaxed ) );
 }
 
 
-NotePlayHandle ** NotePlayHandleManager::s_available;
-QReadWriteLock NotePlayHandleManager::s_mutex;
-std::atomic_int NotePlayHandleManager::s_availableIndex;
-int NotePlayHandleManager::s_size;
 
 
-void NotePlayHandleManager::init()
+static Slot * popSlot()
 {
-	s_available = MM_ALLOC( NotePlayHandle*, INITIAL_NPH_CACHE );
+	quint64 top = s_freeSlots.load( std::memory_order_acquire );
+	while( (quint32) top != 0 )
+	{
+		// the slot may have been taken and released again meanwhile,
+		// the counter makes the exchange fail then. As slots are never
+		// freed, reading next of a taken slot is fine.
+		Slot * candidate = slot( (quint32) top - 1 );
+		const quint64 newTop = ( ( top >> 32 ) + 1 ) << 32 |
+			candidate->next.load( std::memory_order_relaxed );
+		if( s_freeSlots.compare_exchange_weak( top, newTop,
+			std::memory_order_acquire, std::memory_order_acquire ) )
+		{
+			return candidate;
+		}
+	}
+	return NULL;
+}
+
+
+
+
+// adds a chunk and returns one of its slots, the others go to the stack
+static Slot * addChunk()
+{
+	int chunk = s_chunkCount.load();
+	do
+	{
+		if( chunk >= MaxChunks )
+		{
+			qFatal( "NotePlayHandleManager: too many notes" );
+		}
+	}
+	while( !s_chunkCount.compare_exchange_weak( chunk, chunk + 1 ) );
 
-	NotePlayHandle * n = MM_ALLOC( NotePlayHandle, INITIAL_NPH_CACHE );
+	Slot * slots = MM_ALLOC_TAGGED( Slot, NPH_CACHE_INCREMENT, NotePlayHandles );
+	for( int i = 0; i < NPH_CACHE_INCREMENT; ++i )
+	{
+		new( &slots[i] ) Slot;
+		slots[i].index = chunk * NPH_CACHE_INCREMENT + i;
+	}
+	s_chunks[chunk].store( slots, std::memory_order_release );
 
-	for( int i=0; i < INITIAL_NPH_CACHE; ++i )
+	for( int i = 1; i < NPH_CACHE_INCREMENT; ++i )
 	{
-		s_available[ i ] = n;
-		++n;
+		pushSlot( &slots[i] );
 	}
-	s_availableIndex = INITIAL_NPH_CACHE - 1;
-	s_size = INITIAL_NPH_CACHE;
+	return &slots[0];
+}
+
+
+
+
+namespace
+{
+
+struct ThreadCache
+{
+	ThreadCache() :
+		count( 0 )
+	{
+	}
+
+	// hand everything back when the thread finishes
+	~ThreadCache()
+	{
+		while( count > 0 )
+		{
+			pushSlot( slots[--count] );
+		}
+	}
+
+	Slot * slots[ThreadCacheSize];
+	int count;
+} ;
+
+}
+
+static thread_local ThreadCache s_threadCache;
+
+
+
+
+void NotePlayHandleManager::init()
+{
+	reserve( INITIAL_NPH_CACHE );
 }
 
 
@@ -588,12 +936,14 @@ NotePlayHandle * NotePlayHandleManager::acquire( InstrumentTrack* instrumentTrac
 				int midiEventChannel,
 				NotePlayHandle::Origin origin )
 {
-	// TODO: use some lockless data structures
-	s_mutex.lockForWrite();
-	if (s_availableIndex < 0) { extend(NPH_CACHE_INCREMENT); }
-	NotePlayHandle * nph = s_available[s_availableIndex--];
-	s_mutex.unlock();
+	ThreadCache & cache = s_threadCache;
+	Slot * handleSlot = cache.count > 0 ? cache.slots[--cache.count] : popSlot();
+	if( handleSlot == NULL )
+	{
+		handleSlot = addChunk();
+	}
 
+	NotePlayHandle * nph = reinterpret_cast<NotePlayHandle *>( handleSlot->handle );
 	new( (void*)nph ) NotePlayHandle( instrumentTrack, offset, frames, noteToPlay, parent, midiEventChannel, origin );
 	return nph;
 }
@@ -602,24 +952,31 @@ NotePlayHandle * NotePlayHandleManager::acquire( InstrumentTrack* instrumentTrac
 void NotePlayHandleManager::release( NotePlayHandle * nph )
 {
 	nph->NotePlayHandle::~NotePlayHandle();
-	s_mutex.lockForRead();
-	s_available[++s_availableIndex] = nph;
-	s_mutex.unlock();
+
+	// handle is the first member of the slot
+	Slot * handleSlot = reinterpret_cast<Slot *>( nph );
+	ThreadCache & cache = s_threadCache;
+	if( cache.count < ThreadCacheSize )
+	{
+		cache.slots[cache.count++] = handleSlot;
+	}
+	else
+	{
+		pushSlot( handleSlot );
+	}
 }
 
 
-void NotePlayHandleManager::extend( int c )
+void NotePlayHandleManager::reserve( int count )
 {
-	s_size += c;
-	NotePlayHandle ** tmp = MM_ALLOC( NotePlayHandle*, s_size );
-	MM_FREE( s_available );
-	s_available = tmp;
-
-	NotePlayHandle * n = MM_ALLOC( NotePlayHandle, c );
-
-	for( int i=0; i < c; ++i )
+	while( capacity() < count )
 	{
-		s_available[++s_availableIndex] = n;
-		++n;
+		pushSlot( addChunk() );
 	}
 }
+
+
+int NotePlayHandleManager::capacity()
+{
+	return s_chunkCount.load( std::memory_order_relaxed ) * NPH_CACHE_INCREMENT;
+}
@@ -0,0 +1,300 @@
+/*
+ * OneShotCache.cpp - rendered sounds of deterministic one-shot instruments
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "OneShotCache.h"
+
+#include <QtCore/QRunnable>
+
+#include <cstring>
+
+
+// frames rendered at once when completing a sound in the background
+static const fpp_t CompletionFrames = 256;
+
+
+//! Completes the sound of a note which ended before its sound did
+class OneShotCompleter : public QRunnable
+{
+public:
+	OneShotCompleter( OneShotCache * _cache, quint64 _key,
+			OneShotCache::Renderer * _renderer,
+			OneShotCache::Sound * _recording ) :
+		m_cache( _cache ),
+		m_key( _key ),
+		m_renderer( _renderer ),
+		m_recording( _recording )
+	{
+	}
+
+	virtual ~OneShotCompleter()
+	{
+		delete m_renderer;
+		delete m_recording;
+	}
+
+	virtual void run()
+	{
+		sampleFrame buf[CompletionFrames];
+		bool playing = true;
+		while( playing )
+		{
+			playing = m_renderer->render( buf, CompletionFrames );
+			if( m_recording->size() / DEFAULT_CHANNELS +
+				CompletionFrames > static_cast<size_t>( m_cache->m_maxFrames ) )
+			{
+				return;
+			}
+			m_recording->insert( m_recording->end(), buf[0],
+					buf[0] + CompletionFrames * DEFAULT_CHANNELS );
+		}
+
+		m_cache->insert( m_key, m_recording );
+		m_recording = nullptr;
+	}
+
+private:
+	OneShotCache * m_cache;
+	quint64 m_key;
+	OneShotCache::Renderer * m_renderer;
+	OneShotCache::Sound * m_recording;
+
+} ;
+
+
+
+
+OneShotCache::Key & OneShotCache::Key::operator<<( float _value )
+{
+	add( &_value, sizeof( _value ) );
+	return *this;
+}
+
+
+
+
+OneShotCache::Key & OneShotCache::Key::operator<<( int _value )
+{
+	add( &_value, sizeof( _value ) );
+	return *this;
+}
+
+
+
+
+void OneShotCache::Key::add( const void * _data, size_t _size )
+{
+	// FNV-1a
+	const unsigned char * bytes = static_cast<const unsigned char *>( _data );
+	for( size_t i = 0; i < _size; ++i )
+	{
+		m_hash ^= bytes[i];
+		m_hash *= 1099511628211ULL;
+	}
+}
+
+
+
+
+OneShotCache::Voice::Voice( OneShotCache * _cache, const Key & _key,
+							Renderer * _renderer ) :
+	m_cache( _cache ),
+	m_key( _key.value() ),
+	m_sound( _cache ? _cache->find( _key.value() ) : nullptr ),
+	m_position( 0 ),
+	m_renderer( _renderer ),
+	m_recording( nullptr ),
+	m_rendering( m_sound == nullptr )
+{
+	if( m_rendering && m_cache )
+	{
+		m_recording.reset( new Sound );
+	}
+	else if( !m_rendering )
+	{
+		delete m_renderer;
+		m_renderer = nullptr;
+	}
+}
+
+
+
+
+OneShotCache::Voice::~Voice()
+{
+	if( m_rendering && m_recording )
+	{
+		// the note ended before its sound did
+		m_cache->complete( m_key, m_renderer, m_recording.release() );
+		m_renderer = nullptr;
+	}
+	delete m_renderer;
+}
+
+
+
+
+void OneShotCache::Voice::render( sampleFrame * _buf, fpp_t _frames )
+{
+	if( m_sound )
+	{
+		const f_cnt_t frames = static_cast<f_cnt_t>(
+					m_sound->size() / DEFAULT_CHANNELS );
+		const fpp_t streamed = static_cast<fpp_t>( qBound<f_cnt_t>( 0,
+					frames - m_position, _frames ) );
+		memcpy( _buf, m_sound->data() + m_position * DEFAULT_CHANNELS,
+					sizeof( sampleFrame ) * streamed );
+		memset( _buf + streamed, 0,
+				sizeof( sampleFrame ) * ( _frames - streamed ) );
+		m_position += streamed;
+		return;
+	}
+
+	if( !m_rendering )
+	{
+		memset( _buf, 0, sizeof( sampleFrame ) * _frames );
+		return;
+	}
+
+	m_rendering = m_renderer->render( _buf, _frames );
+	if( m_recording )
+	{
+		if( m_recording->size() / DEFAULT_CHANNELS + _frames >
+				static_cast<size_t>( m_cache->m_maxFrames ) )
+		{
+			// too long to be cached
+			m_recording.reset();
+		}
+		else
+		{
+			m_recording->insert( m_recording->end(), _buf[0],
+					_buf[0] + _frames * DEFAULT_CHANNELS );
+		}
+	}
+
+	if( !m_rendering && m_recording )
+	{
+		m_cache->insert( m_key, m_recording.release() );
+	}
+}
+
+
+
+
+bool OneShotCache::Voice::isPlaying() const
+{
+	if( m_sound )
+	{
+		return m_position * DEFAULT_CHANNELS <
+				static_cast<f_cnt_t>( m_sound->size() );
+	}
+	return m_rendering;
+}
+
+
+
+
+OneShotCache::OneShotCache( f_cnt_t _maxFrames ) :
+	m_maxFrames( _maxFrames ),
+	m_frames( 0 )
+{
+	m_completer.setMaxThreadCount( 1 );
+}
+
+
+
+
+OneShotCache::~OneShotCache()
+{
+	m_completer.clear();
+	m_completer.waitForDone();
+}
+
+
+
+
+void OneShotCache::clear()
+{
+	QHash<quint64, SoundPtr> sounds;
+	QMutexLocker lock( &m_mutex );
+	sounds.swap( m_sounds );
+	m_order.clear();
+	m_frames = 0;
+}
+
+
+
+
+int OneShotCache::size() const
+{
+	QMutexLocker lock( &m_mutex );
+	return m_sounds.size();
+}
+
+
+
+
+OneShotCache::SoundPtr OneShotCache::find( quint64 _key ) const
+{
+	QMutexLocker lock( &m_mutex );
+	return m_sounds.value( _key );
+}
+
+
+
+
+void OneShotCache::insert( quint64 _key, Sound * _sound )
+{
+	// declared before the lock, so the sound if it's not needed and
+	// dropped sounds no note streams anymore get freed outside of it
+	SoundPtr sound( _sound );
+	QList<SoundPtr> dropped;
+	const f_cnt_t frames = static_cast<f_cnt_t>(
+					sound->size() / DEFAULT_CHANNELS );
+
+	QMutexLocker lock( &m_mutex );
+	if( m_sounds.contains( _key ) )
+	{
+		// another note of the same sound finished first
+		return;
+	}
+
+	while( !m_order.isEmpty() && m_frames + frames > m_maxFrames )
+	{
+		dropped.append( m_sounds.take( m_order.takeFirst() ) );
+		m_frames -= static_cast<f_cnt_t>(
+				dropped.last()->size() / DEFAULT_CHANNELS );
+	}
+
+	m_sounds.insert( _key, sound );
+	m_order.append( _key );
+	m_frames += frames;
+}
+
+
+
+
+void OneShotCache::complete( quint64 _key, Renderer * _renderer,
+							Sound * _recording )
+{
+	m_completer.start( new OneShotCompleter( this, _key, _renderer,
+								_recording ) );
+}
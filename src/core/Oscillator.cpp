@@ -24,6 +24,7 @@
 
 #include "Oscillator.h"
 
+#include "BandLimitedWave.h"
 #include "BufferManager.h"
 #include "Engine.h"
 #include "Mixer.h"
@@ -47,7 +48,9 @@ Oscillator::Oscillator( const IntModel * _wave_shape_model,
 	m_subOsc( _sub_osc ),
 	m_phaseOffset( _phase_offset ),
 	m_phase( _phase_offset ),
-	m_userWave( NULL )
+	m_userWave( NULL ),
+	m_useWaveTable( false ),
+	m_waveTable( 0 )
 {
 }
 
@@ -323,6 +326,19 @@ inline void Oscillator::recalcPhase()
 
 
 
+// the frequency is the same for the whole period, so is the mipmap level
+inline void Oscillator::selectWaveTable( float _osc_coeff )
+{
+	if( m_useWaveTable )
+	{
+		m_waveTable = BandLimitedWave::tableIndex(
+				BandLimitedWave::pdToLen( qAbs( _osc_coeff ) ) );
+	}
+}
+
+
+
+
 inline bool Oscillator::syncOk( float _osc_coeff )
 {
 	const float v1 = m_phase;
@@ -355,6 +371,7 @@ void Oscillator::updateNoSub( sampleFrame * _ab, const fpp_t _frames,
 {
 	recalcPhase();
 	const float osc_coeff = m_freq * m_detuning;
+	selectWaveTable( osc_coeff );
 
 	for( fpp_t frame = 0; frame < _frames; ++frame )
 	{
@@ -374,6 +391,7 @@ void Oscillator::updatePM( sampleFrame * _ab, const fpp_t _frames,
 	m_subOsc->update( _ab, _frames, _chnl );
 	recalcPhase();
 	const float osc_coeff = m_freq * m_detuning;
+	selectWaveTable( osc_coeff );
 
 	for( fpp_t frame = 0; frame < _frames; ++frame )
 	{
@@ -395,6 +413,7 @@ void Oscillator::updateAM( sampleFrame * _ab, const fpp_t _frames,
 	m_subOsc->update( _ab, _frames, _chnl );
 	recalcPhase();
 	const float osc_coeff = m_freq * m_detuning;
+	selectWaveTable( osc_coeff );
 
 	for( fpp_t frame = 0; frame < _frames; ++frame )
 	{
@@ -414,6 +433,7 @@ void Oscillator::updateMix( sampleFrame * _ab, const fpp_t _frames,
 	m_subOsc->update( _ab, _frames, _chnl );
 	recalcPhase();
 	const float osc_coeff = m_freq * m_detuning;
+	selectWaveTable( osc_coeff );
 
 	for( fpp_t frame = 0; frame < _frames; ++frame )
 	{
@@ -434,6 +454,7 @@ void Oscillator::updateSync( sampleFrame * _ab, const fpp_t _frames,
 	const float sub_osc_coeff = m_subOsc->syncInit( _ab, _frames, _chnl );
 	recalcPhase();
 	const float osc_coeff = m_freq * m_detuning;
+	selectWaveTable( osc_coeff );
 
 	for( fpp_t frame = 0; frame < _frames ; ++frame )
 	{
@@ -457,6 +478,7 @@ void Oscillator::updateFM( sampleFrame * _ab, const fpp_t _frames,
 	m_subOsc->update( _ab, _frames, _chnl );
 	recalcPhase();
 	const float osc_coeff = m_freq * m_detuning;
+	selectWaveTable( osc_coeff );
 	const float sampleRateCorrection = 44100.0f /
 				Engine::mixer()->processingSampleRate();
 
@@ -485,6 +507,11 @@ template<>
 inline sample_t Oscillator::getSample<Oscillator::TriangleWave>(
 							const float _sample )
 {
+	if( m_useWaveTable )
+	{
+		return( BandLimitedWave::oscillateTable( _sample, m_waveTable,
+						BandLimitedWave::BLTriangle ) );
+	}
 	return( triangleSample( _sample ) );
 }
 
@@ -495,6 +522,11 @@ template<>
 inline sample_t Oscillator::getSample<Oscillator::SawWave>(
 							const float _sample )
 {
+	if( m_useWaveTable )
+	{
+		return( BandLimitedWave::oscillateTable( _sample, m_waveTable,
+						BandLimitedWave::BLSaw ) );
+	}
 	return( sawSample( _sample ) );
 }
 
@@ -505,6 +537,11 @@ template<>
 inline sample_t Oscillator::getSample<Oscillator::SquareWave>(
 							const float _sample )
 {
+	if( m_useWaveTable )
+	{
+		return( BandLimitedWave::oscillateTable( _sample, m_waveTable,
+						BandLimitedWave::BLSquare ) );
+	}
 	return( squareSample( _sample ) );
 }
 
@@ -515,6 +552,11 @@ template<>
 inline sample_t Oscillator::getSample<Oscillator::MoogSawWave>(
 							const float _sample )
 {
+	if( m_useWaveTable )
+	{
+		return( BandLimitedWave::oscillateTable( _sample, m_waveTable,
+						BandLimitedWave::BLMoog ) );
+	}
 	return( moogSawSample( _sample ) );
 }
 
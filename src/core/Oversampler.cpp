@@ -0,0 +1,202 @@
+/*
+ * Oversampler.cpp - runs a nonlinear stage of an effect or instrument at a
+ *                   multiple of the processing rate
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "Oversampler.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QtCore/QtGlobal>
+
+
+Oversampler::Oversampler( int factor, Decimator::Qualities quality ) :
+	m_factor( 1 ),
+	m_buffer( new sampleFrame[BlockSize * MaxFactor] )
+{
+	m_scratch[0].resize( BlockSize * MaxFactor );
+	m_scratch[1].resize( BlockSize * MaxFactor );
+	setup( factor, quality );
+}
+
+
+
+
+Oversampler::~Oversampler()
+{
+	delete[] m_buffer;
+}
+
+
+
+
+void Oversampler::setup( int factor, Decimator::Qualities quality )
+{
+	int stages = 0;
+	while( ( 2 << stages ) <= qBound( 1, factor, MaxFactor ) )
+	{
+		++stages;
+	}
+	m_factor = 1 << stages;
+
+	// the reverse of the decimator, the first stage is at the lowest rate
+	m_stages.resize( stages );
+	for( int s = 0; s < stages; ++s )
+	{
+		int pairs;
+		double beta;
+		Decimator::stageDesign( quality, s == 0, pairs, beta );
+		m_stages[s].design( pairs, beta, BlockSize << s );
+	}
+
+	if( stages > 0 )
+	{
+		m_decimator.setup( m_factor, quality );
+	}
+}
+
+
+
+
+float Oversampler::latency() const
+{
+	if( m_factor == 1 )
+	{
+		return 0.0f;
+	}
+
+	// each stage delays by half its taps at its input rate
+	float frames = m_decimator.latency();
+	int rate = 1;
+	for( const Stage & stage : m_stages )
+	{
+		frames += static_cast<float>( stage.taps.size() / 2 ) / rate;
+		rate *= 2;
+	}
+	return frames;
+}
+
+
+
+
+void Oversampler::reset()
+{
+	for( Stage & stage : m_stages )
+	{
+		stage.clear();
+	}
+	m_decimator.reset();
+}
+
+
+
+
+void Oversampler::upsample( const sampleFrame * _in, fpp_t _frames )
+{
+	for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+	{
+		float * in = m_scratch[0].data();
+		float * out = m_scratch[1].data();
+		for( fpp_t f = 0; f < _frames; ++f )
+		{
+			in[f] = _in[f][ch];
+		}
+
+		int n = _frames;
+		for( Stage & stage : m_stages )
+		{
+			stage.process( ch, in, n, out );
+			std::swap( in, out );
+			n *= 2;
+		}
+
+		for( int f = 0; f < n; ++f )
+		{
+			m_buffer[f][ch] = in[f];
+		}
+	}
+}
+
+
+
+
+void Oversampler::Stage::design( int pairs, double beta, int blockSize )
+{
+	// twice the gain as only every other frame has been there before
+	taps = Decimator::halfBandTaps( pairs, beta );
+	for( float & tap : taps )
+	{
+		tap *= 2.0f;
+	}
+
+	for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+	{
+		history[ch].assign( taps.size() - 1 + blockSize, 0.0f );
+	}
+	between.assign( blockSize, 0.0f );
+}
+
+
+
+
+void Oversampler::Stage::clear()
+{
+	for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+	{
+		std::fill( history[ch].begin(), history[ch].end(), 0.0f );
+	}
+}
+
+
+
+
+void Oversampler::Stage::process( int _channel, const float * _in,
+						int _frames, float * _out )
+{
+	const int count = static_cast<int>( taps.size() );
+	const int delay = count - 1;
+	float * __restrict h = history[_channel].data();
+	memcpy( h + delay, _in, sizeof( float ) * _frames );
+
+	// the frames between the input frames
+	float * __restrict b = between.data();
+	std::fill( b, b + _frames, 0.0f );
+	for( int m = 0; m < count; ++m )
+	{
+		const float tap = taps[m];
+		const float * __restrict src = h + m;
+		for( int i = 0; i < _frames; ++i )
+		{
+			b[i] += tap * src[i];
+		}
+	}
+
+	// the input frames are as far behind as the middle of the taps
+	const float * __restrict centre = h + count / 2 - 1;
+	for( int i = 0; i < _frames; ++i )
+	{
+		_out[2 * i] = centre[i];
+		_out[2 * i + 1] = b[i];
+	}
+
+	memmove( h, h + _frames, sizeof( float ) * delay );
+}
@@ -0,0 +1,369 @@
+/*
+ * PartitionedConvolver.cpp - zero-latency convolution with long impulse
+ *                            responses
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "PartitionedConvolver.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#include <QtCore/QtGlobal>
+
+#include "fft_helpers.h"
+#include "MixerWorkerThread.h"
+#include "ThreadableJob.h"
+
+
+// each stage has partitions this many times as long as the one before
+static const int StageGrowth = 8;
+
+static_assert( PartitionedConvolver::MaxPartition %
+				PartitionedConvolver::HeadSize == 0,
+		"stage boundaries have to coincide with head chunks" );
+
+
+
+
+// Uniformly partitioned overlap-save convolution of one section of the
+// impulse response. At the end of each block of Partition input samples
+// the last two blocks are transformed and multiplied with the spectra of
+// all partitions, each against the input spectrum as many blocks old as
+// the partition is in the section. The inverse transform yields the last
+// block convolved with the section, which is played Offset samples later:
+// right away for the first stage (Offset == Partition), a block later for
+// the others (Offset == 2 * Partition), which leaves them a block of time
+// to be computed in.
+class PartitionedConvolver::Stage : public ThreadableJob
+{
+	MM_OPERATORS
+public:
+	Stage( const float * _ir, f_cnt_t _taps, int _partition, int _count,
+								bool _deferred ) :
+		m_partition( _partition ),
+		m_count( _count ),
+		m_bins( _partition + 1 ),
+		// keeps every spectrum as aligned as the first one
+		m_stride( ( _partition + 8 ) & ~7 ),
+		m_deferred( _deferred )
+	{
+		const int size = 2 * m_partition;
+		m_spectra = allocComplex( m_count * m_stride );
+		m_inputSpectra = allocComplex( m_count * m_stride );
+		m_sum = allocComplex( m_stride );
+		m_window = allocReal( size );
+		m_input = allocReal( size );
+		m_result = allocReal( size );
+		m_output = allocReal( m_partition );
+		m_next = allocReal( m_partition );
+
+		m_forward = realFFTPlan( size, m_input, m_inputSpectra );
+		m_inverse = realIFFTPlan( size, m_sum, m_result );
+
+		// the spectra already include the normalization of the inverse
+		// transform
+		const float scale = 1.0f / size;
+		for( int j = 0; j < m_count; ++j )
+		{
+			const f_cnt_t begin = static_cast<f_cnt_t>( j ) * m_partition;
+			const f_cnt_t taps = qBound<f_cnt_t>( 0, _taps - begin,
+								m_partition );
+			memset( m_input, 0, size * sizeof( float ) );
+			for( f_cnt_t i = 0; i < taps; ++i )
+			{
+				m_input[i] = _ir[begin + i] * scale;
+			}
+			fftwf_execute_dft_r2c( m_forward, m_input,
+						m_spectra + j * m_stride );
+		}
+
+		reset();
+	}
+
+	~Stage()
+	{
+		finish();
+		fftwf_free( m_spectra );
+		fftwf_free( m_inputSpectra );
+		fftwf_free( m_sum );
+		fftwf_free( m_window );
+		fftwf_free( m_input );
+		fftwf_free( m_result );
+		fftwf_free( m_output );
+		fftwf_free( m_next );
+	}
+
+	void reset()
+	{
+		finish();
+		memset( m_inputSpectra, 0,
+				m_count * m_stride * sizeof( fftwf_complex ) );
+		memset( m_window, 0, 2 * m_partition * sizeof( float ) );
+		memset( m_output, 0, m_partition * sizeof( float ) );
+		memset( m_next, 0, m_partition * sizeof( float ) );
+		m_newest = 0;
+	}
+
+	int partition() const
+	{
+		return m_partition;
+	}
+
+	//! Add input samples at _offset of the current block
+	void write( const float * _in, int _frames, int _offset )
+	{
+		memcpy( m_window + m_partition + _offset, _in,
+						_frames * sizeof( float ) );
+	}
+
+	//! Add output samples at _offset of the current block
+	void read( float * _out, int _frames, int _offset ) const
+	{
+		const float * output = m_output + _offset;
+		for( int i = 0; i < _frames; ++i )
+		{
+			_out[i] += output[i];
+		}
+	}
+
+	//! Called after the last sample of a block has been written
+	void endBlock( bool _useWorkers )
+	{
+		finish();
+		memcpy( m_input, m_window, 2 * m_partition * sizeof( float ) );
+		memmove( m_window, m_window + m_partition,
+						m_partition * sizeof( float ) );
+		if( !m_deferred )
+		{
+			doProcessing();
+			std::swap( m_output, m_next );
+			return;
+		}
+
+		// the result of the previous block is due now
+		std::swap( m_output, m_next );
+		if( !_useWorkers || !MixerWorkerThread::addJob( this ) )
+		{
+			queue();
+			process();
+		}
+	}
+
+	bool requiresProcessing() const override
+	{
+		return true;
+	}
+
+
+protected:
+	void doProcessing() override
+	{
+		m_newest = ( m_newest + 1 ) % m_count;
+		fftwf_execute_dft_r2c( m_forward, m_input,
+					m_inputSpectra + m_newest * m_stride );
+
+		memset( m_sum, 0, m_bins * sizeof( fftwf_complex ) );
+		for( int j = 0; j < m_count; ++j )
+		{
+			const int age = ( m_newest - j + m_count ) % m_count;
+			const fftwf_complex * h = m_spectra + j * m_stride;
+			const fftwf_complex * x = m_inputSpectra + age * m_stride;
+			for( int k = 0; k < m_bins; ++k )
+			{
+				m_sum[k][0] += h[k][0] * x[k][0] - h[k][1] * x[k][1];
+				m_sum[k][1] += h[k][0] * x[k][1] + h[k][1] * x[k][0];
+			}
+		}
+
+		fftwf_execute_dft_c2r( m_inverse, m_sum, m_result );
+		memcpy( m_next, m_result + m_partition,
+					m_partition * sizeof( float ) );
+	}
+
+	const char * traceName() const override
+	{
+		return "PartitionedConvolver";
+	}
+
+
+private:
+	static fftwf_complex * allocComplex( int _count )
+	{
+		return static_cast<fftwf_complex *>(
+				fftwf_malloc( _count * sizeof( fftwf_complex ) ) );
+	}
+
+	static float * allocReal( int _count )
+	{
+		return static_cast<float *>(
+				fftwf_malloc( _count * sizeof( float ) ) );
+	}
+
+	// wait for the job queued with the last block, or do it now if no
+	// worker has taken it yet
+	void finish()
+	{
+		if( state() == ProcessingState::Queued )
+		{
+			process();
+		}
+		while( state() == ProcessingState::InProgress )
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	const int m_partition;
+	const int m_count;
+	const int m_bins;
+	const int m_stride;
+	const bool m_deferred;
+
+	fftwf_plan m_forward;
+	fftwf_plan m_inverse;
+
+	// of the partitions, m_count times m_stride bins
+	fftwf_complex * m_spectra;
+	// of the last m_count blocks, a ring ending at m_newest
+	fftwf_complex * m_inputSpectra;
+	int m_newest;
+	fftwf_complex * m_sum;
+
+	// the previous block and the one being written
+	float * m_window;
+	// m_window at the end of the last block, for doProcessing()
+	float * m_input;
+	float * m_result;
+	// played during the current block
+	float * m_output;
+	// written by doProcessing(), played during the next block
+	float * m_next;
+
+} ;
+
+
+
+
+PartitionedConvolver::PartitionedConvolver( const float * _ir,
+					f_cnt_t _length, bool _useWorkers ) :
+	m_length( qMax<f_cnt_t>( _length, 0 ) ),
+	m_useWorkers( _useWorkers )
+{
+	memset( m_head, 0, sizeof( m_head ) );
+	memcpy( m_head, _ir, qMin<f_cnt_t>( m_length, HeadSize ) *
+							sizeof( float ) );
+
+	// each stage ends where the next one can start with a block of time
+	// for its computation, the last stage takes the rest
+	f_cnt_t offset = HeadSize;
+	int partition = HeadSize;
+	while( offset < m_length )
+	{
+		const int next = qMin( partition * StageGrowth, MaxPartition );
+		const f_cnt_t end = next > partition ?
+				qMin<f_cnt_t>( 2 * next, m_length ) : m_length;
+		const int count = ( end - offset + partition - 1 ) / partition;
+		m_stages.push_back( new Stage( _ir + offset, m_length - offset,
+					partition, count, offset > partition ) );
+		offset += static_cast<f_cnt_t>( count ) * partition;
+		partition = next;
+	}
+
+	reset();
+}
+
+
+
+
+PartitionedConvolver::~PartitionedConvolver()
+{
+	for( Stage * stage : m_stages )
+	{
+		delete stage;
+	}
+}
+
+
+
+
+void PartitionedConvolver::process( float * _buf, fpp_t _frames )
+{
+	fpp_t done = 0;
+	while( done < _frames )
+	{
+		// chunks end at head boundaries, so they never span two blocks
+		// of any stage
+		const int offset = m_position % HeadSize;
+		const int frames = qMin<int>( _frames - done, HeadSize - offset );
+		float * buf = _buf + done;
+
+		memcpy( m_history + HeadSize - 1, buf, frames * sizeof( float ) );
+		for( Stage * stage : m_stages )
+		{
+			stage->write( buf, frames,
+					m_position % stage->partition() );
+		}
+
+		// the head tap by tap, each over the whole chunk
+		memset( buf, 0, frames * sizeof( float ) );
+		for( int k = 0; k < HeadSize; ++k )
+		{
+			const float h = m_head[k];
+			const float * x = m_history + HeadSize - 1 - k;
+			for( int i = 0; i < frames; ++i )
+			{
+				buf[i] += h * x[i];
+			}
+		}
+
+		for( Stage * stage : m_stages )
+		{
+			stage->read( buf, frames, m_position % stage->partition() );
+		}
+
+		memmove( m_history, m_history + frames,
+					( HeadSize - 1 ) * sizeof( float ) );
+		m_position = ( m_position + frames ) % MaxPartition;
+		done += frames;
+
+		for( Stage * stage : m_stages )
+		{
+			if( m_position % stage->partition() == 0 )
+			{
+				stage->endBlock( m_useWorkers );
+			}
+		}
+	}
+}
+
+
+
+
+void PartitionedConvolver::reset()
+{
+	memset( m_history, 0, sizeof( m_history ) );
+	for( Stage * stage : m_stages )
+	{
+		stage->reset();
+	}
+	m_position = 0;
+}
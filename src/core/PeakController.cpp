@@ -113,7 +113,7 @@ void PeakController::updateValueBuffer()
 	{
 		m_valueBuffer.fill( 0 );
 	}
-	m_bufferLastUpdated = s_periods;
+	m_bufferLastUpdated = runningPeriods();
 }
 
 
@@ -101,6 +101,12 @@ PerfLogTimer::PerfLogTimer(const QString& what)
 	begin();
 }
 
+PerfLogTimer::PerfLogTimer(const QString& what, bool active)
+	: name(what)
+{
+	if (active) { begin(); }
+}
+
 PerfLogTimer::~PerfLogTimer()
 {
 	end();
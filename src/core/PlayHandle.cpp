@@ -23,6 +23,7 @@
  */
  
 #include "PlayHandle.h"
+#include "AudioPort.h"
 #include "BufferManager.h"
 #include "Engine.h"
 #include "Mixer.h"
@@ -38,7 +39,10 @@ PlayHandle::PlayHandle(const Type type, f_cnt_t offset) :
 		m_affinity(QThread::currentThread()),
 		m_playHandleBuffer(BufferManager::acquire()),
 		m_bufferReleased(true),
-		m_usesBuffer(true)
+		m_usesBuffer(true),
+		m_audioPort(NULL),
+		m_mixerSlot(-1),
+		m_aheadOfPeriod(false)
 {
 }
 
@@ -64,6 +68,32 @@ void PlayHandle::doProcessing()
 }
 
 
+void PlayHandle::accountProcessingTime( int microseconds )
+{
+	// of the handle itself for the Mixer's job order
+	ThreadableJob::accountProcessingTime( microseconds );
+	if( m_audioPort )
+	{
+		m_audioPort->m_playHandleCpuUsage.accumulate( microseconds );
+	}
+}
+
+
+const char * PlayHandle::traceName() const
+{
+	switch( m_type )
+	{
+		case TypeNotePlayHandle: return "NotePlayHandle";
+		case TypeInstrumentPlayHandle: return "InstrumentPlayHandle";
+		case TypeSamplePlayHandle: return "SamplePlayHandle";
+		case TypePresetPreviewHandle: return "PresetPreviewPlayHandle";
+		case TypeFreezePlayHandle: return "FreezePlayHandle";
+		case TypeBBLoopPlayHandle: return "BBLoopPlayHandle";
+	}
+	return "PlayHandle";
+}
+
+
 void PlayHandle::releaseBuffer()
 {
 	m_bufferReleased = true;
@@ -25,14 +25,18 @@
 #include "PluginFactory.h"
 
 #include <QtCore/QCoreApplication>
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
 #include <QtCore/QDebug>
 #include <QtCore/QDir>
 #include <QtCore/QLibrary>
+#include <QtCore/QSaveFile>
 #include "lmmsconfig.h"
 
 #include "ConfigManager.h"
 #include "Plugin.h"
 #include "embed.h"
+#include "lmmsversion.h"
 
 #ifdef LMMS_BUILD_WIN32
 	QStringList nameFilters("*.dll");
@@ -40,6 +44,9 @@
 	QStringList nameFilters("lib*.so");
 #endif
 
+// bumped whenever what's kept of a plugin changes
+static const char* ManifestHeader = "lmms-plugin-manifest 1 " LMMS_VERSION;
+
 qint64 qHash(const QFileInfo& fi)
 {
 	return qHash(fi.absoluteFilePath());
@@ -99,32 +106,46 @@ PluginFactory* PluginFactory::instance()
 	return s_instance.get();
 }
 
-const Plugin::DescriptorList PluginFactory::descriptors() const
+const Plugin::DescriptorList PluginFactory::descriptors()
 {
+	loadAll();
 	return m_descriptors.values();
 }
 
-const Plugin::DescriptorList PluginFactory::descriptors(Plugin::PluginTypes type) const
+const Plugin::DescriptorList PluginFactory::descriptors(Plugin::PluginTypes type)
 {
+	loadAll(type);
 	return m_descriptors.values(type);
 }
 
-const PluginFactory::PluginInfoList& PluginFactory::pluginInfos() const
+const PluginFactory::PluginInfoList& PluginFactory::pluginInfos()
 {
+	loadAll();
 	return m_pluginInfos;
 }
 
 const PluginFactory::PluginInfoAndKey PluginFactory::pluginSupportingExtension(const QString& ext)
 {
+	if (!m_pluginByExt.contains(ext) && m_lazyPluginByExt.contains(ext))
+	{
+		// loading it adds its extensions with the keys of its sub plugins
+		pluginInfo(m_lazyPluginByExt.value(ext).toUtf8().constData());
+	}
 	return m_pluginByExt.value(ext, PluginInfoAndKey());
 }
 
-const PluginFactory::PluginInfo PluginFactory::pluginInfo(const char* name) const
+const PluginFactory::PluginInfo PluginFactory::pluginInfo(const char* name)
 {
-	for (const PluginInfo& info : m_pluginInfos)
+	for (PluginInfo& info : m_pluginInfos)
 	{
 		if (qstrcmp(info.descriptor->name, name) == 0)
+		{
+			if (!info.loaded && !loadPlugin(info))
+			{
+				break;
+			}
 			return info;
+		}
 	}
 	return PluginInfo();
 }
@@ -140,6 +161,8 @@ void PluginFactory::discoverPlugins()
 	DescriptorMap descriptors;
 	PluginInfoList pluginInfos;
 	m_pluginByExt.clear();
+	m_lazyPluginByExt.clear();
+	m_dependencies.clear();
 
 	QSet<QFileInfo> files;
 	for (const QString& searchPath : QDir::searchPaths("plugins"))
@@ -147,14 +170,73 @@ void PluginFactory::discoverPlugins()
 		files.unite(QDir(searchPath).entryInfoList(nameFilters).toSet());
 	}
 
+	// Libraries which didn't change since they were written to the manifest
+	// are taken from there without loading them
+	const QHash<QString, ManifestEntry> manifest = readManifest();
+	QList<QFileInfo> changed;
+	QList<const ManifestEntry*> entries;
+	bool manifestChanged = manifest.size() != files.size();
+	for (const QFileInfo& file : files)
+	{
+		auto it = manifest.find(file.absoluteFilePath());
+		if (it == manifest.end() || it->size != file.size() ||
+			it->modified != file.lastModified().toMSecsSinceEpoch())
+		{
+			changed << file;
+			manifestChanged = true;
+			continue;
+		}
+
+		m_manifest.emplace_back(new ManifestEntry(*it));
+		ManifestEntry* entry = m_manifest.back().get();
+		entries << entry;
+		if (!entry->isPlugin)
+		{
+			m_dependencies << entry->path;
+			continue;
+		}
+
+		Plugin::Descriptor& descriptor = entry->descriptor;
+		descriptor = Plugin::Descriptor();
+		descriptor.name = entry->name.c_str();
+		descriptor.displayName = entry->displayName.c_str();
+		descriptor.description = entry->description.c_str();
+		descriptor.author = entry->author.c_str();
+		descriptor.version = entry->version;
+		descriptor.type = static_cast<Plugin::PluginTypes>(entry->type);
+		descriptor.logo = nullptr;
+		descriptor.supportedFileTypes = entry->hasFileTypes
+			? entry->supportedFileTypes.c_str() : nullptr;
+		descriptor.subPluginFeatures = nullptr;
+
+		PluginInfo info;
+		info.file = file;
+		info.library = std::make_shared<QLibrary>(file.absoluteFilePath());
+		info.descriptor = &descriptor;
+		info.loaded = false;
+		pluginInfos << info;
+		descriptors.insert(descriptor.type, &descriptor);
+
+		QStringList fileTypes = entry->subPluginFileTypes;
+		if (entry->hasFileTypes)
+		{
+			fileTypes += QString::fromStdString(entry->supportedFileTypes).split(',');
+		}
+		for (const QString& ext : fileTypes)
+		{
+			m_lazyPluginByExt.insert(ext, QString::fromStdString(entry->name));
+		}
+	}
+
 	// Cheap dependency handling: zynaddsubfx needs ZynAddSubFxCore. By loading
 	// all libraries twice we ensure that libZynAddSubFxCore is found.
-	for (const QFileInfo& file : files)
+	for (const QFileInfo& file : changed)
 	{
 		QLibrary(file.absoluteFilePath()).load();
 	}
 
-	for (const QFileInfo& file : files)
+	QList<ManifestEntry> loaded;
+	for (const QFileInfo& file : changed)
 	{
 		auto library = std::make_shared<QLibrary>(file.absoluteFilePath());
 		if (! library->load()) {
@@ -163,20 +245,17 @@ void PluginFactory::discoverPlugins()
 			continue;
 		}
 
+		ManifestEntry entry;
+		entry.path = file.absoluteFilePath();
+		entry.size = file.size();
+		entry.modified = file.lastModified().toMSecsSinceEpoch();
+
 		Plugin::Descriptor* pluginDescriptor = nullptr;
 		if (library->resolve("lmms_plugin_main"))
 		{
-			QString descriptorName = file.baseName() + "_plugin_descriptor";
-			if( descriptorName.left(3) == "lib" )
-			{
-				descriptorName = descriptorName.mid(3);
-			}
-
-			pluginDescriptor = reinterpret_cast<Plugin::Descriptor*>(library->resolve(descriptorName.toUtf8().constData()));
+			pluginDescriptor = resolveDescriptor(*library, file);
 			if(pluginDescriptor == nullptr)
 			{
-				qWarning() << qApp->translate("PluginFactory", "LMMS plugin %1 does not have a plugin descriptor named %2!").
-							  arg(file.absoluteFilePath()).arg(descriptorName);
 				continue;
 			}
 		}
@@ -189,50 +268,255 @@ void PluginFactory::discoverPlugins()
 			info.descriptor = pluginDescriptor;
 			pluginInfos << info;
 
-			auto addSupportedFileTypes =
-				[this](QString supportedFileTypes,
-					const PluginInfo& info,
-					const Plugin::Descriptor::SubPluginFeatures::Key* key = nullptr)
-			{
-				if(!supportedFileTypes.isNull())
-				{
-					for (const QString& ext : supportedFileTypes.split(','))
-					{
-						//qDebug() << "Plugin " << info.name()
-						//	<< "supports" << ext;
-						PluginInfoAndKey infoAndKey;
-						infoAndKey.info = info;
-						infoAndKey.key = key
-							? *key
-							: Plugin::Descriptor::SubPluginFeatures::Key();
-						m_pluginByExt.insert(ext, infoAndKey);
-					}
-				}
-			};
-
-			if (info.descriptor->supportedFileTypes)
-				addSupportedFileTypes(QString(info.descriptor->supportedFileTypes), info);
-
-			if (info.descriptor->subPluginFeatures)
+			entry.isPlugin = true;
+			entry.name = pluginDescriptor->name;
+			entry.displayName = pluginDescriptor->displayName;
+			entry.description = pluginDescriptor->description;
+			entry.author = pluginDescriptor->author;
+			entry.hasFileTypes = pluginDescriptor->supportedFileTypes != nullptr;
+			if (entry.hasFileTypes)
 			{
-				Plugin::Descriptor::SubPluginFeatures::KeyList
-					subPluginKeys;
-				info.descriptor->subPluginFeatures->listSubPluginKeys(
-					info.descriptor,
-					subPluginKeys);
-				for(const Plugin::Descriptor::SubPluginFeatures::Key& key
-					: subPluginKeys)
-				{
-					addSupportedFileTypes(key.additionalFileExtensions(), info, &key);
-				}
+				entry.supportedFileTypes = pluginDescriptor->supportedFileTypes;
 			}
+			entry.version = pluginDescriptor->version;
+			entry.type = pluginDescriptor->type;
+			entry.subPluginFileTypes = addSupportedFileTypes(info);
 
 			descriptors.insert(info.descriptor->type, info.descriptor);
 		}
+		loaded << entry;
 	}
 
 	m_pluginInfos = pluginInfos;
 	m_descriptors = descriptors;
+
+	if (manifestChanged)
+	{
+		for (const ManifestEntry& entry : loaded)
+		{
+			entries << &entry;
+		}
+		writeManifest(entries);
+	}
+}
+
+
+
+QString PluginFactory::manifestFile()
+{
+	return QFileInfo(ConfigManager::inst()->configFile()).absolutePath() +
+		"/.lmms-plugins.manifest";
+}
+
+QHash<QString, PluginFactory::ManifestEntry> PluginFactory::readManifest() const
+{
+	QHash<QString, ManifestEntry> entries;
+
+	QFile file(manifestFile());
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return entries;
+	}
+
+	QDataStream in(&file);
+	in.setVersion(QDataStream::Qt_5_0);
+	QString header;
+	in >> header;
+	// another version may have written other descriptors
+	if (header != ManifestHeader)
+	{
+		return entries;
+	}
+
+	while (!in.atEnd())
+	{
+		ManifestEntry entry;
+		QString name, displayName, description, author, fileTypes;
+		qint32 version, type;
+		in >> entry.path >> entry.size >> entry.modified >> entry.isPlugin
+			>> name >> displayName >> description >> author
+			>> entry.hasFileTypes >> fileTypes >> version >> type
+			>> entry.subPluginFileTypes;
+		if (in.status() != QDataStream::Ok)
+		{
+			// what's been read can still be trusted, the rest is
+			// loaded again
+			break;
+		}
+		entry.name = name.toStdString();
+		entry.displayName = displayName.toStdString();
+		entry.description = description.toStdString();
+		entry.author = author.toStdString();
+		entry.supportedFileTypes = fileTypes.toStdString();
+		entry.version = version;
+		entry.type = type;
+		entries.insert(entry.path, entry);
+	}
+	return entries;
+}
+
+void PluginFactory::writeManifest(const QList<const ManifestEntry*>& entries) const
+{
+	QSaveFile file(manifestFile());
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		return;
+	}
+
+	QDataStream out(&file);
+	out.setVersion(QDataStream::Qt_5_0);
+	out << QString(ManifestHeader);
+	for (const ManifestEntry* entry : entries)
+	{
+		out << entry->path << entry->size << entry->modified << entry->isPlugin
+			<< QString::fromStdString(entry->name)
+			<< QString::fromStdString(entry->displayName)
+			<< QString::fromStdString(entry->description)
+			<< QString::fromStdString(entry->author)
+			<< entry->hasFileTypes
+			<< QString::fromStdString(entry->supportedFileTypes)
+			<< qint32(entry->version) << qint32(entry->type)
+			<< entry->subPluginFileTypes;
+	}
+	if (!file.commit())
+	{
+		qWarning("Could not write the plugin manifest %s",
+			file.fileName().toLocal8Bit().data());
+	}
+}
+
+bool PluginFactory::loadLibrary(QLibrary& library)
+{
+	if (library.load())
+	{
+		return true;
+	}
+
+	// it may depend on one of the libraries which aren't plugins, which
+	// discoverPlugins() would have loaded before
+	for (const QString& dependency : m_dependencies)
+	{
+		QLibrary(dependency).load();
+	}
+	m_dependencies.clear();
+	return library.load();
+}
+
+Plugin::Descriptor* PluginFactory::resolveDescriptor(QLibrary& library, const QFileInfo& file)
+{
+	QString descriptorName = file.baseName() + "_plugin_descriptor";
+	if( descriptorName.left(3) == "lib" )
+	{
+		descriptorName = descriptorName.mid(3);
+	}
+
+	Plugin::Descriptor* pluginDescriptor = reinterpret_cast<Plugin::Descriptor*>(library.resolve(descriptorName.toUtf8().constData()));
+	if(pluginDescriptor == nullptr)
+	{
+		qWarning() << qApp->translate("PluginFactory", "LMMS plugin %1 does not have a plugin descriptor named %2!").
+					  arg(file.absoluteFilePath()).arg(descriptorName);
+	}
+	return pluginDescriptor;
+}
+
+bool PluginFactory::loadPlugin(PluginInfo& info)
+{
+	Plugin::Descriptor* cached = info.descriptor;
+	Plugin::Descriptor* pluginDescriptor = nullptr;
+	if (!loadLibrary(*info.library))
+	{
+		m_errors[info.file.baseName()] = info.library->errorString();
+		qWarning("%s", info.library->errorString().toLocal8Bit().data());
+	}
+	else
+	{
+		pluginDescriptor = resolveDescriptor(*info.library, info.file);
+	}
+
+	m_descriptors.remove(cached->type, cached);
+	if (!pluginDescriptor)
+	{
+		// it's gone, e.g. the library changed since discoverPlugins()
+		for (int i = 0; i < m_pluginInfos.size(); ++i)
+		{
+			if (m_pluginInfos[i].descriptor == cached)
+			{
+				m_pluginInfos.removeAt(i);
+				break;
+			}
+		}
+		return false;
+	}
+
+	info.descriptor = pluginDescriptor;
+	info.loaded = true;
+	m_descriptors.insert(pluginDescriptor->type, pluginDescriptor);
+	addSupportedFileTypes(info);
+	return true;
+}
+
+void PluginFactory::loadAll(Plugin::PluginTypes type)
+{
+	QList<QByteArray> names;
+	for (const PluginInfo& info : m_pluginInfos)
+	{
+		if (!info.loaded && (type == Plugin::Undefined || info.descriptor->type == type))
+		{
+			names << info.descriptor->name;
+		}
+	}
+	for (const QByteArray& name : names)
+	{
+		pluginInfo(name.constData());
+	}
+}
+
+QStringList PluginFactory::addSupportedFileTypes(const PluginInfo& info)
+{
+	QStringList subPluginFileTypes;
+
+	auto addFileTypes =
+		[this](QString supportedFileTypes,
+			const PluginInfo& info,
+			const Plugin::Descriptor::SubPluginFeatures::Key* key = nullptr)
+	{
+		if(!supportedFileTypes.isNull())
+		{
+			for (const QString& ext : supportedFileTypes.split(','))
+			{
+				//qDebug() << "Plugin " << info.name()
+				//	<< "supports" << ext;
+				PluginInfoAndKey infoAndKey;
+				infoAndKey.info = info;
+				infoAndKey.key = key
+					? *key
+					: Plugin::Descriptor::SubPluginFeatures::Key();
+				m_pluginByExt.insert(ext, infoAndKey);
+			}
+		}
+	};
+
+	if (info.descriptor->supportedFileTypes)
+		addFileTypes(QString(info.descriptor->supportedFileTypes), info);
+
+	if (info.descriptor->subPluginFeatures)
+	{
+		Plugin::Descriptor::SubPluginFeatures::KeyList
+			subPluginKeys;
+		info.descriptor->subPluginFeatures->listSubPluginKeys(
+			info.descriptor,
+			subPluginKeys);
+		for(const Plugin::Descriptor::SubPluginFeatures::Key& key
+			: subPluginKeys)
+		{
+			addFileTypes(key.additionalFileExtensions(), info, &key);
+			if (!key.additionalFileExtensions().isNull())
+			{
+				subPluginFileTypes += key.additionalFileExtensions().split(',');
+			}
+		}
+	}
+	return subPluginFileTypes;
 }
 
 
@@ -0,0 +1,209 @@
+/*
+ * PolyphaseResampler.cpp - windowed-sinc resampler for playing samples at
+ *                          any pitch
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "PolyphaseResampler.h"
+
+#include <cmath>
+#include <cstring>
+
+#include <QtCore/QtGlobal>
+
+#include "MixHelpers.h"
+#include "ScratchArena.h"
+
+
+// Kaiser window, about 70 dB stopband attenuation
+static const double KaiserBeta = 7.0;
+
+// the banks of all scales one after another, each with Phases + 1 rows of
+// Taps * scale coefficients stored twice for interleaved samples
+static const int BankSize = ( PolyphaseResampler::Phases + 1 ) *
+					PolyphaseResampler::Taps * 2;
+static float s_banks[BankSize * ( 1 + 2 + 3 + 4 )];
+
+static_assert( PolyphaseResampler::MaxScale == 4,
+				"s_banks is sized for four scales" );
+
+
+
+
+static inline float * bank( int _scale )
+{
+	return s_banks + BankSize * ( _scale - 1 ) * _scale / 2;
+}
+
+
+
+
+static double besselI0( double _x )
+{
+	double sum = 1.0;
+	double term = 1.0;
+	for( int k = 1; k < 32; ++k )
+	{
+		term *= ( _x / ( 2.0 * k ) ) * ( _x / ( 2.0 * k ) );
+		sum += term;
+	}
+	return sum;
+}
+
+
+
+
+// lowpass at _cutoff times the Nyquist frequency, _half frames wide on
+// each side
+static double kernel( double _x, double _cutoff, int _half )
+{
+	const double u = _x / _half;
+	if( u <= -1.0 || u >= 1.0 )
+	{
+		return 0.0;
+	}
+	const double y = M_PI * _cutoff * _x;
+	const double sinc = y == 0.0 ? 1.0 : sin( y ) / y;
+	return _cutoff * sinc *
+		besselI0( KaiserBeta * sqrt( 1.0 - u * u ) ) /
+							besselI0( KaiserBeta );
+}
+
+
+
+
+// computed when loading, not when the first note plays
+static struct BankGenerator
+{
+	BankGenerator()
+	{
+		const int phases = PolyphaseResampler::Phases;
+		for( int scale = 1; scale <= PolyphaseResampler::MaxScale; ++scale )
+		{
+			const int taps = PolyphaseResampler::Taps * scale;
+			const int half = taps / 2;
+			float * rows = bank( scale );
+			for( int p = 0; p <= phases; ++p )
+			{
+				double coeffs[PolyphaseResampler::Taps *
+					PolyphaseResampler::MaxScale];
+				double sum = 0.0;
+				for( int j = 0; j < taps; ++j )
+				{
+					const double x = j - ( half - 1 ) -
+						static_cast<double>( p ) / phases;
+					// at full bandwidth the first row passes the
+					// input through exactly, like the fast path
+					// of process()
+					if( scale == 1 && ( p == 0 || p == phases ) )
+					{
+						coeffs[j] = x == 0.0 ? 1.0 : 0.0;
+					}
+					else
+					{
+						coeffs[j] = kernel( x, 1.0 / scale, half );
+					}
+					sum += coeffs[j];
+				}
+				// normalized to unity gain at DC
+				for( int j = 0; j < taps; ++j )
+				{
+					rows[( p * taps + j ) * 2] =
+					rows[( p * taps + j ) * 2 + 1] =
+						static_cast<float>( coeffs[j] / sum );
+				}
+			}
+		}
+	}
+} s_bankGenerator;
+
+
+
+
+PolyphaseResampler::PolyphaseResampler()
+{
+	reset();
+}
+
+
+
+
+void PolyphaseResampler::reset()
+{
+	memset( m_history, 0, sizeof( m_history ) );
+	m_position = 0.0;
+}
+
+
+
+
+f_cnt_t PolyphaseResampler::process( const sampleFrame * _in,
+					f_cnt_t _inFrames, sampleFrame * _out,
+					fpp_t _outFrames, double _ratio )
+{
+	const double step = 1.0 / _ratio;
+	const int scale = qBound( 1, static_cast<int>( ceil( step ) ),
+								MaxScale );
+	const int taps = Taps * scale;
+	const int half = taps / 2;
+
+	ScratchBuffer<sampleFrame> work( HistoryFrames + _inFrames );
+	memcpy( work.data(), m_history, sizeof( m_history ) );
+	memcpy( work.data() + HistoryFrames, _in,
+					_inFrames * sizeof( sampleFrame ) );
+
+	// output frame f at position p is made of the input frames from
+	// floor( p ) - half + 1 to floor( p ) + half
+	const double limit = _inFrames - half;
+	fpp_t frames = 0;
+	if( m_position < limit )
+	{
+		frames = static_cast<fpp_t>( qMin<double>( _outFrames,
+				ceil( ( limit - m_position ) / step ) ) );
+		while( frames > 0 && m_position + ( frames - 1 ) * step >= limit )
+		{
+			--frames;
+		}
+	}
+
+	if( step == 1.0 && m_position == 0.0 )
+	{
+		memcpy( _out, _in, frames * sizeof( sampleFrame ) );
+	}
+	else
+	{
+		MixHelpers::polyphase( _out, work.data() + HistoryFrames - half + 1,
+						bank( scale ), taps, Phases,
+						m_position, step, frames );
+	}
+	if( frames < _outFrames )
+	{
+		memset( _out + frames, 0,
+				( _outFrames - frames ) * sizeof( sampleFrame ) );
+	}
+
+	const double end = m_position + frames * step;
+	const f_cnt_t used = qMin<f_cnt_t>( static_cast<f_cnt_t>( end ),
+								_inFrames );
+	m_position = end - used;
+	memcpy( m_history, work.data() + used, sizeof( m_history ) );
+
+	return used;
+}
@@ -22,6 +22,7 @@
  *
  */
 
+#include <QDateTime>
 #include <QFileInfo>
 
 #include "PresetPreviewPlayHandle.h"
@@ -39,15 +40,18 @@
 class PreviewTrackContainer : public TrackContainer
 {
 public:
+	//! Preview tracks kept with the presets last previewed or preloaded,
+	//! so auditioning them again doesn't load them again
+	static const int CachedPresets = 4;
+
 	PreviewTrackContainer() :
 		m_previewInstrumentTrack( NULL ),
 		m_previewNote( NULL ),
 		m_dataMutex()
 	{
 		setJournalling( false );
-		m_previewInstrumentTrack = dynamic_cast<InstrumentTrack *>( Track::create( Track::InstrumentTrack, this ) );
-		m_previewInstrumentTrack->setJournalling( false );
-		m_previewInstrumentTrack->setPreviewMode( true );
+		m_previewInstrumentTrack = createPreviewTrack();
+		m_presets.push_back( Preset{ m_previewInstrumentTrack, QString() } );
 	}
 
 	virtual ~PreviewTrackContainer()
@@ -64,6 +68,68 @@ public:
 		return m_previewInstrumentTrack;
 	}
 
+	void setPreviewInstrumentTrack( InstrumentTrack * _track )
+	{
+		m_previewInstrumentTrack = _track;
+	}
+
+	bool isPreviewTrack( const Track * _track ) const
+	{
+		for( const Preset & preset : m_presets )
+		{
+			if( preset.track == _track )
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//! The preview track which has _preset loaded, or else one to load it
+	//! into, which once there are CachedPresets is the least recently
+	//! used one other than _keep
+	InstrumentTrack * trackFor( const QString & _preset, bool & _loaded,
+					const InstrumentTrack * _keep )
+	{
+		for( int i = 0; i < m_presets.size(); ++i )
+		{
+			if( !_preset.isEmpty() && m_presets[i].preset == _preset )
+			{
+				m_presets.move( i, 0 );
+				_loaded = true;
+				return m_presets.front().track;
+			}
+		}
+
+		_loaded = false;
+		if( m_presets.size() < CachedPresets )
+		{
+			m_presets.push_front( Preset{ createPreviewTrack(), QString() } );
+			return m_presets.front().track;
+		}
+		for( int i = m_presets.size() - 1; i >= 0; --i )
+		{
+			if( m_presets[i].track != _keep )
+			{
+				m_presets[i].preset = QString();
+				m_presets.move( i, 0 );
+				break;
+			}
+		}
+		return m_presets.front().track;
+	}
+
+	void setPreset( InstrumentTrack * _track, const QString & _preset )
+	{
+		for( Preset & preset : m_presets )
+		{
+			if( preset.track == _track )
+			{
+				preset.preset = _preset;
+			}
+		}
+	}
+
 	NotePlayHandle* previewNote()
 	{
 		return m_previewNote.load(std::memory_order_acquire);
@@ -84,6 +150,11 @@ public:
 		m_dataMutex.lock();
 	}
 
+	bool tryLockData()
+	{
+		return m_dataMutex.tryLock();
+	}
+
 	void unlockData()
 	{
 		m_dataMutex.unlock();
@@ -101,7 +172,25 @@ public:
 
 
 private:
+	InstrumentTrack * createPreviewTrack()
+	{
+		InstrumentTrack * track = dynamic_cast<InstrumentTrack *>(
+				Track::create( Track::InstrumentTrack, this ) );
+		track->setJournalling( false );
+		track->setPreviewMode( true );
+		return track;
+	}
+
+	struct Preset
+	{
+		InstrumentTrack * track;
+		//! See presetKey(), empty if not loaded from a file
+		QString preset;
+	} ;
+
 	InstrumentTrack* m_previewInstrumentTrack;
+	//! The most recently used first
+	QList<Preset> m_presets;
 	std::atomic<NotePlayHandle*> m_previewNote;
 	QMutex m_dataMutex;
 
@@ -114,33 +203,33 @@ PreviewTrackContainer * PresetPreviewPlayHandle::s_previewTC;
 
 
 
-PresetPreviewPlayHandle::PresetPreviewPlayHandle( const QString & _preset_file, bool _load_by_plugin, DataFile *dataFile ) :
-	PlayHandle( TypePresetPreviewHandle ),
-	m_previewNote(nullptr)
+
+// the file and its version, so a preset changed since it was cached is loaded
+// again
+static QString presetKey( const QString & _preset_file )
 {
-	setUsesBuffer( false );
+	const QFileInfo info( _preset_file );
+	return info.absoluteFilePath() + '@' +
+		QString::number( info.lastModified().toMSecsSinceEpoch() );
+}
 
-	s_previewTC->lockData();
 
-	Engine::mixer()->requestChangeInModel();
-	s_previewTC->setPreviewNote( nullptr );
-	s_previewTC->previewInstrumentTrack()->silenceAllNotes();
-	Engine::mixer()->doneChangeInModel();
 
-	const bool j = Engine::projectJournal()->isJournalling();
-	Engine::projectJournal()->setJournalling( false );
 
+static void loadPreset( InstrumentTrack * _track, const QString & _preset_file,
+				bool _load_by_plugin, DataFile * dataFile )
+{
 	if( _load_by_plugin )
 	{
-		Instrument * i = s_previewTC->previewInstrumentTrack()->instrument();
+		Instrument * i = _track->instrument();
 		const QString ext = QFileInfo( _preset_file ).
 							suffix().toLower();
 		if( i == NULL || !i->descriptor()->supportsFileType( ext ) )
 		{
 			const PluginFactory::PluginInfoAndKey& infoAndKey =
 				pluginFactory->pluginSupportingExtension(ext);
-			i = s_previewTC->previewInstrumentTrack()->
-				loadInstrument(infoAndKey.info.name(), &infoAndKey.key);
+			i = _track->loadInstrument(infoAndKey.info.name(),
+							&infoAndKey.key);
 		}
 		if( i != NULL )
 		{
@@ -156,7 +245,7 @@ PresetPreviewPlayHandle::PresetPreviewPlayHandle( const QString & _preset_file,
 			dataFileCreated = true;
 		}
 
-		s_previewTC->previewInstrumentTrack()->loadTrackSpecificSettings(
+		_track->loadTrackSpecificSettings(
 					dataFile->content().firstChild().toElement());
 
 		if( dataFileCreated )
@@ -164,20 +253,48 @@ PresetPreviewPlayHandle::PresetPreviewPlayHandle( const QString & _preset_file,
 			delete dataFile;
 		}
 	}
-	dataFile = 0;
 	// make sure, our preset-preview-track does not appear in any MIDI-
 	// devices list, so just disable receiving/sending MIDI-events at all
-	s_previewTC->previewInstrumentTrack()->
-				midiPort()->setMode( MidiPort::Disabled );
+	_track->midiPort()->setMode( MidiPort::Disabled );
+}
+
+
+
+
+PresetPreviewPlayHandle::PresetPreviewPlayHandle( const QString & _preset_file, bool _load_by_plugin, DataFile *dataFile ) :
+	PlayHandle( TypePresetPreviewHandle ),
+	m_previewNote(nullptr)
+{
+	setUsesBuffer( false );
+
+	s_previewTC->lockData();
+
+	Engine::mixer()->requestChangeInModel();
+	s_previewTC->setPreviewNote( nullptr );
+	s_previewTC->previewInstrumentTrack()->silenceAllNotes();
+	Engine::mixer()->doneChangeInModel();
+
+	const bool j = Engine::projectJournal()->isJournalling();
+	Engine::projectJournal()->setJournalling( false );
+
+	const QString key = presetKey( _preset_file );
+	bool loaded;
+	InstrumentTrack * track = s_previewTC->trackFor( key, loaded, NULL );
+	if( !loaded )
+	{
+		loadPreset( track, _preset_file, _load_by_plugin, dataFile );
+		s_previewTC->setPreset( track, key );
+	}
+	s_previewTC->setPreviewInstrumentTrack( track );
 
 	Engine::mixer()->requestChangeInModel();
 	// create note-play-handle for it
 	m_previewNote = NotePlayHandleManager::acquire(
-			s_previewTC->previewInstrumentTrack(), 0,
+			track, 0,
 			typeInfo<f_cnt_t>::max() / 2,
 				Note( 0, 0, DefaultKey, 100 ) );
 
-	setAudioPort( s_previewTC->previewInstrumentTrack()->audioPort() );
+	setAudioPort( track->audioPort() );
 
 	s_previewTC->setPreviewNote( m_previewNote );
 
@@ -197,7 +314,7 @@ PresetPreviewPlayHandle::~PresetPreviewPlayHandle()
 	// not muted by other preset-preview-handle?
 	if (s_previewTC->testAndSetPreviewNote(m_previewNote, nullptr))
 	{
-		m_previewNote->noteOff();
+		m_previewNote->requestNoteOff();
 	}
 	Engine::mixer()->doneChangeInModel();
 }
@@ -224,7 +341,7 @@ bool PresetPreviewPlayHandle::isFinished() const
 
 bool PresetPreviewPlayHandle::isFromTrack( const Track * _track ) const
 {
-	return s_previewTC && s_previewTC->previewInstrumentTrack() == _track;
+	return s_previewTC && s_previewTC->isPreviewTrack( _track );
 }
 
 
@@ -241,6 +358,41 @@ void PresetPreviewPlayHandle::init()
 
 
 
+void PresetPreviewPlayHandle::preload( const QString & _preset_file,
+					bool _load_by_plugin, DataFile * _dataFile )
+{
+	// not in the way of loading a preset for a preview
+	if( !s_previewTC || !s_previewTC->tryLockData() )
+	{
+		return;
+	}
+
+	const QString key = presetKey( _preset_file );
+	bool loaded;
+	InstrumentTrack * track = s_previewTC->trackFor( key, loaded,
+				s_previewTC->previewInstrumentTrack() );
+	if( !loaded )
+	{
+		const bool j = Engine::projectJournal()->isJournalling();
+		Engine::projectJournal()->setJournalling( false );
+
+		// it may still be releasing an earlier preview
+		Engine::mixer()->requestChangeInModel();
+		track->silenceAllNotes();
+		Engine::mixer()->doneChangeInModel();
+
+		loadPreset( track, _preset_file, _load_by_plugin, _dataFile );
+		s_previewTC->setPreset( track, key );
+
+		Engine::projectJournal()->setJournalling( j );
+	}
+
+	s_previewTC->unlockData();
+}
+
+
+
+
 void PresetPreviewPlayHandle::cleanup()
 {
 	delete s_previewTC;
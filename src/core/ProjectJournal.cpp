@@ -25,6 +25,7 @@
 #include <cstdlib>
 
 #include "ProjectJournal.h"
+#include "ConfigManager.h"
 #include "Engine.h"
 #include "JournallingObject.h"
 #include "Song.h"
@@ -33,12 +34,13 @@
 //! and newly created IDs (have the bit set)
 static const int EO_ID_MSB = 1 << 23;
 
-const int ProjectJournal::MAX_UNDO_STATES = 100; // TODO: make this configurable in settings
+const int ProjectJournal::DEFAULT_UNDO_MEMORY = 64;
 
 ProjectJournal::ProjectJournal() :
 	m_joIDs(),
 	m_undoCheckPoints(),
 	m_redoCheckPoints(),
+	m_checkPointBytes( 0 ),
 	m_journalling( false )
 {
 }
@@ -55,21 +57,22 @@ ProjectJournal::~ProjectJournal()
 
 void ProjectJournal::undo()
 {
-	while( !m_undoCheckPoints.isEmpty() )
+	while( !m_undoCheckPoints.empty() )
 	{
-		CheckPoint c = m_undoCheckPoints.pop();
+		CheckPoint c = pop( m_undoCheckPoints );
 		JournallingObject *jo = m_joIDs[c.joID];
 
 		if( jo )
 		{
-			DataFile curState( DataFile::JournalData );
-			jo->saveState( curState, curState.content() );
-			m_redoCheckPoints.push( CheckPoint( c.joID, curState ) );
+			push( m_redoCheckPoints, checkPoint( jo ) );
 
+			// uncompressed by DataFile
+			DataFile data( c.data );
 			bool prev = isJournalling();
 			setJournalling( false );
-			jo->restoreState( c.data.content().firstChildElement() );
+			jo->restoreState( data.content().firstChildElement() );
 			setJournalling( prev );
+			objectChanged( c.joID );
 			Engine::getSong()->setModified();
 			break;
 		}
@@ -80,21 +83,21 @@ void ProjectJournal::undo()
 
 void ProjectJournal::redo()
 {
-	while( !m_redoCheckPoints.isEmpty() )
+	while( !m_redoCheckPoints.empty() )
 	{
-		CheckPoint c = m_redoCheckPoints.pop();
+		CheckPoint c = pop( m_redoCheckPoints );
 		JournallingObject *jo = m_joIDs[c.joID];
 
 		if( jo )
 		{
-			DataFile curState( DataFile::JournalData );
-			jo->saveState( curState, curState.content() );
-			m_undoCheckPoints.push( CheckPoint( c.joID, curState ) );
+			push( m_undoCheckPoints, checkPoint( jo ) );
 
+			DataFile data( c.data );
 			bool prev = isJournalling();
 			setJournalling( false );
-			jo->restoreState( c.data.content().firstChildElement() );
+			jo->restoreState( data.content().firstChildElement() );
 			setJournalling( prev );
+			objectChanged( c.joID );
 			Engine::getSong()->setModified();
 			break;
 		}
@@ -103,12 +106,12 @@ void ProjectJournal::redo()
 
 bool ProjectJournal::canUndo() const
 {
-	return !m_undoCheckPoints.isEmpty();
+	return !m_undoCheckPoints.empty();
 }
 
 bool ProjectJournal::canRedo() const
 {
-	return !m_redoCheckPoints.isEmpty();
+	return !m_redoCheckPoints.empty();
 }
 
 
@@ -117,16 +120,69 @@ void ProjectJournal::addJournalCheckPoint( JournallingObject *jo )
 {
 	if( isJournalling() )
 	{
-		m_redoCheckPoints.clear();
-
-		DataFile dataFile( DataFile::JournalData );
-		jo->saveState( dataFile, dataFile.content() );
+		while( !m_redoCheckPoints.empty() )
+		{
+			pop( m_redoCheckPoints );
+		}
 
-		m_undoCheckPoints.push( CheckPoint( jo->id(), dataFile ) );
-		if( m_undoCheckPoints.size() > MAX_UNDO_STATES )
+		const CheckPoint c = checkPoint( jo );
+		// e.g. a click which didn't change anything
+		if( !m_undoCheckPoints.empty() &&
+				m_undoCheckPoints.back().joID == c.joID &&
+				m_undoCheckPoints.back().data == c.data )
 		{
-			m_undoCheckPoints.remove( 0, m_undoCheckPoints.size() - MAX_UNDO_STATES );
+			return;
 		}
+		push( m_undoCheckPoints, c );
+		trim();
+	}
+}
+
+
+
+
+ProjectJournal::CheckPoint ProjectJournal::checkPoint( JournallingObject * _jo )
+{
+	DataFile dataFile( DataFile::JournalData );
+	_jo->saveState( dataFile, dataFile.content() );
+	return CheckPoint( _jo->id(), dataFile );
+}
+
+
+
+
+void ProjectJournal::push( CheckPointStack & _stack,
+					const CheckPoint & _checkPoint )
+{
+	_stack.push_back( _checkPoint );
+	m_checkPointBytes += _checkPoint.data.size();
+}
+
+
+
+
+ProjectJournal::CheckPoint ProjectJournal::pop( CheckPointStack & _stack )
+{
+	const CheckPoint c = _stack.back();
+	_stack.pop_back();
+	m_checkPointBytes -= c.data.size();
+	return c;
+}
+
+
+
+
+void ProjectJournal::trim()
+{
+	const int megabytes = ConfigManager::inst()->value( "app",
+			"undomemory", QString::number( DEFAULT_UNDO_MEMORY ) ).toInt();
+	const size_t budget = size_t( qMax( megabytes, 1 ) ) * 1024 * 1024;
+
+	// the latest one is kept however large it is
+	while( m_checkPointBytes > budget && m_undoCheckPoints.size() > 1 )
+	{
+		m_checkPointBytes -= m_undoCheckPoints.front().data.size();
+		m_undoCheckPoints.pop_front();
 	}
 }
 
@@ -178,6 +234,7 @@ void ProjectJournal::clearJournal()
 {
 	m_undoCheckPoints.clear();
 	m_redoCheckPoints.clear();
+	m_checkPointBytes = 0;
 
 	for( JoIdMap::Iterator it = m_joIDs.begin(); it != m_joIDs.end(); )
 	{
@@ -25,18 +25,22 @@
 
 #include <QFile>
 
+#include <vector>
+
 #include "ProjectRenderer.h"
+#include "Mixer.h"
+#include "MixerWorkerThread.h"
 #include "Song.h"
 #include "PerfLog.h"
+#include "StemExporter.h"
+#include "TrackFreeze.h"
 
 #include "AudioFileWave.h"
 #include "AudioFileOgg.h"
 #include "AudioFileMP3.h"
 #include "AudioFileFlac.h"
+#include "AudioFileStream.h"
 
-#ifdef LMMS_HAVE_SCHED_H
-#include "sched.h"
-#endif
 
 const ProjectRenderer::FileEncodeDevice ProjectRenderer::fileEncodeDevices[] =
 {
@@ -67,6 +71,9 @@ const ProjectRenderer::FileEncodeDevice ProjectRenderer::fileEncodeDevices[] =
 					NULL
 #endif
 									},
+	{ ProjectRenderer::RawFile,
+		QT_TRANSLATE_NOOP( "ProjectRenderer", "Raw PCM (*.raw)" ),
+					".raw", &AudioFileStream::getRawInst },
 	// Insert your own file-encoder infos here.
 	// Maybe one day the user can add own encoders inside the program.
 
@@ -83,11 +90,21 @@ ProjectRenderer::ProjectRenderer( const Mixer::qualitySettings & qualitySettings
 					const QString & outputFilename ) :
 	QThread( Engine::mixer() ),
 	m_fileDev( NULL ),
+	m_stems( NULL ),
+	m_freeze( NULL ),
 	m_qualitySettings( qualitySettings ),
+	m_context( Engine::context() ),
 	m_progress( 0 ),
 	m_abort( false )
 {
 	AudioFileDeviceInstantiaton audioEncoderFactory = fileEncodeDevices[exportFileFormat].m_getDevInst;
+	// a WAV stream leaves the sizes in the header unknown instead of
+	// seeking back to them at the end
+	if( exportFileFormat == WaveFile &&
+			AudioFileStream::isStream( outputFilename ) )
+	{
+		audioEncoderFactory = &AudioFileStream::getInst;
+	}
 
 	if (audioEncoderFactory)
 	{
@@ -107,6 +124,22 @@ ProjectRenderer::ProjectRenderer( const Mixer::qualitySettings & qualitySettings
 
 
 
+ProjectRenderer::ProjectRenderer( const Mixer::qualitySettings & qualitySettings,
+					AudioFileDevice * fileDevice ) :
+	QThread( Engine::mixer() ),
+	m_fileDev( fileDevice ),
+	m_stems( NULL ),
+	m_freeze( NULL ),
+	m_qualitySettings( qualitySettings ),
+	m_context( Engine::context() ),
+	m_progress( 0 ),
+	m_abort( false )
+{
+}
+
+
+
+
 ProjectRenderer::~ProjectRenderer()
 {
 }
@@ -153,6 +186,10 @@ void ProjectRenderer::startProcessing()
 		// make slots connected to sampleRateChanged()-signals being called immediately.
 		Engine::mixer()->setAudioDevice( m_fileDev,
 						m_qualitySettings, false, false );
+		if( m_stems )
+		{
+			m_stems->applyQualitySettings();
+		}
 
 		start(
 #ifndef LMMS_BUILD_WIN32
@@ -167,16 +204,11 @@ void ProjectRenderer::startProcessing()
 void ProjectRenderer::run()
 {
 	MemoryManager::ThreadGuard mmThreadGuard; Q_UNUSED(mmThreadGuard);
-#if 0
-#if defined(LMMS_BUILD_LINUX) || defined(LMMS_BUILD_FREEBSD)
-#ifdef LMMS_HAVE_SCHED_H
-	cpu_set_t mask;
-	CPU_ZERO( &mask );
-	CPU_SET( 0, &mask );
-	sched_setaffinity( 0, sizeof( mask ), &mask );
-#endif
-#endif
-#endif
+	LmmsCore::ContextScope contextScope( m_context );
+
+	// this thread acts as mixer thread while exporting
+	Engine::mixer()->setupRenderThreads( true );
+	MixerWorkerThread::applyMixerThreadPolicy();
 
 	PerfLogTimer perfLog("Project Render");
 
@@ -184,16 +216,92 @@ void ProjectRenderer::run()
 	Engine::getSong()->updateLength();
 	// Skip first empty buffer.
 	Engine::mixer()->nextBuffer();
+	if( m_stems )
+	{
+		m_stems->skipPeriod();
+	}
+	if( m_freeze )
+	{
+		m_freeze->skipPeriod();
+	}
 
 	m_progress = 0;
 
-	// Now start processing
+	m_fileDev->setBlockSize( ExportBlockSize );
+
+	// frames of the tail beyond an export range still to be written, at
+	// the processing rate, -1 until the end of the range is reached
+	Song * song = Engine::getSong();
+	const fpp_t fpp = Engine::mixer()->framesPerPeriod();
+	const f_cnt_t tail = static_cast<f_cnt_t>(
+			static_cast<double>( song->exportRangeTail() ) *
+				Engine::mixer()->processingSampleRate() /
+						m_fileDev->sampleRate() );
+	f_cnt_t tailLeft = -1;
+	// frames kept of the range so far, at the rate of the file
+	f_cnt_t framesKept = 0;
+	m_barFrames.clear();
+
+	// the output of the mixer lags a period behind the song, see
+	// Mixer::renderNextBuffer(), so what the song reported about the
+	// period before is what applies to it
+	f_cnt_t first = 0, last = 0;
+	std::vector<f_cnt_t> bars;
+	bars.reserve( DEFAULT_BUFFER_SIZE );
+	if( song->hasExportRange() )
+	{
+		song->exportRangeFrames( first, last );
+		bars.assign( song->exportRangeBars().begin(),
+					song->exportRangeBars().end() );
+	}
+
+	// Now start processing, this thread renders each period itself
 	Engine::mixer()->startProcessing(false);
 
 	// Continually track and emit progress percentage to listeners.
-	while (!Engine::getSong()->isExportDone() && !m_abort)
+	while( !m_abort && ( song->hasExportRange() ? tailLeft != 0 :
+						!song->isExportDone() ) )
 	{
-		m_fileDev->processNextBuffer();
+		m_fileDev->processNextPeriod();
+		if( song->hasExportRange() )
+		{
+			if( tailLeft < 0 && last < fpp )
+			{
+				tailLeft = tail;
+			}
+			if( tailLeft > 0 )
+			{
+				const f_cnt_t more = qMin<f_cnt_t>( tailLeft,
+								fpp - last );
+				last += more;
+				tailLeft -= more;
+			}
+
+			// converted the way the device drops the frames
+			const f_cnt_t periodFrames = m_fileDev->lastPeriodFrames();
+			for( const f_cnt_t bar : bars )
+			{
+				m_barFrames.push_back( framesKept +
+						bar * periodFrames / fpp -
+						first * periodFrames / fpp );
+			}
+			m_fileDev->keepOfLastPeriod( first, last );
+			framesKept += m_fileDev->lastPeriodFrames();
+
+			song->exportRangeFrames( first, last );
+			bars.assign( song->exportRangeBars().begin(),
+					song->exportRangeBars().end() );
+		}
+		if( m_stems )
+		{
+			// the mixer renders without fifo, so the taps hold the
+			// period just rendered
+			m_stems->writePeriod();
+		}
+		if( m_freeze )
+		{
+			m_freeze->writePeriod();
+		}
 		const int nprog = Engine::getSong()->getExportProgress();
 		if (m_progress != nprog)
 		{
@@ -202,11 +310,15 @@ void ProjectRenderer::run()
 		}
 	}
 
+	m_fileDev->flushBlock();
+
 	// Notify mixer of the end of processing.
 	Engine::mixer()->stopProcessing();
 
 	Engine::getSong()->stopExport();
 
+	Engine::mixer()->setupRenderThreads( false );
+
 	perfLog.end();
 
 	// If the user aborted export-process, the file has to be deleted.
@@ -214,6 +326,13 @@ void ProjectRenderer::run()
 	if( m_abort )
 	{
 		QFile( f ).remove();
+		if( m_stems )
+		{
+			for( const QString & stem : m_stems->files() )
+			{
+				QFile( stem ).remove();
+			}
+		}
 	}
 }
 
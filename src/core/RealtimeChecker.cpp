@@ -0,0 +1,167 @@
+/*
+ * RealtimeChecker.cpp - reports operations which may block while rendering
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "RealtimeChecker.h"
+
+#ifdef LMMS_DEBUG_REALTIME
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <execinfo.h>
+#include <unistd.h>
+
+
+// The hooks in RealtimeCheckerHooks.cpp call check() before and during
+// initialization of anything else, so only plain thread locals which need
+// no initialization may be used in here.
+static thread_local int s_renderDepth = 0;
+static thread_local int s_allowed = 0;
+// set while reporting so the allocations of backtrace() aren't reported
+static thread_local bool s_reporting = false;
+
+// hashes of the stack traces reported so far
+static const int MaxReported = 1024;
+static std::atomic<size_t> s_reported[MaxReported];
+
+
+
+
+// returns false if the stack trace has been reported already
+static bool markReported( void * const * _frames, int _count )
+{
+	size_t hash = 14695981039346656037ULL;
+	for( int i = 0; i < _count; ++i )
+	{
+		hash = ( hash ^ (size_t) _frames[i] ) * 1099511628211ULL;
+	}
+	hash |= 1;
+
+	for( int i = 0; i < MaxReported; ++i )
+	{
+		std::atomic<size_t> & entry = s_reported[( hash + i ) % MaxReported];
+		size_t expected = 0;
+		if( entry.compare_exchange_strong( expected, hash ) )
+		{
+			return true;
+		}
+		if( expected == hash )
+		{
+			return false;
+		}
+	}
+	// table full, stay quiet from now on
+	return false;
+}
+
+
+
+
+// backtrace() loads libgcc the first time, better do that before rendering
+static struct BacktraceWarmup
+{
+	BacktraceWarmup()
+	{
+		void * frame;
+		backtrace( &frame, 1 );
+	}
+} s_backtraceWarmup;
+
+
+
+
+namespace RealtimeChecker
+{
+
+
+RenderScope::RenderScope() :
+	m_allowed( s_allowed )
+{
+	++s_renderDepth;
+	s_allowed = 0;
+}
+
+
+
+
+RenderScope::~RenderScope()
+{
+	s_allowed = m_allowed;
+	--s_renderDepth;
+}
+
+
+
+
+Allowed::Allowed()
+{
+	++s_allowed;
+}
+
+
+
+
+Allowed::~Allowed()
+{
+	--s_allowed;
+}
+
+
+
+
+void check( const char * _what )
+{
+	if( s_renderDepth == 0 || s_allowed > 0 || s_reporting )
+	{
+		return;
+	}
+	s_reporting = true;
+
+	void * frames[64];
+	const int count = backtrace( frames, 64 );
+	if( markReported( frames, count ) )
+	{
+		// backtrace_symbols_fd() doesn't allocate
+		fprintf( stderr, "Real-time violation: %s while rendering\n",
+									_what );
+		backtrace_symbols_fd( frames, count, STDERR_FILENO );
+		fprintf( stderr, "\n" );
+
+		static const bool abortOnViolation =
+				getenv( "LMMS_REALTIME_ABORT" ) != NULL &&
+				strcmp( getenv( "LMMS_REALTIME_ABORT" ), "0" ) != 0;
+		if( abortOnViolation )
+		{
+			abort();
+		}
+	}
+
+	s_reporting = false;
+}
+
+
+}
+
+
+#endif
@@ -0,0 +1,213 @@
+/*
+ * RealtimeCheckerHooks.cpp - replacements of C library functions which
+ *                            report calls while rendering
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "RealtimeChecker.h"
+
+#ifdef LMMS_DEBUG_REALTIME
+
+// The functions below replace the ones of the C library for the whole
+// process, including plugins and Qt, and forward to the originals. This
+// file deliberately doesn't include the C library headers declaring them,
+// their declarations differ in exception specifications and may be
+// redirected to other symbols (e.g. open() to open64()).
+#include <cstdarg>
+#include <cstddef>
+
+#include <linux/fcntl.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+
+extern "C"
+{
+
+void * dlsym( void * _handle, const char * _symbol );
+
+// glibc exports its allocator under these names as well, which saves
+// looking up the originals with dlsym() - it allocates itself
+void * __libc_malloc( size_t );
+void * __libc_calloc( size_t, size_t );
+void * __libc_realloc( void *, size_t );
+
+}
+
+#define LMMS_RTLD_NEXT ( (void *) -1l )
+
+
+template<typename F>
+static F original( F & _function, const char * _name )
+{
+	// plain statics without guards, a race only looks the symbol up twice
+	if( _function == NULL )
+	{
+		_function = reinterpret_cast<F>( dlsym( LMMS_RTLD_NEXT, _name ) );
+	}
+	return _function;
+}
+
+
+typedef int (*LockFunction)( void * );
+typedef long (*SyscallFunction)( long, ... );
+typedef int (*OpenFunction)( const char *, int, ... );
+typedef void * (*FopenFunction)( const char *, const char * );
+
+static LockFunction s_mutexLock = NULL;
+static SyscallFunction s_syscall = NULL;
+static OpenFunction s_open = NULL;
+static OpenFunction s_open64 = NULL;
+static FopenFunction s_fopen = NULL;
+static FopenFunction s_fopen64 = NULL;
+
+
+// look everything up early, dlsym() shouldn't be called while rendering
+static struct OriginalsLookup
+{
+	OriginalsLookup()
+	{
+		original( s_mutexLock, "pthread_mutex_lock" );
+		original( s_syscall, "syscall" );
+		original( s_open, "open" );
+		original( s_open64, "open64" );
+		original( s_fopen, "fopen" );
+		original( s_fopen64, "fopen64" );
+	}
+} s_originalsLookup;
+
+
+
+
+extern "C"
+{
+
+void * malloc( size_t _size )
+{
+	RealtimeChecker::check( "malloc()" );
+	return __libc_malloc( _size );
+}
+
+
+
+
+void * calloc( size_t _count, size_t _size )
+{
+	RealtimeChecker::check( "calloc()" );
+	return __libc_calloc( _count, _size );
+}
+
+
+
+
+void * realloc( void * _ptr, size_t _size )
+{
+	RealtimeChecker::check( "realloc()" );
+	return __libc_realloc( _ptr, _size );
+}
+
+
+
+
+int pthread_mutex_lock( void * _mutex )
+{
+	RealtimeChecker::check( "pthread_mutex_lock()" );
+	return original( s_mutexLock, "pthread_mutex_lock" )( _mutex );
+}
+
+
+
+
+// QMutex, QWaitCondition and QSemaphore go to the kernel through this once
+// they have to wait
+long syscall( long _number, ... )
+{
+	va_list args;
+	va_start( args, _number );
+	long a[6];
+	for( int i = 0; i < 6; ++i )
+	{
+		a[i] = va_arg( args, long );
+	}
+	va_end( args );
+
+	if( _number == SYS_futex )
+	{
+		const int op = a[1] & FUTEX_CMD_MASK;
+		if( op == FUTEX_WAIT || op == FUTEX_WAIT_BITSET )
+		{
+			RealtimeChecker::check( "waiting on a futex" );
+		}
+	}
+
+	return original( s_syscall, "syscall" )( _number,
+					a[0], a[1], a[2], a[3], a[4], a[5] );
+}
+
+
+
+
+int open( const char * _path, int _flags, ... )
+{
+	va_list args;
+	va_start( args, _flags );
+	const int mode = _flags & O_CREAT ? va_arg( args, int ) : 0;
+	va_end( args );
+
+	RealtimeChecker::check( "open()" );
+	return original( s_open, "open" )( _path, _flags, mode );
+}
+
+
+
+
+int open64( const char * _path, int _flags, ... )
+{
+	va_list args;
+	va_start( args, _flags );
+	const int mode = _flags & O_CREAT ? va_arg( args, int ) : 0;
+	va_end( args );
+
+	RealtimeChecker::check( "open64()" );
+	return original( s_open64, "open64" )( _path, _flags, mode );
+}
+
+
+
+
+void * fopen( const char * _path, const char * _mode )
+{
+	RealtimeChecker::check( "fopen()" );
+	return original( s_fopen, "fopen" )( _path, _mode );
+}
+
+
+
+
+void * fopen64( const char * _path, const char * _mode )
+{
+	RealtimeChecker::check( "fopen64()" );
+	return original( s_fopen64, "fopen64" )( _path, _mode );
+}
+
+}
+
+
+#endif
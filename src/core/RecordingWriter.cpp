@@ -0,0 +1,178 @@
+/*
+ * RecordingWriter.cpp - streams recorded audio to a file on disk
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "RecordingWriter.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+
+#include <sndfile.h>
+
+#include <cstring>
+
+#include "ConfigManager.h"
+
+
+RecordingWriter::RecordingWriter( const QString & fileName,
+						sample_rate_t sampleRate ) :
+	m_fileName( fileName ),
+	m_sampleRate( sampleRate ),
+	m_ring( RingSize ),
+	m_reader( m_ring ),
+	m_framesRecorded( 0 ),
+	m_framesDropped( 0 ),
+	m_finishing( false ),
+	m_failed( false )
+{
+	setObjectName( "RecordingWriter" );
+	start( QThread::LowPriority );
+}
+
+
+
+
+RecordingWriter::~RecordingWriter()
+{
+	finish();
+}
+
+
+
+
+QString RecordingWriter::newFileName( const QString & _prefix )
+{
+	const QString dir = ConfigManager::inst()->userSamplesDir() +
+								"recordings/";
+	const QString base = dir + _prefix + "-" +
+		QDateTime::currentDateTime().toString( "yyyyMMdd-hhmmss" );
+	QString name = base + ".wav";
+	for( int i = 2; QFileInfo::exists( name ); ++i )
+	{
+		name = base + "-" + QString::number( i ) + ".wav";
+	}
+	return name;
+}
+
+
+
+
+void RecordingWriter::write( const sampleFrame * _ab, f_cnt_t _frames )
+{
+	const f_cnt_t written = m_ring.write( _ab, _frames );
+	if( written < _frames )
+	{
+		m_framesDropped.fetch_add( _frames - written,
+						std::memory_order_relaxed );
+	}
+	m_framesRecorded += _frames;
+}
+
+
+
+
+bool RecordingWriter::finish()
+{
+	m_finishing = true;
+	wait();
+	const int dropped = m_framesDropped.exchange( 0 );
+	if( dropped > 0 )
+	{
+		qWarning( "RecordingWriter: the disk couldn't keep up, %d "
+				"frames of %s got lost", dropped,
+					qPrintable( m_fileName ) );
+	}
+	return !m_failed;
+}
+
+
+
+
+void RecordingWriter::run()
+{
+	QDir().mkpath( QFileInfo( m_fileName ).absolutePath() );
+
+	QFile file( m_fileName );
+	SNDFILE * sf = NULL;
+	if( file.open( QIODevice::WriteOnly ) )
+	{
+		SF_INFO info;
+		memset( &info, 0, sizeof( info ) );
+		info.samplerate = m_sampleRate;
+		info.channels = DEFAULT_CHANNELS;
+		info.format = SF_FORMAT_RF64 | SF_FORMAT_FLOAT;
+		// use the file handle for unicode file names on Windows
+		sf = sf_open_fd( file.handle(), SFM_WRITE, &info, false );
+	}
+	if( sf == NULL )
+	{
+		qWarning( "RecordingWriter: can't write %s",
+						qPrintable( m_fileName ) );
+		m_failed = true;
+	}
+	else
+	{
+		// a plain WAV file unless it gets too large for one
+		sf_command( sf, SFC_RF64_AUTO_DOWNGRADE, NULL, SF_TRUE );
+		sf_set_string( sf, SF_STR_SOFTWARE, "LMMS" );
+	}
+
+	const int ChunkSize = 4096;
+	float chunk[ChunkSize * DEFAULT_CHANNELS];
+	while( true )
+	{
+		// frames written before finish() was called are in the ring
+		// by now
+		const bool finishing = m_finishing;
+		auto frames = m_reader.read_max( qMin<std::size_t>(
+					m_reader.read_space(), ChunkSize ) );
+		const std::size_t count = frames.size();
+		if( count == 0 )
+		{
+			if( finishing )
+			{
+				break;
+			}
+			msleep( 20 );
+			continue;
+		}
+
+		for( std::size_t f = 0; f < count; ++f )
+		{
+			chunk[f * DEFAULT_CHANNELS] = frames[f][0];
+			chunk[f * DEFAULT_CHANNELS + 1] = frames[f][1];
+		}
+		if( sf != NULL && sf_writef_float( sf, chunk, count ) !=
+					static_cast<sf_count_t>( count ) )
+		{
+			qWarning( "RecordingWriter: writing %s failed: %s",
+					qPrintable( m_fileName ), sf_strerror( sf ) );
+			m_failed = true;
+		}
+	}
+
+	if( sf != NULL )
+	{
+		sf_close( sf );
+	}
+}
@@ -29,12 +29,17 @@
 #endif
 
 #include "BufferManager.h"
+#include "ConfigManager.h"
 #include "RemotePlugin.h"
 #include "Mixer.h"
 #include "Engine.h"
+#include "RealtimeChecker.h"
+#include "TraceRecorder.h"
 
 #include <QDebug>
 #include <QDir>
+#include <QSemaphore>
+#include <QTimer>
 
 #ifndef SYNC_WITH_SHM_FIFO
 #include <QtCore/QUuid>
@@ -43,32 +48,285 @@
 #endif
 
 
-// simple helper thread monitoring our RemotePlugin - if process terminates
-// unexpectedly invalidate plugin so LMMS doesn't lock up
-ProcessWatcher::ProcessWatcher( RemotePlugin * _p ) :
-	QThread(),
-	m_plugin( _p ),
-	m_quit( false )
+#ifndef SYNC_WITH_SHM_FIFO
+// listens on a new socket in the temporary directory, whose path is
+// stored in _socketFile
+static int startServer( QString & _socketFile )
+{
+	struct sockaddr_un sa;
+	sa.sun_family = AF_LOCAL;
+
+	_socketFile = QDir::tempPath() + QDir::separator() +
+						QUuid::createUuid().toString();
+	auto path = _socketFile.toUtf8();
+	size_t length = path.length();
+	if ( length >= sizeof sa.sun_path )
+	{
+		length = sizeof sa.sun_path - 1;
+		qWarning( "Socket path too long." );
+	}
+	memcpy(sa.sun_path, path.constData(), length );
+	sa.sun_path[length] = '\0';
+
+	int server = socket( PF_LOCAL, SOCK_STREAM, 0 );
+	if ( server == -1 )
+	{
+		qWarning( "Unable to start the server." );
+	}
+	remove(path.constData());
+	int ret = bind( server, (struct sockaddr *) &sa, sizeof sa );
+	if ( ret == -1 || listen( server, 1 ) == -1 )
+	{
+		qWarning( "Unable to start the server." );
+	}
+	return server;
+}
+#endif
+
+
+
+
+ProcessWatcher * ProcessWatcher::instance()
+{
+	static ProcessWatcher watcher;
+	return &watcher;
+}
+
+
+
+
+ProcessWatcher::ProcessWatcher() :
+	QThread()
+{
+	m_context.moveToThread( this );
+	start( QThread::LowestPriority );
+
+	// spare processes mustn't outlive LMMS
+	if( qApp != NULL )
+	{
+		connect( qApp, &QCoreApplication::aboutToQuit, &m_context,
+			[this]() { dropSpares(); },
+			Qt::BlockingQueuedConnection );
+	}
+}
+
+
+
+
+ProcessWatcher::~ProcessWatcher()
+{
+	quit();
+	wait();
+}
+
+
+
+
+void ProcessWatcher::launch( RemotePlugin * _p )
+{
+	// in case the process failed to start the last time
+	release( _p );
+
+	// we start the process on the watcher thread to work around QTBUG-8819
+	_p->m_process->moveToThread( this );
+	QTimer::singleShot( 0, &m_context, [_p]()
+	{
+		_p->m_process->start( _p->m_exec, _p->m_args );
+	} );
+}
+
+
+
+
+void ProcessWatcher::release( RemotePlugin * _p )
+{
+	// the check has to happen on the watcher thread, where the process
+	// may be moved back concurrently
+	QThread * target = _p->thread();
+	runOnWatcher( [this, _p, target]()
+	{
+		if( _p->m_process->thread() == this )
+		{
+			_p->m_process->moveToThread( target );
+		}
+	} );
+}
+
+
+
+
+void ProcessWatcher::prestart( const QString & _exec,
+					const QStringList & _extraArgs )
+{
+	runOnWatcher( [&]()
+	{
+		for( const Spare & s : m_spares )
+		{
+			if( s.exec == _exec && s.extraArgs == _extraArgs )
+			{
+				return;
+			}
+		}
+
+		Spare s;
+		s.exec = _exec;
+		s.extraArgs = _extraArgs;
+		QStringList args;
+#ifdef SYNC_WITH_SHM_FIFO
+		s.in = new shmFifo();
+		s.out = new shmFifo();
+		// swap in and out for bidirectional communication
+		args << QString::number( s.out->shmKey() );
+		args << QString::number( s.in->shmKey() );
+#else
+		s.server = startServer( s.socketFile );
+		args << s.socketFile;
+#endif
+		args << _extraArgs;
+
+		s.process = new QProcess;
+		s.process->setProcessChannelMode( QProcess::ForwardedChannels );
+		s.process->setWorkingDirectory(
+				QCoreApplication::applicationDirPath() );
+		s.process->start( _exec, args );
+		m_spares.push_back( s );
+	} );
+}
+
+
+
+
+bool ProcessWatcher::adopt( RemotePlugin * _p, const QString & _exec,
+					const QStringList & _extraArgs )
+{
+	release( _p );
+
+	QProcess * previous = NULL;
+	runOnWatcher( [&]()
+	{
+		for( int i = 0; i < m_spares.size(); ++i )
+		{
+			const Spare s = m_spares[i];
+			if( s.exec != _exec || s.extraArgs != _extraArgs )
+			{
+				continue;
+			}
+			m_spares.remove( i );
+			if( s.process->state() == QProcess::NotRunning )
+			{
+				dropSpare( s );
+				return;
+			}
+
+			// the process emits its signals on this thread, so it
+			// can't finish unnoticed while being handed over
+			previous = _p->m_process;
+			_p->m_process = s.process;
+			_p->connectProcess();
+#ifdef SYNC_WITH_SHM_FIFO
+			_p->reset( s.in, s.out );
+#else
+			close( _p->m_server );
+			remove( _p->m_socketFile.toUtf8().constData() );
+			_p->m_server = s.server;
+			_p->m_socketFile = s.socketFile;
+#endif
+			_p->m_exec = _exec;
+			return;
+		}
+	} );
+
+	// the process given up lives on the thread of _p
+	delete previous;
+	return previous != NULL;
+}
+
+
+
+
+void ProcessWatcher::runOnWatcher( const std::function<void()> & _f )
+{
+	if( QThread::currentThread() == this )
+	{
+		_f();
+		return;
+	}
+	QSemaphore done;
+	QTimer::singleShot( 0, &m_context, [&_f, &done]()
+	{
+		_f();
+		done.release();
+	} );
+	done.acquire();
+}
+
+
+
+
+void ProcessWatcher::processFinished( RemotePlugin * _p )
 {
+	// leave the process alone until it's done emitting finished()
+	QPointer<RemotePlugin> p = _p;
+	QTimer::singleShot( 0, &m_context, [this, p]()
+	{
+		if( p.isNull() || p->m_quitting )
+		{
+			return;
+		}
+		p->m_process->moveToThread( p->thread() );
+		invalidateWhenDone( p );
+	} );
 }
 
 
-void ProcessWatcher::run()
+
+
+void ProcessWatcher::invalidateWhenDone( QPointer<RemotePlugin> _p )
 {
-	m_plugin->m_process.start( m_plugin->m_exec, m_plugin->m_args );
-	exec();
-	m_plugin->m_process.moveToThread( m_plugin->thread() );
-	while( !m_quit && m_plugin->messagesLeft() )
+	if( _p.isNull() || _p->m_quitting )
 	{
-		msleep( 200 );
+		return;
 	}
-	if( !m_quit )
+	// let the messages the process sent before dying be handled first,
+	// without blocking the other plugins
+	if( _p->messagesLeft() )
 	{
-		fprintf( stderr,
-				"remote plugin died! invalidating now.\n" );
+		QTimer::singleShot( 200, &m_context, [this, _p]()
+		{
+			invalidateWhenDone( _p );
+		} );
+		return;
+	}
+	fprintf( stderr, "remote plugin died! invalidating now.\n" );
+	_p->invalidate();
+}
+
+
+
+
+void ProcessWatcher::dropSpare( const Spare & _s )
+{
+	// kills the process if it's still running
+	delete _s.process;
+#ifdef SYNC_WITH_SHM_FIFO
+	delete _s.in;
+	delete _s.out;
+#else
+	close( _s.server );
+	remove( _s.socketFile.toUtf8().constData() );
+#endif
+}
+
+
 
-		m_plugin->invalidate();
+
+void ProcessWatcher::dropSpares()
+{
+	for( const Spare & s : m_spares )
+	{
+		dropSpare( s );
 	}
+	m_spares.clear();
 }
 
 
@@ -83,7 +341,8 @@ RemotePlugin::RemotePlugin() :
 	RemotePluginBase(),
 #endif
 	m_failed( true ),
-	m_watcher( this ),
+	m_process( new QProcess ),
+	m_quitting( false ),
 	m_commMutex( QMutex::Recursive ),
 	m_splitChannels( false ),
 #ifdef USE_QT_SHMEM
@@ -94,45 +353,17 @@ RemotePlugin::RemotePlugin() :
 	m_shmSize( 0 ),
 	m_shm( NULL ),
 	m_inputCount( DEFAULT_CHANNELS ),
-	m_outputCount( DEFAULT_CHANNELS )
+	m_outputCount( DEFAULT_CHANNELS ),
+	m_asyncProcessing( ConfigManager::inst()->value(
+				"mixer", "asyncremoteplugins" ).toInt() ),
+	m_processingPending( 0 ),
+	m_parameterChanges( RemoteParameterBlock::MaxChanges )
 {
 #ifndef SYNC_WITH_SHM_FIFO
-	struct sockaddr_un sa;
-	sa.sun_family = AF_LOCAL;
-
-	m_socketFile = QDir::tempPath() + QDir::separator() +
-						QUuid::createUuid().toString();
-	auto path = m_socketFile.toUtf8();
-	size_t length = path.length();
-	if ( length >= sizeof sa.sun_path )
-	{
-		length = sizeof sa.sun_path - 1;
-		qWarning( "Socket path too long." );
-	}
-	memcpy(sa.sun_path, path.constData(), length );
-	sa.sun_path[length] = '\0';
-
-	m_server = socket( PF_LOCAL, SOCK_STREAM, 0 );
-	if ( m_server == -1 )
-	{
-		qWarning( "Unable to start the server." );
-	}
-	remove(path.constData());
-	int ret = bind( m_server, (struct sockaddr *) &sa, sizeof sa );
-	if ( ret == -1 || listen( m_server, 1 ) == -1 )
-	{
-		qWarning( "Unable to start the server." );
-	}
+	m_server = startServer( m_socketFile );
 #endif
 
-	connect( &m_process, SIGNAL( finished( int, QProcess::ExitStatus ) ),
-		this, SLOT( processFinished( int, QProcess::ExitStatus ) ),
-		Qt::DirectConnection );
-	connect( &m_process, SIGNAL( errorOccurred( QProcess::ProcessError ) ),
-			 this, SLOT( processErrored( QProcess::ProcessError ) ),
-		Qt::DirectConnection );
-	connect( &m_process, SIGNAL( finished( int, QProcess::ExitStatus ) ),
-		&m_watcher, SLOT( quit() ), Qt::DirectConnection );
+	connectProcess();
 }
 
 
@@ -140,8 +371,8 @@ RemotePlugin::RemotePlugin() :
 
 RemotePlugin::~RemotePlugin()
 {
-	m_watcher.stop();
-	m_watcher.wait();
+	m_quitting = true;
+	ProcessWatcher::instance()->release( this );
 
 	if( m_failed == false )
 	{
@@ -150,11 +381,11 @@ RemotePlugin::~RemotePlugin()
 			lock();
 			sendMessage( IdQuit );
 
-			m_process.waitForFinished( 1000 );
-			if( m_process.state() != QProcess::NotRunning )
+			m_process->waitForFinished( 1000 );
+			if( m_process->state() != QProcess::NotRunning )
 			{
-				m_process.terminate();
-				m_process.kill();
+				m_process->terminate();
+				m_process->kill();
 			}
 			unlock();
 		}
@@ -172,6 +403,25 @@ RemotePlugin::~RemotePlugin()
 	}
 	remove( m_socketFile.toUtf8().constData() );
 #endif
+
+	delete m_process;
+}
+
+
+
+
+void RemotePlugin::connectProcess()
+{
+	connect( m_process, SIGNAL( finished( int, QProcess::ExitStatus ) ),
+		this, SLOT( processFinished( int, QProcess::ExitStatus ) ),
+		Qt::DirectConnection );
+	connect( m_process, SIGNAL( errorOccurred( QProcess::ProcessError ) ),
+			 this, SLOT( processErrored( QProcess::ProcessError ) ),
+		Qt::DirectConnection );
+	connect( m_process, static_cast<void ( QProcess::* )( int,
+			QProcess::ExitStatus )>( &QProcess::finished ), this,
+		[this]() { ProcessWatcher::instance()->processFinished( this ); },
+		Qt::DirectConnection );
 }
 
 
@@ -214,10 +464,8 @@ bool RemotePlugin::init(const QString &pluginExecutable,
 		return failed();
 	}
 
-	// ensure the watcher is ready in case we're running again
-	// (e.g. 32-bit VST plugins on Windows)
-	m_watcher.wait();
-	m_watcher.reset();
+	// in case we're running again (e.g. 32-bit VST plugins on Windows)
+	m_quitting = false;
 
 	QStringList args;
 #ifdef SYNC_WITH_SHM_FIFO
@@ -229,13 +477,24 @@ bool RemotePlugin::init(const QString &pluginExecutable,
 #endif
 	args << extraArgs;
 #ifndef DEBUG_REMOTE_PLUGIN
-	m_process.setProcessChannelMode( QProcess::ForwardedChannels );
-	m_process.setWorkingDirectory( QCoreApplication::applicationDirPath() );
-	m_exec = exec;
-	m_args = args;
-	// we start the process on the watcher thread to work around QTBUG-8819
-	m_process.moveToThread( &m_watcher );
-	m_watcher.start( QThread::LowestPriority );
+	ProcessWatcher * watcher = ProcessWatcher::instance();
+	// taking over a process started in the background saves waiting for
+	// it to come up, e.g. for each VST when loading a project
+	if( !watcher->adopt( this, exec, extraArgs ) )
+	{
+		m_process->setProcessChannelMode( QProcess::ForwardedChannels );
+		m_process->setWorkingDirectory(
+				QCoreApplication::applicationDirPath() );
+		m_exec = exec;
+		m_args = args;
+		watcher->launch( this );
+	}
+	// and have one ready for the next plugin of this kind
+	if( ConfigManager::inst()->value( "mixer", "prestartremoteplugins",
+							"1" ).toInt() )
+	{
+		watcher->prestart( exec, extraArgs );
+	}
 #else
 	qDebug() << exec << args;
 #endif
@@ -311,10 +570,118 @@ bool RemotePlugin::process( const sampleFrame * _in_buf,
 		return false;
 	}
 
-	memset( m_shm, 0, m_shmSize );
+	if( m_asyncProcessing )
+	{
+		// the round trip to the plugin process, overlapping with ours
+		TraceRecorder::Zone zone( "RemotePlugin::process" );
+		RealtimeChecker::Allowed waitingForPlugin;
+		lock();
+		// collect the period started last time, it has usually been
+		// done while the rest of the graph was processed
+		const bool haveResult = m_processingPending > 0;
+		waitForPendingProcessing();
+		if( _out_buf != NULL )
+		{
+			if( haveResult && !m_failed && m_outputCount > 0 )
+			{
+				readOutputs( _out_buf );
+			}
+			else
+			{
+				BufferManager::clear( _out_buf, frames );
+			}
+		}
+
+		// and start this one, its result is taken next period
+		writeInputs( _in_buf );
+		writeParameterChanges();
+		sendMessage( IdStartProcessing );
+		++m_processingPending;
+		unlock();
+		return haveResult && _out_buf != NULL;
+	}
+
+	{
+		// the round trip to the plugin process
+		TraceRecorder::Zone zone( "RemotePlugin::process" );
+		// waiting for the plugin process can't be avoided
+		RealtimeChecker::Allowed waitingForPlugin;
+		lock();
+		// a period may still be running if async processing was
+		// just turned off
+		waitForPendingProcessing();
+		writeInputs( _in_buf );
+		writeParameterChanges();
+		sendMessage( IdStartProcessing );
+		++m_processingPending;
+
+		if( m_failed || _out_buf == NULL || m_outputCount == 0 )
+		{
+			unlock();
+			return false;
+		}
+
+		waitForPendingProcessing();
+		unlock();
+	}
+
+	readOutputs( _out_buf );
+
+	return true;
+}
+
+
+
+
+void RemotePlugin::setAsyncProcessing( bool _on )
+{
+	lock();
+	m_asyncProcessing = _on;
+	unlock();
+}
+
+
+
+
+f_cnt_t RemotePlugin::latency() const
+{
+	return m_asyncProcessing ? Engine::mixer()->framesPerPeriod() : 0;
+}
+
+
+
+
+void RemotePlugin::waitForPendingProcessing()
+{
+	// IdProcessingDone may also be taken by any other waitForMessage(),
+	// processMessage() counts them down either way
+	while( m_processingPending > 0 && !m_failed && !isInvalid() )
+	{
+		fetchAndProcessNextMessage();
+	}
+	if( m_failed || isInvalid() )
+	{
+		m_processingPending = 0;
+	}
+}
+
+
+
+
+void RemotePlugin::writeInputs( const sampleFrame * _in_buf )
+{
+	const fpp_t frames = Engine::mixer()->framesPerPeriod();
 
 	ch_cnt_t inputs = qMin<ch_cnt_t>( m_inputCount, DEFAULT_CHANNELS );
 
+	// the plugin overwrites its outputs, so only inputs we don't fill
+	// need to be cleared instead of the whole segment
+	if( _in_buf == NULL || inputs < m_inputCount ||
+			( !m_splitChannels && inputs < DEFAULT_CHANNELS ) )
+	{
+		memset( m_shm, 0, m_inputCount * frames * sizeof( float ) );
+	}
+
 	if( _in_buf != NULL && inputs > 0 )
 	{
 		if( m_splitChannels )
@@ -344,18 +711,14 @@ bool RemotePlugin::process( const sampleFrame * _in_buf,
 			}
 		}
 	}
+}
 
-	lock();
-	sendMessage( IdStartProcessing );
 
-	if( m_failed || _out_buf == NULL || m_outputCount == 0 )
-	{
-		unlock();
-		return false;
-	}
 
-	waitForMessage( IdProcessingDone );
-	unlock();
+
+void RemotePlugin::readOutputs( sampleFrame * _out_buf )
+{
+	const fpp_t frames = Engine::mixer()->framesPerPeriod();
 
 	const ch_cnt_t outputs = qMin<ch_cnt_t>( m_outputCount,
 							DEFAULT_CHANNELS );
@@ -391,8 +754,94 @@ bool RemotePlugin::process( const sampleFrame * _in_buf,
 			}
 		}
 	}
+}
 
-	return true;
+
+
+
+void RemotePlugin::writeParameterChanges()
+{
+	RemoteParameterBlock * block = parameterBlock();
+	block->count = 0;
+
+	int changes;
+	ParameterChangeList::Element * oldest = takeParameterChanges( changes );
+
+	// the latest changes go into the block, the ones before which don't
+	// fit there are sent ahead so they're applied first
+	while( oldest != NULL )
+	{
+		const RemoteParameterChange & c = oldest->value;
+		if( changes-- > RemoteParameterBlock::MaxChanges )
+		{
+			sendMessage( message( IdParameterChange ).addInt( c.index ).
+					addFloat( c.value ).addInt( c.offset ) );
+		}
+		else
+		{
+			block->changes[block->count++] = c;
+		}
+		ParameterChangeList::Element * next = oldest->next;
+		m_parameterChanges.free( oldest );
+		oldest = next;
+	}
+}
+
+
+
+
+RemotePlugin::ParameterChangeList::Element *
+			RemotePlugin::takeParameterChanges( int & _changes )
+{
+	ParameterChangeList::Element * oldest = NULL;
+	_changes = 0;
+	for( ParameterChangeList::Element * e =
+			m_parameterChanges.popList(); e != NULL; ++_changes )
+	{
+		ParameterChangeList::Element * next = e->next;
+		e->next = oldest;
+		oldest = e;
+		e = next;
+	}
+	return oldest;
+}
+
+
+
+
+RemoteParameterBlock * RemotePlugin::parameterBlock()
+{
+	return (RemoteParameterBlock *)( m_shm + ( m_inputCount +
+			m_outputCount ) * Engine::mixer()->framesPerPeriod() );
+}
+
+
+
+
+void RemotePlugin::queueParameterChange( int _index, float _value,
+							f_cnt_t _offset )
+{
+	const RemoteParameterChange c = { _index, _value, _offset };
+	m_parameterChanges.push( c );
+}
+
+
+
+
+void RemotePlugin::flushParameterChanges()
+{
+	int changes;
+	ParameterChangeList::Element * oldest = takeParameterChanges( changes );
+
+	while( oldest != NULL )
+	{
+		const RemoteParameterChange & c = oldest->value;
+		sendMessage( message( IdParameterChange ).addInt( c.index ).
+				addFloat( c.value ).addInt( c.offset ) );
+		ParameterChangeList::Element * next = oldest->next;
+		m_parameterChanges.free( oldest );
+		oldest = next;
+	}
 }
 
 
@@ -431,9 +880,10 @@ void RemotePlugin::hideUI()
 
 void RemotePlugin::resizeSharedProcessingMemory()
 {
+	// the audio and the parameter changes of a period
 	const size_t s = ( m_inputCount+m_outputCount ) *
 				Engine::mixer()->framesPerPeriod() *
-							sizeof( float );
+				sizeof( float ) + sizeof( RemoteParameterBlock );
 	if( m_shm != NULL )
 	{
 #ifdef USE_QT_SHMEM
@@ -461,6 +911,8 @@ void RemotePlugin::resizeSharedProcessingMemory()
 
 	m_shm = (float *) shmat( m_shmID, 0, 0 );
 #endif
+	// outputs the plugin didn't write yet read as silence
+	memset( m_shm, 0, s );
 	m_shmSize = s;
 	sendMessage( message( IdChangeSharedMemoryKey ).
 				addInt( shm_key ).addInt( m_shmSize ) );
@@ -540,6 +992,12 @@ bool RemotePlugin::processMessage( const message & _m )
 			break;
 
 		case IdProcessingDone:
+			if( m_processingPending > 0 )
+			{
+				--m_processingPending;
+			}
+			break;
+
 		case IdQuit:
 		default:
 			break;
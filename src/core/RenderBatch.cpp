@@ -0,0 +1,252 @@
+/*
+ * RenderBatch.cpp - renders several projects one after the other in the
+ *                   same process
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "RenderBatch.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QTextStream>
+
+#include <cstdio>
+
+#include "Engine.h"
+#include "ProjectRenderer.h"
+#include "RenderManager.h"
+#include "SampleCache.h"
+#include "Song.h"
+#include "stdshims.h"
+
+
+namespace
+{
+
+// decoded samples kept for the projects after the one using them
+const size_t RetainedSampleBytes = 256 * 1024 * 1024;
+
+
+//! Splits _line at whitespace, except for within double quotes. Returns
+//! false if a quote isn't closed.
+bool splitLine( const QString & _line, QStringList & _fields )
+{
+	QString field;
+	bool inField = false;
+	bool quoted = false;
+	for( const QChar c : _line )
+	{
+		if( c == '"' )
+		{
+			quoted = !quoted;
+			inField = true;
+		}
+		else if( c.isSpace() && !quoted )
+		{
+			if( inField )
+			{
+				_fields << field;
+				field.clear();
+				inField = false;
+			}
+		}
+		else
+		{
+			field += c;
+			inField = true;
+		}
+	}
+	if( inField )
+	{
+		_fields << field;
+	}
+	return !quoted;
+}
+
+}
+
+
+
+
+bool RenderBatch::splitFields( const QString & _line, QStringList & _fields )
+{
+	return splitLine( _line, _fields );
+}
+
+
+
+
+bool RenderBatch::readManifest( const QString & _manifest,
+				QVector<Job> & _jobs, QString & _error )
+{
+	QFile file( _manifest );
+	if( !file.open( QIODevice::ReadOnly | QIODevice::Text ) )
+	{
+		_error = QString( "Can't read %1" ).arg( _manifest );
+		return false;
+	}
+
+	const QDir dir = QFileInfo( _manifest ).absoluteDir();
+	QTextStream in( &file );
+	for( int line = 1; !in.atEnd(); ++line )
+	{
+		const QString text = in.readLine().trimmed();
+		if( text.isEmpty() || text.startsWith( '#' ) )
+		{
+			continue;
+		}
+
+		QStringList fields;
+		if( !splitLine( text, fields ) || fields.size() != 2 )
+		{
+			_error = QString( "Line %1 of %2 isn't a project followed "
+				"by an output file" ).arg( line ).arg( _manifest );
+			return false;
+		}
+		_jobs.push_back( Job{ dir.absoluteFilePath( fields[0] ),
+					dir.absoluteFilePath( fields[1] ) } );
+	}
+
+	if( _jobs.isEmpty() )
+	{
+		_error = QString( "%1 lists no projects" ).arg( _manifest );
+		return false;
+	}
+	return true;
+}
+
+
+
+
+RenderBatch::RenderBatch( const QVector<Job> & _jobs,
+			const Mixer::qualitySettings & _qualitySettings,
+			const OutputSettings & _outputSettings, bool _loop ) :
+	m_jobs( _jobs ),
+	m_qualitySettings( _qualitySettings ),
+	m_outputSettings( _outputSettings ),
+	m_loop( _loop ),
+	m_next( 0 ),
+	m_failed( 0 )
+{
+	// projects of a batch often share samples, e.g. of the same kit
+	SampleCache::setRetainBudget( RetainedSampleBytes );
+}
+
+
+
+
+RenderBatch::~RenderBatch()
+{
+	m_manager.reset();
+	SampleCache::setRetainBudget( 0 );
+}
+
+
+
+
+void RenderBatch::start()
+{
+	m_next = 0;
+	m_failed = 0;
+	renderNext();
+}
+
+
+
+
+void RenderBatch::updateConsoleProgress()
+{
+	if( m_manager )
+	{
+		m_manager->updateConsoleProgress();
+	}
+}
+
+
+
+
+void RenderBatch::renderNext()
+{
+	m_manager.reset();
+
+	Song * song = Engine::getSong();
+	while( m_next < m_jobs.size() )
+	{
+		const Job & job = m_jobs[m_next++];
+		fprintf( stderr, "[%d/%d] %s\n", m_next, m_jobs.size(),
+					job.project.toUtf8().constData() );
+
+		// a project which can't be loaded leaves the song empty
+		// instead of with the project before
+		song->clearProject();
+		song->loadProject( job.project );
+		if( song->isEmpty() )
+		{
+			fprintf( stderr, "The project %s is empty or couldn't be "
+				"loaded, skipping it\n",
+					job.project.toUtf8().constData() );
+			++m_failed;
+			continue;
+		}
+		song->setExportLoop( m_loop );
+
+		// so it's known whether the render wrote anything
+		QFile::remove( job.output );
+
+		m_manager = make_unique<RenderManager>( m_qualitySettings,
+			m_outputSettings,
+			ProjectRenderer::getFileFormatFromExtension(
+				"." + QFileInfo( job.output ).suffix() ),
+			job.output );
+		// the manager is deleted once it returned from its signal
+		connect( m_manager.get(), SIGNAL( finished() ),
+				this, SLOT( jobFinished() ),
+				Qt::QueuedConnection );
+
+		m_timer.start();
+		m_manager->renderProject();
+		return;
+	}
+
+	emit finished();
+}
+
+
+
+
+void RenderBatch::jobFinished()
+{
+	const Job & job = m_jobs[m_next - 1];
+	if( QFileInfo( job.output ).isFile() )
+	{
+		fprintf( stderr, "\nRendered %s in %.1f s\n",
+				job.output.toUtf8().constData(),
+				m_timer.elapsed() / 1000.0 );
+	}
+	else
+	{
+		fprintf( stderr, "\nCould not render %s\n",
+				job.output.toUtf8().constData() );
+		++m_failed;
+	}
+
+	renderNext();
+}
@@ -0,0 +1,374 @@
+/*
+ * RenderCache.cpp - bars of a song rendered by earlier exports, so only the
+ *                   ones which changed get rendered again
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "RenderCache.h"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSet>
+#include <QtCore/QStringList>
+#include <QtCore/QTemporaryFile>
+#include <QtCore/QTextStream>
+#include <QtXml/QDomDocument>
+
+#include "BBTrackContainer.h"
+#include "Controller.h"
+#include "Engine.h"
+#include "FxMixer.h"
+#include "Song.h"
+#include "Track.h"
+
+
+namespace
+{
+
+const char * const ManifestName = "cache.txt";
+const char * const ManifestHeader = "lmms-render-cache 1";
+// files of the cache, others in the directory are left alone
+const char * const FilePattern = "bars-*.wav";
+
+
+void addElement( QCryptographicHash & _hash, const QDomElement & _element )
+{
+	_hash.addData( _element.tagName().toUtf8() );
+
+	// QDom doesn't keep the order of the attributes
+	const QDomNamedNodeMap attributes = _element.attributes();
+	QStringList sorted;
+	for( int i = 0; i < attributes.count(); ++i )
+	{
+		const QDomAttr attribute = attributes.item( i ).toAttr();
+		sorted << attribute.name() + '=' + attribute.value();
+	}
+	sorted.sort();
+	_hash.addData( sorted.join( '\n' ).toUtf8() );
+
+	for( QDomNode node = _element.firstChild(); !node.isNull();
+						node = node.nextSibling() )
+	{
+		if( node.isElement() )
+		{
+			addElement( _hash, node.toElement() );
+		}
+		else if( node.isCharacterData() )
+		{
+			_hash.addData( node.nodeValue().toUtf8() );
+		}
+	}
+	_hash.addData( "/" );
+}
+
+
+
+
+QByteArray stateHash( SerializingObject * _object )
+{
+	QDomDocument doc;
+	QDomElement root = doc.createElement( "state" );
+	doc.appendChild( root );
+	_object->saveState( doc, root );
+
+	QCryptographicHash hash( QCryptographicHash::Sha1 );
+	addElement( hash, root );
+	return hash.result();
+}
+
+}
+
+
+
+
+RenderCache::RenderCache( const QString & _dir, const QByteArray & _settings,
+					bar_t _preRoll, f_cnt_t _crossfade ) :
+	m_dir( _dir ),
+	m_settings( _settings + ' ' + QByteArray::number( _preRoll ) + ' ' +
+					QByteArray::number( _crossfade ) ),
+	m_preRoll( qMax<bar_t>( _preRoll, 0 ) ),
+	m_crossfade( qMax<f_cnt_t>( _crossfade, 0 ) )
+{
+	m_dir.mkpath( "." );
+	load();
+}
+
+
+
+
+QVector<QByteArray> RenderCache::barHashes( Song * _song )
+{
+	// the bars an export plays without looping
+	_song->updateLength();
+	const bar_t bars = _song->length() + 1;
+
+	// what each bar depends on
+	QCryptographicHash global( QCryptographicHash::Sha1 );
+	global.addData( QByteArray::number( _song->getTempo() ) + ' ' +
+			QByteArray::number( _song->getTimeSigModel().getNumerator() ) + '/' +
+			QByteArray::number( _song->getTimeSigModel().getDenominator() ) + ' ' +
+			QByteArray::number( _song->masterVolume() ) + ' ' +
+			QByteArray::number( _song->masterPitch() ) );
+	global.addData( stateHash( Engine::fxMixer() ) );
+	for( Controller * controller : _song->controllers() )
+	{
+		global.addData( stateHash( controller ) );
+	}
+	const QByteArray bbHash = stateHash( Engine::getBBTrackContainer() );
+
+	QVector<QByteArray> data( bars );
+	const TrackContainer::TrackList tracks = _song->automationTracks();
+	for( int t = 0; t < tracks.size(); ++t )
+	{
+		Track * track = tracks[t];
+		// soloing a track mutes all others
+		global.addData( track->isSolo() ? "s" : "-" );
+
+		track->setSimpleSerializing();
+		const QByteArray trackHash = QByteArray::number( t ) +
+							stateHash( track );
+		const bool automation = track->type() == Track::AutomationTrack ||
+				track->type() == Track::HiddenAutomationTrack;
+
+		for( TrackContentObject * tco : track->getTCOs() )
+		{
+			QByteArray hash = trackHash + stateHash( tco );
+			if( track->type() == Track::BBTrack )
+			{
+				hash += bbHash;
+			}
+
+			// automated models keep the last value of a pattern
+			const bar_t first = qMax<bar_t>(
+					tco->startPosition().getBar(), 0 );
+			const bar_t last = automation ? bars - 1 : qMin( bars - 1,
+				MidiTime( tco->endPosition() - 1 ).getBar() );
+			for( bar_t bar = first; bar <= last; ++bar )
+			{
+				data[bar] += hash;
+			}
+		}
+	}
+
+	const QByteArray globalHash = global.result();
+	QVector<QByteArray> hashes( bars );
+	for( bar_t bar = 0; bar < bars; ++bar )
+	{
+		hashes[bar] = QCryptographicHash::hash( globalHash + data[bar],
+						QCryptographicHash::Sha1 );
+	}
+	return hashes;
+}
+
+
+
+
+void RenderCache::setBarHashes( const QVector<QByteArray> & _hashes )
+{
+	m_bars.clear();
+	m_dirtyRuns.clear();
+
+	// whether each bar changed itself, the ones after it are affected by
+	// its tails within the pre-roll
+	QVector<bool> changed( _hashes.size() );
+	for( int bar = 0; bar < _hashes.size(); ++bar )
+	{
+		changed[bar] = bar >= m_cached.size() ||
+				m_cached[bar].hash != _hashes[bar];
+	}
+
+	for( int bar = 0; bar < _hashes.size(); ++bar )
+	{
+		bool dirty = bar >= m_cached.size() || m_cached[bar].file.isEmpty();
+		for( int b = qMax( 0, bar - m_preRoll ); b <= bar && !dirty; ++b )
+		{
+			dirty = changed[b];
+		}
+
+		Bar entry = dirty ? Bar{ _hashes[bar], QString(), 0, 0 } :
+								m_cached[bar];
+		entry.hash = _hashes[bar];
+		m_bars.push_back( entry );
+
+		if( dirty )
+		{
+			if( !m_dirtyRuns.isEmpty() && m_dirtyRuns.back().end == bar )
+			{
+				++m_dirtyRuns.back().end;
+			}
+			else
+			{
+				m_dirtyRuns.push_back( Run{ bar, bar + 1 } );
+			}
+		}
+	}
+}
+
+
+
+
+QString RenderCache::createFile()
+{
+	QTemporaryFile file( m_dir.filePath( QString( FilePattern ).
+					replace( '*', "XXXXXX" ) ) );
+	file.setAutoRemove( false );
+	if( !file.open() )
+	{
+		return QString();
+	}
+	return file.fileName();
+}
+
+
+
+
+bool RenderCache::addRun( const Run & _run, const QString & _file,
+					const QVector<f_cnt_t> & _barFrames )
+{
+	// the frames of each bar and the end of the last one
+	if( _run.begin < 0 || _run.end > m_bars.size() ||
+			_barFrames.size() != _run.end - _run.begin + 1 )
+	{
+		return false;
+	}
+
+	const QString name = QFileInfo( _file ).fileName();
+	for( bar_t bar = _run.begin; bar < _run.end; ++bar )
+	{
+		const int i = bar - _run.begin;
+		m_bars[bar].file = name;
+		m_bars[bar].begin = _barFrames[i];
+		m_bars[bar].frames = _barFrames[i + 1] - _barFrames[i];
+	}
+	return true;
+}
+
+
+
+
+QVector<SegmentStitcher::Segment> RenderCache::segments() const
+{
+	QVector<SegmentStitcher::Segment> segments;
+	for( int bar = 0; bar < m_bars.size(); ++bar )
+	{
+		// the rest of the file follows each bar, which it's crossfaded
+		// with if the next bar comes from another file
+		const bool last = bar == m_bars.size() - 1;
+		segments.push_back( SegmentStitcher::Segment{
+				m_dir.filePath( m_bars[bar].file ),
+				m_bars[bar].begin,
+				m_bars[bar].frames + ( last ? 0 : m_crossfade ) } );
+	}
+	return segments;
+}
+
+
+
+
+bool RenderCache::save()
+{
+	QFile manifest( m_dir.filePath( ManifestName ) );
+	if( !manifest.open( QIODevice::WriteOnly | QIODevice::Truncate |
+							QIODevice::Text ) )
+	{
+		return false;
+	}
+
+	QSet<QString> used;
+	QTextStream out( &manifest );
+	out << ManifestHeader << '\n';
+	out << "settings " << m_settings.toHex() << '\n';
+	for( const Bar & bar : m_bars )
+	{
+		if( bar.file.isEmpty() )
+		{
+			break;
+		}
+		out << bar.hash.toHex() << ' ' << bar.file << ' ' <<
+				bar.begin << ' ' << bar.frames << '\n';
+		used.insert( bar.file );
+	}
+	out.flush();
+	manifest.close();
+
+	for( const QString & file : m_dir.entryList(
+				QStringList( FilePattern ), QDir::Files ) )
+	{
+		if( !used.contains( file ) )
+		{
+			m_dir.remove( file );
+		}
+	}
+
+	m_cached = m_bars;
+	return manifest.error() == QFile::NoError;
+}
+
+
+
+
+void RenderCache::load()
+{
+	m_cached.clear();
+
+	QFile manifest( m_dir.filePath( ManifestName ) );
+	if( !manifest.open( QIODevice::ReadOnly | QIODevice::Text ) )
+	{
+		return;
+	}
+
+	QTextStream in( &manifest );
+	if( in.readLine() != ManifestHeader ||
+		in.readLine() != "settings " + QString( m_settings.toHex() ) )
+	{
+		// rendered differently, everything has to be rendered again
+		return;
+	}
+
+	QSet<QString> existing;
+	while( !in.atEnd() )
+	{
+		const QStringList fields = in.readLine().split( ' ' );
+		bool beginOk = false, framesOk = false;
+		Bar bar;
+		if( fields.size() == 4 )
+		{
+			bar.hash = QByteArray::fromHex( fields[0].toLatin1() );
+			bar.file = fields[1];
+			bar.begin = fields[2].toInt( &beginOk );
+			bar.frames = fields[3].toInt( &framesOk );
+		}
+		if( !beginOk || !framesOk )
+		{
+			break;
+		}
+
+		if( !existing.contains( bar.file ) )
+		{
+			if( !QFileInfo( m_dir.filePath( bar.file ) ).isFile() )
+			{
+				break;
+			}
+			existing.insert( bar.file );
+		}
+		m_cached.push_back( bar );
+	}
+}
@@ -0,0 +1,617 @@
+/*
+ * RenderDaemon.cpp - renders the projects sent to it by other processes
+ *                    without starting over for each of them
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "RenderDaemon.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSocketNotifier>
+#include <QtCore/QStringList>
+
+#include <cerrno>
+#include <cstring>
+
+#include "lmmsconfig.h"
+
+#ifndef LMMS_BUILD_WIN32
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "AudioFileStream.h"
+#include "Engine.h"
+#include "ProjectRenderer.h"
+#include "RenderBatch.h"
+#include "RenderManager.h"
+#include "SampleCache.h"
+#include "Song.h"
+#include "stdshims.h"
+
+
+namespace
+{
+
+// decoded samples kept for the jobs after the one using them
+const size_t RetainedSampleBytes = 256 * 1024 * 1024;
+
+// clients stop being read from if they send longer lines
+const int MaxLineLength = 64 * 1024;
+
+}
+
+
+
+
+RenderDaemon::RenderDaemon( const QString & _socket,
+			const Mixer::qualitySettings & _qualitySettings,
+			const OutputSettings & _outputSettings ) :
+	m_socketPath( _socket ),
+	m_qualitySettings( _qualitySettings ),
+	m_outputSettings( _outputSettings ),
+	m_listenFd( -1 ),
+	m_listenNotifier( NULL ),
+	m_closing( false ),
+	m_quit( false ),
+	m_nextId( 1 ),
+	m_current(),
+	m_progress( 0 )
+{
+	SampleCache::setRetainBudget( RetainedSampleBytes );
+}
+
+
+
+
+RenderDaemon::~RenderDaemon()
+{
+	if( m_manager )
+	{
+		m_manager->abortProcessing();
+		m_manager.reset();
+	}
+	while( !m_clients.isEmpty() )
+	{
+		removeClient( m_clients.first() );
+	}
+#ifndef LMMS_BUILD_WIN32
+	if( m_listenFd >= 0 )
+	{
+		delete m_listenNotifier;
+		::close( m_listenFd );
+		unlink( QFile::encodeName( m_socketPath ).constData() );
+	}
+#endif
+	SampleCache::setRetainBudget( 0 );
+}
+
+
+
+
+bool RenderDaemon::start( QString & _error )
+{
+#ifdef LMMS_BUILD_WIN32
+	_error = "The render daemon isn't supported on Windows";
+	return false;
+#else
+	if( m_socketPath.isEmpty() )
+	{
+		// the replies own standard output, whatever else is printed
+		// goes to standard error
+		const int out = dup( STDOUT_FILENO );
+		dup2( STDERR_FILENO, STDOUT_FILENO );
+
+		Client * client = new Client{ STDIN_FILENO, out,
+			new QSocketNotifier( STDIN_FILENO,
+					QSocketNotifier::Read, this ),
+			QByteArray() };
+		connect( client->notifier, SIGNAL( activated( int ) ),
+					this, SLOT( readClient( int ) ) );
+		m_clients << client;
+		return true;
+	}
+
+	const QByteArray path = QFile::encodeName( m_socketPath );
+	sockaddr_un address;
+	memset( &address, 0, sizeof( address ) );
+	address.sun_family = AF_UNIX;
+	if( path.size() >= static_cast<int>( sizeof( address.sun_path ) ) )
+	{
+		_error = QString( "The socket path %1 is too long" ).
+							arg( m_socketPath );
+		return false;
+	}
+	strcpy( address.sun_path, path.constData() );
+
+	// the socket of a daemon before, but nothing else
+	struct stat info;
+	if( stat( path.constData(), &info ) == 0 && S_ISSOCK( info.st_mode ) )
+	{
+		unlink( path.constData() );
+	}
+
+	m_listenFd = socket( AF_UNIX, SOCK_STREAM, 0 );
+	if( m_listenFd < 0 ||
+		bind( m_listenFd, reinterpret_cast<sockaddr *>( &address ),
+						sizeof( address ) ) != 0 ||
+					::listen( m_listenFd, 8 ) != 0 )
+	{
+		_error = QString( "Can't listen on %1: %2" ).arg( m_socketPath ).
+						arg( strerror( errno ) );
+		if( m_listenFd >= 0 )
+		{
+			::close( m_listenFd );
+			m_listenFd = -1;
+		}
+		return false;
+	}
+
+	m_listenNotifier = new QSocketNotifier( m_listenFd,
+					QSocketNotifier::Read, this );
+	connect( m_listenNotifier, SIGNAL( activated( int ) ),
+					this, SLOT( acceptClient() ) );
+	return true;
+#endif
+}
+
+
+
+
+void RenderDaemon::acceptClient()
+{
+#ifndef LMMS_BUILD_WIN32
+	const int fd = accept( m_listenFd, NULL, NULL );
+	if( fd < 0 )
+	{
+		return;
+	}
+	Client * client = new Client{ fd, fd,
+		new QSocketNotifier( fd, QSocketNotifier::Read, this ),
+		QByteArray() };
+	connect( client->notifier, SIGNAL( activated( int ) ),
+				this, SLOT( readClient( int ) ) );
+	m_clients << client;
+#endif
+}
+
+
+
+
+void RenderDaemon::readClient( int _fd )
+{
+#ifndef LMMS_BUILD_WIN32
+	Client * client = NULL;
+	for( Client * c : m_clients )
+	{
+		if( c->inFd == _fd )
+		{
+			client = c;
+		}
+	}
+	if( client == NULL )
+	{
+		return;
+	}
+
+	char buffer[4096];
+	const ssize_t bytes = ::read( _fd, buffer, sizeof( buffer ) );
+	if( bytes < 0 && errno == EINTR )
+	{
+		return;
+	}
+	if( bytes <= 0 || client->pending.size() > MaxLineLength )
+	{
+		if( m_socketPath.isEmpty() )
+		{
+			// the jobs sent to standard input are still rendered
+			client->notifier->setEnabled( false );
+			m_closing = true;
+			if( !m_quit && !m_manager && m_queue.isEmpty() )
+			{
+				quit();
+			}
+		}
+		else
+		{
+			removeClient( client );
+		}
+		return;
+	}
+
+	client->pending.append( buffer, bytes );
+	int end;
+	while( ( end = client->pending.indexOf( '\n' ) ) >= 0 )
+	{
+		const QString line = QString::fromUtf8(
+					client->pending.left( end ) ).trimmed();
+		client->pending.remove( 0, end + 1 );
+		handleCommand( client, line );
+	}
+#endif
+}
+
+
+
+
+void RenderDaemon::updateProgress( int _progress )
+{
+	if( _progress != m_progress )
+	{
+		m_progress = _progress;
+		send( m_current.client, QString( "progress %1 %2" ).
+					arg( m_current.id ).arg( _progress ) );
+	}
+}
+
+
+
+
+void RenderDaemon::jobFinished()
+{
+	// queued before the job was cancelled
+	if( !m_manager || sender() != m_manager.get() )
+	{
+		return;
+	}
+
+	// nothing to look at for streams, they end with the connection
+	if( AudioFileStream::isStream( m_current.output ) ||
+				QFileInfo( m_current.output ).isFile() )
+	{
+		finishJob( QString( "done %1 %2" ).arg( m_current.id ).
+				arg( m_timer.elapsed() / 1000.0, 0, 'f', 1 ) );
+	}
+	else
+	{
+		finishJob( QString( "failed %1 \"Could not write %2\"" ).
+				arg( m_current.id ).arg( m_current.output ) );
+	}
+}
+
+
+
+
+void RenderDaemon::handleCommand( Client * _client, const QString & _line )
+{
+	QStringList fields;
+	if( m_quit )
+	{
+		return;
+	}
+	if( !RenderBatch::splitFields( _line, fields ) )
+	{
+		send( _client, "error \"Unclosed quote\"" );
+		return;
+	}
+	if( fields.isEmpty() || fields[0].startsWith( '#' ) )
+	{
+		return;
+	}
+
+	const QString & command = fields[0];
+	if( command == "render" || command == "preview" )
+	{
+		queueJob( _client, fields, command == "preview" );
+	}
+	else if( command == "cancel" && fields.size() == 2 )
+	{
+		cancelJob( _client, fields[1].toInt() );
+	}
+	else if( command == "jobs" )
+	{
+		if( m_manager )
+		{
+			send( _client, QString( "job %1 rendering %2 \"%3\"" ).
+				arg( m_current.id ).arg( m_current.priority ).
+						arg( m_current.project ) );
+		}
+		for( const Job & job : m_queue )
+		{
+			send( _client, QString( "job %1 queued %2 \"%3\"" ).
+					arg( job.id ).arg( job.priority ).
+							arg( job.project ) );
+		}
+	}
+	else if( command == "quit" )
+	{
+		quit();
+	}
+	else
+	{
+		send( _client, QString( "error \"Unknown command %1\"" ).
+								arg( _line ) );
+	}
+}
+
+
+
+
+void RenderDaemon::queueJob( Client * _client, const QStringList & _fields,
+							bool _preview )
+{
+	const int fieldsNeeded = _preview ? 4 : 3;
+	if( _fields.size() != fieldsNeeded &&
+				_fields.size() != fieldsNeeded + 1 )
+	{
+		send( _client, _preview ?
+			"error \"preview <project> <output> <first bar>:<last bar> "
+							"[<priority>]\"" :
+			"error \"render <project> <output> [<priority>]\"" );
+		return;
+	}
+
+	Job job;
+	job.id = m_nextId;
+	job.project = QFileInfo( _fields[1] ).absoluteFilePath();
+	job.output = _fields[2];
+	job.firstBar = 0;
+	job.lastBar = 0;
+	job.client = _client;
+
+	// standard output carries the replies
+	if( job.output == "-" )
+	{
+		send( _client, "error \"Jobs can't render to standard output\"" );
+		return;
+	}
+	if( !AudioFileStream::isStream( job.output ) )
+	{
+		job.output = QFileInfo( job.output ).absoluteFilePath();
+	}
+
+	if( _preview )
+	{
+		// like --range
+		const QStringList bars = _fields[3].split( ':' );
+		bool firstOk = false, lastOk = false;
+		if( bars.size() == 2 )
+		{
+			job.firstBar = bars[0].toInt( &firstOk );
+			job.lastBar = bars[1].toInt( &lastOk );
+		}
+		if( !firstOk || !lastOk || job.firstBar < 1 ||
+						job.lastBar <= job.firstBar )
+		{
+			send( _client, QString( "error \"Invalid range %1\"" ).
+							arg( _fields[3] ) );
+			return;
+		}
+	}
+
+	bool priorityOk = true;
+	job.priority = _fields.size() > fieldsNeeded ?
+			_fields[fieldsNeeded].toInt( &priorityOk ) : 0;
+	if( !priorityOk )
+	{
+		send( _client, QString( "error \"Invalid priority %1\"" ).
+						arg( _fields[fieldsNeeded] ) );
+		return;
+	}
+
+	++m_nextId;
+	int index = 0;
+	while( index < m_queue.size() &&
+				m_queue[index].priority >= job.priority )
+	{
+		++index;
+	}
+	m_queue.insert( index, job );
+	send( _client, QString( "queued %1" ).arg( job.id ) );
+
+	renderNext();
+}
+
+
+
+
+void RenderDaemon::cancelJob( Client * _client, int _id )
+{
+	if( m_manager && m_current.id == _id )
+	{
+		m_manager->abortProcessing();
+		finishJob( QString( "cancelled %1" ).arg( _id ) );
+		return;
+	}
+	for( int i = 0; i < m_queue.size(); ++i )
+	{
+		if( m_queue[i].id == _id )
+		{
+			send( m_queue[i].client, QString( "cancelled %1" ).arg( _id ) );
+			m_queue.removeAt( i );
+			return;
+		}
+	}
+	send( _client, QString( "error \"No job %1\"" ).arg( _id ) );
+}
+
+
+
+
+void RenderDaemon::send( Client * _client, const QString & _line )
+{
+#ifndef LMMS_BUILD_WIN32
+	if( _client == NULL )
+	{
+		return;
+	}
+	const QByteArray data = _line.toUtf8() + '\n';
+	const bool socket = !m_socketPath.isEmpty();
+	for( int written = 0; written < data.size(); )
+	{
+		// a client gone doesn't take the daemon with it
+		const ssize_t bytes = socket ?
+			::send( _client->outFd, data.constData() + written,
+				data.size() - written, MSG_NOSIGNAL ) :
+			::write( _client->outFd, data.constData() + written,
+						data.size() - written );
+		if( bytes < 0 && errno == EINTR )
+		{
+			continue;
+		}
+		if( bytes <= 0 )
+		{
+			return;
+		}
+		written += bytes;
+	}
+#endif
+}
+
+
+
+
+void RenderDaemon::removeClient( Client * _client )
+{
+	for( int i = 0; i < m_queue.size(); )
+	{
+		if( m_queue[i].client == _client )
+		{
+			m_queue.removeAt( i );
+		}
+		else
+		{
+			++i;
+		}
+	}
+	if( m_manager && m_current.client == _client )
+	{
+		m_manager->abortProcessing();
+		m_current.client = NULL;
+		finishJob( QString() );
+	}
+
+	m_clients.removeAll( _client );
+	delete _client->notifier;
+#ifndef LMMS_BUILD_WIN32
+	if( _client->inFd != STDIN_FILENO )
+	{
+		::close( _client->inFd );
+	}
+	if( _client->outFd != _client->inFd )
+	{
+		::close( _client->outFd );
+	}
+#endif
+	delete _client;
+}
+
+
+
+
+void RenderDaemon::renderNext()
+{
+	if( m_manager || m_quit )
+	{
+		return;
+	}
+
+	Song * song = Engine::getSong();
+	while( !m_queue.isEmpty() )
+	{
+		m_current = m_queue.takeFirst();
+		send( m_current.client, QString( "started %1" ).arg( m_current.id ) );
+
+		// a project which can't be loaded leaves the song empty
+		// instead of with the project before
+		song->clearProject();
+		song->loadProject( m_current.project );
+		if( song->isEmpty() )
+		{
+			send( m_current.client, QString( "failed %1 \"The project "
+				"is empty or couldn't be loaded\"" ).
+							arg( m_current.id ) );
+			continue;
+		}
+		song->setExportLoop( false );
+		if( m_current.firstBar > 0 )
+		{
+			song->setExportRange( MidiTime( m_current.firstBar - 1, 0 ),
+					MidiTime( m_current.lastBar - 1, 0 ),
+							MidiTime( 1, 0 ), 0 );
+		}
+		else
+		{
+			song->clearExportRange();
+		}
+
+		if( !AudioFileStream::isStream( m_current.output ) )
+		{
+			// so it's known whether the render wrote anything
+			QFile::remove( m_current.output );
+		}
+
+		m_manager = make_unique<RenderManager>( m_qualitySettings,
+			m_outputSettings,
+			AudioFileStream::isStream( m_current.output ) ?
+				ProjectRenderer::WaveFile :
+				ProjectRenderer::getFileFormatFromExtension(
+					"." + QFileInfo( m_current.output ).suffix() ),
+			m_current.output );
+		connect( m_manager.get(), SIGNAL( progressChanged( int ) ),
+				this, SLOT( updateProgress( int ) ) );
+		// the manager is deleted once it returned from its signal
+		connect( m_manager.get(), SIGNAL( finished() ),
+				this, SLOT( jobFinished() ),
+				Qt::QueuedConnection );
+
+		m_progress = 0;
+		m_timer.start();
+		m_manager->renderProject();
+		return;
+	}
+
+	if( m_closing )
+	{
+		quit();
+	}
+}
+
+
+
+
+void RenderDaemon::finishJob( const QString & _status )
+{
+	if( !_status.isEmpty() )
+	{
+		send( m_current.client, _status );
+	}
+	m_manager.reset();
+	m_current = Job();
+	renderNext();
+}
+
+
+
+
+void RenderDaemon::quit()
+{
+	m_queue.clear();
+	if( m_manager )
+	{
+		m_manager->abortProcessing();
+		m_manager.reset();
+	}
+	m_quit = true;
+	emit finished();
+}
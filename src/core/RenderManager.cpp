@@ -29,6 +29,9 @@
 #include "Song.h"
 #include "BBTrackContainer.h"
 #include "BBTrack.h"
+#include "FxMixer.h"
+#include "InstrumentTrack.h"
+#include "SampleTrack.h"
 #include "stdshims.h"
 
 
@@ -41,7 +44,8 @@ RenderManager::RenderManager(
 	m_oldQualitySettings( Engine::mixer()->currentQualitySettings() ),
 	m_outputSettings(outputSettings),
 	m_format(fmt),
-	m_outputPath(outputPath)
+	m_outputPath(outputPath),
+	m_nextRun(0)
 {
 	Engine::mixer()->storeAudioDevice();
 }
@@ -56,80 +60,82 @@ void RenderManager::abortProcessing()
 {
 	if ( m_activeRenderer ) {
 		disconnect( m_activeRenderer.get(), SIGNAL( finished() ),
-				this, SLOT( renderNextTrack() ) );
+				this, SLOT( renderFinished() ) );
 		m_activeRenderer->abortProcessing();
 	}
-	restoreMutedState();
+	m_stems.reset();
+	m_cache.reset();
+	Engine::getSong()->clearExportRange();
 }
 
-// Called to render each new track when rendering tracks individually.
-void RenderManager::renderNextTrack()
+// Called when the renderer is done, the stems can be closed then
+void RenderManager::renderFinished()
 {
 	m_activeRenderer.reset();
+	m_stems.reset();
+	emit finished();
+}
 
-	if( m_tracksToRender.isEmpty() )
-	{
-		// nothing left to render
-		restoreMutedState();
-		emit finished();
-	}
-	else
-	{
-		// pop the next track from our rendering queue
-		Track* renderTrack = m_tracksToRender.back();
-		m_tracksToRender.pop_back();
+// Render the song into individual tracks and FX channels at once, besides
+// the whole mix
+void RenderManager::renderTracks( StemExporter::TapPoints tapPoint )
+{
+	m_stems = make_unique<StemExporter>(
+			ProjectRenderer::fileEncodeDevices[m_format].m_getDevInst,
+			m_outputSettings );
 
-		// mute everything but the track we are about to render
-		for( auto it = m_unmuted.begin(); it != m_unmuted.end(); ++it )
+	QVector<Track*> tracks;
+	const TrackContainer::TrackList & tl = Engine::getSong()->tracks();
+	const TrackContainer::TrackList t2 = Engine::getBBTrackContainer()->tracks();
+	for( const TrackContainer::TrackList & list : { tl, t2 } )
+	{
+		for( Track * tk : list )
 		{
-			(*it)->setMuted( (*it) != renderTrack );
+			// Don't render muted or automation tracks
+			if( tk->isMuted() == false &&
+				( tk->type() == Track::InstrumentTrack ||
+					tk->type() == Track::SampleTrack ) )
+			{
+				tracks.push_back( tk );
+			}
 		}
-
-		// for multi-render, prefix each output file with a different number
-		int trackNum = m_tracksToRender.size() + 1;
-
-		render( pathForTrack(renderTrack, trackNum) );
 	}
-}
 
-// Render the song into individual tracks
-void RenderManager::renderTracks()
-{
-	const TrackContainer::TrackList & tl = Engine::getSong()->tracks();
-
-	// find all currently unnmuted tracks -- we want to render these.
-	for( auto it = tl.begin(); it != tl.end(); ++it )
+	for( int i = 0; i < tracks.size(); ++i )
 	{
-		Track* tk = (*it);
-		Track::TrackTypes type = tk->type();
-
-		// Don't render automation tracks
-		if ( tk->isMuted() == false &&
-				( type == Track::InstrumentTrack || type == Track::SampleTrack ) )
+		Track * tk = tracks[i];
+		AudioPort * port = tk->type() == Track::InstrumentTrack ?
+				static_cast<InstrumentTrack *>( tk )->audioPort() :
+				static_cast<SampleTrack *>( tk )->audioPort();
+		const QString path = pathForStem( QString::number( i + 1 ),
+								tk->name() );
+		if( !m_stems->addPort( port, tapPoint, path ) )
 		{
-			m_unmuted.push_back(tk);
+			qDebug( "Could not create stem %s", qPrintable( path ) );
 		}
 	}
 
-	const TrackContainer::TrackList t2 = Engine::getBBTrackContainer()->tracks();
-	for( auto it = t2.begin(); it != t2.end(); ++it )
+	// the master channel is the mix written below
+	FxMixer * fxMixer = Engine::fxMixer();
+	for( int i = 1; i < fxMixer->numChannels(); ++i )
 	{
-		Track* tk = (*it);
-		Track::TrackTypes type = tk->type();
-
-		// Don't render automation tracks
-		if ( tk->isMuted() == false &&
-				( type == Track::InstrumentTrack || type == Track::SampleTrack ) )
+		FxChannel * channel = fxMixer->effectChannel( i );
+		if( channel->m_muteModel.value() )
+		{
+			continue;
+		}
+		const QString name = channel->m_name.isEmpty() ?
+				QString( "FX %1" ).arg( i ) : channel->m_name;
+		const QString path = pathForStem( QString( "fx%1" ).arg( i ),
+									name );
+		if( !m_stems->addFxChannel( channel, path ) )
 		{
-			m_unmuted.push_back(tk);
+			qDebug( "Could not create stem %s", qPrintable( path ) );
 		}
 	}
 
-	// copy the list of unmuted tracks into our rendering queue.
-	// we need to remember which tracks were unmuted to restore state at the end.
-	m_tracksToRender = m_unmuted;
-
-	renderNextTrack();
+	render( QDir( m_outputPath ).filePath( "master" +
+		ProjectRenderer::getFileExtensionFromFormat( m_format ) ) );
 }
 
 // Render the song into a single track
@@ -148,42 +154,162 @@ void RenderManager::render(QString outputPath)
 
 	if( m_activeRenderer->isReady() )
 	{
+		m_activeRenderer->setStemExporter( m_stems.get() );
+
 		// pass progress signals through
 		connect( m_activeRenderer.get(), SIGNAL( progressChanged( int ) ),
 				this, SIGNAL( progressChanged( int ) ) );
 
-		// when it is finished, render the next track.
-		// if we have not queued any tracks, renderNextTrack will just clean up
 		connect( m_activeRenderer.get(), SIGNAL( finished() ),
-				this, SLOT( renderNextTrack() ) );
+				this, SLOT( renderFinished() ) );
 
 		m_activeRenderer->startProcessing();
 	}
 	else
 	{
 		qDebug( "Renderer failed to acquire a file device!" );
-		renderNextTrack();
+		renderFinished();
+	}
+}
+
+// Render the bars which changed since the last export into the cache, and
+// splice them with the ones which didn't
+void RenderManager::renderIncrementally( const QString & cacheDir,
+					bar_t preRoll, f_cnt_t crossfade )
+{
+	const QByteArray settings =
+		QByteArray::number( m_outputSettings.getSampleRate() ) + ' ' +
+		QByteArray::number( m_qualitySettings.interpolation ) + ' ' +
+		QByteArray::number( m_qualitySettings.oversampling );
+	m_cache = make_unique<RenderCache>( cacheDir, settings, preRoll,
+								crossfade );
+	m_cache->setBarHashes( RenderCache::barHashes( Engine::getSong() ) );
+
+	int dirtyBars = 0;
+	for( const RenderCache::Run & run : m_cache->dirtyRuns() )
+	{
+		dirtyBars += run.end - run.begin;
+	}
+	fprintf( stderr, "Rendering %d of %d bars\n", dirtyBars,
+						m_cache->barCount() );
+
+	m_nextRun = 0;
+	renderNextRun();
+}
+
+// Render the next run of bars into a file of the cache, as floats so
+// splicing doesn't add noise
+void RenderManager::renderNextRun()
+{
+	Song * song = Engine::getSong();
+	if( m_nextRun >= m_cache->dirtyRuns().size() )
+	{
+		song->clearExportRange();
+		finishIncrementally();
+		return;
+	}
+
+	const RenderCache::Run & run = m_cache->dirtyRuns()[m_nextRun];
+	song->setExportRange( MidiTime( run.begin, 0 ), MidiTime( run.end, 0 ),
+				MidiTime( m_cache->preRoll(), 0 ),
+				m_cache->crossfade() );
+
+	OutputSettings outputSettings = m_outputSettings;
+	outputSettings.setBitDepth( OutputSettings::Depth_32Bit );
+	m_runFile = m_cache->createFile();
+	if( !m_runFile.isEmpty() )
+	{
+		m_activeRenderer = make_unique<ProjectRenderer>(
+				m_qualitySettings, outputSettings,
+				ProjectRenderer::WaveFile, m_runFile );
+	}
+
+	if( m_activeRenderer && m_activeRenderer->isReady() )
+	{
+		connect( m_activeRenderer.get(), SIGNAL( progressChanged( int ) ),
+				this, SIGNAL( progressChanged( int ) ) );
+
+		connect( m_activeRenderer.get(), SIGNAL( finished() ),
+				this, SLOT( runFinished() ) );
+
+		m_activeRenderer->startProcessing();
+	}
+	else
+	{
+		qDebug( "Could not create a file in the render cache" );
+		song->clearExportRange();
+		m_activeRenderer.reset();
+		m_cache.reset();
+		emit finished();
 	}
 }
 
-// Unmute all tracks that were muted while rendering tracks
-void RenderManager::restoreMutedState()
+// Called when a run of bars is rendered, the next one follows
+void RenderManager::runFinished()
 {
-	while( !m_unmuted.isEmpty() )
+	const bool added = m_cache->addRun( m_cache->dirtyRuns()[m_nextRun],
+				m_runFile, m_activeRenderer->barFrames() );
+	m_activeRenderer.reset();
+	if( !added )
+	{
+		qDebug( "Could not find the bars in %s", qPrintable( m_runFile ) );
+		Engine::getSong()->clearExportRange();
+		m_cache.reset();
+		emit finished();
+		return;
+	}
+
+	++m_nextRun;
+	renderNextRun();
+}
+
+// Splice the cached bars into the output file
+void RenderManager::finishIncrementally()
+{
+	// the device of the last run finishes its file once it's deleted
+	Engine::mixer()->restoreAudioDevice();
+
+	SegmentStitcher stitcher( m_cache->segments(), m_cache->crossfade() );
+	AudioFileDeviceInstantiaton factory =
+			ProjectRenderer::fileEncodeDevices[m_format].m_getDevInst;
+	bool successful = false;
+	if( !stitcher.open() )
+	{
+		qDebug( "%s", qPrintable( stitcher.errorString() ) );
+	}
+	else if( factory )
+	{
+		std::unique_ptr<AudioFileDevice> dev( factory( m_outputPath,
+					m_outputSettings, DEFAULT_CHANNELS,
+					Engine::mixer(), successful ) );
+		if( !successful )
+		{
+			qDebug( "Could not write %s", qPrintable( m_outputPath ) );
+		}
+		else if( !stitcher.stitch( dev.get() ) )
+		{
+			qDebug( "%s", qPrintable( stitcher.errorString() ) );
+			successful = false;
+		}
+	}
+
+	// keep what's cached only if it made it into the output
+	if( successful && !m_cache->save() )
 	{
-		Track* restoreTrack = m_unmuted.back();
-		m_unmuted.pop_back();
-		restoreTrack->setMuted( false );
+		qDebug( "Could not save the render cache" );
 	}
+	m_cache.reset();
+	emit finished();
 }
 
-// Determine the output path for a track when rendering tracks individually
-QString RenderManager::pathForTrack(const Track *track, int num)
+// Determine the output path of a stem when rendering tracks individually
+QString RenderManager::pathForStem( const QString & prefix,
+						const QString & stemName ) const
 {
 	QString extension = ProjectRenderer::getFileExtensionFromFormat( m_format );
-	QString name = track->name();
+	QString name = stemName;
 	name = name.remove(QRegExp(FILENAME_FILTER));
-	name = QString( "%1_%2%3" ).arg( num ).arg( name ).arg( extension );
+	name = QString( "%1_%2%3" ).arg( prefix ).arg( name ).arg( extension );
 	return QDir(m_outputPath).filePath(name);
 }
 
@@ -193,12 +319,10 @@ void RenderManager::updateConsoleProgress()
 	{
 		m_activeRenderer->updateConsoleProgress();
 
-		int totalNum = m_unmuted.size();
-		if ( totalNum > 0 )
+		if ( m_stems )
 		{
-			// we are rendering multiple tracks, append a track counter to the output
-			int trackNum = totalNum - m_tracksToRender.size();
-			fprintf( stderr, "(%d/%d)", trackNum, totalNum );
+			// we are rendering multiple tracks, append the number of stems
+			fprintf( stderr, "(%d stems)", m_stems->count() );
 		}
 	}
 }
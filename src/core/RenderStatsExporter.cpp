@@ -0,0 +1,175 @@
+/*
+ * RenderStatsExporter.cpp - sends the render stats of the mixer as OSC
+ *                           messages over UDP
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "RenderStatsExporter.h"
+
+#include <cstring>
+
+#include "lmmsconfig.h"
+
+#ifndef LMMS_BUILD_WIN32
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "Engine.h"
+
+
+// OSC strings are null terminated and padded to multiples of four bytes
+static void appendOscString( QByteArray & _message, const QByteArray & _string )
+{
+	_message += _string;
+	_message += QByteArray( 4 - _string.size() % 4, '\0' );
+}
+
+
+
+
+// OSC numbers are big endian
+static void appendOscInt( QByteArray & _message, qint32 _value )
+{
+	const quint32 value = _value;
+	for( int shift = 24; shift >= 0; shift -= 8 )
+	{
+		_message += char( ( value >> shift ) & 0xff );
+	}
+}
+
+
+
+
+static void appendOscFloat( QByteArray & _message, float _value )
+{
+	qint32 bits;
+	memcpy( &bits, &_value, sizeof( bits ) );
+	appendOscInt( _message, bits );
+}
+
+
+
+
+RenderStatsExporter::RenderStatsExporter( const QString & _target ) :
+	m_reader( Engine::mixer()->renderStats() ),
+	m_quit( false ),
+	m_socket( -1 )
+{
+#ifndef LMMS_BUILD_WIN32
+	char hostName[256] = "";
+	gethostname( hostName, sizeof( hostName ) - 1 );
+	m_hostName = hostName;
+
+	const int colon = _target.lastIndexOf( ':' );
+	if( colon < 0 )
+	{
+		return;
+	}
+	addrinfo hints;
+	memset( &hints, 0, sizeof( hints ) );
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+	addrinfo * result = NULL;
+	if( getaddrinfo( _target.left( colon ).toUtf8().constData(),
+			_target.mid( colon + 1 ).toUtf8().constData(),
+						&hints, &result ) != 0 )
+	{
+		return;
+	}
+	m_socket = socket( result->ai_family, result->ai_socktype,
+							result->ai_protocol );
+	m_address = QByteArray( reinterpret_cast<const char *>( result->ai_addr ),
+							result->ai_addrlen );
+	freeaddrinfo( result );
+#else
+	Q_UNUSED( _target );
+#endif
+}
+
+
+
+
+RenderStatsExporter::~RenderStatsExporter()
+{
+	m_quit = true;
+	wait();
+#ifndef LMMS_BUILD_WIN32
+	if( m_socket >= 0 )
+	{
+		close( m_socket );
+	}
+#endif
+}
+
+
+
+
+void RenderStatsExporter::run()
+{
+	while( !m_quit )
+	{
+		// the mixer doesn't wake up readers, that isn't real-time safe
+		msleep( Interval );
+
+		auto stats = m_reader.read_max( m_reader.read_space() );
+		// nothing new while the mixer is stopped
+		if( stats.size() == 0 )
+		{
+			continue;
+		}
+
+		float maximumLoad = 0;
+		for( std::size_t i = 0; i < stats.size(); ++i )
+		{
+			maximumLoad = qMax( maximumLoad, stats[i].load );
+		}
+		send( stats[stats.size() - 1], maximumLoad );
+	}
+}
+
+
+
+
+void RenderStatsExporter::send( const Mixer::RenderStats & _stats,
+							float _maximumLoad )
+{
+#ifndef LMMS_BUILD_WIN32
+	QByteArray message;
+	appendOscString( message, "/lmms/stats" );
+	appendOscString( message, ",sfiiiii" );
+	appendOscString( message, m_hostName );
+	appendOscFloat( message, _maximumLoad );
+	appendOscInt( message, _stats.voices );
+	appendOscInt( message, _stats.effects );
+	appendOscInt( message, _stats.jobs );
+	appendOscInt( message, _stats.memory / 1024 );
+	appendOscInt( message, _stats.memoryHighWater / 1024 );
+
+	// a lost message only means a gap in the monitoring
+	sendto( m_socket, message.constData(), message.size(), 0,
+		reinterpret_cast<const sockaddr *>( m_address.constData() ),
+							m_address.size() );
+#else
+	Q_UNUSED( _stats );
+	Q_UNUSED( _maximumLoad );
+#endif
+}
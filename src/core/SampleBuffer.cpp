@@ -29,7 +29,13 @@
 #include <QFile>
 #include <QFileInfo>
 #include <QMessageBox>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QPainter>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include <vector>
 
 
 #include <sndfile.h>
@@ -55,6 +61,11 @@
 #include "Engine.h"
 #include "GuiApplication.h"
 #include "Mixer.h"
+#include "SampleCache.h"
+#include "SampleStream.h"
+#include "ScratchArena.h"
+#include "Song.h"
+#include "TimeStretch.h"
 
 #include "FileDialog.h"
 
@@ -65,6 +76,13 @@ SampleBuffer::SampleBuffer() :
 	m_origData( NULL ),
 	m_origFrames( 0 ),
 	m_data( NULL ),
+	m_dataShared( false ),
+	m_streamingEnabled( false ),
+	m_eagerStreaming( false ),
+	m_stream( NULL ),
+	m_compactEnabled( false ),
+	m_compactData( NULL ),
+	m_compactShared( false ),
 	m_frames( 0 ),
 	m_startFrame( 0 ),
 	m_endFrame( 0 ),
@@ -73,7 +91,11 @@ SampleBuffer::SampleBuffer() :
 	m_amplification( 1.0f ),
 	m_reversed( false ),
 	m_frequency( BaseFreq ),
-	m_sampleRate( mixerSampleRate () )
+	m_sampleRate( mixerSampleRate () ),
+	m_backgroundDecoding( false ),
+	m_stretchSpeed( 1.0 ),
+	m_stretchSemitones( 0 ),
+	m_stretched( NULL )
 {
 
 	connect( Engine::mixer(), SIGNAL( sampleRateChanged() ), this, SLOT( sampleRateChanged() ) );
@@ -105,7 +127,7 @@ SampleBuffer::SampleBuffer( const sampleFrame * _data, const f_cnt_t _frames )
 {
 	if( _frames > 0 )
 	{
-		m_origData = MM_ALLOC( sampleFrame, _frames );
+		m_origData = MM_ALLOC_TAGGED( sampleFrame, _frames, SampleBuffers );
 		memcpy( m_origData, _data, _frames * BYTES_PER_FRAME );
 		m_origFrames = _frames;
 		update();
@@ -120,7 +142,7 @@ SampleBuffer::SampleBuffer( const f_cnt_t _frames )
 {
 	if( _frames > 0 )
 	{
-		m_origData = MM_ALLOC( sampleFrame, _frames );
+		m_origData = MM_ALLOC_TAGGED( sampleFrame, _frames, SampleBuffers );
 		memset( m_origData, 0, _frames * BYTES_PER_FRAME );
 		m_origFrames = _frames;
 		update();
@@ -132,14 +154,113 @@ SampleBuffer::SampleBuffer( const f_cnt_t _frames )
 
 SampleBuffer::~SampleBuffer()
 {
+	cancelDecoding();
+	cancelStretching();
+	if( m_stretched )
+	{
+		sharedObject::unref( m_stretched );
+	}
 	MM_FREE( m_origData );
-	MM_FREE( m_data );
+	freeData();
+	freeCompactData();
+	delete m_stream;
+}
+
+
+
+
+void SampleBuffer::freeData()
+{
+	if( m_dataShared )
+	{
+		SampleCache::release( m_data );
+	}
+	else
+	{
+		MM_FREE( m_data );
+	}
+	m_data = NULL;
+	m_dataShared = false;
+}
+
+
+
+
+void SampleBuffer::freeCompactData()
+{
+	if( m_compactShared )
+	{
+		SampleCache::release( m_compactData );
+	}
+	else
+	{
+		MM_FREE( m_compactData );
+	}
+	m_compactData = NULL;
+	m_compactShared = false;
+}
+
+
+
+
+void SampleBuffer::compactData()
+{
+	m_compactData = MM_ALLOC_TAGGED( qint16, m_frames * DEFAULT_CHANNELS,
+								SampleBuffers );
+	const sample_t * src = m_data[0];
+	for( f_cnt_t i = 0; i < m_frames * DEFAULT_CHANNELS; ++i )
+	{
+		// resampling may overshoot a bit
+		m_compactData[i] = static_cast<qint16>( lrintf(
+			qBound( -1.0f, src[i], 1.0f ) * OUTPUT_SAMPLE_MULTIPLIER ) );
+	}
+
+	freeData();
+	m_data = MM_ALLOC_TAGGED( sampleFrame, 1, SampleBuffers );
+	memset( m_data, 0, sizeof( *m_data ) );
+}
+
+
+
+void SampleBuffer::buildPeaks()
+{
+	const void * data = m_compactData != NULL ?
+			static_cast<const void *>( m_compactData ) : m_data;
+	const bool shared = m_compactData != NULL ? m_compactShared :
+								m_dataShared;
+	if( shared && ( m_peaks = SampleCache::peaks( data ) ) )
+	{
+		return;
+	}
+
+	if( m_compactData != NULL )
+	{
+		m_peaks = std::make_shared<SamplePeaks>( m_compactData,
+								m_frames );
+	}
+	else
+	{
+		m_peaks = std::make_shared<SamplePeaks>( m_data, m_frames );
+	}
+	if( shared )
+	{
+		SampleCache::setPeaks( data, m_peaks );
+	}
 }
 
 
 
+
 void SampleBuffer::sampleRateChanged()
 {
+	// the old data plays at the right pitch meanwhile, see play(), so
+	// files don't hold up switching the rate
+	if( m_data != NULL && !m_audioFile.isEmpty() )
+	{
+		cancelDecoding();
+		decodeInBackground( true );
+		return;
+	}
 	update( true );
 }
 
@@ -149,26 +270,561 @@ sample_rate_t SampleBuffer::mixerSampleRate()
 }
 
 
+// File size and sample length limits
+static const int fileSizeMax = 300; // MB
+static const int sampleLengthMax = 90; // Minutes
+// longer files are streamed from disk if the buffer allows for it
+static const int streamingLengthMin = 10; // Minutes
+
+
 void SampleBuffer::update( bool _keep_settings )
 {
-	const bool lock = ( m_data != NULL );
-	if( lock )
+	// what's being decoded in the background is outdated now
+	cancelDecoding();
+	if( m_backgroundDecoding && !_keep_settings && m_data != NULL &&
+			!m_audioFile.isEmpty() && gui != NULL &&
+				Engine::getSong()->isLoadingProject() )
 	{
+		decodeInBackground();
+		return;
+	}
+
+	bool fileLoadError;
+	if( m_data == NULL )
+	{
+		// nobody can be using our data yet
+		fileLoadError = !decode( _keep_settings );
+	}
+	else
+	{
+		// Decode into a scratch buffer first, so the audio thread only
+		// has to wait for swapping in the result and not for decoding
+		// and resampling the whole file.
+		SampleBuffer scratch;
+		MM_FREE( scratch.m_data );
+		scratch.m_data = NULL;
+		scratch.m_audioFile = m_audioFile;
+		scratch.m_streamingEnabled = m_streamingEnabled;
+		scratch.m_eagerStreaming = m_eagerStreaming;
+		scratch.m_compactEnabled = m_compactEnabled;
+		// borrowed, see below
+		scratch.m_origData = m_origData;
+		scratch.m_origFrames = m_origFrames;
+		scratch.m_frames = m_frames;
+		scratch.m_startFrame = m_startFrame;
+		scratch.m_endFrame = m_endFrame;
+		scratch.m_loopStartFrame = m_loopStartFrame;
+		scratch.m_loopEndFrame = m_loopEndFrame;
+		scratch.m_sampleRate = m_sampleRate;
+		scratch.m_amplification = m_amplification;
+		scratch.m_reversed = m_reversed;
+
+		fileLoadError = !scratch.decode( _keep_settings );
+		scratch.m_origData = NULL;
+
 		Engine::mixer()->requestChangeInModel();
 		m_varLock.lockForWrite();
-		MM_FREE( m_data );
+		std::swap( m_data, scratch.m_data );
+		std::swap( m_dataShared, scratch.m_dataShared );
+		std::swap( m_compactData, scratch.m_compactData );
+		std::swap( m_compactShared, scratch.m_compactShared );
+		std::swap( m_peaks, scratch.m_peaks );
+		std::swap( m_stream, scratch.m_stream );
+		m_frames = scratch.m_frames;
+		m_startFrame = scratch.m_startFrame;
+		m_endFrame = scratch.m_endFrame;
+		m_loopStartFrame = scratch.m_loopStartFrame;
+		m_loopEndFrame = scratch.m_loopEndFrame;
+		m_sampleRate = scratch.m_sampleRate;
+		m_varLock.unlock();
+		Engine::mixer()->doneChangeInModel();
+
+		// scratch frees the old data when going out of scope
+	}
+
+	emit sampleUpdated();
+	updateStretched();
+
+	if( fileLoadError )
+	{
+		reportLoadError();
+	}
+}
+
+
+
+
+void SampleBuffer::reportLoadError()
+{
+	QString title = tr( "Fail to open file" );
+	QString message = tr( "Audio files are limited to %1 MB "
+			"in size and %2 minutes of playing time"
+			).arg( fileSizeMax ).arg( sampleLengthMax );
+	if( gui )
+	{
+		QMessageBox::information( NULL,
+			title, message,	QMessageBox::Ok );
+	}
+	else
+	{
+		fprintf( stderr, "%s\n", message.toUtf8().constData() );
+	}
+}
+
+
+
+
+struct SampleBuffer::DecodeJob
+{
+	QMutex mutex;
+	// NULL once the buffer doesn't wait for the result anymore, whoever
+	// sees the other side done frees the result then
+	SampleBuffer * target;
+	SampleBuffer * result;
+	bool keepSettings;
+	bool done;
+	bool loadError;
+} ;
+
+
+
+
+class SampleBuffer::DecodeTask : public QRunnable
+{
+public:
+	DecodeTask( const std::shared_ptr<DecodeJob> & _job ) :
+		m_job( _job )
+	{
+	}
+
+	void run() override
+	{
+		const bool loaded = m_job->result->decode( m_job->keepSettings );
+
+		QMutexLocker lock( &m_job->mutex );
+		m_job->done = true;
+		m_job->loadError = !loaded;
+		if( m_job->target )
+		{
+			// the buffer can't be deleted while we hold the mutex and
+			// the call is dropped if it's deleted before it's made
+			QMetaObject::invokeMethod( m_job->target, "finishDecoding",
+							Qt::QueuedConnection );
+		}
+		else
+		{
+			sharedObject::unref( m_job->result );
+			m_job->result = NULL;
+		}
+	}
+
+private:
+	std::shared_ptr<DecodeJob> m_job;
+} ;
+
+
+
+
+// the buffers decoding in the background and the threads decoding for
+// them, GUI thread only
+static QList<SampleBuffer *> s_decoding;
+
+static QThreadPool & decodePool()
+{
+	static QThreadPool pool;
+	return pool;
+}
+
+
+
+
+void SampleBuffer::decodeInBackground( bool _keep_settings )
+{
+	// decoded into like the scratch buffer of update()
+	SampleBuffer * result = new SampleBuffer;
+	MM_FREE( result->m_data );
+	result->m_data = NULL;
+	result->m_audioFile = m_audioFile;
+	result->m_streamingEnabled = m_streamingEnabled;
+	result->m_eagerStreaming = m_eagerStreaming;
+	result->m_compactEnabled = m_compactEnabled;
+	result->m_reversed = m_reversed;
+	if( _keep_settings )
+	{
+		// from the file again instead of from m_origData, which isn't
+		// ours to read on another thread
+		result->m_frames = m_frames;
+		result->m_startFrame = m_startFrame;
+		result->m_endFrame = m_endFrame;
+		result->m_loopStartFrame = m_loopStartFrame;
+		result->m_loopEndFrame = m_loopEndFrame;
+		result->m_sampleRate = m_sampleRate;
+		result->m_amplification = m_amplification;
+	}
+
+	m_decodeJob = std::make_shared<DecodeJob>();
+	m_decodeJob->target = this;
+	m_decodeJob->result = result;
+	m_decodeJob->keepSettings = _keep_settings;
+	m_decodeJob->done = false;
+	m_decodeJob->loadError = false;
+	s_decoding.push_back( this );
+	decodePool().start( new DecodeTask( m_decodeJob ) );
+}
+
+
+
+
+void SampleBuffer::cancelDecoding()
+{
+	if( !m_decodeJob )
+	{
+		return;
+	}
+
+	QMutexLocker lock( &m_decodeJob->mutex );
+	m_decodeJob->target = NULL;
+	if( m_decodeJob->done && m_decodeJob->result )
+	{
+		sharedObject::unref( m_decodeJob->result );
+		m_decodeJob->result = NULL;
+	}
+	lock.unlock();
+
+	m_decodeJob.reset();
+	s_decoding.removeOne( this );
+}
+
+
+
+
+void SampleBuffer::finishDecoding()
+{
+	if( !m_decodeJob )
+	{
+		// swapped in by waitForDecoding() already
+		return;
+	}
+
+	QMutexLocker lock( &m_decodeJob->mutex );
+	if( !m_decodeJob->done )
+	{
+		return;
+	}
+	SampleBuffer * result = m_decodeJob->result;
+	const bool keepSettings = m_decodeJob->keepSettings;
+	const bool loadError = m_decodeJob->loadError;
+	m_decodeJob->result = NULL;
+	lock.unlock();
+
+	m_decodeJob.reset();
+	s_decoding.removeOne( this );
+
+	// like update() does with its scratch buffer, the sample rate may
+	// have been set by the project meanwhile
+	Engine::mixer()->requestChangeInModel();
+	m_varLock.lockForWrite();
+	std::swap( m_data, result->m_data );
+	std::swap( m_dataShared, result->m_dataShared );
+	std::swap( m_compactData, result->m_compactData );
+	std::swap( m_compactShared, result->m_compactShared );
+	std::swap( m_peaks, result->m_peaks );
+	std::swap( m_stream, result->m_stream );
+	m_frames = result->m_frames;
+	m_startFrame = result->m_startFrame;
+	m_endFrame = result->m_endFrame;
+	m_loopStartFrame = result->m_loopStartFrame;
+	m_loopEndFrame = result->m_loopEndFrame;
+	if( keepSettings )
+	{
+		// resampled for the new rate
+		m_sampleRate = result->m_sampleRate;
+	}
+	m_varLock.unlock();
+	Engine::mixer()->doneChangeInModel();
+
+	// frees the old data
+	sharedObject::unref( result );
+
+	emit sampleUpdated();
+	updateStretched();
+
+	if( loadError )
+	{
+		reportLoadError();
 	}
+}
+
+
+
+
+void SampleBuffer::waitForDecoding()
+{
+	decodePool().waitForDone();
+	for( SampleBuffer * buffer : QList<SampleBuffer *>( s_decoding ) )
+	{
+		buffer->finishDecoding();
+	}
+}
+
+
+
+
+struct SampleBuffer::StretchJob
+{
+	QMutex mutex;
+	// NULL once the buffer doesn't wait for the result anymore, like with
+	// DecodeJob
+	SampleBuffer * target;
+	SampleBuffer * result;
+	// the frames to stretch, freed by the task
+	sampleFrame * input;
+	f_cnt_t frames;
+	sample_rate_t sampleRate;
+	double speed;
+	int semitones;
+	// whether the result goes into the SampleCache under key
+	bool cacheable;
+	SampleCache::Key key;
+	bool done;
+} ;
+
+
+
+
+class SampleBuffer::StretchTask : public QRunnable
+{
+public:
+	StretchTask( const std::shared_ptr<StretchJob> & _job ) :
+		m_job( _job )
+	{
+	}
+
+	void run() override
+	{
+		const f_cnt_t frames = TimeStretch::stretchedFrames(
+					m_job->frames, m_job->speed );
+		sampleFrame * data = TimeStretch::process( m_job->input,
+					m_job->frames, m_job->speed,
+					m_job->semitones, m_job->sampleRate );
+		MM_FREE( m_job->input );
+		m_job->input = NULL;
+		if( m_job->cacheable )
+		{
+			data = SampleCache::insert( m_job->key, data, frames );
+		}
+		m_job->result->adoptData( data, frames, m_job->cacheable );
+
+		QMutexLocker lock( &m_job->mutex );
+		m_job->done = true;
+		if( m_job->target )
+		{
+			QMetaObject::invokeMethod( m_job->target,
+				"finishStretching", Qt::QueuedConnection );
+		}
+		else
+		{
+			sharedObject::unref( m_job->result );
+			m_job->result = NULL;
+		}
+	}
+
+private:
+	std::shared_ptr<StretchJob> m_job;
+} ;
+
+
+
+
+// stretching is slower than decoding, it gets threads of its own so it
+// doesn't hold up loading projects
+static QThreadPool & stretchPool()
+{
+	static QThreadPool pool;
+	return pool;
+}
+
+
+
+
+void SampleBuffer::setStretch( double _speed, int _semitones )
+{
+	if( _speed == m_stretchSpeed && _semitones == m_stretchSemitones )
+	{
+		return;
+	}
+	m_stretchSpeed = _speed;
+	m_stretchSemitones = _semitones;
+	updateStretched();
+}
+
+
+
+
+void SampleBuffer::updateStretched()
+{
+	cancelStretching();
+	if( m_stretchSpeed == 1.0 && m_stretchSemitones == 0 && !m_stretched )
+	{
+		return;
+	}
+
+	// what's stretched is outdated now, played as it is meanwhile
+	setStretched( NULL );
+	if( ( m_stretchSpeed == 1.0 && m_stretchSemitones == 0 ) ||
+						m_stream || m_frames <= 1 )
+	{
+		emit stretchUpdated();
+		return;
+	}
+
+	SampleBuffer * result = new SampleBuffer;
+	// it's stretched again for the new rate by this buffer
+	disconnect( Engine::mixer(), SIGNAL( sampleRateChanged() ),
+					result, SLOT( sampleRateChanged() ) );
+	result->m_sampleRate = m_sampleRate;
+	result->m_amplification = m_amplification;
+
+	// only the data decoded from a file is known to the SampleCache
+	SampleCache::Key key = SampleCache::Key();
+	const bool cacheable = !m_audioFile.isEmpty() &&
+					( m_dataShared || m_compactShared );
+	if( cacheable )
+	{
+		key = cacheKey( QFileInfo( tryToMakeAbsolute( m_audioFile ) ) );
+		key.speed = m_stretchSpeed;
+		key.semitones = m_stretchSemitones;
+
+		f_cnt_t frames = 0;
+		if( sampleFrame * cached = SampleCache::acquire( key, frames ) )
+		{
+			result->adoptData( cached, frames, true );
+			setStretched( result );
+			emit stretchUpdated();
+			return;
+		}
+	}
+
+	m_stretchJob = std::make_shared<StretchJob>();
+	m_stretchJob->target = this;
+	m_stretchJob->result = result;
+	// copied as the data isn't ours to read on another thread, which
+	// also converts compact data
+	m_stretchJob->input = MM_ALLOC_TAGGED( sampleFrame, m_frames,
+							SampleBuffers );
+	copyFrames( m_stretchJob->input, 0, m_frames );
+	m_stretchJob->frames = m_frames;
+	m_stretchJob->sampleRate = m_sampleRate;
+	m_stretchJob->speed = m_stretchSpeed;
+	m_stretchJob->semitones = m_stretchSemitones;
+	m_stretchJob->cacheable = cacheable;
+	m_stretchJob->key = key;
+	m_stretchJob->done = false;
+	stretchPool().start( new StretchTask( m_stretchJob ) );
+}
+
 
-	// File size and sample length limits
-	const int fileSizeMax = 300; // MB
-	const int sampleLengthMax = 90; // Minutes
 
+
+void SampleBuffer::cancelStretching()
+{
+	if( !m_stretchJob )
+	{
+		return;
+	}
+
+	QMutexLocker lock( &m_stretchJob->mutex );
+	m_stretchJob->target = NULL;
+	if( m_stretchJob->done && m_stretchJob->result )
+	{
+		sharedObject::unref( m_stretchJob->result );
+		m_stretchJob->result = NULL;
+	}
+	lock.unlock();
+
+	m_stretchJob.reset();
+}
+
+
+
+
+void SampleBuffer::finishStretching()
+{
+	if( !m_stretchJob )
+	{
+		return;
+	}
+
+	QMutexLocker lock( &m_stretchJob->mutex );
+	if( !m_stretchJob->done )
+	{
+		return;
+	}
+	SampleBuffer * result = m_stretchJob->result;
+	m_stretchJob->result = NULL;
+	lock.unlock();
+	m_stretchJob.reset();
+
+	setStretched( result );
+	emit stretchUpdated();
+}
+
+
+
+
+void SampleBuffer::setStretched( SampleBuffer * _stretched )
+{
+	// the mixer picks it up when sample clips start playing
+	Engine::mixer()->requestChangeInModel();
+	SampleBuffer * old = m_stretched;
+	m_stretched = _stretched;
+	Engine::mixer()->doneChangeInModel();
+
+	if( old )
+	{
+		sharedObject::unref( old );
+	}
+}
+
+
+
+
+void SampleBuffer::adoptData( sampleFrame * _data, f_cnt_t _frames,
+								bool _shared )
+{
+	freeData();
+	freeCompactData();
+	m_data = _data;
+	m_dataShared = _shared;
+	m_frames = _frames;
+	m_loopStartFrame = m_startFrame = 0;
+	m_loopEndFrame = m_endFrame = _frames;
+	buildPeaks();
+}
+
+
+
+
+SampleCache::Key SampleBuffer::cacheKey( const QFileInfo & _file ) const
+{
+	const SampleCache::Key key = { _file.absoluteFilePath(),
+				_file.lastModified().toMSecsSinceEpoch(),
+				mixerSampleRate(), m_reversed, 0, 0 };
+	return key;
+}
+
+
+
+
+bool SampleBuffer::decode( bool _keep_settings )
+{
 	bool fileLoadError = false;
+	m_peaks.reset();
 	if( m_audioFile.isEmpty() && m_origData != NULL && m_origFrames > 0 )
 	{
 		// TODO: reverse- and amplification-property is not covered
 		// by following code...
-		m_data = MM_ALLOC( sampleFrame, m_origFrames );
+		m_data = MM_ALLOC_TAGGED( sampleFrame, m_origFrames, SampleBuffers );
 		memcpy( m_data, m_origData, m_origFrames * BYTES_PER_FRAME );
 		if( _keep_settings == false )
 		{
@@ -185,8 +841,40 @@ void SampleBuffer::update( bool _keep_settings )
 		ch_cnt_t channels = DEFAULT_CHANNELS;
 		sample_rate_t samplerate = mixerSampleRate();
 		m_frames = 0;
+		// whether the file has no more than 16 bit resolution
+		bool sixteenBit = false;
 
 		const QFileInfo fileInfo( file );
+
+		// another buffer may have decoded the file already
+		const SampleCache::Key key = cacheKey( fileInfo );
+		f_cnt_t cachedFrames = 0;
+		if( sampleFrame * cached = SampleCache::acquire( key, cachedFrames ) )
+		{
+			m_data = cached;
+			m_dataShared = true;
+			m_frames = cachedFrames;
+			// only updates the frame variables
+			normalizeSampleRate( mixerSampleRate(), _keep_settings );
+			buildPeaks();
+			return true;
+		}
+		if( m_compactEnabled )
+		{
+			if( qint16 * cached = SampleCache::acquireCompact( key,
+								cachedFrames ) )
+			{
+				m_compactData = cached;
+				m_compactShared = true;
+				m_data = MM_ALLOC_TAGGED( sampleFrame, 1, SampleBuffers );
+				memset( m_data, 0, sizeof( *m_data ) );
+				m_frames = cachedFrames;
+				normalizeSampleRate( mixerSampleRate(), _keep_settings );
+				buildPeaks();
+				return true;
+			}
+		}
+
 		if( fileInfo.size() > fileSizeMax * 1024 * 1024 )
 		{
 			fileLoadError = true;
@@ -203,7 +891,15 @@ void SampleBuffer::update( bool _keep_settings )
 			{
 				f_cnt_t frames = sf_info.frames;
 				int rate = sf_info.samplerate;
-				if( frames / rate > sampleLengthMax * 60 )
+				const int subtype = sf_info.format & SF_FORMAT_SUBMASK;
+				sixteenBit = subtype == SF_FORMAT_PCM_S8 ||
+						subtype == SF_FORMAT_PCM_U8 ||
+						subtype == SF_FORMAT_PCM_16;
+				const int lengthMax = !m_streamingEnabled ?
+						sampleLengthMax * 60 :
+					m_eagerStreaming ? SampleStream::HeadSeconds :
+						streamingLengthMin * 60;
+				if( frames / rate > lengthMax )
 				{
 					fileLoadError = true;
 				}
@@ -212,6 +908,23 @@ void SampleBuffer::update( bool _keep_settings )
 			f.close();
 		}
 
+		if( fileLoadError && m_streamingEnabled )
+		{
+			SampleStream * stream = new SampleStream( file,
+							mixerSampleRate() );
+			if( stream->isValid() )
+			{
+				m_stream = stream;
+				m_data = MM_ALLOC_TAGGED( sampleFrame, 1, SampleBuffers );
+				memset( m_data, 0, sizeof( *m_data ) );
+				m_frames = stream->frames();
+				// the stream is resampled already
+				normalizeSampleRate( mixerSampleRate(), _keep_settings );
+				return true;
+			}
+			delete stream;
+		}
+
 		if( !fileLoadError )
 		{
 #ifdef LMMS_HAVE_OGGVORBIS
@@ -221,6 +934,7 @@ void SampleBuffer::update( bool _keep_settings )
 			if( m_frames == 0 && fileInfo.suffix() == "ogg" )
 			{
 				m_frames = decodeSampleOGGVorbis( file, buf, channels, samplerate );
+				sixteenBit = m_frames > 0;
 			}
 #endif
 			if( m_frames == 0 )
@@ -233,12 +947,14 @@ void SampleBuffer::update( bool _keep_settings )
 			{
 				m_frames = decodeSampleOGGVorbis( file, buf, channels,
 									samplerate );
+				sixteenBit = m_frames > 0;
 			}
 #endif
 			if( m_frames == 0 )
 			{
 				m_frames = decodeSampleDS( file, buf, channels,
 									samplerate );
+				sixteenBit = m_frames > 0;
 			}
 		}
 
@@ -246,7 +962,7 @@ void SampleBuffer::update( bool _keep_settings )
 		{
 			// sample couldn't be decoded, create buffer containing
 			// one sample-frame
-			m_data = MM_ALLOC( sampleFrame, 1 );
+			m_data = MM_ALLOC_TAGGED( sampleFrame, 1, SampleBuffers );
 			memset( m_data, 0, sizeof( *m_data ) );
 			m_frames = 1;
 			m_loopStartFrame = m_startFrame = 0;
@@ -255,43 +971,34 @@ void SampleBuffer::update( bool _keep_settings )
 		else // otherwise normalize sample rate
 		{
 			normalizeSampleRate( samplerate, _keep_settings );
+			if( m_compactEnabled && sixteenBit )
+			{
+				compactData();
+				m_compactData = SampleCache::insertCompact( key,
+							m_compactData, m_frames );
+				m_compactShared = true;
+			}
+			else
+			{
+				m_data = SampleCache::insert( key, m_data, m_frames );
+				m_dataShared = true;
+			}
+			// while still on the thread decoding in the background
+			buildPeaks();
 		}
 	}
 	else
 	{
 		// neither an audio-file nor a buffer to copy from, so create
 		// buffer containing one sample-frame
-		m_data = MM_ALLOC( sampleFrame, 1 );
+		m_data = MM_ALLOC_TAGGED( sampleFrame, 1, SampleBuffers );
 		memset( m_data, 0, sizeof( *m_data ) );
 		m_frames = 1;
 		m_loopStartFrame = m_startFrame = 0;
 		m_loopEndFrame = m_endFrame = 1;
 	}
 
-	if( lock )
-	{
-		m_varLock.unlock();
-		Engine::mixer()->doneChangeInModel();
-	}
-
-	emit sampleUpdated();
-
-	if( fileLoadError )
-	{
-		QString title = tr( "Fail to open file" );
-		QString message = tr( "Audio files are limited to %1 MB "
-				"in size and %2 minutes of playing time"
-				).arg( fileSizeMax ).arg( sampleLengthMax );
-		if( gui )
-		{
-			QMessageBox::information( NULL,
-				title, message,	QMessageBox::Ok );
-		}
-		else
-		{
-			fprintf( stderr, "%s\n", message.toUtf8().constData() );
-		}
-	}
+	return !fileLoadError;
 }
 
 
@@ -300,7 +1007,7 @@ void SampleBuffer::convertIntToFloat ( int_sample_t * & _ibuf, f_cnt_t _frames,
 	// following code transforms int-samples into
 	// float-samples and does amplifying & reversing
 	const float fac = 1 / OUTPUT_SAMPLE_MULTIPLIER;
-	m_data = MM_ALLOC( sampleFrame, _frames );
+	m_data = MM_ALLOC_TAGGED( sampleFrame, _frames, SampleBuffers );
 	const int ch = ( _channels > 1 ) ? 1 : 0;
 
 	// if reversing is on, we also reverse when
@@ -335,7 +1042,7 @@ void SampleBuffer::directFloatWrite ( sample_t * & _fbuf, f_cnt_t _frames, int _
 
 {
 
-	m_data = MM_ALLOC( sampleFrame, _frames );
+	m_data = MM_ALLOC_TAGGED( sampleFrame, _frames, SampleBuffers );
 	const int ch = ( _channels > 1 ) ? 1 : 0;
 
 	// if reversing is on, we also reverse when
@@ -378,9 +1085,9 @@ void SampleBuffer::normalizeSampleRate( const sample_rate_t _src_sr,
 					mixerSampleRate() );
 
 		m_sampleRate = mixerSampleRate();
-		MM_FREE( m_data );
+		freeData();
 		m_frames = resampled->frames();
-		m_data = MM_ALLOC( sampleFrame, m_frames );
+		m_data = MM_ALLOC_TAGGED( sampleFrame, m_frames, SampleBuffers );
 		memcpy( m_data, resampled->data(), m_frames *
 							sizeof( sampleFrame ) );
 		delete resampled;
@@ -683,51 +1390,76 @@ bool SampleBuffer::play( sampleFrame * _ab, handleState * _state,
 		play_frame = getPingPongIndex( play_frame, loopStartFrame, loopEndFrame );
 	}
 
-	f_cnt_t fragment_size = (f_cnt_t)( _frames * freq_factor ) + MARGIN[ _state->interpolationMode() ];
+	// switch to linear interpolation while the mixer is overloaded
+	const bool cheap = _state->m_cheapResamplingData != NULL &&
+		( Engine::mixer()->overloadMeasures() & Mixer::CheapInterpolation );
+	if( cheap != _state->m_usingCheapResampling )
+	{
+		_state->m_usingCheapResampling = cheap;
+		src_reset( cheap ? _state->m_cheapResamplingData :
+						_state->m_resamplingData );
+	}
+	SRC_STATE * resamplingData = cheap ? _state->m_cheapResamplingData :
+						_state->m_resamplingData;
 
-	sampleFrame * tmp = NULL;
+	f_cnt_t fragment_size = (f_cnt_t)( _frames * freq_factor ) +
+		MARGIN[ cheap ? SRC_LINEAR : _state->interpolationMode() ];
 
 	// check whether we have to change pitch...
 	if( freq_factor != 1.0 || _state->m_varyingPitch )
 	{
-		SRC_DATA src_data;
+		// for the fragment if it crosses the loop or end
+		ScratchBuffer<sampleFrame> tmp( fragment_size );
+
 		// Generate output
-		src_data.data_in =
-			getSampleFragment( play_frame, fragment_size, _loopmode, &tmp, &is_backwards,
-			loopStartFrame, loopEndFrame, endFrame )[0];
-		src_data.data_out = _ab[0];
-		src_data.input_frames = fragment_size;
-		src_data.output_frames = _frames;
-		src_data.src_ratio = 1.0 / freq_factor;
-		src_data.end_of_input = 0;
-		int error = src_process( _state->m_resamplingData,
-								&src_data );
-		if( error )
+		const sampleFrame * fragment =
+			getSampleFragment( play_frame, fragment_size, _loopmode, tmp.data(), &is_backwards,
+			loopStartFrame, loopEndFrame, endFrame );
+		f_cnt_t frames_used;
+		if( _state->m_polyphaseResampler != NULL )
 		{
-			printf( "SampleBuffer: error while resampling: %s\n",
-							src_strerror( error ) );
+			frames_used = _state->m_polyphaseResampler->process(
+					fragment, fragment_size, _ab, _frames,
+							1.0 / freq_factor );
 		}
-		if( src_data.output_frames_gen > _frames )
+		else
 		{
-			printf( "SampleBuffer: not enough frames: %ld / %d\n",
-					src_data.output_frames_gen, _frames );
+			SRC_DATA src_data;
+			src_data.data_in = fragment[0];
+			src_data.data_out = _ab[0];
+			src_data.input_frames = fragment_size;
+			src_data.output_frames = _frames;
+			src_data.src_ratio = 1.0 / freq_factor;
+			src_data.end_of_input = 0;
+			int error = src_process( resamplingData, &src_data );
+			if( error )
+			{
+				printf( "SampleBuffer: error while resampling: %s\n",
+								src_strerror( error ) );
+			}
+			if( src_data.output_frames_gen > _frames )
+			{
+				printf( "SampleBuffer: not enough frames: %ld / %d\n",
+						src_data.output_frames_gen, _frames );
+			}
+			frames_used = src_data.input_frames_used;
 		}
 		// Advance
 		switch( _loopmode )
 		{
 			case LoopOff:
-				play_frame += src_data.input_frames_used;
+				play_frame += frames_used;
 				break;
 			case LoopOn:
-				play_frame += src_data.input_frames_used;
+				play_frame += frames_used;
 				play_frame = getLoopedIndex( play_frame, loopStartFrame, loopEndFrame );
 				break;
 			case LoopPingPong:
 			{
-				f_cnt_t left = src_data.input_frames_used;
+				f_cnt_t left = frames_used;
 				if( _state->isBackwards() )
 				{
-					play_frame -= src_data.input_frames_used;
+					play_frame -= frames_used;
 					if( play_frame < loopStartFrame )
 					{
 						left -= ( loopStartFrame - play_frame );
@@ -746,9 +1478,11 @@ bool SampleBuffer::play( sampleFrame * _ab, handleState * _state,
 		// we don't have to pitch, so we just copy the sample-data
 		// as is into pitched-copy-buffer
 
+		ScratchBuffer<sampleFrame> tmp( _frames );
+
 		// Generate output
 		memcpy( _ab,
-			getSampleFragment( play_frame, _frames, _loopmode, &tmp, &is_backwards,
+			getSampleFragment( play_frame, _frames, _loopmode, tmp.data(), &is_backwards,
 						loopStartFrame, loopEndFrame, endFrame ),
 						_frames * BYTES_PER_FRAME );
 		// Advance
@@ -781,11 +1515,6 @@ bool SampleBuffer::play( sampleFrame * _ab, handleState * _state,
 		}
 	}
 
-	if( tmp != NULL ) 
-	{
-		MM_FREE( tmp );
-	}
-
 	_state->setBackwards( is_backwards );
 	_state->setFrameIndex( play_frame );
 
@@ -801,50 +1530,85 @@ bool SampleBuffer::play( sampleFrame * _ab, handleState * _state,
 
 
 
+void SampleBuffer::cue( f_cnt_t _frame )
+{
+	if( m_stream )
+	{
+		m_stream->cue( _frame );
+	}
+}
+
+
+
+
 sampleFrame * SampleBuffer::getSampleFragment( f_cnt_t _index,
-		f_cnt_t _frames, LoopMode _loopmode, sampleFrame * * _tmp, bool * _backwards,
+		f_cnt_t _frames, LoopMode _loopmode, sampleFrame * _tmp, bool * _backwards,
 		f_cnt_t _loopstart, f_cnt_t _loopend, f_cnt_t _end ) const
 {
+	if( m_stream )
+	{
+		// streams only play forwards, ping-pong loops like normal ones
+		const f_cnt_t end = _loopmode == LoopOff ? _end : _loopend;
+		f_cnt_t index = _index;
+		f_cnt_t copied = 0;
+		while( copied < _frames )
+		{
+			if( index >= end )
+			{
+				if( _loopmode == LoopOff || _loopend <= _loopstart )
+				{
+					memset( _tmp + copied, 0,
+						( _frames - copied ) * BYTES_PER_FRAME );
+					break;
+				}
+				index = _loopstart;
+			}
+			const f_cnt_t count = qMin( _frames - copied, end - index );
+			m_stream->read( index, _tmp + copied, count );
+			copied += count;
+			index += count;
+		}
+		return _tmp;
+	}
+
 	if( _loopmode == LoopOff )
 	{
 		if( _index + _frames <= _end )
 		{
-			return m_data + _index;
+			return framesAt( _index, _frames, _tmp );
 		}
 	}
 	else if( _loopmode == LoopOn )
 	{
 		if( _index + _frames <= _loopend )
 		{
-			return m_data + _index;
+			return framesAt( _index, _frames, _tmp );
 		}
 	}
 	else
 	{
 		if( ! *_backwards && _index + _frames < _loopend )
 		{
-			return m_data + _index;
+			return framesAt( _index, _frames, _tmp );
 		}
 	}
 
-	*_tmp = MM_ALLOC( sampleFrame, _frames );
-
 	if( _loopmode == LoopOff )
 	{
 		f_cnt_t available = _end - _index;
-		memcpy( *_tmp, m_data + _index, available * BYTES_PER_FRAME );
-		memset( *_tmp + available, 0, ( _frames - available ) *
+		copyFrames( _tmp, _index, available );
+		memset( _tmp + available, 0, ( _frames - available ) *
 							BYTES_PER_FRAME );
 	}
 	else if( _loopmode == LoopOn )
 	{
 		f_cnt_t copied = qMin( _frames, _loopend - _index );
-		memcpy( *_tmp, m_data + _index, copied * BYTES_PER_FRAME );
+		copyFrames( _tmp, _index, copied );
 		f_cnt_t loop_frames = _loopend - _loopstart;
 		while( copied < _frames )
 		{
 			f_cnt_t todo = qMin( _frames - copied, loop_frames );
-			memcpy( *_tmp + copied, m_data + _loopstart, todo * BYTES_PER_FRAME );
+			copyFrames( _tmp + copied, _loopstart, todo );
 			copied += todo;
 		}
 	}
@@ -860,18 +1624,14 @@ sampleFrame * SampleBuffer::getSampleFragment( f_cnt_t _index,
 		if( backwards )
 		{
 			copied = qMin( _frames, pos - _loopstart );
-			for( int i=0; i < copied; i++ )
-			{
-				(*_tmp)[i][0] = m_data[ pos - i ][0];
-				(*_tmp)[i][1] = m_data[ pos - i ][1];
-			}
+			copyFramesBackwards( _tmp, pos, copied );
 			pos -= copied;
 			if( pos == _loopstart ) backwards = false;
 		}
 		else
 		{
 			copied = qMin( _frames, _loopend - pos );
-			memcpy( *_tmp, m_data + pos, copied * BYTES_PER_FRAME );
+			copyFrames( _tmp, pos, copied );
 			pos += copied;
 			if( pos == _loopend ) backwards = true;
 		}
@@ -881,11 +1641,7 @@ sampleFrame * SampleBuffer::getSampleFragment( f_cnt_t _index,
 			if( backwards )
 			{
 				f_cnt_t todo = qMin( _frames - copied, pos - _loopstart );
-				for ( int i=0; i < todo; i++ )
-				{
-					(*_tmp)[ copied + i ][0] = m_data[ pos - i ][0];
-					(*_tmp)[ copied + i ][1] = m_data[ pos - i ][1];
-				}
+				copyFramesBackwards( _tmp + copied, pos, todo );
 				pos -= todo;
 				copied += todo;
 				if( pos <= _loopstart ) backwards = false;
@@ -893,7 +1649,7 @@ sampleFrame * SampleBuffer::getSampleFragment( f_cnt_t _index,
 			else
 			{
 				f_cnt_t todo = qMin( _frames - copied, _loopend - pos );
-				memcpy( *_tmp + copied, m_data + pos, todo * BYTES_PER_FRAME );
+				copyFrames( _tmp + copied, pos, todo );
 				pos += todo;
 				copied += todo;
 				if( pos >= _loopend ) backwards = true;
@@ -902,7 +1658,68 @@ sampleFrame * SampleBuffer::getSampleFragment( f_cnt_t _index,
 		*_backwards = backwards;
 	}
 
-	return *_tmp;
+	return _tmp;
+}
+
+
+
+
+sampleFrame * SampleBuffer::framesAt( f_cnt_t _index, f_cnt_t _frames,
+						sampleFrame * _tmp ) const
+{
+	if( m_compactData == NULL )
+	{
+		return m_data + _index;
+	}
+	copyFrames( _tmp, _index, _frames );
+	return _tmp;
+}
+
+
+
+
+void SampleBuffer::copyFrames( sampleFrame * _dst, f_cnt_t _index,
+						f_cnt_t _frames ) const
+{
+	if( m_compactData == NULL )
+	{
+		memcpy( _dst, m_data + _index, _frames * BYTES_PER_FRAME );
+		return;
+	}
+
+	// a plain loop over the interleaved samples gets vectorized
+	const float fac = 1 / OUTPUT_SAMPLE_MULTIPLIER;
+	const qint16 * src = m_compactData + _index * DEFAULT_CHANNELS;
+	sample_t * dst = _dst[0];
+	for( f_cnt_t i = 0; i < _frames * DEFAULT_CHANNELS; ++i )
+	{
+		dst[i] = src[i] * fac;
+	}
+}
+
+
+
+
+void SampleBuffer::copyFramesBackwards( sampleFrame * _dst, f_cnt_t _index,
+						f_cnt_t _frames ) const
+{
+	if( m_compactData == NULL )
+	{
+		for( f_cnt_t i = 0; i < _frames; ++i )
+		{
+			_dst[i][0] = m_data[_index - i][0];
+			_dst[i][1] = m_data[_index - i][1];
+		}
+		return;
+	}
+
+	const float fac = 1 / OUTPUT_SAMPLE_MULTIPLIER;
+	const qint16 * src = m_compactData + _index * DEFAULT_CHANNELS;
+	for( f_cnt_t i = 0; i < _frames; ++i )
+	{
+		_dst[i][0] = src[-i * DEFAULT_CHANNELS] * fac;
+		_dst[i][1] = src[-i * DEFAULT_CHANNELS + 1] * fac;
+	}
 }
 
 
@@ -934,41 +1751,130 @@ f_cnt_t SampleBuffer::getPingPongIndex( f_cnt_t _index, f_cnt_t _startf, f_cnt_t
 }
 
 
+void SampleBuffer::peakRange( f_cnt_t _begin, f_cnt_t _end, float * _min,
+							float * _max ) const
+{
+	if( m_stream )
+	{
+		// the stream has the magnitude of each block, drawn upwards
+		// for the left channel and downwards for the right one
+		float left;
+		float right;
+		m_stream->peak( _begin, left, right );
+		_min[0] = 0;
+		_max[0] = left;
+		_min[1] = -right;
+		_max[1] = 0;
+		return;
+	}
+	if( m_peaks && _end - _begin >= SamplePeaks::BaseBucket )
+	{
+		m_peaks->range( _begin, _end, _min, _max );
+		return;
+	}
+
+	// less than a bucket, from the frames themselves
+	for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+	{
+		_min[ch] = 1;
+		_max[ch] = -1;
+	}
+	for( f_cnt_t frame = _begin; frame < _end; ++frame )
+	{
+		for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+		{
+			const float value = m_compactData ?
+				m_compactData[frame * DEFAULT_CHANNELS + ch] /
+						OUTPUT_SAMPLE_MULTIPLIER :
+				m_data[frame][ch];
+			_min[ch] = qMin( _min[ch], value );
+			_max[ch] = qMax( _max[ch], value );
+		}
+	}
+}
+
+
+
+
 void SampleBuffer::visualize( QPainter & _p, const QRect & _dr,
 							const QRect & _clip, f_cnt_t _from_frame, f_cnt_t _to_frame )
 {
-	if( m_frames == 0 ) return;
+	if( m_frames == 0 || _dr.width() <= 0 ) return;
 
 	const bool focus_on_range = _to_frame <= m_frames
 					&& 0 <= _from_frame && _from_frame < _to_frame;
-	//_p.setClipRect( _clip );
 	const int w = _dr.width();
 	const int h = _dr.height();
 
 	const int yb = h / 2 + _dr.y();
-	const float y_space = h*0.5f;
-	const int nb_frames = focus_on_range ? _to_frame - _from_frame : m_frames;
-
-	const int fpp = qBound<int>( 1, nb_frames / w, 20 );
-	QPointF * l = new QPointF[nb_frames / fpp + 1];
-	QPointF * r = new QPointF[nb_frames / fpp + 1];
-	int n = 0;
+	const float y_space = h * 0.5f * m_amplification;
 	const int xb = _dr.x();
-	const int first = focus_on_range ? _from_frame : 0;
-	const int last = focus_on_range ? _to_frame : m_frames;
-	for( int frame = first; frame < last; frame += fpp )
-	{
-		l[n] = QPointF( xb + ( (frame - first) * double( w ) / nb_frames ),
-			( yb - ( m_data[frame][0] * y_space * m_amplification ) ) );
-		r[n] = QPointF( xb + ( (frame - first) * double( w ) / nb_frames ),
-			( yb - ( m_data[frame][1] * y_space * m_amplification ) ) );
-		++n;
+	const f_cnt_t first = focus_on_range ? _from_frame : 0;
+	const f_cnt_t last = focus_on_range ? _to_frame : m_frames;
+	const double frames_per_pixel = double( last - first ) / w;
+
+	// only the columns which are painted
+	const int x_first = qMax( _clip.left(), _dr.left() );
+	const int x_last = qMin( _clip.right(), _dr.right() );
+	if( x_first > x_last ) return;
+
+	if( !m_stream && frames_per_pixel < 2 )
+	{
+		// zoomed in far enough to connect the frames themselves
+		const f_cnt_t begin = qMax( first, first +
+			f_cnt_t( ( x_first - xb ) * frames_per_pixel ) - 1 );
+		const f_cnt_t end = qMin( last, first +
+			f_cnt_t( ( x_last + 1 - xb ) * frames_per_pixel ) + 2 );
+		if( end - begin < 2 ) return;
+		std::vector<QPointF> l( end - begin );
+		std::vector<QPointF> r( end - begin );
+		for( f_cnt_t frame = begin; frame < end; ++frame )
+		{
+			float min[DEFAULT_CHANNELS];
+			float value[DEFAULT_CHANNELS];
+			peakRange( frame, frame + 1, min, value );
+			const double x = xb + ( frame - first ) / frames_per_pixel;
+			l[frame - begin] = QPointF( x, yb - value[0] * y_space );
+			r[frame - begin] = QPointF( x, yb - value[1] * y_space );
+		}
+		_p.setRenderHint( QPainter::Antialiasing );
+		_p.drawPolyline( l.data(), l.size() );
+		_p.drawPolyline( r.data(), r.size() );
+		return;
+	}
+
+	if( !m_stream && !m_peaks &&
+			frames_per_pixel >= SamplePeaks::BaseBucket )
+	{
+		// not decoded from a file, e.g. recorded
+		buildPeaks();
+	}
+
+	// a vertical line per column and channel from its minimum to its
+	// maximum, so long samples cost no more than short ones
+	std::vector<QLineF> lines;
+	lines.reserve( ( x_last - x_first + 1 ) * DEFAULT_CHANNELS );
+	for( int x = x_first; x <= x_last; ++x )
+	{
+		const f_cnt_t begin = first +
+				f_cnt_t( ( x - xb ) * frames_per_pixel );
+		const f_cnt_t end = qMin( last, qMax( begin + 1, first +
+				f_cnt_t( ( x + 1 - xb ) * frames_per_pixel ) ) );
+		if( begin >= end ) break;
+		float min[DEFAULT_CHANNELS];
+		float max[DEFAULT_CHANNELS];
+		peakRange( begin, end, min, max );
+		for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+		{
+			const double top = yb - max[ch] * y_space;
+			// at least a pixel for silence
+			const double bottom = qMax<double>( yb - min[ch] * y_space,
+								top + 1 );
+			lines.push_back( QLineF( x + 0.5, top, x + 0.5, bottom ) );
+		}
 	}
-	_p.setRenderHint( QPainter::Antialiasing );
-	_p.drawPolyline( l, nb_frames / fpp );
-	_p.drawPolyline( r, nb_frames / fpp );
-	delete[] l;
-	delete[] r;
+	_p.setRenderHint( QPainter::Antialiasing, false );
+	_p.drawLines( lines.data(), lines.size() );
 }
 
 
@@ -1364,14 +2270,14 @@ void SampleBuffer::loadFromBase64( const QString & _data )
 
 	m_origFrames = orig_data.size() / sizeof( sampleFrame );
 	MM_FREE( m_origData );
-	m_origData = MM_ALLOC( sampleFrame, m_origFrames );
+	m_origData = MM_ALLOC_TAGGED( sampleFrame, m_origFrames, SampleBuffers );
 	memcpy( m_origData, orig_data.data(), orig_data.size() );
 
 #else /* LMMS_HAVE_FLAC_STREAM_DECODER_H */
 
 	m_origFrames = dsize / sizeof( sampleFrame );
 	MM_FREE( m_origData );
-	m_origData = MM_ALLOC( sampleFrame, m_origFrames );
+	m_origData = MM_ALLOC_TAGGED( sampleFrame, m_origFrames, SampleBuffers );
 	memcpy( m_origData, dst, dsize );
 
 #endif
@@ -1478,21 +2384,80 @@ QString SampleBuffer::tryToMakeAbsolute(const QString& file)
 
 
 
+class SampleBuffer::PrefetchTask : public QRunnable
+{
+public:
+	PrefetchTask( SampleBuffer * _buffer ) :
+		m_buffer( _buffer )
+	{
+	}
+
+	void run() override
+	{
+		// like the scratch buffer of update(), but without telling
+		// anyone, nobody uses the buffer yet
+		MM_FREE( m_buffer->m_data );
+		m_buffer->m_data = NULL;
+		m_buffer->decode( false );
+	}
+
+private:
+	SampleBuffer * m_buffer;
+} ;
+
+
+
+
+QList<SampleBuffer *> SampleBuffer::prefetch( const QStringList & _files )
+{
+	QList<SampleBuffer *> buffers;
+	QThreadPool pool;
+	for( const QString & file : _files )
+	{
+		SampleBuffer * buffer = new SampleBuffer;
+		buffer->m_audioFile = tryToMakeRelative( file );
+		buffers.push_back( buffer );
+		pool.start( new PrefetchTask( buffer ) );
+	}
+	pool.waitForDone();
+	return buffers;
+}
+
+
+
+
+
 
 
 
 SampleBuffer::handleState::handleState( bool _varying_pitch, int interpolation_mode ) :
 	m_frameIndex( 0 ),
 	m_varyingPitch( _varying_pitch ),
-	m_isBackwards( false )
+	m_isBackwards( false ),
+	m_cheapResamplingData( NULL ),
+	m_usingCheapResampling( false ),
+	m_polyphaseResampler( NULL )
 {
 	int error;
 	m_interpolationMode = interpolation_mode;
-	
+
+	if( interpolation_mode == POLYPHASE_INTERPOLATION )
+	{
+		m_resamplingData = NULL;
+		m_polyphaseResampler = new PolyphaseResampler;
+		return;
+	}
+
 	if( ( m_resamplingData = src_new( interpolation_mode, DEFAULT_CHANNELS, &error ) ) == NULL )
 	{
 		qDebug( "Error: src_new() failed in sample_buffer.cpp!\n" );
 	}
+
+	// only sinc interpolation is expensive enough to fall back from
+	if( interpolation_mode < SRC_ZERO_ORDER_HOLD )
+	{
+		m_cheapResamplingData = src_new( SRC_LINEAR, DEFAULT_CHANNELS, &error );
+	}
 }
 
 
@@ -1500,5 +2465,36 @@ SampleBuffer::handleState::handleState( bool _varying_pitch, int interpolation_m
 
 SampleBuffer::handleState::~handleState()
 {
-	src_delete( m_resamplingData );
+	delete m_polyphaseResampler;
+	if( m_resamplingData != NULL )
+	{
+		src_delete( m_resamplingData );
+	}
+	if( m_cheapResamplingData != NULL )
+	{
+		src_delete( m_cheapResamplingData );
+	}
+}
+
+
+
+
+void SampleBuffer::handleState::reset( bool _varying_pitch )
+{
+	m_frameIndex = 0;
+	m_varyingPitch = _varying_pitch;
+	m_isBackwards = false;
+	m_usingCheapResampling = false;
+	if( m_polyphaseResampler != NULL )
+	{
+		m_polyphaseResampler->reset();
+	}
+	if( m_resamplingData != NULL )
+	{
+		src_reset( m_resamplingData );
+	}
+	if( m_cheapResamplingData != NULL )
+	{
+		src_reset( m_cheapResamplingData );
+	}
 }
@@ -0,0 +1,496 @@
+/*
+ * SampleCache.cpp - decoded samples shared by all sample buffers loading the
+ *                   same file
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "SampleCache.h"
+
+#include <cstring>
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QSaveFile>
+#include <QtCore/QStandardPaths>
+
+#include "MemoryManager.h"
+
+
+namespace
+{
+
+struct Entry
+{
+	QString key;
+	void * data;
+	f_cnt_t frames;
+	size_t bytes;
+	int references;
+	SamplePeaksPtr peaks;
+	// the file of the disk cache the data is mapped from, NULL if the
+	// data has been allocated
+	QFile * mapping;
+} ;
+
+// The files of the disk cache hold the data in the memory layout of this
+// build, the header makes sure it has been written by a compatible one.
+struct DiskHeader
+{
+	char magic[8];
+	quint32 byteOrder;
+	quint32 bytesPerFrame;
+	qint64 frames;
+	// the data starts on a cache line
+	char reserved[40];
+} ;
+
+const char DiskMagic[8] = { 'L', 'M', 'M', 'S', 'S', 'M', 'P', 'L' };
+const quint32 DiskByteOrder = 0x01020304;
+
+}
+
+
+static QMutex s_mutex;
+static QHash<QString, Entry *> s_entries;
+static QHash<const void *, Entry *> s_entriesByData;
+
+// entries without references which are kept, in the order of release
+static QList<Entry *> s_retained;
+static size_t s_retainedBytes = 0;
+static size_t s_retainBudget = 0;
+
+static QString s_diskCacheDir;
+// hashes of the contents of the samples by path and modification time
+static QHash<QString, QByteArray> s_contentHashes;
+
+
+
+
+// has to be called with s_mutex locked
+static void freeEntry( Entry * _entry )
+{
+	s_entries.remove( _entry->key );
+	s_entriesByData.remove( _entry->data );
+	if( _entry->mapping )
+	{
+		// closing the file removes the mapping
+		delete _entry->mapping;
+	}
+	else
+	{
+		MM_FREE( _entry->data );
+	}
+	delete _entry;
+}
+
+
+
+
+// frees the entries released first until the rest fits the budget, has to
+// be called with s_mutex locked
+static void trimRetained()
+{
+	while( s_retainedBytes > s_retainBudget )
+	{
+		Entry * entry = s_retained.takeFirst();
+		s_retainedBytes -= entry->bytes;
+		freeEntry( entry );
+	}
+}
+
+
+
+
+// everything but the file which makes a difference to the data
+static QString propertiesString( const SampleCache::Key & _key, bool _compact )
+{
+	QString stretch;
+	if( _key.speed != 0 )
+	{
+		stretch = '\n' + QString::number( _key.speed, 'g', 17 ) + '\n' +
+					QString::number( _key.semitones );
+	}
+	return QString::number( _key.sampleRate ) + ( _key.reversed ? "r" : "" ) +
+		( _compact ? "c" : "" ) + stretch;
+}
+
+
+
+
+static QString keyString( const SampleCache::Key & _key, bool _compact )
+{
+	return _key.file + '\n' + QString::number( _key.modified ) + '\n' +
+					propertiesString( _key, _compact );
+}
+
+
+
+
+static DiskHeader diskHeader( size_t _bytesPerFrame, f_cnt_t _frames )
+{
+	DiskHeader header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, DiskMagic, sizeof( DiskMagic ) );
+	header.byteOrder = DiskByteOrder;
+	header.bytesPerFrame = _bytesPerFrame;
+	header.frames = _frames;
+	return header;
+}
+
+
+
+
+// the file of the disk cache for _key in _dir, named after the contents of
+// the sample so renamed and copied samples are found as well - empty if
+// the sample can't be read
+static QString diskFileName( const QString & _dir,
+				const SampleCache::Key & _key, bool _compact )
+{
+	const QString version = _key.file + '\n' +
+					QString::number( _key.modified );
+	s_mutex.lock();
+	QByteArray contentHash = s_contentHashes.value( version );
+	s_mutex.unlock();
+
+	if( contentHash.isEmpty() )
+	{
+		// reading the file is still a lot faster than decoding it
+		QFile file( _key.file );
+		QCryptographicHash hash( QCryptographicHash::Sha1 );
+		if( !file.open( QIODevice::ReadOnly ) || !hash.addData( &file ) )
+		{
+			return QString();
+		}
+		contentHash = hash.result();
+		QMutexLocker lock( &s_mutex );
+		s_contentHashes.insert( version, contentHash );
+	}
+
+	QCryptographicHash hash( QCryptographicHash::Sha1 );
+	hash.addData( contentHash );
+	hash.addData( propertiesString( _key, _compact ).toUtf8() );
+	return _dir + '/' + QString::fromLatin1( hash.result().toHex() ) + ".pcm";
+}
+
+
+
+
+// has to be called with s_mutex locked
+static void * takeEntry( const QString & _key, f_cnt_t & _frames )
+{
+	Entry * entry = s_entries.value( _key );
+	if( entry == NULL )
+	{
+		return NULL;
+	}
+	if( entry->references++ == 0 )
+	{
+		s_retained.removeOne( entry );
+		s_retainedBytes -= entry->bytes;
+	}
+	_frames = entry->frames;
+	return entry->data;
+}
+
+
+
+
+// has to be called with s_mutex locked
+static void addEntry( const QString & _key, void * _data, f_cnt_t _frames,
+					size_t _bytes, QFile * _mapping )
+{
+	Entry * entry = new Entry;
+	entry->key = _key;
+	entry->data = _data;
+	entry->frames = _frames;
+	entry->bytes = _bytes;
+	entry->references = 1;
+	entry->mapping = _mapping;
+	s_entries.insert( _key, entry );
+	s_entriesByData.insert( _data, entry );
+}
+
+
+
+
+// maps the data of _key from the disk cache into a new entry
+static void * mapEntry( const QString & _dir, const SampleCache::Key & _key,
+			bool _compact, size_t _bytesPerFrame, f_cnt_t & _frames )
+{
+	const QString fileName = diskFileName( _dir, _key, _compact );
+	if( fileName.isEmpty() )
+	{
+		return NULL;
+	}
+
+	QFile * file = new QFile( fileName );
+	if( !file->open( QIODevice::ReadOnly ) ||
+				file->size() <= (qint64) sizeof( DiskHeader ) )
+	{
+		delete file;
+		return NULL;
+	}
+	// pages are only read in once they're played
+	uchar * mapped = file->map( 0, file->size() );
+	DiskHeader header;
+	memset( &header, 0, sizeof( header ) );
+	if( mapped != NULL )
+	{
+		memcpy( &header, mapped, sizeof( header ) );
+	}
+	const DiskHeader expected = diskHeader( _bytesPerFrame, header.frames );
+	if( mapped == NULL ||
+		memcmp( &header, &expected, sizeof( header ) ) != 0 ||
+		header.frames <= 0 || file->size() != (qint64)
+			( sizeof( header ) + header.frames * _bytesPerFrame ) )
+	{
+		delete file;
+		return NULL;
+	}
+
+	const QString key = keyString( _key, _compact );
+	QMutexLocker lock( &s_mutex );
+	// another thread may have added it meanwhile
+	if( void * data = takeEntry( key, _frames ) )
+	{
+		delete file;
+		return data;
+	}
+	void * data = mapped + sizeof( DiskHeader );
+	_frames = header.frames;
+	addEntry( key, data, _frames, _frames * _bytesPerFrame, file );
+	return data;
+}
+
+
+
+
+// written to a temporary file and renamed, so processes looking for the
+// sample meanwhile never map a partial file
+static void writeEntry( const QString & _dir, const SampleCache::Key & _key,
+			bool _compact, const void * _data, f_cnt_t _frames,
+							size_t _bytesPerFrame )
+{
+	const QString fileName = diskFileName( _dir, _key, _compact );
+	if( fileName.isEmpty() || QFile::exists( fileName ) ||
+						!QDir().mkpath( _dir ) )
+	{
+		return;
+	}
+
+	QSaveFile file( fileName );
+	if( file.open( QIODevice::WriteOnly ) )
+	{
+		const DiskHeader header = diskHeader( _bytesPerFrame, _frames );
+		file.write( reinterpret_cast<const char *>( &header ),
+							sizeof( header ) );
+		file.write( static_cast<const char *>( _data ),
+						_frames * _bytesPerFrame );
+		file.commit();
+	}
+}
+
+
+
+
+static void * acquireEntry( const SampleCache::Key & _key, bool _compact,
+				size_t _bytesPerFrame, f_cnt_t & _frames )
+{
+	s_mutex.lock();
+	void * data = takeEntry( keyString( _key, _compact ), _frames );
+	const QString dir = s_diskCacheDir;
+	s_mutex.unlock();
+
+	if( data == NULL && !dir.isEmpty() )
+	{
+		data = mapEntry( dir, _key, _compact, _bytesPerFrame, _frames );
+	}
+	return data;
+}
+
+
+
+
+static void * insertEntry( const SampleCache::Key & _key, bool _compact,
+			void * _data, f_cnt_t _frames, size_t _bytesPerFrame )
+{
+	const QString key = keyString( _key, _compact );
+	s_mutex.lock();
+	f_cnt_t frames;
+	if( void * data = takeEntry( key, frames ) )
+	{
+		s_mutex.unlock();
+		MM_FREE( _data );
+		return data;
+	}
+	addEntry( key, _data, _frames, _frames * _bytesPerFrame, NULL );
+	const QString dir = s_diskCacheDir;
+	s_mutex.unlock();
+
+	// shared data doesn't change anymore, so it can be written unlocked
+	if( !dir.isEmpty() )
+	{
+		writeEntry( dir, _key, _compact, _data, _frames, _bytesPerFrame );
+	}
+	return _data;
+}
+
+
+
+
+sampleFrame * SampleCache::acquire( const Key & _key, f_cnt_t & _frames )
+{
+	return static_cast<sampleFrame *>( acquireEntry( _key, false,
+						sizeof( sampleFrame ), _frames ) );
+}
+
+
+
+
+sampleFrame * SampleCache::insert( const Key & _key, sampleFrame * _data,
+							f_cnt_t _frames )
+{
+	return static_cast<sampleFrame *>( insertEntry( _key, false, _data,
+					_frames, sizeof( sampleFrame ) ) );
+}
+
+
+
+
+qint16 * SampleCache::acquireCompact( const Key & _key, f_cnt_t & _frames )
+{
+	return static_cast<qint16 *>( acquireEntry( _key, true,
+			DEFAULT_CHANNELS * sizeof( qint16 ), _frames ) );
+}
+
+
+
+
+qint16 * SampleCache::insertCompact( const Key & _key, qint16 * _data,
+							f_cnt_t _frames )
+{
+	return static_cast<qint16 *>( insertEntry( _key, true, _data,
+			_frames, DEFAULT_CHANNELS * sizeof( qint16 ) ) );
+}
+
+
+
+
+void SampleCache::release( const void * _data )
+{
+	QMutexLocker lock( &s_mutex );
+	Entry * entry = s_entriesByData.value( _data );
+	if( entry == NULL || --entry->references > 0 )
+	{
+		return;
+	}
+	if( entry->bytes > s_retainBudget )
+	{
+		freeEntry( entry );
+		return;
+	}
+	s_retained.append( entry );
+	s_retainedBytes += entry->bytes;
+	trimRetained();
+}
+
+
+
+
+SamplePeaksPtr SampleCache::peaks( const void * _data )
+{
+	QMutexLocker lock( &s_mutex );
+	const Entry * entry = s_entriesByData.value( _data );
+	return entry != NULL ? entry->peaks : SamplePeaksPtr();
+}
+
+
+
+
+void SampleCache::setPeaks( const void * _data,
+					const SamplePeaksPtr & _peaks )
+{
+	QMutexLocker lock( &s_mutex );
+	Entry * entry = s_entriesByData.value( _data );
+	if( entry != NULL )
+	{
+		entry->peaks = _peaks;
+	}
+}
+
+
+
+
+void SampleCache::setRetainBudget( size_t _bytes )
+{
+	QMutexLocker lock( &s_mutex );
+	s_retainBudget = _bytes;
+	trimRetained();
+}
+
+
+
+
+void SampleCache::setDiskCacheDir( const QString & _dir )
+{
+	s_mutex.lock();
+	s_diskCacheDir = _dir;
+	s_mutex.unlock();
+	if( _dir.isEmpty() )
+	{
+		return;
+	}
+
+	// the newest files are the ones most likely to be loaded again
+	qint64 bytes = 0;
+	const QFileInfoList files = QDir( _dir ).entryInfoList(
+			QStringList( "*.pcm" ), QDir::Files, QDir::Time );
+	for( const QFileInfo & file : files )
+	{
+		bytes += file.size();
+		if( bytes > DiskCacheBytes )
+		{
+			// mappings of other processes stay valid
+			QFile::remove( file.absoluteFilePath() );
+		}
+	}
+}
+
+
+
+
+QString SampleCache::defaultDiskCacheDir()
+{
+	return QStandardPaths::writableLocation(
+			QStandardPaths::GenericCacheLocation ) + "/lmms/samples";
+}
+
+
+
+
+int SampleCache::size()
+{
+	QMutexLocker lock( &s_mutex );
+	return s_entries.size();
+}
@@ -0,0 +1,171 @@
+/*
+ * SamplePeaks.cpp - minimum and maximum of a sample at several resolutions,
+ *                   for drawing its waveform
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "SamplePeaks.h"
+
+#include <QtGlobal>
+
+#include <algorithm>
+#include <utility>
+
+
+static inline qint16 quantized( float _value )
+{
+	return qint16( qBound( -32767.0f, _value * 32767.0f, 32767.0f ) );
+}
+
+
+
+
+SamplePeaks::SamplePeaks( const sampleFrame * _data, f_cnt_t _frames ) :
+	m_frames( _frames )
+{
+	build( &_data[0][0], _frames, 1.0f );
+}
+
+
+
+
+SamplePeaks::SamplePeaks( const qint16 * _data, f_cnt_t _frames ) :
+	m_frames( _frames )
+{
+	build( _data, _frames, 1.0f / 32767.0f );
+}
+
+
+
+
+void SamplePeaks::range( f_cnt_t _begin, f_cnt_t _end,
+				float _min[DEFAULT_CHANNELS],
+				float _max[DEFAULT_CHANNELS] ) const
+{
+	for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+	{
+		_min[ch] = 0.0f;
+		_max[ch] = 0.0f;
+	}
+	_begin = qMax<f_cnt_t>( _begin, 0 );
+	_end = qMin( _end, m_frames );
+	if( _begin >= _end || m_levels.empty() )
+	{
+		return;
+	}
+
+	// the coarsest level with buckets no longer than the span, which
+	// covers it with at most three buckets
+	size_t level = 0;
+	while( level + 1 < m_levels.size() &&
+		( f_cnt_t( 1 ) << ( BaseBucketBits + level + 1 ) ) <=
+							_end - _begin )
+	{
+		++level;
+	}
+
+	const std::vector<qint16> & buckets = m_levels[level];
+	const int shift = BaseBucketBits + level;
+	const size_t first = _begin >> shift;
+	const size_t last = qMin<size_t>( ( _end - 1 ) >> shift,
+				buckets.size() / ValuesPerBucket - 1 );
+	qint16 min[DEFAULT_CHANNELS];
+	qint16 max[DEFAULT_CHANNELS];
+	for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+	{
+		min[ch] = buckets[first * ValuesPerBucket + 2 * ch];
+		max[ch] = buckets[first * ValuesPerBucket + 2 * ch + 1];
+	}
+	for( size_t b = first + 1; b <= last; ++b )
+	{
+		for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+		{
+			min[ch] = qMin( min[ch],
+				buckets[b * ValuesPerBucket + 2 * ch] );
+			max[ch] = qMax( max[ch],
+				buckets[b * ValuesPerBucket + 2 * ch + 1] );
+		}
+	}
+	for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+	{
+		_min[ch] = min[ch] / 32767.0f;
+		_max[ch] = max[ch] / 32767.0f;
+	}
+}
+
+
+
+
+template<class Sample>
+void SamplePeaks::build( const Sample * _data, f_cnt_t _frames,
+							float _scale )
+{
+	if( _frames <= 0 )
+	{
+		return;
+	}
+
+	// the first level from the data, up to BaseBucket frames per bucket
+	const size_t count = ( _frames + BaseBucket - 1 ) / BaseBucket;
+	std::vector<qint16> level( count * ValuesPerBucket );
+	for( size_t b = 0; b < count; ++b )
+	{
+		const f_cnt_t begin = b * BaseBucket;
+		const f_cnt_t end = qMin( begin + BaseBucket, _frames );
+		for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+		{
+			Sample min = _data[begin * DEFAULT_CHANNELS + ch];
+			Sample max = min;
+			for( f_cnt_t f = begin + 1; f < end; ++f )
+			{
+				const Sample s = _data[f * DEFAULT_CHANNELS + ch];
+				min = std::min( min, s );
+				max = std::max( max, s );
+			}
+			level[b * ValuesPerBucket + 2 * ch] =
+						quantized( min * _scale );
+			level[b * ValuesPerBucket + 2 * ch + 1] =
+						quantized( max * _scale );
+		}
+	}
+	m_levels.push_back( std::move( level ) );
+
+	// each further level from pairs of buckets of the one before
+	while( m_levels.back().size() > size_t( ValuesPerBucket ) )
+	{
+		const std::vector<qint16> & finer = m_levels.back();
+		const size_t finerCount = finer.size() / ValuesPerBucket;
+		std::vector<qint16> coarser( ( finerCount + 1 ) / 2 *
+							ValuesPerBucket );
+		for( size_t b = 0; b < finerCount; ++b )
+		{
+			for( int v = 0; v < ValuesPerBucket; ++v )
+			{
+				const qint16 value = finer[b * ValuesPerBucket + v];
+				qint16 & target = coarser[b / 2 * ValuesPerBucket + v];
+				// even values are minima, odd ones maxima
+				target = b % 2 == 0 ? value : v % 2 == 0 ?
+						qMin( target, value ) :
+						qMax( target, value );
+			}
+		}
+		m_levels.push_back( std::move( coarser ) );
+	}
+}
@@ -37,6 +37,7 @@ SamplePlayHandle::SamplePlayHandle( SampleBuffer* sampleBuffer , bool ownAudioPo
 	m_sampleBuffer( sharedObject::ref( sampleBuffer ) ),
 	m_doneMayReturnTrue( true ),
 	m_frame( 0 ),
+	m_speed( 1.0 ),
 	m_ownAudioPort( ownAudioPort ),
 	m_defaultVolumeModel( DefaultVolume, MinVolume, MaxVolume, 1 ),
 	m_volumeModel( &m_defaultVolumeModel ),
@@ -52,8 +53,22 @@ SamplePlayHandle::SamplePlayHandle( SampleBuffer* sampleBuffer , bool ownAudioPo
 
 
 
+// files are previewed from disk, so playback starts after decoding the
+// head and whatever is left to decode is dropped with the handle
+static SampleBuffer * previewBuffer( const QString & _file )
+{
+	SampleBuffer * buffer = new SampleBuffer;
+	buffer->setStreamingEnabled( true );
+	buffer->setEagerStreaming( true );
+	buffer->setAudioFile( _file );
+	return buffer;
+}
+
+
+
+
 SamplePlayHandle::SamplePlayHandle( const QString& sampleFile ) :
-	SamplePlayHandle( new SampleBuffer( sampleFile ) , true)
+	SamplePlayHandle( previewBuffer( sampleFile ) , true)
 {
 	sharedObject::unref( m_sampleBuffer );
 }
@@ -62,8 +77,9 @@ SamplePlayHandle::SamplePlayHandle( const QString& sampleFile ) :
 
 
 SamplePlayHandle::SamplePlayHandle( SampleTCO* tco ) :
-	SamplePlayHandle( tco->sampleBuffer() , false)
+	SamplePlayHandle( tco->playbackBuffer() , false)
 {
+	m_speed = tco->playbackSpeed();
 	m_track = tco->getTrack();
 	setAudioPort( ( (SampleTrack *)tco->getTrack() )->audioPort() );
 }
@@ -111,7 +127,7 @@ void SamplePlayHandle::play( sampleFrame * buffer )
 			{ { m_volumeModel->value() / DefaultVolume,
 				m_volumeModel->value() / DefaultVolume } };*/
 		if( ! m_sampleBuffer->play( workingBuffer, &m_state, frames,
-								BaseFreq ) )
+								BaseFreq * m_speed ) )
 		{
 			memset( workingBuffer, 0, frames * sizeof( sampleFrame ) );
 		}
@@ -141,7 +157,7 @@ bool SamplePlayHandle::isFromTrack( const Track * _track ) const
 
 f_cnt_t SamplePlayHandle::totalFrames() const
 {
-	return ( m_sampleBuffer->endFrame() - m_sampleBuffer->startFrame() ) * ( Engine::mixer()->processingSampleRate() / m_sampleBuffer->sampleRate() );
+	return ( m_sampleBuffer->endFrame() - m_sampleBuffer->startFrame() ) * ( Engine::mixer()->processingSampleRate() / m_sampleBuffer->sampleRate() ) / m_speed;
 }
 
 
@@ -24,10 +24,14 @@
 
 
 #include "SampleRecordHandle.h"
+
+#include <QtCore/QFile>
+
 #include "BBTrack.h"
 #include "Engine.h"
 #include "InstrumentTrack.h"
 #include "Mixer.h"
+#include "RecordingWriter.h"
 #include "SampleBuffer.h"
 #include "SampleTrack.h"
 #include "debug.h"
@@ -35,6 +39,9 @@
 
 SampleRecordHandle::SampleRecordHandle( SampleTCO* tco ) :
 	PlayHandle( TypeSamplePlayHandle ),
+	m_writer( new RecordingWriter(
+			RecordingWriter::newFileName( "recording" ),
+				Engine::mixer()->inputSampleRate() ) ),
 	m_framesRecorded( 0 ),
 	m_minLength( tco->length() ),
 	m_track( tco->getTrack() ),
@@ -48,18 +55,22 @@ SampleRecordHandle::SampleRecordHandle( SampleTCO* tco ) :
 
 SampleRecordHandle::~SampleRecordHandle()
 {
-	if( !m_buffers.empty() )
+	if( m_framesRecorded > 0 )
 	{
 		SampleBuffer* sb;
 		createSampleBuffer( &sb );
-		m_tco->setSampleBuffer( sb );
+		if( sb != NULL )
+		{
+			m_tco->setSampleBuffer( sb );
+		}
 	}
-	
-	while( !m_buffers.empty() )
+	else
 	{
-		delete[] m_buffers.front().first;
-		m_buffers.erase( m_buffers.begin() );
+		m_writer->finish();
+		QFile::remove( m_writer->fileName() );
 	}
+
+	delete m_writer;
 	m_tco->setRecord( false );
 }
 
@@ -70,7 +81,7 @@ void SampleRecordHandle::play( sampleFrame * /*_working_buffer*/ )
 {
 	const sampleFrame * recbuf = Engine::mixer()->inputBuffer();
 	const f_cnt_t frames = Engine::mixer()->inputBufferFrames();
-	writeBuffer( recbuf, frames );
+	m_writer->write( recbuf, frames );
 	m_framesRecorded += frames;
 
 	MidiTime len = (tick_t)( m_framesRecorded / Engine::framesPerTick() );
@@ -110,45 +121,6 @@ f_cnt_t SampleRecordHandle::framesRecorded() const
 
 void SampleRecordHandle::createSampleBuffer( SampleBuffer** sampleBuf )
 {
-	const f_cnt_t frames = framesRecorded();
-	// create buffer to store all recorded buffers in
-	sampleFrame * data = new sampleFrame[frames];
-	// make sure buffer is cleaned up properly at the end...
-	sampleFrame * data_ptr = data;
-
-
-	assert( data != NULL );
-
-	// now copy all buffers into big buffer
-	for( bufferList::const_iterator it = m_buffers.begin();
-						it != m_buffers.end(); ++it )
-	{
-		memcpy( data_ptr, ( *it ).first, ( *it ).second *
-							sizeof( sampleFrame ) );
-		data_ptr += ( *it ).second;
-	}
-	// create according sample-buffer out of big buffer
-	*sampleBuf = new SampleBuffer( data, frames );
-	( *sampleBuf)->setSampleRate( Engine::mixer()->inputSampleRate() );
-	delete[] data;
+	*sampleBuf = m_writer->finish() ?
+			new SampleBuffer( m_writer->fileName() ) : NULL;
 }
-
-
-
-
-void SampleRecordHandle::writeBuffer( const sampleFrame * _ab,
-					const f_cnt_t _frames )
-{
-	sampleFrame * buf = new sampleFrame[_frames];
-	for( f_cnt_t frame = 0; frame < _frames; ++frame )
-	{
-		for( ch_cnt_t chnl = 0; chnl < DEFAULT_CHANNELS; ++chnl )
-		{
-			buf[frame][chnl] = _ab[frame][chnl];
-		}
-	}
-	m_buffers.push_back( qMakePair( buf, _frames ) );
-}
-
-
-
@@ -0,0 +1,503 @@
+/*
+ * SampleStream.cpp - plays long audio files from disk instead of loading them
+ *                    into memory
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "SampleStream.h"
+
+#include <cstring>
+
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+
+
+// frames read from the file at once
+static const f_cnt_t FileChunkFrames = 4096;
+
+
+static quint64 window( f_cnt_t _start, f_cnt_t _end )
+{
+	return (quint64) (quint32) _start << 32 | (quint32) _end;
+}
+
+static f_cnt_t windowStart( quint64 _window )
+{
+	return (f_cnt_t) ( _window >> 32 );
+}
+
+static f_cnt_t windowEnd( quint64 _window )
+{
+	return (f_cnt_t) (quint32) _window;
+}
+
+
+
+
+namespace
+{
+
+// reads ahead for all streams
+class SampleStreamThread : public QThread
+{
+protected:
+	void run() override;
+} ;
+
+}
+
+
+static QMutex s_streamsMutex;
+static QList<SampleStream *> s_streams;
+static SampleStreamThread * s_thread = NULL;
+static bool s_threadRunning = false;
+
+
+
+
+void SampleStreamThread::run()
+{
+	while( true )
+	{
+		bool busy = false;
+		s_streamsMutex.lock();
+		if( s_streams.isEmpty() )
+		{
+			// started again by the next stream
+			s_threadRunning = false;
+			s_streamsMutex.unlock();
+			return;
+		}
+		for( SampleStream * stream : s_streams )
+		{
+			busy |= stream->fill();
+		}
+		s_streamsMutex.unlock();
+
+		if( !busy )
+		{
+			msleep( 5 );
+		}
+	}
+}
+
+
+
+
+SampleStream::SampleStream( const QString & _file,
+					sample_rate_t _sampleRate ) :
+	m_qfile( _file ),
+	m_file( NULL ),
+	m_ratio( 1 ),
+	m_frames( 0 ),
+	m_keepFrames( _sampleRate ),
+	m_head( NULL ),
+	m_headFrames( 0 ),
+	m_ring( NULL ),
+	m_ringFrames( 0 ),
+	m_window( 0 ),
+	m_readPosition( 0 ),
+	m_seekRequest( -1 ),
+	m_resampler( NULL ),
+	m_fileBuffer( NULL ),
+	m_pending( NULL ),
+	m_pendingOffset( 0 ),
+	m_pendingFrames( 0 ),
+	m_endOfFile( false ),
+	m_chunk( NULL ),
+	m_chunkFrames( 0 ),
+	m_scanQFile( _file ),
+	m_scanFile( NULL ),
+	m_overview( NULL ),
+	m_overviewBlocks( 0 ),
+	m_overviewScanned( 0 )
+{
+	m_info.format = 0;
+	// QFile handles unicode file names on Windows
+	if( !m_qfile.open( QIODevice::ReadOnly ) ||
+		( m_file = sf_open_fd( m_qfile.handle(), SFM_READ, &m_info,
+							false ) ) == NULL ||
+		m_info.frames <= 0 || m_info.samplerate <= 0 )
+	{
+		return;
+	}
+
+	m_ratio = (double) _sampleRate / m_info.samplerate;
+	if( m_info.samplerate != (int) _sampleRate )
+	{
+		int error;
+		m_resampler = src_new( SRC_SINC_FASTEST, DEFAULT_CHANNELS, &error );
+		if( m_resampler == NULL )
+		{
+			return;
+		}
+	}
+
+	m_fileBuffer = new float[FileChunkFrames * m_info.channels];
+	m_pending = MM_ALLOC_TAGGED( sampleFrame, FileChunkFrames, SampleBuffers );
+	m_chunkFrames = static_cast<f_cnt_t>( FileChunkFrames * m_ratio ) + 64;
+	m_chunk = MM_ALLOC_TAGGED( sampleFrame, m_chunkFrames, SampleBuffers );
+
+	const f_cnt_t frames = static_cast<f_cnt_t>( m_info.frames * m_ratio );
+
+	m_headFrames = qMin<f_cnt_t>( frames, HeadSeconds * _sampleRate );
+	m_head = MM_ALLOC_TAGGED( sampleFrame, m_headFrames, SampleBuffers );
+	f_cnt_t headRead = 0;
+	while( headRead < m_headFrames )
+	{
+		const f_cnt_t produced = produce( m_head + headRead,
+						m_headFrames - headRead );
+		if( produced == 0 )
+		{
+			break;
+		}
+		headRead += produced;
+	}
+	memset( m_head + headRead, 0,
+			( m_headFrames - headRead ) * sizeof( sampleFrame ) );
+	seekFile( 0 );
+
+	m_ringFrames = RingSeconds * _sampleRate;
+	m_ring = MM_ALLOC_TAGGED( sampleFrame, m_ringFrames, SampleBuffers );
+
+	m_overviewBlocks = frames / OverviewBlock + 1;
+	m_overview = MM_ALLOC_TAGGED( sampleFrame, m_overviewBlocks, SampleBuffers );
+	memset( m_overview, 0, m_overviewBlocks * sizeof( sampleFrame ) );
+
+	m_frames = frames;
+
+	s_streamsMutex.lock();
+	s_streams.append( this );
+	if( !s_threadRunning )
+	{
+		if( s_thread == NULL )
+		{
+			s_thread = new SampleStreamThread;
+		}
+		else
+		{
+			// it's about to finish, it can't be started again before
+			s_thread->wait();
+		}
+		s_threadRunning = true;
+		s_thread->start( QThread::LowPriority );
+	}
+	s_streamsMutex.unlock();
+}
+
+
+
+
+SampleStream::~SampleStream()
+{
+	s_streamsMutex.lock();
+	s_streams.removeOne( this );
+	s_streamsMutex.unlock();
+
+	if( m_resampler )
+	{
+		src_delete( m_resampler );
+	}
+	if( m_scanFile )
+	{
+		sf_close( m_scanFile );
+	}
+	if( m_file )
+	{
+		sf_close( m_file );
+	}
+	delete[] m_fileBuffer;
+	MM_FREE( m_pending );
+	MM_FREE( m_chunk );
+	MM_FREE( m_head );
+	MM_FREE( m_ring );
+	MM_FREE( m_overview );
+}
+
+
+
+
+void SampleStream::read( f_cnt_t _index, sampleFrame * _dst, f_cnt_t _frames )
+{
+	m_readPosition.store( _index );
+
+	f_cnt_t done = 0;
+	if( _index < m_headFrames )
+	{
+		done = qMin( _frames, m_headFrames - _index );
+		memcpy( _dst, m_head + _index, done * sizeof( sampleFrame ) );
+	}
+
+	const quint64 current = m_window.load();
+	const f_cnt_t start = windowStart( current );
+	const f_cnt_t end = windowEnd( current );
+
+	if( !isInReach( current, _index ) )
+	{
+		m_seekRequest.store( _index );
+	}
+
+	const f_cnt_t first = _index + done;
+	if( first >= start && first < end )
+	{
+		const f_cnt_t count = qMin( _frames - done, end - first );
+		const f_cnt_t offset = first % m_ringFrames;
+		const f_cnt_t beforeWrap = qMin( count, m_ringFrames - offset );
+		memcpy( _dst + done, m_ring + offset, beforeWrap * sizeof( sampleFrame ) );
+		memcpy( _dst + done + beforeWrap, m_ring,
+				( count - beforeWrap ) * sizeof( sampleFrame ) );
+
+		// the slots of these frames only ever hold other frames once
+		// they've left the window, which may have happened meanwhile
+		const quint64 after = m_window.load();
+		if( windowStart( after ) <= first &&
+				windowEnd( after ) >= first + count )
+		{
+			done += count;
+		}
+	}
+
+	// not read yet
+	memset( _dst + done, 0, ( _frames - done ) * sizeof( sampleFrame ) );
+}
+
+
+
+
+void SampleStream::cue( f_cnt_t _index )
+{
+	if( isInReach( m_window.load(), _index ) ||
+			m_seekRequest.load() == _index )
+	{
+		return;
+	}
+	// the ring is filled up to m_ringFrames after the read position
+	m_readPosition.store( _index );
+	m_seekRequest.store( _index );
+}
+
+
+
+
+void SampleStream::peak( f_cnt_t _frame, float & _left, float & _right ) const
+{
+	const f_cnt_t block = _frame / OverviewBlock;
+	if( block < m_overviewScanned.load( std::memory_order_acquire ) )
+	{
+		_left = m_overview[block][0];
+		_right = m_overview[block][1];
+	}
+	else
+	{
+		_left = _right = 0;
+	}
+}
+
+
+
+
+bool SampleStream::fill()
+{
+	const f_cnt_t seek = m_seekRequest.exchange( -1 );
+	if( seek >= 0 )
+	{
+		m_window.store( window( seek, seek ) );
+		seekFile( seek );
+	}
+
+	// writing frame f overwrites frame f - m_ringFrames, keep
+	// m_keepFrames before the read position
+	const quint64 current = m_window.load();
+	const f_cnt_t end = windowEnd( current );
+	const f_cnt_t wanted = qMin( m_chunkFrames, m_frames - end );
+	const f_cnt_t writable = m_readPosition.load() - m_keepFrames +
+							m_ringFrames - end;
+	if( wanted <= 0 || writable < wanted )
+	{
+		return scanOverview();
+	}
+
+	const f_cnt_t produced = produce( m_chunk, wanted );
+	if( produced == 0 )
+	{
+		return scanOverview();
+	}
+
+	// drop what is about to be overwritten from the window first
+	const f_cnt_t start = qMax( windowStart( current ),
+					end + produced - m_ringFrames );
+	m_window.store( window( start, end ) );
+	const f_cnt_t offset = end % m_ringFrames;
+	const f_cnt_t beforeWrap = qMin( produced, m_ringFrames - offset );
+	memcpy( m_ring + offset, m_chunk, beforeWrap * sizeof( sampleFrame ) );
+	memcpy( m_ring, m_chunk + beforeWrap,
+			( produced - beforeWrap ) * sizeof( sampleFrame ) );
+	m_window.store( window( start, end + produced ) );
+
+	return true;
+}
+
+
+
+
+bool SampleStream::isInReach( quint64 _window, f_cnt_t _index ) const
+{
+	// not far outside of what the background thread is reading
+	return _index >= windowStart( _window ) &&
+			_index <= windowEnd( _window ) + 4 * m_chunkFrames;
+}
+
+
+
+
+void SampleStream::seekFile( f_cnt_t _frame )
+{
+	sf_seek( m_file, static_cast<sf_count_t>( _frame / m_ratio ), SEEK_SET );
+	m_pendingOffset = m_pendingFrames = 0;
+	m_endOfFile = false;
+	if( m_resampler )
+	{
+		src_reset( m_resampler );
+	}
+}
+
+
+
+
+f_cnt_t SampleStream::produce( sampleFrame * _dst, f_cnt_t _frames )
+{
+	f_cnt_t produced = 0;
+	while( produced < _frames )
+	{
+		if( m_pendingOffset == m_pendingFrames )
+		{
+			if( m_endOfFile )
+			{
+				break;
+			}
+			const sf_count_t count = sf_readf_float( m_file,
+						m_fileBuffer, FileChunkFrames );
+			if( count <= 0 )
+			{
+				m_endOfFile = true;
+				break;
+			}
+			const int channels = m_info.channels;
+			const int right = channels > 1 ? 1 : 0;
+			for( sf_count_t f = 0; f < count; ++f )
+			{
+				m_pending[f][0] = m_fileBuffer[f * channels];
+				m_pending[f][1] = m_fileBuffer[f * channels + right];
+			}
+			m_pendingOffset = 0;
+			m_pendingFrames = count;
+		}
+
+		if( m_resampler == NULL )
+		{
+			const f_cnt_t count = qMin( _frames - produced,
+					m_pendingFrames - m_pendingOffset );
+			memcpy( _dst + produced, m_pending + m_pendingOffset,
+						count * sizeof( sampleFrame ) );
+			m_pendingOffset += count;
+			produced += count;
+		}
+		else
+		{
+			SRC_DATA data;
+			data.data_in = m_pending[m_pendingOffset];
+			data.input_frames = m_pendingFrames - m_pendingOffset;
+			data.data_out = _dst[produced];
+			data.output_frames = _frames - produced;
+			data.src_ratio = m_ratio;
+			data.end_of_input = 0;
+			if( src_process( m_resampler, &data ) != 0 ||
+				( data.input_frames_used == 0 &&
+					data.output_frames_gen == 0 ) )
+			{
+				m_endOfFile = true;
+				break;
+			}
+			m_pendingOffset += data.input_frames_used;
+			produced += data.output_frames_gen;
+		}
+	}
+	return produced;
+}
+
+
+
+
+bool SampleStream::scanOverview()
+{
+	f_cnt_t block = m_overviewScanned.load( std::memory_order_relaxed );
+	if( block >= m_overviewBlocks )
+	{
+		return false;
+	}
+	if( m_scanFile == NULL )
+	{
+		SF_INFO info;
+		info.format = 0;
+		if( !m_scanQFile.open( QIODevice::ReadOnly ) ||
+			( m_scanFile = sf_open_fd( m_scanQFile.handle(),
+					SFM_READ, &info, false ) ) == NULL )
+		{
+			// leave the overview flat
+			m_overviewScanned.store( m_overviewBlocks );
+			return false;
+		}
+	}
+
+	// a few blocks at a time so reading ahead isn't held up
+	const int channels = m_info.channels;
+	const int right = channels > 1 ? 1 : 0;
+	for( int i = 0; i < 64 && block < m_overviewBlocks; ++i, ++block )
+	{
+		const sf_count_t begin = static_cast<sf_count_t>(
+				block * (double) OverviewBlock / m_ratio );
+		const sf_count_t end = static_cast<sf_count_t>(
+				( block + 1 ) * (double) OverviewBlock / m_ratio );
+		float left = 0;
+		float rightPeak = 0;
+		for( sf_count_t pos = begin; pos < end; )
+		{
+			const sf_count_t count = sf_readf_float( m_scanFile,
+				m_fileBuffer,
+				qMin<sf_count_t>( end - pos, FileChunkFrames ) );
+			if( count <= 0 )
+			{
+				break;
+			}
+			for( sf_count_t f = 0; f < count; ++f )
+			{
+				left = qMax( left, qAbs( m_fileBuffer[f * channels] ) );
+				rightPeak = qMax( rightPeak,
+					qAbs( m_fileBuffer[f * channels + right] ) );
+			}
+			pos += count;
+		}
+		m_overview[block][0] = left;
+		m_overview[block][1] = rightPeak;
+	}
+	m_overviewScanned.store( block, std::memory_order_release );
+	return true;
+}
@@ -0,0 +1,103 @@
+/*
+ * ScratchArena.cpp - temporary buffers for rendering which don't go through
+ *                    the allocator
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "ScratchArena.h"
+
+#include <QtCore/QtGlobal>
+
+#include <cstdlib>
+
+#include "RealtimeChecker.h"
+
+
+// keeps SIMD loads on scratch buffers aligned
+static const size_t Alignment = 16;
+
+
+namespace
+{
+
+struct Arena
+{
+	Arena() :
+		begin( NULL ),
+		top( NULL )
+	{
+	}
+
+	~Arena()
+	{
+		// plain free() as the MemoryManager of this thread may be gone
+		// already
+		free( begin );
+	}
+
+	char * begin;
+	char * top;
+} ;
+
+}
+
+
+static thread_local Arena s_arena;
+
+
+
+
+void ScratchArena::prepareThread()
+{
+	if( s_arena.begin == NULL )
+	{
+		// only happens once per thread
+		RealtimeChecker::Allowed allowed;
+		s_arena.begin = static_cast<char *>( malloc( Capacity ) );
+		s_arena.top = s_arena.begin;
+	}
+}
+
+
+
+
+void * ScratchArena::push( size_t _bytes )
+{
+	prepareThread();
+
+	const size_t bytes = ( _bytes + Alignment - 1 ) & ~( Alignment - 1 );
+	if( s_arena.begin == NULL ||
+		bytes > static_cast<size_t>( s_arena.begin + Capacity - s_arena.top ) )
+	{
+		return NULL;
+	}
+	void * ptr = s_arena.top;
+	s_arena.top += bytes;
+	return ptr;
+}
+
+
+
+
+void ScratchArena::pop( void * _ptr )
+{
+	Q_ASSERT( _ptr >= s_arena.begin && _ptr <= s_arena.top );
+	s_arena.top = static_cast<char *>( _ptr );
+}
@@ -0,0 +1,261 @@
+/*
+ * SegmentStitcher.cpp - joins segments of a song rendered separately
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "SegmentStitcher.h"
+
+#include <QtCore/QFile>
+
+#include <sndfile.h>
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+#include "AudioFileDevice.h"
+
+
+namespace
+{
+
+// frames read and written at once
+const f_cnt_t ChunkSize = 4096;
+
+
+//! A segment file opened for reading through its file handle, which also
+//! works for unicode file names on Windows
+class SegmentFile
+{
+public:
+	SegmentFile( const QString & _name ) :
+		m_file( _name ),
+		m_sf( NULL )
+	{
+		memset( &m_info, 0, sizeof( m_info ) );
+		if( m_file.open( QIODevice::ReadOnly ) )
+		{
+			m_sf = sf_open_fd( m_file.handle(), SFM_READ, &m_info,
+									false );
+		}
+	}
+
+	~SegmentFile()
+	{
+		if( m_sf )
+		{
+			sf_close( m_sf );
+		}
+	}
+
+	bool isOpen() const
+	{
+		return m_sf != NULL &&
+			( m_info.channels == 1 || m_info.channels == 2 );
+	}
+
+	const SF_INFO & info() const
+	{
+		return m_info;
+	}
+
+	//! Reads _frames frames as stereo, returns false if they're not there
+	bool seek( f_cnt_t _frame )
+	{
+		return sf_seek( m_sf, _frame, SEEK_SET ) == _frame;
+	}
+
+	bool read( surroundSampleFrame * _dst, f_cnt_t _frames )
+	{
+		float buf[ChunkSize * 2];
+		const int channels = m_info.channels;
+		while( _frames > 0 )
+		{
+			const f_cnt_t n = qMin( _frames, ChunkSize );
+			if( sf_readf_float( m_sf, buf, n ) != n )
+			{
+				return false;
+			}
+			for( f_cnt_t f = 0; f < n; ++f )
+			{
+				_dst[f][0] = buf[f * channels];
+				_dst[f][1] = buf[f * channels + channels - 1];
+			}
+			_dst += n;
+			_frames -= n;
+		}
+		return true;
+	}
+
+
+private:
+	QFile m_file;
+	SF_INFO m_info;
+	SNDFILE * m_sf;
+
+} ;
+
+}
+
+
+
+
+SegmentStitcher::SegmentStitcher( const QStringList & _segments,
+							f_cnt_t _crossfade ) :
+	m_crossfade( qMax<f_cnt_t>( _crossfade, 0 ) ),
+	m_sampleRate( 0 )
+{
+	for( const QString & name : _segments )
+	{
+		m_segments.push_back( Segment{ name, 0, -1 } );
+	}
+}
+
+
+
+
+SegmentStitcher::SegmentStitcher( const QVector<Segment> & _segments,
+							f_cnt_t _crossfade ) :
+	m_segments( _segments ),
+	m_crossfade( qMax<f_cnt_t>( _crossfade, 0 ) ),
+	m_sampleRate( 0 )
+{
+}
+
+
+
+
+bool SegmentStitcher::open()
+{
+	if( m_segments.isEmpty() )
+	{
+		m_error = "No segments given";
+		return false;
+	}
+
+	for( const Segment & part : m_segments )
+	{
+		const QString & name = part.file;
+		SegmentFile segment( name );
+		if( !segment.isOpen() || part.begin < 0 ||
+					part.begin > segment.info().frames )
+		{
+			m_error = QString( "Can't read %1" ).arg( name );
+			return false;
+		}
+		const sample_rate_t rate = segment.info().samplerate;
+		if( m_sampleRate == 0 )
+		{
+			m_sampleRate = rate;
+		}
+		else if( rate != m_sampleRate )
+		{
+			m_error = QString( "%1 has a sample rate of %2 Hz "
+					"instead of %3 Hz" ).arg( name ).
+					arg( rate ).arg( m_sampleRate );
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+
+bool SegmentStitcher::stitch( AudioFileDevice * _device )
+{
+	m_differences.clear();
+
+	std::unique_ptr<surroundSampleFrame[]> chunk(
+					new surroundSampleFrame[ChunkSize] );
+	// end of the previous segment, still to be crossfaded
+	std::unique_ptr<surroundSampleFrame[]> tail(
+				new surroundSampleFrame[m_crossfade + 1] );
+	f_cnt_t tailFrames = 0;
+
+	for( int i = 0; i < m_segments.size(); ++i )
+	{
+		const Segment & part = m_segments[i];
+		SegmentFile segment( part.file );
+		if( !segment.isOpen() || !segment.seek( part.begin ) )
+		{
+			m_error = QString( "Can't read %1" ).arg( part.file );
+			return false;
+		}
+		const f_cnt_t available = segment.info().frames - part.begin;
+		const f_cnt_t frames = part.frames < 0 ? available :
+					qMin( part.frames, available );
+		const bool last = i == m_segments.size() - 1;
+
+		// the start of the segment overlaps the tail of the one before
+		const f_cnt_t head = qMin( tailFrames, frames );
+		const f_cnt_t keep = last ? 0 : qMin( m_crossfade, frames - head );
+
+		float difference = 0.0f;
+		for( f_cnt_t done = 0; done < head; )
+		{
+			const f_cnt_t n = qMin( head - done, ChunkSize );
+			if( !segment.read( chunk.get(), n ) )
+			{
+				m_error = QString( "Can't read %1" ).arg( part.file );
+				return false;
+			}
+			for( f_cnt_t f = 0; f < n; ++f )
+			{
+				// linear crossfade from the previous segment
+				const float t = ( done + f + 0.5f ) / head;
+				for( int ch = 0; ch < 2; ++ch )
+				{
+					const float a = tail[done + f][ch];
+					const float b = chunk[f][ch];
+					difference = qMax( difference, fabsf( a - b ) );
+					chunk[f][ch] = a + ( b - a ) * t;
+				}
+			}
+			_device->writeFrames( chunk.get(), n );
+			done += n;
+		}
+		if( i > 0 )
+		{
+			m_differences.push_back( difference );
+		}
+
+		for( f_cnt_t left = frames - head - keep; left > 0; )
+		{
+			const f_cnt_t n = qMin( left, ChunkSize );
+			if( !segment.read( chunk.get(), n ) )
+			{
+				m_error = QString( "Can't read %1" ).arg( part.file );
+				return false;
+			}
+			_device->writeFrames( chunk.get(), n );
+			left -= n;
+		}
+
+		if( !segment.read( tail.get(), keep ) )
+		{
+			m_error = QString( "Can't read %1" ).arg( part.file );
+			return false;
+		}
+		tailFrames = keep;
+	}
+
+	return true;
+}
@@ -30,7 +30,9 @@
 #include <QFileInfo>
 #include <QMessageBox>
 
+#include <algorithm>
 #include <functional>
+#include <vector>
 
 #include "AutomationTrack.h"
 #include "AutomationEditor.h"
@@ -46,12 +48,17 @@
 #include "FxMixerView.h"
 #include "GuiApplication.h"
 #include "ExportFilter.h"
+#include "InstrumentTrack.h"
+#include "NotePlayHandle.h"
 #include "Pattern.h"
 #include "PianoRoll.h"
 #include "ProjectJournal.h"
 #include "ProjectNotes.h"
+#include "SampleBuffer.h"
+#include "ScratchArena.h"
 #include "SongEditor.h"
 #include "TimeLineWidget.h"
+#include "TraceRecorder.h"
 #include "PeakController.h"
 
 
@@ -81,6 +88,7 @@ Song::Song() :
 	m_playing( false ),
 	m_paused( false ),
 	m_savingProject( false ),
+	m_trackSnapshots( NULL ),
 	m_loadingProject( false ),
 	m_isCancelled( false ),
 	m_playMode( Mode_None ),
@@ -90,9 +98,17 @@ Song::Song() :
 	m_elapsedTicks( 0 ),
 	m_elapsedBars( 0 ),
 	m_loopRenderCount(1),
-	m_loopRenderRemaining(1)
+	m_loopRenderRemaining(1),
+	m_hasExportRange( false ),
+	m_exportRangeTail( 0 ),
+	m_exportRangeFirst( 0 ),
+	m_exportRangeLast( 0 ),
+	m_anticipating( false )
 {
 	for(int i = 0; i < Mode_Count; ++i) m_elapsedMilliSeconds[i] = 0;
+	// a period has a few ticks at most, don't allocate while playing
+	m_schedule.reserve( 64 );
+	m_aheadSchedule.reserve( 64 );
 	connect( &m_tempoModel, SIGNAL( dataChanged() ),
 			this, SLOT( setTempo() ), Qt::DirectConnection );
 	connect( &m_tempoModel, SIGNAL( dataUnchanged() ),
@@ -136,22 +152,9 @@ void Song::masterVolumeChanged()
 
 void Song::setTempo()
 {
-	Engine::mixer()->requestChangeInModel();
 	const bpm_t tempo = ( bpm_t ) m_tempoModel.value();
-	PlayHandleList & playHandles = Engine::mixer()->playHandles();
-	for( PlayHandleList::Iterator it = playHandles.begin();
-						it != playHandles.end(); ++it )
-	{
-		NotePlayHandle * nph = dynamic_cast<NotePlayHandle *>( *it );
-		if( nph && !nph->isReleased() )
-		{
-			nph->lock();
-			nph->resize( tempo );
-			nph->unlock();
-		}
-	}
-	Engine::mixer()->doneChangeInModel();
 
+	// notes pick up the new tempo on their own in their next period
 	Engine::updateFramesPerTick();
 
 	m_vstSyncController.setTempo( tempo );
@@ -191,8 +194,21 @@ void Song::savePos()
 
 void Song::processNextBuffer()
 {
+	TraceRecorder::Zone zone( "Song::processNextBuffer" );
+
 	m_vstSyncController.setPlaybackJumped( false );
 
+	// before the check below, so the caches notice when the song stopped
+	Engine::getBBTrackContainer()->startPeriod();
+
+	// tracks only get played ahead when playing the song
+	if( m_anticipating && ( m_playing == false ||
+					m_playMode != Mode_PlaySong ) )
+	{
+		m_anticipating = false;
+		setAnticipated( false );
+	}
+
 	// if not playing, nothing to do
 	if( m_playing == false )
 	{
@@ -246,6 +262,54 @@ void Song::processNextBuffer()
 		return;
 	}
 
+	const bool anticipate = m_playMode == Mode_PlaySong && !m_exporting &&
+				Engine::mixer()->anticipativeRendering();
+
+	if( !m_anticipating )
+	{
+		const MidiTime periodStart = m_playPos[m_playMode];
+		advancePlayPos( m_schedule );
+		if( m_exporting && m_hasExportRange )
+		{
+			updateExportRangeFrames( periodStart, m_schedule );
+		}
+		playSchedule( m_schedule, trackList, tcoNum, true, true );
+		if( !anticipate )
+		{
+			return;
+		}
+		// from now on tracks without live input are played one period
+		// ahead (see Mixer::startAnticipativeJobs()), so this time they
+		// play both periods
+		m_anticipating = true;
+		setAnticipated( true );
+	}
+	else
+	{
+		// the tracks played ahead already played this period
+		std::swap( m_schedule, m_aheadSchedule );
+		playSchedule( m_schedule, trackList, tcoNum, true, false );
+		if( !anticipate )
+		{
+			m_anticipating = false;
+			setAnticipated( false );
+			return;
+		}
+	}
+
+	advancePlayPos( m_aheadSchedule );
+	Engine::mixer()->setAddingAheadPlayHandles( true );
+	playSchedule( m_aheadSchedule, trackList, tcoNum, false, true );
+	Engine::mixer()->setAddingAheadPlayHandles( false );
+}
+
+
+
+
+void Song::advancePlayPos( PlaybackSchedule & _schedule )
+{
+	_schedule.clear();
+
 	// check for looping-mode and act if necessary
 	TimeLineWidget * tl = m_playPos[m_playMode].m_timeLine;
 	bool checkLoop =
@@ -275,7 +339,7 @@ void Song::processNextBuffer()
 	}
 
 	f_cnt_t framesPlayed = 0;
-	const float framesPerTick = Engine::framesPerTick();
+	const float framesPerTick = Engine::periodFramesPerTick();
 
 	while( framesPlayed < Engine::mixer()->framesPerPeriod() )
 	{
@@ -393,15 +457,8 @@ void Song::processNextBuffer()
 
 		if( ( f_cnt_t ) currentFrame == 0 )
 		{
-			processAutomations(trackList, m_playPos[m_playMode], framesToPlay);
-
-			// loop through all tracks and play them
-			for( int i = 0; i < trackList.size(); ++i )
-			{
-				trackList[i]->play( m_playPos[m_playMode],
-						framesToPlay,
-						framesPlayed, tcoNum );
-			}
+			_schedule.push_back( PlaybackChunk{ m_playPos[m_playMode],
+						framesToPlay, framesPlayed } );
 		}
 
 		// update frame-counters
@@ -415,10 +472,99 @@ void Song::processNextBuffer()
 }
 
 
-void Song::processAutomations(const TrackList &tracklist, MidiTime timeStart, fpp_t)
+
+
+void Song::updateExportRangeFrames( const MidiTime & _periodStart,
+					const PlaybackSchedule & _schedule )
 {
-	AutomatedValueMap values;
+	// ticks start with the chunks of the schedule, the frames before the
+	// first one belong to the tick the period started in
+	const f_cnt_t fpp = Engine::mixer()->framesPerPeriod();
+	f_cnt_t first = _periodStart >= m_exportRangeBegin ? 0 : fpp;
+	f_cnt_t last = _periodStart >= m_exportRangeEnd ? 0 : fpp;
+	m_exportRangeBars.clear();
+	for( const PlaybackChunk & chunk : _schedule )
+	{
+		if( chunk.start >= m_exportRangeBegin &&
+			chunk.start <= m_exportRangeEnd &&
+			chunk.start.getTicks() % MidiTime::ticksPerBar() == 0 )
+		{
+			m_exportRangeBars.push_back( chunk.offset );
+		}
+		if( first == fpp && chunk.start >= m_exportRangeBegin )
+		{
+			first = chunk.offset;
+		}
+		if( last == fpp && chunk.start >= m_exportRangeEnd )
+		{
+			last = chunk.offset;
+		}
+	}
+	m_exportRangeFirst = first;
+	m_exportRangeLast = qMax( first, last );
+}
+
+
+
+
+void Song::playSchedule( const PlaybackSchedule & _schedule,
+				const TrackList & _tracks, int _tcoNum,
+				bool _live, bool _anticipated )
+{
+	for( const PlaybackChunk & chunk : _schedule )
+	{
+		// automation follows the live tracks
+		if( _live )
+		{
+			processAutomations( _tracks, chunk,
+						&chunk == &_schedule.front() );
+		}
+
+		// loop through all tracks and play them
+		for( Track * track : _tracks )
+		{
+			if( isAnticipated( track ) ? _anticipated : _live )
+			{
+				track->play( chunk.start, chunk.frames,
+							chunk.offset, _tcoNum );
+			}
+		}
+	}
+}
+
+
+
+
+bool Song::isAnticipated( Track * _track )
+{
+	return _track->type() == Track::InstrumentTrack &&
+		static_cast<InstrumentTrack *>( _track )->
+					audioPort()->isAnticipative();
+}
+
+
+
+
+void Song::setAnticipated( bool _anticipated )
+{
+	for( Track * track : tracks() )
+	{
+		if( track->type() == Track::InstrumentTrack )
+		{
+			InstrumentTrack * instrumentTrack =
+					static_cast<InstrumentTrack *>( track );
+			// frozen tracks hardly take any time
+			instrumentTrack->audioPort()->setAnticipative( _anticipated &&
+					!instrumentTrack->hasLiveInput() &&
+					!instrumentTrack->isFrozen() );
+		}
+	}
+}
+
 
+void Song::processAutomations(const TrackList &tracklist, const PlaybackChunk& chunk, bool firstChunk)
+{
+	const MidiTime timeStart = chunk.start;
 	QSet<const AutomatableModel*> recordedModels;
 
 	TrackContainer* container = this;
@@ -442,21 +588,11 @@ void Song::processAutomations(const TrackList &tracklist, MidiTime timeStart, fp
 		return;
 	}
 
-	values = container->automatedValuesAt(timeStart, tcoNum);
-	TrackList tracks = container->tracks();
-
-	Track::tcoVector tcos;
-	for (Track* track : tracks)
-	{
-		if (track->type() == Track::AutomationTrack) {
-			track->getTCOsInRange(tcos, 0, timeStart);
-		}
-	}
+	AutomationIndex& index = container->automationIndex();
 
 	// Process recording
-	for (TrackContentObject* tco : tcos)
+	for (AutomationPattern* p : index.recordingPatterns())
 	{
-		auto p = dynamic_cast<AutomationPattern *>(tco);
 		MidiTime relTime = timeStart - p->startPosition();
 		if (p->isRecording() && relTime >= 0 && relTime < p->length())
 		{
@@ -468,6 +604,41 @@ void Song::processAutomations(const TrackList &tracklist, MidiTime timeStart, fp
 	}
 
 	// Apply values
+	if (tcoNum < 0)
+	{
+		// render the patterns in between ticks, from the first frame of
+		// the period at the first chunk
+		const fpp_t framesPerPeriod = Engine::mixer()->framesPerPeriod();
+		const float ticksPerFrame = 1.0f / Engine::framesPerTick();
+		const f_cnt_t offset = firstChunk ? 0 : chunk.offset;
+		const fpp_t frames = framesPerPeriod - offset;
+		ScratchBuffer<float> buffer(frames);
+
+		for (const auto& value : index.valuesAt(timeStart))
+		{
+			if (recordedModels.contains(value.model))
+			{
+				continue;
+			}
+			value.model->setAutomatedValue(value.value);
+
+			if (value.pattern)
+			{
+				const float time = timeStart - value.pattern->startPosition() -
+						(chunk.offset - offset) * ticksPerFrame;
+				// later chunks overwrite what earlier ones rendered, in
+				// case the play position jumped
+				if (value.pattern->renderValues(buffer.data(), time,
+							ticksPerFrame, frames) || !firstChunk)
+				{
+					value.model->setAutomatedValues(buffer.data(), offset);
+				}
+			}
+		}
+		return;
+	}
+
+	AutomatedValueMap values = container->automatedValuesAt(timeStart, tcoNum);
 	for (auto it = values.begin(); it != values.end(); it++)
 	{
 		if (! recordedModels.contains(it.key()))
@@ -525,6 +696,9 @@ void Song::playSong()
 {
 	m_recording = false;
 
+	// sample tracks would be silent until their samples are decoded
+	SampleBuffer::waitForDecoding();
+
 	if( isStopped() == false )
 	{
 		stop();
@@ -564,6 +738,8 @@ void Song::playAndRecord()
 
 void Song::playBB()
 {
+	SampleBuffer::waitForDecoding();
+
 	if( isStopped() == false )
 	{
 		stop();
@@ -741,10 +917,38 @@ void Song::stop()
 
 
 
+void Song::setExportRange( const MidiTime & _begin, const MidiTime & _end,
+				const MidiTime & _preRoll, f_cnt_t _tailFrames )
+{
+	m_hasExportRange = true;
+	m_exportRangeBegin = _begin;
+	m_exportRangeEnd = qMax( _begin, _end );
+	m_exportPreRoll = _preRoll;
+	m_exportRangeTail = qMax<f_cnt_t>( _tailFrames, 0 );
+}
+
+
+
+
 void Song::startExport()
 {
+	SampleBuffer::waitForDecoding();
 	stop();
-	if (m_renderBetweenMarkers)
+	if (m_hasExportRange)
+	{
+		// play the range once, without loops, from the start of the
+		// pre-roll on
+		m_exportSongBegin = m_exportLoopBegin = m_exportLoopEnd = m_exportRangeBegin;
+		m_exportSongEnd = m_exportRangeEnd;
+		m_loopRenderCount = 1;
+
+		const tick_t start = m_exportRangeBegin.getTicks() - m_exportPreRoll.getTicks();
+		m_playPos[Mode_PlaySong].setTicks( qMax<tick_t>( start, 0 ) );
+		m_exportRangeFirst = m_exportRangeLast = 0;
+		m_exportRangeBars.clear();
+		m_exportRangeBars.reserve( DEFAULT_BUFFER_SIZE );
+	}
+	else if (m_renderBetweenMarkers)
 	{
 		m_exportSongBegin = m_exportLoopBegin = m_playPos[Mode_PlaySong].m_timeLine->loopBegin();
 		m_exportSongEnd = m_exportLoopEnd = m_playPos[Mode_PlaySong].m_timeLine->loopEnd();
@@ -868,14 +1072,6 @@ AutomationPattern * Song::tempoAutomationPattern()
 }
 
 
-AutomatedValueMap Song::automatedValuesAt(MidiTime time, int tcoNum) const
-{
-	return TrackContainer::automatedValuesFromTracks(TrackList{m_globalAutomationTrack} << tracks(), time, tcoNum);
-}
-
-
-
-
 void Song::clearProject()
 {
 	Engine::projectJournal()->setJournalling( false );
@@ -1033,6 +1229,75 @@ void Song::createNewProjectFromTemplate( const QString & templ )
 
 
 // load given song
+// the most notes of any pattern overlapping at a time, summed over all
+// instrument tracks
+static int maxPolyphony( const TrackContainer::TrackList & _tracks )
+{
+	int polyphony = 0;
+	for( const Track * track : _tracks )
+	{
+		if( track->type() != Track::InstrumentTrack )
+		{
+			continue;
+		}
+		int trackPolyphony = 0;
+		for( const TrackContentObject * tco : track->getTCOs() )
+		{
+			const Pattern * pattern = dynamic_cast<const Pattern *>( tco );
+			if( pattern == NULL )
+			{
+				continue;
+			}
+			// +1 at the start of each note, -1 at its end
+			std::vector<std::pair<int, int> > edges;
+			for( const Note * note : pattern->notes() )
+			{
+				edges.push_back( std::make_pair( note->pos(), 1 ) );
+				edges.push_back( std::make_pair( note->pos() +
+						qMax<int>( note->length(), 1 ), -1 ) );
+			}
+			// ends sort before starts at the same position
+			std::sort( edges.begin(), edges.end() );
+			int playing = 0;
+			for( const std::pair<int, int> & edge : edges )
+			{
+				playing += edge.second;
+				trackPolyphony = qMax( trackPolyphony, playing );
+			}
+		}
+		polyphony += trackPolyphony;
+	}
+	return polyphony;
+}
+
+
+
+
+
+// the files of the AudioFileProcessors and, if _sampleTracks, the sample
+// tracks below _element, which are loaded from src unless their data is
+// embedded
+static void collectSampleFiles( const QDomElement & _element,
+				bool _sampleTracks, QStringList & _files )
+{
+	for( QDomElement el = _element.firstChildElement(); !el.isNull();
+						el = el.nextSiblingElement() )
+	{
+		const QString file = el.attribute( "src" );
+		if( !file.isEmpty() && ( ( _sampleTracks &&
+					el.tagName() == "sampletco" ) ||
+				el.tagName() == "audiofileprocessor" ) &&
+						!_files.contains( file ) )
+		{
+			_files.push_back( file );
+		}
+		collectSampleFiles( el, _sampleTracks, _files );
+	}
+}
+
+
+
+
 void Song::loadProject( const QString & fileName )
 {
 	QDomNode node;
@@ -1063,6 +1328,15 @@ void Song::loadProject( const QString & fileName )
 
 	clearErrors();
 
+	// the samples are decoded on all cores up front, the tracks loading
+	// them one after the other just share the decoded data then. In the
+	// GUI, sample tracks decode theirs in the background instead, see
+	// SampleBuffer::setBackgroundDecoding().
+	QStringList sampleFiles;
+	collectSampleFiles( dataFile.content(), gui == NULL, sampleFiles );
+	const QList<SampleBuffer *> prefetched =
+				SampleBuffer::prefetch( sampleFiles );
+
 	Engine::mixer()->requestChangeInModel();
 
 	// get the header information from the DOM
@@ -1175,9 +1449,21 @@ void Song::loadProject( const QString & fileName )
 	// resolve all IDs so that autoModels are automated
 	AutomationPattern::resolveAllIDs();
 
+	// so the note pool doesn't have to grow while playing, twice the
+	// polyphony leaves room for chords, arpeggios and release phases
+	if( ConfigManager::inst()->value( "mixer", "reservenotes", "1" ).toInt() )
+	{
+		NotePlayHandleManager::reserve( 2 * ( maxPolyphony( tracks() ) +
+			maxPolyphony( Engine::getBBTrackContainer()->tracks() ) ) );
+	}
 
 	Engine::mixer()->doneChangeInModel();
 
+	for( SampleBuffer * buffer : prefetched )
+	{
+		sharedObject::unref( buffer );
+	}
+
 	ConfigManager::inst()->addRecentlyOpenedProject( fileName );
 
 	Engine::projectJournal()->setJournalling( true );
@@ -1214,7 +1500,17 @@ void Song::loadProject( const QString & fileName )
 bool Song::saveProjectFile( const QString & filename )
 {
 	DataFile dataFile( DataFile::SongProject );
+	saveProject( dataFile );
+	return dataFile.writeFile( filename );
+}
+
+
+
+
+void Song::saveProject( DataFile & dataFile, TrackSnapshots * snapshots )
+{
 	m_savingProject = true;
+	m_trackSnapshots = snapshots;
 
 	m_tempoModel.saveSettings( dataFile, dataFile.head(), "bpm" );
 	m_timeSigModel.saveSettings( dataFile, dataFile.head(), "timesig" );
@@ -1236,9 +1532,8 @@ bool Song::saveProjectFile( const QString & filename )
 
 	saveControllerStates( dataFile, dataFile.content() );
 
+	m_trackSnapshots = NULL;
 	m_savingProject = false;
-
-	return dataFile.writeFile( filename );
 }
 
 
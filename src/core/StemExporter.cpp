@@ -0,0 +1,233 @@
+/*
+ * StemExporter.cpp - writes tracks and FX channels to files of their own
+ *                    while the song is rendered once
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "StemExporter.h"
+
+#include <cstring>
+
+#include "AudioPort.h"
+#include "BufferManager.h"
+#include "Engine.h"
+#include "FxMixer.h"
+#include "MixHelpers.h"
+#include "Mixer.h"
+
+
+StemTap::StemTap() :
+	m_buffer( BufferManager::acquire() ),
+	m_captured( false )
+{
+	BufferManager::clear( m_buffer, Engine::mixer()->framesPerPeriod() );
+}
+
+
+
+
+StemTap::~StemTap()
+{
+	BufferManager::release( m_buffer );
+}
+
+
+
+
+void StemTap::capture( const sampleFrame * _buf, fpp_t _frames, float _gain )
+{
+	if( _gain == 1.0f )
+	{
+		memcpy( m_buffer, _buf, sizeof( sampleFrame ) * _frames );
+	}
+	else
+	{
+		for( fpp_t f = 0; f < _frames; ++f )
+		{
+			m_buffer[f][0] = _buf[f][0] * _gain;
+			m_buffer[f][1] = _buf[f][1] * _gain;
+		}
+	}
+	m_captured = true;
+}
+
+
+
+
+void StemTap::captureSum( const sampleFrame * const * _buffers, int _count,
+								fpp_t _frames )
+{
+	MixHelpers::sumMultipliedByGains( m_buffer, _buffers, _count, NULL,
+								_frames );
+	m_captured = true;
+}
+
+
+
+
+void StemTap::clear()
+{
+	if( m_captured )
+	{
+		BufferManager::clear( m_buffer, Engine::mixer()->framesPerPeriod() );
+		m_captured = false;
+	}
+}
+
+
+
+
+StemExporter::StemExporter( AudioFileDeviceInstantiaton _factory,
+				const OutputSettings & _outputSettings ) :
+	m_factory( _factory ),
+	m_outputSettings( _outputSettings )
+{
+}
+
+
+
+
+StemExporter::~StemExporter()
+{
+	Engine::mixer()->requestChangeInModel();
+	for( const std::unique_ptr<Stem> & stem : m_stems )
+	{
+		if( stem->port )
+		{
+			stem->port->setStemTap( NULL, false );
+		}
+		if( stem->channel )
+		{
+			stem->channel->m_stemTap = NULL;
+		}
+	}
+	Engine::mixer()->doneChangeInModel();
+
+	// the file devices finish their files when they're deleted
+	m_stems.clear();
+}
+
+
+
+
+bool StemExporter::addPort( AudioPort * _port, TapPoints _tapPoint,
+							const QString & _file )
+{
+	if( !addStem( _port, NULL, _file ) )
+	{
+		return false;
+	}
+
+	Engine::mixer()->requestChangeInModel();
+	_port->setStemTap( &m_stems.back()->tap, _tapPoint == PreEffects );
+	Engine::mixer()->doneChangeInModel();
+	return true;
+}
+
+
+
+
+bool StemExporter::addFxChannel( FxChannel * _channel, const QString & _file )
+{
+	if( !addStem( NULL, _channel, _file ) )
+	{
+		return false;
+	}
+
+	Engine::mixer()->requestChangeInModel();
+	_channel->m_stemTap = &m_stems.back()->tap;
+	Engine::mixer()->doneChangeInModel();
+	return true;
+}
+
+
+
+
+QStringList StemExporter::files() const
+{
+	QStringList files;
+	for( const std::unique_ptr<Stem> & stem : m_stems )
+	{
+		files << stem->device->outputFile();
+	}
+	return files;
+}
+
+
+
+
+void StemExporter::applyQualitySettings()
+{
+	for( const std::unique_ptr<Stem> & stem : m_stems )
+	{
+		stem->device->applyQualitySettings();
+	}
+}
+
+
+
+
+void StemExporter::writePeriod()
+{
+	for( const std::unique_ptr<Stem> & stem : m_stems )
+	{
+		stem->device->processBuffer( stem->tap.buffer(), 1.0f );
+		stem->tap.clear();
+	}
+}
+
+
+
+
+void StemExporter::skipPeriod()
+{
+	for( const std::unique_ptr<Stem> & stem : m_stems )
+	{
+		stem->tap.clear();
+	}
+}
+
+
+
+
+bool StemExporter::addStem( AudioPort * _port, FxChannel * _channel,
+							const QString & _file )
+{
+	if( !m_factory )
+	{
+		return false;
+	}
+
+	bool successful = false;
+	AudioFileDevice * device = m_factory( _file, m_outputSettings,
+				DEFAULT_CHANNELS, Engine::mixer(), successful );
+	if( !successful )
+	{
+		delete device;
+		return false;
+	}
+
+	std::unique_ptr<Stem> stem( new Stem );
+	stem->device.reset( device );
+	stem->port = _port;
+	stem->channel = _channel;
+	m_stems.push_back( std::move( stem ) );
+	return true;
+}
@@ -228,14 +228,13 @@ void StepRecorder::applyStep()
 {
 	m_pattern->addJournalCheckPoint();
 
+	QVector<Note> notes;
 	for (const StepNote* stepNote : m_curStepNotes)
 	{
-		m_pattern->addNote(stepNote->m_note, false);
+		notes.push_back(stepNote->m_note);
 	}
+	m_pattern->addNotes(notes, false);
 
-	m_pattern->rearrangeAllNotes();
-	m_pattern->updateLength();
-	m_pattern->dataChanged();
 	Engine::getSong()->setModified();
 
 	prepareNewStep();
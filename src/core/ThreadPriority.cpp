@@ -0,0 +1,295 @@
+/*
+ * ThreadPriority.cpp - helpers for scheduling priority and CPU affinity of
+ *                      audio threads
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "ThreadPriority.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QStringList>
+#include <QtCore/QThread>
+
+#include "lmmsconfig.h"
+
+#if defined(LMMS_BUILD_LINUX) || defined(LMMS_BUILD_FREEBSD)
+#include <pthread.h>
+#ifdef LMMS_HAVE_SCHED_H
+#include <sched.h>
+#endif
+#endif
+
+#ifdef LMMS_BUILD_LINUX
+#include <unistd.h>
+#endif
+
+#ifdef LMMS_BUILD_WIN32
+#include <windows.h>
+#endif
+
+#ifdef LMMS_BUILD_APPLE
+#include <pthread.h>
+#include <pthread/qos.h>
+#endif
+
+
+namespace ThreadPriority
+{
+
+
+// set the Qt priority of the calling thread, only works for threads started
+// by QThread
+static bool setQtPriority( QThread::Priority priority )
+{
+	QThread * thread = QThread::currentThread();
+	if( thread == NULL )
+	{
+		return false;
+	}
+	thread->setPriority( priority );
+	return true;
+}
+
+
+
+
+#ifdef LMMS_BUILD_WIN32
+// MMCSS lives in avrt.dll which isn't available everywhere, so look it up
+// at runtime instead of linking against it
+typedef HANDLE (WINAPI * AvSetMmThreadCharacteristicsProc)( LPCWSTR, LPDWORD );
+typedef BOOL (WINAPI * AvRevertMmThreadCharacteristicsProc)( HANDLE );
+
+static thread_local HANDLE s_mmcssHandle = NULL;
+
+static bool setMmcss( bool enable )
+{
+	static HMODULE avrt = LoadLibraryW( L"avrt.dll" );
+	if( avrt == NULL )
+	{
+		return false;
+	}
+
+	if( enable && s_mmcssHandle == NULL )
+	{
+		AvSetMmThreadCharacteristicsProc setCharacteristics =
+			(AvSetMmThreadCharacteristicsProc) GetProcAddress(
+					avrt, "AvSetMmThreadCharacteristicsW" );
+		DWORD taskIndex = 0;
+		if( setCharacteristics )
+		{
+			s_mmcssHandle = setCharacteristics( L"Pro Audio", &taskIndex );
+		}
+		return s_mmcssHandle != NULL;
+	}
+	else if( !enable && s_mmcssHandle != NULL )
+	{
+		AvRevertMmThreadCharacteristicsProc revertCharacteristics =
+			(AvRevertMmThreadCharacteristicsProc) GetProcAddress(
+					avrt, "AvRevertMmThreadCharacteristics" );
+		if( revertCharacteristics )
+		{
+			revertCharacteristics( s_mmcssHandle );
+		}
+		s_mmcssHandle = NULL;
+	}
+	return true;
+}
+#endif
+
+
+
+
+QString apply( Policy policy )
+{
+#if defined(LMMS_BUILD_LINUX) || defined(LMMS_BUILD_FREEBSD)
+#if defined(LMMS_HAVE_SCHED_H) && !defined(__OpenBSD__)
+	if( policy == Policy::RealTime )
+	{
+		// same priority main() tries to give the whole process
+		for( int sched : { SCHED_FIFO, SCHED_RR } )
+		{
+			struct sched_param sparam;
+			sparam.sched_priority = ( sched_get_priority_max( sched ) +
+					sched_get_priority_min( sched ) ) / 2;
+			if( pthread_setschedparam( pthread_self(), sched, &sparam ) == 0 )
+			{
+				return QString( "%1 priority %2" ).
+					arg( sched == SCHED_FIFO ? "SCHED_FIFO" : "SCHED_RR" ).
+					arg( sparam.sched_priority );
+			}
+		}
+		setQtPriority( QThread::TimeCriticalPriority );
+		return "normal scheduling (no permission for real-time scheduling)";
+	}
+
+	if( policy == Policy::Normal )
+	{
+		// leave real-time scheduling, e.g. one inherited from main()
+		struct sched_param sparam;
+		sparam.sched_priority = 0;
+		pthread_setschedparam( pthread_self(), SCHED_OTHER, &sparam );
+	}
+#ifdef LMMS_BUILD_LINUX
+	else
+	{
+		// go back to what the main thread got, in case we left it before
+		struct sched_param sparam;
+		const int sched = sched_getscheduler( getpid() );
+		if( sched >= 0 && sched_getparam( getpid(), &sparam ) == 0 )
+		{
+			pthread_setschedparam( pthread_self(), sched, &sparam );
+		}
+	}
+#endif
+#endif
+#endif
+
+#ifdef LMMS_BUILD_WIN32
+	if( policy == Policy::RealTime )
+	{
+		if( setMmcss( true ) )
+		{
+			return "MMCSS \"Pro Audio\"";
+		}
+		setQtPriority( QThread::TimeCriticalPriority );
+		return "time critical priority (MMCSS not available)";
+	}
+	setMmcss( false );
+#endif
+
+#ifdef LMMS_BUILD_APPLE
+	const qos_class_t qos = policy == Policy::Normal ?
+				QOS_CLASS_DEFAULT : QOS_CLASS_USER_INTERACTIVE;
+	if( pthread_set_qos_class_self_np( qos, 0 ) == 0 )
+	{
+		return policy == Policy::Normal ? "QoS default" :
+						"QoS user-interactive";
+	}
+#endif
+
+	switch( policy )
+	{
+		case Policy::RealTime:
+			// no real-time scheduling on this platform
+			setQtPriority( QThread::TimeCriticalPriority );
+			return "time critical priority (real-time not supported)";
+		case Policy::High:
+			setQtPriority( QThread::TimeCriticalPriority );
+			return "time critical priority";
+		case Policy::Normal:
+		default:
+			setQtPriority( QThread::NormalPriority );
+			return "normal priority";
+	}
+}
+
+
+
+
+QString pinToCore( int core )
+{
+#if defined(LMMS_BUILD_LINUX) && defined(LMMS_HAVE_SCHED_H)
+	cpu_set_t mask;
+	if( core < 0 )
+	{
+		// allow everything the process itself may run on
+		if( sched_getaffinity( getpid(), sizeof( mask ), &mask ) != 0 )
+		{
+			return "not pinned";
+		}
+	}
+	else
+	{
+		CPU_ZERO( &mask );
+		CPU_SET( core, &mask );
+	}
+	if( pthread_setaffinity_np( pthread_self(), sizeof( mask ), &mask ) != 0 )
+	{
+		return QString( "not pinned (core %1 not available)" ).arg( core );
+	}
+	return core < 0 ? "not pinned" : QString( "pinned to core %1" ).arg( core );
+#elif defined(LMMS_BUILD_WIN32)
+	DWORD_PTR processMask, systemMask;
+	if( !GetProcessAffinityMask( GetCurrentProcess(),
+						&processMask, &systemMask ) )
+	{
+		return "not pinned";
+	}
+	const DWORD_PTR mask = core < 0 ? processMask :
+					( (DWORD_PTR) 1 << core ) & processMask;
+	if( mask == 0 || SetThreadAffinityMask( GetCurrentThread(), mask ) == 0 )
+	{
+		return QString( "not pinned (core %1 not available)" ).arg( core );
+	}
+	return core < 0 ? "not pinned" : QString( "pinned to core %1" ).arg( core );
+#else
+	// macOS only has affinity hints, FreeBSD/OpenBSD aren't handled yet
+	return core < 0 ? "not pinned" : "not pinned (not supported)";
+#endif
+}
+
+
+
+
+QVector<int> isolatedCores()
+{
+	QVector<int> cores;
+#ifdef LMMS_BUILD_LINUX
+	// contains a list like "2-3,6" or is empty
+	QFile isolated( "/sys/devices/system/cpu/isolated" );
+	if( !isolated.open( QFile::ReadOnly ) )
+	{
+		return cores;
+	}
+	const QString list = QString::fromLatin1( isolated.readAll() ).trimmed();
+	for( const QString & range : list.split( ',', QString::SkipEmptyParts ) )
+	{
+		const QStringList bounds = range.split( '-' );
+		bool okFirst, okLast = true;
+		const int first = bounds.first().toInt( &okFirst );
+		const int last = bounds.size() > 1 ?
+					bounds.last().toInt( &okLast ) : first;
+		if( okFirst && okLast )
+		{
+			for( int core = first; core <= last; ++core )
+			{
+				cores << core;
+			}
+		}
+	}
+#endif
+	return cores;
+}
+
+
+
+
+QVector<int> allCores()
+{
+	QVector<int> cores;
+	for( int core = 0; core < QThread::idealThreadCount(); ++core )
+	{
+		cores << core;
+	}
+	return cores;
+}
+
+
+}
@@ -0,0 +1,239 @@
+/*
+ * TimeStretch.cpp - changes the tempo and pitch of a sample independently
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "TimeStretch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "interpolation.h"
+#include "lmms_constants.h"
+#include "MemoryManager.h"
+
+
+// the similarity is compared for every other offset over every fourth
+// frame first and then for the offsets next to the best one over all frames
+static const int CoarseOffsetStep = 2;
+static const int CoarseFrameStep = 4;
+// frames after the end of the stretched input for interpolating when
+// shifting the pitch
+static const f_cnt_t InterpolationMargin = 4;
+
+
+namespace
+{
+
+class Wsola
+{
+public:
+	Wsola( const sampleFrame * _in, f_cnt_t _frames,
+						sample_rate_t _sampleRate ) :
+		m_in( _in ),
+		m_frames( _frames ),
+		m_window( std::max( 2 * static_cast<int>( _sampleRate *
+			TimeStretch::WindowMilliseconds / 2000 ), 4 ) ),
+		m_hop( m_window / 2 ),
+		m_search( std::max( static_cast<int>( _sampleRate *
+			TimeStretch::SearchMilliseconds / 1000 ), 1 ) ),
+		m_pad( 2 * m_window + 2 * m_search )
+	{
+		// periodic Hann windows half a window apart add up to one
+		m_weights.resize( m_window );
+		for( int n = 0; n < m_window; ++n )
+		{
+			m_weights[n] = 0.5f - 0.5f * cosf( 2 * F_PI * n / m_window );
+		}
+
+		// the similarity is compared on a mono mix, zero around the input
+		m_mono.assign( m_frames + 2 * m_pad, 0.0f );
+		for( f_cnt_t f = 0; f < m_frames; ++f )
+		{
+			m_mono[m_pad + f] = m_in[f][0] + m_in[f][1];
+		}
+	}
+
+	//! Writes _outFrames frames of the input at _speed times the tempo
+	void stretch( double _speed, sampleFrame * _out, f_cnt_t _outFrames )
+	{
+		memset( _out, 0, _outFrames * sizeof( sampleFrame ) );
+
+		// the first window starts half a window before the output so
+		// the windows add up to one from the first frame on, and it's
+		// the input as it is there
+		f_cnt_t previous = -m_hop;
+		for( f_cnt_t outPos = -m_hop; outPos < _outFrames; outPos += m_hop )
+		{
+			f_cnt_t inPos = previous;
+			if( outPos > -m_hop )
+			{
+				// where centre of the window is in the input
+				const f_cnt_t nominal = clampStart( static_cast<f_cnt_t>(
+					llround( ( outPos + m_hop ) * _speed ) ) - m_hop );
+				inPos = bestMatch( clampStart( previous + m_hop ),
+								nominal );
+			}
+
+			const int first = static_cast<int>( std::max<f_cnt_t>( -outPos, 0 ) );
+			const int last = static_cast<int>( std::min<f_cnt_t>(
+						_outFrames - outPos, m_window ) );
+			for( int n = first; n < last; ++n )
+			{
+				const f_cnt_t i = inPos + n;
+				if( i < 0 || i >= m_frames )
+				{
+					continue;
+				}
+				_out[outPos + n][0] += m_weights[n] * m_in[i][0];
+				_out[outPos + n][1] += m_weights[n] * m_in[i][1];
+			}
+			previous = inPos;
+		}
+	}
+
+
+private:
+	//! Keeps windows starting at _start within the padded mono mix
+	f_cnt_t clampStart( f_cnt_t _start ) const
+	{
+		return std::min( std::max( _start, m_search - m_pad ),
+					m_frames + m_pad - m_window - m_search );
+	}
+
+	//! The start in the input within m_search frames of _nominal whose
+	//! window is most like the one at _natural, which is where the window
+	//! before continues
+	f_cnt_t bestMatch( f_cnt_t _natural, f_cnt_t _nominal ) const
+	{
+		const float * target = m_mono.data() + m_pad + _natural;
+		const float * around = m_mono.data() + m_pad + _nominal;
+
+		int best = 0;
+		float bestSimilarity = similarity( target, around, CoarseFrameStep );
+		for( int d = -m_search; d <= m_search; d += CoarseOffsetStep )
+		{
+			const float s = similarity( target, around + d,
+							CoarseFrameStep );
+			if( s > bestSimilarity )
+			{
+				bestSimilarity = s;
+				best = d;
+			}
+		}
+
+		const int coarse = best;
+		bestSimilarity = similarity( target, around + coarse, 1 );
+		for( int d = std::max( coarse - CoarseOffsetStep + 1, -m_search );
+			d <= std::min( coarse + CoarseOffsetStep - 1, m_search ); ++d )
+		{
+			const float s = similarity( target, around + d, 1 );
+			if( s > bestSimilarity )
+			{
+				bestSimilarity = s;
+				best = d;
+			}
+		}
+		return _nominal + best;
+	}
+
+	//! Cross-correlation of the windows at _a and _b over every _step-th
+	//! frame
+	float similarity( const float * _a, const float * _b, int _step ) const
+	{
+		float sum = 0.0f;
+		for( int n = 0; n < m_window; n += _step )
+		{
+			sum += _a[n] * _b[n];
+		}
+		return sum;
+	}
+
+	const sampleFrame * m_in;
+	const f_cnt_t m_frames;
+	const int m_window;
+	const int m_hop;
+	const int m_search;
+	// mono mix frames before and after the input
+	const f_cnt_t m_pad;
+	std::vector<float> m_weights;
+	std::vector<float> m_mono;
+
+} ;
+
+}
+
+
+
+
+f_cnt_t TimeStretch::stretchedFrames( f_cnt_t _frames, double _speed )
+{
+	return std::max<f_cnt_t>( static_cast<f_cnt_t>(
+					llround( _frames / _speed ) ), 1 );
+}
+
+
+
+
+sampleFrame * TimeStretch::process( const sampleFrame * _in, f_cnt_t _frames,
+					double _speed, int _semitones,
+					sample_rate_t _sampleRate )
+{
+	const f_cnt_t outFrames = stretchedFrames( _frames, _speed );
+	sampleFrame * out = MM_ALLOC_TAGGED( sampleFrame, outFrames,
+							SampleBuffers );
+	Wsola wsola( _in, _frames, _sampleRate );
+
+	if( _semitones == 0 )
+	{
+		wsola.stretch( _speed, out, outFrames );
+		return out;
+	}
+
+	// longer by the pitch ratio, which playing it faster by that ratio
+	// undoes and shifts the pitch
+	const double ratio = pow( 2.0, _semitones / 12.0 );
+	const f_cnt_t frames = stretchedFrames( _frames, _speed / ratio );
+	sampleFrame * stretched = MM_ALLOC_TAGGED( sampleFrame,
+				frames + InterpolationMargin, SampleBuffers );
+	wsola.stretch( _speed / ratio, stretched, frames );
+	memset( stretched + frames, 0,
+			InterpolationMargin * sizeof( sampleFrame ) );
+
+	for( f_cnt_t f = 0; f < outFrames; ++f )
+	{
+		const double pos = f * ratio;
+		const f_cnt_t i = std::min( static_cast<f_cnt_t>( pos ),
+							frames - 1 );
+		const float fraction = static_cast<float>( pos - i );
+		for( int ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+		{
+			out[f][ch] = hermiteInterpolate(
+					stretched[std::max<f_cnt_t>( i - 1, 0 )][ch],
+					stretched[i][ch], stretched[i + 1][ch],
+					stretched[i + 2][ch], fraction );
+		}
+	}
+	MM_FREE( stretched );
+
+	return out;
+}
@@ -0,0 +1,198 @@
+/*
+ * TraceRecorder.cpp - records timed zones of the audio threads for viewing
+ *                     them as timeline in chrome://tracing or Perfetto
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "TraceRecorder.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "RealtimeChecker.h"
+
+
+namespace
+{
+
+struct Event
+{
+	const char * name;
+	qint64 begin;
+	qint64 end;
+} ;
+
+
+struct ThreadBuffer
+{
+	ThreadBuffer( int _id, const QString & _name ) :
+		id( _id ),
+		name( _name ),
+		written( 0 )
+	{
+	}
+
+	const int id;
+	const QString name;
+	Event events[TraceRecorder::EventsPerThread];
+	// wraps around together with the index into events
+	std::atomic_uint written;
+} ;
+
+}
+
+
+// zones the owning thread may be overwriting while the trace is written
+static const unsigned int OverwriteMargin = 1024;
+
+// kept after their threads finished so their zones can still be written
+static QMutex s_buffersMutex;
+static std::vector<std::unique_ptr<ThreadBuffer> > s_buffers;
+
+static thread_local ThreadBuffer * s_threadBuffer = NULL;
+
+static std::atomic<qint64> s_recordingStart( 0 );
+
+std::atomic_bool TraceRecorder::s_recording( false );
+
+
+
+
+static ThreadBuffer * registerThread()
+{
+	// e.g. "MixerWorkerThread", or "QAdoptedThread" for threads of audio
+	// backends
+	QThread * thread = QThread::currentThread();
+	const QString name = thread->objectName().isEmpty() ?
+			QString( thread->metaObject()->className() ) :
+			thread->objectName();
+
+	// only happens once per thread
+	RealtimeChecker::Allowed allowed;
+	s_buffersMutex.lock();
+	s_buffers.emplace_back( new ThreadBuffer( s_buffers.size() + 1, name ) );
+	ThreadBuffer * buffer = s_buffers.back().get();
+	s_buffersMutex.unlock();
+
+	return buffer;
+}
+
+
+
+
+void TraceRecorder::setRecording( bool _recording )
+{
+	if( _recording )
+	{
+		s_recordingStart.store( now(), std::memory_order_relaxed );
+	}
+	s_recording.store( _recording, std::memory_order_relaxed );
+}
+
+
+
+
+qint64 TraceRecorder::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+
+
+
+void TraceRecorder::addZone( const char * _name, qint64 _begin, qint64 _end )
+{
+	ThreadBuffer * buffer = s_threadBuffer;
+	if( buffer == NULL )
+	{
+		buffer = s_threadBuffer = registerThread();
+	}
+
+	const unsigned int index = buffer->written.load( std::memory_order_relaxed );
+	Event & event = buffer->events[index % EventsPerThread];
+	event.name = _name;
+	event.begin = _begin;
+	event.end = _end;
+	buffer->written.store( index + 1, std::memory_order_release );
+}
+
+
+
+
+bool TraceRecorder::writeChromeTrace( const QString & _file )
+{
+	QFile file( _file );
+	if( !file.open( QFile::WriteOnly | QFile::Truncate ) )
+	{
+		return false;
+	}
+
+	const qint64 start = s_recordingStart.load( std::memory_order_relaxed );
+	const unsigned int keep = isRecording() ?
+			EventsPerThread - OverwriteMargin : EventsPerThread;
+
+	// timestamps are in microseconds
+	auto us = []( qint64 _ns ) {
+		return QByteArray::number( _ns / 1000.0, 'f', 3 ); };
+
+	QByteArray out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+	bool first = true;
+
+	s_buffersMutex.lock();
+	for( const std::unique_ptr<ThreadBuffer> & buffer : s_buffers )
+	{
+		const QByteArray tid = QByteArray::number( buffer->id );
+		if( !first )
+		{
+			out += ",\n";
+		}
+		first = false;
+		out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" +
+			tid + ",\"args\":{\"name\":\"" +
+			buffer->name.toUtf8().replace( '"', '\'' ) + "\"}}";
+
+		const unsigned int written =
+			buffer->written.load( std::memory_order_acquire );
+		const unsigned int count = qMin( written, keep );
+		for( unsigned int i = written - count; i != written; ++i )
+		{
+			const Event & event = buffer->events[i % EventsPerThread];
+			if( event.begin < start )
+			{
+				continue;
+			}
+			out += ",\n{\"name\":\"" + QByteArray( event.name ) +
+				"\",\"ph\":\"X\",\"pid\":1,\"tid\":" + tid +
+				",\"ts\":" + us( event.begin - start ) +
+				",\"dur\":" + us( event.end - event.begin ) + "}";
+		}
+	}
+	s_buffersMutex.unlock();
+
+	out += "\n]}\n";
+
+	return file.write( out ) == out.size();
+}
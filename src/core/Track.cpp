@@ -46,6 +46,7 @@
 #include <QStyleOption>
 
 
+#include "AutomationIndex.h"
 #include "AutomationPattern.h"
 #include "AutomationTrack.h"
 #include "AutomationEditor.h"
@@ -104,6 +105,8 @@ TrackContentObject::TrackContentObject( Track * track ) :
 	m_mutedModel( false, this, tr( "Mute" ) ),
 	m_selectViewOnCreate( false )
 {
+	connect( &m_mutedModel, &Model::dataChanged,
+			[](){ AutomationIndex::invalidate(); } );
 	if( getTrack() )
 	{
 		getTrack()->addTCO( this );
@@ -148,6 +151,11 @@ void TrackContentObject::movePosition( const MidiTime & pos )
 	{
 		Engine::mixer()->requestChangeInModel();
 		m_startPosition = pos;
+		if( getTrack() )
+		{
+			getTrack()->updateTCOPosition( this );
+		}
+		AutomationIndex::invalidate();
 		Engine::mixer()->doneChangeInModel();
 		Engine::getSong()->updateLength();
 		emit positionChanged();
@@ -167,6 +175,10 @@ void TrackContentObject::movePosition( const MidiTime & pos )
 void TrackContentObject::changeLength( const MidiTime & length )
 {
 	m_length = length;
+	if( getTrack() )
+	{
+		getTrack()->updateTCOLength();
+	}
 	Engine::getSong()->updateLength();
 	emit lengthChanged();
 }
@@ -352,6 +364,40 @@ void TrackContentObjectView::update()
 
 
 
+
+/*! \brief Frees the pixmap of a trackContentObjectView scrolled out of view
+ *
+ *  Large arrangements have many more TCOs than fit into the window, so
+ *  only the visible ones keep what they painted.
+ *
+ * \param he The QHideEvent.
+ */
+void TrackContentObjectView::hideEvent( QHideEvent * he )
+{
+	m_paintPixmap = QPixmap();
+	m_needsUpdate = true;
+	selectableObject::hideEvent( he );
+}
+
+
+
+
+/*! \brief Catches up on what changed while the view was hidden
+ *
+ *  Hidden views don't follow zooming and resizing of their track, see
+ *  updateLength() and TrackContentWidget::update().
+ *
+ * \param se The QShowEvent.
+ */
+void TrackContentObjectView::showEvent( QShowEvent * se )
+{
+	setFixedHeight( m_trackView->getTrackContentWidget()->height() - 1 );
+	updateLength();
+	selectableObject::showEvent( se );
+}
+
+
+
 /*! \brief Does this trackContentObjectView have a fixed TCO?
  *
  *  Returns whether the containing trackView has fixed
@@ -486,6 +532,12 @@ void TrackContentObjectView::cut()
  */
 void TrackContentObjectView::updateLength()
 {
+	if( isHidden() )
+	{
+		// caught up on in showEvent()
+		return;
+	}
+
 	if( fixedTCOs() )
 	{
 		setFixedWidth( parentWidget()->width() );
@@ -559,7 +611,6 @@ void TrackContentObjectView::dragEnterEvent( QDragEnterEvent * dee )
 void TrackContentObjectView::dropEvent( QDropEvent * de )
 {
 	QString type = StringPairDrag::decodeKey( de );
-	QString value = StringPairDrag::decodeValue( de );
 
 	// Track must be the same type to paste into
 	if( type != ( "tco_" + QString::number( m_tco->getTrack()->type() ) ) )
@@ -589,7 +640,7 @@ void TrackContentObjectView::dropEvent( QDropEvent * de )
 	}
 
 	// Copy state into existing tco
-	DataFile dataFile( value.toUtf8() );
+	DataFile dataFile = StringPairDrag::decodeMimeDataFile( de->mimeData() );
 	MidiTime pos = m_tco->startPosition();
 	QDomElement tcos = dataFile.content().firstChildElement( "tcos" );
 	m_tco->restoreState( tcos.firstChildElement().firstChildElement() );
@@ -889,7 +940,7 @@ void TrackContentObjectView::mouseMoveEvent( QMouseEvent * me )
 				Qt::SmoothTransformation );
 			new StringPairDrag( QString( "tco_%1" ).arg(
 								m_tco->getTrack()->type() ),
-								dataFile.toString(), thumbnail, this );
+								dataFile, thumbnail, this );
 		}
 	}
 
@@ -1360,6 +1411,11 @@ void TrackContentWidget::update()
 	for( tcoViewVector::iterator it = m_tcoViews.begin();
 				it != m_tcoViews.end(); ++it )
 	{
+		// the hidden ones are updated once they're shown
+		if( ( *it )->isHidden() )
+		{
+			continue;
+		}
 		( *it )->setFixedHeight( height() - 1 );
 		( *it )->update();
 	}
@@ -1377,6 +1433,13 @@ void TrackContentWidget::update()
  */
 void TrackContentWidget::changePosition( const MidiTime & newPos )
 {
+	if( !isVisible() )
+	{
+		// the track is scrolled out of view, caught up on in
+		// showEvent()
+		return;
+	}
+
 	if( m_trackView->trackContainerView() == gui->getBBEditor()->trackContainerView() )
 	{
 		const int curBB = Engine::getBBTrackContainer()->currentBB();
@@ -1429,14 +1492,13 @@ void TrackContentWidget::changePosition( const MidiTime & newPos )
 		TrackContentObjectView * tcov = *it;
 		TrackContentObject * tco = tcov->getTrackContentObject();
 
-		tco->changeLength( tco->length() );
-
 		const int ts = tco->startPosition();
 		const int te = tco->endPosition()-3;
 		if( ( ts >= begin && ts <= end ) ||
 			( te >= begin && te <= end ) ||
 			( ts <= begin && te >= end ) )
 		{
+			tco->changeLength( tco->length() );
 			tcov->move( static_cast<int>( ( ts - begin ) * ppb /
 						MidiTime::ticksPerBar() ),
 								tcov->y() );
@@ -1448,6 +1510,13 @@ void TrackContentWidget::changePosition( const MidiTime & newPos )
 		else
 		{
 			tcov->move( -tcov->width()-10, tcov->y() );
+			// hidden views don't take part in zooming, repainting
+			// and the like, but the one being edited keeps its
+			// input and the selected ones are moved together
+			if( !tcov->hasFocus() && !tcov->isSelected() )
+			{
+				tcov->hide();
+			}
 		}
 	}
 	setUpdatesEnabled( true );
@@ -1507,7 +1576,6 @@ bool TrackContentWidget::canPasteSelection( MidiTime tcoPos, const QDropEvent* d
 
 	Track * t = getTrack();
 	QString type = StringPairDrag::decodeMimeKey( mimeData );
-	QString value = StringPairDrag::decodeMimeValue( mimeData );
 
 	// We can only paste into tracks of the same type
 	if( type != ( "tco_" + QString::number( t->type() ) ) ||
@@ -1516,8 +1584,9 @@ bool TrackContentWidget::canPasteSelection( MidiTime tcoPos, const QDropEvent* d
 		return false;
 	}
 
-	// value contains XML needed to reconstruct TCOs and place them
-	DataFile dataFile( value.toUtf8() );
+	// the value holds what's needed to reconstruct TCOs and place them,
+	// parsed only if it comes from another process
+	DataFile dataFile = StringPairDrag::decodeMimeDataFile( mimeData );
 
 	// Extract the metadata and which TCO was grabbed
 	QDomElement metadata = dataFile.content().firstChildElement( "copyMetadata" );
@@ -1582,13 +1651,10 @@ bool TrackContentWidget::pasteSelection( MidiTime tcoPos, QDropEvent * de )
 		return false;
 	}
 
-	QString type = StringPairDrag::decodeKey( de );
-	QString value = StringPairDrag::decodeValue( de );
-
 	getTrack()->addJournalCheckPoint();
 
-	// value contains XML needed to reconstruct TCOs and place them
-	DataFile dataFile( value.toUtf8() );
+	// the value holds what's needed to reconstruct TCOs and place them
+	DataFile dataFile = StringPairDrag::decodeMimeDataFile( de->mimeData() );
 
 	// Extract the tco data
 	QDomElement tcoParent = dataFile.content().firstChildElement( "tcos" );
@@ -1753,6 +1819,21 @@ void TrackContentWidget::resizeEvent( QResizeEvent * resizeEvent )
 
 
 
+/*! \brief Position the trackContentObjectViews once the track is shown
+ *
+ *  While hidden the track doesn't follow the scrolling of its container.
+ *
+ * \param se the show event to pass to base class
+ */
+void TrackContentWidget::showEvent( QShowEvent * se )
+{
+	changePosition();
+	QWidget::showEvent( se );
+}
+
+
+
+
 /*! \brief Return the track shown by the trackContentWidget
  *
  */
@@ -2038,6 +2119,7 @@ void TrackOperationsWidget::updateMenu()
 	{
 		toMenu->addSeparator();
 		toMenu->addMenu(trackView->midiMenu());
+		trackView->addFreezeActions(toMenu);
 	}
 	if( dynamic_cast<AutomationTrackView *>( m_trackView ) )
 	{
@@ -2099,8 +2181,12 @@ Track::Track( TrackTypes type, TrackContainer * tc ) :
 	m_soloModel( false, this, tr( "Solo" ) ),
 					/*!< For controlling track soloing */
 	m_simpleSerializingMode( false ),
-	m_trackContentObjects()         /*!< The track content objects (segments) */
+	m_trackContentObjects(),        /*!< The track content objects (segments) */
+	m_sortedTCOs(),
+	m_longestTCO( 0 )
 {
+	connect( &m_mutedModel, &Model::dataChanged,
+			[](){ AutomationIndex::invalidate(); } );
 	m_trackContainer->addTrack( this );
 	m_height = -1;
 }
@@ -2354,6 +2440,11 @@ void Track::loadSettings( const QDomElement & element )
 TrackContentObject * Track::addTCO( TrackContentObject * tco )
 {
 	m_trackContentObjects.push_back( tco );
+	m_sortedTCOs.insert( std::upper_bound( m_sortedTCOs.begin(),
+				m_sortedTCOs.end(), tco,
+				TrackContentObject::comparePosition ), tco );
+	updateTCOLength();
+	AutomationIndex::invalidate();
 
 	emit trackContentObjectAdded( tco );
 
@@ -2375,6 +2466,10 @@ void Track::removeTCO( TrackContentObject * tco )
 	if( it != m_trackContentObjects.end() )
 	{
 		m_trackContentObjects.erase( it );
+		m_sortedTCOs.erase( std::find( m_sortedTCOs.begin(),
+						m_sortedTCOs.end(), tco ) );
+		updateTCOLength();
+		AutomationIndex::invalidate();
 		if( Engine::getSong() )
 		{
 			Engine::getSong()->updateLength();
@@ -2384,6 +2479,41 @@ void Track::removeTCO( TrackContentObject * tco )
 }
 
 
+
+
+/*! rief Keep TCOs sorted after one of them has been moved
+ *
+ *  \param tco The TrackContentObject which changed its start position.
+ */
+void Track::updateTCOPosition( TrackContentObject * tco )
+{
+	tcoVector::iterator it = std::find( m_sortedTCOs.begin(),
+						m_sortedTCOs.end(), tco );
+	if( it == m_sortedTCOs.end() )
+	{
+		return;
+	}
+	m_sortedTCOs.erase( it );
+	m_sortedTCOs.insert( std::upper_bound( m_sortedTCOs.begin(),
+				m_sortedTCOs.end(), tco,
+				TrackContentObject::comparePosition ), tco );
+}
+
+
+
+
+/*! rief Update the length of the longest TCO after any of them changed */
+void Track::updateTCOLength()
+{
+	tick_t longest = 0;
+	for( const TrackContentObject * tco : m_trackContentObjects )
+	{
+		longest = qMax<tick_t>( longest, tco->length() );
+	}
+	m_longestTCO = longest;
+}
+
+
 /*! \brief Remove all TCOs from this track */
 void Track::deleteTCOs()
 {
@@ -2473,11 +2603,20 @@ int Track::getTCONum( const TrackContentObject * tco )
 void Track::getTCOsInRange( tcoVector & tcoV, const MidiTime & start,
 							const MidiTime & end )
 {
-	for( TrackContentObject* tco : m_trackContentObjects )
+	// only TCOs starting at most the longest length before start can
+	// reach into the range
+	const tick_t first = static_cast<int>( start ) - m_longestTCO;
+	tcoVector::const_iterator it = std::lower_bound(
+		m_sortedTCOs.constBegin(), m_sortedTCOs.constEnd(), first,
+		[]( const TrackContentObject * tco, tick_t pos )
+		{
+			return tco->startPosition() < pos;
+		} );
+	for( ; it != m_sortedTCOs.constEnd() &&
+				( *it )->startPosition() <= end; ++it )
 	{
-		int s = tco->startPosition();
-		int e = tco->endPosition();
-		if( ( s <= end ) && ( e >= start ) )
+		TrackContentObject * tco = *it;
+		if( tco->endPosition() >= start )
 		{
 			// TCO is within given range
 			// Insert sorted by TCO's position
@@ -2508,6 +2647,7 @@ void Track::swapPositionOfTCOs( int tcoNum1, int tcoNum2 )
 	m_trackContentObjects[tcoNum1]->movePosition(
 			m_trackContentObjects[tcoNum2]->startPosition() );
 	m_trackContentObjects[tcoNum2]->movePosition( pos );
+	AutomationIndex::invalidate();
 }
 
 
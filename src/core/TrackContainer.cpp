@@ -37,6 +37,7 @@
 #include "TrackContainer.h"
 #include "InstrumentTrack.h"
 #include "Song.h"
+#include "TrackSnapshots.h"
 
 #include "GuiApplication.h"
 #include "MainWindow.h"
@@ -46,7 +47,8 @@ TrackContainer::TrackContainer() :
 	Model( NULL ),
 	JournallingObject(),
 	m_tracksMutex(),
-	m_tracks()
+	m_tracks(),
+	m_automationIndex( this )
 {
 }
 
@@ -68,9 +70,17 @@ void TrackContainer::saveSettings( QDomDocument & _doc, QDomElement & _this )
 
 	// save settings of each track
 	m_tracksMutex.lockForRead();
+	TrackSnapshots * snapshots = Engine::getSong()->trackSnapshots();
 	for( int i = 0; i < m_tracks.size(); ++i )
 	{
-		m_tracks[i]->saveState( _doc, _this );
+		if( snapshots )
+		{
+			snapshots->save( m_tracks[i], _doc, _this );
+		}
+		else
+		{
+			m_tracks[i]->saveState( _doc, _this );
+		}
 	}
 	m_tracksMutex.unlock();
 }
@@ -180,6 +190,7 @@ void TrackContainer::addTrack( Track * _track )
 		m_tracks.push_back( _track );
 		m_tracksMutex.unlock();
 		_track->unlock();
+		AutomationIndex::invalidate();
 		emit trackAdded( _track );
 	}
 }
@@ -202,6 +213,7 @@ void TrackContainer::removeTrack( Track * _track )
 		}
 		m_tracks.remove( index );
 		lockTracksAccess.unlock();
+		AutomationIndex::invalidate();
 
 		if( Engine::getSong() )
 		{
@@ -250,7 +262,16 @@ bool TrackContainer::isEmpty() const
 
 AutomatedValueMap TrackContainer::automatedValuesAt(MidiTime time, int tcoNum) const
 {
-	return automatedValuesFromTracks(tracks(), time, tcoNum);
+	if (tcoNum >= 0) {
+		return automatedValuesFromTracks(automationTracks(), time, tcoNum);
+	}
+
+	AutomatedValueMap valueMap;
+	for (const auto& value : m_automationIndex.valuesAt(time))
+	{
+		valueMap[value.model] = value.value;
+	}
+	return valueMap;
 }
 
 
@@ -0,0 +1,430 @@
+/*
+ * TrackFreeze.cpp - audio of an instrument track rendered once and played
+ *                   back instead of its instrument
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "TrackFreeze.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QTemporaryFile>
+
+#include <cstring>
+
+#include "AudioFileWave.h"
+#include "Engine.h"
+#include "InstrumentTrack.h"
+#include "ProjectRenderer.h"
+#include "SampleStream.h"
+#include "Song.h"
+
+
+TrackFreeze::TrackFreeze( InstrumentTrack * _track, bool _afterEffects ) :
+	m_track( _track ),
+	m_afterEffects( _afterEffects ),
+	m_framesWritten( 0 ),
+	m_sampleRate( Engine::mixer()->processingSampleRate() ),
+	m_ratio( 1.0 )
+{
+	QTemporaryFile file( QDir::temp().filePath( "lmms-freeze-XXXXXX.wav" ) );
+	file.setAutoRemove( false );
+	if( !file.open() )
+	{
+		return;
+	}
+	m_file = file.fileName();
+	file.close();
+
+	// the frames of the file are the ones the mixer renders, so they
+	// match the ticks without converting
+	const OutputSettings outputSettings( m_sampleRate,
+				OutputSettings::BitRateSettings( 160, false ),
+				OutputSettings::Depth_32Bit );
+	bool successful = false;
+	m_device.reset( AudioFileWave::getInst( m_file, outputSettings,
+				DEFAULT_CHANNELS, Engine::mixer(), successful ) );
+	if( !successful )
+	{
+		m_device.reset();
+		return;
+	}
+
+	// there can't be more ticks in a period than frames
+	m_pendingTicks.reserve( DEFAULT_BUFFER_SIZE );
+
+	Engine::mixer()->requestChangeInModel();
+	m_track->audioPort()->setFreezeTap( &m_tap, m_afterEffects );
+	Engine::mixer()->doneChangeInModel();
+}
+
+
+
+
+TrackFreeze::~TrackFreeze()
+{
+	if( m_device )
+	{
+		Engine::mixer()->requestChangeInModel();
+		m_track->audioPort()->setFreezeTap( NULL, false );
+		Engine::mixer()->doneChangeInModel();
+		m_device.reset();
+	}
+	m_stream.reset();
+
+	if( !m_file.isEmpty() )
+	{
+		QFile::remove( m_file );
+	}
+}
+
+
+
+
+bool TrackFreeze::isValid() const
+{
+	return m_device != nullptr || m_stream != nullptr;
+}
+
+
+
+
+void TrackFreeze::markTick( tick_t _tick, f_cnt_t _offset )
+{
+	if( m_pendingTicks.size() < m_pendingTicks.capacity() )
+	{
+		m_pendingTicks.push_back( std::make_pair( _tick, _offset ) );
+	}
+}
+
+
+
+
+void TrackFreeze::writePeriod()
+{
+	m_device->processBuffer( m_tap.buffer(), 1.0f );
+	m_tap.clear();
+
+	for( const std::pair<tick_t, f_cnt_t> & tick : m_pendingTicks )
+	{
+		if( tick.first < 0 )
+		{
+			continue;
+		}
+		if( static_cast<size_t>( tick.first ) >= m_tickFrames.size() )
+		{
+			m_tickFrames.resize( tick.first + 1, -1 );
+		}
+		m_tickFrames[tick.first] = m_framesWritten + tick.second;
+	}
+	m_pendingTicks.clear();
+
+	m_framesWritten += Engine::mixer()->framesPerPeriod();
+}
+
+
+
+
+void TrackFreeze::skipPeriod()
+{
+	m_tap.clear();
+	m_pendingTicks.clear();
+}
+
+
+
+
+bool TrackFreeze::finishRecording()
+{
+	if( !m_device )
+	{
+		return false;
+	}
+
+	Engine::mixer()->requestChangeInModel();
+	m_track->audioPort()->setFreezeTap( NULL, false );
+	Engine::mixer()->doneChangeInModel();
+
+	// finishes the file
+	m_device.reset();
+
+	updateSampleRate();
+	return m_stream != nullptr;
+}
+
+
+
+
+f_cnt_t TrackFreeze::tickFrame( tick_t _tick ) const
+{
+	if( _tick < 0 || static_cast<size_t>( _tick ) >= m_tickFrames.size() ||
+						m_tickFrames[_tick] < 0 )
+	{
+		return -1;
+	}
+	return static_cast<f_cnt_t>( m_tickFrames[_tick] * m_ratio );
+}
+
+
+
+
+void TrackFreeze::read( f_cnt_t _frame, sampleFrame * _dst, f_cnt_t _frames )
+{
+	const f_cnt_t available = m_stream ?
+		qBound<f_cnt_t>( 0, m_stream->frames() - _frame, _frames ) : 0;
+	if( available > 0 )
+	{
+		m_stream->read( _frame, _dst, available );
+	}
+	memset( _dst + available, 0, ( _frames - available ) * sizeof( sampleFrame ) );
+}
+
+
+
+
+void TrackFreeze::updateSampleRate()
+{
+	const sample_rate_t sampleRate = Engine::mixer()->processingSampleRate();
+	if( m_stream && sampleRate == m_sampleRate * m_ratio )
+	{
+		return;
+	}
+
+	// the stream resamples the file if the rate isn't the one it has been
+	// rendered at, e.g. while exporting at a higher quality
+	std::unique_ptr<SampleStream> stream( new SampleStream( m_file,
+								sampleRate ) );
+	if( !stream->isValid() )
+	{
+		stream.reset();
+	}
+
+	Engine::mixer()->requestChangeInModel();
+	m_stream.swap( stream );
+	m_ratio = static_cast<double>( sampleRate ) / m_sampleRate;
+	Engine::mixer()->doneChangeInModel();
+}
+
+
+
+
+FreezePlayHandle::FreezePlayHandle( TrackFreeze * _freeze,
+						InstrumentTrack * _track ) :
+	PlayHandle( TypeFreezePlayHandle ),
+	m_freeze( _freeze ),
+	m_track( _track ),
+	m_jumpCount( 0 ),
+	m_frame( -1 )
+{
+	setAudioPort( _track->audioPort() );
+}
+
+
+
+
+void FreezePlayHandle::play( sampleFrame * _buffer )
+{
+	const Song * song = Engine::getSong();
+	if( !( song->isPlaying() || song->isExporting() ) ||
+				song->playMode() != Song::Mode_PlaySong )
+	{
+		m_frame = -1;
+		m_jumpCount = 0;
+		return;
+	}
+
+	// play on from where the last period ended up to the first tick
+	// starting in this one, from there on up to the next tick etc.
+	const f_cnt_t fpp = Engine::mixer()->framesPerPeriod();
+	f_cnt_t offset = 0;
+	int jump = 0;
+	while( offset < fpp )
+	{
+		while( jump < m_jumpCount && m_jumps[jump].offset <= offset )
+		{
+			m_frame = m_jumps[jump++].frame;
+		}
+		const f_cnt_t end = jump < m_jumpCount ?
+				qMin( m_jumps[jump].offset, fpp ) : fpp;
+		if( m_frame >= 0 )
+		{
+			m_freeze->read( m_frame, _buffer + offset, end - offset );
+			m_frame += end - offset;
+		}
+		offset = end;
+	}
+	m_jumpCount = 0;
+}
+
+
+
+
+bool FreezePlayHandle::isFromTrack( const Track * _track ) const
+{
+	return m_track == _track;
+}
+
+
+
+
+void FreezePlayHandle::jumpTo( tick_t _tick, f_cnt_t _offset )
+{
+	if( m_jumpCount < DEFAULT_BUFFER_SIZE )
+	{
+		m_jumps[m_jumpCount++] = Jump{ _offset,
+						m_freeze->tickFrame( _tick ) };
+	}
+}
+
+
+
+
+TrackFreezer::TrackFreezer( InstrumentTrack * _track, bool _afterEffects ) :
+	m_track( _track ),
+	m_afterEffects( _afterEffects ),
+	m_qualitySettings( Engine::mixer()->currentQualitySettings() ),
+	m_aborted( false )
+{
+}
+
+
+
+
+TrackFreezer::~TrackFreezer()
+{
+	abortProcessing();
+}
+
+
+
+
+bool TrackFreezer::start()
+{
+	// the track is rendered the way it sounds without any freeze, and
+	// nothing is played meanwhile which could mark ticks
+	Engine::getSong()->stop();
+	m_track->unfreeze();
+
+	m_freeze.reset( new TrackFreeze( m_track, m_afterEffects ) );
+	if( !m_freeze->isValid() )
+	{
+		m_freeze.reset();
+		return false;
+	}
+
+	// the master mix isn't needed, a device without file keeps the rate
+	// of the mixer
+	Engine::mixer()->storeAudioDevice();
+	const OutputSettings outputSettings( Engine::mixer()->baseSampleRate(),
+				OutputSettings::BitRateSettings( 160, false ),
+				OutputSettings::Depth_32Bit );
+	m_renderer.reset( new ProjectRenderer( m_qualitySettings,
+			new AudioFileDevice( outputSettings, DEFAULT_CHANNELS,
+						QString(), Engine::mixer() ) ) );
+	m_renderer->setTrackFreeze( m_freeze.get() );
+
+	// the whole song once
+	Song * song = Engine::getSong();
+	song->clearExportRange();
+	song->setRenderBetweenMarkers( false );
+	song->setExportLoop( false );
+	song->setLoopRenderCount( 1 );
+
+	muteOtherTracks( true );
+	m_track->setFreezeRecording( m_freeze.get() );
+
+	connect( m_renderer.get(), SIGNAL( progressChanged( int ) ),
+				this, SIGNAL( progressChanged( int ) ) );
+	connect( m_renderer.get(), SIGNAL( finished() ),
+				this, SLOT( renderFinished() ) );
+
+	m_renderer->startProcessing();
+	return true;
+}
+
+
+
+
+void TrackFreezer::abortProcessing()
+{
+	if( m_renderer )
+	{
+		m_aborted = true;
+		disconnect( m_renderer.get(), SIGNAL( finished() ),
+					this, SLOT( renderFinished() ) );
+		m_renderer->abortProcessing();
+		renderFinished();
+	}
+}
+
+
+
+
+void TrackFreezer::renderFinished()
+{
+	m_renderer.reset();
+
+	m_track->setFreezeRecording( NULL );
+	muteOtherTracks( false );
+	Engine::mixer()->restoreAudioDevice();
+
+	bool successful = !m_aborted && m_freeze->finishRecording();
+	if( successful )
+	{
+		successful = m_track->setFreeze( std::move( m_freeze ) );
+	}
+	m_freeze.reset();
+
+	emit finished( successful );
+}
+
+
+
+
+void TrackFreezer::muteOtherTracks( bool _mute )
+{
+	if( _mute )
+	{
+		for( Track * track : Engine::getSong()->tracks() )
+		{
+			if( track != m_track && !track->isMuted() &&
+				( track->type() == Track::InstrumentTrack ||
+					track->type() == Track::SampleTrack ||
+					track->type() == Track::BBTrack ) )
+			{
+				m_mutedTracks.push_back( track );
+			}
+		}
+	}
+
+	// temporarily, so without journal entries
+	for( Track * track : m_mutedTracks )
+	{
+		BoolModel * muted = track->getMutedModel();
+		muted->saveJournallingState( false );
+		muted->setValue( _mute );
+		muted->restoreJournallingState();
+	}
+
+	if( !_mute )
+	{
+		m_mutedTracks.clear();
+	}
+}
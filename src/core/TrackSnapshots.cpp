@@ -0,0 +1,107 @@
+/*
+ * TrackSnapshots.cpp - the saved state of the tracks unchanged since the
+ *                      last save, so saving again doesn't serialize them
+ *                      again
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "TrackSnapshots.h"
+
+#include "Engine.h"
+#include "JournallingObject.h"
+#include "ProjectJournal.h"
+#include "Track.h"
+
+
+
+TrackSnapshots::TrackSnapshots() :
+	m_updates( 0 )
+{
+}
+
+
+
+
+void TrackSnapshots::update()
+{
+	const QSet<jo_id_t> changed =
+			Engine::projectJournal()->takeChangedObjects();
+	if( ++m_updates >= FullSaveInterval )
+	{
+		clear();
+		return;
+	}
+
+	for( const jo_id_t id : changed )
+	{
+		JournallingObject * jo =
+			Engine::projectJournal()->journallingObject( id );
+		QObject * object = dynamic_cast<QObject *>( jo );
+		if( object == NULL )
+		{
+			// deleted, its track may not be around anymore to tell
+			clear();
+			return;
+		}
+
+		// the models, patterns and plugins of a track are its children
+		while( object != NULL && qobject_cast<Track *>( object ) == NULL )
+		{
+			object = object->parent();
+		}
+		if( object != NULL )
+		{
+			m_snapshots.remove( static_cast<Track *>( object ) );
+		}
+	}
+}
+
+
+
+
+void TrackSnapshots::save( Track * _track, QDomDocument & _doc,
+						QDomElement & _parent )
+{
+	const Snapshot snapshot = m_snapshots.value( _track );
+	if( snapshot.track == _track && !snapshot.element.isNull() )
+	{
+		_parent.appendChild( _doc.importNode( snapshot.element, true ) );
+		return;
+	}
+
+	const QDomElement element = _track->saveState( _doc, _parent );
+	// the first BB track saves the BB tracks as well, whose snapshots
+	// are used then
+	if( !element.isNull() && _track->type() != Track::BBTrack )
+	{
+		m_snapshots.insert( _track, Snapshot{ _track,
+				m_doc.importNode( element, true ).toElement() } );
+	}
+}
+
+
+
+
+void TrackSnapshots::clear()
+{
+	m_snapshots.clear();
+	m_doc = QDomDocument();
+	m_updates = 0;
+}
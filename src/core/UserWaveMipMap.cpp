@@ -0,0 +1,89 @@
+/*
+ * UserWaveMipMap.cpp - band-limited versions of a drawn waveform
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "UserWaveMipMap.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "lmms_constants.h"
+
+
+UserWaveMipMap::UserWaveMipMap( const float * _cycle, int _length ) :
+	m_partials( std::max( _length / 2, 1 ) ),
+	m_levels( 1 )
+{
+	while( ( m_partials >> m_levels ) > 0 )
+	{
+		++m_levels;
+	}
+
+	// partials of the drawing, its discrete Fourier transform
+	std::vector<double> cosines( m_partials + 1, 0.0 );
+	std::vector<double> sines( m_partials + 1, 0.0 );
+	for( int p = 0; p <= m_partials && p <= _length / 2; ++p )
+	{
+		for( int n = 0; n < _length; ++n )
+		{
+			const double angle = D_2PI * p * n / _length;
+			cosines[p] += _cycle[n] * cos( angle );
+			sines[p] += _cycle[n] * sin( angle );
+		}
+		// DC and the partial at half the drawing's rate exist once only
+		const bool single = p == 0 || 2 * p == _length;
+		cosines[p] *= ( single ? 1.0 : 2.0 ) / _length;
+		sines[p] *= single ? 0.0 : 2.0 / _length;
+	}
+
+	std::vector<float> sine( TableLength );
+	for( int i = 0; i < TableLength; ++i )
+	{
+		sine[i] = sinf( F_2PI * i / TableLength );
+	}
+
+	// the last level has the fewest partials, every level before it adds
+	// the ones it lacks to a copy of the next one
+	m_tables.resize( m_levels * ( TableLength + 1 ) );
+	std::vector<float> sum( TableLength, static_cast<float>( cosines[0] ) );
+	int done = 0;
+	for( int l = m_levels - 1; l >= 0; --l )
+	{
+		const int partials = m_partials >> l;
+		for( int p = done + 1; p <= partials; ++p )
+		{
+			const float c = static_cast<float>( cosines[p] );
+			const float s = static_cast<float>( sines[p] );
+			for( int i = 0; i < TableLength; ++i )
+			{
+				const int phase = ( p * i ) & ( TableLength - 1 );
+				sum[i] += c * sine[( phase + TableLength / 4 ) &
+							( TableLength - 1 )] +
+						s * sine[phase];
+			}
+		}
+		done = partials;
+
+		float * table = m_tables.data() + l * ( TableLength + 1 );
+		std::copy( sum.begin(), sum.end(), table );
+		table[TableLength] = table[0];
+	}
+}
@@ -1,12 +1,27 @@
 #include "ValueBuffer.h"
 
+#include <atomic>
+#include <new>
+
 #include "interpolation.h"
+#include "LocklessAllocator.h"
+
+// Only models that are automated, linked or controlled need a buffer, so a
+// pool of this size lasts for large projects. The buffers are constructed
+// once and stay constructed while they are in the pool. Pools of former
+// lengths are kept, buffers taken from them may still be released.
+static const int PoolSize = 1024;
+static const int MaxPools = 4;
+
+static LocklessAllocatorT<ValueBuffer> * s_pools[MaxPools];
+static std::atomic<LocklessAllocatorT<ValueBuffer> *> s_currentPool(nullptr);
+static std::atomic_int s_length(0);
 
 ValueBuffer::ValueBuffer()
 {}
 
 ValueBuffer::ValueBuffer(int length)
-	: std::vector<float>(length)
+	: vector(length)
 {}
 
 void ValueBuffer::fill(float value)
@@ -41,3 +56,61 @@ void ValueBuffer::interpolate(float start, float end_)
 		return linearInterpolate( start, end_, i++ / length());
 	});
 }
+
+
+void ValueBuffer::initPool(int length)
+{
+	if (s_currentPool.load() && s_length == length)
+	{
+		return;
+	}
+	for (auto & pool : s_pools)
+	{
+		if (pool == nullptr)
+		{
+			pool = new LocklessAllocatorT<ValueBuffer>(PoolSize);
+			// construct each element once
+			ValueBuffer * buffers[PoolSize];
+			for (ValueBuffer * & buffer : buffers)
+			{
+				buffer = ::new (pool->alloc()) ValueBuffer(length);
+			}
+			for (ValueBuffer * buffer : buffers)
+			{
+				pool->free(buffer);
+			}
+			s_length = length;
+			s_currentPool = pool;
+			return;
+		}
+	}
+	// more lengths than ever seen in practice, allocate from now on
+	s_length = length;
+	s_currentPool = nullptr;
+}
+
+ValueBuffer * ValueBuffer::acquire()
+{
+	LocklessAllocatorT<ValueBuffer> * pool = s_currentPool.load();
+	if (pool)
+	{
+		if (ValueBuffer * buffer = pool->tryAlloc())
+		{
+			return buffer;
+		}
+	}
+	return new ValueBuffer(s_length);
+}
+
+void ValueBuffer::release(ValueBuffer * buffer)
+{
+	for (LocklessAllocatorT<ValueBuffer> * pool : s_pools)
+	{
+		if (pool && pool->contains(buffer))
+		{
+			pool->free(buffer);
+			return;
+		}
+	}
+	delete buffer;
+}
@@ -44,9 +44,12 @@ AudioAlsa::AudioAlsa( bool & _success_ful, Mixer*  _mixer ) :
 	m_handle( NULL ),
 	m_hwParams( NULL ),
 	m_swParams( NULL ),
-	m_convertEndian( false )
+	m_format( SND_PCM_FORMAT_S16_LE ),
+	m_convertEndian( false ),
+	m_mmap( false )
 {
 	_success_ful = false;
+	m_detectsXruns = true;
 
 	if( setenv( "PULSE_ALSA_HOOK_CONF", "/dev/null", 0 ) )
 	{
@@ -68,8 +71,7 @@ AudioAlsa::AudioAlsa( bool & _success_ful, Mixer*  _mixer ) :
 	snd_pcm_hw_params_malloc( &m_hwParams );
 	snd_pcm_sw_params_malloc( &m_swParams );
 
-	if( ( err = setHWParams( channels(),
-					SND_PCM_ACCESS_RW_INTERLEAVED ) ) < 0 )
+	if( ( err = setHWParams( channels() ) ) < 0 )
 	{
 		printf( "Setting of hwparams failed: %s\n",
 							snd_strerror( err ) );
@@ -201,6 +203,7 @@ int AudioAlsa::handleError( int _err )
 	if( _err == -EPIPE )
 	{
 		// under-run
+		reportXrun();
 		_err = snd_pcm_prepare( m_handle );
 		if( _err < 0 )
 			printf( "Can't recover from underrun, prepare "
@@ -273,8 +276,7 @@ void AudioAlsa::applyQualitySettings()
 			return;
 		}
 
-		if( ( err = setHWParams( channels(),
-					SND_PCM_ACCESS_RW_INTERLEAVED ) ) < 0 )
+		if( ( err = setHWParams( channels() ) ) < 0 )
 		{
 			printf( "Setting of hwparams failed: %s\n",
 							snd_strerror( err ) );
@@ -298,84 +300,167 @@ void AudioAlsa::run()
 {
 	surroundSampleFrame * temp =
 		new surroundSampleFrame[mixer()->framesPerPeriod()];
-	int_sample_t * outbuf =
-			new int_sample_t[mixer()->framesPerPeriod() *
-								channels()];
-	int_sample_t * pcmbuf = new int_sample_t[m_periodSize * channels()];
+	fpp_t tempFrames = 0;
+	fpp_t tempPos = 0;
 
-	int outbuf_size = mixer()->framesPerPeriod() * channels();
-	int outbuf_pos = 0;
-	int pcmbuf_size = m_periodSize * channels();
+	const int frameBytes = snd_pcm_format_physical_width( m_format ) / 8 *
+								channels();
+	char * pcmbuf = m_mmap ? NULL : new char[m_periodSize * frameBytes];
+
+	// converts the next _frames frames of the mixer to _dst, returns
+	// false and writes silence once it is done
+	auto fill = [&]( char * _dst, snd_pcm_uframes_t _frames )
+	{
+		while( _frames > 0 )
+		{
+			if( tempPos == tempFrames )
+			{
+				// frames depend on the sample rate
+				tempFrames = getNextBuffer( temp );
+				tempPos = 0;
+				if( !tempFrames )
+				{
+					memset( _dst, 0, _frames * frameBytes );
+					return false;
+				}
+			}
+			const fpp_t n = qMin<snd_pcm_uframes_t>( _frames,
+							tempFrames - tempPos );
+			convert( temp + tempPos, n, _dst );
+			_dst += n * frameBytes;
+			_frames -= n;
+			tempPos += n;
+		}
+		return true;
+	};
 
 	bool quit = false;
 	while( quit == false )
 	{
-		int_sample_t * ptr = pcmbuf;
-		int len = pcmbuf_size;
-		while( len )
+		if( !m_mmap )
 		{
-			if( outbuf_pos == 0 )
+			quit = !fill( pcmbuf, m_periodSize );
+
+			f_cnt_t frames = m_periodSize;
+			char * ptr = pcmbuf;
+
+			while( frames )
 			{
-				// frames depend on the sample rate
-				const fpp_t frames = getNextBuffer( temp );
-				if( !frames )
+				int err = snd_pcm_writei( m_handle, ptr, frames );
+
+				if( err == -EAGAIN )
 				{
-					quit = true;
-					memset( ptr, 0, len
-						* sizeof( int_sample_t ) );
-					break;
+					continue;
 				}
-				outbuf_size = frames * channels();
 
-				convertToS16( temp, frames,
-						mixer()->masterGain(),
-						outbuf,
-						m_convertEndian );
+				if( err < 0 )
+				{
+					if( handleError( err ) < 0 )
+					{
+						printf( "Write error: %s\n",
+							snd_strerror( err ) );
+					}
+					break;	// skip this buffer
+				}
+				ptr += err * frameBytes;
+				frames -= err;
 			}
-			int min_len = qMin( len, outbuf_size - outbuf_pos );
-			memcpy( ptr, outbuf + outbuf_pos,
-					min_len * sizeof( int_sample_t ) );
-			ptr += min_len;
-			len -= min_len;
-			outbuf_pos += min_len;
-			outbuf_pos %= outbuf_size;
+			continue;
 		}
 
-		f_cnt_t frames = m_periodSize;
-		ptr = pcmbuf;
-
-		while( frames )
+		// wait for room for a period in the ring, the device has to be
+		// started by hand when it gets written to directly
+		int err = snd_pcm_avail_update( m_handle );
+		if( err >= 0 && err < static_cast<int>( m_periodSize ) )
 		{
-			int err = snd_pcm_writei( m_handle, ptr, frames );
-
-			if( err == -EAGAIN )
+			if( snd_pcm_state( m_handle ) == SND_PCM_STATE_PREPARED )
+			{
+				err = snd_pcm_start( m_handle );
+			}
+			else
+			{
+				err = snd_pcm_wait( m_handle, 1000 );
+			}
+			if( err >= 0 )
 			{
 				continue;
 			}
+		}
+		if( err < 0 )
+		{
+			if( handleError( err ) < 0 )
+			{
+				printf( "Write error: %s\n", snd_strerror( err ) );
+				quit = true;
+			}
+			continue;
+		}
 
+		snd_pcm_uframes_t left = m_periodSize;
+		while( left > 0 && quit == false )
+		{
+			const snd_pcm_channel_area_t * areas;
+			snd_pcm_uframes_t offset;
+			snd_pcm_uframes_t frames = left;
+			err = snd_pcm_mmap_begin( m_handle, &areas, &offset,
+								&frames );
 			if( err < 0 )
 			{
-				if( handleError( err ) < 0 )
-				{
-					printf( "Write error: %s\n",
-							snd_strerror( err ) );
-				}
-				break;	// skip this buffer
+				handleError( err );
+				break;
+			}
+
+			char * dst = static_cast<char *>( areas[0].addr ) +
+						areas[0].first / 8 +
+						offset * areas[0].step / 8;
+			quit = !fill( dst, frames );
+
+			const snd_pcm_sframes_t committed =
+				snd_pcm_mmap_commit( m_handle, offset, frames );
+			if( committed < 0 ||
+				static_cast<snd_pcm_uframes_t>( committed ) !=
+								frames )
+			{
+				handleError( committed < 0 ? committed : -EPIPE );
+				break;
 			}
-			ptr += err * channels();
-			frames -= err;
+			left -= frames;
 		}
 	}
 
 	delete[] temp;
-	delete[] outbuf;
 	delete[] pcmbuf;
 }
 
 
 
 
-int AudioAlsa::setHWParams( const ch_cnt_t _channels, snd_pcm_access_t _access )
+void AudioAlsa::convert( const surroundSampleFrame * _src,
+					const fpp_t _frames, char * _dst )
+{
+	const float gain = mixer()->masterGain();
+	switch( m_format )
+	{
+		case SND_PCM_FORMAT_FLOAT:
+			convertToFloat( _src, _frames, gain,
+					reinterpret_cast<float *>( _dst ) );
+			break;
+		case SND_PCM_FORMAT_S32:
+			convertToS32( _src, _frames, gain,
+					reinterpret_cast<int32_t *>( _dst ) );
+			break;
+		default:
+			convertToS16( _src, _frames, gain,
+				reinterpret_cast<int_sample_t *>( _dst ),
+							m_convertEndian );
+			break;
+	}
+}
+
+
+
+
+int AudioAlsa::setHWParams( const ch_cnt_t _channels )
 {
 	int err, dir;
 
@@ -387,30 +472,48 @@ int AudioAlsa::setHWParams( const ch_cnt_t _channels, snd_pcm_access_t _access )
 		return err;
 	}
 
-	// set the interleaved read/write format
-	if( ( err = snd_pcm_hw_params_set_access( m_handle, m_hwParams,
-							_access ) ) < 0 )
+	// write straight into the ring of the device if it can be mapped,
+	// otherwise through interleaved writes
+	m_mmap = snd_pcm_hw_params_set_access( m_handle, m_hwParams,
+				SND_PCM_ACCESS_MMAP_INTERLEAVED ) >= 0;
+	if( !m_mmap && ( err = snd_pcm_hw_params_set_access( m_handle,
+			m_hwParams, SND_PCM_ACCESS_RW_INTERLEAVED ) ) < 0 )
 	{
 		printf( "Access type not available for playback: %s\n",
 							snd_strerror( err ) );
 		return err;
 	}
 
-	// set the sample format
-	if( ( snd_pcm_hw_params_set_format( m_handle, m_hwParams,
+	// set the sample format, preferring the ones the samples can be
+	// handed over in without losing resolution
+	if( snd_pcm_hw_params_set_format( m_handle, m_hwParams,
+						SND_PCM_FORMAT_FLOAT ) >= 0 )
+	{
+		m_format = SND_PCM_FORMAT_FLOAT;
+		m_convertEndian = false;
+	}
+	else if( snd_pcm_hw_params_set_format( m_handle, m_hwParams,
+						SND_PCM_FORMAT_S32 ) >= 0 )
+	{
+		m_format = SND_PCM_FORMAT_S32;
+		m_convertEndian = false;
+	}
+	else if( ( err = snd_pcm_hw_params_set_format( m_handle, m_hwParams,
 						SND_PCM_FORMAT_S16_LE ) ) < 0 )
 	{
-		if( ( snd_pcm_hw_params_set_format( m_handle, m_hwParams,
+		if( ( err = snd_pcm_hw_params_set_format( m_handle, m_hwParams,
 						SND_PCM_FORMAT_S16_BE ) ) < 0 )
 		{
 			printf( "Neither little- nor big-endian available for "
 					"playback: %s\n", snd_strerror( err ) );
 			return err;
 		}
+		m_format = SND_PCM_FORMAT_S16_BE;
 		m_convertEndian = isLittleEndian();
 	}
 	else
 	{
+		m_format = SND_PCM_FORMAT_S16_LE;
 		m_convertEndian = !isLittleEndian();
 	}
 
@@ -31,12 +31,33 @@
 
 
 
+static Decimator::Qualities decimatorQuality(
+				Mixer::qualitySettings::Interpolation _i )
+{
+	switch( _i )
+	{
+		case Mixer::qualitySettings::Interpolation_SincMedium:
+			return Decimator::Balanced;
+		case Mixer::qualitySettings::Interpolation_SincBest:
+			return Decimator::HighQuality;
+		default:
+			return Decimator::LowLatency;
+	}
+}
+
+
+
+
 AudioDevice::AudioDevice( const ch_cnt_t _channels, Mixer*  _mixer ) :
 	m_supportsCapture( false ),
+	m_detectsXruns( false ),
 	m_sampleRate( _mixer->processingSampleRate() ),
 	m_channels( _channels ),
 	m_mixer( _mixer ),
-	m_buffer( new surroundSampleFrame[mixer()->framesPerPeriod()] )
+	m_buffer( new surroundSampleFrame[mixer()->framesPerPeriod()] ),
+	m_xruns( 0 ),
+	m_latePeriods( 0 ),
+	m_fifoDepth( 0.0f )
 {
 	int error;
 	if( ( m_srcState = src_new(
@@ -45,6 +66,11 @@ AudioDevice::AudioDevice( const ch_cnt_t _channels, Mixer*  _mixer ) :
 	{
 		printf( "Error: src_new() failed in audio_device.cpp!\n" );
 	}
+
+	const Mixer::qualitySettings & quality =
+					mixer()->currentQualitySettings();
+	m_decimator.setup( quality.sampleRateMultiplier(),
+				decimatorQuality( quality.interpolation ) );
 }
 
 
@@ -81,7 +107,28 @@ void AudioDevice::processNextBuffer()
 fpp_t AudioDevice::getNextBuffer( surroundSampleFrame * _ab )
 {
 	fpp_t frames = mixer()->framesPerPeriod();
+	const int periodLength = 1000000 * frames /
+					mixer()->processingSampleRate();
+
+	const int interval = m_periodTimer.elapsed();
+	m_periodTimer.reset();
+	// longer breaks mean the device has been stopped in between
+	if( interval < 1000000 )
+	{
+		m_jitter.add( qAbs( interval - periodLength ) );
+	}
+	m_fifoDepth.store( m_fifoDepth.load( std::memory_order_relaxed ) * 0.95f +
+				mixer()->fifoDepth() * 0.05f,
+						std::memory_order_relaxed );
+
+	MicroTimer waitTimer;
 	const surroundSampleFrame * b = mixer()->nextBuffer();
+	const int wait = waitTimer.elapsed();
+	m_wait.add( wait );
+	if( wait > periodLength )
+	{
+		m_latePeriods.fetch_add( 1, std::memory_order_relaxed );
+	}
 	if( !b )
 	{
 		return 0;
@@ -89,29 +136,89 @@ fpp_t AudioDevice::getNextBuffer( surroundSampleFrame * _ab )
 
 	// make sure, no other thread is accessing device
 	lock();
+	frames = toDeviceRate( b, frames, _ab );
+	// release lock
+	unlock();
+
+	mixer()->releaseNextBuffer();
+
+	return frames;
+}
+
+
+
 
-	// resample if necessary
-	if( mixer()->processingSampleRate() != m_sampleRate )
+void AudioDevice::processBuffer( const surroundSampleFrame * _buf,
+							const float _gain )
+{
+	lock();
+	const fpp_t frames = toDeviceRate( _buf, mixer()->framesPerPeriod(),
+								m_buffer );
+	unlock();
+
+	writeBuffer( m_buffer, frames, _gain );
+}
+
+
+
+
+fpp_t AudioDevice::toDeviceRate( const surroundSampleFrame * _src,
+					fpp_t _frames, surroundSampleFrame * _dst )
+{
+	// resample if necessary, whole factors of oversampling only need
+	// to be filtered and decimated
+	if( mixer()->processingSampleRate() ==
+				m_sampleRate * m_decimator.factor() &&
+					_frames % m_decimator.factor() == 0 )
 	{
-		resample( b, frames, _ab, mixer()->processingSampleRate(),
-								m_sampleRate );
-		frames = frames * m_sampleRate /
-					mixer()->processingSampleRate();
+		return m_decimator.process( _src, _frames, _dst );
 	}
-	else
+	else if( mixer()->processingSampleRate() != m_sampleRate )
 	{
-		memcpy( _ab, b, frames * sizeof( surroundSampleFrame ) );
+		resample( _src, _frames, _dst, mixer()->processingSampleRate(),
+								m_sampleRate );
+		return _frames * m_sampleRate /
+					mixer()->processingSampleRate();
 	}
+	memcpy( _dst, _src, _frames * sizeof( surroundSampleFrame ) );
+	return _frames;
+}
 
-	// release lock
-	unlock();
 
-	if( mixer()->hasFifoWriter() )
-	{
-		delete[] b;
-	}
 
-	return frames;
+
+AudioDevice::Statistics AudioDevice::statistics() const
+{
+	Statistics stats;
+	stats.xruns = m_detectsXruns ?
+			m_xruns.load( std::memory_order_relaxed ) : -1;
+	stats.latePeriods = m_latePeriods.load( std::memory_order_relaxed );
+	stats.jitterAverage = m_jitter.average();
+	stats.jitterMaximum = m_jitter.maximum();
+	stats.waitAverage = m_wait.average();
+	stats.waitMaximum = m_wait.maximum();
+	stats.fifoDepth = m_fifoDepth.load( std::memory_order_relaxed );
+	stats.fifoSize = m_mixer->fifoSize();
+	return stats;
+}
+
+
+
+
+QString AudioDevice::statisticsText() const
+{
+	const Statistics stats = statistics();
+	return QString( "xruns: %1, late periods: %2, jitter: %3 us (max. %4 us), "
+			"wait: %5 us (max. %6 us), fifo: %7/%8" ).
+		arg( stats.xruns >= 0 ? QString::number( stats.xruns ) :
+							QString( "n/a" ) ).
+		arg( stats.latePeriods ).
+		arg( stats.jitterAverage, 0, 'f', 0 ).
+		arg( stats.jitterMaximum, 0, 'f', 0 ).
+		arg( stats.waitAverage, 0, 'f', 0 ).
+		arg( stats.waitMaximum, 0, 'f', 0 ).
+		arg( stats.fifoDepth, 0, 'f', 1 ).
+		arg( stats.fifoSize );
 }
 
 
@@ -158,6 +265,11 @@ void AudioDevice::applyQualitySettings()
 	{
 		printf( "Error: src_new() failed in audio_device.cpp!\n" );
 	}
+
+	const Mixer::qualitySettings & quality =
+					mixer()->currentQualitySettings();
+	m_decimator.setup( quality.sampleRateMultiplier(),
+				decimatorQuality( quality.interpolation ) );
 }
 
 
@@ -210,43 +322,101 @@ void AudioDevice::resample( const surroundSampleFrame * _src,
 
 
 
+// Converts the samples of the used channels of each frame. If all channels
+// of a surround frame are used the frames are one contiguous block, which
+// the compiler can vectorise as a single loop.
+template<typename T, class Convert>
+static void convertFrames( const surroundSampleFrame * _ab,
+					const fpp_t _frames,
+					const ch_cnt_t _channels,
+					const float _master_gain,
+					T * __restrict _output_buffer,
+					Convert _convert )
+{
+	if( _channels == SURROUND_CHANNELS )
+	{
+		const sample_t * __restrict in = _ab[0];
+		const int samples = _frames * SURROUND_CHANNELS;
+		for( int i = 0; i < samples; ++i )
+		{
+			_output_buffer[i] = _convert( in[i] * _master_gain );
+		}
+		return;
+	}
+
+	for( fpp_t frame = 0; frame < _frames; ++frame )
+	{
+		for( ch_cnt_t chnl = 0; chnl < _channels; ++chnl )
+		{
+			_output_buffer[frame * _channels + chnl] =
+				_convert( _ab[frame][chnl] * _master_gain );
+		}
+	}
+}
+
+
+
+
 int AudioDevice::convertToS16( const surroundSampleFrame * _ab,
 								const fpp_t _frames,
 								const float _master_gain,
 								int_sample_t * _output_buffer,
 								const bool _convert_endian )
 {
+	convertFrames( _ab, _frames, channels(), _master_gain, _output_buffer,
+		[]( sample_t _s )
+		{
+			return static_cast<int_sample_t>( qBound( -1.0f, _s, 1.0f ) *
+						OUTPUT_SAMPLE_MULTIPLIER );
+		} );
+
+	const int samples = _frames * channels();
 	if( _convert_endian )
 	{
-		int_sample_t temp;
-		for( fpp_t frame = 0; frame < _frames; ++frame )
+		uint16_t * __restrict out =
+				reinterpret_cast<uint16_t *>( _output_buffer );
+		for( int i = 0; i < samples; ++i )
 		{
-			for( ch_cnt_t chnl = 0; chnl < channels(); ++chnl )
-			{
-				temp = static_cast<int_sample_t>( Mixer::clip( _ab[frame][chnl] * _master_gain ) * OUTPUT_SAMPLE_MULTIPLIER );
-				
-				( _output_buffer + frame * channels() )[chnl] =
-						( temp & 0x00ff ) << 8 |
-						( temp & 0xff00 ) >> 8;
-			}
+			out[i] = static_cast<uint16_t>( out[i] << 8 | out[i] >> 8 );
 		}
 	}
-	else
-	{
-		for( fpp_t frame = 0; frame < _frames; ++frame )
+
+	return samples * BYTES_PER_INT_SAMPLE;
+}
+
+
+
+
+int AudioDevice::convertToS32( const surroundSampleFrame * _ab,
+								const fpp_t _frames,
+								const float _master_gain,
+								int32_t * _output_buffer )
+{
+	convertFrames( _ab, _frames, channels(), _master_gain, _output_buffer,
+		[]( sample_t _s )
 		{
-			for( ch_cnt_t chnl = 0; chnl < channels(); ++chnl )
-			{
-				( _output_buffer + frame * channels() )[chnl] =
-						static_cast<int_sample_t>(
-						Mixer::clip( _ab[frame][chnl] *
-						_master_gain ) *
-						OUTPUT_SAMPLE_MULTIPLIER );
-			}
-		}
-	}
+			// the largest float below 2^31, a full scale 1.0 would
+			// overflow
+			return static_cast<int32_t>( qBound( -1.0f, _s, 1.0f ) *
+								2147483520.0f );
+		} );
+	return _frames * channels() * sizeof( int32_t );
+}
+
 
-	return _frames * channels() * BYTES_PER_INT_SAMPLE;
+
+
+int AudioDevice::convertToFloat( const surroundSampleFrame * _ab,
+								const fpp_t _frames,
+								const float _master_gain,
+								float * _output_buffer )
+{
+	convertFrames( _ab, _frames, channels(), _master_gain, _output_buffer,
+		[]( sample_t _s )
+		{
+			return qBound( -1.0f, _s, 1.0f );
+		} );
+	return _frames * channels() * sizeof( float );
 }
 
 
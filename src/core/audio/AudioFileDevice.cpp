@@ -24,10 +24,107 @@
  */
 
 #include <QMessageBox>
+#include <QThread>
+
+#include <atomic>
+#include <cstring>
 
 #include "AudioFileDevice.h"
 #include "ExportProjectDialog.h"
 #include "GuiApplication.h"
+#include "LocklessRingBuffer.h"
+
+
+//! Takes the blocks of an export through a lockless ring and encodes them,
+//! so rendering and encoding overlap. The render thread waits if the
+//! encoder falls behind by more than the ring holds, nothing gets dropped.
+class AudioFileDevice::EncoderThread : public QThread
+{
+public:
+	EncoderThread( AudioFileDevice * _device, f_cnt_t _blockSize ) :
+		m_device( _device ),
+		m_blockSize( _blockSize ),
+		m_block( new surroundSampleFrame[_blockSize] ),
+		m_ring( _blockSize * RingBlocks ),
+		m_reader( m_ring ),
+		m_finishing( false )
+	{
+		setObjectName( "AudioFileDevice encoder" );
+		start();
+	}
+
+	virtual ~EncoderThread()
+	{
+		finish();
+		delete[] m_block;
+	}
+
+	void write( const surroundSampleFrame * _ab, f_cnt_t _frames )
+	{
+		while( _frames > 0 )
+		{
+			const f_cnt_t written = m_ring.write( _ab, _frames );
+			_ab += written;
+			_frames -= written;
+			if( _frames > 0 )
+			{
+				// the encoder is the bottleneck, give it some time
+				usleep( 500 );
+			}
+		}
+	}
+
+	//! Waits for all blocks written so far to be encoded
+	void finish()
+	{
+		m_finishing = true;
+		wait();
+	}
+
+
+private:
+	void run() override
+	{
+		while( true )
+		{
+			// blocks written before finish() was called are in the
+			// ring by now
+			const bool finishing = m_finishing;
+			auto frames = m_reader.read_max( qMin<std::size_t>(
+					m_reader.read_space(), m_blockSize ) );
+			const std::size_t count = frames.size();
+			if( count == 0 )
+			{
+				if( finishing )
+				{
+					break;
+				}
+				usleep( 500 );
+				continue;
+			}
+
+			for( std::size_t f = 0; f < count; ++f )
+			{
+				m_block[f][0] = frames[f][0];
+				m_block[f][1] = frames[f][1];
+			}
+			m_device->writeBuffer( m_block, static_cast<fpp_t>( count ),
+								1.0f );
+		}
+	}
+
+	// blocks the render thread may be ahead of the encoder
+	static const int RingBlocks = 4;
+
+	AudioFileDevice * m_device;
+	const f_cnt_t m_blockSize;
+	surroundSampleFrame * m_block;
+	LocklessRingBuffer<sampleFrame> m_ring;
+	LocklessRingBufferReader<sampleFrame> m_reader;
+	std::atomic<bool> m_finishing;
+
+} ;
+
 
 
 AudioFileDevice::AudioFileDevice( OutputSettings const & outputSettings,
@@ -36,11 +133,16 @@ AudioFileDevice::AudioFileDevice( OutputSettings const & outputSettings,
 					Mixer*  _mixer ) :
 	AudioDevice( _channels, _mixer ),
 	m_outputFile( _file ),
-	m_outputSettings(outputSettings)
+	m_outputSettings(outputSettings),
+	m_block( NULL ),
+	m_blockSize( 0 ),
+	m_blockFrames( 0 ),
+	m_lastPeriodFrames( 0 )
 {
 	setSampleRate( outputSettings.getSampleRate() );
 
-	if( m_outputFile.open( QFile::WriteOnly | QFile::Truncate ) == false )
+	if( !_file.isEmpty() &&
+		m_outputFile.open( QFile::WriteOnly | QFile::Truncate ) == false )
 	{
 		QString title, message;
 		title = ExportProjectDialog::tr( "Could not open file" );
@@ -71,7 +173,131 @@ AudioFileDevice::AudioFileDevice( OutputSettings const & outputSettings,
 
 AudioFileDevice::~AudioFileDevice()
 {
+	// flushBlock() stopped the encoder already, it must not encode into
+	// the parts of the subclass which are gone by now
+	m_encoder.reset();
 	m_outputFile.close();
+	delete[] m_block;
+}
+
+
+
+
+void AudioFileDevice::setBlockSize( f_cnt_t _frames )
+{
+	flushBlock();
+	delete[] m_block;
+	m_block = NULL;
+
+	// a block plus the period which filled it has to fit into the
+	// frames writeBuffer() takes
+	m_blockSize = qBound<f_cnt_t>( 0, _frames, 16384 );
+	if( m_blockSize > 0 )
+	{
+		m_block = new surroundSampleFrame[m_blockSize +
+						mixer()->framesPerPeriod()];
+		if( encodesInBackground() )
+		{
+			m_encoder.reset( new EncoderThread( this,
+					m_blockSize + mixer()->framesPerPeriod() ) );
+		}
+	}
+}
+
+
+
+
+bool AudioFileDevice::processNextPeriod()
+{
+	if( !m_block )
+	{
+		processNextBuffer();
+		return true;
+	}
+
+	// a full block is passed on only now, so the last period can still
+	// be cut by keepOfLastPeriod()
+	if( m_blockFrames >= m_blockSize )
+	{
+		passBlock();
+	}
+
+	surroundSampleFrame * period = m_block + m_blockFrames;
+	const fpp_t frames = getNextBuffer( period );
+	m_lastPeriodFrames = frames;
+	if( !frames )
+	{
+		return false;
+	}
+
+	// the master gain may change between the periods of a block
+	const float gain = mixer()->masterGain();
+	if( gain != 1.0f )
+	{
+		for( fpp_t f = 0; f < frames; ++f )
+		{
+			for( ch_cnt_t ch = 0; ch < SURROUND_CHANNELS; ++ch )
+			{
+				period[f][ch] *= gain;
+			}
+		}
+	}
+
+	m_blockFrames += frames;
+	return true;
+}
+
+
+
+
+void AudioFileDevice::keepOfLastPeriod( f_cnt_t _first, f_cnt_t _last )
+{
+	if( !m_block || m_lastPeriodFrames == 0 )
+	{
+		return;
+	}
+
+	// from the processing rate of the mixer to the rate of the device
+	const f_cnt_t fpp = mixer()->framesPerPeriod();
+	const f_cnt_t first = qBound<f_cnt_t>( 0, _first, fpp ) *
+					m_lastPeriodFrames / fpp;
+	const f_cnt_t last = qBound<f_cnt_t>( _first, _last, fpp ) *
+					m_lastPeriodFrames / fpp;
+
+	surroundSampleFrame * period = m_block + m_blockFrames -
+							m_lastPeriodFrames;
+	memmove( period, period + first,
+			( last - first ) * sizeof( surroundSampleFrame ) );
+	m_blockFrames -= m_lastPeriodFrames - ( last - first );
+	m_lastPeriodFrames = last - first;
+}
+
+
+
+
+void AudioFileDevice::flushBlock()
+{
+	passBlock();
+	m_encoder.reset();
+}
+
+
+
+
+void AudioFileDevice::passBlock()
+{
+	if( m_blockFrames > 0 )
+	{
+		if( m_encoder )
+		{
+			m_encoder->write( m_block, m_blockFrames );
+		}
+		else
+		{
+			writeBuffer( m_block, m_blockFrames, 1.0f );
+		}
+		m_blockFrames = 0;
+	}
 }
 
 
@@ -0,0 +1,327 @@
+/*
+ * AudioFileStream.cpp - AudioFileDevice which streams WAV or raw PCM to
+ *                       standard output, a pipe or a socket while rendering
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "AudioFileStream.h"
+
+#include <QtCore/QtEndian>
+
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+
+#include "lmmsconfig.h"
+
+#ifdef LMMS_BUILD_WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Mixer.h"
+
+
+namespace
+{
+
+const char * const TcpScheme = "tcp://";
+
+// the duplicate of standard output reserveStandardOutput() kept, until a
+// stream takes it
+int s_standardOutput = -1;
+
+
+void putLittleEndian( QByteArray & _header, quint32 _value, int _bytes )
+{
+	for( int i = 0; i < _bytes; ++i )
+	{
+		_header += char( ( _value >> ( 8 * i ) ) & 0xff );
+	}
+}
+
+}
+
+
+
+
+AudioFileStream::AudioFileStream( OutputSettings const & outputSettings,
+				const ch_cnt_t channels, bool & successful,
+				const QString & target, bool raw,
+				Mixer* mixer ) :
+	// a file is opened by AudioFileDevice as usual, so it's removed if
+	// the export is aborted
+	AudioFileDevice( outputSettings, channels,
+				isStream( target ) ? QString() : target, mixer ),
+	m_raw( raw ),
+	m_sampleBytes( outputSettings.getBitDepth() ==
+				OutputSettings::Depth_32Bit ? 4 :
+			outputSettings.getBitDepth() ==
+				OutputSettings::Depth_24Bit ? 3 : 2 ),
+	m_failed( false )
+{
+	successful = ( isStream( target ) ? openStream( target ) :
+							outputFileOpened() ) &&
+			writeHeader();
+}
+
+
+
+
+AudioFileStream::~AudioFileStream()
+{
+	// the reader sees the end of the stream
+	m_stream.close();
+}
+
+
+
+
+bool AudioFileStream::isStream( const QString & _target )
+{
+	if( _target == "-" || _target.startsWith( TcpScheme ) )
+	{
+		return true;
+	}
+#ifndef LMMS_BUILD_WIN32
+	struct stat info;
+	if( stat( QFile::encodeName( _target ).constData(), &info ) == 0 )
+	{
+		return S_ISFIFO( info.st_mode ) || S_ISSOCK( info.st_mode );
+	}
+#endif
+	return false;
+}
+
+
+
+
+void AudioFileStream::reserveStandardOutput()
+{
+	if( s_standardOutput >= 0 )
+	{
+		return;
+	}
+
+	// what's printed from now on must not end up in between the samples
+	fflush( stdout );
+#ifdef LMMS_BUILD_WIN32
+	s_standardOutput = _dup( _fileno( stdout ) );
+	_setmode( s_standardOutput, _O_BINARY );
+	_dup2( _fileno( stderr ), _fileno( stdout ) );
+#else
+	s_standardOutput = dup( STDOUT_FILENO );
+	dup2( STDERR_FILENO, STDOUT_FILENO );
+#endif
+}
+
+
+
+
+bool AudioFileStream::openStream( const QString & _target )
+{
+#ifndef LMMS_BUILD_WIN32
+	// a reader which goes away makes writes fail instead of killing us
+	signal( SIGPIPE, SIG_IGN );
+#endif
+
+	if( _target == "-" )
+	{
+		reserveStandardOutput();
+		const int fd = s_standardOutput;
+		s_standardOutput = -1;
+		return m_stream.open( fd, QIODevice::WriteOnly |
+					QIODevice::Unbuffered,
+					QFileDevice::AutoCloseHandle );
+	}
+
+	if( _target.startsWith( TcpScheme ) )
+	{
+#ifndef LMMS_BUILD_WIN32
+		const QString address = _target.mid( strlen( TcpScheme ) );
+		const int colon = address.lastIndexOf( ':' );
+		if( colon < 0 )
+		{
+			fprintf( stderr, "No port given in %s\n",
+					_target.toUtf8().constData() );
+			return false;
+		}
+
+		addrinfo hints;
+		memset( &hints, 0, sizeof( hints ) );
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		addrinfo * result = NULL;
+		if( getaddrinfo( address.left( colon ).toUtf8().constData(),
+				address.mid( colon + 1 ).toUtf8().constData(),
+							&hints, &result ) != 0 )
+		{
+			fprintf( stderr, "Can't resolve %s\n",
+					_target.toUtf8().constData() );
+			return false;
+		}
+
+		int fd = -1;
+		for( addrinfo * a = result; a != NULL && fd < 0; a = a->ai_next )
+		{
+			fd = socket( a->ai_family, a->ai_socktype, a->ai_protocol );
+			if( fd >= 0 && ::connect( fd, a->ai_addr, a->ai_addrlen ) != 0 )
+			{
+				::close( fd );
+				fd = -1;
+			}
+		}
+		freeaddrinfo( result );
+
+		if( fd < 0 )
+		{
+			fprintf( stderr, "Can't connect to %s\n",
+					_target.toUtf8().constData() );
+			return false;
+		}
+		return m_stream.open( fd, QIODevice::WriteOnly |
+					QIODevice::Unbuffered,
+					QFileDevice::AutoCloseHandle );
+#else
+		fprintf( stderr, "Streaming to sockets isn't supported on "
+								"Windows\n" );
+		return false;
+#endif
+	}
+
+	// a pipe, which blocks until there's a reader
+	m_stream.setFileName( _target );
+	return m_stream.open( QIODevice::WriteOnly | QIODevice::Unbuffered );
+}
+
+
+
+
+bool AudioFileStream::writeHeader()
+{
+	if( m_raw )
+	{
+		return true;
+	}
+
+	// the sizes aren't known until the end, which a stream can't go back
+	// to, readers take the maximum as "until the stream ends"
+	const quint32 unknownSize = 0xffffffff;
+	const quint32 blockAlign = channels() * m_sampleBytes;
+
+	QByteArray header;
+	header += "RIFF";
+	putLittleEndian( header, unknownSize, 4 );
+	header += "WAVE";
+	header += "fmt ";
+	putLittleEndian( header, 16, 4 );
+	// 1 is integer PCM, 3 is IEEE float
+	putLittleEndian( header, m_sampleBytes == 4 ? 3 : 1, 2 );
+	putLittleEndian( header, channels(), 2 );
+	putLittleEndian( header, sampleRate(), 4 );
+	putLittleEndian( header, sampleRate() * blockAlign, 4 );
+	putLittleEndian( header, blockAlign, 2 );
+	putLittleEndian( header, m_sampleBytes * 8, 2 );
+	header += "data";
+	putLittleEndian( header, unknownSize, 4 );
+
+	return writeChunked( header.constData(), header.size() );
+}
+
+
+
+
+void AudioFileStream::writeBuffer( const surroundSampleFrame * _ab,
+						const fpp_t _frames,
+						const float _master_gain )
+{
+	if( m_failed )
+	{
+		return;
+	}
+
+	m_buffer.resize( _frames * channels() * m_sampleBytes );
+	uchar * out = reinterpret_cast<uchar *>( m_buffer.data() );
+	for( fpp_t frame = 0; frame < _frames; ++frame )
+	{
+		for( ch_cnt_t chnl = 0; chnl < channels(); ++chnl )
+		{
+			const float sample = _ab[frame][chnl] * _master_gain;
+			switch( m_sampleBytes )
+			{
+			case 4:
+			{
+				quint32 bits;
+				memcpy( &bits, &sample, sizeof( bits ) );
+				qToLittleEndian<quint32>( bits, out );
+				break;
+			}
+			case 3:
+			{
+				const qint32 value = qBound<qint32>( -8388608,
+					lrintf( sample * 8388607.0f ), 8388607 );
+				out[0] = value & 0xff;
+				out[1] = ( value >> 8 ) & 0xff;
+				out[2] = ( value >> 16 ) & 0xff;
+				break;
+			}
+			default:
+				qToLittleEndian<qint16>( qBound<qint32>( -32768,
+					lrintf( sample * 32767.0f ), 32767 ), out );
+				break;
+			}
+			out += m_sampleBytes;
+		}
+	}
+
+	writeChunked( m_buffer.constData(), m_buffer.size() );
+}
+
+
+
+
+bool AudioFileStream::writeChunked( const char * _data, qint64 _size )
+{
+	while( _size > 0 )
+	{
+		// blocks while the reader is behind, which holds up the
+		// encoder thread and, once its ring is full, the render
+		const qint64 chunk = qMin( _size, ChunkBytes );
+		const qint64 written = m_stream.isOpen() ?
+					m_stream.write( _data, chunk ) :
+					writeData( _data, chunk );
+		if( written <= 0 )
+		{
+			fprintf( stderr, "\nCould not write the export any "
+				"further, the reader may have gone away\n" );
+			m_failed = true;
+			return false;
+		}
+		_data += written;
+		_size -= written;
+	}
+	return true;
+}
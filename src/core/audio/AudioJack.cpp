@@ -35,6 +35,7 @@
 #include "gui_templates.h"
 #include "ConfigManager.h"
 #include "LcdSpinBox.h"
+#include "LedCheckbox.h"
 #include "AudioPort.h"
 #include "MainWindow.h"
 #include "Mixer.h"
@@ -49,6 +50,8 @@ AudioJack::AudioJack( bool & _success_ful, Mixer*  _mixer ) :
 		SURROUND_CHANNELS ), _mixer ),
 	m_client( NULL ),
 	m_active( false ),
+	m_renderInCallback( ConfigManager::inst()->value( "audiojack",
+						"rendercallback" ).toInt() ),
 	m_midiClient( NULL ),
 	m_tempOutBufs( new jack_default_audio_sample_t *[channels()] ),
 	m_outBuf( new surroundSampleFrame[mixer()->framesPerPeriod()] ),
@@ -169,6 +172,10 @@ bool AudioJack::initJackClient()
 	// set shutdown-callback
 	jack_on_shutdown( m_client, shutdownCallback, this );
 
+	// JACK reports xruns of any client, not just ours
+	jack_set_xrun_callback( m_client, xrunCallback, this );
+	m_detectsXruns = true;
+
 
 
 	if( jack_get_sample_rate( m_client ) != sampleRate() )
@@ -176,6 +183,18 @@ bool AudioJack::initJackClient()
 		setSampleRate( jack_get_sample_rate( m_client ) );
 	}
 
+	// the period of the mixer is fixed at startup, so a callback that is
+	// longer or shorter renders a varying number of periods
+	if( m_renderInCallback &&
+		jack_get_buffer_size( m_client ) != mixer()->framesPerPeriod() )
+	{
+		printf( "JACK runs with %d frames per period and LMMS with %d, "
+			"set both to the same size for rendering in the "
+			"JACK callback to work best\n",
+			(int) jack_get_buffer_size( m_client ),
+			(int) mixer()->framesPerPeriod() );
+	}
+
 	for( ch_cnt_t ch = 0; ch < channels(); ++ch )
 	{
 		QString name = QString( "master out " ) +
@@ -442,6 +461,15 @@ void AudioJack::shutdownCallback( void * _udata )
 
 
 
+int AudioJack::xrunCallback( void * _udata )
+{
+	static_cast<AudioJack *>( _udata )->reportXrun();
+	return 0;
+}
+
+
+
+
 
 AudioJack::setupWidget::setupWidget( QWidget * _parent ) :
 	AudioDeviceSetupWidget( AudioJack::name(), _parent )
@@ -469,6 +497,12 @@ AudioJack::setupWidget::setupWidget( QWidget * _parent ) :
 	m_channels->setLabel( tr( "Channels" ) );
 	m_channels->move( 180, 20 );
 
+	m_renderInCallback = new LedCheckBox(
+				tr( "Render in the JACK callback" ), this );
+	m_renderInCallback->move( 10, 60 );
+	m_renderInCallback->setChecked( ConfigManager::inst()->value(
+				"audiojack", "rendercallback" ).toInt() );
+
 }
 
 
@@ -488,6 +522,8 @@ void AudioJack::setupWidget::saveSettings()
 							m_clientName->text() );
 	ConfigManager::inst()->setValue( "audiojack", "channels",
 				QString::number( m_channels->value<int>() ) );
+	ConfigManager::inst()->setValue( "audiojack", "rendercallback",
+			QString::number( m_renderInCallback->isChecked() ) );
 }
 
 
@@ -24,12 +24,17 @@
 
 #include "AudioPort.h"
 #include "AudioDevice.h"
+#include "BBLoopCache.h"
 #include "EffectChain.h"
 #include "FxMixer.h"
 #include "Engine.h"
 #include "Mixer.h"
 #include "MixHelpers.h"
+#include "MixerWorkerThread.h"
 #include "BufferManager.h"
+#include "ScratchArena.h"
+#include "StemExporter.h"
+#include "ValueBuffer.h"
 
 
 AudioPort::AudioPort( const QString & _name, bool _has_effect_chain,
@@ -43,7 +48,18 @@ AudioPort::AudioPort( const QString & _name, bool _has_effect_chain,
 	m_effects( _has_effect_chain ? new EffectChain( NULL ) : NULL ),
 	m_volumeModel( volumeModel ),
 	m_panningModel( panningModel ),
-	m_mutedModel( mutedModel )
+	m_mutedModel( mutedModel ),
+	m_pendingPlayHandles( 0 ),
+	m_anticipative( false ),
+	m_renderedAhead( false ),
+	m_hasAheadOutput( false ),
+	m_sourceLatency( 0 ),
+	m_stemTap( NULL ),
+	m_stemTapPreEffects( false ),
+	m_freezeTap( NULL ),
+	m_freezeTapAfterEffects( false ),
+	m_frozenAfterEffects( false ),
+	m_loopCache( NULL )
 {
 	Engine::mixer()->addAudioPort( this );
 	setExtOutputEnabled( true );
@@ -94,15 +110,35 @@ bool AudioPort::processEffects()
 {
 	if( m_effects )
 	{
-		bool more = m_effects->processAudioBuffer( m_portBuffer, Engine::mixer()->framesPerPeriod(), m_bufferUsage );
+		const fpp_t fpp = Engine::mixer()->framesPerPeriod();
+		bool more = m_effects->processAudioBuffer( m_portBuffer, fpp, m_bufferUsage );
+		// a broken effect only clears this port, not the whole FX channel -
+		// the buffer is only passed on if there's anything in it
+		if( more || m_bufferUsage )
+		{
+			MixHelpers::sanitize( m_portBuffer, fpp );
+		}
 		return more;
 	}
 	return false;
 }
 
 
+f_cnt_t AudioPort::latency() const
+{
+	return m_sourceLatency + ( m_effects ? m_effects->latencyFrames() : 0 );
+}
+
+
+
+
 void AudioPort::doProcessing()
 {
+	m_hasAheadOutput = false;
+
+	// all play handles of the period are done
+	m_playHandleCpuUsage.finishPeriod();
+
 	if( m_mutedModel && m_mutedModel->value() )
 	{
 		return;
@@ -110,12 +146,19 @@ void AudioPort::doProcessing()
 
 	const fpp_t fpp = Engine::mixer()->framesPerPeriod();
 
-	// clear the buffer
-	BufferManager::clear( m_portBuffer, fpp );
-
+	// new play handles may be added while other ports are processed
+	m_playHandleLock.lock();
 	//qDebug( "Playhandles: %d", m_playHandles.size() );
-	for( PlayHandle * ph : m_playHandles ) // now we mix all playhandle buffers into the audioport buffer
+	ScratchBuffer<const sampleFrame *> sources( m_playHandles.size() );
+	int sourceCount = 0;
+	for( PlayHandle * ph : m_playHandles ) // now we collect all playhandle buffers to mix them into the audioport buffer
 	{
+		// play handles which finished in this period haven't been removed
+		// yet when running in a render graph - skip them like before
+		if( ph->isFinished() )
+		{
+			continue;
+		}
 		if( ph->buffer() )
 		{
 			if( ph->usesBuffer()
@@ -123,112 +166,125 @@ void AudioPort::doProcessing()
 					|| !MixHelpers::isSilent( ph->buffer(), fpp ) ) )
 			{
 				m_bufferUsage = true;
-				MixHelpers::add( m_portBuffer, ph->buffer(), fpp );
+				sources[sourceCount++] = ph->buffer();
 			}
-			ph->releaseBuffer(); 	// gets rid of playhandle's buffer and sets
-									// pointer to null, so if it doesn't get re-acquired we know to skip it next time
+			ph->releaseBuffer(); 	// marks the buffer as used (it stays valid until the next period), so if it
+									// doesn't get re-acquired we know to skip it next time
 		}
 	}
 
-	if( m_bufferUsage )
+	if( m_freezeTap && !m_freezeTapAfterEffects && sourceCount > 0 )
 	{
-		// handle volume and panning
-		// has both vol and pan models
-		if( m_volumeModel && m_panningModel )
-		{
-			ValueBuffer * volBuf = m_volumeModel->valueBuffer();
-			ValueBuffer * panBuf = m_panningModel->valueBuffer();
-
-			// both vol and pan have s.ex.data:
-			if( volBuf && panBuf )
-			{
-				for( f_cnt_t f = 0; f < fpp; ++f )
-				{
-					float v = volBuf->values()[ f ] * 0.01f;
-					float p = panBuf->values()[ f ] * 0.01f;
-					m_portBuffer[f][0] *= ( p <= 0 ? 1.0f : 1.0f - p ) * v;
-					m_portBuffer[f][1] *= ( p >= 0 ? 1.0f : 1.0f + p ) * v;
-				}
-			}
+		m_freezeTap->captureSum( sources.data(), sourceCount, fpp );
+	}
+	if( m_loopCache )
+	{
+		// silence is part of the loop as well
+		m_loopCache->capture( sources.data(), sourceCount, fpp );
+	}
 
-			// only vol has s.ex.data:
-			else if( volBuf )
-			{
-				float p = m_panningModel->value() * 0.01f;
-				float l = ( p <= 0 ? 1.0f : 1.0f - p );
-				float r = ( p >= 0 ? 1.0f : 1.0f + p );
-				for( f_cnt_t f = 0; f < fpp; ++f )
-				{
-					float v = volBuf->values()[ f ] * 0.01f;
-					m_portBuffer[f][0] *= v * l;
-					m_portBuffer[f][1] *= v * r;
-				}
-			}
+	// sum up the buffers and apply volume and panning in one pass over the
+	// port buffer, which gets cleared if there are none
+	// as of now there's no situation where we only have panning model but no volume model
+	// if we have neither, we don't have to do anything here - just pass the audio as is
+	const bool applyGains = m_volumeModel && !m_frozenAfterEffects;
+	ScratchBuffer<sampleFrame> gains( applyGains ? fpp : 0 );
+	if( sourceCount > 0 && applyGains )
+	{
+		ValueBuffer * volBuf = m_volumeModel->valueBuffer();
+		ValueBuffer * panBuf = m_panningModel ?
+					m_panningModel->valueBuffer() : NULL;
+		MixHelpers::stereoGains( gains.data(),
+				volBuf ? volBuf->values() : NULL, m_volumeModel->value(),
+				panBuf ? panBuf->values() : NULL,
+				m_panningModel ? m_panningModel->value() : 0.0f, fpp );
+	}
+	MixHelpers::sumMultipliedByGains( m_portBuffer, sources.data(), sourceCount,
+				applyGains ? gains.data() : NULL, fpp );
+	m_playHandleLock.unlock();
 
-			// only pan has s.ex.data:
-			else if( panBuf )
-			{
-				float v = m_volumeModel->value() * 0.01f;
-				for( f_cnt_t f = 0; f < fpp; ++f )
-				{
-					float p = panBuf->values()[ f ] * 0.01f;
-					m_portBuffer[f][0] *= ( p <= 0 ? 1.0f : 1.0f - p ) * v;
-					m_portBuffer[f][1] *= ( p >= 0 ? 1.0f : 1.0f + p ) * v;
-				}
-			}
+	if( m_stemTap && m_stemTapPreEffects && sourceCount > 0 )
+	{
+		m_stemTap->capture( m_portBuffer, fpp );
+	}
 
-			// neither has s.ex.data:
-			else
-			{
-				float p = m_panningModel->value() * 0.01f;
-				float v = m_volumeModel->value() * 0.01f;
-				for( f_cnt_t f = 0; f < fpp; ++f )
-				{
-					m_portBuffer[f][0] *= ( p <= 0 ? 1.0f : 1.0f - p ) * v;
-					m_portBuffer[f][1] *= ( p >= 0 ? 1.0f : 1.0f + p ) * v;
-				}
-			}
+	// handle effects, frozen audio has been through them and the latency
+	// compensation already
+	const bool me = !m_frozenAfterEffects && processEffects();
+	const bool hasOutput = me || m_bufferUsage;
+	const bool compensate = !m_frozenAfterEffects;
+	if( hasOutput || ( compensate && m_compensator.hasTail() ) )
+	{
+		// the delay keeps the output coming for a while once the input
+		// went silent
+		if( compensate )
+		{
+			m_compensator.process( m_portBuffer, fpp, !hasOutput );
 		}
 
-		// has vol model only
-		else if( m_volumeModel )
+		if( m_stemTap && !m_stemTapPreEffects )
 		{
-			ValueBuffer * volBuf = m_volumeModel->valueBuffer();
+			m_stemTap->capture( m_portBuffer, fpp );
+		}
+		if( m_freezeTap && m_freezeTapAfterEffects )
+		{
+			m_freezeTap->capture( m_portBuffer, fpp );
+		}
+		m_tap.write( m_portBuffer, fpp );
 
-			if( volBuf )
-			{
-				for( f_cnt_t f = 0; f < fpp; ++f )
-				{
-					float v = volBuf->values()[ f ] * 0.01f;
-					m_portBuffer[f][0] *= v;
-					m_portBuffer[f][1] *= v;
-				}
-			}
-			else
-			{
-				float v = m_volumeModel->value() * 0.01f;
-				for( f_cnt_t f = 0; f < fpp; ++f )
-				{
-					m_portBuffer[f][0] *= v;
-					m_portBuffer[f][1] *= v;
-				}
-			}
+		if( m_renderedAhead )
+		{
+			// keep it for the next period, see mixAheadOutput()
+			m_hasAheadOutput = true;
+		}
+		else
+		{
+			Engine::fxMixer()->mixToChannel( m_portBuffer, m_nextFxChannel ); 	// send output to fx mixer
+																				// TODO: improve the flow here - convert to pull model
 		}
+		m_bufferUsage = false;
 	}
-	// as of now there's no situation where we only have panning model but no volume model
-	// if we have neither, we don't have to do anything here - just pass the audio as is
+	else
+	{
+		m_tap.write( NULL, fpp );
+	}
+}
+
 
-	// handle effects
-	const bool me = processEffects();
-	if( me || m_bufferUsage )
+void AudioPort::mixAheadOutput()
+{
+	if( m_hasAheadOutput )
 	{
-		Engine::fxMixer()->mixToChannel( m_portBuffer, m_nextFxChannel ); 	// send output to fx mixer
-																			// TODO: improve the flow here - convert to pull model
-		m_bufferUsage = false;
+		Engine::fxMixer()->mixToChannel( m_portBuffer, m_nextFxChannel );
+		m_hasAheadOutput = false;
 	}
 }
 
 
+void AudioPort::prepareRenderGraph()
+{
+	// hold back one pending input until all play handles are queued
+	m_pendingPlayHandles = 1;
+
+	FxMixer * fxMixer = Engine::fxMixer();
+	setSuccessor( m_nextFxChannel < fxMixer->numChannels() ?
+			fxMixer->effectChannel( m_nextFxChannel ) : nullptr );
+}
+
+
+
+
+void AudioPort::predecessorDone()
+{
+	if( --m_pendingPlayHandles == 0 )
+	{
+		MixerWorkerThread::addJob( this );
+	}
+}
+
+
+
+
 void AudioPort::addPlayHandle( PlayHandle * handle )
 {
 	m_playHandleLock.lock();
@@ -63,6 +63,9 @@ AudioPortAudio::AudioPortAudio( bool & _success_ful, Mixer * _mixer ) :
 	m_outBufPos( 0 )
 {
 	_success_ful = false;
+#ifdef PORTAUDIO_V19
+	m_detectsXruns = true;
+#endif
 
 	m_outBufSize = mixer()->framesPerPeriod();
 
@@ -322,9 +325,12 @@ int AudioPortAudio::_process_callback(
 	void * _arg )
 {
 	Q_UNUSED(_timeInfo);
-	Q_UNUSED(_statusFlags);
 
 	AudioPortAudio * _this  = static_cast<AudioPortAudio *> (_arg);
+	if( _statusFlags & paOutputUnderflow )
+	{
+		_this->reportXrun();
+	}
 	return _this->process_callback( (const float*)_inputBuffer,
 		(float*)_outputBuffer, _framesPerBuffer );
 }
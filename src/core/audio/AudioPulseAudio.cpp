@@ -44,6 +44,14 @@ static void stream_write_callback(pa_stream *s, size_t length, void *userdata)
 
 
 
+static void stream_underflow_callback( pa_stream *, void *userdata )
+{
+	static_cast<AudioPulseAudio *>( userdata )->streamUnderflowCallback();
+}
+
+
+
+
 AudioPulseAudio::AudioPulseAudio( bool & _success_ful, Mixer*  _mixer ) :
 	AudioDevice( qBound<ch_cnt_t>(
 		DEFAULT_CHANNELS,
@@ -54,6 +62,7 @@ AudioPulseAudio::AudioPulseAudio( bool & _success_ful, Mixer*  _mixer ) :
 	m_convertEndian( false )
 {
 	_success_ful = false;
+	m_detectsXruns = true;
 
 	m_sampleSpec.format = PA_SAMPLE_S16LE;
 	m_sampleSpec.rate = sampleRate();
@@ -164,6 +173,7 @@ static void context_state_callback(pa_context *c, void *userdata)
 			_this->m_s = pa_stream_new( c, "lmms", &_this->m_sampleSpec,  NULL);
 			pa_stream_set_state_callback( _this->m_s, stream_state_callback, _this );
 			pa_stream_set_write_callback( _this->m_s, stream_write_callback, _this );
+			pa_stream_set_underflow_callback( _this->m_s, stream_underflow_callback, _this );
 
 			pa_buffer_attr buffer_attr;
 
@@ -25,6 +25,7 @@
 
 
 #include "AudioSampleRecorder.h"
+#include "RecordingWriter.h"
 #include "SampleBuffer.h"
 #include "debug.h"
 
@@ -34,7 +35,9 @@ AudioSampleRecorder::AudioSampleRecorder( const ch_cnt_t _channels,
 							bool & _success_ful,
 							Mixer * _mixer ) :
 	AudioDevice( _channels, _mixer ),
-	m_buffers()
+	m_writer( new RecordingWriter(
+			RecordingWriter::newFileName( "rendered" ),
+							sampleRate() ) )
 {
 	_success_ful = true;
 }
@@ -44,11 +47,7 @@ AudioSampleRecorder::AudioSampleRecorder( const ch_cnt_t _channels,
 
 AudioSampleRecorder::~AudioSampleRecorder()
 {
-	while( !m_buffers.empty() )
-	{
-		delete[] m_buffers.front().first;
-		m_buffers.erase( m_buffers.begin() );
-	}
+	delete m_writer;
 }
 
 
@@ -56,13 +55,7 @@ AudioSampleRecorder::~AudioSampleRecorder()
 
 f_cnt_t AudioSampleRecorder::framesRecorded() const
 {
-	f_cnt_t frames = 0;
-	for( BufferList::ConstIterator it = m_buffers.begin();
-						it != m_buffers.end(); ++it )
-	{
-		frames += ( *it ).second;
-	}
-	return frames;
+	return m_writer->framesRecorded();
 }
 
 
@@ -70,27 +63,8 @@ f_cnt_t AudioSampleRecorder::framesRecorded() const
 
 void AudioSampleRecorder::createSampleBuffer( SampleBuffer** sampleBuf )
 {
-	const f_cnt_t frames = framesRecorded();
-	// create buffer to store all recorded buffers in
-	sampleFrame * data = new sampleFrame[frames];
-	// make sure buffer is cleaned up properly at the end...
-	sampleFrame * data_ptr = data;
-
-
-	assert( data != NULL );
-
-	// now copy all buffers into big buffer
-	for( BufferList::ConstIterator it = m_buffers.begin();
-						it != m_buffers.end(); ++it )
-	{
-		memcpy( data_ptr, ( *it ).first, ( *it ).second *
-							sizeof( sampleFrame ) );
-		data_ptr += ( *it ).second;
-	}
-	// create according sample-buffer out of big buffer
-	*sampleBuf = new SampleBuffer( data, frames );
-	( *sampleBuf )->setSampleRate( sampleRate() );
-	delete[] data;
+	*sampleBuf = m_writer->finish() ?
+			new SampleBuffer( m_writer->fileName() ) : NULL;
 }
 
 
@@ -99,15 +73,21 @@ void AudioSampleRecorder::createSampleBuffer( SampleBuffer** sampleBuf )
 void AudioSampleRecorder::writeBuffer( const surroundSampleFrame * _ab,
 					const fpp_t _frames, const float )
 {
-	sampleFrame * buf = new sampleFrame[_frames];
-	for( fpp_t frame = 0; frame < _frames; ++frame )
+	sampleFrame buf[DEFAULT_BUFFER_SIZE];
+	for( fpp_t done = 0; done < _frames; )
 	{
-		for( ch_cnt_t chnl = 0; chnl < DEFAULT_CHANNELS; ++chnl )
+		const fpp_t frames = qMin<fpp_t>( _frames - done,
+							DEFAULT_BUFFER_SIZE );
+		for( fpp_t frame = 0; frame < frames; ++frame )
 		{
-			buf[frame][chnl] = _ab[frame][chnl];
+			for( ch_cnt_t chnl = 0; chnl < DEFAULT_CHANNELS; ++chnl )
+			{
+				buf[frame][chnl] = _ab[done + frame][chnl];
+			}
 		}
+		m_writer->write( buf, frames );
+		done += frames;
 	}
-	m_buffers.push_back( qMakePair( buf, _frames ) );
 }
 
 
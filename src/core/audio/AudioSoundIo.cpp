@@ -43,6 +43,7 @@ AudioSoundIo::AudioSoundIo( bool & outSuccessful, Mixer * _mixer ) :
 		SURROUND_CHANNELS ), _mixer )
 {
 	outSuccessful = false;
+	m_detectsXruns = true;
 	m_soundio = NULL;
 	m_outstream = NULL;
 	m_outBuf = NULL;
@@ -243,6 +244,7 @@ void AudioSoundIo::errorCallback(int err)
 
 void AudioSoundIo::underflowCallback()
 {
+	reportXrun();
 	fprintf(stderr, "soundio: buffer underflow reported\n");
 }
 
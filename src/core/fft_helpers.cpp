@@ -27,6 +27,14 @@
 #include "fft_helpers.h"
 
 #include <cmath>
+#include <map>
+#include <tuple>
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QStandardPaths>
+
 #include "lmms_constants.h"
 
 /* Returns biggest value from abs_spectrum[spec_size] array.
@@ -212,3 +220,86 @@ int compressbands(const float *absspec_buffer, float *compressedband, int num_ol
 
 	return 0;
 }
+
+
+// plans by size, count, whether they run on unaligned arrays and whether
+// they're inverse FFTs
+typedef std::tuple<unsigned int, unsigned int, bool, bool> PlanKey;
+
+static QMutex s_planMutex;
+static std::map<PlanKey, fftwf_plan> s_plans;
+
+
+static QByteArray wisdomFile()
+{
+	const QString dir = QStandardPaths::writableLocation(
+		QStandardPaths::GenericConfigLocation) + "/lmms";
+	QDir().mkpath(dir);
+	return QFile::encodeName(dir + "/fftw-wisdom");
+}
+
+
+/* Returns a shared, cached plan for count real FFTs of size, inverse ones
+ * from complex to real if inverse is set. The FFTW planner isn't
+ * thread-safe, so all planning happens under s_planMutex. New plans are
+ * measured on scratch arrays, which leaves the caller's data alone, and
+ * added to the wisdom file right away.
+ *
+ * return NULL on error
+ */
+static fftwf_plan sharedPlan(unsigned int size, const float *real, const fftwf_complex *complex,
+	unsigned int count, bool inverse)
+{
+	if (size == 0 || count == 0) {return NULL;}
+
+	// new-array execution needs arrays aligned like the planned ones
+	const bool unaligned = fftwf_alignment_of(const_cast<float *>(real)) != 0 ||
+		fftwf_alignment_of(reinterpret_cast<float *>(const_cast<fftwf_complex *>(complex))) != 0;
+	const PlanKey key(size, count, unaligned, inverse);
+
+	QMutexLocker lock(&s_planMutex);
+
+	auto it = s_plans.find(key);
+	if (it != s_plans.end()) {return it->second;}
+
+	static bool wisdomLoaded = false;
+	if (!wisdomLoaded)
+	{
+		fftwf_import_wisdom_from_filename(wisdomFile().constData());
+		wisdomLoaded = true;
+	}
+
+	const int n = size;
+	const int bins = size / 2 + 1;
+	float *in = (float *) fftwf_malloc(size * count * sizeof(float));
+	fftwf_complex *out = (fftwf_complex *) fftwf_malloc(bins * count * sizeof(fftwf_complex));
+	fftwf_plan plan = NULL;
+	if (in != NULL && out != NULL)
+	{
+		const unsigned int flags = FFTW_MEASURE | (unaligned ? FFTW_UNALIGNED : 0);
+		plan = inverse ?
+			fftwf_plan_many_dft_c2r(1, &n, count, out, NULL, 1, bins, in, NULL, 1, size, flags) :
+			fftwf_plan_many_dft_r2c(1, &n, count, in, NULL, 1, size, out, NULL, 1, bins, flags);
+	}
+	fftwf_free(in);
+	fftwf_free(out);
+
+	if (plan != NULL)
+	{
+		s_plans[key] = plan;
+		fftwf_export_wisdom_to_filename(wisdomFile().constData());
+	}
+	return plan;
+}
+
+
+fftwf_plan realFFTPlan(unsigned int size, const float *input, const fftwf_complex *output, unsigned int count)
+{
+	return sharedPlan(size, input, output, count, false);
+}
+
+
+fftwf_plan realIFFTPlan(unsigned int size, const fftwf_complex *input, const float *output, unsigned int count)
+{
+	return sharedPlan(size, output, input, count, true);
+}
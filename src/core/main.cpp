@@ -39,6 +39,9 @@
 #include <QPushButton>
 #include <QTextStream>
 
+#include <cmath>
+#include <memory>
+
 #ifdef LMMS_BUILD_WIN32
 #include <windows.h>
 #endif
@@ -58,19 +61,27 @@
 #include <signal.h>
 
 #include "MainApplication.h"
+#include "AudioFileStream.h"
 #include "ConfigManager.h"
+#include "CostEstimator.h"
 #include "NotePlayHandle.h"
 #include "embed.h"
 #include "Engine.h"
 #include "GuiApplication.h"
 #include "ImportFilter.h"
 #include "MainWindow.h"
+#include "MemoryManager.h"
 #include "MixHelpers.h"
 #include "OutputSettings.h"
 #include "ProjectRenderer.h"
+#include "RenderBatch.h"
+#include "RenderDaemon.h"
 #include "RenderManager.h"
+#include "RenderStatsExporter.h"
+#include "SegmentStitcher.h"
 #include "Song.h"
 #include "SetupDialog.h"
+#include "TraceRecorder.h"
 
 #ifdef LMMS_DEBUG_FPE
 #include <fenv.h> // For feenableexcept
@@ -160,9 +171,27 @@ void printHelp()
 		"Usage: lmms [global options...] [<action> [action parameters...]]\n\n"
 		"Actions:\n"
 		"  <no action> [options...] [<project>]  Start LMMS in normal GUI mode\n"
+		"  daemon [--listen <socket>]            Keep running and render the jobs\n"
+		"                                        sent to standard input, or to the\n"
+		"                                        local <socket>, one per line:\n"
+		"                                        render <project> <out> [<priority>]\n"
+		"                                        preview <project> <out> <start>:<end>\n"
+		"                                        [<priority>], cancel <id>, jobs, quit\n"
 		"  dump <in>                             Dump XML of compressed file <in>\n"
+		"  estimate <project> [options...]       Render <project> and estimate the\n"
+		"                                        load of each track and FX channel\n"
+		"                                        with the period size and the cores\n"
+		"                                        it will be played with, and what to\n"
+		"                                        change if it doesn't fit\n"
 		"  render <project> [options...]         Render given project file\n"
 		"  rendertracks <project> [options...]   Render each track to a different file\n"
+		"  renderbatch <manifest> [options...]   Render the projects listed in\n"
+		"                                        <manifest> in one process, one\n"
+		"                                        project and its output file per\n"
+		"                                        line\n"
+		"  stitch <out> <segment>...             Join segments rendered with --range\n"
+		"                                        into <out>, whose extension tells\n"
+		"                                        the format\n"
 		"  upgrade <in> [out]                    Upgrade file <in> and save as <out>\n"
 		"                                        Standard out is used if no output file\n"
 		"                                        is specified\n"
@@ -171,6 +200,10 @@ void printHelp()
 		"          caution).\n"
 		"  -c, --config <configfile>      Get the configuration from <configfile>\n"
 		"  -h, --help                     Show this usage information and exit.\n"
+		"      --profile-startup          Print how long each phase of the\n"
+		"          startup took\n"
+		"      --stats-udp <host:port>    Send load, voices, effects and memory\n"
+		"          use as OSC messages to <host:port> while running\n"
 		"  -v, --version                  Show version information and exit.\n"
 		"\nOptions if no action is given:\n"
 		"      --geometry <geometry>      Specify the size and position of\n"
@@ -178,12 +211,22 @@ void printHelp()
 		"          geometry is <xsizexysize+xoffset+yoffsety>.\n"
 		"      --import <in> [-e]         Import MIDI or Hydrogen file <in>.\n"
 		"          If -e is specified lmms exits after importing the file.\n"
-		"\nOptions for \"render\" and \"rendertracks\":\n"
+		"\nOptions for \"estimate\":\n"
+		"      --cores <cores>            Cores to estimate for. Default: the\n"
+		"          cores of this machine\n"
+		"      --period <frames>          Frames per period to estimate for.\n"
+		"          Default: the buffer size in the settings\n"
+		"          The quality options and --range of \"render\" apply as well\n"
+		"\nOptions for \"render\", \"rendertracks\", \"renderbatch\" and \"daemon\":\n"
 		"  -a, --float                    Use 32bit float bit depth\n"
 		"  -b, --bitrate <bitrate>        Specify output bitrate in KBit/s\n"
 		"          Default: 160.\n"
+		"      --cache <dir>              For \"render\", keep the rendered bars\n"
+		"          in <dir> and only render the ones which changed since the\n"
+		"          last render into <dir> again\n"
 		"  -f, --format <format>         Specify format of render-output where\n"
-		"          Format is either 'wav', 'flac', 'ogg' or 'mp3'.\n"
+		"          Format is either 'wav', 'flac', 'ogg', 'mp3' or 'raw'\n"
+		"          (interleaved little endian PCM).\n"
 		"  -i, --interpolation <method>   Specify interpolation method\n"
 		"          Possible values:\n"
 		"            - linear\n"
@@ -191,18 +234,36 @@ void printHelp()
 		"            - sincmedium\n"
 		"            - sincbest\n"
 		"  -l, --loop                     Render as a loop\n"
+		"      --memory-report            Print the memory used per subsystem\n"
+		"          after rendering\n"
 		"  -m, --mode                     Stereo mode used for MP3 export\n"
 		"          Possible values: s, j, m\n"
 		"            s: Stereo\n"
 		"            j: Joint Stereo\n"
 		"            m: Mono\n"
 		"          Default: j\n"
+		"      --crossfade <frames>       For --range, --cache and \"stitch\",\n"
+		"          frames of a segment beyond its end which get crossfaded\n"
+		"          with the next one. Default: 1024\n"
 		"  -o, --output <path>            Render into <path>\n"
 		"          For \"render\", provide a file path\n"
 		"          For \"rendertracks\", provide a directory path\n"
 		"          If not specified, render will overwrite the input file\n"
 		"          For \"rendertracks\", this might be required\n"
-		"  -p, --profile <out>            Dump profiling information to file <out>\n"
+		"          For \"render\", '-' streams 'wav' or 'raw' to standard\n"
+		"          output while rendering, as does tcp://<host>:<port>\n"
+		"          to a connection there and a path of a named pipe\n"
+		"      --pre-fx                   For \"rendertracks\", take the tracks\n"
+		"          before their effects\n"
+		"      --preroll <bars>           For --range and --cache, start playing\n"
+		"          <bars> bars earlier so tails and releases are there.\n"
+		"          Default: 1\n"
+		"  -p, --profile <out>            Dump timings of each period as CSV to\n"
+		"          file <out>, print a summary and write a timeline of the\n"
+		"          render to <out>.trace.json\n"
+		"          (open in chrome://tracing or ui.perfetto.dev)\n"
+		"      --range <start>:<end>      For \"render\", only render from bar\n"
+		"          <start> to bar <end>, e.g. as a segment for \"stitch\"\n"
 		"  -s, --samplerate <samplerate>  Specify output samplerate in Hz\n"
 		"          Range: 44100 (default) to 192000\n"
 		"  -x, --oversampling <value>     Specify oversampling\n"
@@ -300,7 +361,19 @@ int main( int argc, char * * argv )
 	bool allowRoot = false;
 	bool renderLoop = false;
 	bool renderTracks = false;
+	bool memoryReport = false;
+	bool stemsPreEffects = false;
+	bool hasRange = false;
+	bool daemon = false;
+	bool estimate = false;
+	int rangeBegin = 0, rangeEnd = 0, preRoll = 1;
+	int estimateCores = QThread::idealThreadCount();
+	fpp_t estimateFrames = 0;
+	f_cnt_t crossfade = 1024;
+	QString stitchOut, cacheDir, batchManifest, daemonSocket;
+	QStringList segments;
 	QString fileToLoad, fileToImport, renderOut, profilerOutputFile, configFile;
+	QString statsTarget;
 
 	// first of two command-line parsing stages
 	for( int i = 1; i < argc; ++i )
@@ -318,6 +391,12 @@ int main( int argc, char * * argv )
 			coreOnly = true;
 			renderTracks = true;
 		}
+		else if( arg == "stitch" || arg == "renderbatch" ||
+					arg == "--render-batch" || arg == "daemon" ||
+					arg == "estimate" )
+		{
+			coreOnly = true;
+		}
 		else if( arg == "--allowroot" )
 		{
 			allowRoot = true;
@@ -441,6 +520,18 @@ int main( int argc, char * * argv )
 			fileToLoad = QString::fromLocal8Bit( argv[i] );
 			renderOut = fileToLoad;
 		}
+		else if( arg == "renderbatch" || arg == "--render-batch" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				return usageError( "No manifest specified" );
+			}
+
+
+			batchManifest = QString::fromLocal8Bit( argv[i] );
+		}
 		else if( arg == "--loop" || arg == "-l" )
 		{
 			renderLoop = true;
@@ -489,6 +580,10 @@ int main( int argc, char * * argv )
 			{
 				eff = ProjectRenderer::FlacFile;
 			}
+			else if( ext == "raw" )
+			{
+				eff = ProjectRenderer::RawFile;
+			}
 			else
 			{
 				return usageError( QString( "Invalid output format %1" ).arg( argv[i] ) );
@@ -650,6 +745,179 @@ int main( int argc, char * * argv )
 				++i;
 			}
 		}
+		else if( arg == "--stats-udp" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				return usageError( "No host and port specified" );
+			}
+
+			statsTarget = QString::fromLocal8Bit( argv[i] );
+		}
+		else if( arg == "--memory-report" )
+		{
+			memoryReport = true;
+		}
+		else if( arg == "--profile-startup" )
+		{
+			Engine::setProfileStartup( true );
+		}
+		else if( arg == "--pre-fx" )
+		{
+			stemsPreEffects = true;
+		}
+		else if( arg == "--range" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				return usageError( "No range specified" );
+			}
+
+
+			const QStringList bars = QString( argv[i] ).split( ':' );
+			bool beginOk = false, endOk = false;
+			if( bars.size() == 2 )
+			{
+				rangeBegin = bars[0].toInt( &beginOk );
+				rangeEnd = bars[1].toInt( &endOk );
+			}
+			if( !beginOk || !endOk || rangeBegin < 1 ||
+							rangeEnd <= rangeBegin )
+			{
+				return usageError( QString( "Invalid range %1" ).arg( argv[i] ) );
+			}
+			hasRange = true;
+		}
+		else if( arg == "daemon" )
+		{
+			daemon = true;
+		}
+		else if( arg == "estimate" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				return noInputFileError();
+			}
+
+
+			fileToLoad = QString::fromLocal8Bit( argv[i] );
+			estimate = true;
+		}
+		else if( arg == "--cores" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				return usageError( "No number of cores specified" );
+			}
+
+
+			bool ok = false;
+			estimateCores = QString( argv[i] ).toInt( &ok );
+			if( !ok || estimateCores < 1 )
+			{
+				return usageError( QString( "Invalid number of cores %1" ).arg( argv[i] ) );
+			}
+		}
+		else if( arg == "--period" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				return usageError( "No period size specified" );
+			}
+
+
+			bool ok = false;
+			estimateFrames = QString( argv[i] ).toInt( &ok );
+			if( !ok || estimateFrames < MINIMUM_BUFFER_SIZE )
+			{
+				return usageError( QString( "Invalid period size %1" ).arg( argv[i] ) );
+			}
+		}
+		else if( arg == "--listen" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				return usageError( "No socket specified" );
+			}
+
+
+			daemonSocket = QString::fromLocal8Bit( argv[i] );
+		}
+		else if( arg == "--cache" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				return usageError( "No cache directory specified" );
+			}
+
+
+			cacheDir = QString::fromLocal8Bit( argv[i] );
+		}
+		else if( arg == "--preroll" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				return usageError( "No pre-roll specified" );
+			}
+
+
+			bool ok = false;
+			preRoll = QString( argv[i] ).toInt( &ok );
+			if( !ok || preRoll < 0 )
+			{
+				return usageError( QString( "Invalid pre-roll %1" ).arg( argv[i] ) );
+			}
+		}
+		else if( arg == "--crossfade" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				return usageError( "No crossfade specified" );
+			}
+
+
+			bool ok = false;
+			crossfade = QString( argv[i] ).toInt( &ok );
+			if( !ok || crossfade < 0 )
+			{
+				return usageError( QString( "Invalid crossfade %1" ).arg( argv[i] ) );
+			}
+		}
+		else if( arg == "stitch" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				return usageError( "No output file specified" );
+			}
+
+
+			stitchOut = QString::fromLocal8Bit( argv[i] );
+			// the segments go up to the next option
+			while( i + 1 < argc && argv[i + 1][0] != '-' )
+			{
+				segments << QString::fromLocal8Bit( argv[++i] );
+			}
+		}
 		else if( arg == "--profile" || arg == "-p" )
 		{
 			++i;
@@ -758,10 +1026,205 @@ int main( int argc, char * * argv )
 
 	bool destroyEngine = false;
 
+	if( !stitchOut.isEmpty() )
+	{
+		Engine::init( true );
+
+		SegmentStitcher stitcher( segments, crossfade );
+		if( !stitcher.open() )
+		{
+			return usageError( stitcher.errorString() );
+		}
+		os.setSampleRate( stitcher.sampleRate() );
+
+		const ProjectRenderer::ExportFileFormats format =
+			ProjectRenderer::getFileFormatFromExtension(
+					"." + QFileInfo( stitchOut ).suffix() );
+		AudioFileDeviceInstantiaton factory =
+			ProjectRenderer::fileEncodeDevices[format].m_getDevInst;
+		bool successful = false;
+		AudioFileDevice * dev = factory ? factory( stitchOut, os,
+				DEFAULT_CHANNELS, Engine::mixer(), successful ) : NULL;
+		if( !successful )
+		{
+			delete dev;
+			return usageError( QString( "Can't write %1" ).arg( stitchOut ) );
+		}
+
+		const bool stitched = stitcher.stitch( dev );
+		delete dev;
+		Engine::destroy();
+		if( !stitched )
+		{
+			printf( "%s\n", stitcher.errorString().toUtf8().constData() );
+			return EXIT_FAILURE;
+		}
+
+		// segments whose pre-roll was too short differ where they overlap
+		for( int i = 0; i < stitcher.differences().size(); ++i )
+		{
+			const float difference = stitcher.differences()[i];
+			printf( "Segments %d and %d differ by %.1f dBFS%s\n", i + 1,
+				i + 2, 20.0f * log10f( qMax( difference, 1e-10f ) ),
+				difference > 0.001f ?
+					", consider a longer pre-roll" : "" );
+		}
+		return EXIT_SUCCESS;
+	}
+
+	// render the jobs sent to the daemon until it's told to quit
+	if( daemon )
+	{
+		if( hasRange || !cacheDir.isEmpty() || renderTracks ||
+						!batchManifest.isEmpty() )
+		{
+			return usageError( "The jobs of \"daemon\" tell what "
+							"to render" );
+		}
+
+		Engine::init( true );
+		destroyEngine = true;
+
+		RenderDaemon * renderDaemon = new RenderDaemon( daemonSocket,
+								qs, os );
+		QString error;
+		if( !renderDaemon->start( error ) )
+		{
+			return usageError( error );
+		}
+		QObject::connect( renderDaemon, &RenderDaemon::finished, []()
+		{
+			QCoreApplication::exit( EXIT_SUCCESS );
+		} );
+		// before the engine goes, which removes the socket
+		QObject::connect( app, &QCoreApplication::aboutToQuit,
+					[renderDaemon]() { delete renderDaemon; } );
+
+		if( profilerOutputFile.isEmpty() == false )
+		{
+			Engine::mixer()->profiler().setOutputFile( profilerOutputFile );
+			TraceRecorder::setRecording( true );
+		}
+	}
+	// render the project and tell whether it fits the machine it will be
+	// played on
+	else if( estimate )
+	{
+		if( !cacheDir.isEmpty() || renderTracks )
+		{
+			return usageError( "\"estimate\" renders the whole mix" );
+		}
+		if( estimateFrames == 0 )
+		{
+			estimateFrames = qMax<int>( ConfigManager::inst()->value(
+				"mixer", "framesperaudiobuffer" ).toInt(),
+							MINIMUM_BUFFER_SIZE );
+		}
+
+		Engine::init( true );
+		destroyEngine = true;
+
+		printf( "Loading project...\n" );
+		Engine::getSong()->loadProject( fileToLoad );
+		if( Engine::getSong()->isEmpty() )
+		{
+			printf( "The project %s is empty, aborting!\n", fileToLoad.toUtf8().constData() );
+			exit( EXIT_FAILURE );
+		}
+		printf( "Done\n" );
+
+		if( hasRange )
+		{
+			Engine::getSong()->setExportRange(
+						MidiTime( rangeBegin - 1, 0 ),
+						MidiTime( rangeEnd - 1, 0 ),
+						MidiTime( preRoll, 0 ), crossfade );
+		}
+
+		CostEstimator * estimator = new CostEstimator( qs, os,
+						estimateFrames, estimateCores );
+		QObject::connect( estimator, &CostEstimator::finished, [estimator]()
+		{
+			QCoreApplication::exit( estimator->failed() ?
+						EXIT_FAILURE : EXIT_SUCCESS );
+		} );
+
+		// timer for progress-updates
+		QTimer * t = new QTimer( estimator );
+		estimator->connect( t, SIGNAL( timeout() ),
+				SLOT( updateConsoleProgress() ) );
+		t->start( 200 );
+
+		// once the event loop runs, which the estimator quits
+		QTimer::singleShot( 0, estimator, SLOT( start() ) );
+	}
+	// render the projects of a batch one after the other, without starting
+	// over for each of them
+	else if( !batchManifest.isEmpty() )
+	{
+		if( hasRange || !cacheDir.isEmpty() || renderTracks )
+		{
+			return usageError( "\"renderbatch\" renders whole projects "
+					"into single files" );
+		}
+
+		QVector<RenderBatch::Job> jobs;
+		QString error;
+		if( !RenderBatch::readManifest( batchManifest, jobs, error ) )
+		{
+			return usageError( error );
+		}
+
+		Engine::init( true );
+		destroyEngine = true;
+
+		RenderBatch * batch = new RenderBatch( jobs, qs, os, renderLoop );
+		QObject::connect( batch, &RenderBatch::finished, [batch]()
+		{
+			QCoreApplication::exit( batch->failed() > 0 ?
+						EXIT_FAILURE : EXIT_SUCCESS );
+		} );
+
+		// timer for progress-updates
+		QTimer * t = new QTimer( batch );
+		batch->connect( t, SIGNAL( timeout() ),
+				SLOT( updateConsoleProgress() ) );
+		t->start( 200 );
+
+		if( profilerOutputFile.isEmpty() == false )
+		{
+			Engine::mixer()->profiler().setOutputFile( profilerOutputFile );
+			TraceRecorder::setRecording( true );
+		}
+
+		// once the event loop runs, which the batch quits
+		QTimer::singleShot( 0, batch, SLOT( start() ) );
+	}
 	// if we have an output file for rendering, just render the song
 	// without starting the GUI
-	if( !renderOut.isEmpty() )
+	else if( !renderOut.isEmpty() )
 	{
+		const bool streaming = !renderTracks &&
+					AudioFileStream::isStream( renderOut );
+		if( streaming )
+		{
+			if( eff != ProjectRenderer::WaveFile &&
+					eff != ProjectRenderer::RawFile )
+			{
+				return usageError( "Only 'wav' and 'raw' can be "
+						"streamed while rendering" );
+			}
+			if( !cacheDir.isEmpty() )
+			{
+				return usageError( "--cache can't render into "
+								"a stream" );
+			}
+			if( renderOut == "-" )
+			{
+				AudioFileStream::reserveStandardOutput();
+			}
+		}
+
 		Engine::init( true );
 		destroyEngine = true;
 
@@ -776,9 +1239,28 @@ int main( int argc, char * * argv )
 
 		Engine::getSong()->setExportLoop( renderLoop );
 
+		if( hasRange )
+		{
+			if( renderTracks )
+			{
+				return usageError( "--range only works with \"render\"" );
+			}
+			Engine::getSong()->setExportRange(
+						MidiTime( rangeBegin - 1, 0 ),
+						MidiTime( rangeEnd - 1, 0 ),
+						MidiTime( preRoll, 0 ), crossfade );
+		}
+		if( !cacheDir.isEmpty() && ( renderTracks || hasRange ||
+								renderLoop ) )
+		{
+			return usageError( "--cache only works with \"render\", "
+					"without --range and --loop" );
+		}
+
 		// when rendering multiple tracks, renderOut is a directory
 		// otherwise, it is a file, so we need to append the file extension
-		if ( !renderTracks )
+		// a stream has no name to append it to
+		if ( !renderTracks && !streaming )
 		{
 			renderOut = baseName( renderOut ) +
 				ProjectRenderer::getFileExtensionFromFormat(eff);
@@ -798,12 +1280,19 @@ int main( int argc, char * * argv )
 		if( profilerOutputFile.isEmpty() == false )
 		{
 			Engine::mixer()->profiler().setOutputFile( profilerOutputFile );
+			TraceRecorder::setRecording( true );
 		}
 
 		// start now!
 		if ( renderTracks )
 		{
-			r->renderTracks();
+			r->renderTracks( stemsPreEffects ?
+						StemExporter::PreEffects :
+						StemExporter::PostEffects );
+		}
+		else if( !cacheDir.isEmpty() )
+		{
+			r->renderIncrementally( cacheDir, preRoll, crossfade );
 		}
 		else
 		{
@@ -969,9 +1458,50 @@ int main( int argc, char * * argv )
 		}
 	}
 
+	std::unique_ptr<RenderStatsExporter> statsExporter;
+	if( !statsTarget.isEmpty() )
+	{
+		statsExporter.reset( new RenderStatsExporter( statsTarget ) );
+		if( statsExporter->isValid() )
+		{
+			statsExporter->start( QThread::LowPriority );
+		}
+		else
+		{
+			printf( "Can not send stats to %s\n",
+					statsTarget.toUtf8().constData() );
+			statsExporter.reset();
+		}
+	}
+
 	const int ret = app->exec();
+	// it reads from the mixer
+	statsExporter.reset();
 	delete app;
 
+	if( !profilerOutputFile.isEmpty() && coreOnly )
+	{
+		printf( "\n\n%s", Engine::mixer()->profiler().summary().
+						toUtf8().constData() );
+	}
+
+	if( TraceRecorder::isRecording() )
+	{
+		TraceRecorder::setRecording( false );
+		const QString traceFile = profilerOutputFile + ".trace.json";
+		if( !TraceRecorder::writeChromeTrace( traceFile ) )
+		{
+			printf( "Could not write trace to %s\n",
+					traceFile.toUtf8().constData() );
+		}
+	}
+
+	// while the project is still loaded
+	if( memoryReport )
+	{
+		printf( "\n%s", MemoryManager::report().c_str() );
+	}
+
 	if( destroyEngine )
 	{
 		Engine::destroy();
@@ -52,7 +52,7 @@ MidiAlsaRaw::MidiAlsaRaw() :
 	m_pfds = new pollfd[m_npfds];
 	snd_rawmidi_poll_descriptors( m_input, m_pfds, m_npfds );
 
-	start( QThread::LowPriority );
+	start( QThread::HighPriority );
 }
 
 
@@ -102,12 +102,14 @@ void MidiAlsaRaw::sendByte( unsigned char c )
 
 void MidiAlsaRaw::run()
 {
+	applyInputThreadPriority( "MidiAlsaRaw" );
+
 	unsigned char buf[128];
 	//int cnt = 0;
 	while( m_quit == false )
 	{
 		msleep( 5 );	// must do that, otherwise this thread takes
-				// too much CPU-time, even with LowPriority...
+				// too much CPU-time
 		int err = poll( m_pfds, m_npfds, 10000 );
 		if( err < 0 && errno == EINTR )
 		{
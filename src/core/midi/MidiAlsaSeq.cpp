@@ -116,7 +116,7 @@ MidiAlsaSeq::MidiAlsaSeq() :
 		perror( "MidiAlsaSeq: pipe" );
 	}
 
-	start( QThread::IdlePriority );
+	start( QThread::HighPriority );
 }
 
 
@@ -457,6 +457,8 @@ void MidiAlsaSeq::subscribeWritablePort( MidiPort * _port,
 
 void MidiAlsaSeq::run()
 {
+	applyInputThreadPriority( "MidiAlsaSeq" );
+
 	// watch the pipe and sequencer input events
 	int pollfd_count = snd_seq_poll_descriptors_count( m_seqHandle,
 								POLLIN );
@@ -24,12 +24,41 @@
  */
 
 #include "MidiClient.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "Engine.h"
+#include "Mixer.h"
 #include "MidiPort.h"
 #include "Note.h"
+#include "ThreadPriority.h"
 
 
-MidiClient::MidiClient()
+static qint64 steadyMicroseconds()
 {
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+
+
+
+MidiClient::MidiClient() :
+	m_inEvents( InEventQueueSize ),
+	m_inEventReader( m_inEvents ),
+	m_lastPeriodStart( 0 ),
+	m_outEvents( OutEventQueueSize ),
+	m_outPeriodStart( 0 ),
+	m_outPeriodLength( 0 ),
+	m_outSampleRate( 44100 ),
+	m_outEventsQueued( false ),
+	m_outQuit( false )
+{
+	// events taken from the queue while a port got removed come on top
+	// of a full queue
+	m_pendingInEvents.reserve( 2 * InEventQueueSize );
+	m_pendingOutEvents.reserve( OutEventQueueSize );
 }
 
 
@@ -37,6 +66,8 @@ MidiClient::MidiClient()
 
 MidiClient::~MidiClient()
 {
+	stopOutputThread();
+
 	//TODO: noteOffAll(); / clear all ports
 	for (MidiPort* port : m_midiPorts)
 	{
@@ -82,6 +113,236 @@ void MidiClient::removePort( MidiPort* port )
 	{
 		m_midiPorts.erase( it );
 	}
+
+	// drop the events queued for the port before it goes away, ports
+	// outliving the mixer belong to the dummy client which got no events
+	Mixer * mixer = Engine::mixer();
+	if( mixer == NULL )
+	{
+		return;
+	}
+	mixer->requestChangeInModel();
+	takeQueuedInEvents();
+	m_pendingInEvents.erase( std::remove_if( m_pendingInEvents.begin(),
+						m_pendingInEvents.end(),
+				[port]( const QueuedInEvent & _e )
+				{
+					return _e.port == port;
+				} ), m_pendingInEvents.end() );
+	mixer->doneChangeInModel();
+
+	// the output thread doesn't send while the events are being sorted out
+	std::lock_guard<std::mutex> lock( m_outEventMutex );
+	takeQueuedOutEvents();
+	m_pendingOutEvents.erase( std::remove_if( m_pendingOutEvents.begin(),
+						m_pendingOutEvents.end(),
+				[port]( const QueuedOutEvent & _e )
+				{
+					return _e.port == port;
+				} ), m_pendingOutEvents.end() );
+}
+
+
+
+
+bool MidiClient::queueInEvent( MidiPort * _port, const MidiEvent & _me,
+						const MidiTime & _time )
+{
+	// the source port points into memory the backend reuses for the next
+	// event, so it can't be queued
+	const QueuedInEvent e = { _port, MidiEvent( _me.type(), _me.channel(),
+						_me.param( 0 ), _me.param( 1 ) ),
+					_time, steadyMicroseconds() };
+	QMutexLocker lock( &m_inEventWriteMutex );
+	return m_inEvents.write( &e, 1 ) == 1;
+}
+
+
+
+
+void MidiClient::processQueuedInEvents( fpp_t _frames,
+						sample_rate_t _sampleRate )
+{
+	takeQueuedInEvents();
+
+	// the events came in while the last period was being played, which
+	// gets mapped onto this one - after a stall only the length of one
+	// period before now is
+	const qint64 end = steadyMicroseconds();
+	const qint64 period = 1000000LL * _frames / _sampleRate;
+	qint64 start = m_lastPeriodStart;
+	if( end - start > 2 * period )
+	{
+		start = end - period;
+	}
+	m_lastPeriodStart = end;
+	const qint64 length = qMax<qint64>( end - start, 1 );
+
+	// what gets rendered now is played once the period before is, events
+	// sent by it are due from then on
+	m_outPeriodStart.store( end + period, std::memory_order_relaxed );
+	m_outPeriodLength.store( period, std::memory_order_relaxed );
+	m_outSampleRate.store( _sampleRate, std::memory_order_relaxed );
+	if( m_outThread.joinable() )
+	{
+		std::lock_guard<std::mutex> lock( m_outWakeMutex );
+		m_outEventsQueued = true;
+		m_outWake.notify_one();
+	}
+
+	for( const QueuedInEvent & e : m_pendingInEvents )
+	{
+		const qint64 t = qBound( start, e.received, end );
+		const f_cnt_t offset = qMin<f_cnt_t>(
+				( t - start ) * _frames / length, _frames - 1 );
+		e.port->deliverInEvent( e.event, e.time, offset );
+	}
+	m_pendingInEvents.clear();
+}
+
+
+
+
+void MidiClient::queueOutEvent( const MidiPort * _port, const MidiEvent & _me,
+					const MidiTime & _time, f_cnt_t _offset )
+{
+	if( !m_outThread.joinable() )
+	{
+		processOutEvent( _me, _time, _port );
+		return;
+	}
+
+	// the mixer wakes the output thread at the start of the next period,
+	// before any of the events are due
+	const qint64 due = m_outPeriodStart.load( std::memory_order_relaxed ) +
+			1000000LL * _offset /
+				m_outSampleRate.load( std::memory_order_relaxed );
+	m_outEvents.push( { _port, _me, _time, due } );
+}
+
+
+
+
+void MidiClient::startOutputThread()
+{
+	if( m_outThread.joinable() )
+	{
+		return;
+	}
+	m_outQuit = false;
+	m_outThread = std::thread( &MidiClient::sendOutEvents, this );
+}
+
+
+
+
+void MidiClient::stopOutputThread()
+{
+	if( !m_outThread.joinable() )
+	{
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock( m_outWakeMutex );
+		m_outQuit = true;
+		m_outWake.notify_one();
+	}
+	m_outThread.join();
+
+	std::lock_guard<std::mutex> lock( m_outEventMutex );
+	takeQueuedOutEvents();
+	m_pendingOutEvents.clear();
+}
+
+
+
+
+void MidiClient::sendOutEvents()
+{
+	// note-offs shouldn't come late just because the CPU is busy
+	applyInputThreadPriority( "MIDI output" );
+
+	while( true )
+	{
+		qint64 next = -1;
+		{
+			std::lock_guard<std::mutex> lock( m_outEventMutex );
+			takeQueuedOutEvents();
+			const qint64 now = steadyMicroseconds();
+			auto e = m_pendingOutEvents.begin();
+			for( ; e != m_pendingOutEvents.end() && e->due <= now; ++e )
+			{
+				processOutEvent( e->event, e->time, e->port );
+			}
+			m_pendingOutEvents.erase( m_pendingOutEvents.begin(), e );
+			if( !m_pendingOutEvents.empty() )
+			{
+				next = m_pendingOutEvents.front().due;
+			}
+		}
+
+		std::unique_lock<std::mutex> lock( m_outWakeMutex );
+		const auto woken = [this]() { return m_outEventsQueued || m_outQuit; };
+		if( next < 0 )
+		{
+			m_outWake.wait( lock, woken );
+		}
+		else
+		{
+			m_outWake.wait_until( lock, std::chrono::steady_clock::time_point(
+					std::chrono::microseconds( next ) ), woken );
+		}
+		if( m_outQuit )
+		{
+			return;
+		}
+		m_outEventsQueued = false;
+	}
+}
+
+
+
+
+void MidiClient::applyInputThreadPriority( const char * _threadName )
+{
+	const QString priority = ThreadPriority::apply(
+					ThreadPriority::Policy::RealTime );
+	qDebug( "%s: %s", _threadName, qPrintable( priority ) );
+}
+
+
+
+
+void MidiClient::takeQueuedInEvents()
+{
+	auto events = m_inEventReader.read_max( m_inEventReader.read_space() );
+	for( std::size_t i = 0; i < events.size(); ++i )
+	{
+		m_pendingInEvents.push_back( events[i] );
+	}
+}
+
+
+
+
+void MidiClient::takeQueuedOutEvents()
+{
+	// the list comes newest first
+	const std::size_t queued = m_pendingOutEvents.size();
+	for( auto e = m_outEvents.popList(); e; )
+	{
+		m_pendingOutEvents.push_back( e->value );
+		auto next = e->next;
+		m_outEvents.free( e );
+		e = next;
+	}
+	std::reverse( m_pendingOutEvents.begin() + queued,
+						m_pendingOutEvents.end() );
+	std::stable_sort( m_pendingOutEvents.begin(), m_pendingOutEvents.end(),
+				[]( const QueuedOutEvent & _a, const QueuedOutEvent & _b )
+				{
+					return _a.due < _b.due;
+				} );
 }
 
 
@@ -66,7 +66,7 @@ void MidiController::updateValueBuffer()
 	{
 		m_valueBuffer.fill( m_lastValue );
 	}
-	m_bufferLastUpdated = s_periods;
+	m_bufferLastUpdated = runningPeriods();
 }
 
 
@@ -42,7 +42,7 @@ MidiOss::MidiOss() :
 	if( m_midiDev.open( QIODevice::ReadWrite ) ||
 					m_midiDev.open( QIODevice::ReadOnly ) )
 	{
-		start( QThread::LowPriority );
+		start( QThread::HighPriority );
 	}
 }
 
@@ -93,6 +93,8 @@ void MidiOss::sendByte( const unsigned char c )
 
 void MidiOss::run()
 {
+	applyInputThreadPriority( "MidiOss" );
+
 	while( m_quit == false && m_midiDev.isOpen() )
 	{
 		char c;
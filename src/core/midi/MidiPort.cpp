@@ -142,6 +142,16 @@ void MidiPort::processInEvent( const MidiEvent& event, const MidiTime& time )
 			}
 		}
 
+		// notes start and end at the frame they were played at if the
+		// mixer takes them from the queue
+		if( ( inEvent.type() == MidiNoteOn ||
+			inEvent.type() == MidiNoteOff ||
+			inEvent.type() == MidiKeyPressure ) &&
+			m_midiClient->queueInEvent( this, inEvent, time ) )
+		{
+			return;
+		}
+
 		m_midiEventProcessor->processInEvent( inEvent, time );
 	}
 }
@@ -149,7 +159,15 @@ void MidiPort::processInEvent( const MidiEvent& event, const MidiTime& time )
 
 
 
-void MidiPort::processOutEvent( const MidiEvent& event, const MidiTime& time )
+void MidiPort::deliverInEvent( const MidiEvent& event, const MidiTime& time, f_cnt_t offset )
+{
+	m_midiEventProcessor->processInEvent( event, time, offset );
+}
+
+
+
+
+void MidiPort::processOutEvent( const MidiEvent& event, const MidiTime& time, f_cnt_t offset )
 {
 	// mask event
 	if( isOutputEnabled() && realOutputChannel() == event.channel() )
@@ -162,7 +180,7 @@ void MidiPort::processOutEvent( const MidiEvent& event, const MidiTime& time )
 			outEvent.setVelocity( fixedOutputVelocity() );
 		}
 
-		m_midiClient->processOutEvent( outEvent, time, this );
+		m_midiClient->queueOutEvent( this, outEvent, time, offset );
 	}
 }
 
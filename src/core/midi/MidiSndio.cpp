@@ -61,7 +61,7 @@ MidiSndio::MidiSndio( void ) :
 		return;
 	}
 
-	start( QThread::LowPriority );
+	start( QThread::HighPriority );
 }
 
 
@@ -92,6 +92,8 @@ void MidiSndio::sendByte( const unsigned char c )
 
 void MidiSndio::run( void )
 {
+	applyInputThreadPriority( "MidiSndio" );
+
 	struct pollfd pfd;
 	nfds_t nfds;
 	char buf[0x100], *p;
@@ -45,8 +45,7 @@ QPixmap * AutomationPatternView::s_pat_rec = NULL;
 AutomationPatternView::AutomationPatternView( AutomationPattern * _pattern,
 						TrackView * _parent ) :
 	TrackContentObjectView( _pattern, _parent ),
-	m_pat( _pattern ),
-	m_paintPixmap()
+	m_pat( _pattern )
 {
 	connect( m_pat, SIGNAL( dataChanged() ),
 			this, SLOT( update() ) );
@@ -325,7 +324,9 @@ void AutomationPatternView::paintEvent( QPaintEvent * )
 			break;
 		}
 
-		float *values = m_pat->valuesAfter( it.key() );
+		// a point per pixel at most
+		const int step = qMax( 1, static_cast<int>( 1.0f / ppTick ) );
+		const QVector<float> values = m_pat->segmentValues( it, step );
 
 		float nextValue;
 		if( m_pat->progressionType() == AutomationPattern::DiscreteProgression )
@@ -342,11 +343,11 @@ void AutomationPatternView::paintEvent( QPaintEvent * )
 		path.moveTo( origin );
 		path.moveTo( QPointF( x_base + it.key() * ppTick,values[0] ) );
 		float x;
-		for( int i = it.key() + 1; i < ( it + 1 ).key(); i++ )
+		for( int i = 1; i < values.size(); i++ )
 		{
-			x = x_base + i * ppTick;
+			x = x_base + ( it.key() + i * step ) * ppTick;
 			if( x > ( width() - TCO_BORDER_WIDTH ) ) break;
-			float value = values[ i - it.key() ];
+			float value = values[i];
 			path.lineTo( QPointF( x, value ) );
 
 		}
@@ -362,7 +363,6 @@ void AutomationPatternView::paintEvent( QPaintEvent * )
 		{
 			p.fillPath( path, col );
 		}
-		delete [] values;
 	}
 
 	p.setRenderHints( QPainter::Antialiasing, false );
@@ -44,6 +44,7 @@ ExportProjectDialog::ExportProjectDialog( const QString & _file_name,
 	m_renderManager( nullptr )
 {
 	setupUi( this );
+	stemsPreFxCB->setVisible( m_multiExport );
 	setWindowTitle( tr( "Export project to %1" ).arg(
 					QFileInfo( _file_name ).fileName() ) );
 
@@ -201,7 +202,9 @@ void ExportProjectDialog::startExport()
 
 	if ( m_multiExport )
 	{
-		m_renderManager->renderTracks();
+		m_renderManager->renderTracks( stemsPreFxCB->isChecked() ?
+						StemExporter::PreEffects :
+						StemExporter::PostEffects );
 	}
 	else
 	{
@@ -231,7 +234,8 @@ void ExportProjectDialog::onFileFormatChanged(int index)
 
 	bool bitDepthControlEnabled =
 			(exportFormat == ProjectRenderer::WaveFile ||
-			 exportFormat == ProjectRenderer::FlacFile);
+			 exportFormat == ProjectRenderer::FlacFile ||
+			 exportFormat == ProjectRenderer::RawFile);
 
 	bool variableBitrateVisible = !(exportFormat == ProjectRenderer::MP3File || exportFormat == ProjectRenderer::FlacFile);
 
@@ -24,6 +24,11 @@
  */
 
 
+#include <algorithm>
+
+#include <QtCore/QDirIterator>
+#include <QtCore/QRunnable>
+#include <QtCore/QTimer>
 #include <QDesktopServices>
 #include <QHBoxLayout>
 #include <QKeyEvent>
@@ -52,7 +57,6 @@
 #include "SamplePlayHandle.h"
 #include "Song.h"
 #include "StringPairDrag.h"
-#include "TextFloat.h"
 
 
 
@@ -64,6 +68,74 @@ enum TreeWidgetItemTypes
 
 
 
+//! Lists the files below the directories of a file browser for its search
+//! index, handing them over in batches so the results grow while scanning
+class FileScanner : public QRunnable
+{
+public:
+	FileScanner( FileBrowser * browser, int generation ) :
+		m_browser( browser ),
+		m_directories( browser->m_directories.split( '*' ) ),
+		m_filter( browser->m_filter ),
+		m_generation( generation )
+	{
+	}
+
+	void run() override
+	{
+		QStringList batch;
+		for( const QString & directory : m_directories )
+		{
+			// hidden files and directories are left out like in
+			// the tree
+			QDirIterator it( directory, QDir::Files,
+						QDirIterator::Subdirectories );
+			while( it.hasNext() )
+			{
+				if( m_browser->m_scanGeneration != m_generation )
+				{
+					return;
+				}
+				it.next();
+				if( QDir::match( m_filter, it.fileName().toLower() ) )
+				{
+					batch << it.filePath();
+				}
+				if( batch.size() >= BatchSize )
+				{
+					deliver( batch );
+					batch.clear();
+				}
+			}
+		}
+		if( !batch.empty() )
+		{
+			deliver( batch );
+		}
+	}
+
+
+private:
+	static const int BatchSize = 2000;
+
+	void deliver( const QStringList & batch )
+	{
+		QMetaObject::invokeMethod( m_browser, "addToIndex",
+					Qt::QueuedConnection,
+					Q_ARG( int, m_generation ),
+					Q_ARG( QStringList, batch ) );
+	}
+
+	FileBrowser * m_browser;
+	const QStringList m_directories;
+	const QString m_filter;
+	const int m_generation;
+
+} ;
+
+
+
+
 FileBrowser::FileBrowser(const QString & directories, const QString & filter,
 			const QString & title, const QPixmap & pm,
 			QWidget * parent, bool dirs_as_items, bool recurse ) :
@@ -71,7 +143,8 @@ FileBrowser::FileBrowser(const QString & directories, const QString & filter,
 	m_directories( directories ),
 	m_filter( filter ),
 	m_dirsAsItems( dirs_as_items ),
-	m_recurse( recurse )
+	m_recurse( recurse ),
+	m_scanGeneration( 0 )
 {
 	setWindowTitle( tr( "Browser" ) );
 
@@ -86,7 +159,7 @@ FileBrowser::FileBrowser(const QString & directories, const QString & filter,
 	m_filterEdit->setPlaceholderText( tr("Search") );
 	m_filterEdit->setClearButtonEnabled( true );
 	connect( m_filterEdit, SIGNAL( textEdited( const QString & ) ),
-			this, SLOT( filterItems( const QString & ) ) );
+			this, SLOT( applyFilter( const QString & ) ) );
 
 	QPushButton * reload_btn = new QPushButton(
 				embed::getIconPixmap( "reload" ),
@@ -103,6 +176,12 @@ FileBrowser::FileBrowser(const QString & directories, const QString & filter,
 	m_fileBrowserTreeWidget = new FileBrowserTreeWidget( contentParent() );
 	addContentWidget( m_fileBrowserTreeWidget );
 
+	m_searchTreeWidget = new FileBrowserTreeWidget( contentParent() );
+	m_searchTreeWidget->hide();
+	addContentWidget( m_searchTreeWidget );
+
+	m_scanPool.setMaxThreadCount( 1 );
+
 	// Whenever the FileBrowser has focus, Ctrl+F should direct focus to its filter box.
 	QShortcut *filterFocusShortcut = new QShortcut( QKeySequence( QKeySequence::Find ), this, SLOT(giveFocusToFilter()) );
 	filterFocusShortcut->setContext(Qt::WidgetWithChildrenShortcut);
@@ -111,6 +190,34 @@ FileBrowser::FileBrowser(const QString & directories, const QString & filter,
 	show();
 }
 
+
+
+
+FileBrowser::~FileBrowser()
+{
+	// stop the scan, it refers to us
+	++m_scanGeneration;
+	m_scanPool.waitForDone();
+}
+
+
+
+
+void FileBrowser::applyFilter( const QString & filter )
+{
+	if( m_recurse )
+	{
+		showSearchResults( filter );
+	}
+	else
+	{
+		filterItems( filter );
+	}
+}
+
+
+
+
 bool FileBrowser::filterItems( const QString & filter, QTreeWidgetItem * item )
 {
 	// call with item=NULL to filter the entire tree
@@ -175,7 +282,83 @@ void FileBrowser::reloadTree( void )
 	}
 	expandItems(NULL, expandedDirs);
 	m_filterEdit->setText( text );
-	filterItems( text );
+	if( m_recurse )
+	{
+		scanFiles();
+	}
+	applyFilter( text );
+}
+
+
+
+void FileBrowser::scanFiles()
+{
+	m_index.clear();
+	m_scanPool.start( new FileScanner( this, ++m_scanGeneration ) );
+}
+
+
+
+void FileBrowser::addToIndex( int generation, const QStringList & paths )
+{
+	if( generation != m_scanGeneration )
+	{
+		return;
+	}
+
+	for( const QString & path : paths )
+	{
+		m_index.add( path );
+	}
+
+	// until there are enough to show
+	if( !m_filterEdit->text().isEmpty() &&
+		m_searchTreeWidget->topLevelItemCount() < MaxSearchResults )
+	{
+		showSearchResults( m_filterEdit->text() );
+	}
+}
+
+
+
+void FileBrowser::showSearchResults( const QString & filter )
+{
+	m_searchTreeWidget->clear();
+	if( filter.isEmpty() )
+	{
+		m_searchTreeWidget->hide();
+		m_fileBrowserTreeWidget->show();
+		return;
+	}
+
+	const QVector<int> found = m_index.find( filter );
+	QList<QTreeWidgetItem *> items;
+	for( int i = 0; i < found.size() && i < MaxSearchResults; ++i )
+	{
+		const QString & path = m_index.path( found[i] );
+		const int separator = path.lastIndexOf( '/' );
+		FileItem * item = new FileItem( path.mid( separator + 1 ),
+						path.left( separator ) );
+		item->setToolTip( 0, QDir::toNativeSeparators( path ) );
+		items << item;
+	}
+	std::sort( items.begin(), items.end(),
+		[]( const QTreeWidgetItem * a, const QTreeWidgetItem * b )
+		{
+			return a->text( 0 ).compare( b->text( 0 ),
+						Qt::CaseInsensitive ) < 0;
+		} );
+	if( found.size() > MaxSearchResults )
+	{
+		QTreeWidgetItem * more = new QTreeWidgetItem;
+		more->setText( 0, tr( "%1 more files, refine the search" ).
+				arg( found.size() - MaxSearchResults ) );
+		items << more;
+	}
+	m_searchTreeWidget->addTopLevelItems( items );
+
+	m_fileBrowserTreeWidget->hide();
+	m_searchTreeWidget->show();
 }
 
 
@@ -186,10 +369,6 @@ void FileBrowser::expandItems( QTreeWidgetItem * item, QList<QString> expandedDi
 	for (int i = 0; i < numChildren; ++i)
 	{
 		QTreeWidgetItem * it = item ? item->child( i ) : m_fileBrowserTreeWidget->topLevelItem(i);
-		if ( m_recurse )
-		{
-			it->setExpanded( true );
-		}
 		Directory *d = dynamic_cast<Directory *> ( it );
 		if (d)
 		{
@@ -197,7 +376,9 @@ void FileBrowser::expandItems( QTreeWidgetItem * item, QList<QString> expandedDi
 			bool expand = expandedDirs.contains( d->fullName() );
 			d->setExpanded( expand );
 		}
-		if (m_recurse && it->childCount())
+		// only the expanded directories have loaded their items, the
+		// others are loaded once expanded; searching uses m_index
+		if (it->childCount())
 		{
 			expandItems(it, expandedDirs);
 		}
@@ -443,19 +624,12 @@ void FileBrowserTreeWidget::mousePressEvent(QMouseEvent * me )
 		// handling() rather than directly creating a SamplePlayHandle
 		if( f->type() == FileItem::SampleFile )
 		{
-			TextFloat * tf = TextFloat::displayMessage(
-					tr( "Loading sample" ),
-					tr( "Please wait, loading sample for "
-								"preview..." ),
-					embed::getIconPixmap( "sample_file",
-								24, 24 ), 0 );
-			qApp->processEvents(
-					QEventLoop::ExcludeUserInputEvents );
+			// streamed from disk, so there's no waiting for the
+			// whole file to be decoded
 			SamplePlayHandle * s = new SamplePlayHandle(
 								f->fullName() );
 			s->setDoneMayReturnTrue( false );
 			m_previewPlayHandle = s;
-			delete tf;
 		}
 		else if( ( f->extension ()== "xiz" || f->extension() == "sf2" || f->extension() == "sf3" || f->extension() == "gig" || f->extension() == "pat" ) &&
 			! pluginFactory->pluginSupportingExtension(f->extension()).info.isNull() )
@@ -484,6 +658,19 @@ void FileBrowserTreeWidget::mousePressEvent(QMouseEvent * me )
 			{
 				m_previewPlayHandle = NULL;
 			}
+			else if( f->type() != FileItem::SampleFile )
+			{
+				// the next one is likely auditioned next
+				FileItem * next = dynamic_cast<FileItem *>(
+							itemBelow( f ) );
+				if( next != NULL )
+				{
+					m_preloadItem = QPersistentModelIndex(
+							indexFromItem( next ) );
+					QTimer::singleShot( PreloadDelay, this,
+							SLOT( preloadPreset() ) );
+				}
+			}
 		}
 		m_pphMutex.unlock();
 	}
@@ -492,6 +679,46 @@ void FileBrowserTreeWidget::mousePressEvent(QMouseEvent * me )
 
 
 
+void FileBrowserTreeWidget::preloadPreset()
+{
+	// unless it's gone since
+	FileItem * f = m_preloadItem.isValid() ? dynamic_cast<FileItem *>(
+				itemFromIndex( m_preloadItem ) ) : NULL;
+	m_preloadItem = QPersistentModelIndex();
+	// not to complain about a file the user didn't ask for
+	if( f == NULL || !QFileInfo( f->fullName() ).isReadable() )
+	{
+		return;
+	}
+
+	// the same items mousePressEvent() previews as presets
+	const QString file = f->fullName();
+	const bool byPlugin = f->handling() == FileItem::LoadByPlugin;
+	if( f->type() == FileItem::SampleFile )
+	{
+		return;
+	}
+	if( ( f->extension() == "xiz" || f->extension() == "sf2" || f->extension() == "sf3" || f->extension() == "gig" || f->extension() == "pat" ) &&
+		! pluginFactory->pluginSupportingExtension(f->extension()).info.isNull() )
+	{
+		PresetPreviewPlayHandle::preload( file, byPlugin );
+	}
+	else if( f->type() != FileItem::VstPluginFile &&
+			( f->handling() == FileItem::LoadAsPreset ||
+			f->handling() == FileItem::LoadByPlugin ) )
+	{
+		DataFile dataFile( file );
+		if( dataFile.validate( f->extension() ) )
+		{
+			PresetPreviewPlayHandle::preload( file, byPlugin,
+							&dataFile );
+		}
+	}
+}
+
+
+
+
 void FileBrowserTreeWidget::mouseMoveEvent( QMouseEvent * me )
 {
 	if( m_mousePressed == true &&
@@ -1036,7 +1263,8 @@ void FileItem::determineFileType( void )
 	m_handling = NotSupported;
 
 	const QString ext = extension();
-	if( ext == "mmp" || ext == "mpt" || ext == "mmpz" )
+	if( ext == "mmp" || ext == "mpt" || ext == "mmpz" ||
+							ext == "mmpb" )
 	{
 		m_type = ProjectFile;
 		m_handling = LoadAsProject;
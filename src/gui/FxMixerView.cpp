@@ -35,6 +35,7 @@
 #include <QScrollArea>
 #include <QStyle>
 #include <QKeyEvent>
+#include <QLabel>
 
 #include "lmms_math.h"
 
@@ -54,7 +55,8 @@
 FxMixerView::FxMixerView() :
 	QWidget(),
 	ModelView( NULL, this ),
-	SerializingObjectHook()
+	SerializingObjectHook(),
+	m_lastPeriod( 0 )
 {
 	FxMixer * m = Engine::fxMixer();
 	m->setHook( this );
@@ -144,12 +146,22 @@ FxMixerView::FxMixerView() :
 
 	setCurrentFxLine( m_fxChannelViews[0]->m_fxLine );
 
-	setLayout( ml );
+	// levels of the selected channel below the channels
+	m_loudnessLabel = new QLabel( this );
+	m_loudnessLabel->setFont( pointSize<7>( m_loudnessLabel->font() ) );
+
+	QVBoxLayout * outerLayout = new QVBoxLayout;
+	outerLayout->setContentsMargins( 0, 0, 0, 2 );
+	outerLayout->setSpacing( 2 );
+	outerLayout->addLayout( ml );
+	outerLayout->addWidget( m_loudnessLabel );
+
+	setLayout( outerLayout );
 	updateGeometry();
 
 	// timer for updating faders
-	connect( gui->mainWindow(), SIGNAL( periodicUpdate() ),
-					this, SLOT( updateFaders() ) );
+	gui->mainWindow()->refreshScheduler()->add( this,
+			RefreshScheduler::MeterRate, [this]() { updateFaders(); } );
 
 
 	// add ourself to workspace
@@ -589,37 +601,48 @@ void FxMixerView::clear()
 
 void FxMixerView::updateFaders()
 {
-	FxMixer * m = Engine::fxMixer();
-
-	// apply master gain
-	m->effectChannel(0)->m_peakLeft *= Engine::mixer()->masterGain();
-	m->effectChannel(0)->m_peakRight *= Engine::mixer()->masterGain();
-
-	for( int i = 0; i < m_fxChannelViews.size(); ++i )
+	const Mixer::Snapshot & snapshot = Engine::mixer()->snapshot();
+	if( snapshot.period == m_lastPeriod )
 	{
-		const float opl = m_fxChannelViews[i]->m_fader->getPeak_L();
-		const float opr = m_fxChannelViews[i]->m_fader->getPeak_R();
-		const float fallOff = 1.25;
-		if( m->effectChannel(i)->m_peakLeft >= opl/fallOff )
-		{
-			m_fxChannelViews[i]->m_fader->setPeak_L( m->effectChannel(i)->m_peakLeft );
-			// Set to -1 so later we'll know if this value has been refreshed yet.
-			m->effectChannel(i)->m_peakLeft = -1;
-		}
-		else if( m->effectChannel(i)->m_peakLeft != -1 )
-		{
-			m_fxChannelViews[i]->m_fader->setPeak_L( opl/fallOff );
-		}
+		// nothing rendered since, keep the meters where they are
+		return;
+	}
+	m_lastPeriod = snapshot.period;
 
-		if( m->effectChannel(i)->m_peakRight >= opr/fallOff )
-		{
-			m_fxChannelViews[i]->m_fader->setPeak_R( m->effectChannel(i)->m_peakRight );
-			// Set to -1 so later we'll know if this value has been refreshed yet.
-			m->effectChannel(i)->m_peakRight = -1;
-		}
-		else if( m->effectChannel(i)->m_peakRight != -1 )
-		{
-			m_fxChannelViews[i]->m_fader->setPeak_R( opr/fallOff );
-		}
+	const int channels = qMin<int>( m_fxChannelViews.size(),
+						snapshot.fxPeaks.size() );
+	for( int i = 0; i < channels; ++i )
+	{
+		Fader * fader = m_fxChannelViews[i]->m_fader;
+		const Mixer::Snapshot::Peak & peak = snapshot.fxPeaks[i];
+		// per refresh at the meter rate of 30 a second
+		const float fallOff = 1.25 * 1.25;
+		fader->setPeak_L( qMax( peak.left, fader->getPeak_L() / fallOff ) );
+		fader->setPeak_R( qMax( peak.right, fader->getPeak_R() / fallOff ) );
 	}
+
+	updateLoudness();
+}
+
+
+
+
+void FxMixerView::updateLoudness()
+{
+	FxChannel * channel = Engine::fxMixer()->effectChannel(
+					m_currentFxLine->channelIndex() );
+	// also keeps the meter of the channel measuring
+	const LoudnessMeter::Levels & levels = channel->m_meter.levels();
+
+	auto db = []( float _level )
+	{
+		return QString::number( LoudnessMeter::toDbfs( _level ), 'f', 1 );
+	};
+	m_loudnessLabel->setText( tr( "%1: momentary %2 LUFS, short-term "
+			"%3 LUFS, true peak %4 / %5 dBTP, RMS %6 / %7 dBFS" ).
+		arg( channel->m_name ).
+		arg( levels.momentary, 0, 'f', 1 ).
+		arg( levels.shortTerm, 0, 'f', 1 ).
+		arg( db( levels.truePeak[0] ) ).arg( db( levels.truePeak[1] ) ).
+		arg( db( levels.rms[0] ) ).arg( db( levels.rms[1] ) ) );
 }
@@ -66,6 +66,8 @@ GuiApplication::GuiApplication()
 	{
 		ConfigManager::inst()->createWorkingDir();
 	}
+	Engine::startupPhase(tr("Loading theme"));
+
 	// Init style and palette
 	QDir::addSearchPath("artwork", ConfigManager::inst()->themeDir());
 	QDir::addSearchPath("artwork", ConfigManager::inst()->defaultThemeDir());
@@ -116,44 +118,47 @@ GuiApplication::GuiApplication()
 
 	s_instance = this;
 
-	displayInitProgress(tr("Preparing UI"));
+	Engine::startupPhase(tr("Preparing UI"));
 
 	m_mainWindow = new MainWindow;
 	connect(m_mainWindow, SIGNAL(destroyed(QObject*)), this, SLOT(childDestroyed(QObject*)));
 	connect(m_mainWindow, SIGNAL(initProgress(const QString&)), 
 		this, SLOT(displayInitProgress(const QString&)));
 
-	displayInitProgress(tr("Preparing song editor"));
+	Engine::startupPhase(tr("Preparing song editor"));
 	m_songEditor = new SongEditorWindow(Engine::getSong());
 	connect(m_songEditor, SIGNAL(destroyed(QObject*)), this, SLOT(childDestroyed(QObject*)));
 
-	displayInitProgress(tr("Preparing mixer"));
+	Engine::startupPhase(tr("Preparing mixer"));
 	m_fxMixerView = new FxMixerView;
 	connect(m_fxMixerView, SIGNAL(destroyed(QObject*)), this, SLOT(childDestroyed(QObject*)));
 
-	displayInitProgress(tr("Preparing controller rack"));
+	Engine::startupPhase(tr("Preparing controller rack"));
 	m_controllerRackView = new ControllerRackView;
 	connect(m_controllerRackView, SIGNAL(destroyed(QObject*)), this, SLOT(childDestroyed(QObject*)));
 
-	displayInitProgress(tr("Preparing project notes"));
+	Engine::startupPhase(tr("Preparing project notes"));
 	m_projectNotes = new ProjectNotes;
 	connect(m_projectNotes, SIGNAL(destroyed(QObject*)), this, SLOT(childDestroyed(QObject*)));
 
-	displayInitProgress(tr("Preparing beat/bassline editor"));
+	Engine::startupPhase(tr("Preparing beat/bassline editor"));
 	m_bbEditor = new BBEditor(Engine::getBBTrackContainer());
 	connect(m_bbEditor, SIGNAL(destroyed(QObject*)), this, SLOT(childDestroyed(QObject*)));
 
-	displayInitProgress(tr("Preparing piano roll"));
+	Engine::startupPhase(tr("Preparing piano roll"));
 	m_pianoRoll = new PianoRollWindow();
 	connect(m_pianoRoll, SIGNAL(destroyed(QObject*)), this, SLOT(childDestroyed(QObject*)));
 
-	displayInitProgress(tr("Preparing automation editor"));
+	Engine::startupPhase(tr("Preparing automation editor"));
 	m_automationEditor = new AutomationEditorWindow;
 	connect(m_automationEditor, SIGNAL(destroyed(QObject*)), this, SLOT(childDestroyed(QObject*)));
 
 	splashScreen.finish(m_mainWindow);
 	m_mainWindow->finalize();
 
+	// the main window is about to show up
+	Engine::startupPhase(QString());
+
 	m_loadingProgressLabel = nullptr;
 }
 
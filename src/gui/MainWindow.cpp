@@ -32,16 +32,22 @@
 #include <QMdiArea>
 #include <QMenuBar>
 #include <QMessageBox>
+#include <QRunnable>
+#include <QSaveFile>
 #include <QShortcut>
 #include <QLibrary>
 #include <QSplitter>
+#include <QTextStream>
 #include <QUrl>
 
+#include <memory>
+
 #include "AboutDialog.h"
 #include "AudioDummy.h"
 #include "AutomationEditor.h"
 #include "BBEditor.h"
 #include "ControllerRackView.h"
+#include "DataFile.h"
 #include "embed.h"
 #include "Engine.h"
 #include "ExportProjectDialog.h"
@@ -50,6 +56,8 @@
 #include "FxMixerView.h"
 #include "GuiApplication.h"
 #include "ImportFilter.h"
+#include "ModelView.h"
+#include "PerformanceMonitor.h"
 #include "PianoRoll.h"
 #include "PluginBrowser.h"
 #include "PluginFactory.h"
@@ -93,6 +101,7 @@ MainWindow::MainWindow() :
 	m_toolsMenu( NULL ),
 	m_autoSaveTimer( this ),
 	m_viewMenu( NULL ),
+	m_performanceMonitor( NULL ),
 	m_metronomeToggle( 0 ),
 	m_session( Normal )
 {
@@ -125,7 +134,7 @@ MainWindow::MainWindow() :
 	sideBar->appendTab( new FileBrowser(
 				confMgr->userProjectsDir() + "*" +
 				confMgr->factoryProjectsDir(),
-					"*.mmp *.mmpz *.xml *.mid",
+					"*.mmp *.mmpz *.mmpb *.xml *.mid",
 							tr( "My Projects" ),
 					embed::getIconPixmap( "project_file" ).transformed( QTransform().rotate( 90 ) ),
 							splitter, false, true ) );
@@ -222,6 +231,8 @@ MainWindow::MainWindow() :
 
 	m_updateTimer.start( 1000 / 60, this );  // 60 fps
 
+	m_autoSavePool.setMaxThreadCount( 1 );
+
 	if( ConfigManager::inst()->value( "ui", "enableautosave" ).toInt() )
 	{
 		// connect auto save
@@ -252,6 +263,8 @@ MainWindow::MainWindow() :
 
 MainWindow::~MainWindow()
 {
+	m_autoSavePool.waitForDone();
+
 	for( PluginView *view : m_tools )
 	{
 		delete view->model();
@@ -263,6 +276,8 @@ MainWindow::~MainWindow()
 	delete gui->automationEditor();
 	delete gui->pianoRoll();
 	delete gui->songEditor();
+	// reads from the mixer
+	delete m_performanceMonitor;
 	// destroy engine which will do further cleanups etc.
 	Engine::destroy();
 }
@@ -811,7 +826,7 @@ void MainWindow::openProject()
 {
 	if( mayChangeProject(false) )
 	{
-		FileDialog ofd( this, tr( "Open Project" ), "", tr( "LMMS (*.mmp *.mmpz)" ) );
+		FileDialog ofd( this, tr( "Open Project" ), "", tr( "LMMS (*.mmp *.mmpz *.mmpb)" ) );
 
 		ofd.setDirectory( ConfigManager::inst()->userProjectsDir() );
 		ofd.setFileMode( FileDialog::ExistingFiles );
@@ -856,6 +871,7 @@ bool MainWindow::saveProjectAs()
 	auto optionsWidget = new SaveOptionsWidget(Engine::getSong()->getSaveOptions());
 	VersionedSaveDialog sfd( this, optionsWidget, tr( "Save Project" ), "",
 			tr( "LMMS Project" ) + " (*.mmpz *.mmp);;" +
+				tr( "LMMS Binary Project" ) + " (*.mmpb);;" +
 				tr( "LMMS Project Template" ) + " (*.mpt)" );
 	QString f = Engine::getSong()->projectFileName();
 	if( f != "" )
@@ -1121,6 +1137,10 @@ void MainWindow::updateViewMenu()
 			      tr( "Project Notes" ) + " (F11)",
 			      this, SLOT( toggleProjectNotesWin() )
 		);
+	m_viewMenu->addAction(embed::getIconPixmap( "setup_performance" ),
+			      tr( "Performance Monitor" ),
+			      this, SLOT( togglePerformanceMonitor() )
+		);
 
 	m_viewMenu->addSeparator();
 
@@ -1219,6 +1239,18 @@ void MainWindow::toggleControllerRack()
 
 
 
+void MainWindow::togglePerformanceMonitor()
+{
+	if( m_performanceMonitor == NULL )
+	{
+		m_performanceMonitor = new PerformanceMonitor;
+	}
+	toggleWindow( m_performanceMonitor );
+}
+
+
+
+
 void MainWindow::updatePlayPauseIcons()
 {
 	gui->songEditor()->setPauseIcon( false );
@@ -1302,7 +1334,8 @@ void MainWindow::closeEvent( QCloseEvent * _ce )
 
 void MainWindow::sessionCleanup()
 {
-	// delete recover session files
+	// delete recover session files, once they're written
+	m_autoSavePool.waitForDone();
 	QFile::remove( ConfigManager::inst()->recoveryFile() );
 	setSession( Normal );
 }
@@ -1373,6 +1406,8 @@ void MainWindow::keyReleaseEvent( QKeyEvent * _ke )
 
 void MainWindow::timerEvent( QTimerEvent * _te)
 {
+	ModelView::updateChangedViews();
+	m_refreshScheduler.tick();
 	emit periodicUpdate();
 }
 
@@ -1402,17 +1437,61 @@ void MainWindow::browseHelp()
 
 
 
+// writes an autosave, which nothing else refers to anymore
+class AutoSaveTask : public QRunnable
+{
+public:
+	AutoSaveTask( const std::shared_ptr<DataFile> & _dataFile,
+						const QString & _fileName ) :
+		m_dataFile( _dataFile ),
+		m_fileName( _fileName )
+	{
+	}
+
+	void run() override
+	{
+		QString xml;
+		QTextStream ts( &xml );
+		m_dataFile->write( ts );
+
+		QSaveFile file( m_fileName );
+		if( !file.open( QIODevice::WriteOnly ) ||
+				file.write( xml.toUtf8() ) < 0 || !file.commit() )
+		{
+			qWarning( "Could not write the autosave %s",
+					m_fileName.toUtf8().constData() );
+		}
+	}
+
+private:
+	std::shared_ptr<DataFile> m_dataFile;
+	QString m_fileName;
+} ;
+
+
+
+
 void MainWindow::autoSave()
 {
 	if( !Engine::getSong()->isExporting() &&
 		!Engine::getSong()->isLoadingProject() &&
 		!RemotePluginBase::isMainThreadWaiting() &&
 		!QApplication::mouseButtons() &&
+		// still writing the last one
+		m_autoSavePool.activeThreadCount() == 0 &&
 		( ConfigManager::inst()->value( "ui",
 				"enablerunningautosave" ).toInt() ||
 			! Engine::getSong()->isPlaying() ) )
 	{
-		Engine::getSong()->saveProjectFile(ConfigManager::inst()->recoveryFile());
+		// only the document is built here, from the snapshots of the
+		// tracks which haven't changed, it's turned into text and
+		// written in the background
+		m_autoSaveSnapshots.update();
+		std::shared_ptr<DataFile> dataFile =
+			std::make_shared<DataFile>( DataFile::SongProject );
+		Engine::getSong()->saveProject( *dataFile, &m_autoSaveSnapshots );
+		m_autoSavePool.start( new AutoSaveTask( dataFile,
+				ConfigManager::inst()->recoveryFile() ) );
 		autoSaveTimerReset();  // Reset timer
 	}
 	else
@@ -22,16 +22,22 @@
  *
  */
 
+#include <QThread>
 #include <QWidget>
 
 #include "ModelView.h"
 
 
+QVector<ModelView *> ModelView::s_views;
+
+
 
 ModelView::ModelView( Model* model, QWidget* widget ) :
 	m_widget( widget ),
-	m_model( model )
+	m_model( model ),
+	m_dataChanged( false )
 {
+	s_views.push_back( this );
 }
 
 
@@ -39,6 +45,7 @@ ModelView::ModelView( Model* model, QWidget* widget ) :
 
 ModelView::~ModelView()
 {
+	s_views.removeOne( this );
 	if( m_model != NULL && m_model->isDefaultConstructed() )
 	{
 		delete m_model;
@@ -78,9 +85,51 @@ void ModelView::doConnections()
 {
 	if( m_model != NULL )
 	{
-		QObject::connect( m_model, SIGNAL( dataChanged() ), widget(), SLOT( update() ) );
+		// a direct connection, so changes from the audio thread don't
+		// queue an event each
+		QObject::connect( m_model, &Model::dataChanged, widget(),
+				[this]() { markDataChanged(); }, Qt::DirectConnection );
 		QObject::connect( m_model, SIGNAL( propertiesChanged() ), widget(), SLOT( update() ) );
 	}
 }
 
 
+
+
+void ModelView::modelDataChanged()
+{
+	// by name like the connection to its slot used to, so the update()
+	// of e.g. buttons and spin boxes reading their model is called
+	QMetaObject::invokeMethod( widget(), "update", Qt::DirectConnection );
+}
+
+
+
+
+void ModelView::updateChangedViews()
+{
+	for( ModelView* view : s_views )
+	{
+		if( view->m_dataChanged.exchange( false, std::memory_order_acquire ) )
+		{
+			view->modelDataChanged();
+		}
+	}
+}
+
+
+
+
+void ModelView::markDataChanged()
+{
+	if( QThread::currentThread() == m_widget->thread() )
+	{
+		modelDataChanged();
+	}
+	else
+	{
+		m_dataChanged.store( true, std::memory_order_release );
+	}
+}
+
+
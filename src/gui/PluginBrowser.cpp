@@ -199,7 +199,8 @@ PluginDescWidget::PluginDescWidget(const PluginKey &_pk,
 							QWidget * _parent ) :
 	QWidget( _parent ),
 	m_pluginKey( _pk ),
-	m_logo( _pk.logo()->pixmap() ),
+	m_logo(),
+	m_scaledLogo(),
 	m_mouseOver( false )
 {
 	setFixedHeight( DEFAULT_HEIGHT );
@@ -233,9 +234,7 @@ void PluginDescWidget::paintEvent( QPaintEvent * )
 	const int s = 16 + ( 32 * ( qBound( 24, height(), 60 ) - 24 ) ) /
 								( 60 - 24 );
 	const QSize logo_size( s, s );
-	QPixmap logo = m_logo.scaled( logo_size, Qt::KeepAspectRatio,
-						Qt::SmoothTransformation );
-	p.drawPixmap( 4, 4, logo );
+	p.drawPixmap( 4, 4, logo( logo_size ) );
 
 	QFont f = p.font();
 	if ( m_mouseOver )
@@ -284,6 +283,25 @@ void PluginDescWidget::mousePressEvent( QMouseEvent * _me )
 
 
 
+const QPixmap & PluginDescWidget::logo( const QSize & _size )
+{
+	if( m_logo.isNull() )
+	{
+		m_logo = m_pluginKey.logo()->pixmap();
+	}
+	// scaling smoothly on every repaint is slow
+	if( m_scaledLogo.isNull() || m_scaledLogo.size() !=
+			m_logo.size().scaled( _size, Qt::KeepAspectRatio ) )
+	{
+		m_scaledLogo = m_logo.scaled( _size, Qt::KeepAspectRatio,
+						Qt::SmoothTransformation );
+	}
+	return m_scaledLogo;
+}
+
+
+
+
 
 
 
@@ -0,0 +1,112 @@
+/*
+ * RefreshScheduler.cpp - refreshes meters, scopes and displays at display
+ *                        rate while they can be seen
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "RefreshScheduler.h"
+
+#include <QWidget>
+
+
+RefreshScheduler::RefreshScheduler( QObject * _parent ) :
+	QObject( _parent ),
+	m_removed( false )
+{
+	m_clock.start();
+}
+
+
+
+
+void RefreshScheduler::add( QWidget * _widget, int _rate,
+						const Refresh & _refresh )
+{
+	remove( _widget );
+	m_entries.push_back( Entry{ _widget, 1000 / _rate,
+						m_clock.elapsed(), _refresh } );
+	connect( _widget, &QObject::destroyed, this,
+			[this]( QObject * _object ) { remove( _object ); } );
+}
+
+
+
+
+void RefreshScheduler::remove( const QObject * _widget )
+{
+	for( Entry & entry : m_entries )
+	{
+		if( entry.widget == _widget )
+		{
+			// taken out after the refreshes, which may remove others
+			entry.widget = NULL;
+			m_removed = true;
+		}
+	}
+}
+
+
+
+
+void RefreshScheduler::tick()
+{
+	const qint64 now = m_clock.elapsed();
+	for( int i = 0; i < m_entries.size(); ++i )
+	{
+		Entry & entry = m_entries[i];
+		if( entry.widget == NULL || now < entry.due ||
+						!isShown( entry.widget ) )
+		{
+			continue;
+		}
+		// keeps to the rate with the frames a bit late, without
+		// catching up on the ones missed while hidden
+		entry.due += entry.interval;
+		if( entry.due < now )
+		{
+			entry.due = now + entry.interval;
+		}
+		const Refresh refresh = entry.refresh;
+		refresh();
+	}
+
+	if( m_removed )
+	{
+		m_removed = false;
+		for( int i = m_entries.size() - 1; i >= 0; --i )
+		{
+			if( m_entries[i].widget == NULL )
+			{
+				m_entries.remove( i );
+			}
+		}
+	}
+}
+
+
+
+
+bool RefreshScheduler::isShown( const QWidget * _widget )
+{
+	// not just visible, but also not minimized or covered by other
+	// windows or scrolled out of its scroll area
+	return _widget->isVisible() && !_widget->window()->isMinimized() &&
+					!_widget->visibleRegion().isEmpty();
+}
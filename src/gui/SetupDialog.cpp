@@ -31,6 +31,7 @@
 #include <QMessageBox>
 #include <QScrollArea>
 
+#include "BBTrackContainer.h"
 #include "debug.h"
 #include "embed.h"
 #include "Engine.h"
@@ -38,7 +39,9 @@
 #include "gui_templates.h"
 #include "MainWindow.h"
 #include "Mixer.h"
+#include "MixerWorkerThread.h"
 #include "ProjectJournal.h"
+#include "SampleCache.h"
 #include "SetupDialog.h"
 #include "TabBar.h"
 #include "TabButton.h"
@@ -69,6 +72,8 @@
 
 
 constexpr int BUFFERSIZE_RESOLUTION = 32;
+constexpr int SPINTIME_RESOLUTION = 50;
+constexpr int MAX_SPINTIME = 1000;
 
 inline void labelWidget(QWidget * w, const QString & txt)
 {
@@ -136,6 +141,33 @@ SetupDialog::SetupDialog(ConfigTabs tab_to_open) :
 			"mixer", "hqaudio").toInt()),
 	m_bufferSize(ConfigManager::inst()->value(
 			"mixer", "framesperaudiobuffer").toInt()),
+	m_workStealing(ConfigManager::inst()->value(
+			"mixer", "workstealing").toInt()),
+	m_renderGraph(ConfigManager::inst()->value(
+			"mixer", "rendergraph").toInt()),
+	m_realtimeThreads(ConfigManager::inst()->value(
+			"mixer", "realtimethreads").toInt()),
+	m_pinThreads(ConfigManager::inst()->value(
+			"mixer", "pinthreads").toInt()),
+	m_hugePages(ConfigManager::inst()->value(
+			"mixer", "hugepages").toInt()),
+	m_anticipative(ConfigManager::inst()->value(
+			"mixer", "anticipative").toInt()),
+	m_bbLoopCache(ConfigManager::inst()->value(
+			"mixer", "bbcache").toInt()),
+	m_asyncRemotePlugins(ConfigManager::inst()->value(
+			"mixer", "asyncremoteplugins").toInt()),
+	m_prestartRemotePlugins(ConfigManager::inst()->value(
+			"mixer", "prestartremoteplugins", "1").toInt()),
+	m_reserveNotes(ConfigManager::inst()->value(
+			"mixer", "reservenotes", "1").toInt()),
+	m_sampleDiskCache(ConfigManager::inst()->value(
+			"mixer", "samplediskcache").toInt()),
+	m_overloadPolicy(ConfigManager::inst()->value(
+			"mixer", "overloadpolicy").toInt()),
+	m_spinTime(ConfigManager::inst()->value(
+			"mixer", "spintime", QString::number(
+				MixerWorkerThread::DefaultSpinTime)).toInt()),
 	m_workingDir(QDir::toNativeSeparators(ConfigManager::inst()->workingDir())),
 	m_vstDir(QDir::toNativeSeparators(ConfigManager::inst()->vstDir())),
 	m_ladspaDir(QDir::toNativeSeparators(ConfigManager::inst()->ladspaDir())),
@@ -442,6 +474,18 @@ SetupDialog::SetupDialog(ConfigTabs tab_to_open) :
 	labelWidget(audio_w,
 			tr("Audio"));
 
+	// Audio scroll area.
+	QScrollArea * audioScroll = new QScrollArea(audio_w);
+	audioScroll->setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+	audioScroll->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+	audioScroll->setFrameShape(QFrame::NoFrame);
+
+	// Audio settings widget, holds everything scrollable.
+	QWidget * audioSettings = new QWidget(audio_w);
+	QVBoxLayout * audioSettingsLayout = new QVBoxLayout;
+	audioSettingsLayout->setSpacing(10);
+	audioSettingsLayout->setMargin(0);
+
 	// Audio interface tab.
 	TabWidget * audioiface_tw = new TabWidget(
 			tr("Audio interface"), audio_w);
@@ -580,12 +624,80 @@ SetupDialog::SetupDialog(ConfigTabs tab_to_open) :
 			tr("Reset to default value"));
 
 
+	counter = 0;
+
+	// Audio engine tab.
+	TabWidget * engine_tw = new TabWidget(
+			tr("Audio engine"), audio_w);
+
+	addLedCheckBox("Use work-stealing job scheduler", engine_tw, counter,
+		m_workStealing, SLOT(toggleWorkStealing(bool)), true);
+	addLedCheckBox("Process tracks and FX channels as one graph", engine_tw, counter,
+		m_renderGraph, SLOT(toggleRenderGraph(bool)), true);
+	addLedCheckBox("Real-time priority for audio threads", engine_tw, counter,
+		m_realtimeThreads, SLOT(toggleRealtimeThreads(bool)), true);
+	addLedCheckBox("Pin audio threads to CPU cores", engine_tw, counter,
+		m_pinThreads, SLOT(togglePinThreads(bool)), true);
+	addLedCheckBox("Keep audio buffers in huge pages", engine_tw, counter,
+		m_hugePages, SLOT(toggleHugePages(bool)), true);
+	addLedCheckBox("Render tracks without MIDI input ahead", engine_tw, counter,
+		m_anticipative, SLOT(toggleAnticipative(bool)), false);
+	addLedCheckBox("Replay unchanged beat/bassline repetitions from a cache", engine_tw, counter,
+		m_bbLoopCache, SLOT(toggleBBLoopCache(bool)), false);
+	addLedCheckBox("Run VST and ZynAddSubFX in parallel (one period latency)", engine_tw, counter,
+		m_asyncRemotePlugins, SLOT(toggleAsyncRemotePlugins(bool)), true);
+	addLedCheckBox("Start VST and ZynAddSubFX processes ahead of time", engine_tw, counter,
+		m_prestartRemotePlugins, SLOT(togglePrestartRemotePlugins(bool)), false);
+	addLedCheckBox("Reserve notes for the polyphony of loaded projects", engine_tw, counter,
+		m_reserveNotes, SLOT(toggleReserveNotes(bool)), false);
+	addLedCheckBox("Keep decoded samples in a cache on disk", engine_tw, counter,
+		m_sampleDiskCache, SLOT(toggleSampleDiskCache(bool)), false);
+	addLedCheckBox("On overload: use cheaper interpolation", engine_tw, counter,
+		m_overloadPolicy & Mixer::CheapInterpolation,
+		SLOT(toggleOverloadInterpolation(bool)), false);
+	addLedCheckBox("On overload: bypass expensive effects", engine_tw, counter,
+		m_overloadPolicy & Mixer::BypassEffects,
+		SLOT(toggleOverloadEffects(bool)), false);
+	addLedCheckBox("On overload: end oldest notes", engine_tw, counter,
+		m_overloadPolicy & Mixer::StealNotes,
+		SLOT(toggleOverloadNotes(bool)), false);
+
+	m_spinTimeSlider = new QSlider(Qt::Horizontal, engine_tw);
+	m_spinTimeSlider->setRange(0, MAX_SPINTIME / SPINTIME_RESOLUTION);
+	m_spinTimeSlider->setTickInterval(2);
+	m_spinTimeSlider->setPageStep(2);
+	m_spinTimeSlider->setValue(m_spinTime / SPINTIME_RESOLUTION);
+	m_spinTimeSlider->setGeometry(10, YDelta + YDelta * counter, 340, 18);
+	m_spinTimeSlider->setTickPosition(QSlider::TicksBelow);
+	ToolTip::add(m_spinTimeSlider,
+			tr("Time worker threads busy-wait for new jobs before "
+				"going to sleep. Higher values lower latency at "
+				"small buffer sizes, lower values save power."));
+
+	connect(m_spinTimeSlider, SIGNAL(valueChanged(int)),
+			this, SLOT(setSpinTime(int)));
+
+	m_spinTimeLbl = new QLabel(engine_tw);
+	m_spinTimeLbl->setGeometry(10, 2 * YDelta + YDelta * counter, 300, 18);
+	setSpinTime(m_spinTimeSlider->value());
+
+	engine_tw->setFixedHeight(3 * YDelta + YDelta * counter + 6);
+
+
 	// Audio layout ordering.
-	audio_layout->addWidget(audioiface_tw);
-	audio_layout->addWidget(as_w);
-	audio_layout->addWidget(hqaudio);
-	audio_layout->addWidget(bufferSize_tw);
-	audio_layout->addStretch();
+	audioSettingsLayout->addWidget(audioiface_tw);
+	audioSettingsLayout->addWidget(as_w);
+	audioSettingsLayout->addWidget(hqaudio);
+	audioSettingsLayout->addWidget(bufferSize_tw);
+	audioSettingsLayout->addWidget(engine_tw);
+	audioSettingsLayout->addStretch();
+
+	audioSettings->setLayout(audioSettingsLayout);
+
+	audioScroll->setWidget(audioSettings);
+	audioScroll->setWidgetResizable(true);
+
+	audio_layout->addWidget(audioScroll);
 
 
 
@@ -915,6 +1027,43 @@ void SetupDialog::accept()
 					QString::number(m_hqAudioDev));
 	ConfigManager::inst()->setValue("mixer", "framesperaudiobuffer",
 					QString::number(m_bufferSize));
+	// right away if only the number of periods queued changes
+	Engine::mixer()->setBufferSize(m_bufferSize);
+	ConfigManager::inst()->setValue("mixer", "workstealing",
+					QString::number(m_workStealing));
+	ConfigManager::inst()->setValue("mixer", "rendergraph",
+					QString::number(m_renderGraph));
+	ConfigManager::inst()->setValue("mixer", "realtimethreads",
+					QString::number(m_realtimeThreads));
+	ConfigManager::inst()->setValue("mixer", "pinthreads",
+					QString::number(m_pinThreads));
+	ConfigManager::inst()->setValue("mixer", "hugepages",
+					QString::number(m_hugePages));
+	ConfigManager::inst()->setValue("mixer", "anticipative",
+					QString::number(m_anticipative));
+	// takes effect with the next period, no restart needed
+	Engine::mixer()->setAnticipativeRendering(m_anticipative);
+	ConfigManager::inst()->setValue("mixer", "bbcache",
+					QString::number(m_bbLoopCache));
+	Engine::getBBTrackContainer()->setLoopCaching(m_bbLoopCache);
+	ConfigManager::inst()->setValue("mixer", "asyncremoteplugins",
+					QString::number(m_asyncRemotePlugins));
+	ConfigManager::inst()->setValue("mixer", "prestartremoteplugins",
+					QString::number(m_prestartRemotePlugins));
+	ConfigManager::inst()->setValue("mixer", "reservenotes",
+					QString::number(m_reserveNotes));
+	ConfigManager::inst()->setValue("mixer", "samplediskcache",
+					QString::number(m_sampleDiskCache));
+	// samples loaded from now on use it
+	SampleCache::setDiskCacheDir(m_sampleDiskCache ?
+				SampleCache::defaultDiskCacheDir() : QString());
+	ConfigManager::inst()->setValue("mixer", "overloadpolicy",
+					QString::number(m_overloadPolicy));
+	Engine::mixer()->setOverloadPolicy(m_overloadPolicy);
+	ConfigManager::inst()->setValue("mixer", "spintime",
+					QString::number(m_spinTime));
+	// takes effect immediately, no restart needed
+	MixerWorkerThread::setSpinTime(m_spinTime);
 	ConfigManager::inst()->setValue("mixer", "mididev",
 					m_midiIfaceNames[m_midiInterfaces->currentText()]);
 
@@ -1102,6 +1251,104 @@ void SetupDialog::toggleHQAudioDev(bool enabled)
 }
 
 
+void SetupDialog::toggleWorkStealing(bool enabled)
+{
+	m_workStealing = enabled;
+}
+
+
+void SetupDialog::toggleRenderGraph(bool enabled)
+{
+	m_renderGraph = enabled;
+}
+
+
+void SetupDialog::toggleRealtimeThreads(bool enabled)
+{
+	m_realtimeThreads = enabled;
+}
+
+
+void SetupDialog::togglePinThreads(bool enabled)
+{
+	m_pinThreads = enabled;
+}
+
+
+void SetupDialog::toggleHugePages(bool enabled)
+{
+	m_hugePages = enabled;
+}
+
+
+void SetupDialog::toggleAnticipative(bool enabled)
+{
+	m_anticipative = enabled;
+}
+
+
+void SetupDialog::toggleBBLoopCache(bool enabled)
+{
+	m_bbLoopCache = enabled;
+}
+
+
+void SetupDialog::toggleAsyncRemotePlugins(bool enabled)
+{
+	m_asyncRemotePlugins = enabled;
+}
+
+
+void SetupDialog::togglePrestartRemotePlugins(bool enabled)
+{
+	m_prestartRemotePlugins = enabled;
+}
+
+
+void SetupDialog::toggleReserveNotes(bool enabled)
+{
+	m_reserveNotes = enabled;
+}
+
+
+void SetupDialog::toggleSampleDiskCache(bool enabled)
+{
+	m_sampleDiskCache = enabled;
+}
+
+
+void SetupDialog::setOverloadMeasure(int measure, bool enabled)
+{
+	m_overloadPolicy = enabled ? m_overloadPolicy | measure :
+					m_overloadPolicy & ~measure;
+}
+
+
+void SetupDialog::toggleOverloadInterpolation(bool enabled)
+{
+	setOverloadMeasure(Mixer::CheapInterpolation, enabled);
+}
+
+
+void SetupDialog::toggleOverloadEffects(bool enabled)
+{
+	setOverloadMeasure(Mixer::BypassEffects, enabled);
+}
+
+
+void SetupDialog::toggleOverloadNotes(bool enabled)
+{
+	setOverloadMeasure(Mixer::StealNotes, enabled);
+}
+
+
+void SetupDialog::setSpinTime(int value)
+{
+	m_spinTime = value * SPINTIME_RESOLUTION;
+	m_spinTimeLbl->setText(tr("Spin before sleeping: %1 us").arg(m_spinTime));
+}
+
+
 void SetupDialog::audioInterfaceChanged(const QString & iface)
 {
 	for(AswMap::iterator it = m_audioIfaceSetupWidgets.begin();
@@ -34,9 +34,92 @@
 #include "MainWindow.h"
 
 
+DataFileMimeData::DataFileMimeData( const QString & _format,
+				const QString & _prefix, const DataFile & _dataFile ) :
+	m_format( _format ),
+	m_prefix( _prefix ),
+	m_dataFile( _dataFile )
+{
+}
+
+
+
+
+bool DataFileMimeData::hasFormat( const QString & _mimeType ) const
+{
+	return _mimeType == m_format;
+}
+
+
+
+
+QStringList DataFileMimeData::formats() const
+{
+	return QStringList( m_format );
+}
+
+
+
+
+QVariant DataFileMimeData::retrieveData( const QString & _mimeType,
+						QVariant::Type _type ) const
+{
+	if( _mimeType != m_format )
+	{
+		return QMimeData::retrieveData( _mimeType, _type );
+	}
+	if( m_text.isEmpty() )
+	{
+		m_text = ( m_prefix + m_dataFile.toString() ).toUtf8();
+	}
+	return m_text;
+}
+
+
+
+
+DataFile DataFileMimeData::decode( const QMimeData * _mimeData,
+					const QString & _format, int _prefixSize )
+{
+	const DataFileMimeData * own =
+			dynamic_cast<const DataFileMimeData *>( _mimeData );
+	if( own != NULL && own->m_format == _format )
+	{
+		return own->dataFile();
+	}
+	return DataFile( _mimeData->data( _format ).mid( _prefixSize ) );
+}
+
+
+
+
 StringPairDrag::StringPairDrag( const QString & _key, const QString & _value,
 					const QPixmap & _icon, QWidget * _w ) :
 	QDrag( _w )
+{
+	QString txt = _key + ":" + _value;
+	QMimeData * m = new QMimeData();
+	m->setData( mimeType(), txt.toUtf8() );
+	start( m, _icon, _w );
+}
+
+
+
+
+StringPairDrag::StringPairDrag( const QString & _key,
+				const DataFile & _dataFile,
+				const QPixmap & _icon, QWidget * _w ) :
+	QDrag( _w )
+{
+	start( new DataFileMimeData( mimeType(), _key + ":", _dataFile ),
+								_icon, _w );
+}
+
+
+
+
+void StringPairDrag::start( QMimeData * _mimeData, const QPixmap & _icon,
+								QWidget * _w )
 {
 	if( _icon.isNull() && _w )
 	{
@@ -49,10 +132,7 @@ StringPairDrag::StringPairDrag( const QString & _key, const QString & _value,
 	{
 		setPixmap( _icon );
 	}
-	QString txt = _key + ":" + _value;
-	QMimeData * m = new QMimeData();
-	m->setData( mimeType(), txt.toUtf8() );
-	setMimeData( m );
+	setMimeData( _mimeData );
 	exec( Qt::LinkAction, Qt::LinkAction );
 }
 
@@ -79,8 +159,8 @@ bool StringPairDrag::processDragEnterEvent( QDragEnterEvent * _dee,
 	{
 		return( false );
 	}
-	QString txt = _dee->mimeData()->data( mimeType() );
-	if( _allowed_keys.split( ',' ).contains( txt.section( ':', 0, 0 ) ) )
+	if( _allowed_keys.split( ',' ).contains(
+					decodeMimeKey( _dee->mimeData() ) ) )
 	{
 		_dee->acceptProposedAction();
 		return( true );
@@ -94,6 +174,13 @@ bool StringPairDrag::processDragEnterEvent( QDragEnterEvent * _dee,
 
 QString StringPairDrag::decodeMimeKey( const QMimeData * mimeData )
 {
+	// without writing out the value
+	const DataFileMimeData * own =
+			dynamic_cast<const DataFileMimeData *>( mimeData );
+	if( own != NULL && own->hasFormat( mimeType() ) )
+	{
+		return own->prefix().section( ':', 0, 0 );
+	}
 	return( QString::fromUtf8( mimeData->data( mimeType() ) ).section( ':', 0, 0 ) );
 }
 
@@ -108,6 +195,15 @@ QString StringPairDrag::decodeMimeValue( const QMimeData * mimeData )
 
 
 
+DataFile StringPairDrag::decodeMimeDataFile( const QMimeData * mimeData )
+{
+	return DataFileMimeData::decode( mimeData, mimeType(),
+			decodeMimeKey( mimeData ).toUtf8().size() + 1 );
+}
+
+
+
+
 QString StringPairDrag::decodeKey( QDropEvent * _de )
 {
 	return decodeMimeKey( _de->mimeData() );
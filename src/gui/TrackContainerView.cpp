@@ -84,6 +84,8 @@ TrackContainerView::TrackContainerView( TrackContainer * _tc ) :
 	connect( m_tc, SIGNAL( trackAdded( Track * ) ),
 			this, SLOT( createTrackView( Track * ) ),
 			Qt::QueuedConnection );
+	connect( m_scrollArea->verticalScrollBar(), SIGNAL( valueChanged( int ) ),
+			this, SLOT( showVisibleTracks() ) );
 }
 
 
@@ -121,6 +123,10 @@ void TrackContainerView::loadSettings( const QDomElement & _this )
 TrackView * TrackContainerView::addTrackView( TrackView * _tv )
 {
 	m_trackViews.push_back( _tv );
+	// hidden while scrolled out of view without moving the others
+	QSizePolicy policy = _tv->sizePolicy();
+	policy.setRetainSizeWhenHidden( true );
+	_tv->setSizePolicy( policy );
 	m_scrollLayout->addWidget( _tv );
 	connect( this, SIGNAL( positionChanged( const MidiTime & ) ),
 				_tv->getTrackContentWidget(),
@@ -229,11 +235,51 @@ void TrackContainerView::realignTracks()
 	m_scrollArea->widget()->setFixedHeight(
 				m_scrollArea->widget()->minimumSizeHint().height());
 
+	// the layout places the hidden ones as well
+	m_scrollLayout->activate();
+	showVisibleTracks();
+
+	for( trackViewList::iterator it = m_trackViews.begin();
+						it != m_trackViews.end(); ++it )
+	{
+		if( !( *it )->isHidden() )
+		{
+			( *it )->update();
+		}
+	}
+}
+
+
+
+
+void TrackContainerView::showVisibleTracks()
+{
+	// with half a page around it, so scrolling a bit shows no new ones
+	const int top = m_scrollArea->verticalScrollBar()->value();
+	const int page = m_scrollArea->viewport()->height();
+	const int begin = top - page / 2;
+	const int end = top + page + page / 2;
+
+	const QWidget * grabber = QWidget::mouseGrabber();
 	for( trackViewList::iterator it = m_trackViews.begin();
 						it != m_trackViews.end(); ++it )
 	{
-		( *it )->show();
-		( *it )->update();
+		TrackView * tv = *it;
+		const bool visible = tv->y() + tv->height() > begin &&
+								tv->y() < end;
+		// the one being dragged or edited is kept
+		if( visible || ( grabber && tv->isAncestorOf( grabber ) ) ||
+				tv->isAncestorOf( QApplication::focusWidget() ) )
+		{
+			if( tv->isHidden() )
+			{
+				tv->show();
+			}
+		}
+		else if( !tv->isHidden() )
+		{
+			tv->hide();
+		}
 	}
 }
 
@@ -61,12 +61,12 @@
 #include "ProjectJournal.h"
 
 
-QPixmap * AutomationEditor::s_toolDraw = NULL;
-QPixmap * AutomationEditor::s_toolErase = NULL;
-QPixmap * AutomationEditor::s_toolSelect = NULL;
-QPixmap * AutomationEditor::s_toolMove = NULL;
-QPixmap * AutomationEditor::s_toolYFlip = NULL;
-QPixmap * AutomationEditor::s_toolXFlip = NULL;
+LazyPixmap AutomationEditor::s_toolDraw( "edit_draw" );
+LazyPixmap AutomationEditor::s_toolErase( "edit_erase" );
+LazyPixmap AutomationEditor::s_toolSelect( "edit_select" );
+LazyPixmap AutomationEditor::s_toolMove( "edit_move" );
+LazyPixmap AutomationEditor::s_toolYFlip( "flip_y" );
+LazyPixmap AutomationEditor::s_toolXFlip( "flip_x" );
 
 const QVector<double> AutomationEditor::m_zoomXLevels =
 		{ 0.125f, 0.25f, 0.5f, 1.0f, 2.0f, 4.0f, 8.0f };
@@ -138,17 +138,6 @@ AutomationEditor::AutomationEditor() :
 					this, SLOT( setQuantization() ) );
 	m_quantizeModel.setValue( m_quantizeModel.findText( "1/8" ) );
 
-	if( s_toolYFlip == NULL )
-	{
-		s_toolYFlip = new QPixmap( embed::getIconPixmap(
-							"flip_y" ) );
-	}
-	if( s_toolXFlip == NULL )
-	{
-		s_toolXFlip = new QPixmap( embed::getIconPixmap(
-							"flip_x" ) );
-	}
-
 	// add time-line
 	m_timeLine = new TimeLineWidget( VALUES_WIDTH, 0, m_ppb,
 				Engine::getSong()->getPlayPos(
@@ -174,28 +163,6 @@ AutomationEditor::AutomationEditor() :
 	connect( m_topBottomScroll, SIGNAL( valueChanged( int ) ), this,
 						SLOT( verScrolled( int ) ) );
 
-	// init pixmaps
-	if( s_toolDraw == NULL )
-	{
-		s_toolDraw = new QPixmap( embed::getIconPixmap(
-							"edit_draw" ) );
-	}
-	if( s_toolErase == NULL )
-	{
-		s_toolErase= new QPixmap( embed::getIconPixmap(
-							"edit_erase" ) );
-	}
-	if( s_toolSelect == NULL )
-	{
-		s_toolSelect = new QPixmap( embed::getIconPixmap(
-							"edit_select" ) );
-	}
-	if( s_toolMove == NULL )
-	{
-		s_toolMove = new QPixmap( embed::getIconPixmap(
-							"edit_move" ) );
-	}
-
 	setCurrentPattern( NULL );
 
 	setMouseTracking( true );
@@ -1403,7 +1370,16 @@ void AutomationEditor::paintEvent(QPaintEvent * pe )
 					is_selected = true;
 				}*/
 
-				float *values = m_pattern->valuesAfter( it.key() );
+				// a point per pixel at most, and only the visible ones
+				const int step = qMax( 1, MidiTime::ticksPerBar() / m_ppb );
+				const QVector<float> values =
+					m_pattern->segmentValues( it, step );
+				const int first = qMax( 0,
+					( m_currentPosition - it.key() ) / step );
+				const int last = qMin( values.size() - 1,
+					( m_currentPosition - it.key() + ( width() -
+						VALUES_WIDTH ) * MidiTime::ticksPerBar() /
+							m_ppb ) / step + 1 );
 
 				float nextValue;
 				if( m_pattern->progressionType() == AutomationPattern::DiscreteProgression )
@@ -1417,19 +1393,24 @@ void AutomationEditor::paintEvent(QPaintEvent * pe )
 
 				p.setRenderHints( QPainter::Antialiasing, true );
 				QPainterPath path;
-				path.moveTo( QPointF( xCoordOfTick( it.key() ), yCoordOfLevel( 0 ) ) );
-				for( int i = 0; i < ( it + 1 ).key() - it.key(); i++ )
-				{	path.lineTo( QPointF( xCoordOfTick( it.key() + i ), yCoordOfLevel( values[i] ) ) );
+				const int first_tick = it.key() + first * step;
+				path.moveTo( QPointF( xCoordOfTick( first_tick ), yCoordOfLevel( 0 ) ) );
+				for( int i = first; i <= last; i++ )
+				{	path.lineTo( QPointF( xCoordOfTick( it.key() + i * step ), yCoordOfLevel( values[i] ) ) );
 					//NEEDS Change in CSS
 					//drawLevelTick( p, it.key() + i, values[i], is_selected );
 
 				}
-				path.lineTo( QPointF( xCoordOfTick( ( it + 1 ).key() ), yCoordOfLevel( nextValue ) ) );
-				path.lineTo( QPointF( xCoordOfTick( ( it + 1 ).key() ), yCoordOfLevel( 0 ) ) );
-				path.lineTo( QPointF( xCoordOfTick( it.key() ), yCoordOfLevel( 0 ) ) );
+				const int last_tick = last == values.size() - 1 ?
+					( it + 1 ).key() : it.key() + last * step;
+				if( last == values.size() - 1 )
+				{
+					path.lineTo( QPointF( xCoordOfTick( last_tick ), yCoordOfLevel( nextValue ) ) );
+				}
+				path.lineTo( QPointF( xCoordOfTick( last_tick ), yCoordOfLevel( 0 ) ) );
+				path.lineTo( QPointF( xCoordOfTick( first_tick ), yCoordOfLevel( 0 ) ) );
 				p.fillPath( path, graphColor() );
 				p.setRenderHints( QPainter::Antialiasing, false );
-				delete [] values;
 
 				// Draw circle
 				drawAutomationPoint(p, it);
@@ -1437,7 +1418,8 @@ void AutomationEditor::paintEvent(QPaintEvent * pe )
 				++it;
 			}
 
-			for( int i = it.key(), x = xCoordOfTick( i ); x <= width();
+			for( int i = qMax<int>( it.key(), m_currentPosition ),
+					x = xCoordOfTick( i ); x <= width();
 							i++, x = xCoordOfTick( i ) )
 			{
 				// TODO: Find out if the section after the last control
@@ -1509,21 +1491,21 @@ void AutomationEditor::paintEvent(QPaintEvent * pe )
 		case DRAW:
 			if( m_mouseDownRight )
 			{
-				cursor = s_toolErase;
+				cursor = s_toolErase.get();
 			}
 			else if( m_action == MOVE_VALUE )
 			{
-				cursor = s_toolMove;
+				cursor = s_toolMove.get();
 			}
 			else
 			{
-				cursor = s_toolDraw;
+				cursor = s_toolDraw.get();
 			}
 
 			break;
-		case ERASE: cursor = s_toolErase; break;
-		case SELECT: cursor = s_toolSelect; break;
-		case MOVE: cursor = s_toolMove; break;
+		case ERASE: cursor = s_toolErase.get(); break;
+		case SELECT: cursor = s_toolSelect.get(); break;
+		case MOVE: cursor = s_toolMove.get(); break;
 	}
 	QPoint mousePosition = mapFromGlobal( QCursor::pos() );
 	if( cursor != NULL && mousePosition.y() > TOP_MARGIN + SCROLLBAR_SIZE)
@@ -59,6 +59,7 @@
 #include "MainWindow.h"
 #include "Pattern.h"
 #include "SongEditor.h"
+#include "StringPairDrag.h"
 #include "stdshims.h"
 #include "TextFloat.h"
 #include "TimeLineWidget.h"
@@ -107,17 +108,17 @@ const int NUM_TRIPLET_LENGTHS = 5;
 
 
 
-QPixmap * PianoRoll::s_whiteKeySmallPm = NULL;
-QPixmap * PianoRoll::s_whiteKeySmallPressedPm = NULL;
-QPixmap * PianoRoll::s_whiteKeyBigPm = NULL;
-QPixmap * PianoRoll::s_whiteKeyBigPressedPm = NULL;
-QPixmap * PianoRoll::s_blackKeyPm = NULL;
-QPixmap * PianoRoll::s_blackKeyPressedPm = NULL;
-QPixmap * PianoRoll::s_toolDraw = NULL;
-QPixmap * PianoRoll::s_toolErase = NULL;
-QPixmap * PianoRoll::s_toolSelect = NULL;
-QPixmap * PianoRoll::s_toolMove = NULL;
-QPixmap * PianoRoll::s_toolOpen = NULL;
+LazyPixmap PianoRoll::s_whiteKeySmallPm( "pr_white_key_small" );
+LazyPixmap PianoRoll::s_whiteKeySmallPressedPm( "pr_white_key_small_pressed" );
+LazyPixmap PianoRoll::s_whiteKeyBigPm( "pr_white_key_big" );
+LazyPixmap PianoRoll::s_whiteKeyBigPressedPm( "pr_white_key_big_pressed" );
+LazyPixmap PianoRoll::s_blackKeyPm( "pr_black_key" );
+LazyPixmap PianoRoll::s_blackKeyPressedPm( "pr_black_key_pressed" );
+LazyPixmap PianoRoll::s_toolDraw( "edit_draw" );
+LazyPixmap PianoRoll::s_toolErase( "edit_erase" );
+LazyPixmap PianoRoll::s_toolSelect( "edit_select" );
+LazyPixmap PianoRoll::s_toolMove( "edit_move" );
+LazyPixmap PianoRoll::s_toolOpen( "automation" );
 
 TextFloat * PianoRoll::s_textFloat = NULL;
 
@@ -250,58 +251,6 @@ PianoRoll::PianoRoll() :
 	m_semiToneMarkerMenu->addAction( unmarkAllAction );
 	m_semiToneMarkerMenu->addAction( copyAllNotesAction );
 
-	// init pixmaps
-	if( s_whiteKeySmallPm == NULL )
-	{
-		s_whiteKeySmallPm = new QPixmap( embed::getIconPixmap(
-						"pr_white_key_small" ) );
-	}
-	if( s_whiteKeySmallPressedPm == NULL )
-	{
-		s_whiteKeySmallPressedPm = new QPixmap( embed::getIconPixmap(
-						"pr_white_key_small_pressed" ) );
-	}
-	if( s_whiteKeyBigPm == NULL )
-	{
-		s_whiteKeyBigPm = new QPixmap( embed::getIconPixmap(
-							"pr_white_key_big" ) );
-	}
-	if( s_whiteKeyBigPressedPm == NULL )
-	{
-		s_whiteKeyBigPressedPm = new QPixmap( embed::getIconPixmap(
-							"pr_white_key_big_pressed" ) );
-	}
-	if( s_blackKeyPm == NULL )
-	{
-		s_blackKeyPm = new QPixmap( embed::getIconPixmap(
-							"pr_black_key" ) );
-	}
-	if( s_blackKeyPressedPm == NULL )
-	{
-		s_blackKeyPressedPm = new QPixmap( embed::getIconPixmap(
-							"pr_black_key_pressed" ) );
-	}
-	if( s_toolDraw == NULL )
-	{
-		s_toolDraw = new QPixmap( embed::getIconPixmap( "edit_draw" ) );
-	}
-	if( s_toolErase == NULL )
-	{
-		s_toolErase= new QPixmap( embed::getIconPixmap( "edit_erase" ) );
-	}
-	if( s_toolSelect == NULL )
-	{
-		s_toolSelect = new QPixmap( embed::getIconPixmap( "edit_select" ) );
-	}
-	if( s_toolMove == NULL )
-	{
-		s_toolMove = new QPixmap( embed::getIconPixmap( "edit_move" ) );
-	}
-	if( s_toolOpen == NULL )
-	{
-		s_toolOpen = new QPixmap( embed::getIconPixmap( "automation" ) );
-	}
-
 	// init text-float
 	if( s_textFloat == NULL )
 	{
@@ -624,6 +573,7 @@ void PianoRoll::setGhostPattern( Pattern* newPattern )
 {
 	// Expects a pointer to a pattern or nullptr.
 	m_ghostNotes.clear();
+	m_ghostNoteIndex.invalidate();
 	if( newPattern != nullptr )
 	{
 		for( Note *note : newPattern->notes() )
@@ -649,6 +599,7 @@ void PianoRoll::loadGhostNotes( const QDomElement & de )
 			m_ghostNotes.push_back( n );
 			node = node.nextSibling();
 		}
+		m_ghostNoteIndex.invalidate();
 		emit ghostPatternSet( true );
 	}
 }
@@ -693,7 +644,11 @@ void PianoRoll::setCurrentPattern( Pattern* newPattern )
 	if( hasValidPattern() )
 	{
 		m_pattern->instrumentTrack()->disconnect( this );
+		m_pattern->instrumentTrack()->pianoModel()->disconnect( this );
+		disconnect( m_pattern, SIGNAL( dataChanged() ),
+					this, SLOT( invalidateNoteIndex() ) );
 	}
+	m_noteIndex.invalidate();
 
 	// force the song-editor to stop playing if it played pattern before
 	if( Engine::getSong()->isPlaying() &&
@@ -754,7 +709,8 @@ void PianoRoll::setCurrentPattern( Pattern* newPattern )
 
 	connect( m_pattern->instrumentTrack(), SIGNAL( midiNoteOn( const Note& ) ), this, SLOT( startRecordNote( const Note& ) ) );
 	connect( m_pattern->instrumentTrack(), SIGNAL( midiNoteOff( const Note& ) ), this, SLOT( finishRecordNote( const Note& ) ) );
-	connect( m_pattern->instrumentTrack()->pianoModel(), SIGNAL( dataChanged() ), this, SLOT( update() ) );
+	connect( m_pattern->instrumentTrack()->pianoModel(), SIGNAL( dataChanged() ), this, SLOT( updateKeyboard() ) );
+	connect( m_pattern, SIGNAL( dataChanged() ), this, SLOT( invalidateNoteIndex() ) );
 
 	update();
 	emit currentPatternChanged();
@@ -2833,17 +2789,14 @@ int PianoRoll::xCoordOfTick( int tick )
 		* m_ppb / MidiTime::ticksPerBar() );
 }
 
-void PianoRoll::paintEvent(QPaintEvent * pe )
+void PianoRoll::drawBackground( QPainter & p, const QBrush & bgColor )
 {
 	bool drawNoteNames = ConfigManager::inst()->value( "ui", "printnotelabels").toInt();
 
 	QStyleOption opt;
 	opt.initFrom( this );
-	QPainter p( this );
 	style()->drawPrimitive( QStyle::PE_Widget, &opt, &p, this );
 
-	QBrush bgColor = p.background();
-
 	// fill with bg color
 	p.fillRect( 0, 0, width(), height(), bgColor );
 
@@ -2873,11 +2826,6 @@ void PianoRoll::paintEvent(QPaintEvent * pe )
 	}
 	// start drawing at the bottom
 	int key_line_y = qMin(keyAreaBottom() - 1, m_keyLineHeight * NumKeys);
-	// we need to set m_notesEditHeight here because it needs to fill in the
-	// rest of the window if key_line_y is bound to m_keyLineHeight * NumKeys
-	if (key_line_y == m_keyLineHeight * NumKeys) {
-		m_notesEditHeight = height() - (PR_TOP_MARGIN + m_keyLineHeight * NumKeys);
-	}
 	// used for aligning black-keys later
 	int first_white_key_height = m_whiteKeySmallHeight;
 	// key-counter - only needed for finding out whether the processed
@@ -3193,6 +3141,172 @@ void PianoRoll::paintEvent(QPaintEvent * pe )
 				    markedSemitoneColor() );
 		}
 	}
+}
+
+
+
+
+PianoRoll::BackgroundState PianoRoll::backgroundState(
+						const QBrush & bgColor ) const
+{
+	BackgroundState state;
+	state.size = size();
+	state.validPattern = hasValidPattern();
+	state.startKey = m_startKey;
+	state.currentPosition = m_currentPosition;
+	state.ppb = m_ppb;
+	state.keyLineHeight = m_keyLineHeight;
+	state.notesEditHeight = m_notesEditHeight;
+	state.quantization = quantization();
+	state.zoom = m_zoomingModel.value();
+	state.timeSigNumerator =
+		Engine::getSong()->getTimeSigModel().getNumerator();
+	state.timeSigDenominator =
+		Engine::getSong()->getTimeSigModel().getDenominator();
+	state.noteEditMode = m_noteEditMode;
+	state.noteNames = ConfigManager::inst()->value( "ui",
+						"printnotelabels" ).toInt();
+	state.markedSemiTones = m_markedSemiTones;
+	if( hasValidPattern() )
+	{
+		const Piano * piano = m_pattern->instrumentTrack()->pianoModel();
+		state.pressedKeys.resize( NumKeys );
+		for( int key = 0; key < NumKeys; ++key )
+		{
+			state.pressedKeys.setBit( key, piano->isKeyPressed( key ) );
+		}
+	}
+	state.colors << bgColor.color().rgba() << barLineColor().rgba()
+		<< beatLineColor().rgba() << lineColor().rgba()
+		<< noteModeColor().rgba() << textColor().rgba()
+		<< textColorLight().rgba() << textShadow().rgba()
+		<< markedSemitoneColor().rgba() << backgroundShade().rgba();
+	return state;
+}
+
+
+
+
+bool PianoRoll::BackgroundState::operator==(
+					const BackgroundState & other ) const
+{
+	return size == other.size && validPattern == other.validPattern &&
+		startKey == other.startKey &&
+		currentPosition == other.currentPosition &&
+		ppb == other.ppb && keyLineHeight == other.keyLineHeight &&
+		notesEditHeight == other.notesEditHeight &&
+		quantization == other.quantization && zoom == other.zoom &&
+		timeSigNumerator == other.timeSigNumerator &&
+		timeSigDenominator == other.timeSigDenominator &&
+		noteEditMode == other.noteEditMode &&
+		noteNames == other.noteNames &&
+		markedSemiTones == other.markedSemiTones &&
+		pressedKeys == other.pressedKeys && colors == other.colors;
+}
+
+
+
+
+PianoRoll::NoteIndex::NoteIndex() :
+	m_valid( false ),
+	m_maxLength( 0 )
+{
+}
+
+
+
+
+void PianoRoll::NoteIndex::invalidate()
+{
+	m_valid = false;
+}
+
+
+
+
+NoteVector PianoRoll::NoteIndex::notesInRange( const NoteVector & _notes,
+							int _start, int _end )
+{
+	// notes moved around in place are in their old place here until
+	// the pattern reports the change
+	if( !m_valid || m_notes.size() != _notes.size() )
+	{
+		m_notes = _notes;
+		std::stable_sort( m_notes.begin(), m_notes.end(), Note::lessThan );
+		m_maxLength = 0;
+		for( const Note * note : m_notes )
+		{
+			// notes without a length are painted 4 ticks long
+			m_maxLength = qMax<int>( m_maxLength,
+					note->length() < 0 ? 4 : note->length() );
+		}
+		m_valid = true;
+	}
+
+	NoteVector::ConstIterator it = std::lower_bound( m_notes.constBegin(),
+			m_notes.constEnd(), _start - m_maxLength,
+			[]( const Note * _note, int _pos )
+			{
+				return (int) _note->pos() < _pos;
+			} );
+	NoteVector notes;
+	for( ; it != m_notes.constEnd() && (int) ( *it )->pos() <= _end; ++it )
+	{
+		notes.push_back( *it );
+	}
+	return notes;
+}
+
+
+
+
+void PianoRoll::paintEvent(QPaintEvent * pe )
+{
+	bool drawNoteNames = ConfigManager::inst()->value( "ui", "printnotelabels").toInt();
+
+	QPainter p( this );
+	QBrush bgColor = p.background();
+
+	// we need to set m_notesEditHeight here because it needs to fill in the
+	// rest of the window if all keys fit into it
+	if( qMin( keyAreaBottom() - 1, m_keyLineHeight * NumKeys ) ==
+						m_keyLineHeight * NumKeys )
+	{
+		m_notesEditHeight = height() - (PR_TOP_MARGIN + m_keyLineHeight * NumKeys);
+	}
+
+	// the keyboard and the grid only change when scrolling, zooming and
+	// the like, otherwise they're copied from the last time
+	const BackgroundState state = backgroundState( bgColor );
+	if( m_background.isNull() || !( state == m_backgroundState ) )
+	{
+		m_background = QPixmap( size() );
+		QPainter bp( &m_background );
+		bp.setFont( p.font() );
+		drawBackground( bp, bgColor );
+		m_backgroundState = state;
+	}
+	p.drawPixmap( pe->rect(), m_background, pe->rect() );
+
+	QFont f = p.font();
+	f.setBold( false );
+	p.setFont( pointSize<10>( f ) );
+
+	const int key_line_y = qMin( keyAreaBottom(),
+					m_keyLineHeight * NumKeys );
+
+	// only the notes within the painted area, none if e.g. just the
+	// keyboard changed
+	const int first_tick = m_currentPosition + ( pe->rect().left() -
+			WHITE_KEY_WIDTH ) * MidiTime::ticksPerBar() / m_ppb;
+	const int last_tick = pe->rect().right() < WHITE_KEY_WIDTH ?
+			first_tick - 1 : m_currentPosition +
+				( pe->rect().right() + 1 - WHITE_KEY_WIDTH ) *
+					MidiTime::ticksPerBar() / m_ppb + 1;
+
+
+
+
 
 	// following code draws all notes in visible area
 	// and the note editing stuff (volume, panning, etc)
@@ -3227,7 +3341,8 @@ void PianoRoll::paintEvent(QPaintEvent * pe )
 		// -- Begin ghost pattern
 		if( !m_ghostNotes.empty() )
 		{
-			for( const Note *note : m_ghostNotes )
+			for( const Note *note : m_ghostNoteIndex.notesInRange(
+					m_ghostNotes, first_tick, last_tick ) )
 			{
 				int len_ticks = note->length();
 
@@ -3268,7 +3383,8 @@ void PianoRoll::paintEvent(QPaintEvent * pe )
 		}
 		// -- End ghost pattern
 
-		for( const Note *note : m_pattern->notes() )
+		for( const Note *note : m_noteIndex.notesInRange(
+				m_pattern->notes(), first_tick, last_tick ) )
 		{
 			int len_ticks = note->length();
 
@@ -3462,20 +3578,20 @@ void PianoRoll::paintEvent(QPaintEvent * pe )
 		case ModeDraw:
 			if( m_mouseDownRight )
 			{
-				cursor = s_toolErase;
+				cursor = s_toolErase.get();
 			}
 			else if( m_action == ActionMoveNote )
 			{
-				cursor = s_toolMove;
+				cursor = s_toolMove.get();
 			}
 			else
 			{
-				cursor = s_toolDraw;
+				cursor = s_toolDraw.get();
 			}
 			break;
-		case ModeErase: cursor = s_toolErase; break;
-		case ModeSelect: cursor = s_toolSelect; break;
-		case ModeEditDetuning: cursor = s_toolOpen; break;
+		case ModeErase: cursor = s_toolErase.get(); break;
+		case ModeSelect: cursor = s_toolSelect.get(); break;
+		case ModeEditDetuning: cursor = s_toolOpen.get(); break;
 	}
 	QPoint mousePosition = mapFromGlobal( QCursor::pos() );
 	if( cursor != NULL && mousePosition.y() > keyAreaTop() && mousePosition.x() > noteEditLeft())
@@ -4079,8 +4195,9 @@ void PianoRoll::copyToClipboard( const NoteVector & notes ) const
 		clip_note.saveState( dataFile, note_list );
 	}
 
-	QMimeData * clip_content = new QMimeData;
-	clip_content->setData( Clipboard::mimeType(), dataFile.toString().toUtf8() );
+	// only written out if another application asks for it
+	QMimeData * clip_content = new DataFileMimeData( Clipboard::mimeType(),
+							QString(), dataFile );
 	QApplication::clipboard()->setMimeData( clip_content,
 							QClipboard::Clipboard );
 }
@@ -4140,13 +4257,13 @@ void PianoRoll::pasteNotes()
 		return;
 	}
 
-	QString value = QApplication::clipboard()
-				->mimeData( QClipboard::Clipboard )
-						->data( Clipboard::mimeType() );
+	const QMimeData * clip_content = QApplication::clipboard()
+					->mimeData( QClipboard::Clipboard );
 
-	if( ! value.isEmpty() )
+	if( clip_content->hasFormat( Clipboard::mimeType() ) )
 	{
-		DataFile dataFile( value.toUtf8() );
+		DataFile dataFile = DataFileMimeData::decode( clip_content,
+							Clipboard::mimeType() );
 
 		QDomNodeList list = dataFile.elementsByTagName( Note::classNodeName() );
 
@@ -4158,6 +4275,7 @@ void PianoRoll::pasteNotes()
 			m_pattern->addJournalCheckPoint();
 		}
 
+		QVector<Note> notes;
 		for( int i = 0; ! list.item( i ).isNull(); ++i )
 		{
 			// create the note
@@ -4168,9 +4286,10 @@ void PianoRoll::pasteNotes()
 			// select it
 			cur_note.setSelected( true );
 
-			// add to pattern
-			m_pattern->addNote( cur_note, false );
+			notes.push_back( cur_note );
 		}
+		// add to pattern
+		m_pattern->addNotes( notes, false );
 
 		// we only have to do the following lines if we pasted at
 		// least one note...
@@ -4262,6 +4381,24 @@ void PianoRoll::updatePosition( const MidiTime & t )
 
 
 
+void PianoRoll::invalidateNoteIndex()
+{
+	m_noteIndex.invalidate();
+}
+
+
+
+
+void PianoRoll::updateKeyboard()
+{
+	// the notes aren't affected by pressing keys
+	update( 0, PR_TOP_MARGIN, WHITE_KEY_WIDTH,
+				keyAreaBottom() - PR_TOP_MARGIN );
+}
+
+
+
+
 void PianoRoll::updatePositionAccompany( const MidiTime & t )
 {
 	Song * s = Engine::getSong();
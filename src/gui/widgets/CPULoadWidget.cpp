@@ -24,12 +24,31 @@
  */
 
 
+#include <QContextMenuEvent>
+#include <QHelpEvent>
+#include <QMenu>
+#include <QMessageBox>
 #include <QPainter>
+#include <QToolTip>
+
+#include <algorithm>
 
 #include "CPULoadWidget.h"
+#include "AudioDevice.h"
+#include "AudioPort.h"
+#include "BBTrackContainer.h"
+#include "BufferManager.h"
+#include "ConfigManager.h"
 #include "embed.h"
 #include "Engine.h"
+#include "FileDialog.h"
+#include "FxMixer.h"
+#include "InstrumentTrack.h"
+#include "MemoryManager.h"
 #include "Mixer.h"
+#include "SampleTrack.h"
+#include "Song.h"
+#include "TraceRecorder.h"
 
 
 CPULoadWidget::CPULoadWidget( QWidget * _parent ) :
@@ -89,6 +108,121 @@ void CPULoadWidget::paintEvent( QPaintEvent *  )
 
 
 
+bool CPULoadWidget::event( QEvent * _ev )
+{
+	if( _ev->type() != QEvent::ToolTip )
+	{
+		return QWidget::event( _ev );
+	}
+
+	// list what takes most of the time so the culprit of an overload can
+	// be found without muting one track after another
+	typedef QPair<const CpuUsage *, QString> Entry;
+	QVector<Entry> entries;
+
+	TrackList tracks = Engine::getSong()->tracks();
+	tracks += Engine::getBBTrackContainer()->tracks();
+	for( Track * track : tracks )
+	{
+		if( InstrumentTrack * it = dynamic_cast<InstrumentTrack *>( track ) )
+		{
+			entries.push_back( Entry( &it->audioPort()->playHandleCpuUsage(),
+					tr( "%1 (instrument)" ).arg( it->name() ) ) );
+			entries.push_back( Entry( &it->audioPort()->cpuUsage(),
+					tr( "%1 (effects)" ).arg( it->name() ) ) );
+		}
+		else if( SampleTrack * st = dynamic_cast<SampleTrack *>( track ) )
+		{
+			entries.push_back( Entry( &st->audioPort()->cpuUsage(),
+								st->name() ) );
+		}
+	}
+
+	FxMixer * fxMixer = Engine::fxMixer();
+	for( int i = 0; i < fxMixer->numChannels(); ++i )
+	{
+		const FxChannel * channel = fxMixer->effectChannel( i );
+		entries.push_back( Entry( &channel->cpuUsage(),
+				tr( "FX %1: %2" ).arg( i ).arg( channel->m_name ) ) );
+	}
+
+	std::sort( entries.begin(), entries.end(),
+		[]( const Entry & a, const Entry & b )
+		{
+			return a.first->average() > b.first->average();
+		} );
+
+	const MixerProfiler & profiler = Engine::mixer()->profiler();
+	QString text = tr( "DSP total: %1%" ).arg( Engine::mixer()->cpuLoad() );
+	text += "\n" + tr( "Audio device: %1" ).arg(
+				Engine::mixer()->audioDev()->statisticsText() );
+	const BufferManager::Statistics buffers = BufferManager::statistics();
+	text += "\n" + tr( "Period buffers: %1 in use, %2 at most, %3 "
+				"preallocated" ).arg( buffers.inUse ).
+				arg( buffers.highWater ).arg( buffers.capacity );
+	if( buffers.overflows > 0 )
+	{
+		text += " " + tr( "(%1 allocated while rendering)" ).
+						arg( buffers.overflows );
+	}
+	for( int i = 0; i < qMin( entries.size(), 8 ); ++i )
+	{
+		text += QString( "\n%1: %2" ).arg( entries[i].second ).
+				arg( profiler.describe( *entries[i].first ) );
+	}
+
+	QToolTip::showText( static_cast<QHelpEvent *>( _ev )->globalPos(),
+								text, this );
+	return true;
+}
+
+
+
+
+void CPULoadWidget::contextMenuEvent( QContextMenuEvent * _ev )
+{
+	// timeline of the audio threads for finding out what caused an xrun
+	QMenu menu( this );
+	QAction * record = menu.addAction( tr( "Record timeline" ) );
+	record->setCheckable( true );
+	record->setChecked( TraceRecorder::isRecording() );
+	QAction * save = menu.addAction( tr( "Save timeline..." ) );
+	menu.addSeparator();
+	QAction * memory = menu.addAction( tr( "Memory usage..." ) );
+
+	QAction * chosen = menu.exec( _ev->globalPos() );
+	if( chosen == record )
+	{
+		TraceRecorder::setRecording( record->isChecked() );
+	}
+	else if( chosen == save )
+	{
+		FileDialog sfd( this, tr( "Save timeline" ),
+				ConfigManager::inst()->workingDir(),
+				tr( "Chrome trace (*.json)" ) );
+		sfd.setAcceptMode( FileDialog::AcceptSave );
+		sfd.setFileMode( FileDialog::AnyFile );
+		sfd.setDefaultSuffix( "json" );
+		if( sfd.exec() == QDialog::Accepted &&
+			!sfd.selectedFiles().isEmpty() &&
+			!TraceRecorder::writeChromeTrace( sfd.selectedFiles()[0] ) )
+		{
+			QMessageBox::warning( this, tr( "Save timeline" ),
+				tr( "Could not write %1." ).
+					arg( sfd.selectedFiles()[0] ) );
+		}
+	}
+	else if( chosen == memory )
+	{
+		QMessageBox::information( this, tr( "Memory usage" ),
+			"<pre>" + QString::fromStdString( MemoryManager::report() ).
+							toHtmlEscaped() + "</pre>" );
+	}
+}
+
+
+
+
 void CPULoadWidget::updateCpuLoad()
 {
 	// smooth load-values a bit
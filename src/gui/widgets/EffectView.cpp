@@ -23,17 +23,20 @@
  *
  */
 
+#include <QHelpEvent>
 #include <QLabel>
 #include <QPushButton>
 #include <QMdiArea>
 #include <QMdiSubWindow>
 #include <QPainter>
 #include <QLayout>
+#include <QToolTip>
 
 #include "EffectView.h"
 #include "DummyEffect.h"
 #include "CaptionMenu.h"
 #include "embed.h"
+#include "FxMixer.h"
 #include "GuiApplication.h"
 #include "gui_templates.h"
 #include "Knob.h"
@@ -203,6 +206,34 @@ void EffectView::contextMenuEvent( QContextMenuEvent * )
 						tr( "&Remove this plugin" ),
 						this, SLOT( deletePlugin() ) );
 	contextMenu->addSeparator();
+
+	// only effects of FX channels get a sidechain input
+	FxMixer * fxMixer = Engine::fxMixer();
+	const int channel = fxMixer->channelIndexOf( effect()->effectChain() );
+	if( channel >= 0 )
+	{
+		QMenu * sidechainMenu = contextMenu->addMenu(
+						tr( "&Sidechain input" ) );
+		QAction * none = sidechainMenu->addAction( tr( "None" ) );
+		none->setCheckable( true );
+		none->setChecked( effect()->sidechainChannel() < 0 );
+		connect( none, &QAction::triggered,
+				[this](){ effect()->setSidechainChannel( -1 ); } );
+		for( int i = 0; i < fxMixer->numChannels(); ++i )
+		{
+			QAction * source = sidechainMenu->addAction(
+					tr( "FX %1: %2" ).arg( i ).arg(
+					fxMixer->effectChannel( i )->m_name ) );
+			source->setCheckable( true );
+			source->setChecked( effect()->sidechainChannel() == i );
+			// the source gets processed first
+			source->setEnabled( !fxMixer->isInfiniteLoop( i, channel ) );
+			connect( source, &QAction::triggered,
+				[this, i](){ effect()->setSidechainChannel( i ); } );
+		}
+		contextMenu->addSeparator();
+	}
+
 	contextMenu->exec( QCursor::pos() );
 	delete contextMenu;
 }
@@ -228,6 +259,23 @@ void EffectView::paintEvent( QPaintEvent * )
 
 
 
+bool EffectView::event( QEvent * _e )
+{
+	if( _e->type() == QEvent::ToolTip )
+	{
+		// built on demand as the load changes all the time
+		QToolTip::showText( static_cast<QHelpEvent *>( _e )->globalPos(),
+			tr( "%1\nCPU: %2" ).arg( model()->displayName() ).arg(
+				Engine::mixer()->profiler().describe(
+						effect()->cpuUsage() ) ), this );
+		return true;
+	}
+	return PluginView::event( _e );
+}
+
+
+
+
 void EffectView::modelChanged()
 {
 	m_bypass->setModel( &effect()->m_enabledModel );
@@ -76,6 +76,7 @@ Fader::Fader( FloatModel * _model, const QString & _name, QWidget * _parent ) :
 	m_levelsDisplayedInDBFS(false),
 	m_moveStartPoint( -1 ),
 	m_startValue( 0 ),
+	m_knobY( -1 ),
 	m_peakGreen( 0, 0, 0 ),
 	m_peakRed( 0, 0, 0 ),
 	m_peakYellow( 0, 0, 0 )
@@ -118,6 +119,7 @@ Fader::Fader( FloatModel * model, const QString & name, QWidget * parent, QPixma
 	m_levelsDisplayedInDBFS(false),
 	m_moveStartPoint( -1 ),
 	m_startValue( 0 ),
+	m_knobY( -1 ),
 	m_peakGreen( 0, 0, 0 ),
 	m_peakRed( 0, 0, 0 )
 {
@@ -293,20 +295,31 @@ void Fader::setPeak( float fPeak, float &targetPeak, float &persistentPeak, QTim
 		fPeak = m_fMaxPeak;
 	}
 
+	// only repainted once a level moves by a pixel
+	bool moved = false;
 	if( targetPeak != fPeak)
 	{
+		moved = levelHeight( targetPeak ) != levelHeight( fPeak );
 		targetPeak = fPeak;
 		if( targetPeak >= persistentPeak )
 		{
+			moved = moved || levelHeight( persistentPeak ) !=
+							levelHeight( targetPeak );
 			persistentPeak = targetPeak;
 			lastPeakTime.restart();
 		}
-		update();
 	}
 
 	if( persistentPeak > 0 && lastPeakTime.elapsed() > 1500 )
 	{
-		persistentPeak = qMax<float>( 0, persistentPeak-0.05 );
+		const int height = levelHeight( persistentPeak );
+		// per refresh at the meter rate of 30 a second
+		persistentPeak = qMax<float>( 0, persistentPeak-0.1 );
+		moved = moved || levelHeight( persistentPeak ) != height;
+	}
+
+	if( moved )
+	{
 		update();
 	}
 }
@@ -351,6 +364,20 @@ inline int Fader::calculateDisplayPeak( float fPeak )
 }
 
 
+int Fader::levelHeight( float fPeak )
+{
+	const int height = m_back->height();
+	if( getLevelsDisplayedInDBFS() )
+	{
+		const float maxDB = ampToDbfs( m_fMaxPeak );
+		const float minDB = ampToDbfs( m_fMinPeak );
+		return height * ( ampToDbfs( qMax<float>( 0.0001, fPeak ) ) -
+						minDB ) / ( maxDB - minDB );
+	}
+	return height - calculateDisplayPeak( fPeak - m_fMinPeak );
+}
+
+
 void Fader::paintEvent( QPaintEvent * ev)
 {
 	QPainter painter(this);
@@ -369,7 +396,21 @@ void Fader::paintEvent( QPaintEvent * ev)
 	}
 
 	// Draw the knob
-	painter.drawPixmap( 0, knobPosY() - m_knob->height(), *m_knob );
+	m_knobY = knobPosY();
+	painter.drawPixmap( 0, m_knobY - m_knob->height(), *m_knob );
+}
+
+
+void Fader::modelDataChanged()
+{
+	const int y = knobPosY();
+	if( y != m_knobY )
+	{
+		update( QRect( 0, m_knobY - m_knob->height(), width(),
+							m_knob->height() ) );
+		update( QRect( 0, y - m_knob->height(), width(),
+							m_knob->height() ) );
+	}
 }
 
 void Fader::paintDBFSLevels(QPaintEvent * ev, QPainter & painter)
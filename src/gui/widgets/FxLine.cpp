@@ -26,11 +26,15 @@
 #include "FxLine.h"
 
 #include <QGraphicsProxyWidget>
+#include <QHelpEvent>
+#include <QToolTip>
 
 #include "CaptionMenu.h"
+#include "Engine.h"
 #include "FxMixer.h"
 #include "gui_templates.h"
 #include "GuiApplication.h"
+#include "Mixer.h"
 #include "Song.h"
 
 bool FxLine::eventFilter( QObject *dist, QEvent *event )
@@ -53,8 +57,8 @@ bool FxLine::eventFilter( QObject *dist, QEvent *event )
 }
 
 const int FxLine::FxLineHeight = 287;
-QPixmap * FxLine::s_sendBgArrow = NULL;
-QPixmap * FxLine::s_receiveBgArrow = NULL;
+LazyPixmap FxLine::s_sendBgArrow( "send_bg_arrow", 29, 56 );
+LazyPixmap FxLine::s_receiveBgArrow( "receive_bg_arrow", 29, 56 );
 
 FxLine::FxLine( QWidget * _parent, FxMixerView * _mv, int _channelIndex ) :
 	QWidget( _parent ),
@@ -67,15 +71,6 @@ FxLine::FxLine( QWidget * _parent, FxMixerView * _mv, int _channelIndex ) :
 	m_strokeInnerInactive( 0, 0, 0 ),
 	m_inRename( false )
 {
-	if( !s_sendBgArrow )
-	{
-		s_sendBgArrow = new QPixmap( embed::getIconPixmap( "send_bg_arrow", 29, 56 ) );
-	}
-	if( !s_receiveBgArrow )
-	{
-		s_receiveBgArrow = new QPixmap( embed::getIconPixmap( "receive_bg_arrow", 29, 56 ) );
-	}
-
 	setFixedSize( 33, FxLineHeight );
 	setAttribute( Qt::WA_OpaquePaintEvent, true );
 	setCursor( QCursor( embed::getIconPixmap( "hand" ), 3, 3 ) );
@@ -205,6 +200,24 @@ void FxLine::paintEvent( QPaintEvent * )
 
 
 
+bool FxLine::event( QEvent * e )
+{
+	if( e->type() == QEvent::ToolTip && !toolTip().isEmpty() )
+	{
+		// built on demand as the load changes all the time
+		const FxChannel * channel = Engine::fxMixer()->effectChannel( m_channelIndex );
+		QToolTip::showText( static_cast<QHelpEvent *>( e )->globalPos(),
+			tr( "%1\nCPU: %2" ).arg( toolTip() ).arg(
+				Engine::mixer()->profiler().describe( channel->cpuUsage() ) ),
+			this );
+		return true;
+	}
+	return QWidget::event( e );
+}
+
+
+
+
 void FxLine::mousePressEvent( QMouseEvent * )
 {
 	m_mv->setCurrentFxLine( this );
@@ -232,6 +245,26 @@ void FxLine::contextMenuEvent( QContextMenuEvent * )
 	contextMenu->addAction( tr( "Rename &channel" ), this, SLOT( renameChannel() ) );
 	contextMenu->addSeparator();
 
+	// long chains of costly effects can be split up to run on several
+	// cores at a period of latency per stage
+	FxChannel * channel = Engine::fxMixer()->effectChannel( m_channelIndex );
+	QMenu * pipelineMenu = contextMenu->addMenu( tr( "Split &effects" ) );
+	for( int stages = 1; stages <= FxChannel::MaxPipelineStages; ++stages )
+	{
+		QAction * action = pipelineMenu->addAction( stages == 1 ?
+			tr( "Don't split" ) :
+			tr( "Into %1 stages (%n period(s) of latency)", "",
+						stages - 1 ).arg( stages ) );
+		action->setCheckable( true );
+		action->setChecked( channel->m_pipelineStagesModel.value() == stages );
+		connect( action, &QAction::triggered, [channel, stages]()
+		{
+			channel->m_pipelineStagesModel.setValue( stages );
+			Engine::getSong()->setModified();
+		} );
+	}
+	contextMenu->addSeparator();
+
 	if( m_channelIndex != 0 ) // no remove-option in master
 	{
 		contextMenu->addAction( embed::getIconPixmap( "cancel" ), tr( "R&emove channel" ), this, SLOT( removeChannel() ) );
@@ -28,12 +28,15 @@
 #include <QLayout>
 
 #include "InstrumentMidiIOView.h"
+#include "ComboBox.h"
 #include "MidiPortMenu.h"
 #include "Engine.h"
 #include "embed.h"
 #include "GroupBox.h"
+#include "GuiApplication.h"
 #include "gui_templates.h"
 #include "LcdSpinBox.h"
+#include "MainWindow.h"
 #include "MidiClient.h"
 #include "Mixer.h"
 #include "InstrumentTrack.h"
@@ -204,7 +207,8 @@ void InstrumentMidiIOView::modelChanged()
 
 
 InstrumentMiscView::InstrumentMiscView(InstrumentTrack *it, QWidget *parent) :
-	QWidget( parent )
+	QWidget( parent ),
+	m_track( it )
 {
 	QVBoxLayout* layout = new QVBoxLayout( this );
 	layout->setMargin( 5 );
@@ -215,6 +219,36 @@ InstrumentMiscView::InstrumentMiscView(InstrumentTrack *it, QWidget *parent) :
 	QLabel *tlabel = new QLabel(tr( "Enables the use of master pitch" ) );
 	m_pitchGroupBox->setModel( &it->m_useMasterPitchModel );
 	masterPitchLayout->addWidget( tlabel );
+
+	GroupBox* polyphonyGroupBox = new GroupBox( tr( "POLYPHONY" ), this );
+	polyphonyGroupBox->ledButton()->hide();
+	layout->addWidget( polyphonyGroupBox );
+	QGridLayout* polyphonyLayout = new QGridLayout( polyphonyGroupBox );
+	polyphonyLayout->setContentsMargins( 8, 18, 8, 8 );
+	polyphonyLayout->setHorizontalSpacing( 10 );
+
+	m_polyphonySpinBox = new LcdSpinBox( 3, polyphonyGroupBox );
+	m_polyphonySpinBox->addTextForValue( 0, "---" );
+	m_polyphonySpinBox->setLabel( tr( "VOICES" ) );
+	m_polyphonySpinBox->setModel( it->polyphonyModel() );
+	polyphonyLayout->addWidget( m_polyphonySpinBox, 0, 0, 2, 1 );
+
+	QLabel* stealLabel = new QLabel( tr( "Steal:" ) );
+	stealLabel->setFont( pointSize<8>( stealLabel->font() ) );
+	polyphonyLayout->addWidget( stealLabel, 0, 1 );
+
+	m_voiceStealComboBox = new ComboBox( polyphonyGroupBox );
+	m_voiceStealComboBox->setModel( it->voiceStealModel() );
+	polyphonyLayout->addWidget( m_voiceStealComboBox, 1, 1 );
+
+	m_voiceCountLabel = new QLabel( polyphonyGroupBox );
+	m_voiceCountLabel->setFont( pointSize<8>( m_voiceCountLabel->font() ) );
+	polyphonyLayout->addWidget( m_voiceCountLabel, 2, 0, 1, 2 );
+	updateVoiceCount();
+
+	gui->mainWindow()->refreshScheduler()->add( this,
+		RefreshScheduler::DisplayRate, [this]() { updateVoiceCount(); } );
+
 	layout->addStretch();
 }
 
@@ -222,3 +256,24 @@ InstrumentMiscView::~InstrumentMiscView()
 {
 
 }
+
+
+
+
+void InstrumentMiscView::setTrack( InstrumentTrack * it )
+{
+	m_track = it;
+	m_pitchGroupBox->setModel( &it->m_useMasterPitchModel );
+	m_polyphonySpinBox->setModel( it->polyphonyModel() );
+	m_voiceStealComboBox->setModel( it->voiceStealModel() );
+	updateVoiceCount();
+}
+
+
+
+
+void InstrumentMiscView::updateVoiceCount()
+{
+	m_voiceCountLabel->setText( tr( "Playing voices: %1" ).
+					arg( m_track->voiceCount() ) );
+}
@@ -31,7 +31,9 @@
 #include "GroupBox.h"
 #include "gui_templates.h"
 #include "Knob.h"
+#include "LedCheckbox.h"
 #include "TabWidget.h"
+#include "ToolTip.h"
 
 
 
@@ -90,6 +92,16 @@ InstrumentSoundShapingView::InstrumentSoundShapingView( QWidget * _parent ) :
 	m_filterResKnob->setHintText( tr( "Q/Resonance:" ), "" );
 
 
+	m_fastFilterModulationCheckBox = new LedCheckBox( tr( "FAST MODULATION" ),
+							m_filterGroupBox );
+	m_fastFilterModulationCheckBox->setFont( pointSizeF(
+			m_fastFilterModulationCheckBox->font(), 6.5 ) );
+	m_fastFilterModulationCheckBox->move( 14, 46 );
+	ToolTip::add( m_fastFilterModulationCheckBox,
+		tr( "Update the filter less often while envelopes or LFOs "
+			"modulate cutoff or resonance, which saves CPU" ) );
+
+
 	m_singleStreamInfoLabel = new QLabel( tr( "Envelopes, LFOs and filters are not supported by the current instrument." ), this );
 	m_singleStreamInfoLabel->setWordWrap( true );
 	m_singleStreamInfoLabel->setFont( pointSize<8>( m_singleStreamInfoLabel->font() ) );
@@ -126,6 +138,7 @@ void InstrumentSoundShapingView::modelChanged()
 	m_filterComboBox->setModel( &m_ss->m_filterModel );
 	m_filterCutKnob->setModel( &m_ss->m_filterCutModel );
 	m_filterResKnob->setModel( &m_ss->m_filterResModel );
+	m_fastFilterModulationCheckBox->setModel( &m_ss->m_fastFilterModulationModel );
 	for( int i = 0; i < InstrumentSoundShaping::NumTargets; ++i )
 	{
 		m_envLfoViews[i]->setModel( m_ss->m_envLfoParameters[i] );
@@ -49,6 +49,7 @@
 #include "TextFloat.h"
 
 TextFloat * Knob::s_textFloat = NULL;
+QHash<QString, QHash<int, QPixmap> > Knob::s_sprites;
 
 
 
@@ -369,7 +370,9 @@ bool Knob::updateAngle()
 	{
 		angle = angleFromValue( model()->inverseScaledValue( model()->value() ), model()->minValue(), model()->maxValue(), m_totalAngle );
 	}
-	if( qAbs( angle - m_angle ) > 3 )
+	// to the frame closest to it
+	angle = qRound( angle / float( AngleStep ) ) * AngleStep;
+	if( angle != m_angle )
 	{
 		m_angle = angle;
 		return true;
@@ -380,18 +383,66 @@ bool Knob::updateAngle()
 
 
 
+void Knob::modelDataChanged()
+{
+	if( updateAngle() )
+	{
+		update();
+	}
+}
+
+
+
+
 void Knob::drawKnob( QPainter * _p )
 {
-	if( updateAngle() == false && !m_cache.isNull() )
+	updateAngle();
+
+	const int centerAngle = m_knobNum == knobStyled ? 0 :
+		angleFromValue( model()->inverseScaledValue( model()->centerValue() ), model()->minValue(), model()->maxValue(), m_totalAngle );
+	const QColor penColor = _p->pen().brush().color();
+
+	QPixmap & frame =
+		s_sprites[spriteKey( centerAngle, penColor )][m_angle];
+	if( frame.isNull() )
+	{
+		frame = renderKnob( centerAngle, penColor );
+	}
+	_p->drawPixmap( 0, 0, frame );
+}
+
+
+
+
+QString Knob::spriteKey( int _centerAngle, const QColor & _penColor ) const
+{
+	QString key = QString( "%1 %2x%3 %4 %5" ).arg( m_knobNum ).
+			arg( width() ).arg( height() ).
+			arg( m_lineColor.rgba() ).arg( m_totalAngle );
+	if( m_knobNum == knobStyled )
+	{
+		key += QString( " %1 %2 %3 %4 %5 %6 %7" ).
+			arg( m_outerColor.isValid() ? m_outerColor.rgba() : 0 ).
+			arg( _penColor.rgba() ).arg( m_lineWidth ).
+			arg( m_innerRadius ).arg( m_outerRadius ).
+			arg( m_centerPoint.x() ).arg( m_centerPoint.y() );
+	}
+	else
 	{
-		_p->drawImage( 0, 0, m_cache );
-		return;
+		key += QString( " %1" ).arg( _centerAngle );
 	}
+	return key;
+}
 
-	m_cache = QImage( size(), QImage::Format_ARGB32 );
-	m_cache.fill( qRgba( 0, 0, 0, 0 ) );
 
-	QPainter p( &m_cache );
+
+
+QPixmap Knob::renderKnob( int _centerAngle, const QColor & _penColor ) const
+{
+	QImage image( size(), QImage::Format_ARGB32_Premultiplied );
+	image.fill( qRgba( 0, 0, 0, 0 ) );
+
+	QPainter p( &image );
 
 	QPoint mid;
 
@@ -403,7 +454,7 @@ void Knob::drawKnob( QPainter * _p )
 		if( m_outerColor.isValid() )
 		{
 			QRadialGradient gradient( centerPoint(), outerRadius() );
-			gradient.setColorAt( 0.4, _p->pen().brush().color() );
+			gradient.setColorAt( 0.4, _penColor );
 			gradient.setColorAt( 1, m_outerColor );
 
 			p.setPen( QPen( gradient, lineWidth(),
@@ -420,8 +471,7 @@ void Knob::drawKnob( QPainter * _p )
 		p.drawLine( calculateLine( centerPoint(), outerRadius(),
 							innerRadius() ) );
 		p.end();
-		_p->drawImage( 0, 0, m_cache );
-		return;
+		return QPixmap::fromImage( image );
 	}
 
 
@@ -435,8 +485,6 @@ void Knob::drawKnob( QPainter * _p )
 
 	p.setRenderHint( QPainter::Antialiasing );
 
-	const int centerAngle = angleFromValue( model()->inverseScaledValue( model()->centerValue() ), model()->minValue(), model()->maxValue(), m_totalAngle );
-
 	const int arcLineWidth = 2;
 	const int arcRectSize = m_knobPixmap->width() - arcLineWidth;
 
@@ -485,11 +533,11 @@ void Knob::drawKnob( QPainter * _p )
 			break;
 	}
 
-	p.drawArc( mid.x() - arcRectSize/2, 1, arcRectSize, arcRectSize, (90-centerAngle)*16, -16*(m_angle-centerAngle) );
+	p.drawArc( mid.x() - arcRectSize/2, 1, arcRectSize, arcRectSize, (90-_centerAngle)*16, -16*(m_angle-_centerAngle) );
 
 	p.end();
 
-	_p->drawImage( 0, 0, m_cache );
+	return QPixmap::fromImage( image );
 }
 
 float Knob::getValue( const QPoint & _p )
@@ -799,19 +847,6 @@ void Knob::enterValue()
 
 
 
-void Knob::friendlyUpdate()
-{
-	if (model() && (model()->controllerConnection() == NULL ||
-		model()->controllerConnection()->getController()->frequentUpdates() == false ||
-				Controller::runningFrames() % (256*4) == 0))
-	{
-		update();
-	}
-}
-
-
-
-
 QString Knob::displayValue() const
 {
 	if( isVolumeKnob() &&
@@ -824,18 +859,3 @@ QString Knob::displayValue() const
 	return m_description.trimmed() + QString( " %1" ).
 					arg( model()->getRoundedValue() ) + m_unit;
 }
-
-
-
-
-void Knob::doConnections()
-{
-	if( model() != NULL )
-	{
-		QObject::connect( model(), SIGNAL( dataChanged() ),
-					this, SLOT( friendlyUpdate() ) );
-
-		QObject::connect( model(), SIGNAL( propertiesChanged() ),
-						this, SLOT( update() ) );
-	}
-}
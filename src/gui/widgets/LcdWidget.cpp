@@ -91,9 +91,13 @@ void LcdWidget::setValue( int value )
 		*/
 	}
 
+	if( s == m_display )
+	{
+		return;
+	}
 	m_display = s;
 
-	update();
+	invalidateCache();
 }
 
 
@@ -107,6 +111,7 @@ QColor LcdWidget::textColor() const
 void LcdWidget::setTextColor( const QColor & c )
 {
 	m_textColor = c;
+	invalidateCache();
 }
 
 
@@ -120,6 +125,26 @@ QColor LcdWidget::textShadowColor() const
 void LcdWidget::setTextShadowColor( const QColor & c )
 {
 	m_textShadowColor = c;
+	invalidateCache();
+}
+
+
+
+
+void LcdWidget::changeEvent( QEvent * ce )
+{
+	switch( ce->type() )
+	{
+		case QEvent::EnabledChange:
+		case QEvent::FontChange:
+		case QEvent::PaletteChange:
+		case QEvent::StyleChange:
+			invalidateCache();
+			break;
+		default:
+			break;
+	}
+	QWidget::changeEvent( ce );
 }
 
 
@@ -127,8 +152,32 @@ void LcdWidget::setTextShadowColor( const QColor & c )
 
 void LcdWidget::paintEvent( QPaintEvent* )
 {
+	if( m_cache.size() != size() )
+	{
+		m_cache = QPixmap( size() );
+		m_cache.fill( Qt::transparent );
+		QPainter p( &m_cache );
+		drawLcd( p );
+	}
+
 	QPainter p( this );
+	p.drawPixmap( 0, 0, m_cache );
+}
+
+
+
 
+void LcdWidget::invalidateCache()
+{
+	m_cache = QPixmap();
+	update();
+}
+
+
+
+
+void LcdWidget::drawLcd( QPainter & p )
+{
 	QSize cellSize( m_cellWidth, m_cellHeight );
 
 	QRect cellRect( 0, 0, m_cellWidth, m_cellHeight );
@@ -246,7 +295,7 @@ void LcdWidget::updateSize()
 				m_cellHeight + (2*margin) + 9 );
 	}
 
-	update();
+	invalidateCache();
 }
 
 
@@ -27,6 +27,7 @@
 #include <QPainter>
 
 #include "Oscilloscope.h"
+#include "AudioTap.h"
 #include "GuiApplication.h"
 #include "gui_templates.h"
 #include "MainWindow.h"
@@ -42,6 +43,7 @@ Oscilloscope::Oscilloscope( QWidget * _p ) :
 	QWidget( _p ),
 	m_background( embed::getIconPixmap( "output_graph" ) ),
 	m_points( new QPointF[Engine::mixer()->framesPerPeriod()] ),
+	m_tap( Engine::mixer()->masterTap().tap() ),
 	m_active( false ),
 	m_normalColor(71, 253, 133),
 	m_warningColor(255, 192, 64),
@@ -49,13 +51,13 @@ Oscilloscope::Oscilloscope( QWidget * _p ) :
 {
 	setFixedSize( m_background.width(), m_background.height() );
 	setAttribute( Qt::WA_OpaquePaintEvent, true );
-	setActive( ConfigManager::inst()->value( "ui", "displaywaveform").toInt() );
-
 	const fpp_t frames = Engine::mixer()->framesPerPeriod();
 	m_buffer = new sampleFrame[frames];
 
 	BufferManager::clear( m_buffer, frames );
 
+	setActive( ConfigManager::inst()->value( "ui", "displaywaveform").toInt() );
+
 
 	ToolTip::add( this, tr( "Oscilloscope" ) );
 }
@@ -65,6 +67,10 @@ Oscilloscope::Oscilloscope( QWidget * _p ) :
 
 Oscilloscope::~Oscilloscope()
 {
+	if( m_active )
+	{
+		m_tap->removeReader();
+	}
 	delete[] m_buffer;
 	delete[] m_points;
 }
@@ -72,13 +78,13 @@ Oscilloscope::~Oscilloscope()
 
 
 
-void Oscilloscope::updateAudioBuffer( const surroundSampleFrame * buffer )
+void Oscilloscope::updateAudioBuffer()
 {
 	if( !Engine::getSong()->isExporting() )
 	{
-		const fpp_t fpp = Engine::mixer()->framesPerPeriod();
-		memcpy( m_buffer, buffer, sizeof( surroundSampleFrame ) * fpp );
+		m_tap->latest( m_buffer, Engine::mixer()->framesPerPeriod() );
 	}
+	update();
 }
 
 
@@ -89,21 +95,16 @@ void Oscilloscope::setActive( bool _active )
 	m_active = _active;
 	if( m_active )
 	{
-		connect( gui->mainWindow(),
-					SIGNAL( periodicUpdate() ),
-					this, SLOT( update() ) );
-		connect( Engine::mixer(),
-			SIGNAL( nextAudioBuffer( const surroundSampleFrame* ) ),
-			this, SLOT( updateAudioBuffer( const surroundSampleFrame* ) ) );
+		m_tap->addReader();
+		gui->mainWindow()->refreshScheduler()->add( this,
+				RefreshScheduler::ScopeRate,
+				[this]() { updateAudioBuffer(); } );
 	}
 	else
 	{
-		disconnect( gui->mainWindow(),
-					SIGNAL( periodicUpdate() ),
-					this, SLOT( update() ) );
-		disconnect( Engine::mixer(),
-			SIGNAL( nextAudioBuffer( const surroundSampleFrame* ) ),
-			this, SLOT( updateAudioBuffer( const surroundSampleFrame* ) ) );
+		gui->mainWindow()->refreshScheduler()->remove( this );
+		m_tap->removeReader();
+		BufferManager::clear( m_buffer, Engine::mixer()->framesPerPeriod() );
 		// we have to update (remove last waves),
 		// because timer doesn't do that anymore
 		update();
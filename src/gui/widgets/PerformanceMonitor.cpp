@@ -0,0 +1,111 @@
+/*
+ * PerformanceMonitor.cpp - window showing the render stats of the mixer live
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <QFormLayout>
+#include <QLabel>
+#include <QMdiSubWindow>
+
+#include "PerformanceMonitor.h"
+#include "embed.h"
+#include "Engine.h"
+#include "GuiApplication.h"
+#include "MainWindow.h"
+
+
+PerformanceMonitor::PerformanceMonitor() :
+	QWidget(),
+	m_reader( Engine::mixer()->renderStats() ),
+	m_updateTimer( this )
+{
+	setWindowIcon( embed::getIconPixmap( "setup_performance" ) );
+	setWindowTitle( tr( "Performance Monitor" ) );
+
+	QFormLayout * layout = new QFormLayout( this );
+	setLayout( layout );
+
+	m_load = addRow( tr( "Load" ) );
+	m_voices = addRow( tr( "Voices" ) );
+	m_effects = addRow( tr( "Running effects" ) );
+	m_jobs = addRow( tr( "Jobs per period" ) );
+	m_memory = addRow( tr( "Memory" ) );
+
+	QMdiSubWindow * subWin = gui->mainWindow()->addWindowedWidget( this );
+	Qt::WindowFlags flags = subWin->windowFlags();
+	flags &= ~Qt::WindowMaximizeButtonHint;
+	subWin->setWindowFlags( flags );
+	subWin->setAttribute( Qt::WA_DeleteOnClose, false );
+	subWin->resize( 280, 160 );
+
+	// keeps reading while hidden so other readers of the stats, like
+	// --stats-udp, don't have to wait for this one
+	connect( &m_updateTimer, SIGNAL( timeout() ), this, SLOT( readStats() ) );
+	m_updateTimer.start( 100 );
+}
+
+
+
+
+PerformanceMonitor::~PerformanceMonitor()
+{
+}
+
+
+
+
+QLabel * PerformanceMonitor::addRow( const QString & _name )
+{
+	QLabel * label = new QLabel( "-", this );
+	static_cast<QFormLayout *>( layout() )->addRow( _name, label );
+	return label;
+}
+
+
+
+
+void PerformanceMonitor::readStats()
+{
+	auto stats = m_reader.read_max( m_reader.read_space() );
+	if( stats.size() == 0 || !isVisible() )
+	{
+		return;
+	}
+
+	float maximumLoad = 0;
+	int maximumJobs = 0;
+	for( std::size_t i = 0; i < stats.size(); ++i )
+	{
+		maximumLoad = qMax( maximumLoad, stats[i].load );
+		maximumJobs = qMax( maximumJobs, stats[i].jobs );
+	}
+	const Mixer::RenderStats & latest = stats[stats.size() - 1];
+
+	m_load->setText( tr( "%1% (max. %2%)" ).
+			arg( latest.load * 100, 0, 'f', 0 ).
+			arg( maximumLoad * 100, 0, 'f', 0 ) );
+	m_voices->setText( QString::number( latest.voices ) );
+	m_effects->setText( QString::number( latest.effects ) );
+	m_jobs->setText( tr( "%1 (max. %2)" ).arg( latest.jobs ).
+							arg( maximumJobs ) );
+	m_memory->setText( tr( "%1 MiB (max. %2 MiB)" ).
+			arg( latest.memory / 1048576.0, 0, 'f', 1 ).
+			arg( latest.memoryHighWater / 1048576.0, 0, 'f', 1 ) );
+}
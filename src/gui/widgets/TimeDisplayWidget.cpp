@@ -28,6 +28,7 @@
 #include "GuiApplication.h"
 #include "MainWindow.h"
 #include "Engine.h"
+#include "Mixer.h"
 #include "ToolTip.h"
 #include "Song.h"
 
@@ -54,8 +55,8 @@ TimeDisplayWidget::TimeDisplayWidget() :
 	// update labels of LCD spinboxes
 	setDisplayMode( m_displayMode );
 
-	connect( gui->mainWindow(), SIGNAL( periodicUpdate() ),
-					this, SLOT( updateTime() ) );
+	gui->mainWindow()->refreshScheduler()->add( this,
+			RefreshScheduler::DisplayRate, [this]() { updateTime(); } );
 }
 
 void TimeDisplayWidget::setDisplayMode( DisplayMode displayMode )
@@ -86,12 +87,14 @@ void TimeDisplayWidget::setDisplayMode( DisplayMode displayMode )
 void TimeDisplayWidget::updateTime()
 {
 	Song* s = Engine::getSong();
+	// as far as rendered, without racing the mixer advancing it
+	const Mixer::Snapshot & snapshot = Engine::mixer()->snapshot();
 
 	switch( m_displayMode )
 	{
 		case MinutesSeconds:
 			int msec;
-			msec = s->getMilliseconds();
+			msec = snapshot.milliseconds;
 			m_majorLCD.setValue(msec / 60000);
 			m_minorLCD.setValue((msec / 1000) % 60);
 			m_milliSecondsLCD.setValue(msec % 1000);
@@ -99,7 +102,7 @@ void TimeDisplayWidget::updateTime()
 
 		case BarsTicks:
 			int tick;
-			tick = s->getPlayPos().getTicks();
+			tick = snapshot.ticks;
 			m_majorLCD.setValue((int)(tick / s->ticksPerBar()) + 1);
 			m_minorLCD.setValue((tick % s->ticksPerBar()) /
 						 (s->ticksPerBar() / s->getTimeSigModel().getNumerator() ) +1);
@@ -150,8 +150,7 @@ TrackContentObjectView * BBTCO::createView( TrackView * _tv )
 
 BBTCOView::BBTCOView( TrackContentObject * _tco, TrackView * _tv ) :
 	TrackContentObjectView( _tco, _tv ),
-	m_bbTCO( dynamic_cast<BBTCO *>( _tco ) ),
-	m_paintPixmap()
+	m_bbTCO( dynamic_cast<BBTCO *>( _tco ) )
 {
 	connect( _tco->getTrack(), SIGNAL( dataChanged() ), this, SLOT( update() ) );
 
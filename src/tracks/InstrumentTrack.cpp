@@ -23,26 +23,32 @@
  *
  */
 
+#include <algorithm>
+
 #include <QDir>
 #include <QQueue>
 #include <QApplication>
 #include <QCloseEvent>
 #include <QLabel>
 #include <QLayout>
+#include <QEventLoop>
 #include <QLineEdit>
 #include <QMdiArea>
 #include <QMenu>
 #include <QMessageBox>
 #include <QMdiSubWindow>
 #include <QPainter>
+#include <QProgressDialog>
 
 #include "FileDialog.h"
 #include "InstrumentTrack.h"
 #include "AutomationPattern.h"
+#include "BBLoopCache.h"
 #include "BBTrack.h"
 #include "CaptionMenu.h"
 #include "ConfigManager.h"
 #include "ControllerConnection.h"
+#include "DummyInstrument.h"
 #include "EffectChain.h"
 #include "EffectRackView.h"
 #include "embed.h"
@@ -73,6 +79,7 @@
 #include "Song.h"
 #include "StringPairDrag.h"
 #include "TrackContainerView.h"
+#include "TrackFreeze.h"
 #include "TrackLabelButton.h"
 
 
@@ -87,6 +94,9 @@ const int PIANO_HEIGHT		= 80;
 const int INSTRUMENT_WINDOW_CACHE_SIZE = 8;
 
 
+std::atomic_int InstrumentTrack::s_noteStartsGeneration( 0 );
+
+
 // #### IT:
 InstrumentTrack::InstrumentTrack( TrackContainer* tc ) :
 	Track( Track::InstrumentTrack, tc ),
@@ -99,6 +109,8 @@ InstrumentTrack::InstrumentTrack( TrackContainer* tc ) :
 	m_previewMode( false ),
 	m_baseNoteModel( 0, 0, KeysPerOctave * NumOctaves - 1, this,
 							tr( "Base note" ) ),
+	m_voiceCount( 0 ),
+	m_noteStartsGeneration( -1 ),
 	m_volumeModel( DefaultVolume, MinVolume, MaxVolume, 0.1f, this, tr( "Volume" ) ),
 	m_panningModel( DefaultPanning, PanningLeft, PanningRight, 0.1f, this, tr( "Panning" ) ),
 	m_audioPort( tr( "unnamed_track" ), true, &m_volumeModel, &m_panningModel, &m_mutedModel ),
@@ -106,11 +118,15 @@ InstrumentTrack::InstrumentTrack( TrackContainer* tc ) :
 	m_pitchRangeModel( 1, 1, 60, this, tr( "Pitch range" ) ),
 	m_effectChannelModel( 0, 0, 0, this, tr( "FX channel" ) ),
 	m_useMasterPitchModel( true, this, tr( "Master pitch") ),
+	m_polyphonyModel( 0, 0, 256, this, tr( "Maximum polyphony" ) ),
+	m_voiceStealModel( this, tr( "Voice stealing" ) ),
 	m_instrument( NULL ),
 	m_soundShaping( this ),
 	m_arpeggio( this ),
 	m_noteStacking( this ),
-	m_piano( this )
+	m_piano( this ),
+	m_freezeHandle( NULL ),
+	m_freezeRecording( NULL )
 {
 	m_pitchModel.setCenterValue( 0 );
 	m_panningModel.setCenterValue( DefaultPanning );
@@ -118,6 +134,10 @@ InstrumentTrack::InstrumentTrack( TrackContainer* tc ) :
 
 	m_effectChannelModel.setRange( 0, Engine::fxMixer()->numChannels()-1, 1);
 
+	m_voiceStealModel.addItem( tr( "Oldest" ) );
+	m_voiceStealModel.addItem( tr( "Quietest" ) );
+	m_voiceStealModel.addItem( tr( "Same key" ) );
+
 	for( int i = 0; i < NumKeys; ++i )
 	{
 		m_notes[i] = NULL;
@@ -135,6 +155,12 @@ InstrumentTrack::InstrumentTrack( TrackContainer* tc ) :
 			this, SLOT( updatePitchRange() ), Qt::DirectConnection );
 	connect( &m_effectChannelModel, SIGNAL( dataChanged() ),
 			this, SLOT( updateEffectChannel() ), Qt::DirectConnection );
+
+	if( tc == (TrackContainer*)Engine::getBBTrackContainer() &&
+						BBLoopCache::isEnabled() )
+	{
+		setLoopCaching( true );
+	}
 }
 
 
@@ -149,6 +175,9 @@ int InstrumentTrack::baseNote() const
 
 InstrumentTrack::~InstrumentTrack()
 {
+	unfreeze();
+	setLoopCaching( false );
+
 	// kill all running notes and the iph
 	silenceAllNotes( true );
 
@@ -192,6 +221,8 @@ void InstrumentTrack::processAudioBuffer( sampleFrame* buf, const fpp_t frames,
 	// now
 	m_audioPort.effects()->startRunning();
 
+	m_audioPort.setSourceLatency( m_instrument->latencyFrames() );
+
 	// get volume knob data
 	static const float DefaultVolumeRatio = 1.0f / DefaultVolume;
 	/*ValueBuffer * volBuf = m_volumeModel.valueBuffer();
@@ -280,10 +311,10 @@ void InstrumentTrack::processInEvent( const MidiEvent& event, const MidiTime& ti
 		case MidiNoteOff:
 			if( m_notes[event.key()] != NULL )
 			{
-				// do actual note off and remove internal reference to NotePlayHandle (which itself will
-				// be deleted later automatically)
+				// note off with the next period the note plays and remove internal reference to
+				// NotePlayHandle (which itself will be deleted later automatically)
 				Engine::mixer()->requestChangeInModel();
-				m_notes[event.key()]->noteOff( offset );
+				m_notes[event.key()]->requestNoteOff( offset );
 				if (isSustainPedalPressed() &&
 					m_notes[event.key()]->origin() ==
 					m_notes[event.key()]->OriginMidiInput)
@@ -323,7 +354,8 @@ void InstrumentTrack::processInEvent( const MidiEvent& event, const MidiTime& ti
 				{
 					for (NotePlayHandle* nph : m_sustainedNotes)
 					{
-						if (nph && nph->isReleased())
+						if (nph && (nph->isReleased() ||
+							nph->isReleaseRequested()))
 						{
 							if( nph->origin() ==
 								nph->OriginMidiInput)
@@ -431,7 +463,7 @@ void InstrumentTrack::processOutEvent( const MidiEvent& event, const MidiTime& t
 	}
 
 	// if appropriate, midi-port does futher routing
-	m_midiPort.processOutEvent( event, time );
+	m_midiPort.processOutEvent( event, time, offset );
 }
 
 
@@ -488,8 +520,16 @@ void InstrumentTrack::playNote( NotePlayHandle* n, sampleFrame* workingBuffer )
 
 	if( n->isMasterNote() == false && m_instrument != NULL )
 	{
-		// all is done, so now lets play the note!
-		m_instrument->playNote( n, workingBuffer );
+		// all is done, so now lets play the note! Batched instruments
+		// render it later on together with all other notes of this period
+		if( m_instrument->flags().testFlag( Instrument::RendersVoicesBatched ) )
+		{
+			n->m_renderPending = true;
+		}
+		else
+		{
+			m_instrument->playNote( n, workingBuffer );
+		}
 	}
 }
 
@@ -613,11 +653,27 @@ void InstrumentTrack::removeMidiPortNode( DataFile & _dataFile )
 bool InstrumentTrack::play( const MidiTime & _start, const fpp_t _frames,
 							const f_cnt_t _offset, int _tco_num )
 {
+	if( _tco_num < 0 )
+	{
+		if( m_freezeRecording )
+		{
+			m_freezeRecording->markTick( _start.getTicks(), _offset );
+		}
+		if( m_freezeHandle )
+		{
+			// the frozen audio takes over from the notes
+			m_freezeHandle->jumpTo( _start.getTicks(), _offset );
+			return false;
+		}
+	}
+
+	// the lock is only held while the track itself is set up, editing
+	// notes doesn't take it (see Pattern::playedNotes())
 	if( ! m_instrument || ! tryLock() )
 	{
 		return false;
 	}
-	const float frames_per_tick = Engine::framesPerTick();
+	const float frames_per_tick = Engine::periodFramesPerTick();
 
 	tcoVector tcos;
 	::BBTrack * bb_track = NULL;
@@ -629,18 +685,33 @@ bool InstrumentTrack::play( const MidiTime & _start, const fpp_t _frames,
 		{
 			bb_track = BBTrack::findBBTrack( _tco_num );
 		}
-	}
-	else
-	{
-		getTCOsInRange( tcos, _start, _start + static_cast<int>(
-					_frames / frames_per_tick ) );
+		if( m_loopCache && m_loopCache->playTick(
+				dynamic_cast<Pattern *>( tco ), bb_track,
+				_tco_num, _start.getTicks(), _offset ) )
+		{
+			// the cached audio plays this tick
+			unlock();
+			return false;
+		}
 	}
 
 	// Handle automation: detuning
 	for( NotePlayHandleList::Iterator it = m_processHandles.begin();
 					it != m_processHandles.end(); ++it )
 	{
-		( *it )->processMidiTime( _start );
+		( *it )->processMidiTime( _start, _offset );
+	}
+
+	if( _tco_num < 0 )
+	{
+		// most ticks of the song don't start any note
+		if( !mayStartNote( _start ) )
+		{
+			unlock();
+			return false;
+		}
+		getTCOsInRange( tcos, _start, _start + static_cast<int>(
+					_frames / frames_per_tick ) );
 	}
 
 	if ( tcos.size() == 0 )
@@ -668,28 +739,25 @@ bool InstrumentTrack::play( const MidiTime & _start, const fpp_t _frames,
 			cur_start -= p->startPosition();
 		}
 
-		// get all notes from the given pattern...
-		const NoteVector & notes = p->notes();
-		// ...and set our index to zero
-		NoteVector::ConstIterator nit = notes.begin();
-
-		// very effective algorithm for playing notes that are
-		// posated within the current sample-frame
-
+		// get all notes from the given pattern, as of the last edit so
+		// editing doesn't have to wait for playback...
+		const Pattern::NoteSnapshot & notes = p->playedNotes();
 
+		// ...and find the first one starting at the current tick, they
+		// are sorted by position
+		Pattern::NoteSnapshot::const_iterator nit = notes.begin();
 		if( cur_start > 0 )
 		{
-			// skip notes which are posated before start-bar
-			while( nit != notes.end() && ( *nit )->pos() < cur_start )
-			{
-				++nit;
-			}
+			nit = std::lower_bound( notes.begin(), notes.end(), cur_start,
+				[]( const Note & note, const MidiTime & pos )
+				{
+					return note.pos() < pos;
+				} );
 		}
 
-		Note * cur_note;
-		while( nit != notes.end() &&
-					( cur_note = *nit )->pos() == cur_start )
+		while( nit != notes.end() && nit->pos() == cur_start )
 		{
+			const Note * cur_note = &*nit;
 			const f_cnt_t note_frames =
 				cur_note->length().frames( frames_per_tick );
 
@@ -715,6 +783,386 @@ bool InstrumentTrack::play( const MidiTime & _start, const fpp_t _frames,
 
 
 
+bool InstrumentTrack::mayStartNote( const MidiTime & _time )
+{
+	const int generation = s_noteStartsGeneration;
+	if( generation != m_noteStartsGeneration )
+	{
+		m_noteStartsGeneration = generation;
+		m_noteStarts.clear();
+		for( TrackContentObject * tco : getTCOs() )
+		{
+			Pattern * p = dynamic_cast<Pattern *>( tco );
+			if( p == NULL )
+			{
+				continue;
+			}
+			for( const Note & note : p->playedNotes() )
+			{
+				m_noteStarts.push_back( p->startPosition() +
+								note.pos() );
+			}
+		}
+		std::sort( m_noteStarts.begin(), m_noteStarts.end() );
+	}
+
+	return std::binary_search( m_noteStarts.begin(), m_noteStarts.end(),
+					static_cast<tick_t>( _time ) );
+}
+
+
+
+
+bool InstrumentTrack::isPlayingFrozen() const
+{
+	const Song * song = Engine::getSong();
+	return m_freezeHandle && song->playMode() == Song::Mode_PlaySong &&
+				( song->isPlaying() || song->isExporting() );
+}
+
+
+
+
+bool InstrumentTrack::setFreeze( std::unique_ptr<TrackFreeze> _freeze )
+{
+	unfreeze();
+
+	FreezePlayHandle * handle = new FreezePlayHandle( _freeze.get(), this );
+
+	Engine::mixer()->requestChangeInModel();
+	m_freeze = std::move( _freeze );
+	m_audioPort.setFrozenAfterEffects( m_freeze->afterEffects() );
+	m_freezeHandle = handle;
+	const bool added = Engine::mixer()->addPlayHandle( handle );
+	if( !added )
+	{
+		// the mixer deleted the handle already
+		m_freezeHandle = NULL;
+		m_audioPort.setFrozenAfterEffects( false );
+	}
+	Engine::mixer()->doneChangeInModel();
+
+	if( !added )
+	{
+		m_freeze.reset();
+		return false;
+	}
+
+	watchFreeze( true );
+	return true;
+}
+
+
+
+
+void InstrumentTrack::setFreezeRecording( TrackFreeze * _freeze )
+{
+	Engine::mixer()->requestChangeInModel();
+	m_freezeRecording = _freeze;
+	Engine::mixer()->doneChangeInModel();
+}
+
+
+
+
+void InstrumentTrack::unfreeze()
+{
+	if( !m_freeze )
+	{
+		return;
+	}
+
+	watchFreeze( false );
+
+	Engine::mixer()->requestChangeInModel();
+	Engine::mixer()->removePlayHandle( m_freezeHandle );
+	m_freezeHandle = NULL;
+	m_audioPort.setFrozenAfterEffects( false );
+	Engine::mixer()->doneChangeInModel();
+
+	m_freeze.reset();
+}
+
+
+
+
+QList<AutomatableModel *> InstrumentTrack::soundModels()
+{
+	QList<AutomatableModel *> models;
+	models << &m_baseNoteModel << &m_pitchModel << &m_pitchRangeModel
+		<< &m_useMasterPitchModel << &m_polyphonyModel
+		<< &m_voiceStealModel << &Engine::getSong()->getTempoModel();
+	models += m_soundShaping.findChildren<AutomatableModel *>();
+	models += m_arpeggio.findChildren<AutomatableModel *>();
+	models += m_noteStacking.findChildren<AutomatableModel *>();
+	if( m_instrument )
+	{
+		models += m_instrument->findChildren<AutomatableModel *>();
+	}
+	return models;
+}
+
+
+
+
+void InstrumentTrack::watchFreeze( bool _watch )
+{
+	QList<AutomatableModel *> models = soundModels();
+	if( m_freeze->afterEffects() )
+	{
+		models << &m_volumeModel << &m_panningModel;
+		models += m_audioPort.effects()->findChildren<AutomatableModel *>();
+	}
+
+	QList<Model *> objects;
+	for( TrackContentObject * tco : getTCOs() )
+	{
+		objects << tco;
+		models += tco->findChildren<AutomatableModel *>();
+	}
+	if( m_freeze->afterEffects() )
+	{
+		objects << m_audioPort.effects();
+	}
+
+	for( AutomatableModel * model : models )
+	{
+		if( _watch )
+		{
+			connect( model, SIGNAL( dataChanged() ),
+					this, SLOT( freezeModelChanged() ),
+					Qt::UniqueConnection );
+		}
+		else
+		{
+			disconnect( model, SIGNAL( dataChanged() ),
+					this, SLOT( freezeModelChanged() ) );
+		}
+	}
+
+	for( Model * object : objects )
+	{
+		if( _watch )
+		{
+			connect( object, SIGNAL( dataChanged() ),
+					this, SLOT( invalidateFreeze() ),
+					Qt::UniqueConnection );
+		}
+		else
+		{
+			disconnect( object, SIGNAL( dataChanged() ),
+					this, SLOT( invalidateFreeze() ) );
+		}
+		if( TrackContentObject * tco =
+				dynamic_cast<TrackContentObject *>( object ) )
+		{
+			for( const char * signal : { SIGNAL( positionChanged() ),
+						SIGNAL( lengthChanged() ),
+						SIGNAL( destroyedTCO() ) } )
+			{
+				if( _watch )
+				{
+					connect( tco, signal, this,
+						SLOT( invalidateFreeze() ),
+						Qt::UniqueConnection );
+				}
+				else
+				{
+					disconnect( tco, signal, this,
+						SLOT( invalidateFreeze() ) );
+				}
+			}
+		}
+	}
+
+	if( _watch )
+	{
+		connect( this, SIGNAL( trackContentObjectAdded( TrackContentObject * ) ),
+				this, SLOT( invalidateFreeze() ), Qt::UniqueConnection );
+		connect( this, SIGNAL( instrumentChanged() ),
+				this, SLOT( invalidateFreeze() ), Qt::UniqueConnection );
+		connect( Engine::mixer(), SIGNAL( sampleRateChanged() ),
+				this, SLOT( updateFreezeSampleRate() ),
+				Qt::UniqueConnection );
+	}
+	else
+	{
+		disconnect( this, SIGNAL( trackContentObjectAdded( TrackContentObject * ) ),
+				this, SLOT( invalidateFreeze() ) );
+		disconnect( this, SIGNAL( instrumentChanged() ),
+				this, SLOT( invalidateFreeze() ) );
+		disconnect( Engine::mixer(), SIGNAL( sampleRateChanged() ),
+				this, SLOT( updateFreezeSampleRate() ) );
+	}
+}
+
+
+
+
+void InstrumentTrack::freezeModelChanged()
+{
+	// automated and controlled models change while the song is played,
+	// the way they did while it was frozen
+	const AutomatableModel * model =
+			dynamic_cast<AutomatableModel *>( sender() );
+	if( model && model->isAutomatedOrControlled() )
+	{
+		return;
+	}
+	invalidateFreeze();
+}
+
+
+
+
+void InstrumentTrack::invalidateFreeze()
+{
+	// later, as e.g. the pattern which changed may be about to be deleted
+	QMetaObject::invokeMethod( this, "unfreeze", Qt::QueuedConnection );
+}
+
+
+
+
+void InstrumentTrack::updateFreezeSampleRate()
+{
+	if( m_freeze )
+	{
+		m_freeze->updateSampleRate();
+	}
+}
+
+
+
+
+void InstrumentTrack::setLoopCaching( bool _enabled )
+{
+	if( _enabled == ( m_loopCache != nullptr ) )
+	{
+		return;
+	}
+
+	if( _enabled )
+	{
+		BBLoopCache * cache = new BBLoopCache( this );
+		Engine::mixer()->requestChangeInModel();
+		m_loopCache.reset( cache );
+		Engine::mixer()->doneChangeInModel();
+		updateLoopCacheModels();
+		connect( this, SIGNAL( instrumentChanged() ),
+				this, SLOT( updateLoopCacheModels() ),
+				Qt::UniqueConnection );
+	}
+	else
+	{
+		disconnect( this, SIGNAL( instrumentChanged() ),
+				this, SLOT( updateLoopCacheModels() ) );
+		Engine::mixer()->requestChangeInModel();
+		m_loopCache.reset();
+		Engine::mixer()->doneChangeInModel();
+	}
+}
+
+
+
+
+void InstrumentTrack::updateLoopCacheModels()
+{
+	if( m_loopCache )
+	{
+		lock();
+		m_loopCache->setModels( soundModels() );
+		unlock();
+	}
+}
+
+
+
+
+void InstrumentTrack::limitPolyphony( NotePlayHandle * _newNote )
+{
+	const int limit = m_polyphonyModel.value();
+	if( limit <= 0 )
+	{
+		return;
+	}
+
+	// stolen notes fade out within a period, so only the ones which
+	// haven't been released yet and aren't about to be count
+	int playing = 0;
+	for( const NotePlayHandle * note : m_processHandles )
+	{
+		if( note != _newNote && !note->isReleased() &&
+						!note->isReleaseRequested() )
+		{
+			++playing;
+		}
+	}
+
+	for( ; playing >= limit; --playing )
+	{
+		NotePlayHandle * victim = voiceToSteal( _newNote );
+		if( victim == NULL )
+		{
+			break;
+		}
+		// the victim may be playing right now, e.g. when the new note
+		// comes from MIDI input
+		victim->requestSteal();
+	}
+}
+
+
+
+
+NotePlayHandle * InstrumentTrack::voiceToSteal( const NotePlayHandle * _newNote )
+{
+	// notes are appended as they start, so the first one is the oldest
+	NotePlayHandle * oldest = NULL;
+	NotePlayHandle * quietest = NULL;
+	float quietestLevel = 0;
+	for( NotePlayHandle * note : m_processHandles )
+	{
+		if( note == _newNote || note->isReleased() ||
+						note->isReleaseRequested() )
+		{
+			continue;
+		}
+		if( oldest == NULL )
+		{
+			oldest = note;
+		}
+
+		switch( m_voiceStealModel.value() )
+		{
+		case StealSameKey:
+			if( note->key() == _newNote->key() )
+			{
+				return note;
+			}
+			break;
+		case StealQuietest:
+		{
+			const float level = note->getVolume() *
+				note->volumeLevel( note->totalFramesPlayed() );
+			if( quietest == NULL || level < quietestLevel )
+			{
+				quietest = note;
+				quietestLevel = level;
+			}
+			break;
+		}
+		default:
+			return oldest;
+		}
+	}
+
+	return quietest ? quietest : oldest;
+}
+
+
+
+
 TrackContentObject * InstrumentTrack::createTCO( const MidiTime & )
 {
 	return new Pattern( this );
@@ -741,6 +1189,8 @@ void InstrumentTrack::saveTrackSpecificSettings( QDomDocument& doc, QDomElement
 	m_effectChannelModel.saveSettings( doc, thisElement, "fxch" );
 	m_baseNoteModel.saveSettings( doc, thisElement, "basenote" );
 	m_useMasterPitchModel.saveSettings( doc, thisElement, "usemasterpitch");
+	m_polyphonyModel.saveSettings( doc, thisElement, "polyphony" );
+	m_voiceStealModel.saveSettings( doc, thisElement, "voicesteal" );
 
 	if( m_instrument != NULL )
 	{
@@ -790,6 +1240,8 @@ void InstrumentTrack::loadTrackSpecificSettings( const QDomElement & thisElement
 	}
 	m_baseNoteModel.loadSettings( thisElement, "basenote" );
 	m_useMasterPitchModel.loadSettings( thisElement, "usemasterpitch");
+	m_polyphonyModel.loadSettings( thisElement, "polyphony" );
+	m_voiceStealModel.loadSettings( thisElement, "voicesteal" );
 
 	// clear effect-chain just in case we load an old preset without FX-data
 	m_audioPort.effects()->clear();
@@ -830,6 +1282,10 @@ void InstrumentTrack::loadTrackSpecificSettings( const QDomElement & thisElement
 				}
 				else
 				{
+					if( m_loopCache )
+					{
+						m_loopCache->clearModels();
+					}
 					delete m_instrument;
 					m_instrument = NULL;
 					m_instrument = Instrument::instantiate(
@@ -845,6 +1301,10 @@ void InstrumentTrack::loadTrackSpecificSettings( const QDomElement & thisElement
 					ControllerConnection::classNodeName() != node.nodeName() &&
 					!node.toElement().hasAttribute( "id" ))
 			{
+				if( m_loopCache )
+				{
+					m_loopCache->clearModels();
+				}
 				delete m_instrument;
 				m_instrument = NULL;
 				m_instrument = Instrument::instantiate(
@@ -895,10 +1355,22 @@ Instrument * InstrumentTrack::loadInstrument(const QString & _plugin_name,
 	silenceAllNotes( true );
 
 	lock();
-	delete m_instrument;
-	m_instrument = Instrument::instantiate(_plugin_name, this,
-					key, keyFromDnd);
+	if( m_loopCache )
+	{
+		m_loopCache->clearModels();
+	}
 	unlock();
+
+	// the old instrument goes first as it may remove the play handles of
+	// the track when destroyed. Setting up the new one can take seconds
+	// for SF2 and VST, meanwhile a silent one keeps the track playing
+	// without holding up the audio threads.
+	delete swapInstrument( new DummyInstrument( this ) );
+	Instrument * instrument = Instrument::instantiate( _plugin_name, this,
+							key, keyFromDnd );
+	delete swapInstrument( instrument );
+	// notes started meanwhile were silent and have no data of the new one
+	silenceAllNotes( false );
 	setName(m_instrument->displayName());
 
 	emit instrumentChanged();
@@ -909,6 +1381,19 @@ Instrument * InstrumentTrack::loadInstrument(const QString & _plugin_name,
 
 
 
+Instrument * InstrumentTrack::swapInstrument( Instrument * _instrument )
+{
+	Instrument * old = m_instrument;
+	Engine::mixer()->runInAudioThread( [this, _instrument]()
+	{
+		m_instrument = _instrument;
+	} );
+	return old;
+}
+
+
+
+
 
 // #### ITV:
 
@@ -1079,6 +1564,85 @@ void InstrumentTrackView::assignFxLine(int channelIndex)
 
 
 
+
+void InstrumentTrackView::addFreezeActions( QMenu * _menu )
+{
+	// only the song is played from freezes
+	if( model()->trackContainer() != Engine::getSong() )
+	{
+		return;
+	}
+
+	_menu->addSeparator();
+	if( model()->isFrozen() )
+	{
+		_menu->addAction( tr( "Unfreeze" ), model(), SLOT( unfreeze() ) );
+	}
+	else
+	{
+		_menu->addAction( tr( "Freeze" ), this, SLOT( freezeTrack() ) );
+		_menu->addAction( tr( "Freeze with effects" ),
+					this, SLOT( freezeTrackWithEffects() ) );
+	}
+}
+
+
+
+
+void InstrumentTrackView::freezeTrack()
+{
+	freeze( false );
+}
+
+
+
+
+void InstrumentTrackView::freezeTrackWithEffects()
+{
+	freeze( true );
+}
+
+
+
+
+void InstrumentTrackView::freeze( bool _afterEffects )
+{
+	TrackFreezer freezer( model(), _afterEffects );
+
+	QProgressDialog progress( tr( "Freezing %1..." ).arg( model()->name() ),
+				tr( "Cancel" ), 0, 100, gui->mainWindow() );
+	progress.setWindowModality( Qt::WindowModal );
+	progress.setMinimumDuration( 0 );
+
+	QEventLoop loop;
+	bool successful = false;
+	connect( &freezer, SIGNAL( progressChanged( int ) ),
+				&progress, SLOT( setValue( int ) ) );
+	connect( &progress, SIGNAL( canceled() ),
+				&freezer, SLOT( abortProcessing() ) );
+	connect( &freezer, &TrackFreezer::finished, [&]( bool _successful )
+	{
+		successful = _successful;
+		loop.quit();
+	} );
+
+	if( !freezer.start() )
+	{
+		QMessageBox::warning( gui->mainWindow(), tr( "Freeze failed" ),
+			tr( "Could not create a file for the frozen track." ) );
+		return;
+	}
+	loop.exec();
+
+	if( !successful && !progress.wasCanceled() )
+	{
+		QMessageBox::warning( gui->mainWindow(), tr( "Freeze failed" ),
+			tr( "Could not play the frozen track." ) );
+	}
+}
+
+
+
 // TODO: Add windows to free list on freeInstrumentTrackWindow.
 // But, don't NULL m_window or disconnect signals.  This will allow windows
 // that are being show/hidden frequently to stay connected.
@@ -1582,7 +2146,7 @@ void InstrumentTrackWindow::modelChanged()
 	m_arpeggioView->setModel( &m_track->m_arpeggio );
 	m_midiView->setModel( &m_track->m_midiPort );
 	m_effectView->setModel( m_track->m_audioPort.effects() );
-	m_miscView->pitchGroupBox()->setModel(&m_track->m_useMasterPitchModel);
+	m_miscView->setTrack( m_track );
 	updateName();
 }
 
@@ -41,7 +41,9 @@
 #include "BBTrackContainer.h"
 #include "StringPairDrag.h"
 #include "MainWindow.h"
+#include "Mixer.h"
 
+#include <algorithm>
 #include <limits>
 
 
@@ -56,7 +58,8 @@ Pattern::Pattern( InstrumentTrack * _instrument_track ) :
 	TrackContentObject( _instrument_track ),
 	m_instrumentTrack( _instrument_track ),
 	m_patternType( BeatPattern ),
-	m_steps( MidiTime::stepsPerBar() )
+	m_steps( MidiTime::stepsPerBar() ),
+	m_snapshot( std::make_shared<SnapshotSlot>() )
 {
 	setName( _instrument_track->name() );
 	if( _instrument_track->trackContainer()
@@ -75,12 +78,14 @@ Pattern::Pattern( const Pattern& other ) :
 	TrackContentObject( other.m_instrumentTrack ),
 	m_instrumentTrack( other.m_instrumentTrack ),
 	m_patternType( other.m_patternType ),
-	m_steps( other.m_steps )
+	m_steps( other.m_steps ),
+	m_snapshot( std::make_shared<SnapshotSlot>() )
 {
 	for( NoteVector::ConstIterator it = other.m_notes.begin(); it != other.m_notes.end(); ++it )
 	{
 		m_notes.push_back( new Note( **it ) );
 	}
+	m_snapshot->notes = takeSnapshot();
 
 	init();
 	switch( getTrack()->trackContainer()->type() )
@@ -143,6 +148,13 @@ void Pattern::init()
 {
 	connect( Engine::getSong(), SIGNAL( timeSignatureChanged( int, int ) ),
 				this, SLOT( changeTimeSignature() ) );
+	connect( this, &Model::dataChanged,
+			[](){ InstrumentTrack::invalidateNoteStarts(); } );
+	// notes are edited in place before the pattern is told about it
+	connect( this, SIGNAL( dataChanged() ), this, SLOT( publishNotes() ) );
+	connect( this, &TrackContentObject::positionChanged,
+			[](){ InstrumentTrack::invalidateNoteStarts(); } );
+	InstrumentTrack::invalidateNoteStarts();
 	saveJournallingState( false );
 
 	updateLength();
@@ -214,9 +226,7 @@ Note * Pattern::addNote( const Note & _new_note, const bool _quant_pos )
 		new_note->quantizePos( gui->pianoRoll()->quantization() );
 	}
 
-	instrumentTrack()->lock();
 	m_notes.insert(std::upper_bound(m_notes.begin(), m_notes.end(), new_note, Note::lessThan), new_note);
-	instrumentTrack()->unlock();
 
 	checkType();
 	updateLength();
@@ -229,9 +239,45 @@ Note * Pattern::addNote( const Note & _new_note, const bool _quant_pos )
 
 
 
+void Pattern::addNotes( const QVector<Note> & _new_notes,
+						const bool _quant_pos )
+{
+	if( _new_notes.isEmpty() )
+	{
+		return;
+	}
+
+	NoteVector new_notes;
+	new_notes.reserve( _new_notes.size() );
+	for( const Note & note : _new_notes )
+	{
+		Note * new_note = new Note( note );
+		if( _quant_pos && gui->pianoRoll() )
+		{
+			new_note->quantizePos( gui->pianoRoll()->quantization() );
+		}
+		new_notes.push_back( new_note );
+	}
+	// sorted and merged stably, so new notes come after existing ones at
+	// the same position just like with addNote()
+	std::stable_sort( new_notes.begin(), new_notes.end(), Note::lessThan );
+
+	const int old_size = m_notes.size();
+	m_notes += new_notes;
+	std::inplace_merge( m_notes.begin(), m_notes.begin() + old_size,
+					m_notes.end(), Note::lessThan );
+
+	checkType();
+	updateLength();
+
+	emit dataChanged();
+}
+
+
+
+
 void Pattern::removeNote( Note * _note_to_del )
 {
-	instrumentTrack()->lock();
 	NoteVector::Iterator it = m_notes.begin();
 	while( it != m_notes.end() )
 	{
@@ -243,7 +289,6 @@ void Pattern::removeNote( Note * _note_to_del )
 		}
 		++it;
 	}
-	instrumentTrack()->unlock();
 
 	checkType();
 	updateLength();
@@ -274,20 +319,21 @@ void Pattern::rearrangeAllNotes()
 {
 	// sort notes by start time
 	std::sort(m_notes.begin(), m_notes.end(), Note::lessThan);
+	// notes are moved around in place before
+	InstrumentTrack::invalidateNoteStarts();
+	publishNotes();
 }
 
 
 
 void Pattern::clearNotes()
 {
-	instrumentTrack()->lock();
 	for( NoteVector::Iterator it = m_notes.begin(); it != m_notes.end();
 									++it )
 	{
 		delete *it;
 	}
 	m_notes.clear();
-	instrumentTrack()->unlock();
 
 	checkType();
 	emit dataChanged();
@@ -296,6 +342,38 @@ void Pattern::clearNotes()
 
 
 
+void Pattern::publishNotes()
+{
+	// the change takes the notes it replaces along, and changes are
+	// destroyed outside of the audio thread
+	std::shared_ptr<SnapshotSlot> slot = m_snapshot;
+	std::shared_ptr<const NoteSnapshot> notes = takeSnapshot();
+	Engine::mixer()->postChangeInModel( [slot, notes]() mutable
+	{
+		slot->notes.swap( notes );
+		// the note starts may have been gathered from the old notes
+		// since the edit
+		InstrumentTrack::invalidateNoteStarts();
+	} );
+}
+
+
+
+
+std::shared_ptr<const Pattern::NoteSnapshot> Pattern::takeSnapshot() const
+{
+	std::shared_ptr<NoteSnapshot> notes = std::make_shared<NoteSnapshot>();
+	notes->reserve( m_notes.size() );
+	for( const Note * note : m_notes )
+	{
+		notes->push_back( *note );
+	}
+	return notes;
+}
+
+
+
+
 Note * Pattern::addStepNote( int step )
 {
 	return addNote( Note( MidiTime( -DefaultTicksPerBar ),
@@ -578,7 +656,6 @@ void Pattern::changeTimeSignature()
 PatternView::PatternView( Pattern* pattern, TrackView* parent ) :
 	TrackContentObjectView( pattern, parent ),
 	m_pat( pattern ),
-	m_paintPixmap(),
 	m_noteFillColor(255, 255, 255, 220),
 	m_noteBorderColor(255, 255, 255, 220),
 	m_mutedNoteFillColor(100, 100, 100, 220),
@@ -26,6 +26,7 @@
 
 #include <QDropEvent>
 #include <QFileInfo>
+#include <QInputDialog>
 #include <QMenu>
 #include <QLayout>
 #include <QLineEdit>
@@ -53,11 +54,27 @@
 #include "TabWidget.h"
 #include "TrackLabelButton.h"
 
+
+// how far clips can be transposed
+static const int MaxSemitones = 24;
+
+
 SampleTCO::SampleTCO( Track * _track ) :
 	TrackContentObject( _track ),
 	m_sampleBuffer( new SampleBuffer ),
-	m_isPlaying( false )
+	m_isPlaying( false ),
+	m_sampleTempo( 0 ),
+	m_semitones( 0 )
 {
+	// recordings of several hours shouldn't have to fit into memory
+	m_sampleBuffer->setStreamingEnabled( true );
+	// the project can be edited while its samples are being decoded
+	m_sampleBuffer->setBackgroundDecoding( true );
+	connect( m_sampleBuffer, SIGNAL( sampleUpdated() ),
+					this, SIGNAL( sampleChanged() ) );
+	connect( m_sampleBuffer, SIGNAL( stretchUpdated() ),
+					this, SLOT( updateTrackTcos() ) );
+
 	saveJournallingState( false );
 	setSampleFile( "" );
 	restoreJournallingState();
@@ -66,6 +83,9 @@ SampleTCO::SampleTCO( Track * _track ) :
 	// change length of this TCO
 	connect( Engine::getSong(), SIGNAL( tempoChanged( bpm_t ) ),
 					this, SLOT( updateLength() ), Qt::DirectConnection );
+	// stretched on the GUI thread, also when automation changes the tempo
+	connect( Engine::getSong(), SIGNAL( tempoChanged( bpm_t ) ),
+					this, SLOT( updateStretch() ) );
 	connect( Engine::getSong(), SIGNAL( timeSignatureChanged( int,int ) ),
 					this, SLOT( updateLength() ) );
 
@@ -143,6 +163,9 @@ void SampleTCO::setSampleBuffer( SampleBuffer* sb )
 	sharedObject::unref( m_sampleBuffer );
 	Engine::mixer()->doneChangeInModel();
 	m_sampleBuffer = sb;
+	connect( m_sampleBuffer, SIGNAL( stretchUpdated() ),
+					this, SLOT( updateTrackTcos() ) );
+	updateStretch();
 	updateLength();
 
 	emit sampleChanged();
@@ -232,7 +255,9 @@ void SampleTCO::updateLength()
 
 MidiTime SampleTCO::sampleLength() const
 {
-	return (int)( m_sampleBuffer->frames() / Engine::framesPerTick() );
+	// the same for the stretched sample
+	return (int)( m_sampleBuffer->frames() / Engine::framesPerTick() /
+								tempoRatio() );
 }
 
 
@@ -240,7 +265,7 @@ MidiTime SampleTCO::sampleLength() const
 
 void SampleTCO::setSampleStartFrame(f_cnt_t startFrame)
 {
-	m_sampleBuffer->setStartFrame( startFrame );
+	playbackBuffer()->setStartFrame( startFrame );
 }
 
 
@@ -248,7 +273,63 @@ void SampleTCO::setSampleStartFrame(f_cnt_t startFrame)
 
 void SampleTCO::setSamplePlayLength(f_cnt_t length)
 {
-	m_sampleBuffer->setEndFrame( length );
+	playbackBuffer()->setEndFrame( length );
+}
+
+
+
+
+SampleBuffer* SampleTCO::playbackBuffer()
+{
+	SampleBuffer* stretched = m_sampleBuffer->stretched();
+	return stretched ? stretched : m_sampleBuffer;
+}
+
+
+
+
+double SampleTCO::playbackSpeed() const
+{
+	return m_sampleBuffer->stretched() ? 1.0 : tempoRatio();
+}
+
+
+
+
+double SampleTCO::tempoRatio() const
+{
+	return m_sampleTempo > 0 ?
+		Engine::getSong()->getTempo() / m_sampleTempo : 1.0;
+}
+
+
+
+
+void SampleTCO::setSampleTempo( float _tempo )
+{
+	m_sampleTempo = qMax( _tempo, 0.0f );
+	updateStretch();
+	updateTrackTcos();
+	emit sampleChanged();
+}
+
+
+
+
+void SampleTCO::setSemitones( int _semitones )
+{
+	m_semitones = _semitones;
+	updateStretch();
+	updateTrackTcos();
+	emit sampleChanged();
+}
+
+
+
+
+void SampleTCO::updateStretch()
+{
+	m_sampleBuffer->setStretch( tempoRatio(), m_semitones );
 }
 
 
@@ -275,6 +356,8 @@ void SampleTCO::saveSettings( QDomDocument & _doc, QDomElement & _this )
 	}
 
 	_this.setAttribute ("sample_rate", m_sampleBuffer->sampleRate());
+	_this.setAttribute( "sampletempo", m_sampleTempo );
+	_this.setAttribute( "pitch", m_semitones );
 	// TODO: start- and end-frame
 }
 
@@ -299,6 +382,10 @@ void SampleTCO::loadSettings( const QDomElement & _this )
 	if (_this.hasAttribute("sample_rate")) {
 		m_sampleBuffer->setSampleRate(_this.attribute("sample_rate").toInt());
 	}
+
+	m_sampleTempo = _this.attribute( "sampletempo", "0" ).toFloat();
+	m_semitones = _this.attribute( "pitch", "0" ).toInt();
+	updateStretch();
 }
 
 
@@ -314,8 +401,7 @@ TrackContentObjectView * SampleTCO::createView( TrackView * _tv )
 
 SampleTCOView::SampleTCOView( SampleTCO * _tco, TrackView * _tv ) :
 	TrackContentObjectView( _tco, _tv ),
-	m_tco( _tco ),
-	m_paintPixmap()
+	m_tco( _tco )
 {
 	// update UI and tooltip
 	updateSample();
@@ -340,6 +426,51 @@ void SampleTCOView::updateSample()
 
 
 
+void SampleTCOView::setSampleTempo()
+{
+	float tempo = m_tco->sampleTempo();
+	if( tempo <= 0 )
+	{
+		// guessed for loops of whole bars
+		const float bars = m_tco->sampleBuffer()->frames() /
+			Engine::framesPerTick() / MidiTime::ticksPerBar();
+		tempo = Engine::getSong()->getTempo();
+		if( bars > 0 )
+		{
+			tempo *= qMax( qRound( bars ), 1 ) / bars;
+		}
+	}
+	bool ok;
+	const double newTempo = QInputDialog::getDouble( this,
+			tr( "Fit to song tempo" ),
+			tr( "Tempo of the sample in BPM, 0 plays it at its own "
+				"speed:" ), tempo, 0, MaxTempo, 2, &ok );
+	if( ok )
+	{
+		m_tco->setSampleTempo( newTempo );
+		Engine::getSong()->setModified();
+	}
+}
+
+
+
+
+void SampleTCOView::setSemitones()
+{
+	bool ok;
+	const int semitones = QInputDialog::getInt( this, tr( "Transpose" ),
+			tr( "Semitones to shift the sample by:" ),
+			m_tco->semitones(), -MaxSemitones, MaxSemitones, 1, &ok );
+	if( ok )
+	{
+		m_tco->setSemitones( semitones );
+		Engine::getSong()->setModified();
+	}
+}
+
+
+
+
 void SampleTCOView::contextMenuEvent( QContextMenuEvent * _cme )
 {
 	if( _cme->modifiers() )
@@ -365,6 +496,11 @@ void SampleTCOView::contextMenuEvent( QContextMenuEvent * _cme )
 	contextMenu.addAction( embed::getIconPixmap( "muted" ),
 				tr( "Mute/unmute (<%1> + middle click)" ).arg(UI_CTRL_KEY),
 						m_tco, SLOT( toggleMute() ) );
+	contextMenu.addSeparator();
+	contextMenu.addAction( tr( "Fit to song tempo..." ),
+					this, SLOT( setSampleTempo() ) );
+	contextMenu.addAction( tr( "Transpose..." ),
+					this, SLOT( setSemitones() ) );
 	/*contextMenu.addAction( embed::getIconPixmap( "record" ),
 				tr( "Set/clear record" ),
 						m_tco, SLOT( toggleRecord() ) );*/
@@ -533,11 +669,17 @@ void SampleTCOView::paintEvent( QPaintEvent * pe )
 	float offset =  m_tco->startTimeOffset() / ticksPerBar * pixelsPerBar();
 	QRect r = QRect( TCO_BORDER_WIDTH + offset, spacing,
 			qMax( static_cast<int>( m_tco->sampleLength() * ppb / ticksPerBar ), 1 ), rect().bottom() - 2 * spacing );
-	m_tco->m_sampleBuffer->visualize( p, r, pe->rect() );
+	// there's no waveform to show until the sample is decoded
+	const bool decoding = m_tco->m_sampleBuffer->isDecoding();
+	if( !decoding )
+	{
+		m_tco->m_sampleBuffer->visualize( p, r, pe->rect() );
+	}
 
 	QFileInfo fileInfo(m_tco->m_sampleBuffer->audioFile());
 	QString filename = fileInfo.fileName();
-	paintTextLabel(filename, p);
+	paintTextLabel( decoding ? tr( "%1 (loading)" ).arg( filename ) :
+							filename, p );
 
 	// disable antialiasing for borders, since its not needed
 	p.setRenderHint( QPainter::Antialiasing, false );
@@ -648,10 +790,9 @@ bool SampleTrack::play( const MidiTime & _start, const fpp_t _frames,
 			{
 				if( sTco->isPlaying() == false && _start > sTco->startPosition() + sTco->startTimeOffset() )
 				{
-					auto bufferFramesPerTick = Engine::framesPerTick (sTco->sampleBuffer ()->sampleRate ());
-					f_cnt_t sampleStart = bufferFramesPerTick * ( _start - sTco->startPosition() - sTco->startTimeOffset() );
-					f_cnt_t tcoFrameLength = bufferFramesPerTick * ( sTco->endPosition() - sTco->startPosition() - sTco->startTimeOffset() );
-					f_cnt_t sampleBufferLength = sTco->sampleBuffer()->frames();
+					f_cnt_t sampleStart = sampleFrameAt( sTco, _start );
+					f_cnt_t tcoFrameLength = sampleFrameAt( sTco, sTco->endPosition() );
+					f_cnt_t sampleBufferLength = sTco->playbackBuffer()->frames();
 					//if the Tco smaller than the sample length we play only until Tco end
 					//else we play the sample to the end but nothing more
 					f_cnt_t samplePlayLength = tcoFrameLength > sampleBufferLength ? sampleBufferLength : tcoFrameLength;
@@ -673,6 +814,7 @@ bool SampleTrack::play( const MidiTime & _start, const fpp_t _frames,
 			nowPlaying = nowPlaying || sTco->isPlaying();
 		}
 		setPlaying(nowPlaying);
+		cueUpcomingTcos( _start );
 	}
 
 	for( tcoVector::Iterator it = tcos.begin(); it != tcos.end(); ++it )
@@ -710,6 +852,60 @@ bool SampleTrack::play( const MidiTime & _start, const fpp_t _frames,
 
 
 
+void SampleTrack::cueUpcomingTcos( const MidiTime & _start )
+{
+	const MidiTime ahead = static_cast<int>( CueMilliseconds *
+			Engine::mixer()->processingSampleRate() / 1000.0f /
+						Engine::framesPerTick() );
+
+	// the song jumps back to the loop's beginning within that time
+	TimeLineWidget * tl = Engine::getSong()->getPlayPos(
+						Song::Mode_PlaySong ).m_timeLine;
+	const bool loops = tl != NULL && tl->loopPointsEnabled() &&
+				!Engine::getSong()->isExporting() &&
+				_start < tl->loopEnd() && _start + ahead >= tl->loopEnd();
+
+	for( int i = 0; i < numOfTCOs(); ++i )
+	{
+		SampleTCO * sTco = dynamic_cast<SampleTCO *>( getTCO( i ) );
+		// playing ones would lose what they're reading
+		if( sTco->isPlaying() || sTco->isMuted() || sTco->isRecord() ||
+				!sTco->playbackBuffer()->isStreaming() )
+		{
+			continue;
+		}
+
+		// where the sample is once playback gets there, the sample
+		// may start before the clip
+		const MidiTime begin = qMax<int>( sTco->startPosition(),
+				sTco->startPosition() + sTco->startTimeOffset() );
+		if( begin > _start && begin <= _start + ahead &&
+					begin < sTco->endPosition() )
+		{
+			sTco->playbackBuffer()->cue( sampleFrameAt( sTco, begin ) );
+		}
+		else if( loops && tl->loopBegin() >= begin &&
+					tl->loopBegin() < sTco->endPosition() )
+		{
+			sTco->playbackBuffer()->cue(
+					sampleFrameAt( sTco, tl->loopBegin() ) );
+		}
+	}
+}
+
+
+
+
+f_cnt_t SampleTrack::sampleFrameAt( SampleTCO * _tco, const MidiTime & _time )
+{
+	auto bufferFramesPerTick = Engine::framesPerTick( _tco->playbackBuffer()->sampleRate() ) *
+							_tco->playbackSpeed();
+	return bufferFramesPerTick * ( _time - _tco->startPosition() - _tco->startTimeOffset() );
+}
+
+
+
+
 TrackView * SampleTrack::createView( TrackContainerView* tcv )
 {
 	return new SampleTrackView( this, tcv );
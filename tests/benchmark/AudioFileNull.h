@@ -0,0 +1,82 @@
+/*
+ * AudioFileNull.h - file device which discards the audio but records how
+ *                   long each period took to render
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef AUDIO_FILE_NULL_H
+#define AUDIO_FILE_NULL_H
+
+#include <QtCore/QProcess>
+
+#include <vector>
+
+#include "AudioFileDevice.h"
+#include "MicroTimer.h"
+
+
+class AudioFileNull : public AudioFileDevice
+{
+public:
+	AudioFileNull( OutputSettings const & outputSettings, Mixer * mixer ) :
+		AudioFileDevice( outputSettings, DEFAULT_CHANNELS,
+					QProcess::nullDevice(), mixer ),
+		m_frames( 0 )
+	{
+		// avoid reallocations while rendering about ten minutes
+		m_periodTimes.reserve( 100000 );
+	}
+
+	void startProcessing() override
+	{
+		AudioFileDevice::startProcessing();
+		m_timer.reset();
+	}
+
+	//! Microseconds each period took from the end of the previous one,
+	//! i.e. rendering plus everything the export loop does around it
+	const std::vector<int> & periodTimes() const
+	{
+		return m_periodTimes;
+	}
+
+	f_cnt_t frames() const
+	{
+		return m_frames;
+	}
+
+
+private:
+	void writeBuffer( const surroundSampleFrame *, const fpp_t _frames,
+					float ) override
+	{
+		m_periodTimes.push_back( m_timer.elapsed() );
+		m_frames += _frames;
+		m_timer.reset();
+	}
+
+	MicroTimer m_timer;
+	std::vector<int> m_periodTimes;
+	f_cnt_t m_frames;
+
+} ;
+
+
+#endif
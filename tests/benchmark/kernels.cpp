@@ -0,0 +1,471 @@
+/*
+ * kernels.cpp - lmms-microbench, times the DSP primitives everything else is
+ *               built from across period sizes
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QRegExp>
+#include <QtCore/QStringList>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "lmmsconfig.h"
+#include "lmmsversion.h"
+
+#include "AutomatableModel.h"
+#include "BandLimitedWave.h"
+#include "BasicFilters.h"
+#include "Engine.h"
+#include "Mixer.h"
+#include "MixHelpers.h"
+#include "Oscillator.h"
+#include "SampleBuffer.h"
+#include "ValueBuffer.h"
+
+
+// the largest period size that is benchmarked
+static const int MaxFrames = 4096;
+
+// results are summed up in here so the compiler can't drop the work
+static volatile float s_sink = 0.0f;
+
+
+//! One kernel to time. run() processes the given number of frames into
+//! the buffer, state that has to survive between runs is captured by it.
+struct Kernel
+{
+	QString name;
+	std::function<void( sampleFrame *, int )> run;
+} ;
+
+
+
+
+static void fillNoise( sampleFrame * _buf, int _frames )
+{
+	for( int f = 0; f < _frames; ++f )
+	{
+		_buf[f][0] = Oscillator::noiseSample( 0 );
+		_buf[f][1] = Oscillator::noiseSample( 0 );
+	}
+}
+
+
+
+
+static void consume( const sampleFrame * _buf, int _frames )
+{
+	s_sink = s_sink + _buf[0][0] + _buf[_frames - 1][1];
+}
+
+
+
+
+static void addMixHelpers( std::vector<Kernel> & _kernels )
+{
+	// all of them are shared by the kernels, so keep them alive until exit
+	static sampleFrame src[MaxFrames];
+	static sample_t srcLeft[MaxFrames];
+	static sample_t srcRight[MaxFrames];
+	static ValueBuffer coeffs1( MaxFrames );
+	static ValueBuffer coeffs2( MaxFrames );
+
+	fillNoise( src, MaxFrames );
+	for( int f = 0; f < MaxFrames; ++f )
+	{
+		srcLeft[f] = src[f][0];
+		srcRight[f] = src[f][1];
+	}
+	coeffs1.interpolate( 0.0f, 1.0f );
+	coeffs2.interpolate( 1.0f, 0.5f );
+
+	// dst is never cleared, it only grows linearly and stays finite for
+	// far longer than any run takes
+	_kernels.push_back( { "MixHelpers::add", []( sampleFrame * dst, int frames ) {
+		MixHelpers::add( dst, src, frames ); } } );
+	_kernels.push_back( { "MixHelpers::addMultiplied", []( sampleFrame * dst, int frames ) {
+		MixHelpers::addMultiplied( dst, src, -0.5f, frames ); } } );
+	_kernels.push_back( { "MixHelpers::addSwappedMultiplied", []( sampleFrame * dst, int frames ) {
+		MixHelpers::addSwappedMultiplied( dst, src, -0.5f, frames ); } } );
+	_kernels.push_back( { "MixHelpers::addMultipliedStereo", []( sampleFrame * dst, int frames ) {
+		MixHelpers::addMultipliedStereo( dst, src, -0.5f, 0.5f, frames ); } } );
+	_kernels.push_back( { "MixHelpers::addMultipliedByBuffer", []( sampleFrame * dst, int frames ) {
+		MixHelpers::addMultipliedByBuffer( dst, src, -0.5f, &coeffs1, frames ); } } );
+	_kernels.push_back( { "MixHelpers::addMultipliedByBuffers", []( sampleFrame * dst, int frames ) {
+		MixHelpers::addMultipliedByBuffers( dst, src, &coeffs1, &coeffs2, frames ); } } );
+	_kernels.push_back( { "MixHelpers::addSanitizedMultiplied", []( sampleFrame * dst, int frames ) {
+		MixHelpers::addSanitizedMultiplied( dst, src, -0.5f, frames ); } } );
+	_kernels.push_back( { "MixHelpers::addSanitizedMultipliedByBuffer", []( sampleFrame * dst, int frames ) {
+		MixHelpers::addSanitizedMultipliedByBuffer( dst, src, -0.5f, &coeffs1, frames ); } } );
+	_kernels.push_back( { "MixHelpers::multiplyAndAddMultiplied", []( sampleFrame * dst, int frames ) {
+		MixHelpers::multiplyAndAddMultiplied( dst, src, 0.5f, 0.5f, frames ); } } );
+	// planar input as it comes from plugins with separate channel buffers
+	_kernels.push_back( { "MixHelpers::multiplyAndAddMultipliedJoined", []( sampleFrame * dst, int frames ) {
+		MixHelpers::multiplyAndAddMultipliedJoined( dst, srcLeft, srcRight, 0.5f, 0.5f, frames ); } } );
+	_kernels.push_back( { "MixHelpers::isSilent", []( sampleFrame *, int frames ) {
+		s_sink = s_sink + MixHelpers::isSilent( src, frames ); } } );
+	_kernels.push_back( { "MixHelpers::sanitize", []( sampleFrame * dst, int frames ) {
+		s_sink = s_sink + MixHelpers::sanitize( dst, frames ); } } );
+}
+
+
+
+
+static void addOscillators( std::vector<Kernel> & _kernels )
+{
+	struct Shape
+	{
+		const char * name;
+		Oscillator::WaveShapes shape;
+	} ;
+	const Shape shapes[] = {
+		{ "sine", Oscillator::SineWave },
+		{ "triangle", Oscillator::TriangleWave },
+		{ "saw", Oscillator::SawWave },
+		{ "square", Oscillator::SquareWave },
+		{ "moogsaw", Oscillator::MoogSawWave },
+		{ "exp", Oscillator::ExponentialWave },
+		{ "noise", Oscillator::WhiteNoise }
+	} ;
+
+	// the oscillators only keep references to these
+	static const float freq = 440.0f;
+	static const float detuning = 1.0f / 44100;
+	static const float phaseOffset = 0.0f;
+	static const float volume = 1.0f;
+	static IntModel modAlgo( Oscillator::PhaseModulation, 0,
+					Oscillator::NumModulationAlgos - 1 );
+
+	for( const Shape & s : shapes )
+	{
+		auto shapeModel = std::make_shared<IntModel>( s.shape, 0,
+						Oscillator::NumWaveShapes - 1 );
+		auto osc = std::make_shared<Oscillator>( shapeModel.get(),
+				&modAlgo, freq, detuning, phaseOffset, volume );
+
+		_kernels.push_back( { QString( "Oscillator::update/%1/mono" ).arg( s.name ),
+			[shapeModel, osc]( sampleFrame * buf, int frames ) {
+				osc->update( buf, frames, 0 );
+				consume( buf, frames ); } } );
+		// stereo as in TripleOscillator, one oscillator per channel
+		auto right = std::make_shared<Oscillator>( shapeModel.get(),
+				&modAlgo, freq, detuning, phaseOffset, volume );
+		_kernels.push_back( { QString( "Oscillator::update/%1/stereo" ).arg( s.name ),
+			[shapeModel, osc, right]( sampleFrame * buf, int frames ) {
+				osc->update( buf, frames, 0 );
+				right->update( buf, frames, 1 );
+				consume( buf, frames ); } } );
+	}
+
+	// one modulated pair to cover the sub oscillator paths
+	static IntModel sineModel( Oscillator::SineWave, 0,
+					Oscillator::NumWaveShapes - 1 );
+	auto pm = std::make_shared<Oscillator>( &sineModel, &modAlgo,
+			freq, detuning, phaseOffset, volume,
+			new Oscillator( &sineModel, &modAlgo, freq, detuning,
+						phaseOffset, volume ) );
+	_kernels.push_back( { "Oscillator::update/sine+pm/mono",
+		[pm]( sampleFrame * buf, int frames ) {
+			pm->update( buf, frames, 0 );
+			consume( buf, frames ); } } );
+}
+
+
+
+
+static void addBandLimitedWaves( std::vector<Kernel> & _kernels )
+{
+	struct Wave
+	{
+		const char * name;
+		BandLimitedWave::Waveforms wave;
+	} ;
+	const Wave waves[] = {
+		{ "saw", BandLimitedWave::BLSaw },
+		{ "square", BandLimitedWave::BLSquare },
+		{ "triangle", BandLimitedWave::BLTriangle },
+		{ "moog", BandLimitedWave::BLMoog }
+	} ;
+
+	// a low and a high note, which use different tables
+	for( float freq : { 110.0f, 3520.0f } )
+	{
+		for( const Wave & w : waves )
+		{
+			const float len = BandLimitedWave::freqToLen( freq, 44100 );
+			const BandLimitedWave::Waveforms wave = w.wave;
+			auto phase = std::make_shared<float>( 0.0f );
+			_kernels.push_back( { QString( "BandLimitedWave::oscillate/%1/%2Hz" ).
+						arg( w.name ).arg( freq ),
+				[len, wave, phase]( sampleFrame * buf, int frames ) {
+					float ph = *phase;
+					for( int f = 0; f < frames; ++f )
+					{
+						buf[f][0] = buf[f][1] =
+							BandLimitedWave::oscillate( ph, len, wave );
+						ph += 1.0f / len;
+					}
+					*phase = fraction( ph );
+					consume( buf, frames ); } } );
+		}
+	}
+}
+
+
+
+
+template<ch_cnt_t CHANNELS>
+static void addFilters( std::vector<Kernel> & _kernels, const char * _layout )
+{
+	struct Type
+	{
+		const char * name;
+		typename BasicFilters<CHANNELS>::FilterTypes type;
+	} ;
+	const Type types[] = {
+		{ "lowpass", BasicFilters<CHANNELS>::LowPass },
+		{ "moog", BasicFilters<CHANNELS>::Moog },
+		{ "doublelowpass", BasicFilters<CHANNELS>::DoubleLowPass },
+		{ "lowpass_rc24", BasicFilters<CHANNELS>::Lowpass_RC24 },
+		{ "formant", BasicFilters<CHANNELS>::Formantfilter },
+		{ "doublemoog", BasicFilters<CHANNELS>::DoubleMoog },
+		{ "sv_lowpass", BasicFilters<CHANNELS>::Lowpass_SV },
+		{ "fastformant", BasicFilters<CHANNELS>::FastFormant },
+		{ "tripole", BasicFilters<CHANNELS>::Tripole }
+	} ;
+
+	static sampleFrame input[MaxFrames];
+	fillNoise( input, MaxFrames );
+
+	for( const Type & t : types )
+	{
+		auto filter = std::make_shared<BasicFilters<CHANNELS> >( 44100 );
+		filter->setFilterType( t.type );
+		filter->calcFilterCoeffs( 2000.0f, 0.7f );
+		_kernels.push_back( { QString( "BasicFilters::update/%1/%2" ).
+						arg( t.name ).arg( _layout ),
+			[filter]( sampleFrame * buf, int frames ) {
+				for( int f = 0; f < frames; ++f )
+				{
+					for( ch_cnt_t ch = 0; ch < CHANNELS; ++ch )
+					{
+						buf[f][ch] = filter->update( input[f][ch], ch );
+					}
+				}
+				consume( buf, frames ); } } );
+		if( CHANNELS == DEFAULT_CHANNELS )
+		{
+			_kernels.push_back( { QString( "BasicFilters::processBlock/%1" ).
+								arg( t.name ),
+				[filter]( sampleFrame * buf, int frames ) {
+					memcpy( buf, input, frames * sizeof( sampleFrame ) );
+					filter->processBlock( reinterpret_cast<
+						typename BasicFilters<CHANNELS>::frame *>( buf ),
+									frames );
+					consume( buf, frames ); } } );
+		}
+	}
+}
+
+
+
+
+static void addSampleBuffers( std::vector<Kernel> & _kernels )
+{
+	struct Mode
+	{
+		const char * name;
+		int mode;
+	} ;
+	const Mode modes[] = {
+		{ "zoh", SRC_ZERO_ORDER_HOLD },
+		{ "linear", SRC_LINEAR },
+		{ "sinc_fastest", SRC_SINC_FASTEST },
+		{ "sinc_medium", SRC_SINC_MEDIUM_QUALITY },
+		{ "sinc_best", SRC_SINC_BEST_QUALITY },
+		{ "polyphase", POLYPHASE_INTERPOLATION }
+	} ;
+
+	// ten seconds, looped so the kernels never run out of sample data
+	static const f_cnt_t length = 441000;
+	std::vector<sampleFrame> data( length );
+	fillNoise( data.data(), length );
+	auto sample = std::make_shared<SampleBuffer>( data.data(), length );
+
+	// unpitched playback doesn't resample at all
+	auto state = std::make_shared<SampleBuffer::handleState>();
+	_kernels.push_back( { "SampleBuffer::play/unpitched",
+		[sample, state]( sampleFrame * buf, int frames ) {
+			sample->play( buf, state.get(), frames, BaseFreq,
+						SampleBuffer::LoopOn );
+			consume( buf, frames ); } } );
+
+	for( const Mode & m : modes )
+	{
+		auto pitched = std::make_shared<SampleBuffer::handleState>(
+								true, m.mode );
+		_kernels.push_back( { QString( "SampleBuffer::play/%1" ).arg( m.name ),
+			[sample, pitched]( sampleFrame * buf, int frames ) {
+				// a fifth up
+				sample->play( buf, pitched.get(), frames,
+					BaseFreq * 1.5f, SampleBuffer::LoopOn );
+				consume( buf, frames ); } } );
+	}
+}
+
+
+
+
+int main( int argc, char * * argv )
+{
+	QCoreApplication app( argc, argv );
+
+	QRegExp filter;
+	double minTime = 0.1;
+	bool json = false;
+	const QStringList args = app.arguments().mid( 1 );
+	for( int i = 0; i < args.size(); ++i )
+	{
+		if( ( args[i] == "--filter" || args[i] == "-f" ) && i + 1 < args.size() )
+		{
+			filter = QRegExp( args[++i] );
+		}
+		else if( ( args[i] == "--min-time" || args[i] == "-t" ) && i + 1 < args.size() )
+		{
+			minTime = args[++i].toDouble();
+		}
+		else if( args[i] == "--json" )
+		{
+			json = true;
+		}
+		else
+		{
+			printf( "Usage: lmms-microbench [--filter <regex>] "
+				"[--min-time <seconds>] [--json]\n\n"
+				"Times DSP kernels for period sizes from 32 to %d "
+				"frames, each for at least\nthe given time (default "
+				"0.1 s).\n", MaxFrames );
+			return args[i] == "--help" || args[i] == "-h" ?
+						EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+
+	// needed for the wavetables and the sample rate, the audio thread is
+	// stopped again so it doesn't compete with the kernels
+	Engine::init( true );
+	Engine::mixer()->stopProcessing();
+
+	std::vector<Kernel> kernels;
+	addMixHelpers( kernels );
+	addOscillators( kernels );
+	addBandLimitedWaves( kernels );
+	addFilters<1>( kernels, "mono" );
+	addFilters<2>( kernels, "stereo" );
+	addSampleBuffers( kernels );
+
+	std::vector<sampleFrame> buffer( MaxFrames );
+	fillNoise( buffer.data(), MaxFrames );
+
+	if( !json )
+	{
+		printf( "%-60s %12s %12s %10s\n", "Benchmark",
+				"Time", "ns/frame", "Iterations" );
+	}
+	QJsonArray results;
+	for( const Kernel & kernel : kernels )
+	{
+		for( int frames = 32; frames <= MaxFrames; frames *= 2 )
+		{
+			const QString name = QString( "%1/%2" ).
+						arg( kernel.name ).arg( frames );
+			if( !filter.isEmpty() && filter.indexIn( name ) < 0 )
+			{
+				continue;
+			}
+
+			// warm up caches and let the kernel settle
+			for( int i = 0; i < 16; ++i )
+			{
+				kernel.run( buffer.data(), frames );
+			}
+
+			// double the batch until it takes long enough for the clock
+			typedef std::chrono::steady_clock Clock;
+			long iterations = 0;
+			long batch = 1;
+			double seconds = 0;
+			while( seconds < minTime )
+			{
+				const Clock::time_point start = Clock::now();
+				for( long i = 0; i < batch; ++i )
+				{
+					kernel.run( buffer.data(), frames );
+				}
+				seconds += std::chrono::duration<double>(
+						Clock::now() - start ).count();
+				iterations += batch;
+				batch *= 2;
+			}
+
+			const double ns = seconds * 1e9 / iterations;
+			if( json )
+			{
+				QJsonObject result;
+				result["name"] = name;
+				result["frames"] = frames;
+				result["iterations"] = (qint64) iterations;
+				result["ns_per_iteration"] = ns;
+				result["ns_per_frame"] = ns / frames;
+				results.append( result );
+			}
+			else
+			{
+				printf( "%-60s %9.0f ns %12.2f %10ld\n",
+						name.toUtf8().constData(),
+						ns, ns / frames, iterations );
+				fflush( stdout );
+			}
+		}
+	}
+
+	// some kernels hold objects which need the engine
+	kernels.clear();
+	Engine::destroy();
+
+	if( json )
+	{
+		QJsonObject report;
+		report["version"] = QString( LMMS_VERSION );
+		report["benchmarks"] = results;
+		const QByteArray out = QJsonDocument( report ).toJson();
+		fwrite( out.constData(), 1, out.size(), stdout );
+	}
+
+	return EXIT_SUCCESS;
+}
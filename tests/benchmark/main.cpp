@@ -0,0 +1,226 @@
+/*
+ * main.cpp - lmms-bench, renders projects offline as fast as possible and
+ *            reports how fast it went
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QStringList>
+
+#include <algorithm>
+#include <cstdio>
+
+#include "lmmsconfig.h"
+#include "lmmsversion.h"
+
+#ifdef LMMS_BUILD_WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "AudioFileNull.h"
+#include "Engine.h"
+#include "Mixer.h"
+#include "ProjectRenderer.h"
+#include "Song.h"
+
+
+// in kilobytes, -1 if unknown
+static long peakRss()
+{
+#ifdef LMMS_BUILD_WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if( GetProcessMemoryInfo( GetCurrentProcess(), &counters,
+						sizeof( counters ) ) )
+	{
+		return counters.PeakWorkingSetSize / 1024;
+	}
+	return -1;
+#else
+	struct rusage usage;
+	if( getrusage( RUSAGE_SELF, &usage ) != 0 )
+	{
+		return -1;
+	}
+#ifdef LMMS_BUILD_APPLE
+	// bytes on macOS, kilobytes everywhere else
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+#endif
+}
+
+
+
+
+static int percentile( const std::vector<int> & _sorted, int _percent )
+{
+	if( _sorted.empty() )
+	{
+		return 0;
+	}
+	const size_t index = _sorted.size() * _percent / 100;
+	return _sorted[std::min( index, _sorted.size() - 1 )];
+}
+
+
+
+
+static QJsonObject benchmark( const QString & _project,
+				const Mixer::qualitySettings & _qs,
+				const OutputSettings & _os )
+{
+	QJsonObject result;
+	result["project"] = QFileInfo( _project ).fileName();
+
+	Engine::getSong()->loadProject( _project );
+	if( Engine::getSong()->isEmpty() )
+	{
+		result["error"] = QString( "project is empty or could not be loaded" );
+		return result;
+	}
+
+	// the mixer takes ownership of the device
+	AudioFileNull * device = new AudioFileNull( _os, Engine::mixer() );
+	ProjectRenderer renderer( _qs, device );
+
+	QElapsedTimer timer;
+	timer.start();
+	renderer.startProcessing();
+	renderer.wait();
+	const double seconds = timer.elapsed() / 1000.0;
+
+	std::vector<int> periods = device->periodTimes();
+	std::sort( periods.begin(), periods.end() );
+
+	const double audioSeconds = (double) device->frames() /
+					Engine::mixer()->processingSampleRate();
+
+	result["frames"] = device->frames();
+	result["seconds"] = seconds;
+	result["frames_per_second"] = seconds > 0 ? device->frames() / seconds : 0;
+	result["realtime_factor"] = seconds > 0 ? audioSeconds / seconds : 0;
+	result["periods"] = (int) periods.size();
+	result["period_us_p50"] = percentile( periods, 50 );
+	result["period_us_p99"] = percentile( periods, 99 );
+	result["period_us_max"] = periods.empty() ? 0 : periods.back();
+	// of the whole process so far - pass a single project per run for
+	// exact numbers
+	result["peak_rss_kb"] = (qint64) peakRss();
+
+	return result;
+}
+
+
+
+
+int main( int argc, char * * argv )
+{
+	QCoreApplication app( argc, argv );
+
+	QStringList projects;
+	QString outputFile;
+	const QStringList args = app.arguments().mid( 1 );
+	for( int i = 0; i < args.size(); ++i )
+	{
+		if( ( args[i] == "--output" || args[i] == "-o" ) && i + 1 < args.size() )
+		{
+			outputFile = args[++i];
+		}
+		else if( args[i] == "--help" || args[i] == "-h" )
+		{
+			printf( "Usage: lmms-bench [-o <file>] [project...]\n\n"
+				"Renders the given projects (by default the bundled "
+				"stress projects) offline\nwithout writing any audio "
+				"and prints the results as JSON.\n" );
+			return EXIT_SUCCESS;
+		}
+		else
+		{
+			projects << args[i];
+		}
+	}
+
+	if( projects.isEmpty() )
+	{
+		const QDir dir( LMMS_BENCH_PROJECTS_DIR );
+		for( const QString & f : dir.entryList( QStringList( "*.mmpz" ),
+						QDir::Files, QDir::Name ) )
+		{
+			projects << dir.filePath( f );
+		}
+	}
+
+	Engine::init( true );
+
+	// same settings as rendering from the command line by default
+	const Mixer::qualitySettings qs( Mixer::qualitySettings::Mode_HighQuality );
+	const OutputSettings os( 44100,
+			OutputSettings::BitRateSettings( 160, false ),
+			OutputSettings::Depth_16Bit,
+			OutputSettings::StereoMode_JointStereo );
+
+	QJsonArray results;
+	bool failed = false;
+	for( const QString & project : projects )
+	{
+		fprintf( stderr, "Rendering %s...\n", project.toUtf8().constData() );
+		const QJsonObject result = benchmark( project, qs, os );
+		failed |= result.contains( "error" );
+		results.append( result );
+	}
+
+	QJsonObject report;
+	report["version"] = QString( LMMS_VERSION );
+	report["sample_rate"] = (int) Engine::mixer()->processingSampleRate();
+	report["frames_per_period"] = Engine::mixer()->framesPerPeriod();
+	report["projects"] = results;
+
+	Engine::destroy();
+
+	const QByteArray json = QJsonDocument( report ).toJson();
+	if( outputFile.isEmpty() )
+	{
+		fwrite( json.constData(), 1, json.size(), stdout );
+	}
+	else
+	{
+		QFile file( outputFile );
+		if( !file.open( QFile::WriteOnly | QFile::Truncate ) ||
+					file.write( json ) != json.size() )
+		{
+			fprintf( stderr, "Could not write %s\n",
+					outputFile.toUtf8().constData() );
+			return EXIT_FAILURE;
+		}
+	}
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,100 @@
+/*
+ * AudioFileHash.h - file device which discards the audio but hashes it
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef AUDIO_FILE_HASH_H
+#define AUDIO_FILE_HASH_H
+
+#include <QtCore/QProcess>
+
+#include <cmath>
+#include <cstring>
+
+#include "AudioFileDevice.h"
+
+
+//! Hashes the rendered float samples including master gain with 64 bit
+//! FNV-1a. With a tolerance > 0 each sample is rounded to a multiple of it
+//! first, so tiny differences e.g. from reordered additions don't change
+//! the hash - differences close to a rounding boundary still do.
+class AudioFileHash : public AudioFileDevice
+{
+public:
+	AudioFileHash( OutputSettings const & outputSettings, Mixer * mixer,
+							double tolerance ) :
+		AudioFileDevice( outputSettings, DEFAULT_CHANNELS,
+					QProcess::nullDevice(), mixer ),
+		m_tolerance( tolerance ),
+		m_hash( 14695981039346656037ULL ),
+		m_frames( 0 )
+	{
+	}
+
+	quint64 hash() const
+	{
+		return m_hash;
+	}
+
+	f_cnt_t frames() const
+	{
+		return m_frames;
+	}
+
+
+private:
+	void writeBuffer( const surroundSampleFrame * _ab, const fpp_t _frames,
+					const float _master_gain ) override
+	{
+		for( fpp_t f = 0; f < _frames; ++f )
+		{
+			for( ch_cnt_t ch = 0; ch < channels(); ++ch )
+			{
+				const float sample = _ab[f][ch] * _master_gain;
+				qint64 value;
+				if( m_tolerance > 0 )
+				{
+					value = llround( sample / m_tolerance );
+				}
+				else
+				{
+					// the bits, so even -0.0 and NaN count
+					quint32 bits;
+					memcpy( &bits, &sample, sizeof( bits ) );
+					value = bits;
+				}
+				for( int byte = 0; byte < 8; ++byte )
+				{
+					m_hash = ( m_hash ^ ( ( value >> ( byte * 8 ) ) & 0xff ) ) *
+								1099511628211ULL;
+				}
+			}
+		}
+		m_frames += _frames;
+	}
+
+	const double m_tolerance;
+	quint64 m_hash;
+	f_cnt_t m_frames;
+
+} ;
+
+
+#endif
@@ -0,0 +1,315 @@
+/*
+ * main.cpp - lmms-regression, renders a corpus of projects and checks that
+ *            neither their output nor their render time changed
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QProcess>
+#include <QtCore/QStringList>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "AudioFileHash.h"
+#include "Engine.h"
+#include "Mixer.h"
+#include "ProjectRenderer.h"
+#include "Song.h"
+
+
+// what is compared, rendering has to match these for the hash to mean
+// anything
+static const sample_rate_t SampleRate = 44100;
+
+// a render taking longer than this has hung
+static const int TimeoutMs = 10 * 60 * 1000;
+
+
+
+
+// Renders a single project in this process and prints the result as one
+// line of JSON. Each project gets a process of its own so random number
+// generators and plugin state start the same no matter which projects were
+// rendered before.
+static int renderOne( const QString & _project, double _tolerance )
+{
+	srand( 1 );
+	Engine::init( true );
+
+	QJsonObject result;
+	Engine::getSong()->loadProject( _project );
+	if( Engine::getSong()->isEmpty() )
+	{
+		result["error"] = QString( "project is empty or could not be loaded" );
+	}
+	else
+	{
+		const Mixer::qualitySettings qs(
+				Mixer::qualitySettings::Mode_HighQuality );
+		const OutputSettings os( SampleRate,
+				OutputSettings::BitRateSettings( 160, false ),
+				OutputSettings::Depth_32Bit,
+				OutputSettings::StereoMode_Stereo );
+
+		// the mixer takes ownership of the device
+		AudioFileHash * device = new AudioFileHash( os, Engine::mixer(),
+								_tolerance );
+		ProjectRenderer renderer( qs, device );
+
+		QElapsedTimer timer;
+		timer.start();
+		renderer.startProcessing();
+		renderer.wait();
+
+		result["seconds"] = timer.elapsed() / 1000.0;
+		result["hash"] = QString::number( device->hash(), 16 );
+		result["frames"] = device->frames();
+		result["sample_rate"] = (int) Engine::mixer()->processingSampleRate();
+		result["frames_per_period"] = Engine::mixer()->framesPerPeriod();
+	}
+
+	Engine::destroy();
+
+	// plugins may print to stdout as well, the result is the last line
+	printf( "\n%s\n", QJsonDocument( result ).toJson(
+					QJsonDocument::Compact ).constData() );
+	return result.contains( "error" ) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+
+
+
+static QString expectationFile( const QString & _project )
+{
+	const QFileInfo info( _project );
+	return info.dir().filePath( info.completeBaseName() + ".expected.json" );
+}
+
+
+
+
+static QJsonObject readJson( const QString & _file )
+{
+	QFile file( _file );
+	if( !file.open( QFile::ReadOnly ) )
+	{
+		return QJsonObject();
+	}
+	return QJsonDocument::fromJson( file.readAll() ).object();
+}
+
+
+
+
+static bool writeJson( const QString & _file, const QJsonObject & _object )
+{
+	QFile file( _file );
+	const QByteArray json = QJsonDocument( _object ).toJson();
+	return file.open( QFile::WriteOnly | QFile::Truncate ) &&
+					file.write( json ) == json.size();
+}
+
+
+
+
+static QJsonObject render( const QString & _project, double _tolerance )
+{
+	QProcess process;
+	process.setProcessChannelMode( QProcess::ForwardedErrorChannel );
+	process.start( QCoreApplication::applicationFilePath(),
+			QStringList() << "--render-one" << _project <<
+					QString::number( _tolerance, 'g', 17 ) );
+	if( !process.waitForFinished( TimeoutMs ) )
+	{
+		process.kill();
+		process.waitForFinished();
+		QJsonObject result;
+		result["error"] = QString( "render crashed or timed out" );
+		return result;
+	}
+
+	const QList<QByteArray> lines = process.readAllStandardOutput().
+						trimmed().split( '\n' );
+	const QJsonObject result = QJsonDocument::fromJson( lines.last() ).object();
+	if( result.isEmpty() )
+	{
+		QJsonObject error;
+		error["error"] = QString( "render crashed" );
+		return error;
+	}
+	return result;
+}
+
+
+
+
+int main( int argc, char * * argv )
+{
+	QCoreApplication app( argc, argv );
+
+	QStringList projects;
+	bool update = false;
+	double budgetScale = 1;
+	double tolerance = 0;
+	const QStringList args = app.arguments().mid( 1 );
+	for( int i = 0; i < args.size(); ++i )
+	{
+		if( args[i] == "--render-one" && i + 2 < args.size() )
+		{
+			return renderOne( args[i + 1], args[i + 2].toDouble() );
+		}
+		else if( args[i] == "--update" )
+		{
+			update = true;
+		}
+		else if( args[i] == "--budget-scale" && i + 1 < args.size() )
+		{
+			budgetScale = args[++i].toDouble();
+		}
+		else if( args[i] == "--tolerance" && i + 1 < args.size() )
+		{
+			tolerance = args[++i].toDouble();
+		}
+		else if( args[i] == "--help" || args[i] == "-h" )
+		{
+			printf( "Usage: lmms-regression [--update] [--budget-scale <factor>]\n"
+				"                      [--tolerance <step>] [project...]\n\n"
+				"Renders the given projects (by default the bundled "
+				"corpus) at %d Hz and compares\nthe hash of the output "
+				"and the render time with <project>.expected.json.\n\n"
+				"  --update                Record the hashes of the "
+				"current output, and a budget\n"
+				"                          of twice the render time "
+				"where there is none yet\n"
+				"  --budget-scale <factor> Multiply the budgets, for "
+				"slower machines\n"
+				"  --tolerance <step>      Round samples to multiples "
+				"of <step> before hashing,\n"
+				"                          for newly recorded "
+				"expectations\n",
+				(int) SampleRate );
+			return EXIT_SUCCESS;
+		}
+		else
+		{
+			projects << args[i];
+		}
+	}
+
+	if( projects.isEmpty() )
+	{
+		const QDir dir( LMMS_REGRESSION_PROJECTS_DIR );
+		for( const QString & f : dir.entryList( QStringList( "*.mmpz" ),
+						QDir::Files, QDir::Name ) )
+		{
+			projects << dir.filePath( f );
+		}
+	}
+
+	int failures = 0;
+	for( const QString & project : projects )
+	{
+		const QString name = QFileInfo( project ).completeBaseName();
+		const QString file = expectationFile( project );
+		QJsonObject expected = readJson( file );
+		const bool known = expected.contains( "hash" );
+		const double projectTolerance = known ?
+			expected["tolerance"].toDouble() : tolerance;
+
+		const QJsonObject result = render( project, projectTolerance );
+		if( result.contains( "error" ) )
+		{
+			printf( "FAIL %s: %s\n", name.toUtf8().constData(),
+				result["error"].toString().toUtf8().constData() );
+			++failures;
+			continue;
+		}
+
+		const double seconds = result["seconds"].toDouble();
+		const double budget = expected["budget_seconds"].toDouble() *
+								budgetScale;
+
+		QStringList problems;
+		if( known && ( expected["hash"] != result["hash"] ||
+				expected["frames"] != result["frames"] ||
+				expected["sample_rate"] != result["sample_rate"] ||
+				expected["frames_per_period"] !=
+					result["frames_per_period"] ) )
+		{
+			problems << "output changed";
+		}
+		if( budget > 0 && seconds > budget )
+		{
+			problems << QString( "took %1 s, budget is %2 s" ).
+					arg( seconds, 0, 'f', 2 ).arg( budget, 0, 'f', 2 );
+		}
+
+		if( update )
+		{
+			for( const char * key : { "hash", "frames", "sample_rate",
+							"frames_per_period" } )
+			{
+				expected[key] = result[key];
+			}
+			expected["tolerance"] = projectTolerance;
+			// budgets are only ever changed by hand
+			if( !expected.contains( "budget_seconds" ) )
+			{
+				expected["budget_seconds"] = ceil( seconds * 20 ) / 10;
+			}
+			if( !writeJson( file, expected ) )
+			{
+				problems << "could not write " + file;
+			}
+			problems.removeAll( "output changed" );
+		}
+
+		if( !problems.isEmpty() )
+		{
+			printf( "FAIL %s: %s\n", name.toUtf8().constData(),
+				problems.join( ", " ).toUtf8().constData() );
+			++failures;
+		}
+		else if( !known && !update )
+		{
+			printf( "NEW  %s: %.2f s, no expectation yet "
+						"(record one with --update)\n",
+					name.toUtf8().constData(), seconds );
+		}
+		else
+		{
+			printf( "%s %s: %.2f s\n", known ? "PASS" : "REC ",
+					name.toUtf8().constData(), seconds );
+		}
+		fflush( stdout );
+	}
+
+	printf( "\n%d of %d projects failed\n", failures, (int) projects.size() );
+
+	return failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+/*
+ * AudioTapTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+#include "QTestSuite.h"
+
+#include "AudioTap.h"
+
+class AudioTapTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void LatestFramesTests()
+	{
+		AudioTap tap;
+		sampleFrame frames[4];
+		for (int f = 0; f < 4; ++f)
+		{
+			frames[f][0] = f;
+			frames[f][1] = -f;
+		}
+
+		// nothing is written without readers
+		QVERIFY(!tap.isActive());
+		tap.addReader();
+		QVERIFY(tap.isActive());
+
+		tap.write(frames, 4);
+		sampleFrame latest[2];
+		tap.latest(latest, 2);
+		QCOMPARE(latest[0][0], 2.f);
+		QCOMPARE(latest[1][0], 3.f);
+		QCOMPARE(latest[1][1], -3.f);
+		QCOMPARE(tap.framesReceived(), f_cnt_t(4));
+
+		// every view gets the latest frames, not just the first one
+		tap.latest(latest, 2);
+		QCOMPARE(latest[1][0], 3.f);
+
+		tap.write(nullptr, 1);
+		tap.latest(latest, 2);
+		QCOMPARE(latest[0][0], 3.f);
+		QCOMPARE(latest[1][0], 0.f);
+		QCOMPARE(tap.framesReceived(), f_cnt_t(5));
+
+		// starting over once everyone stopped looking
+		tap.removeReader();
+		QVERIFY(!tap.isActive());
+		tap.addReader();
+		QCOMPARE(tap.framesReceived(), f_cnt_t(0));
+	}
+} AudioTapTests;
+
+#include "AudioTapTest.moc"
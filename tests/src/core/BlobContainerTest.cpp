@@ -0,0 +1,84 @@
+/*
+ * BlobContainerTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include <QDomDocument>
+#include <QTemporaryDir>
+
+#include "BlobContainer.h"
+
+class BlobContainerTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void RoundTripTests()
+	{
+		QTemporaryDir dir;
+		const QString file = dir.filePath("project.mmpb");
+		const QByteArray sample(10000, 'x');
+
+		QDomDocument doc;
+		QDomElement root = doc.createElement("lmms-project");
+		doc.appendChild(root);
+		QDomElement track = doc.createElement("sampletco");
+		track.setAttribute("data", QString(sample.toBase64()));
+		track.setAttribute("name", "short");
+		root.appendChild(track);
+
+		{
+			QList<QByteArray> blobs;
+			const QList<BlobContainer::Replacement> replacements =
+				BlobContainer::replaceAttributes(root, &blobs);
+			QCOMPARE(blobs.size(), 1);
+			QCOMPARE(blobs[0], sample);
+			const QByteArray xml = doc.toByteArray();
+			BlobContainer::restore(replacements);
+			QCOMPARE(track.attribute("data"), QString(sample.toBase64()));
+
+			QFile out(file);
+			QVERIFY(out.open(QIODevice::WriteOnly));
+			QVERIFY(BlobContainer::write(out, xml, blobs));
+		}
+
+		QString reference;
+		{
+			BlobContainer container(file);
+			QVERIFY(container.isValid());
+			QDomDocument loaded;
+			QVERIFY(loaded.setContent(container.xml()));
+			container.adoptReferences(loaded.documentElement());
+
+			const QDomElement el =
+				loaded.documentElement().firstChildElement();
+			QCOMPARE(el.attribute("name"), QString("short"));
+			reference = el.attribute("data");
+			QVERIFY(BlobContainer::isReference(reference));
+			QCOMPARE(BlobContainer::data(reference), sample);
+		}
+
+		// closed along with the container
+		QVERIFY(BlobContainer::data(reference).isEmpty());
+	}
+} BlobContainerTests;
+
+#include "BlobContainerTest.moc"
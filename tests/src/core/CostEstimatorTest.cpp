@@ -0,0 +1,56 @@
+/*
+ * CostEstimatorTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include "CostEstimator.h"
+
+#include <cmath>
+
+class CostEstimatorTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void LoadTests()
+	{
+		const sample_rate_t sampleRate = 44100;
+		const float period = 256 * 1000000.0f / sampleRate;
+
+		// the longest job decides once there are enough cores
+		QVERIFY(fabsf(CostEstimator::load(8000, 3000, 200, 256, 256, 4, sampleRate) -
+				3200 / period) < 1e-4f);
+		// the jobs add up on a single core
+		QVERIFY(fabsf(CostEstimator::load(8000, 3000, 200, 256, 256, 1, sampleRate) -
+				8200 / period) < 1e-4f);
+
+		// the jobs take as long per frame, the overhead per period weighs
+		// more with shorter periods
+		const float shorter = CostEstimator::load(8000, 3000, 200, 256, 128, 4, sampleRate);
+		const float longer = CostEstimator::load(8000, 3000, 200, 256, 512, 4, sampleRate);
+		QVERIFY(fabsf(shorter - 1700 / (period / 2)) < 1e-4f);
+		QVERIFY(shorter > longer);
+		QVERIFY(fabsf(CostEstimator::load(8000, 3000, 0, 256, 128, 4, sampleRate) -
+				CostEstimator::load(8000, 3000, 0, 256, 512, 4, sampleRate)) < 1e-4f);
+	}
+} CostEstimatorTests;
+
+#include "CostEstimatorTest.moc"
@@ -0,0 +1,71 @@
+/*
+ * DecimatorTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include "Decimator.h"
+#include "lmms_constants.h"
+
+#include <cmath>
+
+class DecimatorTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void GainTests()
+	{
+		// DC passes unchanged, a tone that would alias into the band
+		// of the output is removed
+		for (int factor : {2, 4, 8})
+		{
+			Decimator decimator(factor, Decimator::Balanced);
+			QCOMPARE(decimator.factor(), factor);
+
+			surroundSampleFrame in[256];
+			surroundSampleFrame out[128];
+			float peak = 0.0f;
+			for (int period = 0; period < 8; ++period)
+			{
+				for (int f = 0; f < 256; ++f)
+				{
+					const int frame = period * 256 + f;
+					in[f][0] = 1.0f;
+					// at 0.7 times the output rate
+					in[f][1] = sinf(2.0f * F_PI * 0.7f * frame / factor);
+				}
+				QCOMPARE(decimator.process(in, 256, out), 256 / factor);
+				if (period < 4)
+				{
+					continue;
+				}
+				for (int f = 0; f < 256 / factor; ++f)
+				{
+					QVERIFY(fabsf(out[f][0] - 1.0f) < 1e-4f);
+					peak = qMax(peak, fabsf(out[f][1]));
+				}
+			}
+			QVERIFY(peak < 1e-3f);
+		}
+	}
+} DecimatorTests;
+
+#include "DecimatorTest.moc"
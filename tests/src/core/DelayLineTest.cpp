@@ -0,0 +1,68 @@
+/*
+ * DelayLineTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+
+#include "QTestSuite.h"
+
+#include "DelayLine.h"
+
+#include <algorithm>
+
+class DelayLineTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void FractionalReadTests()
+	{
+		DelayLine line(100);
+		sample_t ramp[64];
+		for (int f = 0; f < 64; ++f)
+		{
+			ramp[f] = f;
+		}
+		line.write(ramp, 64);
+
+		sample_t out[64];
+		line.read(out, 10.5f, 64);
+		QCOMPARE(out[40], 29.5f);
+		line.read(out, 10.5f, 64, DelayLine::Cubic);
+		QCOMPARE(out[40], 29.5f);
+	}
+
+	void FeedbackTests()
+	{
+		// delays shorter than the block feed back within it
+		DelayLine line(100);
+		sample_t buf[64] = { 1.0f };
+		float delays[64];
+		std::fill(delays, delays + 64, 4.0f);
+		line.process(buf, delays, 0.5f, 64);
+		QCOMPARE(buf[3], 0.0f);
+		QCOMPARE(buf[4], 1.0f);
+		QCOMPARE(buf[8], 0.5f);
+		QCOMPARE(buf[12], 0.25f);
+	}
+} DelayLineTests;
+
+#include "DelayLineTest.moc"
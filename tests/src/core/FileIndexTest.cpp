@@ -0,0 +1,49 @@
+/*
+ * FileIndexTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include "FileIndex.h"
+
+class FileIndexTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void FindTests()
+	{
+		FileIndex index;
+		index.add("drums/kicks/Kick01.wav");
+		index.add("drums/snares/Snare01.wav");
+		index.add("kicks/bass.ogg");
+		index.add("basses/kickbass.wav");
+
+		QCOMPARE(index.find("KICK"), QVector<int>({0, 3}));
+		QCOMPARE(index.find("01.wav"), QVector<int>({0, 1}));
+		// only the file names, not their directories
+		QCOMPARE(index.find("snares"), QVector<int>());
+		QCOMPARE(index.find("ss"), QVector<int>({2, 3}));
+		QCOMPARE(index.find("xyz"), QVector<int>());
+		QCOMPARE(index.path(2), QString("kicks/bass.ogg"));
+	}
+} FileIndexTests;
+
+#include "FileIndexTest.moc"
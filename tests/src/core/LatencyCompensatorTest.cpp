@@ -0,0 +1,62 @@
+/*
+ * LatencyCompensatorTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include "LatencyCompensator.h"
+
+#include <algorithm>
+
+class LatencyCompensatorTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void DelayAndTailTests()
+	{
+		// a delay longer than a period comes out in the next one and
+		// keeps the tail going until it passed
+		LatencyCompensator compensator;
+		compensator.setDelay(300);
+		sampleFrame buf[256];
+		for (int f = 0; f < 256; ++f)
+		{
+			buf[f][0] = f + 1;
+			buf[f][1] = -(f + 1);
+		}
+		compensator.process(buf, 256, false);
+		QCOMPARE(buf[255][0], 0.0f);
+
+		std::fill(buf[0], buf[0] + 2 * 256, 0.0f);
+		compensator.process(buf, 256, true);
+		QCOMPARE(buf[43][0], 0.0f);
+		QCOMPARE(buf[44][0], 1.0f);
+		QCOMPARE(buf[44][1], -1.0f);
+		QVERIFY(compensator.hasTail());
+
+		std::fill(buf[0], buf[0] + 2 * 256, 0.0f);
+		compensator.process(buf, 256, true);
+		QCOMPARE(buf[43][0], 256.0f);
+		QVERIFY(!compensator.hasTail());
+	}
+} LatencyCompensatorTests;
+
+#include "LatencyCompensatorTest.moc"
@@ -0,0 +1,65 @@
+/*
+ * LevelDetectorTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+
+#include "QTestSuite.h"
+
+#include "LevelDetector.h"
+
+class LevelDetectorTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void LookaheadTests()
+	{
+		// an attack this fast jumps to the level right away
+		LevelDetector detector(0.001f, 10.0f);
+		detector.setAttack(1000000.0f);
+		detector.setLookahead(4);
+
+		sample_t buf[16] = { 0 };
+		buf[8] = 1.0f;
+		float levels[16];
+		detector.process(buf, levels, 16);
+		QCOMPARE(levels[4], 0.001f);
+		QCOMPARE(levels[8], 1.0f);
+		QCOMPARE(buf[8], 0.0f);
+		QCOMPARE(buf[12], 1.0f);
+	}
+
+	void CurveGainsTests()
+	{
+		// output levels for the inputs 0.5 and 1
+		const float curve[2] = { 0.25f, 0.5f };
+		const float levels[4] = { 0.0f, 0.25f, 0.5f, 2.0f };
+		float gains[4];
+		LevelDetector::curveGains(curve, 2, 2.0f, 0.0f, levels, gains, 4);
+		QCOMPARE(gains[0], 1.0f);
+		QCOMPARE(gains[1], 0.5f);
+		QCOMPARE(gains[2], 0.5f);
+		QCOMPARE(gains[3], 0.25f);
+	}
+} LevelDetectorTests;
+
+#include "LevelDetectorTest.moc"
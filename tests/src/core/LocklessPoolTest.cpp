@@ -0,0 +1,83 @@
+/*
+ * LocklessPoolTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include <set>
+#include <vector>
+
+#include "LocklessList.h"
+#include "LocklessPool.h"
+
+class LocklessPoolTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void GrowingTests()
+	{
+		MemoryManager::ThreadGuard guard;
+		LocklessPool<int> pool(32);
+
+		// far more than fits into the first allocator
+		std::vector<int*> elements;
+		for (int i = 0; i < 1000; ++i)
+		{
+			int* element = pool.alloc();
+			QVERIFY(element != nullptr);
+			*element = i;
+			elements.push_back(element);
+		}
+		QCOMPARE(std::set<int*>(elements.begin(), elements.end()).size(), elements.size());
+		for (int i = 0; i < 1000; ++i)
+		{
+			QCOMPARE(*elements[i], i);
+			pool.free(elements[i]);
+		}
+
+		// freed elements are used again
+		int* element = pool.alloc();
+		QVERIFY(element != nullptr);
+		pool.free(element);
+	}
+
+	void ListTests()
+	{
+		MemoryManager::ThreadGuard guard;
+		LocklessList<int> list(4);
+		for (int i = 0; i < 100; ++i)
+		{
+			list.push(i);
+		}
+
+		int expected = 99;
+		for (LocklessList<int>::Element* e = list.popList(); e;)
+		{
+			QCOMPARE(e->value, expected--);
+			LocklessList<int>::Element* next = e->next;
+			list.free(e);
+			e = next;
+		}
+		QCOMPARE(expected, -1);
+	}
+} LocklessPoolTests;
+
+#include "LocklessPoolTest.moc"
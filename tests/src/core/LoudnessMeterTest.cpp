@@ -0,0 +1,76 @@
+/*
+ * LoudnessMeterTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+#include "QTestSuite.h"
+
+#include <cmath>
+
+#include "LoudnessMeter.h"
+#include "lmms_constants.h"
+
+class LoudnessMeterTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	//! A stereo sine of 1 kHz at -23 dBFS reads -23 LUFS, see EBU Tech 3341
+	void SineLoudnessTests()
+	{
+		const int sampleRate = 48000;
+		const int frames = 256;
+		const float amplitude = powf(10.f, -23.f / 20.f);
+
+		LoudnessMeter meter;
+		QVERIFY(!meter.isWanted());
+		meter.levels();
+		QVERIFY(meter.isWanted());
+
+		sampleFrame buf[frames];
+		int frame = 0;
+		// three seconds, to fill the short-term window
+		for (int period = 0; period < 3 * sampleRate / frames; ++period)
+		{
+			for (int f = 0; f < frames; ++f, ++frame)
+			{
+				buf[f][0] = buf[f][1] = amplitude *
+					sinf(F_2PI * 1000.f * frame / sampleRate);
+			}
+			meter.levels();
+			meter.process(buf, frames, 1.f, amplitude, amplitude, sampleRate);
+		}
+
+		const LoudnessMeter::Levels & levels = meter.levels();
+		QVERIFY(fabsf(levels.momentary + 23.f) < 0.1f);
+		QVERIFY(fabsf(levels.shortTerm + 23.f) < 0.1f);
+		QVERIFY(fabsf(LoudnessMeter::toDbfs(levels.rms[0]) + 26.01f) < 0.1f);
+		QVERIFY(levels.truePeak[1] >= amplitude);
+		QVERIFY(levels.truePeak[1] < amplitude * 1.01f);
+
+		// silence is as quiet as it gets
+		LoudnessMeter silent;
+		silent.levels();
+		silent.process(nullptr, frames, 1.f, 0.f, 0.f, sampleRate);
+		QCOMPARE(silent.levels().momentary, LoudnessMeter::Silence);
+	}
+} LoudnessMeterTests;
+
+#include "LoudnessMeterTest.moc"
@@ -0,0 +1,61 @@
+/*
+ * MemoryManagerTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include "MemoryManager.h"
+#include "ValueBuffer.h"
+
+class MemoryManagerTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void TaggedAllocationTests()
+	{
+		MemoryManager::ThreadGuard guard;
+		const MemoryManager::Usage before = MemoryManager::usage(MemoryManager::SampleBuffers);
+
+		float* data = MM_ALLOC_TAGGED(float, 1000, SampleBuffers);
+		MemoryManager::Usage during = MemoryManager::usage(MemoryManager::SampleBuffers);
+		QCOMPARE(during.bytes, before.bytes + 1000 * sizeof(float));
+		QCOMPARE(during.allocations, before.allocations + 1);
+
+		MM_FREE(data);
+		MemoryManager::Usage after = MemoryManager::usage(MemoryManager::SampleBuffers);
+		QCOMPARE(after.bytes, before.bytes);
+		QCOMPARE(after.allocations, before.allocations);
+	}
+
+	void ValueBufferTests()
+	{
+		MemoryManager::ThreadGuard guard;
+		const size_t before = MemoryManager::usage(MemoryManager::ValueBuffers).bytes;
+		{
+			ValueBuffer buffer(256);
+			QVERIFY(MemoryManager::usage(MemoryManager::ValueBuffers).bytes >=
+					before + 256 * sizeof(float));
+		}
+		QCOMPARE(MemoryManager::usage(MemoryManager::ValueBuffers).bytes, before);
+	}
+} MemoryManagerTests;
+
+#include "MemoryManagerTest.moc"
@@ -0,0 +1,192 @@
+/*
+ * MixHelpersTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "MixHelpers.h"
+
+class MixHelpersTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void SimdMatchesScalarTests()
+	{
+		if (!MixHelpers::detectedSimdKernels())
+		{
+			QSKIP("No vectorized kernels for this CPU");
+		}
+		const bool nanHandler = MixHelpers::useNaNHandler();
+		MixHelpers::setNaNHandler(true);
+
+		// odd lengths leave samples for the scalar tails
+		for (int frames = 0; frames < 40; ++frames)
+		{
+			sampleFrame src[40];
+			sampleFrame simd[40];
+			sampleFrame scalar[40];
+			for (int f = 0; f < frames; ++f)
+			{
+				src[f][0] = (f * 37 % 200 - 100) / 7.0f;
+				src[f][1] = (f * 53 % 200 - 100) / 3.0f;
+				simd[f][0] = scalar[f][0] = f / 40.0f;
+				simd[f][1] = scalar[f][1] = -f / 40.0f;
+			}
+			if (frames > 4)
+			{
+				src[frames / 2][1] = NAN;
+				src[1][0] = INFINITY;
+			}
+
+			MixHelpers::setSimdEnabled(true);
+			MixHelpers::add(simd, src, frames);
+			MixHelpers::addSanitizedMultiplied(simd, src, 0.3f, frames);
+			MixHelpers::setSimdEnabled(false);
+			MixHelpers::add(scalar, src, frames);
+			MixHelpers::addSanitizedMultiplied(scalar, src, 0.3f, frames);
+			QVERIFY(memcmp(simd, scalar, frames * sizeof(sampleFrame)) == 0);
+
+			float simdPeaks[2], scalarPeaks[2];
+			MixHelpers::setSimdEnabled(true);
+			MixHelpers::peak(simd, frames, simdPeaks[0], simdPeaks[1]);
+			MixHelpers::setSimdEnabled(false);
+			MixHelpers::peak(scalar, frames, scalarPeaks[0], scalarPeaks[1]);
+			QCOMPARE(simdPeaks[0], scalarPeaks[0]);
+			QCOMPARE(simdPeaks[1], scalarPeaks[1]);
+
+			MixHelpers::setSimdEnabled(true);
+			const bool simdFound = MixHelpers::sanitize(simd, frames);
+			const bool simdSilent = MixHelpers::isSilent(simd, frames);
+			MixHelpers::setSimdEnabled(false);
+			QCOMPARE(simdFound, MixHelpers::sanitize(scalar, frames));
+			QCOMPARE(simdSilent, MixHelpers::isSilent(scalar, frames));
+			QVERIFY(memcmp(simd, scalar, frames * sizeof(sampleFrame)) == 0);
+
+			float volume[40];
+			float panning[40];
+			for (int f = 0; f < frames; ++f)
+			{
+				volume[f] = f * 5;
+				panning[f] = f * 5 - 100;
+			}
+			sampleFrame simdGains[40];
+			sampleFrame scalarGains[40];
+			const sampleFrame* sources[] = { src, scalar };
+			MixHelpers::setSimdEnabled(true);
+			MixHelpers::stereoGains(simdGains, volume, 0.0f, panning, 0.0f, frames);
+			MixHelpers::sumMultipliedByGains(simd, sources, 2, simdGains, frames);
+			MixHelpers::setSimdEnabled(false);
+			MixHelpers::stereoGains(scalarGains, volume, 0.0f, panning, 0.0f, frames);
+			QVERIFY(memcmp(simdGains, scalarGains, frames * sizeof(sampleFrame)) == 0);
+			MixHelpers::sumMultipliedByGains(scalarGains, sources, 2, scalarGains, frames);
+			QVERIFY(memcmp(simd, scalarGains, frames * sizeof(sampleFrame)) == 0);
+
+			memcpy(simd, src, frames * sizeof(sampleFrame));
+			memcpy(scalar, src, frames * sizeof(sampleFrame));
+			MixHelpers::setSimdEnabled(true);
+			const bool simdCleared = MixHelpers::sanitizeAndPeak(simd, frames, simdPeaks[0], simdPeaks[1]);
+			MixHelpers::setSimdEnabled(false);
+			QCOMPARE(simdCleared, MixHelpers::sanitizeAndPeak(scalar, frames, scalarPeaks[0], scalarPeaks[1]));
+			QCOMPARE(simdPeaks[0], scalarPeaks[0]);
+			QCOMPARE(simdPeaks[1], scalarPeaks[1]);
+			QVERIFY(memcmp(simd, scalar, frames * sizeof(sampleFrame)) == 0);
+
+			// the squares are summed up in another order, and the
+			// compiler may fuse the multiplications with the additions
+			for (int f = 0; f < frames; ++f)
+			{
+				simd[f][0] = scalar[f][0] = f / 40.0f;
+				simd[f][1] = scalar[f][1] = -f / 20.0f;
+			}
+			MixHelpers::setSimdEnabled(true);
+			const double simdSquares = MixHelpers::mixDryWet(simd, simdGains, 0.25f, 0.75f, frames);
+			MixHelpers::setSimdEnabled(false);
+			const double scalarSquares = MixHelpers::mixDryWet(scalar, simdGains, 0.25f, 0.75f, frames);
+			for (int f = 0; f < frames; ++f)
+			{
+				QVERIFY(qAbs(simd[f][0] - scalar[f][0]) <= 1e-5f);
+				QVERIFY(qAbs(simd[f][1] - scalar[f][1]) <= 1e-5f);
+			}
+			QVERIFY(qAbs(simdSquares - scalarSquares) <= 1e-5 * (1.0 + scalarSquares));
+		}
+
+		MixHelpers::setSimdEnabled(true);
+		MixHelpers::setNaNHandler(nanHandler);
+	}
+
+	void PolyphaseMatchesScalarTests()
+	{
+		const int taps = 12;
+		const int phases = 8;
+		float bank[(phases + 1) * taps * 2];
+		for (int i = 0; i < (phases + 1) * taps * 2; ++i)
+		{
+			bank[i] = sinf(i * 0.37f) * 0.2f;
+		}
+		sampleFrame src[100];
+		for (int f = 0; f < 100; ++f)
+		{
+			src[f][0] = sinf(f * 0.1f);
+			src[f][1] = cosf(f * 0.13f);
+		}
+
+		// exactly on the rows of the bank and in between
+		const double steps[] = { 0.5, 0.73, 1.5 };
+		for (double step : steps)
+		{
+			sampleFrame simd[40];
+			sampleFrame scalar[40];
+			MixHelpers::setSimdEnabled(true);
+			MixHelpers::polyphase(simd, src, bank, taps, phases, 0.25, step, 40);
+			MixHelpers::setSimdEnabled(false);
+			MixHelpers::polyphase(scalar, src, bank, taps, phases, 0.25, step, 40);
+			QVERIFY(memcmp(simd, scalar, sizeof(simd)) == 0);
+		}
+
+		MixHelpers::setSimdEnabled(true);
+	}
+
+	void InterleaveTests()
+	{
+		sampleFrame src[16];
+		for (int f = 0; f < 16; ++f)
+		{
+			src[f][0] = f;
+			src[f][1] = -f;
+		}
+
+		float left[16];
+		float right[16];
+		float* channels[] = { left, right };
+		MixHelpers::deinterleave(channels, src, 16);
+		QCOMPARE(left[5], 5.0f);
+		QCOMPARE(right[5], -5.0f);
+
+		sampleFrame dst[16];
+		MixHelpers::interleave(dst, channels, 16);
+		QVERIFY(memcmp(dst, src, sizeof(src)) == 0);
+	}
+} MixHelpersTests;
+
+#include "MixHelpersTest.moc"
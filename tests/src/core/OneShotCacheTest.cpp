@@ -0,0 +1,92 @@
+/*
+ * OneShotCacheTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include "OneShotCache.h"
+
+// renders a ramp of 100 frames
+class RampRenderer : public OneShotCache::Renderer
+{
+public:
+	RampRenderer(int* calls) :
+		m_calls(calls),
+		m_frame(0)
+	{
+	}
+
+	bool render(sampleFrame* buf, fpp_t frames) override
+	{
+		++*m_calls;
+		for (fpp_t f = 0; f < frames; ++f, ++m_frame)
+		{
+			buf[f][0] = buf[f][1] = m_frame < 100 ? m_frame : 0;
+		}
+		return m_frame < 100;
+	}
+
+private:
+	int* m_calls;
+	int m_frame;
+};
+
+class OneShotCacheTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void StreamingTests()
+	{
+		OneShotCache cache;
+		OneShotCache::Key key;
+		key << 1.0f << 2;
+		int calls = 0;
+		sampleFrame buf[64];
+
+		OneShotCache::Voice first(&cache, key, new RampRenderer(&calls));
+		QVERIFY(!first.isCached());
+		while (first.isPlaying())
+		{
+			first.render(buf, 64);
+		}
+		QCOMPARE(calls, 2);
+		QCOMPARE(cache.size(), 1);
+
+		// the same sound streams from the cache
+		OneShotCache::Voice second(&cache, key, new RampRenderer(&calls));
+		QVERIFY(second.isCached());
+		second.render(buf, 64);
+		QCOMPARE(buf[10][0], 10.0f);
+		second.render(buf, 64);
+		QCOMPARE(buf[35][1], 99.0f);
+		QCOMPARE(buf[63][1], 0.0f);
+		QVERIFY(!second.isPlaying());
+		QCOMPARE(calls, 2);
+
+		// other parameters miss the cache
+		OneShotCache::Key other;
+		other << 1.5f << 2;
+		OneShotCache::Voice third(&cache, other, new RampRenderer(&calls));
+		QVERIFY(!third.isCached());
+	}
+} OneShotCacheTests;
+
+#include "OneShotCacheTest.moc"
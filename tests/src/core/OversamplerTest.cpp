@@ -0,0 +1,77 @@
+/*
+ * OversamplerTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include "Oversampler.h"
+#include "lmms_constants.h"
+
+#include <cmath>
+
+class OversamplerTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void RoundTripTests()
+	{
+		// a tone comes back as it was, only later by the latency
+		for (int factor : {2, 4, 8})
+		{
+			Oversampler oversampler(factor, Decimator::Balanced);
+			QCOMPARE(oversampler.factor(), factor);
+			const float latency = oversampler.latency();
+
+			sampleFrame buf[256];
+			for (int period = 0; period < 4; ++period)
+			{
+				for (int f = 0; f < 256; ++f)
+				{
+					buf[f][0] = buf[f][1] =
+						sinf(2.0f * F_PI * 0.05f * (period * 256 + f));
+				}
+				int frames = 0;
+				oversampler.process(buf, 256, [&](sampleFrame*, fpp_t n) { frames += n; });
+				QCOMPARE(frames, 256 * factor);
+				if (period == 0)
+				{
+					continue;
+				}
+				for (int f = 0; f < 256; ++f)
+				{
+					const float expected = sinf(2.0f * F_PI * 0.05f *
+								(period * 256 + f - latency));
+					QVERIFY(fabsf(buf[f][0] - expected) < 1e-3f);
+				}
+			}
+		}
+
+		// without oversampling the stage gets the buffer itself
+		Oversampler bypass(1);
+		sampleFrame buf[4];
+		sampleFrame* seen = nullptr;
+		bypass.process(buf, 4, [&](sampleFrame* b, fpp_t) { seen = b; });
+		QCOMPARE(seen, buf);
+		QCOMPARE(bypass.latency(), 0.f);
+	}
+} OversamplerTests;
+
+#include "OversamplerTest.moc"
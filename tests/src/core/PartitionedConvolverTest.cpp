@@ -0,0 +1,77 @@
+/*
+ * PartitionedConvolverTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "PartitionedConvolver.h"
+
+class PartitionedConvolverTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void MatchesDirectConvolutionTests()
+	{
+		// lengths ending in the head, in the first stage and in the
+		// stages computed a block ahead
+		for (int length : {50, 700, 1100, 20000})
+		{
+			std::vector<float> ir(length);
+			for (int k = 0; k < length; ++k)
+			{
+				ir[k] = ((k * 37 + 11) % 200 - 100) / 1000.0f;
+			}
+			std::vector<float> in(40000);
+			for (size_t n = 0; n < in.size(); ++n)
+			{
+				in[n] = ((n * 53 + 7) % 200 - 100) / 100.0f;
+			}
+
+			PartitionedConvolver convolver(ir.data(), length, false);
+			std::vector<float> out = in;
+			// uneven chunks, starting and ending within blocks
+			const int chunks[] = {64, 37, 1, 200, 256, 13};
+			size_t pos = 0;
+			for (int i = 0; pos < out.size(); ++i)
+			{
+				const int frames = std::min<int>(chunks[i % 6], out.size() - pos);
+				convolver.process(out.data() + pos, frames);
+				pos += frames;
+			}
+
+			for (size_t n = 0; n < out.size(); n += 101)
+			{
+				double expected = 0.0;
+				for (int k = 0; k < length && k <= static_cast<int>(n); ++k)
+				{
+					expected += static_cast<double>(ir[k]) * in[n - k];
+				}
+				QVERIFY(std::abs(out[n] - expected) < 1e-4);
+			}
+		}
+	}
+} PartitionedConvolverTests;
+
+#include "PartitionedConvolverTest.moc"
@@ -0,0 +1,97 @@
+/*
+ * RenderCacheTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include <QTemporaryDir>
+
+#include "RenderCache.h"
+
+class RenderCacheTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void DirtyRunTests()
+	{
+		QTemporaryDir dir;
+		QVector<QByteArray> hashes;
+		hashes << "a" << "b" << "c" << "d" << "e" << "f";
+
+		{
+			RenderCache cache(dir.path(), "44100", 1, 10);
+			cache.setBarHashes(hashes);
+			QCOMPARE(cache.dirtyRuns().size(), 1);
+			QCOMPARE(cache.dirtyRuns()[0].begin, 0);
+			QCOMPARE(cache.dirtyRuns()[0].end, 6);
+
+			// the frames of each bar and the end of the last one
+			const QString file = cache.createFile();
+			QVERIFY(!file.isEmpty());
+			QVERIFY(!cache.addRun(cache.dirtyRuns()[0], file,
+						QVector<f_cnt_t>() << 0 << 100));
+			QVERIFY(cache.addRun(cache.dirtyRuns()[0], file,
+				QVector<f_cnt_t>() << 0 << 100 << 200 << 300
+							<< 400 << 500 << 600));
+			QVERIFY(cache.save());
+		}
+
+		{
+			RenderCache cache(dir.path(), "44100", 1, 10);
+			cache.setBarHashes(hashes);
+			QVERIFY(cache.dirtyRuns().isEmpty());
+
+			// each bar but the last brings the frames to crossfade along
+			const QVector<SegmentStitcher::Segment> segments =
+							cache.segments();
+			QCOMPARE(segments.size(), 6);
+			QCOMPARE(segments[2].begin, 200);
+			QCOMPARE(segments[2].frames, 110);
+			QCOMPARE(segments[5].frames, 100);
+
+			// the bar after a changed one is within its tail
+			QVector<QByteArray> changed = hashes;
+			changed[2] = "x";
+			cache.setBarHashes(changed);
+			QCOMPARE(cache.dirtyRuns().size(), 1);
+			QCOMPARE(cache.dirtyRuns()[0].begin, 2);
+			QCOMPARE(cache.dirtyRuns()[0].end, 4);
+
+			// a longer song only renders the new bars
+			QVector<QByteArray> longer = hashes;
+			longer << "g";
+			cache.setBarHashes(longer);
+			QCOMPARE(cache.dirtyRuns().size(), 1);
+			QCOMPARE(cache.dirtyRuns()[0].begin, 6);
+			QCOMPARE(cache.dirtyRuns()[0].end, 7);
+		}
+
+		{
+			// rendered differently
+			RenderCache cache(dir.path(), "48000", 1, 10);
+			cache.setBarHashes(hashes);
+			QCOMPARE(cache.dirtyRuns().size(), 1);
+			QCOMPARE(cache.dirtyRuns()[0].end, 6);
+		}
+	}
+} RenderCacheTests;
+
+#include "RenderCacheTest.moc"
@@ -0,0 +1,163 @@
+/*
+ * SampleCacheTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include "QTestSuite.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "MemoryManager.h"
+#include "SampleCache.h"
+
+class SampleCacheTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void SharingTests()
+	{
+		const int entries = SampleCache::size();
+		const SampleCache::Key key = {"/samples/kick.wav", 1000, 44100, false};
+
+		f_cnt_t frames = 0;
+		QVERIFY(SampleCache::acquire(key, frames) == nullptr);
+
+		sampleFrame* data = MM_ALLOC_TAGGED(sampleFrame, 10, SampleBuffers);
+		QCOMPARE(SampleCache::insert(key, data, 10), data);
+		QCOMPARE(SampleCache::acquire(key, frames), data);
+		QCOMPARE(frames, 10);
+
+		// a second decode of the same file is dropped in favour of the first
+		sampleFrame* again = MM_ALLOC_TAGGED(sampleFrame, 10, SampleBuffers);
+		QCOMPARE(SampleCache::insert(key, again, 10), data);
+		QCOMPARE(SampleCache::size(), entries + 1);
+
+		// other properties get their own entries
+		SampleCache::Key reversed = key;
+		reversed.reversed = true;
+		SampleCache::Key modified = key;
+		modified.modified = 2000;
+		QVERIFY(SampleCache::acquire(reversed, frames) == nullptr);
+		QVERIFY(SampleCache::acquire(modified, frames) == nullptr);
+		QVERIFY(SampleCache::acquireCompact(key, frames) == nullptr);
+
+		SampleCache::release(data);
+		SampleCache::release(data);
+		QCOMPARE(SampleCache::size(), entries + 1);
+		SampleCache::release(data);
+		QCOMPARE(SampleCache::size(), entries);
+	}
+
+	void CompactTests()
+	{
+		const int entries = SampleCache::size();
+		const SampleCache::Key key = {"/samples/snare.wav", 1000, 44100, false};
+
+		qint16* data = MM_ALLOC_TAGGED(qint16, 20, SampleBuffers);
+		QCOMPARE(SampleCache::insertCompact(key, data, 10), data);
+
+		f_cnt_t frames = 0;
+		QVERIFY(SampleCache::acquire(key, frames) == nullptr);
+		QCOMPARE(SampleCache::acquireCompact(key, frames), data);
+		QCOMPARE(frames, 10);
+
+		SampleCache::release(data);
+		SampleCache::release(data);
+		QCOMPARE(SampleCache::size(), entries);
+	}
+
+	void RetainTests()
+	{
+		const int entries = SampleCache::size();
+		const SampleCache::Key first = {"/samples/hat.wav", 1000, 44100, false};
+		const SampleCache::Key second = {"/samples/clap.wav", 1000, 44100, false};
+
+		// room for one of them
+		SampleCache::setRetainBudget(15 * sizeof(sampleFrame));
+		sampleFrame* data = MM_ALLOC_TAGGED(sampleFrame, 10, SampleBuffers);
+		SampleCache::insert(first, data, 10);
+		SampleCache::release(data);
+		QCOMPARE(SampleCache::size(), entries + 1);
+
+		f_cnt_t frames = 0;
+		QCOMPARE(SampleCache::acquire(first, frames), data);
+		SampleCache::release(data);
+
+		// the one released first goes to make room
+		sampleFrame* other = MM_ALLOC_TAGGED(sampleFrame, 10, SampleBuffers);
+		SampleCache::insert(second, other, 10);
+		SampleCache::release(other);
+		QCOMPARE(SampleCache::size(), entries + 1);
+		QVERIFY(SampleCache::acquire(first, frames) == nullptr);
+
+		SampleCache::setRetainBudget(0);
+		QCOMPARE(SampleCache::size(), entries);
+	}
+
+	void DiskCacheTests()
+	{
+		QTemporaryDir dir;
+		QFile source(dir.path() + "/tom.wav");
+		QVERIFY(source.open(QIODevice::WriteOnly));
+		source.write("RIFF");
+		source.close();
+
+		const int entries = SampleCache::size();
+		SampleCache::setDiskCacheDir(dir.path() + "/cache");
+		const SampleCache::Key key = {source.fileName(), 1000, 44100, false};
+
+		sampleFrame* data = MM_ALLOC_TAGGED(sampleFrame, 10, SampleBuffers);
+		for (int f = 0; f < 10; ++f)
+		{
+			data[f][0] = f;
+			data[f][1] = -f;
+		}
+		SampleCache::insert(key, data, 10);
+		SampleCache::release(data);
+		QCOMPARE(SampleCache::size(), entries);
+
+		// comes back from the file
+		f_cnt_t frames = 0;
+		const sampleFrame* mapped = SampleCache::acquire(key, frames);
+		QVERIFY(mapped != nullptr);
+		QCOMPARE(frames, 10);
+		QCOMPARE(mapped[9][0], 9.0f);
+		QCOMPARE(mapped[9][1], -9.0f);
+		SampleCache::release(mapped);
+
+		// so does a copy of the sample, but not at another rate
+		QVERIFY(source.copy(dir.path() + "/copy.wav"));
+		SampleCache::Key copy = key;
+		copy.file = dir.path() + "/copy.wav";
+		mapped = SampleCache::acquire(copy, frames);
+		QVERIFY(mapped != nullptr);
+		SampleCache::release(mapped);
+		copy.sampleRate = 48000;
+		QVERIFY(SampleCache::acquire(copy, frames) == nullptr);
+
+		SampleCache::setDiskCacheDir(QString());
+		QCOMPARE(SampleCache::size(), entries);
+	}
+} SampleCacheTests;
+
+#include "SampleCacheTest.moc"
@@ -0,0 +1,68 @@
+/*
+ * SamplePeaksTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include <vector>
+
+#include "SamplePeaks.h"
+
+class SamplePeaksTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void RangeTests()
+	{
+		const f_cnt_t frames = 100000;
+		std::vector<sampleFrame> data(frames);
+		for (f_cnt_t f = 0; f < frames; ++f)
+		{
+			data[f][0] = 0.1f;
+			data[f][1] = -0.1f;
+		}
+		data[50000][0] = 0.9f;
+		data[70000][1] = -0.8f;
+
+		const SamplePeaks peaks(data.data(), frames);
+		float min[DEFAULT_CHANNELS];
+		float max[DEFAULT_CHANNELS];
+
+		peaks.range(0, frames, min, max);
+		QVERIFY(qAbs(max[0] - 0.9f) < 0.001f);
+		QVERIFY(qAbs(min[1] + 0.8f) < 0.001f);
+
+		// far from the peaks at any level
+		peaks.range(10000, 20000, min, max);
+		QVERIFY(qAbs(max[0] - 0.1f) < 0.001f);
+		QVERIFY(qAbs(min[1] + 0.1f) < 0.001f);
+
+		peaks.range(49990, 50100, min, max);
+		QVERIFY(qAbs(max[0] - 0.9f) < 0.001f);
+		QVERIFY(qAbs(min[1] + 0.1f) < 0.001f);
+
+		// the last bucket is partial
+		peaks.range(frames - 10, frames + 10, min, max);
+		QVERIFY(qAbs(max[0] - 0.1f) < 0.001f);
+	}
+} SamplePeaksTests;
+
+#include "SamplePeaksTest.moc"
@@ -0,0 +1,70 @@
+/*
+ * TimeStretchTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include "MemoryManager.h"
+#include "TimeStretch.h"
+#include "lmms_constants.h"
+
+#include <cmath>
+
+class TimeStretchTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void ToneTests()
+	{
+		// a tone keeps its level and, unless shifted, its pitch
+		const int sampleRate = 44100;
+		const f_cnt_t frames = sampleRate;
+		sampleFrame* tone = MM_ALLOC_TAGGED(sampleFrame, frames, SampleBuffers);
+		for (f_cnt_t f = 0; f < frames; ++f)
+		{
+			tone[f][0] = tone[f][1] = 0.5f * sinf(2.0f * F_PI * 440.0f * f / sampleRate);
+		}
+
+		struct Case { double speed; int semitones; double frequency; };
+		for (const Case& c : {Case{0.5, 0, 440.0}, Case{1.5, 0, 440.0}, Case{1.0, 12, 880.0}})
+		{
+			sampleFrame* out = TimeStretch::process(tone, frames, c.speed, c.semitones, sampleRate);
+			const f_cnt_t outFrames = TimeStretch::stretchedFrames(frames, c.speed);
+			QCOMPARE(outFrames, static_cast<f_cnt_t>(llround(frames / c.speed)));
+
+			// away from the ends
+			int crossings = 0;
+			double squares = 0;
+			for (f_cnt_t f = outFrames / 4; f < outFrames * 3 / 4; ++f)
+			{
+				crossings += out[f - 1][0] < 0 && out[f][0] >= 0;
+				squares += out[f][0] * out[f][0];
+			}
+			const double seconds = (outFrames / 2) / double(sampleRate);
+			QVERIFY(fabs(crossings / seconds - c.frequency) < c.frequency * 0.01);
+			QVERIFY(fabs(sqrt(squares / (outFrames / 2)) - 0.5 / sqrt(2.0)) < 0.01);
+			MM_FREE(out);
+		}
+		MM_FREE(tone);
+	}
+} TimeStretchTests;
+
+#include "TimeStretchTest.moc"
@@ -0,0 +1,65 @@
+/*
+ * TripleBufferTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include "TripleBuffer.h"
+
+class TripleBufferTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void HandoverTests()
+	{
+		TripleBuffer<int> buffer;
+		buffer.forEach([](int& value) { value = 0; });
+		QCOMPARE(buffer.read(), 0);
+
+		buffer.back() = 1;
+		buffer.publish();
+		QVERIFY(!buffer.taken());
+		QCOMPARE(buffer.read(), 1);
+		QVERIFY(buffer.taken());
+
+		// the reader keeps the latest state until there is a newer one
+		QCOMPARE(buffer.read(), 1);
+
+		// states it didn't get in time are replaced
+		buffer.back() = 2;
+		buffer.publish();
+		buffer.back() = 3;
+		buffer.publish();
+		QCOMPARE(buffer.read(), 3);
+
+		// the writer never gets the buffer the reader looks at
+		const int& read = buffer.read();
+		for (int i = 4; i < 10; ++i)
+		{
+			buffer.back() = i;
+			buffer.publish();
+			QCOMPARE(read, 3);
+		}
+		QCOMPARE(buffer.read(), 9);
+	}
+} TripleBufferTests;
+
+#include "TripleBufferTest.moc"
@@ -0,0 +1,76 @@
+/*
+ * UserWaveMipMapTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include <cmath>
+
+#include "lmms_constants.h"
+#include "UserWaveMipMap.h"
+
+class UserWaveMipMapTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void SineTests()
+	{
+		float cycle[64];
+		for (int i = 0; i < 64; ++i)
+		{
+			cycle[i] = sinf(F_2PI * i / 64);
+		}
+		UserWaveMipMap waves(cycle, 64);
+
+		// a sine has a single partial, which every level keeps
+		for (int l = 0; l < waves.levels(); ++l)
+		{
+			QVERIFY(fabsf(waves.sample(l, 0.25f) - 1.0f) < 1e-3f);
+			QVERIFY(fabsf(waves.sample(l, 0.1f) - sinf(F_2PI * 0.1f)) < 1e-3f);
+		}
+	}
+
+	void LevelTests()
+	{
+		const float square[8] = {1, 1, 1, 1, -1, -1, -1, -1};
+		UserWaveMipMap waves(square, 8);
+
+		// 4, 2 and 1 partials
+		QCOMPARE(waves.levels(), 3);
+		QCOMPARE(waves.level(0.01f), 0);
+		QCOMPARE(waves.level(0.2f), 1);
+		QCOMPARE(waves.level(0.4f), 2);
+		QCOMPARE(waves.level(0.9f), 2);
+
+		// the first level goes through the drawn samples
+		for (int i = 0; i < 8; ++i)
+		{
+			QVERIFY(fabsf(waves.sample(0, i / 8.0f) - square[i]) < 1e-3f);
+		}
+
+		// only the fundamental is left on the last level
+		QVERIFY(fabsf(waves.sample(2, 0.0f) + waves.sample(2, 0.5f)) < 1e-3f);
+		QVERIFY(fabsf(waves.sample(2, 0.25f) + waves.sample(2, 0.75f)) < 1e-3f);
+		QVERIFY(fabsf(waves.sample(2, 0.0f) - waves.sample(2, 0.25f)) > 0.5f);
+	}
+} UserWaveMipMapTests;
+
+#include "UserWaveMipMapTest.moc"
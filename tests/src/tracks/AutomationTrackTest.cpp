@@ -74,6 +74,27 @@ private slots:
 		QCOMPARE(p.valueAt(150), 1.0f);
 	}
 
+	void testPatternRenderValues()
+	{
+		AutomationPattern p(nullptr);
+		p.setProgressionType(AutomationPattern::LinearProgression);
+		p.putValue(0, 0.0, false);
+		p.putValue(100, 1.0, false);
+
+		float values[6];
+		QVERIFY(p.renderValues(values, 0.0f, 25.0f, 6));
+		QCOMPARE(values[0], 0.0f);
+		QCOMPARE(values[1], 0.25f);
+		QCOMPARE(values[2], 0.5f);
+		QCOMPARE(values[3], 0.75f);
+		QCOMPARE(values[4], 1.0f);
+		QCOMPARE(values[5], 1.0f);
+
+		p.setProgressionType(AutomationPattern::DiscreteProgression);
+		QVERIFY(!p.renderValues(values, 10.0f, 10.0f, 6));
+		QCOMPARE(values[5], 0.0f);
+	}
+
 	void testPatterns()
 	{
 		FloatModel model;